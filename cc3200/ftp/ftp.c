@@ -57,7 +57,12 @@
 #define FTP_CMD_PORT                        21
 #define FTP_ACTIVE_DATA_PORT                20
 #define FTP_PASIVE_DATA_PORT                2024
-#define FTP_BUFFER_SIZE                     512
+// two sectors, so FatFs can transfer whole sectors straight to/from the
+// buffer, while a block still fits in a single 1460 byte TCP segment
+#define FTP_BUFFER_SIZE                     1024
+// file data goes through two buffers of FTP_BUFFER_SIZE, used alternately
+// when sending, and together as one buffer when receiving
+#define FTP_RX_BUFFER_SIZE                  (FTP_BUFFER_SIZE * 2)
 #define FTP_TX_RETRIES_MAX                  25
 #define FTP_CMD_SIZE_MAX                    6
 #define FTP_CMD_CLIENTS_MAX                 1
@@ -119,6 +124,7 @@ typedef enum {
 
 typedef struct {
     uint8_t             *dBuffer;
+    uint32_t            dBufferLen;
     uint32_t            ctimeout;
     union {
         DIR             dp;
@@ -138,6 +144,7 @@ typedef struct {
     bool                closechild;
     bool                enabled;
     bool                swupdating;
+    uint8_t             dBufferIdx;
 
 } ftp_data_t;
 
@@ -205,8 +212,8 @@ static bool ftp_create_listening_socket (_i16 *sd, _u16 port, _u8 backlog);
 static ftp_result_t ftp_wait_for_connection (_i16 l_sd, _i16 *n_sd);
 static ftp_result_t ftp_send_non_blocking (_i16 sd, void *data, _i16 Len);
 static void ftp_send_reply (_u16 status, char *message);
-static void ftp_send_data (_u32 datasize);
-static void ftp_send_from_fifo (void);
+static void ftp_send_data (void *data, _u32 datasize);
+static bool ftp_send_from_fifo (void);
 static ftp_result_t ftp_recv_non_blocking (_i16 sd, void *buff, _i16 Maxlen, _i32 *rxLen);
 static void ftp_process_cmd (void);
 static void ftp_close_files (void);
@@ -231,7 +238,7 @@ static void ftp_reset (void);
  ******************************************************************************/
 void ftp_init (void) {
     // Allocate memory for the data buffer, and the file system structs (from the RTOS heap)
-    ASSERT ((ftp_data.dBuffer = mem_Malloc(FTP_BUFFER_SIZE)) != NULL);
+    ASSERT ((ftp_data.dBuffer = mem_Malloc(FTP_RX_BUFFER_SIZE)) != NULL);
     ASSERT ((ftp_path = mem_Malloc(FTP_MAX_PARAM_SIZE)) != NULL);
     ASSERT ((ftp_scratch_buffer = mem_Malloc(FTP_MAX_PARAM_SIZE)) != NULL);
     ASSERT ((ftp_cmd_buffer = mem_Malloc(FTP_MAX_PARAM_SIZE + FTP_CMD_SIZE_MAX)) != NULL);
@@ -287,7 +294,7 @@ void ftp_run (void) {
                 uint32_t listsize;
                 ftp_list_dir((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, &listsize);
                 if (listsize > 0) {
-                    ftp_send_data(listsize);
+                    ftp_send_data(ftp_data.dBuffer, listsize);
                 }
                 else {
                     ftp_send_reply(226, NULL);
@@ -297,19 +304,22 @@ void ftp_run (void) {
             }
             break;
         case E_FTP_STE_CONTINUE_FILE_TX:
-            // read the next block from the file only if the previous one has been sent
-            if (SOCKETFIFO_IsEmpty()) {
+            // read the next block into the free buffer while the other one is
+            // still queued or being transmitted by the network processor
+            while (SOCKETFIFO_Count() < 2 && ftp_data.state == E_FTP_STE_CONTINUE_FILE_TX) {
                 uint32_t readsize;
                 ftp_result_t result;
+                uint8_t *buf = ftp_data.dBuffer + ftp_data.dBufferIdx * FTP_BUFFER_SIZE;
                 ftp_data.ctimeout = 0;
-                result = ftp_read_file ((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, &readsize);
+                result = ftp_read_file ((char *)buf, FTP_BUFFER_SIZE, &readsize);
                 if (result == E_FTP_RESULT_FAILED) {
                     ftp_send_reply(451, NULL);
                     ftp_data.state = E_FTP_STE_END_TRANSFER;
                 }
                 else {
                     if (readsize > 0) {
-                        ftp_send_data(readsize);
+                        ftp_send_data(buf, readsize);
+                        ftp_data.dBufferIdx ^= 1;
                     }
                     if (result == E_FTP_RESULT_OK) {
                         ftp_send_reply(226, NULL);
@@ -322,30 +332,43 @@ void ftp_run (void) {
             if (SOCKETFIFO_IsEmpty()) {
                 _i32 len;
                 ftp_result_t result;
-                if (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data.d_sd, ftp_data.dBuffer, FTP_BUFFER_SIZE, &len))) {
+                // gather everything that has arrived, and only write once the
+                // buffer is full (or the transfer ends), so that FatFs and the
+                // updater get large sector aligned writes instead of one per packet
+                while (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data.d_sd, ftp_data.dBuffer + ftp_data.dBufferLen,
+                                                                           FTP_RX_BUFFER_SIZE - ftp_data.dBufferLen, &len))) {
                     ftp_data.dtimeout = 0;
                     ftp_data.ctimeout = 0;
-                    // its a software update
+                    ftp_data.dBufferLen += len;
+                    if (ftp_data.dBufferLen == FTP_RX_BUFFER_SIZE) {
+                        break;
+                    }
+                }
+                if (ftp_data.dBufferLen == FTP_RX_BUFFER_SIZE || (result == E_FTP_RESULT_FAILED && ftp_data.dBufferLen > 0)) {
+                    bool written;
+                    // its a software update, written straight to the serial flash
                     if (ftp_data.swupdating) {
-                        if (updater_write(ftp_data.dBuffer, len)) {
-                            break;
-                        }
+                        written = updater_write(ftp_data.dBuffer, ftp_data.dBufferLen);
                     }
                     // user file being received
-                    else if (E_FTP_RESULT_OK == ftp_write_file ((char *)ftp_data.dBuffer, len)) {
+                    else {
+                        written = (E_FTP_RESULT_OK == ftp_write_file ((char *)ftp_data.dBuffer, ftp_data.dBufferLen));
+                    }
+                    ftp_data.dBufferLen = 0;
+                    if (!written) {
+                        ftp_send_reply(451, NULL);
+                        ftp_data.state = E_FTP_STE_END_TRANSFER;
                         break;
                     }
-                    ftp_send_reply(451, NULL);
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
                 }
-                else if (result == E_FTP_RESULT_CONTINUE) {
+                if (result == E_FTP_RESULT_CONTINUE) {
                     if (ftp_data.dtimeout++ > FTP_DATA_TIMEOUT_MS / FTP_CYCLE_TIME_MS) {
                         ftp_close_files();
                         ftp_send_reply(426, NULL);
                         ftp_data.state = E_FTP_STE_END_TRANSFER;
                     }
                 }
-                else {
+                else if (result == E_FTP_RESULT_FAILED) {
                     if (ftp_data.swupdating) {
                         ftp_data.swupdating = false;
                         updater_finnish();
@@ -388,8 +411,8 @@ void ftp_run (void) {
         break;
     }
 
-    // send data pending in the queue
-    ftp_send_from_fifo();
+    // send data pending in the queue, until the network processor can't take more
+    while (ftp_send_from_fifo());
 
     // check the state of the data sockets
     if (ftp_data.d_sd < 0 && (ftp_data.state > E_FTP_STE_READY)) {
@@ -515,10 +538,10 @@ static void ftp_send_reply (_u16 status, char *message) {
     }
 }
 
-static void ftp_send_data (_u32 datasize) {
+static void ftp_send_data (void *data, _u32 datasize) {
     SocketFifoElement_t fifoelement;
 
-    fifoelement.data = ftp_data.dBuffer;
+    fifoelement.data = data;
     fifoelement.datasize = datasize;
     fifoelement.sd = &ftp_data.d_sd;
     fifoelement.closesockets = E_FTP_CLOSE_NONE;
@@ -526,7 +549,8 @@ static void ftp_send_data (_u32 datasize) {
     SOCKETFIFO_Push (&fifoelement);
 }
 
-static void ftp_send_from_fifo (void) {
+// returns true if an element was taken off the queue
+static bool ftp_send_from_fifo (void) {
     SocketFifoElement_t fifoelement;
     if (SOCKETFIFO_Peek (&fifoelement)) {
         _i16 _sd = *fifoelement.sd;
@@ -546,6 +570,7 @@ static void ftp_send_from_fifo (void) {
                 if (fifoelement.freedata) {
                     mem_Free(fifoelement.data);
                 }
+                return true;
             }
         }
         // socket closed, remove from the queue
@@ -554,6 +579,7 @@ static void ftp_send_from_fifo (void) {
             if (fifoelement.freedata) {
                 mem_Free(fifoelement.data);
             }
+            return true;
         }
     }
     else if (ftp_data.state == E_FTP_STE_END_TRANSFER && (ftp_data.d_sd > 0)) {
@@ -564,6 +590,7 @@ static void ftp_send_from_fifo (void) {
             ftp_data.swupdating = false;
         }
     }
+    return false;
 }
 
 static ftp_result_t ftp_recv_non_blocking (_i16 sd, void *buff, _i16 Maxlen, _i32 *rxLen) {
@@ -715,7 +742,7 @@ static void ftp_process_cmd (void) {
             if ((result = ftp_open_dir_for_listing(ftp_path, (char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, &listsize)) == E_FTP_RESULT_OK) {
                 ftp_data.state = E_FTP_STE_END_TRANSFER;
                 ftp_send_reply(150, NULL);
-                ftp_send_data(listsize);
+                ftp_send_data(ftp_data.dBuffer, listsize);
                 ftp_send_reply(226, NULL);
             }
             else if (result == E_FTP_RESULT_CONTINUE) {
@@ -729,6 +756,7 @@ static void ftp_process_cmd (void) {
         case E_FTP_CMD_RETR:
             ftp_get_param_and_open_child (&bufptr);
             if (ftp_open_file (ftp_path, FA_READ)) {
+                ftp_data.dBufferIdx = 0;
                 ftp_data.state = E_FTP_STE_CONTINUE_FILE_TX;
                 ftp_send_reply(150, NULL);
             }
@@ -746,6 +774,7 @@ static void ftp_process_cmd (void) {
                 f_unlink(ftp_path);
                 if (updater_start()) {
                     ftp_data.swupdating = true;
+                    ftp_data.dBufferLen = 0;
                     ftp_data.state = E_FTP_STE_CONTINUE_FILE_RX;
                     ftp_send_reply(150, NULL);
                 }
@@ -756,6 +785,7 @@ static void ftp_process_cmd (void) {
             }
             else {
                 if (ftp_open_file (ftp_path, FA_WRITE | FA_CREATE_ALWAYS)) {
+                    ftp_data.dBufferLen = 0;
                     ftp_data.state = E_FTP_STE_CONTINUE_FILE_RX;
                     ftp_send_reply(150, NULL);
                 }
@@ -150,6 +150,8 @@ void mp_hal_stdout_tx_strn_cooked(const char *str, uint32_t len) {
 }
 
 int mp_hal_stdin_rx_chr(void) {
+    // make sure everything printed so far is out before waiting for input
+    telnet_tx_flush();
     for ( ;; ) {
         if (telnet_rx_any()) {
             return telnet_rx_char();
@@ -32,6 +32,7 @@
 #include "py/mpstate.h"
 #include MICROPY_HAL_H
 #include "py/runtime.h"
+#include "py/stream.h"
 #include "netutils.h"
 #include "modnetwork.h"
 #include "mpexception.h"
@@ -222,6 +223,38 @@ STATIC mp_obj_t socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recv_obj, socket_recv);
 
+// get the buffer, and optional length limit, for the *_into methods
+STATIC void socket_get_into_buffer(mp_uint_t n_args, const mp_obj_t *args, mp_buffer_info_t *bufinfo) {
+    mod_network_socket_obj_t *self = args[0];
+    if (self->nic == MP_OBJ_NULL) {
+        // not connected
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(ENOTCONN)));
+    }
+    mp_get_buffer_raise(args[1], bufinfo, MP_BUFFER_WRITE);
+    if (n_args > 2) {
+        mp_int_t len = mp_obj_get_int(args[2]);
+        if (len >= 0 && len < bufinfo->len) {
+            bufinfo->len = len;
+        }
+    }
+}
+
+// method socket.recv_into(buf[, nbytes])
+// receives straight into a caller-owned buffer, so a receive loop can reuse
+// one bytearray (or a memoryview slice of it) instead of allocating per call
+STATIC mp_obj_t socket_recv_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mod_network_socket_obj_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    socket_get_into_buffer(n_args, args, &bufinfo);
+    int _errno;
+    mp_int_t ret = self->nic_type->recv(self, bufinfo.buf, bufinfo.len, &_errno);
+    if (ret == -1) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+    }
+    return mp_obj_new_int(ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_into_obj, 2, 3, socket_recv_into);
+
 // method socket.sendto(bytes, address)
 STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
     mod_network_socket_obj_t *self = self_in;
@@ -274,6 +307,25 @@ STATIC mp_obj_t socket_recvfrom(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recvfrom_obj, socket_recvfrom);
 
+// method socket.recvfrom_into(buf[, nbytes])
+STATIC mp_obj_t socket_recvfrom_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mod_network_socket_obj_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    socket_get_into_buffer(n_args, args, &bufinfo);
+    byte ip[4];
+    mp_uint_t port;
+    int _errno;
+    mp_int_t ret = self->nic_type->recvfrom(self, bufinfo.buf, bufinfo.len, ip, &port, &_errno);
+    if (ret == -1) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+    }
+    mp_obj_t tuple[2];
+    tuple[0] = mp_obj_new_int(ret);
+    tuple[1] = netutils_format_inet_addr(ip, port, NETUTILS_LITTLE);
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_obj, 2, 3, socket_recvfrom_into);
+
 // method socket.setsockopt(level, optname, value)
 STATIC mp_obj_t socket_setsockopt(mp_uint_t n_args, const mp_obj_t *args) {
     mod_network_socket_obj_t *self = args[0];
@@ -349,19 +401,50 @@ STATIC const mp_map_elem_t socket_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv), (mp_obj_t)&socket_recv_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendto), (mp_obj_t)&socket_sendto_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom), (mp_obj_t)&socket_recvfrom_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into), (mp_obj_t)&socket_recv_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom_into), (mp_obj_t)&socket_recvfrom_into_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setsockopt), (mp_obj_t)&socket_setsockopt_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_settimeout), (mp_obj_t)&socket_settimeout_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setblocking), (mp_obj_t)&socket_setblocking_obj },
+
+    // stream methods, which read into and write from any buffer without a copy
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&mp_stream_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&mp_stream_unbuffered_readline_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(socket_locals_dict, socket_locals_dict_table);
 
+STATIC mp_uint_t socket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    mod_network_socket_obj_t *self = self_in;
+    if (self->nic == MP_OBJ_NULL) {
+        // not connected
+        *errcode = ENOTCONN;
+        return MP_STREAM_ERROR;
+    }
+    return self->nic_type->recv(self, buf, size, errcode);
+}
+
+STATIC mp_uint_t socket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    mod_network_socket_obj_t *self = self_in;
+    if (self->nic == MP_OBJ_NULL) {
+        // not connected
+        *errcode = EBADF;
+        return MP_STREAM_ERROR;
+    }
+    return self->nic_type->send(self, buf, size, errcode);
+}
+
 mp_uint_t socket_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t arg, int *errcode) {
     mod_network_socket_obj_t *self = self_in;
     return self->nic_type->ioctl(self, request, arg, errcode);
 }
 
 STATIC const mp_stream_p_t socket_stream_p = {
+    .read = socket_read,
+    .write = socket_write,
     .ioctl = socket_ioctl,
     .is_text = false,
 };
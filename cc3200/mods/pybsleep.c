@@ -66,6 +66,12 @@
 #define WAKEUP_TIME_LPDS                        (LPDS_UP_TIME + LPDS_DOWN_TIME + USER_OFFSET)   // 20 msec
 #define WAKEUP_TIME_HIB                         (32768)       // 1 s
 
+// OCR register 0 is retained in hibernate; the top bit requests a fast wake
+// up and the rest holds a user value (OCR register 1 belongs to the RTC)
+#define RETAINED_OCR_REG                        (0)
+#define RETAINED_FASTWAKE                       (0x80000000)
+#define RETAINED_VALUE_MASK                     (0x7FFFFFFF)
+
 #define FORCED_TIMER_INTERRUPT_MS               (1)
 #define FAILED_SLEEP_DELAY_MS                   (FORCED_TIMER_INTERRUPT_MS * 3)
 
@@ -124,6 +130,7 @@ STATIC pybsleep_data_t   pybsleep_data = {NULL, NULL, NULL, 0};
 volatile arm_cm4_core_regs_t vault_arm_registers;
 STATIC pybsleep_reset_cause_t pybsleep_reset_cause = PYB_SLP_PWRON_RESET;
 STATIC pybsleep_reset_cause_t pybsleep_wake_reason = PYB_SLP_WAKED_PWRON;
+STATIC bool pybsleep_fastwake = false;
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -160,6 +167,9 @@ void pybsleep_init0 (void) {
     MAP_PRCMHibernateWakeupSourceDisable(PRCM_HIB_SLOW_CLK_CTR | PRCM_HIB_GPIO2  | PRCM_HIB_GPIO4  | PRCM_HIB_GPIO13 |
                                          PRCM_HIB_GPIO17       | PRCM_HIB_GPIO11 | PRCM_HIB_GPIO24 | PRCM_HIB_GPIO26);
 
+    // a fast wake up only applies to the first boot after hibernate
+    pybsleep_fastwake = false;
+
     // store the reset casue (if it's soft reset, leave it as it is)
     if (pybsleep_reset_cause != PYB_SLP_SOFT_RESET) {
         switch (MAP_PRCMSysResetCauseGet()) {
@@ -180,6 +190,7 @@ void pybsleep_init0 (void) {
             }
             else {
                 pybsleep_reset_cause = PYB_SLP_HIB_RESET;
+                pybsleep_fastwake = (MAP_PRCMOCRRegisterRead(RETAINED_OCR_REG) & RETAINED_FASTWAKE) != 0;
                 // set the correct wake reason
                 switch (MAP_PRCMHibernateWakeupCauseGet()) {
                 case PRCM_HIB_WAKEUP_CAUSE_SLOW_CLOCK:
@@ -196,6 +207,10 @@ void pybsleep_init0 (void) {
         default:
             break;
         }
+        if (pybsleep_reset_cause == PYB_SLP_PWRON_RESET) {
+            // the retention register holds garbage after a power on
+            MAP_PRCMOCRRegisterWrite(RETAINED_OCR_REG, 0);
+        }
     }
 }
 
@@ -241,6 +256,10 @@ pybsleep_reset_cause_t pybsleep_get_reset_cause (void) {
     return pybsleep_reset_cause;
 }
 
+bool pybsleep_is_fast_wake (void) {
+    return pybsleep_fastwake;
+}
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -613,10 +632,19 @@ STATIC mp_obj_t pyb_sleep_suspend (mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_sleep_suspend_obj, pyb_sleep_suspend);
 
-/// \function hibernate()
+/// \function hibernate([fastwake])
 /// Enters hibernate mode. Wake up sources should have been enable prior to
-/// calling this method.
-STATIC mp_obj_t pyb_sleep_hibernate (mp_obj_t self_in) {
+/// calling this method. RAM is not retained, so the board boots again when
+/// waking up; if `fastwake` is `True` that boot skips the telnet/ftp servers,
+/// the heartbeat and the filesystem checks, and goes straight to boot.py and
+/// main.py. Use suspend() when RAM has to be retained.
+STATIC mp_obj_t pyb_sleep_hibernate (mp_uint_t n_args, const mp_obj_t *args) {
+    uint32_t ocr = MAP_PRCMOCRRegisterRead(RETAINED_OCR_REG) & RETAINED_VALUE_MASK;
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        ocr |= RETAINED_FASTWAKE;
+    }
+    MAP_PRCMOCRRegisterWrite(RETAINED_OCR_REG, ocr);
+
     // check if we should enable timer wake-up
     if (pybsleep_data.timer_wake_pwrmode & PYB_PWR_MODE_HIBERNATE) {
         if (!setup_timer_hibernate_wake()) {
@@ -633,7 +661,21 @@ STATIC mp_obj_t pyb_sleep_hibernate (mp_obj_t self_in) {
     MAP_PRCMHibernateEnter();
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_sleep_hibernate_obj, pyb_sleep_hibernate);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_sleep_hibernate_obj, 1, 2, pyb_sleep_hibernate);
+
+/// \function retain([value])
+/// Get or set a 31-bit value that is kept across hibernate, for example a
+/// sample counter. It is cleared on power on.
+STATIC mp_obj_t pyb_sleep_retain (mp_uint_t n_args, const mp_obj_t *args) {
+    uint32_t ocr = MAP_PRCMOCRRegisterRead(RETAINED_OCR_REG);
+    if (n_args == 1) {
+        return mp_obj_new_int_from_uint(ocr & RETAINED_VALUE_MASK);
+    }
+    ocr = (ocr & RETAINED_FASTWAKE) | (mp_obj_get_int_truncated(args[1]) & RETAINED_VALUE_MASK);
+    MAP_PRCMOCRRegisterWrite(RETAINED_OCR_REG, ocr);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_sleep_retain_obj, 1, 2, pyb_sleep_retain);
 
 /// \function reset_cause()
 /// Returns the last reset casue
@@ -656,6 +698,7 @@ STATIC const mp_map_elem_t pybsleep_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_hibernate),               (mp_obj_t)&pyb_sleep_hibernate_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_reset_cause),             (mp_obj_t)&pyb_sleep_reset_cause_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_wake_reason),             (mp_obj_t)&pyb_sleep_wake_reason_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_retain),                  (mp_obj_t)&pyb_sleep_retain_obj },
 
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_ACTIVE),                  MP_OBJ_NEW_SMALL_INT(PYB_PWR_MODE_ACTIVE) },
@@ -72,5 +72,6 @@ void pybsleep_set_gpio_lpds_callback (mp_obj_t cb_obj);
 void pybsleep_set_timer_lpds_callback (mp_obj_t cb_obj);
 void pybsleep_configure_timer_wakeup (uint pwrmode);
 pybsleep_reset_cause_t pybsleep_get_reset_cause (void);
+bool pybsleep_is_fast_wake (void);
 
 #endif /* PYBSLEEP_H_ */
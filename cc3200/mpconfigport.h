@@ -34,6 +34,8 @@
 
 //#define MICROPY_DEBUG_PRINTERS      (1)
 #define MICROPY_ALLOC_PATH_MAX                      (128)
+#define MICROPY_ALLOC_QSTR_CHUNK_INIT               (64)
+#define MICROPY_QSTR_BYTES_IN_HASH                  (1)
 #define MICROPY_EMIT_THUMB                          (0)
 #define MICROPY_EMIT_INLINE_THUMB                   (0)
 #define MICROPY_COMP_MODULE_CONST                   (1)
@@ -73,7 +73,7 @@
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
 STATIC void mptask_pre_init (void);
-STATIC void mptask_init_sflash_filesystem (void);
+STATIC void mptask_init_sflash_filesystem (bool fastwake);
 STATIC void mptask_enter_ap_mode (void);
 STATIC void mptask_create_main_py (void);
 
@@ -130,8 +130,14 @@ soft_reset:
     rng_init0();
 #endif
 
+    // after hibernating with fastwake set, only what's needed to run
+    // boot.py and main.py again is brought up
+    bool fastwake = pybsleep_is_fast_wake();
+
     // we are alive, so let the world know it
-    mperror_enable_heartbeat();
+    if (!fastwake) {
+        mperror_enable_heartbeat();
+    }
 
 #ifdef LAUNCHXL
     // configure the stdio uart pins with the correct alternate functions
@@ -166,11 +172,13 @@ soft_reset:
         }
 
         // enable telnet and ftp
-        servers_start();
+        if (!fastwake) {
+            servers_start();
+        }
     }
 
     // initialize the serial flash file system
-    mptask_init_sflash_filesystem();
+    mptask_init_sflash_filesystem(fastwake);
 
     // append the flash paths to the system path
     mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR__slash_flash));
@@ -290,7 +298,7 @@ STATIC void mptask_pre_init (void) {
 #endif
 }
 
-STATIC void mptask_init_sflash_filesystem (void) {
+STATIC void mptask_init_sflash_filesystem (bool fastwake) {
     FILINFO fno;
 #if _USE_LFN
     fno.lfname = NULL;
@@ -301,6 +309,11 @@ STATIC void mptask_init_sflash_filesystem (void) {
     // Create it if needed, and mount in on /flash.
     // try to mount the flash
     FRESULT res = f_mount(sflash_fatfs, "/flash", 1);
+    if (fastwake && res == FR_OK) {
+        // the filesystem was checked before going to hibernate
+        f_chdrive("/flash");
+        return;
+    }
     if (res == FR_NO_FILESYSTEM) {
         // no filesystem, so create a fresh one
         res = f_mkfs("/flash", 1, 0);
@@ -211,6 +211,8 @@ Q(send)
 Q(sendto)
 Q(recv)
 Q(recvfrom)
+Q(recv_into)
+Q(recvfrom_into)
 Q(listen)
 Q(accept)
 Q(bind)
@@ -296,6 +298,7 @@ Q(Sleep)
 Q(idle)
 Q(suspend)
 Q(hibernate)
+Q(retain)
 Q(reset_cause)
 Q(wake_reason)
 Q(ACTIVE)
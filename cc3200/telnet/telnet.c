@@ -43,6 +43,8 @@
 #define TELNET_PORT                         23
 // rxRindex and rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256
 #define TELNET_RX_BUFFER_SIZE               256
+#define TELNET_TX_BUFFER_SIZE               512
+#define TELNET_TX_FLUSH_MS                  5
 #define TELNET_MAX_CLIENTS                  1
 #define TELNET_TX_RETRIES_MAX               25
 #define TELNET_WAIT_TIME_MS                 5
@@ -86,6 +88,10 @@ typedef union {
 
 typedef struct {
     uint8_t             *rxBuffer;
+    uint8_t             *txBuffer;
+    _SlLockObj_t        txLockObj;
+    uint32_t            txStart;
+    uint16_t            txLen;
     uint32_t            timeout;
     telnet_state_t      state;
     telnet_substate_t   substate;
@@ -131,6 +137,7 @@ static void telnet_process (void);
 static int telnet_process_credential (char *credential, _i16 rxLen);
 static void telnet_parse_input (uint8_t *str, int16_t *len);
 static bool telnet_send_with_retries (int16_t sd, const void *pBuf, int16_t len);
+static void telnet_tx_flush_locked (void);
 static void telnet_reset (void);
 static void telnet_reset_buffer (void);
 
@@ -140,6 +147,9 @@ static void telnet_reset_buffer (void);
 void telnet_init (void) {
     // Allocate memory for the receive buffer (from the RTOS heap)
     ASSERT ((telnet_data.rxBuffer = mem_Malloc(TELNET_RX_BUFFER_SIZE)) != NULL);
+    // and for the transmit buffer, shared by the MicroPython and the servers task
+    ASSERT ((telnet_data.txBuffer = mem_Malloc(TELNET_TX_BUFFER_SIZE)) != NULL);
+    ASSERT (OSI_OK == sl_LockObjCreate(&telnet_data.txLockObj, "TelnetTxLock"));
     telnet_data.state = E_TELNET_STE_DISABLED;
 }
 
@@ -230,6 +240,13 @@ void telnet_run (void) {
             break;
         case E_TELNET_STE_LOGGED_IN:
             telnet_process();
+            // send pending output once it has waited long enough; don't block
+            // if the MicroPython task is adding to the buffer right now
+            if (telnet_data.txLen > 0 && HAL_GetTick() - telnet_data.txStart >= TELNET_TX_FLUSH_MS &&
+                OSI_OK == sl_LockObjLock(&telnet_data.txLockObj, 0)) {
+                telnet_tx_flush_locked();
+                sl_LockObjUnlock(&telnet_data.txLockObj);
+            }
             break;
         default:
             break;
@@ -242,9 +259,28 @@ void telnet_run (void) {
     }
 }
 
+// Output is gathered in txBuffer and sent when it fills up, when the REPL
+// waits for input, or by the servers task once the oldest byte is
+// TELNET_TX_FLUSH_MS old; so printing line by line doesn't cost a TCP
+// segment (and a radio wake up) per line or character.
 void telnet_tx_strn (const char *str, int len) {
-    if (len > 0 && telnet_data.n_sd > 0) {
-        telnet_send_with_retries(telnet_data.n_sd, str, len);
+    // the lock can't be taken from interrupt context, output is dropped there
+    if (len > 0 && telnet_data.n_sd > 0 && (HAL_NVIC_INT_CTRL_REG & HAL_VECTACTIVE_MASK) == 0) {
+        sl_LockObjLock(&telnet_data.txLockObj, SL_OS_WAIT_FOREVER);
+        while (len > 0) {
+            if (telnet_data.txLen == 0) {
+                telnet_data.txStart = HAL_GetTick();
+            }
+            int n = MIN(len, TELNET_TX_BUFFER_SIZE - telnet_data.txLen);
+            memcpy(telnet_data.txBuffer + telnet_data.txLen, str, n);
+            telnet_data.txLen += n;
+            str += n;
+            len -= n;
+            if (telnet_data.txLen == TELNET_TX_BUFFER_SIZE) {
+                telnet_tx_flush_locked();
+            }
+        }
+        sl_LockObjUnlock(&telnet_data.txLockObj);
     }
 }
 
@@ -254,8 +290,8 @@ void telnet_tx_strn_cooked (const char *str, uint len) {
 
     for (int i = 0; i < len; i++) {
         if (str[i] == '\n') {
-            telnet_send_with_retries(telnet_data.n_sd, _str, nslen);
-            telnet_send_with_retries(telnet_data.n_sd, "\r\n", 2);
+            telnet_tx_strn(_str, nslen);
+            telnet_tx_strn("\r\n", 2);
             _str += nslen + 1;
             nslen = 0;
         }
@@ -264,7 +300,15 @@ void telnet_tx_strn_cooked (const char *str, uint len) {
         }
     }
     if (_str < str + len) {
-        telnet_send_with_retries(telnet_data.n_sd, _str, nslen);
+        telnet_tx_strn(_str, nslen);
+    }
+}
+
+void telnet_tx_flush (void) {
+    if (telnet_data.txLen > 0 && (HAL_NVIC_INT_CTRL_REG & HAL_VECTACTIVE_MASK) == 0) {
+        sl_LockObjLock(&telnet_data.txLockObj, SL_OS_WAIT_FOREVER);
+        telnet_tx_flush_locked();
+        sl_LockObjUnlock(&telnet_data.txLockObj);
     }
 }
 
@@ -492,10 +536,18 @@ static bool telnet_send_with_retries (int16_t sd, const void *pBuf, int16_t len)
     return false;
 }
 
+static void telnet_tx_flush_locked (void) {
+    if (telnet_data.txLen > 0 && telnet_data.n_sd > 0) {
+        telnet_send_with_retries(telnet_data.n_sd, telnet_data.txBuffer, telnet_data.txLen);
+    }
+    telnet_data.txLen = 0;
+}
+
 static void telnet_reset (void) {
     // close the connection and start all over again
     servers_close_socket(&telnet_data.n_sd);
     servers_close_socket(&telnet_data.sd);
+    telnet_data.txLen = 0;
     telnet_data.state = E_TELNET_STE_START;
 }
 
@@ -34,6 +34,7 @@ extern void telnet_init (void);
 extern void telnet_run (void);
 extern void telnet_tx_strn (const char *str, int len);
 extern void telnet_tx_strn_cooked (const char *str, uint len);
+extern void telnet_tx_flush (void);
 extern bool telnet_rx_any (void);
 extern int  telnet_rx_char (void);
 extern void telnet_enable (void);
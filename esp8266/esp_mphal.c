@@ -29,6 +29,9 @@
 #include "etshal.h"
 #include "uart.h"
 #include "esp_mphal.h"
+#include "py/nlr.h"
+#include "py/obj.h"
+#include "py/runtime.h"
 
 extern void ets_wdt_disable(void);
 extern void wdt_feed(void);
@@ -97,3 +100,39 @@ void mp_hal_set_interrupt_char(int c) {
 uint32_t mp_hal_get_cpu_freq(void) {
     return ets_get_cpu_frequency();
 }
+
+#if MICROPY_EMIT_XTENSA
+
+// The ESP8266 can't execute code from DRAM, so native code is copied to the
+// free end of IRAM, after the firmware's code.  IRAM only allows 32-bit
+// accesses, and the space is only given back on a soft reset.
+#define ESP_NATIVE_CODE_IRAM_END (0x40108000)
+
+extern char _lit4_end;
+STATIC uint32_t *esp_native_code_cur;
+
+void esp_native_code_init(void) {
+    esp_native_code_cur = (uint32_t*)(((uint32_t)&_lit4_end + 3) & ~3);
+    MP_STATE_PORT(native_code_ram) = MP_OBJ_NULL;
+}
+
+void *esp_native_code_commit(void *buf, mp_uint_t len) {
+    len = (len + 3) & ~3;
+    if ((uint32_t)esp_native_code_cur + len > ESP_NATIVE_CODE_IRAM_END) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "no IRAM for native code"));
+    }
+    // the code holds pointers to objects, so keep the DRAM copy for the GC
+    if (MP_STATE_PORT(native_code_ram) == MP_OBJ_NULL) {
+        MP_STATE_PORT(native_code_ram) = mp_obj_new_list(0, NULL);
+    }
+    mp_obj_list_append(MP_STATE_PORT(native_code_ram), buf);
+    uint32_t *dest = esp_native_code_cur;
+    const uint32_t *src = buf;
+    for (mp_uint_t i = 0; i < len / 4; i++) {
+        dest[i] = src[i];
+    }
+    esp_native_code_cur += len / 4;
+    return dest;
+}
+
+#endif
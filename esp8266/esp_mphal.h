@@ -40,6 +40,8 @@ void HAL_Delay(uint32_t Delay);
 void mp_hal_set_interrupt_char(int c);
 uint32_t mp_hal_get_cpu_freq(void);
 
+void esp_native_code_init(void);
+
 #define UART_TASK_ID 0
 void uart_task_init();
 
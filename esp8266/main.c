@@ -45,6 +45,7 @@ STATIC void mp_reset(void) {
     mp_hal_init();
     gc_init(heap, heap + sizeof(heap));
     mp_init();
+    esp_native_code_init();
     mp_obj_list_init(mp_sys_path, 0);
     mp_obj_list_init(mp_sys_argv, 0);
 #if MICROPY_MODULE_FROZEN
@@ -27,11 +27,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include "py/nlr.h"
 #include "py/obj.h"
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/stream.h"
 #include MICROPY_HAL_H
 #include "netutils.h"
 #include "queue.h"
@@ -41,6 +43,19 @@
 
 STATIC const mp_obj_type_t esp_socket_type;
 
+// Received data not taken by an onrecv callback goes into a per-socket ring
+// buffer, allocated on first use.  espconn only hands us a copy of each
+// packet, so reception is held (TCP flow control) once less than an MSS is
+// free, which guarantees the next packet always fits.
+#define ESP_SOCKET_MSS (1460)
+#define ESP_SOCKET_RECVBUF_SIZE (2 * ESP_SOCKET_MSS)
+
+// same values as stmhal's pybioctl.h
+#define MP_IOCTL_POLL (0x100 | 1)
+#define MP_IOCTL_POLL_RD  (0x0001)
+#define MP_IOCTL_POLL_WR  (0x0002)
+#define MP_IOCTL_POLL_HUP (0x0004)
+
 typedef struct _esp_socket_obj_t {
     mp_obj_base_t base;
     struct espconn *espconn;
@@ -51,9 +66,12 @@ typedef struct _esp_socket_obj_t {
     mp_obj_t cb_disconnect;
 
     uint8_t *recvbuf;
-    mp_uint_t recvbuf_len;
+    uint16_t recvbuf_head;
+    uint16_t recvbuf_tail;
 
     bool fromserver;
+    bool recv_held;
+    bool sending;
 
     mp_obj_list_t *connlist;
 } esp_socket_obj_t;
@@ -66,6 +84,10 @@ STATIC esp_socket_obj_t *esp_socket_listening;
 STATIC mp_obj_t esp_socket_make_new_base() {
     esp_socket_obj_t *s = m_new_obj_with_finaliser(esp_socket_obj_t);
     s->recvbuf = NULL;
+    s->recvbuf_head = 0;
+    s->recvbuf_tail = 0;
+    s->recv_held = false;
+    s->sending = false;
     s->base.type = (mp_obj_t)&esp_socket_type;
     s->cb_connect = mp_const_none;
     s->cb_recv = mp_const_none;
@@ -142,6 +164,30 @@ STATIC mp_obj_t esp_socket_bind(mp_obj_t self_in, mp_obj_t addr_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp_socket_bind_obj, esp_socket_bind);
 
+STATIC mp_uint_t esp_socket_recv_avail(esp_socket_obj_t *s) {
+    mp_uint_t head = s->recvbuf_head;
+    mp_uint_t tail = s->recvbuf_tail;
+    return head >= tail ? head - tail : ESP_SOCKET_RECVBUF_SIZE - tail + head;
+}
+
+STATIC mp_uint_t esp_socket_recv_free(esp_socket_obj_t *s) {
+    return ESP_SOCKET_RECVBUF_SIZE - 1 - esp_socket_recv_avail(s);
+}
+
+// take up to len bytes out of the receive buffer, returning how many
+STATIC mp_uint_t esp_socket_recv_take(esp_socket_obj_t *s, byte *buf, mp_uint_t len) {
+    len = MIN(len, esp_socket_recv_avail(s));
+    for (mp_uint_t i = 0; i < len; i++) {
+        buf[i] = s->recvbuf[s->recvbuf_tail];
+        s->recvbuf_tail = (s->recvbuf_tail + 1) % ESP_SOCKET_RECVBUF_SIZE;
+    }
+    if (s->recv_held && esp_socket_recv_free(s) >= ESP_SOCKET_MSS) {
+        s->recv_held = false;
+        espconn_recv_unhold(s->espconn);
+    }
+    return len;
+}
+
 STATIC void esp_socket_recv_callback(void *arg, char *pdata, unsigned short len) {
     struct espconn *conn = arg;
     esp_socket_obj_t *s = conn->reverse;
@@ -150,22 +196,20 @@ STATIC void esp_socket_recv_callback(void *arg, char *pdata, unsigned short len)
         call_function_2_protected(s->cb_recv, s, mp_obj_new_bytes((byte *)pdata, len));
     } else {
         if (s->recvbuf == NULL) {
-            s->recvbuf = gc_alloc(len, false);
-            s->recvbuf_len = len;
-            if (s->recvbuf != NULL) {
-                memcpy(s->recvbuf, pdata, len);
-            }
-        } else {
-            s->recvbuf = gc_realloc(s->recvbuf, s->recvbuf_len + len);
-            if (s->recvbuf != NULL) {
-                memcpy(&s->recvbuf[s->recvbuf_len], pdata, len);
-                s->recvbuf_len += len;
-            }
+            s->recvbuf = gc_alloc(ESP_SOCKET_RECVBUF_SIZE, false);
         }
-        if (s->recvbuf == NULL) {
+        if (s->recvbuf == NULL || len > esp_socket_recv_free(s)) {
             esp_socket_close(s);
             return;
         }
+        for (mp_uint_t i = 0; i < len; i++) {
+            s->recvbuf[s->recvbuf_head] = pdata[i];
+            s->recvbuf_head = (s->recvbuf_head + 1) % ESP_SOCKET_RECVBUF_SIZE;
+        }
+        if (!s->recv_held && esp_socket_recv_free(s) < ESP_SOCKET_MSS) {
+            s->recv_held = true;
+            espconn_recv_hold(conn);
+        }
     }
 }
 
@@ -173,6 +217,7 @@ STATIC void esp_socket_sent_callback(void *arg) {
     struct espconn *conn = arg;
     esp_socket_obj_t *s = conn->reverse;
 
+    s->sending = false;
     if (s->cb_sent != mp_const_none) {
         call_function_1_protected(s->cb_sent, s);
     }
@@ -304,6 +349,7 @@ STATIC mp_obj_t esp_socket_send(mp_obj_t self_in, mp_obj_t buf_in) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
 
+    s->sending = true;
     espconn_sent(s->espconn, bufinfo.buf, bufinfo.len);
 
     return mp_obj_new_int(bufinfo.len);
@@ -314,24 +360,15 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp_socket_send_obj, esp_socket_send);
 STATIC mp_obj_t esp_socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
     esp_socket_obj_t *s = self_in;
 
-    if (s->recvbuf == NULL) {
+    if (s->recvbuf == NULL || esp_socket_recv_avail(s) == 0) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError,
             "no data available"));
     }
 
-    mp_uint_t mxl = mp_obj_get_int(len_in);
-    if (mxl >= s->recvbuf_len) {
-        mp_obj_t trt = mp_obj_new_bytes(s->recvbuf, s->recvbuf_len);
-        gc_free(s->recvbuf);
-        s->recvbuf = NULL;
-        return trt;
-    } else {
-        mp_obj_t trt = mp_obj_new_bytes(s->recvbuf, mxl);
-        memmove(s->recvbuf, &s->recvbuf[mxl], s->recvbuf_len - mxl);
-        s->recvbuf_len -= mxl;
-        s->recvbuf = gc_realloc(s->recvbuf, s->recvbuf_len);
-        return trt;
-    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, MIN(mp_obj_get_int(len_in), esp_socket_recv_avail(s)));
+    esp_socket_recv_take(s, (byte*)vstr.buf, vstr.len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp_socket_recv_obj, esp_socket_recv);
 
@@ -378,10 +415,12 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp_socket_onconnect_obj, esp_socket_onconnect)
 STATIC mp_obj_t esp_socket_onrecv(mp_obj_t self_in, mp_obj_t lambda_in) {
     esp_socket_obj_t *s = self_in;
     s->cb_recv = lambda_in;
-    if (s->recvbuf != NULL) {
+    if (s->recvbuf != NULL && esp_socket_recv_avail(s) > 0) {
+        vstr_t vstr;
+        vstr_init_len(&vstr, esp_socket_recv_avail(s));
+        esp_socket_recv_take(s, (byte*)vstr.buf, vstr.len);
         call_function_2_protected(s->cb_recv, s,
-            mp_obj_new_bytes((byte *)s->recvbuf, s->recvbuf_len));
-        s->recvbuf = NULL;
+            mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr));
     }
     return mp_const_none;
 }
@@ -471,13 +510,86 @@ STATIC const mp_map_elem_t esp_socket_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_onrecv), (mp_obj_t)&esp_socket_onrecv_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_onsent), (mp_obj_t)&esp_socket_onsent_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ondisconnect), (mp_obj_t)&esp_socket_ondisconnect_obj },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&mp_stream_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj },
 };
 STATIC MP_DEFINE_CONST_DICT(esp_socket_locals_dict, esp_socket_locals_dict_table);
 
+STATIC bool esp_socket_is_closed(esp_socket_obj_t *s) {
+    return s->espconn->state == ESPCONN_CLOSE;
+}
+
+// The stream methods never block, since SDK callbacks (and so new data) only
+// run once we return to the SDK; they raise EAGAIN instead, and poll (ioctl)
+// tells an event loop when to retry.
+STATIC mp_uint_t esp_socket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    esp_socket_obj_t *s = self_in;
+    if (s->recvbuf == NULL || esp_socket_recv_avail(s) == 0) {
+        if (esp_socket_is_closed(s)) {
+            return 0;
+        }
+        *errcode = EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return esp_socket_recv_take(s, buf, size);
+}
+
+STATIC mp_uint_t esp_socket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    esp_socket_obj_t *s = self_in;
+    if (s->espconn->state == ESPCONN_NONE || esp_socket_is_closed(s)) {
+        *errcode = ENOTCONN;
+        return MP_STREAM_ERROR;
+    }
+    // espconn takes only one send at a time, until its sent callback
+    if (s->sending) {
+        *errcode = EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    s->sending = true;
+    if (espconn_sent(s->espconn, (uint8_t*)buf, size) != 0) {
+        s->sending = false;
+        *errcode = EIO;
+        return MP_STREAM_ERROR;
+    }
+    return size;
+}
+
+STATIC mp_uint_t esp_socket_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t arg, int *errcode) {
+    esp_socket_obj_t *s = self_in;
+    if (request == MP_IOCTL_POLL) {
+        mp_uint_t flags = arg;
+        mp_uint_t ret = 0;
+        bool closed = esp_socket_is_closed(s);
+        if ((flags & MP_IOCTL_POLL_RD) && ((s->recvbuf != NULL && esp_socket_recv_avail(s) > 0) || closed)) {
+            ret |= MP_IOCTL_POLL_RD;
+        }
+        if ((flags & MP_IOCTL_POLL_WR) && s->espconn->state == ESPCONN_CONNECT && !s->sending) {
+            ret |= MP_IOCTL_POLL_WR;
+        }
+        if (closed) {
+            ret |= MP_IOCTL_POLL_HUP;
+        }
+        return ret;
+    }
+    *errcode = EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t esp_socket_stream_p = {
+    .read = esp_socket_read,
+    .write = esp_socket_write,
+    .ioctl = esp_socket_ioctl,
+    .is_text = false,
+};
+
 STATIC const mp_obj_type_t esp_socket_type = {
     { &mp_type_type },
     .name = MP_QSTR_socket,
     .make_new = esp_socket_make_new,
+    .stream_p = &esp_socket_stream_p,
     .locals_dict = (mp_obj_t)&esp_socket_locals_dict,
 };
 
@@ -3,8 +3,12 @@
 // options to control how Micro Python is built
 
 #define MICROPY_ALLOC_PATH_MAX      (128)
+#define MICROPY_ALLOC_QSTR_CHUNK_INIT (64)
+#define MICROPY_QSTR_BYTES_IN_HASH  (1)
+#define MICROPY_PARSE_STREAMING     (1)
 #define MICROPY_EMIT_X64            (0)
 #define MICROPY_EMIT_THUMB          (0)
+#define MICROPY_EMIT_XTENSA         (1)
 #define MICROPY_EMIT_INLINE_THUMB   (0)
 #define MICROPY_MEM_STATS           (0)
 #define MICROPY_DEBUG_PRINTERS      (0)
@@ -56,6 +60,9 @@ typedef long mp_off_t;
 void mp_hal_stdout_tx_strn_cooked(const char *str, mp_uint_t len);
 #define MP_PLAT_PRINT_STRN(str, len) mp_hal_stdout_tx_strn_cooked(str, len)
 
+void *esp_native_code_commit(void *buf, mp_uint_t len);
+#define MP_PLAT_COMMIT_EXEC(buf, len) esp_native_code_commit(buf, len)
+
 // extra built in names to add to the global namespace
 extern const struct _mp_obj_fun_builtin_t mp_builtin_open_obj;
 #define MICROPY_PORT_BUILTINS \
@@ -77,6 +84,9 @@ extern const struct _mp_obj_module_t esp_module;
     /* Singleton instance of scan callback, meaning that there can
        be only one concurrent AP scan. */ \
     mp_obj_t scan_cb_obj; \
+    \
+    /* DRAM copies of the native code that was moved to IRAM */ \
+    mp_obj_t native_code_ram; \
 
 // We need to provide a declaration/definition of alloca()
 #include <alloca.h>
@@ -0,0 +1,34 @@
+/*********************************************************************
+* Filename:   aes.h
+* Author:     Brad Conte (brad AT bradconte.com)
+* Copyright:
+* Disclaimer: This code is presented "as is" without any guarantees.
+* Details:    Defines the API for the corresponding AES implementation.
+*********************************************************************/
+
+#ifndef AES_H
+#define AES_H
+
+/*************************** HEADER FILES ***************************/
+#include <stddef.h>
+
+/****************************** MACROS ******************************/
+#define AES_BLOCK_SIZE 16               // AES operates on 16 bytes at a time
+
+/**************************** DATA TYPES ****************************/
+typedef unsigned char BYTE;             // 8-bit byte
+typedef unsigned int  WORD;             // 32-bit word, change to "long" for 16-bit machines
+
+typedef struct {
+	BYTE rk[240];                       // round keys, (rounds + 1) * 16 bytes
+	int rounds;
+} AES_CTX;
+
+/*********************** FUNCTION DECLARATIONS **********************/
+// keylen is 16, 24 or 32 bytes; returns 0, or -1 for any other length
+int aes_key_setup(AES_CTX *ctx, const BYTE key[], size_t keylen);
+// in and out may be the same buffer
+void aes_encrypt(const AES_CTX *ctx, const BYTE in[], BYTE out[]);
+void aes_decrypt(const AES_CTX *ctx, const BYTE in[], BYTE out[]);
+
+#endif   // AES_H
@@ -98,9 +98,17 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	size_t i = 0;
+
+	// Whole blocks are transformed straight from the input.
+	if (ctx->datalen == 0) {
+		for ( ; i + 64 <= len; i += 64) {
+			sha256_transform(ctx, data + i);
+			ctx->bitlen += 512;
+		}
+	}
 
-	for (i = 0; i < len; ++i) {
+	for ( ; i < len; ++i) {
 		ctx->data[ctx->datalen] = data[i];
 		ctx->datalen++;
 		if (ctx->datalen == 64) {
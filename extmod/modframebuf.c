@@ -0,0 +1,403 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_FRAMEBUF
+
+#include "stmhal/font_petme128_8x8.h"
+
+// A FrameBuffer draws into any writable buffer.  Each pixel format provides
+// the three primitives below and all drawing is built on them.
+
+#define FRAMEBUF_MVLSB  (0) // mono, a byte is 8 vertical pixels with LSB at top
+#define FRAMEBUF_RGB565 (1) // 16 bits per pixel, native endian
+
+typedef struct _mp_obj_framebuf_t {
+    mp_obj_base_t base;
+    mp_obj_t buf_obj; // keeps the buffer alive
+    void *buf;
+    uint16_t width, height, stride;
+    uint8_t format;
+} mp_obj_framebuf_t;
+
+typedef void (*setpixel_t)(const mp_obj_framebuf_t*, int, int, uint32_t);
+typedef uint32_t (*getpixel_t)(const mp_obj_framebuf_t*, int, int);
+typedef void (*fill_rect_t)(const mp_obj_framebuf_t*, int, int, int, int, uint32_t);
+
+typedef struct _mp_framebuf_p_t {
+    setpixel_t setpixel;
+    getpixel_t getpixel;
+    fill_rect_t fill_rect;
+} mp_framebuf_p_t;
+
+// Functions for MVLSB format
+
+STATIC void mvlsb_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
+    size_t index = (y >> 3) * fb->stride + x;
+    uint8_t offset = y & 0x07;
+    ((uint8_t*)fb->buf)[index] = (((uint8_t*)fb->buf)[index] & ~(0x01 << offset)) | ((col != 0) << offset);
+}
+
+STATIC uint32_t mvlsb_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
+    return (((uint8_t*)fb->buf)[(y >> 3) * fb->stride + x] >> (y & 0x07)) & 0x01;
+}
+
+STATIC void mvlsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+    while (h--) {
+        uint8_t *b = &((uint8_t*)fb->buf)[(y >> 3) * fb->stride + x];
+        uint8_t mask = 1 << (y & 0x07);
+        for (int ww = w; ww; --ww) {
+            *b = col ? (*b | mask) : (*b & ~mask);
+            ++b;
+        }
+        ++y;
+    }
+}
+
+// Functions for RGB565 format
+
+STATIC void rgb565_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
+    ((uint16_t*)fb->buf)[x + y * fb->stride] = col;
+}
+
+STATIC uint32_t rgb565_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
+    return ((uint16_t*)fb->buf)[x + y * fb->stride];
+}
+
+STATIC void rgb565_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+    uint16_t *b = &((uint16_t*)fb->buf)[x + y * fb->stride];
+    while (h--) {
+        for (int ww = w; ww; --ww) {
+            *b++ = col;
+        }
+        b += fb->stride - w;
+    }
+}
+
+STATIC const mp_framebuf_p_t formats[] = {
+    [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect},
+    [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect},
+};
+
+STATIC inline void setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
+    formats[fb->format].setpixel(fb, x, y, col);
+}
+
+STATIC inline uint32_t getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
+    return formats[fb->format].getpixel(fb, x, y);
+}
+
+STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+    if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
+        // no operation needed
+        return;
+    }
+
+    // clip to the framebuffer
+    int xend = MIN(fb->width, x + w);
+    int yend = MIN(fb->height, y + h);
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+
+    formats[fb->format].fill_rect(fb, x, y, xend - x, yend - y, col);
+}
+
+// FrameBuffer(buffer, width, height, format[, stride])
+STATIC mp_obj_t framebuf_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 4, 5, false);
+
+    mp_obj_framebuf_t *o = m_new_obj(mp_obj_framebuf_t);
+    o->base.type = type_in;
+    o->buf_obj = args[0];
+    mp_int_t width = mp_obj_get_int(args[1]);
+    mp_int_t height = mp_obj_get_int(args[2]);
+    mp_int_t format = mp_obj_get_int(args[3]);
+    mp_int_t stride = width;
+    if (n_args >= 5) {
+        stride = mp_obj_get_int(args[4]);
+    }
+    if (width < 1 || height < 1 || stride < width || stride > 0xffff || height > 0xffff) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid dimensions"));
+    }
+
+    mp_uint_t needed;
+    switch (format) {
+        case FRAMEBUF_MVLSB:
+            needed = (height + 7) / 8 * stride;
+            break;
+        case FRAMEBUF_RGB565:
+            needed = height * stride * 2;
+            break;
+        default:
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid format"));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < needed) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+
+    o->buf = bufinfo.buf;
+    o->width = width;
+    o->height = height;
+    o->stride = stride;
+    o->format = format;
+
+    return o;
+}
+
+STATIC mp_obj_t framebuf_fill(mp_obj_t self_in, mp_obj_t col_in) {
+    mp_obj_framebuf_t *self = self_in;
+    formats[self->format].fill_rect(self, 0, 0, self->width, self->height, mp_obj_get_int(col_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_fill_obj, framebuf_fill);
+
+STATIC mp_obj_t framebuf_fill_rect(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    fill_rect(args[0], mp_obj_get_int(args[1]), mp_obj_get_int(args[2]),
+        mp_obj_get_int(args[3]), mp_obj_get_int(args[4]), mp_obj_get_int(args[5]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_fill_rect_obj, 6, 6, framebuf_fill_rect);
+
+STATIC mp_obj_t framebuf_pixel(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = args[0];
+    mp_int_t x = mp_obj_get_int(args[1]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    if (0 <= x && x < self->width && 0 <= y && y < self->height) {
+        if (n_args == 3) {
+            // get
+            return MP_OBJ_NEW_SMALL_INT(getpixel(self, x, y));
+        } else {
+            // set
+            setpixel(self, x, y, mp_obj_get_int(args[3]));
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_pixel_obj, 3, 4, framebuf_pixel);
+
+STATIC mp_obj_t framebuf_hline(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    fill_rect(args[0], mp_obj_get_int(args[1]), mp_obj_get_int(args[2]),
+        mp_obj_get_int(args[3]), 1, mp_obj_get_int(args[4]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_hline_obj, 5, 5, framebuf_hline);
+
+STATIC mp_obj_t framebuf_vline(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    fill_rect(args[0], mp_obj_get_int(args[1]), mp_obj_get_int(args[2]),
+        1, mp_obj_get_int(args[3]), mp_obj_get_int(args[4]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_vline_obj, 5, 5, framebuf_vline);
+
+STATIC mp_obj_t framebuf_rect(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_framebuf_t *self = args[0];
+    mp_int_t x = mp_obj_get_int(args[1]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    mp_int_t w = mp_obj_get_int(args[3]);
+    mp_int_t h = mp_obj_get_int(args[4]);
+    mp_int_t col = mp_obj_get_int(args[5]);
+    fill_rect(self, x, y, w, 1, col);
+    fill_rect(self, x, y + h - 1, w, 1, col);
+    fill_rect(self, x, y, 1, h, col);
+    fill_rect(self, x + w - 1, y, 1, h, col);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_rect_obj, 6, 6, framebuf_rect);
+
+// line(x1, y1, x2, y2, col), using Bresenham's algorithm
+STATIC mp_obj_t framebuf_line(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_framebuf_t *self = args[0];
+    mp_int_t x = mp_obj_get_int(args[1]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    mp_int_t x2 = mp_obj_get_int(args[3]);
+    mp_int_t y2 = mp_obj_get_int(args[4]);
+    mp_int_t col = mp_obj_get_int(args[5]);
+
+    mp_int_t dx = x2 > x ? x2 - x : x - x2;
+    mp_int_t dy = y2 > y ? y2 - y : y - y2;
+    mp_int_t sx = x < x2 ? 1 : -1;
+    mp_int_t sy = y < y2 ? 1 : -1;
+    mp_int_t err = dx - dy;
+    for (;;) {
+        if (0 <= x && x < self->width && 0 <= y && y < self->height) {
+            setpixel(self, x, y, col);
+        }
+        if (x == x2 && y == y2) {
+            break;
+        }
+        mp_int_t e2 = 2 * err;
+        if (e2 > -dy) {
+            err -= dy;
+            x += sx;
+        }
+        if (e2 < dx) {
+            err += dx;
+            y += sy;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_line_obj, 6, 6, framebuf_line);
+
+// blit(fbuf, x, y[, key]): copy another FrameBuffer in, skipping pixels of
+// colour key if given; pixel values are copied as-is between formats
+STATIC mp_obj_t framebuf_blit(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = args[0];
+    if (!MP_OBJ_IS_TYPE(args[1], self->base.type)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "expecting a FrameBuffer"));
+    }
+    mp_obj_framebuf_t *source = args[1];
+    mp_int_t x = mp_obj_get_int(args[2]);
+    mp_int_t y = mp_obj_get_int(args[3]);
+    mp_int_t key = -1;
+    if (n_args > 4) {
+        key = mp_obj_get_int(args[4]);
+    }
+
+    if (x >= self->width || y >= self->height
+        || -x >= source->width || -y >= source->height) {
+        // out of bounds, no-op
+        return mp_const_none;
+    }
+
+    // clip to the destination
+    int x0 = MAX(0, x);
+    int y0 = MAX(0, y);
+    int x1 = MAX(0, -x);
+    int y1 = MAX(0, -y);
+    int x0end = MIN(self->width, x + source->width);
+    int y0end = MIN(self->height, y + source->height);
+
+    if (self->format == source->format && key == -1 && self->format == FRAMEBUF_RGB565) {
+        // fast path: copy whole rows
+        for (; y0 < y0end; ++y0, ++y1) {
+            memmove(&((uint16_t*)self->buf)[x0 + y0 * self->stride],
+                &((uint16_t*)source->buf)[x1 + y1 * source->stride], (x0end - x0) * 2);
+        }
+        return mp_const_none;
+    }
+
+    for (; y0 < y0end; ++y0, ++y1) {
+        int cx1 = x1;
+        for (int cx0 = x0; cx0 < x0end; ++cx0, ++cx1) {
+            uint32_t col = getpixel(source, cx1, y1);
+            if (col != (uint32_t)key) {
+                setpixel(self, cx0, y0, col);
+            }
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 5, framebuf_blit);
+
+// text(str, x, y[, col]) using the built-in 8x8 font
+STATIC mp_obj_t framebuf_text(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = args[0];
+    mp_uint_t len;
+    const char *str = mp_obj_str_get_data(args[1], &len);
+    mp_int_t x0 = mp_obj_get_int(args[2]);
+    mp_int_t y0 = mp_obj_get_int(args[3]);
+    mp_int_t col = 1;
+    if (n_args > 4) {
+        col = mp_obj_get_int(args[4]);
+    }
+
+    // loop over chars
+    for (const char *top = str + len; str < top; str++) {
+        // get char and make sure its in range of font
+        uint chr = *(byte*)str;
+        if (chr < 32 || chr > 127) {
+            chr = 127;
+        }
+        // get char data
+        const uint8_t *chr_data = &font_petme128_8x8[(chr - 32) * 8];
+        // loop over char data
+        for (int j = 0; j < 8; j++, x0++) {
+            if (0 <= x0 && x0 < self->width) { // clip x
+                uint vline_data = chr_data[j]; // each byte is a column of 8 pixels, LSB at top
+                for (int y = y0; vline_data; vline_data >>= 1, y++) { // scan over vertical column
+                    if (vline_data & 1) { // only draw if pixel set
+                        if (0 <= y && y < self->height) { // clip y
+                            setpixel(self, x0, y, col);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 5, framebuf_text);
+
+STATIC const mp_map_elem_t framebuf_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fill), (mp_obj_t)&framebuf_fill_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fill_rect), (mp_obj_t)&framebuf_fill_rect_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pixel), (mp_obj_t)&framebuf_pixel_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hline), (mp_obj_t)&framebuf_hline_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_vline), (mp_obj_t)&framebuf_vline_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rect), (mp_obj_t)&framebuf_rect_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_line), (mp_obj_t)&framebuf_line_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_blit), (mp_obj_t)&framebuf_blit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_text), (mp_obj_t)&framebuf_text_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(framebuf_locals_dict, framebuf_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_framebuf = {
+    { &mp_type_type },
+    .name = MP_QSTR_FrameBuffer,
+    .make_new = framebuf_make_new,
+    .locals_dict = (mp_obj_t)&framebuf_locals_dict,
+};
+
+STATIC const mp_map_elem_t framebuf_module_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_framebuf) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_FrameBuffer), (mp_obj_t)&mp_type_framebuf },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MVLSB), MP_OBJ_NEW_SMALL_INT(FRAMEBUF_MVLSB) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RGB565), MP_OBJ_NEW_SMALL_INT(FRAMEBUF_RGB565) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(framebuf_module_globals, framebuf_module_globals_table);
+
+const mp_obj_module_t mp_module_framebuf = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_framebuf,
+    .globals = (mp_obj_dict_t*)&framebuf_module_globals,
+};
+
+#endif // MICROPY_PY_FRAMEBUF
@@ -0,0 +1,403 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+#include "py/builtin.h"
+
+#if MICROPY_PY_UASYNCIO
+
+// Provided by the port: a millisecond counter, which may wrap around.
+mp_uint_t mp_hal_ticks_ms(void);
+
+/// \module _uasyncio - Core of an event loop for coroutines
+///
+/// A task is a generator.  What it yields tells the loop what to do next:
+///  - None: run it again after the other ready tasks;
+///  - an int: sleep for that many milliseconds;
+///  - the result of loop.wait_read(obj) or loop.wait_write(obj): wait until
+///    obj is ready, using a uselect.poll object.
+/// A task ends when it returns, and an exception raised by a task is raised
+/// out of loop.run().
+
+typedef struct _uasyncio_sleeper_t {
+    mp_uint_t wake;
+    mp_uint_t seq;
+    mp_obj_t task;
+} uasyncio_sleeper_t;
+
+typedef struct _mp_obj_uasyncio_loop_t {
+    mp_obj_base_t base;
+    // tasks ready to run, a ring buffer
+    mp_obj_t *runq;
+    mp_uint_t runq_alloc;
+    mp_uint_t runq_head;
+    mp_uint_t runq_len;
+    // sleeping tasks, a heap ordered by wake time then by seq
+    uasyncio_sleeper_t *sleepq;
+    mp_uint_t sleepq_alloc;
+    mp_uint_t sleepq_len;
+    mp_uint_t seq;
+    // tasks waiting for I/O, keyed by the id of the object waited on
+    mp_map_t io_read;
+    mp_map_t io_write;
+    // the uselect.poll object, created when first needed
+    mp_obj_t poller;
+    qstr poll_meth;
+    mp_uint_t pollin;
+    mp_uint_t pollout;
+    // the task being run, MP_OBJ_NULL if none
+    mp_obj_t cur_task;
+    bool cur_waiting;
+    bool stopped;
+} mp_obj_uasyncio_loop_t;
+
+STATIC void uasyncio_runq_push(mp_obj_uasyncio_loop_t *self, mp_obj_t task) {
+    if (self->runq_len == self->runq_alloc) {
+        // grow, unwrapping the ring so it starts at index 0
+        mp_uint_t new_alloc = self->runq_alloc * 2;
+        mp_obj_t *runq = m_new(mp_obj_t, new_alloc);
+        for (mp_uint_t i = 0; i < self->runq_len; i++) {
+            runq[i] = self->runq[(self->runq_head + i) % self->runq_alloc];
+        }
+        m_del(mp_obj_t, self->runq, self->runq_alloc);
+        self->runq = runq;
+        self->runq_alloc = new_alloc;
+        self->runq_head = 0;
+    }
+    self->runq[(self->runq_head + self->runq_len) % self->runq_alloc] = task;
+    self->runq_len += 1;
+}
+
+STATIC mp_obj_t uasyncio_runq_pop(mp_obj_uasyncio_loop_t *self) {
+    mp_obj_t task = self->runq[self->runq_head];
+    self->runq[self->runq_head] = MP_OBJ_NULL;
+    self->runq_head = (self->runq_head + 1) % self->runq_alloc;
+    self->runq_len -= 1;
+    return task;
+}
+
+// wake times are compared by their difference, so the counter may wrap
+STATIC bool uasyncio_sleeper_less(const uasyncio_sleeper_t *a, const uasyncio_sleeper_t *b) {
+    mp_int_t diff = a->wake - b->wake;
+    return diff < 0 || (diff == 0 && (mp_int_t)(a->seq - b->seq) < 0);
+}
+
+STATIC void uasyncio_sleepq_push(mp_obj_uasyncio_loop_t *self, mp_uint_t wake, mp_obj_t task) {
+    if (self->sleepq_len == self->sleepq_alloc) {
+        self->sleepq = m_renew(uasyncio_sleeper_t, self->sleepq, self->sleepq_alloc, self->sleepq_alloc * 2);
+        self->sleepq_alloc *= 2;
+    }
+    uasyncio_sleeper_t item = {wake, self->seq++, task};
+    // sift the new item down towards the root
+    mp_uint_t pos = self->sleepq_len++;
+    while (pos > 0) {
+        mp_uint_t parent_pos = (pos - 1) >> 1;
+        if (!uasyncio_sleeper_less(&item, &self->sleepq[parent_pos])) {
+            break;
+        }
+        self->sleepq[pos] = self->sleepq[parent_pos];
+        pos = parent_pos;
+    }
+    self->sleepq[pos] = item;
+}
+
+STATIC mp_obj_t uasyncio_sleepq_pop(mp_obj_uasyncio_loop_t *self) {
+    mp_obj_t task = self->sleepq[0].task;
+    mp_uint_t len = --self->sleepq_len;
+    uasyncio_sleeper_t item = self->sleepq[len];
+    self->sleepq[len].task = MP_OBJ_NULL;
+    // sift the last item up from the root
+    mp_uint_t pos = 0;
+    for (mp_uint_t child_pos = 1; child_pos < len; child_pos = 2 * pos + 1) {
+        if (child_pos + 1 < len && uasyncio_sleeper_less(&self->sleepq[child_pos + 1], &self->sleepq[child_pos])) {
+            child_pos += 1;
+        }
+        if (!uasyncio_sleeper_less(&self->sleepq[child_pos], &item)) {
+            break;
+        }
+        self->sleepq[pos] = self->sleepq[child_pos];
+        pos = child_pos;
+    }
+    if (len > 0) {
+        self->sleepq[pos] = item;
+    }
+    return task;
+}
+
+STATIC void uasyncio_get_poller(mp_obj_uasyncio_loop_t *self) {
+    if (self->poller != MP_OBJ_NULL) {
+        return;
+    }
+    mp_obj_t mod = mp_import_name(MP_QSTR_uselect, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    self->pollin = mp_obj_get_int(mp_load_attr(mod, MP_QSTR_POLLIN));
+    self->pollout = mp_obj_get_int(mp_load_attr(mod, MP_QSTR_POLLOUT));
+    self->poller = mp_call_function_0(mp_load_attr(mod, MP_QSTR_poll));
+    // use ipoll, which doesn't allocate, if the port has it
+    mp_obj_t dest[2];
+    mp_load_method_maybe(self->poller, MP_QSTR_ipoll, dest);
+    self->poll_meth = (dest[0] != MP_OBJ_NULL) ? MP_QSTR_ipoll : MP_QSTR_poll;
+}
+
+STATIC mp_uint_t uasyncio_io_flags(mp_obj_uasyncio_loop_t *self, mp_obj_t obj) {
+    mp_uint_t flags = 0;
+    if (mp_map_lookup(&self->io_read, mp_obj_id(obj), MP_MAP_LOOKUP) != NULL) {
+        flags |= self->pollin;
+    }
+    if (mp_map_lookup(&self->io_write, mp_obj_id(obj), MP_MAP_LOOKUP) != NULL) {
+        flags |= self->pollout;
+    }
+    return flags;
+}
+
+// tell the poller which events are now wanted for obj, given those that
+// were registered for it before
+STATIC void uasyncio_update_poller(mp_obj_uasyncio_loop_t *self, mp_obj_t obj, mp_uint_t old_flags) {
+    mp_uint_t flags = uasyncio_io_flags(self, obj);
+    mp_obj_t dest[4];
+    if (flags == 0) {
+        mp_load_method(self->poller, MP_QSTR_unregister, dest);
+        dest[2] = obj;
+        mp_call_method_n_kw(1, 0, dest);
+    } else {
+        mp_load_method(self->poller, old_flags == 0 ? MP_QSTR_register : MP_QSTR_modify, dest);
+        dest[2] = obj;
+        dest[3] = MP_OBJ_NEW_SMALL_INT(flags);
+        mp_call_method_n_kw(2, 0, dest);
+    }
+}
+
+// Wait for I/O for up to timeout ms (-1 means forever), and move the tasks
+// whose objects are ready to the run queue.
+STATIC void uasyncio_poll_io(mp_obj_uasyncio_loop_t *self, mp_int_t timeout) {
+    uasyncio_get_poller(self);
+    mp_obj_t dest[3];
+    mp_load_method(self->poller, self->poll_meth, dest);
+    dest[2] = MP_OBJ_NEW_SMALL_INT(timeout);
+    mp_obj_t iter = mp_getiter(mp_call_method_n_kw(1, 0, dest));
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *ev;
+        mp_obj_get_array_fixed_n(item, 2, &ev);
+        mp_obj_t obj = ev[0];
+        mp_uint_t events = mp_obj_get_int(ev[1]);
+        mp_uint_t old_flags = uasyncio_io_flags(self, obj);
+        // an error or hang-up wakes both readers and writers, so they see it
+        bool other = (events & ~(self->pollin | self->pollout)) != 0;
+        mp_map_elem_t *elem;
+        if ((other || (events & self->pollin))
+            && (elem = mp_map_lookup(&self->io_read, mp_obj_id(obj), MP_MAP_LOOKUP_REMOVE_IF_FOUND)) != NULL) {
+            uasyncio_runq_push(self, elem->value);
+        }
+        if ((other || (events & self->pollout))
+            && (elem = mp_map_lookup(&self->io_write, mp_obj_id(obj), MP_MAP_LOOKUP_REMOVE_IF_FOUND)) != NULL) {
+            uasyncio_runq_push(self, elem->value);
+        }
+        if (old_flags != 0) {
+            uasyncio_update_poller(self, obj, old_flags);
+        }
+    }
+}
+
+// run a task until it yields or ends
+STATIC void uasyncio_run_task(mp_obj_uasyncio_loop_t *self, mp_obj_t task) {
+    self->cur_task = task;
+    self->cur_waiting = false;
+    mp_obj_t ret;
+    mp_vm_return_kind_t kind = mp_resume(task, mp_const_none, MP_OBJ_NULL, &ret);
+    self->cur_task = MP_OBJ_NULL;
+    if (kind == MP_VM_RETURN_EXCEPTION) {
+        nlr_raise(ret);
+    }
+    if (kind == MP_VM_RETURN_NORMAL || self->cur_waiting) {
+        // task ended, or is now waiting for I/O
+        return;
+    }
+    if (ret == mp_const_none) {
+        uasyncio_runq_push(self, task);
+    } else {
+        mp_int_t delay = mp_obj_get_int(ret);
+        uasyncio_sleepq_push(self, mp_hal_ticks_ms() + (delay > 0 ? delay : 0), task);
+    }
+}
+
+/// \class Loop - event loop
+
+STATIC mp_obj_t uasyncio_loop_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    (void)args;
+    mp_obj_uasyncio_loop_t *o = m_new_obj(mp_obj_uasyncio_loop_t);
+    o->base.type = type_in;
+    o->runq_alloc = 4;
+    o->runq = m_new0(mp_obj_t, o->runq_alloc);
+    o->runq_head = 0;
+    o->runq_len = 0;
+    o->sleepq_alloc = 4;
+    o->sleepq = m_new0(uasyncio_sleeper_t, o->sleepq_alloc);
+    o->sleepq_len = 0;
+    o->seq = 0;
+    mp_map_init(&o->io_read, 0);
+    mp_map_init(&o->io_write, 0);
+    o->poller = MP_OBJ_NULL;
+    o->cur_task = MP_OBJ_NULL;
+    o->cur_waiting = false;
+    o->stopped = false;
+    return o;
+}
+
+/// \method create_task(coro)
+/// Schedule coro to run as soon as possible.  Returns coro.
+STATIC mp_obj_t uasyncio_loop_create_task(mp_obj_t self_in, mp_obj_t task) {
+    uasyncio_runq_push(self_in, task);
+    return task;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_create_task_obj, uasyncio_loop_create_task);
+
+/// \method call_later_ms(delay, coro)
+/// Schedule coro to run after delay milliseconds.  Returns coro.
+STATIC mp_obj_t uasyncio_loop_call_later_ms(mp_obj_t self_in, mp_obj_t delay_in, mp_obj_t task) {
+    mp_int_t delay = mp_obj_get_int(delay_in);
+    uasyncio_sleepq_push(self_in, mp_hal_ticks_ms() + (delay > 0 ? delay : 0), task);
+    return task;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(uasyncio_loop_call_later_ms_obj, uasyncio_loop_call_later_ms);
+
+STATIC mp_obj_t uasyncio_loop_wait(mp_obj_uasyncio_loop_t *self, mp_obj_t obj, mp_map_t *waiters) {
+    if (self->cur_task == MP_OBJ_NULL || self->cur_waiting) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "must be yielded by the running task"));
+    }
+    uasyncio_get_poller(self);
+    if (mp_map_lookup(waiters, mp_obj_id(obj), MP_MAP_LOOKUP) != NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "another task is waiting"));
+    }
+    mp_uint_t old_flags = uasyncio_io_flags(self, obj);
+    mp_map_lookup(waiters, mp_obj_id(obj), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = self->cur_task;
+    uasyncio_update_poller(self, obj, old_flags);
+    self->cur_waiting = true;
+    return mp_const_none;
+}
+
+/// \method wait_read(obj)
+/// Yield the result of this from a task to wait until obj can be read.
+STATIC mp_obj_t uasyncio_loop_wait_read(mp_obj_t self_in, mp_obj_t obj) {
+    mp_obj_uasyncio_loop_t *self = self_in;
+    return uasyncio_loop_wait(self, obj, &self->io_read);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_wait_read_obj, uasyncio_loop_wait_read);
+
+/// \method wait_write(obj)
+/// Yield the result of this from a task to wait until obj can be written.
+STATIC mp_obj_t uasyncio_loop_wait_write(mp_obj_t self_in, mp_obj_t obj) {
+    mp_obj_uasyncio_loop_t *self = self_in;
+    return uasyncio_loop_wait(self, obj, &self->io_write);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_wait_write_obj, uasyncio_loop_wait_write);
+
+/// \method run()
+/// Run tasks until there are none left, or stop() is called.
+STATIC mp_obj_t uasyncio_loop_run(mp_obj_t self_in) {
+    mp_obj_uasyncio_loop_t *self = self_in;
+    self->stopped = false;
+    while (!self->stopped) {
+        // move the tasks whose sleep is over to the run queue
+        mp_uint_t now = mp_hal_ticks_ms();
+        while (self->sleepq_len > 0 && (mp_int_t)(self->sleepq[0].wake - now) <= 0) {
+            uasyncio_runq_push(self, uasyncio_sleepq_pop(self));
+        }
+
+        // work out how long to wait for I/O, if at all
+        mp_int_t timeout;
+        if (self->runq_len > 0) {
+            timeout = 0;
+        } else if (self->sleepq_len > 0) {
+            timeout = self->sleepq[0].wake - now;
+        } else {
+            timeout = -1;
+        }
+        if (self->io_read.used + self->io_write.used > 0) {
+            uasyncio_poll_io(self, timeout);
+        } else if (timeout > 0) {
+            // nothing but sleepers, so use the poller to sleep
+            uasyncio_poll_io(self, timeout);
+            continue;
+        } else if (timeout < 0) {
+            // nothing left to do
+            break;
+        }
+
+        // run the tasks that are ready now; those they make ready run on
+        // the next pass, after the sleepers and I/O have been checked
+        for (mp_uint_t n = self->runq_len; n > 0 && !self->stopped; n--) {
+            uasyncio_run_task(self, uasyncio_runq_pop(self));
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uasyncio_loop_run_obj, uasyncio_loop_run);
+
+/// \method stop()
+/// Make run() return once the running task yields.
+STATIC mp_obj_t uasyncio_loop_stop(mp_obj_t self_in) {
+    mp_obj_uasyncio_loop_t *self = self_in;
+    self->stopped = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uasyncio_loop_stop_obj, uasyncio_loop_stop);
+
+STATIC const mp_map_elem_t uasyncio_loop_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_create_task), (mp_obj_t)&uasyncio_loop_create_task_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_call_later_ms), (mp_obj_t)&uasyncio_loop_call_later_ms_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wait_read), (mp_obj_t)&uasyncio_loop_wait_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wait_write), (mp_obj_t)&uasyncio_loop_wait_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_run), (mp_obj_t)&uasyncio_loop_run_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stop), (mp_obj_t)&uasyncio_loop_stop_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(uasyncio_loop_locals_dict, uasyncio_loop_locals_dict_table);
+
+STATIC const mp_obj_type_t uasyncio_loop_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Loop,
+    .make_new = uasyncio_loop_make_new,
+    .locals_dict = (mp_obj_t)&uasyncio_loop_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_uasyncio_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR__uasyncio) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Loop), (mp_obj_t)&uasyncio_loop_type },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_uasyncio_globals, mp_module_uasyncio_globals_table);
+
+const mp_obj_module_t mp_module_uasyncio = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR__uasyncio,
+    .globals = (mp_obj_dict_t*)&mp_module_uasyncio_globals,
+};
+
+#endif // MICROPY_PY_UASYNCIO
@@ -34,6 +34,160 @@
 
 #if MICROPY_PY_UBINASCII
 
+// Each codec below is a plain loop over the input, writing to an output
+// pointer, so the same code serves the functions that return a new bytes
+// object and the *_into variants that write into a caller's buffer (and
+// return the number of bytes written).  Base64 is done a 3-byte group at a
+// time, packed into a 24-bit word, with table lookups in both directions.
+
+STATIC const char hex_digits[] = "0123456789abcdef";
+
+STATIC const char base64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// maps an ASCII character to its base64 value, or 0xff if not in the alphabet
+#define X (0xff)
+STATIC const byte base64_decode_table[128] = {
+    X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+    X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+    X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  62, X,  X,  X,  63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, X,  X,  X,  X,  X,  X,
+    X,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, X,  X,  X,  X,  X,
+    X,  26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, X,  X,  X,  X,  X,
+};
+#undef X
+
+STATIC NORETURN void binascii_raise_too_small(void) {
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+}
+
+// gets the writable buffer for an *_into function, checking it can hold need bytes
+STATIC void binascii_get_into_buf(mp_obj_t buf_in, mp_uint_t need, mp_buffer_info_t *bufinfo) {
+    mp_get_buffer_raise(buf_in, bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo->len < need) {
+        binascii_raise_too_small();
+    }
+}
+
+STATIC void hex_encode(const byte *in, mp_uint_t len, byte *out) {
+    for (; len--; ++in) {
+        *out++ = hex_digits[*in >> 4];
+        *out++ = hex_digits[*in & 0xf];
+    }
+}
+
+STATIC int hex_digit_value(byte c) {
+    if ((unsigned)(c - '0') <= 9) {
+        return c - '0';
+    }
+    c |= 0x20; // lower case
+    if ((unsigned)(c - 'a') <= 5) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+STATIC void hex_decode(const byte *in, mp_uint_t len, byte *out) {
+    for (len /= 2; len--; in += 2) {
+        int hi = hex_digit_value(in[0]);
+        int lo = hex_digit_value(in[1]);
+        if ((hi | lo) < 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "non-hex digit found"));
+        }
+        *out++ = hi << 4 | lo;
+    }
+}
+
+STATIC mp_uint_t hex_decoded_len(mp_uint_t len) {
+    if (len & 1) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "odd-length string"));
+    }
+    return len / 2;
+}
+
+// the encoded length includes the trailing newline, as for CPython
+STATIC mp_uint_t base64_encoded_len(mp_uint_t len) {
+    return (len + 2) / 3 * 4 + 1;
+}
+
+STATIC void base64_encode(const byte *in, mp_uint_t len, byte *out) {
+    for (; len >= 3; len -= 3, in += 3) {
+        uint32_t w = in[0] << 16 | in[1] << 8 | in[2];
+        out[0] = base64_alphabet[w >> 18];
+        out[1] = base64_alphabet[(w >> 12) & 0x3f];
+        out[2] = base64_alphabet[(w >> 6) & 0x3f];
+        out[3] = base64_alphabet[w & 0x3f];
+        out += 4;
+    }
+    if (len > 0) {
+        uint32_t w = in[0] << 16;
+        if (len == 2) {
+            w |= in[1] << 8;
+        }
+        out[0] = base64_alphabet[w >> 18];
+        out[1] = base64_alphabet[(w >> 12) & 0x3f];
+        out[2] = len == 2 ? base64_alphabet[(w >> 6) & 0x3f] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    *out = '\n';
+}
+
+// Decodes base64 the way CPython does: characters outside the alphabet are
+// skipped, and a complete pad sequence ends the input.  Returns the number
+// of bytes written, raising if they would go past out_end.
+STATIC mp_uint_t base64_decode(const byte *in, mp_uint_t len, byte *out, byte *out_end) {
+    byte *out_start = out;
+    uint32_t w = 0;
+    mp_uint_t quad_pos = 0;
+    mp_uint_t pads = 0;
+    for (const byte *in_end = in + len; in < in_end; ++in) {
+        byte c = *in;
+        if (c == '=') {
+            if (quad_pos >= 2 && quad_pos + ++pads >= 4) {
+                break;
+            }
+            continue;
+        }
+        byte v = c < 128 ? base64_decode_table[c] : 0xff;
+        if (v == 0xff) {
+            continue;
+        }
+        pads = 0;
+        w = w << 6 | v;
+        if (++quad_pos == 4) {
+            if (out_end - out < 3) {
+                binascii_raise_too_small();
+            }
+            out[0] = w >> 16;
+            out[1] = w >> 8;
+            out[2] = w;
+            out += 3;
+            w = 0;
+            quad_pos = 0;
+        }
+    }
+    if (quad_pos == 1) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid base64 length"));
+    } else if (quad_pos != 0) {
+        if (quad_pos + pads < 4) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "incorrect padding"));
+        }
+        // 2 or 3 characters give 1 or 2 bytes
+        if ((mp_uint_t)(out_end - out) < quad_pos - 1) {
+            binascii_raise_too_small();
+        }
+        w <<= 6 * (4 - quad_pos);
+        *out++ = w >> 16;
+        if (quad_pos == 3) {
+            *out++ = w >> 8;
+        }
+    }
+    return out - out_start;
+}
+
 STATIC mp_obj_t mod_binascii_hexlify(mp_uint_t n_args, const mp_obj_t *args) {
     (void)n_args;
     mp_buffer_info_t bufinfo;
@@ -41,29 +195,94 @@ STATIC mp_obj_t mod_binascii_hexlify(mp_uint_t n_args, const mp_obj_t *args) {
 
     vstr_t vstr;
     vstr_init_len(&vstr, bufinfo.len * 2);
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte d = (*in >> 4);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        d = (*in++ & 0xf);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-    }
+    hex_encode(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_obj, 1, 2, mod_binascii_hexlify);
 
+STATIC mp_obj_t mod_binascii_hexlify_into(mp_obj_t data_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo, outinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    binascii_get_into_buf(buf_in, bufinfo.len * 2, &outinfo);
+    hex_encode(bufinfo.buf, bufinfo.len, outinfo.buf);
+    return MP_OBJ_NEW_SMALL_INT(bufinfo.len * 2);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_hexlify_into_obj, mod_binascii_hexlify_into);
+
+STATIC mp_obj_t mod_binascii_unhexlify(mp_obj_t data_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, hex_decoded_len(bufinfo.len));
+    hex_decode(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_unhexlify_obj, mod_binascii_unhexlify);
+
+STATIC mp_obj_t mod_binascii_unhexlify_into(mp_obj_t data_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo, outinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    mp_uint_t n = hex_decoded_len(bufinfo.len);
+    binascii_get_into_buf(buf_in, n, &outinfo);
+    hex_decode(bufinfo.buf, bufinfo.len, outinfo.buf);
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_unhexlify_into_obj, mod_binascii_unhexlify_into);
+
+STATIC mp_obj_t mod_binascii_a2b_base64(mp_obj_t data_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+
+    // every 4 input characters give at most 3 output bytes
+    vstr_t vstr;
+    vstr_init_len(&vstr, bufinfo.len / 4 * 3 + 2);
+    byte *out = (byte*)vstr.buf;
+    vstr.len = base64_decode(bufinfo.buf, bufinfo.len, out, out + vstr.len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_a2b_base64_obj, mod_binascii_a2b_base64);
+
+STATIC mp_obj_t mod_binascii_a2b_base64_into(mp_obj_t data_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo, outinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    binascii_get_into_buf(buf_in, 0, &outinfo);
+    byte *out = outinfo.buf;
+    return MP_OBJ_NEW_SMALL_INT(base64_decode(bufinfo.buf, bufinfo.len, out, out + outinfo.len));
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_a2b_base64_into_obj, mod_binascii_a2b_base64_into);
+
+STATIC mp_obj_t mod_binascii_b2a_base64(mp_obj_t data_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, base64_encoded_len(bufinfo.len));
+    base64_encode(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_b2a_base64_obj, mod_binascii_b2a_base64);
+
+STATIC mp_obj_t mod_binascii_b2a_base64_into(mp_obj_t data_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo, outinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    mp_uint_t n = base64_encoded_len(bufinfo.len);
+    binascii_get_into_buf(buf_in, n, &outinfo);
+    base64_encode(bufinfo.buf, bufinfo.len, outinfo.buf);
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_b2a_base64_into_obj, mod_binascii_b2a_base64_into);
+
 STATIC const mp_map_elem_t mp_module_binascii_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ubinascii) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_hexlify), (mp_obj_t)&mod_binascii_hexlify_obj },
-//    { MP_OBJ_NEW_QSTR(MP_QSTR_unhexlify), (mp_obj_t)&mod_binascii_unhexlify_obj },
-//    { MP_OBJ_NEW_QSTR(MP_QSTR_a2b_base64), (mp_obj_t)&mod_binascii_a2b_base64_obj },
-//    { MP_OBJ_NEW_QSTR(MP_QSTR_b2a_base64), (mp_obj_t)&mod_binascii_b2a_base64_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unhexlify), (mp_obj_t)&mod_binascii_unhexlify_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_a2b_base64), (mp_obj_t)&mod_binascii_a2b_base64_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_b2a_base64), (mp_obj_t)&mod_binascii_b2a_base64_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hexlify_into), (mp_obj_t)&mod_binascii_hexlify_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unhexlify_into), (mp_obj_t)&mod_binascii_unhexlify_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_a2b_base64_into), (mp_obj_t)&mod_binascii_a2b_base64_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_b2a_base64_into), (mp_obj_t)&mod_binascii_b2a_base64_into_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_binascii_globals, mp_module_binascii_globals_table);
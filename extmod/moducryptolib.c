@@ -0,0 +1,274 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Paul Sokolovsky
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_UCRYPTOLIB
+
+#include "crypto-algorithms/aes.h"
+
+// Values as used by CPython's PyCrypto
+#define UCRYPTOLIB_MODE_ECB (1)
+#define UCRYPTOLIB_MODE_CBC (2)
+#define UCRYPTOLIB_MODE_CTR (6)
+
+#if MICROPY_PY_UCRYPTOLIB_HW
+// Provided by a port with an AES engine. mp_hal_aes_init() loads the key
+// (16, 24 or 32 bytes) for the given mode into the engine and returns true,
+// or returns false if the engine can't take it, and the software version is
+// used instead. ctx is MICROPY_HW_AES_CTX_SIZE bytes in the aes object, for
+// the port's own state. mp_hal_aes_crypt() processes len bytes, a multiple
+// of 16, from in to out (which may be the same buffer, and may be any
+// buffer, so a port wanting DMA must check alignment and placement itself),
+// and updates iv to chain with the next call. CTR mode is always called
+// with encrypt true, and mode ECB is also used to make CTR keystream for a
+// trailing partial block.
+bool mp_hal_aes_init(void *ctx, const byte *key, mp_uint_t keylen, int mode);
+void mp_hal_aes_crypt(void *ctx, int mode, bool encrypt, byte *iv, const byte *in, byte *out, mp_uint_t len);
+#endif
+
+typedef struct _mp_obj_aes_t {
+    mp_obj_base_t base;
+    uint8_t mode;
+    uint8_t dir; // 0 until first used, then 1 for encrypt or 2 for decrypt
+    uint8_t ks_used; // bytes of ks already used, in CTR mode
+    bool hw; // key is held by the port's AES engine
+    byte iv[AES_BLOCK_SIZE]; // chaining block, or counter in CTR mode
+    byte ks[AES_BLOCK_SIZE]; // keystream of the last counter in CTR mode
+    #if MICROPY_PY_UCRYPTOLIB_HW
+    union {
+        AES_CTX sw;
+        char hw[MICROPY_HW_AES_CTX_SIZE];
+    } ctx;
+    #else
+    union {
+        AES_CTX sw;
+    } ctx;
+    #endif
+} mp_obj_aes_t;
+
+STATIC mp_obj_t aes_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 2, 3, false);
+    mp_obj_aes_t *o = m_new_obj(mp_obj_aes_t);
+    o->base.type = type_in;
+
+    mp_int_t mode = mp_obj_get_int(args[1]);
+    if (mode != UCRYPTOLIB_MODE_ECB && mode != UCRYPTOLIB_MODE_CBC && mode != UCRYPTOLIB_MODE_CTR) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "mode"));
+    }
+    o->mode = mode;
+    o->dir = 0;
+    o->ks_used = AES_BLOCK_SIZE;
+
+    mp_buffer_info_t keyinfo;
+    mp_get_buffer_raise(args[0], &keyinfo, MP_BUFFER_READ);
+    if (keyinfo.len != 16 && keyinfo.len != 24 && keyinfo.len != 32) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "key"));
+    }
+
+    memset(o->iv, 0, AES_BLOCK_SIZE);
+    if (mode != UCRYPTOLIB_MODE_ECB) {
+        if (n_args < 3 || args[2] == mp_const_none) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "IV required"));
+        }
+        mp_buffer_info_t ivinfo;
+        mp_get_buffer_raise(args[2], &ivinfo, MP_BUFFER_READ);
+        if (ivinfo.len != AES_BLOCK_SIZE) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "IV"));
+        }
+        memcpy(o->iv, ivinfo.buf, AES_BLOCK_SIZE);
+    }
+
+    #if MICROPY_PY_UCRYPTOLIB_HW
+    o->hw = mp_hal_aes_init(o->ctx.hw, keyinfo.buf, keyinfo.len, mode);
+    if (!o->hw)
+    #else
+    o->hw = false;
+    #endif
+    {
+        aes_key_setup(&o->ctx.sw, keyinfo.buf, keyinfo.len);
+    }
+    return o;
+}
+
+// Process whole blocks, in and out may be the same buffer
+STATIC void aes_process(mp_obj_aes_t *self, int mode, bool encrypt, const byte *in, byte *out, mp_uint_t len) {
+    #if MICROPY_PY_UCRYPTOLIB_HW
+    if (self->hw) {
+        mp_hal_aes_crypt(self->ctx.hw, mode, encrypt, self->iv, in, out, len);
+        return;
+    }
+    #endif
+    const AES_CTX *ctx = &self->ctx.sw;
+    byte *iv = self->iv;
+    for (; len > 0; len -= AES_BLOCK_SIZE, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE) {
+        if (mode == UCRYPTOLIB_MODE_ECB) {
+            if (encrypt) {
+                aes_encrypt(ctx, in, out);
+            } else {
+                aes_decrypt(ctx, in, out);
+            }
+        } else if (mode == UCRYPTOLIB_MODE_CBC) {
+            if (encrypt) {
+                for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+                    iv[i] ^= in[i];
+                }
+                aes_encrypt(ctx, iv, iv);
+                memcpy(out, iv, AES_BLOCK_SIZE);
+            } else {
+                byte tmp[AES_BLOCK_SIZE];
+                memcpy(tmp, in, AES_BLOCK_SIZE);
+                aes_decrypt(ctx, in, out);
+                for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+                    out[i] ^= iv[i];
+                }
+                memcpy(iv, tmp, AES_BLOCK_SIZE);
+            }
+        } else {
+            byte ks[AES_BLOCK_SIZE];
+            aes_encrypt(ctx, iv, ks);
+            for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+                out[i] = in[i] ^ ks[i];
+            }
+            // the counter is the whole IV, big endian
+            for (int i = AES_BLOCK_SIZE - 1; i >= 0 && ++iv[i] == 0; i--) {
+            }
+        }
+    }
+}
+
+STATIC mp_obj_t aes_process_helper(mp_uint_t n_args, const mp_obj_t *args, bool encrypt) {
+    mp_obj_aes_t *self = args[0];
+
+    mp_buffer_info_t in_info;
+    mp_get_buffer_raise(args[1], &in_info, MP_BUFFER_READ);
+    const byte *in = in_info.buf;
+    mp_uint_t len = in_info.len;
+    if (self->mode != UCRYPTOLIB_MODE_CTR && len % AES_BLOCK_SIZE != 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "blksize % 16"));
+    }
+
+    // results go to out_buf if given, which may be in_buf itself, else to
+    // a new bytes object
+    vstr_t vstr;
+    byte *out;
+    if (n_args > 2 && args[2] != mp_const_none) {
+        mp_buffer_info_t out_info;
+        mp_get_buffer_raise(args[2], &out_info, MP_BUFFER_WRITE);
+        if (out_info.len != len) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "output len"));
+        }
+        out = out_info.buf;
+    } else {
+        vstr_init_len(&vstr, len);
+        out = (byte*)vstr.buf;
+    }
+
+    // the chaining state belongs to one direction
+    uint8_t dir = encrypt ? 1 : 2;
+    if (self->dir != 0 && self->dir != dir) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "can't encrypt & decrypt"));
+    }
+    self->dir = dir;
+
+    if (self->mode == UCRYPTOLIB_MODE_CTR) {
+        // CTR is a stream mode, so use up keystream left from a previous
+        // partial block, then whole blocks, then start a new partial block
+        while (len > 0 && self->ks_used < AES_BLOCK_SIZE) {
+            *out++ = *in++ ^ self->ks[self->ks_used++];
+            len--;
+        }
+        mp_uint_t whole = len & ~(AES_BLOCK_SIZE - 1);
+        if (whole > 0) {
+            aes_process(self, UCRYPTOLIB_MODE_CTR, true, in, out, whole);
+            in += whole;
+            out += whole;
+            len -= whole;
+        }
+        if (len > 0) {
+            memset(self->ks, 0, AES_BLOCK_SIZE);
+            aes_process(self, UCRYPTOLIB_MODE_CTR, true, self->ks, self->ks, AES_BLOCK_SIZE);
+            for (self->ks_used = 0; self->ks_used < len; self->ks_used++) {
+                out[self->ks_used] = in[self->ks_used] ^ self->ks[self->ks_used];
+            }
+        }
+    } else {
+        aes_process(self, self->mode, encrypt, in, out, len);
+    }
+
+    if (n_args > 2 && args[2] != mp_const_none) {
+        return mp_const_none;
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t aes_encrypt_meth(mp_uint_t n_args, const mp_obj_t *args) {
+    return aes_process_helper(n_args, args, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(aes_encrypt_obj, 2, 3, aes_encrypt_meth);
+
+STATIC mp_obj_t aes_decrypt_meth(mp_uint_t n_args, const mp_obj_t *args) {
+    return aes_process_helper(n_args, args, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(aes_decrypt_obj, 2, 3, aes_decrypt_meth);
+
+STATIC const mp_map_elem_t aes_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_encrypt), (mp_obj_t)&aes_encrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_decrypt), (mp_obj_t)&aes_decrypt_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(aes_locals_dict, aes_locals_dict_table);
+
+STATIC const mp_obj_type_t aes_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_aes,
+    .make_new = aes_make_new,
+    .locals_dict = (mp_obj_t)&aes_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_ucryptolib_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ucryptolib) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_aes), (mp_obj_t)&aes_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MODE_ECB), MP_OBJ_NEW_SMALL_INT(UCRYPTOLIB_MODE_ECB) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MODE_CBC), MP_OBJ_NEW_SMALL_INT(UCRYPTOLIB_MODE_CBC) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MODE_CTR), MP_OBJ_NEW_SMALL_INT(UCRYPTOLIB_MODE_CTR) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_ucryptolib_globals, mp_module_ucryptolib_globals_table);
+
+const mp_obj_module_t mp_module_ucryptolib = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_ucryptolib,
+    .globals = (mp_obj_dict_t*)&mp_module_ucryptolib_globals,
+};
+
+#include "crypto-algorithms/aes.c"
+
+#endif //MICROPY_PY_UCRYPTOLIB
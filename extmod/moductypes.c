@@ -233,6 +233,10 @@ STATIC mp_uint_t uctypes_struct_size(mp_obj_t desc_in, mp_uint_t *max_field_size
                 mp_uint_t offset = MP_OBJ_SMALL_INT_VALUE(v);
                 mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
                 offset &= VALUE_MASK(VAL_TYPE_BITS);
+                if (val_type >= BFUINT8 && val_type <= BFINT32) {
+                    // strip bit position and length
+                    offset &= (1 << 17) - 1;
+                }
                 mp_uint_t s = uctypes_struct_scalar_size(val_type);
                 if (s > *max_field_size) {
                     *max_field_size = s;
@@ -366,74 +370,79 @@ STATIC void set_aligned(uint val_type, void *p, mp_int_t index, mp_obj_t val) {
     }
 }
 
-STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
-    mp_obj_uctypes_struct_t *self = self_in;
-
-    // TODO: Support at least OrderedDict in addition
-    if (!MP_OBJ_IS_TYPE(self->desc, &mp_type_dict)) {
-            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "struct: no fields"));
-    }
-
-    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
-    if (MP_OBJ_IS_SMALL_INT(deref)) {
-        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
-        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
-        offset &= VALUE_MASK(VAL_TYPE_BITS);
+// Load (set_val == MP_OBJ_NULL) or store a scalar field, given the field's
+// descriptor value and the address of the containing struct
+STATIC mp_obj_t uctypes_scalar_op(byte *addr, mp_int_t offset, uint32_t flags, mp_obj_t set_val) {
+    mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
+    offset &= VALUE_MASK(VAL_TYPE_BITS);
 //printf("scalar type=%d offset=%x\n", val_type, offset);
 
-        if (val_type <= INT64) {
-//            printf("size=%d\n", GET_SCALAR_SIZE(val_type));
-            if (self->flags == LAYOUT_NATIVE) {
-                if (set_val == MP_OBJ_NULL) {
-                    return get_aligned(val_type, self->addr + offset, 0);
-                } else {
-                    set_aligned(val_type, self->addr + offset, 0, set_val);
-                    return set_val; // just !MP_OBJ_NULL
-                }
-            } else {
-                if (set_val == MP_OBJ_NULL) {
-                    return get_unaligned(val_type, self->addr + offset, self->flags);
-                } else {
-                    set_unaligned(val_type, self->addr + offset, self->flags, set_val);
-                    return set_val; // just !MP_OBJ_NULL
-                }
-            }
-        } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
-            uint bit_offset = (offset >> 17) & 31;
-            uint bit_len = (offset >> 22) & 31;
-            offset &= (1 << 17) - 1;
-            mp_uint_t val;
-            if (self->flags == LAYOUT_NATIVE) {
-                val = get_aligned_basic(val_type & 6, self->addr + offset);
+    if (val_type <= INT64) {
+//        printf("size=%d\n", GET_SCALAR_SIZE(val_type));
+        if (flags == LAYOUT_NATIVE) {
+            if (set_val == MP_OBJ_NULL) {
+                return get_aligned(val_type, addr + offset, 0);
             } else {
-                val = mp_binary_get_int(GET_SCALAR_SIZE(val_type & 7), val_type & 1, self->flags, self->addr + offset);
+                set_aligned(val_type, addr + offset, 0, set_val);
+                return set_val; // just !MP_OBJ_NULL
             }
+        } else {
             if (set_val == MP_OBJ_NULL) {
-                val >>= bit_offset;
-                val &= (1 << bit_len) - 1;
-                // TODO: signed
-                assert((val_type & 1) == 0);
-                return mp_obj_new_int(val);
+                return get_unaligned(val_type, addr + offset, flags);
             } else {
-                mp_uint_t set_val_int = (mp_uint_t)mp_obj_get_int(set_val);
-                mp_uint_t mask = (1 << bit_len) - 1;
-                set_val_int &= mask;
-                set_val_int <<= bit_offset;
-                mask <<= bit_offset;
-                val = (val & ~mask) | set_val_int;
-
-                if (self->flags == LAYOUT_NATIVE) {
-                    set_aligned_basic(val_type & 6, self->addr + offset, val);
-                } else {
-                    mp_binary_set_int(GET_SCALAR_SIZE(val_type & 7), self->flags == LAYOUT_BIG_ENDIAN,
-                        self->addr + offset, val);
-                }
+                set_unaligned(val_type, addr + offset, flags, set_val);
                 return set_val; // just !MP_OBJ_NULL
             }
         }
+    } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
+        uint bit_offset = (offset >> 17) & 31;
+        uint bit_len = (offset >> 22) & 31;
+        offset &= (1 << 17) - 1;
+        mp_uint_t val;
+        if (flags == LAYOUT_NATIVE) {
+            val = get_aligned_basic(val_type & 6, addr + offset);
+        } else {
+            val = mp_binary_get_int(GET_SCALAR_SIZE(val_type & 7), val_type & 1, flags, addr + offset);
+        }
+        if (set_val == MP_OBJ_NULL) {
+            val >>= bit_offset;
+            val &= (1 << bit_len) - 1;
+            // TODO: signed
+            assert((val_type & 1) == 0);
+            return mp_obj_new_int(val);
+        } else {
+            mp_uint_t set_val_int = (mp_uint_t)mp_obj_get_int(set_val);
+            mp_uint_t mask = (1 << bit_len) - 1;
+            set_val_int &= mask;
+            set_val_int <<= bit_offset;
+            mask <<= bit_offset;
+            val = (val & ~mask) | set_val_int;
+
+            if (flags == LAYOUT_NATIVE) {
+                set_aligned_basic(val_type & 6, addr + offset, val);
+            } else {
+                mp_binary_set_int(GET_SCALAR_SIZE(val_type & 7), flags == LAYOUT_BIG_ENDIAN,
+                    addr + offset, val);
+            }
+            return set_val; // just !MP_OBJ_NULL
+        }
+    }
 
-        assert(0);
-        return MP_OBJ_NULL;
+    assert(0);
+    return MP_OBJ_NULL;
+}
+
+STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
+    mp_obj_uctypes_struct_t *self = self_in;
+
+    // TODO: Support at least OrderedDict in addition
+    if (!MP_OBJ_IS_TYPE(self->desc, &mp_type_dict)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "struct: no fields"));
+    }
+
+    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
+    if (MP_OBJ_IS_SMALL_INT(deref)) {
+        return uctypes_scalar_op(self->addr, MP_OBJ_SMALL_INT_VALUE(deref), self->flags, set_val);
     }
 
     if (!MP_OBJ_IS_TYPE(deref, &mp_type_tuple)) {
@@ -587,6 +596,216 @@ STATIC mp_obj_t uctypes_struct_bytes_at(mp_obj_t ptr, mp_obj_t size) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(uctypes_struct_bytes_at_obj, uctypes_struct_bytes_at);
 
+#if MICROPY_PY_UCTYPES_LAYOUT
+
+/// \function compile(descriptor, fields, layout_type=NATIVE)
+/// Flatten the given scalar fields of a structure descriptor into a compiled
+/// layout, which unpack(), pack() and iter_unpack() then access without any
+/// descriptor lookups. A field in a nested structure is named with a dotted
+/// path, e.g. "hdr.len".
+
+typedef struct _uctypes_field_t {
+    mp_uint_t base; // offset of the struct containing the field
+    mp_int_t desc; // scalar descriptor value of the field
+} uctypes_field_t;
+
+typedef struct _mp_obj_uctypes_layout_t {
+    mp_obj_base_t base;
+    uint32_t flags;
+    mp_uint_t size; // size of the whole structure, the stride for iter_unpack
+    mp_uint_t n_fields;
+    uctypes_field_t fields[];
+} mp_obj_uctypes_layout_t;
+
+STATIC const mp_obj_type_t uctypes_layout_type;
+
+STATIC void uctypes_compile_field(uctypes_field_t *field, mp_obj_t desc, mp_obj_t name_in) {
+    mp_uint_t len;
+    const char *name = mp_obj_str_get_data(name_in, &len);
+    const char *top = name + len;
+    field->base = 0;
+    for (;;) {
+        if (!MP_OBJ_IS_TYPE(desc, &mp_type_dict)) {
+            syntax_error();
+        }
+        const char *dot = memchr(name, '.', top - name);
+        if (dot == NULL) {
+            dot = top;
+        }
+        mp_obj_t v = mp_obj_dict_get(desc, mp_obj_new_str(name, dot - name, true));
+        if (dot == top) {
+            if (!MP_OBJ_IS_SMALL_INT(v)) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "only scalar fields can be compiled"));
+            }
+            field->desc = MP_OBJ_SMALL_INT_VALUE(v);
+            return;
+        }
+        // descend into a nested structure
+        if (!MP_OBJ_IS_TYPE(v, &mp_type_tuple)) {
+            syntax_error();
+        }
+        mp_obj_tuple_t *t = (mp_obj_tuple_t*)v;
+        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(t->items[0]);
+        if (GET_TYPE(offset, AGG_TYPE_BITS) != STRUCT) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "only scalar fields can be compiled"));
+        }
+        field->base += offset & VALUE_MASK(AGG_TYPE_BITS);
+        desc = t->items[1];
+        name = dot + 1;
+    }
+}
+
+STATIC mp_obj_t uctypes_compile(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_uint_t n_fields;
+    mp_obj_t *fields;
+    mp_obj_get_array(args[1], &n_fields, &fields);
+    mp_obj_uctypes_layout_t *o = m_new_obj_var(mp_obj_uctypes_layout_t, uctypes_field_t, n_fields);
+    o->base.type = &uctypes_layout_type;
+    o->flags = n_args > 2 ? mp_obj_get_int(args[2]) : LAYOUT_NATIVE;
+    mp_uint_t max_field_size = 0;
+    o->size = uctypes_struct_size(args[0], &max_field_size);
+    o->n_fields = n_fields;
+    for (mp_uint_t i = 0; i < n_fields; i++) {
+        uctypes_compile_field(&o->fields[i], args[0], fields[i]);
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uctypes_compile_obj, 2, 3, uctypes_compile);
+
+STATIC mp_obj_uctypes_layout_t *uctypes_get_layout(mp_obj_t layout_in) {
+    if (!MP_OBJ_IS_TYPE(layout_in, &uctypes_layout_type)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "expecting compiled layout"));
+    }
+    return layout_in;
+}
+
+// Get the address of data to access, which may be given as an integer, a
+// uctypes struct, or an object with the buffer protocol. The length of the
+// data is returned in *len, or UCTYPES_LEN_UNKNOWN for a bare address.
+#define UCTYPES_LEN_UNKNOWN ((mp_uint_t)-1)
+STATIC byte *uctypes_get_addr(mp_obj_t addr_in, mp_uint_t *len, int flags) {
+    *len = UCTYPES_LEN_UNKNOWN;
+    if (MP_OBJ_IS_TYPE(addr_in, &uctypes_struct_type)) {
+        return ((mp_obj_uctypes_struct_t*)addr_in)->addr;
+    }
+    if (MP_OBJ_IS_INT(addr_in)) {
+        return (byte*)(uintptr_t)mp_obj_int_get_truncated(addr_in);
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(addr_in, &bufinfo, flags);
+    *len = bufinfo.len;
+    return bufinfo.buf;
+}
+
+STATIC NORETURN void uctypes_buffer_too_small(void) {
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+}
+
+STATIC mp_obj_t uctypes_layout_unpack(const mp_obj_uctypes_layout_t *layout, byte *addr) {
+    mp_obj_tuple_t *t = mp_obj_new_tuple(layout->n_fields, NULL);
+    for (mp_uint_t i = 0; i < layout->n_fields; i++) {
+        const uctypes_field_t *f = &layout->fields[i];
+        t->items[i] = uctypes_scalar_op(addr + f->base, f->desc, layout->flags, MP_OBJ_NULL);
+    }
+    return t;
+}
+
+/// \function unpack(layout, addr)
+/// Return the fields of a compiled layout as a tuple.
+STATIC mp_obj_t uctypes_unpack(mp_obj_t layout_in, mp_obj_t addr_in) {
+    mp_obj_uctypes_layout_t *layout = uctypes_get_layout(layout_in);
+    mp_uint_t len;
+    byte *addr = uctypes_get_addr(addr_in, &len, MP_BUFFER_READ);
+    if (len < layout->size) {
+        uctypes_buffer_too_small();
+    }
+    return uctypes_layout_unpack(layout, addr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uctypes_unpack_obj, uctypes_unpack);
+
+/// \function pack(layout, addr, values)
+/// Store the fields of a compiled layout from a sequence of values.
+STATIC mp_obj_t uctypes_pack(mp_obj_t layout_in, mp_obj_t addr_in, mp_obj_t values_in) {
+    mp_obj_uctypes_layout_t *layout = uctypes_get_layout(layout_in);
+    mp_uint_t len;
+    byte *addr = uctypes_get_addr(addr_in, &len, MP_BUFFER_WRITE);
+    if (len < layout->size) {
+        uctypes_buffer_too_small();
+    }
+    mp_uint_t n_values;
+    mp_obj_t *values;
+    mp_obj_get_array(values_in, &n_values, &values);
+    if (n_values != layout->n_fields) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "wrong number of values"));
+    }
+    for (mp_uint_t i = 0; i < n_values; i++) {
+        const uctypes_field_t *f = &layout->fields[i];
+        uctypes_scalar_op(addr + f->base, f->desc, layout->flags, values[i]);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(uctypes_pack_obj, uctypes_pack);
+
+typedef struct _mp_obj_uctypes_iter_t {
+    mp_obj_base_t base;
+    mp_obj_uctypes_layout_t *layout;
+    byte *addr;
+    mp_uint_t remaining;
+} mp_obj_uctypes_iter_t;
+
+STATIC mp_obj_t uctypes_iter_iternext(mp_obj_t self_in) {
+    mp_obj_uctypes_iter_t *self = self_in;
+    if (self->remaining == 0) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    self->remaining -= 1;
+    mp_obj_t t = uctypes_layout_unpack(self->layout, self->addr);
+    self->addr += self->layout->size;
+    return t;
+}
+
+STATIC const mp_obj_type_t uctypes_iter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = uctypes_iter_iternext,
+};
+
+/// \function iter_unpack(layout, addr, count=None)
+/// Iterate over an array of structures, yielding the fields of a compiled
+/// layout for each as a tuple. The count may be left out when addr is a
+/// buffer, to cover all of it.
+STATIC mp_obj_t uctypes_iter_unpack(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_uctypes_layout_t *layout = uctypes_get_layout(args[0]);
+    mp_obj_uctypes_iter_t *o = m_new_obj(mp_obj_uctypes_iter_t);
+    o->base.type = &uctypes_iter_type;
+    o->layout = layout;
+    mp_uint_t len;
+    o->addr = uctypes_get_addr(args[1], &len, MP_BUFFER_READ);
+    mp_uint_t avail = UCTYPES_LEN_UNKNOWN;
+    if (len != UCTYPES_LEN_UNKNOWN && layout->size != 0) {
+        avail = len / layout->size;
+    }
+    if (n_args > 2 && args[2] != mp_const_none) {
+        o->remaining = mp_obj_get_int(args[2]);
+        if (o->remaining > avail) {
+            uctypes_buffer_too_small();
+        }
+    } else if (avail != UCTYPES_LEN_UNKNOWN) {
+        o->remaining = avail;
+    } else {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "count required"));
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uctypes_iter_unpack_obj, 2, 3, uctypes_iter_unpack);
+
+STATIC const mp_obj_type_t uctypes_layout_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_layout,
+};
+
+#endif // MICROPY_PY_UCTYPES_LAYOUT
 
 STATIC const mp_obj_type_t uctypes_struct_type = {
     { &mp_type_type },
@@ -604,6 +823,12 @@ STATIC const mp_map_elem_t mp_module_uctypes_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_addressof), (mp_obj_t)&uctypes_struct_addressof_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_bytes_at), (mp_obj_t)&uctypes_struct_bytes_at_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_bytearray_at), (mp_obj_t)&uctypes_struct_bytearray_at_obj },
+    #if MICROPY_PY_UCTYPES_LAYOUT
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compile), (mp_obj_t)&uctypes_compile_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unpack), (mp_obj_t)&uctypes_unpack_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pack), (mp_obj_t)&uctypes_pack_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_iter_unpack), (mp_obj_t)&uctypes_iter_unpack_obj },
+    #endif
 
     /// \moduleref uctypes
 
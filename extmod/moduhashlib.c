@@ -33,19 +33,64 @@
 #if MICROPY_PY_UHASHLIB
 
 #include "crypto-algorithms/sha256.h"
+#if MICROPY_PY_UHASHLIB_SHA1
+#include "crypto-algorithms/sha1.h"
+#endif
+#if MICROPY_PY_UHASHLIB_MD5
+#include "crypto-algorithms/md5.h"
+#endif
+
+#if MICROPY_PY_UHASHLIB_HW
+// Provided by a port with a hashing engine. mp_hal_hash_init() starts a hash
+// of the given algorithm (MP_QSTR_sha256, MP_QSTR_sha1 or MP_QSTR_md5) in
+// the engine and returns true, or returns false if the engine can't take it
+// (not supported, or in use by another hash), and the software version is
+// used instead. ctx is MICROPY_HW_HASH_CTX_SIZE bytes in the hash object,
+// for the port's own state. Data given to update() may be in any buffer,
+// including a slice of a memoryview, and is only valid during the call.
+bool mp_hal_hash_init(void *ctx, qstr alg);
+void mp_hal_hash_update(void *ctx, const byte *data, mp_uint_t len);
+void mp_hal_hash_final(void *ctx, byte *digest);
+#endif
+
+// A software implementation of a hash algorithm
+typedef struct _hash_alg_t {
+    uint16_t ctx_size;
+    uint16_t digest_size;
+    void (*init)(void *ctx);
+    void (*update)(void *ctx, const byte *data, size_t len);
+    void (*final)(void *ctx, byte *digest);
+} hash_alg_t;
 
 typedef struct _mp_obj_hash_t {
     mp_obj_base_t base;
+    const hash_alg_t *alg;
+    bool hw; // state is kept by the port's hashing engine
     char state[0];
 } mp_obj_hash_t;
 
 STATIC mp_obj_t hash_update(mp_obj_t self_in, mp_obj_t arg);
 
-STATIC mp_obj_t hash_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+STATIC mp_obj_t hash_make_new(mp_obj_t type_in, const hash_alg_t *alg, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 0, 1, false);
-    mp_obj_hash_t *o = m_new_obj_var(mp_obj_hash_t, char, sizeof(SHA256_CTX));
+    mp_uint_t ctx_size = alg->ctx_size;
+    #if MICROPY_PY_UHASHLIB_HW
+    if (ctx_size < MICROPY_HW_HASH_CTX_SIZE) {
+        ctx_size = MICROPY_HW_HASH_CTX_SIZE;
+    }
+    #endif
+    mp_obj_hash_t *o = m_new_obj_var(mp_obj_hash_t, char, ctx_size);
     o->base.type = type_in;
-    sha256_init((SHA256_CTX*)o->state);
+    o->alg = alg;
+    #if MICROPY_PY_UHASHLIB_HW
+    o->hw = mp_hal_hash_init(o->state, ((mp_obj_type_t*)type_in)->name);
+    if (!o->hw)
+    #else
+    o->hw = false;
+    #endif
+    {
+        alg->init(o->state);
+    }
     if (n_args == 1) {
         hash_update(o, args[0]);
     }
@@ -54,9 +99,17 @@ STATIC mp_obj_t hash_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw
 
 STATIC mp_obj_t hash_update(mp_obj_t self_in, mp_obj_t arg) {
     mp_obj_hash_t *self = self_in;
+    // any object with the buffer protocol, e.g. a memoryview, is hashed in
+    // place without a copy
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(arg, &bufinfo, MP_BUFFER_READ);
-    sha256_update((SHA256_CTX*)self->state, bufinfo.buf, bufinfo.len);
+    #if MICROPY_PY_UHASHLIB_HW
+    if (self->hw) {
+        mp_hal_hash_update(self->state, bufinfo.buf, bufinfo.len);
+        return mp_const_none;
+    }
+    #endif
+    self->alg->update(self->state, bufinfo.buf, bufinfo.len);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_2(hash_update_obj, hash_update);
@@ -64,8 +117,14 @@ MP_DEFINE_CONST_FUN_OBJ_2(hash_update_obj, hash_update);
 STATIC mp_obj_t hash_digest(mp_obj_t self_in) {
     mp_obj_hash_t *self = self_in;
     vstr_t vstr;
-    vstr_init_len(&vstr, SHA256_BLOCK_SIZE);
-    sha256_final((SHA256_CTX*)self->state, (byte*)vstr.buf);
+    vstr_init_len(&vstr, self->alg->digest_size);
+    #if MICROPY_PY_UHASHLIB_HW
+    if (self->hw) {
+        mp_hal_hash_final(self->state, (byte*)vstr.buf);
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+    #endif
+    self->alg->final(self->state, (byte*)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(hash_digest_obj, hash_digest);
@@ -90,16 +149,76 @@ STATIC const mp_map_elem_t hash_locals_dict_table[] = {
 
 STATIC MP_DEFINE_CONST_DICT(hash_locals_dict, hash_locals_dict_table);
 
+STATIC const hash_alg_t sha256_alg = {
+    .ctx_size = sizeof(SHA256_CTX),
+    .digest_size = SHA256_BLOCK_SIZE,
+    .init = (void(*)(void*))sha256_init,
+    .update = (void(*)(void*, const byte*, size_t))sha256_update,
+    .final = (void(*)(void*, byte*))sha256_final,
+};
+
+STATIC mp_obj_t sha256_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    return hash_make_new(type_in, &sha256_alg, n_args, n_kw, args);
+}
+
 STATIC const mp_obj_type_t sha256_type = {
     { &mp_type_type },
     .name = MP_QSTR_sha256,
-    .make_new = hash_make_new,
+    .make_new = sha256_make_new,
     .locals_dict = (mp_obj_t)&hash_locals_dict,
 };
 
+#if MICROPY_PY_UHASHLIB_SHA1
+STATIC const hash_alg_t sha1_alg = {
+    .ctx_size = sizeof(SHA1_CTX),
+    .digest_size = SHA1_BLOCK_SIZE,
+    .init = (void(*)(void*))sha1_init,
+    .update = (void(*)(void*, const byte*, size_t))sha1_update,
+    .final = (void(*)(void*, byte*))sha1_final,
+};
+
+STATIC mp_obj_t sha1_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    return hash_make_new(type_in, &sha1_alg, n_args, n_kw, args);
+}
+
+STATIC const mp_obj_type_t sha1_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_sha1,
+    .make_new = sha1_make_new,
+    .locals_dict = (mp_obj_t)&hash_locals_dict,
+};
+#endif
+
+#if MICROPY_PY_UHASHLIB_MD5
+STATIC const hash_alg_t md5_alg = {
+    .ctx_size = sizeof(MD5_CTX),
+    .digest_size = MD5_BLOCK_SIZE,
+    .init = (void(*)(void*))md5_init,
+    .update = (void(*)(void*, const byte*, size_t))md5_update,
+    .final = (void(*)(void*, byte*))md5_final,
+};
+
+STATIC mp_obj_t md5_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    return hash_make_new(type_in, &md5_alg, n_args, n_kw, args);
+}
+
+STATIC const mp_obj_type_t md5_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_md5,
+    .make_new = md5_make_new,
+    .locals_dict = (mp_obj_t)&hash_locals_dict,
+};
+#endif
+
 STATIC const mp_map_elem_t mp_module_hashlib_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uhashlib) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sha256), (mp_obj_t)&sha256_type },
+    #if MICROPY_PY_UHASHLIB_SHA1
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sha1), (mp_obj_t)&sha1_type },
+    #endif
+    #if MICROPY_PY_UHASHLIB_MD5
+    { MP_OBJ_NEW_QSTR(MP_QSTR_md5), (mp_obj_t)&md5_type },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_hashlib_globals, mp_module_hashlib_globals_table);
@@ -111,5 +230,11 @@ const mp_obj_module_t mp_module_uhashlib = {
 };
 
 #include "crypto-algorithms/sha256.c"
+#if MICROPY_PY_UHASHLIB_SHA1
+#include "crypto-algorithms/sha1.c"
+#endif
+#if MICROPY_PY_UHASHLIB_MD5
+#include "crypto-algorithms/md5.c"
+#endif
 
 #endif //MICROPY_PY_UHASHLIB
@@ -105,11 +105,193 @@ STATIC mp_obj_t mod_uheapq_heapify(mp_obj_t heap_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uheapq_heapify_obj, mod_uheapq_heapify);
 
+#if MICROPY_PY_UHEAPQ_PQUEUE
+
+// A priority queue keeping native int (or float) priorities in a flat array
+// of entries, so pushing and popping don't allocate tuples and comparisons
+// don't go through mp_binary_op. Items of equal priority are popped in the
+// order they were pushed.
+
+typedef struct _pqueue_entry_t {
+    union {
+        mp_int_t i;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        mp_float_t f;
+        #endif
+    } prio;
+    mp_uint_t seq;
+    mp_obj_t item;
+} pqueue_entry_t;
+
+typedef struct _mp_obj_pqueue_t {
+    mp_obj_base_t base;
+    bool is_float; // all priorities are floats, set once a float is pushed
+    mp_uint_t alloc;
+    mp_uint_t len;
+    mp_uint_t seq;
+    pqueue_entry_t *heap;
+} mp_obj_pqueue_t;
+
+STATIC bool pqueue_less(const mp_obj_pqueue_t *pq, const pqueue_entry_t *a, const pqueue_entry_t *b) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (pq->is_float) {
+        if (a->prio.f != b->prio.f) {
+            return a->prio.f < b->prio.f;
+        }
+    } else
+    #else
+    (void)pq;
+    #endif
+    if (a->prio.i != b->prio.i) {
+        return a->prio.i < b->prio.i;
+    }
+    // sequence numbers are compared so that wrapping around is harmless
+    return (mp_int_t)(a->seq - b->seq) < 0;
+}
+
+STATIC void pqueue_siftdown(mp_obj_pqueue_t *pq, mp_uint_t pos) {
+    pqueue_entry_t item = pq->heap[pos];
+    while (pos > 0) {
+        mp_uint_t parent_pos = (pos - 1) >> 1;
+        if (!pqueue_less(pq, &item, &pq->heap[parent_pos])) {
+            break;
+        }
+        pq->heap[pos] = pq->heap[parent_pos];
+        pos = parent_pos;
+    }
+    pq->heap[pos] = item;
+}
+
+STATIC void pqueue_siftup(mp_obj_pqueue_t *pq, mp_uint_t pos) {
+    mp_uint_t end_pos = pq->len;
+    pqueue_entry_t item = pq->heap[pos];
+    for (mp_uint_t child_pos = 2 * pos + 1; child_pos < end_pos; child_pos = 2 * pos + 1) {
+        if (child_pos + 1 < end_pos && pqueue_less(pq, &pq->heap[child_pos + 1], &pq->heap[child_pos])) {
+            child_pos += 1;
+        }
+        if (!pqueue_less(pq, &pq->heap[child_pos], &item)) {
+            break;
+        }
+        pq->heap[pos] = pq->heap[child_pos];
+        pos = child_pos;
+    }
+    pq->heap[pos] = item;
+}
+
+STATIC mp_obj_t pqueue_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    mp_obj_pqueue_t *o = m_new_obj(mp_obj_pqueue_t);
+    o->base.type = type_in;
+    o->is_float = false;
+    // the optional argument is the initial capacity
+    o->alloc = n_args > 0 ? mp_obj_get_int(args[0]) : 4;
+    if (o->alloc < 1) {
+        o->alloc = 1;
+    }
+    o->len = 0;
+    o->seq = 0;
+    o->heap = m_new(pqueue_entry_t, o->alloc);
+    return o;
+}
+
+STATIC mp_obj_t pqueue_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_pqueue_t *self = self_in;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(self->len != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->len);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t pqueue_push(mp_obj_t self_in, mp_obj_t prio_in, mp_obj_t item) {
+    mp_obj_pqueue_t *self = self_in;
+    pqueue_entry_t e;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (!self->is_float && mp_obj_is_float(prio_in)) {
+        // switch the whole queue over to float priorities
+        for (mp_uint_t i = 0; i < self->len; i++) {
+            self->heap[i].prio.f = (mp_float_t)self->heap[i].prio.i;
+        }
+        self->is_float = true;
+    }
+    if (self->is_float) {
+        e.prio.f = mp_obj_get_float(prio_in);
+    } else
+    #endif
+    {
+        e.prio.i = mp_obj_get_int(prio_in);
+    }
+    e.seq = self->seq++;
+    e.item = item;
+    if (self->len >= self->alloc) {
+        self->heap = m_renew(pqueue_entry_t, self->heap, self->alloc, self->alloc * 2);
+        self->alloc *= 2;
+    }
+    self->heap[self->len] = e;
+    pqueue_siftdown(self, self->len++);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(pqueue_push_obj, pqueue_push);
+
+STATIC mp_obj_pqueue_t *pqueue_get_nonempty(mp_obj_t self_in) {
+    mp_obj_pqueue_t *self = self_in;
+    if (self->len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "empty heap"));
+    }
+    return self;
+}
+
+STATIC mp_obj_t pqueue_pop(mp_obj_t self_in) {
+    mp_obj_pqueue_t *self = pqueue_get_nonempty(self_in);
+    mp_obj_t item = self->heap[0].item;
+    self->len -= 1;
+    self->heap[0] = self->heap[self->len];
+    self->heap[self->len].item = MP_OBJ_NULL; // so we don't retain a pointer
+    if (self->len) {
+        pqueue_siftup(self, 0);
+    }
+    return item;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pqueue_pop_obj, pqueue_pop);
+
+// Return the priority of the item that pop() would return
+STATIC mp_obj_t pqueue_peek(mp_obj_t self_in) {
+    mp_obj_pqueue_t *self = pqueue_get_nonempty(self_in);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (self->is_float) {
+        return mp_obj_new_float(self->heap[0].prio.f);
+    }
+    #endif
+    return mp_obj_new_int(self->heap[0].prio.i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pqueue_peek_obj, pqueue_peek);
+
+STATIC const mp_map_elem_t pqueue_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_push), (mp_obj_t)&pqueue_push_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pop), (mp_obj_t)&pqueue_pop_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_peek), (mp_obj_t)&pqueue_peek_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(pqueue_locals_dict, pqueue_locals_dict_table);
+
+STATIC const mp_obj_type_t pqueue_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_PriorityQueue,
+    .make_new = pqueue_make_new,
+    .unary_op = pqueue_unary_op,
+    .locals_dict = (mp_obj_t)&pqueue_locals_dict,
+};
+
+#endif // MICROPY_PY_UHEAPQ_PQUEUE
+
 STATIC const mp_map_elem_t mp_module_uheapq_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uheapq) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_heappush), (mp_obj_t)&mod_uheapq_heappush_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_heappop), (mp_obj_t)&mod_uheapq_heappop_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_heapify), (mp_obj_t)&mod_uheapq_heapify_obj },
+    #if MICROPY_PY_UHEAPQ_PQUEUE
+    { MP_OBJ_NEW_QSTR(MP_QSTR_PriorityQueue), (mp_obj_t)&pqueue_type },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uheapq_globals, mp_module_uheapq_globals_table);
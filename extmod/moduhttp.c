@@ -0,0 +1,294 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_UHTTP
+
+// An incremental HTTP/1.x request and response head parser.  It works on a
+// buffer the caller fills (e.g. with sock.readinto) and never copies out of
+// it: the method, path, reason and header names and values are returned as
+// (start, end) offsets into the buffer.  Until the empty line that ends the
+// head has arrived the parse functions return None, and passing the length
+// seen on the previous call avoids scanning the same bytes again.
+
+#define HEADER_TUPLE_LEN (4) // name start, name end, value start, value end
+
+STATIC void uhttp_bad(void) {
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad HTTP message"));
+}
+
+// find the end of the head, returning the offset just past its empty line or
+// 0 if it isn't complete yet; lines may end with CRLF or a bare LF
+STATIC mp_uint_t uhttp_find_head_end(const byte *buf, mp_uint_t len, mp_uint_t from) {
+    for (mp_uint_t i = from; i < len; i++) {
+        if (buf[i] != '\n') {
+            continue;
+        }
+        if (i + 1 < len && buf[i + 1] == '\n') {
+            return i + 2;
+        }
+        if (i + 2 < len && buf[i + 1] == '\r' && buf[i + 2] == '\n') {
+            return i + 3;
+        }
+    }
+    return 0;
+}
+
+// return the end of the line starting at pos (excluding any CR), and set
+// *next to the start of the following line
+STATIC mp_uint_t uhttp_line_end(const byte *buf, mp_uint_t pos, mp_uint_t *next) {
+    const byte *nl = memchr(buf + pos, '\n', *next - pos);
+    mp_uint_t end = nl - buf;
+    *next = end + 1;
+    if (end > pos && buf[end - 1] == '\r') {
+        end--;
+    }
+    return end;
+}
+
+STATIC bool uhttp_is_token_char(byte c) {
+    return c > ' ' && c < 0x7f && strchr("()<>@,;:\\\"/[]?={}", c) == NULL;
+}
+
+STATIC mp_obj_t uhttp_span(mp_uint_t start, mp_uint_t end) {
+    mp_obj_t t[2] = {MP_OBJ_NEW_SMALL_INT(start), MP_OBJ_NEW_SMALL_INT(end)};
+    return mp_obj_new_tuple(2, t);
+}
+
+// parse "HTTP/1.x" at buf[pos], returning x
+STATIC mp_int_t uhttp_parse_version(const byte *buf, mp_uint_t pos, mp_uint_t end) {
+    if (end - pos < 8 || memcmp(buf + pos, "HTTP/1.", 7) != 0
+        || buf[pos + 7] < '0' || buf[pos + 7] > '9') {
+        uhttp_bad();
+    }
+    return buf[pos + 7] - '0';
+}
+
+// parse the header lines from pos up to the end of the head
+STATIC mp_obj_t uhttp_parse_headers(const byte *buf, mp_uint_t pos, mp_uint_t head_end) {
+    mp_obj_t headers = mp_obj_new_list(0, NULL);
+    for (;;) {
+        mp_uint_t next = head_end;
+        mp_uint_t end = uhttp_line_end(buf, pos, &next);
+        if (end == pos) {
+            // the empty line ending the head
+            break;
+        }
+        mp_uint_t colon = pos;
+        while (colon < end && uhttp_is_token_char(buf[colon])) {
+            colon++;
+        }
+        // folded (continuation) lines and names with spaces are rejected
+        if (colon == pos || colon == end || buf[colon] != ':') {
+            uhttp_bad();
+        }
+        mp_uint_t vstart = colon + 1;
+        while (vstart < end && (buf[vstart] == ' ' || buf[vstart] == '\t')) {
+            vstart++;
+        }
+        mp_uint_t vend = end;
+        while (vend > vstart && (buf[vend - 1] == ' ' || buf[vend - 1] == '\t')) {
+            vend--;
+        }
+        mp_obj_t t[HEADER_TUPLE_LEN] = {
+            MP_OBJ_NEW_SMALL_INT(pos), MP_OBJ_NEW_SMALL_INT(colon),
+            MP_OBJ_NEW_SMALL_INT(vstart), MP_OBJ_NEW_SMALL_INT(vend),
+        };
+        mp_obj_list_append(headers, mp_obj_new_tuple(HEADER_TUPLE_LEN, t));
+        pos = next;
+    }
+    return headers;
+}
+
+// get the buffer and head end shared by the parse functions, returning false
+// if the head is incomplete
+STATIC bool uhttp_get_head(mp_uint_t n_args, const mp_obj_t *args, mp_buffer_info_t *bufinfo, mp_uint_t *head_end) {
+    mp_get_buffer_raise(args[0], bufinfo, MP_BUFFER_READ);
+    mp_uint_t len = bufinfo->len;
+    if (n_args > 1 && args[1] != mp_const_none) {
+        len = MIN((mp_uint_t)mp_obj_get_int(args[1]), len);
+    }
+    mp_uint_t from = 0;
+    if (n_args > 2) {
+        mp_int_t last_len = mp_obj_get_int(args[2]);
+        // the end of the head may straddle the previous and the new data
+        if (last_len > 3) {
+            from = MIN((mp_uint_t)last_len - 3, len);
+        }
+    }
+    bufinfo->len = len;
+    *head_end = uhttp_find_head_end(bufinfo->buf, len, from);
+    return *head_end != 0;
+}
+
+// parse_request(buf[, len[, last_len]])
+// returns None if incomplete, otherwise a tuple
+// (head_len, (method_start, method_end), (path_start, path_end), minor_version, headers)
+// where headers is a list of (name_start, name_end, value_start, value_end)
+STATIC mp_obj_t uhttp_parse_request(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_uint_t head_end;
+    if (!uhttp_get_head(n_args, args, &bufinfo, &head_end)) {
+        return mp_const_none;
+    }
+    const byte *buf = bufinfo.buf;
+
+    // skip empty lines that may precede the request line
+    mp_uint_t pos = 0;
+    while (pos < head_end && (buf[pos] == '\r' || buf[pos] == '\n')) {
+        pos++;
+    }
+
+    // request line: method SP path SP version
+    mp_uint_t next = head_end;
+    mp_uint_t end = uhttp_line_end(buf, pos, &next);
+    mp_uint_t method_end = pos;
+    while (method_end < end && uhttp_is_token_char(buf[method_end])) {
+        method_end++;
+    }
+    if (method_end == pos || method_end == end || buf[method_end] != ' ') {
+        uhttp_bad();
+    }
+    mp_uint_t path_start = method_end + 1;
+    mp_uint_t path_end = path_start;
+    while (path_end < end && buf[path_end] > ' ') {
+        path_end++;
+    }
+    if (path_end == path_start || path_end == end || buf[path_end] != ' ') {
+        uhttp_bad();
+    }
+    mp_int_t minor = uhttp_parse_version(buf, path_end + 1, end);
+    if (path_end + 1 + 8 != end) {
+        uhttp_bad();
+    }
+
+    mp_obj_t t[5] = {
+        MP_OBJ_NEW_SMALL_INT(head_end),
+        uhttp_span(pos, method_end),
+        uhttp_span(path_start, path_end),
+        MP_OBJ_NEW_SMALL_INT(minor),
+        uhttp_parse_headers(buf, next, head_end),
+    };
+    return mp_obj_new_tuple(5, t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uhttp_parse_request_obj, 1, 3, uhttp_parse_request);
+
+// parse_response(buf[, len[, last_len]])
+// returns None if incomplete, otherwise a tuple
+// (head_len, minor_version, status, (reason_start, reason_end), headers)
+STATIC mp_obj_t uhttp_parse_response(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_uint_t head_end;
+    if (!uhttp_get_head(n_args, args, &bufinfo, &head_end)) {
+        return mp_const_none;
+    }
+    const byte *buf = bufinfo.buf;
+
+    // status line: version SP 3-digit status [SP reason]
+    mp_uint_t next = head_end;
+    mp_uint_t end = uhttp_line_end(buf, 0, &next);
+    mp_int_t minor = uhttp_parse_version(buf, 0, end);
+    if (end < 12 || buf[8] != ' ') {
+        uhttp_bad();
+    }
+    mp_int_t status = 0;
+    for (mp_uint_t i = 9; i < 12; i++) {
+        if (buf[i] < '0' || buf[i] > '9') {
+            uhttp_bad();
+        }
+        status = status * 10 + buf[i] - '0';
+    }
+    mp_uint_t reason_start = 12;
+    if (end > 12) {
+        if (buf[12] != ' ') {
+            uhttp_bad();
+        }
+        reason_start = 13;
+    }
+
+    mp_obj_t t[5] = {
+        MP_OBJ_NEW_SMALL_INT(head_end),
+        MP_OBJ_NEW_SMALL_INT(minor),
+        MP_OBJ_NEW_SMALL_INT(status),
+        uhttp_span(reason_start, end),
+        uhttp_parse_headers(buf, next, head_end),
+    };
+    return mp_obj_new_tuple(5, t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(uhttp_parse_response_obj, 1, 3, uhttp_parse_response);
+
+// header(buf, headers, name)
+// look up a header by name, ignoring case, returning (value_start, value_end)
+// of the first match or None
+STATIC mp_obj_t uhttp_header(mp_obj_t buf_in, mp_obj_t headers_in, mp_obj_t name_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    mp_uint_t name_len;
+    const char *name = mp_obj_str_get_data(name_in, &name_len);
+    mp_uint_t n;
+    mp_obj_t *items;
+    mp_obj_get_array(headers_in, &n, &items);
+    for (mp_uint_t i = 0; i < n; i++) {
+        mp_obj_t *h;
+        mp_obj_get_array_fixed_n(items[i], HEADER_TUPLE_LEN, &h);
+        mp_uint_t start = mp_obj_get_int(h[0]);
+        mp_uint_t end = mp_obj_get_int(h[1]);
+        if (end > bufinfo.len || end - start != name_len) {
+            continue;
+        }
+        const byte *p = (const byte*)bufinfo.buf + start;
+        mp_uint_t j = 0;
+        while (j < name_len && unichar_tolower(p[j]) == unichar_tolower(name[j])) {
+            j++;
+        }
+        if (j == name_len) {
+            return uhttp_span(mp_obj_get_int(h[2]), mp_obj_get_int(h[3]));
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(uhttp_header_obj, uhttp_header);
+
+STATIC const mp_map_elem_t uhttp_module_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uhttp) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_parse_request), (mp_obj_t)&uhttp_parse_request_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_parse_response), (mp_obj_t)&uhttp_parse_response_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_header), (mp_obj_t)&uhttp_header_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(uhttp_module_globals, uhttp_module_globals_table);
+
+const mp_obj_module_t mp_module_uhttp = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_uhttp,
+    .globals = (mp_obj_dict_t*)&uhttp_module_globals,
+};
+
+#endif // MICROPY_PY_UHTTP
@@ -25,14 +25,67 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/nlr.h"
 #include "py/objlist.h"
+#include "py/objstr.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
+#include "py/stream.h"
 
 #if MICROPY_PY_UJSON
 
+// load() and dump() go through the stream protocol in chunks of this size,
+// so a document never needs to be held in RAM as a whole
+#define UJSON_STREAM_BUF_SIZE (64)
+
+STATIC const mp_stream_p_t *ujson_get_stream(mp_obj_t obj, bool write) {
+    return mp_get_stream_raise(obj, write ? MP_STREAM_OP_WRITE : MP_STREAM_OP_READ);
+}
+
+/******************************************************************************/
+// encoder
+
+typedef struct _ujson_dump_t {
+    mp_obj_t stream_obj;
+    mp_uint_t len;
+    byte buf[UJSON_STREAM_BUF_SIZE];
+} ujson_dump_t;
+
+STATIC void ujson_dump_write(ujson_dump_t *d, const char *str, mp_uint_t len) {
+    int errcode;
+    if (mp_stream_rw_into(d->stream_obj, (char*)str, len, &errcode, MP_STREAM_RW_WRITE) != len) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+    }
+}
+
+STATIC void ujson_dump_strn(void *data, const char *str, mp_uint_t len) {
+    ujson_dump_t *d = data;
+    if (d->len + len > UJSON_STREAM_BUF_SIZE) {
+        ujson_dump_write(d, (const char*)d->buf, d->len);
+        d->len = 0;
+        if (len > UJSON_STREAM_BUF_SIZE) {
+            ujson_dump_write(d, str, len);
+            return;
+        }
+    }
+    memcpy(d->buf + d->len, str, len);
+    d->len += len;
+}
+
+STATIC mp_obj_t mod_ujson_dump(mp_obj_t obj, mp_obj_t stream_obj) {
+    ujson_dump_t d;
+    ujson_get_stream(stream_obj, true);
+    d.stream_obj = stream_obj;
+    d.len = 0;
+    mp_print_t print = {&d, ujson_dump_strn};
+    mp_obj_print_helper(&print, obj, PRINT_JSON);
+    ujson_dump_write(&d, (const char*)d.buf, d.len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_obj, mod_ujson_dump);
+
 STATIC mp_obj_t mod_ujson_dumps(mp_obj_t obj) {
     vstr_t vstr;
     mp_print_t print;
@@ -42,6 +95,76 @@ STATIC mp_obj_t mod_ujson_dumps(mp_obj_t obj) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 
+/******************************************************************************/
+// decoder
+
+// The input to the parser: a window [cur, top) onto the data which, for a
+// stream, is refilled from the stream when it runs out.  For a str the
+// window is the whole string and there is nothing to refill from.
+typedef struct _ujson_stream_t {
+    mp_obj_t stream_obj;
+    mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
+    const byte *cur;
+    const byte *top;
+    byte *buf;
+} ujson_stream_t;
+
+#define S_EOF (-1)
+#define S_CUR(s) ((s)->cur < (s)->top ? *(s)->cur : ujson_stream_fill(s))
+#define S_NEXT(s) ((s)->cur++) // only valid when S_CUR is not S_EOF
+
+STATIC int ujson_stream_fill(ujson_stream_t *s) {
+    if (s->read == NULL) {
+        return S_EOF;
+    }
+    int errcode;
+    mp_uint_t n = s->read(s->stream_obj, s->buf, UJSON_STREAM_BUF_SIZE, &errcode);
+    if (n == MP_STREAM_ERROR) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+    }
+    if (n == 0) {
+        s->read = NULL;
+        return S_EOF;
+    }
+    s->cur = s->buf;
+    s->top = s->buf + n;
+    return *s->cur;
+}
+
+// match the remaining chars of a literal
+STATIC bool ujson_match(ujson_stream_t *s, const char *lit) {
+    for (; *lit != '\0'; lit++) {
+        if (S_CUR(s) != (byte)*lit) {
+            return false;
+        }
+        S_NEXT(s);
+    }
+    return true;
+}
+
+// Dict keys tend to repeat (eg a list of records with the same fields), so
+// the parser remembers recently made keys in a small hash-indexed cache and
+// hands out the same str object for the same key text.  Keys that are
+// already qstrs come back as qstrs, as with any other string.
+#define UJSON_KEY_CACHE_SIZE (16) // must be a power of 2
+
+// The size of the last list/dict closed at each nesting depth is used to
+// preallocate the next one made at that depth.
+#define UJSON_SIZE_HINT_DEPTH (8)
+
+STATIC mp_obj_t ujson_new_key(mp_obj_t *cache, const char *data, mp_uint_t len) {
+    mp_uint_t hash = qstr_compute_hash((const byte*)data, len);
+    mp_obj_t *slot = &cache[hash & (UJSON_KEY_CACHE_SIZE - 1)];
+    if (*slot != MP_OBJ_NULL) {
+        GET_STR_DATA_LEN(*slot, key_data, key_len);
+        if (key_len == len && memcmp(key_data, data, len) == 0) {
+            return *slot;
+        }
+    }
+    *slot = mp_obj_new_str(data, len, false);
+    return *slot;
+}
+
 // This function implements a simple non-recursive JSON parser.
 //
 // The JSON specification is at http://www.ietf.org/rfc/rfc4627.txt
@@ -52,13 +175,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 // input is outside it's specs.
 //
 // Most of the work is parsing the primitives (null, false, true, numbers,
-// strings).  It does 1 pass over the input string and so is easily extended to
-// being able to parse from a non-seekable stream.  It tries to be fast and
-// small in code size, while not using more RAM than necessary.
-STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
-    mp_uint_t len;
-    const char *s = mp_obj_str_get_data(obj, &len);
-    const char *top = s + len;
+// strings).  It does 1 pass over the input, one char at a time, so that it
+// can parse from a non-seekable stream.  It tries to be fast and small in
+// code size, while not using more RAM than necessary.
+STATIC mp_obj_t ujson_parse(ujson_stream_t *s) {
     vstr_t vstr;
     vstr_init(&vstr, 8);
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
@@ -67,64 +187,72 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     mp_obj_t stack_top = MP_OBJ_NULL;
     mp_obj_type_t *stack_top_type = NULL;
     mp_obj_t stack_key = MP_OBJ_NULL;
+    mp_obj_t key_cache[UJSON_KEY_CACHE_SIZE];
+    mp_uint_t size_hint[UJSON_SIZE_HINT_DEPTH];
+    memset(key_cache, 0, sizeof(key_cache));
+    memset(size_hint, 0, sizeof(size_hint));
+    int c;
     for (;;) {
         cont:
-        if (s == top) {
-            break;
+        c = S_CUR(s);
+        if (c == S_EOF) {
+            // no object, or an unterminated list/dict
+            goto fail;
         }
         mp_obj_t next = MP_OBJ_NULL;
         bool enter = false;
-        switch (*s) {
+        S_NEXT(s);
+        switch (c) {
             case ',':
             case ':':
             case ' ':
             case '\t':
             case '\n':
             case '\r':
-                s += 1;
                 goto cont;
             case 'n':
-                if (s + 3 < top && s[1] == 'u' && s[2] == 'l' && s[3] == 'l') {
-                    s += 4;
-                    next = mp_const_none;
-                } else {
+                if (!ujson_match(s, "ull")) {
                     goto fail;
                 }
+                next = mp_const_none;
                 break;
             case 'f':
-                if (s + 4 < top && s[1] == 'a' && s[2] == 'l' && s[3] == 's' && s[4] == 'e') {
-                    s += 5;
-                    next = mp_const_false;
-                } else {
+                if (!ujson_match(s, "alse")) {
                     goto fail;
                 }
+                next = mp_const_false;
                 break;
             case 't':
-                if (s + 3 < top && s[1] == 'r' && s[2] == 'u' && s[3] == 'e') {
-                    s += 4;
-                    next = mp_const_true;
-                } else {
+                if (!ujson_match(s, "rue")) {
                     goto fail;
                 }
+                next = mp_const_true;
                 break;
             case '"':
                 vstr_reset(&vstr);
-                for (s++; s < top && *s != '"';) {
-                    byte c = *s;
+                while ((c = S_CUR(s)) != '"') {
+                    if (c == S_EOF) {
+                        goto fail;
+                    }
                     if (c == '\\') {
-                        s++;
-                        c = *s;
+                        S_NEXT(s);
+                        c = S_CUR(s);
                         switch (c) {
+                            case S_EOF: goto fail;
                             case 'b': c = 0x08; break;
                             case 'f': c = 0x0c; break;
                             case 'n': c = 0x0a; break;
                             case 'r': c = 0x0d; break;
                             case 't': c = 0x09; break;
                             case 'u': {
-                                if (s + 4 >= top) { goto fail; }
                                 mp_uint_t num = 0;
                                 for (int i = 0; i < 4; i++) {
-                                    c = (*++s | 0x20) - '0';
+                                    S_NEXT(s);
+                                    c = S_CUR(s);
+                                    if (c == S_EOF) {
+                                        goto fail;
+                                    }
+                                    c = (c | 0x20) - '0';
                                     if (c > 9) {
                                         c -= ('a' - ('9' + 1));
                                     }
@@ -137,27 +265,30 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
                     }
                     vstr_add_byte(&vstr, c);
                 str_cont:
-                    s++;
+                    S_NEXT(s);
                 }
-                if (s == top) {
-                    goto fail;
+                S_NEXT(s);
+                if (stack_top_type == &mp_type_dict && stack_key == MP_OBJ_NULL) {
+                    next = ujson_new_key(key_cache, vstr.buf, vstr.len);
+                } else {
+                    next = mp_obj_new_str(vstr.buf, vstr.len, false);
                 }
-                s++;
-                next = mp_obj_new_str(vstr.buf, vstr.len, false);
                 break;
             case '-':
             case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
                 bool flt = false;
                 vstr_reset(&vstr);
-                for (; s < top; s++) {
-                    if (*s == '.' || *s == 'E' || *s == 'e') {
+                for (;;) {
+                    vstr_add_byte(&vstr, c);
+                    c = S_CUR(s);
+                    if (c == '.' || c == 'E' || c == 'e') {
                         flt = true;
-                    } else if (*s == '-' || unichar_isdigit(*s)) {
+                    } else if (c == '-' || unichar_isdigit(c)) {
                         // pass
                     } else {
                         break;
                     }
-                    vstr_add_byte(&vstr, *s);
+                    S_NEXT(s);
                 }
                 if (flt) {
                     next = mp_parse_num_decimal(vstr.buf, vstr.len, false, false, NULL);
@@ -167,18 +298,22 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
                 break;
             }
             case '[':
-                next = mp_obj_new_list(0, NULL);
-                enter = true;
-                s += 1;
-                break;
-            case '{':
-                next = mp_obj_new_dict(0);
+            case '{': {
+                mp_uint_t depth = stack_top == MP_OBJ_NULL ? 0 : stack.len + 1;
+                mp_uint_t n = depth < UJSON_SIZE_HINT_DEPTH ? size_hint[depth] : 0;
+                if (c == '[') {
+                    mp_obj_list_t *list = mp_obj_new_list(n, NULL);
+                    list->len = 0;
+                    next = list;
+                } else {
+                    // leave some room so that the table isn't completely full
+                    next = mp_obj_new_dict(n + n / 2);
+                }
                 enter = true;
-                s += 1;
                 break;
+            }
             case '}':
             case ']': {
-                s += 1;
                 if (stack_top == MP_OBJ_NULL) {
                     // no object at all
                     goto fail;
@@ -187,6 +322,11 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
                     // finished; compound object
                     goto success;
                 }
+                if (stack.len < UJSON_SIZE_HINT_DEPTH) {
+                    size_hint[stack.len] = stack_top_type == &mp_type_list
+                        ? ((mp_obj_list_t*)stack_top)->len
+                        : ((mp_obj_dict_t*)stack_top)->map.used;
+                }
                 stack.len -= 1;
                 stack_top = stack.items[stack.len];
                 stack_top_type = mp_obj_get_type(stack_top);
@@ -231,10 +371,10 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     }
     success:
     // eat trailing whitespace
-    while (s < top && unichar_isspace(*s)) {
-        s++;
+    while (unichar_isspace(c = S_CUR(s))) {
+        S_NEXT(s);
     }
-    if (s < top) {
+    if (c != S_EOF) {
         // unexpected chars
         goto fail;
     }
@@ -248,11 +388,27 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     fail:
     nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "syntax error in JSON"));
 }
+
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
+    byte buf[UJSON_STREAM_BUF_SIZE];
+    ujson_stream_t s = {stream_obj, ujson_get_stream(stream_obj, false)->read, buf, buf, buf};
+    return ujson_parse(&s);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
+
+STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
+    mp_uint_t len;
+    const byte *data = (const byte*)mp_obj_str_get_data(obj, &len);
+    ujson_stream_t s = {MP_OBJ_NULL, NULL, data, data + len, NULL};
+    return ujson_parse(&s);
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
 
 STATIC const mp_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ujson) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dump), (mp_obj_t)&mod_ujson_dump_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_dumps), (mp_obj_t)&mod_ujson_dumps_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_load), (mp_obj_t)&mod_ujson_load_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_loads), (mp_obj_t)&mod_ujson_loads_obj },
 };
 
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_URANDOM
+
+// A small, fast pseudo-random number generator for when os.urandom is too
+// slow or not available.  It is xoshiro128** (a member of the xorshift
+// family), which needs only 32-bit shifts, xors and two multiplies by small
+// constants per word, and has a period of 2**128 - 1.  It is NOT suitable
+// for cryptographic use.  The state is seeded lazily on first use, from
+// MICROPY_PY_URANDOM_SEED_INIT_FUNC if the port provides it (eg the
+// hardware RNG), so that each boot gives a different sequence.
+
+STATIC uint32_t urandom_state[4];
+STATIC bool urandom_seeded = false;
+
+static inline uint32_t rotl32(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+// splitmix32 expands one seed word into the four state words; it never
+// gives an all-zero state, which is the one state xoshiro can't leave
+STATIC void urandom_seed_state(uint32_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint32_t z = (seed += 0x9e3779b9);
+        z = (z ^ (z >> 16)) * 0x85ebca6b;
+        z = (z ^ (z >> 13)) * 0xc2b2ae35;
+        urandom_state[i] = z ^ (z >> 16);
+    }
+    urandom_seeded = true;
+}
+
+STATIC uint32_t urandom_next(void) {
+    if (!urandom_seeded) {
+        #ifdef MICROPY_PY_URANDOM_SEED_INIT_FUNC
+        urandom_seed_state(MICROPY_PY_URANDOM_SEED_INIT_FUNC);
+        #else
+        urandom_seed_state(0);
+        #endif
+    }
+    uint32_t *s = urandom_state;
+    uint32_t result = rotl32(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+    return result;
+}
+
+// returns a uniform value in [0, n); it rejects draws above the largest
+// multiple of the range so there is no modulo bias
+STATIC uint32_t urandom_below(uint32_t n) {
+    uint32_t mask = n - 1;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    uint32_t r;
+    do {
+        r = urandom_next() & mask;
+    } while (r >= n);
+    return r;
+}
+
+// returns start + k * step for a uniform k, such that the result lies in
+// the half-open range [start, stop)
+STATIC mp_obj_t urandom_range(mp_int_t start, mp_int_t stop, mp_int_t step) {
+    mp_int_t n;
+    if (step > 0) {
+        n = (stop - start + step - 1) / step;
+    } else if (step < 0) {
+        n = (stop - start + step + 1) / step;
+    } else {
+        n = 0;
+    }
+    if (n <= 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty range"));
+    }
+    if ((uint64_t)n > 0xffffffff) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "range too large"));
+    }
+    return mp_obj_new_int(start + (mp_int_t)urandom_below(n) * step);
+}
+
+STATIC mp_obj_t mod_urandom_seed(mp_uint_t n_args, const mp_obj_t *args) {
+    uint32_t seed;
+    if (n_args == 0 || args[0] == mp_const_none) {
+        #ifdef MICROPY_PY_URANDOM_SEED_INIT_FUNC
+        seed = MICROPY_PY_URANDOM_SEED_INIT_FUNC;
+        #else
+        seed = 0;
+        #endif
+    } else {
+        if (MP_OBJ_IS_INT(args[0])) {
+            seed = mp_obj_int_get_truncated(args[0]);
+        } else {
+            seed = mp_obj_get_int(args[0]);
+        }
+    }
+    urandom_seed_state(seed);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_urandom_seed_obj, 0, 1, mod_urandom_seed);
+
+STATIC mp_obj_t mod_urandom_getrandbits(mp_obj_t num_in) {
+    mp_int_t n = mp_obj_get_int(num_in);
+    if (n < 0 || n > 32) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bits must be 0-32"));
+    }
+    if (n == 0) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    return mp_obj_new_int_from_uint(urandom_next() >> (32 - n));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_getrandbits_obj, mod_urandom_getrandbits);
+
+STATIC mp_obj_t mod_urandom_randrange(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_int_t start = 0;
+    mp_int_t stop;
+    mp_int_t step = 1;
+    if (n_args == 1) {
+        stop = mp_obj_get_int(args[0]);
+    } else {
+        start = mp_obj_get_int(args[0]);
+        stop = mp_obj_get_int(args[1]);
+        if (n_args == 3) {
+            step = mp_obj_get_int(args[2]);
+        }
+    }
+    return urandom_range(start, stop, step);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_urandom_randrange_obj, 1, 3, mod_urandom_randrange);
+
+STATIC mp_obj_t mod_urandom_randint(mp_obj_t a_in, mp_obj_t b_in) {
+    return urandom_range(mp_obj_get_int(a_in), mp_obj_get_int(b_in) + 1, 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_urandom_randint_obj, mod_urandom_randint);
+
+STATIC mp_obj_t mod_urandom_choice(mp_obj_t seq) {
+    mp_int_t len = mp_obj_get_int(mp_obj_len(seq));
+    if (len == 0) {
+        nlr_raise(mp_obj_new_exception(&mp_type_IndexError));
+    }
+    return mp_obj_subscr(seq, mp_obj_new_int(urandom_below(len)), MP_OBJ_SENTINEL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_choice_obj, mod_urandom_choice);
+
+#if MICROPY_PY_BUILTINS_FLOAT
+
+// returns a float in [0, 1) with as many random bits as the mantissa holds
+STATIC mp_float_t urandom_float(void) {
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    uint32_t a = urandom_next() >> 5;
+    uint32_t b = urandom_next() >> 6;
+    return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+    #else
+    return (urandom_next() >> 8) * (1.0f / 16777216.0f);
+    #endif
+}
+
+STATIC mp_obj_t mod_urandom_random(void) {
+    return mp_obj_new_float(urandom_float());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_urandom_random_obj, mod_urandom_random);
+
+STATIC mp_obj_t mod_urandom_uniform(mp_obj_t a_in, mp_obj_t b_in) {
+    mp_float_t a = mp_obj_get_float(a_in);
+    mp_float_t b = mp_obj_get_float(b_in);
+    return mp_obj_new_float(a + (b - a) * urandom_float());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_urandom_uniform_obj, mod_urandom_uniform);
+
+#endif // MICROPY_PY_BUILTINS_FLOAT
+
+STATIC const mp_map_elem_t mp_module_urandom_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_urandom) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_seed), (mp_obj_t)&mod_urandom_seed_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_getrandbits), (mp_obj_t)&mod_urandom_getrandbits_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_randrange), (mp_obj_t)&mod_urandom_randrange_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_randint), (mp_obj_t)&mod_urandom_randint_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_choice), (mp_obj_t)&mod_urandom_choice_obj },
+    #if MICROPY_PY_BUILTINS_FLOAT
+    { MP_OBJ_NEW_QSTR(MP_QSTR_random), (mp_obj_t)&mod_urandom_random_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_uniform), (mp_obj_t)&mod_urandom_uniform_obj },
+    #endif
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_urandom_globals, mp_module_urandom_globals_table);
+
+const mp_obj_module_t mp_module_urandom = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_urandom,
+    .globals = (mp_obj_dict_t*)&mp_module_urandom_globals,
+};
+
+#endif // MICROPY_PY_URANDOM
@@ -30,7 +30,9 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/objstr.h"
 #include "py/binary.h"
+#include "py/unicode.h"
 
 #if MICROPY_PY_URE
 
@@ -38,8 +40,17 @@
 
 #define FLAG_DEBUG 0x1000
 
+// longest literal prefix kept for scanning the subject
+#define RE_PREFIX_MAX (8)
+
 typedef struct _mp_obj_re_t {
     mp_obj_base_t base;
+    // found at compile time, so that search can skip the positions where no
+    // match can start without running the matcher there
+    byte prefix_len; // every match starts with these bytes of prefix
+    bool has_first; // every match starts with one of the bytes set in first
+    char prefix[RE_PREFIX_MAX];
+    byte first[256 / 8];
     ByteProg re;
 } mp_obj_re_t;
 
@@ -51,6 +62,18 @@ typedef struct _mp_obj_match_t {
 } mp_obj_match_t;
 
 
+// The subject is a str or bytes, or any object with the buffer protocol
+// (a bytearray, an mmap, ...) which is then matched as bytes without copying.
+STATIC const char *re_subject_data(mp_obj_t obj, mp_uint_t *len) {
+    if (MP_OBJ_IS_STR_OR_BYTES(obj)) {
+        return mp_obj_str_get_data(obj, len);
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_READ);
+    *len = bufinfo.len;
+    return bufinfo.buf;
+}
+
 STATIC void match_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_match_t *self = self_in;
@@ -73,8 +96,70 @@ STATIC mp_obj_t match_group(mp_obj_t self_in, mp_obj_t no_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(match_group_obj, match_group);
 
+#if MICROPY_PY_URE_SUB
+
+// Offsets of a group within the subject, (-1, -1) if the group didn't match;
+// groups are held as pointers into the subject, so nothing is copied.
+STATIC void match_span_helper(mp_uint_t n_args, const mp_obj_t *args, mp_obj_t span[2]) {
+    mp_obj_match_t *self = args[0];
+    mp_int_t no = 0;
+    if (n_args == 2) {
+        no = mp_obj_get_int(args[1]);
+        if (no < 0 || no >= self->num_matches) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_IndexError, args[1]));
+        }
+    }
+
+    mp_int_t s = -1;
+    mp_int_t e = -1;
+    const char *start = self->caps[no * 2];
+    if (start != NULL) {
+        mp_uint_t len;
+        const char *begin = re_subject_data(self->str, &len);
+        s = start - begin;
+        e = self->caps[no * 2 + 1] - begin;
+        #if MICROPY_PY_BUILTINS_STR_UNICODE
+        if (MP_OBJ_IS_STR(self->str)) {
+            // str offsets are in characters
+            s = unichar_charlen(begin, s);
+            e = unichar_charlen(begin, e);
+        }
+        #endif
+    }
+    span[0] = mp_obj_new_int(s);
+    span[1] = mp_obj_new_int(e);
+}
+
+STATIC mp_obj_t match_span(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return mp_obj_new_tuple(2, span);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_span_obj, 1, 2, match_span);
+
+STATIC mp_obj_t match_start(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return span[0];
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_start_obj, 1, 2, match_start);
+
+STATIC mp_obj_t match_end(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return span[1];
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_end_obj, 1, 2, match_end);
+
+#endif
+
 STATIC const mp_map_elem_t match_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_group), (mp_obj_t) &match_group_obj },
+    #if MICROPY_PY_URE_SUB
+    { MP_OBJ_NEW_QSTR(MP_QSTR_span), (mp_obj_t) &match_span_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_start), (mp_obj_t) &match_start_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_end), (mp_obj_t) &match_end_obj },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(match_locals_dict, match_locals_dict_table);
@@ -92,26 +177,63 @@ STATIC void re_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     mp_printf(print, "<re %p>", self);
 }
 
+// Whether a match can start at sp, going by the prefix or first bytes
+STATIC bool re_can_start(mp_obj_re_t *self, const char *sp, const char *end) {
+    if (self->prefix_len > 0) {
+        return (mp_uint_t)(end - sp) >= self->prefix_len && memcmp(sp, self->prefix, self->prefix_len) == 0;
+    }
+    if (self->has_first) {
+        return sp < end && (self->first[(byte)*sp >> 3] & (1 << (*sp & 7)));
+    }
+    return true;
+}
+
+// Find a match starting at sp, or if not anchored, at any position after it;
+// subj->begin stays the start of the subject, as seen by ^.
+STATIC int re_exec_from(mp_obj_re_t *self, Subject *subj, const char *sp, const char **caps, int caps_num, bool is_anchored) {
+    const char *end = subj->end;
+    if (is_anchored) {
+        return re_can_start(self, sp, end) && re1_5_recursiveloopprog_at(&self->re, subj, sp, caps, caps_num);
+    }
+    for (; sp <= end; sp++) {
+        if (self->prefix_len > 0) {
+            // let memchr find the candidates
+            sp = memchr(sp, self->prefix[0], end - sp);
+            if (sp == NULL) {
+                return 0;
+            }
+        }
+        if (re_can_start(self, sp, end) && re1_5_recursiveloopprog_at(&self->re, subj, sp, caps, caps_num)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+STATIC mp_obj_match_t *re_new_match(mp_obj_t str, int caps_num) {
+    mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
+    match->base.type = &match_type;
+    match->num_matches = caps_num / 2; // caps_num counts start and end pointers
+    match->str = str;
+    // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+    memset((char*)match->caps, 0, caps_num * sizeof(char*));
+    return match;
+}
+
 STATIC mp_obj_t re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
     mp_obj_re_t *self = args[0];
     Subject subj;
     mp_uint_t len;
-    subj.begin = mp_obj_str_get_data(args[1], &len);
+    subj.begin = re_subject_data(args[1], &len);
     subj.end = subj.begin + len;
     int caps_num = (self->re.sub + 1) * 2;
-    mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
-    // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
-    memset((char*)match->caps, 0, caps_num * sizeof(char*));
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    mp_obj_match_t *match = re_new_match(args[1], caps_num);
+    int res = re_exec_from(self, &subj, subj.begin, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char*, caps_num, match);
         return mp_const_none;
     }
-
-    match->base.type = &match_type;
-    match->num_matches = caps_num / 2; // caps_num counts start and end pointers
-    match->str = args[1];
     return match;
 }
 
@@ -129,7 +251,7 @@ STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
     mp_obj_re_t *self = args[0];
     Subject subj;
     mp_uint_t len;
-    subj.begin = mp_obj_str_get_data(args[1], &len);
+    subj.begin = re_subject_data(args[1], &len);
     subj.end = subj.begin + len;
     int caps_num = (self->re.sub + 1) * 2;
 
@@ -140,37 +262,230 @@ STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
 
     mp_obj_t retval = mp_obj_new_list(0, NULL);
     const char **caps = alloca(caps_num * sizeof(char*));
+    // the subject is kept whole, each search continues from the last match
+    const char *piece = subj.begin;
     while (true) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char**)caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = re_exec_from(self, &subj, piece, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
             break;
         }
 
-        mp_obj_t s = mp_obj_new_str(subj.begin, caps[0] - subj.begin, false);
+        mp_obj_t s = mp_obj_new_str(piece, caps[0] - piece, false);
         mp_obj_list_append(retval, s);
         if (self->re.sub > 0) {
             mp_not_implemented("Splitting with sub-captures");
         }
-        subj.begin = caps[1];
+        piece = caps[1];
         if (maxsplit > 0 && --maxsplit == 0) {
             break;
         }
     }
 
-    mp_obj_t s = mp_obj_new_str(subj.begin, subj.end - subj.begin, false);
+    mp_obj_t s = mp_obj_new_str(piece, subj.end - piece, false);
     mp_obj_list_append(retval, s);
     return retval;
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_split_obj, 2, 3, re_split);
 
+#if MICROPY_PY_URE_SUB
+
+// After an empty match at sp, where the next search starts so that it makes
+// progress; str subjects are stepped a whole character at a time.
+STATIC const char *re_step_over(mp_obj_t str, const char *sp, const char *end) {
+    (void)str;
+    sp++;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE
+    if (MP_OBJ_IS_STR(str)) {
+        while (sp < end && UTF8_IS_CONT(*sp)) {
+            sp++;
+        }
+    }
+    #else
+    (void)end;
+    #endif
+    return sp;
+}
+
+// Append repl to vstr, with \N and \g<N> replaced by the groups in caps
+STATIC void re_sub_expand(vstr_t *vstr, const char *repl, mp_uint_t repl_len, const char **caps, int num_groups) {
+    const char *top = repl + repl_len;
+    while (repl < top) {
+        const char *lit = repl;
+        while (repl < top && *repl != '\\') {
+            repl++;
+        }
+        vstr_add_strn(vstr, lit, repl - lit);
+        if (repl + 1 >= top) {
+            // no escape, or a trailing backslash which is kept as is
+            vstr_add_strn(vstr, repl, top - repl);
+            break;
+        }
+
+        repl++;
+        mp_int_t no = -1;
+        char c = *repl++;
+        if (unichar_isdigit(c)) {
+            no = c - '0';
+        } else if (c == 'g' && repl < top && *repl == '<') {
+            const char *p = ++repl;
+            for (no = 0; p < top && unichar_isdigit(*p); p++) {
+                no = no * 10 + *p - '0';
+            }
+            if (p == repl || p == top || *p != '>') {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad group reference"));
+            }
+            repl = p + 1;
+        } else if (c == 'n') {
+            vstr_add_byte(vstr, '\n');
+        } else if (c == 'r') {
+            vstr_add_byte(vstr, '\r');
+        } else if (c == 't') {
+            vstr_add_byte(vstr, '\t');
+        } else if (c == '\\') {
+            vstr_add_byte(vstr, '\\');
+        } else {
+            vstr_add_byte(vstr, '\\');
+            vstr_add_byte(vstr, c);
+        }
+
+        if (no >= 0) {
+            if (no >= num_groups) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid group reference"));
+            }
+            const char *start = caps[no * 2];
+            if (start != NULL) {
+                vstr_add_strn(vstr, start, caps[no * 2 + 1] - start);
+            }
+        }
+    }
+}
+
+// sub(repl, string, count=0)
+// The result is written through one vstr, the pieces between matches are
+// copied straight from the subject; a match object is only made if repl is
+// callable.
+STATIC mp_obj_t re_sub_helper(mp_obj_re_t *self, mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t repl = args[0];
+    mp_obj_t str = args[1];
+    mp_int_t count = 0;
+    if (n_args > 2) {
+        count = mp_obj_get_int(args[2]);
+    }
+
+    Subject subj;
+    mp_uint_t len;
+    subj.begin = re_subject_data(str, &len);
+    subj.end = subj.begin + len;
+    int caps_num = (self->re.sub + 1) * 2;
+    const char **caps = alloca(caps_num * sizeof(char*));
+
+    const char *repl_str = NULL;
+    mp_uint_t repl_len = 0;
+    if (!mp_obj_is_callable(repl)) {
+        repl_str = mp_obj_str_get_data(repl, &repl_len);
+    }
+
+    vstr_t vstr;
+    vstr_init(&vstr, len + 16);
+    const char *sp = subj.begin;
+    const char *copied = subj.begin;
+    for (mp_int_t n = 0; (count == 0 || n < count) && sp <= subj.end; n++) {
+        // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+        memset((char**)caps, 0, caps_num * sizeof(char*));
+        if (!re_exec_from(self, &subj, sp, caps, caps_num, false)) {
+            break;
+        }
+
+        vstr_add_strn(&vstr, copied, caps[0] - copied);
+        if (repl_str != NULL) {
+            re_sub_expand(&vstr, repl_str, repl_len, caps, caps_num / 2);
+        } else {
+            mp_obj_match_t *match = re_new_match(str, caps_num);
+            memcpy((char**)match->caps, caps, caps_num * sizeof(char*));
+            mp_uint_t res_len;
+            const char *res = mp_obj_str_get_data(mp_call_function_1(repl, match), &res_len);
+            vstr_add_strn(&vstr, res, res_len);
+        }
+
+        copied = sp = caps[1];
+        if (caps[0] == caps[1]) {
+            sp = re_step_over(str, sp, subj.end);
+        }
+    }
+    vstr_add_strn(&vstr, copied, subj.end - copied);
+
+    return mp_obj_new_str_from_vstr(MP_OBJ_IS_STR_OR_BYTES(str) ? mp_obj_get_type(str) : &mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t re_sub(mp_uint_t n_args, const mp_obj_t *args) {
+    return re_sub_helper(args[0], n_args - 1, args + 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_sub_obj, 3, 4, re_sub);
+
+typedef struct _mp_obj_re_finditer_t {
+    mp_obj_base_t base;
+    mp_obj_re_t *re;
+    mp_obj_t str;
+    mp_uint_t pos; // where the next search starts, past the end when finished
+} mp_obj_re_finditer_t;
+
+STATIC mp_obj_t re_finditer_iternext(mp_obj_t self_in) {
+    mp_obj_re_finditer_t *self = self_in;
+    Subject subj;
+    mp_uint_t len;
+    subj.begin = re_subject_data(self->str, &len);
+    subj.end = subj.begin + len;
+    if (self->pos > len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+
+    int caps_num = (self->re->re.sub + 1) * 2;
+    mp_obj_match_t *match = re_new_match(self->str, caps_num);
+    if (!re_exec_from(self->re, &subj, subj.begin + self->pos, match->caps, caps_num, false)) {
+        m_del_var(mp_obj_match_t, char*, caps_num, match);
+        self->pos = len + 1;
+        return MP_OBJ_STOP_ITERATION;
+    }
+
+    const char *sp = match->caps[1];
+    if (match->caps[0] == sp) {
+        sp = re_step_over(self->str, sp, subj.end);
+    }
+    self->pos = sp - subj.begin;
+    return match;
+}
+
+STATIC const mp_obj_type_t re_finditer_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = re_finditer_iternext,
+};
+
+STATIC mp_obj_t re_finditer(mp_obj_t self_in, mp_obj_t str) {
+    mp_obj_re_finditer_t *o = m_new_obj(mp_obj_re_finditer_t);
+    o->base.type = &re_finditer_type;
+    o->re = self_in;
+    o->str = str;
+    o->pos = 0;
+    return o;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(re_finditer_obj, re_finditer);
+
+#endif
+
 STATIC const mp_map_elem_t re_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_match), (mp_obj_t) &re_match_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_search), (mp_obj_t) &re_search_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_split), (mp_obj_t) &re_split_obj },
+    #if MICROPY_PY_URE_SUB
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub), (mp_obj_t) &re_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_finditer), (mp_obj_t) &re_finditer_obj },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(re_locals_dict, re_locals_dict_table);
@@ -182,6 +497,77 @@ STATIC const mp_obj_type_t re_type = {
     .locals_dict = (mp_obj_t)&re_locals_dict,
 };
 
+// Add to first the bytes a match can start with, following the code from pc.
+// Returns false if a match can start without consuming a byte, in which case
+// nothing can be skipped.
+STATIC bool re_first_set(const char *code, int pc, byte *visited, byte *first) {
+    for (;;) {
+        if (visited[pc]) {
+            // already followed from here
+            return true;
+        }
+        visited[pc] = 1;
+        switch (code[pc]) {
+            case Char:
+                first[(byte)code[pc + 1] >> 3] |= 1 << (code[pc + 1] & 7);
+                return true;
+            case Class:
+            case ClassNot:
+            case NamedClass:
+                for (int i = 0; i < 256; i++) {
+                    char c = i;
+                    int m;
+                    if (code[pc] == NamedClass) {
+                        m = _re1_5_namedclassmatch(code + pc + 1, &c);
+                    } else {
+                        m = _re1_5_classmatch(code + pc + 1, &c);
+                    }
+                    if (m) {
+                        first[i >> 3] |= 1 << (i & 7);
+                    }
+                }
+                return true;
+            case Bol:
+                pc++;
+                break;
+            case Jmp:
+                pc += 2 + (signed char)code[pc + 1];
+                break;
+            case Split:
+            case RSplit:
+                if (!re_first_set(code, pc + 2, visited, first)) {
+                    return false;
+                }
+                pc += 2 + (signed char)code[pc + 1];
+                break;
+            case Save:
+                pc += 2;
+                break;
+            default:
+                // Any, Eol, Match
+                return false;
+        }
+    }
+}
+
+STATIC void re_analyse(mp_obj_re_t *self) {
+    const char *code = self->re.insts;
+    int pc = NON_ANCHORED_PREFIX;
+
+    // literal prefix: the Char instructions that directly follow Save 0
+    self->prefix_len = 0;
+    if (code[pc] == Save) {
+        for (int i = pc + 2; code[i] == Char && self->prefix_len < RE_PREFIX_MAX; i += 2) {
+            self->prefix[self->prefix_len++] = code[i + 1];
+        }
+    }
+
+    byte *visited = alloca(self->re.bytelen);
+    memset(visited, 0, self->re.bytelen);
+    memset(self->first, 0, sizeof(self->first));
+    self->has_first = re_first_set(code, pc, visited, self->first);
+}
+
 STATIC mp_obj_t mod_re_compile(uint n_args, const mp_obj_t *args) {
     const char *re_str = mp_obj_str_get_str(args[0]);
     int size = re1_5_sizecode(re_str);
@@ -195,6 +581,7 @@ STATIC mp_obj_t mod_re_compile(uint n_args, const mp_obj_t *args) {
     if (error != 0) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Error in regex"));
     }
+    re_analyse(o);
     if (flags & FLAG_DEBUG) {
         re1_5_dumpcode(&o->re);
     }
@@ -221,11 +608,28 @@ STATIC mp_obj_t mod_re_search(uint n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
+#if MICROPY_PY_URE_SUB
+STATIC mp_obj_t mod_re_sub(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_re_t *self = mod_re_compile(1, args);
+    return re_sub_helper(self, n_args - 1, args + 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_sub_obj, 3, 4, mod_re_sub);
+
+STATIC mp_obj_t mod_re_finditer(mp_obj_t pattern, mp_obj_t str) {
+    return re_finditer(mod_re_compile(1, &pattern), str);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_re_finditer_obj, mod_re_finditer);
+#endif
+
 STATIC const mp_map_elem_t mp_module_re_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ure) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_compile), (mp_obj_t)&mod_re_compile_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_match), (mp_obj_t)&mod_re_match_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_search), (mp_obj_t)&mod_re_search_obj },
+    #if MICROPY_PY_URE_SUB
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub), (mp_obj_t)&mod_re_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_finditer), (mp_obj_t)&mod_re_finditer_obj },
+    #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_DEBUG), MP_OBJ_NEW_SMALL_INT(FLAG_DEBUG) },
 };
 
@@ -0,0 +1,210 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_URINGBUF
+
+// A byte ring buffer with a fixed backing store, for passing data from an
+// IRQ handler to the main task (or the other way) without using the heap.
+// It is lock-free for a single producer and a single consumer: only the
+// producer moves head and only the consumer moves tail.  One byte of the
+// store is kept free to tell a full buffer from an empty one.
+
+typedef struct _mp_obj_ringbuf_t {
+    mp_obj_base_t base;
+    mp_obj_t store_obj; // keeps the backing store alive
+    volatile byte *store;
+    mp_uint_t size;
+    volatile mp_uint_t head; // next byte to write
+    volatile mp_uint_t tail; // next byte to read
+} mp_obj_ringbuf_t;
+
+STATIC mp_uint_t ringbuf_avail(mp_obj_ringbuf_t *self) {
+    mp_uint_t head = self->head;
+    mp_uint_t tail = self->tail;
+    return head >= tail ? head - tail : self->size - tail + head;
+}
+
+STATIC mp_uint_t ringbuf_free(mp_obj_ringbuf_t *self) {
+    return self->size - 1 - ringbuf_avail(self);
+}
+
+// RingBuffer(size) allocates a store for size bytes; RingBuffer(buf) uses the
+// given writable buffer, of which len(buf) - 1 bytes can be held
+STATIC mp_obj_t ringbuf_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_obj_ringbuf_t *o = m_new_obj(mp_obj_ringbuf_t);
+    o->base.type = type_in;
+    if (MP_OBJ_IS_INT(args[0])) {
+        mp_int_t size = mp_obj_get_int(args[0]);
+        if (size <= 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "size must be positive"));
+        }
+        o->store_obj = mp_obj_new_bytearray_by_ref(size + 1, m_new(byte, size + 1));
+    } else {
+        o->store_obj = args[0];
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(o->store_obj, &bufinfo, MP_BUFFER_RW);
+    if (bufinfo.len < 2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+    o->store = bufinfo.buf;
+    o->size = bufinfo.len;
+    o->head = 0;
+    o->tail = 0;
+    return o;
+}
+
+// put(byte): add a byte, returning False if the buffer is full
+STATIC mp_obj_t ringbuf_put(mp_obj_t self_in, mp_obj_t byte_in) {
+    mp_obj_ringbuf_t *self = self_in;
+    mp_uint_t head = self->head;
+    mp_uint_t next = head + 1 == self->size ? 0 : head + 1;
+    if (next == self->tail) {
+        return mp_const_false;
+    }
+    self->store[head] = mp_obj_get_int(byte_in);
+    self->head = next;
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ringbuf_put_obj, ringbuf_put);
+
+// get(): remove and return a byte, or -1 if the buffer is empty
+STATIC mp_obj_t ringbuf_get(mp_obj_t self_in) {
+    mp_obj_ringbuf_t *self = self_in;
+    mp_uint_t tail = self->tail;
+    if (tail == self->head) {
+        return MP_OBJ_NEW_SMALL_INT(-1);
+    }
+    byte b = self->store[tail];
+    self->tail = tail + 1 == self->size ? 0 : tail + 1;
+    return MP_OBJ_NEW_SMALL_INT(b);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ringbuf_get_obj, ringbuf_get);
+
+// write(buf): add as many bytes from buf as fit, returning how many did
+STATIC mp_obj_t ringbuf_write(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_ringbuf_t *self = self_in;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    mp_uint_t n = MIN(bufinfo.len, ringbuf_free(self));
+    mp_uint_t head = self->head;
+    const byte *src = bufinfo.buf;
+    for (mp_uint_t i = 0; i < n; i++) {
+        self->store[head] = src[i];
+        if (++head == self->size) {
+            head = 0;
+        }
+    }
+    self->head = head;
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ringbuf_write_obj, ringbuf_write);
+
+// readinto(buf[, nbytes]): remove up to nbytes (default len(buf)) bytes into
+// buf, returning how many were read
+STATIC mp_obj_t ringbuf_readinto(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_ringbuf_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t n = bufinfo.len;
+    if (n_args == 3) {
+        n = MIN(n, (mp_uint_t)mp_obj_get_int(args[2]));
+    }
+    n = MIN(n, ringbuf_avail(self));
+    mp_uint_t tail = self->tail;
+    byte *dest = bufinfo.buf;
+    for (mp_uint_t i = 0; i < n; i++) {
+        dest[i] = self->store[tail];
+        if (++tail == self->size) {
+            tail = 0;
+        }
+    }
+    self->tail = tail;
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ringbuf_readinto_obj, 2, 3, ringbuf_readinto);
+
+// any(): number of bytes waiting to be read
+STATIC mp_obj_t ringbuf_any(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(ringbuf_avail(self_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ringbuf_any_obj, ringbuf_any);
+
+// free(): number of bytes that can be added before the buffer is full
+STATIC mp_obj_t ringbuf_free_fun(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(ringbuf_free(self_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ringbuf_free_obj, ringbuf_free_fun);
+
+STATIC mp_obj_t ringbuf_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_ringbuf_t *self = self_in;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(ringbuf_avail(self) != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(ringbuf_avail(self));
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC const mp_map_elem_t ringbuf_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_put), (mp_obj_t)&ringbuf_put_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get), (mp_obj_t)&ringbuf_get_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&ringbuf_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&ringbuf_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_any), (mp_obj_t)&ringbuf_any_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_free), (mp_obj_t)&ringbuf_free_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(ringbuf_locals_dict, ringbuf_locals_dict_table);
+
+STATIC const mp_obj_type_t ringbuf_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_RingBuffer,
+    .make_new = ringbuf_make_new,
+    .unary_op = ringbuf_unary_op,
+    .locals_dict = (mp_obj_t)&ringbuf_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_uringbuf_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uringbuf) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RingBuffer), (mp_obj_t)&ringbuf_type },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_uringbuf_globals, mp_module_uringbuf_globals_table);
+
+const mp_obj_module_t mp_module_uringbuf = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_uringbuf,
+    .globals = (mp_obj_dict_t*)&mp_module_uringbuf_globals,
+};
+
+#endif // MICROPY_PY_URINGBUF
@@ -0,0 +1,140 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/nlr.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+#include "py/objtype.h"
+#include "py/gc.h"
+
+#if MICROPY_PY_UWEAKREF
+
+// A weak reference, cleared by the GC once its target is unreachable.  The
+// target is hidden from the GC (see gc_weak_register), and is 0 when dead.
+// Only objects that can be freed by a collection and outlive a call can be
+// targets: instances of user classes, functions and classes.
+
+typedef struct _mp_obj_weakref_t {
+    mp_obj_base_t base;
+    mp_uint_t target;
+    mp_obj_t callback;
+} mp_obj_weakref_t;
+
+STATIC bool weakref_is_target(mp_obj_t obj) {
+    if (!MP_OBJ_IS_OBJ(obj)) {
+        return false;
+    }
+    mp_obj_type_t *type = mp_obj_get_type(obj);
+    return mp_obj_is_instance_type(type) || type == &mp_type_fun_bc || type == &mp_type_type;
+}
+
+// ref(obj[, callback]): the callback is called with the weak reference, after
+// the collection that clears it, if the weak reference is still alive then
+STATIC mp_obj_t weakref_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    if (!weakref_is_target(args[0])) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+            "cannot create weak reference to '%s' object", mp_obj_get_type_str(args[0])));
+    }
+    mp_obj_weakref_t *o;
+    if (n_args == 2 && args[1] != mp_const_none) {
+        // the finaliser is what calls the callback
+        o = m_new_obj_with_finaliser(mp_obj_weakref_t);
+        o->callback = args[1];
+    } else {
+        o = m_new_obj(mp_obj_weakref_t);
+        o->callback = mp_const_none;
+    }
+    o->base.type = type_in;
+    o->target = GC_WEAK_HIDE(args[0]);
+    gc_weak_register(o);
+    return o;
+}
+
+STATIC mp_obj_t weakref_get(mp_obj_weakref_t *self) {
+    if (self->target == 0) {
+        return mp_const_none;
+    }
+    return GC_WEAK_REVEAL(self->target);
+}
+
+STATIC void weakref_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_t target = weakref_get(self_in);
+    if (target == mp_const_none) {
+        mp_printf(print, "<weakref; dead>");
+    } else {
+        mp_printf(print, "<weakref; to '%s'>", mp_obj_get_type_str(target));
+    }
+}
+
+// calling a weak reference returns its target, or None if it's dead
+STATIC mp_obj_t weakref_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    (void)args;
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    return weakref_get(self_in);
+}
+
+STATIC mp_obj_t weakref_del(mp_obj_t self_in) {
+    mp_obj_weakref_t *self = self_in;
+    mp_obj_t callback = self->callback;
+    if (self->target == 0 && callback != mp_const_none) {
+        self->callback = mp_const_none;
+        mp_call_function_1(callback, self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(weakref_del_obj, weakref_del);
+
+STATIC const mp_map_elem_t weakref_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__), (mp_obj_t)&weakref_del_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(weakref_locals_dict, weakref_locals_dict_table);
+
+STATIC const mp_obj_type_t weakref_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_ref,
+    .print = weakref_print,
+    .make_new = weakref_make_new,
+    .call = weakref_call,
+    .locals_dict = (mp_obj_t)&weakref_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_uweakref_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uweakref) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ref), (mp_obj_t)&weakref_type },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_uweakref_globals, mp_module_uweakref_globals_table);
+
+const mp_obj_module_t mp_module_uweakref = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_uweakref,
+    .globals = (mp_obj_dict_t*)&mp_module_uweakref_globals,
+};
+
+#endif // MICROPY_PY_UWEAKREF
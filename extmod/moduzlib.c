@@ -25,9 +25,11 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/stream.h"
 
 #if MICROPY_PY_UZLIB
 
@@ -63,6 +65,7 @@ STATIC mp_obj_t mod_uzlib_decompress(mp_uint_t n_args, const mp_obj_t *args) {
     DEBUG_printf("uzlib: Initial out buffer: " UINT_FMT " bytes\n", decomp->destSize);
     decomp->destGrow = mod_uzlib_grow_buf;
     decomp->source = bufinfo.buf;
+    decomp->readSource = NULL;
 
     int st;
     if (n_args > 1 && MP_OBJ_SMALL_INT_VALUE(args[1]) < 0) {
@@ -83,9 +86,318 @@ STATIC mp_obj_t mod_uzlib_decompress(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+// the running value for crc32/adler32 may be any int; only its low 32 bits matter
+STATIC uint32_t mod_uzlib_get_checksum(mp_obj_t value_in) {
+    if (MP_OBJ_IS_INT(value_in)) {
+        return mp_obj_int_get_truncated(value_in);
+    }
+    return mp_obj_get_int(value_in);
+}
+
+// crc32(data[, value]) continues the checksum from value (default 0), so
+// it can be updated incrementally over several buffers or memoryviews
+STATIC mp_obj_t mod_uzlib_crc32(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    uint32_t crc = n_args > 1 ? mod_uzlib_get_checksum(args[1]) : 0;
+    const byte *buf = bufinfo.buf;
+    mp_uint_t len = bufinfo.len;
+    #ifdef MICROPY_PY_UZLIB_CRC32_HW_FUNC
+    // the port's CRC unit takes whole words; the tail is done in software
+    if (len >= 4) {
+        crc = MICROPY_PY_UZLIB_CRC32_HW_FUNC(crc, buf, len & ~3);
+        buf += len & ~3;
+        len &= 3;
+    }
+    #endif
+    return mp_obj_new_int_from_uint(tinf_crc32_update(crc, buf, len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_crc32_obj, 1, 2, mod_uzlib_crc32);
+
+// adler32(data[, value]) continues the checksum from value (default 1)
+STATIC mp_obj_t mod_uzlib_adler32(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    uint32_t adler = n_args > 1 ? mod_uzlib_get_checksum(args[1]) : 1;
+    return mp_obj_new_int_from_uint(tinf_adler32_update(adler, bufinfo.buf, bufinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_adler32_obj, 1, 2, mod_uzlib_adler32);
+
+#if MICROPY_PY_UZLIB_COMPRESS
+
+// The compressor needs 5 << wbits bytes for its window and hash tables, so
+// the default window is kept small; wbits can be given up to 15.
+#define UZLIB_COMPRESS_WBITS_DEFAULT (10)
+
+typedef struct _mp_obj_compress_t {
+    mp_obj_base_t base;
+    TDEFL_DATA comp;
+} mp_obj_compress_t;
+
+STATIC int mod_uzlib_comp_grow_buf(TDEFL_DATA *d, unsigned alloc_req) {
+    if (alloc_req < 64) {
+        alloc_req = 64;
+    }
+    d->destStart = m_renew(byte, d->destStart, d->destSize, d->destSize + alloc_req);
+    d->destSize += alloc_req;
+    return 0;
+}
+
+STATIC void mod_uzlib_comp_init(TDEFL_DATA *comp, mp_int_t wbits) {
+    mp_int_t abs_wbits = wbits < 0 ? -wbits : wbits;
+    if (abs_wbits < TDEFL_WBITS_MIN || abs_wbits > TDEFL_WBITS_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid wbits"));
+    }
+    comp->window = m_new(byte, 2 << abs_wbits);
+    comp->head = m_new(unsigned short, 1 << TDEFL_HASH_BITS(abs_wbits));
+    comp->prev = m_new(unsigned short, 1 << abs_wbits);
+    comp->destGrow = mod_uzlib_comp_grow_buf;
+    comp->destStart = NULL;
+    comp->destSize = 0;
+    comp->dest = NULL;
+    comp->destRemaining = 0;
+    tdefl_init(comp, wbits);
+}
+
+STATIC void mod_uzlib_comp_deinit(TDEFL_DATA *comp) {
+    m_del(byte, comp->window, 2 << comp->wbits);
+    m_del(unsigned short, comp->head, 1 << comp->hashBits);
+    m_del(unsigned short, comp->prev, 1 << comp->wbits);
+    comp->window = NULL;
+}
+
+// hand the output produced so far over to a new bytes object
+STATIC mp_obj_t mod_uzlib_comp_take_output(TDEFL_DATA *comp) {
+    vstr_t vstr;
+    vstr.buf = (char*)comp->destStart;
+    vstr.alloc = comp->destSize;
+    vstr.len = comp->dest - comp->destStart;
+    vstr.fixed_buf = false;
+    comp->destStart = NULL;
+    comp->destSize = 0;
+    comp->dest = NULL;
+    comp->destRemaining = 0;
+    if (vstr.buf == NULL) {
+        return mp_const_empty_bytes;
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+// compress(data, level=-1, wbits=10)
+// level is accepted for compatibility, but there is only one strategy
+STATIC mp_obj_t mod_uzlib_compress(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_level, MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_wbits, MP_ARG_INT, {.u_int = UZLIB_COMPRESS_WBITS_DEFAULT} },
+    };
+    mp_arg_val_t vals[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, vals);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    TDEFL_DATA *comp = m_new_obj(TDEFL_DATA);
+    mod_uzlib_comp_init(comp, vals[1].u_int);
+    tdefl_compress(comp, bufinfo.buf, bufinfo.len);
+    tdefl_finish(comp);
+    mod_uzlib_comp_deinit(comp);
+    mp_obj_t res = mod_uzlib_comp_take_output(comp);
+    m_del_obj(TDEFL_DATA, comp);
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uzlib_compress_obj, 1, mod_uzlib_compress);
+
+STATIC mp_obj_compress_t *mod_uzlib_get_compress(mp_obj_t self_in) {
+    mp_obj_compress_t *self = self_in;
+    if (self->comp.window == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "compressor is finished"));
+    }
+    return self;
+}
+
+STATIC mp_obj_t compress_compress(mp_obj_t self_in, mp_obj_t data) {
+    mp_obj_compress_t *self = mod_uzlib_get_compress(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    tdefl_compress(&self->comp, bufinfo.buf, bufinfo.len);
+    return mod_uzlib_comp_take_output(&self->comp);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(compress_compress_obj, compress_compress);
+
+STATIC mp_obj_t compress_flush(mp_uint_t n_args, const mp_obj_t *args) {
+    // the mode argument is accepted, but the stream is always finished
+    (void)n_args;
+    mp_obj_compress_t *self = mod_uzlib_get_compress(args[0]);
+    tdefl_finish(&self->comp);
+    mod_uzlib_comp_deinit(&self->comp);
+    return mod_uzlib_comp_take_output(&self->comp);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compress_flush_obj, 1, 2, compress_flush);
+
+STATIC const mp_map_elem_t compress_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compress), (mp_obj_t)&compress_compress_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_flush), (mp_obj_t)&compress_flush_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compress_locals_dict, compress_locals_dict_table);
+
+STATIC const mp_obj_type_t compress_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Compress,
+    .locals_dict = (mp_obj_t)&compress_locals_dict,
+};
+
+// compressobj(level=-1, method=DEFLATED, wbits=10)
+STATIC mp_obj_t mod_uzlib_compressobj(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_level, MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_method, MP_ARG_INT, {.u_int = 8} },
+        { MP_QSTR_wbits, MP_ARG_INT, {.u_int = UZLIB_COMPRESS_WBITS_DEFAULT} },
+    };
+    mp_arg_val_t vals[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, vals);
+    if (vals[1].u_int != 8) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid method"));
+    }
+
+    mp_obj_compress_t *o = m_new_obj(mp_obj_compress_t);
+    o->base.type = &compress_type;
+    mod_uzlib_comp_init(&o->comp, vals[2].u_int);
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uzlib_compressobj_obj, 0, mod_uzlib_compressobj);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
+#if MICROPY_PY_UZLIB_DECOMPIO
+
+// compressed data is read from the source stream in chunks of this size
+#define UZLIB_DECOMPIO_BUF_SIZE (64)
+
+typedef struct _mp_obj_decompio_t {
+    mp_obj_base_t base;
+    mp_obj_t src_stream;
+    TINF_DATA decomp;
+    bool zlib;
+    bool eof;
+    byte buf[UZLIB_DECOMPIO_BUF_SIZE];
+} mp_obj_decompio_t;
+
+STATIC int mod_uzlib_read_src_stream(TINF_DATA *data) {
+    mp_obj_decompio_t *o = (mp_obj_decompio_t*)((byte*)data - offsetof(mp_obj_decompio_t, decomp));
+    const mp_stream_p_t *stream_p = mp_obj_get_type(o->src_stream)->stream_p;
+    int errcode;
+    mp_uint_t n = stream_p->read(o->src_stream, o->buf, sizeof(o->buf), &errcode);
+    if (n == MP_STREAM_ERROR) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+    }
+    if (n == 0) {
+        return -1;
+    }
+    data->source = o->buf + 1;
+    data->sourceLimit = o->buf + n;
+    return o->buf[0];
+}
+
+// DecompIO(stream, wbits=0)
+// wbits is 0 to use the window size from the zlib header, 8..15 to give the
+// largest window accepted, or -8..-15 for a raw deflate stream. Only the
+// window and a small input buffer are held, whatever the size of the data.
+STATIC mp_obj_t decompio_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    const mp_stream_p_t *stream_p = mp_obj_get_type(args[0])->stream_p;
+    if (stream_p == NULL || stream_p->read == NULL) {
+        // CPython: io.UnsupportedOperation, OSError subclass
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Operation not supported"));
+    }
+    mp_int_t wbits = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    if (wbits != 0 && (wbits < -15 || (wbits > -8 && wbits < 8) || wbits > 15)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid wbits"));
+    }
+
+    mp_obj_decompio_t *o = m_new_obj(mp_obj_decompio_t);
+    o->base.type = type_in;
+    o->src_stream = args[0];
+    o->zlib = wbits >= 0;
+    o->eof = false;
+    o->decomp.source = NULL;
+    o->decomp.sourceLimit = NULL;
+    o->decomp.readSource = mod_uzlib_read_src_stream;
+    o->decomp.eof = 0;
+
+    if (o->zlib) {
+        int hdr_wbits = tinf_zlib_parse_header(&o->decomp);
+        if (hdr_wbits < 0) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_ValueError, MP_OBJ_NEW_SMALL_INT(hdr_wbits)));
+        }
+        if (wbits != 0 && hdr_wbits > wbits) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "window too large"));
+        }
+        wbits = hdr_wbits;
+    } else {
+        wbits = -wbits;
+    }
+    tinf_uncompress_stream_init(&o->decomp, m_new(byte, 1 << wbits), wbits);
+    return o;
+}
+
+STATIC mp_uint_t decompio_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errcode) {
+    (void)errcode;
+    mp_obj_decompio_t *o = o_in;
+    if (o->eof) {
+        return 0;
+    }
+    o->decomp.dest = buf;
+    o->decomp.destRemaining = size;
+    int st;
+    if (o->zlib) {
+        st = tinf_zlib_uncompress_stream(&o->decomp);
+    } else {
+        st = tinf_uncompress_stream(&o->decomp);
+    }
+    if (st == TINF_DONE) {
+        o->eof = true;
+    } else if (st < 0) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_ValueError, MP_OBJ_NEW_SMALL_INT(st)));
+    }
+    return o->decomp.dest - (byte*)buf;
+}
+
+STATIC const mp_map_elem_t decompio_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&mp_stream_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&mp_stream_unbuffered_readline_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(decompio_locals_dict, decompio_locals_dict_table);
+
+STATIC const mp_stream_p_t decompio_stream_p = {
+    .read = decompio_read,
+};
+
+STATIC const mp_obj_type_t decompio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_DecompIO,
+    .make_new = decompio_make_new,
+    .stream_p = &decompio_stream_p,
+    .locals_dict = (mp_obj_t)&decompio_locals_dict,
+};
+
+#endif // MICROPY_PY_UZLIB_DECOMPIO
+
 STATIC const mp_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uzlib) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_decompress), (mp_obj_t)&mod_uzlib_decompress_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_crc32), (mp_obj_t)&mod_uzlib_crc32_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_adler32), (mp_obj_t)&mod_uzlib_adler32_obj },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compress), (mp_obj_t)&mod_uzlib_compress_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compressobj), (mp_obj_t)&mod_uzlib_compressobj_obj },
+    #endif
+    #if MICROPY_PY_UZLIB_DECOMPIO
+    { MP_OBJ_NEW_QSTR(MP_QSTR_DecompIO), (mp_obj_t)&decompio_type },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -102,5 +414,12 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinflate.c"
 #include "uzlib/tinfzlib.c"
 #include "uzlib/adler32.c"
+#if MICROPY_PY_UZLIB_CRC32_SLICE8
+#define TINF_CRC32_SLICE8
+#endif
+#include "uzlib/crc32.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/tdeflate.c"
+#endif
 
 #endif // MICROPY_PY_UZLIB
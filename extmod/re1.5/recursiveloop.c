@@ -82,3 +82,10 @@ re1_5_recursiveloopprog(ByteProg *prog, Subject *input, const char **subp, int n
 {
 	return recursiveloop(HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, input, subp, nsubp);
 }
+
+// Try to match at sp only, with the rest of input still visible to ^
+int
+re1_5_recursiveloopprog_at(ByteProg *prog, Subject *input, const char *sp, const char **subp, int nsubp)
+{
+	return recursiveloop(prog->insts + NON_ANCHORED_PREFIX, sp, input, subp, nsubp);
+}
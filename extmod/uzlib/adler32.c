@@ -42,11 +42,17 @@
 #define A32_NMAX 5552
 
 unsigned int tinf_adler32(const void *data, unsigned int length)
+{
+   return tinf_adler32_update(1, data, length);
+}
+
+/* continue a checksum from a previous result (start with 1) */
+unsigned int tinf_adler32_update(unsigned int adler, const void *data, unsigned int length)
 {
    const unsigned char *buf = (const unsigned char *)data;
 
-   unsigned int s1 = 1;
-   unsigned int s2 = 0;
+   unsigned int s1 = adler & 0xffff;
+   unsigned int s2 = adler >> 16;
 
    while (length > 0)
    {
@@ -0,0 +1,130 @@
+/*
+ * CRC32 checksum
+ *
+ * Copyright (c) 2003 by Joergen Ibsen / Jibz
+ * All Rights Reserved
+ *
+ * http://www.ibsensoftware.com/
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/*
+ * CRC32 algorithm taken from the zlib source, which is
+ * Copyright (C) 1995-1998 Jean-loup Gailly and Mark Adler
+ */
+
+#include "tinf.h"
+
+#define CRC32_POLY 0xedb88320
+
+#ifdef TINF_CRC32_SLICE8
+
+/* slicing-by-8: eight 256-entry tables (8 KiB), built on first use, let
+   the inner loop fold 8 bytes per iteration */
+
+static unsigned int tinf_crc32tab[8][256];
+static int tinf_crc32tab_built = 0;
+
+static void tinf_build_crc32tab(void)
+{
+   unsigned int i, k;
+
+   for (i = 0; i < 256; ++i)
+   {
+      unsigned int c = i;
+      for (k = 0; k < 8; ++k) c = (c >> 1) ^ (CRC32_POLY & -(c & 1));
+      tinf_crc32tab[0][i] = c;
+   }
+   for (i = 0; i < 256; ++i)
+   {
+      for (k = 1; k < 8; ++k)
+      {
+         unsigned int c = tinf_crc32tab[k - 1][i];
+         tinf_crc32tab[k][i] = (c >> 8) ^ tinf_crc32tab[0][c & 0xff];
+      }
+   }
+   tinf_crc32tab_built = 1;
+}
+
+/* continue a checksum from a previous result (start with 0) */
+unsigned int tinf_crc32_update(unsigned int crc, const void *data, unsigned int length)
+{
+   const unsigned char *buf = (const unsigned char *)data;
+
+   if (!tinf_crc32tab_built) tinf_build_crc32tab();
+
+   crc ^= 0xffffffff;
+
+   for (; length >= 8; length -= 8, buf += 8)
+   {
+      unsigned int one = crc ^ (buf[0] | buf[1] << 8 | buf[2] << 16 | (unsigned int)buf[3] << 24);
+      unsigned int two = buf[4] | buf[5] << 8 | buf[6] << 16 | (unsigned int)buf[7] << 24;
+      crc = tinf_crc32tab[7][one & 0xff] ^ tinf_crc32tab[6][(one >> 8) & 0xff]
+          ^ tinf_crc32tab[5][(one >> 16) & 0xff] ^ tinf_crc32tab[4][one >> 24]
+          ^ tinf_crc32tab[3][two & 0xff] ^ tinf_crc32tab[2][(two >> 8) & 0xff]
+          ^ tinf_crc32tab[1][(two >> 16) & 0xff] ^ tinf_crc32tab[0][two >> 24];
+   }
+
+   while (length--) crc = (crc >> 8) ^ tinf_crc32tab[0][(crc ^ *buf++) & 0xff];
+
+   return crc ^ 0xffffffff;
+}
+
+#else
+
+/* a 16-entry table, one lookup per nibble, for when code size matters */
+
+static const unsigned int tinf_crc32tab[16] = {
+   0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190,
+   0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344,
+   0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278,
+   0xbdbdf21c
+};
+
+/* continue a checksum from a previous result (start with 0) */
+unsigned int tinf_crc32_update(unsigned int crc, const void *data, unsigned int length)
+{
+   const unsigned char *buf = (const unsigned char *)data;
+   unsigned int i;
+
+   crc ^= 0xffffffff;
+
+   for (i = 0; i < length; ++i)
+   {
+      crc ^= buf[i];
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+   }
+
+   return crc ^ 0xffffffff;
+}
+
+#endif
+
+unsigned int tinf_crc32(const void *data, unsigned int length)
+{
+   return tinf_crc32_update(0, data, length);
+}
@@ -0,0 +1,302 @@
+/*
+ * tdeflate  -  tiny deflate
+ *
+ * Copyright (c) 2015 by Paul Sokolovsky
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/*
+ * A small streaming deflate compressor.  Matches are found with LZ77 over
+ * a sliding window of 2^wbits bytes, using hash chains of limited length,
+ * and are coded with the fixed Huffman codes of RFC 1951, so no code tables
+ * need to be built or stored.  All memory (window and hash tables) is
+ * provided by the caller.
+ */
+
+#include <string.h>
+#include "tinf.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+/* keep this much input ahead of the current position, so a match of the
+   longest length can always be checked */
+#define MIN_LOOKAHEAD (MAX_MATCH + MIN_MATCH + 1)
+/* candidates examined for each match */
+#define MAX_CHAIN 16
+/* a match of length 3 further away than this codes worse than literals */
+#define TOO_FAR 4096
+
+/* --------------------------------------------------- *
+ * -- static tables                                 -- *
+ * --------------------------------------------------- */
+
+static const unsigned short defl_length_base[29] = {
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const unsigned short defl_dist_base[30] = {
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+   8193, 12289, 16385, 24577
+};
+
+/* --------------------------------------------------- *
+ * -- bit output                                    -- *
+ * --------------------------------------------------- */
+
+static void tdefl_outbyte(TDEFL_DATA *d, unsigned char c)
+{
+   if (d->destRemaining == 0)
+   {
+      /* This will update only destStart and destSize */
+      unsigned int oldsize = d->dest - d->destStart;
+      d->destGrow(d, 1);
+      d->dest = d->destStart + oldsize;
+      d->destRemaining = d->destSize - oldsize;
+   }
+   *d->dest++ = c;
+   d->destRemaining--;
+}
+
+/* output bits, least significant first */
+static void tdefl_outbits(TDEFL_DATA *d, unsigned int bits, int num)
+{
+   d->bitbuf |= bits << d->bitcount;
+   d->bitcount += num;
+   while (d->bitcount >= 8)
+   {
+      tdefl_outbyte(d, d->bitbuf);
+      d->bitbuf >>= 8;
+      d->bitcount -= 8;
+   }
+}
+
+/* output a Huffman code, which is stored most significant bit first */
+static void tdefl_outcode(TDEFL_DATA *d, unsigned int code, int num)
+{
+   unsigned int rev = 0;
+   int i;
+   for (i = 0; i < num; ++i, code >>= 1) rev = (rev << 1) | (code & 1);
+   tdefl_outbits(d, rev, num);
+}
+
+/* output a literal/length symbol using the fixed code */
+static void tdefl_outsym(TDEFL_DATA *d, unsigned int sym)
+{
+   if (sym < 144) tdefl_outcode(d, 0x30 + sym, 8);
+   else if (sym < 256) tdefl_outcode(d, 0x190 + sym - 144, 9);
+   else if (sym < 280) tdefl_outcode(d, sym - 256, 7);
+   else tdefl_outcode(d, 0xc0 + sym - 280, 8);
+}
+
+static void tdefl_outmatch(TDEFL_DATA *d, unsigned int len, unsigned int dist)
+{
+   int i;
+
+   /* length: symbol 285 is the special code for 258 */
+   for (i = 28; defl_length_base[i] > len || (i == 28 && len != 258); --i) ;
+   tdefl_outsym(d, 257 + i);
+   if (i >= 8 && i < 28) tdefl_outbits(d, len - defl_length_base[i], (i >> 2) - 1);
+
+   /* distance */
+   for (i = 29; defl_dist_base[i] > dist; --i) ;
+   tdefl_outcode(d, i, 5);
+   if (i >= 4) tdefl_outbits(d, dist - defl_dist_base[i], (i >> 1) - 1);
+}
+
+/* --------------------------------------------------- *
+ * -- LZ77 matching                                 -- *
+ * --------------------------------------------------- */
+
+static unsigned int tdefl_hash(const TDEFL_DATA *d, const unsigned char *p)
+{
+   unsigned int v = ((unsigned int)p[0] << 16) | ((unsigned int)p[1] << 8) | p[2];
+   return (v * 2654435761u) >> (32 - d->hashBits);
+}
+
+/* make the string at pos findable; pos 0 doubles as the empty marker so is
+   never found, which costs nothing noticeable */
+static void tdefl_insert(TDEFL_DATA *d, unsigned int pos, unsigned int h)
+{
+   d->prev[pos & ((1u << d->wbits) - 1)] = d->head[h];
+   d->head[h] = pos;
+}
+
+/* drop the older half of the window, once the current position is in the
+   upper half and more room is needed for input */
+static void tdefl_slide(TDEFL_DATA *d)
+{
+   unsigned int wsize = 1u << d->wbits;
+   unsigned int i;
+   memcpy(d->window, d->window + wsize, wsize);
+   d->strstart -= wsize;
+   for (i = 0; i < (1u << d->hashBits); ++i)
+   {
+      d->head[i] = d->head[i] >= wsize ? d->head[i] - wsize : 0;
+   }
+   for (i = 0; i < wsize; ++i)
+   {
+      d->prev[i] = d->prev[i] >= wsize ? d->prev[i] - wsize : 0;
+   }
+}
+
+/* compress from strstart while enough lookahead is buffered, or until all
+   input is consumed if flushing */
+static void tdefl_process(TDEFL_DATA *d, int flush)
+{
+   const unsigned int max_dist = (1u << d->wbits) - MIN_LOOKAHEAD;
+   unsigned char *win = d->window;
+
+   while (d->lookahead >= MIN_LOOKAHEAD || (flush && d->lookahead > 0))
+   {
+      unsigned int s = d->strstart;
+      unsigned int best_len = 0;
+      unsigned int best_dist = 0;
+
+      if (d->lookahead >= MIN_MATCH)
+      {
+         unsigned int max_len = d->lookahead < MAX_MATCH ? d->lookahead : MAX_MATCH;
+         unsigned int h = tdefl_hash(d, win + s);
+         unsigned int cur = d->head[h];
+         int chain = MAX_CHAIN;
+
+         best_len = MIN_MATCH - 1;
+         while (cur != 0 && s - cur <= max_dist && chain-- > 0)
+         {
+            const unsigned char *m = win + cur;
+            const unsigned char *p = win + s;
+            if (m[best_len] == p[best_len] && m[0] == p[0] && m[1] == p[1])
+            {
+               unsigned int len = 2;
+               while (len < max_len && m[len] == p[len]) ++len;
+               if (len > best_len)
+               {
+                  best_len = len;
+                  best_dist = s - cur;
+                  if (len == max_len) break;
+               }
+            }
+            cur = d->prev[cur & ((1u << d->wbits) - 1)];
+         }
+         tdefl_insert(d, s, h);
+
+         if (best_len == MIN_MATCH && best_dist > TOO_FAR) best_len = 0;
+      }
+
+      if (best_len >= MIN_MATCH)
+      {
+         unsigned int i;
+         tdefl_outmatch(d, best_len, best_dist);
+         for (i = 1; i < best_len; ++i)
+         {
+            if (i + MIN_MATCH <= d->lookahead)
+            {
+               tdefl_insert(d, s + i, tdefl_hash(d, win + s + i));
+            }
+         }
+         d->strstart += best_len;
+         d->lookahead -= best_len;
+      } else {
+         tdefl_outsym(d, win[s]);
+         d->strstart += 1;
+         d->lookahead -= 1;
+      }
+   }
+}
+
+/* --------------------------------------------------- *
+ * -- public functions                              -- *
+ * --------------------------------------------------- */
+
+/* The caller sets up the output buffer (destGrow is required), the window
+   of 2 << |wbits| bytes, head of 1 << TDEFL_HASH_BITS(|wbits|) entries and
+   prev of 1 << |wbits| entries.  A negative wbits gives a raw deflate
+   stream, otherwise a zlib stream is made. */
+void tdefl_init(TDEFL_DATA *d, int wbits)
+{
+   d->raw = wbits < 0;
+   d->wbits = wbits < 0 ? -wbits : wbits;
+   d->hashBits = TDEFL_HASH_BITS(d->wbits);
+   d->bitbuf = 0;
+   d->bitcount = 0;
+   d->adler = 1;
+   d->strstart = 0;
+   d->lookahead = 0;
+   memset(d->head, 0, sizeof(*d->head) << d->hashBits);
+   memset(d->prev, 0, sizeof(*d->prev) << d->wbits);
+
+   if (!d->raw)
+   {
+      /* CMF: deflate with window size; FLG: check bits only */
+      unsigned int cmf = ((d->wbits - 8) << 4) | 8;
+      tdefl_outbyte(d, cmf);
+      tdefl_outbyte(d, 31 - (cmf << 8) % 31);
+   }
+
+   /* one fixed Huffman block, not final; tdefl_finish adds the final one */
+   tdefl_outbits(d, 2, 3);
+}
+
+void tdefl_compress(TDEFL_DATA *d, const void *source, unsigned int sourceLen)
+{
+   const unsigned char *src = (const unsigned char *)source;
+   unsigned int wsize2 = 2u << d->wbits;
+
+   if (!d->raw) d->adler = tinf_adler32_update(d->adler, src, sourceLen);
+
+   while (sourceLen > 0)
+   {
+      unsigned int n;
+      if (d->strstart + d->lookahead == wsize2) tdefl_slide(d);
+      n = wsize2 - (d->strstart + d->lookahead);
+      if (n > sourceLen) n = sourceLen;
+      memcpy(d->window + d->strstart + d->lookahead, src, n);
+      d->lookahead += n;
+      src += n;
+      sourceLen -= n;
+      tdefl_process(d, 0);
+   }
+}
+
+void tdefl_finish(TDEFL_DATA *d)
+{
+   tdefl_process(d, 1);
+
+   /* end of block, then an empty final fixed block */
+   tdefl_outsym(d, 256);
+   tdefl_outbits(d, 3, 3);
+   tdefl_outsym(d, 256);
+   if (d->bitcount > 0) tdefl_outbits(d, 0, 8 - d->bitcount);
+
+   if (!d->raw)
+   {
+      tdefl_outbyte(d, d->adler >> 24);
+      tdefl_outbyte(d, d->adler >> 16);
+      tdefl_outbyte(d, d->adler >> 8);
+      tdefl_outbyte(d, d->adler);
+   }
+}
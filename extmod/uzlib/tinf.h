@@ -27,6 +27,7 @@ extern "C" {
 #endif
 
 #define TINF_OK             0
+#define TINF_DONE           1
 #define TINF_DATA_ERROR    (-3)
 #define TINF_DEST_OVERFLOW (-4)
 
@@ -59,6 +60,28 @@ typedef struct TINF_DATA {
 
    TINF_TREE ltree; /* dynamic length/symbol tree */
    TINF_TREE dtree; /* dynamic distance tree */
+
+    /* The rest is used only by the streaming API. When source reaches
+       sourceLimit, readSource is called; it should set up new source and
+       sourceLimit and return the next byte, or -1 at the end of input.
+       Must be NULL for the buffer-based API. */
+    const unsigned char *sourceLimit;
+    int (*readSource)(struct TINF_DATA *data);
+    int eof;
+
+    /* state of the current block, kept between calls */
+    int bfinal;
+    int btype;           /* -1 when between blocks */
+    unsigned int curlen; /* bytes left of a match or a stored block */
+    unsigned int lzOff;  /* distance of the current match */
+
+    /* ring buffer of the last (dictMask + 1) output bytes */
+    unsigned char *dict;
+    unsigned int dictMask;
+    unsigned int dictIdx;
+    unsigned int dictLen;
+
+    unsigned int checksum;
 } TINF_DATA;
 
 
@@ -74,6 +97,24 @@ typedef struct TINF_DATA {
 int TINFCC tinf_uncompress_dyn(TINF_DATA *d);
 int TINFCC tinf_zlib_uncompress_dyn(TINF_DATA *d, unsigned int sourceLen);
 
+/* streaming API */
+
+/* Step 1: Allocate TINF_DATA structure and a window of 1 << dictBits bytes */
+/* Step 2: Set readSource, and source and sourceLimit if some input is
+           already available (otherwise set both to NULL) */
+/* Step 3: Call tinf_uncompress_stream_init() */
+/* Step 4: For a zlib stream, call tinf_zlib_parse_header(), which returns
+           the window bits the stream needs; check they fit the window */
+/* Step 5: Set dest and destRemaining and call tinf_uncompress_stream() or
+           tinf_zlib_uncompress_stream(), which return TINF_OK when dest is
+           full and TINF_DONE at the end of the stream (with dest pointing
+           a byte past the last output byte); call until TINF_DONE */
+
+void TINFCC tinf_uncompress_stream_init(TINF_DATA *d, unsigned char *dict, unsigned int dictBits);
+int TINFCC tinf_uncompress_stream(TINF_DATA *d);
+int TINFCC tinf_zlib_parse_header(TINF_DATA *d);
+int TINFCC tinf_zlib_uncompress_stream(TINF_DATA *d);
+
 /* high-level API */
 
 void TINFCC tinf_init(void);
@@ -88,12 +129,46 @@ int TINFCC tinf_zlib_uncompress(void *dest, unsigned int *destLen,
                                 const void *source, unsigned int sourceLen);
 
 unsigned int TINFCC tinf_adler32(const void *data, unsigned int length);
+unsigned int TINFCC tinf_adler32_update(unsigned int adler, const void *data, unsigned int length);
 
 unsigned int TINFCC tinf_crc32(const void *data, unsigned int length);
+unsigned int TINFCC tinf_crc32_update(unsigned int crc, const void *data, unsigned int length);
 
 /* compression API */
 
-void TINFCC tinf_compress(void *data, const uint8_t *src, unsigned slen);
+/* deflate compressor, see tdeflate.c */
+
+#define TDEFL_WBITS_MIN 9
+#define TDEFL_WBITS_MAX 15
+#define TDEFL_HASH_BITS(wbits) ((wbits) - 1)
+
+struct TDEFL_DATA;
+typedef struct TDEFL_DATA {
+    /* output buffer, managed as for TINF_DATA; destGrow is required */
+    unsigned char *destStart;
+    unsigned int destSize;
+    unsigned char *dest;
+    unsigned int destRemaining;
+    int (*destGrow)(struct TDEFL_DATA *data, unsigned int lastAlloc);
+
+    /* memory provided by the caller */
+    unsigned char *window; /* 2 << wbits bytes */
+    unsigned short *head;  /* 1 << TDEFL_HASH_BITS(wbits) entries */
+    unsigned short *prev;  /* 1 << wbits entries */
+
+    unsigned int bitbuf;
+    unsigned int bitcount;
+    unsigned int adler;
+    unsigned int wbits;
+    unsigned int hashBits;
+    unsigned int strstart;
+    unsigned int lookahead;
+    int raw;
+} TDEFL_DATA;
+
+void TINFCC tdefl_init(TDEFL_DATA *d, int wbits);
+void TINFCC tdefl_compress(TDEFL_DATA *d, const void *source, unsigned int sourceLen);
+void TINFCC tdefl_finish(TDEFL_DATA *d);
 
 #ifdef __cplusplus
 } /* extern "C" */
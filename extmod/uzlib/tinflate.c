@@ -180,6 +180,24 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
  * -- decode functions -- *
  * ---------------------- */
 
+/* get one byte from source stream */
+static unsigned char tinf_read_byte(TINF_DATA *d)
+{
+   if (d->readSource != NULL && d->source == d->sourceLimit)
+   {
+      int c = d->readSource(d);
+      /* past the end, feed zeros; every decode step then terminates and
+         the caller reports the error */
+      if (c < 0)
+      {
+         d->eof = 1;
+         return 0;
+      }
+      return c;
+   }
+   return *d->source++;
+}
+
 /* get one bit from source stream */
 static int tinf_getbit(TINF_DATA *d)
 {
@@ -189,7 +207,7 @@ static int tinf_getbit(TINF_DATA *d)
    if (!d->bitcount--)
    {
       /* load next tag */
-      d->tag = *d->source++;
+      d->tag = tinf_read_byte(d);
       d->bitcount = 7;
    }
 
@@ -455,6 +473,7 @@ int tinf_uncompress(void *dest, unsigned int *destLen,
 
    /* initialise data */
    d.source = (const unsigned char *)source;
+   d.readSource = NULL;
 
    d.destStart = (unsigned char *)dest;
    d.destRemaining = *destLen;
@@ -513,3 +532,135 @@ int tinf_uncompress_dyn(TINF_DATA *d)
 
    return TINF_OK;
 }
+
+/* ----------------------------- *
+ * -- streaming decompression -- *
+ * ----------------------------- */
+
+void tinf_uncompress_stream_init(TINF_DATA *d, unsigned char *dict, unsigned int dictBits)
+{
+   d->bitcount = 0;
+   d->eof = 0;
+   d->bfinal = 0;
+   d->btype = -1;
+   d->curlen = 0;
+   d->dict = dict;
+   d->dictMask = (1u << dictBits) - 1;
+   d->dictIdx = 0;
+   d->dictLen = 0;
+}
+
+/* read the header of the next block */
+static int tinf_stream_next_block(TINF_DATA *d)
+{
+   if (d->bfinal) return TINF_DONE;
+
+   /* read final block flag */
+   d->bfinal = tinf_getbit(d);
+
+   /* read block type (2 bits) */
+   d->btype = tinf_read_bits(d, 2, 0);
+
+   switch (d->btype)
+   {
+   case 0:
+      {
+         unsigned int length, invlength;
+
+         /* stored data starts on a byte boundary */
+         d->bitcount = 0;
+
+         length = tinf_read_byte(d);
+         length += 256 * tinf_read_byte(d);
+         invlength = tinf_read_byte(d);
+         invlength += 256 * tinf_read_byte(d);
+
+         if (length != (~invlength & 0x0000ffff)) return TINF_DATA_ERROR;
+
+         d->curlen = length;
+      }
+      break;
+   case 1:
+      tinf_build_fixed_trees(&d->ltree, &d->dtree);
+      break;
+   case 2:
+      tinf_decode_trees(d, &d->ltree, &d->dtree);
+      break;
+   default:
+      return TINF_DATA_ERROR;
+   }
+
+   return d->eof ? TINF_DATA_ERROR : TINF_OK;
+}
+
+/* inflate from the source callback into dest, until dest is full or the
+   stream ends; only the window is kept between calls, so output can be
+   handed out in pieces as small as needed */
+int tinf_uncompress_stream(TINF_DATA *d)
+{
+   while (d->destRemaining)
+   {
+      int c = -1;
+
+      if (d->curlen == 0)
+      {
+         if (d->btype == 1 || d->btype == 2)
+         {
+            int sym = tinf_decode_symbol(d, &d->ltree);
+
+            if (sym < 256)
+            {
+               c = sym;
+            } else if (sym == 256) {
+               /* end of block */
+               d->btype = -1;
+               continue;
+            } else {
+               int dist;
+
+               sym -= 257;
+               if (sym >= 29) return TINF_DATA_ERROR;
+
+               /* possibly get more bits from length code */
+               d->curlen = tinf_read_bits(d, length_bits[sym], length_base[sym]);
+
+               dist = tinf_decode_symbol(d, &d->dtree);
+               if (dist >= 30) return TINF_DATA_ERROR;
+
+               /* possibly get more bits from distance code */
+               d->lzOff = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
+
+               /* the match must lie within the output kept so far */
+               if (d->lzOff > d->dictLen) return TINF_DATA_ERROR;
+            }
+         } else {
+            /* no block yet, or the end of a stored block */
+            int res = tinf_stream_next_block(d);
+            if (res != TINF_OK) return res;
+            continue;
+         }
+      }
+
+      if (c < 0)
+      {
+         /* next byte of a stored block or of a match */
+         if (d->btype == 0)
+         {
+            c = tinf_read_byte(d);
+         } else {
+            c = d->dict[(d->dictIdx - d->lzOff) & d->dictMask];
+         }
+         d->curlen--;
+      }
+      if (d->eof) return TINF_DATA_ERROR;
+
+      d->dict[d->dictIdx] = c;
+      d->dictIdx = (d->dictIdx + 1) & d->dictMask;
+      if (d->dictLen <= d->dictMask) d->dictLen++;
+
+      *d->dest++ = c;
+      d->destRemaining--;
+   }
+
+   return TINF_OK;
+}
@@ -41,6 +41,7 @@ int tinf_zlib_uncompress(void *dest, unsigned int *destLen,
 
    /* initialise data */
    d.source = (const unsigned char *)source;
+   d.readSource = NULL;
 
    d.destStart = (unsigned char *)dest;
    d.destRemaining = *destLen;
@@ -99,3 +100,52 @@ int tinf_zlib_uncompress_dyn(TINF_DATA *d, unsigned int sourceLen)
    return TINF_OK;
 }
 
+
+/* returns the window bits the stream was made with, or TINF_DATA_ERROR */
+int tinf_zlib_parse_header(TINF_DATA *d)
+{
+   unsigned char cmf, flg;
+
+   cmf = tinf_read_byte(d);
+   flg = tinf_read_byte(d);
+
+   if (d->eof) return TINF_DATA_ERROR;
+
+   /* check checksum */
+   if ((256*cmf + flg) % 31) return TINF_DATA_ERROR;
+
+   /* check method is deflate */
+   if ((cmf & 0x0f) != 8) return TINF_DATA_ERROR;
+
+   /* check window size is valid */
+   if ((cmf >> 4) > 7) return TINF_DATA_ERROR;
+
+   /* check there is no preset dictionary */
+   if (flg & 0x20) return TINF_DATA_ERROR;
+
+   d->checksum = 1;
+
+   return (cmf >> 4) + 8;
+}
+
+int tinf_zlib_uncompress_stream(TINF_DATA *d)
+{
+   unsigned char *start = d->dest;
+   unsigned int a32;
+   int i, res;
+
+   res = tinf_uncompress_stream(d);
+
+   d->checksum = tinf_adler32_update(d->checksum, start, d->dest - start);
+
+   if (res != TINF_DONE) return res;
+
+   /* -- check adler32 checksum, which follows on a byte boundary -- */
+
+   d->bitcount = 0;
+   for (a32 = 0, i = 0; i < 4; ++i) a32 = 256*a32 + tinf_read_byte(d);
+
+   if (d->eof || a32 != d->checksum) return TINF_DATA_ERROR;
+
+   return TINF_DONE;
+}
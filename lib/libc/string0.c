@@ -115,13 +115,31 @@ int memcmp(const void *s1, const void *s2, size_t n) {
 }
 
 void *memchr(const void *s, int c, size_t n) {
-    if (n != 0) {
-        const unsigned char *p = s;
+    const uint8_t *p = s;
+    c = (uint8_t)c;
 
-        do {
-            if (*p++ == c)
-                return ((void *)(p - 1));
-        } while (--n != 0);
+    // check bytes until p is word aligned
+    for (; n > 0 && ((uint32_t)p & 3); n--, p++) {
+        if (*p == c) {
+            return (void*)p;
+        }
+    }
+
+    // check a word at a time; x has a zero byte, ie the word has a byte equal
+    // to c, if and only if (x - 0x01010101) & ~x & 0x80808080 is non-zero
+    uint32_t c4 = c * 0x01010101;
+    for (; n >= 4; n -= 4, p += 4) {
+        uint32_t x = *(const uint32_t*)p ^ c4;
+        if ((x - 0x01010101) & ~x & 0x80808080) {
+            break;
+        }
+    }
+
+    // find the byte in the word that matched, or check the remaining bytes
+    for (; n > 0; n--, p++) {
+        if (*p == c) {
+            return (void*)p;
+        }
     }
     return 0;
 }
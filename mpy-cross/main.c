@@ -0,0 +1,205 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "py/nlr.h"
+#include "py/compile.h"
+#include "py/runtime.h"
+#include "py/emitglue.h"
+
+// Command line options, with their defaults
+mp_uint_t mp_verbose_flag = 0;
+
+STATIC int usage(char **argv) {
+    printf(
+"usage: %s [<opts>] <input filename>...\n"
+"Options:\n"
+"-o : output file for compiled bytecode (defaults to input with .mpy extension)\n"
+"-s : source filename to embed in the compiled bytecode (defaults to input file)\n"
+"-j N : compile the input files using N worker processes (default 1)\n"
+"-v : verbose (trace various operations); can be multiple\n"
+"-o and -s can only be given with a single input file\n"
+, argv[0]
+);
+    return 1;
+}
+
+STATIC int compile_and_save(const char *file, const char *output_file, const char *source_file) {
+    mp_lexer_t *lex = mp_lexer_new_from_file(file);
+    if (lex == NULL) {
+        printf("could not open file '%s' for reading\n", file);
+        return 1;
+    }
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        qstr source_name;
+        if (source_file == NULL) {
+            source_name = lex->source_name;
+        } else {
+            source_name = qstr_from_str(source_file);
+        }
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        mp_raw_code_t *rc = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+
+        vstr_t vstr;
+        vstr_init(&vstr, 16);
+        if (output_file == NULL) {
+            // replace the .py extension, if any, with .mpy
+            vstr_add_str(&vstr, file);
+            if (vstr_len(&vstr) > 3 && strcmp(file + vstr_len(&vstr) - 3, ".py") == 0) {
+                vstr_cut_tail_bytes(&vstr, 3);
+            }
+            vstr_add_str(&vstr, ".mpy");
+            output_file = vstr_null_terminated_str(&vstr);
+        }
+        mp_raw_code_save_file(rc, output_file);
+        vstr_clear(&vstr);
+
+        nlr_pop();
+        return 0;
+    } else {
+        // uncaught exception
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        return 1;
+    }
+}
+
+// compiles every step'th file starting with the first one, saving each next to
+// its source; returns non-zero if any of them failed
+STATIC int compile_and_save_files(char **files, int num_files, int step) {
+    int ret = 0;
+    for (int i = 0; i < num_files; i += step) {
+        ret |= compile_and_save(files[i], NULL, NULL);
+    }
+    return ret;
+}
+
+// Compiles the files using worker processes that are forked after mp_init, so
+// the runtime and the qstr table only need to be set up once.  Each worker has
+// its own copy of all the state, so no locking is needed.
+STATIC int compile_and_save_files_parallel(char **files, int num_files, int num_jobs) {
+    int ret = 0;
+    fflush(stdout);
+    for (int j = 0; j < num_jobs; j++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // worker process, which takes every num_jobs'th file
+            ret = compile_and_save_files(files + j, num_files - j, num_jobs);
+            fflush(stdout);
+            _exit(ret);
+        } else if (pid < 0) {
+            // couldn't start a worker, so do its share of the files here
+            ret |= compile_and_save_files(files + j, num_files - j, num_jobs);
+        }
+    }
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    mp_init();
+
+    char **input_files = alloca(argc * sizeof(char*));
+    int num_input_files = 0;
+    int num_jobs = 1;
+    const char *output_file = NULL;
+    const char *source_file = NULL;
+
+    // parse command line options
+    for (int a = 1; a < argc; a++) {
+        if (argv[a][0] == '-') {
+            if (strcmp(argv[a], "-o") == 0) {
+                if (a + 1 >= argc) {
+                    return usage(argv);
+                }
+                output_file = argv[++a];
+            } else if (strcmp(argv[a], "-s") == 0) {
+                if (a + 1 >= argc) {
+                    return usage(argv);
+                }
+                source_file = argv[++a];
+            } else if (strcmp(argv[a], "-j") == 0) {
+                if (a + 1 >= argc) {
+                    return usage(argv);
+                }
+                num_jobs = atoi(argv[++a]);
+                if (num_jobs < 1) {
+                    return usage(argv);
+                }
+            } else if (strcmp(argv[a], "-v") == 0) {
+                mp_verbose_flag++;
+            } else {
+                return usage(argv);
+            }
+        } else {
+            input_files[num_input_files++] = argv[a];
+        }
+    }
+
+    if (num_input_files == 0) {
+        printf("error: no input file\n");
+        return usage(argv);
+    }
+
+    int ret;
+    if (num_input_files == 1) {
+        ret = compile_and_save(input_files[0], output_file, source_file);
+    } else if (output_file != NULL || source_file != NULL) {
+        printf("error: -o and -s need a single input file\n");
+        return usage(argv);
+    } else if (num_jobs == 1) {
+        ret = compile_and_save_files(input_files, num_input_files, 1);
+    } else {
+        if (num_jobs > num_input_files) {
+            num_jobs = num_input_files;
+        }
+        ret = compile_and_save_files_parallel(input_files, num_input_files, num_jobs);
+    }
+
+    mp_deinit();
+    return ret;
+}
+
+mp_import_stat_t mp_import_stat(const char *path) {
+    (void)path;
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+void nlr_jump_fail(void *val) {
+    printf("FATAL: uncaught NLR %p\n", val);
+    exit(1);
+}
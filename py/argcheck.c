@@ -73,7 +73,101 @@ void mp_arg_check_num(mp_uint_t n_args, mp_uint_t n_kw, mp_uint_t n_args_min, mp
     }
 }
 
+STATIC NORETURN void arg_error_required(qstr qst) {
+    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+        mp_arg_error_terse_mismatch();
+    } else {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+            "'%q' argument required", qst));
+    }
+}
+
+STATIC NORETURN void arg_error_extra_positional(void) {
+    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+        mp_arg_error_terse_mismatch();
+    } else {
+        // TODO better error message
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError,
+            "extra positional arguments given"));
+    }
+}
+
+STATIC NORETURN void arg_error_extra_keyword(void) {
+    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+        mp_arg_error_terse_mismatch();
+    } else {
+        // TODO better error message
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError,
+            "extra keyword arguments given"));
+    }
+}
+
+STATIC void arg_convert(const mp_arg_t *allowed, mp_obj_t given_arg, mp_arg_val_t *out_val) {
+    if ((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_BOOL) {
+        out_val->u_bool = mp_obj_is_true(given_arg);
+    } else if ((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_INT) {
+        out_val->u_int = mp_obj_get_int(given_arg);
+    } else if ((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_OBJ) {
+        out_val->u_obj = given_arg;
+    } else {
+        assert(0);
+    }
+}
+
+#if MICROPY_OPT_ARG_PARSE
+// The positional arguments are converted in order.  If there are no keyword
+// arguments the rest just get their defaults.  Keyword arguments in an array
+// (as passed to C functions by calls in bytecode) are each matched against
+// the qstrs of the remaining allowed arguments, which is a scan of small
+// integers rather than a map lookup per allowed argument.  A bit per allowed
+// argument records those given, to catch missing and repeated ones.  Keywords
+// in a hash-table map (from **kwargs) take the general path below.
+STATIC bool arg_parse_fast(mp_uint_t n_pos, const mp_obj_t *pos, mp_map_t *kws, mp_uint_t n_allowed, const mp_arg_t *allowed, mp_arg_val_t *out_vals) {
+    if (kws->used != 0 && (!kws->is_fixed || n_allowed > sizeof(mp_uint_t) * 8)) {
+        return false;
+    }
+    if (n_pos > n_allowed) {
+        arg_error_extra_positional();
+    }
+    for (mp_uint_t i = 0; i < n_pos; i++) {
+        if (allowed[i].flags & MP_ARG_KW_ONLY) {
+            arg_error_extra_positional();
+        }
+        arg_convert(&allowed[i], pos[i], &out_vals[i]);
+    }
+    mp_uint_t given = 0;
+    for (mp_uint_t j = 0; j < kws->used; j++) {
+        mp_obj_t key = kws->table[j].key;
+        mp_uint_t i = n_pos;
+        for (; i < n_allowed; i++) {
+            if (key == MP_OBJ_NEW_QSTR(allowed[i].qst)) {
+                break;
+            }
+        }
+        if (i == n_allowed || (given & ((mp_uint_t)1 << i))) {
+            arg_error_extra_keyword();
+        }
+        given |= (mp_uint_t)1 << i;
+        arg_convert(&allowed[i], kws->table[j].value, &out_vals[i]);
+    }
+    for (mp_uint_t i = n_pos; i < n_allowed; i++) {
+        if (!(given & ((mp_uint_t)1 << i))) {
+            if (allowed[i].flags & MP_ARG_REQUIRED) {
+                arg_error_required(allowed[i].qst);
+            }
+            out_vals[i] = allowed[i].defval;
+        }
+    }
+    return true;
+}
+#endif
+
 void mp_arg_parse_all(mp_uint_t n_pos, const mp_obj_t *pos, mp_map_t *kws, mp_uint_t n_allowed, const mp_arg_t *allowed, mp_arg_val_t *out_vals) {
+    #if MICROPY_OPT_ARG_PARSE
+    if (arg_parse_fast(n_pos, pos, kws, n_allowed, allowed, out_vals)) {
+        return;
+    }
+    #endif
     mp_uint_t pos_found = 0, kws_found = 0;
     for (mp_uint_t i = 0; i < n_allowed; i++) {
         mp_obj_t given_arg;
@@ -87,12 +181,7 @@ void mp_arg_parse_all(mp_uint_t n_pos, const mp_obj_t *pos, mp_map_t *kws, mp_ui
             mp_map_elem_t *kw = mp_map_lookup(kws, MP_OBJ_NEW_QSTR(allowed[i].qst), MP_MAP_LOOKUP);
             if (kw == NULL) {
                 if (allowed[i].flags & MP_ARG_REQUIRED) {
-                    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                        mp_arg_error_terse_mismatch();
-                    } else {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
-                            "'%q' argument required", allowed[i].qst));
-                    }
+                    arg_error_required(allowed[i].qst);
                 }
                 out_vals[i] = allowed[i].defval;
                 continue;
@@ -101,34 +190,14 @@ void mp_arg_parse_all(mp_uint_t n_pos, const mp_obj_t *pos, mp_map_t *kws, mp_ui
                 given_arg = kw->value;
             }
         }
-        if ((allowed[i].flags & MP_ARG_KIND_MASK) == MP_ARG_BOOL) {
-            out_vals[i].u_bool = mp_obj_is_true(given_arg);
-        } else if ((allowed[i].flags & MP_ARG_KIND_MASK) == MP_ARG_INT) {
-            out_vals[i].u_int = mp_obj_get_int(given_arg);
-        } else if ((allowed[i].flags & MP_ARG_KIND_MASK) == MP_ARG_OBJ) {
-            out_vals[i].u_obj = given_arg;
-        } else {
-            assert(0);
-        }
+        arg_convert(&allowed[i], given_arg, &out_vals[i]);
     }
     if (pos_found < n_pos) {
         extra_positional:
-        if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-            mp_arg_error_terse_mismatch();
-        } else {
-            // TODO better error message
-            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError,
-                "extra positional arguments given"));
-        }
+        arg_error_extra_positional();
     }
     if (kws_found < kws->used) {
-        if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-            mp_arg_error_terse_mismatch();
-        } else {
-            // TODO better error message
-            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError,
-                "extra keyword arguments given"));
-        }
+        arg_error_extra_keyword();
     }
 }
 
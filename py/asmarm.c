@@ -84,7 +84,10 @@ void asm_arm_start_pass(asm_arm_t *as, uint pass) {
 
 void asm_arm_end_pass(asm_arm_t *as) {
     if (as->pass == ASM_ARM_PASS_EMIT) {
-#ifdef __arm__
+#if defined(__linux__) && defined(__GNUC__)
+        // the cp15 cache operations are privileged, so ask the kernel
+        __builtin___clear_cache((char*)as->code_base, (char*)as->code_base + as->code_size);
+#elif defined(__arm__)
         // flush I- and D-cache
         asm volatile(
                 "0:"
@@ -236,13 +239,20 @@ void asm_arm_entry(asm_arm_t *as, int num_locals) {
     }
 
     emit_al(as, asm_arm_op_push(as->push_reglist | 1 << ASM_ARM_REG_LR));
-    if (as->stack_adjust > 0) {
+    if (as->stack_adjust > 0xff) {
+        // too big for an immediate; r12 is free to use (it's not an argument)
+        asm_arm_mov_reg_i32(as, ASM_ARM_REG_R12, as->stack_adjust);
+        emit_al(as, asm_arm_op_sub_reg(ASM_ARM_REG_SP, ASM_ARM_REG_SP, ASM_ARM_REG_R12));
+    } else if (as->stack_adjust > 0) {
         emit_al(as, asm_arm_op_sub_imm(ASM_ARM_REG_SP, ASM_ARM_REG_SP, as->stack_adjust));
     }
 }
 
 void asm_arm_exit(asm_arm_t *as) {
-    if (as->stack_adjust > 0) {
+    if (as->stack_adjust > 0xff) {
+        asm_arm_mov_reg_i32(as, ASM_ARM_REG_R12, as->stack_adjust);
+        emit_al(as, asm_arm_op_add_reg(ASM_ARM_REG_SP, ASM_ARM_REG_SP, ASM_ARM_REG_R12));
+    } else if (as->stack_adjust > 0) {
         emit_al(as, asm_arm_op_add_imm(ASM_ARM_REG_SP, ASM_ARM_REG_SP, as->stack_adjust));
     }
 
@@ -306,11 +316,13 @@ void asm_arm_mov_reg_i32(asm_arm_t *as, uint rd, int imm) {
 }
 
 void asm_arm_mov_local_reg(asm_arm_t *as, int local_num, uint rd) {
+    assert(local_num < 0x1000 / 4);
     // str rd, [sp, #local_num*4]
     emit_al(as, 0x58d0000 | (rd << 12) | (local_num << 2));
 }
 
 void asm_arm_mov_reg_local(asm_arm_t *as, uint rd, int local_num) {
+    assert(local_num < 0x1000 / 4);
     // ldr rd, [sp, #local_num*4]
     emit_al(as, 0x59d0000 | (rd << 12) | (local_num << 2));
 }
@@ -356,8 +368,13 @@ void asm_arm_orr_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm) {
 }
 
 void asm_arm_mov_reg_local_addr(asm_arm_t *as, uint rd, int local_num) {
-    // add rd, sp, #local_num*4
-    emit_al(as, asm_arm_op_add_imm(rd, ASM_ARM_REG_SP, local_num << 2));
+    if (local_num < 0x100 / 4) {
+        // add rd, sp, #local_num*4
+        emit_al(as, asm_arm_op_add_imm(rd, ASM_ARM_REG_SP, local_num << 2));
+    } else {
+        asm_arm_mov_reg_i32(as, rd, local_num << 2);
+        emit_al(as, asm_arm_op_add_reg(rd, ASM_ARM_REG_SP, rd)); // add rd, sp, rd
+    }
 }
 
 void asm_arm_lsl_reg_reg(asm_arm_t *as, uint rd, uint rs) {
@@ -385,6 +402,32 @@ void asm_arm_ldrb_reg_reg(asm_arm_t *as, uint rd, uint rn) {
     emit_al(as, 0x5d00000 | (rn << 16) | (rd << 12));
 }
 
+void asm_arm_ldrh_reg_reg_i8(asm_arm_t *as, uint rd, uint rn, uint byte_offset) {
+    // ldrh rd, [rn, #off], where off is 0-255
+    emit_al(as, 0x1d000b0 | (rn << 16) | (rd << 12) | ((byte_offset & 0xf0) << 4) | (byte_offset & 0xf));
+}
+
+void asm_arm_ldrb_reg_reg_i12(asm_arm_t *as, uint rd, uint rn, uint byte_offset) {
+    // ldrb rd, [rn, #off], where off is 0-4095
+    emit_al(as, 0x5d00000 | (rn << 16) | (rd << 12) | byte_offset);
+}
+
+void asm_arm_ldr_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm) {
+    // ldr rd, [rn, rm, lsl #2]
+    emit_al(as, 0x7900100 | (rn << 16) | (rd << 12) | rm);
+}
+
+void asm_arm_ldrh_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm) {
+    // ldrh doesn't support scaled register index
+    emit_al(as, 0x1a00080 | (ASM_ARM_REG_R8 << 12) | rm); // mov r8, rm, lsl #1
+    emit_al(as, 0x19000b0 | (rn << 16) | (rd << 12) | ASM_ARM_REG_R8); // ldrh rd, [rn, r8]
+}
+
+void asm_arm_ldrb_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm) {
+    // ldrb rd, [rn, rm]
+    emit_al(as, 0x7d00000 | (rn << 16) | (rd << 12) | rm);
+}
+
 void asm_arm_str_reg_reg(asm_arm_t *as, uint rd, uint rm, uint byte_offset) {
     // str rd, [rm, #off]
     emit_al(as, 0x5800000 | (rm << 16) | (rd << 12) | byte_offset);
@@ -115,6 +115,12 @@ void asm_arm_ldrb_reg_reg(asm_arm_t *as, uint rd, uint rn);
 void asm_arm_str_reg_reg(asm_arm_t *as, uint rd, uint rm, uint byte_offset);
 void asm_arm_strh_reg_reg(asm_arm_t *as, uint rd, uint rm);
 void asm_arm_strb_reg_reg(asm_arm_t *as, uint rd, uint rm);
+void asm_arm_ldrh_reg_reg_i8(asm_arm_t *as, uint rd, uint rn, uint byte_offset);
+void asm_arm_ldrb_reg_reg_i12(asm_arm_t *as, uint rd, uint rn, uint byte_offset);
+// load from array
+void asm_arm_ldr_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm);
+void asm_arm_ldrh_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm);
+void asm_arm_ldrb_reg_reg_reg(asm_arm_t *as, uint rd, uint rn, uint rm);
 // store to array
 void asm_arm_str_reg_reg_reg(asm_arm_t *as, uint rd, uint rm, uint rn);
 void asm_arm_strh_reg_reg_reg(asm_arm_t *as, uint rd, uint rm, uint rn);
@@ -207,6 +207,35 @@ static inline void asm_thumb_ldrb_rlo_rlo_i5(asm_thumb_t *as, uint rlo_dest, uin
 static inline void asm_thumb_ldrh_rlo_rlo_i5(asm_thumb_t *as, uint rlo_dest, uint rlo_base, uint byte_offset)
     { asm_thumb_format_9_10(as, ASM_THUMB_FORMAT_10_LDRH, rlo_dest, rlo_base, byte_offset); }
 
+// Thumb-2 add with a shifted register: rd = rn + (rm << shift)
+static inline void asm_thumb_add_reg_reg_reg_lsl(asm_thumb_t *as, uint rd, uint rn, uint rm, uint shift)
+    { asm_thumb_op32(as, 0xeb00 | rn, ((shift & 0x1c) << 10) | (rd << 8) | ((shift & 3) << 6) | rm); }
+
+// VFP single-precision floating point; s registers are numbered 0-31
+
+#define ASM_THUMB_VFP_OP_ADD (0x30)
+#define ASM_THUMB_VFP_OP_SUB (0x34)
+#define ASM_THUMB_VFP_OP_MUL (0x20)
+#define ASM_THUMB_VFP_OP_DIV (0x80)
+
+static inline void asm_thumb_vmov_s_r(asm_thumb_t *as, uint s_dest, uint r_src)
+    { asm_thumb_op32(as, 0xee00 | (s_dest >> 1), 0x0a10 | (r_src << 12) | ((s_dest & 1) << 7)); }
+static inline void asm_thumb_vmov_r_s(asm_thumb_t *as, uint r_dest, uint s_src)
+    { asm_thumb_op32(as, 0xee10 | (s_src >> 1), 0x0a10 | (r_dest << 12) | ((s_src & 1) << 7)); }
+static inline void asm_thumb_vop_s_s_s(asm_thumb_t *as, uint vfp_op, uint s_dest, uint s_src_a, uint s_src_b)
+    { asm_thumb_op32(as, 0xee00 | (vfp_op & 0xf0) | ((s_dest & 1) << 6) | (s_src_a >> 1),
+        0x0a00 | ((vfp_op & 0x0f) << 4) | ((s_dest & 0x1e) << 11) | ((s_src_a & 1) << 7) | ((s_src_b & 1) << 5) | (s_src_b >> 1)); }
+static inline void asm_thumb_vfp_2op_s_s(asm_thumb_t *as, uint op_hi, uint s_dest, uint s_src)
+    { asm_thumb_op32(as, op_hi | ((s_dest & 1) << 6), 0x0ac0 | ((s_dest & 0x1e) << 11) | ((s_src & 1) << 5) | (s_src >> 1)); }
+static inline void asm_thumb_vcmp_s_s(asm_thumb_t *as, uint s_src_a, uint s_src_b)
+    { asm_thumb_vfp_2op_s_s(as, 0xeeb4, s_src_a, s_src_b); }
+static inline void asm_thumb_vcvt_f32_s32(asm_thumb_t *as, uint s_dest, uint s_src)
+    { asm_thumb_vfp_2op_s_s(as, 0xeeb8, s_dest, s_src); }
+static inline void asm_thumb_vcvt_s32_f32(asm_thumb_t *as, uint s_dest, uint s_src)
+    { asm_thumb_vfp_2op_s_s(as, 0xeebd, s_dest, s_src); } // rounds towards zero
+static inline void asm_thumb_vmrs_apsr_fpscr(asm_thumb_t *as)
+    { asm_thumb_op32(as, 0xeef1, 0xfa10); } // copy FP flags to APSR_nzcv
+
 // TODO convert these to above format style
 
 #define ASM_THUMB_OP_MOVW (0xf240)
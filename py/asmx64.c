@@ -83,6 +83,13 @@
 #define OPCODE_CALL_REL32        (0xe8)
 #define OPCODE_CALL_RM32         (0xff) /* /2 */
 #define OPCODE_LEAVE             (0xc9)
+#define OPCODE_MOVQ_R64_TO_XMM   (0x6e) /* 0x66 REX.W 0x0f 0x6e /r */
+#define OPCODE_MOVQ_XMM_TO_R64   (0x7e) /* 0x66 REX.W 0x0f 0x7e /r */
+#define OPCODE_UCOMISD           (0x2e) /* 0x66 0x0f 0x2e /r */
+#define OPCODE_CVTSI2SD          (0x2a) /* 0xf2 REX.W 0x0f 0x2a /r */
+#define OPCODE_CVTTSD2SI         (0x2c) /* 0xf2 REX.W 0x0f 0x2c /r */
+#define OPCODE_CVTSD2SS          (0x5a) /* 0xf2 0x0f 0x5a /r */
+#define OPCODE_CVTSS2SD          (0x5a) /* 0xf3 0x0f 0x5a /r */
 
 #define MODRM_R64(x)    (((x) & 0x7) << 3)
 #define MODRM_RM_DISP0  (0x00)
@@ -92,6 +99,8 @@
 #define MODRM_RM_R64(x) ((x) & 0x7)
 
 #define OP_SIZE_PREFIX (0x66)
+#define SSE_SD_PREFIX  (0xf2)
+#define SSE_SS_PREFIX  (0xf3)
 
 #define REX_PREFIX  (0x40)
 #define REX_W       (0x08)  // width
@@ -256,19 +265,25 @@ STATIC void asm_x64_write_word32_to(asm_x64_t *as, int offset, int w32) {
 STATIC void asm_x64_write_r64_disp(asm_x64_t *as, int r64, int disp_r64, int disp_offset) {
     assert(disp_r64 != ASM_X64_REG_RSP);
 
-    if (disp_r64 == ASM_X64_REG_R12) {
-        // special case for r12; not fully implemented
-        assert(SIGNED_FIT8(disp_offset));
-        asm_x64_write_byte_3(as, MODRM_R64(r64) | MODRM_RM_DISP8 | MODRM_RM_R64(disp_r64), 0x24, IMM32_L0(disp_offset));
-        return;
-    }
-
-    if (disp_offset == 0 && disp_r64 != ASM_X64_REG_RBP) {
-        asm_x64_write_byte_1(as, MODRM_R64(r64) | MODRM_RM_DISP0 | MODRM_RM_R64(disp_r64));
+    // the low 3 bits of the base register select the addressing mode: for
+    // r12 they mean a SIB byte follows, and for r13 (like rbp) there is no
+    // mode without a displacement
+    byte mod;
+    if (disp_offset == 0 && (disp_r64 & 7) != ASM_X64_REG_RBP) {
+        mod = MODRM_RM_DISP0;
     } else if (SIGNED_FIT8(disp_offset)) {
-        asm_x64_write_byte_2(as, MODRM_R64(r64) | MODRM_RM_DISP8 | MODRM_RM_R64(disp_r64), IMM32_L0(disp_offset));
+        mod = MODRM_RM_DISP8;
     } else {
-        asm_x64_write_byte_1(as, MODRM_R64(r64) | MODRM_RM_DISP32 | MODRM_RM_R64(disp_r64));
+        mod = MODRM_RM_DISP32;
+    }
+    asm_x64_write_byte_1(as, MODRM_R64(r64) | mod | MODRM_RM_R64(disp_r64));
+    if ((disp_r64 & 7) == ASM_X64_REG_RSP) {
+        // SIB byte for base only, no index
+        asm_x64_write_byte_1(as, 0x24);
+    }
+    if (mod == MODRM_RM_DISP8) {
+        asm_x64_write_byte_1(as, IMM32_L0(disp_offset));
+    } else if (mod == MODRM_RM_DISP32) {
         asm_x64_write_word32(as, disp_offset);
     }
 }
@@ -321,21 +336,29 @@ void asm_x64_mov_r64_r64(asm_x64_t *as, int dest_r64, int src_r64) {
 }
 
 void asm_x64_mov_r8_to_mem8(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp) {
-    assert(dest_r64 < 8);
-    if (src_r64 < 8) {
+    if (src_r64 < 4 && dest_r64 < 8) {
         asm_x64_write_byte_1(as, OPCODE_MOV_R8_TO_RM8);
     } else {
-        asm_x64_write_byte_2(as, REX_PREFIX | REX_R, OPCODE_MOV_R8_TO_RM8);
+        // a REX prefix is also needed to select SPL..DIL instead of AH..BH
+        asm_x64_write_byte_2(as, REX_PREFIX | (src_r64 < 8 ? 0 : REX_R) | (dest_r64 < 8 ? 0 : REX_B), OPCODE_MOV_R8_TO_RM8);
     }
     asm_x64_write_r64_disp(as, src_r64, dest_r64, dest_disp);
 }
 
 void asm_x64_mov_r16_to_mem16(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp) {
-    assert(dest_r64 < 8);
-    if (src_r64 < 8) {
+    if (src_r64 < 8 && dest_r64 < 8) {
         asm_x64_write_byte_2(as, OP_SIZE_PREFIX, OPCODE_MOV_R64_TO_RM64);
     } else {
-        asm_x64_write_byte_3(as, OP_SIZE_PREFIX, REX_PREFIX | REX_R, OPCODE_MOV_R64_TO_RM64);
+        asm_x64_write_byte_3(as, OP_SIZE_PREFIX, REX_PREFIX | (src_r64 < 8 ? 0 : REX_R) | (dest_r64 < 8 ? 0 : REX_B), OPCODE_MOV_R64_TO_RM64);
+    }
+    asm_x64_write_r64_disp(as, src_r64, dest_r64, dest_disp);
+}
+
+void asm_x64_mov_r32_to_mem32(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp) {
+    if (src_r64 < 8 && dest_r64 < 8) {
+        asm_x64_write_byte_1(as, OPCODE_MOV_R64_TO_RM64);
+    } else {
+        asm_x64_write_byte_2(as, REX_PREFIX | (src_r64 < 8 ? 0 : REX_R) | (dest_r64 < 8 ? 0 : REX_B), OPCODE_MOV_R64_TO_RM64);
     }
     asm_x64_write_r64_disp(as, src_r64, dest_r64, dest_disp);
 }
@@ -347,21 +370,29 @@ void asm_x64_mov_r64_to_mem64(asm_x64_t *as, int src_r64, int dest_r64, int dest
 }
 
 void asm_x64_mov_mem8_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64) {
-    assert(src_r64 < 8);
-    if (dest_r64 < 8) {
+    if (dest_r64 < 8 && src_r64 < 8) {
         asm_x64_write_byte_2(as, 0x0f, OPCODE_MOVZX_RM8_TO_R64);
     } else {
-        asm_x64_write_byte_3(as, REX_PREFIX | REX_R, 0x0f, OPCODE_MOVZX_RM8_TO_R64);
+        asm_x64_write_byte_3(as, REX_PREFIX | (dest_r64 < 8 ? 0 : REX_R) | (src_r64 < 8 ? 0 : REX_B), 0x0f, OPCODE_MOVZX_RM8_TO_R64);
     }
     asm_x64_write_r64_disp(as, dest_r64, src_r64, src_disp);
 }
 
 void asm_x64_mov_mem16_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64) {
-    assert(src_r64 < 8);
-    if (dest_r64 < 8) {
+    if (dest_r64 < 8 && src_r64 < 8) {
         asm_x64_write_byte_2(as, 0x0f, OPCODE_MOVZX_RM16_TO_R64);
     } else {
-        asm_x64_write_byte_3(as, REX_PREFIX | REX_R, 0x0f, OPCODE_MOVZX_RM16_TO_R64);
+        asm_x64_write_byte_3(as, REX_PREFIX | (dest_r64 < 8 ? 0 : REX_R) | (src_r64 < 8 ? 0 : REX_B), 0x0f, OPCODE_MOVZX_RM16_TO_R64);
+    }
+    asm_x64_write_r64_disp(as, dest_r64, src_r64, src_disp);
+}
+
+void asm_x64_mov_mem32_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64) {
+    // a 32 bit operation zero extends into the full register
+    if (dest_r64 < 8 && src_r64 < 8) {
+        asm_x64_write_byte_1(as, OPCODE_MOV_RM64_TO_R64);
+    } else {
+        asm_x64_write_byte_2(as, REX_PREFIX | (dest_r64 < 8 ? 0 : REX_R) | (src_r64 < 8 ? 0 : REX_B), OPCODE_MOV_RM64_TO_R64);
     }
     asm_x64_write_r64_disp(as, dest_r64, src_r64, src_disp);
 }
@@ -374,12 +405,24 @@ void asm_x64_mov_mem64_to_r64(asm_x64_t *as, int src_r64, int src_disp, int dest
 
 STATIC void asm_x64_lea_disp_to_r64(asm_x64_t *as, int src_r64, int src_disp, int dest_r64) {
     // use REX prefix for 64 bit operation
-    assert(src_r64 < 8);
-    assert(dest_r64 < 8);
-    asm_x64_write_byte_2(as, REX_PREFIX | REX_W, OPCODE_LEA_MEM_TO_R64);
+    asm_x64_write_byte_2(as, REX_PREFIX | REX_W | (dest_r64 < 8 ? 0 : REX_R) | (src_r64 < 8 ? 0 : REX_B), OPCODE_LEA_MEM_TO_R64);
     asm_x64_write_r64_disp(as, dest_r64, src_r64, src_disp);
 }
 
+void asm_x64_lea_scaled_to_r64(asm_x64_t *as, int base_r64, int index_r64, int log2_scale, int dest_r64) {
+    // dest = base + (index << log2_scale), using a SIB byte
+    assert(index_r64 != ASM_X64_REG_RSP);
+    assert(0 <= log2_scale && log2_scale <= 3);
+    asm_x64_write_byte_2(as, REX_PREFIX | REX_W | (dest_r64 < 8 ? 0 : REX_R) | (index_r64 < 8 ? 0 : REX_X) | (base_r64 < 8 ? 0 : REX_B), OPCODE_LEA_MEM_TO_R64);
+    byte sib = (log2_scale << 6) | MODRM_R64(index_r64) | MODRM_RM_R64(base_r64);
+    if ((base_r64 & 7) == ASM_X64_REG_RBP) {
+        // rbp and r13 as base have no mode without a displacement
+        asm_x64_write_byte_3(as, MODRM_R64(dest_r64) | MODRM_RM_DISP8 | 4, sib, 0);
+    } else {
+        asm_x64_write_byte_2(as, MODRM_R64(dest_r64) | MODRM_RM_DISP0 | 4, sib);
+    }
+}
+
 /*
 void asm_x64_mov_i8_to_r8(asm_x64_t *as, int src_i8, int dest_r64) {
     assert(dest_r64 < 8);
@@ -400,8 +443,7 @@ STATIC void asm_x64_mov_i32_to_r64(asm_x64_t *as, int src_i32, int dest_r64) {
 void asm_x64_mov_i64_to_r64(asm_x64_t *as, int64_t src_i64, int dest_r64) {
     // cpu defaults to i32 to r64
     // to mov i64 to r64 need to use REX prefix
-    assert(dest_r64 < 8);
-    asm_x64_write_byte_2(as, REX_PREFIX | REX_W, OPCODE_MOV_I64_TO_R64 | dest_r64);
+    asm_x64_write_byte_2(as, REX_PREFIX | REX_W | (dest_r64 < 8 ? 0 : REX_B), OPCODE_MOV_I64_TO_R64 | (dest_r64 & 7));
     asm_x64_write_word64(as, src_i64);
 }
 
@@ -525,6 +567,49 @@ void asm_x64_setcc_r8(asm_x64_t *as, int jcc_type, int dest_r8) {
     asm_x64_write_byte_3(as, OPCODE_SETCC_RM8_A, OPCODE_SETCC_RM8_B | jcc_type, MODRM_R64(0) | MODRM_RM_REG | MODRM_RM_R64(dest_r8));
 }
 
+// SSE2 instructions have a mandatory prefix before any REX prefix, and a
+// 0x0f escape before the opcode; reg and rm may be xmm or general registers
+STATIC void asm_x64_sse_reg_reg(asm_x64_t *as, int prefix, int rex_w, int op, int reg, int rm) {
+    asm_x64_write_byte_1(as, prefix);
+    int rex = rex_w | (reg < 8 ? 0 : REX_R) | (rm < 8 ? 0 : REX_B);
+    if (rex != 0) {
+        asm_x64_write_byte_1(as, REX_PREFIX | rex);
+    }
+    asm_x64_write_byte_3(as, 0x0f, op, MODRM_R64(reg) | MODRM_RM_REG | MODRM_RM_R64(rm));
+}
+
+void asm_x64_movq_r64_to_xmm(asm_x64_t *as, int src_r64, int dest_xmm) {
+    asm_x64_sse_reg_reg(as, OP_SIZE_PREFIX, REX_W, OPCODE_MOVQ_R64_TO_XMM, dest_xmm, src_r64);
+}
+
+void asm_x64_movq_xmm_to_r64(asm_x64_t *as, int src_xmm, int dest_r64) {
+    asm_x64_sse_reg_reg(as, OP_SIZE_PREFIX, REX_W, OPCODE_MOVQ_XMM_TO_R64, src_xmm, dest_r64);
+}
+
+void asm_x64_sd_op_xmm_xmm(asm_x64_t *as, int sd_op, int dest_xmm, int src_xmm) {
+    asm_x64_sse_reg_reg(as, SSE_SD_PREFIX, 0, sd_op, dest_xmm, src_xmm);
+}
+
+void asm_x64_ucomisd_xmm_xmm(asm_x64_t *as, int src_xmm_a, int src_xmm_b) {
+    asm_x64_sse_reg_reg(as, OP_SIZE_PREFIX, 0, OPCODE_UCOMISD, src_xmm_a, src_xmm_b);
+}
+
+void asm_x64_cvtsd2ss_xmm_xmm(asm_x64_t *as, int dest_xmm, int src_xmm) {
+    asm_x64_sse_reg_reg(as, SSE_SD_PREFIX, 0, OPCODE_CVTSD2SS, dest_xmm, src_xmm);
+}
+
+void asm_x64_cvtss2sd_xmm_xmm(asm_x64_t *as, int dest_xmm, int src_xmm) {
+    asm_x64_sse_reg_reg(as, SSE_SS_PREFIX, 0, OPCODE_CVTSS2SD, dest_xmm, src_xmm);
+}
+
+void asm_x64_cvtsi2sd_r64_to_xmm(asm_x64_t *as, int src_r64, int dest_xmm) {
+    asm_x64_sse_reg_reg(as, SSE_SD_PREFIX, REX_W, OPCODE_CVTSI2SD, dest_xmm, src_r64);
+}
+
+void asm_x64_cvttsd2si_xmm_to_r64(asm_x64_t *as, int src_xmm, int dest_r64) {
+    asm_x64_sse_reg_reg(as, SSE_SD_PREFIX, REX_W, OPCODE_CVTTSD2SI, dest_r64, src_xmm);
+}
+
 void asm_x64_label_assign(asm_x64_t *as, mp_uint_t label) {
     assert(label < as->max_num_labels);
     if (as->pass < ASM_X64_PASS_EMIT) {
@@ -598,10 +683,14 @@ void asm_x64_entry(asm_x64_t *as, int num_locals) {
     asm_x64_push_r64(as, ASM_X64_REG_RBX);
     asm_x64_push_r64(as, ASM_X64_REG_R12);
     asm_x64_push_r64(as, ASM_X64_REG_R13);
+    asm_x64_push_r64(as, ASM_X64_REG_R14);
+    asm_x64_push_r64(as, ASM_X64_REG_R15);
     as->num_locals = num_locals;
 }
 
 void asm_x64_exit(asm_x64_t *as) {
+    asm_x64_pop_r64(as, ASM_X64_REG_R15);
+    asm_x64_pop_r64(as, ASM_X64_REG_R14);
     asm_x64_pop_r64(as, ASM_X64_REG_R13);
     asm_x64_pop_r64(as, ASM_X64_REG_R12);
     asm_x64_pop_r64(as, ASM_X64_REG_RBX);
@@ -61,17 +61,30 @@
 #define ASM_X64_REG_R14 (14)
 #define ASM_X64_REG_R15 (15)
 
+#define ASM_X64_REG_XMM0 (0)
+#define ASM_X64_REG_XMM1 (1)
+
 // condition codes, used for jcc and setcc (despite their j-name!)
 #define ASM_X64_CC_JB  (0x2) // below, unsigned
+#define ASM_X64_CC_JAE (0x3) // above or equal, unsigned
 #define ASM_X64_CC_JZ  (0x4)
 #define ASM_X64_CC_JE  (0x4)
 #define ASM_X64_CC_JNZ (0x5)
 #define ASM_X64_CC_JNE (0x5)
+#define ASM_X64_CC_JA  (0x7) // above, unsigned
+#define ASM_X64_CC_JP  (0xa) // parity, set by an unordered float compare
+#define ASM_X64_CC_JNP (0xb)
 #define ASM_X64_CC_JL  (0xc) // less, signed
 #define ASM_X64_CC_JGE (0xd) // greater or equal, signed
 #define ASM_X64_CC_JLE (0xe) // less or equal, signed
 #define ASM_X64_CC_JG  (0xf) // greater, signed
 
+// scalar double-precision SSE2 arithmetic, for asm_x64_sd_op_xmm_xmm
+#define ASM_X64_SD_OP_ADD (0x58)
+#define ASM_X64_SD_OP_MUL (0x59)
+#define ASM_X64_SD_OP_SUB (0x5c)
+#define ASM_X64_SD_OP_DIV (0x5e)
+
 typedef struct _asm_x64_t asm_x64_t;
 
 asm_x64_t* asm_x64_new(mp_uint_t max_num_labels);
@@ -94,10 +107,13 @@ void asm_x64_mov_i64_to_r64_optimised(asm_x64_t *as, int64_t src_i64, int dest_r
 void asm_x64_mov_i64_to_r64_aligned(asm_x64_t *as, int64_t src_i64, int dest_r64);
 void asm_x64_mov_r8_to_mem8(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp);
 void asm_x64_mov_r16_to_mem16(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp);
+void asm_x64_mov_r32_to_mem32(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp);
 void asm_x64_mov_r64_to_mem64(asm_x64_t *as, int src_r64, int dest_r64, int dest_disp);
 void asm_x64_mov_mem8_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64);
 void asm_x64_mov_mem16_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64);
+void asm_x64_mov_mem32_to_r64zx(asm_x64_t *as, int src_r64, int src_disp, int dest_r64);
 void asm_x64_mov_mem64_to_r64(asm_x64_t *as, int src_r64, int src_disp, int dest_r64);
+void asm_x64_lea_scaled_to_r64(asm_x64_t *as, int base_r64, int index_r64, int log2_scale, int dest_r64);
 void asm_x64_and_r64_r64(asm_x64_t *as, int dest_r64, int src_r64);
 void asm_x64_or_r64_r64(asm_x64_t *as, int dest_r64, int src_r64);
 void asm_x64_xor_r64_r64(asm_x64_t *as, int dest_r64, int src_r64);
@@ -108,6 +124,14 @@ void asm_x64_sub_r64_r64(asm_x64_t* as, int dest_r64, int src_r64);
 void asm_x64_cmp_r64_with_r64(asm_x64_t* as, int src_r64_a, int src_r64_b);
 void asm_x64_test_r8_with_r8(asm_x64_t* as, int src_r64_a, int src_r64_b);
 void asm_x64_setcc_r8(asm_x64_t* as, int jcc_type, int dest_r8);
+void asm_x64_movq_r64_to_xmm(asm_x64_t *as, int src_r64, int dest_xmm);
+void asm_x64_movq_xmm_to_r64(asm_x64_t *as, int src_xmm, int dest_r64);
+void asm_x64_sd_op_xmm_xmm(asm_x64_t *as, int sd_op, int dest_xmm, int src_xmm);
+void asm_x64_ucomisd_xmm_xmm(asm_x64_t *as, int src_xmm_a, int src_xmm_b);
+void asm_x64_cvtsd2ss_xmm_xmm(asm_x64_t *as, int dest_xmm, int src_xmm);
+void asm_x64_cvtss2sd_xmm_xmm(asm_x64_t *as, int dest_xmm, int src_xmm);
+void asm_x64_cvtsi2sd_r64_to_xmm(asm_x64_t *as, int src_r64, int dest_xmm);
+void asm_x64_cvttsd2si_xmm_to_r64(asm_x64_t *as, int src_xmm, int dest_r64);
 void asm_x64_label_assign(asm_x64_t* as, mp_uint_t label);
 void asm_x64_jmp_label(asm_x64_t* as, mp_uint_t label);
 void asm_x64_jcc_label(asm_x64_t* as, int jcc_type, mp_uint_t label);
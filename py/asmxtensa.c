@@ -0,0 +1,471 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+
+// wrapper around everything in this file
+#if MICROPY_EMIT_XTENSA
+
+#include "py/asmxtensa.h"
+
+#define WORD_SIZE (4)
+#define SIGNED_FIT8(x) ((((x) & 0xffffff80) == 0) || (((x) & 0xffffff80) == 0xffffff80))
+#define SIGNED_FIT12(x) ((((x) & 0xfffff800) == 0) || (((x) & 0xfffff800) == 0xfffff800))
+#define SIGNED_FIT18(x) ((((x) & 0xfffe0000) == 0) || (((x) & 0xfffe0000) == 0xfffe0000))
+
+// the stack frame holds a0 and the callee-save registers a12-a15, then the locals
+#define NUM_REGS_SAVED (5)
+
+// instruction formats, giving the 24-bit (or 16-bit) little-endian opcode
+#define ENCODE_RRR(op0, op1, op2, r, s, t) \
+    (((uint32_t)(op2) << 20) | ((uint32_t)(op1) << 16) | ((r) << 12) | ((s) << 8) | ((t) << 4) | (op0))
+#define ENCODE_RRI8(op0, r, s, t, imm8) \
+    (((uint32_t)(imm8) << 16) | ((r) << 12) | ((s) << 8) | ((t) << 4) | (op0))
+#define ENCODE_RI16(op0, t, imm16) \
+    (((uint32_t)(imm16) << 8) | ((t) << 4) | (op0))
+#define ENCODE_CALL(op0, n, offset) \
+    (((uint32_t)(offset) << 6) | ((n) << 4) | (op0))
+#define ENCODE_CALLX(op0, op1, op2, r, s, m, n) \
+    (((uint32_t)(op2) << 20) | ((uint32_t)(op1) << 16) | ((r) << 12) | ((s) << 8) | ((m) << 6) | ((n) << 4) | (op0))
+#define ENCODE_BRI12(op0, s, m, n, imm12) \
+    (((uint32_t)(imm12) << 12) | ((s) << 8) | ((m) << 6) | ((n) << 4) | (op0))
+#define ENCODE_RRRN(op0, r, s, t) \
+    (((r) << 12) | ((s) << 8) | ((t) << 4) | (op0))
+#define ENCODE_RI7(op0, s, imm7) \
+    ((((imm7) & 0xf) << 12) | ((s) << 8) | ((imm7) & 0x70) | (op0))
+
+struct _asm_xtensa_t {
+    uint pass;
+    mp_uint_t code_offset;
+    mp_uint_t code_size;
+    byte *code_base;
+    byte dummy_data[4];
+
+    mp_uint_t max_num_labels;
+    mp_uint_t *label_offsets;
+    uint stack_adjust;
+
+    // literal pool for l32r, which can only load from below the instruction;
+    // it is sized by the previous pass and placed at the start of the code
+    mp_uint_t const_table_offset;
+    uint32_t *const_table;
+    uint num_const;
+    uint cur_const;
+};
+
+asm_xtensa_t *asm_xtensa_new(uint max_num_labels) {
+    asm_xtensa_t *as;
+
+    as = m_new0(asm_xtensa_t, 1);
+    as->max_num_labels = max_num_labels;
+    as->label_offsets = m_new(mp_uint_t, max_num_labels);
+
+    return as;
+}
+
+void asm_xtensa_free(asm_xtensa_t *as, bool free_code) {
+    if (free_code) {
+        MP_PLAT_FREE_EXEC(as->code_base, as->code_size);
+    }
+    m_del(mp_uint_t, as->label_offsets, as->max_num_labels);
+    m_del_obj(asm_xtensa_t, as);
+}
+
+void asm_xtensa_start_pass(asm_xtensa_t *as, uint pass) {
+    if (pass == ASM_XTENSA_PASS_COMPUTE) {
+        memset(as->label_offsets, -1, as->max_num_labels * sizeof(mp_uint_t));
+    } else if (pass == ASM_XTENSA_PASS_EMIT) {
+        MP_PLAT_ALLOC_EXEC(as->code_offset, (void**)&as->code_base, &as->code_size);
+        if (as->code_base == NULL) {
+            assert(0);
+        }
+    }
+    as->pass = pass;
+    as->code_offset = 0;
+    as->const_table = NULL;
+    as->cur_const = 0;
+}
+
+void asm_xtensa_end_pass(asm_xtensa_t *as) {
+    if (as->pass == ASM_XTENSA_PASS_COMPUTE) {
+        as->num_const = as->cur_const;
+    } else {
+        assert(as->cur_const == as->num_const);
+        // move the code to where it can be executed, if the port needs that
+        as->code_base = MP_PLAT_COMMIT_EXEC(as->code_base, as->code_size);
+    }
+}
+
+// all functions must go through this one to emit bytes
+// if as->pass < ASM_XTENSA_PASS_EMIT, then this function only returns a buffer of 4 bytes length
+STATIC byte *asm_xtensa_get_cur_to_write_bytes(asm_xtensa_t *as, int num_bytes_to_write) {
+    if (as->pass < ASM_XTENSA_PASS_EMIT) {
+        as->code_offset += num_bytes_to_write;
+        return as->dummy_data;
+    } else {
+        assert(as->code_offset + num_bytes_to_write <= as->code_size);
+        byte *c = as->code_base + as->code_offset;
+        as->code_offset += num_bytes_to_write;
+        return c;
+    }
+}
+
+uint asm_xtensa_get_code_pos(asm_xtensa_t *as) {
+    return as->code_offset;
+}
+
+uint asm_xtensa_get_code_size(asm_xtensa_t *as) {
+    return as->code_size;
+}
+
+void *asm_xtensa_get_code(asm_xtensa_t *as) {
+    return as->code_base;
+}
+
+STATIC void asm_xtensa_op16(asm_xtensa_t *as, uint op) {
+    byte *c = asm_xtensa_get_cur_to_write_bytes(as, 2);
+    c[0] = op;
+    c[1] = op >> 8;
+}
+
+STATIC void asm_xtensa_op24(asm_xtensa_t *as, uint32_t op) {
+    byte *c = asm_xtensa_get_cur_to_write_bytes(as, 3);
+    c[0] = op;
+    c[1] = op >> 8;
+    c[2] = op >> 16;
+}
+
+void asm_xtensa_op_add(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 8, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_sub(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 12, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_and(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 1, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_or(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 2, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_xor(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 3, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_addx2(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    // reg_dest = (reg_src_a << 1) + reg_src_b
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 9, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_addx4(asm_xtensa_t *as, uint reg_dest, uint reg_src_a, uint reg_src_b) {
+    // reg_dest = (reg_src_a << 2) + reg_src_b
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 10, reg_dest, reg_src_a, reg_src_b));
+}
+
+void asm_xtensa_op_addi(asm_xtensa_t *as, uint reg_dest, uint reg_src, int imm8) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 12, reg_src, reg_dest, imm8 & 0xff));
+}
+
+void asm_xtensa_op_mov_n(asm_xtensa_t *as, uint reg_dest, uint reg_src) {
+    asm_xtensa_op16(as, ENCODE_RRRN(13, 0, reg_src, reg_dest));
+}
+
+void asm_xtensa_op_movi(asm_xtensa_t *as, uint reg_dest, int imm12) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 10, (imm12 >> 8) & 0xf, reg_dest, imm12 & 0xff));
+}
+
+void asm_xtensa_op_movi_n(asm_xtensa_t *as, uint reg_dest, int imm4) {
+    // the immediate is in the range -32 to 95
+    asm_xtensa_op16(as, ENCODE_RI7(12, reg_dest, imm4));
+}
+
+void asm_xtensa_op_ssl(asm_xtensa_t *as, uint reg_src) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 4, 1, reg_src, 0));
+}
+
+void asm_xtensa_op_ssr(asm_xtensa_t *as, uint reg_src) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 0, 4, 0, reg_src, 0));
+}
+
+void asm_xtensa_op_sll(asm_xtensa_t *as, uint reg_dest, uint reg_src) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 1, 10, reg_dest, reg_src, 0));
+}
+
+void asm_xtensa_op_sra(asm_xtensa_t *as, uint reg_dest, uint reg_src) {
+    asm_xtensa_op24(as, ENCODE_RRR(0, 1, 11, reg_dest, 0, reg_src));
+}
+
+void asm_xtensa_op_l8ui(asm_xtensa_t *as, uint reg_dest, uint reg_base, uint byte_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 0, reg_base, reg_dest, byte_offset & 0xff));
+}
+
+void asm_xtensa_op_l16ui(asm_xtensa_t *as, uint reg_dest, uint reg_base, uint half_word_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 1, reg_base, reg_dest, half_word_offset & 0xff));
+}
+
+void asm_xtensa_op_l32i(asm_xtensa_t *as, uint reg_dest, uint reg_base, uint word_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 2, reg_base, reg_dest, word_offset & 0xff));
+}
+
+void asm_xtensa_op_s8i(asm_xtensa_t *as, uint reg_src, uint reg_base, uint byte_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 4, reg_base, reg_src, byte_offset & 0xff));
+}
+
+void asm_xtensa_op_s16i(asm_xtensa_t *as, uint reg_src, uint reg_base, uint half_word_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 5, reg_base, reg_src, half_word_offset & 0xff));
+}
+
+void asm_xtensa_op_s32i(asm_xtensa_t *as, uint reg_src, uint reg_base, uint word_offset) {
+    asm_xtensa_op24(as, ENCODE_RRI8(2, 6, reg_base, reg_src, word_offset & 0xff));
+}
+
+STATIC void asm_xtensa_op_l32i_n(asm_xtensa_t *as, uint reg_dest, uint reg_base, uint word_offset) {
+    asm_xtensa_op16(as, ENCODE_RRRN(8, word_offset & 0xf, reg_base, reg_dest));
+}
+
+STATIC void asm_xtensa_op_s32i_n(asm_xtensa_t *as, uint reg_src, uint reg_base, uint word_offset) {
+    asm_xtensa_op16(as, ENCODE_RRRN(9, word_offset & 0xf, reg_base, reg_src));
+}
+
+STATIC void asm_xtensa_op_l32r(asm_xtensa_t *as, uint reg_dest, mp_uint_t dest_offset) {
+    // the literal is addressed relative to the next instruction, word aligned
+    mp_int_t rel = dest_offset - ((as->code_offset + 3) & ~3);
+    asm_xtensa_op24(as, ENCODE_RI16(1, reg_dest, (rel >> 2) & 0xffff));
+}
+
+STATIC void asm_xtensa_op_j(asm_xtensa_t *as, int32_t rel18) {
+    asm_xtensa_op24(as, ENCODE_CALL(6, 0, rel18 & 0x3ffff));
+}
+
+STATIC void asm_xtensa_op_bccz(asm_xtensa_t *as, uint cond, uint reg_src, int32_t rel12) {
+    asm_xtensa_op24(as, ENCODE_BRI12(6, reg_src, cond, 1, rel12 & 0xfff));
+}
+
+STATIC void asm_xtensa_op_bcc(asm_xtensa_t *as, uint cond, uint reg_src1, uint reg_src2, int32_t rel8) {
+    asm_xtensa_op24(as, ENCODE_RRI8(7, cond, reg_src1, reg_src2, rel8 & 0xff));
+}
+
+void asm_xtensa_op_callx0(asm_xtensa_t *as, uint reg) {
+    asm_xtensa_op24(as, ENCODE_CALLX(0, 0, 0, 0, reg, 3, 0));
+}
+
+STATIC void asm_xtensa_op_ret_n(asm_xtensa_t *as) {
+    asm_xtensa_op16(as, ENCODE_RRRN(13, 15, 0, 0));
+}
+
+// stack frame:
+//  - a0 and a12-a15 are saved at the bottom of the frame
+//  - the locals follow them, in ascending order
+//  - the frame is a multiple of 16 bytes
+//
+//  | SP
+//  v
+//  a0  a12  a13  a14  a15  l0  l1  ...  l(n-1)
+//  ^                                    ^
+//  | low address                        | high address in RAM
+
+void asm_xtensa_entry(asm_xtensa_t *as, int num_locals) {
+    if (num_locals < 0) {
+        num_locals = 0;
+    }
+
+    // jump over the literal pool, which is word aligned
+    as->const_table_offset = (as->code_offset + 3 + 3) & ~3;
+    mp_uint_t start = as->const_table_offset + as->num_const * WORD_SIZE;
+    asm_xtensa_op_j(as, start - as->code_offset - 4);
+    as->code_offset = as->const_table_offset;
+    byte *c = asm_xtensa_get_cur_to_write_bytes(as, as->num_const * WORD_SIZE);
+    if (as->pass == ASM_XTENSA_PASS_EMIT) {
+        as->const_table = (uint32_t*)c;
+    }
+
+    // make room for the saved registers and the locals
+    as->stack_adjust = ((NUM_REGS_SAVED + num_locals) * WORD_SIZE + 15) & ~15;
+    if (as->stack_adjust < 128) {
+        asm_xtensa_op_addi(as, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_SP, -as->stack_adjust);
+    } else {
+        // a8 is caller-save and not used to pass arguments
+        asm_xtensa_mov_reg_i32(as, ASM_XTENSA_REG_A8, as->stack_adjust);
+        asm_xtensa_op_sub(as, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_A8);
+    }
+
+    asm_xtensa_op_s32i_n(as, ASM_XTENSA_REG_A0, ASM_XTENSA_REG_SP, 0);
+    asm_xtensa_op_s32i_n(as, ASM_XTENSA_REG_A12, ASM_XTENSA_REG_SP, 1);
+    asm_xtensa_op_s32i_n(as, ASM_XTENSA_REG_A13, ASM_XTENSA_REG_SP, 2);
+    asm_xtensa_op_s32i_n(as, ASM_XTENSA_REG_A14, ASM_XTENSA_REG_SP, 3);
+    asm_xtensa_op_s32i_n(as, ASM_XTENSA_REG_A15, ASM_XTENSA_REG_SP, 4);
+}
+
+void asm_xtensa_exit(asm_xtensa_t *as) {
+    asm_xtensa_op_l32i_n(as, ASM_XTENSA_REG_A15, ASM_XTENSA_REG_SP, 4);
+    asm_xtensa_op_l32i_n(as, ASM_XTENSA_REG_A14, ASM_XTENSA_REG_SP, 3);
+    asm_xtensa_op_l32i_n(as, ASM_XTENSA_REG_A13, ASM_XTENSA_REG_SP, 2);
+    asm_xtensa_op_l32i_n(as, ASM_XTENSA_REG_A12, ASM_XTENSA_REG_SP, 1);
+    asm_xtensa_op_l32i_n(as, ASM_XTENSA_REG_A0, ASM_XTENSA_REG_SP, 0);
+
+    if (as->stack_adjust < 128) {
+        asm_xtensa_op_addi(as, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_SP, as->stack_adjust);
+    } else {
+        asm_xtensa_mov_reg_i32(as, ASM_XTENSA_REG_A8, as->stack_adjust);
+        asm_xtensa_op_add(as, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_SP, ASM_XTENSA_REG_A8);
+    }
+    asm_xtensa_op_ret_n(as);
+}
+
+void asm_xtensa_label_assign(asm_xtensa_t *as, uint label) {
+    assert(label < as->max_num_labels);
+    if (as->pass < ASM_XTENSA_PASS_EMIT) {
+        // assign label offset
+        assert(as->label_offsets[label] == -1);
+        as->label_offsets[label] = as->code_offset;
+    } else {
+        // ensure label offset has not changed from PASS_COMPUTE to PASS_EMIT
+        assert(as->label_offsets[label] == as->code_offset);
+    }
+}
+
+void asm_xtensa_align(asm_xtensa_t* as, uint align) {
+    // TODO fill unused data with NOPs?
+    as->code_offset = (as->code_offset + align - 1) & (~(align - 1));
+}
+
+void asm_xtensa_data(asm_xtensa_t* as, uint bytesize, uint val) {
+    byte *c = asm_xtensa_get_cur_to_write_bytes(as, bytesize);
+    // only write to the buffer in the emit pass (otherwise we overflow dummy_data)
+    if (as->pass == ASM_XTENSA_PASS_EMIT) {
+        // little endian
+        for (uint i = 0; i < bytesize; i++) {
+            *c++ = val;
+            val >>= 8;
+        }
+    }
+}
+
+// always loads from the literal pool, so the code size and the number of
+// literals don't depend on the value, which may change between passes
+void asm_xtensa_mov_reg_literal(asm_xtensa_t *as, uint reg_dest, uint32_t i32) {
+    asm_xtensa_op_l32r(as, reg_dest, as->const_table_offset + as->cur_const * WORD_SIZE);
+    if (as->const_table != NULL) {
+        assert(as->cur_const < as->num_const);
+        as->const_table[as->cur_const] = i32;
+    }
+    ++as->cur_const;
+}
+
+void asm_xtensa_mov_reg_i32(asm_xtensa_t *as, uint reg_dest, uint32_t i32) {
+    if (SIGNED_FIT12(i32)) {
+        asm_xtensa_op_movi(as, reg_dest, i32);
+    } else {
+        asm_xtensa_mov_reg_literal(as, reg_dest, i32);
+    }
+}
+
+void asm_xtensa_mov_local_reg(asm_xtensa_t *as, int local_num, uint reg_src) {
+    assert(NUM_REGS_SAVED + local_num < 256);
+    asm_xtensa_op_s32i(as, reg_src, ASM_XTENSA_REG_SP, NUM_REGS_SAVED + local_num);
+}
+
+void asm_xtensa_mov_reg_local(asm_xtensa_t *as, uint reg_dest, int local_num) {
+    assert(NUM_REGS_SAVED + local_num < 256);
+    asm_xtensa_op_l32i(as, reg_dest, ASM_XTENSA_REG_SP, NUM_REGS_SAVED + local_num);
+}
+
+void asm_xtensa_mov_reg_local_addr(asm_xtensa_t *as, uint reg_dest, int local_num) {
+    uint offset = (NUM_REGS_SAVED + local_num) * WORD_SIZE;
+    if (offset < 128) {
+        asm_xtensa_op_addi(as, reg_dest, ASM_XTENSA_REG_SP, offset);
+    } else {
+        asm_xtensa_mov_reg_i32(as, reg_dest, offset);
+        asm_xtensa_op_add(as, reg_dest, reg_dest, ASM_XTENSA_REG_SP);
+    }
+}
+
+// reg_dest must be different from reg_src1 and reg_src2
+void asm_xtensa_setcc_reg_reg_reg(asm_xtensa_t *as, uint cond, uint reg_dest, uint reg_src1, uint reg_src2) {
+    asm_xtensa_op_movi_n(as, reg_dest, 1);
+    asm_xtensa_op_bcc(as, cond, reg_src1, reg_src2, 1); // skip the next movi.n
+    asm_xtensa_op_movi_n(as, reg_dest, 0);
+}
+
+STATIC mp_uint_t get_label_dest(asm_xtensa_t *as, uint label) {
+    assert(label < as->max_num_labels);
+    return as->label_offsets[label];
+}
+
+void asm_xtensa_j_label(asm_xtensa_t *as, uint label) {
+    mp_int_t rel = get_label_dest(as, label) - as->code_offset - 4;
+    if (as->pass == ASM_XTENSA_PASS_EMIT && !SIGNED_FIT18(rel)) {
+        printf("asm_xtensa_j: branch does not fit in 18 bits\n");
+    }
+    asm_xtensa_op_j(as, rel);
+}
+
+// Conditional branches have a short range, so they are only used directly
+// for backward jumps that fit.  Forward jumps branch on the inverse condition
+// over a j.  Backward labels are known in every pass, so both passes choose
+// the same form and the code size doesn't change.
+STATIC bool asm_xtensa_short_branch(asm_xtensa_t *as, uint label, bool fit8) {
+    mp_uint_t dest = get_label_dest(as, label);
+    if (dest > as->code_offset) {
+        return false;
+    }
+    mp_int_t rel = dest - as->code_offset - 4;
+    return fit8 ? SIGNED_FIT8(rel) : SIGNED_FIT12(rel);
+}
+
+void asm_xtensa_bccz_reg_label(asm_xtensa_t *as, uint cond, uint reg, uint label) {
+    if (asm_xtensa_short_branch(as, label, false)) {
+        asm_xtensa_op_bccz(as, cond, reg, get_label_dest(as, label) - as->code_offset - 4);
+    } else {
+        asm_xtensa_op_bccz(as, cond ^ 1, reg, 2); // skip the j
+        asm_xtensa_j_label(as, label);
+    }
+}
+
+void asm_xtensa_bcc_reg_reg_label(asm_xtensa_t *as, uint cond, uint reg1, uint reg2, uint label) {
+    if (asm_xtensa_short_branch(as, label, true)) {
+        asm_xtensa_op_bcc(as, cond, reg1, reg2, get_label_dest(as, label) - as->code_offset - 4);
+    } else {
+        asm_xtensa_op_bcc(as, cond ^ 8, reg1, reg2, 2); // skip the j
+        asm_xtensa_j_label(as, label);
+    }
+}
+
+void asm_xtensa_call_ind(asm_xtensa_t *as, uint fun_id) {
+    // a15 holds mp_fun_table (loaded by the emitter), and a0 is saved on entry
+    assert(fun_id < 256);
+    asm_xtensa_op_l32i(as, ASM_XTENSA_REG_A0, ASM_XTENSA_REG_A15, fun_id);
+    asm_xtensa_op_callx0(as, ASM_XTENSA_REG_A0);
+}
+
+#endif // MICROPY_EMIT_XTENSA
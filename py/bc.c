@@ -31,6 +31,7 @@
 
 #include "py/nlr.h"
 #include "py/objfun.h"
+#include "py/bc0.h"
 #include "py/bc.h"
 
 #if 0 // print debugging info
@@ -52,6 +53,17 @@ mp_uint_t mp_decode_uint(const byte **ptr) {
     return unum;
 }
 
+// qstrs in the code-info block are fixed size if the code can be persisted
+qstr mp_decode_code_info_qstr(const byte **ptr) {
+    #if MICROPY_PERSISTENT_CODE
+    const byte *p = *ptr;
+    *ptr = p + 2;
+    return p[0] | (p[1] << 8);
+    #else
+    return mp_decode_uint(ptr);
+    #endif
+}
+
 STATIC NORETURN void fun_pos_args_mismatch(mp_obj_fun_bc_t *f, mp_uint_t expected, mp_uint_t given) {
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE
     // generic message, used also for other argument issues
@@ -78,6 +90,70 @@ STATIC void dump_args(const mp_obj_t *a, mp_uint_t sz) {
 #define dump_args(...) (void)0
 #endif
 
+// Decode one entry of the line number table at ci, returning the next one.
+// b is the number of bytecode bytes covered and l the line number increment.
+STATIC const byte *decode_line_entry(const byte *ci, mp_uint_t *b, mp_uint_t *l) {
+    mp_uint_t c = *ci;
+    if ((c & 0x80) == 0) {
+        // 0b0LLBBBBB encoding
+        *b = c & 0x1f;
+        *l = c >> 5;
+        return ci + 1;
+    } else {
+        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+        *b = c & 0xf;
+        *l = ((c << 4) & 0x700) | ci[1];
+        return ci + 2;
+    }
+}
+
+// Decode the code-info of a bytecode function to find the name of the
+// function, its source file, and the source line of the opcode at ip.
+mp_uint_t mp_bytecode_get_source_line(const byte *code_info, const byte *ip, qstr *block_name, qstr *source_file) {
+    const byte *ci = code_info;
+    mp_uint_t code_info_size = mp_decode_uint(&ci);
+    *block_name = mp_decode_code_info_qstr(&ci);
+    *source_file = mp_decode_code_info_qstr(&ci);
+    mp_uint_t bc = ip - code_info - code_info_size;
+    mp_uint_t source_line = 1;
+    while (*ci) {
+        mp_uint_t b, l;
+        ci = decode_line_entry(ci, &b, &l);
+        if (bc >= b) {
+            bc -= b;
+            source_line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    return source_line;
+}
+
+#if MICROPY_VM_PROFILE
+// Decode the code-info of a bytecode function to find the name of the
+// function, its source file, and the source line of its first statement.
+mp_uint_t mp_bytecode_get_first_line(const byte *code_info, qstr *block_name, qstr *source_file) {
+    const byte *ci = code_info;
+    mp_decode_uint(&ci);
+    *block_name = mp_decode_code_info_qstr(&ci);
+    *source_file = mp_decode_code_info_qstr(&ci);
+    // the first line increment is that of the first statement; it's spread
+    // over several entries if it doesn't fit in one
+    mp_uint_t source_line = 1;
+    while (*ci) {
+        mp_uint_t b, l;
+        const byte *next = decode_line_entry(ci, &b, &l);
+        if (source_line > 1 && b != 0) {
+            break;
+        }
+        source_line += l;
+        ci = next;
+    }
+    return source_line;
+}
+#endif
+
 // On entry code_state should be allocated somewhere (stack/heap) and
 // contain the following valid entries:
 //    - code_state->code_info should be the offset in bytes from the start of
@@ -94,7 +170,13 @@ void mp_setup_code_state(mp_code_state *code_state, mp_obj_t self_in, mp_uint_t
     #if MICROPY_STACKLESS
     code_state->prev = NULL;
     #endif
+    #if MICROPY_EMIT_NATIVE_JIT
+    code_state->jit_count = 0;
+    #endif
     code_state->code_info = self->bytecode + (mp_uint_t)code_state->code_info;
+    #if MICROPY_PERSISTENT_CODE
+    code_state->const_table = self->const_table;
+    #endif
     code_state->sp = &code_state->state[0] - 1;
     code_state->exc_sp = (mp_exc_stack_t*)(code_state->state + n_state) - 1;
 
@@ -147,37 +229,65 @@ void mp_setup_code_state(mp_code_state *code_state, mp_obj_t self_in, mp_uint_t
         dump_args(code_state->state + n_state - self->n_pos_args - self->n_kwonly_args, self->n_pos_args + self->n_kwonly_args);
 
         mp_obj_t dict = MP_OBJ_NULL;
-        if (self->takes_kw_args) {
-            dict = mp_obj_new_dict(n_kw); // TODO: better go conservative with 0?
-            *var_pos_kw_args = dict;
-        }
 
-        // get pointer to arg_names array at start of bytecode prelude
+        // get pointer to arg_names array at start of bytecode prelude, or
+        // at the start of the constant table
         const mp_obj_t *arg_names;
+        #if MICROPY_PERSISTENT_CODE
+        arg_names = (const mp_obj_t*)self->const_table;
+        #else
         {
             const byte *code_info = code_state->code_info;
             mp_uint_t code_info_size = mp_decode_uint(&code_info);
             arg_names = (const mp_obj_t*)(code_state->code_info + code_info_size);
         }
+        #endif
 
+        mp_uint_t n_named_args = self->n_pos_args + self->n_kwonly_args;
+        mp_uint_t n_filled = n_args;
         for (mp_uint_t i = 0; i < n_kw; i++) {
             mp_obj_t wanted_arg_name = kwargs[2 * i];
-            for (mp_uint_t j = 0; j < self->n_pos_args + self->n_kwonly_args; j++) {
+            mp_uint_t j;
+            #if MICROPY_OPT_KW_ARG_CACHE
+            mp_uint_t cache_idx = (((mp_uint_t)arg_names >> 2) ^ (mp_uint_t)wanted_arg_name) & (MICROPY_OPT_KW_ARG_CACHE_SIZE - 1);
+            j = MP_STATE_VM(kw_arg_cache)[cache_idx];
+            if (j < n_named_args && wanted_arg_name == arg_names[j]) {
+                goto found;
+            }
+            #endif
+            for (j = 0; j < n_named_args; j++) {
                 if (wanted_arg_name == arg_names[j]) {
-                    if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
-                            "function got multiple values for argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
-                    }
-                    code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
-                    goto continue2;
+                    #if MICROPY_OPT_KW_ARG_CACHE
+                    MP_STATE_VM(kw_arg_cache)[cache_idx] = j;
+                    #endif
+                    goto found;
                 }
             }
             // Didn't find name match with positional args
             if (!self->takes_kw_args) {
                 nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "function does not take keyword arguments"));
             }
+            if (dict == MP_OBJ_NULL) {
+                // sized for the keywords that are left, which may all be extra
+                dict = mp_obj_new_dict(n_kw - i);
+            }
             mp_obj_dict_store(dict, kwargs[2 * i], kwargs[2 * i + 1]);
-continue2:;
+            continue;
+        found:
+            if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
+                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+                    "function got multiple values for argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
+            }
+            code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
+            n_filled += 1;
+        }
+        if (self->takes_kw_args) {
+            *var_pos_kw_args = dict == MP_OBJ_NULL ? mp_obj_new_dict(0) : dict;
+        }
+
+        if (n_filled == n_named_args) {
+            // every argument was given, so there are no defaults to fill in
+            goto args_done;
         }
 
         DEBUG_printf("Args with kws flattened: ");
@@ -219,6 +329,7 @@ continue2:;
                 }
             }
         }
+    args_done:;
 
     } else {
         // no keyword arguments given
@@ -246,3 +357,137 @@ continue2:;
     dump_args(code_state->state + n_state - self->n_pos_args - self->n_kwonly_args, self->n_pos_args + self->n_kwonly_args);
     dump_args(code_state->state, n_state);
 }
+
+#if MICROPY_PERSISTENT_CODE_SAVE
+
+// The following table encodes the format of each opcode's main argument, 2 bits
+// per opcode.  Any extra bytes that follow the main argument are accounted for
+// by mp_opcode_format.
+
+#define OC4(a, b, c, d) (a | (b << 2) | (c << 4) | (d << 6))
+#define U (MP_OPCODE_BYTE) // unused opcode
+#define B (MP_OPCODE_BYTE)
+#define Q (MP_OPCODE_QSTR)
+#define V (MP_OPCODE_VAR_UINT)
+#define O (MP_OPCODE_OFFSET)
+
+STATIC const byte opcode_format_table[64] = {
+    OC4(U, U, U, U), // 0x00-0x03
+    OC4(U, U, U, U), // 0x04-0x07
+    OC4(U, U, U, U), // 0x08-0x0b
+    OC4(U, U, U, U), // 0x0c-0x0f
+    OC4(B, B, B, U), // 0x10-0x13
+    OC4(V, Q, Q, V), // 0x14-0x17
+    OC4(B, U, V, V), // 0x18-0x1b
+    OC4(Q, Q, Q, Q), // 0x1c-0x1f
+    OC4(B, B, V, V), // 0x20-0x23
+    OC4(Q, Q, Q, B), // 0x24-0x27
+    OC4(V, V, Q, Q), // 0x28-0x2b
+    OC4(U, U, U, U), // 0x2c-0x2f
+    OC4(B, B, B, B), // 0x30-0x33
+    OC4(B, O, O, O), // 0x34-0x37
+    OC4(O, O, U, U), // 0x38-0x3b
+    OC4(U, O, B, O), // 0x3c-0x3f
+    OC4(O, B, B, O), // 0x40-0x43
+    OC4(B, B, O, B), // 0x44-0x47
+    OC4(B, B, B, B), // 0x48-0x4b
+    OC4(O, U, U, U), // 0x4c-0x4f
+    OC4(V, V, V, V), // 0x50-0x53
+    OC4(B, V, V, V), // 0x54-0x57
+    OC4(V, V, V, B), // 0x58-0x5b
+    OC4(B, B, B, U), // 0x5c-0x5f
+    OC4(V, V, V, V), // 0x60-0x63
+    OC4(V, V, V, V), // 0x64-0x67
+    OC4(Q, Q, B, U), // 0x68-0x6b
+    OC4(U, U, U, U), // 0x6c-0x6f
+    OC4(B, B, B, B), // 0x70-0x73
+    OC4(B, B, B, B), // 0x74-0x77
+    OC4(B, B, B, B), // 0x78-0x7b
+    OC4(B, B, B, B), // 0x7c-0x7f
+    OC4(B, B, B, B), // 0x80-0x83
+    OC4(B, B, B, B), // 0x84-0x87
+    OC4(B, B, B, B), // 0x88-0x8b
+    OC4(B, B, B, B), // 0x8c-0x8f
+    OC4(B, B, B, B), // 0x90-0x93
+    OC4(B, B, B, B), // 0x94-0x97
+    OC4(B, B, B, B), // 0x98-0x9b
+    OC4(B, B, B, B), // 0x9c-0x9f
+    OC4(B, B, B, B), // 0xa0-0xa3
+    OC4(B, B, B, B), // 0xa4-0xa7
+    OC4(B, B, B, B), // 0xa8-0xab
+    OC4(B, B, B, B), // 0xac-0xaf
+    OC4(B, B, B, B), // 0xb0-0xb3
+    OC4(B, B, B, B), // 0xb4-0xb7
+    OC4(B, B, B, B), // 0xb8-0xbb
+    OC4(B, B, B, B), // 0xbc-0xbf
+    OC4(B, B, B, B), // 0xc0-0xc3
+    OC4(B, B, B, B), // 0xc4-0xc7
+    OC4(B, B, B, B), // 0xc8-0xcb
+    OC4(B, B, B, B), // 0xcc-0xcf
+    OC4(B, B, B, B), // 0xd0-0xd3
+    OC4(B, B, B, B), // 0xd4-0xd7
+    OC4(B, B, B, B), // 0xd8-0xdb
+    OC4(B, B, B, B), // 0xdc-0xdf
+    OC4(B, B, B, B), // 0xe0-0xe3
+    OC4(B, B, B, B), // 0xe4-0xe7
+    OC4(B, B, B, B), // 0xe8-0xeb
+    OC4(B, B, B, B), // 0xec-0xef
+    OC4(B, B, B, B), // 0xf0-0xf3
+    OC4(B, B, B, B), // 0xf4-0xf7
+    OC4(B, B, B, B), // 0xf8-0xfb
+    OC4(B, B, B, B), // 0xfc-0xff
+};
+
+#undef OC4
+#undef U
+#undef B
+#undef Q
+#undef V
+#undef O
+
+// Returns the format of the opcode at ip, and stores the total size of the
+// opcode, including all of its arguments, in *opcode_size.
+uint mp_opcode_format(const byte *ip, mp_uint_t *opcode_size) {
+    uint f = (opcode_format_table[*ip >> 2] >> (2 * (*ip & 3))) & 3;
+    const byte *ip_start = ip;
+    if (f == MP_OPCODE_QSTR) {
+        ip += 3;
+    } else {
+        int extra_byte = (
+            *ip == MP_BC_RAISE_VARARGS
+            || *ip == MP_BC_MAKE_CLOSURE
+            || *ip == MP_BC_MAKE_CLOSURE_DEFARGS
+            || *ip == MP_BC_UNWIND_JUMP
+            || *ip == MP_BC_FOR_RANGE_SMALL_INT
+        );
+        if (*ip == MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT
+            || *ip == MP_BC_STORE_FAST_BINARY_OP_SMALL_INT) {
+            extra_byte = 3;
+        } else if (*ip == MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE
+            || *ip == MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE) {
+            extra_byte = 5;
+        }
+        ip += 1;
+        if (f == MP_OPCODE_VAR_UINT) {
+            while ((*ip++ & 0x80) != 0) {
+            }
+        } else if (f == MP_OPCODE_OFFSET) {
+            ip += 2;
+        }
+        ip += extra_byte;
+    }
+    if (MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE && f == MP_OPCODE_QSTR) {
+        switch (*ip_start) {
+            case MP_BC_LOAD_NAME:
+            case MP_BC_LOAD_GLOBAL:
+            case MP_BC_LOAD_ATTR:
+            case MP_BC_STORE_ATTR:
+                ip += 1;
+                break;
+        }
+    }
+    *opcode_size = ip - ip_start;
+    return f;
+}
+
+#endif // MICROPY_PERSISTENT_CODE_SAVE
@@ -46,9 +46,21 @@ typedef struct _mp_code_state {
     // bit 0 is saved currently_in_except_block value
     mp_exc_stack_t *exc_sp;
     mp_obj_dict_t *old_globals;
+    #if MICROPY_PERSISTENT_CODE
+    const mp_uint_t *const_table;
+    #endif
     #if MICROPY_STACKLESS
     struct _mp_code_state *prev;
     #endif
+    #if MICROPY_GC_PRECISE_VM_ROOTS
+    // next older code state on the C stack, see MP_STATE_VM(gc_code_state_top)
+    struct _mp_code_state *gc_prev;
+    mp_uint_t gc_n_exc_stack;
+    #endif
+    #if MICROPY_EMIT_NATIVE_JIT
+    // number of backward jumps taken, added to the function's hotness on return
+    mp_uint_t jit_count;
+    #endif
     mp_uint_t n_state;
     // Variable-length
     mp_obj_t state[0];
@@ -57,14 +69,36 @@ typedef struct _mp_code_state {
 } mp_code_state;
 
 mp_uint_t mp_decode_uint(const byte **ptr);
+qstr mp_decode_code_info_qstr(const byte **ptr);
 
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state *code_state, volatile mp_obj_t inject_exc);
 mp_code_state *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
+void mp_obj_fun_bc_release_codestate(mp_code_state *code_state);
 void mp_setup_code_state(mp_code_state *code_state, mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
-void mp_bytecode_print(const void *descr, mp_uint_t n_total_args, const byte *code, mp_uint_t len);
+mp_uint_t mp_bytecode_get_source_line(const byte *code_info, const byte *ip, qstr *block_name, qstr *source_file);
+mp_uint_t mp_bytecode_get_first_line(const byte *code_info, qstr *block_name, qstr *source_file);
+void mp_bytecode_print(const void *descr, mp_uint_t n_total_args, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const byte *code, mp_uint_t len);
 const byte *mp_bytecode_print_str(const byte *ip);
 #define mp_bytecode_print_inst(code) mp_bytecode_print2(code, 1)
+void mp_bytecode_print_opcode_stats(const mp_print_t *print, mp_uint_t n);
+
+#if MICROPY_VM_SAMPLE_PROFILE
+// called by the port's timer interrupt to take a sample
+void mp_vm_sample(void);
+// provided by the port: sample every period_us microseconds, or stop if 0
+void mp_hal_sample_timer(mp_uint_t period_us);
+#endif
+
+#if MICROPY_PERSISTENT_CODE_SAVE
+// the format of an opcode's main argument, as returned by mp_opcode_format
+#define MP_OPCODE_BYTE (0) // no argument, or only byte-sized ones
+#define MP_OPCODE_QSTR (1) // 2-byte qstr
+#define MP_OPCODE_VAR_UINT (2) // var-uint, or signed var-int
+#define MP_OPCODE_OFFSET (3) // 2-byte jump offset
+
+uint mp_opcode_format(const byte *ip, mp_uint_t *opcode_size);
+#endif
 
 // Helper macros to access pointer with least significant bits holding flags
 #define MP_TAGPTR_PTR(x) ((void*)((mp_uint_t)(x) & ~((mp_uint_t)3)))
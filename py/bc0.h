@@ -83,6 +83,16 @@
 
 #define MP_BC_NOT                (0x47)
 
+// fused opcodes, emitted only if MICROPY_OPT_FUSED_OPCODES is enabled
+// the arguments are: local num, binary op, signed small int
+#define MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT   (0x48) // byte, byte, byte
+#define MP_BC_STORE_FAST_BINARY_OP_SMALL_INT  (0x49) // byte, byte, byte
+#define MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE  (0x4a) // byte, byte, byte, rel byte code offset, 16-bit signed, in excess
+#define MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE (0x4b) // byte, byte, byte, rel byte code offset, 16-bit signed, in excess
+
+// emitted only if MICROPY_OPT_FOR_RANGE is enabled; the step is a signed byte
+#define MP_BC_FOR_RANGE_SMALL_INT (0x4c) // rel byte code offset, 16-bit unsigned; then a byte
+
 #define MP_BC_BUILD_TUPLE        (0x50) // uint
 #define MP_BC_BUILD_LIST         (0x51) // uint
 #define MP_BC_LIST_APPEND        (0x52) // uint
@@ -29,6 +29,15 @@
 #include "py/obj.h"
 
 mp_obj_t mp_builtin___import__(mp_uint_t n_args, const mp_obj_t *args);
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+// Forget the cached directory listings; called when the filesystem changes
+void mp_import_cache_clear(void);
+#endif
+
+#if MICROPY_MODULE_LAZY_SUBMODULES
+mp_obj_t mp_import_submodule_maybe(mp_obj_t package, qstr attr);
+#endif
 mp_obj_t mp_builtin_open(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwargs);
 mp_obj_t mp_micropython_mem_info(mp_uint_t n_args, const mp_obj_t *args);
 
@@ -90,6 +99,7 @@ extern const mp_obj_module_t mp_module_micropython;
 extern const mp_obj_module_t mp_module_ustruct;
 extern const mp_obj_module_t mp_module_sys;
 extern const mp_obj_module_t mp_module_gc;
+extern const mp_obj_module_t mp_module_thread;
 
 extern const mp_obj_dict_t mp_module_builtins_globals;
 
@@ -101,6 +111,13 @@ extern const mp_obj_module_t mp_module_ure;
 extern const mp_obj_module_t mp_module_uheapq;
 extern const mp_obj_module_t mp_module_uhashlib;
 extern const mp_obj_module_t mp_module_ubinascii;
+extern const mp_obj_module_t mp_module_ucryptolib;
 extern const mp_obj_module_t mp_module_machine;
+extern const mp_obj_module_t mp_module_uasyncio;
+extern const mp_obj_module_t mp_module_uringbuf;
+extern const mp_obj_module_t mp_module_uweakref;
+extern const mp_obj_module_t mp_module_urandom;
+extern const mp_obj_module_t mp_module_framebuf;
+extern const mp_obj_module_t mp_module_uhttp;
 
 #endif // __MICROPY_INCLUDED_PY_BUILTIN_H__
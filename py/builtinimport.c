@@ -60,20 +60,135 @@ bool mp_obj_is_package(mp_obj_t module) {
     return dest[0] != MP_OBJ_NULL;
 }
 
+#if MICROPY_MODULE_LISTDIR_CACHE
+
+// A listing is a bytes object holding, for each entry, its kind (the value
+// of mp_import_stat_t) in one byte followed by its name and a null byte.
+
+void mp_import_listdir_add(void *env, const char *name, mp_import_stat_t stat) {
+    vstr_t *listing = env;
+    size_t len = strlen(name);
+    if (stat == MP_IMPORT_STAT_FILE
+        && !(len > 3 && strcmp(name + len - 3, ".py") == 0)
+        && !(len > 4 && strcmp(name + len - 4, ".mpy") == 0)) {
+        // only modules are looked up
+        return;
+    }
+    vstr_add_byte(listing, stat);
+    vstr_add_strn(listing, name, len + 1);
+}
+
+void mp_import_cache_clear(void) {
+    mp_map_clear(&MP_STATE_VM(mp_import_listdir_cache));
+}
+
+// Find path in the listing of its directory, listing the directory first
+// if it isn't in the cache.
+STATIC mp_import_stat_t import_stat(const char *path) {
+    const char *name = strrchr(path, PATH_SEP_CHAR);
+    size_t dir_len;
+    if (name == NULL) {
+        name = path;
+        dir_len = 0;
+    } else {
+        dir_len = name == path ? 1 : name - path;
+        name += 1;
+    }
+    mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_VM(mp_import_listdir_cache),
+        MP_OBJ_NEW_QSTR(qstr_from_strn(path, dir_len)), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    if (elem->value == MP_OBJ_NULL) {
+        char *dir = alloca(dir_len + 1);
+        memcpy(dir, path, dir_len);
+        dir[dir_len] = '\0';
+        vstr_t listing;
+        vstr_init(&listing, 16);
+        if (mp_import_listdir(dir, &listing)) {
+            elem->value = mp_obj_new_str_from_vstr(&mp_type_bytes, &listing);
+        } else {
+            vstr_clear(&listing);
+            elem->value = mp_const_none;
+        }
+    }
+    if (elem->value == mp_const_none) {
+        // the directory couldn't be listed
+        return mp_import_stat(path);
+    }
+    mp_uint_t len;
+    const char *entry = mp_obj_str_get_data(elem->value, &len);
+    const char *top = entry + len;
+    while (entry < top) {
+        size_t entry_len = strlen(entry + 1);
+        if (strcmp(entry + 1, name) == 0) {
+            return entry[0];
+        }
+        entry += 2 + entry_len;
+    }
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+#else
+
+#define import_stat(path) mp_import_stat(path)
+
+#endif
+
 STATIC mp_import_stat_t stat_dir_or_file(vstr_t *path) {
-    mp_import_stat_t stat = mp_import_stat(vstr_null_terminated_str(path));
+    mp_import_stat_t stat = import_stat(vstr_null_terminated_str(path));
     DEBUG_printf("stat %s: %d\n", vstr_str(path), stat);
     if (stat == MP_IMPORT_STAT_DIR) {
         return stat;
     }
+    #if MICROPY_PERSISTENT_CODE_LOAD
+    // precompiled bytecode takes precedence over source
+    vstr_add_str(path, ".mpy");
+    stat = import_stat(vstr_null_terminated_str(path));
+    if (stat == MP_IMPORT_STAT_FILE) {
+        return stat;
+    }
+    vstr_cut_tail_bytes(path, 4);
+    #endif
     vstr_add_str(path, ".py");
-    stat = mp_import_stat(vstr_null_terminated_str(path));
+    stat = import_stat(vstr_null_terminated_str(path));
     if (stat == MP_IMPORT_STAT_FILE) {
         return stat;
     }
     return MP_IMPORT_STAT_NO_EXIST;
 }
 
+#if MICROPY_MODULE_LAZY_SUBMODULES
+// Import the submodule attr of package if there is one in the package's
+// directory, returning MP_OBJ_NULL if there isn't or package is a module.
+mp_obj_t mp_import_submodule_maybe(mp_obj_t package, qstr attr) {
+    mp_obj_module_t *self = package;
+    mp_map_elem_t *elem = mp_map_lookup(&self->globals->map, MP_OBJ_NEW_QSTR(MP_QSTR___path__), MP_MAP_LOOKUP);
+    if (elem == NULL || !MP_OBJ_IS_STR(elem->value)) {
+        return MP_OBJ_NULL;
+    }
+    mp_uint_t pkg_path_len;
+    const char *pkg_path = mp_obj_str_get_data(elem->value, &pkg_path_len);
+    VSTR_FIXED(path, MICROPY_ALLOC_PATH_MAX)
+    vstr_add_strn(&path, pkg_path, pkg_path_len);
+    vstr_add_char(&path, PATH_SEP_CHAR);
+    vstr_add_str(&path, qstr_str(attr));
+    if (stat_dir_or_file(&path) == MP_IMPORT_STAT_NO_EXIST) {
+        return MP_OBJ_NULL;
+    }
+
+    // import it by its full name, which also stores it in the package
+    vstr_reset(&path);
+    vstr_add_str(&path, qstr_str(self->name));
+    vstr_add_char(&path, '.');
+    vstr_add_str(&path, qstr_str(attr));
+    mp_obj_t args[5];
+    args[0] = MP_OBJ_NEW_QSTR(qstr_from_strn(vstr_str(&path), vstr_len(&path)));
+    args[1] = mp_const_none;
+    args[2] = mp_const_none;
+    args[3] = mp_const_true; // return the leaf module
+    args[4] = MP_OBJ_NEW_SMALL_INT(0);
+    return mp_builtin___import__(5, args);
+}
+#endif
+
 STATIC mp_import_stat_t find_file(const char *file_str, uint file_len, vstr_t *dest) {
 #if MICROPY_PY_SYS
     // extract the list of paths
@@ -132,9 +247,53 @@ STATIC void do_load_from_lexer(mp_obj_t module_obj, mp_lexer_t *lex, const char
     mp_parse_compile_execute(lex, MP_PARSE_FILE_INPUT, mod_globals, mod_globals);
 }
 
+#if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_MODULE_FROZEN_MPY
+STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code) {
+    // execute the module in its context
+    mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
+
+    // save context
+    mp_obj_dict_t *volatile old_globals = mp_globals_get();
+    mp_obj_dict_t *volatile old_locals = mp_locals_get();
+
+    // set new context
+    mp_globals_set(mod_globals);
+    mp_locals_set(mod_globals);
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t module_fun = mp_make_function_from_raw_code(raw_code, MP_OBJ_NULL, MP_OBJ_NULL);
+        mp_call_function_0(module_fun);
+
+        // finish nlr block, restore context
+        nlr_pop();
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+    } else {
+        // exception; restore context and re-raise same exception
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+        nlr_raise(nlr.ret_val);
+    }
+}
+#endif
+
 STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
-    // create the lexer
     char *file_str = vstr_null_terminated_str(file);
+
+    #if MICROPY_PERSISTENT_CODE_LOAD
+    // if the file is precompiled bytecode then load and execute it directly
+    if (vstr_len(file) > 4 && strcmp(file_str + vstr_len(file) - 4, ".mpy") == 0) {
+        #if MICROPY_PY___FILE__
+        mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(qstr_from_str(file_str)));
+        #endif
+        mp_raw_code_t *raw_code = mp_raw_code_load_file(file_str);
+        do_execute_raw_code(module_obj, raw_code);
+        return;
+    }
+    #endif
+
+    // create the lexer
     mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
     do_load_from_lexer(module_obj, lex, file_str);
 }
@@ -273,6 +432,15 @@ mp_obj_t mp_builtin___import__(mp_uint_t n_args, const mp_obj_t *args) {
     }
     #endif
 
+    #if MICROPY_MODULE_FROZEN_MPY
+    const mp_raw_code_t *raw_code = mp_find_frozen_mpy(mod_str, mod_len);
+    if (raw_code != NULL) {
+        module_obj = mp_obj_new_module(module_name_qstr);
+        do_execute_raw_code(module_obj, (mp_raw_code_t*)raw_code);
+        return module_obj;
+    }
+    #endif
+
     uint last = 0;
     VSTR_FIXED(path, MICROPY_ALLOC_PATH_MAX)
     module_obj = MP_OBJ_NULL;
@@ -347,7 +515,7 @@ mp_obj_t mp_builtin___import__(mp_uint_t n_args, const mp_obj_t *args) {
                     mp_store_attr(module_obj, MP_QSTR___path__, mp_obj_new_str(vstr_str(&path), vstr_len(&path), false));
                     vstr_add_char(&path, PATH_SEP_CHAR);
                     vstr_add_str(&path, "__init__.py");
-                    if (mp_import_stat(vstr_null_terminated_str(&path)) != MP_IMPORT_STAT_FILE) {
+                    if (import_stat(vstr_null_terminated_str(&path)) != MP_IMPORT_STAT_FILE) {
                         vstr_cut_tail_bytes(&path, sizeof("/__init__.py") - 1); // cut off /__init__.py
                         mp_warning("%s is imported as namespace package", vstr_str(&path));
                     } else {
@@ -36,6 +36,10 @@
 #include "py/smallint.h"
 #include "py/runtime.h"
 #include "py/builtin.h"
+#include "py/nlr.h"
+#include "py/objstr.h"
+#include "py/objtuple.h"
+#include "py/bc.h"
 
 // TODO need to mangle __attr names
 
@@ -74,6 +78,7 @@ typedef enum {
 // elements in this struct are ordered to make it compact
 typedef struct _compiler_t {
     qstr source_file;
+    mp_parse_tree_t *parse_tree; // scopes and folded nodes are allocated from this
 
     uint8_t is_repl;
     uint8_t pass; // holds enum type pass_kind_t
@@ -131,6 +136,259 @@ STATIC const mp_map_elem_t mp_constants_table[] = {
 STATIC MP_DEFINE_CONST_MAP(mp_constants_map, mp_constants_table);
 #endif
 
+#if MICROPY_COMP_CONST_FOLDING_OBJ
+// longest sequence that is made at compile time by multiplying a constant
+#define FOLD_SEQ_MUL_MAX_LEN (20)
+
+// returns true if pn is a constant, in which case its value is put in *o
+STATIC bool fold_get_const(mp_parse_node_t pn, mp_obj_t *o) {
+    if (MP_PARSE_NODE_IS_SMALL_INT(pn)) {
+        *o = MP_OBJ_NEW_SMALL_INT(MP_PARSE_NODE_LEAF_SMALL_INT(pn));
+    } else if (MP_PARSE_NODE_IS_LEAF(pn)) {
+        mp_uint_t arg = MP_PARSE_NODE_LEAF_ARG(pn);
+        switch (MP_PARSE_NODE_LEAF_KIND(pn)) {
+            case MP_PARSE_NODE_STRING: *o = MP_OBJ_NEW_QSTR(arg); break;
+            case MP_PARSE_NODE_BYTES: {
+                mp_uint_t len;
+                const byte *data = qstr_data(arg, &len);
+                *o = mp_obj_new_bytes(data, len);
+                break;
+            }
+            case MP_PARSE_NODE_TOKEN:
+                switch (arg) {
+                    case MP_TOKEN_KW_NONE: *o = mp_const_none; break;
+                    case MP_TOKEN_KW_FALSE: *o = mp_const_false; break;
+                    case MP_TOKEN_KW_TRUE: *o = mp_const_true; break;
+                    case MP_TOKEN_ELLIPSIS: *o = (mp_obj_t)&mp_const_ellipsis_obj; break;
+                    default: return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_const_object)) {
+        *o = (mp_obj_t)((mp_parse_node_struct_t*)pn)->nodes[0];
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_string) || MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_bytes)) {
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+        if (MP_PARSE_NODE_STRUCT_KIND(pns) == PN_string) {
+            *o = mp_obj_new_str((const char*)pns->nodes[0], pns->nodes[1], false);
+        } else {
+            *o = mp_obj_new_bytes((const byte*)pns->nodes[0], pns->nodes[1]);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// makes a parse node holding the constant o, in the same form the parser would use
+STATIC mp_parse_node_t fold_make_node(compiler_t *comp, mp_parse_node_struct_t *pns_src, mp_obj_t o) {
+    if (MP_OBJ_IS_SMALL_INT(o)) {
+        return mp_parse_node_new_leaf(MP_PARSE_NODE_SMALL_INT, MP_OBJ_SMALL_INT_VALUE(o));
+    } else if (MP_OBJ_IS_QSTR(o)) {
+        return mp_parse_node_new_leaf(MP_PARSE_NODE_STRING, MP_OBJ_QSTR_VALUE(o));
+    } else if (o == mp_const_none) {
+        return mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN, MP_TOKEN_KW_NONE);
+    } else if (o == mp_const_false) {
+        return mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN, MP_TOKEN_KW_FALSE);
+    } else if (o == mp_const_true) {
+        return mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN, MP_TOKEN_KW_TRUE);
+    } else if (MP_OBJ_IS_STR_OR_BYTES(o)) {
+        // intern short strings/bytes, like the parser does
+        mp_uint_t len;
+        const char *str = mp_obj_str_get_data(o, &len);
+        if (len <= MICROPY_ALLOC_PARSE_INTERN_STRING_LEN) {
+            return mp_parse_node_new_leaf(MP_OBJ_IS_STR(o) ? MP_PARSE_NODE_STRING : MP_PARSE_NODE_BYTES, qstr_from_strn(str, len));
+        }
+    }
+    mp_parse_node_struct_t *pn = mp_parse_tree_alloc(comp->parse_tree, sizeof(mp_parse_node_struct_t) + sizeof(mp_parse_node_t));
+    pn->source_line = pns_src->source_line;
+    pn->kind_num_nodes = PN_const_object | (1 << 8);
+    pn->nodes[0] = (mp_uint_t)o;
+    return (mp_parse_node_t)pn;
+}
+
+// whether an object is a constant that can be embedded in the bytecode
+STATIC bool fold_is_const(mp_obj_t o) {
+    return MP_OBJ_IS_INT(o) || o == mp_const_none || o == mp_const_false || o == mp_const_true
+        || MP_OBJ_IS_STR_OR_BYTES(o) || MP_OBJ_IS_TYPE(o, &mp_type_tuple)
+        #if MICROPY_PY_BUILTINS_FLOAT
+        || mp_obj_is_float(o)
+        #endif
+        #if MICROPY_PY_BUILTINS_COMPLEX
+        || MP_OBJ_IS_TYPE(o, &mp_type_complex)
+        #endif
+        ;
+}
+
+// evaluates a binary operation on constants now, returning MP_OBJ_NULL if it
+// raises or if the result could be unreasonably big to keep in the bytecode
+STATIC mp_obj_t fold_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t res = mp_binary_op(op, lhs, rhs);
+        nlr_pop();
+        if (!fold_is_const(res)) {
+            return MP_OBJ_NULL;
+        }
+        if (MP_OBJ_IS_TYPE(res, &mp_type_int) && (op == MP_BINARY_OP_POWER || op == MP_BINARY_OP_LSHIFT)) {
+            return MP_OBJ_NULL;
+        }
+        if (op == MP_BINARY_OP_MULTIPLY && !MP_OBJ_IS_INT(res)) {
+            mp_obj_t len = mp_obj_len_maybe(res);
+            if (len != MP_OBJ_NULL && MP_OBJ_SMALL_INT_VALUE(len) > FOLD_SEQ_MUL_MAX_LEN) {
+                return MP_OBJ_NULL;
+            }
+        }
+        return res;
+    }
+    return MP_OBJ_NULL;
+}
+
+STATIC mp_binary_op_t fold_token_to_op(mp_parse_node_t pn) {
+    switch (MP_PARSE_NODE_LEAF_ARG(pn)) {
+        case MP_TOKEN_OP_DBL_LESS: return MP_BINARY_OP_LSHIFT;
+        case MP_TOKEN_OP_DBL_MORE: return MP_BINARY_OP_RSHIFT;
+        case MP_TOKEN_OP_PLUS: return MP_BINARY_OP_ADD;
+        case MP_TOKEN_OP_MINUS: return MP_BINARY_OP_SUBTRACT;
+        case MP_TOKEN_OP_STAR: return MP_BINARY_OP_MULTIPLY;
+        case MP_TOKEN_OP_DBL_SLASH: return MP_BINARY_OP_FLOOR_DIVIDE;
+        case MP_TOKEN_OP_SLASH: return MP_BINARY_OP_TRUE_DIVIDE;
+        case MP_TOKEN_OP_PERCENT: return MP_BINARY_OP_MODULO;
+        case MP_TOKEN_OP_LESS: return MP_BINARY_OP_LESS;
+        case MP_TOKEN_OP_MORE: return MP_BINARY_OP_MORE;
+        case MP_TOKEN_OP_DBL_EQUAL: return MP_BINARY_OP_EQUAL;
+        case MP_TOKEN_OP_LESS_EQUAL: return MP_BINARY_OP_LESS_EQUAL;
+        case MP_TOKEN_OP_MORE_EQUAL: return MP_BINARY_OP_MORE_EQUAL;
+        case MP_TOKEN_OP_NOT_EQUAL: default: return MP_BINARY_OP_NOT_EQUAL;
+    }
+}
+
+// makes a tuple from n constant nodes, returning MP_OBJ_NULL if they aren't all constant
+STATIC mp_obj_t fold_tuple(mp_parse_node_t pn_first, int n, mp_parse_node_t *nodes) {
+    mp_obj_tuple_t *tuple = (mp_obj_tuple_t*)mp_obj_new_tuple(n + (pn_first != MP_PARSE_NODE_NULL), NULL);
+    mp_obj_t *item = tuple->items;
+    if (pn_first != MP_PARSE_NODE_NULL && !fold_get_const(pn_first, item++)) {
+        return MP_OBJ_NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!fold_get_const(nodes[i], item++)) {
+            return MP_OBJ_NULL;
+        }
+    }
+    return tuple;
+}
+
+// folds operations on constant objects that aren't all small ints, such as
+// floats, strings and tuples, by evaluating them with the runtime
+STATIC mp_parse_node_t fold_constants_obj(compiler_t *comp, mp_parse_node_struct_t *pns) {
+    int n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+    mp_obj_t arg0, arg1;
+    mp_obj_t res = MP_OBJ_NULL;
+    switch (MP_PARSE_NODE_STRUCT_KIND(pns)) {
+        case PN_atom_paren:
+            if (MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[0], PN_testlist_comp)) {
+                // a tuple, or a generator expression which is never constant
+                mp_parse_node_struct_t *pns0 = (mp_parse_node_struct_t*)pns->nodes[0];
+                if (MP_PARSE_NODE_IS_STRUCT_KIND(pns0->nodes[1], PN_testlist_comp_3b)) {
+                    res = fold_tuple(pns0->nodes[0], 0, NULL);
+                } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pns0->nodes[1], PN_testlist_comp_3c)) {
+                    mp_parse_node_struct_t *pns1 = (mp_parse_node_struct_t*)pns0->nodes[1];
+                    res = fold_tuple(pns0->nodes[0], MP_PARSE_NODE_STRUCT_NUM_NODES(pns1), pns1->nodes);
+                } else if (!MP_PARSE_NODE_IS_STRUCT_KIND(pns0->nodes[1], PN_comp_for)) {
+                    res = fold_tuple(MP_PARSE_NODE_NULL, 2, pns0->nodes);
+                }
+            } else if (fold_get_const(pns->nodes[0], &arg0)) {
+                // (const)
+                return pns->nodes[0];
+            }
+            break;
+
+        case PN_expr:
+        case PN_xor_expr:
+        case PN_and_expr: {
+            // the operator is implied by the node kind
+            mp_binary_op_t op = MP_PARSE_NODE_STRUCT_KIND(pns) == PN_expr ? MP_BINARY_OP_OR
+                : MP_PARSE_NODE_STRUCT_KIND(pns) == PN_xor_expr ? MP_BINARY_OP_XOR : MP_BINARY_OP_AND;
+            if (!fold_get_const(pns->nodes[0], &res)) {
+                return (mp_parse_node_t)pns;
+            }
+            for (int i = 1; i < n && res != MP_OBJ_NULL; i++) {
+                if (!fold_get_const(pns->nodes[i], &arg1)) {
+                    return (mp_parse_node_t)pns;
+                }
+                res = fold_binary_op(op, res, arg1);
+            }
+            break;
+        }
+
+        case PN_shift_expr:
+        case PN_arith_expr:
+        case PN_term:
+            // operands alternate with operator tokens
+            if (!fold_get_const(pns->nodes[0], &res)) {
+                return (mp_parse_node_t)pns;
+            }
+            for (int i = 1; i + 1 < n && res != MP_OBJ_NULL; i += 2) {
+                if (!fold_get_const(pns->nodes[i + 1], &arg1)) {
+                    return (mp_parse_node_t)pns;
+                }
+                res = fold_binary_op(fold_token_to_op(pns->nodes[i]), res, arg1);
+            }
+            break;
+
+        case PN_comparison:
+            // only a single comparison, and not "in", "not in", "is" or "is not"
+            if (n == 3 && MP_PARSE_NODE_IS_TOKEN(pns->nodes[1]) && !MP_PARSE_NODE_IS_TOKEN_KIND(pns->nodes[1], MP_TOKEN_KW_IN)
+                && fold_get_const(pns->nodes[0], &arg0) && fold_get_const(pns->nodes[2], &arg1)) {
+                res = fold_binary_op(fold_token_to_op(pns->nodes[1]), arg0, arg1);
+            }
+            break;
+
+        case PN_not_test_2:
+            if (fold_get_const(pns->nodes[0], &arg0)) {
+                res = mp_obj_is_true(arg0) ? mp_const_false : mp_const_true;
+            }
+            break;
+
+        case PN_factor_2:
+            if (fold_get_const(pns->nodes[1], &arg0)) {
+                mp_unary_op_t op;
+                if (MP_PARSE_NODE_IS_TOKEN_KIND(pns->nodes[0], MP_TOKEN_OP_PLUS)) {
+                    op = MP_UNARY_OP_POSITIVE;
+                } else if (MP_PARSE_NODE_IS_TOKEN_KIND(pns->nodes[0], MP_TOKEN_OP_MINUS)) {
+                    op = MP_UNARY_OP_NEGATIVE;
+                } else {
+                    op = MP_UNARY_OP_INVERT;
+                }
+                nlr_buf_t nlr;
+                if (nlr_push(&nlr) == 0) {
+                    res = mp_unary_op(op, arg0);
+                    nlr_pop();
+                    if (!fold_is_const(res)) {
+                        res = MP_OBJ_NULL;
+                    }
+                }
+            }
+            break;
+
+        case PN_power:
+            // const ** const
+            if (MP_PARSE_NODE_IS_NULL(pns->nodes[1]) && MP_PARSE_NODE_IS_STRUCT_KIND(pns->nodes[2], PN_power_dbl_star)
+                && fold_get_const(pns->nodes[0], &arg0)
+                && fold_get_const(((mp_parse_node_struct_t*)pns->nodes[2])->nodes[0], &arg1)) {
+                res = fold_binary_op(MP_BINARY_OP_POWER, arg0, arg1);
+            }
+            break;
+    }
+
+    if (res == MP_OBJ_NULL) {
+        return (mp_parse_node_t)pns;
+    }
+    return fold_make_node(comp, pns, res);
+}
+#endif
+
 // this function is essentially a simple preprocessor
 STATIC mp_parse_node_t fold_constants(compiler_t *comp, mp_parse_node_t pn, mp_map_t *consts) {
     if (0) {
@@ -289,8 +547,10 @@ STATIC mp_parse_node_t fold_constants(compiler_t *comp, mp_parse_node_t pn, mp_m
                         // int / int
                         // pass
                     } else if (MP_PARSE_NODE_IS_TOKEN_KIND(pns->nodes[1], MP_TOKEN_OP_PERCENT)) {
-                        // int%int
-                        pn = mp_parse_node_new_leaf(MP_PARSE_NODE_SMALL_INT, mp_small_int_modulo(arg0, arg1));
+                        if (arg1 != 0) {
+                            // int%int
+                            pn = mp_parse_node_new_leaf(MP_PARSE_NODE_SMALL_INT, mp_small_int_modulo(arg0, arg1));
+                        }
                     } else {
                         assert(MP_PARSE_NODE_IS_TOKEN_KIND(pns->nodes[1], MP_TOKEN_OP_DBL_SLASH)); // should be
                         if (arg1 != 0) {
@@ -358,6 +618,13 @@ STATIC mp_parse_node_t fold_constants(compiler_t *comp, mp_parse_node_t pn, mp_m
                 }
                 break;
         }
+
+        #if MICROPY_COMP_CONST_FOLDING_OBJ
+        if (pn == (mp_parse_node_t)pns) {
+            // not folded as small ints, so try with general constant objects
+            pn = fold_constants_obj(comp, pns);
+        }
+        #endif
     }
 
     return pn;
@@ -371,6 +638,19 @@ STATIC uint comp_next_label(compiler_t *comp) {
     return comp->next_label++;
 }
 
+// The native emitter needs a label for each finally handler that a jump out
+// of a try block goes through, so reserve them while the labels are counted.
+STATIC void compile_reserve_unwind_labels(compiler_t *comp, uint except_depth) {
+    #if MICROPY_EMIT_NATIVE
+    if (comp->pass == MP_PASS_SCOPE) {
+        comp->next_label += except_depth;
+    }
+    #else
+    (void)comp;
+    (void)except_depth;
+    #endif
+}
+
 STATIC void compile_increase_except_level(compiler_t *comp) {
     comp->cur_except_level += 1;
     if (comp->cur_except_level > comp->scope_cur->exc_stack_size) {
@@ -384,7 +664,7 @@ STATIC void compile_decrease_except_level(compiler_t *comp) {
 }
 
 STATIC scope_t *scope_new_and_link(compiler_t *comp, scope_kind_t kind, mp_parse_node_t pn, uint emit_options) {
-    scope_t *scope = scope_new(kind, pn, comp->source_file, emit_options);
+    scope_t *scope = scope_new(comp->parse_tree, kind, pn, comp->source_file, emit_options);
     scope->parent = comp->scope_cur;
     scope->next = NULL;
     if (comp->scope_head == NULL) {
@@ -413,10 +693,47 @@ STATIC void apply_to_single_or_list(compiler_t *comp, mp_parse_node_t pn, pn_kin
     }
 }
 
+#if !MICROPY_EMIT_CPYTHON
+// whether the statement unconditionally leaves the block it is in
+STATIC bool node_is_block_exit(mp_parse_node_t pn) {
+    if (!MP_PARSE_NODE_IS_STRUCT(pn)) {
+        return false;
+    }
+    mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+    switch (MP_PARSE_NODE_STRUCT_KIND(pns)) {
+        case PN_return_stmt:
+        case PN_raise_stmt:
+        case PN_break_stmt:
+        case PN_continue_stmt:
+            return true;
+        case PN_simple_stmt_2: {
+            // a; b; c
+            int n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
+            for (int i = 0; i < n; i++) {
+                if (node_is_block_exit(pns->nodes[i])) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+#endif
+
 STATIC void compile_generic_all_nodes(compiler_t *comp, mp_parse_node_struct_t *pns) {
     int num_nodes = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
     for (int i = 0; i < num_nodes; i++) {
         compile_node(comp, pns->nodes[i]);
+        #if !MICROPY_EMIT_CPYTHON
+        // optimisation: don't emit the unreachable statements that follow a
+        // return/raise/break/continue; they are still seen by the scope pass
+        // so that the kind of each variable is the same as in CPython
+        if (comp->pass > MP_PASS_SCOPE && node_is_block_exit(pns->nodes[i])) {
+            break;
+        }
+        #endif
     }
 }
 
@@ -634,14 +951,19 @@ STATIC void compile_generic_tuple(compiler_t *comp, mp_parse_node_struct_t *pns)
     c_tuple(comp, MP_PARSE_NODE_NULL, pns);
 }
 
+STATIC bool node_is_const_true(mp_parse_node_t pn);
+
 STATIC bool node_is_const_false(mp_parse_node_t pn) {
     return MP_PARSE_NODE_IS_TOKEN_KIND(pn, MP_TOKEN_KW_FALSE)
-        || (MP_PARSE_NODE_IS_SMALL_INT(pn) && MP_PARSE_NODE_LEAF_SMALL_INT(pn) == 0);
+        || MP_PARSE_NODE_IS_TOKEN_KIND(pn, MP_TOKEN_KW_NONE)
+        || (MP_PARSE_NODE_IS_SMALL_INT(pn) && MP_PARSE_NODE_LEAF_SMALL_INT(pn) == 0)
+        || (MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_not_test_2) && node_is_const_true(((mp_parse_node_struct_t*)pn)->nodes[0]));
 }
 
 STATIC bool node_is_const_true(mp_parse_node_t pn) {
     return MP_PARSE_NODE_IS_TOKEN_KIND(pn, MP_TOKEN_KW_TRUE)
-        || (MP_PARSE_NODE_IS_SMALL_INT(pn) && MP_PARSE_NODE_LEAF_SMALL_INT(pn) != 0);
+        || (MP_PARSE_NODE_IS_SMALL_INT(pn) && MP_PARSE_NODE_LEAF_SMALL_INT(pn) != 0)
+        || (MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_not_test_2) && node_is_const_false(((mp_parse_node_struct_t*)pn)->nodes[0]));
 }
 
 #if MICROPY_EMIT_CPYTHON
@@ -1381,6 +1703,7 @@ STATIC void compile_break_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
         compile_syntax_error(comp, (mp_parse_node_t)pns, "'break' outside loop");
     }
     assert(comp->cur_except_level >= comp->break_continue_except_level);
+    compile_reserve_unwind_labels(comp, comp->cur_except_level - comp->break_continue_except_level);
     EMIT_ARG(break_loop, comp->break_label, comp->cur_except_level - comp->break_continue_except_level);
 }
 
@@ -1389,6 +1712,7 @@ STATIC void compile_continue_stmt(compiler_t *comp, mp_parse_node_struct_t *pns)
         compile_syntax_error(comp, (mp_parse_node_t)pns, "'continue' outside loop");
     }
     assert(comp->cur_except_level >= comp->break_continue_except_level);
+    compile_reserve_unwind_labels(comp, comp->cur_except_level - comp->break_continue_except_level);
     EMIT_ARG(continue_loop, comp->continue_label, comp->cur_except_level - comp->break_continue_except_level);
 }
 
@@ -1397,6 +1721,8 @@ STATIC void compile_return_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
         compile_syntax_error(comp, (mp_parse_node_t)pns, "'return' outside function");
         return;
     }
+    // there may be 2 return_value's below
+    compile_reserve_unwind_labels(comp, 2 * comp->cur_except_level);
     if (MP_PARSE_NODE_IS_NULL(pns->nodes[0])) {
         // no argument to 'return', so return None
         EMIT_ARG(load_const_tok, MP_TOKEN_KW_NONE);
@@ -1662,6 +1988,16 @@ STATIC void compile_declare_nonlocal(compiler_t *comp, mp_parse_node_t pn, qstr
     }
     id_info->kind = ID_INFO_KIND_FREE;
     scope_close_over_in_parents(comp->scope_cur, qst);
+    // the variable may be assigned to from here, so it can't be closed over by value
+    for (scope_t *s = comp->scope_cur->parent; s->parent != NULL; s = s->parent) {
+        id_info2 = scope_find(s, qst);
+        if (id_info2 != NULL) {
+            id_info2->flags |= ID_FLAG_IS_REBOUND;
+            if (id_info2->kind != ID_INFO_KIND_FREE) {
+                break;
+            }
+        }
+    }
 }
 
 STATIC void compile_nonlocal_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
@@ -1824,10 +2160,57 @@ STATIC void compile_while_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
 //  - assignments to <var>, <end> or <step> in the body do not alter the loop
 //    (<step> is a constant for us, so no need to worry about it changing)
 //
-// If <end> is a small-int, then the stack during the for-loop contains just
-// the current value of <var>.  Otherwise, the stack contains <end> then the
-// current value of <var>.
+// With MICROPY_OPT_FOR_RANGE and a <step> that fits in a byte, the stack during
+// the for-loop contains <end> then the current value of <var>, and the
+// FOR_RANGE_SMALL_INT opcode does the compare, the increment and the jump out
+// of the loop in one go.
+#if MICROPY_OPT_FOR_RANGE
+STATIC void compile_for_stmt_range_small_int(compiler_t *comp, mp_parse_node_t pn_var, mp_parse_node_t pn_start, mp_parse_node_t pn_end, mp_int_t step, mp_parse_node_t pn_body, mp_parse_node_t pn_else) {
+    START_BREAK_CONTINUE_BLOCK
+
+    uint done_label = comp_next_label(comp);
+
+    // compile: end, start
+    compile_node(comp, pn_end);
+    compile_node(comp, pn_start);
+
+    // continue goes straight to the test, which also increments the counter
+    EMIT_ARG(label_assign, continue_label);
+    EMIT_ARG(for_range, step, done_label);
+    c_assign(comp, pn_var, ASSIGN_STORE);
+
+    // compile body
+    compile_node(comp, pn_body);
+    EMIT_ARG(jump, continue_label);
+
+    EMIT_ARG(label_assign, done_label);
+
+    // break/continue apply to outer loop (if any) in the else block
+    END_BREAK_CONTINUE_BLOCK
+
+    compile_node(comp, pn_else);
+
+    EMIT_ARG(label_assign, break_label);
+
+    // discard the counter and <end>
+    EMIT(pop_top);
+    EMIT(pop_top);
+}
+#endif
+
+// Without it (or for viper), if <end> is a small-int, then the stack during
+// the for-loop contains just the current value of <var>.  Otherwise, the stack
+// contains <end> then the current value of <var>.
 STATIC void compile_for_stmt_optimised_range(compiler_t *comp, mp_parse_node_t pn_var, mp_parse_node_t pn_start, mp_parse_node_t pn_end, mp_parse_node_t pn_step, mp_parse_node_t pn_body, mp_parse_node_t pn_else) {
+    #if MICROPY_OPT_FOR_RANGE
+    // viper keeps using the explicit loop below so <var> can have a native type
+    mp_int_t step = MP_PARSE_NODE_LEAF_SMALL_INT(pn_step);
+    if (comp->scope_cur->emit_options != MP_EMIT_OPT_VIPER && -128 <= step && step <= 127) {
+        compile_for_stmt_range_small_int(comp, pn_var, pn_start, pn_end, step, pn_body, pn_else);
+        return;
+    }
+    #endif
+
     START_BREAK_CONTINUE_BLOCK
 
     uint top_label = comp_next_label(comp);
@@ -3542,13 +3925,33 @@ STATIC void scope_compute_things(scope_t *scope) {
                     id_info_t temp = *id_param; *id_param = *id; *id = temp;
                 }
                 break;
-            } else if (id_param == NULL && id->flags == ID_FLAG_IS_PARAM) {
+            } else if (id_param == NULL && (id->flags & (ID_FLAG_IS_PARAM | ID_FLAG_IS_STAR_PARAM | ID_FLAG_IS_DBL_STAR_PARAM)) == ID_FLAG_IS_PARAM) {
                 id_param = id;
             }
         }
     }
 #endif
 
+#if MICROPY_COMP_CLOSURE_BY_VALUE && !MICROPY_EMIT_CPYTHON
+    // A param that is never rebound has the same value for the whole call, so
+    // a closure can take that value instead of a cell holding it.  The scopes
+    // are in order parent first, so a free var can follow its parent's choice.
+    for (int i = 0; i < scope->id_info_len; i++) {
+        id_info_t *id = &scope->id_info[i];
+        if (id->kind == ID_INFO_KIND_CELL) {
+            if ((id->flags & (ID_FLAG_IS_PARAM | ID_FLAG_IS_REBOUND)) == ID_FLAG_IS_PARAM
+                && scope->emit_options != MP_EMIT_OPT_VIPER) {
+                id->flags |= ID_FLAG_IS_BY_VALUE;
+            }
+        } else if (id->kind == ID_INFO_KIND_FREE) {
+            id_info_t *id_parent = scope_find_local_in_parent(scope, id->qst);
+            if (id_parent != NULL && (id_parent->flags & ID_FLAG_IS_BY_VALUE)) {
+                id->flags |= ID_FLAG_IS_BY_VALUE;
+            }
+        }
+    }
+#endif
+
     // in functions, turn implicit globals into explicit globals
     // compute the index of each local
     scope->num_locals = 0;
@@ -3654,21 +4057,49 @@ STATIC void scope_compute_things(scope_t *scope) {
     }
 }
 
-mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is_repl) {
+#if MICROPY_EMIT_NATIVE_JIT
+// Check if scope s was just compiled to bytecode with the given code-info,
+// which identifies a function by its name, source file and line numbers.
+STATIC bool compile_is_jit_target(scope_t *s, const byte *code_info) {
+    if (s->kind != SCOPE_FUNCTION || (s->scope_flags & MP_SCOPE_FLAG_GENERATOR)
+        || s->emit_options != MP_EMIT_OPT_NONE || s->raw_code->kind != MP_CODE_BYTECODE) {
+        return false;
+    }
+    const byte *ci1 = s->raw_code->data.u_byte.code;
+    const byte *ci2 = code_info;
+    mp_uint_t code_info_size = mp_decode_uint(&ci1);
+    return code_info_size == mp_decode_uint(&ci2)
+        && memcmp(s->raw_code->data.u_byte.code, code_info, code_info_size) == 0;
+}
+#endif
+
+// If jit_code_info is not NULL then the function it identifies is compiled to
+// native code, and its raw code is returned instead of that of the module.
+// If consts is not NULL then it holds the values of const() names, to be used
+// and added to, otherwise only the const() names in the tree are known.
+STATIC mp_raw_code_t *compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl, const byte *jit_code_info, mp_map_t *consts) {
+    #if !MICROPY_EMIT_NATIVE_JIT
+    (void)jit_code_info;
+    #endif
     compiler_t *comp = m_new0(compiler_t, 1);
     comp->source_file = source_file;
+    comp->parse_tree = parse_tree;
     comp->is_repl = is_repl;
     comp->compile_error = MP_OBJ_NULL;
 
     // create the module scope
-    scope_t *module_scope = scope_new_and_link(comp, SCOPE_MODULE, pn, emit_opt);
+    scope_t *module_scope = scope_new_and_link(comp, SCOPE_MODULE, parse_tree->root, emit_opt);
 
     // optimise constants (scope must be set for error messages to work)
     comp->scope_cur = module_scope;
-    mp_map_t consts;
-    mp_map_init(&consts, 0);
-    module_scope->pn = fold_constants(comp, module_scope->pn, &consts);
-    mp_map_deinit(&consts);
+    mp_map_t local_consts;
+    if (consts == NULL) {
+        mp_map_init(&local_consts, 0);
+        module_scope->pn = fold_constants(comp, module_scope->pn, &local_consts);
+        mp_map_deinit(&local_consts);
+    } else {
+        module_scope->pn = fold_constants(comp, module_scope->pn, consts);
+    }
 
     // create standard emitter; it's used at least for MP_PASS_SCOPE
     #if MICROPY_EMIT_CPYTHON
@@ -3729,7 +4160,10 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
     emit_inline_asm_t *emit_inline_thumb = NULL;
 #endif
 #endif // !MICROPY_EMIT_CPYTHON
-    for (scope_t *s = comp->scope_head; s != NULL && comp->compile_error == MP_OBJ_NULL; s = s->next) {
+#if MICROPY_EMIT_NATIVE_JIT
+    scope_t *jit_scope = NULL;
+#endif
+    for (scope_t *s = comp->scope_head; s != NULL && comp->compile_error == MP_OBJ_NULL;) {
         if (false) {
             // dummy
 
@@ -3764,24 +4198,29 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
                 case MP_EMIT_OPT_VIPER:
 #if MICROPY_EMIT_X64
                     if (emit_native == NULL) {
-                        emit_native = emit_native_x64_new(&comp->compile_error, max_num_labels);
+                        emit_native = emit_native_x64_new(&comp->compile_error, &comp->next_label, max_num_labels);
                     }
                     comp->emit_method_table = &emit_native_x64_method_table;
 #elif MICROPY_EMIT_X86
                     if (emit_native == NULL) {
-                        emit_native = emit_native_x86_new(&comp->compile_error, max_num_labels);
+                        emit_native = emit_native_x86_new(&comp->compile_error, &comp->next_label, max_num_labels);
                     }
                     comp->emit_method_table = &emit_native_x86_method_table;
 #elif MICROPY_EMIT_THUMB
                     if (emit_native == NULL) {
-                        emit_native = emit_native_thumb_new(&comp->compile_error, max_num_labels);
+                        emit_native = emit_native_thumb_new(&comp->compile_error, &comp->next_label, max_num_labels);
                     }
                     comp->emit_method_table = &emit_native_thumb_method_table;
 #elif MICROPY_EMIT_ARM
                     if (emit_native == NULL) {
-                        emit_native = emit_native_arm_new(&comp->compile_error, max_num_labels);
+                        emit_native = emit_native_arm_new(&comp->compile_error, &comp->next_label, max_num_labels);
                     }
                     comp->emit_method_table = &emit_native_arm_method_table;
+#elif MICROPY_EMIT_XTENSA
+                    if (emit_native == NULL) {
+                        emit_native = emit_native_xtensa_new(&comp->compile_error, &comp->next_label, max_num_labels);
+                    }
+                    comp->emit_method_table = &emit_native_xtensa_method_table;
 #endif
                     comp->emit = emit_native;
                     EMIT_ARG(set_native_type, MP_EMIT_NATIVE_TYPE_ENABLE, s->emit_options == MP_EMIT_OPT_VIPER, 0);
@@ -3810,6 +4249,18 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
                 compile_scope(comp, s, MP_PASS_EMIT);
             }
         }
+
+#if MICROPY_EMIT_NATIVE_JIT
+        if (jit_code_info != NULL && jit_scope == NULL && comp->compile_error == MP_OBJ_NULL
+            && compile_is_jit_target(s, jit_code_info)) {
+            // this is the function to promote, so compile it again to native code
+            s->emit_options = MP_EMIT_OPT_NATIVE_PYTHON;
+            jit_scope = s;
+            continue;
+        }
+#endif
+
+        s = s->next;
     }
 
     // free the emitters
@@ -3828,6 +4279,8 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
         emit_native_thumb_free(emit_native);
 #elif MICROPY_EMIT_ARM
         emit_native_arm_free(emit_native);
+#elif MICROPY_EMIT_XTENSA
+        emit_native_xtensa_free(emit_native);
 #endif
     }
 #endif
@@ -3838,16 +4291,15 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
 #endif
 #endif // MICROPY_EMIT_CPYTHON
 
-    // free the parse tree
-    mp_parse_node_free(module_scope->pn);
-
-    // free the scopes
     mp_raw_code_t *outer_raw_code = module_scope->raw_code;
-    for (scope_t *s = module_scope; s;) {
-        scope_t *next = s->next;
-        scope_free(s);
-        s = next;
+    #if MICROPY_EMIT_NATIVE_JIT
+    if (jit_code_info != NULL) {
+        outer_raw_code = jit_scope == NULL ? NULL : jit_scope->raw_code;
     }
+    #endif
+
+    // free the parse tree, along with the scopes
+    mp_parse_tree_clear(parse_tree);
 
     // free the compiler
     mp_obj_t compile_error = comp->compile_error;
@@ -3856,13 +4308,35 @@ mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is
     if (compile_error != MP_OBJ_NULL) {
         nlr_raise(compile_error);
     } else {
+        return outer_raw_code;
+    }
+}
+
+mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
+    return compile_to_raw_code(parse_tree, source_file, emit_opt, is_repl, NULL, NULL);
+}
+
+#if MICROPY_EMIT_NATIVE_JIT
+mp_raw_code_t *mp_compile_jit(mp_parse_tree_t *parse_tree, qstr source_file, const byte *code_info) {
+    return compile_to_raw_code(parse_tree, source_file, MP_EMIT_OPT_NONE, false, code_info, NULL);
+}
+#endif
+
+mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
+    mp_raw_code_t *rc = mp_compile_to_raw_code(parse_tree, source_file, emit_opt, is_repl);
 #if MICROPY_EMIT_CPYTHON
-        // can't create code, so just return true
-        (void)outer_raw_code; // to suppress warning that outer_raw_code is unused
-        return mp_const_true;
+    // can't create code, so just return true
+    (void)rc; // to suppress warning that rc is unused
+    return mp_const_true;
 #else
-        // return function that executes the outer module
-        return mp_make_function_from_raw_code(outer_raw_code, MP_OBJ_NULL, MP_OBJ_NULL);
+    // return function that executes the outer module
+    return mp_make_function_from_raw_code(rc, MP_OBJ_NULL, MP_OBJ_NULL);
 #endif
-    }
 }
+
+#if MICROPY_PARSE_STREAMING && !MICROPY_EMIT_CPYTHON
+mp_obj_t mp_compile_stmt(mp_parse_tree_t *parse_tree, qstr source_file, mp_map_t *consts) {
+    mp_raw_code_t *rc = compile_to_raw_code(parse_tree, source_file, MP_EMIT_OPT_NONE, false, NULL, consts);
+    return mp_make_function_from_raw_code(rc, MP_OBJ_NULL, MP_OBJ_NULL);
+}
+#endif
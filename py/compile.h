@@ -40,8 +40,23 @@ enum {
 };
 
 // the compiler will raise an exception if an error occurred
-// the compiler will free the parse tree (pn) before it returns
-mp_obj_t mp_compile(mp_parse_node_t pn, qstr source_file, uint emit_opt, bool is_repl);
+// the compiler will clear the parse tree before it returns
+mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl);
+
+// as above, but returns the raw code of the outer module, eg for saving it
+mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl);
+
+#if MICROPY_PARSE_STREAMING
+// compile one top-level statement of a module, as given by mp_parse_file_stmts;
+// consts carries the values of const() names from one statement to the next
+mp_obj_t mp_compile_stmt(mp_parse_tree_t *parse_tree, qstr source_file, mp_map_t *consts);
+#endif
+
+#if MICROPY_EMIT_NATIVE_JIT
+// compile the module again with the function identified by code_info compiled
+// to native code, and return its raw code (NULL if the function wasn't found)
+mp_raw_code_t *mp_compile_jit(mp_parse_tree_t *parse_tree, qstr source_file, const byte *code_info);
+#endif
 
 // this is implemented in runtime.c
 mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_input_kind, mp_obj_dict_t *globals, mp_obj_dict_t *locals);
@@ -37,7 +37,13 @@
 #if !MICROPY_EMIT_CPYTHON
 
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
+#define PEEP_MAX_LABELS_HERE (4)
+#if MICROPY_OPT_FUSED_OPCODES
+// a fused compare-and-jump opcode is written in one go and takes 6 bytes
+#define DUMMY_DATA_SIZE (BYTES_FOR_INT > 6 ? BYTES_FOR_INT : 6)
+#else
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
+#endif
 
 struct _emit_t {
     pass_kind_t pass : 8;
@@ -49,6 +55,12 @@ struct _emit_t {
 
     mp_uint_t last_source_line_offset;
     mp_uint_t last_source_line;
+    #if MICROPY_ENABLE_SOURCE_LINE
+    // the offset and line that the line number table has been written up to;
+    // the change to last_source_line is written once some bytecode follows it
+    mp_uint_t written_source_line_offset;
+    mp_uint_t written_source_line;
+    #endif
 
     mp_uint_t max_num_labels;
     mp_uint_t *label_offsets;
@@ -58,10 +70,59 @@ struct _emit_t {
     mp_uint_t bytecode_offset;
     mp_uint_t bytecode_size;
     byte *code_base; // stores both byte code and code info
+
+    #if MICROPY_PERSISTENT_CODE
+    mp_uint_t ct_cur_obj;
+    mp_uint_t ct_num_obj;
+    mp_uint_t ct_cur_raw_code;
+    #endif
+    mp_uint_t *const_table;
     // Accessed as mp_uint_t, so must be aligned as such
     byte dummy_data[DUMMY_DATA_SIZE];
+
+    #if MICROPY_OPT_FUSED_OPCODES
+    // opcodes that are held back so they can be fused with those that follow
+    byte fuse_state;
+    byte fuse_local_num;
+    byte fuse_op;
+    int8_t fuse_arg;
+    #endif
+
+    #if MICROPY_OPT_PEEPHOLE
+    // per-label information for the peephole optimiser; flags are found in
+    // MP_PASS_STACK_SIZE and the label each label jumps to in MP_PASS_CODE_SIZE
+    byte *label_flags;
+    mp_uint_t *label_jump_to;
+    // the labels that were assigned at labels_here_offset
+    mp_uint_t labels_here_offset;
+    mp_uint_t labels_here[PEEP_MAX_LABELS_HERE];
+    byte num_labels_here;
+    // set when the code being emitted can never be executed
+    bool unreachable;
+    // the last opcode of interest that was written, and the offset just after it
+    byte last_op;
+    mp_uint_t last_op_end;
+    mp_uint_t last_jump_label;
+    #endif
 };
 
+#if MICROPY_OPT_FUSED_OPCODES
+enum {
+    FUSE_NONE,
+    FUSE_LOAD_FAST,             // LOAD_FAST
+    FUSE_LOAD_FAST_SMALL_INT,   // LOAD_FAST, LOAD_CONST_SMALL_INT
+    FUSE_BINARY_OP,             // LOAD_FAST, LOAD_CONST_SMALL_INT, BINARY_OP
+};
+
+STATIC void emit_bc_fuse_flush(emit_t *emit);
+#endif
+
+#if MICROPY_OPT_PEEPHOLE
+#define LABEL_FLAG_IS_TARGET (0x01)     // some instruction refers to this label
+#define LABEL_FLAG_RETURNS_NONE (0x02)  // this label is followed by "return None"
+#define PEEP_MAX_JUMP_CHAIN (8)
+#endif
+
 emit_t *emit_bc_new(void) {
     emit_t *emit = m_new0(emit_t, 1);
     return emit;
@@ -70,10 +131,18 @@ emit_t *emit_bc_new(void) {
 void emit_bc_set_max_num_labels(emit_t *emit, mp_uint_t max_num_labels) {
     emit->max_num_labels = max_num_labels;
     emit->label_offsets = m_new(mp_uint_t, emit->max_num_labels);
+    #if MICROPY_OPT_PEEPHOLE
+    emit->label_flags = m_new(byte, emit->max_num_labels);
+    emit->label_jump_to = m_new(mp_uint_t, emit->max_num_labels);
+    #endif
 }
 
 void emit_bc_free(emit_t *emit) {
     m_del(mp_uint_t, emit->label_offsets, emit->max_num_labels);
+    #if MICROPY_OPT_PEEPHOLE
+    m_del(byte, emit->label_flags, emit->max_num_labels);
+    m_del(mp_uint_t, emit->label_jump_to, emit->max_num_labels);
+    #endif
     m_del_obj(emit_t, emit);
 }
 
@@ -118,7 +187,14 @@ STATIC void emit_write_code_info_uint(emit_t *emit, mp_uint_t val) {
 }
 
 STATIC void emit_write_code_info_qstr(emit_t *emit, qstr qst) {
+    #if MICROPY_PERSISTENT_CODE
+    assert((qst >> 16) == 0);
+    byte *c = emit_get_cur_to_write_code_info(emit, 2);
+    c[0] = qst;
+    c[1] = qst >> 8;
+    #else
     emit_write_uint(emit, emit_get_cur_to_write_code_info, qst);
+    #endif
 }
 
 #if MICROPY_ENABLE_SOURCE_LINE
@@ -144,11 +220,35 @@ STATIC void emit_write_code_info_bytes_lines(emit_t *emit, mp_uint_t bytes_to_sk
         lines_to_skip -= l;
     }
 }
+
+// Writes the pending line change to the line number table, but only if some
+// bytecode has been emitted since it.  Several line changes at the same
+// offset (eg from "else:" or a docstring) then cost one entry, not one each,
+// and a change at the very end of a function costs nothing.
+STATIC void emit_bc_flush_source_line(emit_t *emit) {
+    if (emit->last_source_line > emit->written_source_line
+        && emit->bytecode_offset > emit->last_source_line_offset) {
+        emit_write_code_info_bytes_lines(emit,
+            emit->last_source_line_offset - emit->written_source_line_offset,
+            emit->last_source_line - emit->written_source_line);
+        emit->written_source_line_offset = emit->last_source_line_offset;
+        emit->written_source_line = emit->last_source_line;
+    }
+}
 #endif
 
 // all functions must go through this one to emit byte code
 STATIC byte *emit_get_cur_to_write_bytecode(emit_t *emit, int num_bytes_to_write) {
     //printf("emit %d\n", num_bytes_to_write);
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
+    #if MICROPY_OPT_PEEPHOLE
+    if (emit->unreachable) {
+        // this code can never run so don't store it
+        return emit->dummy_data;
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         emit->bytecode_offset += num_bytes_to_write;
         return emit->dummy_data;
@@ -160,9 +260,11 @@ STATIC byte *emit_get_cur_to_write_bytecode(emit_t *emit, int num_bytes_to_write
     }
 }
 
+#if !MICROPY_PERSISTENT_CODE
 STATIC void emit_align_bytecode_to_machine_word(emit_t *emit) {
     emit->bytecode_offset = (emit->bytecode_offset + sizeof(mp_uint_t) - 1) & (~(sizeof(mp_uint_t) - 1));
 }
+#endif
 
 STATIC void emit_write_bytecode_byte(emit_t *emit, byte b1) {
     byte *c = emit_get_cur_to_write_bytecode(emit, 1);
@@ -212,6 +314,14 @@ STATIC void emit_write_bytecode_byte_uint(emit_t *emit, byte b, mp_uint_t val) {
     emit_write_uint(emit, emit_get_cur_to_write_bytecode, val);
 }
 
+#if MICROPY_PERSISTENT_CODE
+STATIC void emit_write_bytecode_byte_const(emit_t *emit, byte b, mp_uint_t n, mp_uint_t c) {
+    if (emit->pass == MP_PASS_EMIT) {
+        emit->const_table[n] = c;
+    }
+    emit_write_bytecode_byte_uint(emit, b, n);
+}
+#else
 STATIC void emit_write_bytecode_prealigned_ptr(emit_t *emit, void *ptr) {
     mp_uint_t *c = (mp_uint_t*)emit_get_cur_to_write_bytecode(emit, sizeof(mp_uint_t));
     // Verify thar c is already uint-aligned
@@ -228,6 +338,27 @@ STATIC void emit_write_bytecode_byte_ptr(emit_t *emit, byte b, void *ptr) {
     assert(c == MP_ALIGN(c, sizeof(mp_uint_t)));
     *c = (mp_uint_t)ptr;
 }
+#endif
+
+STATIC void emit_write_bytecode_byte_obj(emit_t *emit, byte b, void *ptr) {
+    #if MICROPY_PERSISTENT_CODE
+    emit_write_bytecode_byte_const(emit, b,
+        emit->scope->num_pos_args + emit->scope->num_kwonly_args
+        + emit->ct_cur_obj++, (mp_uint_t)ptr);
+    #else
+    emit_write_bytecode_byte_ptr(emit, b, ptr);
+    #endif
+}
+
+STATIC void emit_write_bytecode_byte_raw_code(emit_t *emit, byte b, mp_raw_code_t *rc) {
+    #if MICROPY_PERSISTENT_CODE
+    emit_write_bytecode_byte_const(emit, b,
+        emit->scope->num_pos_args + emit->scope->num_kwonly_args
+        + emit->ct_num_obj + emit->ct_cur_raw_code++, (mp_uint_t)rc);
+    #else
+    emit_write_bytecode_byte_ptr(emit, b, rc);
+    #endif
+}
 
 /* currently unused
 STATIC void emit_write_bytecode_byte_uint_uint(emit_t *emit, byte b, mp_uint_t num1, mp_uint_t num2) {
@@ -238,11 +369,73 @@ STATIC void emit_write_bytecode_byte_uint_uint(emit_t *emit, byte b, mp_uint_t n
 */
 
 STATIC void emit_write_bytecode_byte_qstr(emit_t *emit, byte b, qstr qst) {
+    #if MICROPY_PERSISTENT_CODE
+    assert((qst >> 16) == 0);
+    byte *c = emit_get_cur_to_write_bytecode(emit, 3);
+    c[0] = b;
+    c[1] = qst;
+    c[2] = qst >> 8;
+    #else
     emit_write_bytecode_byte_uint(emit, b, qst);
+    #endif
+}
+
+#if MICROPY_OPT_PEEPHOLE
+// records that the given opcode was just written, if it was written at all
+STATIC void emit_bc_peep_note_op(emit_t *emit, byte op) {
+    if (!emit->unreachable) {
+        emit->last_op = op;
+        emit->last_op_end = emit->bytecode_offset;
+    }
+}
+
+// whether the last thing written was the given opcode, with no label or line
+// number assigned after its start, so that it can be taken back
+STATIC bool emit_bc_peep_last_op_is(emit_t *emit, byte op, mp_uint_t op_size) {
+    return emit->last_op == op
+        && emit->last_op_end == emit->bytecode_offset
+        && emit->labels_here_offset != emit->bytecode_offset
+        && emit->last_source_line_offset <= emit->bytecode_offset - op_size;
+}
+
+// code following an unconditional jump, return or raise can only be reached
+// via a label; whether a label is a target is only known after MP_PASS_STACK_SIZE
+STATIC void emit_bc_peep_set_unreachable(emit_t *emit) {
+    if (emit->pass >= MP_PASS_CODE_SIZE) {
+        emit->unreachable = true;
+    }
 }
 
+// called for each instruction that refers to a label, returns the label to
+// actually use, which skips over any labels that just jump somewhere else
+STATIC mp_uint_t emit_bc_peep_label_ref(emit_t *emit, byte op, mp_uint_t label, bool can_thread) {
+    if (emit->pass == MP_PASS_STACK_SIZE) {
+        emit->label_flags[label] |= LABEL_FLAG_IS_TARGET;
+    } else if (emit->pass == MP_PASS_CODE_SIZE) {
+        if (op == MP_BC_JUMP && !emit->unreachable && emit->labels_here_offset == emit->bytecode_offset) {
+            for (mp_uint_t i = 0; i < emit->num_labels_here; i++) {
+                emit->label_jump_to[emit->labels_here[i]] = label;
+            }
+        }
+    } else if (emit->pass == MP_PASS_EMIT && can_thread) {
+        // the chain is bounded in case of a loop like "while True: pass"
+        for (int i = 0; i < PEEP_MAX_JUMP_CHAIN && emit->label_jump_to[label] != (mp_uint_t)-1; i++) {
+            label = emit->label_jump_to[label];
+        }
+    }
+    return label;
+}
+#endif
+
 // unsigned labels are relative to ip following this instruction, stored as 16 bits
 STATIC void emit_write_bytecode_byte_unsigned_label(emit_t *emit, byte b1, mp_uint_t label) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
+    #if MICROPY_OPT_PEEPHOLE
+    // these set up handlers which must stay in place, so don't thread them
+    label = emit_bc_peep_label_ref(emit, b1, label, false);
+    #endif
     mp_uint_t bytecode_offset;
     if (emit->pass < MP_PASS_EMIT) {
         bytecode_offset = 0;
@@ -257,6 +450,12 @@ STATIC void emit_write_bytecode_byte_unsigned_label(emit_t *emit, byte b1, mp_ui
 
 // signed labels are relative to ip following this instruction, stored as 16 bits, in excess
 STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint_t label) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
+    #if MICROPY_OPT_PEEPHOLE
+    label = emit_bc_peep_label_ref(emit, b1, label, true);
+    #endif
     int bytecode_offset;
     if (emit->pass < MP_PASS_EMIT) {
         bytecode_offset = 0;
@@ -269,6 +468,40 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+#if MICROPY_OPT_FUSED_OPCODES
+STATIC void emit_write_bytecode_load_fast(emit_t *emit, mp_uint_t local_num);
+STATIC void emit_write_bytecode_load_const_small_int(emit_t *emit, mp_int_t arg);
+
+// writes a fused opcode taking the held-back local, op and small int, and
+// returns a pointer to the bytes that follow these arguments
+STATIC byte *emit_bc_fuse_write(emit_t *emit, byte b1, int num_extra_bytes) {
+    emit->fuse_state = FUSE_NONE;
+    byte *c = emit_get_cur_to_write_bytecode(emit, 4 + num_extra_bytes);
+    c[0] = b1;
+    c[1] = emit->fuse_local_num;
+    c[2] = emit->fuse_op;
+    c[3] = emit->fuse_arg;
+    return c + 4;
+}
+
+// writes out any opcodes that were held back waiting to be fused
+STATIC void emit_bc_fuse_flush(emit_t *emit) {
+    byte state = emit->fuse_state;
+    if (state == FUSE_NONE) {
+        return;
+    }
+    if (state == FUSE_BINARY_OP) {
+        emit_bc_fuse_write(emit, MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT, 0);
+    } else {
+        emit->fuse_state = FUSE_NONE;
+        emit_write_bytecode_load_fast(emit, emit->fuse_local_num);
+        if (state == FUSE_LOAD_FAST_SMALL_INT) {
+            emit_write_bytecode_load_const_small_int(emit, emit->fuse_arg);
+        }
+    }
+}
+#endif
+
 #if MICROPY_EMIT_NATIVE
 STATIC void mp_emit_bc_set_native_type(emit_t *emit, mp_uint_t op, mp_uint_t arg1, qstr arg2) {
     (void)emit;
@@ -285,11 +518,33 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->scope = scope;
     emit->last_source_line_offset = 0;
     emit->last_source_line = 1;
+    #if MICROPY_ENABLE_SOURCE_LINE
+    emit->written_source_line_offset = 0;
+    emit->written_source_line = 1;
+    #endif
     if (pass < MP_PASS_EMIT) {
         memset(emit->label_offsets, -1, emit->max_num_labels * sizeof(mp_uint_t));
     }
     emit->bytecode_offset = 0;
     emit->code_info_offset = 0;
+    #if MICROPY_PERSISTENT_CODE
+    emit->ct_cur_obj = 0;
+    emit->ct_cur_raw_code = 0;
+    #endif
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit->fuse_state = FUSE_NONE;
+    #endif
+    #if MICROPY_OPT_PEEPHOLE
+    if (pass == MP_PASS_STACK_SIZE) {
+        memset(emit->label_flags, 0, emit->max_num_labels);
+    } else if (pass == MP_PASS_CODE_SIZE) {
+        memset(emit->label_jump_to, -1, emit->max_num_labels * sizeof(mp_uint_t));
+    }
+    emit->labels_here_offset = (mp_uint_t)-1;
+    emit->num_labels_here = 0;
+    emit->unreachable = false;
+    emit->last_op = 0;
+    #endif
 
     // Write code info size as compressed uint.  If we are not in the final pass
     // then space for this uint is reserved in emit_bc_end_pass.
@@ -304,6 +559,7 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     // bytecode prelude: argument names (needed to resolve positional args passed as keywords)
     // we store them as full word-sized objects for efficient access in mp_setup_code_state
     // this is the start of the prelude and is guaranteed to be aligned on a word boundary
+    // with persistent code they go at the start of the constant table instead
     {
         // For a given argument position (indexed by i) we need to find the
         // corresponding id_info which is a parameter, as it has the correct
@@ -324,7 +580,13 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
                     break;
                 }
             }
+            #if MICROPY_PERSISTENT_CODE
+            if (pass == MP_PASS_EMIT) {
+                emit->const_table[i] = (mp_uint_t)MP_OBJ_NEW_QSTR(qst);
+            }
+            #else
             emit_write_bytecode_prealigned_ptr(emit, MP_OBJ_NEW_QSTR(qst));
+            #endif
         }
     }
 
@@ -344,7 +606,7 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     // bytecode prelude: initialise closed over variables
     for (int i = 0; i < scope->id_info_len; i++) {
         id_info_t *id = &scope->id_info[i];
-        if (id->kind == ID_INFO_KIND_CELL) {
+        if (id->kind == ID_INFO_KIND_CELL && !(id->flags & ID_FLAG_IS_BY_VALUE)) {
             assert(id->local_num < 255);
             emit_write_bytecode_byte(emit, id->local_num); // write the local which should be converted to a cell
         }
@@ -353,6 +615,9 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
 }
 
 void mp_emit_bc_end_pass(emit_t *emit) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
     if (emit->pass == MP_PASS_SCOPE) {
         return;
     }
@@ -362,8 +627,16 @@ void mp_emit_bc_end_pass(emit_t *emit) {
         mp_printf(&mp_plat_print, "ERROR: stack size not back to zero; got %d\n", emit->stack_size);
     }
 
+    #if MICROPY_ENABLE_SOURCE_LINE
+    emit_bc_flush_source_line(emit);
+    #endif
     *emit_get_cur_to_write_code_info(emit, 1) = 0; // end of line number info
 
+    #if MICROPY_PERSISTENT_CODE
+    assert(emit->pass <= MP_PASS_STACK_SIZE || (emit->ct_num_obj == emit->ct_cur_obj));
+    emit->ct_num_obj = emit->ct_cur_obj;
+    #endif
+
     if (emit->pass == MP_PASS_CODE_SIZE) {
         // Need to make sure we have enough room in the code-info block to write
         // the size of the code-info block.  Since the size is written as a
@@ -388,9 +661,21 @@ void mp_emit_bc_end_pass(emit_t *emit) {
         emit->bytecode_size = emit->bytecode_offset;
         emit->code_base = m_new0(byte, emit->code_info_size + emit->bytecode_size);
 
+        #if MICROPY_PERSISTENT_CODE
+        emit->const_table = m_new0(mp_uint_t,
+            emit->scope->num_pos_args + emit->scope->num_kwonly_args
+            + emit->ct_cur_obj + emit->ct_cur_raw_code);
+        #else
+        emit->const_table = NULL;
+        #endif
+
     } else if (emit->pass == MP_PASS_EMIT) {
         mp_emit_glue_assign_bytecode(emit->scope->raw_code, emit->code_base,
             emit->code_info_size + emit->bytecode_size,
+            emit->const_table,
+            #if MICROPY_PERSISTENT_CODE_SAVE
+            emit->ct_cur_obj, emit->ct_cur_raw_code,
+            #endif
             emit->scope->num_pos_args, emit->scope->num_kwonly_args,
             emit->scope->scope_flags);
     }
@@ -411,17 +696,18 @@ void mp_emit_bc_set_source_line(emit_t *emit, mp_uint_t source_line) {
         // If we compile with -O3, don't store line numbers.
         return;
     }
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
     if (source_line > emit->last_source_line) {
-        mp_uint_t bytes_to_skip = emit->bytecode_offset - emit->last_source_line_offset;
-        mp_uint_t lines_to_skip = source_line - emit->last_source_line;
-        emit_write_code_info_bytes_lines(emit, bytes_to_skip, lines_to_skip);
+        emit_bc_flush_source_line(emit);
         emit->last_source_line_offset = emit->bytecode_offset;
         emit->last_source_line = source_line;
     }
 #endif
 }
 
-STATIC void emit_bc_pre(emit_t *emit, mp_int_t stack_size_delta) {
+STATIC void emit_bc_adjust_stack(emit_t *emit, mp_int_t stack_size_delta) {
     if (emit->pass == MP_PASS_SCOPE) {
         return;
     }
@@ -433,12 +719,40 @@ STATIC void emit_bc_pre(emit_t *emit, mp_int_t stack_size_delta) {
     emit->last_emit_was_return_value = false;
 }
 
+STATIC void emit_bc_pre(emit_t *emit, mp_int_t stack_size_delta) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    emit_bc_fuse_flush(emit);
+    #endif
+    emit_bc_adjust_stack(emit, stack_size_delta);
+}
+
 void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
     emit_bc_pre(emit, 0);
     if (emit->pass == MP_PASS_SCOPE) {
         return;
     }
     assert(l < emit->max_num_labels);
+    #if MICROPY_OPT_PEEPHOLE
+    if (emit->label_flags[l] & LABEL_FLAG_IS_TARGET) {
+        emit->unreachable = false;
+    }
+    if (emit->pass > MP_PASS_STACK_SIZE && emit->last_jump_label == l
+        && emit_bc_peep_last_op_is(emit, MP_BC_JUMP, 3)) {
+        // a jump to the very next instruction does nothing, so remove it
+        emit->bytecode_offset -= 3;
+        emit->last_op = 0;
+    }
+    // after MP_PASS_STACK_SIZE only labels that are jumped to need remembering
+    if (emit->pass == MP_PASS_STACK_SIZE || (emit->label_flags[l] & LABEL_FLAG_IS_TARGET)) {
+        if (emit->labels_here_offset != emit->bytecode_offset) {
+            emit->labels_here_offset = emit->bytecode_offset;
+            emit->num_labels_here = 0;
+        }
+        if (emit->num_labels_here < PEEP_MAX_LABELS_HERE) {
+            emit->labels_here[emit->num_labels_here++] = l;
+        }
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         // assign label offset
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
@@ -469,16 +783,20 @@ void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
     emit_bc_pre(emit, 1);
     switch (tok) {
         case MP_TOKEN_KW_FALSE: emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_FALSE); break;
-        case MP_TOKEN_KW_NONE: emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_NONE); break;
+        case MP_TOKEN_KW_NONE:
+            emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_NONE);
+            #if MICROPY_OPT_PEEPHOLE
+            emit_bc_peep_note_op(emit, MP_BC_LOAD_CONST_NONE);
+            #endif
+            break;
         case MP_TOKEN_KW_TRUE: emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_TRUE); break;
         no_other_choice:
-        case MP_TOKEN_ELLIPSIS: emit_write_bytecode_byte_ptr(emit, MP_BC_LOAD_CONST_OBJ, (void*)&mp_const_ellipsis_obj); break;
+        case MP_TOKEN_ELLIPSIS: emit_write_bytecode_byte_obj(emit, MP_BC_LOAD_CONST_OBJ, (void*)&mp_const_ellipsis_obj); break;
         default: assert(0); goto no_other_choice; // to help flow control analysis
     }
 }
 
-void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
-    emit_bc_pre(emit, 1);
+STATIC void emit_write_bytecode_load_const_small_int(emit_t *emit, mp_int_t arg) {
     if (-16 <= arg && arg <= 47) {
         emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
     } else {
@@ -486,6 +804,19 @@ void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
     }
 }
 
+void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    if (emit->fuse_state == FUSE_LOAD_FAST && -128 <= arg && arg <= 127) {
+        emit_bc_adjust_stack(emit, 1);
+        emit->fuse_state = FUSE_LOAD_FAST_SMALL_INT;
+        emit->fuse_arg = arg;
+        return;
+    }
+    #endif
+    emit_bc_pre(emit, 1);
+    emit_write_bytecode_load_const_small_int(emit, arg);
+}
+
 void mp_emit_bc_load_const_str(emit_t *emit, qstr qst, bool bytes) {
     emit_bc_pre(emit, 1);
     if (bytes) {
@@ -497,7 +828,7 @@ void mp_emit_bc_load_const_str(emit_t *emit, qstr qst, bool bytes) {
 
 void mp_emit_bc_load_const_obj(emit_t *emit, void *obj) {
     emit_bc_pre(emit, 1);
-    emit_write_bytecode_byte_ptr(emit, MP_BC_LOAD_CONST_OBJ, obj);
+    emit_write_bytecode_byte_obj(emit, MP_BC_LOAD_CONST_OBJ, obj);
 }
 
 void mp_emit_bc_load_null(emit_t *emit) {
@@ -505,10 +836,7 @@ void mp_emit_bc_load_null(emit_t *emit) {
     emit_write_bytecode_byte(emit, MP_BC_LOAD_NULL);
 };
 
-void mp_emit_bc_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
-    (void)qst;
-    assert(local_num >= 0);
-    emit_bc_pre(emit, 1);
+STATIC void emit_write_bytecode_load_fast(emit_t *emit, mp_uint_t local_num) {
     if (local_num <= 15) {
         emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
     } else {
@@ -516,6 +844,21 @@ void mp_emit_bc_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     }
 }
 
+void mp_emit_bc_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
+    (void)qst;
+    assert(local_num >= 0);
+    emit_bc_pre(emit, 1);
+    #if MICROPY_OPT_FUSED_OPCODES
+    if (local_num <= 255) {
+        // hold back the load to see if it can be fused with what follows
+        emit->fuse_state = FUSE_LOAD_FAST;
+        emit->fuse_local_num = local_num;
+        return;
+    }
+    #endif
+    emit_write_bytecode_load_fast(emit, local_num);
+}
+
 void mp_emit_bc_load_deref(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
     emit_bc_pre(emit, 1);
@@ -566,6 +909,13 @@ void mp_emit_bc_load_subscr(emit_t *emit) {
 void mp_emit_bc_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
     assert(local_num >= 0);
+    #if MICROPY_OPT_FUSED_OPCODES
+    if (emit->fuse_state == FUSE_BINARY_OP && emit->fuse_local_num == local_num) {
+        emit_bc_adjust_stack(emit, -1);
+        emit_bc_fuse_write(emit, MP_BC_STORE_FAST_BINARY_OP_SMALL_INT, 0);
+        return;
+    }
+    #endif
     emit_bc_pre(emit, -1);
     if (local_num <= 15) {
         emit_write_bytecode_byte(emit, MP_BC_STORE_FAST_MULTI + local_num);
@@ -638,6 +988,9 @@ void mp_emit_bc_delete_subscr(emit_t *emit) {
 void mp_emit_bc_dup_top(emit_t *emit) {
     emit_bc_pre(emit, 1);
     emit_write_bytecode_byte(emit, MP_BC_DUP_TOP);
+    #if MICROPY_OPT_PEEPHOLE
+    emit_bc_peep_note_op(emit, MP_BC_DUP_TOP);
+    #endif
 }
 
 void mp_emit_bc_dup_top_two(emit_t *emit) {
@@ -647,6 +1000,14 @@ void mp_emit_bc_dup_top_two(emit_t *emit) {
 
 void mp_emit_bc_pop_top(emit_t *emit) {
     emit_bc_pre(emit, -1);
+    #if MICROPY_OPT_PEEPHOLE
+    if (emit_bc_peep_last_op_is(emit, MP_BC_DUP_TOP, 1)) {
+        // DUP_TOP followed by POP_TOP does nothing, so remove them both
+        emit->bytecode_offset -= 1;
+        emit->last_op = 0;
+        return;
+    }
+    #endif
     emit_write_bytecode_byte(emit, MP_BC_POP_TOP);
 }
 
@@ -662,10 +1023,42 @@ void mp_emit_bc_rot_three(emit_t *emit) {
 
 void mp_emit_bc_jump(emit_t *emit, mp_uint_t label) {
     emit_bc_pre(emit, 0);
+    #if MICROPY_OPT_PEEPHOLE
+    if (emit->pass > MP_PASS_STACK_SIZE && (emit->label_flags[label] & LABEL_FLAG_RETURNS_NONE)) {
+        // jumping to "return None" so do it here, which is also shorter
+        emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_NONE);
+        emit_write_bytecode_byte(emit, MP_BC_RETURN_VALUE);
+        emit_bc_peep_set_unreachable(emit);
+        return;
+    }
+    #endif
     emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label);
+    #if MICROPY_OPT_PEEPHOLE
+    emit_bc_peep_note_op(emit, MP_BC_JUMP);
+    emit->last_jump_label = label;
+    emit_bc_peep_set_unreachable(emit);
+    #endif
 }
 
 void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
+    #if MICROPY_OPT_FUSED_OPCODES
+    if (emit->fuse_state == FUSE_BINARY_OP) {
+        emit_bc_adjust_stack(emit, -1);
+        #if MICROPY_OPT_PEEPHOLE
+        label = emit_bc_peep_label_ref(emit, MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE, label, true);
+        #endif
+        // label is relative to ip following this instruction, like a signed label
+        int bytecode_offset = 0;
+        if (emit->pass == MP_PASS_EMIT) {
+            bytecode_offset = emit->label_offsets[label] - emit->bytecode_offset - 6 + 0x8000;
+        }
+        byte *c = emit_bc_fuse_write(emit, cond ? MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE
+            : MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE, 2);
+        c[0] = bytecode_offset;
+        c[1] = bytecode_offset >> 8;
+        return;
+    }
+    #endif
     emit_bc_pre(emit, -1);
     if (cond) {
         emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_TRUE, label);
@@ -695,6 +1088,9 @@ void mp_emit_bc_unwind_jump(emit_t *emit, mp_uint_t label, mp_uint_t except_dept
         emit_write_bytecode_byte_signed_label(emit, MP_BC_UNWIND_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
         emit_write_bytecode_byte(emit, ((label & MP_EMIT_BREAK_FROM_FOR) ? 0x80 : 0) | except_depth);
     }
+    #if MICROPY_OPT_PEEPHOLE
+    emit_bc_peep_set_unreachable(emit);
+    #endif
 }
 
 void mp_emit_bc_setup_with(emit_t *emit, mp_uint_t label) {
@@ -739,6 +1135,15 @@ void mp_emit_bc_for_iter_end(emit_t *emit) {
     emit_bc_pre(emit, -1);
 }
 
+#if MICROPY_OPT_FOR_RANGE
+void mp_emit_bc_for_range(emit_t *emit, mp_int_t step, mp_uint_t label) {
+    assert(-128 <= step && step <= 127);
+    emit_bc_pre(emit, 1);
+    emit_write_bytecode_byte_unsigned_label(emit, MP_BC_FOR_RANGE_SMALL_INT, label);
+    emit_write_bytecode_byte(emit, step);
+}
+#endif
+
 void mp_emit_bc_pop_block(emit_t *emit) {
     emit_bc_pre(emit, 0);
     emit_write_bytecode_byte(emit, MP_BC_POP_BLOCK);
@@ -770,6 +1175,14 @@ void mp_emit_bc_binary_op(emit_t *emit, mp_binary_op_t op) {
         invert = true;
         op = MP_BINARY_OP_IS;
     }
+    #if MICROPY_OPT_FUSED_OPCODES
+    if (emit->fuse_state == FUSE_LOAD_FAST_SMALL_INT && op <= MP_BINARY_OP_NOT_EQUAL) {
+        emit_bc_adjust_stack(emit, -1);
+        emit->fuse_state = FUSE_BINARY_OP;
+        emit->fuse_op = op;
+        return;
+    }
+    #endif
     emit_bc_pre(emit, -1);
     emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
     if (invert) {
@@ -840,22 +1253,22 @@ void mp_emit_bc_unpack_ex(emit_t *emit, mp_uint_t n_left, mp_uint_t n_right) {
 void mp_emit_bc_make_function(emit_t *emit, scope_t *scope, mp_uint_t n_pos_defaults, mp_uint_t n_kw_defaults) {
     if (n_pos_defaults == 0 && n_kw_defaults == 0) {
         emit_bc_pre(emit, 1);
-        emit_write_bytecode_byte_ptr(emit, MP_BC_MAKE_FUNCTION, scope->raw_code);
+        emit_write_bytecode_byte_raw_code(emit, MP_BC_MAKE_FUNCTION, scope->raw_code);
     } else {
         emit_bc_pre(emit, -1);
-        emit_write_bytecode_byte_ptr(emit, MP_BC_MAKE_FUNCTION_DEFARGS, scope->raw_code);
+        emit_write_bytecode_byte_raw_code(emit, MP_BC_MAKE_FUNCTION_DEFARGS, scope->raw_code);
     }
 }
 
 void mp_emit_bc_make_closure(emit_t *emit, scope_t *scope, mp_uint_t n_closed_over, mp_uint_t n_pos_defaults, mp_uint_t n_kw_defaults) {
     if (n_pos_defaults == 0 && n_kw_defaults == 0) {
         emit_bc_pre(emit, -n_closed_over + 1);
-        emit_write_bytecode_byte_ptr(emit, MP_BC_MAKE_CLOSURE, scope->raw_code);
+        emit_write_bytecode_byte_raw_code(emit, MP_BC_MAKE_CLOSURE, scope->raw_code);
         emit_write_bytecode_byte(emit, n_closed_over);
     } else {
         assert(n_closed_over <= 255);
         emit_bc_pre(emit, -2 - n_closed_over + 1);
-        emit_write_bytecode_byte_ptr(emit, MP_BC_MAKE_CLOSURE_DEFARGS, scope->raw_code);
+        emit_write_bytecode_byte_raw_code(emit, MP_BC_MAKE_CLOSURE_DEFARGS, scope->raw_code);
         emit_write_bytecode_byte(emit, n_closed_over);
     }
 }
@@ -889,13 +1302,28 @@ void mp_emit_bc_call_method(emit_t *emit, mp_uint_t n_positional, mp_uint_t n_ke
 void mp_emit_bc_return_value(emit_t *emit) {
     emit_bc_pre(emit, -1);
     emit->last_emit_was_return_value = true;
+    #if MICROPY_OPT_PEEPHOLE
+    if (emit->pass == MP_PASS_STACK_SIZE && emit_bc_peep_last_op_is(emit, MP_BC_LOAD_CONST_NONE, 1)
+        && emit->labels_here_offset == emit->bytecode_offset - 1) {
+        // remember the labels that are followed by "return None"
+        for (mp_uint_t i = 0; i < emit->num_labels_here; i++) {
+            emit->label_flags[emit->labels_here[i]] |= LABEL_FLAG_RETURNS_NONE;
+        }
+    }
+    #endif
     emit_write_bytecode_byte(emit, MP_BC_RETURN_VALUE);
+    #if MICROPY_OPT_PEEPHOLE
+    emit_bc_peep_set_unreachable(emit);
+    #endif
 }
 
 void mp_emit_bc_raise_varargs(emit_t *emit, mp_uint_t n_args) {
     assert(0 <= n_args && n_args <= 2);
     emit_bc_pre(emit, -n_args);
     emit_write_bytecode_byte_byte(emit, MP_BC_RAISE_VARARGS, n_args);
+    #if MICROPY_OPT_PEEPHOLE
+    emit_bc_peep_set_unreachable(emit);
+    #endif
 }
 
 void mp_emit_bc_yield_value(emit_t *emit) {
@@ -981,6 +1409,9 @@ const emit_method_table_t emit_bc_method_table = {
     mp_emit_bc_get_iter,
     mp_emit_bc_for_iter,
     mp_emit_bc_for_iter_end,
+    #if MICROPY_OPT_FOR_RANGE
+    mp_emit_bc_for_range,
+    #endif
     mp_emit_bc_pop_block,
     mp_emit_bc_pop_except,
     mp_emit_bc_unary_op,
@@ -69,9 +69,12 @@ void mp_emit_common_get_id_for_modification(scope_t *scope, qstr qst) {
         } else {
             id->kind = ID_INFO_KIND_LOCAL;
         }
-    } else if (scope->kind >= SCOPE_FUNCTION && scope->kind <= SCOPE_GEN_EXPR && id->kind == ID_INFO_KIND_GLOBAL_IMPLICIT) {
-        // rebind as a local variable
-        id->kind = ID_INFO_KIND_LOCAL;
+    } else {
+        id->flags |= ID_FLAG_IS_REBOUND;
+        if (scope->kind >= SCOPE_FUNCTION && scope->kind <= SCOPE_GEN_EXPR && id->kind == ID_INFO_KIND_GLOBAL_IMPLICIT) {
+            // rebind as a local variable
+            id->kind = ID_INFO_KIND_LOCAL;
+        }
     }
 }
 
@@ -86,7 +89,7 @@ void mp_emit_common_id_op(emit_t *emit, const mp_emit_method_table_id_ops_t *emi
         emit_method_table->name(emit, qst);
     } else if (id->kind == ID_INFO_KIND_GLOBAL_EXPLICIT) {
         emit_method_table->global(emit, qst);
-    } else if (id->kind == ID_INFO_KIND_LOCAL) {
+    } else if (id->kind == ID_INFO_KIND_LOCAL || (id->flags & ID_FLAG_IS_BY_VALUE)) {
         emit_method_table->fast(emit, qst, id->local_num);
     } else {
         assert(id->kind == ID_INFO_KIND_CELL || id->kind == ID_INFO_KIND_FREE);
@@ -34,6 +34,19 @@
 #include "py/runtime0.h"
 #include "py/bc.h"
 
+#if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
+#include "py/nlr.h"
+#include "py/objstr.h"
+#include "py/objtuple.h"
+#include "py/parsenum.h"
+#include "py/smallint.h"
+#if MICROPY_HELPER_LEXER_UNIX
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#endif
+
 #if 0 // print debugging info
 #define DEBUG_PRINT (1)
 #define WRITE_CODE (1)
@@ -44,22 +57,6 @@
 #define DEBUG_OP_printf(...) (void)0
 #endif
 
-struct _mp_raw_code_t {
-    mp_raw_code_kind_t kind : 3;
-    mp_uint_t scope_flags : 7;
-    mp_uint_t n_pos_args : 11;
-    mp_uint_t n_kwonly_args : 11;
-    union {
-        struct {
-            byte *code;
-            mp_uint_t len;
-        } u_byte;
-        struct {
-            void *fun_data;
-            mp_uint_t type_sig; // for viper, compressed as 2-bit types; ret is MSB, then arg0, arg1, etc
-        } u_native;
-    } data;
-};
 
 mp_raw_code_t *mp_emit_glue_new_raw_code(void) {
     mp_raw_code_t *rc = m_new0(mp_raw_code_t, 1);
@@ -67,32 +64,43 @@ mp_raw_code_t *mp_emit_glue_new_raw_code(void) {
     return rc;
 }
 
-void mp_emit_glue_assign_bytecode(mp_raw_code_t *rc, byte *code, mp_uint_t len, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_uint_t scope_flags) {
+void mp_emit_glue_assign_bytecode(mp_raw_code_t *rc, byte *code, mp_uint_t len,
+    const mp_uint_t *const_table,
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    mp_uint_t n_obj, mp_uint_t n_raw_code,
+    #endif
+    mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_uint_t scope_flags) {
     rc->kind = MP_CODE_BYTECODE;
     rc->scope_flags = scope_flags;
     rc->n_pos_args = n_pos_args;
     rc->n_kwonly_args = n_kwonly_args;
     rc->data.u_byte.code = code;
     rc->data.u_byte.len = len;
+    rc->data.u_byte.const_table = const_table;
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    rc->data.u_byte.n_obj = n_obj;
+    rc->data.u_byte.n_raw_code = n_raw_code;
+    #endif
 
 #ifdef DEBUG_PRINT
     DEBUG_printf("assign byte code: code=%p len=" UINT_FMT " n_pos_args=" UINT_FMT " n_kwonly_args=" UINT_FMT " flags=%x\n", code, len, n_pos_args, n_kwonly_args, (uint)scope_flags);
 #endif
 #if MICROPY_DEBUG_PRINTERS
     if (mp_verbose_flag >= 2) {
-        mp_bytecode_print(rc, n_pos_args + n_kwonly_args, code, len);
+        mp_bytecode_print(rc, n_pos_args + n_kwonly_args, code, len, const_table);
     }
 #endif
 }
 
 #if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_THUMB
-void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void *fun_data, mp_uint_t fun_len, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_uint_t scope_flags, mp_uint_t type_sig) {
+void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void *fun_data, mp_uint_t fun_len, const mp_uint_t *const_table, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_uint_t scope_flags, mp_uint_t type_sig) {
     assert(kind == MP_CODE_NATIVE_PY || kind == MP_CODE_NATIVE_VIPER || kind == MP_CODE_NATIVE_ASM);
     rc->kind = kind;
     rc->scope_flags = scope_flags;
     rc->n_pos_args = n_pos_args;
     rc->n_kwonly_args = n_kwonly_args;
     rc->data.u_native.fun_data = fun_data;
+    rc->data.u_native.const_table = const_table;
     rc->data.u_native.type_sig = type_sig;
 
 #ifdef DEBUG_PRINT
@@ -131,11 +139,11 @@ mp_obj_t mp_make_function_from_raw_code(mp_raw_code_t *rc, mp_obj_t def_args, mp
     switch (rc->kind) {
         case MP_CODE_BYTECODE:
         no_other_choice:
-            fun = mp_obj_new_fun_bc(rc->scope_flags, rc->n_pos_args, rc->n_kwonly_args, def_args, def_kw_args, rc->data.u_byte.code);
+            fun = mp_obj_new_fun_bc(rc->scope_flags, rc->n_pos_args, rc->n_kwonly_args, def_args, def_kw_args, rc->data.u_byte.code, rc->data.u_byte.const_table);
             break;
         #if MICROPY_EMIT_NATIVE
         case MP_CODE_NATIVE_PY:
-            fun = mp_obj_new_fun_native(rc->scope_flags, rc->n_pos_args, rc->n_kwonly_args, def_args, def_kw_args, rc->data.u_native.fun_data);
+            fun = mp_obj_new_fun_native(rc->scope_flags, rc->n_pos_args, rc->n_kwonly_args, def_args, def_kw_args, rc->data.u_native.fun_data, rc->data.u_native.const_table);
             break;
         case MP_CODE_NATIVE_VIPER:
             fun = mp_obj_new_fun_viper(rc->n_pos_args, rc->data.u_native.fun_data, rc->data.u_native.type_sig);
@@ -174,3 +182,481 @@ mp_obj_t mp_make_closure_from_raw_code(mp_raw_code_t *rc, mp_uint_t n_closed_ove
     // wrap function in closure object
     return mp_obj_new_closure(ffun, n_closed_over & 0xff, args + ((n_closed_over >> 7) & 2));
 }
+
+#if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
+
+// The .mpy file format is:
+//  - header: 'M', version, feature flags, number of bits in a small int
+//  - the outer raw code, which recursively contains all the inner ones
+//
+// A raw code is stored as:
+//  - scope flags, number of positional args, number of kw-only args
+//  - length of the bytecode, then the bytecode itself
+//  - qstr fixups: pairs of (offset of slot from the previous slot, qstr)
+//    terminated by a zero offset; each slot is a 2-byte qstr in the bytecode
+//  - number of constant objects, number of inner raw codes
+//  - the arg names as qstrs, then the objects, then the raw codes
+//
+// All numbers are var-uints and a qstr is stored as its length then its data.
+
+#define MPY_VERSION (0)
+
+// these features change the bytecode so both ends must agree on them
+#define MPY_FEATURE_CACHE_MAP_LOOKUP (1)
+#define MPY_FEATURE_FUSED_OPCODES (2)
+#define MPY_FEATURE_FOR_RANGE (4)
+
+#define MPY_FEATURE_FLAGS ( \
+    (MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE ? MPY_FEATURE_CACHE_MAP_LOOKUP : 0) \
+    | (MICROPY_OPT_FUSED_OPCODES ? MPY_FEATURE_FUSED_OPCODES : 0) \
+    | (MICROPY_OPT_FOR_RANGE ? MPY_FEATURE_FOR_RANGE : 0) \
+    )
+
+STATIC mp_uint_t mpy_small_int_bits(void) {
+    mp_uint_t n = 1; // for the sign bit
+    for (mp_uint_t v = MP_SMALL_INT_MAX; v != 0; v >>= 1) {
+        ++n;
+    }
+    return n;
+}
+
+#endif
+
+#if MICROPY_PERSISTENT_CODE_LOAD
+
+STATIC NORETURN void raise_incompatible(void) {
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError,
+        "incompatible .mpy file"));
+}
+
+STATIC byte read_byte(mp_reader_t *reader) {
+    mp_uint_t b = reader->read_byte(reader->data);
+    if (b == MP_READER_EOF) {
+        raise_incompatible();
+    }
+    return b;
+}
+
+STATIC void read_bytes(mp_reader_t *reader, byte *buf, mp_uint_t len) {
+    while (len-- > 0) {
+        *buf++ = read_byte(reader);
+    }
+}
+
+STATIC mp_uint_t read_uint(mp_reader_t *reader) {
+    mp_uint_t unum = 0;
+    for (;;) {
+        byte b = read_byte(reader);
+        unum = (unum << 7) | (b & 0x7f);
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    return unum;
+}
+
+STATIC qstr load_qstr(mp_reader_t *reader) {
+    mp_uint_t len = read_uint(reader);
+    char *str = m_new(char, len);
+    read_bytes(reader, (byte*)str, len);
+    qstr qst = qstr_from_strn(str, len);
+    m_del(char, str, len);
+    return qst;
+}
+
+STATIC mp_obj_t load_obj(mp_reader_t *reader) {
+    byte obj_type = read_byte(reader);
+    if (obj_type == 'n') {
+        return mp_const_none;
+    } else if (obj_type == 'e') {
+        return (mp_obj_t)&mp_const_ellipsis_obj;
+    } else if (obj_type == 'F') {
+        return mp_const_false;
+    } else if (obj_type == 'T') {
+        return mp_const_true;
+    }
+    mp_uint_t len = read_uint(reader);
+    if (obj_type == 't') {
+        // a constant tuple, from the constant folding in the compiler
+        mp_obj_tuple_t *tuple = mp_obj_new_tuple(len, NULL);
+        for (mp_uint_t i = 0; i < len; i++) {
+            tuple->items[i] = load_obj(reader);
+        }
+        return tuple;
+    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+    read_bytes(reader, (byte*)vstr.buf, len);
+    mp_obj_t obj;
+    if (obj_type == 's' || obj_type == 'b') {
+        obj = mp_obj_new_str_from_vstr(obj_type == 's' ? &mp_type_str : &mp_type_bytes, &vstr);
+        return obj;
+    } else if (obj_type == 'i') {
+        obj = mp_parse_num_integer(vstr.buf, vstr.len, 10, NULL);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    } else if (obj_type == 'f') {
+        obj = mp_parse_num_decimal(vstr.buf, vstr.len, false, false, NULL);
+    #if MICROPY_PY_BUILTINS_COMPLEX
+    } else if (obj_type == 'c') {
+        // the real and imaginary parts are separated by a space
+        char *sep = memchr(vstr.buf, ' ', vstr.len);
+        if (sep == NULL) {
+            raise_incompatible();
+        }
+        mp_obj_t real = mp_parse_num_decimal(vstr.buf, sep - vstr.buf, false, false, NULL);
+        mp_obj_t imag = mp_parse_num_decimal(sep + 1, vstr.buf + vstr.len - sep - 1, false, false, NULL);
+        obj = mp_obj_new_complex(mp_obj_float_get(real), mp_obj_float_get(imag));
+    #endif
+    #endif
+    } else {
+        raise_incompatible();
+    }
+    vstr_clear(&vstr);
+    return obj;
+}
+
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader) {
+    mp_uint_t scope_flags = read_uint(reader);
+    mp_uint_t n_pos_args = read_uint(reader);
+    mp_uint_t n_kwonly_args = read_uint(reader);
+
+    // load the bytecode and fix up its qstrs
+    mp_uint_t len = read_uint(reader);
+    byte *code = m_new(byte, len);
+    read_bytes(reader, code, len);
+    for (mp_uint_t ofs = 0;;) {
+        mp_uint_t delta = read_uint(reader);
+        if (delta == 0) {
+            break;
+        }
+        ofs += delta;
+        if (ofs + 2 > len) {
+            raise_incompatible();
+        }
+        qstr qst = load_qstr(reader);
+        code[ofs] = qst;
+        code[ofs + 1] = qst >> 8;
+    }
+
+    // load the constant table
+    mp_uint_t n_obj = read_uint(reader);
+    mp_uint_t n_raw_code = read_uint(reader);
+    mp_uint_t n_args = n_pos_args + n_kwonly_args;
+    mp_uint_t *const_table = m_new(mp_uint_t, n_args + n_obj + n_raw_code);
+    mp_uint_t *ct = const_table;
+    for (mp_uint_t i = 0; i < n_args; ++i) {
+        *ct++ = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader));
+    }
+    for (mp_uint_t i = 0; i < n_obj; ++i) {
+        *ct++ = (mp_uint_t)load_obj(reader);
+    }
+    for (mp_uint_t i = 0; i < n_raw_code; ++i) {
+        *ct++ = (mp_uint_t)load_raw_code(reader);
+    }
+
+    mp_raw_code_t *rc = mp_emit_glue_new_raw_code();
+    mp_emit_glue_assign_bytecode(rc, code, len, const_table,
+        #if MICROPY_PERSISTENT_CODE_SAVE
+        n_obj, n_raw_code,
+        #endif
+        n_pos_args, n_kwonly_args, scope_flags);
+    return rc;
+}
+
+mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        byte header[4];
+        read_bytes(reader, header, sizeof(header));
+        if (header[0] != 'M' || header[1] != MPY_VERSION
+            || ((header[2] ^ MPY_FEATURE_FLAGS) & MPY_FEATURE_CACHE_MAP_LOOKUP)
+            || (header[2] & ~MPY_FEATURE_FLAGS) != 0
+            || header[3] > mpy_small_int_bits()) {
+            raise_incompatible();
+        }
+        mp_raw_code_t *rc = load_raw_code(reader);
+        nlr_pop();
+        reader->close(reader->data);
+        return rc;
+    } else {
+        reader->close(reader->data);
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+typedef struct _mp_mem_reader_t {
+    const byte *cur;
+    const byte *end;
+} mp_mem_reader_t;
+
+STATIC mp_uint_t mem_reader_read_byte(void *data) {
+    mp_mem_reader_t *mr = data;
+    if (mr->cur < mr->end) {
+        return *mr->cur++;
+    } else {
+        return MP_READER_EOF;
+    }
+}
+
+STATIC void mem_reader_close(void *data) {
+    (void)data;
+}
+
+mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, mp_uint_t len) {
+    mp_mem_reader_t mr = {buf, buf + len};
+    mp_reader_t reader = {&mr, mem_reader_read_byte, mem_reader_close};
+    return mp_raw_code_load(&reader);
+}
+
+#if MICROPY_HELPER_LEXER_UNIX
+
+typedef struct _mp_file_reader_t {
+    int fd;
+    byte buf[20];
+    mp_uint_t len;
+    mp_uint_t pos;
+} mp_file_reader_t;
+
+STATIC mp_uint_t file_reader_read_byte(void *data) {
+    mp_file_reader_t *fr = data;
+    if (fr->pos >= fr->len) {
+        if (fr->len == 0) {
+            return MP_READER_EOF;
+        } else {
+            int n = read(fr->fd, fr->buf, sizeof(fr->buf));
+            if (n <= 0) {
+                fr->len = 0;
+                return MP_READER_EOF;
+            }
+            fr->len = n;
+            fr->pos = 0;
+        }
+    }
+    return fr->buf[fr->pos++];
+}
+
+STATIC void file_reader_close(void *data) {
+    mp_file_reader_t *fr = data;
+    close(fr->fd);
+}
+
+mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
+    mp_file_reader_t fr;
+    fr.fd = open(filename, O_RDONLY, 0644);
+    if (fr.fd < 0) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
+    }
+    int n = read(fr.fd, fr.buf, sizeof(fr.buf));
+    fr.len = n > 0 ? n : 0;
+    fr.pos = 0;
+    mp_reader_t reader = {&fr, file_reader_read_byte, file_reader_close};
+    return mp_raw_code_load(&reader);
+}
+
+#endif // MICROPY_HELPER_LEXER_UNIX
+
+#endif // MICROPY_PERSISTENT_CODE_LOAD
+
+#if MICROPY_PERSISTENT_CODE_SAVE
+
+STATIC void save_bytes(mp_print_t *print, const byte *data, mp_uint_t len) {
+    print->print_strn(print->data, (const char*)data, len);
+}
+
+#define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
+STATIC void save_uint(mp_print_t *print, mp_uint_t n) {
+    byte buf[BYTES_FOR_INT];
+    byte *p = buf + sizeof(buf);
+    *--p = n & 0x7f;
+    n >>= 7;
+    for (; n != 0; n >>= 7) {
+        *--p = 0x80 | (n & 0x7f);
+    }
+    save_bytes(print, p, buf + sizeof(buf) - p);
+}
+
+STATIC void save_qstr(mp_print_t *print, qstr qst) {
+    mp_uint_t len;
+    const byte *str = qstr_data(qst, &len);
+    save_uint(print, len);
+    save_bytes(print, str, len);
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+// floats are saved with enough digits that they load back exactly
+STATIC void save_float(vstr_t *vstr, mp_float_t f) {
+    char buf[32];
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    snprintf(buf, sizeof(buf), "%.17g", (double)f);
+    #else
+    snprintf(buf, sizeof(buf), "%.9g", (double)f);
+    #endif
+    vstr_add_str(vstr, buf);
+}
+#endif
+
+STATIC void save_obj(mp_print_t *print, mp_obj_t o) {
+    if (o == mp_const_none) {
+        save_bytes(print, (const byte*)"n", 1);
+        return;
+    } else if (o == &mp_const_ellipsis_obj) {
+        save_bytes(print, (const byte*)"e", 1);
+        return;
+    } else if (o == mp_const_false) {
+        save_bytes(print, (const byte*)"F", 1);
+        return;
+    } else if (o == mp_const_true) {
+        save_bytes(print, (const byte*)"T", 1);
+        return;
+    } else if (MP_OBJ_IS_TYPE(o, &mp_type_tuple)) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_tuple_get(o, &len, &items);
+        save_bytes(print, (const byte*)"t", 1);
+        save_uint(print, len);
+        for (mp_uint_t i = 0; i < len; i++) {
+            save_obj(print, items[i]);
+        }
+        return;
+    } else if (MP_OBJ_IS_STR_OR_BYTES(o)) {
+        byte obj_type = MP_OBJ_IS_STR(o) ? 's' : 'b';
+        mp_uint_t len;
+        const char *str = mp_obj_str_get_data(o, &len);
+        save_bytes(print, &obj_type, 1);
+        save_uint(print, len);
+        save_bytes(print, (const byte*)str, len);
+        return;
+    }
+
+    byte obj_type;
+    vstr_t vstr;
+    mp_print_t vstr_print;
+    vstr_init_print(&vstr, 16, &vstr_print);
+    if (MP_OBJ_IS_INT(o)) {
+        obj_type = 'i';
+        mp_obj_print_helper(&vstr_print, o, PRINT_REPR);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    } else if (mp_obj_is_float(o)) {
+        obj_type = 'f';
+        save_float(&vstr, mp_obj_float_get(o));
+    #if MICROPY_PY_BUILTINS_COMPLEX
+    } else if (MP_OBJ_IS_TYPE(o, &mp_type_complex)) {
+        obj_type = 'c';
+        mp_float_t real, imag;
+        mp_obj_complex_get(o, &real, &imag);
+        save_float(&vstr, real);
+        vstr_add_byte(&vstr, ' ');
+        save_float(&vstr, imag);
+    #endif
+    #endif
+    } else {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+            "can't save object of type '%s'", mp_obj_get_type_str(o)));
+    }
+    save_bytes(print, &obj_type, 1);
+    save_uint(print, vstr.len);
+    save_bytes(print, (const byte*)vstr.buf, vstr.len);
+    vstr_clear(&vstr);
+}
+
+// writes the qstr at the given slot as a fixup, and returns the slot offset
+STATIC mp_uint_t save_qstr_fixup(mp_print_t *print, const byte *code, const byte *slot, mp_uint_t prev_ofs) {
+    mp_uint_t ofs = slot - code;
+    save_uint(print, ofs - prev_ofs);
+    save_qstr(print, slot[0] | (slot[1] << 8));
+    return ofs;
+}
+
+STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc) {
+    if (rc->kind != MP_CODE_BYTECODE) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError,
+            "can only save bytecode"));
+    }
+
+    save_uint(print, rc->scope_flags);
+    save_uint(print, rc->n_pos_args);
+    save_uint(print, rc->n_kwonly_args);
+
+    const byte *code = rc->data.u_byte.code;
+    mp_uint_t len = rc->data.u_byte.len;
+    save_uint(print, len);
+    save_bytes(print, code, len);
+
+    // code-info: simple name and source file qstrs
+    const byte *ip = code;
+    mp_uint_t code_info_size = mp_decode_uint(&ip);
+    mp_uint_t ofs = save_qstr_fixup(print, code, ip, 0);
+    ofs = save_qstr_fixup(print, code, ip + 2, ofs);
+
+    // bytecode prelude: n_state, n_exc_stack and the closed over variables
+    ip = code + code_info_size;
+    mp_decode_uint(&ip);
+    mp_decode_uint(&ip);
+    while (*ip++ != 255) {
+    }
+
+    // bytecode: the qstr argument of each opcode
+    const byte *ip_top = code + len;
+    while (ip < ip_top) {
+        mp_uint_t opcode_size;
+        uint f = mp_opcode_format(ip, &opcode_size);
+        if (f == MP_OPCODE_QSTR) {
+            ofs = save_qstr_fixup(print, code, ip + 1, ofs);
+        }
+        ip += opcode_size;
+    }
+    assert(ip == ip_top);
+    save_uint(print, 0);
+
+    // constant table
+    const mp_uint_t *const_table = rc->data.u_byte.const_table;
+    mp_uint_t n_args = rc->n_pos_args + rc->n_kwonly_args;
+    mp_uint_t n_obj = rc->data.u_byte.n_obj;
+    mp_uint_t n_raw_code = rc->data.u_byte.n_raw_code;
+    save_uint(print, n_obj);
+    save_uint(print, n_raw_code);
+    for (mp_uint_t i = 0; i < n_args; ++i) {
+        save_qstr(print, MP_OBJ_QSTR_VALUE((mp_obj_t)*const_table++));
+    }
+    for (mp_uint_t i = 0; i < n_obj; ++i) {
+        save_obj(print, (mp_obj_t)*const_table++);
+    }
+    for (mp_uint_t i = 0; i < n_raw_code; ++i) {
+        save_raw_code(print, (mp_raw_code_t*)*const_table++);
+    }
+}
+
+void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
+    byte header[4] = {'M', MPY_VERSION, MPY_FEATURE_FLAGS, mpy_small_int_bits()};
+    save_bytes(print, header, sizeof(header));
+    save_raw_code(print, rc);
+}
+
+#if MICROPY_HELPER_LEXER_UNIX
+
+STATIC void fd_print_strn(void *env, const char *str, mp_uint_t len) {
+    int fd = (mp_int_t)env;
+    ssize_t ret = write(fd, str, len);
+    (void)ret;
+}
+
+void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
+    }
+    mp_print_t fd_print = {(void*)(mp_int_t)fd, fd_print_strn};
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_raw_code_save(rc, &fd_print);
+        nlr_pop();
+        close(fd);
+    } else {
+        close(fd);
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+#endif // MICROPY_HELPER_LEXER_UNIX
+
+#endif // MICROPY_PERSISTENT_CODE_SAVE
@@ -90,7 +90,7 @@ STATIC void emit_inline_thumb_end_pass(emit_inline_asm_t *emit) {
 
     if (emit->pass == MP_PASS_EMIT) {
         void *f = asm_thumb_get_code(emit->as);
-        mp_emit_glue_assign_native(emit->scope->raw_code, MP_CODE_NATIVE_ASM, f, asm_thumb_get_code_size(emit->as), emit->scope->num_pos_args, 0, 0, 0);
+        mp_emit_glue_assign_native(emit->scope->raw_code, MP_CODE_NATIVE_ASM, f, asm_thumb_get_code_size(emit->as), NULL, emit->scope->num_pos_args, 0, 0, 0);
     }
 }
 
@@ -381,6 +381,82 @@ STATIC const format_9_10_op_t format_9_10_op_table[] = {
 };
 #undef X
 
+// Thumb-2 parallel add/sub instructions, eg sadd16, uqsub8, shasx
+// opcodes are: 0xfa80 | op << 4 | rn, 0xf000 | rd << 8 | prefix << 4 | rm
+typedef struct _simd_name_t { byte op; char name[6]; } simd_name_t;
+STATIC const simd_name_t simd_prefix_table[] = {
+    { 0, "s" },
+    { 1, "q" },
+    { 2, "sh" },
+    { 4, "u" },
+    { 5, "uq" },
+    { 6, "uh" },
+};
+STATIC const simd_name_t simd_op_table[] = {
+    { 0, "add8" },
+    { 1, "add16" },
+    { 2, "asx" },
+    { 4, "sub8" },
+    { 5, "sub16" },
+    { 6, "sax" },
+};
+
+// Thumb-2 sign/zero extend instructions, with rotation 0
+// opcodes are: 0xfa0f | op << 4, 0xf080 | rd << 8 | rm
+typedef struct _extend_op_t { byte op; char name[7]; } extend_op_t;
+STATIC const extend_op_t extend_op_table[] = {
+    { 0x00, "sxth" },
+    { 0x01, "uxth" },
+    { 0x02, "sxtb16" },
+    { 0x03, "uxtb16" },
+    { 0x04, "sxtb" },
+    { 0x05, "uxtb" },
+};
+
+// Thumb-2 multiply and multiply-accumulate instructions
+// opcodes are: 0xfb00 | op.hi, op.lo | ra << 12 | rd << 8 | rm
+// the non-accumulating forms use ra = 0xf
+typedef struct _mul_op_t { uint16_t op; char name[7]; } mul_op_t;
+STATIC const mul_op_t mul_op_table[] = {
+    { 0x0000, "mla" },
+    { 0x0010, "mls" },
+    { 0x1000, "smlabb" },
+    { 0x1010, "smlabt" },
+    { 0x1020, "smlatb" },
+    { 0x1030, "smlatt" },
+    { 0x2000, "smlad" },
+    { 0x2010, "smladx" },
+    { 0x3000, "smlawb" },
+    { 0x3010, "smlawt" },
+    { 0x4000, "smlsd" },
+    { 0x4010, "smlsdx" },
+    { 0x5000, "smmla" },
+    { 0x6000, "smmls" },
+};
+STATIC const mul_op_t mul_noacc_op_table[] = {
+    { 0x1000, "smulbb" },
+    { 0x1010, "smulbt" },
+    { 0x1020, "smultb" },
+    { 0x1030, "smultt" },
+    { 0x2000, "smuad" },
+    { 0x2010, "smuadx" },
+    { 0x3000, "smulwb" },
+    { 0x3010, "smulwt" },
+    { 0x4000, "smusd" },
+    { 0x4010, "smusdx" },
+    { 0x5000, "smmul" },
+    { 0x7000, "usad8" },
+};
+
+// Thumb-2 long multiply instructions: rdlo, rdhi, rn, rm
+// opcodes are: 0xfb80 | op << 4 | rn, rdlo << 12 | rdhi << 8 | rm
+STATIC const simd_name_t mull_op_table[] = {
+    { 0, "smull" },
+    { 2, "umull" },
+    { 4, "smlal" },
+    { 6, "umlal" },
+};
+
 #if MICROPY_EMIT_INLINE_THUMB_FLOAT
 // actual opcodes are: 0xee00 | op.hi_nibble, 0x0a00 | op.lo_nibble
 typedef struct _format_vfp_op_t { byte op; char name[3]; } format_vfp_op_t;
@@ -619,6 +695,16 @@ STATIC void emit_inline_thumb_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_a
                 op_code = 0xf0a0;
                 goto op_clz_rbit;
             } else {
+                // search table for sign/zero extend ops
+                for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(extend_op_table); i++) {
+                    if (strcmp(op_str, extend_op_table[i].name) == 0) {
+                        op_code_hi = 0xfa0f | (extend_op_table[i].op << 4);
+                        mp_uint_t rd = get_arg_reg(emit, op_str, pn_args[0], 15);
+                        mp_uint_t rm = get_arg_reg(emit, op_str, pn_args[1], 15);
+                        asm_thumb_op32(emit->as, op_code_hi, 0xf080 | (rd << 8) | rm);
+                        return;
+                    }
+                }
                 if (strcmp(op_str, "and_") == 0) {
                     op_code = ASM_THUMB_FORMAT_4_AND;
                     mp_uint_t reg_dest, reg_src;
@@ -673,6 +759,21 @@ STATIC void emit_inline_thumb_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_a
                 int i_src = get_arg_i(emit, op_str, pn_args[1], 0xffffffff);
                 asm_thumb_mov_reg_i16(emit->as, ASM_THUMB_OP_MOVW, reg_dest, i_src & 0xffff);
                 asm_thumb_mov_reg_i16(emit->as, ASM_THUMB_OP_MOVT, reg_dest, (i_src >> 16) & 0x7fff);
+            } else if (strcmp(op_str, "ldm") == 0 || strcmp(op_str, "ldmia") == 0
+                || strcmp(op_str, "stm") == 0 || strcmp(op_str, "stmia") == 0) {
+                // ldm/stm leave the base register alone, ldmia/stmia write back
+                bool is_ld = op_str[0] == 'l';
+                bool wback = op_str[3] != '\0';
+                mp_uint_t r_base = get_arg_reg(emit, op_str, pn_args[0], 15);
+                mp_uint_t reglist = get_arg_reglist(emit, op_str, pn_args[1]);
+                if (wback && r_base < 8 && (reglist & 0xff00) == 0
+                    && (is_ld ? !(reglist & (1 << r_base)) : true)) {
+                    // 16-bit encoding, which always writes back (for ldm only
+                    // when the base is not in the list)
+                    asm_thumb_op16(emit->as, (is_ld ? 0xc800 : 0xc000) | (r_base << 8) | reglist);
+                } else {
+                    asm_thumb_op32(emit->as, (is_ld ? 0xe890 : 0xe880) | (wback << 5) | r_base, reglist);
+                }
             } else if (strcmp(op_str, "ldrex") == 0) {
                 mp_uint_t r_dest = get_arg_reg(emit, op_str, pn_args[0], 15);
                 mp_parse_node_t pn_base, pn_offset;
@@ -748,10 +849,81 @@ STATIC void emit_inline_thumb_op(emit_inline_asm_t *emit, qstr op, mp_uint_t n_a
                 mp_uint_t i8 = get_arg_i(emit, op_str, pn_offset, 0xff) >> 2;
                 asm_thumb_op32(emit->as, 0xe840 | r_base, (r_src << 12) | (r_dest << 8) | i8);
             }
+        } else if (strcmp(op_str, "ssat") == 0 || strcmp(op_str, "usat") == 0
+            || strcmp(op_str, "ssat16") == 0 || strcmp(op_str, "usat16") == 0) {
+            // ssat(rd, sat, rn): the signed forms saturate to 1..32 (or 16) bits,
+            // the unsigned forms to 0..31 (or 15) bits
+            bool is_signed = op_str[0] == 's';
+            bool is_16 = op_str[4] != '\0';
+            mp_uint_t rd = get_arg_reg(emit, op_str, pn_args[0], 15);
+            int sat = get_arg_i(emit, op_str, pn_args[1], is_16 ? 0x1f : 0x3f);
+            mp_uint_t rn = get_arg_reg(emit, op_str, pn_args[2], 15);
+            if (is_signed) {
+                sat -= 1;
+            }
+            if (sat < 0 || sat > (is_16 ? 15 : 31)) {
+                emit_inline_thumb_error_exc(emit, mp_obj_new_exception_msg_varg(&mp_type_SyntaxError, "'%s' saturate bit position out of range", op_str));
+                return;
+            }
+            asm_thumb_op32(emit->as, (is_signed ? 0xf300 : 0xf380) | (is_16 << 5) | rn, (rd << 8) | sat);
         } else {
+            // search table for multiply ops without accumulator
+            for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(mul_noacc_op_table); i++) {
+                if (strcmp(op_str, mul_noacc_op_table[i].name) == 0) {
+                    op_code = mul_noacc_op_table[i].op;
+                    mp_uint_t rd = get_arg_reg(emit, op_str, pn_args[0], 15);
+                    mp_uint_t rn = get_arg_reg(emit, op_str, pn_args[1], 15);
+                    mp_uint_t rm = get_arg_reg(emit, op_str, pn_args[2], 15);
+                    asm_thumb_op32(emit->as, 0xfb00 | (op_code >> 8) | rn, 0xf000 | (rd << 8) | (op_code & 0xff) | rm);
+                    return;
+                }
+            }
+            // search tables for parallel add/sub ops
+            for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(simd_prefix_table); i++) {
+                size_t prefix_len = strlen(simd_prefix_table[i].name);
+                if (strncmp(op_str, simd_prefix_table[i].name, prefix_len) != 0) {
+                    continue;
+                }
+                for (mp_uint_t j = 0; j < MP_ARRAY_SIZE(simd_op_table); j++) {
+                    if (strcmp(op_str + prefix_len, simd_op_table[j].name) == 0) {
+                        mp_uint_t rd = get_arg_reg(emit, op_str, pn_args[0], 15);
+                        mp_uint_t rn = get_arg_reg(emit, op_str, pn_args[1], 15);
+                        mp_uint_t rm = get_arg_reg(emit, op_str, pn_args[2], 15);
+                        asm_thumb_op32(emit->as, 0xfa80 | (simd_op_table[j].op << 4) | rn,
+                            0xf000 | (rd << 8) | (simd_prefix_table[i].op << 4) | rm);
+                        return;
+                    }
+                }
+            }
             goto unknown_op;
         }
 
+    } else if (n_args == 4) {
+        // search table for multiply-accumulate ops: rd, rn, rm, ra
+        for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(mul_op_table); i++) {
+            if (strcmp(op_str, mul_op_table[i].name) == 0) {
+                mp_uint_t op_code = mul_op_table[i].op;
+                mp_uint_t rd = get_arg_reg(emit, op_str, pn_args[0], 15);
+                mp_uint_t rn = get_arg_reg(emit, op_str, pn_args[1], 15);
+                mp_uint_t rm = get_arg_reg(emit, op_str, pn_args[2], 15);
+                mp_uint_t ra = get_arg_reg(emit, op_str, pn_args[3], 15);
+                asm_thumb_op32(emit->as, 0xfb00 | (op_code >> 8) | rn, (ra << 12) | (rd << 8) | (op_code & 0xff) | rm);
+                return;
+            }
+        }
+        // search table for long multiply ops: rdlo, rdhi, rn, rm
+        for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(mull_op_table); i++) {
+            if (strcmp(op_str, mull_op_table[i].name) == 0) {
+                mp_uint_t rdlo = get_arg_reg(emit, op_str, pn_args[0], 15);
+                mp_uint_t rdhi = get_arg_reg(emit, op_str, pn_args[1], 15);
+                mp_uint_t rn = get_arg_reg(emit, op_str, pn_args[2], 15);
+                mp_uint_t rm = get_arg_reg(emit, op_str, pn_args[3], 15);
+                asm_thumb_op32(emit->as, 0xfb80 | (mull_op_table[i].op << 4) | rn, (rdlo << 12) | (rdhi << 8) | rm);
+                return;
+            }
+        }
+        goto unknown_op;
+
     } else {
         goto unknown_op;
     }
@@ -61,7 +61,8 @@
 #if (MICROPY_EMIT_X64 && N_X64) \
     || (MICROPY_EMIT_X86 && N_X86) \
     || (MICROPY_EMIT_THUMB && N_THUMB) \
-    || (MICROPY_EMIT_ARM && N_ARM)
+    || (MICROPY_EMIT_ARM && N_ARM) \
+    || (MICROPY_EMIT_XTENSA && N_XTENSA)
 
 #if N_X64
 
@@ -89,7 +90,9 @@
 #define REG_LOCAL_1 ASM_X64_REG_RBX
 #define REG_LOCAL_2 ASM_X64_REG_R12
 #define REG_LOCAL_3 ASM_X64_REG_R13
-#define REG_LOCAL_NUM (3)
+#define REG_LOCAL_4 ASM_X64_REG_R14
+#define REG_LOCAL_5 ASM_X64_REG_R15
+#define REG_LOCAL_NUM (5)
 
 #define ASM_PASS_COMPUTE    ASM_X64_PASS_COMPUTE
 #define ASM_PASS_EMIT       ASM_X64_PASS_EMIT
@@ -125,6 +128,11 @@
         asm_x64_cmp_r64_with_r64(as, reg1, reg2); \
         asm_x64_jcc_label(as, ASM_X64_CC_JE, label); \
     } while (0)
+#define ASM_JUMP_IF_REG_NE(as, reg1, reg2, label) \
+    do { \
+        asm_x64_cmp_r64_with_r64(as, reg1, reg2); \
+        asm_x64_jcc_label(as, ASM_X64_CC_JNE, label); \
+    } while (0)
 #define ASM_CALL_IND(as, ptr, idx) asm_x64_call_ind(as, ptr, ASM_X64_REG_RAX)
 
 #define ASM_MOV_REG_TO_LOCAL        asm_x64_mov_r64_to_local
@@ -151,11 +159,13 @@
 #define ASM_LOAD_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_x64_mov_mem64_to_r64((as), (reg_base), 8 * (word_offset), (reg_dest))
 #define ASM_LOAD8_REG_REG(as, reg_dest, reg_base) asm_x64_mov_mem8_to_r64zx((as), (reg_base), 0, (reg_dest))
 #define ASM_LOAD16_REG_REG(as, reg_dest, reg_base) asm_x64_mov_mem16_to_r64zx((as), (reg_base), 0, (reg_dest))
+#define ASM_LOAD32_REG_REG(as, reg_dest, reg_base) asm_x64_mov_mem32_to_r64zx((as), (reg_base), 0, (reg_dest))
 
 #define ASM_STORE_REG_REG(as, reg_src, reg_base) asm_x64_mov_r64_to_mem64((as), (reg_src), (reg_base), 0)
 #define ASM_STORE_REG_REG_OFFSET(as, reg_src, reg_base, word_offset) asm_x64_mov_r64_to_mem64((as), (reg_src), (reg_base), 8 * (word_offset))
 #define ASM_STORE8_REG_REG(as, reg_src, reg_base) asm_x64_mov_r8_to_mem8((as), (reg_src), (reg_base), 0)
 #define ASM_STORE16_REG_REG(as, reg_src, reg_base) asm_x64_mov_r16_to_mem16((as), (reg_src), (reg_base), 0)
+#define ASM_STORE32_REG_REG(as, reg_src, reg_base) asm_x64_mov_r32_to_mem32((as), (reg_src), (reg_base), 0)
 
 #elif N_X86
 
@@ -269,6 +279,11 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
         asm_x86_cmp_r32_with_r32(as, reg1, reg2); \
         asm_x86_jcc_label(as, ASM_X86_CC_JE, label); \
     } while (0)
+#define ASM_JUMP_IF_REG_NE(as, reg1, reg2, label) \
+    do { \
+        asm_x86_cmp_r32_with_r32(as, reg1, reg2); \
+        asm_x86_jcc_label(as, ASM_X86_CC_JNE, label); \
+    } while (0)
 #define ASM_CALL_IND(as, ptr, idx) asm_x86_call_ind(as, ptr, mp_f_n_args[idx], ASM_X86_REG_EAX)
 
 #define ASM_MOV_REG_TO_LOCAL        asm_x86_mov_r32_to_local
@@ -295,11 +310,13 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
 #define ASM_LOAD_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_x86_mov_mem32_to_r32((as), (reg_base), 4 * (word_offset), (reg_dest))
 #define ASM_LOAD8_REG_REG(as, reg_dest, reg_base) asm_x86_mov_mem8_to_r32zx((as), (reg_base), 0, (reg_dest))
 #define ASM_LOAD16_REG_REG(as, reg_dest, reg_base) asm_x86_mov_mem16_to_r32zx((as), (reg_base), 0, (reg_dest))
+#define ASM_LOAD32_REG_REG(as, reg_dest, reg_base) ASM_LOAD_REG_REG((as), (reg_dest), (reg_base))
 
 #define ASM_STORE_REG_REG(as, reg_src, reg_base) asm_x86_mov_r32_to_mem32((as), (reg_src), (reg_base), 0)
 #define ASM_STORE_REG_REG_OFFSET(as, reg_src, reg_base, word_offset) asm_x86_mov_r32_to_mem32((as), (reg_src), (reg_base), 4 * (word_offset))
 #define ASM_STORE8_REG_REG(as, reg_src, reg_base) asm_x86_mov_r8_to_mem8((as), (reg_src), (reg_base), 0)
 #define ASM_STORE16_REG_REG(as, reg_src, reg_base) asm_x86_mov_r16_to_mem16((as), (reg_src), (reg_base), 0)
+#define ASM_STORE32_REG_REG(as, reg_src, reg_base) ASM_STORE_REG_REG((as), (reg_src), (reg_base))
 
 #elif N_THUMB
 
@@ -361,6 +378,11 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
         asm_thumb_cmp_rlo_rlo(as, reg1, reg2); \
         asm_thumb_bcc_label(as, ASM_THUMB_CC_EQ, label); \
     } while (0)
+#define ASM_JUMP_IF_REG_NE(as, reg1, reg2, label) \
+    do { \
+        asm_thumb_cmp_rlo_rlo(as, reg1, reg2); \
+        asm_thumb_bcc_label(as, ASM_THUMB_CC_NE, label); \
+    } while (0)
 #define ASM_CALL_IND(as, ptr, idx) asm_thumb_bl_ind(as, ptr, idx, ASM_THUMB_REG_R3)
 
 #define ASM_MOV_REG_TO_LOCAL(as, reg, local_num) asm_thumb_mov_local_reg(as, (local_num), (reg))
@@ -387,11 +409,13 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
 #define ASM_LOAD_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_thumb_ldr_rlo_rlo_i5((as), (reg_dest), (reg_base), (word_offset))
 #define ASM_LOAD8_REG_REG(as, reg_dest, reg_base) asm_thumb_ldrb_rlo_rlo_i5((as), (reg_dest), (reg_base), 0)
 #define ASM_LOAD16_REG_REG(as, reg_dest, reg_base) asm_thumb_ldrh_rlo_rlo_i5((as), (reg_dest), (reg_base), 0)
+#define ASM_LOAD32_REG_REG(as, reg_dest, reg_base) ASM_LOAD_REG_REG((as), (reg_dest), (reg_base))
 
 #define ASM_STORE_REG_REG(as, reg_src, reg_base) asm_thumb_str_rlo_rlo_i5((as), (reg_src), (reg_base), 0)
 #define ASM_STORE_REG_REG_OFFSET(as, reg_src, reg_base, word_offset) asm_thumb_str_rlo_rlo_i5((as), (reg_src), (reg_base), (word_offset))
 #define ASM_STORE8_REG_REG(as, reg_src, reg_base) asm_thumb_strb_rlo_rlo_i5((as), (reg_src), (reg_base), 0)
 #define ASM_STORE16_REG_REG(as, reg_src, reg_base) asm_thumb_strh_rlo_rlo_i5((as), (reg_src), (reg_base), 0)
+#define ASM_STORE32_REG_REG(as, reg_src, reg_base) ASM_STORE_REG_REG((as), (reg_src), (reg_base))
 
 #elif N_ARM
 
@@ -452,6 +476,11 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
         asm_arm_cmp_reg_reg(as, reg1, reg2); \
         asm_arm_bcc_label(as, ASM_ARM_CC_EQ, label); \
     } while (0)
+#define ASM_JUMP_IF_REG_NE(as, reg1, reg2, label) \
+    do { \
+        asm_arm_cmp_reg_reg(as, reg1, reg2); \
+        asm_arm_bcc_label(as, ASM_ARM_CC_NE, label); \
+    } while (0)
 #define ASM_CALL_IND(as, ptr, idx) asm_arm_bl_ind(as, ptr, idx, ASM_ARM_REG_R3)
 
 #define ASM_MOV_REG_TO_LOCAL(as, reg, local_num) asm_arm_mov_local_reg(as, (local_num), (reg))
@@ -478,11 +507,110 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
 #define ASM_LOAD_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_arm_ldr_reg_reg((as), (reg_dest), (reg_base), 4 * (word_offset))
 #define ASM_LOAD8_REG_REG(as, reg_dest, reg_base) asm_arm_ldrb_reg_reg((as), (reg_dest), (reg_base))
 #define ASM_LOAD16_REG_REG(as, reg_dest, reg_base) asm_arm_ldrh_reg_reg((as), (reg_dest), (reg_base))
+#define ASM_LOAD32_REG_REG(as, reg_dest, reg_base) ASM_LOAD_REG_REG((as), (reg_dest), (reg_base))
 
 #define ASM_STORE_REG_REG(as, reg_value, reg_base) asm_arm_str_reg_reg((as), (reg_value), (reg_base), 0)
 #define ASM_STORE_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_arm_str_reg_reg((as), (reg_dest), (reg_base), 4 * (word_offset))
 #define ASM_STORE8_REG_REG(as, reg_value, reg_base) asm_arm_strb_reg_reg((as), (reg_value), (reg_base))
 #define ASM_STORE16_REG_REG(as, reg_value, reg_base) asm_arm_strh_reg_reg((as), (reg_value), (reg_base))
+#define ASM_STORE32_REG_REG(as, reg_value, reg_base) ASM_STORE_REG_REG((as), (reg_value), (reg_base))
+
+#elif N_XTENSA
+
+// Xtensa specific stuff
+
+#include "py/asmxtensa.h"
+
+#define ASM_WORD_SIZE (4)
+
+#define EXPORT_FUN(name) emit_native_xtensa_##name
+
+#define REG_RET ASM_XTENSA_REG_A2
+#define REG_ARG_1 ASM_XTENSA_REG_A2
+#define REG_ARG_2 ASM_XTENSA_REG_A3
+#define REG_ARG_3 ASM_XTENSA_REG_A4
+#define REG_ARG_4 ASM_XTENSA_REG_A5
+#define REG_ARG_5 ASM_XTENSA_REG_A6
+
+#define REG_TEMP0 ASM_XTENSA_REG_A2
+#define REG_TEMP1 ASM_XTENSA_REG_A3
+#define REG_TEMP2 ASM_XTENSA_REG_A4
+
+// a15 holds mp_fun_table
+#define REG_LOCAL_1 ASM_XTENSA_REG_A12
+#define REG_LOCAL_2 ASM_XTENSA_REG_A13
+#define REG_LOCAL_3 ASM_XTENSA_REG_A14
+#define REG_LOCAL_NUM (3)
+
+#define ASM_PASS_COMPUTE    ASM_XTENSA_PASS_COMPUTE
+#define ASM_PASS_EMIT       ASM_XTENSA_PASS_EMIT
+
+#define ASM_T               asm_xtensa_t
+#define ASM_NEW             asm_xtensa_new
+#define ASM_FREE            asm_xtensa_free
+#define ASM_GET_CODE        asm_xtensa_get_code
+#define ASM_GET_CODE_POS    asm_xtensa_get_code_pos
+#define ASM_GET_CODE_SIZE   asm_xtensa_get_code_size
+#define ASM_START_PASS      asm_xtensa_start_pass
+#define ASM_END_PASS        asm_xtensa_end_pass
+#define ASM_ENTRY           asm_xtensa_entry
+#define ASM_EXIT            asm_xtensa_exit
+
+#define ASM_ALIGN           asm_xtensa_align
+#define ASM_DATA            asm_xtensa_data
+
+#define ASM_LABEL_ASSIGN    asm_xtensa_label_assign
+#define ASM_JUMP            asm_xtensa_j_label
+#define ASM_JUMP_IF_REG_ZERO(as, reg, label) \
+    asm_xtensa_bccz_reg_label(as, ASM_XTENSA_CCZ_EQ, reg, label)
+#define ASM_JUMP_IF_REG_NONZERO(as, reg, label) \
+    asm_xtensa_bccz_reg_label(as, ASM_XTENSA_CCZ_NE, reg, label)
+#define ASM_JUMP_IF_REG_EQ(as, reg1, reg2, label) \
+    asm_xtensa_bcc_reg_reg_label(as, ASM_XTENSA_CC_EQ, reg1, reg2, label)
+#define ASM_JUMP_IF_REG_NE(as, reg1, reg2, label) \
+    asm_xtensa_bcc_reg_reg_label(as, ASM_XTENSA_CC_NE, reg1, reg2, label)
+#define ASM_CALL_IND(as, ptr, idx) asm_xtensa_call_ind(as, (idx))
+
+#define ASM_MOV_REG_TO_LOCAL(as, reg, local_num) asm_xtensa_mov_local_reg(as, (local_num), (reg))
+#define ASM_MOV_IMM_TO_REG(as, imm, reg) asm_xtensa_mov_reg_i32(as, (reg), (imm))
+// pointers go in the word-aligned literal pool, where the GC can see them
+#define ASM_MOV_ALIGNED_IMM_TO_REG(as, imm, reg) asm_xtensa_mov_reg_literal(as, (reg), (imm))
+#define ASM_MOV_IMM_TO_LOCAL_USING(as, imm, local_num, reg_temp) \
+    do { \
+        asm_xtensa_mov_reg_literal(as, (reg_temp), (imm)); \
+        asm_xtensa_mov_local_reg(as, (local_num), (reg_temp)); \
+    } while (false)
+#define ASM_MOV_LOCAL_TO_REG(as, local_num, reg) asm_xtensa_mov_reg_local(as, (reg), (local_num))
+#define ASM_MOV_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_mov_n((as), (reg_dest), (reg_src))
+#define ASM_MOV_LOCAL_ADDR_TO_REG(as, local_num, reg) asm_xtensa_mov_reg_local_addr(as, (reg), (local_num))
+
+#define ASM_LSL_REG_REG(as, reg_dest, reg_shift) \
+    do { \
+        asm_xtensa_op_ssl((as), (reg_shift)); \
+        asm_xtensa_op_sll((as), (reg_dest), (reg_dest)); \
+    } while (0)
+#define ASM_ASR_REG_REG(as, reg_dest, reg_shift) \
+    do { \
+        asm_xtensa_op_ssr((as), (reg_shift)); \
+        asm_xtensa_op_sra((as), (reg_dest), (reg_dest)); \
+    } while (0)
+#define ASM_OR_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_or((as), (reg_dest), (reg_dest), (reg_src))
+#define ASM_XOR_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_xor((as), (reg_dest), (reg_dest), (reg_src))
+#define ASM_AND_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_and((as), (reg_dest), (reg_dest), (reg_src))
+#define ASM_ADD_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_add((as), (reg_dest), (reg_dest), (reg_src))
+#define ASM_SUB_REG_REG(as, reg_dest, reg_src) asm_xtensa_op_sub((as), (reg_dest), (reg_dest), (reg_src))
+
+#define ASM_LOAD_REG_REG(as, reg_dest, reg_base) asm_xtensa_op_l32i((as), (reg_dest), (reg_base), 0)
+#define ASM_LOAD_REG_REG_OFFSET(as, reg_dest, reg_base, word_offset) asm_xtensa_op_l32i((as), (reg_dest), (reg_base), (word_offset))
+#define ASM_LOAD8_REG_REG(as, reg_dest, reg_base) asm_xtensa_op_l8ui((as), (reg_dest), (reg_base), 0)
+#define ASM_LOAD16_REG_REG(as, reg_dest, reg_base) asm_xtensa_op_l16ui((as), (reg_dest), (reg_base), 0)
+#define ASM_LOAD32_REG_REG(as, reg_dest, reg_base) ASM_LOAD_REG_REG((as), (reg_dest), (reg_base))
+
+#define ASM_STORE_REG_REG(as, reg_src, reg_base) asm_xtensa_op_s32i((as), (reg_src), (reg_base), 0)
+#define ASM_STORE_REG_REG_OFFSET(as, reg_src, reg_base, word_offset) asm_xtensa_op_s32i((as), (reg_src), (reg_base), (word_offset))
+#define ASM_STORE8_REG_REG(as, reg_src, reg_base) asm_xtensa_op_s8i((as), (reg_src), (reg_base), 0)
+#define ASM_STORE16_REG_REG(as, reg_src, reg_base) asm_xtensa_op_s16i((as), (reg_src), (reg_base), 0)
+#define ASM_STORE32_REG_REG(as, reg_src, reg_base) ASM_STORE_REG_REG((as), (reg_src), (reg_base))
 
 #else
 
@@ -490,31 +618,53 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
 
 #endif
 
+// unboxed floats are held in a machine word, and need FPU support in the emitter
+#if MICROPY_EMIT_NATIVE_FLOAT && ((N_X64 && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE) \
+    || (N_THUMB && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT))
+#define N_FLOAT (1)
+#else
+#define N_FLOAT (0)
+#endif
+
 #define EMIT_NATIVE_VIPER_TYPE_ERROR(emit, ...) do { \
         *emit->error_slot = mp_obj_new_exception_msg_varg(&mp_type_ViperTypeError, __VA_ARGS__); \
     } while (0)
 
+// callee-save registers available for holding locals, in order of preference
+STATIC const byte reg_local_table[REG_LOCAL_NUM] = {
+    REG_LOCAL_1, REG_LOCAL_2, REG_LOCAL_3,
+    #if REG_LOCAL_NUM > 3
+    REG_LOCAL_4, REG_LOCAL_5,
+    #endif
+};
+
+#define LIVE_POS_NONE ((mp_uint_t)-1)
+
 typedef enum {
     STACK_VALUE,
     STACK_REG,
     STACK_IMM,
 } stack_info_kind_t;
 
-// these enums must be distinct and the bottom 2 bits
+// these enums must be distinct and the bottom 4 bits
 // must correspond to the correct MP_NATIVE_TYPE_xxx value
 typedef enum {
     VTYPE_PYOBJ = 0x00 | MP_NATIVE_TYPE_OBJ,
     VTYPE_BOOL = 0x00 | MP_NATIVE_TYPE_BOOL,
     VTYPE_INT = 0x00 | MP_NATIVE_TYPE_INT,
     VTYPE_UINT = 0x00 | MP_NATIVE_TYPE_UINT,
+    VTYPE_FLOAT = 0x00 | MP_NATIVE_TYPE_FLOAT,
 
     VTYPE_PTR = 0x10 | MP_NATIVE_TYPE_UINT, // pointer to word sized entity
     VTYPE_PTR8 = 0x20 | MP_NATIVE_TYPE_UINT,
     VTYPE_PTR16 = 0x30 | MP_NATIVE_TYPE_UINT,
-    VTYPE_PTR_NONE = 0x40 | MP_NATIVE_TYPE_UINT,
+    VTYPE_PTR32 = 0x40 | MP_NATIVE_TYPE_UINT,
+    VTYPE_PTRF = 0x50 | MP_NATIVE_TYPE_UINT, // pointer to 32-bit float
+    VTYPE_PTRD = 0x60 | MP_NATIVE_TYPE_UINT, // pointer to 64-bit double
+    VTYPE_PTR_NONE = 0x70 | MP_NATIVE_TYPE_UINT,
 
-    VTYPE_UNBOUND = 0x50 | MP_NATIVE_TYPE_OBJ,
-    VTYPE_BUILTIN_CAST = 0x60 | MP_NATIVE_TYPE_OBJ,
+    VTYPE_UNBOUND = 0x80 | MP_NATIVE_TYPE_OBJ,
+    VTYPE_BUILTIN_CAST = 0x90 | MP_NATIVE_TYPE_OBJ,
 } vtype_kind_t;
 
 STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
@@ -523,13 +673,56 @@ STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
         case VTYPE_BOOL: return MP_QSTR_bool;
         case VTYPE_INT: return MP_QSTR_int;
         case VTYPE_UINT: return MP_QSTR_uint;
+        #if N_FLOAT
+        case VTYPE_FLOAT: return MP_QSTR_float;
+        #endif
         case VTYPE_PTR: return MP_QSTR_ptr;
         case VTYPE_PTR8: return MP_QSTR_ptr8;
         case VTYPE_PTR16: return MP_QSTR_ptr16;
+        case VTYPE_PTR32: return MP_QSTR_ptr32;
+        #if N_FLOAT
+        case VTYPE_PTRF: return MP_QSTR_ptrf;
+        case VTYPE_PTRD: return MP_QSTR_ptrd;
+        #endif
         case VTYPE_PTR_NONE: default: return MP_QSTR_None;
     }
 }
 
+// Where a local lives, and (for viper) the range of positions over which it
+// is live.  Positions are counted in units of load_fast/store_fast, and are
+// computed during MP_PASS_STACK_SIZE so that registers can be allocated
+// before the code size is computed.
+typedef struct _local_info_t {
+    mp_uint_t live_start;
+    mp_uint_t live_end;
+    int reg; // -1 if the local is kept in memory
+    int slot;
+} local_info_t;
+
+// A try block that is open at the current point in the code.  The nlr_buf for
+// the block lives on the value stack at stack_base; it is pushed while the
+// body of the try is running, and popped once a handler or finally is entered.
+typedef struct _exc_stack_entry_t {
+    mp_uint_t label;
+    mp_uint_t stack_base;
+    bool is_finally;
+    bool is_active;
+    bool in_handler;
+} exc_stack_entry_t;
+
+// A jump out of a try block that must go via a finally handler; the handler
+// is entered with MP_OBJ_NEW_SMALL_INT(label) on the top of the stack and
+// end_finally then continues at label, which unwinds the remaining depth
+// try blocks on the way to target.
+typedef struct _unwind_info_t {
+    mp_uint_t exc_level;
+    mp_uint_t label;
+    mp_uint_t target;
+    mp_uint_t depth;
+} unwind_info_t;
+
+#define UNWIND_TARGET_RETURN ((mp_uint_t)-1)
+
 typedef struct _stack_info_t {
     vtype_kind_t vtype;
     stack_info_kind_t kind;
@@ -549,11 +742,26 @@ struct _emit_t {
 
     mp_uint_t local_vtype_alloc;
     vtype_kind_t *local_vtype;
+    local_info_t *local_info;
+
+    mp_uint_t max_num_labels;
+    mp_uint_t *label_live_pos;
+    mp_uint_t live_pos;
+    mp_uint_t num_local_slots;
 
     mp_uint_t stack_info_alloc;
     stack_info_t *stack_info;
     vtype_kind_t saved_stack_vtype;
 
+    uint *label_slot;
+    bool has_exc_handler;
+    mp_uint_t exc_stack_alloc;
+    mp_uint_t exc_stack_size;
+    exc_stack_entry_t *exc_stack;
+    mp_uint_t unwind_alloc;
+    mp_uint_t unwind_len;
+    unwind_info_t *unwind;
+
     int code_info_size;
     int code_info_offset;
     int prelude_offset;
@@ -568,17 +776,24 @@ struct _emit_t {
     ASM_T *as;
 };
 
-emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, mp_uint_t max_num_labels) {
+emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, uint *label_slot, mp_uint_t max_num_labels) {
     emit_t *emit = m_new0(emit_t, 1);
     emit->error_slot = error_slot;
+    emit->label_slot = label_slot;
+    emit->max_num_labels = max_num_labels;
+    emit->label_live_pos = m_new(mp_uint_t, max_num_labels);
     emit->as = ASM_NEW(max_num_labels);
     return emit;
 }
 
 void EXPORT_FUN(free)(emit_t *emit) {
     ASM_FREE(emit->as, false);
+    m_del(mp_uint_t, emit->label_live_pos, emit->max_num_labels);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
+    m_del(local_info_t, emit->local_info, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
+    m_del(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc);
+    m_del(unwind_info_t, emit->unwind, emit->unwind_alloc);
     m_del_obj(emit_t, emit);
 }
 
@@ -595,9 +810,17 @@ STATIC void emit_native_set_native_type(emit_t *emit, mp_uint_t op, mp_uint_t ar
                 case MP_QSTR_bool: type = VTYPE_BOOL; break;
                 case MP_QSTR_int: type = VTYPE_INT; break;
                 case MP_QSTR_uint: type = VTYPE_UINT; break;
+                #if N_FLOAT
+                case MP_QSTR_float: type = VTYPE_FLOAT; break;
+                #endif
                 case MP_QSTR_ptr: type = VTYPE_PTR; break;
                 case MP_QSTR_ptr8: type = VTYPE_PTR8; break;
                 case MP_QSTR_ptr16: type = VTYPE_PTR16; break;
+                case MP_QSTR_ptr32: type = VTYPE_PTR32; break;
+                #if N_FLOAT
+                case MP_QSTR_ptrf: type = VTYPE_PTRF; break;
+                case MP_QSTR_ptrd: type = VTYPE_PTRD; break;
+                #endif
                 default: EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "unknown type '%q'", arg2); return;
             }
             if (op == MP_EMIT_NATIVE_TYPE_RETURN) {
@@ -617,6 +840,145 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num);
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num);
 
 #define STATE_START (sizeof(mp_code_state) / sizeof(mp_uint_t))
+#define NLR_BUF_SIZE (sizeof(nlr_buf_t) / sizeof(mp_uint_t))
+
+// Holds the return value while a return unwinds through finally handlers.  It
+// is just above the value stack: for viper an extra slot is allocated for it,
+// and for native code it falls below the locals, in the part of the state
+// that is only used by bytecode.
+#define UNWIND_RETURN_SLOT(emit) ((emit)->stack_start + (emit)->scope->stack_size)
+
+STATIC bool emit_native_live_pass(emit_t *emit) {
+    return emit->do_viper_types && emit->pass == MP_PASS_STACK_SIZE;
+}
+
+// record a use of a local at the next position
+STATIC void emit_native_live_ref(emit_t *emit, mp_uint_t local_num) {
+    if (emit_native_live_pass(emit)) {
+        local_info_t *li = &emit->local_info[local_num];
+        mp_uint_t pos = ++emit->live_pos;
+        if (li->live_start == LIVE_POS_NONE) {
+            li->live_start = pos;
+        }
+        li->live_end = pos;
+    }
+}
+
+// A backward jump makes every local that is live anywhere in the loop body
+// live over the whole loop, since its value may flow around the back edge.
+STATIC void emit_native_live_jump(emit_t *emit, mp_uint_t label) {
+    if (emit_native_live_pass(emit) && emit->label_live_pos[label] != LIVE_POS_NONE) {
+        mp_uint_t loop_start = emit->label_live_pos[label];
+        mp_uint_t loop_end = emit->live_pos;
+        for (mp_uint_t i = 0; i < emit->scope->num_locals; i++) {
+            local_info_t *li = &emit->local_info[i];
+            if (li->live_start != LIVE_POS_NONE && li->live_start <= loop_end && li->live_end >= loop_start) {
+                if (li->live_start > loop_start) {
+                    li->live_start = loop_start;
+                }
+                if (li->live_end < loop_end) {
+                    li->live_end = loop_end;
+                }
+            }
+        }
+    }
+}
+
+// Linear-scan allocation of the callee-save registers to viper locals, using
+// the live ranges computed in MP_PASS_STACK_SIZE.  Locals are visited in order
+// of the start of their range; when no register is free the local whose range
+// ends last is spilled to memory.  Returns the number of memory slots used.
+STATIC mp_uint_t emit_native_alloc_locals(emit_t *emit) {
+    mp_uint_t num_locals = emit->scope->num_locals;
+    int active[REG_LOCAL_NUM];
+    for (int r = 0; r < REG_LOCAL_NUM; r++) {
+        active[r] = -1;
+    }
+    for (mp_uint_t i = 0; i < num_locals; i++) {
+        emit->local_info[i].reg = -1;
+        emit->local_info[i].slot = -1;
+    }
+
+    // registers are restored by nlr when an exception is caught, so if there
+    // are exception handlers then a local changed within a try block must be
+    // kept in memory
+    mp_uint_t prev_start = 0;
+    mp_uint_t prev_local = 0;
+    for (mp_uint_t n = 0; n < num_locals && !emit->has_exc_handler; n++) {
+        // find the next local in order of (live_start, local_num)
+        local_info_t *li = NULL;
+        mp_uint_t cur_local = 0;
+        for (mp_uint_t i = 0; i < num_locals; i++) {
+            local_info_t *lj = &emit->local_info[i];
+            if (lj->live_start == LIVE_POS_NONE) {
+                continue;
+            }
+            if (n > 0 && (lj->live_start < prev_start || (lj->live_start == prev_start && i <= prev_local))) {
+                continue;
+            }
+            if (li == NULL || lj->live_start < li->live_start) {
+                li = lj;
+                cur_local = i;
+            }
+        }
+        if (li == NULL) {
+            break;
+        }
+        prev_start = li->live_start;
+        prev_local = cur_local;
+
+        // expire ranges that ended before this one starts, and find a free register
+        int free_r = -1;
+        int furthest_r = -1;
+        for (int r = 0; r < REG_LOCAL_NUM; r++) {
+            if (active[r] >= 0 && emit->local_info[active[r]].live_end < li->live_start) {
+                active[r] = -1;
+            }
+            if (active[r] < 0) {
+                if (free_r < 0) {
+                    free_r = r;
+                }
+            } else if (furthest_r < 0 || emit->local_info[active[r]].live_end > emit->local_info[active[furthest_r]].live_end) {
+                furthest_r = r;
+            }
+        }
+
+        if (free_r < 0 && emit->local_info[active[furthest_r]].live_end > li->live_end) {
+            // steal the register from the local that is live the longest
+            emit->local_info[active[furthest_r]].reg = -1;
+            free_r = furthest_r;
+        }
+        if (free_r >= 0) {
+            active[free_r] = cur_local;
+            li->reg = reg_local_table[free_r];
+        }
+    }
+
+    // locals without a register get consecutive memory slots
+    mp_uint_t num_slots = 0;
+    for (mp_uint_t i = 0; i < num_locals; i++) {
+        local_info_t *li = &emit->local_info[i];
+        if (li->live_start != LIVE_POS_NONE && li->reg < 0) {
+            li->slot = num_slots++;
+        }
+    }
+    return num_slots;
+}
+
+// ARM and Xtensa call the runtime through mp_fun_table held in a register,
+// so it's loaded straight after the entry, before the call to
+// mp_setup_code_state
+STATIC void emit_native_load_fun_table(emit_t *emit) {
+    #if N_ARM
+    // TODO don't load r7 if we don't need it
+    asm_arm_mov_reg_i32(emit->as, ASM_ARM_REG_R7, (mp_uint_t)mp_fun_table);
+    #elif N_XTENSA
+    // TODO don't load a15 if we don't need it
+    asm_xtensa_mov_reg_literal(emit->as, ASM_XTENSA_REG_A15, (mp_uint_t)mp_fun_table);
+    #else
+    (void)emit;
+    #endif
+}
 
 STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     DEBUG_printf("start_pass(pass=%u, scope=%p)\n", pass, scope);
@@ -626,10 +988,17 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     emit->stack_size = 0;
     emit->last_emit_was_return_value = false;
     emit->scope = scope;
+    emit->exc_stack_size = 0;
+    emit->unwind_len = 0;
+    if (pass == MP_PASS_STACK_SIZE) {
+        // found out by setup_except/setup_finally during this pass
+        emit->has_exc_handler = false;
+    }
 
-    // allocate memory for keeping track of the types of locals
+    // allocate memory for keeping track of the types and locations of locals
     if (emit->local_vtype_alloc < scope->num_locals) {
         emit->local_vtype = m_renew(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc, scope->num_locals);
+        emit->local_info = m_renew(local_info_t, emit->local_info, emit->local_vtype_alloc, scope->num_locals);
         emit->local_vtype_alloc = scope->num_locals;
     }
 
@@ -673,47 +1042,67 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
     if (emit->do_viper_types) {
 
+        // work out where each local lives
+        if (pass == MP_PASS_STACK_SIZE) {
+            // use a fixed assignment while the live ranges are computed
+            emit->live_pos = 0;
+            emit->num_local_slots = 0;
+            for (mp_uint_t i = 0; i < emit->max_num_labels; i++) {
+                emit->label_live_pos[i] = LIVE_POS_NONE;
+            }
+            for (mp_uint_t i = 0; i < scope->num_locals; i++) {
+                local_info_t *li = &emit->local_info[i];
+                // arguments are live from entry to the function
+                li->live_start = i < scope->num_pos_args ? 0 : LIVE_POS_NONE;
+                li->live_end = 0;
+                if (i < REG_LOCAL_NUM) {
+                    li->reg = reg_local_table[i];
+                    li->slot = -1;
+                } else {
+                    li->reg = -1;
+                    li->slot = i - REG_LOCAL_NUM;
+                    emit->num_local_slots = li->slot + 1;
+                }
+            }
+        } else if (pass == MP_PASS_CODE_SIZE) {
+            emit->num_local_slots = emit_native_alloc_locals(emit);
+        }
+
         // entry to function
         int num_locals = 0;
         if (pass > MP_PASS_SCOPE) {
-            num_locals = scope->num_locals - REG_LOCAL_NUM;
-            if (num_locals < 0) {
-                num_locals = 0;
+            emit->stack_start = emit->num_local_slots;
+            num_locals = emit->stack_start + scope->stack_size;
+            if (emit->has_exc_handler) {
+                // for UNWIND_RETURN_SLOT
+                num_locals += 1;
             }
-            emit->stack_start = num_locals;
-            num_locals += scope->stack_size;
         }
         ASM_ENTRY(emit->as, num_locals);
+        emit_native_load_fun_table(emit);
 
-        #if N_X86
+        // move arguments to their allocated location
         for (int i = 0; i < scope->num_pos_args; i++) {
-            if (i == 0) {
-                asm_x86_mov_arg_to_r32(emit->as, i, REG_LOCAL_1);
-            } else if (i == 1) {
-                asm_x86_mov_arg_to_r32(emit->as, i, REG_LOCAL_2);
-            } else if (i == 2) {
-                asm_x86_mov_arg_to_r32(emit->as, i, REG_LOCAL_3);
-            } else {
+            local_info_t *li = &emit->local_info[i];
+            #if N_X86
+            if (li->reg >= 0) {
+                asm_x86_mov_arg_to_r32(emit->as, i, li->reg);
+            } else if (li->slot >= 0) {
                 asm_x86_mov_arg_to_r32(emit->as, i, REG_TEMP0);
-                asm_x86_mov_r32_to_local(emit->as, REG_TEMP0, i - REG_LOCAL_NUM);
+                asm_x86_mov_r32_to_local(emit->as, REG_TEMP0, li->slot);
             }
-        }
-        #else
-        for (int i = 0; i < scope->num_pos_args; i++) {
-            if (i == 0) {
-                ASM_MOV_REG_REG(emit->as, REG_LOCAL_1, REG_ARG_1);
-            } else if (i == 1) {
-                ASM_MOV_REG_REG(emit->as, REG_LOCAL_2, REG_ARG_2);
-            } else if (i == 2) {
-                ASM_MOV_REG_REG(emit->as, REG_LOCAL_3, REG_ARG_3);
-            } else if (i == 3) {
-                ASM_MOV_REG_TO_LOCAL(emit->as, REG_ARG_4, i - REG_LOCAL_NUM);
-            } else {
+            #else
+            static const byte reg_arg_table[] = {REG_ARG_1, REG_ARG_2, REG_ARG_3, REG_ARG_4};
+            if (i >= 4) {
                 // TODO not implemented
                 assert(0);
+            } else if (li->reg >= 0) {
+                ASM_MOV_REG_REG(emit->as, li->reg, reg_arg_table[i]);
+            } else if (li->slot >= 0) {
+                ASM_MOV_REG_TO_LOCAL(emit->as, reg_arg_table[i], li->slot);
             }
+            #endif
         }
-        #endif
 
     } else {
         // work out size of state (locals plus stack)
@@ -721,6 +1110,7 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
         // allocate space on C-stack for code_state structure, which includes state
         ASM_ENTRY(emit->as, STATE_START + emit->n_state);
+        emit_native_load_fun_table(emit);
 
         // prepare incoming arguments for call to mp_setup_code_state
         #if N_X86
@@ -768,14 +1158,14 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         ASM_CALL_IND(emit->as, mp_fun_table[MP_F_SETUP_CODE_STATE], MP_F_SETUP_CODE_STATE);
         #endif
 
-        // cache some locals in registers
-        if (scope->num_locals > 0) {
-            ASM_MOV_LOCAL_TO_REG(emit->as, STATE_START + emit->n_state - 1 - 0, REG_LOCAL_1);
-            if (scope->num_locals > 1) {
-                ASM_MOV_LOCAL_TO_REG(emit->as, STATE_START + emit->n_state - 1 - 1, REG_LOCAL_2);
-                if (scope->num_locals > 2) {
-                    ASM_MOV_LOCAL_TO_REG(emit->as, STATE_START + emit->n_state - 1 - 2, REG_LOCAL_3);
-                }
+        // cache some locals in registers, unless an exception handler could
+        // see registers restored by nlr to their values at the nlr_push
+        for (mp_uint_t i = 0; i < scope->num_locals; i++) {
+            local_info_t *li = &emit->local_info[i];
+            li->reg = -1;
+            if (i < REG_LOCAL_NUM && !emit->has_exc_handler) {
+                li->reg = reg_local_table[i];
+                ASM_MOV_LOCAL_TO_REG(emit->as, STATE_START + emit->n_state - 1 - i, li->reg);
             }
         }
 
@@ -793,12 +1183,32 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     asm_thumb_mov_reg_i32(emit->as, ASM_THUMB_REG_R7, (mp_uint_t)mp_fun_table);
     #endif
 
-    #if N_ARM
-    // TODO don't load r7 if we don't need it
-    asm_arm_mov_reg_i32(emit->as, ASM_ARM_REG_R7, (mp_uint_t)mp_fun_table);
-    #endif
 }
 
+#if MICROPY_EMIT_NATIVE_PERF_MAP
+// name native code "py:<file>:<outer>.<inner>" after its scope and those
+// enclosing it, up to the module
+STATIC void emit_native_perf_map(scope_t *scope, const void *code, mp_uint_t len) {
+    scope_t *names[8];
+    mp_uint_t n = 0;
+    for (scope_t *s = scope; s != NULL && s->kind != SCOPE_MODULE && n < MP_ARRAY_SIZE(names); s = s->parent) {
+        names[n++] = s;
+    }
+    VSTR_SMALL(vstr);
+    vstr_add_str(&vstr, "py:");
+    vstr_add_str(&vstr, qstr_str(scope->source_file));
+    vstr_add_char(&vstr, ':');
+    while (n-- > 0) {
+        vstr_add_str(&vstr, qstr_str(names[n]->simple_name));
+        if (n > 0) {
+            vstr_add_char(&vstr, '.');
+        }
+    }
+    mp_hal_perf_map_add(code, len, vstr_null_terminated_str(&vstr));
+    vstr_clear(&vstr);
+}
+#endif
+
 STATIC void emit_native_end_pass(emit_t *emit) {
     if (!emit->last_emit_was_return_value) {
         ASM_EXIT(emit->as);
@@ -827,7 +1237,7 @@ STATIC void emit_native_end_pass(emit_t *emit) {
         emit->prelude_offset = ASM_GET_CODE_POS(emit->as);
         for (int i = 0; i < emit->scope->id_info_len; i++) {
             id_info_t *id = &emit->scope->id_info[i];
-            if (id->kind == ID_INFO_KIND_CELL) {
+            if (id->kind == ID_INFO_KIND_CELL && !(id->flags & ID_FLAG_IS_BY_VALUE)) {
                 assert(id->local_num < 255);
                 ASM_DATA(emit->as, 1, id->local_num); // write the local which should be converted to a cell
             }
@@ -847,16 +1257,27 @@ STATIC void emit_native_end_pass(emit_t *emit) {
         mp_uint_t f_len = ASM_GET_CODE_SIZE(emit->as);
 
         // compute type signature
-        // note that the lower 2 bits of a vtype are tho correct MP_NATIVE_TYPE_xxx
-        mp_uint_t type_sig = emit->return_vtype & 3;
+        // note that the lower 4 bits of a vtype are tho correct MP_NATIVE_TYPE_xxx
+        mp_uint_t type_sig = emit->return_vtype & 0xf;
         for (mp_uint_t i = 0; i < emit->scope->num_pos_args; i++) {
-            type_sig |= (emit->local_vtype[i] & 3) << (i * 2 + 2);
+            type_sig |= (emit->local_vtype[i] & 0xf) << (i * 4 + 4);
+        }
+
+        // the arg names, which follow the dummy code info, act as the constant table
+        const mp_uint_t *const_table = NULL;
+        if (!emit->do_viper_types) {
+            const_table = (const mp_uint_t*)((byte*)f + emit->code_info_offset + emit->code_info_size);
         }
 
         mp_emit_glue_assign_native(emit->scope->raw_code,
             emit->do_viper_types ? MP_CODE_NATIVE_VIPER : MP_CODE_NATIVE_PY,
-            f, f_len, emit->scope->num_pos_args, emit->scope->num_kwonly_args,
+            f, f_len, const_table, emit->scope->num_pos_args, emit->scope->num_kwonly_args,
             emit->scope->scope_flags, type_sig);
+
+        #if MICROPY_EMIT_NATIVE_PERF_MAP
+        // the code size is that allocated, so give the size actually emitted
+        emit_native_perf_map(emit->scope, f, ASM_GET_CODE_POS(emit->as));
+        #endif
     }
 }
 
@@ -1173,7 +1594,7 @@ STATIC void emit_get_stack_pointer_to_reg_for_pop(emit_t *emit, mp_uint_t reg_de
                     break;
                 case VTYPE_INT:
                 case VTYPE_UINT:
-                    ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (si->data.u_imm << 1) | 1, emit->stack_start + emit->stack_size - 1 - i, reg_dest);
+                    ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (mp_uint_t)MP_OBJ_NEW_SMALL_INT(si->data.u_imm), emit->stack_start + emit->stack_size - 1 - i, reg_dest);
                     si->vtype = VTYPE_PYOBJ;
                     break;
                 default:
@@ -1221,6 +1642,9 @@ STATIC void emit_native_label_assign(emit_t *emit, mp_uint_t l) {
     // need to commit stack because we can jump here from elsewhere
     need_stack_settled(emit);
     ASM_LABEL_ASSIGN(emit->as, l);
+    if (emit_native_live_pass(emit)) {
+        emit->label_live_pos[l] = emit->live_pos + 1;
+    }
     emit_post(emit);
 }
 
@@ -1316,6 +1740,15 @@ STATIC void emit_native_load_const_str(emit_t *emit, qstr qst, bool bytes) {
 
 STATIC void emit_native_load_const_obj(emit_t *emit, void *obj) {
     emit_native_pre(emit);
+    #if N_FLOAT
+    if (emit->do_viper_types && mp_obj_is_float(obj)) {
+        // viper float constants are unboxed, and held as an immediate
+        union { mp_float_t f; mp_int_t i; } v = {.i = 0};
+        v.f = mp_obj_float_get(obj);
+        emit_post_push_imm(emit, VTYPE_FLOAT, v.i);
+        return;
+    }
+    #endif
     need_reg_single(emit, REG_RET, 0);
     ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)obj, REG_RET);
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
@@ -1333,16 +1766,13 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
         EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "local '%q' used before type known", qst);
     }
     emit_native_pre(emit);
-    if (local_num == 0) {
-        emit_post_push_reg(emit, vtype, REG_LOCAL_1);
-    } else if (local_num == 1) {
-        emit_post_push_reg(emit, vtype, REG_LOCAL_2);
-    } else if (local_num == 2) {
-        emit_post_push_reg(emit, vtype, REG_LOCAL_3);
+    emit_native_live_ref(emit, local_num);
+    if (emit->local_info[local_num].reg >= 0) {
+        emit_post_push_reg(emit, vtype, emit->local_info[local_num].reg);
     } else {
         need_reg_single(emit, REG_TEMP0, 0);
         if (emit->do_viper_types) {
-            ASM_MOV_LOCAL_TO_REG(emit->as, local_num - REG_LOCAL_NUM, REG_TEMP0);
+            ASM_MOV_LOCAL_TO_REG(emit->as, emit->local_info[local_num].slot, REG_TEMP0);
         } else {
             ASM_MOV_LOCAL_TO_REG(emit->as, STATE_START + emit->n_state - 1 - local_num, REG_TEMP0);
         }
@@ -1377,12 +1807,24 @@ STATIC void emit_native_load_global(emit_t *emit, qstr qst) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_INT);
     } else if (emit->do_viper_types && qst == MP_QSTR_uint) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_UINT);
+    #if N_FLOAT
+    } else if (emit->do_viper_types && qst == MP_QSTR_float) {
+        emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_FLOAT);
+    #endif
     } else if (emit->do_viper_types && qst == MP_QSTR_ptr) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTR);
     } else if (emit->do_viper_types && qst == MP_QSTR_ptr8) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTR8);
     } else if (emit->do_viper_types && qst == MP_QSTR_ptr16) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTR16);
+    } else if (emit->do_viper_types && qst == MP_QSTR_ptr32) {
+        emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTR32);
+    #if N_FLOAT
+    } else if (emit->do_viper_types && qst == MP_QSTR_ptrf) {
+        emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTRF);
+    } else if (emit->do_viper_types && qst == MP_QSTR_ptrd) {
+        emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTRD);
+    #endif
     } else {
         emit_call_with_imm_arg(emit, MP_F_LOAD_GLOBAL, qst, REG_ARG_1);
         emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
@@ -1415,6 +1857,62 @@ STATIC void emit_native_load_build_class(emit_t *emit) {
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
+// add (reg_index << log2_size) to reg_base, leaving reg_index unchanged
+STATIC void emit_native_add_scaled_index(emit_t *emit, int reg_base, int reg_index, int log2_size) {
+    #if N_X64
+    asm_x64_lea_scaled_to_r64(emit->as, reg_base, reg_index, log2_size, reg_base);
+    #elif N_THUMB
+    asm_thumb_add_reg_reg_reg_lsl(emit->as, reg_base, reg_base, reg_index, log2_size);
+    #else
+    #if N_XTENSA
+    if (log2_size == 1) {
+        asm_xtensa_op_addx2(emit->as, reg_base, reg_index, reg_base);
+        return;
+    } else if (log2_size == 2) {
+        asm_xtensa_op_addx4(emit->as, reg_base, reg_index, reg_base);
+        return;
+    }
+    #endif
+    for (int i = 0; i < (1 << log2_size); i++) {
+        ASM_ADD_REG_REG(emit->as, reg_base, reg_index);
+    }
+    #endif
+}
+
+#if N_FLOAT
+STATIC void emit_native_float_from_int(emit_t *emit, int reg);
+
+#if N_X64
+// viper floats are doubles on x64, so ptrf elements must be converted
+STATIC void emit_native_float_single_to_double(emit_t *emit, int reg) {
+    asm_x64_movq_r64_to_xmm(emit->as, reg, ASM_X64_REG_XMM0);
+    asm_x64_cvtss2sd_xmm_xmm(emit->as, ASM_X64_REG_XMM0, ASM_X64_REG_XMM0);
+    asm_x64_movq_xmm_to_r64(emit->as, ASM_X64_REG_XMM0, reg);
+}
+
+STATIC void emit_native_float_double_to_single(emit_t *emit, int reg) {
+    asm_x64_movq_r64_to_xmm(emit->as, reg, ASM_X64_REG_XMM0);
+    asm_x64_cvtsd2ss_xmm_xmm(emit->as, ASM_X64_REG_XMM0, ASM_X64_REG_XMM0);
+    asm_x64_movq_xmm_to_r64(emit->as, ASM_X64_REG_XMM0, reg);
+}
+#endif
+
+// convert a value in place so it can be stored to a ptrf/ptrd element
+STATIC void emit_native_float_for_store(emit_t *emit, vtype_kind_t vtype_base, vtype_kind_t vtype_value, int reg_value) {
+    if (vtype_value == VTYPE_INT) {
+        emit_native_float_from_int(emit, reg_value);
+    } else if (vtype_value != VTYPE_FLOAT) {
+        EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
+            "can't store '%q' to '%q'", vtype_to_qstr(vtype_value), vtype_to_qstr(vtype_base));
+    }
+    #if N_X64
+    if (vtype_base == VTYPE_PTRF) {
+        emit_native_float_double_to_single(emit, reg_value);
+    }
+    #endif
+}
+#endif
+
 STATIC void emit_native_load_subscr(emit_t *emit) {
     DEBUG_printf("load_subscr\n");
     // need to compile: base[index]
@@ -1435,6 +1933,10 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
         // TODO The different machine architectures have very different
         // capabilities and requirements for loads, so probably best to
         // write a completely separate load-optimiser for each one.
+        // REG_RET receives the result and REG_ARG_2 may be used as a
+        // temporary, so neither may hold a value further down the stack
+        need_reg_single(emit, REG_RET, 0);
+        need_reg_single(emit, REG_ARG_2, 0);
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_INT && top->kind == STACK_IMM) {
             // index is an immediate
@@ -1454,6 +1956,16 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                             asm_thumb_ldrb_rlo_rlo_i5(emit->as, REG_RET, reg_base, index_value);
                             break;
                         }
+                        #elif N_ARM
+                        if (index_value > 0 && index_value < 4096) {
+                            asm_arm_ldrb_reg_reg_i12(emit->as, REG_RET, reg_base, index_value);
+                            break;
+                        }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_l8ui(emit->as, REG_RET, reg_base, index_value);
+                            break;
+                        }
                         #endif
                         ASM_MOV_IMM_TO_REG(emit->as, index_value, reg_index);
                         ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add index to base
@@ -1471,6 +1983,16 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                             asm_thumb_ldrh_rlo_rlo_i5(emit->as, REG_RET, reg_base, index_value);
                             break;
                         }
+                        #elif N_ARM
+                        if (index_value > 0 && index_value < 128) {
+                            asm_arm_ldrh_reg_reg_i8(emit->as, REG_RET, reg_base, index_value << 1);
+                            break;
+                        }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_l16ui(emit->as, REG_RET, reg_base, index_value);
+                            break;
+                        }
                         #endif
                         ASM_MOV_IMM_TO_REG(emit->as, index_value << 1, reg_index);
                         ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add 2*index to base
@@ -1479,6 +2001,64 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                     ASM_LOAD16_REG_REG(emit->as, REG_RET, reg_base); // load from (base+2*index)
                     break;
                 }
+                case VTYPE_PTR32:
+                #if N_FLOAT
+                case VTYPE_PTRF:
+                #endif
+                {
+                    // pointer to 32-bit memory
+                    if (index_value != 0) {
+                        // index is a non-zero immediate
+                        #if N_X64
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x64_mov_mem32_to_r64zx(emit->as, reg_base, index_value << 2, REG_RET);
+                            break;
+                        }
+                        #elif N_X86
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x86_mov_mem32_to_r32(emit->as, reg_base, index_value << 2, REG_RET);
+                            break;
+                        }
+                        #elif N_THUMB
+                        if (index_value > 0 && index_value < 32) {
+                            asm_thumb_ldr_rlo_rlo_i5(emit->as, REG_RET, reg_base, index_value);
+                            break;
+                        }
+                        #elif N_ARM
+                        if (index_value > 0 && index_value < 1024) {
+                            asm_arm_ldr_reg_reg(emit->as, REG_RET, reg_base, index_value << 2);
+                            break;
+                        }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_l32i(emit->as, REG_RET, reg_base, index_value);
+                            break;
+                        }
+                        #endif
+                        ASM_MOV_IMM_TO_REG(emit->as, index_value << 2, reg_index);
+                        ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add 4*index to base
+                        reg_base = reg_index;
+                    }
+                    ASM_LOAD32_REG_REG(emit->as, REG_RET, reg_base); // load from (base+4*index)
+                    break;
+                }
+                #if N_FLOAT && N_X64
+                case VTYPE_PTRD: {
+                    // pointer to 64-bit memory
+                    if (index_value != 0) {
+                        // index is a non-zero immediate
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x64_mov_mem64_to_r64(emit->as, reg_base, index_value << 3, REG_RET);
+                            break;
+                        }
+                        ASM_MOV_IMM_TO_REG(emit->as, index_value << 3, reg_index);
+                        ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add 8*index to base
+                        reg_base = reg_index;
+                    }
+                    ASM_LOAD_REG_REG(emit->as, REG_RET, reg_base); // load from (base+8*index)
+                    break;
+                }
+                #endif
                 default:
                     EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                         "can't load from '%q'", vtype_to_qstr(vtype_base));
@@ -1494,6 +2074,10 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                     // pointer to 8-bit memory
                     // TODO optimise to use thumb ldrb r1, [r2, r3]
                     assert(vtype_index == VTYPE_INT);
+                    #if N_ARM
+                    asm_arm_ldrb_reg_reg_reg(emit->as, REG_RET, REG_ARG_1, reg_index);
+                    break;
+                    #endif
                     ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
                     ASM_LOAD8_REG_REG(emit->as, REG_RET, REG_ARG_1); // store value to (base+index)
                     break;
@@ -1501,32 +2085,67 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                 case VTYPE_PTR16: {
                     // pointer to 16-bit memory
                     assert(vtype_index == VTYPE_INT);
-                    ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
-                    ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
+                    #if N_ARM
+                    asm_arm_ldrh_reg_reg_reg(emit->as, REG_RET, REG_ARG_1, reg_index);
+                    break;
+                    #endif
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 1); // add 2*index to base
                     ASM_LOAD16_REG_REG(emit->as, REG_RET, REG_ARG_1); // load from (base+2*index)
                     break;
                 }
+                case VTYPE_PTR32:
+                #if N_FLOAT
+                case VTYPE_PTRF:
+                #endif
+                {
+                    // pointer to 32-bit memory
+                    assert(vtype_index == VTYPE_INT);
+                    #if N_ARM
+                    asm_arm_ldr_reg_reg_reg(emit->as, REG_RET, REG_ARG_1, reg_index);
+                    break;
+                    #endif
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 2); // add 4*index to base
+                    ASM_LOAD32_REG_REG(emit->as, REG_RET, REG_ARG_1); // load from (base+4*index)
+                    break;
+                }
+                #if N_FLOAT && N_X64
+                case VTYPE_PTRD: {
+                    // pointer to 64-bit memory
+                    assert(vtype_index == VTYPE_INT);
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 3); // add 8*index to base
+                    ASM_LOAD_REG_REG(emit->as, REG_RET, REG_ARG_1); // load from (base+8*index)
+                    break;
+                }
+                #endif
                 default:
                     EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                         "can't load from '%q'", vtype_to_qstr(vtype_base));
             }
         }
+        #if N_FLOAT
+        if (vtype_base == VTYPE_PTRF || vtype_base == VTYPE_PTRD) {
+            #if N_X64
+            if (vtype_base == VTYPE_PTRF) {
+                emit_native_float_single_to_double(emit, REG_RET);
+            }
+            #endif
+            emit_post_push_reg(emit, VTYPE_FLOAT, REG_RET);
+            return;
+        }
+        #endif
         emit_post_push_reg(emit, VTYPE_INT, REG_RET);
     }
 }
 
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     vtype_kind_t vtype;
-    if (local_num == 0) {
-        emit_pre_pop_reg(emit, &vtype, REG_LOCAL_1);
-    } else if (local_num == 1) {
-        emit_pre_pop_reg(emit, &vtype, REG_LOCAL_2);
-    } else if (local_num == 2) {
-        emit_pre_pop_reg(emit, &vtype, REG_LOCAL_3);
+    emit_native_live_ref(emit, local_num);
+    if (emit->local_info[local_num].reg >= 0) {
+        emit_pre_pop_reg(emit, &vtype, emit->local_info[local_num].reg);
     } else {
         emit_pre_pop_reg(emit, &vtype, REG_TEMP0);
         if (emit->do_viper_types) {
-            ASM_MOV_REG_TO_LOCAL(emit->as, REG_TEMP0, local_num - REG_LOCAL_NUM);
+            ASM_MOV_REG_TO_LOCAL(emit->as, REG_TEMP0, emit->local_info[local_num].slot);
         } else {
             ASM_MOV_REG_TO_LOCAL(emit->as, REG_TEMP0, STATE_START + emit->n_state - 1 - local_num);
         }
@@ -1624,7 +2243,17 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
             // special case: x86 needs byte stores to be from lower 4 regs (REG_ARG_3 is EDX)
             emit_pre_pop_reg(emit, &vtype_value, reg_value);
             #else
-            emit_pre_pop_reg_flexible(emit, &vtype_value, &reg_value, reg_base, reg_index);
+            if (N_FLOAT && (vtype_base == VTYPE_PTRF || vtype_base == VTYPE_PTRD)) {
+                // the value may be converted in place, so needs its own register
+                emit_pre_pop_reg(emit, &vtype_value, reg_value);
+            } else {
+                emit_pre_pop_reg_flexible(emit, &vtype_value, &reg_value, reg_base, reg_index);
+            }
+            #endif
+            #if N_FLOAT
+            if (vtype_base == VTYPE_PTRF || vtype_base == VTYPE_PTRD) {
+                emit_native_float_for_store(emit, vtype_base, vtype_value, reg_value);
+            }
             #endif
             switch (vtype_base) {
                 case VTYPE_PTR8: {
@@ -1637,6 +2266,11 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                             asm_thumb_strb_rlo_rlo_i5(emit->as, reg_value, reg_base, index_value);
                             break;
                         }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_s8i(emit->as, reg_value, reg_base, index_value);
+                            break;
+                        }
                         #endif
                         ASM_MOV_IMM_TO_REG(emit->as, index_value, reg_index);
                         #if N_ARM
@@ -1658,6 +2292,11 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                             asm_thumb_strh_rlo_rlo_i5(emit->as, reg_value, reg_base, index_value);
                             break;
                         }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_s16i(emit->as, reg_value, reg_base, index_value);
+                            break;
+                        }
                         #endif
                         ASM_MOV_IMM_TO_REG(emit->as, index_value << 1, reg_index);
                         #if N_ARM
@@ -1670,6 +2309,64 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                     ASM_STORE16_REG_REG(emit->as, reg_value, reg_base); // store value to (base+2*index)
                     break;
                 }
+                case VTYPE_PTR32:
+                #if N_FLOAT
+                case VTYPE_PTRF:
+                #endif
+                {
+                    // pointer to 32-bit memory
+                    if (index_value != 0) {
+                        // index is a non-zero immediate
+                        #if N_X64
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x64_mov_r32_to_mem32(emit->as, reg_value, reg_base, index_value << 2);
+                            break;
+                        }
+                        #elif N_X86
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x86_mov_r32_to_mem32(emit->as, reg_value, reg_base, index_value << 2);
+                            break;
+                        }
+                        #elif N_THUMB
+                        if (index_value > 0 && index_value < 32) {
+                            asm_thumb_str_rlo_rlo_i5(emit->as, reg_value, reg_base, index_value);
+                            break;
+                        }
+                        #elif N_ARM
+                        if (index_value > 0 && index_value < 1024) {
+                            asm_arm_str_reg_reg(emit->as, reg_value, reg_base, index_value << 2);
+                            break;
+                        }
+                        #elif N_XTENSA
+                        if (index_value > 0 && index_value < 256) {
+                            asm_xtensa_op_s32i(emit->as, reg_value, reg_base, index_value);
+                            break;
+                        }
+                        #endif
+                        ASM_MOV_IMM_TO_REG(emit->as, index_value << 2, reg_index);
+                        ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add 4*index to base
+                        reg_base = reg_index;
+                    }
+                    ASM_STORE32_REG_REG(emit->as, reg_value, reg_base); // store value to (base+4*index)
+                    break;
+                }
+                #if N_FLOAT && N_X64
+                case VTYPE_PTRD: {
+                    // pointer to 64-bit memory
+                    if (index_value != 0) {
+                        // index is a non-zero immediate
+                        if (index_value > 0 && index_value < 0x1000000) {
+                            asm_x64_mov_r64_to_mem64(emit->as, reg_value, reg_base, index_value << 3);
+                            break;
+                        }
+                        ASM_MOV_IMM_TO_REG(emit->as, index_value << 3, reg_index);
+                        ASM_ADD_REG_REG(emit->as, reg_index, reg_base); // add 8*index to base
+                        reg_base = reg_index;
+                    }
+                    ASM_STORE_REG_REG(emit->as, reg_value, reg_base); // store value to (base+8*index)
+                    break;
+                }
+                #endif
                 default:
                     EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                         "can't store to '%q'", vtype_to_qstr(vtype_base));
@@ -1685,7 +2382,17 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
             // special case: x86 needs byte stores to be from lower 4 regs (REG_ARG_3 is EDX)
             emit_pre_pop_reg(emit, &vtype_value, reg_value);
             #else
-            emit_pre_pop_reg_flexible(emit, &vtype_value, &reg_value, REG_ARG_1, reg_index);
+            if (N_FLOAT && (vtype_base == VTYPE_PTRF || vtype_base == VTYPE_PTRD)) {
+                // the value may be converted in place, so needs its own register
+                emit_pre_pop_reg(emit, &vtype_value, reg_value);
+            } else {
+                emit_pre_pop_reg_flexible(emit, &vtype_value, &reg_value, REG_ARG_1, reg_index);
+            }
+            #endif
+            #if N_FLOAT
+            if (vtype_base == VTYPE_PTRF || vtype_base == VTYPE_PTRD) {
+                emit_native_float_for_store(emit, vtype_base, vtype_value, reg_value);
+            }
             #endif
             switch (vtype_base) {
                 case VTYPE_PTR8: {
@@ -1707,11 +2414,34 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
                     asm_arm_strh_reg_reg_reg(emit->as, reg_value, REG_ARG_1, reg_index);
                     break;
                     #endif
-                    ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
-                    ASM_ADD_REG_REG(emit->as, REG_ARG_1, reg_index); // add index to base
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 1); // add 2*index to base
                     ASM_STORE16_REG_REG(emit->as, reg_value, REG_ARG_1); // store value to (base+2*index)
                     break;
                 }
+                case VTYPE_PTR32:
+                #if N_FLOAT
+                case VTYPE_PTRF:
+                #endif
+                {
+                    // pointer to 32-bit memory
+                    assert(vtype_index == VTYPE_INT);
+                    #if N_ARM
+                    asm_arm_str_reg_reg_reg(emit->as, reg_value, REG_ARG_1, reg_index);
+                    break;
+                    #endif
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 2); // add 4*index to base
+                    ASM_STORE32_REG_REG(emit->as, reg_value, REG_ARG_1); // store value to (base+4*index)
+                    break;
+                }
+                #if N_FLOAT && N_X64
+                case VTYPE_PTRD: {
+                    // pointer to 64-bit memory
+                    assert(vtype_index == VTYPE_INT);
+                    emit_native_add_scaled_index(emit, REG_ARG_1, reg_index, 3); // add 8*index to base
+                    ASM_STORE_REG_REG(emit->as, reg_value, REG_ARG_1); // store value to (base+8*index)
+                    break;
+                }
+                #endif
                 default:
                     EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                         "can't store to '%q'", vtype_to_qstr(vtype_base));
@@ -1803,6 +2533,7 @@ STATIC void emit_native_jump(emit_t *emit, mp_uint_t label) {
     emit_native_pre(emit);
     // need to commit stack because we are jumping elsewhere
     need_stack_settled(emit);
+    emit_native_live_jump(emit, label);
     ASM_JUMP(emit->as, label);
     emit_post(emit);
 }
@@ -1837,6 +2568,7 @@ STATIC void emit_native_jump_helper(emit_t *emit, bool pop) {
 STATIC void emit_native_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
     DEBUG_printf("pop_jump_if(cond=%u, label=" UINT_FMT ")\n", cond, label);
     emit_native_jump_helper(emit, true);
+    emit_native_live_jump(emit, label);
     if (cond) {
         ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
     } else {
@@ -1848,6 +2580,7 @@ STATIC void emit_native_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
 STATIC void emit_native_jump_if_or_pop(emit_t *emit, bool cond, mp_uint_t label) {
     DEBUG_printf("jump_if_or_pop(cond=%u, label=" UINT_FMT ")\n", cond, label);
     emit_native_jump_helper(emit, false);
+    emit_native_live_jump(emit, label);
     if (cond) {
         ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
     } else {
@@ -1857,51 +2590,135 @@ STATIC void emit_native_jump_if_or_pop(emit_t *emit, bool cond, mp_uint_t label)
     emit_post(emit);
 }
 
-STATIC void emit_native_break_loop(emit_t *emit, mp_uint_t label, mp_uint_t except_depth) {
-    (void)except_depth;
-    emit_native_jump(emit, label & ~MP_EMIT_BREAK_FROM_FOR); // TODO properly
+STATIC void emit_native_push_exc_stack(emit_t *emit, mp_uint_t label, bool is_finally) {
+    if (emit->exc_stack_size >= emit->exc_stack_alloc) {
+        emit->exc_stack = m_renew(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc, emit->exc_stack_alloc + 4);
+        emit->exc_stack_alloc += 4;
+    }
+    exc_stack_entry_t *e = &emit->exc_stack[emit->exc_stack_size++];
+    e->label = label;
+    e->stack_base = emit->stack_size;
+    e->is_finally = is_finally;
+    e->is_active = true;
+    e->in_handler = false;
+}
+
+// Jump to target (or return, if target is UNWIND_TARGET_RETURN) from within
+// the innermost depth try blocks, popping their nlr_bufs.  If one of them is a
+// try/finally then the jump goes to its finally handler, and the end_finally
+// of that handler does the rest of the unwinding.  The stack must be settled.
+STATIC void emit_native_unwind_to(emit_t *emit, mp_uint_t target, mp_uint_t depth) {
+    mp_uint_t level = emit->exc_stack_size;
+    for (; depth > 0; depth--) {
+        exc_stack_entry_t *e = &emit->exc_stack[--level];
+        if (!e->is_active) {
+            // already in the handler, so nothing to pop
+            continue;
+        }
+        emit_call(emit, MP_F_NLR_POP);
+        if (e->is_finally) {
+            if (emit->unwind_len >= emit->unwind_alloc) {
+                emit->unwind = m_renew(unwind_info_t, emit->unwind, emit->unwind_alloc, emit->unwind_alloc + 4);
+                emit->unwind_alloc += 4;
+            }
+            unwind_info_t *u = &emit->unwind[emit->unwind_len++];
+            u->exc_level = level;
+            u->label = (*emit->label_slot)++; // reserved by the compiler
+            assert(u->label < emit->max_num_labels);
+            u->target = target;
+            u->depth = depth - 1;
+            // the finally handler finds the unwind label where it would find an exception
+            ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (mp_uint_t)MP_OBJ_NEW_SMALL_INT(u->label), emit->stack_start + e->stack_base + 1, REG_TEMP0);
+            ASM_JUMP(emit->as, e->label);
+            return;
+        }
+    }
+    if (target == UNWIND_TARGET_RETURN) {
+        ASM_MOV_LOCAL_TO_REG(emit->as, UNWIND_RETURN_SLOT(emit), REG_RET);
+        ASM_EXIT(emit->as);
+    } else {
+        ASM_JUMP(emit->as, target);
+    }
 }
 
-STATIC void emit_native_continue_loop(emit_t *emit, mp_uint_t label, mp_uint_t except_depth) {
-    (void)except_depth;
-    emit_native_jump(emit, label); // TODO properly
+STATIC void emit_native_unwind_jump(emit_t *emit, mp_uint_t label, mp_uint_t except_depth) {
+    DEBUG_printf("unwind_jump(label=" UINT_FMT ", except_depth=" UINT_FMT ")\n", label, except_depth);
+    label &= ~MP_EMIT_BREAK_FROM_FOR;
+    emit_native_pre(emit);
+    // need to commit stack because we are jumping elsewhere
+    need_stack_settled(emit);
+    emit_native_live_jump(emit, label);
+    emit_native_unwind_to(emit, label, except_depth);
+    emit_post(emit);
+}
+
+STATIC void emit_native_setup_block(emit_t *emit, mp_uint_t label, bool is_finally) {
+    emit_native_pre(emit);
+    // need to commit stack because we may jump elsewhere
+    need_stack_settled(emit);
+    emit->has_exc_handler = true;
+    emit_native_push_exc_stack(emit, label, is_finally);
+    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, NLR_BUF_SIZE); // arg1 = pointer to nlr buf
+    emit_call(emit, MP_F_NLR_PUSH);
+    ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
+    emit_post(emit);
 }
 
 STATIC void emit_native_setup_with(emit_t *emit, mp_uint_t label) {
-    // not supported, or could be with runtime call
-    (void)emit;
-    (void)label;
-    assert(0);
+    // not supported, but keep the stack consistent with a try/finally so the
+    // rest of the scope can be compiled until the error is reported
+    *emit->error_slot = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "native with");
+    vtype_kind_t vtype;
+    emit_pre_pop_reg(emit, &vtype, REG_ARG_1); // context manager
+    emit_native_setup_block(emit, label, true);
+    emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET); // result of __enter__
 }
 
 STATIC void emit_native_with_cleanup(emit_t *emit) {
+    // not supported, see emit_native_setup_with
     (void)emit;
-    assert(0);
 }
 
 STATIC void emit_native_setup_except(emit_t *emit, mp_uint_t label) {
-    emit_native_pre(emit);
-    // need to commit stack because we may jump elsewhere
-    need_stack_settled(emit);
-    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, sizeof(nlr_buf_t) / sizeof(mp_uint_t)); // arg1 = pointer to nlr buf
-    emit_call(emit, MP_F_NLR_PUSH);
-    ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
-    emit_post(emit);
+    emit_native_setup_block(emit, label, false);
 }
 
 STATIC void emit_native_setup_finally(emit_t *emit, mp_uint_t label) {
-    emit_native_setup_except(emit, label);
+    emit_native_setup_block(emit, label, true);
 }
 
 STATIC void emit_native_end_finally(emit_t *emit) {
     // logic:
     //   exc = pop_stack
-    //   if exc == None: pass
+    //   if exc is an unwind label: continue unwinding
+    //   elif exc == None: pass
     //   else: raise exc
     // the check if exc is None is done in the MP_F_NATIVE_RAISE stub
     vtype_kind_t vtype;
     emit_pre_pop_reg(emit, &vtype, REG_ARG_1);
+    bool is_finally = emit->exc_stack[emit->exc_stack_size - 1].is_finally;
+    if (is_finally) {
+        // this is the end of the try/finally, so emit the jumps that go via it
+        mp_uint_t exc_level = --emit->exc_stack_size;
+        mp_uint_t n = 0;
+        for (mp_uint_t i = 0; i < emit->unwind_len; i++) {
+            unwind_info_t u = emit->unwind[i];
+            if (u.exc_level != exc_level) {
+                emit->unwind[n++] = u;
+                continue;
+            }
+            ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)MP_OBJ_NEW_SMALL_INT(u.label), REG_ARG_2);
+            ASM_JUMP_IF_REG_NE(emit->as, REG_ARG_1, REG_ARG_2, u.label);
+            emit_native_unwind_to(emit, u.target, u.depth);
+            ASM_LABEL_ASSIGN(emit->as, u.label);
+        }
+        emit->unwind_len = n;
+    }
     emit_call(emit, MP_F_NATIVE_RAISE);
+    if (is_finally) {
+        // discard the rest of the nlr_buf
+        adjust_stack(emit, -1);
+    }
     emit_post(emit);
 }
 
@@ -1937,7 +2754,15 @@ STATIC void emit_native_for_iter_end(emit_t *emit) {
 STATIC void emit_native_pop_block(emit_t *emit) {
     emit_native_pre(emit);
     emit_call(emit, MP_F_NLR_POP);
-    adjust_stack(emit, -(mp_int_t)(sizeof(nlr_buf_t) / sizeof(mp_uint_t)));
+    exc_stack_entry_t *e = &emit->exc_stack[emit->exc_stack_size - 1];
+    e->is_active = false;
+    if (e->is_finally) {
+        // Keep the first word of the nlr_buf so that the top of the stack in
+        // the finally handler is the ret_val word, where nlr puts the exception.
+        adjust_stack(emit, -(mp_int_t)(NLR_BUF_SIZE - 1));
+    } else {
+        adjust_stack(emit, -(mp_int_t)NLR_BUF_SIZE);
+    }
     emit_post(emit);
 }
 
@@ -1953,6 +2778,21 @@ STATIC void emit_native_pop_except(emit_t *emit) {
 
 STATIC void emit_native_unary_op(emit_t *emit, mp_unary_op_t op) {
     vtype_kind_t vtype;
+    #if N_FLOAT
+    if (peek_vtype(emit, 0) == VTYPE_FLOAT) {
+        if (op == MP_UNARY_OP_NEGATIVE) {
+            // flip the sign bit
+            emit_pre_pop_reg(emit, &vtype, REG_ARG_2);
+            need_reg_single(emit, REG_ARG_3, 0);
+            ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)1 << (8 * sizeof(mp_float_t) - 1), REG_ARG_3);
+            ASM_XOR_REG_REG(emit->as, REG_ARG_2, REG_ARG_3);
+            emit_post_push_reg(emit, VTYPE_FLOAT, REG_ARG_2);
+        } else if (op != MP_UNARY_OP_POSITIVE) {
+            EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "unary op not supported for 'float'");
+        }
+        return;
+    }
+    #endif
     emit_pre_pop_reg(emit, &vtype, REG_ARG_2);
     assert(vtype == VTYPE_PYOBJ);
     if (op == MP_UNARY_OP_NOT) {
@@ -1964,10 +2804,152 @@ STATIC void emit_native_unary_op(emit_t *emit, mp_unary_op_t op) {
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
+#if N_FLOAT
+// Floats are kept in general registers as the bits of an mp_float_t, and only
+// moved to the FPU (SSE2 on x64, VFP on Thumb2) to do arithmetic.  These
+// conversions are done in place, in the given register.
+STATIC void emit_native_float_from_int(emit_t *emit, int reg) {
+    #if N_X64
+    asm_x64_cvtsi2sd_r64_to_xmm(emit->as, reg, ASM_X64_REG_XMM0);
+    asm_x64_movq_xmm_to_r64(emit->as, ASM_X64_REG_XMM0, reg);
+    #elif N_THUMB
+    asm_thumb_vmov_s_r(emit->as, 0, reg);
+    asm_thumb_vcvt_f32_s32(emit->as, 0, 0);
+    asm_thumb_vmov_r_s(emit->as, reg, 0);
+    #endif
+}
+
+STATIC void emit_native_int_from_float(emit_t *emit, int reg) {
+    #if N_X64
+    asm_x64_movq_r64_to_xmm(emit->as, reg, ASM_X64_REG_XMM0);
+    asm_x64_cvttsd2si_xmm_to_r64(emit->as, ASM_X64_REG_XMM0, reg);
+    #elif N_THUMB
+    asm_thumb_vmov_s_r(emit->as, 0, reg);
+    asm_thumb_vcvt_s32_f32(emit->as, 0, 0);
+    asm_thumb_vmov_r_s(emit->as, reg, 0);
+    #endif
+}
+
+// load a float (or an int, converting it) into FPU register fp_reg
+STATIC void emit_native_load_fpu_reg(emit_t *emit, vtype_kind_t vtype, int reg, int fp_reg) {
+    #if N_X64
+    if (vtype == VTYPE_FLOAT) {
+        asm_x64_movq_r64_to_xmm(emit->as, reg, fp_reg);
+    } else {
+        asm_x64_cvtsi2sd_r64_to_xmm(emit->as, reg, fp_reg);
+    }
+    #elif N_THUMB
+    asm_thumb_vmov_s_r(emit->as, fp_reg, reg);
+    if (vtype != VTYPE_FLOAT) {
+        asm_thumb_vcvt_f32_s32(emit->as, fp_reg, fp_reg);
+    }
+    #endif
+}
+
+STATIC void emit_native_binary_op_float(emit_t *emit, mp_binary_op_t op) {
+    vtype_kind_t vtype_lhs, vtype_rhs;
+    emit_pre_pop_reg_reg(emit, &vtype_rhs, REG_ARG_3, &vtype_lhs, REG_ARG_2);
+    emit_native_load_fpu_reg(emit, vtype_lhs, REG_ARG_2, 0);
+    emit_native_load_fpu_reg(emit, vtype_rhs, REG_ARG_3, 1);
+
+    if (MP_BINARY_OP_LESS <= op && op <= MP_BINARY_OP_NOT_EQUAL) {
+        // comparisons must be false if either side is a NaN, except for !=
+        need_reg_single(emit, REG_RET, 0);
+        #if N_X64
+        // ucomisd sets CF/ZF like an unsigned compare, and PF if unordered;
+        // a, b are swapped for < and <= so that NaN gives false
+        static const byte ops[6] = {
+            ASM_X64_CC_JA,
+            ASM_X64_CC_JA,
+            ASM_X64_CC_JE,
+            ASM_X64_CC_JAE,
+            ASM_X64_CC_JAE,
+            ASM_X64_CC_JNE,
+        };
+        asm_x64_xor_r64_r64(emit->as, REG_RET, REG_RET);
+        asm_x64_xor_r64_r64(emit->as, REG_ARG_3, REG_ARG_3);
+        if (op == MP_BINARY_OP_LESS || op == MP_BINARY_OP_LESS_EQUAL) {
+            asm_x64_ucomisd_xmm_xmm(emit->as, ASM_X64_REG_XMM1, ASM_X64_REG_XMM0);
+        } else {
+            asm_x64_ucomisd_xmm_xmm(emit->as, ASM_X64_REG_XMM0, ASM_X64_REG_XMM1);
+        }
+        asm_x64_setcc_r8(emit->as, ops[op - MP_BINARY_OP_LESS], REG_RET);
+        if (op == MP_BINARY_OP_EQUAL) {
+            asm_x64_setcc_r8(emit->as, ASM_X64_CC_JNP, REG_ARG_3);
+            asm_x64_and_r64_r64(emit->as, REG_RET, REG_ARG_3);
+        } else if (op == MP_BINARY_OP_NOT_EQUAL) {
+            asm_x64_setcc_r8(emit->as, ASM_X64_CC_JP, REG_ARG_3);
+            asm_x64_or_r64_r64(emit->as, REG_RET, REG_ARG_3);
+        }
+        #elif N_THUMB
+        // after vmrs, MI/GT/EQ/LS/GE/NE are the ordered float comparisons
+        asm_thumb_vcmp_s_s(emit->as, 0, 1);
+        asm_thumb_vmrs_apsr_fpscr(emit->as);
+        static const uint16_t ops[6] = {
+            ASM_THUMB_OP_ITE_MI,
+            ASM_THUMB_OP_ITE_GT,
+            ASM_THUMB_OP_ITE_EQ,
+            ASM_THUMB_OP_ITE_HI,
+            ASM_THUMB_OP_ITE_GE,
+            ASM_THUMB_OP_ITE_EQ,
+        };
+        static const byte ret[6] = { 1, 1, 1, 0, 1, 0, };
+        asm_thumb_op16(emit->as, ops[op - MP_BINARY_OP_LESS]);
+        asm_thumb_mov_rlo_i8(emit->as, REG_RET, ret[op - MP_BINARY_OP_LESS]);
+        asm_thumb_mov_rlo_i8(emit->as, REG_RET, ret[op - MP_BINARY_OP_LESS] ^ 1);
+        #endif
+        emit_post_push_reg(emit, VTYPE_BOOL, REG_RET);
+        return;
+    }
+
+    // arithmetic ops, in the order add, subtract, multiply, divide
+    #if N_X64
+    static const byte fp_ops[4] = {
+        ASM_X64_SD_OP_ADD, ASM_X64_SD_OP_SUB, ASM_X64_SD_OP_MUL, ASM_X64_SD_OP_DIV,
+    };
+    #elif N_THUMB
+    static const byte fp_ops[4] = {
+        ASM_THUMB_VFP_OP_ADD, ASM_THUMB_VFP_OP_SUB, ASM_THUMB_VFP_OP_MUL, ASM_THUMB_VFP_OP_DIV,
+    };
+    #endif
+    int fp_op;
+    if (op == MP_BINARY_OP_ADD || op == MP_BINARY_OP_INPLACE_ADD) {
+        fp_op = fp_ops[0];
+    } else if (op == MP_BINARY_OP_SUBTRACT || op == MP_BINARY_OP_INPLACE_SUBTRACT) {
+        fp_op = fp_ops[1];
+    } else if (op == MP_BINARY_OP_MULTIPLY || op == MP_BINARY_OP_INPLACE_MULTIPLY) {
+        fp_op = fp_ops[2];
+    } else if (op == MP_BINARY_OP_TRUE_DIVIDE || op == MP_BINARY_OP_INPLACE_TRUE_DIVIDE) {
+        fp_op = fp_ops[3];
+    } else {
+        EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
+            "can't do binary op between '%q' and '%q'",
+            vtype_to_qstr(vtype_lhs), vtype_to_qstr(vtype_rhs));
+        emit_post_push_reg(emit, VTYPE_FLOAT, REG_ARG_2);
+        return;
+    }
+    #if N_X64
+    asm_x64_sd_op_xmm_xmm(emit->as, fp_op, ASM_X64_REG_XMM0, ASM_X64_REG_XMM1);
+    asm_x64_movq_xmm_to_r64(emit->as, ASM_X64_REG_XMM0, REG_ARG_2);
+    #elif N_THUMB
+    asm_thumb_vop_s_s_s(emit->as, fp_op, 0, 0, 1);
+    asm_thumb_vmov_r_s(emit->as, REG_ARG_2, 0);
+    #endif
+    emit_post_push_reg(emit, VTYPE_FLOAT, REG_ARG_2);
+}
+#endif
+
 STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
     DEBUG_printf("binary_op(" UINT_FMT ")\n", op);
     vtype_kind_t vtype_lhs = peek_vtype(emit, 1);
     vtype_kind_t vtype_rhs = peek_vtype(emit, 0);
+    #if N_FLOAT
+    if ((vtype_lhs == VTYPE_FLOAT && (vtype_rhs == VTYPE_FLOAT || vtype_rhs == VTYPE_INT))
+        || (vtype_lhs == VTYPE_INT && vtype_rhs == VTYPE_FLOAT)) {
+        emit_native_binary_op_float(emit, op);
+        return;
+    }
+    #endif
     if (vtype_lhs == VTYPE_INT && vtype_rhs == VTYPE_INT) {
         #if N_X64 || N_X86
         // special cases for x86 and shifting
@@ -2075,6 +3057,22 @@ STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
                 ASM_ARM_CC_NE,
             };
             asm_arm_setcc_reg(emit->as, REG_RET, ccs[op - MP_BINARY_OP_LESS]);
+            #elif N_XTENSA
+            // only LT and GE exist, so > and <= swap the operands
+            static const byte ccs[6] = {
+                ASM_XTENSA_CC_LT,
+                ASM_XTENSA_CC_LT,
+                ASM_XTENSA_CC_EQ,
+                ASM_XTENSA_CC_GE,
+                ASM_XTENSA_CC_GE,
+                ASM_XTENSA_CC_NE,
+            };
+            static const byte swap[6] = { 0, 1, 0, 1, 0, 0, };
+            if (swap[op - MP_BINARY_OP_LESS]) {
+                asm_xtensa_setcc_reg_reg_reg(emit->as, ccs[op - MP_BINARY_OP_LESS], REG_RET, reg_rhs, REG_ARG_2);
+            } else {
+                asm_xtensa_setcc_reg_reg_reg(emit->as, ccs[op - MP_BINARY_OP_LESS], REG_RET, REG_ARG_2, reg_rhs);
+            }
             #else
                 #error not implemented
             #endif
@@ -2107,6 +3105,21 @@ STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
     }
 }
 
+#if MICROPY_OPT_FOR_RANGE
+STATIC void emit_native_for_range(emit_t *emit, mp_int_t step, mp_uint_t label) {
+    // there's no single native op for this, so build it up from the generic
+    // ones; the stack holds <end> then the counter, like the bytecode version
+    emit_native_dup_top_two(emit);
+    emit_native_rot_two(emit);
+    emit_native_binary_op(emit, step >= 0 ? MP_BINARY_OP_LESS : MP_BINARY_OP_MORE);
+    emit_native_pop_jump_if(emit, false, label);
+    emit_native_dup_top(emit);
+    emit_native_load_const_small_int(emit, step);
+    emit_native_binary_op(emit, MP_BINARY_OP_INPLACE_ADD);
+    emit_native_rot_two(emit);
+}
+#endif
+
 STATIC void emit_native_build_tuple(emit_t *emit, mp_uint_t n_args) {
     // for viper: call runtime, with types of args
     //   if wrapped in byte_array, or something, allocates memory and fills it
@@ -2266,21 +3279,48 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
         assert(!star_flags);
         DEBUG_printf("  cast to %d\n", vtype_fun);
         vtype_kind_t vtype_cast = peek_stack(emit, 1)->data.u_imm;
-        switch (peek_vtype(emit, 0)) {
+        vtype_kind_t vtype_arg = peek_vtype(emit, 0);
+        #if N_FLOAT
+        if ((vtype_cast == VTYPE_FLOAT) != (vtype_arg == VTYPE_FLOAT) && vtype_arg != VTYPE_PYOBJ) {
+            // convert between float and int
+            vtype_kind_t vtype;
+            emit_pre_pop_reg(emit, &vtype, REG_RET);
+            emit_pre_pop_discard(emit);
+            if (vtype_cast == VTYPE_FLOAT && (vtype == VTYPE_BOOL || vtype == VTYPE_INT || vtype == VTYPE_UINT)) {
+                emit_native_float_from_int(emit, REG_RET);
+            } else if (vtype == VTYPE_FLOAT && (vtype_cast == VTYPE_INT || vtype_cast == VTYPE_UINT)) {
+                emit_native_int_from_float(emit, REG_RET);
+            } else {
+                EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
+                    "can't convert '%q' to '%q'", vtype_to_qstr(vtype), vtype_to_qstr(vtype_cast));
+            }
+            emit_post_push_reg(emit, vtype_cast, REG_RET);
+            return;
+        }
+        #endif
+        switch (vtype_arg) {
             case VTYPE_PYOBJ: {
                 vtype_kind_t vtype;
                 emit_pre_pop_reg(emit, &vtype, REG_ARG_1);
                 emit_pre_pop_discard(emit);
-                emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, MP_NATIVE_TYPE_UINT, REG_ARG_2); // arg2 = type
+                emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, vtype_cast == VTYPE_FLOAT ? MP_NATIVE_TYPE_FLOAT : MP_NATIVE_TYPE_UINT, REG_ARG_2); // arg2 = type
                 emit_post_push_reg(emit, vtype_cast, REG_RET);
                 break;
             }
             case VTYPE_BOOL:
             case VTYPE_INT:
             case VTYPE_UINT:
+            #if N_FLOAT
+            case VTYPE_FLOAT:
+            #endif
             case VTYPE_PTR:
             case VTYPE_PTR8:
             case VTYPE_PTR16:
+            case VTYPE_PTR32:
+            #if N_FLOAT
+            case VTYPE_PTRF:
+            case VTYPE_PTRD:
+            #endif
             case VTYPE_PTR_NONE:
                 emit_fold_stack_top(emit, REG_ARG_1);
                 emit_post_top_set_vtype(emit, vtype_cast);
@@ -2360,11 +3400,35 @@ STATIC void emit_native_return_value(emit_t *emit) {
     }
     emit->last_emit_was_return_value = true;
     //ASM_BREAK_POINT(emit->as); // to insert a break-point for debugging
+    for (mp_uint_t i = 0; i < emit->exc_stack_size; i++) {
+        if (emit->exc_stack[i].is_active) {
+            // returning from within a try block
+            ASM_MOV_REG_TO_LOCAL(emit->as, REG_RET, UNWIND_RETURN_SLOT(emit));
+            emit_native_unwind_to(emit, UNWIND_TARGET_RETURN, emit->exc_stack_size);
+            return;
+        }
+    }
     ASM_EXIT(emit->as);
 }
 
 STATIC void emit_native_raise_varargs(emit_t *emit, mp_uint_t n_args) {
-    assert(n_args == 1);
+    assert(n_args <= 1);
+    if (n_args == 0) {
+        // re-raise the exception of the inner-most handler, which is kept in its nlr_buf
+        emit_native_pre(emit);
+        need_reg_all(emit);
+        mp_uint_t level = emit->exc_stack_size;
+        while (level > 0 && !emit->exc_stack[level - 1].in_handler) {
+            level -= 1;
+        }
+        if (level == 0) {
+            ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)&mp_type_RuntimeError, REG_ARG_1);
+        } else {
+            ASM_MOV_LOCAL_TO_REG(emit->as, emit->stack_start + emit->exc_stack[level - 1].stack_base + 1, REG_ARG_1);
+        }
+        emit_call(emit, MP_F_NATIVE_RAISE);
+        return;
+    }
     vtype_kind_t vtype_exc;
     emit_pre_pop_reg(emit, &vtype_exc, REG_ARG_1); // arg1 = object to raise
     if (vtype_exc != VTYPE_PYOBJ) {
@@ -2376,28 +3440,28 @@ STATIC void emit_native_raise_varargs(emit_t *emit, mp_uint_t n_args) {
 
 STATIC void emit_native_yield_value(emit_t *emit) {
     // not supported (for now)
-    (void)emit;
-    assert(0);
+    *emit->error_slot = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "native yield");
 }
 STATIC void emit_native_yield_from(emit_t *emit) {
     // not supported (for now)
-    (void)emit;
-    assert(0);
+    *emit->error_slot = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "native yield from");
+    adjust_stack(emit, -1);
 }
 
 STATIC void emit_native_start_except_handler(emit_t *emit) {
-    // This instruction follows an nlr_pop, so the stack counter is back to zero, when really
-    // it should be up by a whole nlr_buf_t.  We then want to pop the nlr_buf_t here, but save
-    // the first 2 elements, so we can get the thrown value.
-    adjust_stack(emit, 2);
-    vtype_kind_t vtype_nlr;
-    emit_pre_pop_reg(emit, &vtype_nlr, REG_ARG_1); // get the thrown value
-    emit_pre_pop_discard(emit); // discard the linked-list pointer in the nlr_buf
+    // This instruction follows an nlr_pop, so the stack counter is back to where it was before
+    // the nlr_buf_t was pushed.  The nlr_buf_t is kept on the stack while the handler runs,
+    // since it holds the thrown value for a bare raise.
+    emit_native_adjust_stack_size(emit, NLR_BUF_SIZE);
+    emit->exc_stack[emit->exc_stack_size - 1].in_handler = true;
+    need_reg_single(emit, REG_ARG_1, 0);
+    ASM_MOV_LOCAL_TO_REG(emit->as, emit->stack_start + emit->stack_size - NLR_BUF_SIZE + 1, REG_ARG_1); // get the thrown value
     emit_post_push_reg_reg_reg(emit, VTYPE_PYOBJ, REG_ARG_1, VTYPE_PYOBJ, REG_ARG_1, VTYPE_PYOBJ, REG_ARG_1); // push the 3 exception items
 }
 
 STATIC void emit_native_end_except_handler(emit_t *emit) {
-    adjust_stack(emit, -2);
+    adjust_stack(emit, -(mp_int_t)(NLR_BUF_SIZE + 2));
+    emit->exc_stack_size -= 1;
 }
 
 const emit_method_table_t EXPORT_FUN(method_table) = {
@@ -2452,8 +3516,8 @@ const emit_method_table_t EXPORT_FUN(method_table) = {
     emit_native_jump,
     emit_native_pop_jump_if,
     emit_native_jump_if_or_pop,
-    emit_native_break_loop,
-    emit_native_continue_loop,
+    emit_native_unwind_jump,
+    emit_native_unwind_jump,
     emit_native_setup_with,
     emit_native_with_cleanup,
     emit_native_setup_except,
@@ -2462,6 +3526,9 @@ const emit_method_table_t EXPORT_FUN(method_table) = {
     emit_native_get_iter,
     emit_native_for_iter,
     emit_native_for_iter_end,
+    #if MICROPY_OPT_FOR_RANGE
+    emit_native_for_range,
+    #endif
     emit_native_pop_block,
     emit_native_pop_except,
     emit_native_unary_op,
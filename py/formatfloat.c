@@ -44,7 +44,7 @@
 
 #include "py/mpconfig.h"
 
-#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT && !MICROPY_FLOAT_EXACT_CONV
 
 #include "py/formatfloat.h"
 
@@ -342,3 +342,837 @@ int mp_format_float(float f, char *buf, size_t buf_size, char fmt, int prec, cha
 }
 
 #endif
+
+#if MICROPY_PY_BUILTINS_FLOAT && MICROPY_FLOAT_EXACT_CONV
+
+/***********************************************************************
+
+  Exact float to string conversion, for both single and double precision.
+
+  Digits are generated with Florian Loitsch's Grisu3 algorithm ("Printing
+  Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010)
+  using 64-bit integer arithmetic and a small table of cached powers of
+  ten.  Grisu3 knows when it can't guarantee a correct answer (about 0.5%
+  of inputs); those fall back to exact arithmetic on mpz big integers.
+
+***********************************************************************/
+
+#include <assert.h>
+#include <math.h>
+
+#include "py/mpz.h"
+#include "py/formatfloat.h"
+
+#if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_MPZ
+#error MICROPY_FLOAT_EXACT_CONV requires MICROPY_LONGINT_IMPL_MPZ
+#endif
+
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#define FPC_MANT_BITS (23)
+#define FPC_EXP_BITS (8)
+#define FPC_DIG_MIN (6) // any decimal with this many digits round-trips
+#define FPC_DIG_MAX (9) // this many digits always round-trip
+#define FPC_POW_FIRST_IDX (39) // first cached power that single precision needs
+typedef uint32_t fpc_bits_t;
+#else
+#define FPC_MANT_BITS (52)
+#define FPC_EXP_BITS (11)
+#define FPC_DIG_MIN (15)
+#define FPC_DIG_MAX (17)
+#define FPC_POW_FIRST_IDX (0)
+typedef uint64_t fpc_bits_t;
+#endif
+
+#define FPC_HIDDEN_BIT ((uint64_t)1 << FPC_MANT_BITS)
+#define FPC_EXP_BIAS ((1 << (FPC_EXP_BITS - 1)) - 1 + FPC_MANT_BITS)
+#define FPC_EXP_DENORMAL (1 - FPC_EXP_BIAS)
+
+// repr switches to exponent notation outside 1e-4 <= |f| < 1e16, like CPython
+#define FPC_REPR_EXP_MAX (16)
+
+// size of the digit buffer; formatted numbers are limited to
+// FPC_DIG_LEN_MAX digits so their mpz fits in the buffer as a string
+#define FPC_DIG_BUF_SIZE (64)
+#define FPC_DIG_LEN_MAX (40)
+
+// a 64-bit floating point value f * 2^e used by Grisu
+typedef struct _diy_fp_t {
+    uint64_t f;
+    int e;
+} diy_fp_t;
+
+// Grisu needs the scaled value's binary exponent in this range
+#define DIY_FP_ALPHA (-60)
+#define DIY_FP_GAMMA (-32)
+
+// normalised 64-bit approximations of 10^k, for k = -348, -340, ..., 340
+STATIC const struct {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+} fpc_cached_pow10[] = {
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL, -980, -276 },
+    { 0xd3515c2831559a83ULL, -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL, -927, -260 },
+    { 0xea9c227723ee8bcbULL, -901, -252 },
+    { 0xaecc49914078536dULL, -874, -244 },
+    { 0x823c12795db6ce57ULL, -847, -236 },
+    { 0xc21094364dfb5637ULL, -821, -228 },
+    { 0x9096ea6f3848984fULL, -794, -220 },
+    { 0xd77485cb25823ac7ULL, -768, -212 },
+    { 0xa086cfcd97bf97f4ULL, -741, -204 },
+    { 0xef340a98172aace5ULL, -715, -196 },
+    { 0xb23867fb2a35b28eULL, -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL, -661, -180 },
+    { 0xc5dd44271ad3cdbaULL, -635, -172 },
+    { 0x936b9fcebb25c996ULL, -608, -164 },
+    { 0xdbac6c247d62a584ULL, -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL, -555, -148 },
+    { 0xf3e2f893dec3f126ULL, -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL, -502, -132 },
+    { 0x87625f056c7c4a8bULL, -475, -124 },
+    { 0xc9bcff6034c13053ULL, -449, -116 },
+    { 0x964e858c91ba2655ULL, -422, -108 },
+    { 0xdff9772470297ebdULL, -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL, -369, -92 },
+    { 0xf8a95fcf88747d94ULL, -343, -84 },
+    { 0xb94470938fa89bcfULL, -316, -76 },
+    { 0x8a08f0f8bf0f156bULL, -289, -68 },
+    { 0xcdb02555653131b6ULL, -263, -60 },
+    { 0x993fe2c6d07b7facULL, -236, -52 },
+    { 0xe45c10c42a2b3b06ULL, -210, -44 },
+    #endif
+    { 0xaa242499697392d3ULL, -183, -36 },
+    { 0xfd87b5f28300ca0eULL, -157, -28 },
+    { 0xbce5086492111aebULL, -130, -20 },
+    { 0x8cbccc096f5088ccULL, -103, -12 },
+    { 0xd1b71758e219652cULL, -77, -4 },
+    { 0x9c40000000000000ULL, -50, 4 },
+    { 0xe8d4a51000000000ULL, -24, 12 },
+    { 0xad78ebc5ac620000ULL, 3, 20 },
+    { 0x813f3978f8940984ULL, 30, 28 },
+    { 0xc097ce7bc90715b3ULL, 56, 36 },
+    { 0x8f7e32ce7bea5c70ULL, 83, 44 },
+    { 0xd5d238a4abe98068ULL, 109, 52 },
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    { 0x9f4f2726179a2245ULL, 136, 60 },
+    { 0xed63a231d4c4fb27ULL, 162, 68 },
+    { 0xb0de65388cc8ada8ULL, 189, 76 },
+    { 0x83c7088e1aab65dbULL, 216, 84 },
+    { 0xc45d1df942711d9aULL, 242, 92 },
+    { 0x924d692ca61be758ULL, 269, 100 },
+    { 0xda01ee641a708deaULL, 295, 108 },
+    { 0xa26da3999aef774aULL, 322, 116 },
+    { 0xf209787bb47d6b85ULL, 348, 124 },
+    { 0xb454e4a179dd1877ULL, 375, 132 },
+    { 0x865b86925b9bc5c2ULL, 402, 140 },
+    { 0xc83553c5c8965d3dULL, 428, 148 },
+    { 0x952ab45cfa97a0b3ULL, 455, 156 },
+    { 0xde469fbd99a05fe3ULL, 481, 164 },
+    { 0xa59bc234db398c25ULL, 508, 172 },
+    { 0xf6c69a72a3989f5cULL, 534, 180 },
+    { 0xb7dcbf5354e9beceULL, 561, 188 },
+    { 0x88fcf317f22241e2ULL, 588, 196 },
+    { 0xcc20ce9bd35c78a5ULL, 614, 204 },
+    { 0x98165af37b2153dfULL, 641, 212 },
+    { 0xe2a0b5dc971f303aULL, 667, 220 },
+    { 0xa8d9d1535ce3b396ULL, 694, 228 },
+    { 0xfb9b7cd9a4a7443cULL, 720, 236 },
+    { 0xbb764c4ca7a44410ULL, 747, 244 },
+    { 0x8bab8eefb6409c1aULL, 774, 252 },
+    { 0xd01fef10a657842cULL, 800, 260 },
+    { 0x9b10a4e5e9913129ULL, 827, 268 },
+    { 0xe7109bfba19c0c9dULL, 853, 276 },
+    { 0xac2820d9623bf429ULL, 880, 284 },
+    { 0x80444b5e7aa7cf85ULL, 907, 292 },
+    { 0xbf21e44003acdd2dULL, 933, 300 },
+    { 0x8e679c2f5e44ff8fULL, 960, 308 },
+    { 0xd433179d9c8cb841ULL, 986, 316 },
+    { 0x9e19db92b4e31ba9ULL, 1013, 324 },
+    { 0xeb96bf6ebadf77d9ULL, 1039, 332 },
+    { 0xaf87023b9bf0ee6bULL, 1066, 340 },
+    #endif
+};
+
+STATIC const uint32_t fpc_pow10_u32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+// Splits f into its sign and m * 2^e, returning false if f is inf (m == 0) or nan
+STATIC bool fpc_decompose(mp_float_t f, bool *neg, uint64_t *m, int *e) {
+    union {
+        mp_float_t f;
+        fpc_bits_t u;
+    } num = {f};
+    int biased_exp = (num.u >> FPC_MANT_BITS) & ((1 << FPC_EXP_BITS) - 1);
+    *neg = num.u >> (FPC_MANT_BITS + FPC_EXP_BITS);
+    *m = num.u & (FPC_HIDDEN_BIT - 1);
+    if (biased_exp == (1 << FPC_EXP_BITS) - 1) {
+        *e = 0;
+        return false;
+    } else if (biased_exp == 0) {
+        *e = FPC_EXP_DENORMAL;
+    } else {
+        *m |= FPC_HIDDEN_BIT;
+        *e = biased_exp - FPC_EXP_BIAS;
+    }
+    return true;
+}
+
+// Returns floor(log10(m * 2^e)) or one less than it, for m > 0
+STATIC int fpc_k10_estimate(uint64_t m, int e) {
+    int bits = 0;
+    for (; m != 0; m >>= 1) {
+        bits += 1;
+    }
+    // 78913 / 2^18 is just below log10(2)
+    return ((e + bits - 1) * 78913) >> 18;
+}
+
+STATIC diy_fp_t diy_fp_normalize(uint64_t f, int e) {
+    while (!(f & 0xffc0000000000000ULL)) {
+        f <<= 10;
+        e -= 10;
+    }
+    while (!(f & 0x8000000000000000ULL)) {
+        f <<= 1;
+        e -= 1;
+    }
+    diy_fp_t r = {f, e};
+    return r;
+}
+
+// upper 64 bits of the 128-bit product, rounded
+STATIC diy_fp_t diy_fp_mul(diy_fp_t x, diy_fp_t y) {
+    uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+    uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff) + (1U << 31);
+    diy_fp_t r = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return r;
+}
+
+// Returns c ~= 10^mk such that DIY_FP_ALPHA <= e + c.e + 64 <= DIY_FP_GAMMA
+STATIC diy_fp_t diy_fp_cached_pow10(int e, int *mk) {
+    // k = ceil((ALPHA - e - 1) * log10(2)), 78913 / 2^18 being log10(2)
+    int k = ((DIY_FP_ALPHA - e - 1) * 78913 + (1 << 18) - 1) >> 18;
+    int idx = (348 + k - 1) / 8 + 1 - FPC_POW_FIRST_IDX;
+    *mk = fpc_cached_pow10[idx].k;
+    diy_fp_t c = {fpc_cached_pow10[idx].f, fpc_cached_pow10[idx].e};
+    return c;
+}
+
+// Number of decimal digits in the integral part, and the power of ten of the first one
+STATIC int fpc_integral_digits(uint32_t integrals, uint32_t *divisor) {
+    int n = 0;
+    while (n < 10 && integrals >= fpc_pow10_u32[n]) {
+        n += 1;
+    }
+    *divisor = n > 0 ? fpc_pow10_u32[n - 1] : 0;
+    return n;
+}
+
+// Moves the last digit towards w while staying in the safe interval,
+// then checks that the result is unambiguously the closest
+STATIC bool grisu_round_weed(char *buf, int len, uint64_t dist_too_high_w, uint64_t unsafe_interval,
+    uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_dist = dist_too_high_w - unit;
+    uint64_t big_dist = dist_too_high_w + unit;
+    while (rest < small_dist && unsafe_interval - rest >= ten_kappa
+        && (rest + ten_kappa < small_dist || small_dist - rest >= rest + ten_kappa - small_dist)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_dist && unsafe_interval - rest >= ten_kappa
+        && (rest + ten_kappa < big_dist || big_dist - rest > rest + ten_kappa - big_dist)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// Grisu3: the shortest digits that read back as m * 2^e, with the decimal
+// exponent of the first digit in k10; returns false if unsure
+STATIC bool grisu_shortest(uint64_t m, int e, char *buf, int *len, int *k10) {
+    diy_fp_t w = diy_fp_normalize(m, e);
+    diy_fp_t hi = diy_fp_normalize((m << 1) + 1, e - 1);
+    diy_fp_t lo;
+    if (m == FPC_HIDDEN_BIT && e != FPC_EXP_DENORMAL) {
+        // the float below is closer, having a smaller exponent
+        lo.f = (m << 2) - 1;
+        lo.e = e - 2;
+    } else {
+        lo.f = (m << 1) - 1;
+        lo.e = e - 1;
+    }
+    lo.f <<= lo.e - hi.e;
+    lo.e = hi.e;
+
+    int mk;
+    diy_fp_t c = diy_fp_cached_pow10(w.e, &mk);
+    w = diy_fp_mul(w, c);
+    hi = diy_fp_mul(hi, c);
+    lo = diy_fp_mul(lo, c);
+
+    // the scaled boundaries are off by at most one unit, so only digits
+    // inside the narrowed interval are known to be safe
+    uint64_t unit = 1;
+    uint64_t too_low = lo.f - unit;
+    uint64_t too_high = hi.f + unit;
+    uint64_t unsafe_interval = too_high - too_low;
+    int shift = -w.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t integrals = too_high >> shift;
+    uint64_t fractionals = too_high & (one - 1);
+    uint32_t divisor;
+    int kappa = fpc_integral_digits(integrals, &divisor);
+    *k10 = kappa - 1 - mk;
+    int n = 0;
+    while (kappa > 0) {
+        buf[n++] = '0' + integrals / divisor;
+        integrals %= divisor;
+        kappa -= 1;
+        uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            *len = n;
+            return grisu_round_weed(buf, n, too_high - w.f, unsafe_interval, rest,
+                (uint64_t)divisor << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buf[n++] = '0' + (fractionals >> shift);
+        fractionals &= one - 1;
+        if (fractionals < unsafe_interval) {
+            *len = n;
+            return grisu_round_weed(buf, n, (too_high - w.f) * unit, unsafe_interval, fractionals,
+                one, unit);
+        }
+    }
+}
+
+// Rounds the last digit given the rest and its error; returns false if
+// the error makes the rounding direction ambiguous
+STATIC bool grisu_round_weed_counted(char *buf, int len, uint64_t rest, uint64_t ten_kappa,
+    uint64_t unit, int *k10) {
+    if (unit >= ten_kappa || ten_kappa - unit <= unit) {
+        return false;
+    }
+    if (ten_kappa - rest > rest && ten_kappa - 2 * rest >= 2 * unit) {
+        // safe to round down
+        return true;
+    }
+    if (rest > unit && ten_kappa - (rest - unit) <= rest - unit) {
+        // safe to round up
+        buf[len - 1]++;
+        for (int i = len - 1; i > 0 && buf[i] == '0' + 10; --i) {
+            buf[i] = '0';
+            buf[i - 1]++;
+        }
+        if (buf[0] == '0' + 10) {
+            buf[0] = '1';
+            *k10 += 1;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Grisu with a fixed number of correctly rounded digits: n significant
+// digits if n > 0, else all digits down to the one of weight 10^last;
+// returns false if unsure, or the digit count is out of range
+STATIC bool grisu_counted(uint64_t m, int e, int n, int last, char *buf, int *len, int *k10) {
+    int mk;
+    diy_fp_t w = diy_fp_normalize(m, e);
+    w = diy_fp_mul(w, diy_fp_cached_pow10(w.e, &mk));
+    uint64_t w_error = 1;
+    int shift = -w.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t integrals = w.f >> shift;
+    uint64_t fractionals = w.f & (one - 1);
+    uint32_t divisor;
+    int kappa = fpc_integral_digits(integrals, &divisor);
+    *k10 = kappa - 1 - mk;
+    if (n <= 0) {
+        n = *k10 - last + 1;
+    }
+    if (n <= 0 || n > FPC_DIG_MAX + 1) {
+        return false;
+    }
+    *len = n;
+    char *b = buf;
+    while (kappa > 0) {
+        *b++ = '0' + integrals / divisor;
+        integrals %= divisor;
+        kappa -= 1;
+        if (--n == 0) {
+            uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+            return grisu_round_weed_counted(buf, *len, rest, (uint64_t)divisor << shift, w_error, k10);
+        }
+        divisor /= 10;
+    }
+    while (n > 0 && fractionals > w_error) {
+        fractionals *= 10;
+        w_error *= 10;
+        *b++ = '0' + (fractionals >> shift);
+        fractionals &= one - 1;
+        n -= 1;
+    }
+    if (n != 0) {
+        return false;
+    }
+    return grisu_round_weed_counted(buf, *len, fractionals, one, w_error, k10);
+}
+
+STATIC void fpc_mpz_pow10(mpz_t *dest, int n) {
+    MPZ_CONST_INT(ten, 10);
+    MPZ_CONST_INT(n_mpz, n);
+    mpz_pow_inpl(dest, &ten, &n_mpz);
+}
+
+// q = m * 2^e * 10^t, rounded half to even
+STATIC void fpc_exact_scaled(mpz_t *q, uint64_t m, int e, int t) {
+    MPZ_SCRATCH(num);
+    MPZ_SCRATCH(den);
+    MPZ_SCRATCH(tmp);
+    mpz_set_from_ll(&tmp, m, false);
+    mpz_set_from_int(&den, 1);
+    if (t >= 0) {
+        fpc_mpz_pow10(&den, t);
+        mpz_mul_inpl(&num, &tmp, &den);
+        mpz_set_from_int(&den, 1);
+    } else {
+        mpz_set(&num, &tmp);
+        fpc_mpz_pow10(&den, -t);
+    }
+    if (e >= 0) {
+        mpz_shl_inpl(&tmp, &num, e);
+        mpz_set(&num, &tmp);
+    } else {
+        mpz_shl_inpl(&tmp, &den, -e);
+        mpz_set(&den, &tmp);
+    }
+    mpz_divmod_inpl(q, &tmp, &num, &den);
+    mpz_shl_inpl(&num, &tmp, 1);
+    int c = mpz_cmp(&num, &den);
+    if (c > 0 || (c == 0 && q->len > 0 && (q->dig[0] & 1))) {
+        MPZ_CONST_INT(one, 1);
+        mpz_add_inpl(&tmp, q, &one);
+        mpz_set(q, &tmp);
+    }
+    mpz_deinit(&num);
+    mpz_deinit(&den);
+    mpz_deinit(&tmp);
+}
+
+// Exactly the first n significant digits of m * 2^e, correctly rounded;
+// leaves them in q and returns the decimal exponent of the first digit
+STATIC int fpc_exact_sig(uint64_t m, int e, int n, mpz_t *q) {
+    MPZ_SCRATCH(lim);
+    int k = fpc_k10_estimate(m, e);
+    for (;;) {
+        fpc_exact_scaled(q, m, e, n - 1 - k);
+        fpc_mpz_pow10(&lim, n);
+        int c = mpz_cmp(q, &lim);
+        if (c > 0) {
+            k += 1;
+            continue;
+        } else if (c == 0) {
+            // rounded up to a power of ten
+            fpc_mpz_pow10(q, n - 1);
+            k += 1;
+            break;
+        }
+        fpc_mpz_pow10(&lim, n - 1);
+        if (mpz_cmp(q, &lim) < 0) {
+            k -= 1;
+            continue;
+        }
+        break;
+    }
+    mpz_deinit(&lim);
+    return k;
+}
+
+// Whether q * 10^t reads back as m * 2^e; if not, sets *below to whether
+// q * 10^t is less than it
+STATIC bool fpc_exact_round_trips(uint64_t m, int e, const mpz_t *q, int t, bool *below) {
+    // scale everything by 2^(2 + max(-e, 0)) * 10^max(-t, 0) to work in integers
+    int e_pos = e > 0 ? e : 0;
+    MPZ_SCRATCH(x);
+    MPZ_SCRATCH(v);
+    MPZ_SCRATCH(bound);
+    MPZ_SCRATCH(tmp);
+    if (t >= 0) {
+        fpc_mpz_pow10(&tmp, t);
+        mpz_mul_inpl(&bound, q, &tmp);
+        mpz_set_from_ll(&v, m, false);
+        mpz_set_from_int(&tmp, 1);
+    } else {
+        mpz_set(&bound, q);
+        fpc_mpz_pow10(&x, -t);
+        mpz_set_from_ll(&tmp, m, false);
+        mpz_mul_inpl(&v, &tmp, &x);
+        mpz_set(&tmp, &x);
+    }
+    // here bound = q * 10^max(t, 0), v = m * 10^max(-t, 0), tmp = 10^max(-t, 0)
+    mpz_shl_inpl(&x, &bound, 2 + (e < 0 ? -e : 0));
+    mpz_shl_inpl(&bound, &v, 2 + e_pos);
+    mpz_sub_inpl(&v, &x, &bound);
+    *below = v.neg;
+    v.neg = 0;
+    // distance to the next float up is 2^e, and the same down unless m is
+    // a power of two, so half of it is 2^(1 + e_pos) or 2^e_pos scaled
+    if (*below && m == FPC_HIDDEN_BIT && e != FPC_EXP_DENORMAL) {
+        mpz_shl_inpl(&bound, &tmp, e_pos);
+    } else {
+        mpz_shl_inpl(&bound, &tmp, 1 + e_pos);
+    }
+    int c = mpz_cmp(&v, &bound);
+    mpz_deinit(&x);
+    mpz_deinit(&v);
+    mpz_deinit(&bound);
+    mpz_deinit(&tmp);
+    // on a tie the float with even mantissa wins
+    return c < 0 || (c == 0 && (m & 1) == 0);
+}
+
+STATIC int fpc_mpz_digits(const mpz_t *q, char *buf) {
+    return mpz_as_str_inpl(q, 10, "", 'a', '\0', buf);
+}
+
+// The shortest digits that read back as m * 2^e (m > 0), nearest to it if there
+// are several, with the decimal exponent of the first digit in k10
+STATIC int fpc_shortest(uint64_t m, int e, char *buf, int *k10) {
+    int len;
+    if (!grisu_shortest(m, e, buf, &len, k10)) {
+        // If an n-digit decimal reads back as m * 2^e then it is the correctly
+        // rounded one, except that a power of two may need it rounded up.
+        // Unless m is subnormal with fewer bits, anything shorter than
+        // FPC_DIG_MIN digits is that rounding with trailing zeros.
+        MPZ_SCRATCH(q);
+        int n;
+        for (n = m < FPC_HIDDEN_BIT ? 1 : FPC_DIG_MIN;; ++n) {
+            *k10 = fpc_exact_sig(m, e, n, &q);
+            bool below;
+            if (n == FPC_DIG_MAX || fpc_exact_round_trips(m, e, &q, *k10 - n + 1, &below)) {
+                break;
+            }
+            if (below) {
+                MPZ_SCRATCH(q1);
+                MPZ_CONST_INT(one, 1);
+                mpz_add_inpl(&q1, &q, &one);
+                bool ok = fpc_exact_round_trips(m, e, &q1, *k10 - n + 1, &below);
+                if (ok) {
+                    mpz_set(&q, &q1);
+                }
+                mpz_deinit(&q1);
+                if (ok) {
+                    break;
+                }
+            }
+        }
+        len = fpc_mpz_digits(&q, buf);
+        if (len > n) {
+            // q + 1 carried into a new digit
+            len = n;
+            *k10 += 1;
+        }
+        mpz_deinit(&q);
+    }
+    while (len > 1 && buf[len - 1] == '0') {
+        len -= 1;
+    }
+    return len;
+}
+
+// n (at most FPC_DIG_LEN_MAX) correctly rounded significant digits of m * 2^e
+STATIC int fpc_sig_digits(uint64_t m, int e, int n, char *buf, int *k10) {
+    int len;
+    if (m == 0) {
+        buf[0] = '0';
+        *k10 = 0;
+        return 1;
+    }
+    if (grisu_counted(m, e, n, 0, buf, &len, k10)) {
+        return len;
+    }
+    MPZ_SCRATCH(q);
+    *k10 = fpc_exact_sig(m, e, n, &q);
+    len = fpc_mpz_digits(&q, buf);
+    mpz_deinit(&q);
+    return len;
+}
+
+// The digits of m * 2^e correctly rounded to prec decimal places; there
+// must be at most FPC_DIG_LEN_MAX of them
+STATIC int fpc_fixed_digits(uint64_t m, int e, int prec, char *buf, int *k10) {
+    int len;
+    if (m == 0) {
+        buf[0] = '0';
+        *k10 = 0;
+        return 1;
+    }
+    if (grisu_counted(m, e, 0, -prec, buf, &len, k10)) {
+        return len;
+    }
+    MPZ_SCRATCH(q);
+    fpc_exact_scaled(&q, m, e, prec);
+    len = fpc_mpz_digits(&q, buf);
+    *k10 = len - 1 - prec;
+    if (q.len == 0) {
+        *k10 = 0;
+    }
+    mpz_deinit(&q);
+    return len;
+}
+
+// Writes the digits, the first having weight 10^k10, with prec decimal places
+STATIC char *fpc_put_fixed(char *s, const char *dig, int len, int k10, int prec) {
+    if (k10 < 0) {
+        *s++ = '0';
+    }
+    for (int i = 0; i <= k10; ++i) {
+        *s++ = i < len ? dig[i] : '0';
+    }
+    if (prec > 0) {
+        *s++ = '.';
+        for (int i = k10 + 1; i <= k10 + prec; ++i) {
+            *s++ = (i >= 0 && i < len) ? dig[i] : '0';
+        }
+    }
+    return s;
+}
+
+// Writes the digits as d.ddde+XX, with prec decimal places
+STATIC char *fpc_put_exp(char *s, const char *dig, int len, int k10, int prec, char e_char) {
+    *s++ = dig[0];
+    if (prec > 0) {
+        *s++ = '.';
+        for (int i = 1; i <= prec; ++i) {
+            *s++ = i < len ? dig[i] : '0';
+        }
+    }
+    *s++ = e_char;
+    if (k10 < 0) {
+        *s++ = '-';
+        k10 = -k10;
+    } else {
+        *s++ = '+';
+    }
+    if (k10 >= 100) {
+        *s++ = '0' + k10 / 100;
+    }
+    *s++ = '0' + k10 / 10 % 10;
+    *s++ = '0' + k10 % 10;
+    return s;
+}
+
+// Writes the sign and returns NULL, or writes inf/nan and returns the end
+STATIC char *fpc_put_sign(char *s, bool finite, bool neg, uint64_t m, char sign, char fmt) {
+    if (neg && (finite || m == 0)) {
+        *s++ = '-';
+    } else if (sign) {
+        *s++ = sign;
+    }
+    if (finite) {
+        return NULL;
+    }
+    char uc = fmt & 0x20;
+    const char *name = m == 0 ? "INF" : "NAN";
+    for (int i = 0; i < 3; ++i) {
+        *s++ = name[i] ^ uc;
+    }
+    return s;
+}
+
+bool mp_float_from_decimal_fast(uint64_t mant, bool mant_exact, int exp10, mp_float_t *result) {
+    // Like Grisu, this uses a cached power of ten, so it lives here.  It's the
+    // DiyFp strtod of the double-conversion library: the error of mant * 10^exp10
+    // is tracked in eighths of its last bit, and if that leaves the rounding
+    // of its float in doubt we give up.
+    const int pow_len = sizeof(fpc_cached_pow10) / sizeof(fpc_cached_pow10[0]);
+    if (mant == 0 || exp10 < -348 + 8 * FPC_POW_FIRST_IDX) {
+        return false;
+    }
+    int idx = (exp10 + 348) / 8 - FPC_POW_FIRST_IDX;
+    if (idx >= pow_len) {
+        return false;
+    }
+    int adj = exp10 - fpc_cached_pow10[idx].k;
+    uint64_t error = mant_exact ? 0 : 8;
+    if (adj > 0 && mant <= UINT64_MAX / fpc_pow10_u32[adj]) {
+        mant *= fpc_pow10_u32[adj];
+        error *= fpc_pow10_u32[adj];
+        adj = 0;
+    }
+    diy_fp_t in = diy_fp_normalize(mant, 0);
+    error <<= -in.e;
+    if (adj > 0) {
+        // the adjustment power is exact, only the product is rounded
+        in = diy_fp_mul(in, diy_fp_normalize(fpc_pow10_u32[adj], 0));
+        error += 4;
+    }
+    diy_fp_t c = {fpc_cached_pow10[idx].f, fpc_cached_pow10[idx].e};
+    in = diy_fp_mul(in, c);
+    // add the error of the cached power, of their product and of the rounding
+    error += 4 + (error != 0) + 4;
+    int old_e = in.e;
+    in = diy_fp_normalize(in.f, in.e);
+    error <<= old_e - in.e;
+
+    // the number of low bits to round off, more for subnormals
+    int order = 64 + in.e;
+    int sig_bits = FPC_MANT_BITS + 1;
+    if (order < FPC_EXP_DENORMAL + sig_bits) {
+        sig_bits = order <= FPC_EXP_DENORMAL ? 0 : order - FPC_EXP_DENORMAL;
+    }
+    int prec_bits = 64 - sig_bits;
+    if (prec_bits + 3 >= 64) {
+        // tiny subnormal: shift so the eighths don't overflow
+        int shift = prec_bits + 3 - 64 + 1;
+        in.f >>= shift;
+        in.e += shift;
+        error = (error >> shift) + 1 + 8;
+        prec_bits -= shift;
+    }
+    uint64_t low_bits = (in.f & (((uint64_t)1 << prec_bits) - 1)) * 8;
+    uint64_t half_way = ((uint64_t)1 << (prec_bits - 1)) * 8;
+    if (half_way - error < low_bits && low_bits < half_way + error) {
+        return false;
+    }
+    uint64_t rounded = in.f >> prec_bits;
+    if (low_bits >= half_way + error) {
+        rounded += 1;
+    }
+    *result = MICROPY_FLOAT_C_FUN(ldexp)((mp_float_t)rounded, in.e + prec_bits);
+    return true;
+}
+
+int mp_format_float(mp_float_t f, char *buf, size_t buf_size, char fmt, int prec, char sign) {
+    if (buf_size < 7) {
+        // Smallest exp notion is -9e+99 which is 6 chars plus terminating
+        // null.
+        if (buf_size >= 2) {
+            buf[0] = '?';
+            buf[1] = '\0';
+        } else if (buf_size == 1) {
+            buf[0] = '\0';
+        }
+        return buf_size >= 2;
+    }
+
+    bool neg;
+    uint64_t m;
+    int e;
+    bool finite = fpc_decompose(f, &neg, &m, &e);
+    char *s = fpc_put_sign(buf, finite, neg, m, sign, fmt);
+    if (s != NULL) {
+        *s = '\0';
+        return s - buf;
+    }
+    s = buf + (neg || sign);
+
+    // the digits must fit in the buffer and in our digit buffer
+    int room = buf_size - 1 - (s - buf);
+    if (room > FPC_DIG_LEN_MAX) {
+        room = FPC_DIG_LEN_MAX;
+    }
+    if (prec < 0) {
+        prec = 6;
+    }
+    char e_char = 'E' | (fmt & 0x20); // e_char will match case of fmt
+    fmt |= 0x20; // Force fmt to be lowercase
+    char dig[FPC_DIG_BUF_SIZE];
+    int len, k10;
+
+    if (fmt == 'f') {
+        // upper bound on the number of integral digits
+        int n_int = m == 0 ? 1 : fpc_k10_estimate(m, e) + 2;
+        if (n_int < 1) {
+            n_int = 1;
+        }
+        if (n_int > room - 1) {
+            // too big for the buffer, so print it in exponent notation
+            fmt = 'e';
+        } else {
+            if (n_int + 1 + prec > room) {
+                prec = room - n_int - 1;
+                if (prec < 0) {
+                    prec = 0;
+                }
+            }
+            len = fpc_fixed_digits(m, e, prec, dig, &k10);
+            s = fpc_put_fixed(s, dig, len, k10, prec);
+        }
+    }
+    if (fmt == 'e') {
+        // d.ddde+XXX is 6 characters plus the decimal places
+        if (prec > room - 7) {
+            prec = room - 7 > 0 ? room - 7 : 0;
+        }
+        len = fpc_sig_digits(m, e, prec + 1, dig, &k10);
+        s = fpc_put_exp(s, dig, len, k10, prec, e_char);
+    } else if (fmt == 'g') {
+        // the longest is 0.0000ddd or d.ddde+XXX
+        if (prec == 0) {
+            prec = 1;
+        } else if (prec > room - 6) {
+            prec = room - 6;
+        }
+        len = fpc_sig_digits(m, e, prec, dig, &k10);
+        while (len > 1 && dig[len - 1] == '0') {
+            len -= 1;
+        }
+        if (-4 <= k10 && k10 < prec) {
+            s = fpc_put_fixed(s, dig, len, k10, len - 1 > k10 ? len - 1 - k10 : 0);
+        } else {
+            s = fpc_put_exp(s, dig, len, k10, len - 1, e_char);
+        }
+    }
+    *s = '\0';
+    return s - buf;
+}
+
+int mp_format_float_repr(mp_float_t f, char *buf, size_t buf_size) {
+    assert(buf_size >= MP_FLOAT_REPR_BUF_SIZE);
+    (void)buf_size;
+    bool neg;
+    uint64_t m;
+    int e;
+    bool finite = fpc_decompose(f, &neg, &m, &e);
+    char *s = fpc_put_sign(buf, finite, neg, m, '\0', 'e');
+    if (s == NULL) {
+        s = buf + neg;
+        char dig[FPC_DIG_BUF_SIZE];
+        int len, k10;
+        if (m == 0) {
+            dig[0] = '0';
+            len = 1;
+            k10 = 0;
+        } else {
+            len = fpc_shortest(m, e, dig, &k10);
+        }
+        if (-4 <= k10 && k10 < FPC_REPR_EXP_MAX) {
+            s = fpc_put_fixed(s, dig, len, k10, len - 1 > k10 ? len - 1 - k10 : 0);
+        } else {
+            s = fpc_put_exp(s, dig, len, k10, len - 1, 'e');
+        }
+    }
+    *s = '\0';
+    return s - buf;
+}
+
+#endif // MICROPY_FLOAT_EXACT_CONV
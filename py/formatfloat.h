@@ -26,6 +26,20 @@
 #ifndef __MICROPY_INCLUDED_PY_FORMATFLOAT_H__
 #define __MICROPY_INCLUDED_PY_FORMATFLOAT_H__
 
+#include "py/mpconfig.h"
+
+#if MICROPY_FLOAT_EXACT_CONV
+// big enough for any repr, eg -2.2250738585072014e-308
+#define MP_FLOAT_REPR_BUF_SIZE (32)
+
+int mp_format_float(mp_float_t f, char *buf, size_t bufSize, char fmt, int prec, char sign);
+// writes the shortest string that reads back as f, without a trailing ".0"
+int mp_format_float_repr(mp_float_t f, char *buf, size_t buf_size);
+// converts mant * 10^exp10 to the nearest float, where mant is exact or
+// truncated; returns false if it can't be sure of the rounding
+bool mp_float_from_decimal_fast(uint64_t mant, bool mant_exact, int exp10, mp_float_t *result);
+#else
 int mp_format_float(float f, char *buf, size_t bufSize, char fmt, int prec, char sign);
+#endif
 
 #endif // __MICROPY_INCLUDED_PY_FORMATFLOAT_H__
@@ -28,6 +28,7 @@
 #include <stdint.h>
 
 #include "py/lexer.h"
+#include "py/frozenmod.h"
 
 #if MICROPY_MODULE_FROZEN
 
@@ -51,3 +52,24 @@ mp_lexer_t *mp_find_frozen_module(const char *str, int len) {
 }
 
 #endif // MICROPY_MODULE_FROZEN
+
+#if MICROPY_MODULE_FROZEN_MPY
+
+// these are generated by tools/mpy-tool.py; the names are nul-terminated,
+// with an empty name at the end
+extern const char mp_frozen_mpy_names[];
+extern const mp_raw_code_t *const mp_frozen_mpy_content[];
+
+const mp_raw_code_t *mp_find_frozen_mpy(const char *str, int len) {
+    const char *s = mp_frozen_mpy_names;
+    for (int i = 0; *s != '\0'; i++) {
+        int l = strlen(s);
+        if (l == len && !memcmp(str, s, l)) {
+            return mp_frozen_mpy_content[i];
+        }
+        s += l + 1;
+    }
+    return NULL;
+}
+
+#endif // MICROPY_MODULE_FROZEN_MPY
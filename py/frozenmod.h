@@ -25,3 +25,9 @@
  */
 
 mp_lexer_t *mp_find_frozen_module(const char *str, int len);
+
+#if MICROPY_MODULE_FROZEN_MPY
+#include "py/emitglue.h"
+
+const mp_raw_code_t *mp_find_frozen_mpy(const char *str, int len);
+#endif
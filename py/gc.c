@@ -32,9 +32,29 @@
 #include "py/gc.h"
 #include "py/obj.h"
 #include "py/runtime.h"
+#if MICROPY_GC_PRECISE_VM_ROOTS || MICROPY_GC_HEAP_PROFILE
+#include "py/bc.h"
+#endif
 
 #if MICROPY_ENABLE_GC
 
+#if MICROPY_PY_THREAD && MICROPY_GC_PRECISE_VM_ROOTS
+// registered code states are only tracked for the current thread
+#error MICROPY_GC_PRECISE_VM_ROOTS is not supported with MICROPY_PY_THREAD
+#endif
+
+#if MICROPY_GC_AUTO_GROW && !MICROPY_GC_SPLIT_HEAP
+#error MICROPY_GC_AUTO_GROW requires MICROPY_GC_SPLIT_HEAP
+#endif
+
+#if MICROPY_GC_DEFERRED_FINALISERS && !(MICROPY_ENABLE_FINALISER && MICROPY_ENABLE_SCHEDULER)
+#error MICROPY_GC_DEFERRED_FINALISERS requires MICROPY_ENABLE_FINALISER and MICROPY_ENABLE_SCHEDULER
+#endif
+
+#if MICROPY_PY_UWEAKREF && !MICROPY_GC_DEFERRED_FINALISERS
+#error MICROPY_PY_UWEAKREF requires MICROPY_GC_DEFERRED_FINALISERS
+#endif
+
 #if 0 // print debugging info
 #define DEBUG_PRINT (1)
 #define DEBUG_printf DEBUG_printf
@@ -72,71 +92,300 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((ptr) - (mp_uint_t)MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (mp_uint_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+#define BLOCK_FROM_PTR(area, ptr) (((ptr) - (mp_uint_t)(area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (mp_uint_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
+// returns the number of blocks in the chain with the given head; the entries
+// after the last block of the ATB are FTB bits, which mustn't be read as tails
+static inline mp_uint_t gc_chain_len(mp_state_mem_area_t *area, mp_uint_t block) {
+    mp_uint_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    mp_uint_t n_blocks = 1;
+    while (block + n_blocks < max_block && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL) {
+        n_blocks += 1;
+    }
+    return n_blocks;
+}
+
+#if MICROPY_GC_INCREMENTAL || MICROPY_GC_LAZY_SWEEP
+// while an incremental mark or a lazy sweep is in progress live heads may
+// already be marked
+#define ATB_IS_HEAD(area, block) (ATB_GET_KIND(area, block) & AT_HEAD)
+#else
+#define ATB_IS_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD)
+#endif
+
 #if MICROPY_ENABLE_FINALISER
 // FTB = finaliser table byte
 // if set, then the corresponding block may have a finaliser
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#endif
+
+#if MICROPY_GC_GENERATIONAL
+// YTB = young table byte
+// if set, then the corresponding head block was allocated since the last collection
+
+#define BLOCKS_PER_YTB (8)
+
+#define YTB_GET(area, block) (((area)->gc_young_table_start[(block) / BLOCKS_PER_YTB] >> ((block) & 7)) & 1)
+#define YTB_SET(area, block) do { (area)->gc_young_table_start[(block) / BLOCKS_PER_YTB] |= (1 << ((block) & 7)); } while (0)
+
+// during a minor collection only young blocks are traced
+#define BLOCK_IS_TRACEABLE(area, block) (!MP_STATE_MEM(gc_in_minor) || YTB_GET(area, block))
+#else
+#define BLOCK_IS_TRACEABLE(area, block) (1)
+#endif
+
+#if MICROPY_GC_HEAP_PROFILE
+// PTB = profile table byte
+// index of the allocation site of the chain starting at the corresponding head block
+
+#define PTB_GET(area, block) ((area)->gc_profile_table_start[(block)])
+#define PTB_SET(area, block, site) do { (area)->gc_profile_table_start[(block)] = (site); } while (0)
+#endif
+
+#if MICROPY_GC_FREE_LISTS
+// Segregated free lists for small allocations.  Each size class holds the
+// start block of runs which had at least that many free blocks when they were
+// recorded.  The lists live in the area state (not in the free blocks), so an
+// entry that was since allocated by another path is simply rejected when it's
+// taken, and entries can never corrupt the heap.
+
+#define GC_NUM_SIZE_CLASSES (5)
+#define GC_SIZE_CLASS_MAX_BLOCKS (8)
+
+STATIC const byte gc_size_class_blocks[GC_NUM_SIZE_CLASSES] = {1, 2, 3, 4, 8};
+
+// the smallest class that can satisfy an allocation of n_blocks
+#define SIZE_CLASS_FOR_ALLOC(n_blocks) ((n_blocks) <= 4 ? (n_blocks) - 1 : 4)
+
+// the largest class that fits in a free run of the given length
+#define SIZE_CLASS_FOR_RUN(len) ((len) >= 8 ? 4 : (len) >= 4 ? 3 : (len) - 1)
+
+STATIC void gc_free_list_add_run(mp_state_mem_area_t *area, mp_uint_t block, mp_uint_t len) {
+    while (len > 0) {
+        mp_uint_t c = SIZE_CLASS_FOR_RUN(len);
+        if (area->gc_free_list_len[c] >= MICROPY_GC_FREE_LIST_LEN) {
+            // list is full, the rest of the run is left to the linear scan
+            break;
+        }
+        area->gc_free_list[c][area->gc_free_list_len[c]++] = block;
+        block += gc_size_class_blocks[c];
+        len -= gc_size_class_blocks[c];
+    }
+}
+
+STATIC bool gc_run_is_free(mp_state_mem_area_t *area, mp_uint_t block, mp_uint_t n_blocks) {
+    for (; n_blocks > 0; block++, n_blocks--) {
+        if (ATB_GET_KIND(area, block) != AT_FREE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// returns the start of a run of n_blocks free blocks, or -1 if none found
+STATIC mp_uint_t gc_free_list_take(mp_state_mem_area_t *area, mp_uint_t n_blocks) {
+    for (mp_uint_t c = SIZE_CLASS_FOR_ALLOC(n_blocks); c < GC_NUM_SIZE_CLASSES; c++) {
+        while (area->gc_free_list_len[c] > 0) {
+            mp_uint_t block = area->gc_free_list[c][--area->gc_free_list_len[c]];
+            if (gc_run_is_free(area, block, n_blocks)) {
+                // give back the unused part of the run
+                gc_free_list_add_run(area, block + n_blocks, gc_size_class_blocks[c] - n_blocks);
+                MP_STATE_MEM(gc_free_list_hit) += 1;
+                return block;
+            }
+        }
+    }
+    MP_STATE_MEM(gc_free_list_miss) += 1;
+    return (mp_uint_t)-1;
+}
+
+STATIC void gc_free_list_reset(mp_state_mem_area_t *area) {
+    for (mp_uint_t c = 0; c < GC_NUM_SIZE_CLASSES; c++) {
+        area->gc_free_list_len[c] = 0;
+    }
+}
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
 #endif
 
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((mp_uint_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
 
-    // calculate parameters for GC (T=total, A=alloc table, F=finaliser table, P=pool; all in bytes):
-    // T = A + F + P
+    // calculate parameters for GC (T=total, A=alloc table, F=finaliser table, Y=young table,
+    // R=profile table, P=pool; all in bytes):
+    // T = A + F + Y + R + P
     //     F = A * BLOCKS_PER_ATB / BLOCKS_PER_FTB
+    //     Y = A * BLOCKS_PER_ATB / BLOCKS_PER_YTB
+    //     R = A * BLOCKS_PER_ATB
     //     P = A * BLOCKS_PER_ATB * BYTES_PER_BLOCK
-    // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
+    // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB / BLOCKS_PER_YTB + BLOCKS_PER_ATB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
+    // F, Y and R are only present if the corresponding feature is enabled.
     mp_uint_t total_byte_len = (byte*)end - (byte*)start;
+    mp_uint_t table_bits_per_atb = BITS_PER_BYTE;
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
-#else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    table_bits_per_atb += BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB;
+#endif
+#if MICROPY_GC_GENERATIONAL
+    table_bits_per_atb += BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_YTB;
 #endif
+#if MICROPY_GC_HEAP_PROFILE
+    table_bits_per_atb += BITS_PER_BYTE * BLOCKS_PER_ATB;
+#endif
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (table_bits_per_atb + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
+    byte *gc_tables_end = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 
 #if MICROPY_ENABLE_FINALISER
-    mp_uint_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    mp_uint_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = gc_tables_end;
+    gc_tables_end += gc_finaliser_table_byte_len;
 #endif
 
-    mp_uint_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (mp_uint_t*)((byte*)end - gc_pool_block_len * BYTES_PER_BLOCK);
-    MP_STATE_MEM(gc_pool_end) = (mp_uint_t*)end;
+#if MICROPY_GC_GENERATIONAL
+    mp_uint_t gc_young_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_YTB - 1) / BLOCKS_PER_YTB;
+    area->gc_young_table_start = gc_tables_end;
+    gc_tables_end += gc_young_table_byte_len;
+#endif
 
-#if MICROPY_ENABLE_FINALISER
-    assert((byte*)MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+#if MICROPY_GC_HEAP_PROFILE
+    area->gc_profile_table_start = gc_tables_end;
+    gc_tables_end += area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
 #endif
 
+    mp_uint_t gc_pool_block_len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    area->gc_pool_start = (mp_uint_t*)((byte*)end - gc_pool_block_len * BYTES_PER_BLOCK);
+    area->gc_pool_end = (mp_uint_t*)end;
+
+    assert((byte*)area->gc_pool_start >= gc_tables_end);
+    (void)gc_tables_end;
+
+#if !MICROPY_GC_HEAP_ZEROED
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
+#endif
+
+#if MICROPY_GC_GENERATIONAL
+    // clear YTBs
+    memset(area->gc_young_table_start, 0, gc_young_table_byte_len);
+#endif
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+    area->gc_last_multi_atb_index = 0;
+
+    #if MICROPY_GC_LAZY_SWEEP
+    // nothing to sweep
+    area->gc_sweep_block = gc_pool_block_len;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    // the whole area is free
+    gc_free_list_reset(area);
+    gc_free_list_add_run(area, 0, gc_pool_block_len);
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+#if MICROPY_GC_GENERATIONAL
+    DEBUG_printf("  young table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_young_table_start, gc_young_table_byte_len, gc_young_table_byte_len * BLOCKS_PER_YTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
+
+    #if MICROPY_GC_GENERATIONAL
+    MP_STATE_MEM(gc_minor_requested) = 0;
+    MP_STATE_MEM(gc_in_minor) = 0;
+    MP_STATE_MEM(gc_minor_count) = 0;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    MP_STATE_MEM(gc_incr_marking) = 0;
+    MP_STATE_MEM(gc_incr_finishing) = 0;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    MP_STATE_MEM(gc_free_list_hit) = 0;
+    MP_STATE_MEM(gc_free_list_miss) = 0;
+    #endif
+
+    #if MICROPY_GC_OBJ_POOLS
+    memset(MP_STATE_MEM(gc_pool_head), 0, sizeof(MP_STATE_MEM(gc_pool_head)));
+    memset(MP_STATE_MEM(gc_pool_type), 0, sizeof(MP_STATE_MEM(gc_pool_type)));
+    memset(MP_STATE_MEM(gc_pool_len), 0, sizeof(MP_STATE_MEM(gc_pool_len)));
+    memset(MP_STATE_MEM(gc_pool_hit), 0, sizeof(MP_STATE_MEM(gc_pool_hit)));
+    memset(MP_STATE_MEM(gc_pool_miss), 0, sizeof(MP_STATE_MEM(gc_pool_miss)));
+    MP_STATE_MEM(gc_pool_room) = 0;
+    #endif
+
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_large) = NULL;
+    MP_STATE_MEM(gc_large_len) = 0;
+    MP_STATE_MEM(gc_large_max) = 0;
+    MP_STATE_MEM(gc_large_live_bytes) = 0;
+    MP_STATE_MEM(gc_large_new_bytes) = 0;
+    MP_STATE_MEM(gc_large_pending) = 0;
+    MP_STATE_MEM(gc_large_lo) = (mp_uint_t)-1;
+    MP_STATE_MEM(gc_large_hi) = 0;
+    #endif
+
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) = 0;
+    MP_STATE_MEM(gc_alloc_threshold) = (size_t)-1;
+    #endif
+
+    #if MICROPY_GC_STATS
+    memset(&MP_STATE_MEM(gc_stats), 0, sizeof(mp_gc_stats_t));
+    #endif
+
+    #if MICROPY_GC_DEFERRED_FINALISERS
+    memset(MP_STATE_VM(gc_finaliser_queue), 0, sizeof(MP_STATE_VM(gc_finaliser_queue)));
+    MP_STATE_VM(gc_finaliser_len) = 0;
+    MP_STATE_VM(gc_finaliser_scheduled) = 0;
+    MP_STATE_VM(gc_finaliser_running) = 0;
+    #endif
+
+    #if MICROPY_PY_UWEAKREF
+    MP_STATE_VM(gc_weak_table) = NULL;
+    MP_STATE_VM(gc_weak_len) = 0;
+    MP_STATE_VM(gc_weak_alloc) = 0;
+    #endif
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -144,14 +393,35 @@ void gc_init(void *start, void *end) {
     // allow auto collection
     MP_STATE_MEM(gc_auto_collect_enabled) = 1;
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
-#endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+    #if MICROPY_GC_HEAP_PROFILE
+    // only the unknown site to begin with
+    memset(&MP_STATE_MEM(gc_profile_site)[0], 0, sizeof(mp_gc_profile_site_t));
+    MP_STATE_MEM(gc_profile_num_sites) = 1;
+    #endif
 }
 
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add_region(void *start, void *end) {
+    // the area state lives at the start of the region itself
+    start = (void*)(((mp_uint_t)start + sizeof(mp_uint_t) - 1) & ~(sizeof(mp_uint_t) - 1));
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)start;
+    start = area + 1;
+    if ((byte*)start >= (byte*)end) {
+        return;
+    }
+
+    gc_setup_area(area, start, end);
+
+    // append the new area to the end of the list, so areas are searched in the
+    // order they were added
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+}
+#endif
+
 void gc_lock(void) {
     MP_STATE_MEM(gc_lock_depth)++;
 }
@@ -164,182 +434,1666 @@ bool gc_is_locked(void) {
     return MP_STATE_MEM(gc_lock_depth) != 0;
 }
 
-#define VERIFY_PTR(ptr) ( \
+#define VERIFY_PTR(area, ptr) ( \
         (ptr & (BYTES_PER_BLOCK - 1)) == 0          /* must be aligned on a block */ \
-        && ptr >= (mp_uint_t)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (mp_uint_t)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
+        && ptr >= (mp_uint_t)(area)->gc_pool_start     /* must be above start of pool */ \
+        && ptr < (mp_uint_t)(area)->gc_pool_end        /* must be below end of pool */ \
     )
 
+// returns the area that contains the given heap pointer, or NULL if it's not
+// a valid heap pointer
+#if MICROPY_GC_SPLIT_HEAP
+STATIC mp_state_mem_area_t *gc_get_ptr_area(mp_uint_t ptr) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = area->next) {
+        if (VERIFY_PTR(area, ptr)) {
+            return area;
+        }
+    }
+    return NULL;
+}
+#else
+#define gc_get_ptr_area(ptr) (VERIFY_PTR(&MP_STATE_MEM(area), ptr) ? &MP_STATE_MEM(area) : NULL)
+#endif
+
+#if MICROPY_GC_OBJ_POOLS
+// Object pools.  A dead object is kept on a pool by leaving its chain
+// allocated and linking it through its second word, with the low bit set so
+// that the link doesn't look like a pointer.  The pools aren't roots, so a
+// pooled object is found dead by every collection, which empties the pools
+// before marking and lets the sweep refill them.
+
+#define POOL_NEXT(obj) (((mp_uint_t*)(obj))[1])
+
+// called by the sweep for an unmarked head without a finaliser; returns true
+// if the object was put on a pool, in which case its chain must be kept
+STATIC bool gc_pool_keep(mp_state_mem_area_t *area, mp_uint_t block) {
+    if (MP_STATE_MEM(gc_pool_room) == 0) {
+        // the sweep otherwise only reads the ATB, so don't touch the object
+        return false;
+    }
+    void *obj = (void*)PTR_FROM_BLOCK(area, block);
+    const void *type = *(const void**)obj;
+    for (mp_uint_t p = 0; p < MP_OBJ_NUM_POOLS; p++) {
+        if (type == MP_STATE_MEM(gc_pool_type)[p] && type != NULL) {
+            if (MP_STATE_MEM(gc_pool_len)[p] >= MICROPY_GC_OBJ_POOL_LEN
+                || gc_chain_len(area, block) != MP_STATE_MEM(gc_pool_n_blocks)[p]) {
+                return false;
+            }
+            POOL_NEXT(obj) = (mp_uint_t)MP_STATE_MEM(gc_pool_head)[p] | 1;
+            MP_STATE_MEM(gc_pool_head)[p] = obj;
+            MP_STATE_MEM(gc_pool_len)[p] += 1;
+            MP_STATE_MEM(gc_pool_room) -= 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// empty the pools, leaving their objects to the next sweep
+STATIC void gc_pool_drop(void) {
+    MP_STATE_MEM(gc_pool_room) = 0;
+    for (mp_uint_t p = 0; p < MP_OBJ_NUM_POOLS; p++) {
+        if (MP_STATE_MEM(gc_pool_type)[p] != NULL) {
+            MP_STATE_MEM(gc_pool_room) += MICROPY_GC_OBJ_POOL_LEN;
+        }
+        #if MICROPY_GC_GENERATIONAL
+        // pooled objects survived the last sweep and so are old, but they
+        // must be young for a minor collection to reclaim them
+        for (void *obj = MP_STATE_MEM(gc_pool_head)[p]; obj != NULL; obj = (void*)(POOL_NEXT(obj) & ~(mp_uint_t)1)) {
+            mp_state_mem_area_t *area = gc_get_ptr_area((mp_uint_t)obj);
+            YTB_SET(area, BLOCK_FROM_PTR(area, (mp_uint_t)obj));
+        }
+        #endif
+        MP_STATE_MEM(gc_pool_head)[p] = NULL;
+        MP_STATE_MEM(gc_pool_len)[p] = 0;
+    }
+}
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP
+#define GC_STACK_PUSH_AREA(area) (MP_STATE_MEM(gc_area_stack)[MP_STATE_MEM(gc_sp) - MP_STATE_MEM(gc_stack)] = (area))
+#define GC_STACK_POP_AREA() (MP_STATE_MEM(gc_area_stack)[MP_STATE_MEM(gc_sp) - MP_STATE_MEM(gc_stack)])
+#else
+#define GC_STACK_PUSH_AREA(area) (void)(area)
+#define GC_STACK_POP_AREA() (&MP_STATE_MEM(area))
+#endif
+
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// Large objects each have their own memory from the port, and are recorded
+// in a table sorted by address.  The mark phase looks up there any pointer
+// that isn't in an area.  A marked large object is scanned once the mark
+// stack is empty, so the stack only ever holds blocks.
+
+// returns the index of the first large object at or above ptr
+STATIC mp_uint_t gc_large_index(mp_uint_t ptr) {
+    mp_gc_large_t *table = MP_STATE_MEM(gc_large);
+    mp_uint_t lo = 0;
+    mp_uint_t hi = MP_STATE_MEM(gc_large_len);
+    while (lo < hi) {
+        mp_uint_t mid = (lo + hi) / 2;
+        if ((mp_uint_t)table[mid].ptr < ptr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// returns the large object starting at ptr, or NULL if there is none
+STATIC mp_gc_large_t *gc_large_find(mp_uint_t ptr) {
+    if (ptr < MP_STATE_MEM(gc_large_lo) || ptr > MP_STATE_MEM(gc_large_hi)) {
+        return NULL;
+    }
+    mp_uint_t i = gc_large_index(ptr);
+    if (i < MP_STATE_MEM(gc_large_len) && (mp_uint_t)MP_STATE_MEM(gc_large)[i].ptr == ptr) {
+        return &MP_STATE_MEM(gc_large)[i];
+    }
+    return NULL;
+}
+
+STATIC void gc_large_update_bounds(void) {
+    mp_uint_t len = MP_STATE_MEM(gc_large_len);
+    if (len == 0) {
+        MP_STATE_MEM(gc_large_lo) = (mp_uint_t)-1;
+        MP_STATE_MEM(gc_large_hi) = 0;
+    } else {
+        MP_STATE_MEM(gc_large_lo) = (mp_uint_t)MP_STATE_MEM(gc_large)[0].ptr;
+        MP_STATE_MEM(gc_large_hi) = (mp_uint_t)MP_STATE_MEM(gc_large)[len - 1].ptr;
+    }
+}
+
+STATIC void gc_large_mark(mp_uint_t ptr) {
+    mp_gc_large_t *large = gc_large_find(ptr);
+    if (large == NULL) {
+        return;
+    }
+    #if MICROPY_GC_PARALLEL
+    // the workers may find the same object at once
+    byte unmarked = 0;
+    if (__atomic_compare_exchange_n(&large->mark, &unmarked, 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&MP_STATE_MEM(gc_large_pending), 1, __ATOMIC_RELAXED);
+    }
+    #else
+    if (large->mark == 0) {
+        large->mark = 1;
+        MP_STATE_MEM(gc_large_pending) = 1;
+    }
+    #endif
+}
+#define GC_LARGE_MARK(ptr) gc_large_mark(ptr)
+#else
+#define GC_LARGE_MARK(ptr) (void)(ptr)
+#endif
+
 #define VERIFY_MARK_AND_PUSH(ptr) \
     do { \
-        if (VERIFY_PTR(ptr)) { \
-            mp_uint_t _block = BLOCK_FROM_PTR(ptr); \
-            if (ATB_GET_KIND(_block) == AT_HEAD) { \
+        mp_state_mem_area_t *_area = gc_get_ptr_area(ptr); \
+        if (_area != NULL) { \
+            mp_uint_t _block = BLOCK_FROM_PTR(_area, ptr); \
+            if (ATB_GET_KIND(_area, _block) == AT_HEAD && BLOCK_IS_TRACEABLE(_area, _block)) { \
                 /* an unmarked head, mark it, and push it on gc stack */ \
-                ATB_HEAD_TO_MARK(_block); \
+                ATB_HEAD_TO_MARK(_area, _block); \
                 if (MP_STATE_MEM(gc_sp) < &MP_STATE_MEM(gc_stack)[MICROPY_ALLOC_GC_STACK_SIZE]) { \
+                    GC_STACK_PUSH_AREA(_area); \
                     *MP_STATE_MEM(gc_sp)++ = _block; \
                 } else { \
                     MP_STATE_MEM(gc_stack_overflow) = 1; \
                 } \
             } \
+        } else { \
+            GC_LARGE_MARK(ptr); \
         } \
     } while (0)
 
-STATIC void gc_drain_stack(void) {
+// pop the next block (and its area) off the gc stack
+#define GC_STACK_POP(area, block) \
+    do { \
+        block = *--MP_STATE_MEM(gc_sp); \
+        area = GC_STACK_POP_AREA(); \
+    } while (0)
+
+#define GC_STACK_PUSH(area, block) \
+    do { \
+        GC_STACK_PUSH_AREA(area); \
+        *MP_STATE_MEM(gc_sp)++ = (block); \
+    } while (0)
+
+// mark and push all children of the chain starting at the given block, and
+// return the number of blocks in the chain
+STATIC mp_uint_t gc_scan_chain(mp_state_mem_area_t *area, mp_uint_t block) {
+    // work out number of consecutive blocks in the chain starting with this one
+    mp_uint_t n_blocks = gc_chain_len(area, block);
+
+    // check this block's children
+    mp_uint_t *scan = (mp_uint_t*)PTR_FROM_BLOCK(area, block);
+    for (mp_uint_t i = n_blocks * WORDS_PER_BLOCK; i > 0; i--, scan++) {
+        mp_uint_t ptr2 = *scan;
+        VERIFY_MARK_AND_PUSH(ptr2);
+    }
+
+    return n_blocks;
+}
+
+STATIC void gc_drain_stack(void) {
+    while (MP_STATE_MEM(gc_sp) > MP_STATE_MEM(gc_stack)) {
+        // pop the next block off the stack and check its children
+        mp_state_mem_area_t *area;
+        mp_uint_t block;
+        GC_STACK_POP(area, block);
+        gc_scan_chain(area, block);
+    }
+}
+
+STATIC void gc_deal_with_stack_overflow(void) {
+    while (MP_STATE_MEM(gc_stack_overflow)) {
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+        MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+
+        // scan entire memory looking for blocks which have been marked but not their children
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (mp_uint_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    GC_STACK_PUSH(area, block);
+                    gc_drain_stack();
+                }
+            }
+        }
+    }
+}
+
+#if MICROPY_ENABLE_FINALISER
+// call the __del__ method (if any) of an unreachable object
+STATIC void gc_call_del(mp_obj_t obj) {
+    if (((mp_obj_base_t*)obj)->type != MP_OBJ_NULL) {
+        // if the object has a type then see if it has a __del__ method
+        mp_obj_t dest[2];
+        mp_load_method_maybe(obj, MP_QSTR___del__, dest);
+        if (dest[0] != MP_OBJ_NULL) {
+            // load_method returned a method
+            mp_call_method_n_kw(0, 0, dest);
+        }
+    }
+}
+
+// call the finaliser of an unreachable object with a finaliser
+STATIC void gc_call_finaliser(mp_state_mem_area_t *area, mp_uint_t block) {
+    gc_call_del((mp_obj_t)PTR_FROM_BLOCK(area, block));
+    // clear finaliser flag
+    FTB_CLEAR(area, block);
+}
+#endif
+
+// Sweep the blocks from block up to end of an area, where block is not in the
+// middle of a chain.  Returns the number of blocks freed and adds the number
+// of chains freed to *n_collected.  If add_runs is set then the runs of free
+// blocks are added to the free lists, and dead objects may be kept on the
+// object pools.
+STATIC mp_uint_t gc_sweep_range(mp_state_mem_area_t *area, mp_uint_t block, mp_uint_t end, mp_uint_t *n_collected, bool add_runs) {
+    mp_uint_t n_freed = 0;
+    #if MICROPY_GC_FREE_LISTS
+    mp_uint_t run_start = 0;
+    mp_uint_t run_len = 0;
+    #else
+    (void)add_runs;
+    #endif
+    // free unmarked heads and their tails
+    int free_tail = 0;
+    for (; block < end; block++) {
+        switch (ATB_GET_KIND(area, block)) {
+            case AT_HEAD:
+#if MICROPY_GC_GENERATIONAL
+                if (!BLOCK_IS_TRACEABLE(area, block)) {
+                    // old block not considered by a minor collection
+                    free_tail = 0;
+                    break;
+                }
+#endif
+#if MICROPY_GC_OBJ_POOLS
+                if (add_runs
+                    #if MICROPY_ENABLE_FINALISER
+                    && !FTB_GET(area, block)
+                    #endif
+                    && gc_pool_keep(area, block)) {
+                    // dead, but its chain now belongs to a pool
+                    *n_collected += 1;
+                    free_tail = 0;
+                    break;
+                }
+#endif
+#if MICROPY_ENABLE_FINALISER
+                if (FTB_GET(area, block)) {
+                    gc_call_finaliser(area, block);
+                }
+#endif
+                free_tail = 1;
+                *n_collected += 1;
+                // fall through to free the head
+
+            case AT_TAIL:
+                if (free_tail) {
+                    DEBUG_printf("gc_sweep(%p)\n",PTR_FROM_BLOCK(area, block));
+                    ATB_ANY_TO_FREE(area, block);
+                    n_freed += 1;
+                }
+                break;
+
+            case AT_MARK:
+                ATB_MARK_TO_HEAD(area, block);
+                free_tail = 0;
+                break;
+        }
+        #if MICROPY_GC_FREE_LISTS
+        if (!add_runs) {
+            continue;
+        }
+        if (ATB_GET_KIND(area, block) == AT_FREE) {
+            if (run_len++ == 0) {
+                run_start = block;
+            }
+        } else if (run_len > 0) {
+            gc_free_list_add_run(area, run_start, run_len);
+            run_len = 0;
+        }
+        #endif
+    }
+    #if MICROPY_GC_FREE_LISTS
+    if (add_runs) {
+        gc_free_list_add_run(area, run_start, run_len);
+    }
+    #endif
+    return n_freed;
+}
+
+#if MICROPY_GC_PARALLEL
+// Parallel collection.  Each worker marks from a private stack, claiming
+// blocks with an atomic OR on their ATB byte so that every block is scanned
+// by exactly one worker.  A worker with a deep stack hands its oldest entries
+// (those nearest the roots, with the most work below them) to a shared pool
+// whenever the pool runs low, and an idle worker takes its work from there.
+// Work can also be a range of the heap to scan or sweep linearly.  Ranges
+// start on an ATB byte which isn't inside a chain, so no two workers write to
+// the same ATB byte while sweeping.  Finalisers call into the runtime, so
+// they are run beforehand on the collecting thread.
+
+#define GC_PAR_MARK (0)
+#define GC_PAR_SCAN_OLD (1)
+#define GC_PAR_RESCAN_MARKED (2)
+#define GC_PAR_SWEEP (3)
+
+#define GC_PAR_N_RANGES (MICROPY_GC_PARALLEL_WORKERS * 8)
+#define GC_PAR_POOL_SIZE (2 * MICROPY_ALLOC_GC_STACK_SIZE)
+// number of entries a worker takes from the pool at a time
+#define GC_PAR_TAKE (16)
+
+STATIC void gc_par_lock(mp_gc_parallel_t *par) {
+    while (__atomic_test_and_set(&par->lock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&par->lock, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+STATIC void gc_par_unlock(mp_gc_parallel_t *par) {
+    __atomic_clear(&par->lock, __ATOMIC_RELEASE);
+}
+
+// returns true if this call changed the block from a head to marked
+#define ATB_HEAD_TO_MARK_ATOMIC(area, block) \
+    (((__atomic_fetch_or(&(area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB], AT_MARK << BLOCK_SHIFT(block), __ATOMIC_RELAXED) \
+        >> BLOCK_SHIFT(block)) & 3) == AT_HEAD)
+
+// mark and push all children of a chain onto a worker's stack, returning the
+// number of blocks in the chain
+STATIC mp_uint_t gc_par_scan_chain(mp_state_mem_area_t *area, mp_uint_t block, mp_uint_t **sp_in, mp_uint_t *stack_end) {
+    mp_uint_t n_blocks = gc_chain_len(area, block);
+
+    mp_uint_t *sp = *sp_in;
+    mp_uint_t *scan = (mp_uint_t*)PTR_FROM_BLOCK(area, block);
+    for (mp_uint_t i = n_blocks * WORDS_PER_BLOCK; i > 0; i--, scan++) {
+        mp_uint_t ptr = *scan;
+        mp_state_mem_area_t *area2 = gc_get_ptr_area(ptr);
+        if (area2 != NULL) {
+            mp_uint_t block2 = BLOCK_FROM_PTR(area2, ptr);
+            if (ATB_GET_KIND(area2, block2) == AT_HEAD && BLOCK_IS_TRACEABLE(area2, block2)
+                && ATB_HEAD_TO_MARK_ATOMIC(area2, block2)) {
+                if (sp < stack_end) {
+                    *sp++ = ptr;
+                } else {
+                    // found again by gc_deal_with_stack_overflow
+                    MP_STATE_MEM(gc_stack_overflow) = 1;
+                }
+            }
+        } else {
+            GC_LARGE_MARK(ptr);
+        }
+    }
+    *sp_in = sp;
+    return n_blocks;
+}
+
+STATIC void gc_par_worker(void *arg) {
+    mp_gc_parallel_t *par = arg;
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    // the heap tables are reached through the interpreter state
+    mp_state_ctx_ptr = par->ctx;
+    #endif
+    gc_par_lock(par);
+    mp_uint_t *stack = par->stack[par->n_started++];
+    gc_par_unlock(par);
+    mp_uint_t *stack_end = stack + MICROPY_ALLOC_GC_STACK_SIZE;
+    mp_uint_t *sp = stack;
+    mp_state_mem_area_t *area = par->area;
+    bool busy = false;
+
+    for (;;) {
+        // get more work, from the pool or else a range of the heap
+        mp_uint_t range = (mp_uint_t)-1;
+        gc_par_lock(par);
+        if (par->pool_len > 0) {
+            mp_uint_t n = par->pool_len < GC_PAR_TAKE ? par->pool_len : GC_PAR_TAKE;
+            par->pool_len -= n;
+            memcpy(sp, &par->pool[par->pool_len], n * sizeof(mp_uint_t));
+            sp += n;
+        } else if (par->next_range < par->n_ranges) {
+            range = par->next_range++;
+        } else {
+            if (busy) {
+                par->n_busy -= 1;
+                busy = false;
+            }
+            // Only busy workers add to the pool, so once no worker is busy
+            // and there is no work left the phase is finished for good.
+            bool done = par->n_busy == 0;
+            gc_par_unlock(par);
+            if (done) {
+                break;
+            }
+            while (__atomic_load_n(&par->pool_len, __ATOMIC_RELAXED) == 0
+                && __atomic_load_n(&par->n_busy, __ATOMIC_RELAXED) != 0) {
+            }
+            continue;
+        }
+        if (!busy) {
+            par->n_busy += 1;
+            busy = true;
+        }
+        gc_par_unlock(par);
+
+        mp_uint_t block = 0;
+        mp_uint_t end = 0;
+        if (range != (mp_uint_t)-1) {
+            block = par->range[range];
+            end = par->range[range + 1];
+            if (par->kind == GC_PAR_SWEEP) {
+                mp_uint_t n_collected = 0;
+                mp_uint_t n_freed = gc_sweep_range(area, block, end, &n_collected, false);
+                gc_par_lock(par);
+                par->n_freed += n_freed;
+                par->n_collected += n_collected;
+                gc_par_unlock(par);
+                continue;
+            }
+        }
+
+        for (;;) {
+            // trace everything on the stack, sharing work if the pool is low
+            while (sp > stack) {
+                mp_uint_t ptr = *--sp;
+                mp_state_mem_area_t *area2 = gc_get_ptr_area(ptr);
+                gc_par_scan_chain(area2, BLOCK_FROM_PTR(area2, ptr), &sp, stack_end);
+                if (sp - stack >= 2 * GC_PAR_TAKE
+                    && __atomic_load_n(&par->pool_len, __ATOMIC_RELAXED) < GC_PAR_TAKE) {
+                    gc_par_lock(par);
+                    mp_uint_t n = (sp - stack) / 2;
+                    if (n > GC_PAR_POOL_SIZE - par->pool_len) {
+                        n = GC_PAR_POOL_SIZE - par->pool_len;
+                    }
+                    memcpy(&par->pool[par->pool_len], stack, n * sizeof(mp_uint_t));
+                    par->pool_len += n;
+                    gc_par_unlock(par);
+                    sp -= n;
+                    memmove(stack, stack + n, (sp - stack) * sizeof(mp_uint_t));
+                }
+            }
+            // scan the next chain of the range, if any
+            for (; block < end; block++) {
+                mp_uint_t kind = ATB_GET_KIND(area, block);
+                #if MICROPY_GC_GENERATIONAL
+                if (par->kind == GC_PAR_SCAN_OLD && kind == AT_HEAD && !YTB_GET(area, block)) {
+                    break;
+                }
+                #endif
+                if (par->kind == GC_PAR_RESCAN_MARKED && kind == AT_MARK) {
+                    break;
+                }
+            }
+            if (block >= end) {
+                break;
+            }
+            block += gc_par_scan_chain(area, block, &sp, stack_end);
+        }
+    }
+}
+
+// Split the blocks of an area into ranges for the workers.  Each range starts
+// on an ATB byte boundary that isn't inside a chain.
+STATIC void gc_par_split(mp_gc_parallel_t *par, mp_state_mem_area_t *area) {
+    mp_uint_t n_blocks = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    mp_uint_t step = (n_blocks + GC_PAR_N_RANGES - 1) / GC_PAR_N_RANGES;
+    step = (step + BLOCKS_PER_ATB - 1) & ~(BLOCKS_PER_ATB - 1);
+    mp_uint_t n = 0;
+    mp_uint_t block = 0;
+    par->range[0] = 0;
+    while (block < n_blocks) {
+        block += step;
+        while (block < n_blocks && ATB_GET_KIND(area, block) == AT_TAIL) {
+            block += BLOCKS_PER_ATB;
+        }
+        if (block > n_blocks) {
+            block = n_blocks;
+        }
+        par->range[++n] = block;
+    }
+    par->n_ranges = n;
+}
+
+// Run a phase of the collection on the workers.  Marking starts from the
+// blocks on gc_stack; the other kinds work on the ranges of the given area.
+STATIC void gc_par_run(mp_uint_t kind, mp_state_mem_area_t *area) {
+    mp_gc_parallel_t *par = &MP_STATE_MEM(gc_par);
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    par->ctx = mp_state_ctx_ptr;
+    #endif
+    par->lock = 0;
+    par->kind = kind;
+    par->area = area;
+    par->n_started = 0;
+    par->n_busy = 0;
+    par->next_range = 0;
+    par->n_freed = 0;
+    par->n_collected = 0;
+    if (area == NULL) {
+        par->n_ranges = 0;
+    } else {
+        gc_par_split(par, area);
+    }
+    // hand the blocks on gc_stack over to the workers
+    par->pool_len = 0;
+    while (MP_STATE_MEM(gc_sp) > MP_STATE_MEM(gc_stack)) {
+        mp_state_mem_area_t *area2;
+        mp_uint_t block;
+        GC_STACK_POP(area2, block);
+        par->pool[par->pool_len++] = PTR_FROM_BLOCK(area2, block);
+    }
+    if (par->pool_len == 0 && par->n_ranges == 0) {
+        return;
+    }
+    gc_run_workers(gc_par_worker, par);
+}
+
+STATIC mp_uint_t gc_sweep_area_parallel(mp_state_mem_area_t *area) {
+    #if MICROPY_ENABLE_FINALISER
+    // run the finalisers of unreachable objects first, on this thread
+    for (mp_uint_t i = 0; i < (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB; i++) {
+        if (area->gc_finaliser_table_start[i] == 0) {
+            continue;
+        }
+        for (mp_uint_t block = i * BLOCKS_PER_FTB; block < (i + 1) * BLOCKS_PER_FTB; block++) {
+            if (FTB_GET(area, block) && ATB_GET_KIND(area, block) == AT_HEAD && BLOCK_IS_TRACEABLE(area, block)) {
+                gc_call_finaliser(area, block);
+            }
+        }
+    }
+    #endif
+    mp_gc_parallel_t *par = &MP_STATE_MEM(gc_par);
+    gc_par_run(GC_PAR_SWEEP, area);
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) += par->n_collected;
+    #endif
+    #if MICROPY_GC_FREE_LISTS
+    // rebuild the free lists from the first free runs of the area
+    gc_free_list_reset(area);
+    mp_uint_t run_start = 0;
+    mp_uint_t run_len = 0;
+    for (mp_uint_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+        if (ATB_GET_KIND(area, block) == AT_FREE) {
+            if (run_len++ == 0) {
+                run_start = block;
+            }
+        } else if (run_len > 0) {
+            gc_free_list_add_run(area, run_start, run_len);
+            run_len = 0;
+            if (area->gc_free_list_len[GC_NUM_SIZE_CLASSES - 1] >= MICROPY_GC_FREE_LIST_LEN) {
+                // the lists of smaller classes are refilled as they're used
+                break;
+            }
+        }
+    }
+    gc_free_list_add_run(area, run_start, run_len);
+    #endif
+    return par->n_freed;
+}
+#endif
+
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// Scan the large objects marked since the last call, and trace what they
+// refer to.  Returns false if there were none.
+STATIC bool gc_large_scan(void) {
+    if (!MP_STATE_MEM(gc_large_pending)) {
+        return false;
+    }
+    MP_STATE_MEM(gc_large_pending) = 0;
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        mp_gc_large_t *large = &MP_STATE_MEM(gc_large)[i];
+        if (large->mark == 1) {
+            large->mark = 2;
+            gc_collect_root(large->ptr, large->n_bytes / sizeof(mp_uint_t));
+        }
+    }
+    #if MICROPY_GC_PARALLEL
+    if (MP_STATE_MEM(gc_parallel)) {
+        gc_par_run(GC_PAR_MARK, NULL);
+    }
+    #endif
+    return true;
+}
+
+// free the unmarked large objects and clear the marks of the others
+STATIC void gc_large_sweep(void) {
+    mp_gc_large_t *table = MP_STATE_MEM(gc_large);
+    mp_uint_t n = 0;
+    mp_uint_t live_bytes = 0;
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        if (table[i].mark) {
+            table[i].mark = 0;
+            live_bytes += table[i].n_alloc;
+            table[n++] = table[i];
+            continue;
+        }
+        #if MICROPY_ENABLE_FINALISER
+        if (table[i].has_finaliser) {
+            gc_call_del(table[i].ptr);
+        }
+        #endif
+        gc_large_free_pages(table[i].ptr, table[i].n_alloc);
+        #if MICROPY_PY_GC_COLLECT_RETVAL
+        MP_STATE_MEM(gc_collected) += 1;
+        #endif
+    }
+    MP_STATE_MEM(gc_large_len) = n;
+    MP_STATE_MEM(gc_large_live_bytes) = live_bytes;
+    MP_STATE_MEM(gc_large_new_bytes) = 0;
+    gc_large_update_bounds();
+}
+#endif
+
+#if MICROPY_GC_GENERATIONAL
+// For a minor collection all old blocks are treated as roots.  This is the
+// remembered set: old objects may have been mutated to point to young ones
+// and there is no write barrier to record that, so every old chain is
+// scanned linearly (without tracing into other old blocks).
+STATIC void gc_scan_old(void) {
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    // large objects are all treated as old, and are scanned and kept
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        MP_STATE_MEM(gc_large)[i].mark = 1;
+        MP_STATE_MEM(gc_large_pending) = 1;
+    }
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if MICROPY_GC_PARALLEL
+        if (MP_STATE_MEM(gc_parallel)) {
+            gc_par_run(GC_PAR_SCAN_OLD, area);
+            continue;
+        }
+        #endif
+        for (mp_uint_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            if (ATB_GET_KIND(area, block) == AT_HEAD && !YTB_GET(area, block)) {
+                block += gc_scan_chain(area, block) - 1;
+                gc_drain_stack();
+            }
+        }
+    }
+}
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// Finish an incremental mark phase.  The mutator ran between the mark steps
+// and may have stored pointers to unmarked objects into already-scanned ones,
+// and there is no write barrier to catch that, so every marked chain is
+// scanned again.  This is linear in the live heap and only needs to trace the
+// (usually few) objects that were missed.
+STATIC void gc_rescan_marked(void) {
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    // all large objects are marked here, as none are swept while marking
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        if (MP_STATE_MEM(gc_large)[i].mark) {
+            MP_STATE_MEM(gc_large)[i].mark = 1;
+            MP_STATE_MEM(gc_large_pending) = 1;
+        }
+    }
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if MICROPY_GC_PARALLEL
+        if (MP_STATE_MEM(gc_parallel)) {
+            gc_par_run(GC_PAR_RESCAN_MARKED, area);
+            continue;
+        }
+        #endif
+        for (mp_uint_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            if (ATB_GET_KIND(area, block) == AT_MARK) {
+                block += gc_scan_chain(area, block) - 1;
+                gc_drain_stack();
+            }
+        }
+    }
+}
+#endif
+
+// sweep a single area, returning the number of blocks freed
+STATIC mp_uint_t gc_sweep_area(mp_state_mem_area_t *area) {
+    mp_uint_t n_freed;
+    #if MICROPY_GC_PARALLEL
+    if (MP_STATE_MEM(gc_parallel)) {
+        n_freed = gc_sweep_area_parallel(area);
+    } else
+    #endif
+    {
+        #if MICROPY_GC_FREE_LISTS
+        // the free lists are rebuilt from the runs of free blocks left by the sweep
+        gc_free_list_reset(area);
+        #endif
+        mp_uint_t n_collected = 0;
+        n_freed = gc_sweep_range(area, 0, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB, &n_collected, true);
+        #if MICROPY_PY_GC_COLLECT_RETVAL
+        MP_STATE_MEM(gc_collected) += n_collected;
+        #endif
+    }
+#if MICROPY_GC_GENERATIONAL
+    // all surviving blocks are now old
+    memset(area->gc_young_table_start, 0, (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_YTB - 1) / BLOCKS_PER_YTB);
+#endif
+    return n_freed;
+}
+
+#if MICROPY_GC_AUTO_GROW
+// pass the run of free blocks at the end of each area to the port, once
+// all areas are swept
+STATIC void gc_decommit_free_tails(void) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        mp_uint_t atb = area->gc_alloc_table_byte_len;
+        while (atb > 0 && area->gc_alloc_table_start[atb - 1] == 0) {
+            atb -= 1;
+        }
+        mp_uint_t block = atb * BLOCKS_PER_ATB;
+        while (block > 0 && ATB_GET_KIND(area, block - 1) == AT_FREE) {
+            block -= 1;
+        }
+        byte *start = (byte*)PTR_FROM_BLOCK(area, block);
+        if ((byte*)area->gc_pool_end - start >= MICROPY_GC_AUTO_GROW_DECOMMIT_MIN) {
+            gc_decommit(start, area->gc_pool_end);
+        }
+    }
+}
+#endif
+
+#if MICROPY_GC_STATS
+mp_uint_t mp_hal_ticks_cpu(void);
+
+// account for a pause that marked from t_start to t_mark, then swept until now
+STATIC void gc_stats_pause(mp_uint_t t_start, mp_uint_t t_mark) {
+    mp_gc_stats_t *stats = &MP_STATE_MEM(gc_stats);
+    mp_uint_t mark = t_mark - t_start;
+    mp_uint_t sweep = mp_hal_ticks_cpu() - t_mark;
+    stats->mark_ticks += mark;
+    stats->sweep_ticks += sweep;
+    if (mark > stats->mark_max) {
+        stats->mark_max = mark;
+    }
+    if (sweep > stats->sweep_max) {
+        stats->sweep_max = sweep;
+    }
+    mp_uint_t pause = mark + sweep;
+    if (pause > stats->pause_max) {
+        stats->pause_max = pause;
+    }
+    mp_uint_t b = 0;
+    for (mp_uint_t t = pause >> MICROPY_GC_STATS_HIST_SHIFT; t > 0 && b < MICROPY_GC_STATS_HIST_LEN - 1; t >>= 1) {
+        b += 1;
+    }
+    stats->pause_hist[b] += 1;
+}
+#endif
+
+#if MICROPY_GC_LAZY_SWEEP
+// Sweep at least n_blocks more of the blocks left by a lazy collection, in
+// whole chains, or all of them if there are fewer.
+STATIC void gc_sweep_lazy(mp_uint_t n_blocks) {
+    if (!MP_STATE_MEM(gc_sweep_pending)) {
+        return;
+    }
+    #if MICROPY_GC_STATS
+    // the sweep is spread over allocations, so it is not counted as a pause
+    mp_uint_t t_start = mp_hal_ticks_cpu();
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        mp_uint_t area_blocks = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+        mp_uint_t block = area->gc_sweep_block;
+        if (block >= area_blocks) {
+            continue;
+        }
+        mp_uint_t end = n_blocks < area_blocks - block ? block + n_blocks : area_blocks;
+        while (end < area_blocks && ATB_GET_KIND(area, end) == AT_TAIL) {
+            end += 1;
+        }
+        // finalisers run with the GC locked, as in a full sweep
+        gc_lock();
+        mp_uint_t n_collected = 0;
+        if (gc_sweep_range(area, block, end, &n_collected, true) > 0
+            && block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            // the allocator may already have moved past the freed blocks
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
+        }
+        gc_unlock();
+        area->gc_sweep_block = end;
+        #if MICROPY_PY_GC_COLLECT_RETVAL
+        MP_STATE_MEM(gc_collected) += n_collected;
+        #endif
+        if (end < area_blocks) {
+            goto done;
+        }
+        n_blocks -= end - block < n_blocks ? end - block : n_blocks;
+    }
+    MP_STATE_MEM(gc_sweep_pending) = 0;
+    #if MICROPY_GC_AUTO_GROW
+    gc_decommit_free_tails();
+    #endif
+done:;
+    #if MICROPY_GC_STATS
+    mp_uint_t sweep = mp_hal_ticks_cpu() - t_start;
+    MP_STATE_MEM(gc_stats).sweep_ticks += sweep;
+    if (sweep > MP_STATE_MEM(gc_stats).sweep_max) {
+        MP_STATE_MEM(gc_stats).sweep_max = sweep;
+    }
+    #endif
+}
+
+#define gc_sweep_finish() gc_sweep_lazy((mp_uint_t)-1)
+#endif
+
+STATIC void gc_sweep(void) {
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    // large objects are few, so they are never swept lazily
+    gc_large_sweep();
+    #endif
+    #if MICROPY_GC_LAZY_SWEEP
+    if (MP_STATE_MEM(gc_sweep_lazy)
+        #if MICROPY_GC_GENERATIONAL
+        && !MP_STATE_MEM(gc_in_minor)
+        #endif
+        ) {
+        // leave the sweep to gc_alloc; blocks it allocates before sweeping
+        // them are marked so that they survive
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            area->gc_sweep_block = 0;
+            #if MICROPY_GC_FREE_LISTS
+            gc_free_list_reset(area);
+            #endif
+            #if MICROPY_GC_GENERATIONAL
+            // all surviving blocks are now old
+            memset(area->gc_young_table_start, 0, (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_YTB - 1) / BLOCKS_PER_YTB);
+            #endif
+        }
+        MP_STATE_MEM(gc_sweep_pending) = 1;
+        return;
+    }
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    mp_uint_t n_freed = 0;
+    mp_uint_t n_total = 0;
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if MICROPY_GC_GENERATIONAL
+        n_freed += gc_sweep_area(area);
+        n_total += area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+        #else
+        gc_sweep_area(area);
+        #endif
+    }
+#if MICROPY_GC_GENERATIONAL
+    // If a minor collection reclaimed little then the heap is mostly full of
+    // old objects and further minor collections would cost almost as much as
+    // a full one while freeing next to nothing, so make the next one full.
+    if (MP_STATE_MEM(gc_in_minor) && n_freed < n_total / 8) {
+        MP_STATE_MEM(gc_minor_count) = MICROPY_GC_GENERATIONAL_MAX_MINOR;
+    }
+#endif
+    #if MICROPY_GC_AUTO_GROW
+    gc_decommit_free_tails();
+    #endif
+}
+
+void gc_collect_start(void) {
+    #if MICROPY_GC_LAZY_SWEEP
+    // marks left from the last collection must be cleared first
+    gc_sweep_finish();
+    #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_start) = mp_hal_ticks_cpu();
+    #endif
+    gc_lock();
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // the cached bound methods aren't traced, so they may be freed
+    memset(MP_STATE_VM(bound_meth_cache), 0, sizeof(MP_STATE_VM(bound_meth_cache)));
+    #endif
+    #if MICROPY_GC_OBJ_POOLS
+    gc_pool_drop();
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    // a collection while an incremental mark is in progress finishes the
+    // incremental cycle; the marks made so far are kept
+    MP_STATE_MEM(gc_incr_finishing) = MP_STATE_MEM(gc_incr_marking);
+    MP_STATE_MEM(gc_incr_marking) = 0;
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_minor_requested) && MP_STATE_MEM(gc_minor_count) < MICROPY_GC_GENERATIONAL_MAX_MINOR
+        #if MICROPY_GC_INCREMENTAL
+        && !MP_STATE_MEM(gc_incr_finishing)
+        #endif
+        ) {
+        MP_STATE_MEM(gc_in_minor) = 1;
+        MP_STATE_MEM(gc_minor_count) += 1;
+    } else {
+        MP_STATE_MEM(gc_in_minor) = 0;
+        MP_STATE_MEM(gc_minor_count) = 0;
+    }
+    MP_STATE_MEM(gc_minor_requested) = 0;
+    #endif
+    MP_STATE_MEM(gc_stack_overflow) = 0;
+    MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+    #if MICROPY_GC_PARALLEL
+    mp_uint_t n_blocks = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        n_blocks += area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    }
+    MP_STATE_MEM(gc_parallel) = n_blocks >= MICROPY_GC_PARALLEL_MIN_BLOCKS && gc_num_workers() > 1;
+    #endif
+    // Trace root pointers.  This relies on the root pointers being organised
+    // correctly in the mp_state_ctx structure.  We scan the root pointer
+    // section of the current thread's state (dict_locals, dict_globals,
+    // nlr_top, ...), then that of mp_state_vm.  Any other threads are dealt
+    // with by the port's gc_collect.
+    gc_collect_thread_state(MP_STATE_THREAD_PTR());
+    void **ptrs = (void**)(void*)&MP_STATE_CTX_PTR->vm;
+    gc_collect_root(ptrs, offsetof(mp_state_vm_t, mp_optimise_value) / sizeof(mp_uint_t));
+}
+
+// Trace the root pointers of a thread's state, and its stackless frames
+void gc_collect_thread_state(mp_state_thread_t *state) {
+    void **ptrs = (void**)(void*)state;
+    gc_collect_root(ptrs, offsetof(mp_state_thread_t, stack_top) / sizeof(mp_uint_t));
+    #if MICROPY_STACKLESS && MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    // trace the frames in use in the stackless frame pool
+    ptrs = (void**)(void*)state->frame_pool;
+    gc_collect_root(ptrs, (state->frame_pool_top - (byte*)ptrs) / sizeof(mp_uint_t));
+    #endif
+}
+
+#if MICROPY_GC_PRECISE_VM_ROOTS
+#define GC_CODE_STATE_WORDS(code_state) \
+    ((sizeof(mp_code_state) + (code_state)->n_state * sizeof(mp_obj_t) \
+        + (code_state)->gc_n_exc_stack * sizeof(mp_exc_stack_t)) / sizeof(mp_uint_t))
+
+// Scan only the slots of a registered code state that can refer to heap objects.
+STATIC void gc_scan_code_state(mp_code_state *code_state) {
+    mp_uint_t ptr = (mp_uint_t)code_state->code_info; // start of the bytecode
+    VERIFY_MARK_AND_PUSH(ptr);
+    ptr = (mp_uint_t)code_state->old_globals;
+    VERIFY_MARK_AND_PUSH(ptr);
+    #if MICROPY_PERSISTENT_CODE
+    ptr = (mp_uint_t)code_state->const_table;
+    VERIFY_MARK_AND_PUSH(ptr);
+    #endif
+    for (mp_uint_t i = 0; i < code_state->n_state; i++) {
+        ptr = (mp_uint_t)code_state->state[i];
+        VERIFY_MARK_AND_PUSH(ptr);
+    }
+    mp_exc_stack_t *exc_stack = (mp_exc_stack_t*)(code_state->state + code_state->n_state);
+    for (mp_uint_t i = 0; i < code_state->gc_n_exc_stack; i++) {
+        ptr = (mp_uint_t)exc_stack[i].prev_exc;
+        VERIFY_MARK_AND_PUSH(ptr);
+    }
+    gc_drain_stack();
+}
+#endif
+
+void gc_collect_root(void **ptrs, mp_uint_t len) {
+    #if MICROPY_GC_PRECISE_VM_ROOTS
+    // Registered code states are ordered by address on a descending stack.
+    // Those found within this range are scanned precisely; any others (eg
+    // with an ascending stack) are just scanned word by word.
+    mp_code_state *code_state = MP_STATE_VM(gc_code_state_top);
+    #endif
+    for (mp_uint_t i = 0; i < len; i++) {
+        #if MICROPY_GC_PRECISE_VM_ROOTS
+        while (code_state != NULL && (void*)code_state < (void*)&ptrs[i]) {
+            code_state = code_state->gc_prev;
+        }
+        if ((void*)code_state == (void*)&ptrs[i]) {
+            mp_uint_t n = GC_CODE_STATE_WORDS(code_state);
+            if (i + n <= len) {
+                gc_scan_code_state(code_state);
+                i += n - 1;
+                code_state = code_state->gc_prev;
+                continue;
+            }
+        }
+        #endif
+        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+        VERIFY_MARK_AND_PUSH(ptr);
+        #if MICROPY_GC_PARALLEL
+        if (MP_STATE_MEM(gc_parallel)) {
+            // the roots are gathered on gc_stack and traced by the workers
+            if (MP_STATE_MEM(gc_sp) == &MP_STATE_MEM(gc_stack)[MICROPY_ALLOC_GC_STACK_SIZE]) {
+                gc_par_run(GC_PAR_MARK, NULL);
+            }
+            continue;
+        }
+        #endif
+        gc_drain_stack();
+    }
+}
+
+// trace whatever is left after the roots: blocks that didn't fit on the mark
+// stack, and the contents of marked large objects
+STATIC void gc_mark_finish(void) {
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    // scanning large objects may overflow the stack, and dealing with that
+    // may mark more large objects
+    do {
+        gc_deal_with_stack_overflow();
+    } while (gc_large_scan());
+    #else
+    gc_deal_with_stack_overflow();
+    #endif
+}
+
+#if MICROPY_GC_DEFERRED_FINALISERS
+// add an object to the finaliser queue, returning false if it is full
+STATIC bool gc_finaliser_enqueue(mp_uint_t ptr) {
+    if (MP_STATE_VM(gc_finaliser_len) == MICROPY_GC_FINALISER_QUEUE_LEN) {
+        return false;
+    }
+    MP_STATE_VM(gc_finaliser_queue)[MP_STATE_VM(gc_finaliser_len)++] = (mp_obj_t)ptr;
+    return true;
+}
+
+#if MICROPY_PY_UWEAKREF
+// returns true if the marking that has just finished didn't reach the object
+// at ptr; objects outside the heap, and old ones in a minor collection, are
+// always reachable
+STATIC bool gc_is_unreachable(mp_uint_t ptr) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        mp_uint_t block = BLOCK_FROM_PTR(area, ptr);
+        return ATB_GET_KIND(area, block) == AT_HEAD && BLOCK_IS_TRACEABLE(area, block);
+    }
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    mp_gc_large_t *large = gc_large_find(ptr);
+    return large != NULL && large->mark == 0;
+    #else
+    return false;
+    #endif
+}
+
+void gc_weak_register(void *ref) {
+    if (MP_STATE_VM(gc_weak_len) == MP_STATE_VM(gc_weak_alloc)) {
+        mp_uint_t alloc = MP_STATE_VM(gc_weak_alloc);
+        mp_uint_t new_alloc = alloc == 0 ? 8 : alloc * 2;
+        // a collection in here may shrink the table, but never moves it
+        MP_STATE_VM(gc_weak_table) = m_renew(mp_uint_t, MP_STATE_VM(gc_weak_table), alloc, new_alloc);
+        MP_STATE_VM(gc_weak_alloc) = new_alloc;
+    }
+    MP_STATE_VM(gc_weak_table)[MP_STATE_VM(gc_weak_len)++] = GC_WEAK_HIDE(ref);
+}
+
+// Clear the weak references whose targets weren't reached, queueing those
+// with a callback, and drop them and the unreachable weak references from
+// the table.  This is done before any object is kept for its finaliser, so
+// the weak references to it are cleared first, as in CPython.
+STATIC void gc_weak_clear(void) {
+    mp_uint_t *table = MP_STATE_VM(gc_weak_table);
+    mp_uint_t n = 0;
+    for (mp_uint_t i = 0; i < MP_STATE_VM(gc_weak_len); i++) {
+        mp_uint_t *ref = GC_WEAK_REVEAL(table[i]);
+        if (gc_is_unreachable((mp_uint_t)ref)) {
+            // it may yet be kept alive by an object with a finaliser, so it
+            // must not point to a target that might be freed
+            ref[1] = 0;
+            mp_state_mem_area_t *area = gc_get_ptr_area((mp_uint_t)ref);
+            if (area != NULL) {
+                FTB_CLEAR(area, BLOCK_FROM_PTR(area, (mp_uint_t)ref));
+            }
+            continue;
+        }
+        if (ref[1] != 0 && !gc_is_unreachable((mp_uint_t)GC_WEAK_REVEAL(ref[1]))) {
+            table[n++] = table[i];
+            continue;
+        }
+        ref[1] = 0;
+        mp_state_mem_area_t *area = gc_get_ptr_area((mp_uint_t)ref);
+        if (area != NULL) {
+            mp_uint_t block = BLOCK_FROM_PTR(area, (mp_uint_t)ref);
+            if (FTB_GET(area, block)) {
+                if (!gc_finaliser_enqueue((mp_uint_t)ref)) {
+                    // the queue is full, so keep it to try again next time
+                    table[n++] = table[i];
+                    continue;
+                }
+                FTB_CLEAR(area, block);
+            }
+        }
+    }
+    MP_STATE_VM(gc_weak_len) = n;
+}
+#endif
+
+// Queue the unreachable objects that have finalisers, and mark them and
+// everything they refer to so that they survive until the finalisers run.
+// Their finaliser bits are cleared, so they are freed by the next collection
+// that finds them unreachable.
+STATIC void gc_queue_finalisers(void) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        for (mp_uint_t i = 0; i < (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB; i++) {
+            if (area->gc_finaliser_table_start[i] == 0) {
+                continue;
+            }
+            for (mp_uint_t block = i * BLOCKS_PER_FTB; block < (i + 1) * BLOCKS_PER_FTB; block++) {
+                if (FTB_GET(area, block) && ATB_GET_KIND(area, block) == AT_HEAD && BLOCK_IS_TRACEABLE(area, block)) {
+                    mp_uint_t ptr = (mp_uint_t)PTR_FROM_BLOCK(area, block);
+                    if (!gc_finaliser_enqueue(ptr)) {
+                        // the rest are finalised by the sweep
+                        goto queue_full;
+                    }
+                    FTB_CLEAR(area, block);
+                    VERIFY_MARK_AND_PUSH(ptr);
+                    gc_drain_stack();
+                }
+            }
+        }
+    }
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        mp_gc_large_t *large = &MP_STATE_MEM(gc_large)[i];
+        if (large->mark == 0 && large->has_finaliser) {
+            if (!gc_finaliser_enqueue((mp_uint_t)large->ptr)) {
+                break;
+            }
+            large->has_finaliser = 0;
+            large->mark = 1;
+            MP_STATE_MEM(gc_large_pending) = 1;
+        }
+    }
+    #endif
+queue_full:
+    gc_mark_finish();
+}
+
+STATIC mp_obj_t gc_finalise_pending_callback(mp_obj_t arg) {
+    (void)arg;
+    MP_STATE_VM(gc_finaliser_scheduled) = 0;
+    gc_finalise_pending();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gc_finalise_pending_obj, gc_finalise_pending_callback);
+
+void gc_finalise_pending(void) {
+    if (MP_STATE_VM(gc_finaliser_running)) {
+        // a finaliser caused a collection; its objects are run by the loop below
+        return;
+    }
+    MP_STATE_VM(gc_finaliser_running) = 1;
+    while (MP_STATE_VM(gc_finaliser_len) > 0) {
+        mp_uint_t i = --MP_STATE_VM(gc_finaliser_len);
+        // the object stays alive through this reference on the C stack
+        mp_obj_t obj = MP_STATE_VM(gc_finaliser_queue)[i];
+        MP_STATE_VM(gc_finaliser_queue)[i] = MP_OBJ_NULL;
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            gc_call_del(obj);
+            nlr_pop();
+        } else {
+            // as in CPython, an exception from a finaliser is printed and ignored
+            mp_printf(&mp_plat_print, "Exception ignored in __del__:\n");
+            mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        }
+    }
+    MP_STATE_VM(gc_finaliser_running) = 0;
+}
+#endif
+
+void gc_collect_end(void) {
+    #if MICROPY_GC_PARALLEL
+    if (MP_STATE_MEM(gc_parallel)) {
+        gc_par_run(GC_PAR_MARK, NULL);
+    }
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_in_minor)) {
+        gc_scan_old();
+    }
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incr_finishing)) {
+        gc_rescan_marked();
+        MP_STATE_MEM(gc_incr_finishing) = 0;
+    }
+    #endif
+    gc_mark_finish();
+    #if MICROPY_PY_UWEAKREF
+    gc_weak_clear();
+    #endif
+    #if MICROPY_GC_DEFERRED_FINALISERS
+    gc_queue_finalisers();
+    #endif
+    #if MICROPY_GC_STATS
+    mp_uint_t t_mark = mp_hal_ticks_cpu();
+    #endif
+    gc_sweep();
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+        area->gc_last_multi_atb_index = 0;
+    }
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) = 0;
+    #endif
+    #if MICROPY_GC_STATS
+    gc_stats_pause(MP_STATE_MEM(gc_stats_start), t_mark);
+    MP_STATE_MEM(gc_stats).n_collect += 1;
+    MP_STATE_MEM(gc_stats).alloc_bytes = 0;
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    MP_STATE_MEM(gc_in_minor) = 0;
+    #endif
+    #if MICROPY_GC_PARALLEL
+    MP_STATE_MEM(gc_parallel) = 0;
+    #endif
+    gc_unlock();
+    #if MICROPY_GC_DEFERRED_FINALISERS
+    // the queued finalisers run at the next safe point in the VM, where they
+    // can allocate
+    if (MP_STATE_VM(gc_finaliser_len) > 0 && !MP_STATE_VM(gc_finaliser_scheduled)) {
+        MP_STATE_VM(gc_finaliser_scheduled) = mp_sched_schedule((mp_obj_t)&gc_finalise_pending_obj, mp_const_none);
+    }
+    #endif
+}
+
+#if MICROPY_GC_GENERATIONAL
+void gc_collect_young(void) {
+    MP_STATE_MEM(gc_minor_requested) = 1;
+    gc_collect();
+}
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+bool gc_collect_step(mp_uint_t budget) {
+    if (MP_STATE_MEM(gc_lock_depth) > 0) {
+        return false;
+    }
+
+    #if MICROPY_GC_STATS
+    mp_uint_t t_start = mp_hal_ticks_cpu();
+    #endif
+
+    if (!MP_STATE_MEM(gc_incr_marking)) {
+        // start a new cycle by pushing the root pointers in mp_state_ctx; the
+        // C stack and registers are only scanned when the cycle is finished
+        #if MICROPY_GC_LAZY_SWEEP
+        gc_sweep_finish();
+        #endif
+        MP_STATE_MEM(gc_incr_marking) = 1;
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+        MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+        void **ptrs = (void**)(void*)MP_STATE_THREAD_PTR();
+        for (mp_uint_t i = 0, len = offsetof(mp_state_thread_t, stack_top) / sizeof(mp_uint_t); i < len; i++) {
+            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+            VERIFY_MARK_AND_PUSH(ptr);
+        }
+        ptrs = (void**)(void*)&MP_STATE_CTX_PTR->vm;
+        for (mp_uint_t i = 0, len = offsetof(mp_state_vm_t, mp_optimise_value) / sizeof(mp_uint_t); i < len; i++) {
+            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+            VERIFY_MARK_AND_PUSH(ptr);
+        }
+    }
+
+    // trace from the mark stack until the budget is exhausted
     while (MP_STATE_MEM(gc_sp) > MP_STATE_MEM(gc_stack)) {
-        // pop the next block off the stack
-        mp_uint_t block = *--MP_STATE_MEM(gc_sp);
+        if (budget == 0) {
+            #if MICROPY_GC_STATS
+            gc_stats_pause(t_start, mp_hal_ticks_cpu());
+            #endif
+            return false;
+        }
+        mp_state_mem_area_t *area;
+        mp_uint_t block;
+        GC_STACK_POP(area, block);
+        mp_uint_t n = gc_scan_chain(area, block);
+        budget = n < budget ? budget - n : 0;
+    }
 
-        // work out number of consecutive blocks in the chain starting with this one
-        mp_uint_t n_blocks = 0;
-        do {
-            n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+    // mark stack is empty (or overflowed, which the final phase deals with),
+    // so finish this cycle with an atomic root scan, rescan and sweep
+    #if MICROPY_GC_STATS
+    gc_stats_pause(t_start, mp_hal_ticks_cpu());
+    #endif
+    gc_collect();
+    return true;
+}
+#endif
 
-        // check this block's children
-        mp_uint_t *scan = (mp_uint_t*)PTR_FROM_BLOCK(block);
-        for (mp_uint_t i = n_blocks * WORDS_PER_BLOCK; i > 0; i--, scan++) {
-            mp_uint_t ptr2 = *scan;
-            VERIFY_MARK_AND_PUSH(ptr2);
+void gc_info(gc_info_t *info) {
+    #if MICROPY_GC_LAZY_SWEEP
+    gc_sweep_finish();
+    #endif
+    info->total = 0;
+    info->used = 0;
+    info->free = 0;
+    info->num_1block = 0;
+    info->num_2block = 0;
+    info->max_block = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        info->total += (area->gc_pool_end - area->gc_pool_start) * sizeof(mp_uint_t);
+        for (mp_uint_t block = 0, len = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            mp_uint_t kind = ATB_GET_KIND(area, block);
+            if (kind == AT_FREE || kind == AT_HEAD || kind == AT_MARK) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+            }
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                case AT_MARK: // only during an incremental mark
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+            }
         }
     }
-}
 
-STATIC void gc_deal_with_stack_overflow(void) {
-    while (MP_STATE_MEM(gc_stack_overflow)) {
-        MP_STATE_MEM(gc_stack_overflow) = 0;
-        MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+    #if MICROPY_GC_OBJ_POOLS
+    // pooled objects are dead and can be freed when memory runs out
+    for (mp_uint_t p = 0; p < MP_OBJ_NUM_POOLS; p++) {
+        mp_uint_t n = MP_STATE_MEM(gc_pool_len)[p] * MP_STATE_MEM(gc_pool_n_blocks)[p];
+        info->used -= n;
+        info->free += n;
+    }
+    #endif
 
-        // scan entire memory looking for blocks which have been marked but not their children
-        for (mp_uint_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                *MP_STATE_MEM(gc_sp)++ = block;
-                gc_drain_stack();
-            }
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_large_len); i++) {
+        info->total += MP_STATE_MEM(gc_large)[i].n_bytes;
+        info->used += MP_STATE_MEM(gc_large)[i].n_bytes;
+    }
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    info->num_free_list_hit = MP_STATE_MEM(gc_free_list_hit);
+    info->num_free_list_miss = MP_STATE_MEM(gc_free_list_miss);
+    #endif
+}
+
+#if MICROPY_GC_HEAP_PROFILE
+// find (or record) the allocation site of the currently executing bytecode
+STATIC byte gc_profile_get_site(void) {
+    mp_code_state *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state == NULL) {
+        return 0;
+    }
+    qstr block_name, source_file;
+    mp_uint_t source_line = mp_bytecode_get_source_line(code_state->code_info, code_state->ip, &block_name, &source_file);
+    mp_gc_profile_site_t *sites = MP_STATE_MEM(gc_profile_site);
+    mp_uint_t n = MP_STATE_MEM(gc_profile_num_sites);
+    for (mp_uint_t i = 1; i < n; i++) {
+        if (sites[i].source_line == source_line && sites[i].block_name == block_name && sites[i].source_file == source_file) {
+            return i;
         }
     }
+    if (n >= MICROPY_GC_HEAP_PROFILE_SITES) {
+        // table full
+        return 0;
+    }
+    sites[n].source_file = source_file;
+    sites[n].block_name = block_name;
+    sites[n].source_line = source_line;
+    sites[n].n_alloc = 0;
+    MP_STATE_MEM(gc_profile_num_sites) = n + 1;
+    return n;
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
+void gc_heap_profile(mp_uint_t *n_live, mp_uint_t *n_live_bytes) {
+    #if MICROPY_GC_LAZY_SWEEP
+    gc_sweep_finish();
     #endif
-    // free unmarked heads and their tails
-    int free_tail = 0;
-    for (mp_uint_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
-            case AT_HEAD:
-#if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_t obj = (mp_obj_t)PTR_FROM_BLOCK(block);
-                    if (((mp_obj_base_t*)obj)->type != MP_OBJ_NULL) {
-                        // if the object has a type then see if it has a __del__ method
-                        mp_obj_t dest[2];
-                        mp_load_method_maybe(obj, MP_QSTR___del__, dest);
-                        if (dest[0] != MP_OBJ_NULL) {
-                            // load_method returned a method
-                            mp_call_method_n_kw(0, 0, dest);
-                        }
-                    }
-                    // clear finaliser flag
-                    FTB_CLEAR(block);
-                }
+    memset(n_live, 0, MICROPY_GC_HEAP_PROFILE_SITES * sizeof(mp_uint_t));
+    memset(n_live_bytes, 0, MICROPY_GC_HEAP_PROFILE_SITES * sizeof(mp_uint_t));
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        byte site = 0;
+        for (mp_uint_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            switch (ATB_GET_KIND(area, block)) {
+                case AT_HEAD:
+                case AT_MARK: // only during an incremental mark
+                    site = PTB_GET(area, block);
+                    n_live[site] += 1;
+                    n_live_bytes[site] += BYTES_PER_BLOCK;
+                    break;
+
+                case AT_TAIL:
+                    n_live_bytes[site] += BYTES_PER_BLOCK;
+                    break;
+            }
+        }
+    }
+}
 #endif
-                free_tail = 1;
-                #if MICROPY_PY_GC_COLLECT_RETVAL
-                MP_STATE_MEM(gc_collected)++;
-                #endif
-                // fall through to free the head
 
-            case AT_TAIL:
-                if (free_tail) {
-                    DEBUG_printf("gc_sweep(%p)\n",PTR_FROM_BLOCK(block));
-                    ATB_ANY_TO_FREE(block);
-                }
-                break;
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// make room in the table for one more large object
+STATIC bool gc_large_table_reserve(void) {
+    mp_uint_t max = MP_STATE_MEM(gc_large_max);
+    if (MP_STATE_MEM(gc_large_len) < max) {
+        return true;
+    }
+    mp_uint_t new_max = max == 0 ? 16 : 2 * max;
+    mp_gc_large_t *table = gc_large_alloc_pages(new_max * sizeof(mp_gc_large_t));
+    if (table == NULL) {
+        return false;
+    }
+    if (max > 0) {
+        memcpy(table, MP_STATE_MEM(gc_large), max * sizeof(mp_gc_large_t));
+        gc_large_free_pages(MP_STATE_MEM(gc_large), max * sizeof(mp_gc_large_t));
+    }
+    MP_STATE_MEM(gc_large) = table;
+    MP_STATE_MEM(gc_large_max) = new_max;
+    return true;
+}
 
-            case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
-                free_tail = 0;
+// Allocate a large object of n_bytes, with room for it to grow to n_alloc.
+// *collected is set if a collection was done.
+STATIC void *gc_large_alloc(mp_uint_t n_bytes, mp_uint_t n_alloc, bool has_finaliser, int *collected) {
+    // Large objects don't fill the heap, so they trigger a collection of
+    // their own once as much has been allocated as survived the last one, or
+    // as the heap holds if that is more.
+    mp_uint_t trigger = MP_STATE_MEM(gc_large_live_bytes);
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        trigger += (area->gc_pool_end - area->gc_pool_start) * sizeof(mp_uint_t);
+    }
+    if (!*collected && MP_STATE_MEM(gc_large_new_bytes) + n_alloc > trigger) {
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats).n_collect_alloc += 1;
+        #endif
+        gc_collect();
+        *collected = 1;
+    }
+
+    void *ptr;
+    for (;;) {
+        if (gc_large_table_reserve()) {
+            ptr = gc_large_alloc_pages(n_alloc);
+            if (ptr != NULL) {
                 break;
+            }
         }
+        if (*collected) {
+            return NULL;
+        }
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats).n_collect_alloc += 1;
+        #endif
+        gc_collect();
+        *collected = 1;
     }
-}
+    DEBUG_printf("gc_alloc(" UINT_FMT "): large object at %p\n", n_bytes, ptr);
+
+    mp_uint_t i = gc_large_index((mp_uint_t)ptr);
+    mp_gc_large_t *large = &MP_STATE_MEM(gc_large)[i];
+    memmove(large + 1, large, (MP_STATE_MEM(gc_large_len) - i) * sizeof(mp_gc_large_t));
+    MP_STATE_MEM(gc_large_len) += 1;
+    large->ptr = ptr;
+    large->n_bytes = n_bytes;
+    large->n_alloc = n_alloc;
+    large->mark = 0;
+    large->has_finaliser = has_finaliser;
+    gc_large_update_bounds();
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incr_marking)) {
+        // scanned when the cycle is finished, like blocks allocated now
+        large->mark = 1;
+        MP_STATE_MEM(gc_large_pending) = 1;
+    }
+    #endif
+    MP_STATE_MEM(gc_large_new_bytes) += n_alloc;
 
-void gc_collect_start(void) {
-    gc_lock();
-    MP_STATE_MEM(gc_stack_overflow) = 0;
-    MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
-    // Trace root pointers.  This relies on the root pointers being organised
-    // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
-    // dict_globals, then the root pointer section of mp_state_vm.
-    void **ptrs = (void**)(void*)&mp_state_ctx;
-    gc_collect_root(ptrs, offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t));
-}
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) += n_bytes;
+    #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).alloc_bytes += n_bytes;
+    #endif
 
-void gc_collect_root(void **ptrs, mp_uint_t len) {
-    for (mp_uint_t i = 0; i < len; i++) {
-        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-        VERIFY_MARK_AND_PUSH(ptr);
-        gc_drain_stack();
+    #if MICROPY_ENABLE_FINALISER
+    if (has_finaliser) {
+        // clear type pointer in case it is never set
+        ((mp_obj_base_t*)ptr)->type = MP_OBJ_NULL;
     }
+    #endif
+
+    return ptr;
 }
 
-void gc_collect_end(void) {
-    gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
-    gc_unlock();
+STATIC void gc_large_free(mp_gc_large_t *large) {
+    gc_large_free_pages(large->ptr, large->n_alloc);
+    if (MP_STATE_MEM(gc_large_new_bytes) > large->n_alloc) {
+        MP_STATE_MEM(gc_large_new_bytes) -= large->n_alloc;
+    } else {
+        MP_STATE_MEM(gc_large_new_bytes) = 0;
+    }
+    mp_uint_t i = large - MP_STATE_MEM(gc_large);
+    MP_STATE_MEM(gc_large_len) -= 1;
+    memmove(large, large + 1, (MP_STATE_MEM(gc_large_len) - i) * sizeof(mp_gc_large_t));
+    gc_large_update_bounds();
 }
 
-void gc_info(gc_info_t *info) {
-    info->total = (MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start)) * sizeof(mp_uint_t);
-    info->used = 0;
-    info->free = 0;
-    info->num_1block = 0;
-    info->num_2block = 0;
-    info->max_block = 0;
-    for (mp_uint_t block = 0, len = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        mp_uint_t kind = ATB_GET_KIND(block);
-        if (kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
-            }
-            if (len > info->max_block) {
-                info->max_block = len;
-            }
-        }
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len = 0;
-                break;
+STATIC void *gc_large_realloc(void *ptr_in, mp_uint_t n_bytes) {
+    mp_gc_large_t *large = gc_large_find((mp_uint_t)ptr_in);
+    if (large == NULL) {
+        return NULL;
+    }
+    if (n_bytes <= large->n_alloc) {
+        if (n_bytes < large->n_bytes) {
+            // clear the bytes given up, so they hold no stale pointers if
+            // the object grows again
+            memset((byte*)ptr_in + n_bytes, 0, large->n_bytes - n_bytes);
+        }
+        large->n_bytes = n_bytes;
+        return ptr_in;
+    }
 
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
+    // move it, leaving room to grow again without another copy
+    mp_uint_t n_copy = large->n_bytes;
+    int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
+    void *ptr_out = gc_large_alloc(n_bytes, n_bytes + n_bytes / 2, large->has_finaliser, &collected);
+    if (ptr_out == NULL) {
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats).n_alloc_fail += 1;
+        #endif
+        return NULL;
+    }
+    DEBUG_printf("gc_realloc(%p -> %p)\n", ptr_in, ptr_out);
+    memcpy(ptr_out, ptr_in, n_copy);
+    gc_large_free(gc_large_find((mp_uint_t)ptr_in));
+    return ptr_out;
+}
+#endif
 
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
+#if MICROPY_GC_OBJ_POOLS
+// free the objects on the pools, returning true if there were any
+STATIC bool gc_pool_release(void) {
+    bool released = false;
+    for (mp_uint_t p = 0; p < MP_OBJ_NUM_POOLS; p++) {
+        void *obj = MP_STATE_MEM(gc_pool_head)[p];
+        while (obj != NULL) {
+            void *next = (void*)(POOL_NEXT(obj) & ~(mp_uint_t)1);
+            gc_free(obj);
+            obj = next;
+            released = true;
+        }
+        MP_STATE_MEM(gc_pool_head)[p] = NULL;
+        MP_STATE_MEM(gc_pool_len)[p] = 0;
+    }
+    // don't refill the pools until the next collection
+    MP_STATE_MEM(gc_pool_room) = 0;
+    return released;
+}
 
-            case AT_MARK:
-                // shouldn't happen
-                break;
+void *gc_pool_alloc(unsigned int pool, const void *obj_type, mp_uint_t n_bytes) {
+    void *obj = MP_STATE_MEM(gc_pool_head)[pool];
+    if (obj == NULL
+        || MP_STATE_MEM(gc_lock_depth) > 0
+        #if MICROPY_GC_INCREMENTAL
+        // objects allocated during an incremental mark must be marked
+        || MP_STATE_MEM(gc_incr_marking)
+        #endif
+        ) {
+        if (MP_STATE_MEM(gc_pool_type)[pool] == NULL) {
+            // the first allocation sets the type and size kept by the pool
+            MP_STATE_MEM(gc_pool_type)[pool] = obj_type;
+            MP_STATE_MEM(gc_pool_n_blocks)[pool] = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
         }
+        MP_STATE_MEM(gc_pool_miss)[pool] += 1;
+        return NULL;
+    }
+    assert(obj_type == MP_STATE_MEM(gc_pool_type)[pool]);
+    MP_STATE_MEM(gc_pool_head)[pool] = (void*)(POOL_NEXT(obj) & ~(mp_uint_t)1);
+    MP_STATE_MEM(gc_pool_len)[pool] -= 1;
+    MP_STATE_MEM(gc_pool_room) += 1;
+    MP_STATE_MEM(gc_pool_hit)[pool] += 1;
+
+    mp_uint_t n_alloc = MP_STATE_MEM(gc_pool_n_blocks)[pool] * BYTES_PER_BLOCK;
+    #if MICROPY_GC_GENERATIONAL || MICROPY_GC_HEAP_PROFILE
+    mp_state_mem_area_t *area = gc_get_ptr_area((mp_uint_t)obj);
+    mp_uint_t block = BLOCK_FROM_PTR(area, (mp_uint_t)obj);
+    #endif
+    #if MICROPY_GC_GENERATIONAL
+    YTB_SET(area, block);
+    #endif
+    #if MICROPY_GC_HEAP_PROFILE
+    {
+        byte site = gc_profile_get_site();
+        PTB_SET(area, block, site);
+        MP_STATE_MEM(gc_profile_site)[site].n_alloc += 1;
     }
+    #endif
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) += n_alloc;
+    #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).alloc_bytes += n_alloc;
+    #endif
 
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
+    // the caller sets the object's fields, as for a fresh allocation
+    memset((byte*)obj + n_bytes, 0, n_alloc - n_bytes);
+    return obj;
 }
+#endif
 
-void *gc_alloc(mp_uint_t n_bytes, bool has_finaliser) {
+// allow_top is false for chains being moved by gc_realloc: a growing chain
+// placed at the top of the heap could never be extended in place
+STATIC void *gc_alloc_internal(mp_uint_t n_bytes, bool has_finaliser, bool allow_top) {
+    #if !MICROPY_GC_TOP_ALLOC_THRESHOLD
+    (void)allow_top;
+    #endif
     mp_uint_t n_blocks = ((n_bytes + BYTES_PER_BLOCK - 1) & (~(BYTES_PER_BLOCK - 1))) / BYTES_PER_BLOCK;
     DEBUG_printf("gc_alloc(" UINT_FMT " bytes -> " UINT_FMT " blocks)\n", n_bytes, n_blocks);
 
@@ -353,28 +2107,183 @@ void *gc_alloc(mp_uint_t n_bytes, bool has_finaliser) {
         return NULL;
     }
 
+    #if MICROPY_GC_LAZY_SWEEP
+    gc_sweep_lazy(MICROPY_GC_LAZY_SWEEP_STEP);
+    #endif
+
     mp_uint_t i;
     mp_uint_t end_block;
     mp_uint_t start_block;
-    mp_uint_t n_free = 0;
+    mp_uint_t n_free;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
-    for (;;) {
+    #if MICROPY_GC_GENERATIONAL
+    int collected_young = collected;
+    #endif
+
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    if (!collected && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
+        // collect while the heap still has room, rather than when it is full
+        DEBUG_printf("gc_alloc(" UINT_FMT "): threshold reached, triggering GC\n", n_bytes);
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats).n_collect_alloc += 1;
+        #endif
+        #if MICROPY_GC_GENERATIONAL
+        // a minor collection is enough; a full one is still done on failure
+        gc_collect_young();
+        collected_young = 1;
+        #else
+        #if MICROPY_GC_LAZY_SWEEP
+        MP_STATE_MEM(gc_sweep_lazy) = 1;
+        gc_collect();
+        MP_STATE_MEM(gc_sweep_lazy) = 0;
+        #else
+        gc_collect();
+        #endif
+        collected = 1;
+        #endif
+    }
+    #endif
 
-        // look for a run of n_blocks available blocks
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    if (n_bytes >= MICROPY_GC_LARGE_ALLOC_THRESHOLD) {
+        void *ptr = gc_large_alloc(n_bytes, n_bytes, has_finaliser, &collected);
+        if (ptr != NULL) {
+            return ptr;
         }
+        // the port has no memory for it, so try the heap's own blocks
+    }
+    #endif
+
+    // Areas are searched in order, starting with the main one.  With a split
+    // heap, large allocations start at the first added region instead, so
+    // that big buffers don't fragment the main area used by small objects.
+    mp_state_mem_area_t *first_area = &MP_STATE_MEM(area);
+    #if MICROPY_GC_SPLIT_HEAP
+    if (n_bytes >= MICROPY_GC_SPLIT_HEAP_LARGE_ALLOC && first_area->next != NULL) {
+        first_area = first_area->next;
+    }
+    #endif
+    mp_state_mem_area_t *area;
+
+    for (;;) {
+        area = first_area;
+        do {
+            #if MICROPY_GC_FREE_LISTS
+            // fast path for small allocations
+            if (n_blocks <= GC_SIZE_CLASS_MAX_BLOCKS) {
+                start_block = gc_free_list_take(area, n_blocks);
+                if (start_block != (mp_uint_t)-1) {
+                    end_block = start_block + n_blocks - 1;
+                    goto found_run;
+                }
+            }
+            #endif
+
+            // look for a run of n_blocks available blocks
+            n_free = 0;
+            #if MICROPY_GC_TOP_ALLOC_THRESHOLD
+            if (allow_top && n_bytes >= MICROPY_GC_TOP_ALLOC_THRESHOLD && n_blocks > 1) {
+                // large allocation, search down from the top of the area
+                for (i = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; i-- > 0;) {
+                    if (ATB_GET_KIND(area, i) == AT_FREE) {
+                        if (++n_free >= n_blocks) {
+                            // found, starting at block i; the run ends at block i + n_free - 1
+                            i += n_free - 1;
+                            goto found;
+                        }
+                    } else {
+                        n_free = 0;
+                    }
+                }
+                goto next_area;
+            }
+            #endif
+            // A multi-block allocation doesn't move gc_last_free_atb_index,
+            // so it first looks after where the last one ended (next fit),
+            // rather than walking again over all the blocks allocated since
+            // the last collection.  The whole area is tried if that fails.
+            mp_uint_t scan_start = area->gc_last_free_atb_index;
+            if (n_blocks > 1 && area->gc_last_multi_atb_index > scan_start) {
+                scan_start = area->gc_last_multi_atb_index;
+            }
+            for (;;) {
+                for (i = scan_start; i < area->gc_alloc_table_byte_len; i++) {
+                    byte a = area->gc_alloc_table_start[i];
+                    if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                    if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                    if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                    if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+                }
+                if (scan_start == area->gc_last_free_atb_index) {
+                    break;
+                }
+                scan_start = area->gc_last_free_atb_index;
+                n_free = 0;
+            }
+            if (n_blocks == 1) {
+                // The area has no free block after gc_last_free_atb_index,
+                // so skip it until a block is freed.  Otherwise a full area
+                // would be scanned again by each allocation that goes on to
+                // a later one.
+                area->gc_last_free_atb_index = area->gc_alloc_table_byte_len;
+            }
+
+            // try the next area, wrapping around to the main one
+            #if MICROPY_GC_TOP_ALLOC_THRESHOLD
+        next_area:
+            #endif
+            area = NEXT_AREA(area);
+            if (area == NULL) {
+                area = &MP_STATE_MEM(area);
+            }
+        } while (area != first_area);
 
         // nothing found!
+        #if MICROPY_GC_LAZY_SWEEP
+        if (MP_STATE_MEM(gc_sweep_pending)) {
+            // reclaim the rest of the garbage found by the last collection
+            gc_sweep_finish();
+            continue;
+        }
+        #endif
         if (collected) {
+            #if MICROPY_GC_AUTO_GROW
+            // the new region is searched when the loop wraps around to it
+            if (gc_grow_heap(n_bytes)) {
+                DEBUG_printf("gc_alloc(" UINT_FMT "): heap grown\n", n_bytes);
+                continue;
+            }
+            #endif
+            #if MICROPY_GC_STATS
+            MP_STATE_MEM(gc_stats).n_alloc_fail += 1;
+            #endif
             return NULL;
         }
+        #if MICROPY_GC_OBJ_POOLS
+        if (gc_pool_release()) {
+            continue;
+        }
+        #endif
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats).n_collect_alloc += 1;
+        #endif
+        #if MICROPY_GC_GENERATIONAL
+        // try a cheap minor collection first, then fall back to a full one
+        if (!collected_young) {
+            DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering minor GC\n", n_bytes);
+            gc_collect_young();
+            collected_young = 1;
+            continue;
+        }
+        #endif
         DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering GC\n", n_bytes);
+        #if MICROPY_GC_LAZY_SWEEP
+        MP_STATE_MEM(gc_sweep_lazy) = 1;
+        gc_collect();
+        MP_STATE_MEM(gc_sweep_lazy) = 0;
+        #else
         gc_collect();
+        #endif
         collected = 1;
     }
 
@@ -390,20 +2299,57 @@ found:
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
+    } else {
+        area->gc_last_multi_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
 
+#if MICROPY_GC_FREE_LISTS
+found_run:
+#endif
+
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
+    #if MICROPY_GC_GENERATIONAL
+    YTB_SET(area, start_block);
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incr_marking)) {
+        // allocate marked during an incremental mark; contents are scanned
+        // when the cycle is finished
+        ATB_HEAD_TO_MARK(area, start_block);
+    }
+    #endif
+    #if MICROPY_GC_LAZY_SWEEP
+    if (start_block >= area->gc_sweep_block) {
+        // in the part still to be swept, where unmarked heads are garbage
+        ATB_HEAD_TO_MARK(area, start_block);
+    }
+    #endif
+
+    #if MICROPY_GC_HEAP_PROFILE
+    {
+        byte site = gc_profile_get_site();
+        PTB_SET(area, start_block, site);
+        MP_STATE_MEM(gc_profile_site)[site].n_alloc += 1;
+    }
+    #endif
+
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) += (end_block - start_block + 1) * BYTES_PER_BLOCK;
+    #endif
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats).alloc_bytes += (end_block - start_block + 1) * BYTES_PER_BLOCK;
+    #endif
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (mp_uint_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
     }
 
     // get pointer to first block
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * WORDS_PER_BLOCK);
+    void *ret_ptr = (void*)(area->gc_pool_start + start_block * WORDS_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
     // zero out the additional bytes of the newly allocated blocks
@@ -418,7 +2364,7 @@ found:
         // clear type pointer in case it is never set
         ((mp_obj_base_t*)ret_ptr)->type = MP_OBJ_NULL;
         // set mp_obj flag only if it has a finaliser
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
     }
 #endif
 
@@ -429,6 +2375,10 @@ found:
     return ret_ptr;
 }
 
+void *gc_alloc(mp_uint_t n_bytes, bool has_finaliser) {
+    return gc_alloc_internal(n_bytes, has_finaliser, true);
+}
+
 /*
 void *gc_alloc(mp_uint_t n_bytes) {
     return _gc_alloc(n_bytes, false);
@@ -449,19 +2399,27 @@ void gc_free(void *ptr_in) {
     mp_uint_t ptr = (mp_uint_t)ptr_in;
     DEBUG_printf("gc_free(%p)\n", ptr);
 
-    if (VERIFY_PTR(ptr)) {
-        mp_uint_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        mp_uint_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_IS_HEAD(area, block)) {
             // set the last_free pointer to this block if it's earlier in the heap
-            if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-                MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+            if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+                area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
             }
 
             // free head and all of its tail blocks
-            do {
-                ATB_ANY_TO_FREE(block);
-                block += 1;
-            } while (ATB_GET_KIND(block) == AT_TAIL);
+            mp_uint_t n_blocks = gc_chain_len(area, block);
+            for (mp_uint_t i = 0; i < n_blocks; i++) {
+                ATB_ANY_TO_FREE(area, block + i);
+            }
+
+            #if MICROPY_GC_FREE_LISTS
+            // make the freed run available straight away for small allocations
+            if (n_blocks <= GC_SIZE_CLASS_MAX_BLOCKS) {
+                gc_free_list_add_run(area, block, n_blocks);
+            }
+            #endif
 
             #if EXTENSIVE_HEAP_PROFILING
             gc_dump_alloc_table();
@@ -469,26 +2427,38 @@ void gc_free(void *ptr_in) {
         } else {
             assert(!"bad free");
         }
-    } else if (ptr_in != NULL) {
-        assert(!"bad free");
+    } else {
+        #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+        mp_gc_large_t *large = gc_large_find(ptr);
+        if (large != NULL) {
+            gc_large_free(large);
+            return;
+        }
+        #endif
+        // anything else is outside the heap, eg a const object in ROM that
+        // was made by tools/mpy-tool.py, and is left alone
     }
 }
 
 mp_uint_t gc_nbytes(const void *ptr_in) {
     mp_uint_t ptr = (mp_uint_t)ptr_in;
 
-    if (VERIFY_PTR(ptr)) {
-        mp_uint_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        mp_uint_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_IS_HEAD(area, block)) {
             // work out number of consecutive blocks in the chain starting with this on
-            mp_uint_t n_blocks = 0;
-            do {
-                n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
-            return n_blocks * BYTES_PER_BLOCK;
+            return gc_chain_len(area, block) * BYTES_PER_BLOCK;
         }
     }
 
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    mp_gc_large_t *large = gc_large_find(ptr);
+    if (large != NULL) {
+        return large->n_bytes;
+    }
+    #endif
+
     // invalid pointer
     return 0;
 }
@@ -505,7 +2475,8 @@ void *gc_realloc(void *ptr, mp_uint_t n_bytes) {
             has_finaliser = false;
         } else {
 #if MICROPY_ENABLE_FINALISER
-            has_finaliser = FTB_GET(BLOCK_FROM_PTR((mp_uint_t)ptr));
+            mp_state_mem_area_t *area = gc_get_ptr_area((mp_uint_t)ptr);
+            has_finaliser = FTB_GET(area, BLOCK_FROM_PTR(area, (mp_uint_t)ptr));
 #else
             has_finaliser = false;
 #endif
@@ -541,15 +2512,20 @@ void *gc_realloc(void *ptr_in, mp_uint_t n_bytes) {
     mp_uint_t ptr = (mp_uint_t)ptr_in;
 
     // sanity check the ptr
-    if (!VERIFY_PTR(ptr)) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area == NULL) {
+        #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+        return gc_large_realloc(ptr_in, n_bytes);
+        #else
         return NULL;
+        #endif
     }
 
     // get first block
-    mp_uint_t block = BLOCK_FROM_PTR(ptr);
+    mp_uint_t block = BLOCK_FROM_PTR(area, ptr);
 
     // sanity check the ptr is pointing to the head of a block
-    if (ATB_GET_KIND(block) != AT_HEAD) {
+    if (!ATB_IS_HEAD(area, block)) {
         return NULL;
     }
 
@@ -564,9 +2540,9 @@ void *gc_realloc(void *ptr_in, mp_uint_t n_bytes) {
     // efficiently shrink it (see below for shrinking code).
     mp_uint_t n_free   = 0;
     mp_uint_t n_blocks = 1; // counting HEAD block
-    mp_uint_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    mp_uint_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
     for (mp_uint_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -591,12 +2567,12 @@ void *gc_realloc(void *ptr_in, mp_uint_t n_bytes) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (mp_uint_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
 
         #if EXTENSIVE_HEAP_PROFILING
@@ -610,8 +2586,8 @@ void *gc_realloc(void *ptr_in, mp_uint_t n_bytes) {
     if (new_blocks <= n_blocks + n_free) {
         // mark few more blocks as used tail
         for (mp_uint_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
         }
 
         // zero out the additional bytes of the newly allocated blocks (see comment above in gc_alloc)
@@ -625,13 +2601,13 @@ void *gc_realloc(void *ptr_in, mp_uint_t n_bytes) {
     }
 
     // can't resize inplace; try to find a new contiguous chain
-    void *ptr_out = gc_alloc(n_bytes,
+    void *ptr_out = gc_alloc_internal(n_bytes,
 #if MICROPY_ENABLE_FINALISER
-        FTB_GET(block)
+        FTB_GET(area, block),
 #else
-        false
+        false,
 #endif
-    );
+        false);
 
     // check that the alloc succeeded
     if (ptr_out == NULL) {
@@ -656,106 +2632,108 @@ void gc_dump_info(void) {
 
 void gc_dump_alloc_table(void) {
     static const mp_uint_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (mp_uint_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                mp_uint_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (" UINT_FMT " lines all free)", (bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            #if EXTENSIVE_HEAP_PROFILING
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-            #else
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            #endif
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (mp_uint_t bl = 0; bl < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    mp_uint_t bl2 = bl;
+                    while (bl2 < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_VM(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (" UINT_FMT " lines all free)", (bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                            // got to end of heap
                             break;
                         }
                     }
                 }
-                break;
-            }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                mp_uint_t *ptr = MP_STATE_MEM(gc_pool_start) + bl * WORDS_PER_BLOCK;
-                if (*ptr == (mp_uint_t)&mp_type_tuple) { c = 'T'; }
-                else if (*ptr == (mp_uint_t)&mp_type_list) { c = 'L'; }
-                else if (*ptr == (mp_uint_t)&mp_type_dict) { c = 'D'; }
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == (mp_uint_t)&mp_type_float) { c = 'F'; }
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                #if EXTENSIVE_HEAP_PROFILING
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
+                #else
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(area, bl) & (uint32_t)0xfffff));
                 #endif
-                else if (*ptr == (mp_uint_t)&mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == (mp_uint_t)&mp_type_module) { c = 'M'; }
-                else {
+            }
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&MP_STATE_CTX_PTR->vm;
+                    mp_uint_t len = offsetof(mp_state_vm_t, mp_optimise_value) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    mp_uint_t *ptr = area->gc_pool_start + bl * WORDS_PER_BLOCK;
+                    if (*ptr == (mp_uint_t)&mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == (mp_uint_t)&mp_type_list) { c = 'L'; }
+                    else if (*ptr == (mp_uint_t)&mp_type_dict) { c = 'D'; }
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == (mp_uint_t)&mp_type_float) { c = 'F'; }
                     #endif
+                    else if (*ptr == (mp_uint_t)&mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == (mp_uint_t)&mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = 't'; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = 't'; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
+        mp_print_str(&mp_plat_print, "\n");
     }
-    mp_print_str(&mp_plat_print, "\n");
 }
 
 #if DEBUG_PRINT
@@ -33,6 +33,28 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// add another region of memory to the heap; the region's tables are stored in it
+void gc_add_region(void *start, void *end);
+#endif
+
+#if MICROPY_GC_AUTO_GROW
+// provided by the port: add a region that can hold an allocation of n_bytes,
+// returning false if the heap can't grow any further
+bool gc_grow_heap(mp_uint_t n_bytes);
+// provided by the port: the memory from start to end is free and won't be
+// read before it is next allocated, so its pages may be released
+void gc_decommit(void *start, void *end);
+#endif
+
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// provided by the port: return zeroed, word aligned memory of n_bytes for a
+// large object (or the table of them), or NULL if there is none
+void *gc_large_alloc_pages(mp_uint_t n_bytes);
+// provided by the port: give back memory from gc_large_alloc_pages
+void gc_large_free_pages(void *ptr, mp_uint_t n_bytes);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -43,8 +65,57 @@ bool gc_is_locked(void);
 void gc_collect(void);
 void gc_collect_start(void);
 void gc_collect_root(void **ptrs, mp_uint_t len);
+struct _mp_state_thread_t;
+void gc_collect_thread_state(struct _mp_state_thread_t *state);
 void gc_collect_end(void);
 
+#if MICROPY_GC_OBJ_POOLS
+// Take an object from the given pool, which holds dead objects of obj_type
+// that are n_bytes long, or return NULL if it's empty
+void *gc_pool_alloc(unsigned int pool, const void *obj_type, mp_uint_t n_bytes);
+#endif
+
+#if MICROPY_GC_DEFERRED_FINALISERS
+// Run the finalisers queued by the collections so far.  Called by the
+// scheduler after a collection, and by gc.collect() before it returns.
+void gc_finalise_pending(void);
+#endif
+
+#if MICROPY_PY_UWEAKREF
+// A weak reference is a heap object whose word after its base holds its
+// target as GC_WEAK_HIDE(target), which the GC doesn't follow.  Once it is
+// registered, a collection that finds the target unreachable sets that word
+// to 0 and, if the weak reference has a finaliser, queues it to be
+// finalised.  A weak reference that is itself unreachable is dropped
+// without being finalised.
+#define GC_WEAK_HIDE(ptr) ((mp_uint_t)(ptr) | 1)
+#define GC_WEAK_REVEAL(word) ((void*)((word) & ~(mp_uint_t)1))
+void gc_weak_register(void *ref);
+#endif
+
+#if MICROPY_GC_GENERATIONAL
+// Run a minor collection, only reclaiming blocks allocated since the last
+// collection (falls back to a full collection every so often).
+void gc_collect_young(void);
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// Do a bounded amount of incremental marking, scanning roughly up to budget
+// heap blocks.  Returns true if the call finished a complete collection.
+bool gc_collect_step(mp_uint_t budget);
+#endif
+
+#if MICROPY_GC_PARALLEL
+// Provided by the port: return the number of threads, including the calling
+// one, that gc_run_workers can use.  Collections are only done in parallel if
+// this is more than 1.
+mp_uint_t gc_num_workers(void);
+// Provided by the port: call fun(arg) on the calling thread and at the same
+// time on up to MICROPY_GC_PARALLEL_WORKERS - 1 other threads, returning once
+// all the calls have returned.
+void gc_run_workers(void (*fun)(void *arg), void *arg);
+#endif
+
 void *gc_alloc(mp_uint_t n_bytes, bool has_finaliser);
 void gc_free(void *ptr);
 mp_uint_t gc_nbytes(const void *ptr);
@@ -57,9 +128,19 @@ typedef struct _gc_info_t {
     mp_uint_t num_1block;
     mp_uint_t num_2block;
     mp_uint_t max_block;
+    #if MICROPY_GC_FREE_LISTS
+    mp_uint_t num_free_list_hit;
+    mp_uint_t num_free_list_miss;
+    #endif
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
+
+#if MICROPY_GC_HEAP_PROFILE
+// fill in the number of live chains and their size in bytes for each of the
+// MICROPY_GC_HEAP_PROFILE_SITES allocation sites
+void gc_heap_profile(mp_uint_t *n_live, mp_uint_t *n_live_bytes);
+#endif
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
@@ -122,6 +122,19 @@ STATIC bool is_tail_of_identifier(mp_lexer_t *lex) {
     return is_head_of_identifier(lex) || is_digit(lex);
 }
 
+STATIC unichar next_byte(mp_lexer_t *lex) {
+    if (lex->buf_cur >= lex->buf_end) {
+        mp_uint_t len;
+        const byte *buf = lex->stream_read(lex->stream_data, &len);
+        if (len == 0) {
+            return MP_LEXER_EOF;
+        }
+        lex->buf_cur = buf;
+        lex->buf_end = buf + len;
+    }
+    return *lex->buf_cur++;
+}
+
 STATIC void next_char(mp_lexer_t *lex) {
     if (lex->chr0 == MP_LEXER_EOF) {
         return;
@@ -141,7 +154,7 @@ STATIC void next_char(mp_lexer_t *lex) {
 
     lex->chr0 = lex->chr1;
     lex->chr1 = lex->chr2;
-    lex->chr2 = lex->stream_next_byte(lex->stream_data);
+    lex->chr2 = next_byte(lex);
 
     if (lex->chr0 == '\r') {
         // CR is a new line, converted to LF
@@ -149,7 +162,7 @@ STATIC void next_char(mp_lexer_t *lex) {
         if (lex->chr1 == '\n') {
             // CR LF is a single new line
             lex->chr1 = lex->chr2;
-            lex->chr2 = lex->stream_next_byte(lex->stream_data);
+            lex->chr2 = next_byte(lex);
         }
     }
 
@@ -163,6 +176,82 @@ STATIC void next_char(mp_lexer_t *lex) {
     }
 }
 
+// Runs of simple characters (ones that aren't a newline or tab, so next_char
+// would only advance the column) are taken straight from the stream's block.
+// The run is the 3 cached characters followed by the first n bytes of the
+// block; n of them are added to the token text and the cache is refilled with
+// the following 3, which are still part of the run.
+STATIC void take_run(mp_lexer_t *lex, mp_uint_t n) {
+    const byte *end = lex->buf_cur + n;
+    if (n < 3) {
+        unichar cache[3] = {lex->chr0, lex->chr1, lex->chr2};
+        for (mp_uint_t i = 0; i < n; i++) {
+            vstr_add_byte(&lex->vstr, cache[i]);
+        }
+        lex->chr0 = n == 1 ? cache[1] : cache[2];
+        lex->chr1 = n == 1 ? cache[2] : end[-2];
+    } else {
+        vstr_add_byte(&lex->vstr, lex->chr0);
+        vstr_add_byte(&lex->vstr, lex->chr1);
+        vstr_add_byte(&lex->vstr, lex->chr2);
+        vstr_add_strn(&lex->vstr, (const char*)lex->buf_cur, n - 3);
+        lex->chr0 = end[-3];
+        lex->chr1 = end[-2];
+    }
+    lex->chr2 = end[-1];
+    lex->buf_cur = end;
+    lex->column += n;
+}
+
+STATIC bool is_ident_byte(unichar c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// returns the length of the run of identifier characters at the current position
+STATIC mp_uint_t ident_run_len(mp_lexer_t *lex) {
+    if (!is_ident_byte(lex->chr0) || !is_ident_byte(lex->chr1) || !is_ident_byte(lex->chr2)) {
+        return 0;
+    }
+    const byte *p = lex->buf_cur;
+    while (p < lex->buf_end && is_ident_byte(*p)) {
+        ++p;
+    }
+    return p - lex->buf_cur;
+}
+
+STATIC bool is_digit_byte(unichar c) {
+    return c >= '0' && c <= '9';
+}
+
+// returns the length of the run of decimal digits at the current position
+STATIC mp_uint_t digit_run_len(mp_lexer_t *lex) {
+    if (!is_digit_byte(lex->chr0) || !is_digit_byte(lex->chr1) || !is_digit_byte(lex->chr2)) {
+        return 0;
+    }
+    const byte *p = lex->buf_cur;
+    while (p < lex->buf_end && is_digit_byte(*p)) {
+        ++p;
+    }
+    return p - lex->buf_cur;
+}
+
+STATIC bool is_str_byte(unichar c, char quote_char) {
+    return c != (byte)quote_char && c != '\\' && c != '\n' && c != '\r' && c != '\t' && c != MP_LEXER_EOF;
+}
+
+// returns the length of the run of string characters at the current position
+// that have no special meaning, ie aren't a quote, escape or newline
+STATIC mp_uint_t str_run_len(mp_lexer_t *lex, char quote_char) {
+    if (!is_str_byte(lex->chr0, quote_char) || !is_str_byte(lex->chr1, quote_char) || !is_str_byte(lex->chr2, quote_char)) {
+        return 0;
+    }
+    const byte *p = lex->buf_cur;
+    while (p < lex->buf_end && is_str_byte(*p, quote_char)) {
+        ++p;
+    }
+    return p - lex->buf_cur;
+}
+
 STATIC void indent_push(mp_lexer_t *lex, mp_uint_t indent) {
     if (lex->num_indent_level >= lex->alloc_indent_level) {
         // TODO use m_renew_maybe and somehow indicate an error if it fails... probably by using MP_TOKEN_MEMORY_ERROR
@@ -428,6 +517,12 @@ STATIC void mp_lexer_next_token_into(mp_lexer_t *lex, bool first_token) {
         // parse the literal
         mp_uint_t n_closing = 0;
         while (!is_end(lex) && (num_quotes > 1 || !is_char(lex, '\n')) && n_closing < num_quotes) {
+            mp_uint_t n = str_run_len(lex, quote_char);
+            if (n > 0) {
+                n_closing = 0;
+                take_run(lex, n);
+                continue;
+            }
             if (is_char(lex, quote_char)) {
                 n_closing += 1;
                 vstr_add_char(&lex->vstr, CUR_CHAR(lex));
@@ -539,8 +634,13 @@ STATIC void mp_lexer_next_token_into(mp_lexer_t *lex, bool first_token) {
 
         // get tail chars
         while (!is_end(lex) && is_tail_of_identifier(lex)) {
-            vstr_add_char(&lex->vstr, CUR_CHAR(lex));
-            next_char(lex);
+            mp_uint_t n = ident_run_len(lex);
+            if (n > 0) {
+                take_run(lex, n);
+            } else {
+                vstr_add_char(&lex->vstr, CUR_CHAR(lex));
+                next_char(lex);
+            }
         }
 
     } else if (is_digit(lex) || (is_char(lex, '.') && is_following_digit(lex))) {
@@ -560,7 +660,10 @@ STATIC void mp_lexer_next_token_into(mp_lexer_t *lex, bool first_token) {
 
         // get tail chars
         while (!is_end(lex)) {
-            if (!forced_integer && is_char_or(lex, 'e', 'E')) {
+            mp_uint_t n = digit_run_len(lex);
+            if (n > 0) {
+                take_run(lex, n);
+            } else if (!forced_integer && is_char_or(lex, 'e', 'E')) {
                 lex->tok_kind = MP_TOKEN_FLOAT_OR_IMAG;
                 vstr_add_char(&lex->vstr, 'e');
                 next_char(lex);
@@ -696,7 +799,7 @@ STATIC void mp_lexer_next_token_into(mp_lexer_t *lex, bool first_token) {
     }
 }
 
-mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_next_byte_t stream_next_byte, mp_lexer_stream_close_t stream_close) {
+mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_read_t stream_read, mp_lexer_stream_close_t stream_close) {
     mp_lexer_t *lex = m_new_obj_maybe(mp_lexer_t);
 
     // check for memory allocation error
@@ -709,8 +812,10 @@ mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_next_
 
     lex->source_name = src_name;
     lex->stream_data = stream_data;
-    lex->stream_next_byte = stream_next_byte;
+    lex->stream_read = stream_read;
     lex->stream_close = stream_close;
+    lex->buf_cur = NULL;
+    lex->buf_end = NULL;
     lex->line = 1;
     lex->column = 1;
     lex->emit_dent = 0;
@@ -730,9 +835,9 @@ mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_next_
     lex->indent_level[0] = 0;
 
     // preload characters
-    lex->chr0 = stream_next_byte(stream_data);
-    lex->chr1 = stream_next_byte(stream_data);
-    lex->chr2 = stream_next_byte(stream_data);
+    lex->chr0 = next_byte(lex);
+    lex->chr1 = next_byte(lex);
+    lex->chr2 = next_byte(lex);
 
     // if input stream is 0, 1 or 2 characters long and doesn't end in a newline, then insert a newline at the end
     if (lex->chr0 == MP_LEXER_EOF) {
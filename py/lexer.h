@@ -138,12 +138,13 @@ typedef enum _mp_token_kind_t {
     MP_TOKEN_DEL_MINUS_MORE,
 } mp_token_kind_t;
 
-// the next-byte function must return the next byte in the stream
-// it must return MP_LEXER_EOF if end of stream
-// it can be called again after returning MP_LEXER_EOF, and in that case must return MP_LEXER_EOF
+// the read function must return a pointer to the next block of bytes in the
+// stream and store its length in *len; the block only needs to stay valid until
+// the read function is called again
+// at the end of the stream it must set *len to 0, and keep doing so if called again
 #define MP_LEXER_EOF ((unichar)(-1))
 
-typedef mp_uint_t (*mp_lexer_stream_next_byte_t)(void*);
+typedef const byte *(*mp_lexer_stream_read_t)(void*, mp_uint_t *len);
 typedef void (*mp_lexer_stream_close_t)(void*);
 
 // this data structure is exposed for efficiency
@@ -151,8 +152,11 @@ typedef void (*mp_lexer_stream_close_t)(void*);
 typedef struct _mp_lexer_t {
     qstr source_name;           // name of source
     void *stream_data;          // data for stream
-    mp_lexer_stream_next_byte_t stream_next_byte;   // stream callback to get next byte
-    mp_lexer_stream_close_t stream_close;           // stream callback to free
+    mp_lexer_stream_read_t stream_read;     // stream callback to get next block
+    mp_lexer_stream_close_t stream_close;   // stream callback to free
+
+    const byte *buf_cur;        // next byte to read from the current block
+    const byte *buf_end;        // end (exclusive) of the current block
 
     unichar chr0, chr1, chr2;   // current cached characters from source
 
@@ -172,7 +176,7 @@ typedef struct _mp_lexer_t {
     vstr_t vstr;                // token data
 } mp_lexer_t;
 
-mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_next_byte_t stream_next_byte, mp_lexer_stream_close_t stream_close);
+mp_lexer_t *mp_lexer_new(qstr src_name, void *stream_data, mp_lexer_stream_read_t stream_read, mp_lexer_stream_close_t stream_close);
 mp_lexer_t *mp_lexer_new_from_str_len(qstr src_name, const char *str, mp_uint_t len, mp_uint_t free_len);
 
 void mp_lexer_free(mp_lexer_t *lex);
@@ -192,6 +196,15 @@ typedef enum {
 } mp_import_stat_t;
 
 mp_import_stat_t mp_import_stat(const char *path);
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+// List the directory at path (the current directory if path is empty) by
+// calling mp_import_listdir_add for each entry, passing env through.  A
+// directory that doesn't exist has no entries.  Returns false if the
+// directory can't be listed, in which case mp_import_stat is used instead.
+bool mp_import_listdir(const char *path, void *env);
+void mp_import_listdir_add(void *env, const char *name, mp_import_stat_t stat);
+#endif
 mp_lexer_t *mp_lexer_new_from_file(const char *filename);
 
 #endif // __MICROPY_INCLUDED_PY_LEXER_H__
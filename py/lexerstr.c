@@ -33,12 +33,12 @@ typedef struct _mp_lexer_str_buf_t {
     const char *src_end;        // end (exclusive) of source
 } mp_lexer_str_buf_t;
 
-STATIC mp_uint_t str_buf_next_byte(mp_lexer_str_buf_t *sb) {
-    if (sb->src_cur < sb->src_end) {
-        return *sb->src_cur++;
-    } else {
-        return MP_LEXER_EOF;
-    }
+STATIC const byte *str_buf_read(mp_lexer_str_buf_t *sb, mp_uint_t *len) {
+    // the whole string is given to the lexer as a single block
+    const char *buf = sb->src_cur;
+    *len = sb->src_end - buf;
+    sb->src_cur = sb->src_end;
+    return (const byte*)buf;
 }
 
 STATIC void str_buf_free(mp_lexer_str_buf_t *sb) {
@@ -57,5 +57,5 @@ mp_lexer_t *mp_lexer_new_from_str_len(qstr src_name, const char *str, mp_uint_t
     sb->src_beg = str;
     sb->src_cur = str;
     sb->src_end = str + len;
-    return mp_lexer_new(src_name, sb, (mp_lexer_stream_next_byte_t)str_buf_next_byte, (mp_lexer_stream_close_t)str_buf_free);
+    return mp_lexer_new(src_name, sb, (mp_lexer_stream_read_t)str_buf_read, (mp_lexer_stream_close_t)str_buf_free);
 }
@@ -39,26 +39,21 @@
 
 typedef struct _mp_lexer_file_buf_t {
     int fd;
-    byte buf[20];
-    mp_uint_t len;
-    mp_uint_t pos;
+    bool eof;
+    byte buf[512];
 } mp_lexer_file_buf_t;
 
-STATIC mp_uint_t file_buf_next_byte(mp_lexer_file_buf_t *fb) {
-    if (fb->pos >= fb->len) {
-        if (fb->len == 0) {
-            return MP_LEXER_EOF;
+STATIC const byte *file_buf_read(mp_lexer_file_buf_t *fb, mp_uint_t *len) {
+    *len = 0;
+    if (!fb->eof) {
+        int n = read(fb->fd, fb->buf, sizeof(fb->buf));
+        if (n <= 0) {
+            fb->eof = true;
         } else {
-            int n = read(fb->fd, fb->buf, sizeof(fb->buf));
-            if (n <= 0) {
-                fb->len = 0;
-                return MP_LEXER_EOF;
-            }
-            fb->len = n;
-            fb->pos = 0;
+            *len = n;
         }
     }
-    return fb->buf[fb->pos++];
+    return fb->buf;
 }
 
 STATIC void file_buf_close(mp_lexer_file_buf_t *fb) {
@@ -76,10 +71,8 @@ mp_lexer_t *mp_lexer_new_from_file(const char *filename) {
         m_del_obj(mp_lexer_file_buf_t, fb);
         return NULL;
     }
-    int n = read(fb->fd, fb->buf, sizeof(fb->buf));
-    fb->len = n;
-    fb->pos = 0;
-    return mp_lexer_new(qstr_from_str(filename), fb, (mp_lexer_stream_next_byte_t)file_buf_next_byte, (mp_lexer_stream_close_t)file_buf_close);
+    fb->eof = false;
+    return mp_lexer_new(qstr_from_str(filename), fb, (mp_lexer_stream_read_t)file_buf_read, (mp_lexer_stream_close_t)file_buf_close);
 }
 
 #endif // MICROPY_HELPER_LEXER_UNIX
@@ -31,13 +31,48 @@ codepoint2name[ord('*')] = 'star'
 codepoint2name[ord('!')] = 'bang'
 codepoint2name[ord('\\')] = 'backslash'
 
+# values of MICROPY_QSTR_HASH
+HASH_DJB2 = 0
+HASH_FNV1A_WORD = 1
+
 # this must match the equivalent function in qstr.c
-def compute_hash(qstr):
-    hash = 5381
-    for char in qstr:
-        hash = (hash * 33) ^ ord(char)
+def compute_hash(qstr, bytes_hash, hash_fn=HASH_DJB2):
+    if hash_fn == HASH_FNV1A_WORD:
+        data = [ord(char) & 0xff for char in qstr]
+        n_words = len(data) // 4 * 4
+        hash = 2166136261
+        for i in range(0, n_words, 4):
+            hash ^= data[i] | data[i + 1] << 8 | data[i + 2] << 16 | data[i + 3] << 24
+            hash = (hash * 16777619) & 0xffffffff
+        for b in data[n_words:]:
+            hash = ((hash ^ b) * 16777619) & 0xffffffff
+        hash ^= hash >> 16
+        hash = (hash * 0x85ebca6b) & 0xffffffff
+        hash ^= hash >> 13
+        hash = (hash * 0xc2b2ae35) & 0xffffffff
+        hash ^= hash >> 16
+    else:
+        hash = 5381
+        for char in qstr:
+            hash = (hash * 33) ^ ord(char)
     # Make sure that valid hash is never zero, zero means "hash not computed"
-    return (hash & 0xffff) or 1
+    return (hash & ((1 << (8 * bytes_hash)) - 1)) or 1
+
+# the first entry for hash in a qstr index of the given (power of 2) length;
+# this must match the equivalent macro in qstr.c
+def index_start(hash, bytes_hash, index_len):
+    spread = max(1, index_len >> (8 * bytes_hash))
+    return (hash * spread) & (index_len - 1)
+
+# the identifier used for the qstr in the MP_QSTR_xxx enum
+def qstr_escape(qstr):
+    return re.sub(r'[^A-Za-z0-9_]', lambda s: "_" + codepoint2name[ord(s.group(0))] + "_", qstr)
+
+# qstrs may contain C escape sequences (eg \n or \ooo octal), so decode them
+# to get the actual length and hash of the string
+def qstr_unescape(qstr):
+    escapes = {'n': '\n', 'r': '\r', 't': '\t'}
+    return re.sub(r'\\([0-7]{1,3}|.)', lambda s: chr(int(s.group(1), 8)) if s.group(1)[0] in '01234567' else escapes.get(s.group(1), s.group(1)), qstr)
 
 def do_work(infiles):
     # read the qstrs in from the input files
@@ -52,7 +87,7 @@ def do_work(infiles):
                 match = re.match(r'^QCFG\((.+), (.+)\)', line)
                 if match:
                     value = match.group(2)
-                    if value[0] == '(' and value[-1] == ')':
+                    while value[0] == '(' and value[-1] == ')':
                         # strip parenthesis from config value
                         value = value[1:-1]
                     qcfgs[match.group(1)] = value
@@ -65,7 +100,7 @@ def do_work(infiles):
 
                 # get the qstr value
                 qstr = match.group(1)
-                ident = re.sub(r'[^A-Za-z0-9_]', lambda s: "_" + codepoint2name[ord(s.group(0))] + "_", qstr)
+                ident = qstr_escape(qstr)
 
                 # don't add duplicates
                 if ident in qstrs:
@@ -76,6 +111,8 @@ def do_work(infiles):
 
     # get config variables
     cfg_bytes_len = int(qcfgs['BYTES_IN_LEN'])
+    cfg_bytes_hash = int(qcfgs['BYTES_IN_HASH'])
+    cfg_hash = int(qcfgs.get('HASH', HASH_DJB2))
     cfg_max_len = 1 << (8 * cfg_bytes_len)
 
     # print out the starte of the generated C header file
@@ -83,19 +120,40 @@ def do_work(infiles):
     print('')
 
     # add NULL qstr with no hash or data
-    print('QDEF(MP_QSTR_NULL, (const byte*)"\\x00\\x00%s" "")' % ('\\x00' * cfg_bytes_len))
+    print('QDEF(MP_QSTR_NULL, (const byte*)"%s" "")' % ('\\x00' * (cfg_bytes_hash + cfg_bytes_len)))
 
     # go through each qstr and print it out
+    qhashes = []
     for order, ident, qstr in sorted(qstrs.values(), key=lambda x: x[0]):
-        qhash = compute_hash(qstr)
-        # Calculate len of str, taking escapes into account
-        qlen = len(qstr.replace("\\\\", "-").replace("\\", ""))
+        # Calculate hash and len of str, taking escapes into account
+        qstr_value = qstr_unescape(qstr)
+        qhash = compute_hash(qstr_value, cfg_bytes_hash, cfg_hash)
+        qhashes.append((ident, qhash))
+        qlen = len(qstr_value)
         qdata = qstr.replace('"', '\\"')
         if qlen >= cfg_max_len:
             print('qstr is too long:', qstr)
             assert False
+        qhash_str = ('\\x%02x' * cfg_bytes_hash) % tuple(((qhash >> (8 * i)) & 0xff) for i in range(cfg_bytes_hash))
         qlen_str = ('\\x%02x' * cfg_bytes_len) % tuple(((qlen >> (8 * i)) & 0xff) for i in range(cfg_bytes_len))
-        print('QDEF(MP_QSTR_%s, (const byte*)"\\x%02x\\x%02x%s" "%s")' % (ident, qhash & 0xff, (qhash >> 8) & 0xff, qlen_str, qdata))
+        print('QDEF(MP_QSTR_%s, (const byte*)"%s%s" "%s")' % (ident, qhash_str, qlen_str, qdata))
+
+    # print out a hash table index of the qstrs, with linear probing and at
+    # most half of the entries used; an entry of MP_QSTR_NULL is empty
+    index_len = 1
+    while index_len < 2 * len(qhashes):
+        index_len *= 2
+    index = [None] * index_len
+    for ident, qhash in qhashes:
+        pos = index_start(qhash, cfg_bytes_hash, index_len)
+        while index[pos] is not None:
+            pos = (pos + 1) & (index_len - 1)
+        index[pos] = ident
+    print('')
+    print('#ifdef QINDEX')
+    for ident in index:
+        print('QINDEX(MP_QSTR_%s)' % ('NULL' if ident is None else ident))
+    print('#endif')
 
     return True
 
@@ -100,6 +100,24 @@ void *m_malloc_with_finaliser(size_t num_bytes) {
 }
 #endif
 
+#if MICROPY_GC_OBJ_POOLS
+// allocate an object of the given type, which must always be num_bytes long
+// when allocated from this pool
+void *m_malloc_pooled(unsigned int pool, const void *obj_type, size_t num_bytes) {
+    void *ptr = gc_pool_alloc(pool, obj_type, num_bytes);
+    if (ptr == NULL) {
+        return m_malloc(num_bytes);
+    }
+#if MICROPY_MEM_STATS
+    MP_STATE_MEM(total_bytes_allocated) += num_bytes;
+    MP_STATE_MEM(current_bytes_allocated) += num_bytes;
+    UPDATE_PEAK();
+#endif
+    DEBUG_printf("malloc %d : %p\n", num_bytes, ptr);
+    return ptr;
+}
+#endif
+
 void *m_malloc0(size_t num_bytes) {
     void *ptr = m_malloc(num_bytes);
     if (ptr == NULL && num_bytes != 0) {
@@ -68,7 +68,7 @@ void mp_map_init(mp_map_t *map, mp_uint_t n) {
         map->table = NULL;
     } else {
         map->alloc = n;
-        map->table = m_new0(mp_map_elem_t, map->alloc);
+        map->table = m_new0(mp_map_elem_t, MP_MAP_TABLE_LEN(map->alloc));
     }
     map->used = 0;
     map->all_keys_are_qstrs = 1;
@@ -94,7 +94,7 @@ mp_map_t *mp_map_new(mp_uint_t n) {
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(mp_map_elem_t, map->table, MP_MAP_TABLE_LEN(map->alloc));
     }
     map->used = map->alloc = 0;
 }
@@ -106,7 +106,7 @@ void mp_map_free(mp_map_t *map) {
 
 void mp_map_clear(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(mp_map_elem_t, map->table, MP_MAP_TABLE_LEN(map->alloc));
     }
     map->alloc = 0;
     map->used = 0;
@@ -115,19 +115,211 @@ void mp_map_clear(mp_map_t *map) {
     map->table = NULL;
 }
 
-STATIC void mp_map_rehash(mp_map_t *map) {
+STATIC void mp_map_resize(mp_map_t *map, mp_uint_t new_alloc) {
     mp_uint_t old_alloc = map->alloc;
     mp_map_elem_t *old_table = map->table;
-    map->alloc = get_doubling_prime_greater_or_equal_to(map->alloc + 1);
+    map->alloc = new_alloc;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
-    map->table = m_new0(mp_map_elem_t, map->alloc);
+    map->table = m_new0(mp_map_elem_t, MP_MAP_TABLE_LEN(map->alloc));
     for (mp_uint_t i = 0; i < old_alloc; i++) {
         if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
             mp_map_lookup(map, old_table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = old_table[i].value;
         }
     }
-    m_del(mp_map_elem_t, old_table, old_alloc);
+    m_del(mp_map_elem_t, old_table, MP_MAP_TABLE_LEN(old_alloc));
+}
+
+STATIC void mp_map_rehash(mp_map_t *map) {
+    #if MICROPY_OPT_MAP_COMPACT
+    // room for the live slots and then some; deleted slots are dropped
+    mp_map_resize(map, map->used + map->used / 2 + 4);
+    #else
+    mp_map_resize(map, get_doubling_prime_greater_or_equal_to(map->alloc + 1));
+    #endif
+}
+
+// a compact map has no hash tags
+#define MAP_HASH_TAGS (MICROPY_OPT_MAP_HASH_TAGS && !MICROPY_OPT_MAP_COMPACT)
+
+#if MAP_HASH_TAGS
+
+// The tag of a slot is 0 if it's empty, 1 if its key was deleted, or else has
+// the top bit set and the low 7 bits of the hash of its key in the other bits.
+// The tags are kept in step with the keys by mp_map_lookup.
+#define MAP_TAGS(map) ((byte*)&(map)->table[(map)->alloc])
+#define MAP_TAG(hash) (0x80 | ((hash) & 0x7f))
+#define MAP_TAG_EMPTY (0)
+#define MAP_TAG_DELETED (1)
+#define MAP_SET_TAG(map, slot, t) (MAP_TAGS(map)[(slot) - (map)->table] = (t))
+#define MAP_TAG_MAY_MATCH(map, pos, t) (MAP_TAGS(map)[pos] == (t))
+
+// For checking the bytes of a machine word at a time: a byte of the result
+// has its top bit set if the corresponding byte of x is zero.  Bytes above the
+// lowest zero byte can be wrongly set, but only if their value is below 0x80.
+#define MAP_WORD_ONES ((mp_uint_t)-1 / 0xff)
+#define MAP_WORD_ZERO_BYTES(x) (((x) - MAP_WORD_ONES) & ~(x) & (MAP_WORD_ONES << 7))
+
+// Plain lookup in a hash table, checking the tags of the slots a word at a
+// time.  Only slots with a matching tag, before the first empty one, have
+// their keys compared.
+STATIC mp_map_elem_t *mp_map_lookup_tags(mp_map_t *map, mp_obj_t index, mp_uint_t hash, bool compare_only_ptrs) {
+    const byte *tags = MAP_TAGS(map);
+    mp_uint_t tag = MAP_TAG(hash);
+    mp_uint_t alloc = map->alloc;
+    mp_uint_t pos = hash % alloc;
+    for (mp_uint_t n = alloc; n > 0;) {
+        mp_uint_t match, empty, len;
+        if (MP_ENDIANNESS_LITTLE && pos + sizeof(mp_uint_t) <= alloc) {
+            mp_uint_t w;
+            memcpy(&w, tags + pos, sizeof(w));
+            // the tags of empty and deleted slots are never wrongly matched
+            match = MAP_WORD_ZERO_BYTES(w ^ (tag * MAP_WORD_ONES));
+            empty = MAP_WORD_ZERO_BYTES(w);
+            len = sizeof(mp_uint_t);
+        } else {
+            match = tags[pos] == tag ? 0x80 : 0;
+            empty = tags[pos] == MAP_TAG_EMPTY ? 0x80 : 0;
+            len = 1;
+        }
+        if (empty != 0) {
+            // only the slots before the first empty one can hold the key
+            empty &= -empty;
+            match &= empty - 1;
+        }
+        for (mp_map_elem_t *slot = &map->table[pos]; match != 0; slot++, match >>= 8) {
+            if ((match & 0x80) && (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index)))) {
+                return slot;
+            }
+        }
+        if (empty != 0) {
+            return NULL;
+        }
+        pos += len;
+        if (pos == alloc) {
+            pos = 0;
+        }
+        n = len < n ? n - len : 0;
+    }
+    return NULL;
+}
+
+#else
+#define MAP_SET_TAG(map, slot, t)
+#define MAP_TAG_MAY_MATCH(map, pos, t) (1)
+#endif
+
+#if MICROPY_OPT_MAP_COMPACT
+
+// The number of slots used so far (live or deleted) and the index table are
+// stored after the slots.  An index entry is 0 if empty, or else 1 plus the
+// number of a slot.  An index entry of a deleted slot is left in place, as a
+// marker to keep probing, until the next rehash.
+#define MAP_N_FILLED(map) (*(mp_uint_t*)&(map)->table[(map)->alloc])
+#define MAP_INDEX(map) ((byte*)&(map)->table[(map)->alloc] + sizeof(mp_uint_t))
+
+STATIC mp_uint_t map_index_get(const mp_map_t *map, mp_uint_t pos) {
+    const byte *index = MAP_INDEX(map);
+    switch (MP_MAP_INDEX_WIDTH(map->alloc)) {
+        case 1: return index[pos];
+        case 2: return ((const uint16_t*)index)[pos];
+        default: return ((const uint32_t*)index)[pos];
+    }
+}
+
+STATIC void map_index_set(mp_map_t *map, mp_uint_t pos, mp_uint_t val) {
+    byte *index = MAP_INDEX(map);
+    switch (MP_MAP_INDEX_WIDTH(map->alloc)) {
+        case 1: index[pos] = val; break;
+        case 2: ((uint16_t*)index)[pos] = val; break;
+        default: ((uint32_t*)index)[pos] = val; break;
+    }
+}
+
+// Lookup in a compact map, which has alloc > 0.  There are more index entries
+// than slots so a probe always ends at an empty index entry.
+STATIC mp_map_elem_t *mp_map_lookup_compact(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, bool compare_only_ptrs) {
+    mp_uint_t hash = mp_obj_hash(index);
+    for (;;) {
+        mp_uint_t index_len = MP_MAP_INDEX_LEN(map->alloc);
+        mp_uint_t pos = hash % index_len;
+        mp_uint_t avail_pos = index_len;
+        for (;;) {
+            mp_uint_t n = map_index_get(map, pos);
+            if (n == 0) {
+                break;
+            }
+            mp_map_elem_t *slot = &map->table[n - 1];
+            if (slot->key == MP_OBJ_SENTINEL) {
+                // deleted slot, remember its index entry for later
+                if (avail_pos == index_len) {
+                    avail_pos = pos;
+                }
+            } else if (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index))) {
+                if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                    map->used--;
+                    slot->key = MP_OBJ_SENTINEL;
+                    // keep slot->value so that caller can access it if needed
+                }
+                return slot;
+            }
+            pos = pos + 1 == index_len ? 0 : pos + 1;
+        }
+
+        // index is not in the map
+        if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            return NULL;
+        }
+        mp_uint_t n_filled = MAP_N_FILLED(map);
+        if (n_filled < map->alloc) {
+            if (avail_pos != index_len) {
+                pos = avail_pos;
+            }
+            map_index_set(map, pos, n_filled + 1);
+            MAP_N_FILLED(map) = n_filled + 1;
+            map->used++;
+            mp_map_elem_t *slot = &map->table[n_filled];
+            slot->key = index;
+            slot->value = MP_OBJ_NULL;
+            if (!MP_OBJ_IS_QSTR(index)) {
+                map->all_keys_are_qstrs = 0;
+            }
+            return slot;
+        }
+
+        // no free slots left, so rehash and retry
+        mp_map_rehash(map);
+    }
+}
+
+#endif
+
+// Make room for n more keys, so that adding them does not need a rehash part
+// way through.  Used when the number of keys to add is known, or estimated,
+// before adding them.
+void mp_map_reserve(mp_map_t *map, mp_uint_t n) {
+    if (map->is_fixed || n == 0) {
+        return;
+    }
+    mp_uint_t need = map->used + n;
+    if (map->is_ordered) {
+        if (need > map->alloc) {
+            map->table = m_renew(mp_map_elem_t, map->table, MP_MAP_TABLE_LEN(map->alloc), MP_MAP_TABLE_LEN(need));
+            mp_seq_clear(map->table, map->used, need, sizeof(*map->table));
+            map->alloc = need;
+        }
+        return;
+    }
+    #if MICROPY_OPT_MAP_COMPACT
+    if (map->alloc != 0 && MAP_N_FILLED(map) + n <= map->alloc) {
+        return;
+    }
+    mp_map_resize(map, need);
+    #else
+    if (need > map->alloc) {
+        mp_map_resize(map, get_doubling_prime_greater_or_equal_to(need));
+    }
+    #endif
 }
 
 // MP_MAP_LOOKUP behaviour:
@@ -179,7 +371,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         if (map->used == map->alloc) {
             // TODO: Alloc policy
             map->alloc += 4;
-            map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
+            map->table = m_renew(mp_map_elem_t, map->table, MP_MAP_TABLE_LEN(map->used), MP_MAP_TABLE_LEN(map->alloc));
             mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
         }
         mp_map_elem_t *elem = map->table + map->used++;
@@ -200,7 +392,17 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
+    #if MICROPY_OPT_MAP_COMPACT
+    return mp_map_lookup_compact(map, index, lookup_kind, compare_only_ptrs);
+    #else
+
     mp_uint_t hash = mp_obj_hash(index);
+    #if MAP_HASH_TAGS
+    if (lookup_kind == MP_MAP_LOOKUP) {
+        return mp_map_lookup_tags(map, index, hash, compare_only_ptrs);
+    }
+    byte tag = MAP_TAG(hash);
+    #endif
     mp_uint_t pos = hash % map->alloc;
     mp_uint_t start_pos = pos;
     mp_map_elem_t *avail_slot = NULL;
@@ -215,6 +417,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                 }
                 slot->key = index;
                 slot->value = MP_OBJ_NULL;
+                MAP_SET_TAG(map, slot, tag);
                 if (!MP_OBJ_IS_QSTR(index)) {
                     map->all_keys_are_qstrs = 0;
                 }
@@ -227,7 +430,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             if (avail_slot == NULL) {
                 avail_slot = slot;
             }
-        } else if (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index))) {
+        } else if (MAP_TAG_MAY_MATCH(map, pos, tag) && (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index)))) {
             // found index
             // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
             if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
@@ -236,8 +439,10 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                 if (map->table[(pos + 1) % map->alloc].key == MP_OBJ_NULL) {
                     // optimisation if next slot is empty
                     slot->key = MP_OBJ_NULL;
+                    MAP_SET_TAG(map, slot, MAP_TAG_EMPTY);
                 } else {
                     slot->key = MP_OBJ_SENTINEL;
+                    MAP_SET_TAG(map, slot, MAP_TAG_DELETED);
                 }
                 // keep slot->value so that caller can access it if needed
             }
@@ -255,6 +460,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     map->used++;
                     avail_slot->key = index;
                     avail_slot->value = MP_OBJ_NULL;
+                    MAP_SET_TAG(map, avail_slot, tag);
                     if (!MP_OBJ_IS_QSTR(index)) {
                         map->all_keys_are_qstrs = 0;
                     }
@@ -270,6 +476,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             }
         }
     }
+    #endif
 }
 
 /******************************************************************************/
@@ -283,10 +490,10 @@ void mp_set_init(mp_set_t *set, mp_uint_t n) {
     set->table = m_new0(mp_obj_t, set->alloc);
 }
 
-STATIC void mp_set_rehash(mp_set_t *set) {
+STATIC void mp_set_resize(mp_set_t *set, mp_uint_t new_alloc) {
     mp_uint_t old_alloc = set->alloc;
     mp_obj_t *old_table = set->table;
-    set->alloc = get_doubling_prime_greater_or_equal_to(set->alloc + 1);
+    set->alloc = new_alloc;
     set->used = 0;
     set->table = m_new0(mp_obj_t, set->alloc);
     for (mp_uint_t i = 0; i < old_alloc; i++) {
@@ -297,6 +504,18 @@ STATIC void mp_set_rehash(mp_set_t *set) {
     m_del(mp_obj_t, old_table, old_alloc);
 }
 
+STATIC void mp_set_rehash(mp_set_t *set) {
+    mp_set_resize(set, get_doubling_prime_greater_or_equal_to(set->alloc + 1));
+}
+
+// make room for n more elements, see mp_map_reserve
+void mp_set_reserve(mp_set_t *set, mp_uint_t n) {
+    mp_uint_t need = set->used + n;
+    if (need > set->alloc) {
+        mp_set_resize(set, get_doubling_prime_greater_or_equal_to(need));
+    }
+}
+
 mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
     // Note: lookup_kind can be MP_MAP_LOOKUP_ADD_IF_NOT_FOUND_OR_REMOVE_IF_FOUND which
     // is handled by using bitwise operations.
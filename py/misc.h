@@ -56,6 +56,7 @@ typedef unsigned int uint;
 #define m_new_obj_maybe(type) (m_new_maybe(type, 1))
 #define m_new_obj_var(obj_type, var_type, var_num) ((obj_type*)m_malloc(sizeof(obj_type) + sizeof(var_type) * (var_num)))
 #define m_new_obj_var_maybe(obj_type, var_type, var_num) ((obj_type*)m_malloc_maybe(sizeof(obj_type) + sizeof(var_type) * (var_num)))
+#define m_renew_obj_var(obj_type, var_type, obj_ptr, old_num, new_num) ((obj_type*)m_renew(byte, (obj_ptr), sizeof(obj_type) + sizeof(var_type) * (old_num), sizeof(obj_type) + sizeof(var_type) * (new_num)))
 #if MICROPY_ENABLE_FINALISER
 #define m_new_obj_with_finaliser(type) ((type*)(m_malloc_with_finaliser(sizeof(type))))
 #else
@@ -74,10 +75,30 @@ typedef unsigned int uint;
 #endif
 #define m_del_obj(type, ptr) (m_del(type, ptr, 1))
 
+// the object pools, see MICROPY_GC_OBJ_POOLS
+enum {
+    MP_OBJ_POOL_FLOAT,
+    MP_OBJ_POOL_TUPLE2,
+    MP_OBJ_POOL_BOUND_METH,
+    MP_OBJ_POOL_RANGE_IT,
+    MP_OBJ_POOL_LIST,
+    MP_OBJ_NUM_POOLS,
+};
+#if MICROPY_GC_OBJ_POOLS
+#define m_new_obj_pooled(type, obj_type, pool) ((type*)(m_malloc_pooled((pool), (obj_type), sizeof(type))))
+#define m_new_obj_var_pooled(type, var_type, var_num, obj_type, pool) ((type*)(m_malloc_pooled((pool), (obj_type), sizeof(type) + sizeof(var_type) * (var_num))))
+#else
+#define m_new_obj_pooled(type, obj_type, pool) m_new_obj(type)
+#define m_new_obj_var_pooled(type, var_type, var_num, obj_type, pool) m_new_obj_var(type, var_type, var_num)
+#endif
+
 void *m_malloc(size_t num_bytes);
 void *m_malloc_maybe(size_t num_bytes);
 void *m_malloc_with_finaliser(size_t num_bytes);
 void *m_malloc0(size_t num_bytes);
+#if MICROPY_GC_OBJ_POOLS
+void *m_malloc_pooled(unsigned int pool, const void *obj_type, size_t num_bytes);
+#endif
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
 void *m_realloc(void *ptr, size_t old_num_bytes, size_t new_num_bytes);
 void *m_realloc_maybe(void *ptr, size_t old_num_bytes, size_t new_num_bytes);
@@ -139,14 +160,20 @@ typedef struct _vstr_t {
     char *buf;
     bool had_error : 1;
     bool fixed_buf : 1;
+    bool small_buf : 1;
 } vstr_t;
 
 // convenience macro to declare a vstr with a fixed size buffer on the stack
 #define VSTR_FIXED(vstr, alloc) vstr_t vstr; char vstr##_buf[(alloc)]; vstr_init_fixed_buf(&vstr, (alloc), vstr##_buf);
 
+// convenience macro to declare a vstr that starts in a small buffer on the
+// stack and moves to the heap only if it outgrows it
+#define VSTR_SMALL(vstr) vstr_t vstr; char vstr##_buf[MICROPY_ALLOC_VSTR_SMALL]; vstr_init_small_buf(&vstr, MICROPY_ALLOC_VSTR_SMALL, vstr##_buf);
+
 void vstr_init(vstr_t *vstr, size_t alloc);
 void vstr_init_len(vstr_t *vstr, size_t len);
 void vstr_init_fixed_buf(vstr_t *vstr, size_t alloc, char *buf);
+void vstr_init_small_buf(vstr_t *vstr, size_t alloc, char *buf);
 struct _mp_print_t;
 void vstr_init_print(vstr_t *vstr, size_t alloc, struct _mp_print_t *print);
 void vstr_clear(vstr_t *vstr);
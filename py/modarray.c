@@ -24,13 +24,341 @@
  * THE SOFTWARE.
  */
 
+#include "py/nlr.h"
+#include "py/smallint.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+#include "py/binary.h"
 #include "py/builtin.h"
 
 #if MICROPY_PY_ARRAY
 
+#if MICROPY_PY_ARRAY_MATH
+
+// Elementwise math over anything supporting the buffer protocol (array,
+// bytearray, bytes, memoryview).  The common typecodes get a plain typed C
+// loop; all others fall back to boxing each element through
+// mp_binary_get_val_array/mp_binary_set_val_array and mp_binary_op.
+// Integer results wrap to the element width, like item assignment does.
+
+#define ARRAY_MATH_INT_TYPES(X) \
+    X(BYTEARRAY_TYPECODE, uint8_t) \
+    X('b', int8_t) \
+    X('B', uint8_t) \
+    X('h', int16_t) \
+    X('H', uint16_t) \
+    X('i', int) \
+    X('I', unsigned int)
+
+#if MICROPY_PY_BUILTINS_FLOAT
+#define ARRAY_MATH_FLOAT_TYPES(X) \
+    X('f', float) \
+    X('d', double)
+#else
+#define ARRAY_MATH_FLOAT_TYPES(X)
+#endif
+
+// returns number of elements in the buffer
+STATIC mp_uint_t array_math_get(mp_obj_t obj, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_get_buffer_raise(obj, bufinfo, flags);
+    int sz = mp_binary_get_size('@', bufinfo->typecode, NULL);
+    if (sz <= 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad typecode"));
+    }
+    return bufinfo->len / sz;
+}
+
+STATIC mp_uint_t array_math_get_pair(mp_obj_t a_in, mp_obj_t b_in, mp_buffer_info_t *a, mp_buffer_info_t *b) {
+    mp_uint_t n = array_math_get(a_in, a, MP_BUFFER_READ);
+    if (array_math_get(b_in, b, MP_BUFFER_READ) != n || b->typecode != a->typecode) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "incompatible arrays"));
+    }
+    return n;
+}
+
+// use args[i] as output if given, otherwise make a new array
+STATIC mp_obj_t array_math_out(mp_uint_t n_args, const mp_obj_t *args, mp_uint_t i, const mp_buffer_info_t *a, mp_uint_t n, mp_buffer_info_t *out) {
+    mp_obj_t o;
+    if (n_args > i) {
+        o = args[i];
+        if (array_math_get(o, out, MP_BUFFER_WRITE) != n || out->typecode != a->typecode) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "incompatible arrays"));
+        }
+    } else {
+        o = mp_obj_new_array(a->typecode, n);
+        mp_get_buffer_raise(o, out, MP_BUFFER_WRITE);
+    }
+    return o;
+}
+
+STATIC mp_obj_t array_math_int_result(long long val) {
+    if (MP_SMALL_INT_FITS(val)) {
+        return MP_OBJ_NEW_SMALL_INT(val);
+    }
+    return mp_obj_new_int_from_ll(val);
+}
+
+STATIC mp_obj_t array_math_binop(mp_uint_t n_args, const mp_obj_t *args, mp_uint_t op) {
+    mp_buffer_info_t a, b, out;
+    mp_uint_t n = array_math_get_pair(args[0], args[1], &a, &b);
+    mp_obj_t o = array_math_out(n_args, args, 2, &a, n, &out);
+    switch (a.typecode) {
+        #define INT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf, *y = b.buf; T *z = out.buf; \
+            if (op == MP_BINARY_OP_ADD) { \
+                for (mp_uint_t i = 0; i < n; i++) { z[i] = (T)((mp_uint_t)x[i] + (mp_uint_t)y[i]); } \
+            } else { \
+                for (mp_uint_t i = 0; i < n; i++) { z[i] = (T)((mp_uint_t)x[i] * (mp_uint_t)y[i]); } \
+            } \
+            break; \
+        }
+        ARRAY_MATH_INT_TYPES(INT_CASE)
+        #undef INT_CASE
+        #define FLOAT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf, *y = b.buf; T *z = out.buf; \
+            if (op == MP_BINARY_OP_ADD) { \
+                for (mp_uint_t i = 0; i < n; i++) { z[i] = x[i] + y[i]; } \
+            } else { \
+                for (mp_uint_t i = 0; i < n; i++) { z[i] = x[i] * y[i]; } \
+            } \
+            break; \
+        }
+        ARRAY_MATH_FLOAT_TYPES(FLOAT_CASE)
+        #undef FLOAT_CASE
+        default:
+            for (mp_uint_t i = 0; i < n; i++) {
+                mp_obj_t v = mp_binary_op(op, mp_binary_get_val_array(a.typecode, a.buf, i),
+                    mp_binary_get_val_array(a.typecode, b.buf, i));
+                mp_binary_set_val_array(a.typecode, out.buf, i, v);
+            }
+            break;
+    }
+    return o;
+}
+
+STATIC mp_obj_t array_math_add(mp_uint_t n_args, const mp_obj_t *args) {
+    return array_math_binop(n_args, args, MP_BINARY_OP_ADD);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_math_add_obj, 2, 3, array_math_add);
+
+STATIC mp_obj_t array_math_mul(mp_uint_t n_args, const mp_obj_t *args) {
+    return array_math_binop(n_args, args, MP_BINARY_OP_MULTIPLY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_math_mul_obj, 2, 3, array_math_mul);
+
+STATIC mp_obj_t array_math_scale(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t a, out;
+    mp_uint_t n = array_math_get(args[0], &a, MP_BUFFER_READ);
+    mp_obj_t o = array_math_out(n_args, args, 2, &a, n, &out);
+    switch (a.typecode) {
+        #define INT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; T *z = out.buf; \
+            mp_uint_t k = mp_obj_get_int(args[1]); \
+            for (mp_uint_t i = 0; i < n; i++) { z[i] = (T)((mp_uint_t)x[i] * k); } \
+            break; \
+        }
+        ARRAY_MATH_INT_TYPES(INT_CASE)
+        #undef INT_CASE
+        #define FLOAT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; T *z = out.buf; \
+            T k = mp_obj_get_float(args[1]); \
+            for (mp_uint_t i = 0; i < n; i++) { z[i] = x[i] * k; } \
+            break; \
+        }
+        ARRAY_MATH_FLOAT_TYPES(FLOAT_CASE)
+        #undef FLOAT_CASE
+        default:
+            for (mp_uint_t i = 0; i < n; i++) {
+                mp_obj_t v = mp_binary_op(MP_BINARY_OP_MULTIPLY, mp_binary_get_val_array(a.typecode, a.buf, i), args[1]);
+                mp_binary_set_val_array(a.typecode, out.buf, i, v);
+            }
+            break;
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_math_scale_obj, 2, 3, array_math_scale);
+
+STATIC mp_obj_t array_math_clip(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t a, out;
+    mp_uint_t n = array_math_get(args[0], &a, MP_BUFFER_READ);
+    mp_obj_t o = array_math_out(n_args, args, 3, &a, n, &out);
+    switch (a.typecode) {
+        #define INT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; T *z = out.buf; \
+            long long lo = mp_obj_get_int(args[1]), hi = mp_obj_get_int(args[2]); \
+            for (mp_uint_t i = 0; i < n; i++) { \
+                long long v = x[i]; \
+                z[i] = v < lo ? (T)lo : v > hi ? (T)hi : x[i]; \
+            } \
+            break; \
+        }
+        ARRAY_MATH_INT_TYPES(INT_CASE)
+        #undef INT_CASE
+        #define FLOAT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; T *z = out.buf; \
+            T lo = mp_obj_get_float(args[1]), hi = mp_obj_get_float(args[2]); \
+            for (mp_uint_t i = 0; i < n; i++) { z[i] = x[i] < lo ? lo : x[i] > hi ? hi : x[i]; } \
+            break; \
+        }
+        ARRAY_MATH_FLOAT_TYPES(FLOAT_CASE)
+        #undef FLOAT_CASE
+        default:
+            for (mp_uint_t i = 0; i < n; i++) {
+                mp_obj_t v = mp_binary_get_val_array(a.typecode, a.buf, i);
+                if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, v, args[1]))) {
+                    v = args[1];
+                } else if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_MORE, v, args[2]))) {
+                    v = args[2];
+                }
+                mp_binary_set_val_array(a.typecode, out.buf, i, v);
+            }
+            break;
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_math_clip_obj, 3, 4, array_math_clip);
+
+STATIC mp_obj_t array_math_dot(mp_obj_t a_in, mp_obj_t b_in) {
+    mp_buffer_info_t a, b;
+    mp_uint_t n = array_math_get_pair(a_in, b_in, &a, &b);
+    switch (a.typecode) {
+        // 'i' and 'I' products can overflow a long long accumulator,
+        // so they take the generic path
+        #define INT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf, *y = b.buf; \
+            long long acc = 0; \
+            for (mp_uint_t i = 0; i < n; i++) { acc += (mp_int_t)x[i] * y[i]; } \
+            return array_math_int_result(acc); \
+        }
+        INT_CASE(BYTEARRAY_TYPECODE, uint8_t)
+        INT_CASE('b', int8_t)
+        INT_CASE('B', uint8_t)
+        INT_CASE('h', int16_t)
+        INT_CASE('H', uint16_t)
+        #undef INT_CASE
+        #define FLOAT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf, *y = b.buf; \
+            mp_float_t acc = 0; \
+            for (mp_uint_t i = 0; i < n; i++) { acc += (mp_float_t)x[i] * (mp_float_t)y[i]; } \
+            return mp_obj_new_float(acc); \
+        }
+        ARRAY_MATH_FLOAT_TYPES(FLOAT_CASE)
+        #undef FLOAT_CASE
+        default: {
+            mp_obj_t acc = MP_OBJ_NEW_SMALL_INT(0);
+            for (mp_uint_t i = 0; i < n; i++) {
+                mp_obj_t v = mp_binary_op(MP_BINARY_OP_MULTIPLY, mp_binary_get_val_array(a.typecode, a.buf, i),
+                    mp_binary_get_val_array(a.typecode, b.buf, i));
+                acc = mp_binary_op(MP_BINARY_OP_ADD, acc, v);
+            }
+            return acc;
+        }
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_math_dot_obj, array_math_dot);
+
+STATIC mp_obj_t array_math_sum(mp_obj_t a_in) {
+    mp_buffer_info_t a;
+    mp_uint_t n = array_math_get(a_in, &a, MP_BUFFER_READ);
+    switch (a.typecode) {
+        #define INT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; \
+            long long acc = 0; \
+            for (mp_uint_t i = 0; i < n; i++) { acc += x[i]; } \
+            return array_math_int_result(acc); \
+        }
+        ARRAY_MATH_INT_TYPES(INT_CASE)
+        #undef INT_CASE
+        #define FLOAT_CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; \
+            mp_float_t acc = 0; \
+            for (mp_uint_t i = 0; i < n; i++) { acc += (mp_float_t)x[i]; } \
+            return mp_obj_new_float(acc); \
+        }
+        ARRAY_MATH_FLOAT_TYPES(FLOAT_CASE)
+        #undef FLOAT_CASE
+        default: {
+            mp_obj_t acc = MP_OBJ_NEW_SMALL_INT(0);
+            for (mp_uint_t i = 0; i < n; i++) {
+                acc = mp_binary_op(MP_BINARY_OP_ADD, acc, mp_binary_get_val_array(a.typecode, a.buf, i));
+            }
+            return acc;
+        }
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_math_sum_obj, array_math_sum);
+
+// op is MP_BINARY_OP_LESS for min, MP_BINARY_OP_MORE for max
+STATIC mp_obj_t array_math_minmax(mp_obj_t a_in, mp_uint_t op) {
+    mp_buffer_info_t a;
+    mp_uint_t n = array_math_get(a_in, &a, MP_BUFFER_READ);
+    if (n == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "arg is an empty sequence"));
+    }
+    mp_uint_t best = 0;
+    switch (a.typecode) {
+        #define CASE(tc, T) \
+        case tc: { \
+            const T *x = a.buf; \
+            if (op == MP_BINARY_OP_LESS) { \
+                for (mp_uint_t i = 1; i < n; i++) { if (x[i] < x[best]) { best = i; } } \
+            } else { \
+                for (mp_uint_t i = 1; i < n; i++) { if (x[i] > x[best]) { best = i; } } \
+            } \
+            break; \
+        }
+        ARRAY_MATH_INT_TYPES(CASE)
+        ARRAY_MATH_FLOAT_TYPES(CASE)
+        #undef CASE
+        default: {
+            mp_obj_t best_obj = mp_binary_get_val_array(a.typecode, a.buf, 0);
+            for (mp_uint_t i = 1; i < n; i++) {
+                mp_obj_t v = mp_binary_get_val_array(a.typecode, a.buf, i);
+                if (mp_obj_is_true(mp_binary_op(op, v, best_obj))) {
+                    best_obj = v;
+                }
+            }
+            return best_obj;
+        }
+    }
+    return mp_binary_get_val_array(a.typecode, a.buf, best);
+}
+
+STATIC mp_obj_t array_math_min(mp_obj_t a_in) {
+    return array_math_minmax(a_in, MP_BINARY_OP_LESS);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_math_min_obj, array_math_min);
+
+STATIC mp_obj_t array_math_max(mp_obj_t a_in) {
+    return array_math_minmax(a_in, MP_BINARY_OP_MORE);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_math_max_obj, array_math_max);
+
+#endif // MICROPY_PY_ARRAY_MATH
+
 STATIC const mp_map_elem_t mp_module_array_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_array) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_array), (mp_obj_t)&mp_type_array },
+    #if MICROPY_PY_ARRAY_MATH
+    { MP_OBJ_NEW_QSTR(MP_QSTR_add), (mp_obj_t)&array_math_add_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mul), (mp_obj_t)&array_math_mul_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scale), (mp_obj_t)&array_math_scale_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_clip), (mp_obj_t)&array_math_clip_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dot), (mp_obj_t)&array_math_dot_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sum), (mp_obj_t)&array_math_sum_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_min), (mp_obj_t)&array_math_min_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_max), (mp_obj_t)&array_math_max_obj },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_array_globals, mp_module_array_globals_table);
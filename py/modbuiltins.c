@@ -35,6 +35,8 @@
 #include "py/runtime.h"
 #include "py/builtin.h"
 #include "py/stream.h"
+#include "py/objgenerator.h"
+#include "py/binary.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT
 #include <math.h>
@@ -93,7 +95,7 @@ STATIC mp_obj_t mp_builtin_abs(mp_obj_t o_in) {
     if (0) {
         // dummy
 #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (MP_OBJ_IS_TYPE(o_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(o_in)) {
         mp_float_t value = mp_obj_float_get(o_in);
         // TODO check for NaN etc
         if (value < 0) {
@@ -115,10 +117,114 @@ STATIC mp_obj_t mp_builtin_abs(mp_obj_t o_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_builtin_abs_obj, mp_builtin_abs);
 
+#if MICROPY_OPT_NUMERIC_SEQ
+
+// A list or tuple is walked by indexing its items directly, instead of
+// through an iterator: seq_getiter returns MP_OBJ_NULL for one, and
+// seq_iternext then takes the item at *idx.  The items are looked up afresh
+// each time since user code called on an item may have changed the list.
+STATIC mp_obj_t seq_getiter(mp_obj_t seq) {
+    if (MP_OBJ_IS_TYPE(seq, &mp_type_list) || MP_OBJ_IS_TYPE(seq, &mp_type_tuple)) {
+        return MP_OBJ_NULL;
+    }
+    return mp_getiter(seq);
+}
+
+STATIC mp_obj_t seq_iternext(mp_obj_t seq, mp_obj_t iter, mp_uint_t *idx) {
+    if (iter != MP_OBJ_NULL) {
+        return mp_iternext(iter);
+    }
+    mp_uint_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(seq, &len, &items);
+    if (*idx >= len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    return items[(*idx)++];
+}
+
+// Gets the buffer of a bytes, bytearray or array object whose items are
+// numbers, returning false for anything else.
+STATIC bool numeric_buf_get(mp_obj_t o, mp_buffer_info_t *bufinfo) {
+    if (!(MP_OBJ_IS_TYPE(o, &mp_type_bytes)
+        #if MICROPY_PY_BUILTINS_BYTEARRAY
+        || MP_OBJ_IS_TYPE(o, &mp_type_bytearray)
+        #endif
+        #if MICROPY_PY_ARRAY
+        || MP_OBJ_IS_TYPE(o, &mp_type_array)
+        #endif
+        )) {
+        return false;
+    }
+    mp_get_buffer_raise(o, bufinfo, MP_BUFFER_READ);
+    if (bufinfo->typecode == 'O') {
+        return false;
+    }
+    if (MP_OBJ_IS_TYPE(o, &mp_type_bytes)) {
+        // bytes gives its buffer as signed chars, but its items are unsigned
+        bufinfo->typecode = 'B';
+    }
+    bufinfo->len /= mp_binary_get_size('@', bufinfo->typecode, NULL);
+    return true;
+}
+
+// Gets item i of an array of ints as a small int value, as
+// mp_binary_get_val_array would, or returns false if the item does not fit
+// in a small int or is not an int.
+STATIC bool numeric_buf_get_small_int(char typecode, const void *p, mp_uint_t i, mp_int_t *val) {
+    long long v;
+    switch (typecode) {
+        case 'b': *val = ((const signed char*)p)[i]; return true;
+        case BYTEARRAY_TYPECODE:
+        case 'B': *val = ((const unsigned char*)p)[i]; return true;
+        case 'h': *val = ((const short*)p)[i]; return true;
+        case 'H': *val = ((const unsigned short*)p)[i]; return true;
+        case 'i': v = ((const int*)p)[i]; break;
+        case 'I': v = ((const unsigned int*)p)[i]; break;
+        case 'l': v = ((const long*)p)[i]; break;
+        case 'L': {
+            unsigned long u = ((const unsigned long*)p)[i];
+            if (u > (unsigned long)MP_SMALL_INT_MAX) {
+                return false;
+            }
+            *val = u;
+            return true;
+        }
+        #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+        case 'q':
+        case 'Q': v = ((const long long*)p)[i]; break;
+        #endif
+        default: return false;
+    }
+    if (v < MP_SMALL_INT_MIN || v > MP_SMALL_INT_MAX) {
+        return false;
+    }
+    *val = v;
+    return true;
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_float_t numeric_buf_get_float(char typecode, const void *p, mp_uint_t i) {
+    if (typecode == 'f') {
+        return ((const float*)p)[i];
+    } else {
+        return ((const double*)p)[i];
+    }
+}
+#endif
+
+#else
+
+#define seq_getiter(seq) mp_getiter(seq)
+#define seq_iternext(seq, iter, idx) ((void)(idx), mp_iternext(iter))
+
+#endif
+
 STATIC mp_obj_t mp_builtin_all(mp_obj_t o_in) {
-    mp_obj_t iterable = mp_getiter(o_in);
+    mp_obj_t iterable = seq_getiter(o_in);
+    mp_uint_t idx = 0;
     mp_obj_t item;
-    while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+    while ((item = seq_iternext(o_in, iterable, &idx)) != MP_OBJ_STOP_ITERATION) {
         if (!mp_obj_is_true(item)) {
             return mp_const_false;
         }
@@ -128,9 +234,10 @@ STATIC mp_obj_t mp_builtin_all(mp_obj_t o_in) {
 MP_DEFINE_CONST_FUN_OBJ_1(mp_builtin_all_obj, mp_builtin_all);
 
 STATIC mp_obj_t mp_builtin_any(mp_obj_t o_in) {
-    mp_obj_t iterable = mp_getiter(o_in);
+    mp_obj_t iterable = seq_getiter(o_in);
+    mp_uint_t idx = 0;
     mp_obj_t item;
-    while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+    while ((item = seq_iternext(o_in, iterable, &idx)) != MP_OBJ_STOP_ITERATION) {
         if (mp_obj_is_true(item)) {
             return mp_const_true;
         }
@@ -245,7 +352,7 @@ STATIC mp_obj_t mp_builtin_divmod(mp_obj_t o1_in, mp_obj_t o2_in) {
         args[1] = MP_OBJ_NEW_SMALL_INT(mp_small_int_modulo(i1, i2));
         return mp_obj_new_tuple(2, args);
     #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (MP_OBJ_IS_TYPE(o1_in, &mp_type_float) || MP_OBJ_IS_TYPE(o2_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(o1_in) || mp_obj_is_float(o2_in)) {
         mp_float_t f1 = mp_obj_get_float(o1_in);
         mp_float_t f2 = mp_obj_get_float(o2_in);
         if (f2 == 0.0) {
@@ -287,17 +394,86 @@ STATIC mp_obj_t mp_builtin_iter(mp_obj_t o_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_builtin_iter_obj, mp_builtin_iter);
 
+#if MICROPY_OPT_NUMERIC_SEQ
+// min or max of a range or of an array of numbers, or MP_OBJ_NULL if the
+// generic loop is needed
+STATIC mp_obj_t min_max_numeric(mp_obj_t o, mp_uint_t op) {
+    if (MP_OBJ_IS_TYPE(o, &mp_type_range)) {
+        mp_int_t start, step;
+        mp_int_t len = mp_obj_range_get(o, &start, &step);
+        if (len == 0) {
+            return MP_OBJ_NULL;
+        }
+        mp_int_t last = start + (len - 1) * step;
+        return mp_obj_new_int((op == MP_BINARY_OP_LESS) == (step > 0) ? start : last);
+    }
+    mp_buffer_info_t bufinfo;
+    if (!numeric_buf_get(o, &bufinfo) || bufinfo.len == 0) {
+        return MP_OBJ_NULL;
+    }
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (bufinfo.typecode == 'f' || bufinfo.typecode == 'd') {
+        mp_uint_t best = 0;
+        mp_float_t best_val = numeric_buf_get_float(bufinfo.typecode, bufinfo.buf, 0);
+        for (mp_uint_t i = 1; i < bufinfo.len; i++) {
+            mp_float_t v = numeric_buf_get_float(bufinfo.typecode, bufinfo.buf, i);
+            if (op == MP_BINARY_OP_LESS ? v < best_val : v > best_val) {
+                best = i;
+                best_val = v;
+            }
+        }
+        return mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, best);
+    }
+    #endif
+    mp_int_t best_val;
+    if (!numeric_buf_get_small_int(bufinfo.typecode, bufinfo.buf, 0, &best_val)) {
+        return MP_OBJ_NULL;
+    }
+    for (mp_uint_t i = 1; i < bufinfo.len; i++) {
+        mp_int_t v;
+        if (!numeric_buf_get_small_int(bufinfo.typecode, bufinfo.buf, i, &v)) {
+            return MP_OBJ_NULL;
+        }
+        if (op == MP_BINARY_OP_LESS ? v < best_val : v > best_val) {
+            best_val = v;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(best_val);
+}
+#endif
+
 STATIC mp_obj_t mp_builtin_min_max(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwargs, mp_uint_t op) {
     mp_map_elem_t *key_elem = mp_map_lookup(kwargs, MP_OBJ_NEW_QSTR(MP_QSTR_key), MP_MAP_LOOKUP);
     mp_obj_t key_fn = key_elem == NULL ? MP_OBJ_NULL : key_elem->value;
     if (n_args == 1) {
         // given an iterable
-        mp_obj_t iterable = mp_getiter(args[0]);
+        #if MICROPY_OPT_NUMERIC_SEQ
+        if (key_fn == MP_OBJ_NULL) {
+            mp_obj_t best = min_max_numeric(args[0], op);
+            if (best != MP_OBJ_NULL) {
+                return best;
+            }
+        }
+        #endif
+        mp_obj_t iterable = seq_getiter(args[0]);
+        mp_uint_t idx = 0;
         mp_obj_t best_key = MP_OBJ_NULL;
         mp_obj_t best_obj = MP_OBJ_NULL;
         mp_obj_t item;
-        while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+        while ((item = seq_iternext(args[0], iterable, &idx)) != MP_OBJ_STOP_ITERATION) {
             mp_obj_t key = key_fn == MP_OBJ_NULL ? item : mp_call_function_1(key_fn, item);
+            #if MICROPY_OPT_NUMERIC_SEQ
+            bool better;
+            if (best_obj != MP_OBJ_NULL && (op == MP_BINARY_OP_LESS
+                ? mp_binary_op_less_fast(key, best_key, &better)
+                : mp_binary_op_less_fast(best_key, key, &better))) {
+                if (better) {
+                    best_key = key;
+                    best_obj = item;
+                }
+                continue;
+            }
+            #endif
             if (best_obj == MP_OBJ_NULL || (mp_binary_op(op, key, best_key) == mp_const_true)) {
                 best_key = key;
                 best_obj = item;
@@ -335,6 +511,13 @@ MP_DEFINE_CONST_FUN_OBJ_KW(mp_builtin_min_obj, 1, mp_builtin_min);
 STATIC mp_obj_t mp_builtin_next(mp_obj_t o) {
     mp_obj_t ret = mp_iternext_allow_raise(o);
     if (ret == MP_OBJ_STOP_ITERATION) {
+        if (MP_OBJ_IS_TYPE(o, &mp_type_gen_instance)) {
+            // a generator keeps its return value for us to raise with
+            mp_obj_t val = mp_obj_gen_take_return_value(o);
+            if (val != mp_const_none) {
+                nlr_raise(mp_obj_new_exception_args(&mp_type_StopIteration, 1, &val));
+            }
+        }
         nlr_raise(mp_obj_new_exception(&mp_type_StopIteration));
     } else {
         return ret;
@@ -394,7 +577,11 @@ STATIC mp_obj_t mp_builtin_pow(mp_uint_t n_args, const mp_obj_t *args) {
     assert(2 <= n_args && n_args <= 3);
     switch (n_args) {
         case 2: return mp_binary_op(MP_BINARY_OP_POWER, args[0], args[1]);
+        #if MICROPY_PY_BUILTINS_POW3
+        default: return mp_obj_int_pow3(args[0], args[1], args[2]);
+        #else
         default: return mp_binary_op(MP_BINARY_OP_MODULO, mp_binary_op(MP_BINARY_OP_POWER, args[0], args[1]), args[2]); // TODO optimise...
+        #endif
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_builtin_pow_obj, 2, 3, mp_builtin_pow);
@@ -459,9 +646,8 @@ STATIC mp_obj_t mp_builtin___repl_print__(mp_obj_t o) {
 MP_DEFINE_CONST_FUN_OBJ_1(mp_builtin___repl_print___obj, mp_builtin___repl_print__);
 
 STATIC mp_obj_t mp_builtin_repr(mp_obj_t o_in) {
-    vstr_t vstr;
-    mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    VSTR_SMALL(vstr);
+    mp_print_t print = {&vstr, (mp_print_strn_t)vstr_add_strn};
     mp_obj_print_helper(&print, o_in, PRINT_REPR);
     return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
 }
@@ -507,6 +693,115 @@ STATIC mp_obj_t mp_builtin_sum(mp_uint_t n_args, const mp_obj_t *args) {
         case 1: value = MP_OBJ_NEW_SMALL_INT(0); break;
         default: value = args[1]; break;
     }
+    #if MICROPY_OPT_NUMERIC_SEQ
+    if (MP_OBJ_IS_TYPE(args[0], &mp_type_list) || MP_OBJ_IS_TYPE(args[0], &mp_type_tuple)) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(args[0], &len, &items);
+        mp_uint_t i = 0;
+        // add up small ints while the total fits in a small int
+        if (MP_OBJ_IS_SMALL_INT(value)) {
+            mp_int_t total = MP_OBJ_SMALL_INT_VALUE(value);
+            for (; i < len && MP_OBJ_IS_SMALL_INT(items[i]); i++) {
+                mp_int_t t = total + MP_OBJ_SMALL_INT_VALUE(items[i]);
+                if (!MP_SMALL_INT_FITS(t)) {
+                    break;
+                }
+                total = t;
+            }
+            value = MP_OBJ_NEW_SMALL_INT(total);
+        }
+        #if MICROPY_PY_BUILTINS_FLOAT
+        // then add up floats (and small ints) as a C float
+        if (i < len && (MP_OBJ_IS_SMALL_INT(value) || mp_obj_is_float(value))
+            && (mp_obj_is_float(value) || mp_obj_is_float(items[i]))) {
+            mp_float_t total = mp_obj_get_float(value);
+            for (; i < len; i++) {
+                if (mp_obj_is_float(items[i])) {
+                    total += mp_obj_float_get(items[i]);
+                } else if (MP_OBJ_IS_SMALL_INT(items[i])) {
+                    total += MP_OBJ_SMALL_INT_VALUE(items[i]);
+                } else {
+                    break;
+                }
+            }
+            value = mp_obj_new_float(total);
+        }
+        #endif
+        // anything else goes through the generic add
+        for (; i < len; i++) {
+            value = mp_binary_op(MP_BINARY_OP_ADD, value, items[i]);
+        }
+        return value;
+    }
+    if (MP_OBJ_IS_TYPE(args[0], &mp_type_range) && MP_OBJ_IS_SMALL_INT(value)) {
+        // closed form: len * start + step * len * (len - 1) / 2
+        mp_int_t start, step;
+        mp_int_t len = mp_obj_range_get(args[0], &start, &step);
+        if (len == 0) {
+            return value;
+        }
+        mp_int_t a = len, b = len - 1;
+        if (a % 2 == 0) {
+            a /= 2;
+        } else {
+            b /= 2;
+        }
+        mp_obj_t tri = mp_binary_op(MP_BINARY_OP_MULTIPLY, mp_obj_new_int(a), mp_obj_new_int(b));
+        value = mp_binary_op(MP_BINARY_OP_ADD, value,
+            mp_binary_op(MP_BINARY_OP_MULTIPLY, mp_obj_new_int(start), mp_obj_new_int(len)));
+        return mp_binary_op(MP_BINARY_OP_ADD, value,
+            mp_binary_op(MP_BINARY_OP_MULTIPLY, mp_obj_new_int(step), tri));
+    }
+    mp_buffer_info_t bufinfo;
+    if ((MP_OBJ_IS_SMALL_INT(value)
+        #if MICROPY_PY_BUILTINS_FLOAT
+        || mp_obj_is_float(value)
+        #endif
+        ) && numeric_buf_get(args[0], &bufinfo)) {
+        mp_uint_t i = 0;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (bufinfo.len == 0) {
+            return value;
+        }
+        if (bufinfo.typecode == 'f' || bufinfo.typecode == 'd' || mp_obj_is_float(value)) {
+            // add up as a C float, with ints that fit in a small int
+            bool is_float_buf = bufinfo.typecode == 'f' || bufinfo.typecode == 'd';
+            mp_float_t total = mp_obj_get_float(value);
+            for (; i < bufinfo.len; i++) {
+                if (is_float_buf) {
+                    total += numeric_buf_get_float(bufinfo.typecode, bufinfo.buf, i);
+                } else {
+                    mp_int_t v;
+                    if (!numeric_buf_get_small_int(bufinfo.typecode, bufinfo.buf, i, &v)) {
+                        break;
+                    }
+                    total += v;
+                }
+            }
+            value = mp_obj_new_float(total);
+        } else
+        #endif
+        {
+            // add up while the total fits in a small int
+            mp_int_t total = MP_OBJ_SMALL_INT_VALUE(value);
+            mp_int_t v;
+            for (; i < bufinfo.len && numeric_buf_get_small_int(bufinfo.typecode, bufinfo.buf, i, &v); i++) {
+                mp_int_t t = total + v;
+                if (!MP_SMALL_INT_FITS(t)) {
+                    break;
+                }
+                total = t;
+            }
+            value = MP_OBJ_NEW_SMALL_INT(total);
+        }
+        // the rest (big ints) go through the generic add
+        for (; i < bufinfo.len; i++) {
+            value = mp_binary_op(MP_BINARY_OP_ADD, value, mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, i));
+        }
+        return value;
+    }
+    #endif
     mp_obj_t iterable = mp_getiter(args[0]);
     mp_obj_t item;
     while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
@@ -26,6 +26,7 @@
 
 #include "py/mpstate.h"
 #include "py/obj.h"
+#include "py/objtuple.h"
 #include "py/gc.h"
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
@@ -34,17 +35,45 @@
 
 extern uint gc_collected;
 
-/// \function collect()
-/// Run a garbage collection.
-STATIC mp_obj_t py_gc_collect(void) {
+/// \function collect([generation])
+/// Run a garbage collection.  If generation is 0 and the GC is generational
+/// then only a minor collection of recently allocated objects is done.
+STATIC mp_obj_t py_gc_collect(mp_uint_t n_args, const mp_obj_t *args) {
+#if MICROPY_GC_GENERATIONAL
+    if (n_args > 0 && mp_obj_get_int(args[0]) == 0) {
+        gc_collect_young();
+    } else {
+        gc_collect();
+    }
+#else
+    (void)n_args;
+    (void)args;
     gc_collect();
+#endif
 #if MICROPY_PY_GC_COLLECT_RETVAL
-    return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
+    mp_obj_t ret = MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
 #else
-    return mp_const_none;
+    mp_obj_t ret = mp_const_none;
 #endif
+#if MICROPY_GC_DEFERRED_FINALISERS
+    // finalise what was found unreachable before returning, as CPython does
+    gc_finalise_pending();
+#endif
+    return ret;
 }
-MP_DEFINE_CONST_FUN_OBJ_0(gc_collect_obj, py_gc_collect);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_collect_obj, 0, 1, py_gc_collect);
+
+#if MICROPY_GC_INCREMENTAL
+/// \function collect_step(budget)
+/// Do a bounded amount of incremental garbage collection work, scanning about
+/// `budget` heap blocks (16 bytes each on 32-bit machines).  Returns True if
+/// this call completed a full collection cycle.
+STATIC mp_obj_t py_gc_collect_step(mp_obj_t budget_in) {
+    mp_int_t budget = mp_obj_get_int(budget_in);
+    return MP_BOOL(gc_collect_step(budget < 0 ? 0 : budget));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(gc_collect_step_obj, py_gc_collect_step);
+#endif
 
 /// \function disable()
 /// Disable the garbage collector.
@@ -85,14 +114,83 @@ STATIC mp_obj_t gc_mem_alloc(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_alloc_obj, gc_mem_alloc);
 
+#if MICROPY_GC_ALLOC_THRESHOLD
+/// \function threshold([amount])
+/// Make an allocation collect first once `amount` bytes have been allocated
+/// since the last collection; -1 turns this off.  Without an argument, return
+/// the current amount.
+STATIC mp_obj_t gc_threshold(mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        if (MP_STATE_MEM(gc_alloc_threshold) == (size_t)-1) {
+            return MP_OBJ_NEW_SMALL_INT(-1);
+        }
+        return mp_obj_new_int_from_uint(MP_STATE_MEM(gc_alloc_threshold));
+    }
+    mp_int_t amount = mp_obj_get_int(args[0]);
+    MP_STATE_MEM(gc_alloc_threshold) = amount < 0 ? (size_t)-1 : (size_t)amount;
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_threshold_obj, 0, 1, gc_threshold);
+#endif
+
+#if MICROPY_GC_STATS
+#if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+#define NEW_TICKS(t) mp_obj_new_int_from_ull(t)
+#else
+#define NEW_TICKS(t) mp_obj_new_int_from_uint((mp_uint_t)(t))
+#endif
+
+/// \function stats()
+/// Return a named tuple of counters kept by the garbage collector: the number
+/// of collections, how many of them were triggered by an allocation, how many
+/// allocations failed, the bytes allocated since the last collection, the
+/// total and longest mark and sweep times, the longest pause, and a histogram
+/// of pause times.  Times are in the units of the port's CPU tick counter.
+STATIC mp_obj_t gc_stats(void) {
+    static const qstr stats_fields[] = {
+        MP_QSTR_collections, MP_QSTR_alloc_collections, MP_QSTR_alloc_failures,
+        MP_QSTR_alloc_bytes, MP_QSTR_mark_ticks, MP_QSTR_mark_max,
+        MP_QSTR_sweep_ticks, MP_QSTR_sweep_max, MP_QSTR_pause_max, MP_QSTR_pause_hist,
+    };
+    // copy the counters first, since making the result may collect
+    mp_gc_stats_t stats = MP_STATE_MEM(gc_stats);
+    mp_obj_t hist[MICROPY_GC_STATS_HIST_LEN];
+    for (mp_uint_t i = 0; i < MICROPY_GC_STATS_HIST_LEN; i++) {
+        hist[i] = mp_obj_new_int_from_uint(stats.pause_hist[i]);
+    }
+    mp_obj_t items[10];
+    items[0] = mp_obj_new_int_from_uint(stats.n_collect);
+    items[1] = mp_obj_new_int_from_uint(stats.n_collect_alloc);
+    items[2] = mp_obj_new_int_from_uint(stats.n_alloc_fail);
+    items[3] = mp_obj_new_int_from_uint(stats.alloc_bytes);
+    items[4] = NEW_TICKS(stats.mark_ticks);
+    items[5] = mp_obj_new_int_from_uint(stats.mark_max);
+    items[6] = NEW_TICKS(stats.sweep_ticks);
+    items[7] = mp_obj_new_int_from_uint(stats.sweep_max);
+    items[8] = mp_obj_new_int_from_uint(stats.pause_max);
+    items[9] = mp_obj_new_tuple(MICROPY_GC_STATS_HIST_LEN, hist);
+    return mp_obj_new_attrtuple(stats_fields, 10, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_stats_obj, gc_stats);
+#endif
+
 STATIC const mp_map_elem_t mp_module_gc_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_gc) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_collect), (mp_obj_t)&gc_collect_obj },
+    #if MICROPY_GC_INCREMENTAL
+    { MP_OBJ_NEW_QSTR(MP_QSTR_collect_step), (mp_obj_t)&gc_collect_step_obj },
+    #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_disable), (mp_obj_t)&gc_disable_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_enable), (mp_obj_t)&gc_enable_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_isenabled), (mp_obj_t)&gc_isenabled_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mem_free), (mp_obj_t)&gc_mem_free_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mem_alloc), (mp_obj_t)&gc_mem_alloc_obj },
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    { MP_OBJ_NEW_QSTR(MP_QSTR_threshold), (mp_obj_t)&gc_threshold_obj },
+    #endif
+    #if MICROPY_GC_STATS
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats), (mp_obj_t)&gc_stats_obj },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_gc_globals, mp_module_gc_globals_table);
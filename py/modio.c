@@ -24,13 +24,355 @@
  * THE SOFTWARE.
  */
 
+#include <errno.h>
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
 #include "py/builtin.h"
+#include "py/stream.h"
 
 #if MICROPY_PY_IO
 
 extern const mp_obj_type_t mp_type_fileio;
 extern const mp_obj_type_t mp_type_textio;
 
+#if MICROPY_PY_IO_BUFFERED
+
+// Buffered wrappers around any object with the stream protocol. The reader
+// fills its buffer with one underlying read at a time, so readline() costs
+// one read per buffer instead of one per byte; the writer collects small
+// writes and passes them on when the buffer fills or on flush().
+
+#define BUFIO_DEFAULT_SIZE (256)
+
+typedef struct _mp_obj_bufio_t {
+    mp_obj_base_t base;
+    mp_obj_t stream;
+    mp_uint_t alloc;
+    mp_uint_t pos; // reader only, start of unread data in buf
+    mp_uint_t len; // end of data in buf
+    byte buf[];
+} mp_obj_bufio_t;
+
+STATIC const mp_stream_p_t *bufio_get_stream(mp_obj_t stream, bool write) {
+    return mp_get_stream_raise(stream, write ? MP_STREAM_OP_WRITE : MP_STREAM_OP_READ);
+}
+
+STATIC mp_obj_t bufio_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args, bool write) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    bufio_get_stream(args[0], write);
+    mp_int_t alloc = BUFIO_DEFAULT_SIZE;
+    if (n_args > 1) {
+        alloc = mp_obj_get_int(args[1]);
+        if (alloc <= 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer size must be positive"));
+        }
+    }
+    mp_obj_bufio_t *o = m_new_obj_var(mp_obj_bufio_t, byte, alloc);
+    o->base.type = type_in;
+    o->stream = args[0];
+    o->alloc = alloc;
+    o->pos = 0;
+    o->len = 0;
+    return o;
+}
+
+// Call the underlying stream's close(), if it has one
+STATIC mp_obj_t bufio_close_stream(mp_obj_bufio_t *self) {
+    mp_obj_t dest[2];
+    mp_load_method_maybe(self->stream, MP_QSTR_close, dest);
+    if (dest[0] != MP_OBJ_NULL) {
+        return mp_call_method_n_kw(0, 0, dest);
+    }
+    return mp_const_none;
+}
+
+/******************************************************************************/
+// BufferedReader
+
+STATIC mp_obj_t bufreader_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    return bufio_make_new(type_in, n_args, n_kw, args, false);
+}
+
+// Refill the (empty) buffer with one read of the underlying stream
+STATIC mp_uint_t bufreader_fill(mp_obj_bufio_t *self, int *errcode) {
+    const mp_stream_p_t *stream_p = bufio_get_stream(self->stream, false);
+    mp_uint_t out_sz = stream_p->read(self->stream, self->buf, self->alloc, errcode);
+    self->pos = 0;
+    self->len = out_sz == MP_STREAM_ERROR ? 0 : out_sz;
+    return out_sz;
+}
+
+STATIC mp_uint_t bufreader_read(mp_obj_t self_in, void *buf_in, mp_uint_t size, int *errcode) {
+    mp_obj_bufio_t *self = self_in;
+    byte *buf = buf_in;
+    mp_uint_t done = 0;
+    while (done < size) {
+        mp_uint_t avail = self->len - self->pos;
+        if (avail == 0) {
+            mp_uint_t out_sz;
+            if (size - done >= self->alloc) {
+                // big request, read straight into the caller's buffer
+                const mp_stream_p_t *stream_p = bufio_get_stream(self->stream, false);
+                out_sz = stream_p->read(self->stream, buf + done, size - done, errcode);
+                if (out_sz != MP_STREAM_ERROR) {
+                    done += out_sz;
+                }
+            } else {
+                out_sz = bufreader_fill(self, errcode);
+            }
+            if (out_sz == MP_STREAM_ERROR) {
+                return done > 0 ? done : MP_STREAM_ERROR;
+            }
+            if (out_sz == 0) {
+                // EOF
+                break;
+            }
+            continue;
+        }
+        if (avail > size - done) {
+            avail = size - done;
+        }
+        memcpy(buf + done, self->buf + self->pos, avail);
+        self->pos += avail;
+        done += avail;
+    }
+    return done;
+}
+
+STATIC mp_uint_t bufreader_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t arg, int *errcode) {
+    mp_obj_bufio_t *self = self_in;
+    const mp_stream_p_t *stream_p = bufio_get_stream(self->stream, false);
+    if (stream_p->ioctl == NULL) {
+        *errcode = EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    if (request == MP_STREAM_SEEK) {
+        // buffered data is dropped, and a relative seek is made from the
+        // position the caller sees rather than that of the stream
+        struct mp_stream_seek_t *s = (struct mp_stream_seek_t*)arg;
+        if (s->whence == 1) {
+            s->offset -= self->len - self->pos;
+        }
+        self->pos = self->len = 0;
+    }
+    return stream_p->ioctl(self->stream, request, arg, errcode);
+}
+
+STATIC mp_obj_t bufreader_readline(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_bufio_t *self = args[0];
+    mp_int_t max_size = -1;
+    if (n_args > 1) {
+        max_size = mp_obj_get_int(args[1]);
+    }
+    vstr_t vstr;
+    vstr_init(&vstr, 16);
+    while (max_size != 0) {
+        if (self->pos == self->len) {
+            int error;
+            mp_uint_t out_sz = bufreader_fill(self, &error);
+            if (out_sz == MP_STREAM_ERROR) {
+                if (mp_is_nonblocking_error(error) && vstr.len == 0) {
+                    vstr_clear(&vstr);
+                    return mp_const_none;
+                } else if (!mp_is_nonblocking_error(error)) {
+                    nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error)));
+                }
+                break;
+            }
+            if (out_sz == 0) {
+                break;
+            }
+        }
+        const byte *start = self->buf + self->pos;
+        mp_uint_t n = self->len - self->pos;
+        if (max_size > 0 && (mp_uint_t)max_size < n) {
+            n = max_size;
+        }
+        const byte *nl = memchr(start, '\n', n);
+        if (nl != NULL) {
+            n = nl - start + 1;
+        }
+        vstr_add_strn(&vstr, (const char*)start, n);
+        self->pos += n;
+        if (max_size > 0) {
+            max_size -= n;
+        }
+        if (nl != NULL) {
+            break;
+        }
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bufreader_readline_obj, 1, 2, bufreader_readline);
+
+STATIC mp_obj_t bufreader_iternext(mp_obj_t self_in) {
+    mp_obj_t line = bufreader_readline(1, &self_in);
+    if (mp_obj_is_true(line)) {
+        return line;
+    }
+    return MP_OBJ_STOP_ITERATION;
+}
+
+// Return buffered data without consuming it, reading from the stream only
+// if the buffer is empty; the argument is accepted but, as in CPython, the
+// amount returned is whatever is buffered
+STATIC mp_obj_t bufreader_peek(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_bufio_t *self = args[0];
+    (void)n_args;
+    if (self->pos == self->len) {
+        int error;
+        if (bufreader_fill(self, &error) == MP_STREAM_ERROR && !mp_is_nonblocking_error(error)) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error)));
+        }
+    }
+    return mp_obj_new_bytes(self->buf + self->pos, self->len - self->pos);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bufreader_peek_obj, 1, 2, bufreader_peek);
+
+STATIC mp_obj_t bufreader_close(mp_obj_t self_in) {
+    mp_obj_bufio_t *self = self_in;
+    self->pos = self->len = 0;
+    return bufio_close_stream(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bufreader_close_obj, bufreader_close);
+
+STATIC const mp_map_elem_t bufreader_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&mp_stream_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&bufreader_readline_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_peek), (mp_obj_t)&bufreader_peek_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_seek), (mp_obj_t)&mp_stream_seek_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&bufreader_close_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(bufreader_locals_dict, bufreader_locals_dict_table);
+
+STATIC const mp_stream_p_t bufreader_stream_p = {
+    .read = bufreader_read,
+    .ioctl = bufreader_ioctl,
+};
+
+STATIC const mp_obj_type_t bufreader_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_BufferedReader,
+    .make_new = bufreader_make_new,
+    .getiter = mp_identity,
+    .iternext = bufreader_iternext,
+    .stream_p = &bufreader_stream_p,
+    .locals_dict = (mp_obj_t)&bufreader_locals_dict,
+};
+
+/******************************************************************************/
+// BufferedWriter
+
+STATIC mp_obj_t bufwriter_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    return bufio_make_new(type_in, n_args, n_kw, args, true);
+}
+
+// Write all of buf to the underlying stream, which may take several writes
+STATIC mp_uint_t bufwriter_write_all(mp_obj_bufio_t *self, const byte *buf, mp_uint_t size, int *errcode) {
+    if (mp_stream_rw_into(self->stream, (byte*)buf, size, errcode, MP_STREAM_RW_WRITE) != size) {
+        if (*errcode == 0) {
+            *errcode = EIO;
+        }
+        return MP_STREAM_ERROR;
+    }
+    return size;
+}
+
+STATIC mp_uint_t bufwriter_flush_buf(mp_obj_bufio_t *self, int *errcode) {
+    if (self->len > 0) {
+        if (bufwriter_write_all(self, self->buf, self->len, errcode) == MP_STREAM_ERROR) {
+            return MP_STREAM_ERROR;
+        }
+        self->len = 0;
+    }
+    return 0;
+}
+
+STATIC mp_uint_t bufwriter_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_bufio_t *self = self_in;
+    if (self->len + size > self->alloc) {
+        if (bufwriter_flush_buf(self, errcode) == MP_STREAM_ERROR) {
+            return MP_STREAM_ERROR;
+        }
+    }
+    if (size >= self->alloc) {
+        // too big to be worth buffering
+        return bufwriter_write_all(self, buf, size, errcode);
+    }
+    memcpy(self->buf + self->len, buf, size);
+    self->len += size;
+    return size;
+}
+
+STATIC mp_uint_t bufwriter_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t arg, int *errcode) {
+    mp_obj_bufio_t *self = self_in;
+    if (request == MP_STREAM_FLUSH || request == MP_STREAM_SEEK) {
+        if (bufwriter_flush_buf(self, errcode) == MP_STREAM_ERROR) {
+            return MP_STREAM_ERROR;
+        }
+    }
+    const mp_stream_p_t *stream_p = bufio_get_stream(self->stream, true);
+    if (stream_p->ioctl == NULL) {
+        if (request == MP_STREAM_FLUSH) {
+            return 0;
+        }
+        *errcode = EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    return stream_p->ioctl(self->stream, request, arg, errcode);
+}
+
+STATIC mp_obj_t bufwriter_flush(mp_obj_t self_in) {
+    mp_obj_bufio_t *self = self_in;
+    int error;
+    if (bufwriter_flush_buf(self, &error) == MP_STREAM_ERROR) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error)));
+    }
+    // let the stream flush its own buffers too, if it can
+    mp_obj_t dest[2];
+    mp_load_method_maybe(self->stream, MP_QSTR_flush, dest);
+    if (dest[0] != MP_OBJ_NULL) {
+        mp_call_method_n_kw(0, 0, dest);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bufwriter_flush_obj, bufwriter_flush);
+
+STATIC mp_obj_t bufwriter_close(mp_obj_t self_in) {
+    bufwriter_flush(self_in);
+    return bufio_close_stream(self_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bufwriter_close_obj, bufwriter_close);
+
+STATIC const mp_map_elem_t bufwriter_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_flush), (mp_obj_t)&bufwriter_flush_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_seek), (mp_obj_t)&mp_stream_seek_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&bufwriter_close_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(bufwriter_locals_dict, bufwriter_locals_dict_table);
+
+STATIC const mp_stream_p_t bufwriter_stream_p = {
+    .write = bufwriter_write,
+    .ioctl = bufwriter_ioctl,
+};
+
+STATIC const mp_obj_type_t bufwriter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_BufferedWriter,
+    .make_new = bufwriter_make_new,
+    .stream_p = &bufwriter_stream_p,
+    .locals_dict = (mp_obj_t)&bufwriter_locals_dict,
+};
+
+#endif // MICROPY_PY_IO_BUFFERED
+
 STATIC const mp_map_elem_t mp_module_io_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR__io) },
     // Note: mp_builtin_open_obj should be defined by port, it's not
@@ -46,6 +388,10 @@ STATIC const mp_map_elem_t mp_module_io_globals_table[] = {
     #if MICROPY_PY_IO_BYTESIO
     { MP_OBJ_NEW_QSTR(MP_QSTR_BytesIO), (mp_obj_t)&mp_type_bytesio },
     #endif
+    #if MICROPY_PY_IO_BUFFERED
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BufferedReader), (mp_obj_t)&bufreader_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BufferedWriter), (mp_obj_t)&bufwriter_type },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_io_globals, mp_module_io_globals_table);
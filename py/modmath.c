@@ -24,6 +24,10 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
 #include "py/builtin.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT && MICROPY_PY_MATH
@@ -52,11 +56,13 @@
     STATIC mp_obj_t mp_math_ ## py_name(mp_obj_t x_obj) { mp_int_t x = MICROPY_FLOAT_C_FUN(c_name)(mp_obj_get_float(x_obj)); return mp_obj_new_int(x); } \
     STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_## py_name ## _obj, mp_math_ ## py_name);
 
-// These are also used by cmath.c
+// These are also used by cmath.c, via mp_const_float_e and mp_const_float_pi
+#if MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_C && MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_D
 /// \constant e - base of the natural logarithm
 const mp_obj_float_t mp_math_e_obj = {{&mp_type_float}, M_E};
 /// \constant pi - the ratio of a circle's circumference to its diameter
 const mp_obj_float_t mp_math_pi_obj = {{&mp_type_float}, M_PI};
+#endif
 
 /// \function sqrt(x)
 /// Returns the square root of `x`.
@@ -134,7 +140,268 @@ MATH_FUN_1(gamma, tgamma)
 /// return the natural logarithm of the gamma function of `x`.
 MATH_FUN_1(lgamma, lgamma)
 #endif
-//TODO: factorial, fsum
+//TODO: factorial
+
+/// \function fsum(iterable)
+/// Returns an accurate sum of the floats in `iterable`, without the rounding
+/// error that accumulates in `sum`.
+// This is Shewchuk's algorithm, as used by CPython: the running sum is kept
+// exactly as a list of non-overlapping partial sums.
+STATIC mp_obj_t mp_math_fsum(mp_obj_t iterable) {
+    mp_float_t partials_stack[32];
+    mp_float_t *p = partials_stack;
+    mp_uint_t alloc = MP_ARRAY_SIZE(partials_stack);
+    mp_uint_t n = 0;
+    mp_float_t special_sum = 0;
+    mp_float_t inf_sum = 0;
+
+    mp_obj_t iter = mp_getiter(iterable);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_float_t x = mp_obj_get_float(item);
+        if (!isfinite(x)) {
+            // infinities and nans are summed separately
+            if (isinf(x)) {
+                inf_sum += x;
+            }
+            special_sum += x;
+            continue;
+        }
+        mp_uint_t i = 0;
+        for (mp_uint_t j = 0; j < n; j++) {
+            mp_float_t y = p[j];
+            if (MICROPY_FLOAT_C_FUN(fabs)(x) < MICROPY_FLOAT_C_FUN(fabs)(y)) {
+                mp_float_t t = x;
+                x = y;
+                y = t;
+            }
+            mp_float_t hi = x + y;
+            mp_float_t lo = y - (hi - x);
+            if (lo != 0) {
+                p[i++] = lo;
+            }
+            x = hi;
+        }
+        if (!isfinite(x)) {
+            if (p != partials_stack) {
+                m_del(mp_float_t, p, alloc);
+            }
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OverflowError, "intermediate overflow in fsum"));
+        }
+        n = i;
+        if (n >= alloc) {
+            mp_float_t *p2 = m_new(mp_float_t, alloc * 2);
+            memcpy(p2, p, n * sizeof(mp_float_t));
+            if (p != partials_stack) {
+                m_del(mp_float_t, p, alloc);
+            }
+            p = p2;
+            alloc *= 2;
+        }
+        p[n++] = x;
+    }
+
+    mp_float_t hi = 0;
+    if (special_sum != 0) {
+        if (isnan(inf_sum)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "-inf + inf in fsum"));
+        }
+        hi = special_sum;
+    } else if (n > 0) {
+        // sum the partials from the top, stopping when the sum is inexact
+        mp_float_t lo = 0;
+        hi = p[--n];
+        while (n > 0) {
+            mp_float_t x = hi;
+            mp_float_t y = p[--n];
+            hi = x + y;
+            lo = y - (hi - x);
+            if (lo != 0) {
+                break;
+            }
+        }
+        // make half-way cases round correctly, using the next partial's sign
+        if (n > 0 && ((lo < 0 && p[n - 1] < 0) || (lo > 0 && p[n - 1] > 0))) {
+            mp_float_t y = lo * 2;
+            mp_float_t x = hi + y;
+            if (y == x - hi) {
+                hi = x;
+            }
+        }
+    }
+    if (p != partials_stack) {
+        m_del(mp_float_t, p, alloc);
+    }
+    return mp_obj_new_float(hi);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_fsum_obj, mp_math_fsum);
+
+/// \function hypot(*coordinates)
+/// Returns the Euclidean norm `sqrt(sum(x*x for x in coordinates))`.
+STATIC mp_obj_t mp_math_hypot(mp_uint_t n_args, const mp_obj_t *args) {
+    // scale by the largest magnitude, so that squaring can't overflow or underflow
+    mp_float_t max = 0;
+    bool found_nan = false;
+    for (mp_uint_t i = 0; i < n_args; i++) {
+        mp_float_t x = MICROPY_FLOAT_C_FUN(fabs)(mp_obj_get_float(args[i]));
+        if (isnan(x)) {
+            found_nan = true;
+        } else if (x > max) {
+            max = x;
+        }
+    }
+    if (isinf(max) || max == 0) {
+        return mp_obj_new_float(max);
+    }
+    if (found_nan) {
+        return mp_obj_new_float(NAN);
+    }
+    mp_float_t sum = 0;
+    for (mp_uint_t i = 0; i < n_args; i++) {
+        mp_float_t x = mp_obj_get_float(args[i]) / max;
+        sum += x * x;
+    }
+    return mp_obj_new_float(max * MICROPY_FLOAT_C_FUN(sqrt)(sum));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(mp_math_hypot_obj, 0, mp_math_hypot);
+
+#if MICROPY_PY_MATH_ARRAY_FUNCTIONS
+
+// Array functions work on the buffer of an array('f') or array('d'), so that
+// a whole block of samples is processed without creating a float object for
+// each element.  Elements are computed at the precision of mp_float_t.
+
+STATIC mp_uint_t math_get_float_buffer(mp_obj_t obj, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_get_buffer_raise(obj, bufinfo, flags);
+    if (bufinfo->typecode == 'f') {
+        return bufinfo->len / sizeof(float);
+    } else if (bufinfo->typecode == 'd') {
+        return bufinfo->len / sizeof(double);
+    }
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "expecting a float array"));
+}
+
+STATIC inline mp_float_t math_buf_get(const mp_buffer_info_t *bufinfo, mp_uint_t i) {
+    if (bufinfo->typecode == 'f') {
+        return ((float*)bufinfo->buf)[i];
+    } else {
+        return ((double*)bufinfo->buf)[i];
+    }
+}
+
+STATIC inline void math_buf_set(const mp_buffer_info_t *bufinfo, mp_uint_t i, mp_float_t x) {
+    if (bufinfo->typecode == 'f') {
+        ((float*)bufinfo->buf)[i] = x;
+    } else {
+        ((double*)bufinfo->buf)[i] = x;
+    }
+}
+
+// get the destination buffer, making a new array like src if none is given
+STATIC mp_obj_t math_get_dest_buffer(mp_uint_t n_args, const mp_obj_t *args, const mp_buffer_info_t *src, mp_uint_t len, mp_buffer_info_t *dest) {
+    mp_obj_t dest_obj;
+    if (n_args > 2) {
+        dest_obj = args[2];
+    } else {
+        dest_obj = mp_obj_new_array(src->typecode, len);
+    }
+    if (math_get_float_buffer(dest_obj, dest, MP_BUFFER_WRITE) != len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "arrays must be the same length"));
+    }
+    return dest_obj;
+}
+
+typedef struct _math_array_fun_t {
+    const mp_obj_fun_builtin_t *fun_obj;
+    mp_float_t (*fun)(mp_float_t);
+} math_array_fun_t;
+
+// math functions that apply() calls directly, rather than through the object
+STATIC const math_array_fun_t math_array_fun_table[] = {
+    { &mp_math_sqrt_obj, MICROPY_FLOAT_C_FUN(sqrt) },
+    { &mp_math_exp_obj, MICROPY_FLOAT_C_FUN(exp) },
+    { &mp_math_log_obj, MICROPY_FLOAT_C_FUN(log) },
+    { &mp_math_cos_obj, MICROPY_FLOAT_C_FUN(cos) },
+    { &mp_math_sin_obj, MICROPY_FLOAT_C_FUN(sin) },
+    { &mp_math_tan_obj, MICROPY_FLOAT_C_FUN(tan) },
+    { &mp_math_atan_obj, MICROPY_FLOAT_C_FUN(atan) },
+    { &mp_math_tanh_obj, MICROPY_FLOAT_C_FUN(tanh) },
+    { &mp_math_fabs_obj, MICROPY_FLOAT_C_FUN(fabs) },
+};
+
+/// \function apply(fun, src[, dest])
+/// Applies `fun` to each element of the float array `src`, storing the
+/// results in `dest`, or in a new array if `dest` is not given.  Returns the
+/// destination array.  `dest` may be `src`.  For math functions such as `sin`, `cos`, `exp` and
+/// `sqrt` the loop runs entirely in C.
+STATIC mp_obj_t mp_math_apply(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t src, dest;
+    mp_uint_t len = math_get_float_buffer(args[1], &src, MP_BUFFER_READ);
+    mp_obj_t dest_obj = math_get_dest_buffer(n_args, args, &src, len, &dest);
+
+    for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(math_array_fun_table); i++) {
+        if (args[0] == (mp_obj_t)math_array_fun_table[i].fun_obj) {
+            mp_float_t (*fun)(mp_float_t) = math_array_fun_table[i].fun;
+            for (mp_uint_t j = 0; j < len; j++) {
+                math_buf_set(&dest, j, fun(math_buf_get(&src, j)));
+            }
+            return dest_obj;
+        }
+    }
+
+    // any other callable is called with each element
+    for (mp_uint_t j = 0; j < len; j++) {
+        mp_obj_t y = mp_call_function_1(args[0], mp_obj_new_float(math_buf_get(&src, j)));
+        math_buf_set(&dest, j, mp_obj_get_float(y));
+    }
+    return dest_obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_math_apply_obj, 2, 3, mp_math_apply);
+
+/// \function polyval(coeffs, x[, dest])
+/// Evaluates the polynomial with coefficients `coeffs`, highest power first,
+/// at `x` using Horner's rule.  If `x` is a float array then the polynomial
+/// is evaluated at each element, and the results are stored in `dest`, or in
+/// a new array if `dest` is not given, and the destination array is returned.
+STATIC mp_obj_t mp_math_polyval(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_uint_t n_coeffs;
+    mp_obj_t *coeff_objs;
+    mp_obj_get_array(args[0], &n_coeffs, &coeff_objs);
+
+    mp_buffer_info_t src;
+    if (!mp_get_buffer(args[1], &src, MP_BUFFER_READ)) {
+        // a single value
+        mp_float_t x = mp_obj_get_float(args[1]);
+        mp_float_t acc = 0;
+        for (mp_uint_t k = 0; k < n_coeffs; k++) {
+            acc = acc * x + mp_obj_get_float(coeff_objs[k]);
+        }
+        return mp_obj_new_float(acc);
+    }
+
+    mp_buffer_info_t dest;
+    mp_uint_t len = math_get_float_buffer(args[1], &src, MP_BUFFER_READ);
+    mp_obj_t dest_obj = math_get_dest_buffer(n_args, args, &src, len, &dest);
+
+    // convert the coefficients once, rather than for every sample
+    mp_float_t *c = m_new(mp_float_t, n_coeffs);
+    for (mp_uint_t k = 0; k < n_coeffs; k++) {
+        c[k] = mp_obj_get_float(coeff_objs[k]);
+    }
+    for (mp_uint_t j = 0; j < len; j++) {
+        mp_float_t x = math_buf_get(&src, j);
+        mp_float_t acc = 0;
+        for (mp_uint_t k = 0; k < n_coeffs; k++) {
+            acc = acc * x + c[k];
+        }
+        math_buf_set(&dest, j, acc);
+    }
+    m_del(mp_float_t, c, n_coeffs);
+    return dest_obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_math_polyval_obj, 2, 3, mp_math_polyval);
+
+#endif // MICROPY_PY_MATH_ARRAY_FUNCTIONS
 
 // Functions that return a tuple
 
@@ -177,8 +444,8 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_degrees_obj, mp_math_degrees);
 
 STATIC const mp_map_elem_t mp_module_math_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_math) },
-    { MP_OBJ_NEW_QSTR(MP_QSTR_e), (mp_obj_t)&mp_math_e_obj },
-    { MP_OBJ_NEW_QSTR(MP_QSTR_pi), (mp_obj_t)&mp_math_pi_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_e), mp_const_float_e },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pi), mp_const_float_pi },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sqrt), (mp_obj_t)&mp_math_sqrt_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pow), (mp_obj_t)&mp_math_pow_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_exp), (mp_obj_t)&mp_math_exp_obj },
@@ -213,6 +480,12 @@ STATIC const mp_map_elem_t mp_module_math_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_trunc), (mp_obj_t)&mp_math_trunc_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_radians), (mp_obj_t)&mp_math_radians_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_degrees), (mp_obj_t)&mp_math_degrees_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fsum), (mp_obj_t)&mp_math_fsum_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hypot), (mp_obj_t)&mp_math_hypot_obj },
+    #if MICROPY_PY_MATH_ARRAY_FUNCTIONS
+    { MP_OBJ_NEW_QSTR(MP_QSTR_apply), (mp_obj_t)&mp_math_apply_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_polyval), (mp_obj_t)&mp_math_polyval_obj },
+    #endif
     #if MICROPY_PY_MATH_SPECIAL_FUNCTIONS
     { MP_OBJ_NEW_QSTR(MP_QSTR_erf), (mp_obj_t)&mp_math_erf_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_erfc), (mp_obj_t)&mp_math_erfc_obj },
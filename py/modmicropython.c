@@ -25,11 +25,16 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/mpstate.h"
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/runtime.h"
+#include "py/bc.h"
+#include "py/objlist.h"
+#include "py/objtuple.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -60,10 +65,25 @@ mp_obj_t mp_micropython_mem_info(mp_uint_t n_args, const mp_obj_t *args) {
         (mp_uint_t)m_get_total_bytes_allocated(), (mp_uint_t)m_get_current_bytes_allocated(), (mp_uint_t)m_get_peak_bytes_allocated());
 #endif
 #if MICROPY_STACK_CHECK
-    mp_printf(&mp_plat_print, "stack: " UINT_FMT " out of " INT_FMT "\n", mp_stack_usage(), MP_STATE_VM(stack_limit));
+    mp_printf(&mp_plat_print, "stack: " UINT_FMT " out of " INT_FMT "\n", mp_stack_usage(), MP_STATE_THREAD(stack_limit));
 #else
     mp_printf(&mp_plat_print, "stack: " UINT_FMT "\n", mp_stack_usage());
 #endif
+#if MICROPY_OPT_CODE_STATE_CACHE
+    mp_printf(&mp_plat_print, "code_state cache: hit=" UINT_FMT ", miss=" UINT_FMT "\n",
+        MP_STATE_VM(code_state_cache_hit), MP_STATE_VM(code_state_cache_miss));
+#endif
+#if MICROPY_GC_OBJ_POOLS
+    {
+        static const char *const pool_names[MP_OBJ_NUM_POOLS] = {"float", "tuple2", "bound_meth", "range_it", "list"};
+        mp_printf(&mp_plat_print, "object pools (hit/miss):");
+        for (mp_uint_t p = 0; p < MP_OBJ_NUM_POOLS; p++) {
+            mp_printf(&mp_plat_print, " %s=" UINT_FMT "/" UINT_FMT, pool_names[p],
+                MP_STATE_MEM(gc_pool_hit)[p], MP_STATE_MEM(gc_pool_miss)[p]);
+        }
+        mp_printf(&mp_plat_print, "\n");
+    }
+#endif
 #if MICROPY_ENABLE_GC
     gc_dump_info();
     if (n_args == 1) {
@@ -91,8 +111,219 @@ STATIC mp_obj_t mp_micropython_qstr_info(mp_uint_t n_args, const mp_obj_t *args)
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_qstr_info_obj, 0, 1, mp_micropython_qstr_info);
 
+#if MICROPY_GC_HEAP_PROFILE
+// Returns a list of (file, function, line, live_count, live_bytes, total_count)
+// tuples, one for each allocation site; file and function are None for
+// allocations made outside of bytecode, or once the site table is full.
+STATIC mp_obj_t mp_micropython_heap_profile(void) {
+    mp_uint_t *n_live = m_new(mp_uint_t, 2 * MICROPY_GC_HEAP_PROFILE_SITES);
+    mp_uint_t *n_live_bytes = n_live + MICROPY_GC_HEAP_PROFILE_SITES;
+    gc_heap_profile(n_live, n_live_bytes);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (mp_uint_t i = 0; i < MP_STATE_MEM(gc_profile_num_sites); i++) {
+        const mp_gc_profile_site_t *site = &MP_STATE_MEM(gc_profile_site)[i];
+        if (n_live[i] == 0 && site->n_alloc == 0) {
+            continue;
+        }
+        mp_obj_t tuple[6] = {
+            site->source_file == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(site->source_file),
+            site->block_name == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(site->block_name),
+            MP_OBJ_NEW_SMALL_INT(site->source_line),
+            mp_obj_new_int_from_uint(n_live[i]),
+            mp_obj_new_int_from_uint(n_live_bytes[i]),
+            mp_obj_new_int_from_uint(site->n_alloc),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(6, tuple));
+    }
+    m_del(mp_uint_t, n_live, 2 * MICROPY_GC_HEAP_PROFILE_SITES);
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_heap_profile_obj, mp_micropython_heap_profile);
+#endif
+
 #endif // MICROPY_PY_MICROPYTHON_MEM_INFO
 
+#if MICROPY_EMIT_NATIVE_JIT
+// Get or set the number of calls plus loop iterations after which a bytecode
+// function is promoted to native code; 0 disables promotion.
+STATIC mp_obj_t mp_micropython_jit_threshold(mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_int_from_uint(MP_STATE_VM(jit_threshold));
+    } else {
+        MP_STATE_VM(jit_threshold) = mp_obj_get_int(args[0]);
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_jit_threshold_obj, 0, 1, mp_micropython_jit_threshold);
+#endif
+
+#if MICROPY_VM_PROFILE
+// Start (clearing the counts) or stop the VM profiler.  The function table is
+// only emptied when no recorded function is running, so running ones keep
+// their entries.
+STATIC mp_obj_t mp_micropython_profile(mp_obj_t enable_in) {
+    bool enable = mp_obj_is_true(enable_in);
+    if (enable) {
+        mp_vm_profile_func_t *table = MP_STATE_VM(vm_profile_func);
+        bool running = false;
+        for (mp_uint_t i = 0; i <= MICROPY_VM_PROFILE_FUNCS; i++) {
+            running |= table[i].depth != 0;
+        }
+        for (mp_uint_t i = 0; i <= MICROPY_VM_PROFILE_FUNCS; i++) {
+            if (!running) {
+                table[i].code_info = NULL;
+            }
+            table[i].n_calls = 0;
+            table[i].self_ticks = 0;
+            table[i].total_ticks = 0;
+        }
+    }
+    MP_STATE_VM(vm_profile_enabled) = enable;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_profile_obj, mp_micropython_profile);
+
+// Returns a list of (file, function, line, calls, self_ticks, total_ticks)
+// tuples, one for each bytecode function called while profiling; file and
+// function are None for the time of functions that didn't fit in the table.
+// The line is that of the function's first statement, and ticks are in the
+// units of mp_hal_ticks_cpu().
+STATIC mp_obj_t mp_micropython_profile_stats(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (mp_uint_t i = 0; i <= MICROPY_VM_PROFILE_FUNCS; i++) {
+        const mp_vm_profile_func_t *func = &MP_STATE_VM(vm_profile_func)[i];
+        if (func->n_calls == 0) {
+            continue;
+        }
+        mp_obj_t tuple[6] = {
+            mp_const_none,
+            mp_const_none,
+            MP_OBJ_NEW_SMALL_INT(0),
+            mp_obj_new_int_from_uint(func->n_calls),
+            mp_obj_new_int_from_ull(func->self_ticks),
+            mp_obj_new_int_from_ull(func->total_ticks),
+        };
+        if (func->code_info != NULL) {
+            qstr block_name, source_file;
+            mp_uint_t line = mp_bytecode_get_first_line(func->code_info, &block_name, &source_file);
+            tuple[0] = MP_OBJ_NEW_QSTR(source_file);
+            tuple[1] = MP_OBJ_NEW_QSTR(block_name);
+            tuple[2] = MP_OBJ_NEW_SMALL_INT(line);
+        }
+        mp_obj_list_append(list, mp_obj_new_tuple(6, tuple));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_stats_obj, mp_micropython_profile_stats);
+#endif
+
+#if MICROPY_VM_SAMPLE_PROFILE
+// Start sampling the VM every period_us microseconds, clearing the counts, or
+// stop it if the period is 0.  The port's timer may round the period.
+STATIC mp_obj_t mp_micropython_sample(mp_obj_t period_in) {
+    mp_int_t period = mp_obj_get_int(period_in);
+    MP_STATE_VM(vm_sample_enabled) = false;
+    mp_hal_sample_timer(0);
+    if (period > 0) {
+        memset(MP_STATE_VM(vm_sample), 0, sizeof(MP_STATE_VM(vm_sample)));
+        MP_STATE_VM(vm_sample_enabled) = true;
+        mp_hal_sample_timer(period);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_sample_obj, mp_micropython_sample);
+
+// Returns a list of (file, function, line, samples) tuples, one for each
+// source line that was sampled; file and function are None for the samples
+// taken outside bytecode, or that didn't fit in the table.  Native code is
+// counted at the line of the bytecode that called it.
+STATIC mp_obj_t mp_micropython_sample_stats(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    mp_obj_list_t *l = list;
+    for (mp_uint_t i = 0; i <= MICROPY_VM_SAMPLE_PROFILE_SLOTS; i++) {
+        const mp_vm_sample_t *s = &MP_STATE_VM(vm_sample)[i];
+        mp_uint_t count = s->count;
+        const byte *code_info = s->code_info;
+        if (count == 0 || (code_info == NULL && i < MICROPY_VM_SAMPLE_PROFILE_SLOTS)) {
+            continue;
+        }
+        mp_obj_t tuple[4] = {
+            mp_const_none,
+            mp_const_none,
+            MP_OBJ_NEW_SMALL_INT(0),
+            mp_obj_new_int_from_uint(count),
+        };
+        if (code_info != NULL) {
+            qstr block_name, source_file;
+            mp_uint_t line = mp_bytecode_get_source_line(code_info, s->ip, &block_name, &source_file);
+            tuple[0] = MP_OBJ_NEW_QSTR(source_file);
+            tuple[1] = MP_OBJ_NEW_QSTR(block_name);
+            tuple[2] = MP_OBJ_NEW_SMALL_INT(line);
+        }
+        // positions on the same line are added together
+        mp_uint_t j;
+        for (j = 0; j < l->len; j++) {
+            mp_obj_tuple_t *t = l->items[j];
+            if (t->items[0] == tuple[0] && t->items[1] == tuple[1] && t->items[2] == tuple[2]) {
+                t->items[3] = mp_obj_new_int_from_uint(mp_obj_get_int(t->items[3]) + count);
+                break;
+            }
+        }
+        if (j == l->len) {
+            mp_obj_list_append(list, mp_obj_new_tuple(4, tuple));
+        }
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_sample_stats_obj, mp_micropython_sample_stats);
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+// Print the most frequently executed opcodes and opcode pairs, 20 of each
+// unless a number is given.
+STATIC mp_obj_t mp_micropython_opcode_stats(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_uint_t n = n_args == 0 ? 20 : mp_obj_get_int(args[0]);
+    mp_bytecode_print_opcode_stats(&mp_plat_print, n);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_opcode_stats_obj, 0, 1, mp_micropython_opcode_stats);
+#endif
+
+#if MICROPY_ENABLE_SCHEDULER
+// Queue a call of function(arg) to be run by the VM as soon as possible.
+// Does not allocate, so it can be used from an IRQ handler.
+STATIC mp_obj_t mp_micropython_schedule(mp_obj_t function, mp_obj_t arg) {
+    if (!mp_sched_schedule(function, arg)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "schedule queue full"));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_micropython_schedule_obj, mp_micropython_schedule);
+#endif
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+// Forget the directory listings cached by import, eg after files were
+// added by something other than this interpreter
+STATIC mp_obj_t mp_micropython_import_cache_clear(void) {
+    mp_import_cache_clear();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_import_cache_clear_obj, mp_micropython_import_cache_clear);
+#endif
+
+// opt_level([level]) gets or sets the optimisation level used when compiling
+// scripts, as -O does on unix.  At level 3 the line number tables are left
+// out of the bytecode: tracebacks still give the file and function, and it
+// saves RAM on production firmware.
+STATIC mp_obj_t mp_micropython_opt_level(mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_OBJ_NEW_SMALL_INT(MP_STATE_VM(mp_optimise_value));
+    }
+    MP_STATE_VM(mp_optimise_value) = mp_obj_get_int(args[0]);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_opt_level_obj, 0, 1, mp_micropython_opt_level);
+
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_alloc_emergency_exception_buf_obj, mp_alloc_emergency_exception_buf);
 #endif
@@ -107,6 +338,30 @@ STATIC const mp_map_elem_t mp_module_micropython_globals_table[] = {
 #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_mem_info), (mp_obj_t)&mp_micropython_mem_info_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_qstr_info), (mp_obj_t)&mp_micropython_qstr_info_obj },
+#if MICROPY_GC_HEAP_PROFILE
+    { MP_OBJ_NEW_QSTR(MP_QSTR_heap_profile), (mp_obj_t)&mp_micropython_heap_profile_obj },
+#endif
+#endif
+    { MP_OBJ_NEW_QSTR(MP_QSTR_opt_level), (mp_obj_t)&mp_micropython_opt_level_obj },
+#if MICROPY_EMIT_NATIVE_JIT
+    { MP_OBJ_NEW_QSTR(MP_QSTR_jit_threshold), (mp_obj_t)&mp_micropython_jit_threshold_obj },
+#endif
+#if MICROPY_VM_PROFILE
+    { MP_OBJ_NEW_QSTR(MP_QSTR_profile), (mp_obj_t)&mp_micropython_profile_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_profile_stats), (mp_obj_t)&mp_micropython_profile_stats_obj },
+#endif
+#if MICROPY_VM_SAMPLE_PROFILE
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sample), (mp_obj_t)&mp_micropython_sample_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sample_stats), (mp_obj_t)&mp_micropython_sample_stats_obj },
+#endif
+#if MICROPY_VM_OPCODE_STATS
+    { MP_OBJ_NEW_QSTR(MP_QSTR_opcode_stats), (mp_obj_t)&mp_micropython_opcode_stats_obj },
+#endif
+#if MICROPY_ENABLE_SCHEDULER
+    { MP_OBJ_NEW_QSTR(MP_QSTR_schedule), (mp_obj_t)&mp_micropython_schedule_obj },
+#endif
+#if MICROPY_MODULE_LISTDIR_CACHE
+    { MP_OBJ_NEW_QSTR(MP_QSTR_import_cache_clear), (mp_obj_t)&mp_micropython_import_cache_clear_obj },
 #endif
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
     { MP_OBJ_NEW_QSTR(MP_QSTR_alloc_emergency_exception_buf), (mp_obj_t)&mp_alloc_emergency_exception_buf_obj },
@@ -28,6 +28,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include "py/nlr.h"
+#include "py/runtime.h"
 #include "py/builtin.h"
 #include "py/objtuple.h"
 #include "py/binary.h"
@@ -92,9 +94,23 @@ STATIC uint calcsize_items(const char *fmt) {
     return cnt;
 }
 
-STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
+// A format string parsed once: the module-level functions build one of these
+// on the stack for each call, and struct.Struct keeps one around for reuse.
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t fmt_obj;
+    const char *fmt; // format with the byte order char stripped
+    mp_uint_t size;
+    uint n_items;
+    char fmt_type;
+} mp_obj_struct_t;
+
+STATIC void struct_compile(mp_obj_struct_t *self, mp_obj_t fmt_in) {
     const char *fmt = mp_obj_str_get_str(fmt_in);
-    char fmt_type = get_fmt_type(&fmt);
+    self->fmt_obj = fmt_in;
+    self->fmt_type = get_fmt_type(&fmt);
+    self->fmt = fmt;
+    self->n_items = calcsize_items(fmt);
     mp_uint_t size;
     for (size = 0; *fmt; fmt++) {
         mp_uint_t align = 1;
@@ -111,7 +127,7 @@ STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
         if (*fmt == 's') {
             sz = cnt;
         } else {
-            sz = (mp_uint_t)mp_binary_get_size(fmt_type, *fmt, &align);
+            sz = (mp_uint_t)mp_binary_get_size(self->fmt_type, *fmt, &align);
         }
         // TODO
         assert(sz != (mp_uint_t)-1);
@@ -119,21 +135,42 @@ STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
         size = (size + align - 1) & ~(align - 1);
         size += sz;
     }
-    return MP_OBJ_NEW_SMALL_INT(size);
+    self->size = size;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(struct_calcsize_obj, struct_calcsize);
 
-STATIC mp_obj_t struct_unpack(mp_obj_t fmt_in, mp_obj_t data_in) {
-    // TODO: "The buffer must contain exactly the amount of data required by the format (len(bytes) must equal calcsize(fmt))."
-    const char *fmt = mp_obj_str_get_str(fmt_in);
-    char fmt_type = get_fmt_type(&fmt);
-    uint size = calcsize_items(fmt);
-    mp_obj_tuple_t *res = mp_obj_new_tuple(size, NULL);
+// Get a pointer to the buffer at the given offset (negative counts from the
+// end) and the end of the buffer, checking the struct fits at that offset.
+STATIC byte *struct_get_buf(const mp_obj_struct_t *self, mp_obj_t buf_in, mp_int_t offset, mp_uint_t flags, byte **end) {
     mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
-    byte *p = bufinfo.buf;
+    mp_get_buffer_raise(buf_in, &bufinfo, flags);
+    if (offset < 0) {
+        offset += bufinfo.len;
+    }
+    if (offset < 0 || (mp_uint_t)offset + self->size > bufinfo.len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+    *end = (byte*)bufinfo.buf + bufinfo.len;
+    return (byte*)bufinfo.buf + offset;
+}
+
+// Check that an item of size sz fits before end, after applying native
+// alignment, which mp_binary_get_val/set_val do relative to the address.
+STATIC void struct_check_item(const mp_obj_struct_t *self, char val_type, mp_uint_t sz, byte *p, byte *end) {
+    if (self->fmt_type == '@' && val_type != 's') {
+        mp_uint_t align;
+        sz = mp_binary_get_size('@', val_type, &align);
+        p = (byte*)(((mp_uint_t)p + align - 1) & ~((mp_uint_t)align - 1));
+    }
+    if (p + sz > end) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+}
+
+STATIC mp_obj_t struct_unpack_internal(const mp_obj_struct_t *self, byte *p, byte *end) {
+    const char *fmt = self->fmt;
+    mp_obj_tuple_t *res = mp_obj_new_tuple(self->n_items, NULL);
 
-    for (uint i = 0; i < size; i++) {
+    for (uint i = 0; i < self->n_items; i++) {
         mp_uint_t sz = 1;
         if (unichar_isdigit(*fmt)) {
             sz = get_fmt_num(&fmt);
@@ -142,31 +179,38 @@ STATIC mp_obj_t struct_unpack(mp_obj_t fmt_in, mp_obj_t data_in) {
             // TODO: size spec support only for string len
             assert(*fmt == 's');
         }
+        struct_check_item(self, *fmt, sz, p, end);
         mp_obj_t item;
         if (*fmt == 's') {
             item = mp_obj_new_bytes(p, sz);
             p += sz;
             fmt++;
         } else {
-            item = mp_binary_get_val(fmt_type, *fmt++, &p);
+            item = mp_binary_get_val(self->fmt_type, *fmt++, &p);
         }
         res->items[i] = item;
     }
     return res;
 }
-MP_DEFINE_CONST_FUN_OBJ_2(struct_unpack_obj, struct_unpack);
 
-STATIC mp_obj_t struct_pack(mp_uint_t n_args, const mp_obj_t *args) {
-    // TODO: "The arguments must match the values required by the format exactly."
-    const char *fmt = mp_obj_str_get_str(args[0]);
-    char fmt_type = get_fmt_type(&fmt);
-    mp_int_t size = MP_OBJ_SMALL_INT_VALUE(struct_calcsize(args[0]));
-    vstr_t vstr;
-    vstr_init_len(&vstr, size);
-    byte *p = (byte*)vstr.buf;
-    memset(p, 0, size);
+// unpack and Struct.unpack take exactly the bytes of the values, unlike
+// unpack_from which can be given a longer buffer
+STATIC mp_obj_t struct_unpack_exact(const mp_obj_struct_t *self, mp_obj_t data_in) {
+    byte *end;
+    byte *p = struct_get_buf(self, data_in, 0, MP_BUFFER_READ, &end);
+    if ((mp_uint_t)(end - p) != self->size) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer size must match format"));
+    }
+    return struct_unpack_internal(self, p, end);
+}
 
-    for (mp_uint_t i = 1; i < n_args; i++) {
+STATIC void struct_pack_internal(const mp_obj_struct_t *self, byte *p, byte *end, mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args != self->n_items) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "wrong number of values"));
+    }
+    const char *fmt = self->fmt;
+
+    for (mp_uint_t i = 0; i < n_args; i++) {
         mp_uint_t sz = 1;
         if (unichar_isdigit(*fmt)) {
             sz = get_fmt_num(&fmt);
@@ -175,6 +219,7 @@ STATIC mp_obj_t struct_pack(mp_uint_t n_args, const mp_obj_t *args) {
             // TODO: size spec support only for string len
             assert(*fmt == 's');
         }
+        struct_check_item(self, *fmt, sz, p, end);
 
         if (*fmt == 's') {
             mp_buffer_info_t bufinfo;
@@ -188,19 +233,145 @@ STATIC mp_obj_t struct_pack(mp_uint_t n_args, const mp_obj_t *args) {
             p += sz;
             fmt++;
         } else {
-            mp_binary_set_val(fmt_type, *fmt++, args[i], &p);
+            mp_binary_set_val(self->fmt_type, *fmt++, args[i], &p);
         }
     }
+}
 
+STATIC mp_obj_t struct_pack_new(const mp_obj_struct_t *self, mp_uint_t n_args, const mp_obj_t *args) {
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->size);
+    byte *p = (byte*)vstr.buf;
+    memset(p, 0, self->size);
+    struct_pack_internal(self, p, p + self->size, n_args, args);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
+
+STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
+    mp_obj_struct_t s;
+    struct_compile(&s, fmt_in);
+    return MP_OBJ_NEW_SMALL_INT(s.size);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(struct_calcsize_obj, struct_calcsize);
+
+STATIC mp_obj_t struct_unpack(mp_obj_t fmt_in, mp_obj_t data_in) {
+    mp_obj_struct_t s;
+    struct_compile(&s, fmt_in);
+    return struct_unpack_exact(&s, data_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(struct_unpack_obj, struct_unpack);
+
+// unpack_from(fmt, buffer, offset=0)
+STATIC mp_obj_t struct_unpack_from(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t s;
+    struct_compile(&s, args[0]);
+    mp_int_t offset = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    byte *end;
+    byte *p = struct_get_buf(&s, args[1], offset, MP_BUFFER_READ, &end);
+    return struct_unpack_internal(&s, p, end);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_unpack_from_obj, 2, 3, struct_unpack_from);
+
+STATIC mp_obj_t struct_pack(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t s;
+    struct_compile(&s, args[0]);
+    return struct_pack_new(&s, n_args - 1, args + 1);
+}
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_pack);
 
+// pack_into(fmt, buffer, offset, v1, v2, ...)
+STATIC mp_obj_t struct_pack_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t s;
+    struct_compile(&s, args[0]);
+    byte *end;
+    byte *p = struct_get_buf(&s, args[1], mp_obj_get_int(args[2]), MP_BUFFER_WRITE, &end);
+    struct_pack_internal(&s, p, end, n_args - 3, args + 3);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
+
+/******************************************************************************/
+// Struct class
+
+STATIC mp_obj_t struct_obj_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_obj_struct_t *o = m_new_obj(mp_obj_struct_t);
+    o->base.type = type_in;
+    struct_compile(o, args[0]);
+    return o;
+}
+
+STATIC mp_obj_t struct_obj_pack(mp_uint_t n_args, const mp_obj_t *args) {
+    return struct_pack_new(args[0], n_args - 1, args + 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack);
+
+STATIC mp_obj_t struct_obj_pack_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = args[0];
+    byte *end;
+    byte *p = struct_get_buf(self, args[1], mp_obj_get_int(args[2]), MP_BUFFER_WRITE, &end);
+    struct_pack_internal(self, p, end, n_args - 3, args + 3);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack_into);
+
+STATIC mp_obj_t struct_obj_unpack(mp_obj_t self_in, mp_obj_t data_in) {
+    return struct_unpack_exact(self_in, data_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(struct_obj_unpack_obj, struct_obj_unpack);
+
+STATIC mp_obj_t struct_obj_unpack_from(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_int_t offset = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    byte *end;
+    byte *p = struct_get_buf(args[0], args[1], offset, MP_BUFFER_READ, &end);
+    return struct_unpack_internal(args[0], p, end);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_from_obj, 2, 3, struct_obj_unpack_from);
+
+STATIC const mp_map_elem_t struct_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pack), (mp_obj_t)&struct_obj_pack_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pack_into), (mp_obj_t)&struct_obj_pack_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unpack), (mp_obj_t)&struct_obj_unpack_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unpack_from), (mp_obj_t)&struct_obj_unpack_from_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(struct_locals_dict, struct_locals_dict_table);
+
+// provides the size and format attributes as well as the methods
+STATIC void struct_obj_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not load attribute
+        return;
+    }
+    mp_obj_struct_t *self = self_in;
+    if (attr == MP_QSTR_size) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+    } else if (attr == MP_QSTR_format) {
+        dest[0] = self->fmt_obj;
+    } else {
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&struct_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            dest[0] = elem->value;
+            dest[1] = self_in;
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .make_new = struct_obj_make_new,
+    .attr = struct_obj_attr,
+};
+
 STATIC const mp_map_elem_t mp_module_struct_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ustruct) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_calcsize), (mp_obj_t)&struct_calcsize_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pack), (mp_obj_t)&struct_pack_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_unpack), (mp_obj_t)&struct_unpack_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pack_into), (mp_obj_t)&struct_pack_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unpack_from), (mp_obj_t)&struct_unpack_from_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Struct), (mp_obj_t)&struct_type },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
@@ -54,14 +54,14 @@ STATIC const MP_DEFINE_STR_OBJ(version_obj, "3.4.0");
 /// \constant version_info - Python language version that this implementation conforms to, as a tuple of ints
 #define I(n) MP_OBJ_NEW_SMALL_INT(n)
 // TODO: CPython is now at 5-element array, but save 2 els so far...
-STATIC const mp_obj_tuple_t mp_sys_version_info_obj = {{&mp_type_tuple}, 3, {I(3), I(4), I(0)}};
+STATIC const mp_obj_tuple_t mp_sys_version_info_obj = {.base = {&mp_type_tuple}, .len = 3, .items = {I(3), I(4), I(0)}};
 
 // sys.implementation object
 // this holds the MicroPython version
 STATIC const mp_obj_tuple_t mp_sys_implementation_version_info_obj = {
-    {&mp_type_tuple},
-    3,
-    { I(MICROPY_VERSION_MAJOR), I(MICROPY_VERSION_MINOR), I(MICROPY_VERSION_MICRO) }
+    .base = {&mp_type_tuple},
+    .len = 3,
+    .items = { I(MICROPY_VERSION_MAJOR), I(MICROPY_VERSION_MINOR), I(MICROPY_VERSION_MICRO) }
 };
 #if MICROPY_PY_ATTRTUPLE
 STATIC const qstr impl_fields[] = { MP_QSTR_name, MP_QSTR_version };
@@ -74,9 +74,9 @@ STATIC MP_DEFINE_ATTRTUPLE(
 );
 #else
 STATIC const mp_obj_tuple_t mp_sys_implementation_obj = {
-    {&mp_type_tuple},
-    2,
-    {
+    .base = {&mp_type_tuple},
+    .len = 2,
+    .items = {
         MP_OBJ_NEW_QSTR(MP_QSTR_micropython),
         (mp_obj_t)&mp_sys_implementation_version_info_obj,
     }
@@ -123,7 +123,7 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_sys_print_exception_obj, 1, 2, mp_sys_pri
 
 #if MICROPY_PY_SYS_EXC_INFO
 STATIC mp_obj_t mp_sys_exc_info(void) {
-    mp_obj_t cur_exc = MP_STATE_VM(cur_exception);
+    mp_obj_t cur_exc = MP_STATE_THREAD(cur_exception);
     mp_obj_tuple_t *t = mp_obj_new_tuple(3, NULL);
 
     if (cur_exc == MP_OBJ_NULL) {
@@ -144,8 +144,11 @@ MP_DEFINE_CONST_FUN_OBJ_0(mp_sys_exc_info_obj, mp_sys_exc_info);
 STATIC const mp_map_elem_t mp_module_sys_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_sys) },
 
+#if !MICROPY_MULTIPLE_INTERPRETERS
+    // with multiple interpreters these are looked up by module_attr
     { MP_OBJ_NEW_QSTR(MP_QSTR_path), (mp_obj_t)&MP_STATE_VM(mp_sys_path_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_argv), (mp_obj_t)&MP_STATE_VM(mp_sys_argv_obj) },
+#endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_version), (mp_obj_t)&version_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_version_info), (mp_obj_t)&mp_sys_version_info_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_implementation), (mp_obj_t)&mp_sys_implementation_obj },
@@ -0,0 +1,292 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+#include "py/stackctrl.h"
+
+#if MICROPY_PY_THREAD
+
+/****************************************************************/
+// _thread lock type
+
+typedef struct _mp_obj_thread_lock_t {
+    mp_obj_base_t base;
+    mp_thread_mutex_t mutex;
+    volatile bool locked;
+} mp_obj_thread_lock_t;
+
+STATIC const mp_obj_type_t mp_type_thread_lock;
+
+STATIC mp_obj_thread_lock_t *mp_obj_new_thread_lock(void) {
+    mp_obj_thread_lock_t *self = m_new_obj(mp_obj_thread_lock_t);
+    self->base.type = &mp_type_thread_lock;
+    mp_thread_mutex_init(&self->mutex);
+    self->locked = false;
+    return self;
+}
+
+/// \method acquire([waitflag])
+/// Acquire the lock, waiting for it (without holding the GIL) unless
+/// waitflag is 0.  Returns True if the lock was acquired.
+STATIC mp_obj_t thread_lock_acquire(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_thread_lock_t *self = args[0];
+    bool wait = true;
+    if (n_args > 1) {
+        wait = mp_obj_get_int(args[1]) != 0;
+    }
+    int ret = mp_thread_mutex_lock(&self->mutex, 0);
+    if (ret == 0 && wait) {
+        MP_THREAD_GIL_EXIT();
+        ret = mp_thread_mutex_lock(&self->mutex, 1);
+        MP_THREAD_GIL_ENTER();
+    }
+    if (ret < 0) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(-ret)));
+    }
+    if (ret == 0) {
+        return mp_const_false;
+    }
+    self->locked = true;
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(thread_lock_acquire_obj, 1, 2, thread_lock_acquire);
+
+/// \method release()
+/// Release the lock, which may have been acquired by another thread.
+STATIC mp_obj_t thread_lock_release(mp_obj_t self_in) {
+    mp_obj_thread_lock_t *self = self_in;
+    if (!self->locked) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "release unlocked lock"));
+    }
+    self->locked = false;
+    mp_thread_mutex_unlock(&self->mutex);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_lock_release_obj, thread_lock_release);
+
+STATIC mp_obj_t thread_lock_locked(mp_obj_t self_in) {
+    mp_obj_thread_lock_t *self = self_in;
+    return MP_BOOL(self->locked);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(thread_lock_locked_obj, thread_lock_locked);
+
+STATIC mp_obj_t thread_lock___exit__(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return thread_lock_release(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(thread_lock___exit___obj, 4, 4, thread_lock___exit__);
+
+STATIC const mp_map_elem_t thread_lock_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_acquire), (mp_obj_t)&thread_lock_acquire_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_release), (mp_obj_t)&thread_lock_release_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_locked), (mp_obj_t)&thread_lock_locked_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___enter__), (mp_obj_t)&thread_lock_acquire_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___exit__), (mp_obj_t)&thread_lock___exit___obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(thread_lock_locals_dict, thread_lock_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_thread_lock = {
+    { &mp_type_type },
+    .name = MP_QSTR_lock,
+    .locals_dict = (mp_obj_t)&thread_lock_locals_dict,
+};
+
+/****************************************************************/
+// _thread module
+
+// stack size of new threads, 0 for the port's default
+STATIC mp_uint_t thread_stack_size = 0;
+
+// The function to run in a new thread and its arguments, kept alive by the
+// port until the thread has finished.
+typedef struct _thread_entry_args_t {
+    mp_obj_dict_t *dict_locals;
+    mp_obj_dict_t *dict_globals;
+    mp_uint_t stack_size;
+    mp_obj_t fun;
+    mp_uint_t n_args;
+    mp_uint_t n_kw;
+    mp_obj_t args[];
+} thread_entry_args_t;
+
+// Run the thread's function; this must have a stack frame below the thread's
+// state so that the objects it refers to are found by the GC.
+STATIC MP_NOINLINE void thread_run(thread_entry_args_t *args) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_call_function_n_kw(args->fun, args->n_args, args->n_kw, args->args);
+        nlr_pop();
+    } else {
+        // uncaught exception; SystemExit just ends the thread
+        mp_obj_base_t *exc = nlr.ret_val;
+        if (!mp_obj_is_subclass_fast(exc->type, &mp_type_SystemExit)) {
+            mp_printf(&mp_plat_print, "Unhandled exception in thread started by ");
+            mp_obj_print_helper(&mp_plat_print, args->fun, PRINT_REPR);
+            mp_printf(&mp_plat_print, "\n");
+            mp_obj_print_exception(&mp_plat_print, exc);
+        }
+    }
+}
+
+STATIC void *thread_entry(void *args_in) {
+    thread_entry_args_t *args = args_in;
+
+    // the state of this thread lives on its stack, just above the frames
+    // that use it
+    mp_state_thread_t ts;
+    mp_thread_set_state(&ts);
+    mp_stack_set_top(&ts + 1);
+    ts.nlr_top = NULL;
+    #if MICROPY_PY_SYS_EXC_INFO
+    ts.cur_exception = MP_OBJ_NULL;
+    #endif
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    ts.current_code_state = NULL;
+    #endif
+    #if MICROPY_VM_PROFILE
+    ts.vm_profile_depth = 0;
+    #endif
+    #if MICROPY_STACKLESS && MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    ts.frame_pool_top = (byte*)ts.frame_pool;
+    #endif
+
+    // args is on the heap, so it can only be read with the GIL held (the
+    // heap may be gone if the interpreter exited before this thread ran)
+    MP_THREAD_GIL_ENTER();
+    mp_stack_set_limit(args->stack_size - 1024);
+
+    // the new thread runs in the context of the one that started it
+    ts.dict_locals = args->dict_locals;
+    ts.dict_globals = args->dict_globals;
+
+    thread_run(args);
+
+    // releases the GIL
+    mp_thread_finish();
+    return NULL;
+}
+
+/// \function start_new_thread(function, args[, kwargs])
+/// Start a thread calling function(*args, **kwargs).  Returns None.
+STATIC mp_obj_t mod_thread_start_new_thread(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_uint_t pos_args_len;
+    mp_obj_t *pos_args_items;
+    if (!MP_OBJ_IS_TYPE(args[1], &mp_type_tuple)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "expecting a tuple of args"));
+    }
+    mp_obj_get_array(args[1], &pos_args_len, &pos_args_items);
+
+    mp_map_t *kw_map = NULL;
+    if (n_args > 2) {
+        if (!MP_OBJ_IS_TYPE(args[2], &mp_type_dict)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "expecting a dict for keyword args"));
+        }
+        kw_map = mp_obj_dict_get_map(args[2]);
+    }
+
+    // positional args followed by keyword (name, value) pairs, as taken by
+    // mp_call_function_n_kw
+    mp_uint_t n_kw = kw_map == NULL ? 0 : kw_map->used;
+    thread_entry_args_t *th_args = m_new_obj_var(thread_entry_args_t, mp_obj_t, pos_args_len + 2 * n_kw);
+    th_args->dict_locals = mp_locals_get();
+    th_args->dict_globals = mp_globals_get();
+    th_args->stack_size = thread_stack_size;
+    th_args->fun = args[0];
+    th_args->n_args = pos_args_len;
+    th_args->n_kw = n_kw;
+    memcpy(th_args->args, pos_args_items, pos_args_len * sizeof(mp_obj_t));
+    if (kw_map != NULL) {
+        mp_obj_t *kw = th_args->args + pos_args_len;
+        for (mp_uint_t i = 0; i < kw_map->alloc; i++) {
+            if (MP_MAP_SLOT_IS_FILLED(kw_map, i)) {
+                *kw++ = kw_map->table[i].key;
+                *kw++ = kw_map->table[i].value;
+            }
+        }
+    }
+
+    // the port sets the stack size it actually uses before the thread starts
+    mp_thread_create(thread_entry, th_args, &th_args->stack_size);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_start_new_thread_obj, 2, 3, mod_thread_start_new_thread);
+
+/// \function get_ident()
+/// Return a nonzero integer identifying the current thread.
+STATIC mp_obj_t mod_thread_get_ident(void) {
+    return mp_obj_new_int_from_uint((mp_uint_t)mp_thread_get_state());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_get_ident_obj, mod_thread_get_ident);
+
+/// \function allocate_lock()
+/// Return a new lock object, initially unlocked.
+STATIC mp_obj_t mod_thread_allocate_lock(void) {
+    return mp_obj_new_thread_lock();
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_allocate_lock_obj, mod_thread_allocate_lock);
+
+/// \function stack_size([size])
+/// Return the stack size of new threads, and set it if size is given; 0
+/// means the port's default.
+STATIC mp_obj_t mod_thread_stack_size(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t ret = mp_obj_new_int_from_uint(thread_stack_size);
+    if (n_args > 0) {
+        thread_stack_size = mp_obj_get_int(args[0]);
+    }
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_stack_size_obj, 0, 1, mod_thread_stack_size);
+
+/// \function exit()
+/// End the calling thread, by raising SystemExit.
+STATIC mp_obj_t mod_thread_exit(void) {
+    nlr_raise(mp_obj_new_exception(&mp_type_SystemExit));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_exit_obj, mod_thread_exit);
+
+STATIC const mp_map_elem_t mp_module_thread_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR__thread) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_LockType), (mp_obj_t)&mp_type_thread_lock },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_start_new_thread), (mp_obj_t)&mod_thread_start_new_thread_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get_ident), (mp_obj_t)&mod_thread_get_ident_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_allocate_lock), (mp_obj_t)&mod_thread_allocate_lock_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stack_size), (mp_obj_t)&mod_thread_stack_size_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_exit), (mp_obj_t)&mod_thread_exit_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_thread_globals, mp_module_thread_globals_table);
+
+const mp_obj_module_t mp_module_thread = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR__thread,
+    .globals = (mp_obj_dict_t*)&mp_module_thread_globals,
+};
+
+#endif // MICROPY_PY_THREAD
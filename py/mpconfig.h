@@ -63,6 +63,30 @@
 //  - xxxx...xxx0 : a pointer to an mp_obj_base_t (unless a fake object)
 #define MICROPY_OBJ_REPR_B (1)
 
+// A Micro Python object is a 64-bit word having the following form (the
+// top 16 bits select the kind of object):
+//  - 0000 xxxx...xxxx : a pointer to an mp_obj_base_t (unless a fake object)
+//  - 0001 xxxx...xxxx : a small int, the low 48 bits are the value
+//  - 0002 0000 xxxx...xxxx : a qstr, the low 32 bits are the value
+//  - 0004 to ffff : a double stored in-place, with 0x8004000000000000 added
+// So floats don't need to be allocated on the heap.  This requires 64-bit
+// words, double precision floats and pointers that fit in 48 bits.  A NaN
+// whose encoding would overlap the first 3 forms is stored as the canonical
+// (quiet) NaN instead.
+#define MICROPY_OBJ_REPR_C (2)
+
+// A Micro Python object is a 32-bit word having the following form:
+//  - iiiiiiii iiiiiiii iiiiiiii iiiiiii1 : a small int, bits 1 and above are the value
+//  - 00000000 0qqqqqqq qqqqqqqq qqqqq110 : a qstr, bits 3 and above are the value
+//  - xxxxxxxx xxxxxxxx xxxxxxxx xxxxxx10 : otherwise, a float (see below)
+//  - pppppppp pppppppp pppppppp pppppp00 : a pointer to an mp_obj_base_t (unless a fake object)
+// A float is stored as its single precision bits with the 2 lowest mantissa
+// bits dropped, plus 0x80800000.  The only floats that then have their top
+// 9 bits clear are positive infinity and NaNs, and a NaN that would look like
+// a qstr is stored as the canonical (quiet) NaN.  This requires 32-bit words
+// and single precision floats; floats don't need to be allocated on the heap.
+#define MICROPY_OBJ_REPR_D (3)
+
 #ifndef MICROPY_OBJ_REPR
 #define MICROPY_OBJ_REPR (MICROPY_OBJ_REPR_A)
 #endif
@@ -105,6 +129,12 @@
 #define MICROPY_ALLOC_PARSE_RESULT_INC (16)
 #endif
 
+// Minimum size of the chunks that parse nodes and compiler scopes are
+// allocated from; they are all freed together when compilation finishes
+#ifndef MICROPY_ALLOC_PARSE_CHUNK_INIT
+#define MICROPY_ALLOC_PARSE_CHUNK_INIT (128)
+#endif
+
 // Strings this length or less will be interned by the parser
 #ifndef MICROPY_ALLOC_PARSE_INTERN_STRING_LEN
 #define MICROPY_ALLOC_PARSE_INTERN_STRING_LEN (10)
@@ -120,12 +150,30 @@
 #define MICROPY_ALLOC_SCOPE_ID_INC (6)
 #endif
 
+// Initial size of the chunks that qstr data is packed into; if 0 then each
+// qstr gets its own allocation.  Qstrs this long or longer are never packed.
+#ifndef MICROPY_ALLOC_QSTR_CHUNK_INIT
+#define MICROPY_ALLOC_QSTR_CHUNK_INIT (0)
+#endif
+
 // Maximum length of a path in the filesystem
 // So we can allocate a buffer on the stack for path manipulation in import
 #ifndef MICROPY_ALLOC_PATH_MAX
 #define MICROPY_ALLOC_PATH_MAX (512)
 #endif
 
+// Size of the stack buffer that temporary vstrs (eg for repr and str) start
+// in; they only go to the heap if the text doesn't fit
+#ifndef MICROPY_ALLOC_VSTR_SMALL
+#define MICROPY_ALLOC_VSTR_SMALL (32)
+#endif
+
+// A growing vstr is resized to n + (n >> shift) bytes when it needs n bytes,
+// so 0 doubles it, 1 grows it by half and 2 by a quarter
+#ifndef MICROPY_ALLOC_VSTR_GROWTH_SHIFT
+#define MICROPY_ALLOC_VSTR_GROWTH_SHIFT (0)
+#endif
+
 // Initial size of module dict
 #ifndef MICROPY_MODULE_DICT_SIZE
 #define MICROPY_MODULE_DICT_SIZE (1)
@@ -144,6 +192,25 @@
 #define MICROPY_QSTR_BYTES_IN_LEN (1)
 #endif
 
+// Number of bytes used to store qstr hash (1, 2 or 4)
+// A 1-byte hash saves RAM for each qstr but gives more false matches to
+// check when looking a qstr up.  str and bytes objects have the same hash
+// as qstrs, so dicts with very many str keys want a 4-byte hash.
+#ifndef MICROPY_QSTR_BYTES_IN_HASH
+#define MICROPY_QSTR_BYTES_IN_HASH (2)
+#endif
+
+// Hash function of qstrs and of str and bytes objects, one of:
+//  - djb2 a byte at a time, which is the smallest code
+//  - FNV-1a a 4-byte word at a time, with a final mixing step so that the
+//    low bits (which pick a hash table slot) depend on all the data
+#define MICROPY_QSTR_HASH_DJB2 (0)
+#define MICROPY_QSTR_HASH_FNV1A_WORD (1)
+
+#ifndef MICROPY_QSTR_HASH
+#define MICROPY_QSTR_HASH (MICROPY_QSTR_HASH_DJB2)
+#endif
+
 // Avoid using C stack when making Python function calls. C stack still
 // may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
@@ -157,9 +224,34 @@
 #define MICROPY_STACKLESS_STRICT (0)
 #endif
 
+// Size in bytes of the pool that frames for stackless calls are taken from, in
+// LIFO order; if it's exhausted (or 0) frames are allocated on the heap
+#ifndef MICROPY_STACKLESS_FRAME_POOL_SIZE
+#define MICROPY_STACKLESS_FRAME_POOL_SIZE (2048)
+#endif
+
 /*****************************************************************************/
 /* Micro Python emitters                                                     */
 
+// Whether to support loading of persistent code (precompiled .mpy files)
+#ifndef MICROPY_PERSISTENT_CODE_LOAD
+#define MICROPY_PERSISTENT_CODE_LOAD (0)
+#endif
+
+// Whether to support saving of persistent code, eg for a cross compiler
+#ifndef MICROPY_PERSISTENT_CODE_SAVE
+#define MICROPY_PERSISTENT_CODE_SAVE (0)
+#endif
+
+// Whether generated bytecode can be persisted.  If enabled, qstrs in the
+// bytecode are stored as fixed 2-byte values, and constant objects and raw
+// code are referenced through a per-function table instead of by pointer, so
+// the bytecode doesn't depend on the word size or memory layout of the VM.
+// Frozen bytecode (see MICROPY_MODULE_FROZEN_MPY) is in this format too.
+#ifndef MICROPY_PERSISTENT_CODE
+#define MICROPY_PERSISTENT_CODE (MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE || MICROPY_MODULE_FROZEN_MPY)
+#endif
+
 // Whether to emit CPython byte codes (for debugging/testing)
 // Enabling this overrides all other emitters
 #ifndef MICROPY_EMIT_CPYTHON
@@ -191,17 +283,57 @@
 #define MICROPY_EMIT_INLINE_THUMB_FLOAT (1)
 #endif
 
+// Whether viper supports an unboxed float type, using the FPU of the target:
+// SSE2 on x64 (needs double floats), VFP on Thumb2 (needs single floats)
+#ifndef MICROPY_EMIT_NATIVE_FLOAT
+#define MICROPY_EMIT_NATIVE_FLOAT (0)
+#endif
+
 // Whether to emit ARM native code
 #ifndef MICROPY_EMIT_ARM
 #define MICROPY_EMIT_ARM (0)
 #endif
 
+// Whether to emit Xtensa native code (for the call0 ABI of the LX106)
+#ifndef MICROPY_EMIT_XTENSA
+#define MICROPY_EMIT_XTENSA (0)
+#endif
+
 // Convenience definition for whether any native emitter is enabled
-#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM)
+#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA)
+
+// Whether to automatically recompile hot bytecode functions to native code;
+// the function is re-parsed from its source file, which must still be readable
+#ifndef MICROPY_EMIT_NATIVE_JIT
+#define MICROPY_EMIT_NATIVE_JIT (0)
+#endif
+
+// Default number of calls plus loop iterations of a bytecode function after
+// which it is promoted to native code (0 disables promotion)
+#ifndef MICROPY_EMIT_NATIVE_JIT_THRESHOLD
+#define MICROPY_EMIT_NATIVE_JIT_THRESHOLD (1000)
+#endif
+
+// Whether the native emitter passes the address, size and qualified name of
+// each function it generates to mp_hal_perf_map_add(), which the port must
+// provide and declare in its mpconfigport.h, so that profilers such as Linux
+// perf can name native code
+#ifndef MICROPY_EMIT_NATIVE_PERF_MAP
+#define MICROPY_EMIT_NATIVE_PERF_MAP (0)
+#endif
 
 /*****************************************************************************/
 /* Compiler configuration                                                    */
 
+// Whether mp_parse_compile_execute, used by import and exec, should parse,
+// compile and run a file one top-level statement at a time, freeing the parse
+// tree of each statement before the next one is parsed.  Peak memory then
+// depends on the largest statement instead of the whole file, but a syntax
+// error is only raised once it's reached, after the code before it has run.
+#ifndef MICROPY_PARSE_STREAMING
+#define MICROPY_PARSE_STREAMING (0)
+#endif
+
 // Whether to enable lookup of constants in modules; eg module.CONST
 #ifndef MICROPY_COMP_MODULE_CONST
 #define MICROPY_COMP_MODULE_CONST (0)
@@ -212,6 +344,13 @@
 #define MICROPY_COMP_CONST (1)
 #endif
 
+// Whether to fold constant expressions on objects other than small ints;
+// eg floats, strings, bytes and tuples.  They are evaluated by the runtime
+// at compile time and stored as constant objects in the bytecode.
+#ifndef MICROPY_COMP_CONST_FOLDING_OBJ
+#define MICROPY_COMP_CONST_FOLDING_OBJ (0)
+#endif
+
 // Whether to enable optimisation of: a, b = c, d
 // Costs 124 bytes (Thumb2)
 #ifndef MICROPY_COMP_DOUBLE_TUPLE_ASSIGN
@@ -224,6 +363,13 @@
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (0)
 #endif
 
+// Whether a parameter that is closed over but never assigned to again (nor
+// declared nonlocal in an inner function) is passed to the closure by value,
+// instead of being put in a cell on each call
+#ifndef MICROPY_COMP_CLOSURE_BY_VALUE
+#define MICROPY_COMP_CLOSURE_BY_VALUE (0)
+#endif
+
 /*****************************************************************************/
 /* Internal debugging stuff                                                  */
 
@@ -256,6 +402,233 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether the VM should handle add, subtract, bitwise and comparison binary
+// ops inline when both operands are small ints, instead of calling out to
+// mp_binary_op.  Increases VM code size a little.
+#ifndef MICROPY_OPT_SMALL_INT_BINARY_OP
+#define MICROPY_OPT_SMALL_INT_BINARY_OP (0)
+#endif
+
+// Whether the bytecode emitter should fuse common sequences of opcodes into
+// single opcodes, eg "local <op> small int", optionally followed by a store
+// back to the same local or a conditional jump.  Saves a few dispatches for
+// each loop counter update and comparison, at the cost of some VM code size.
+#ifndef MICROPY_OPT_FUSED_OPCODES
+#define MICROPY_OPT_FUSED_OPCODES (0)
+#endif
+
+// Whether "for <var> in range(...)" with a constant step should compile to a
+// loop around the FOR_RANGE_SMALL_INT opcode, which tests, increments and
+// jumps in one dispatch and does small-int arithmetic on the counter directly,
+// only making an object for <var> when it stops being a small int.
+#ifndef MICROPY_OPT_FOR_RANGE
+#define MICROPY_OPT_FOR_RANGE (0)
+#endif
+
+// Whether the bytecode emitter should do simple peephole optimisations: drop
+// unreachable code, thread jumps to jumps, replace a jump to "return None"
+// with the return itself, and remove jumps to the next instruction and
+// DUP_TOP/POP_TOP pairs.  Bytecode gets a little smaller and faster, at the
+// cost of some compiler code size and 1+word bytes of RAM per label.
+#ifndef MICROPY_OPT_PEEPHOLE
+#define MICROPY_OPT_PEEPHOLE (0)
+#endif
+
+// Whether to cache the methods found by looking up an attribute of an
+// instance through its class hierarchy, keyed on the (type, attribute) pair.
+// The cache is cleared when an attribute of any class is stored or deleted.
+// Uses 3 * MICROPY_OPT_METHOD_CACHE_SIZE words of RAM, in the GC root set.
+#ifndef MICROPY_OPT_METHOD_CACHE
+#define MICROPY_OPT_METHOD_CACHE (0)
+#endif
+
+// Number of entries in the method cache; must be a power of 2
+#ifndef MICROPY_OPT_METHOD_CACHE_SIZE
+#define MICROPY_OPT_METHOD_CACHE_SIZE (64)
+#endif
+
+// Whether to keep the code states of calls that were too big for the C stack
+// when the call returns, for reuse by later calls of a similar size.  They are
+// kept in size buckets of 4 words, and the hit rate is shown by mem_info().
+#ifndef MICROPY_OPT_CODE_STATE_CACHE
+#define MICROPY_OPT_CODE_STATE_CACHE (0)
+#endif
+
+// Number of size buckets, and the maximum number of code states kept in each
+#ifndef MICROPY_OPT_CODE_STATE_CACHE_BUCKETS
+#define MICROPY_OPT_CODE_STATE_CACHE_BUCKETS (8)
+#endif
+#ifndef MICROPY_OPT_CODE_STATE_CACHE_DEPTH
+#define MICROPY_OPT_CODE_STATE_CACHE_DEPTH (4)
+#endif
+
+// Whether the VM records a traceback entry as the position in the bytecode,
+// and only works out the file, line and function name if the traceback is
+// read.  The first entry is stored in the exception itself, so an exception
+// caught in the function that raised it needs no further allocation.  Uses 3
+// words more RAM per exception object.
+#ifndef MICROPY_OPT_LAZY_TRACEBACK
+#define MICROPY_OPT_LAZY_TRACEBACK (0)
+#endif
+
+// Whether the keyword arguments of calls to bytecode functions are matched to
+// parameters through a table, indexed by the function's argument names and
+// the keyword, of the slot where that keyword was last found.  Entries are
+// only hints which are checked before use, so the table needs no upkeep.
+#ifndef MICROPY_OPT_KW_ARG_CACHE
+#define MICROPY_OPT_KW_ARG_CACHE (0)
+#endif
+
+// Number of entries in the keyword argument table (must be a power of 2)
+#ifndef MICROPY_OPT_KW_ARG_CACHE_SIZE
+#define MICROPY_OPT_KW_ARG_CACHE_SIZE (64)
+#endif
+
+// Whether mp_arg_parse_all has fast paths for calls to C functions with only
+// positional arguments, and for keyword arguments passed as an array, which
+// are matched against the allowed qstrs instead of looked up in a map.
+#ifndef MICROPY_OPT_ARG_PARSE
+#define MICROPY_OPT_ARG_PARSE (0)
+#endif
+
+// Whether hash-table maps keep a tag byte for each slot, holding 7 bits of the
+// hash of its key, so lookups can skip slots (a machine word of tags at a time)
+// without touching their keys.  Uses 1 extra byte of RAM per slot.
+#ifndef MICROPY_OPT_MAP_HASH_TAGS
+#define MICROPY_OPT_MAP_HASH_TAGS (0)
+#endif
+
+// Whether hash-table maps (including all dicts) are compact: the slots are
+// kept densely in insertion order and found through a small separate index
+// of slot numbers.  Small maps then take less RAM, and dicts iterate in
+// insertion order.  Hash tags are not used by compact maps.
+#ifndef MICROPY_OPT_MAP_COMPACT
+#define MICROPY_OPT_MAP_COMPACT (0)
+#endif
+
+// Whether instances of user classes store their attributes as an array of
+// values plus a shape (the attribute names, shared by all instances that set
+// the same attributes in the same order), instead of a map of their own.
+// Falls back to a map when an attribute is deleted or there are too many.
+#ifndef MICROPY_OPT_INSTANCE_SHAPES
+#define MICROPY_OPT_INSTANCE_SHAPES (0)
+#endif
+
+// Whether each user class keeps an array of itself and all its base classes,
+// in the depth-first order of attribute lookup, made when the class is
+// created.  isinstance, issubclass, super() and attribute lookup then scan
+// this array instead of walking the bases recursively.  Uses 2 words plus a
+// word per base of RAM per class.
+#ifndef MICROPY_OPT_CLASS_MRO
+#define MICROPY_OPT_CLASS_MRO (0)
+#endif
+
+// Whether qstr_find_strn uses hash table indexes of the qstrs, instead of
+// searching all the qstr pools.  The index of the const qstrs is made by
+// makeqstrdata.py and costs 4 to 8 bytes of ROM per qstr; the index of the
+// dynamic qstrs costs up to 4 words of RAM per qstr.
+#ifndef MICROPY_OPT_QSTR_INDEX
+#define MICROPY_OPT_QSTR_INDEX (0)
+#endif
+
+// Whether str/bytes and tuple objects compute their hash on first use and
+// cache it in the object, instead of hashing str/bytes eagerly on creation
+// and tuples on every lookup.  Adds 1 word of RAM to each tuple.  Objects
+// outside the GC heap (eg const objects in ROM) are hashed but never written
+// to, so this requires MICROPY_ENABLE_GC.
+#ifndef MICROPY_OPT_CACHE_HASH
+#define MICROPY_OPT_CACHE_HASH (0)
+#endif
+
+// Whether str/bytes += puts its result in a buffer with room to grow, so
+// that a following += on the result can append to it in place.  A loop of
+// s += x then takes time linear in the final length of s, instead of
+// quadratic.  Costs up to twice the memory for strings made this way.
+#ifndef MICROPY_OPT_STR_INPLACE_ADD
+#define MICROPY_OPT_STR_INPLACE_ADD (0)
+#endif
+
+// Whether slicing, splitting, stripping and partitioning a str/bytes make
+// views that share the data of the original object instead of copying it.
+// A view keeps a reference to its parent so the data stays alive, which
+// means a short view can pin a large parent.  Requires MICROPY_ENABLE_GC.
+#ifndef MICROPY_OPT_STR_VIEW
+#define MICROPY_OPT_STR_VIEW (0)
+#endif
+
+// Results shorter than this are copied; a view costs an extra word per
+// object, and copying small strings frees the parent sooner.
+#ifndef MICROPY_OPT_STR_VIEW_MIN_LEN
+#define MICROPY_OPT_STR_VIEW_MIN_LEN (32)
+#endif
+
+// Whether unicode str indexing remembers the last str indexed, its length in
+// characters and the position of the last character looked up.  Makes
+// stepping through a str by index O(1) per character instead of O(n), and
+// indexing an ASCII str O(1).  Only applies with MICROPY_PY_BUILTINS_STR_UNICODE.
+#ifndef MICROPY_OPT_STR_INDEX_CACHE
+#define MICROPY_OPT_STR_INDEX_CACHE (0)
+#endif
+
+// Whether list.sort and sorted use a stable, adaptive merge sort (in the
+// style of TimSort) instead of quicksort.  It is O(n) on input that is
+// already sorted or reverse sorted, and calls a key function once per item
+// rather than once per comparison.  It needs up to 1.5 times the list's
+// size in temporary memory (3 times with a key function).
+#ifndef MICROPY_OPT_STABLE_SORT
+#define MICROPY_OPT_STABLE_SORT (0)
+#endif
+
+// Whether sum, min, max and list sort handle small ints and floats directly
+// instead of going through mp_binary_op for each item.  sum of a list or
+// tuple of floats adds them up as a C float and makes one float at the end.
+// sum, min and max of a range use its closed form, those of a bytes,
+// bytearray or array add up and compare the raw items, and all of these
+// plus any and all index a list or tuple without making an iterator.
+#ifndef MICROPY_OPT_NUMERIC_SEQ
+#define MICROPY_OPT_NUMERIC_SEQ (0)
+#endif
+
+// Whether map, filter, zip and enumerate step through a list or tuple by
+// index instead of making an iterator over it, and whether a for loop that
+// unpacks the items of enumerate, zip or dict.items() takes the values
+// straight from the source instead of a new tuple for each step.
+#ifndef MICROPY_OPT_ITER_FUSION
+#define MICROPY_OPT_ITER_FUSION (0)
+#endif
+
+// Whether "return a, b" from a bytecode function called stacklessly, whose
+// caller unpacks the result straight away ("x, y = f()"), copies the values
+// into the caller's stack instead of making a tuple.  Needs MICROPY_STACKLESS.
+#ifndef MICROPY_OPT_MULTI_RETURN
+#define MICROPY_OPT_MULTI_RETURN (0)
+#endif
+
+// Whether mpz multiplication uses Karatsuba's method once both operands have
+// at least MICROPY_MPZ_KARATSUBA_THRESHOLD digits, and long strings of digits
+// are converted to an mpz by divide-and-conquer on top of it.
+#ifndef MICROPY_OPT_MPZ_KARATSUBA
+#define MICROPY_OPT_MPZ_KARATSUBA (0)
+#endif
+#ifndef MICROPY_MPZ_KARATSUBA_THRESHOLD
+#define MICROPY_MPZ_KARATSUBA_THRESHOLD (32)
+#endif
+
+// Whether bound methods are kept in a small table keyed on the (function,
+// self) pair, and an existing one is returned when the same method of the
+// same object is looked up again, eg when self.handler is passed as a
+// callback.  The table is not a GC root and is emptied when a collection
+// starts, so it never keeps an object alive.  A consequence is that obj.meth
+// is obj.meth can be True, where CPython makes a new bound method each time.
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (0)
+#endif
+
+// Number of entries in the bound method table (must be a power of 2)
+#ifndef MICROPY_OPT_BOUND_METH_CACHE_SIZE
+#define MICROPY_OPT_BOUND_METH_CACHE_SIZE (16)
+#endif
+
 /*****************************************************************************/
 /* Python internal features                                                  */
 
@@ -269,6 +642,259 @@
 #define MICROPY_ENABLE_FINALISER (0)
 #endif
 
+// Whether the finalisers of unreachable objects are queued by the collection
+// and run once it has finished, by the scheduler (or before gc.collect()
+// returns), instead of inside the sweep with the GC locked.  A queued object,
+// and anything it refers to, is kept until its finaliser has run.  If the
+// queue is full then the remaining finalisers run in the sweep as before.
+// Needs MICROPY_ENABLE_FINALISER and MICROPY_ENABLE_SCHEDULER.
+#ifndef MICROPY_GC_DEFERRED_FINALISERS
+#define MICROPY_GC_DEFERRED_FINALISERS (0)
+#endif
+
+// Number of objects the collection can queue for deferred finalisation
+#ifndef MICROPY_GC_FINALISER_QUEUE_LEN
+#define MICROPY_GC_FINALISER_QUEUE_LEN (16)
+#endif
+
+// Whether to enable generational collection in the garbage collector.  A
+// table with a "young" bit per block records blocks allocated since the last
+// collection, and a minor collection only marks and sweeps those blocks.
+// Old blocks are scanned linearly as the remembered set, so no write barrier
+// is needed.  Costs 1 bit of RAM per block of heap.
+#ifndef MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_GENERATIONAL (0)
+#endif
+
+// Maximum number of consecutive minor collections before a full collection
+// is forced, so that unreachable old objects are eventually reclaimed
+#ifndef MICROPY_GC_GENERATIONAL_MAX_MINOR
+#define MICROPY_GC_GENERATIONAL_MAX_MINOR (8)
+#endif
+
+// Whether to support incremental collection, where the mark phase is done in
+// bounded steps via gc_collect_step() between which the program can run
+#ifndef MICROPY_GC_INCREMENTAL
+#define MICROPY_GC_INCREMENTAL (0)
+#endif
+
+// Whether to keep per-size-class free lists (for allocations of up to 8
+// blocks) that are rebuilt by the sweep, making small allocations O(1) even
+// when the heap is fragmented.  Costs 5 * MICROPY_GC_FREE_LIST_LEN words of RAM.
+#ifndef MICROPY_GC_FREE_LISTS
+#define MICROPY_GC_FREE_LISTS (0)
+#endif
+
+// Number of entries in each size-class free list
+#ifndef MICROPY_GC_FREE_LIST_LEN
+#define MICROPY_GC_FREE_LIST_LEN (16)
+#endif
+
+// Whether to keep pools of dead floats, 2-tuples, bound methods, range
+// iterators and list objects.  The sweep puts such objects on their type's
+// pool instead of freeing them, and the next objects of the type are taken
+// from there without going through gc_alloc.  The pools are emptied by each
+// collection, and when an allocation would fail, so they never hide memory
+// for long.  Counts are shown by micropython.mem_info().
+#ifndef MICROPY_GC_OBJ_POOLS
+#define MICROPY_GC_OBJ_POOLS (0)
+#endif
+
+// Maximum number of objects kept on each object pool
+#ifndef MICROPY_GC_OBJ_POOL_LEN
+#define MICROPY_GC_OBJ_POOL_LEN (32)
+#endif
+
+// Whether the GC heap can be made of more than one region of memory, with
+// further regions added after gc_init by gc_add_region.  Each added region
+// holds its own tables, and pointers are looked up in every region while
+// marking, so this costs a little speed.
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// With a split heap, allocations of at least this many bytes are placed in the
+// added regions before the main one, keeping large buffers apart from small
+// objects.
+#ifndef MICROPY_GC_SPLIT_HEAP_LARGE_ALLOC
+#define MICROPY_GC_SPLIT_HEAP_LARGE_ALLOC (1024)
+#endif
+
+// Whether the memory passed to gc_init and gc_add_region is already zero
+// (eg fresh anonymous pages or BSS), so the allocation tables needn't be
+// cleared.  Besides saving the time to clear them, on a port with demand
+// paging the pages of the tables for a large heap aren't touched until used.
+#ifndef MICROPY_GC_HEAP_ZEROED
+#define MICROPY_GC_HEAP_ZEROED (0)
+#endif
+
+// Whether the heap grows when an allocation fails even after a collection.
+// Needs MICROPY_GC_SPLIT_HEAP; the port provides gc_grow_heap, which adds a
+// region with gc_add_region, and gc_decommit, which gives the pages of the
+// free blocks at the end of each region back to the OS after a sweep.
+#ifndef MICROPY_GC_AUTO_GROW
+#define MICROPY_GC_AUTO_GROW (0)
+#endif
+
+// Free space at the end of a region that is worth passing to gc_decommit
+#ifndef MICROPY_GC_AUTO_GROW_DECOMMIT_MIN
+#define MICROPY_GC_AUTO_GROW_DECOMMIT_MIN (64 * 1024)
+#endif
+
+// Allocations of at least this many bytes are not made in the heap's blocks
+// but each get their own memory from the port's gc_large_alloc_pages, and
+// are given back with gc_large_free_pages when collected.  Set to 0 to
+// disable.
+#ifndef MICROPY_GC_LARGE_ALLOC_THRESHOLD
+#define MICROPY_GC_LARGE_ALLOC_THRESHOLD (0)
+#endif
+
+// Allocations of at least this many bytes are placed at the top of the heap
+// (searching downwards) instead of the bottom.  Keeping large, usually
+// short-lived buffers apart from small objects stops the small ones being
+// scattered through the space the large ones need, which reduces
+// fragmentation on long-running systems.  Set to 0 to disable.
+#ifndef MICROPY_GC_TOP_ALLOC_THRESHOLD
+#define MICROPY_GC_TOP_ALLOC_THRESHOLD (0)
+#endif
+
+// Whether a collection triggered by an allocation only marks, leaving the
+// unreachable blocks to be reclaimed (and their finalisers run) a little at a
+// time by the allocations that follow.  The pause of such a collection then
+// covers just the mark phase.
+#ifndef MICROPY_GC_LAZY_SWEEP
+#define MICROPY_GC_LAZY_SWEEP (0)
+#endif
+
+// Number of blocks each allocation sweeps while a lazy sweep is pending
+#ifndef MICROPY_GC_LAZY_SWEEP_STEP
+#define MICROPY_GC_LAZY_SWEEP_STEP (256)
+#endif
+
+// Whether a collection of a large heap marks and sweeps using several threads
+// at once.  The port must provide gc_run_workers (see py/gc.h), and the
+// compiler must support the GCC __atomic builtins.
+#ifndef MICROPY_GC_PARALLEL
+#define MICROPY_GC_PARALLEL (0)
+#endif
+
+// Maximum number of threads, including the collecting one, that take part
+// in a parallel collection
+#ifndef MICROPY_GC_PARALLEL_WORKERS
+#define MICROPY_GC_PARALLEL_WORKERS (4)
+#endif
+
+// Heaps with fewer blocks than this are collected on one thread, because
+// waking the workers would cost more than it saves
+#ifndef MICROPY_GC_PARALLEL_MIN_BLOCKS
+#define MICROPY_GC_PARALLEL_MIN_BLOCKS (65536)
+#endif
+
+// Whether bytecode functions register their stack-allocated code state so
+// that the GC scans it precisely (only the slots that can hold objects)
+// instead of word by word along with the rest of the C stack.  C frames
+// are still scanned conservatively.
+#ifndef MICROPY_GC_PRECISE_VM_ROOTS
+#define MICROPY_GC_PRECISE_VM_ROOTS (0)
+#endif
+
+// Whether to record the bytecode source location (function and line) that
+// allocated each heap chain, so micropython.heap_profile can report the live
+// heap per allocation site.  Costs one byte of RAM per heap block.
+#ifndef MICROPY_GC_HEAP_PROFILE
+#define MICROPY_GC_HEAP_PROFILE (0)
+#endif
+
+// Number of distinct allocation sites that the heap profiler can record
+// (at most 255); allocations from further sites are counted as unknown
+#ifndef MICROPY_GC_HEAP_PROFILE_SITES
+#define MICROPY_GC_HEAP_PROFILE_SITES (64)
+#endif
+
+// Whether gc_alloc can also collect once a set number of bytes have been
+// allocated since the last collection, as set by gc.threshold
+#ifndef MICROPY_GC_ALLOC_THRESHOLD
+#define MICROPY_GC_ALLOC_THRESHOLD (0)
+#endif
+
+// Whether the GC counts its collections and allocation failures, and times
+// its mark and sweep phases, as reported by gc.stats.  Time is measured with
+// mp_hal_ticks_cpu(), which the port must provide.
+#ifndef MICROPY_GC_STATS
+#define MICROPY_GC_STATS (0)
+#endif
+
+// Number of buckets in the GC pause histogram; bucket 0 counts pauses below
+// 2**MICROPY_GC_STATS_HIST_SHIFT ticks and each further one covers twice the
+// range of the one before, the last one counting all longer pauses
+#ifndef MICROPY_GC_STATS_HIST_LEN
+#define MICROPY_GC_STATS_HIST_LEN (16)
+#endif
+
+#ifndef MICROPY_GC_STATS_HIST_SHIFT
+#define MICROPY_GC_STATS_HIST_SHIFT (10)
+#endif
+
+// Whether the VM can count the calls, self time and total time of each
+// bytecode function, reported by micropython.profile_stats.  Time is measured
+// with mp_hal_ticks_cpu(), which the port must provide.
+#ifndef MICROPY_VM_PROFILE
+#define MICROPY_VM_PROFILE (0)
+#endif
+
+// Number of distinct bytecode functions the VM profiler can record (a power
+// of 2); time spent in further functions is counted as unknown
+#ifndef MICROPY_VM_PROFILE_FUNCS
+#define MICROPY_VM_PROFILE_FUNCS (64)
+#endif
+
+// Depth of nested calls the VM profiler can time in each thread; the time of
+// deeper calls counts as self time of the deepest one that is timed
+#ifndef MICROPY_VM_PROFILE_DEPTH
+#define MICROPY_VM_PROFILE_DEPTH (32)
+#endif
+
+// Whether the VM counts how often each opcode, and each pair of consecutive
+// opcodes, is executed; micropython.opcode_stats prints the most frequent.
+// This slows down the VM and is meant for a dedicated measurement build.
+#ifndef MICROPY_VM_OPCODE_STATS
+#define MICROPY_VM_OPCODE_STATS (0)
+#endif
+
+// Number of distinct opcode pairs that can be counted (a power of 2); pairs
+// seen once the table is full are only counted in total
+#ifndef MICROPY_VM_OPCODE_STATS_PAIRS
+#define MICROPY_VM_OPCODE_STATS_PAIRS (256)
+#endif
+
+// Whether the VM can be sampled by a timer interrupt, which calls
+// mp_vm_sample() to count the bytecode being run; micropython.sample_stats
+// reports the counts per source line.  The port must provide
+// mp_hal_sample_timer() to start and stop its timer.
+#ifndef MICROPY_VM_SAMPLE_PROFILE
+#define MICROPY_VM_SAMPLE_PROFILE (0)
+#endif
+
+// Number of distinct bytecode positions the sampler can count (a power of
+// 2); further samples are counted as unknown
+#ifndef MICROPY_VM_SAMPLE_PROFILE_SLOTS
+#define MICROPY_VM_SAMPLE_PROFILE_SLOTS (64)
+#endif
+
+// Whether each thread keeps a pointer to the code state of its innermost
+// running bytecode function, as the heap profiler and the sampler need
+#define MICROPY_VM_CURRENT_CODE_STATE (MICROPY_GC_HEAP_PROFILE || MICROPY_VM_SAMPLE_PROFILE)
+
+// Whether to allow several independent interpreters in one process.  All
+// state is then reached through mp_state_ctx_ptr, a thread-local pointer
+// that each OS thread sets to the mp_state_ctx_t of the interpreter it runs
+// before calling into it.  Each interpreter has its own heap and they share
+// no locks, so they can run concurrently.  Set it on the compiler command
+// line, as the nlr asm code needs to see it.
+#ifndef MICROPY_MULTIPLE_INTERPRETERS
+#define MICROPY_MULTIPLE_INTERPRETERS (0)
+#endif
+
 // Whether to check C stack usage. C stack used for calling Python functions,
 // etc. Not checking means segfault on overflow.
 #ifndef MICROPY_STACK_CHECK
@@ -285,6 +911,17 @@
 #   endif
 #endif
 
+// Whether to provide a queue of callbacks that IRQ handlers can schedule and
+// the VM runs between bytecodes, and micropython.schedule()
+#ifndef MICROPY_ENABLE_SCHEDULER
+#define MICROPY_ENABLE_SCHEDULER (0)
+#endif
+
+// Maximum number of callbacks waiting in the scheduler queue
+#ifndef MICROPY_SCHEDULER_DEPTH
+#define MICROPY_SCHEDULER_DEPTH (4)
+#endif
+
 // Whether to include REPL helper function
 #ifndef MICROPY_HELPER_REPL
 #define MICROPY_HELPER_REPL (0)
@@ -295,6 +932,12 @@
 #define MICROPY_REPL_EVENT_DRIVEN (0)
 #endif
 
+// Whether the raw REPL accepts binary file transfers (CTRL-F), which need
+// the port to provide mp_hal_stdin_rx_chr_timeout and a builtin open
+#ifndef MICROPY_REPL_RAW_FILE_TRANSFER
+#define MICROPY_REPL_RAW_FILE_TRANSFER (0)
+#endif
+
 // Whether to include lexer helper function for unix
 #ifndef MICROPY_HELPER_LEXER_UNIX
 #define MICROPY_HELPER_LEXER_UNIX (0)
@@ -365,6 +1008,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_COMPLEX (MICROPY_PY_BUILTINS_FLOAT)
 #endif
 
+// Whether float to string conversion is exact and repr gives the shortest
+// string that reads back as the same float, and string to float conversion
+// is correctly rounded; needs MICROPY_LONGINT_IMPL_MPZ for the hard cases
+#ifndef MICROPY_FLOAT_EXACT_CONV
+#define MICROPY_FLOAT_EXACT_CONV (0)
+#endif
+
 // Enable features which improve CPython compatibility
 // but may lead to more code size/memory usage.
 // TODO: Originally intended as generic category to not
@@ -383,11 +1033,46 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_WEAK_LINKS (0)
 #endif
 
+// Whether import caches a listing of each directory it looks in, so that
+// finding a module takes no filesystem lookups once its directory has been
+// listed.  The port provides mp_import_listdir, and must call
+// mp_import_cache_clear when the filesystem is changed.  Only directories,
+// and files ending in .py and .mpy, are kept in a listing.
+#ifndef MICROPY_MODULE_LISTDIR_CACHE
+#define MICROPY_MODULE_LISTDIR_CACHE (0)
+#endif
+
+// Whether a submodule of a package that hasn't been imported is imported
+// on first access as an attribute of the package, so a package can make its
+// submodules available without importing them all up front
+#ifndef MICROPY_MODULE_LAZY_SUBMODULES
+#define MICROPY_MODULE_LAZY_SUBMODULES (0)
+#endif
+
+// Whether a builtin module's __init__ function, if it has one, is called the
+// first time the module is imported, so a port can defer setting up the
+// module until it is used rather than doing it at startup
+#ifndef MICROPY_MODULE_BUILTIN_INIT
+#define MICROPY_MODULE_BUILTIN_INIT (0)
+#endif
+
+// Whether a module-level __getattr__ function is called for attributes the
+// module doesn't have (PEP 562)
+#ifndef MICROPY_MODULE_GETATTR
+#define MICROPY_MODULE_GETATTR (0)
+#endif
+
 // Whether frozen modules are supported
 #ifndef MICROPY_MODULE_FROZEN
 #define MICROPY_MODULE_FROZEN (0)
 #endif
 
+// Whether frozen bytecode modules are supported; these are generated as const
+// data by tools/mpy-tool.py and run in place without using the heap for code
+#ifndef MICROPY_MODULE_FROZEN_MPY
+#define MICROPY_MODULE_FROZEN_MPY (0)
+#endif
+
 // Whether you can override builtins in the builtins module
 #ifndef MICROPY_CAN_OVERRIDE_BUILTINS
 #define MICROPY_CAN_OVERRIDE_BUILTINS (0)
@@ -407,6 +1092,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_DESCRIPTORS (0)
 #endif
 
+// Whether to support __slots__ in classes, storing the slot attributes of
+// an instance as values at fixed offsets in the instance itself
+#ifndef MICROPY_PY_SLOTS
+#define MICROPY_PY_SLOTS (0)
+#endif
+
 // Whether str object is proper unicode
 #ifndef MICROPY_PY_BUILTINS_STR_UNICODE
 #define MICROPY_PY_BUILTINS_STR_UNICODE (0)
@@ -422,6 +1113,19 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_BYTEARRAY (1)
 #endif
 
+// Whether bytearray has the in-place itranslate and ixor methods (extension
+// to CPython) which transform the buffer without allocating a new object
+#ifndef MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS
+#define MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS (0)
+#endif
+
+// Whether the bytearray constructor takes a reserve keyword argument (extension
+// to CPython) giving the capacity to allocate up front, so a buffer that is
+// built up by append/extend is allocated once
+#ifndef MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE
+#define MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE (0)
+#endif
+
 // Whether to support memoryview object
 #ifndef MICROPY_PY_BUILTINS_MEMORYVIEW
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (0)
@@ -437,6 +1141,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_SLICE (1)
 #endif
 
+// Whether to compute 3-arg pow directly as a modular power (using Montgomery
+// multiplication for odd moduli), rather than as (a ** b) % c.
+// Requires MICROPY_LONGINT_IMPL_MPZ.
+#ifndef MICROPY_PY_BUILTINS_POW3
+#define MICROPY_PY_BUILTINS_POW3 (0)
+#endif
+
 // Whether to support frozenset object
 #ifndef MICROPY_PY_BUILTINS_FROZENSET
 #define MICROPY_PY_BUILTINS_FROZENSET (0)
@@ -501,6 +1212,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_ARRAY (1)
 #endif
 
+// Whether to provide elementwise math functions (add, mul, scale, clip, dot,
+// sum, min, max) in the array module, operating on any buffer in C
+#ifndef MICROPY_PY_ARRAY_MATH
+#define MICROPY_PY_ARRAY_MATH (0)
+#endif
+
 // Whether to support slice assignments for array (and bytearray).
 // This is rarely used, but adds ~0.5K of code.
 #ifndef MICROPY_PY_ARRAY_SLICE_ASSIGN
@@ -523,6 +1240,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (0)
 #endif
 
+// Whether to provide "collections.deque" type
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE
+#define MICROPY_PY_COLLECTIONS_DEQUE (0)
+#endif
+
 // Whether to provide "math" module
 #ifndef MICROPY_PY_MATH
 #define MICROPY_PY_MATH (1)
@@ -533,6 +1255,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (0)
 #endif
 
+// Whether to provide math.{apply,polyval}, which work over float arrays in C
+// (needs MICROPY_PY_ARRAY)
+#ifndef MICROPY_PY_MATH_ARRAY_FUNCTIONS
+#define MICROPY_PY_MATH_ARRAY_FUNCTIONS (0)
+#endif
+
 // Whether to provide "cmath" module
 #ifndef MICROPY_PY_CMATH
 #define MICROPY_PY_CMATH (0)
@@ -563,6 +1291,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_IO_BYTESIO (1)
 #endif
 
+// Whether to provide "io.BufferedReader" and "io.BufferedWriter" classes,
+// which add buffering to any stream
+#ifndef MICROPY_PY_IO_BUFFERED
+#define MICROPY_PY_IO_BUFFERED (0)
+#endif
+
 // Whether to provide "struct" module
 #ifndef MICROPY_PY_STRUCT
 #define MICROPY_PY_STRUCT (1)
@@ -594,6 +1328,19 @@ typedef double mp_float_t;
 #define MICROPY_PY_SYS_STDFILES (0)
 #endif
 
+// Whether to provide the "_thread" module.  Threads share the heap and run
+// Python code one at a time, holding a global interpreter lock; the port
+// must provide mpthreadport.h and the functions declared in py/mpthread.h
+#ifndef MICROPY_PY_THREAD
+#define MICROPY_PY_THREAD (0)
+#endif
+
+// Number of VM jumps between offers of the global interpreter lock to any
+// threads waiting for it
+#ifndef MICROPY_PY_THREAD_GIL_VM_DIVISOR
+#define MICROPY_PY_THREAD_GIL_VM_DIVISOR (32)
+#endif
+
 
 // Extended modules
 
@@ -601,10 +1348,34 @@ typedef double mp_float_t;
 #define MICROPY_PY_UCTYPES (0)
 #endif
 
+// Whether uctypes provides compile/unpack/pack/iter_unpack, for bulk access
+// to structure fields through a flattened layout
+#ifndef MICROPY_PY_UCTYPES_LAYOUT
+#define MICROPY_PY_UCTYPES_LAYOUT (0)
+#endif
+
 #ifndef MICROPY_PY_UZLIB
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// Whether uzlib provides compress and compressobj, as well as decompress
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
+// Whether uzlib provides DecompIO, which decompresses from a stream
+#ifndef MICROPY_PY_UZLIB_DECOMPIO
+#define MICROPY_PY_UZLIB_DECOMPIO (0)
+#endif
+
+// Whether uzlib.crc32 uses slicing-by-8 tables (8k of RAM, built on first
+// use) instead of a 64-byte nibble table.  A port with a CRC unit may also
+// define MICROPY_PY_UZLIB_CRC32_HW_FUNC(crc, buf, len), which continues a
+// zlib-style crc over len bytes, len being a non-zero multiple of 4
+#ifndef MICROPY_PY_UZLIB_CRC32_SLICE8
+#define MICROPY_PY_UZLIB_CRC32_SLICE8 (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
@@ -613,22 +1384,93 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE (0)
 #endif
 
+// Whether ure provides sub and finditer, and match start, end and span
+#ifndef MICROPY_PY_URE_SUB
+#define MICROPY_PY_URE_SUB (0)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
 
+// Whether uheapq provides PriorityQueue, a heap of native priorities
+#ifndef MICROPY_PY_UHEAPQ_PQUEUE
+#define MICROPY_PY_UHEAPQ_PQUEUE (0)
+#endif
+
 #ifndef MICROPY_PY_UHASHLIB
 #define MICROPY_PY_UHASHLIB (0)
 #endif
 
+// Whether uhashlib provides sha1 and md5, as well as sha256
+#ifndef MICROPY_PY_UHASHLIB_SHA1
+#define MICROPY_PY_UHASHLIB_SHA1 (0)
+#endif
+#ifndef MICROPY_PY_UHASHLIB_MD5
+#define MICROPY_PY_UHASHLIB_MD5 (0)
+#endif
+
+// Whether the port provides a hashing engine for uhashlib, through
+// mp_hal_hash_init/update/final; it must also define MICROPY_HW_HASH_CTX_SIZE
+#ifndef MICROPY_PY_UHASHLIB_HW
+#define MICROPY_PY_UHASHLIB_HW (0)
+#endif
+
 #ifndef MICROPY_PY_UBINASCII
 #define MICROPY_PY_UBINASCII (0)
 #endif
 
+// Whether to provide the "ucryptolib" module, with AES in ECB, CBC and CTR
+#ifndef MICROPY_PY_UCRYPTOLIB
+#define MICROPY_PY_UCRYPTOLIB (0)
+#endif
+
+// Whether the port provides an AES engine for ucryptolib, through
+// mp_hal_aes_init/crypt; it must also define MICROPY_HW_AES_CTX_SIZE
+#ifndef MICROPY_PY_UCRYPTOLIB_HW
+#define MICROPY_PY_UCRYPTOLIB_HW (0)
+#endif
+
 #ifndef MICROPY_PY_MACHINE
 #define MICROPY_PY_MACHINE (0)
 #endif
 
+// Whether to provide the "_uasyncio" module, an event loop core for coroutines;
+// the port must provide mp_hal_ticks_ms() and a uselect module with poll
+#ifndef MICROPY_PY_UASYNCIO
+#define MICROPY_PY_UASYNCIO (0)
+#endif
+
+// Whether to provide the "uringbuf" module, a byte ring buffer that can be
+// used from IRQ handlers without touching the heap
+#ifndef MICROPY_PY_URINGBUF
+#define MICROPY_PY_URINGBUF (0)
+#endif
+
+// Whether to provide the "uweakref" module, with weak references that the GC
+// clears when their target is collected; needs MICROPY_GC_DEFERRED_FINALISERS,
+// which runs their callbacks
+#ifndef MICROPY_PY_UWEAKREF
+#define MICROPY_PY_UWEAKREF (0)
+#endif
+
+// Whether to provide the "urandom" module, a fast (non-cryptographic) PRNG;
+// the port may define MICROPY_PY_URANDOM_SEED_INIT_FUNC to an expression
+// giving a 32-bit seed, which is used on first use and by seed(None)
+#ifndef MICROPY_PY_URANDOM
+#define MICROPY_PY_URANDOM (0)
+#endif
+
+// Whether to provide the "framebuf" module, for drawing into a buffer
+#ifndef MICROPY_PY_FRAMEBUF
+#define MICROPY_PY_FRAMEBUF (0)
+#endif
+
+// Whether to provide the "uhttp" module, an incremental HTTP head parser
+#ifndef MICROPY_PY_UHTTP
+#define MICROPY_PY_UHTTP (0)
+#endif
+
 /*****************************************************************************/
 /* Hooks for a port to add builtins                                          */
 
@@ -728,6 +1570,13 @@ typedef double mp_float_t;
 #define MP_PLAT_FREE_EXEC(ptr, size) m_del(byte, ptr, size)
 #endif
 
+// For ports that can't execute code from where MP_PLAT_ALLOC_EXEC puts it, this
+// moves the finished code and returns its new address.  The original buffer
+// must then be kept reachable by the GC, for the pointers stored in the code.
+#ifndef MP_PLAT_COMMIT_EXEC
+#define MP_PLAT_COMMIT_EXEC(ptr, size) (ptr)
+#endif
+
 // This macro is used to do all output (except when MICROPY_PY_IO is defined)
 #ifndef MP_PLAT_PRINT_STRN
 #define MP_PLAT_PRINT_STRN(str, len) printf("%.*s", (int)len, str)
@@ -760,6 +1609,11 @@ typedef double mp_float_t;
 #define MP_WEAK __attribute__((weak))
 #endif
 
+// Modifier for functions that must keep their own stack frame
+#ifndef MP_NOINLINE
+#define MP_NOINLINE __attribute__((noinline))
+#endif
+
 // Condition is likely to be true, to help branch prediction
 #ifndef MP_LIKELY
 #define MP_LIKELY(x) __builtin_expect((x), 1)
@@ -26,4 +26,8 @@
 
 #include "py/mpstate.h"
 
+#if MICROPY_MULTIPLE_INTERPRETERS
+__thread mp_state_ctx_t *mp_state_ctx_ptr;
+#else
 mp_state_ctx_t mp_state_ctx;
+#endif
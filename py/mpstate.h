@@ -34,17 +34,31 @@
 #include "py/obj.h"
 #include "py/objlist.h"
 #include "py/objexcept.h"
+#include "py/mpthread.h"
 
 // This file contains structures defining the state of the Micro Python
 // memory system, runtime and virtual machine.  The state is a global
 // variable, but in the future it is hoped that the state can become local.
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// an object of at least MICROPY_GC_LARGE_ALLOC_THRESHOLD bytes, outside the
+// heap's blocks
+typedef struct _mp_gc_large_t {
+    void *ptr;
+    mp_uint_t n_bytes;
+    mp_uint_t n_alloc; // as passed to gc_large_alloc_pages
+    // 0 unmarked, 1 marked but not yet scanned, 2 marked and scanned
+    byte mark;
+    byte has_finaliser;
+} mp_gc_large_t;
+#endif
+
+// This structure holds the tables and pool of one contiguous region of the
+// GC heap.  The main area is part of mp_state_mem_t; with a split heap any
+// further areas are stored at the start of the region they describe.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
@@ -52,11 +66,100 @@ typedef struct _mp_state_mem_t {
     #if MICROPY_ENABLE_FINALISER
     byte *gc_finaliser_table_start;
     #endif
+    #if MICROPY_GC_GENERATIONAL
+    byte *gc_young_table_start;
+    #endif
+    #if MICROPY_GC_HEAP_PROFILE
+    byte *gc_profile_table_start;
+    #endif
     mp_uint_t *gc_pool_start;
     mp_uint_t *gc_pool_end;
 
+    mp_uint_t gc_last_free_atb_index;
+    // where the last multi-block allocation ended, for the next one to start
+    mp_uint_t gc_last_multi_atb_index;
+
+    #if MICROPY_GC_LAZY_SWEEP
+    // the first block not yet swept after a lazy collection
+    mp_uint_t gc_sweep_block;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    // start blocks of free runs, one list for each size class of 1, 2, 3, 4
+    // and 8 blocks
+    mp_uint_t gc_free_list[5][MICROPY_GC_FREE_LIST_LEN];
+    uint16_t gc_free_list_len[5];
+    #endif
+} mp_state_mem_area_t;
+
+#if MICROPY_GC_PARALLEL
+// State shared by the workers of a parallel collection.  The fields from
+// n_started to pool are protected by lock.
+typedef struct _mp_gc_parallel_t {
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    struct _mp_state_ctx_t *ctx;
+    #endif
+    uint8_t lock;
+    uint8_t kind;
+    mp_state_mem_area_t *area;
+    mp_uint_t n_ranges;
+    mp_uint_t range[MICROPY_GC_PARALLEL_WORKERS * 8 + 1];
+    mp_uint_t n_started;
+    mp_uint_t n_busy;
+    mp_uint_t next_range;
+    mp_uint_t n_freed;
+    mp_uint_t n_collected;
+    mp_uint_t pool_len;
+    // heap pointers of marked blocks that are still to be scanned
+    mp_uint_t pool[2 * MICROPY_ALLOC_GC_STACK_SIZE];
+    // the private mark stack of each worker
+    mp_uint_t stack[MICROPY_GC_PARALLEL_WORKERS][MICROPY_ALLOC_GC_STACK_SIZE];
+} mp_gc_parallel_t;
+#endif
+
+#if MICROPY_GC_HEAP_PROFILE
+// An allocation site recorded by the heap profiler
+typedef struct _mp_gc_profile_site_t {
+    qstr source_file;
+    qstr block_name;
+    mp_uint_t source_line;
+    mp_uint_t n_alloc;
+} mp_gc_profile_site_t;
+#endif
+
+#if MICROPY_GC_STATS
+// Counters kept by the GC for gc.stats; times are in mp_hal_ticks_cpu() units
+// and a pause is a collection, or a step of an incremental one
+typedef struct _mp_gc_stats_t {
+    mp_uint_t n_collect;
+    mp_uint_t n_collect_alloc; // collections triggered by gc_alloc
+    mp_uint_t n_alloc_fail;
+    mp_uint_t alloc_bytes; // since the last collection
+    uint64_t mark_ticks;
+    uint64_t sweep_ticks;
+    mp_uint_t mark_max;
+    mp_uint_t sweep_max;
+    mp_uint_t pause_max;
+    mp_uint_t pause_hist[MICROPY_GC_STATS_HIST_LEN];
+} mp_gc_stats_t;
+#endif
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     mp_uint_t gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    // the area of each block on gc_stack
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
     mp_uint_t *gc_sp;
     uint16_t gc_lock_depth;
 
@@ -65,13 +168,151 @@ typedef struct _mp_state_mem_t {
     // you can still allocate/free memory and also explicitly call gc_collect.
     uint16_t gc_auto_collect_enabled;
 
-    mp_uint_t gc_last_free_atb_index;
+    #if MICROPY_GC_GENERATIONAL
+    // set by gc_collect_young to request a minor collection; in_minor is set
+    // by gc_collect_start if the collection in progress is a minor one
+    uint8_t gc_minor_requested;
+    uint8_t gc_in_minor;
+    uint16_t gc_minor_count;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // marking is set while an incremental mark is in progress; finishing is
+    // set during the final atomic collection that completes it
+    uint8_t gc_incr_marking;
+    uint8_t gc_incr_finishing;
+    #endif
+
+    #if MICROPY_GC_LAZY_SWEEP
+    // lazy is set by gc_alloc around the collections it triggers; pending is
+    // set while some area still has blocks left to sweep
+    uint8_t gc_sweep_lazy;
+    uint8_t gc_sweep_pending;
+    #endif
+
+    #if MICROPY_GC_PARALLEL
+    // set by gc_collect_start if the collection in progress uses the workers
+    uint8_t gc_parallel;
+    mp_gc_parallel_t gc_par;
+    #endif
+
+    #if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+    // the large objects, sorted by address, in a table of gc_large_max
+    // entries; lo and hi bound their addresses
+    mp_gc_large_t *gc_large;
+    mp_uint_t gc_large_len;
+    mp_uint_t gc_large_max;
+    mp_uint_t gc_large_lo;
+    mp_uint_t gc_large_hi;
+    // bytes of large objects that survived the last collection, and
+    // allocated since then
+    mp_uint_t gc_large_live_bytes;
+    mp_uint_t gc_large_new_bytes;
+    // set when a large object is marked, until its contents are scanned
+    uint8_t gc_large_pending;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    // counters for allocations served by the free lists
+    mp_uint_t gc_free_list_hit;
+    mp_uint_t gc_free_list_miss;
+    #endif
+
+    #if MICROPY_GC_OBJ_POOLS
+    // Each pool is a list of dead objects of one type and size, linked
+    // through their second word (hidden from the GC as with GC_WEAK_HIDE).
+    // The type and size are set by the first allocation from the pool.
+    void *gc_pool_head[MP_OBJ_NUM_POOLS];
+    const void *gc_pool_type[MP_OBJ_NUM_POOLS];
+    uint16_t gc_pool_n_blocks[MP_OBJ_NUM_POOLS];
+    mp_uint_t gc_pool_len[MP_OBJ_NUM_POOLS];
+    // free entries on the pools in use; the sweep stops looking at dead
+    // objects once this is 0
+    mp_uint_t gc_pool_room;
+    mp_uint_t gc_pool_hit[MP_OBJ_NUM_POOLS];
+    mp_uint_t gc_pool_miss[MP_OBJ_NUM_POOLS];
+    #endif
 
     #if MICROPY_PY_GC_COLLECT_RETVAL
     mp_uint_t gc_collected;
     #endif
+
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    // bytes allocated since the last collection, and the amount that triggers
+    // the next one, or (size_t)-1 for none
+    size_t gc_alloc_amount;
+    size_t gc_alloc_threshold;
+    #endif
+
+    #if MICROPY_GC_STATS
+    mp_gc_stats_t gc_stats;
+    // when the collection in progress started
+    mp_uint_t gc_stats_start;
+    #endif
+
+    #if MICROPY_GC_HEAP_PROFILE
+    // site 0 is used for allocations with an unknown location
+    mp_gc_profile_site_t gc_profile_site[MICROPY_GC_HEAP_PROFILE_SITES];
+    mp_uint_t gc_profile_num_sites;
+    #endif
 } mp_state_mem_t;
 
+#if MICROPY_VM_PROFILE
+// A bytecode function recorded by the VM profiler, keyed by its code info.
+// depth is the number of its activations currently running.
+typedef struct _mp_vm_profile_func_t {
+    const byte *code_info;
+    mp_uint_t depth;
+    mp_uint_t n_calls;
+    uint64_t self_ticks;
+    uint64_t total_ticks;
+} mp_vm_profile_func_t;
+
+// A running code state timed by the VM profiler; child is the time spent in
+// the code states it started
+typedef struct _mp_vm_profile_frame_t {
+    const struct _mp_code_state *code_state;
+    mp_vm_profile_func_t *func;
+    mp_uint_t start;
+    mp_uint_t child;
+} mp_vm_profile_frame_t;
+#endif
+
+#if MICROPY_VM_SAMPLE_PROFILE
+// A bytecode position counted by the sampler; an entry is free while its
+// code info is NULL
+typedef struct _mp_vm_sample_t {
+    const byte *code_info;
+    const byte *ip;
+    mp_uint_t count;
+} mp_vm_sample_t;
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+// A pair of consecutive opcodes counted by the VM, first << 8 | second
+typedef struct _mp_vm_opcode_pair_t {
+    uint16_t pair;
+    mp_uint_t count;
+} mp_vm_opcode_pair_t;
+#endif
+
+#if MICROPY_OPT_METHOD_CACHE
+// An entry in the method cache: the method found for attr on instances of type
+typedef struct _mp_method_cache_entry_t {
+    const mp_obj_type_t *type;
+    mp_uint_t attr;
+    mp_obj_t meth;
+} mp_method_cache_entry_t;
+#endif
+
+#if MICROPY_ENABLE_SCHEDULER
+// A callback waiting in the scheduler queue
+typedef struct _mp_sched_item_t {
+    mp_obj_t func;
+    mp_obj_t arg;
+} mp_sched_item_t;
+#endif
+
 // This structure hold runtime and VM information.  It includes a section
 // which contains root pointers that must be scanned by the GC.
 typedef struct _mp_state_vm_t {
@@ -81,11 +322,21 @@ typedef struct _mp_state_vm_t {
     // this must start at the start of this structure
     //
 
-    // Note: nlr asm code has the offset of this hard-coded
-    nlr_buf_t *nlr_top;
-
     qstr_pool_t *last_pool;
 
+    // hash table of the dynamically created qstrs, 0 for an empty entry
+    #if MICROPY_OPT_QSTR_INDEX
+    qstr *qstr_index;
+    mp_uint_t qstr_index_alloc;
+    #endif
+
+    // chunk that new qstr data is bump-allocated from
+    #if MICROPY_ALLOC_QSTR_CHUNK_INIT
+    byte *qstr_last_chunk;
+    mp_uint_t qstr_last_alloc;
+    mp_uint_t qstr_last_used;
+    #endif
+
     // non-heap memory for creating an exception if we can't allocate RAM
     mp_obj_exception_t mp_emergency_exception_obj;
 
@@ -104,17 +355,48 @@ typedef struct _mp_state_vm_t {
     // TODO: expose as sys.modules
     mp_map_t mp_loaded_modules_map;
 
+    // listings of the directories searched by import, keyed by their path
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_map_t mp_import_listdir_cache;
+    #endif
+
     // pending exception object (MP_OBJ_NULL if not pending)
     mp_obj_t mp_pending_exception;
 
-    // current exception being handled, for sys.exc_info()
-    #if MICROPY_PY_SYS_EXC_INFO
-    mp_obj_t cur_exception;
+    // callbacks scheduled by IRQ handlers; sched_idx is the oldest entry
+    #if MICROPY_ENABLE_SCHEDULER
+    mp_sched_item_t sched_queue[MICROPY_SCHEDULER_DEPTH];
+    volatile uint8_t sched_len;
+    uint8_t sched_idx;
+    uint8_t sched_running;
+    #endif
+
+    // objects queued by the GC to have their finalisers run; they are root
+    // pointers so that the objects stay alive until then
+    #if MICROPY_GC_DEFERRED_FINALISERS
+    mp_obj_t gc_finaliser_queue[MICROPY_GC_FINALISER_QUEUE_LEN];
+    mp_uint_t gc_finaliser_len;
+    uint8_t gc_finaliser_scheduled;
+    uint8_t gc_finaliser_running;
+    #endif
+
+    // the registered weak references, each stored as GC_WEAK_HIDE(ref) so
+    // that this table doesn't keep them alive
+    #if MICROPY_PY_UWEAKREF
+    mp_uint_t *gc_weak_table;
+    mp_uint_t gc_weak_len;
+    mp_uint_t gc_weak_alloc;
     #endif
 
     // dictionary for the __main__ module
     mp_obj_dict_t dict_main;
 
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    // the __main__ module itself, which can't be a static object when each
+    // interpreter has its own dict_main
+    mp_obj_module_t module_main;
+    #endif
+
     // these two lists must be initialised per port, after the call to mp_init
     mp_obj_list_t mp_sys_path_obj;
     mp_obj_list_t mp_sys_argv_obj;
@@ -124,6 +406,55 @@ typedef struct _mp_state_vm_t {
     mp_obj_dict_t *mp_module_builtins_override_dict;
     #endif
 
+    // cached methods of user classes; they are root pointers so the cached
+    // types stay alive (and their addresses can't be reused) while cached
+    #if MICROPY_OPT_METHOD_CACHE
+    mp_method_cache_entry_t method_cache[MICROPY_OPT_METHOD_CACHE_SIZE];
+    #endif
+
+    // free lists of heap code states, one for each size bucket, linked
+    // through their first word; the rest of a free code state is zeroed
+    #if MICROPY_OPT_CODE_STATE_CACHE
+    struct _mp_code_state *code_state_cache[MICROPY_OPT_CODE_STATE_CACHE_BUCKETS];
+    #endif
+
+    // shapes of instances with a single attribute, linked through sibling
+    #if MICROPY_OPT_INSTANCE_SHAPES
+    struct _mp_obj_shape_t *instance_shapes;
+    #endif
+
+    // buffer that str/bytes += appends to in place; used is the length of
+    // the last string appended to it
+    #if MICROPY_OPT_STR_INPLACE_ADD
+    byte *str_add_buf;
+    mp_uint_t str_add_alloc;
+    mp_uint_t str_add_used;
+    #endif
+
+    // the last unicode str indexed and its data, its length in characters,
+    // and the character index and byte offset of a checkpoint within it
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    mp_obj_t str_index_obj;
+    const byte *str_index_data;
+    mp_uint_t str_index_charlen;
+    mp_uint_t str_index_char;
+    mp_uint_t str_index_byte;
+    #endif
+
+    // functions recorded by the VM profiler, an open-addressed hash table
+    // followed by the entry for unknown functions; the code info pointers are
+    // roots, so a recorded function's name can always be decoded
+    #if MICROPY_VM_PROFILE
+    mp_vm_profile_func_t vm_profile_func[MICROPY_VM_PROFILE_FUNCS + 1];
+    #endif
+
+    // positions counted by the sampler, an open-addressed hash table keyed by
+    // ip and followed by the entry for unknown samples; the code info
+    // pointers are roots, so that the lines can always be decoded
+    #if MICROPY_VM_SAMPLE_PROFILE
+    mp_vm_sample_t vm_sample[MICROPY_VM_SAMPLE_PROFILE_SLOTS + 1];
+    #endif
+
     // include any root pointers defined by a port
     MICROPY_PORT_ROOT_POINTERS
 
@@ -131,15 +462,51 @@ typedef struct _mp_state_vm_t {
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
 
-    // Stack top at the start of program
     // Note: this entry is used to locate the end of the root pointer section.
-    char *stack_top;
+    mp_uint_t mp_optimise_value;
 
-    #if MICROPY_STACK_CHECK
-    mp_uint_t stack_limit;
+    #if MICROPY_GC_PRECISE_VM_ROOTS
+    // most recent code state allocated on the C stack by a running bytecode
+    // function, and linked through gc_prev to the older ones
+    struct _mp_code_state *gc_code_state_top;
     #endif
 
-    mp_uint_t mp_optimise_value;
+    #if MICROPY_OPT_CODE_STATE_CACHE
+    byte code_state_cache_len[MICROPY_OPT_CODE_STATE_CACHE_BUCKETS];
+    mp_uint_t code_state_cache_hit;
+    mp_uint_t code_state_cache_miss;
+    #endif
+
+    #if MICROPY_OPT_KW_ARG_CACHE
+    byte kw_arg_cache[MICROPY_OPT_KW_ARG_CACHE_SIZE];
+    #endif
+
+    // recently made bound methods; not root pointers, so cleared by the GC
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    struct _mp_obj_bound_meth_t *bound_meth_cache[MICROPY_OPT_BOUND_METH_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_EMIT_NATIVE_JIT
+    // hotness at which bytecode functions are promoted to native code
+    mp_uint_t jit_threshold;
+    #endif
+
+    #if MICROPY_VM_PROFILE
+    bool vm_profile_enabled;
+    #endif
+
+    #if MICROPY_VM_SAMPLE_PROFILE
+    volatile bool vm_sample_enabled;
+    #endif
+
+    // opcode counts, and pair counts in an open-addressed hash table where
+    // 0 marks an empty entry (there is no opcode 0)
+    #if MICROPY_VM_OPCODE_STATS
+    mp_uint_t opcode_count[256];
+    mp_vm_opcode_pair_t opcode_pair[MICROPY_VM_OPCODE_STATS_PAIRS];
+    mp_uint_t opcode_pair_lost;
+    byte opcode_last;
+    #endif
 
     // size of the emergency exception buf, if it's dynamically allocated
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0
@@ -147,23 +514,78 @@ typedef struct _mp_state_vm_t {
     #endif
 } mp_state_vm_t;
 
-// This structure combines the above 2 structures, and adds the local
-// and global dicts.
+// This structure holds the state of a thread of execution: the main thread's
+// is part of mp_state_ctx, while any other thread keeps its own on its stack.
 // Note: if this structure changes then revisit all nlr asm code since they
 // have the offset of nlr_top hard-coded.
-typedef struct _mp_state_ctx_t {
+typedef struct _mp_state_thread_t {
     // these must come first for root pointer scanning in GC to work
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
-    // this must come next for root pointer scanning in GC to work
+
+    // Note: nlr asm code has the offset of this hard-coded
+    nlr_buf_t *nlr_top;
+
+    // current exception being handled, for sys.exc_info()
+    #if MICROPY_PY_SYS_EXC_INFO
+    mp_obj_t cur_exception;
+    #endif
+
+    // Stack top at the start of the thread
+    // Note: this entry is used to locate the end of the root pointer section.
+    char *stack_top;
+
+    #if MICROPY_STACK_CHECK
+    mp_uint_t stack_limit;
+    #endif
+
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    // code state of the innermost running bytecode function, if any
+    struct _mp_code_state *current_code_state;
+    #endif
+
+    #if MICROPY_VM_PROFILE
+    // code states being timed by the VM profiler, innermost last
+    mp_uint_t vm_profile_depth;
+    mp_vm_profile_frame_t vm_profile_frame[MICROPY_VM_PROFILE_DEPTH];
+    #endif
+
+    #if MICROPY_STACKLESS && MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    // frames of stackless calls; only those below frame_pool_top are in use,
+    // and only they are scanned by the GC
+    byte *frame_pool_top;
+    mp_uint_t frame_pool[MICROPY_STACKLESS_FRAME_POOL_SIZE / sizeof(mp_uint_t)];
+    #endif
+} mp_state_thread_t;
+
+// This structure combines the above 3 structures.
+typedef struct _mp_state_ctx_t {
+    // this must come first for the nlr asm code to find nlr_top
+    mp_state_thread_t thread;
     mp_state_vm_t vm;
     mp_state_mem_t mem;
 } mp_state_ctx_t;
 
+#if MICROPY_MULTIPLE_INTERPRETERS
+#if MICROPY_PY_THREAD
+// the GIL and the list of threads are shared by the whole process
+#error MICROPY_MULTIPLE_INTERPRETERS is not supported with MICROPY_PY_THREAD
+#endif
+extern __thread mp_state_ctx_t *mp_state_ctx_ptr;
+#define MP_STATE_CTX_PTR (mp_state_ctx_ptr)
+#else
 extern mp_state_ctx_t mp_state_ctx;
+#define MP_STATE_CTX_PTR (&mp_state_ctx)
+#endif
+
+#define MP_STATE_VM(x) (MP_STATE_CTX_PTR->vm.x)
+#define MP_STATE_MEM(x) (MP_STATE_CTX_PTR->mem.x)
 
-#define MP_STATE_CTX(x) (mp_state_ctx.x)
-#define MP_STATE_VM(x) (mp_state_ctx.vm.x)
-#define MP_STATE_MEM(x) (mp_state_ctx.mem.x)
+#if MICROPY_PY_THREAD
+#define MP_STATE_THREAD_PTR() (mp_thread_get_state())
+#else
+#define MP_STATE_THREAD_PTR() (&MP_STATE_CTX_PTR->thread)
+#endif
+#define MP_STATE_THREAD(x) (MP_STATE_THREAD_PTR()->x)
 
 #endif // __MICROPY_INCLUDED_PY_MPSTATE_H__
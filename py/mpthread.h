@@ -0,0 +1,76 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef __MICROPY_INCLUDED_PY_MPTHREAD_H__
+#define __MICROPY_INCLUDED_PY_MPTHREAD_H__
+
+#include "py/mpconfig.h"
+
+#if MICROPY_PY_THREAD
+
+struct _mp_state_thread_t;
+
+// The port's mpthreadport.h must define mp_thread_mutex_t, and provide
+// mp_thread_get_state() to return the state of the current thread.
+#include <mpthreadport.h>
+
+// Threads run Python code one at a time, holding the global interpreter lock
+// (GIL).  A thread releases it around anything that may block, and the VM
+// offers it to waiting threads every MICROPY_PY_THREAD_GIL_VM_DIVISOR jumps.
+// While a thread doesn't hold the GIL it must not touch any Python object or
+// the heap; in return its stack is scanned by a garbage collection run from
+// another thread.
+//
+// When the interpreter exits, the main thread calls mp_thread_deinit() after
+// mp_deinit() and keeps the GIL from then on, so that any other threads stay
+// stopped.  It returns true if there are any, in which case the heap must be
+// left in place: a thread that runs without the GIL may still be using a
+// buffer on it.
+
+// These functions are provided by the port
+void mp_thread_init(void);
+bool mp_thread_deinit(void);
+void mp_thread_set_state(struct _mp_state_thread_t *state);
+void mp_thread_create(void *(*entry)(void*), void *arg, mp_uint_t *stack_size);
+void mp_thread_finish(void);
+void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
+int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait);
+void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
+void mp_thread_gil_enter(void);
+void mp_thread_gil_exit(void);
+void mp_thread_gil_yield(void);
+void mp_thread_gc_others(void);
+
+#define MP_THREAD_GIL_ENTER() mp_thread_gil_enter()
+#define MP_THREAD_GIL_EXIT() mp_thread_gil_exit()
+
+#else
+
+#define MP_THREAD_GIL_ENTER()
+#define MP_THREAD_GIL_EXIT()
+
+#endif // MICROPY_PY_THREAD
+
+#endif // __MICROPY_INCLUDED_PY_MPTHREAD_H__
@@ -340,6 +340,91 @@ STATIC mp_uint_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, mp_uint_t jlen, mpz_d
     return ilen;
 }
 
+#if MICROPY_OPT_MPZ_KARATSUBA
+// below 4 digits the sub-products would not be smaller than the product
+#define KARATSUBA_THRESHOLD (MICROPY_MPZ_KARATSUBA_THRESHOLD < 4 ? 4 : MICROPY_MPZ_KARATSUBA_THRESHOLD)
+
+/* computes i = j * k using Karatsuba's method for large enough operands
+   writes all jlen + klen digits of i, which may have leading zeros
+   assumes jlen >= klen >= 1; j, k need not be normalised
+   i must not overlap j or k
+*/
+STATIC void mpn_mul_kara(mpz_dig_t *idig, const mpz_dig_t *jdig, mp_uint_t jlen, const mpz_dig_t *kdig, mp_uint_t klen) {
+    mp_uint_t ilen = jlen + klen;
+
+    if (klen < KARATSUBA_THRESHOLD) {
+        memset(idig, 0, ilen * sizeof(mpz_dig_t));
+        mpn_mul(idig, (mpz_dig_t*)jdig, jlen, (mpz_dig_t*)kdig, klen);
+        return;
+    }
+
+    mp_uint_t m = jlen / 2;
+
+    if (klen <= m) {
+        // unbalanced: multiply k by successive klen-digit chunks of j
+        memset(idig, 0, ilen * sizeof(mpz_dig_t));
+        mpz_dig_t *t = m_new(mpz_dig_t, 2 * klen);
+        for (mp_uint_t off = 0; off < jlen; off += klen) {
+            mp_uint_t n = jlen - off < klen ? jlen - off : klen;
+            if (n >= klen) {
+                mpn_mul_kara(t, jdig + off, n, kdig, klen);
+            } else {
+                mpn_mul_kara(t, kdig, klen, jdig + off, n);
+            }
+            mpn_add(idig + off, idig + off, ilen - off, t, n + klen);
+        }
+        m_del(mpz_dig_t, t, 2 * klen);
+        return;
+    }
+
+    // j = j1 * B^m + j0, k = k1 * B^m + k0, and then
+    // j * k = z2 * B^2m + (z1 - z2 - z0) * B^m + z0
+    // where z2 = j1 * k1, z0 = j0 * k0, z1 = (j1 + j0) * (k1 + k0)
+    mp_uint_t j1len = jlen - m;
+    mp_uint_t k1len = klen - m;
+    mp_uint_t sjlen = j1len + 1;
+    mp_uint_t sklen = (k1len > m ? k1len : m) + 1;
+    mp_uint_t tlen = sjlen + sklen + sjlen + sklen;
+    mpz_dig_t *sj = m_new0(mpz_dig_t, tlen);
+    mpz_dig_t *sk = sj + sjlen;
+    mpz_dig_t *z1 = sk + sklen;
+
+    mpn_mul_kara(idig, jdig, m, kdig, m);
+    mpn_mul_kara(idig + 2 * m, jdig + m, j1len, kdig + m, k1len);
+
+    mpn_add(sj, jdig + m, j1len, jdig, m);
+    if (k1len >= m) {
+        mpn_add(sk, kdig + m, k1len, kdig, m);
+    } else {
+        mpn_add(sk, kdig, m, kdig + m, k1len);
+    }
+    mpn_mul_kara(z1, sj, sjlen, sk, sklen);
+
+    mp_uint_t z2len = ilen - 2 * m;
+    while (z2len > 0 && idig[2 * m + z2len - 1] == 0) {
+        --z2len;
+    }
+    mp_uint_t z1len = mpn_sub(z1, z1, sjlen + sklen, idig, 2 * m);
+    z1len = mpn_sub(z1, z1, z1len, idig + 2 * m, z2len);
+    mpn_add(idig + m, idig + m, ilen - m, z1, z1len);
+
+    m_del(mpz_dig_t, sj, tlen);
+}
+#endif
+
+/* returns the largest power of base that fits in a digit, and its exponent in n
+   used to convert to and from strings a chunk of characters at a time
+*/
+STATIC mpz_dig_t mpn_base_chunk(mp_uint_t base, mp_uint_t *n) {
+    mpz_dbl_dig_t chunk = base;
+    *n = 1;
+    while (chunk * base <= DIG_MASK) {
+        chunk *= base;
+        *n += 1;
+    }
+    return chunk;
+}
+
 /* natural_div - quo * den + new_num = old_num (ie num is replaced with rem)
    assumes den != 0
    assumes num_dig has enough memory to be extended by 1 digit
@@ -379,10 +464,11 @@ STATIC void mpn_div(mpz_dig_t *num_dig, mp_uint_t *num_len, mpz_dig_t *den_dig,
     }
 
     // normalise denomenator (leading bit of leading digit is 1)
+    // carry shifts go via mpz_dbl_dig_t so they are defined when norm_shift is 0
     for (mpz_dig_t *den = den_dig, carry = 0; den < den_dig + den_len; ++den) {
         mpz_dig_t d = *den;
         *den = ((d << norm_shift) | carry) & DIG_MASK;
-        carry = d >> (DIG_SIZE - norm_shift);
+        carry = (mpz_dbl_dig_t)d >> (DIG_SIZE - norm_shift);
     }
 
     // now need to shift numerator by same amount as denominator
@@ -392,7 +478,7 @@ STATIC void mpn_div(mpz_dig_t *num_dig, mp_uint_t *num_len, mpz_dig_t *den_dig,
     for (mpz_dig_t *num = num_dig, carry = 0; num < num_dig + *num_len; ++num) {
         mpz_dig_t n = *num;
         *num = ((n << norm_shift) | carry) & DIG_MASK;
-        carry = n >> (DIG_SIZE - norm_shift);
+        carry = (mpz_dbl_dig_t)n >> (DIG_SIZE - norm_shift);
     }
 
     // cache the leading digit of the denominator
@@ -411,8 +497,11 @@ STATIC void mpn_div(mpz_dig_t *num_dig, mp_uint_t *num_len, mpz_dig_t *den_dig,
     while (*num_len > den_len) {
         mpz_dbl_dig_t quo = ((mpz_dbl_dig_t)*num_dig << DIG_SIZE) | num_dig[-1];
 
-        // get approximate quotient
+        // get approximate quotient, which can't be more than one digit
         quo /= lead_den_digit;
+        if (quo > DIG_MASK) {
+            quo = DIG_MASK;
+        }
 
         // Multiply quo by den and subtract from num to get remainder.
         // We have different code here to handle different compile-time
@@ -509,14 +598,14 @@ STATIC void mpn_div(mpz_dig_t *num_dig, mp_uint_t *num_len, mpz_dig_t *den_dig,
     for (mpz_dig_t *den = den_dig + den_len - 1, carry = 0; den >= den_dig; --den) {
         mpz_dig_t d = *den;
         *den = ((d >> norm_shift) | carry) & DIG_MASK;
-        carry = d << (DIG_SIZE - norm_shift);
+        carry = ((mpz_dbl_dig_t)d << (DIG_SIZE - norm_shift)) & DIG_MASK;
     }
 
     // unnormalise numerator (remainder now)
     for (mpz_dig_t *num = orig_num_dig + *num_len - 1, carry = 0; num >= orig_num_dig; --num) {
         mpz_dig_t n = *num;
         *num = ((n >> norm_shift) | carry) & DIG_MASK;
-        carry = n << (DIG_SIZE - norm_shift);
+        carry = ((mpz_dbl_dig_t)n << (DIG_SIZE - norm_shift)) & DIG_MASK;
     }
 
     // strip trailing zeros
@@ -622,11 +711,14 @@ STATIC void mpz_need_dig(mpz_t *z, mp_uint_t need) {
 
     if (z->dig == NULL || z->alloc < need) {
         if (z->fixed_dig) {
-            // cannot reallocate fixed buffers
-            assert(0);
-            return;
+            // outgrown a fixed buffer, so move the digits to the heap
+            mpz_dig_t *dig = m_new(mpz_dig_t, need);
+            memcpy(dig, z->dig, z->len * sizeof(mpz_dig_t));
+            z->dig = dig;
+            z->fixed_dig = 0;
+        } else {
+            z->dig = m_renew(mpz_dig_t, z->dig, z->alloc, need);
         }
-        z->dig = m_renew(mpz_dig_t, z->dig, z->alloc, need);
         z->alloc = need;
     }
 }
@@ -766,14 +858,84 @@ typedef uint32_t mp_float_int_t;
 }
 #endif
 
+// returns the value of the character as a digit, or base if it isn't one
+STATIC mp_uint_t mpz_char_to_digit(mp_uint_t v, mp_uint_t base) {
+    //mp_uint_t v = char_to_numeric(cur#); // XXX UTF8 get char
+    if ('0' <= v && v <= '9') {
+        v -= '0';
+    } else if ('A' <= v && v <= 'Z') {
+        v -= 'A' - 10;
+    } else if ('a' <= v && v <= 'z') {
+        v -= 'a' - 10;
+    } else {
+        return base;
+    }
+    if (v >= base) {
+        return base;
+    }
+    return v;
+}
+
+/* sets z to the non-negative value of the len digits in str
+   assumes all characters of str are valid digits in the given base
+*/
+STATIC void mpz_set_from_digits(mpz_t *z, const char *str, mp_uint_t len, mp_uint_t base) {
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    if (len * log_base2_floor[base] >= 4 * KARATSUBA_THRESHOLD * DIG_SIZE) {
+        // divide and conquer: z = hi * base**lo_len + lo
+        mp_uint_t lo_len = len / 2;
+        mpz_t hi, lo, pow, exp;
+        mpz_init_zero(&hi);
+        mpz_init_zero(&lo);
+        mpz_init_from_int(&pow, base);
+        mpz_init_from_int(&exp, lo_len);
+        mpz_set_from_digits(&hi, str, len - lo_len, base);
+        mpz_set_from_digits(&lo, str + len - lo_len, lo_len, base);
+        mpz_pow_inpl(&pow, &pow, &exp);
+        mpz_mul_inpl(z, &hi, &pow);
+        mpz_add_inpl(z, z, &lo);
+        mpz_deinit(&hi);
+        mpz_deinit(&lo);
+        mpz_deinit(&pow);
+        mpz_deinit(&exp);
+        return;
+    }
+    #endif
+
+    mpz_need_dig(z, len * 8 / DIG_SIZE + 1);
+    z->neg = 0;
+    z->len = 0;
+
+    // accumulate as many characters as fit in a digit before each multiply
+    mp_uint_t chunk_n;
+    mpz_dig_t chunk = mpn_base_chunk(base, &chunk_n);
+    const char *top = str + len;
+    while (str < top) {
+        mpz_dig_t mul = chunk;
+        if ((mp_uint_t)(top - str) < chunk_n) {
+            mul = 1;
+            for (const char *c = str; c < top; ++c) {
+                mul *= base;
+            }
+        }
+        mpz_dig_t v = 0;
+        for (mp_uint_t n = 0; n < chunk_n && str < top; ++n, ++str) {
+            v = v * base + mpz_char_to_digit(*str, base);
+        }
+        z->len = mpn_mul_dig_add_dig(z->dig, z->len, mul, v);
+    }
+}
+
 // returns number of bytes from str that were processed
 mp_uint_t mpz_set_from_str(mpz_t *z, const char *str, mp_uint_t len, bool neg, mp_uint_t base) {
     assert(base < 36);
 
     const char *cur = str;
     const char *top = str + len;
+    for (; cur < top && mpz_char_to_digit(*cur, base) < base; ++cur) { // XXX UTF8 next char
+    }
 
-    mpz_need_dig(z, len * 8 / DIG_SIZE + 1);
+    mpz_set_from_digits(z, str, cur - str, base);
 
     if (neg) {
         z->neg = 1;
@@ -781,25 +943,6 @@ mp_uint_t mpz_set_from_str(mpz_t *z, const char *str, mp_uint_t len, bool neg, m
         z->neg = 0;
     }
 
-    z->len = 0;
-    for (; cur < top; ++cur) { // XXX UTF8 next char
-        //mp_uint_t v = char_to_numeric(cur#); // XXX UTF8 get char
-        mp_uint_t v = *cur;
-        if ('0' <= v && v <= '9') {
-            v -= '0';
-        } else if ('A' <= v && v <= 'Z') {
-            v -= 'A' - 10;
-        } else if ('a' <= v && v <= 'z') {
-            v -= 'a' - 10;
-        } else {
-            break;
-        }
-        if (v >= base) {
-            break;
-        }
-        z->len = mpn_mul_dig_add_dig(z->dig, z->len, base, v);
-    }
-
     return cur - str;
 }
 
@@ -1191,8 +1334,24 @@ void mpz_mul_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     }
 
     mpz_need_dig(dest, lhs->len + rhs->len); // min mem l+r-1, max mem l+r
-    memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
-    dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    if (lhs->len >= KARATSUBA_THRESHOLD && rhs->len >= KARATSUBA_THRESHOLD) {
+        if (lhs->len < rhs->len) {
+            const mpz_t *t = lhs;
+            lhs = rhs;
+            rhs = t;
+        }
+        mpn_mul_kara(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+        dest->len = lhs->len + rhs->len;
+        while (dest->len > 0 && dest->dig[dest->len - 1] == 0) {
+            --dest->len;
+        }
+    } else
+    #endif
+    {
+        memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
+        dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    }
 
     if (lhs->neg == rhs->neg) {
         dest->neg = 0;
@@ -1342,6 +1501,223 @@ void mpz_divmod_inpl(mpz_t *dest_quo, mpz_t *dest_rem, const mpz_t *lhs, const m
     }
 }
 
+#if MICROPY_PY_BUILTINS_POW3
+/* computes r = a * b / B^n mod m, the Montgomery product of a and b
+   a, b, r have n digits and are less than m; m is odd and has n digits
+   minv = -1 / m mod B; t is scratch space for 2n + 1 digits
+   can have r, a, b the same
+*/
+STATIC void mpn_mont_mul(mpz_dig_t *r, const mpz_dig_t *a, const mpz_dig_t *b, const mpz_dig_t *m, mp_uint_t n, mpz_dig_t minv, mpz_dig_t *t) {
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    mpn_mul_kara(t, a, n, b, n);
+    #else
+    memset(t, 0, 2 * n * sizeof(mpz_dig_t));
+    mpn_mul(t, (mpz_dig_t*)a, n, (mpz_dig_t*)b, n);
+    #endif
+    t[2 * n] = 0;
+
+    // add multiples of m to clear the low n digits of t
+    for (mp_uint_t i = 0; i < n; ++i) {
+        mpz_dig_t u = ((mpz_dbl_dig_t)t[i] * minv) & DIG_MASK;
+        mpz_dig_t *td = t + i;
+        mpz_dbl_dig_t carry = 0;
+        for (mp_uint_t j = 0; j < n; ++j, ++td) {
+            carry += (mpz_dbl_dig_t)*td + (mpz_dbl_dig_t)u * (mpz_dbl_dig_t)m[j]; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
+            *td = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        for (; carry != 0; ++td) {
+            carry += *td;
+            *td = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+    }
+
+    // the high n + 1 digits of t are now less than 2m; subtract m if needed
+    mpz_dig_t *hi = t + n;
+    bool ge = true;
+    if (hi[n] == 0) {
+        for (mp_uint_t j = n; j-- > 0;) {
+            if (hi[j] != m[j]) {
+                ge = hi[j] > m[j];
+                break;
+            }
+        }
+    }
+    if (ge) {
+        mpz_dbl_dig_signed_t borrow = 0;
+        for (mp_uint_t j = 0; j < n; ++j) {
+            borrow += (mpz_dbl_dig_t)hi[j] - (mpz_dbl_dig_t)m[j];
+            r[j] = borrow & DIG_MASK;
+            borrow >>= DIG_SIZE;
+        }
+    } else {
+        memcpy(r, hi, n * sizeof(mpz_dig_t));
+    }
+}
+
+#define EXP_BIT(e, i) (((e)->dig[(i) / DIG_SIZE] >> ((i) % DIG_SIZE)) & 1)
+
+/* computes res = x ** e % m using Montgomery multiplication and a sliding
+   window over the bits of e
+   assumes 0 <= x < m, e > 0 and m odd and greater than 1
+*/
+STATIC void mpz_pow3_mont(mpz_t *res, const mpz_t *x, const mpz_t *e, const mpz_t *m) {
+    mp_uint_t n = m->len;
+
+    // minv = -1 / m mod B, by Newton's iteration (m * m = 1 mod 8 for odd m)
+    mpz_dbl_dig_t inv = m->dig[0];
+    for (int bits = 3; bits < DIG_SIZE; bits *= 2) {
+        inv = (inv * (2 - (mpz_dbl_dig_t)m->dig[0] * inv)) & DIG_MASK;
+    }
+    mpz_dig_t minv = (-inv) & DIG_MASK;
+
+    mp_uint_t nbits = (e->len - 1) * DIG_SIZE;
+    for (mpz_dig_t d = e->dig[e->len - 1]; d != 0; d >>= 1) {
+        ++nbits;
+    }
+    mp_uint_t w = nbits > 671 ? 6 : nbits > 239 ? 5 : nbits > 79 ? 4 : nbits > 23 ? 3 : 2;
+
+    // table holds x, x^3, x^5, ..., x^(2^w - 1) in Montgomery form
+    mp_uint_t table_len = 1 << (w - 1);
+    mp_uint_t buf_len = (table_len + 2) * n + 2 * n + 1;
+    mpz_dig_t *buf = m_new0(mpz_dig_t, buf_len);
+    mpz_dig_t *table = buf;
+    mpz_dig_t *acc = table + table_len * n;
+    mpz_dig_t *sq = acc + n;
+    mpz_dig_t *t = sq + n;
+
+    // convert x to Montgomery form: x * B^n mod m
+    {
+        mpz_t xr, quo;
+        mpz_init_zero(&xr);
+        mpz_init_zero(&quo);
+        mpz_shl_inpl(&xr, x, n * DIG_SIZE);
+        mpz_divmod_inpl(&quo, &xr, &xr, m);
+        memcpy(table, xr.dig, xr.len * sizeof(mpz_dig_t));
+        mpz_deinit(&xr);
+        mpz_deinit(&quo);
+    }
+    mpn_mont_mul(sq, table, table, m->dig, n, minv, t);
+    for (mp_uint_t k = 1; k < table_len; ++k) {
+        mpn_mont_mul(table + k * n, table + (k - 1) * n, sq, m->dig, n, minv, t);
+    }
+
+    // left to right over the bits of e, taking windows that end in a 1 bit
+    bool started = false;
+    for (mp_int_t i = nbits - 1; i >= 0;) {
+        if (!EXP_BIT(e, i)) {
+            mpn_mont_mul(acc, acc, acc, m->dig, n, minv, t);
+            --i;
+            continue;
+        }
+        mp_int_t l = i - (mp_int_t)w + 1;
+        if (l < 0) {
+            l = 0;
+        }
+        while (!EXP_BIT(e, l)) {
+            ++l;
+        }
+        mp_uint_t val = 0;
+        for (mp_int_t j = i; j >= l; --j) {
+            val = (val << 1) | EXP_BIT(e, j);
+        }
+        if (started) {
+            for (mp_int_t j = l; j <= i; ++j) {
+                mpn_mont_mul(acc, acc, acc, m->dig, n, minv, t);
+            }
+            mpn_mont_mul(acc, acc, table + (val >> 1) * n, m->dig, n, minv, t);
+        } else {
+            memcpy(acc, table + (val >> 1) * n, n * sizeof(mpz_dig_t));
+            started = true;
+        }
+        i = l - 1;
+    }
+
+    // convert out of Montgomery form by multiplying by 1
+    memset(sq, 0, n * sizeof(mpz_dig_t));
+    sq[0] = 1;
+    mpn_mont_mul(acc, acc, sq, m->dig, n, minv, t);
+
+    mpz_need_dig(res, n);
+    memcpy(res->dig, acc, n * sizeof(mpz_dig_t));
+    res->len = n;
+    while (res->len > 0 && res->dig[res->len - 1] == 0) {
+        --res->len;
+    }
+    res->neg = 0;
+
+    m_del(mpz_dig_t, buf, buf_len);
+}
+
+/* computes res = x ** e % m by square and multiply, reducing as it goes
+   assumes 0 <= x < m and e > 0; used for even m
+*/
+STATIC void mpz_pow3_plain(mpz_t *res, mpz_t *x, const mpz_t *e, const mpz_t *m) {
+    mpz_t quo;
+    mpz_init_zero(&quo);
+    mpz_set_from_int(res, 1);
+    mp_uint_t nbits = e->len * DIG_SIZE;
+    for (mp_uint_t i = 0; i < nbits; ++i) {
+        if (EXP_BIT(e, i)) {
+            mpz_mul_inpl(res, res, x);
+            mpz_divmod_inpl(&quo, res, res, m);
+        }
+        if (i + 1 < nbits) {
+            mpz_mul_inpl(x, x, x);
+            mpz_divmod_inpl(&quo, x, x, m);
+        }
+    }
+    mpz_deinit(&quo);
+}
+
+#undef EXP_BIT
+
+/* computes dest = lhs ** rhs % mod, with the sign of mod (as Python's %)
+   assumes rhs >= 0 and mod != 0
+   can have dest, lhs, rhs, mod the same
+*/
+void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
+    mpz_t m, x, res;
+    mpz_init_zero(&m);
+    mpz_init_zero(&x);
+    mpz_init_zero(&res);
+    mpz_abs_inpl(&m, mod);
+
+    // x = lhs % m, in the range [0, m)
+    {
+        mpz_t quo;
+        mpz_init_zero(&quo);
+        mpz_divmod_inpl(&quo, &x, lhs, &m);
+        mpz_deinit(&quo);
+        if (x.neg && x.len != 0) {
+            mpz_add_inpl(&x, &x, &m);
+        }
+        x.neg = 0;
+    }
+
+    if (m.len == 1 && m.dig[0] == 1) {
+        // anything mod 1 is 0
+    } else if (rhs->len == 0) {
+        mpz_set_from_int(&res, 1);
+    } else if (m.dig[0] & 1) {
+        mpz_pow3_mont(&res, &x, rhs, &m);
+    } else {
+        mpz_pow3_plain(&res, &x, rhs, &m);
+    }
+
+    if (mod->neg && res.len != 0) {
+        mpz_sub_inpl(&res, &res, &m);
+    }
+
+    mpz_set(dest, &res);
+
+    mpz_deinit(&m);
+    mpz_deinit(&x);
+    mpz_deinit(&res);
+}
+#endif
+
 #if 0
 these functions are unused
 
@@ -1522,9 +1898,11 @@ mp_uint_t mpz_as_str_inpl(const mpz_t *i, mp_uint_t base, const char *prefix, ch
     mpz_dig_t *dig = m_new(mpz_dig_t, ilen);
     memcpy(dig, i->dig, ilen * sizeof(mpz_dig_t));
 
-    // convert
+    // convert, dividing by the largest power of base that fits in a digit
+    // and then emitting that many characters from the remainder
+    mp_uint_t chunk_n;
+    mpz_dig_t chunk = mpn_base_chunk(base, &chunk_n);
     char *last_comma = str;
-    bool done;
     do {
         mpz_dig_t *d = dig + ilen;
         mpz_dbl_dig_t a = 0;
@@ -1532,34 +1910,36 @@ mp_uint_t mpz_as_str_inpl(const mpz_t *i, mp_uint_t base, const char *prefix, ch
         // compute next remainder
         while (--d >= dig) {
             a = (a << DIG_SIZE) | *d;
-            *d = a / base;
-            a %= base;
+            *d = a / chunk;
+            a %= chunk;
         }
 
-        // convert to character
-        a += '0';
-        if (a > '9') {
-            a += base_char - '9' - 1;
+        // strip leading zero digits of the quotient
+        while (ilen > 0 && dig[ilen - 1] == 0) {
+            --ilen;
         }
-        *s++ = a;
 
-        // check if number is zero
-        done = true;
-        for (d = dig; d < dig + ilen; ++d) {
-            if (*d != 0) {
-                done = false;
-                break;
+        // convert to characters; the last chunk has no leading zeros
+        for (mp_uint_t n = 0; n < chunk_n && (ilen > 0 || a > 0); ++n) {
+            if (comma && (s - last_comma) == 3) {
+                *s++ = comma;
+                last_comma = s;
             }
+            mpz_dig_t c = a % base + '0';
+            a /= base;
+            if (c > '9') {
+                c += base_char - '9' - 1;
+            }
+            *s++ = c;
         }
-        if (comma && (s - last_comma) == 3) {
-            *s++ = comma;
-            last_comma = s;
-        }
+    } while (ilen > 0);
+    if (s == str) {
+        // i had digits but was zero
+        *s++ = '0';
     }
-    while (!done);
 
     // free the copy of the digits array
-    m_del(mpz_dig_t, dig, ilen);
+    m_del(mpz_dig_t, dig, i->len);
 
     if (prefix) {
         const char *p = &prefix[strlen(prefix)];
@@ -80,6 +80,7 @@ typedef int8_t mpz_dbl_dig_signed_t;
 
 #define MPZ_NUM_DIG_FOR_INT (sizeof(mp_int_t) * 8 / MPZ_DIG_SIZE + 1)
 #define MPZ_NUM_DIG_FOR_LL (sizeof(long long) * 8 / MPZ_DIG_SIZE + 1)
+#define MPZ_NUM_DIG_FOR_SCRATCH (2 * MPZ_NUM_DIG_FOR_LL)
 
 typedef struct _mpz_t {
     mp_uint_t neg : 1;
@@ -90,7 +91,12 @@ typedef struct _mpz_t {
 } mpz_t;
 
 // convenience macro to declare an mpz with a digit array from the stack, initialised by an integer
-#define MPZ_CONST_INT(z, val) mpz_t z; mpz_dig_t z ## _digits[MPZ_NUM_DIG_FOR_INT]; mpz_init_fixed_from_int(&z, z_digits, MPZ_NUM_DIG_FOR_INT, val);
+#define MPZ_CONST_INT(z, val) mpz_t z; mpz_dig_t z ## _digits[MPZ_NUM_DIG_FOR_INT]; mpz_init_fixed_from_int(&z, z ## _digits, MPZ_NUM_DIG_FOR_INT, val);
+
+// convenience macro to declare a zero mpz to compute into, with a digit array
+// from the stack that holds any result of arithmetic on 64-bit values; if it
+// needs more digits they are moved to the heap, so call mpz_deinit when done
+#define MPZ_SCRATCH(z) mpz_t z; mpz_dig_t z ## _digits[MPZ_NUM_DIG_FOR_SCRATCH]; mpz_init_fixed_from_int(&z, z ## _digits, MPZ_NUM_DIG_FOR_SCRATCH, 0);
 
 void mpz_init_zero(mpz_t *z);
 void mpz_init_from_int(mpz_t *z, mp_int_t val);
@@ -117,6 +123,7 @@ void mpz_add_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
 void mpz_sub_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
 void mpz_mul_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
 void mpz_pow_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
+void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod);
 void mpz_and_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
 void mpz_or_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
 void mpz_xor_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs);
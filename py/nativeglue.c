@@ -45,7 +45,7 @@
 // convert a Micro Python object to a valid native value based on type
 mp_uint_t mp_convert_obj_to_native(mp_obj_t obj, mp_uint_t type) {
     DEBUG_printf("mp_convert_obj_to_native(%p, " UINT_FMT ")\n", obj, type);
-    switch (type & 3) {
+    switch (type & 0xf) {
         case MP_NATIVE_TYPE_OBJ: return (mp_uint_t)obj;
         case MP_NATIVE_TYPE_BOOL:
         case MP_NATIVE_TYPE_INT: return mp_obj_get_int(obj);
@@ -58,6 +58,14 @@ mp_uint_t mp_convert_obj_to_native(mp_obj_t obj, mp_uint_t type) {
                 return mp_obj_get_int(obj);
             }
         }
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case MP_NATIVE_TYPE_FLOAT: {
+            // the bits of the float are passed around in a machine word
+            union { mp_float_t f; mp_uint_t u; } v = {.u = 0};
+            v.f = mp_obj_get_float(obj);
+            return v.u;
+        }
+        #endif
         default: assert(0); return 0;
     }
 }
@@ -65,11 +73,17 @@ mp_uint_t mp_convert_obj_to_native(mp_obj_t obj, mp_uint_t type) {
 // convert a native value to a Micro Python object based on type
 mp_obj_t mp_convert_native_to_obj(mp_uint_t val, mp_uint_t type) {
     DEBUG_printf("mp_convert_native_to_obj(" UINT_FMT ", " UINT_FMT ")\n", val, type);
-    switch (type & 3) {
+    switch (type & 0xf) {
         case MP_NATIVE_TYPE_OBJ: return (mp_obj_t)val;
         case MP_NATIVE_TYPE_BOOL: return MP_BOOL(val);
         case MP_NATIVE_TYPE_INT: return mp_obj_new_int(val);
         case MP_NATIVE_TYPE_UINT: return mp_obj_new_int_from_uint(val);
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case MP_NATIVE_TYPE_FLOAT: {
+            union { mp_float_t f; mp_uint_t u; } v = {.u = val};
+            return mp_obj_new_float(v.f);
+        }
+        #endif
         default: assert(0); return mp_const_none;
     }
 }
@@ -81,9 +95,10 @@ mp_obj_t mp_native_call_function_n_kw(mp_obj_t fun_in, mp_uint_t n_args_kw, cons
 }
 
 // wrapper that makes raise obj and raises it
-// END_FINALLY opcode requires that we don't raise if o==None
+// END_FINALLY opcode requires that we don't raise if o==None (which viper
+// code represents as 0)
 void mp_native_raise(mp_obj_t o) {
-    if (o != mp_const_none) {
+    if (o != mp_const_none && o != MP_OBJ_NULL) {
         nlr_raise(mp_make_raise_obj(o));
     }
 }
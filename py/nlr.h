@@ -64,14 +64,21 @@ struct _nlr_buf_t {
 #endif
 };
 
+#if (MICROPY_PY_THREAD || MICROPY_MULTIPLE_INTERPRETERS) && !MICROPY_NLR_SETJMP \
+    && !(defined(__x86_64__) && !defined(__APPLE__) && !defined(__CYGWIN__))
+// nlr_top is reached through a thread-local pointer, which only the x86-64
+// ELF asm code knows how to follow
+#error MICROPY_PY_THREAD and MICROPY_MULTIPLE_INTERPRETERS require MICROPY_NLR_SETJMP on this arch
+#endif
+
 #if MICROPY_NLR_SETJMP
 #include "py/mpstate.h"
 
 NORETURN void nlr_setjmp_jump(void *val);
 // nlr_push() must be defined as a macro, because "The stack context will be
 // invalidated if the function which called setjmp() returns."
-#define nlr_push(buf) ((buf)->prev = MP_STATE_VM(nlr_top), MP_STATE_VM(nlr_top) = (buf), setjmp((buf)->jmpbuf))
-#define nlr_pop() { MP_STATE_VM(nlr_top) = MP_STATE_VM(nlr_top)->prev; }
+#define nlr_push(buf) ((buf)->prev = MP_STATE_THREAD(nlr_top), MP_STATE_THREAD(nlr_top) = (buf), setjmp((buf)->jmpbuf))
+#define nlr_pop() { MP_STATE_THREAD(nlr_top) = MP_STATE_THREAD(nlr_top)->prev; }
 #define nlr_jump(val) nlr_setjmp_jump(val)
 #else
 unsigned int nlr_push(nlr_buf_t *);
@@ -91,7 +98,7 @@ void nlr_jump_fail(void *val);
 #include "mpstate.h"
 #define nlr_raise(val) \
     do { \
-        /*printf("nlr_raise: nlr_top=%p\n", MP_STATE_VM(nlr_top)); \
+        /*printf("nlr_raise: nlr_top=%p\n", MP_STATE_THREAD(nlr_top)); \
         fflush(stdout);*/ \
         void *_val = val; \
         assert(_val != NULL); \
@@ -101,11 +108,11 @@ void nlr_jump_fail(void *val);
 
 #if !MICROPY_NLR_SETJMP
 #define nlr_push(val) \
-    assert(MP_STATE_VM(nlr_top) != val),nlr_push(val)
+    assert(MP_STATE_THREAD(nlr_top) != val),nlr_push(val)
 
 /*
 #define nlr_push(val) \
-    printf("nlr_push: before: nlr_top=%p, val=%p\n", MP_STATE_VM(nlr_top), val),assert(MP_STATE_VM(nlr_top) != val),nlr_push(val)
+    printf("nlr_push: before: nlr_top=%p, val=%p\n", MP_STATE_THREAD(nlr_top), val),assert(MP_STATE_THREAD(nlr_top) != val),nlr_push(val)
 #endif
 */
 #endif
@@ -33,6 +33,7 @@
 #include "py/obj.h"
 #include "py/objtype.h"
 #include "py/objint.h"
+#include "py/objstr.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
 #include "py/stackctrl.h"
@@ -43,6 +44,10 @@ mp_obj_type_t *mp_obj_get_type(mp_const_obj_t o_in) {
         return (mp_obj_t)&mp_type_int;
     } else if (MP_OBJ_IS_QSTR(o_in)) {
         return (mp_obj_t)&mp_type_str;
+    #if MICROPY_PY_BUILTINS_FLOAT && (MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D)
+    } else if (mp_obj_is_float(o_in)) {
+        return (mp_obj_t)&mp_type_float;
+    #endif
     } else {
         const mp_obj_base_t *o = o_in;
         return (mp_obj_t)o->type;
@@ -314,7 +319,7 @@ mp_float_t mp_obj_get_float(mp_obj_t arg) {
         return MP_OBJ_SMALL_INT_VALUE(arg);
     } else if (MP_OBJ_IS_TYPE(arg, &mp_type_int)) {
         return mp_obj_int_as_float(arg);
-    } else if (MP_OBJ_IS_TYPE(arg, &mp_type_float)) {
+    } else if (mp_obj_is_float(arg)) {
         return mp_obj_float_get(arg);
     } else {
         if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
@@ -341,7 +346,7 @@ void mp_obj_get_complex(mp_obj_t arg, mp_float_t *real, mp_float_t *imag) {
     } else if (MP_OBJ_IS_TYPE(arg, &mp_type_int)) {
         *real = mp_obj_int_as_float(arg);
         *imag = 0;
-    } else if (MP_OBJ_IS_TYPE(arg, &mp_type_float)) {
+    } else if (mp_obj_is_float(arg)) {
         *real = mp_obj_float_get(arg);
         *imag = 0;
     } else if (MP_OBJ_IS_TYPE(arg, &mp_type_complex)) {
@@ -480,6 +485,29 @@ mp_obj_t mp_obj_len_maybe(mp_obj_t o_in) {
     }
 }
 
+// Returns the number of items the object is expected to yield when iterated,
+// or -1 if unknown.  This is only used to size buffers up front so it need not
+// be exact.  User classes are not asked so that no Python code is run.
+mp_int_t mp_obj_len_hint(mp_obj_t o_in) {
+    mp_obj_t len;
+    if (MP_OBJ_IS_STR_OR_BYTES(o_in)) {
+        len = mp_obj_len_maybe(o_in);
+    } else {
+        mp_obj_type_t *type = mp_obj_get_type(o_in);
+        if (type->unary_op == NULL || mp_obj_is_instance_type(type)) {
+            return -1;
+        }
+        len = type->unary_op(MP_UNARY_OP_LEN, o_in);
+        if (len == MP_OBJ_NULL) {
+            len = type->unary_op(MP_UNARY_OP_LEN_HINT, o_in);
+        }
+    }
+    if (len != MP_OBJ_NULL && MP_OBJ_IS_SMALL_INT(len)) {
+        return MP_OBJ_SMALL_INT_VALUE(len);
+    }
+    return -1;
+}
+
 mp_obj_t mp_obj_subscr(mp_obj_t base, mp_obj_t index, mp_obj_t value) {
     mp_obj_type_t *type = mp_obj_get_type(base);
     if (type->subscr != NULL) {
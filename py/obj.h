@@ -101,6 +101,36 @@ static inline bool MP_OBJ_IS_QSTR(mp_const_obj_t o)
 static inline bool MP_OBJ_IS_OBJ(mp_const_obj_t o)
     { return ((((mp_int_t)(o)) & 1) == 0); }
 
+#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C
+
+static inline bool MP_OBJ_IS_SMALL_INT(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) >> 48) == 1); }
+#define MP_OBJ_SMALL_INT_VALUE(o) (((mp_int_t)(((mp_uint_t)(o)) << 16)) >> 16)
+#define MP_OBJ_NEW_SMALL_INT(small_int) ((mp_obj_t)((((mp_uint_t)(small_int)) & 0xffffffffffff) | 0x1000000000000))
+
+static inline bool MP_OBJ_IS_QSTR(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) >> 48) == 2); }
+#define MP_OBJ_QSTR_VALUE(o) (((mp_uint_t)(o)) & 0xffffffff)
+#define MP_OBJ_NEW_QSTR(qst) ((mp_obj_t)(((mp_uint_t)(qst)) | 0x2000000000000))
+
+static inline bool MP_OBJ_IS_OBJ(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) >> 48) == 0); }
+
+#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D
+
+static inline bool MP_OBJ_IS_SMALL_INT(mp_const_obj_t o)
+    { return ((((mp_int_t)(o)) & 1) != 0); }
+#define MP_OBJ_SMALL_INT_VALUE(o) (((mp_int_t)(o)) >> 1)
+#define MP_OBJ_NEW_SMALL_INT(small_int) ((mp_obj_t)((((mp_int_t)(small_int)) << 1) | 1))
+
+static inline bool MP_OBJ_IS_QSTR(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) & 0xff800007) == 0x00000006); }
+#define MP_OBJ_QSTR_VALUE(o) (((mp_uint_t)(o)) >> 3)
+#define MP_OBJ_NEW_QSTR(qst) ((mp_obj_t)((((mp_uint_t)(qst)) << 3) | 0x00000006))
+
+static inline bool MP_OBJ_IS_OBJ(mp_const_obj_t o)
+    { return ((((mp_int_t)(o)) & 3) == 0); }
+
 #endif
 
 // Macros to convert between mp_obj_t and concrete object types.
@@ -208,6 +238,22 @@ typedef struct _mp_map_t {
     mp_map_elem_t *table;
 } mp_map_t;
 
+// Number of elements allocated for the table of a (non-fixed) map with the
+// given number of slots; with hash tags, the tag bytes come after the slots.
+// A compact map has a dense array of alloc slots, filled in insertion order,
+// followed by a count of the slots used so far and an index table mapping
+// hashes to slot numbers (1, 2 or 4 bytes each).
+#if MICROPY_OPT_MAP_COMPACT
+#define MP_MAP_INDEX_LEN(alloc) (((alloc) + (alloc) / 2 + 1) | 1)
+#define MP_MAP_INDEX_WIDTH(alloc) ((alloc) < 0xff ? 1 : (alloc) < 0xffff ? 2 : 4)
+#define MP_MAP_TABLE_LEN(alloc) ((alloc) == 0 ? 0 : (alloc) \
+    + (sizeof(mp_uint_t) + MP_MAP_INDEX_LEN(alloc) * MP_MAP_INDEX_WIDTH(alloc) + sizeof(mp_map_elem_t) - 1) / sizeof(mp_map_elem_t))
+#elif MICROPY_OPT_MAP_HASH_TAGS
+#define MP_MAP_TABLE_LEN(alloc) ((alloc) + ((alloc) + sizeof(mp_map_elem_t) - 1) / sizeof(mp_map_elem_t))
+#else
+#define MP_MAP_TABLE_LEN(alloc) (alloc)
+#endif
+
 // mp_set_lookup requires these constants to have the values they do
 typedef enum _mp_map_lookup_kind_t {
     MP_MAP_LOOKUP = 0,
@@ -226,6 +272,7 @@ mp_map_t *mp_map_new(mp_uint_t n);
 void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
+void mp_map_reserve(mp_map_t *map, mp_uint_t n);
 void mp_map_clear(mp_map_t *map);
 void mp_map_dump(mp_map_t *map);
 
@@ -241,6 +288,7 @@ static inline bool MP_SET_SLOT_IS_FILLED(const mp_set_t *set, mp_uint_t pos) { r
 
 void mp_set_init(mp_set_t *set, mp_uint_t n);
 mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
+void mp_set_reserve(mp_set_t *set, mp_uint_t n);
 mp_obj_t mp_set_remove_first(mp_set_t *set);
 void mp_set_clear(mp_set_t *set);
 
@@ -390,6 +438,7 @@ extern const mp_obj_type_t mp_type_enumerate;
 extern const mp_obj_type_t mp_type_filter;
 extern const mp_obj_type_t mp_type_dict;
 extern const mp_obj_type_t mp_type_ordereddict;
+extern const mp_obj_type_t mp_type_deque;
 extern const mp_obj_type_t mp_type_range;
 extern const mp_obj_type_t mp_type_set;
 extern const mp_obj_type_t mp_type_frozenset;
@@ -468,20 +517,20 @@ mp_obj_t mp_obj_new_int_from_ull(unsigned long long val); // this must return a
 mp_obj_t mp_obj_new_str(const char* data, mp_uint_t len, bool make_qstr_if_not_already);
 mp_obj_t mp_obj_new_str_from_vstr(const mp_obj_type_t *type, vstr_t *vstr);
 mp_obj_t mp_obj_new_bytes(const byte* data, mp_uint_t len);
+mp_obj_t mp_obj_new_array(char typecode, mp_uint_t n);
 mp_obj_t mp_obj_new_bytearray(mp_uint_t n, void *items);
 mp_obj_t mp_obj_new_bytearray_by_ref(mp_uint_t n, void *items);
 #if MICROPY_PY_BUILTINS_FLOAT
 mp_obj_t mp_obj_new_int_from_float(mp_float_t val);
-mp_obj_t mp_obj_new_float(mp_float_t val);
 mp_obj_t mp_obj_new_complex(mp_float_t real, mp_float_t imag);
 #endif
 mp_obj_t mp_obj_new_exception(const mp_obj_type_t *exc_type);
 mp_obj_t mp_obj_new_exception_arg1(const mp_obj_type_t *exc_type, mp_obj_t arg);
 mp_obj_t mp_obj_new_exception_args(const mp_obj_type_t *exc_type, mp_uint_t n_args, const mp_obj_t *args);
-mp_obj_t mp_obj_new_exception_msg(const mp_obj_type_t *exc_type, const char *msg);
+mp_obj_t mp_obj_new_exception_msg(const mp_obj_type_t *exc_type, const char *msg); // msg is used in place, so must not change (eg a string literal)
 mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char *fmt, ...); // counts args by number of % symbols in fmt, excluding %%; can only handle void* sizes (ie no float/double!)
-mp_obj_t mp_obj_new_fun_bc(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args, mp_obj_t def_kw_args, const byte *code);
-mp_obj_t mp_obj_new_fun_native(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data);
+mp_obj_t mp_obj_new_fun_bc(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table);
+mp_obj_t mp_obj_new_fun_native(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data, const mp_uint_t *const_table);
 mp_obj_t mp_obj_new_fun_viper(mp_uint_t n_args, void *fun_data, mp_uint_t type_sig);
 mp_obj_t mp_obj_new_fun_asm(mp_uint_t n_args, void *fun_data);
 mp_obj_t mp_obj_new_gen_wrap(mp_obj_t fun);
@@ -524,6 +573,7 @@ mp_uint_t mp_get_index(const mp_obj_type_t *type, mp_uint_t len, mp_obj_t index,
 mp_obj_t mp_obj_id(mp_obj_t o_in);
 mp_obj_t mp_obj_len(mp_obj_t o_in);
 mp_obj_t mp_obj_len_maybe(mp_obj_t o_in); // may return MP_OBJ_NULL
+mp_int_t mp_obj_len_hint(mp_obj_t o_in); // returns -1 if unknown
 mp_obj_t mp_obj_subscr(mp_obj_t base, mp_obj_t index, mp_obj_t val);
 
 // bool
@@ -550,6 +600,9 @@ bool mp_obj_is_exception_instance(mp_obj_t self_in);
 bool mp_obj_exception_match(mp_obj_t exc, mp_const_obj_t exc_type);
 void mp_obj_exception_clear_traceback(mp_obj_t self_in);
 void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, mp_uint_t line, qstr block);
+#if MICROPY_OPT_LAZY_TRACEBACK
+void mp_obj_exception_add_traceback_ip(mp_obj_t self_in, const byte *code_info, const byte *ip);
+#endif
 void mp_obj_exception_get_traceback(mp_obj_t self_in, mp_uint_t *n, mp_uint_t **values);
 mp_obj_t mp_obj_exception_get_value(mp_obj_t self_in);
 mp_obj_t mp_obj_exception_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
@@ -568,15 +621,72 @@ void mp_str_print_quoted(const mp_print_t *print, const byte *str_data, mp_uint_
 
 #if MICROPY_PY_BUILTINS_FLOAT
 // float
+#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C
+#if MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_DOUBLE
+#error MICROPY_OBJ_REPR_C requires double precision floats
+#endif
+#define MP_OBJ_FLOAT_OFFSET (0x8004000000000000)
+static inline bool mp_obj_is_float(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) >> 50) != 0); }
+static inline mp_float_t mp_obj_float_get(mp_const_obj_t o) {
+    union { mp_float_t f; mp_uint_t u; } num = {.u = (mp_uint_t)o - MP_OBJ_FLOAT_OFFSET};
+    return num.f;
+}
+static inline mp_obj_t mp_obj_new_float(mp_float_t f) {
+    union { mp_float_t f; mp_uint_t u; } num = {.f = f};
+    mp_uint_t o = num.u + MP_OBJ_FLOAT_OFFSET;
+    if ((o >> 50) == 0) {
+        // a NaN that would look like another kind of object
+        o = 0x7ff8000000000000 + MP_OBJ_FLOAT_OFFSET;
+    }
+    return (mp_obj_t)o;
+}
+#define mp_const_float_e ((mp_obj_t)(0x4005bf0a8b145769 + MP_OBJ_FLOAT_OFFSET))
+#define mp_const_float_pi ((mp_obj_t)(0x400921fb54442d18 + MP_OBJ_FLOAT_OFFSET))
+#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D
+#if MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_FLOAT
+#error MICROPY_OBJ_REPR_D requires single precision floats
+#endif
+#define MP_OBJ_FLOAT_OFFSET (0x80800000)
+static inline bool mp_obj_is_float(mp_const_obj_t o)
+    { return ((((mp_uint_t)(o)) & 3) == 2) && !MP_OBJ_IS_QSTR(o); }
+static inline mp_float_t mp_obj_float_get(mp_const_obj_t o) {
+    union { mp_float_t f; mp_uint_t u; } num = {.u = ((mp_uint_t)o - MP_OBJ_FLOAT_OFFSET) & ~3};
+    return num.f;
+}
+static inline mp_obj_t mp_obj_new_float(mp_float_t f) {
+    union { mp_float_t f; mp_uint_t u; } num = {.f = f};
+    mp_uint_t o = ((num.u & ~3) | 2) + MP_OBJ_FLOAT_OFFSET;
+    if ((o & 0xff800007) == 0x00000006) {
+        // a NaN that would look like a qstr
+        o = (0x7fc00000 | 2) + MP_OBJ_FLOAT_OFFSET;
+    }
+    return (mp_obj_t)o;
+}
+#define mp_const_float_e ((mp_obj_t)(((0x402df854 & ~3) | 2) + MP_OBJ_FLOAT_OFFSET))
+#define mp_const_float_pi ((mp_obj_t)(((0x40490fdb & ~3) | 2) + MP_OBJ_FLOAT_OFFSET))
+#else
 typedef struct _mp_obj_float_t {
     mp_obj_base_t base;
     mp_float_t value;
 } mp_obj_float_t;
+#define mp_obj_is_float(o) MP_OBJ_IS_TYPE((o), &mp_type_float)
 mp_float_t mp_obj_float_get(mp_obj_t self_in);
+mp_obj_t mp_obj_new_float(mp_float_t val);
+extern const mp_obj_float_t mp_math_e_obj;
+extern const mp_obj_float_t mp_math_pi_obj;
+#define mp_const_float_e ((mp_obj_t)&mp_math_e_obj)
+#define mp_const_float_pi ((mp_obj_t)&mp_math_pi_obj)
+#endif
 mp_obj_t mp_obj_float_binary_op(mp_uint_t op, mp_float_t lhs_val, mp_obj_t rhs); // can return MP_OBJ_NULL if op not supported
 void mp_obj_float_divmod(mp_float_t *x, mp_float_t *y);
 
 // complex
+typedef struct _mp_obj_complex_t {
+    mp_obj_base_t base;
+    mp_float_t real;
+    mp_float_t imag;
+} mp_obj_complex_t;
 void mp_obj_complex_get(mp_obj_t self_in, mp_float_t *real, mp_float_t *imag);
 mp_obj_t mp_obj_complex_binary_op(mp_uint_t op, mp_float_t lhs_real, mp_float_t lhs_imag, mp_obj_t rhs_in); // can return MP_OBJ_NULL if op not supported
 #endif
@@ -614,6 +724,14 @@ void mp_obj_set_store(mp_obj_t self_in, mp_obj_t item);
 // slice
 void mp_obj_slice_get(mp_obj_t self_in, mp_obj_t *start, mp_obj_t *stop, mp_obj_t *step);
 
+// range
+mp_int_t mp_obj_range_get(mp_obj_t self_in, mp_int_t *start, mp_int_t *step); // returns the length
+
+// enumerate, zip and dict.items(); see mp_iternext_unpack
+mp_obj_t mp_obj_enumerate_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items);
+mp_obj_t mp_obj_zip_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items);
+mp_obj_t mp_obj_dict_view_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items);
+
 // functions
 #define MP_OBJ_FUN_ARGS_MAX (0xffff) // to set maximum value in n_args_max below
 typedef struct _mp_obj_fun_builtin_t { // use this to make const objects that go in ROM
@@ -30,9 +30,11 @@
 #include <stdint.h>
 
 #include "py/nlr.h"
+#include "py/objstr.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_ARRAY || MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_BUILTINS_MEMORYVIEW
 
@@ -67,6 +69,9 @@ typedef struct _mp_obj_array_t {
     void *items;
 } mp_obj_array_t;
 
+// largest value that fits in the free bit-field
+#define ARRAY_FREE_MAX ((~(mp_uint_t)0) >> 8)
+
 STATIC mp_obj_t array_iterator_new(mp_obj_t array_in);
 STATIC mp_obj_t array_append(mp_obj_t self_in, mp_obj_t arg);
 STATIC mp_obj_t array_extend(mp_obj_t self_in, mp_obj_t arg_in);
@@ -119,6 +124,46 @@ STATIC mp_obj_array_t *array_new(char typecode, mp_uint_t n) {
     o->items = m_new(byte, typecode_size * o->len);
     return o;
 }
+
+// Reserve room for n more elements at the end of the array and account for
+// them in free; the caller then fills them in and bumps len.  When growing
+// we add spare room proportional to the current length so that repeated
+// append/extend is amortised linear rather than reallocating every time.
+STATIC void array_reserve(mp_obj_array_t *self, mp_uint_t n) {
+    if (self->free < n) {
+        int item_sz = mp_binary_get_size('@', self->typecode, NULL);
+        mp_uint_t spare = self->len / 2;
+        if (spare < 8) {
+            spare = 8;
+        } else if (spare > 0x10000) {
+            spare = 0x10000;
+        }
+        self->items = m_renew(byte, self->items, item_sz * (self->len + self->free), item_sz * (self->len + n + spare));
+        mp_seq_clear(self->items, self->len, self->len + n + spare, item_sz);
+        self->free = spare;
+    } else {
+        self->free -= n;
+    }
+}
+
+// Store n objects into the array starting at element index start; small ints
+// going into a bytearray are written directly to skip the generic converter.
+STATIC void array_store_objs(mp_obj_array_t *self, mp_uint_t start, mp_uint_t n, const mp_obj_t *items) {
+    if (self->typecode == BYTEARRAY_TYPECODE) {
+        byte *dest = (byte*)self->items + start;
+        for (mp_uint_t i = 0; i < n; i++) {
+            if (MP_OBJ_IS_SMALL_INT(items[i])) {
+                dest[i] = MP_OBJ_SMALL_INT_VALUE(items[i]);
+            } else {
+                dest[i] = mp_obj_get_int(items[i]);
+            }
+        }
+    } else {
+        for (mp_uint_t i = 0; i < n; i++) {
+            mp_binary_set_val_array(self->typecode, self->items, start + i, items[i]);
+        }
+    }
+}
 #endif
 
 #if MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_ARRAY
@@ -141,26 +186,31 @@ STATIC mp_obj_t array_construct(char typecode, mp_obj_t initializer) {
         return o;
     }
 
-    mp_uint_t len;
-    // Try to create array of exact len if initializer len is known
-    mp_obj_t len_in = mp_obj_len_maybe(initializer);
-    if (len_in == MP_OBJ_NULL) {
-        len = 0;
-    } else {
-        len = MP_OBJ_SMALL_INT_VALUE(len_in);
+    if (MP_OBJ_IS_TYPE(initializer, &mp_type_list) || MP_OBJ_IS_TYPE(initializer, &mp_type_tuple)) {
+        // construct array directly from the items, no iterator needed
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(initializer, &len, &items);
+        mp_obj_array_t *o = array_new(typecode, len);
+        array_store_objs(o, 0, len, items);
+        return o;
     }
 
+    // Try to create array of exact len if initializer len is known; it's
+    // only a hint so the room is reserved and items are appended
+    mp_int_t len = mp_obj_len_hint(initializer);
+    if (len < 0 || (mp_uint_t)len > ARRAY_FREE_MAX) {
+        len = 0;
+    }
     mp_obj_array_t *array = array_new(typecode, len);
+    array->free = len;
+    array->len = 0;
+    mp_seq_clear(array->items, 0, len, mp_binary_get_size('@', typecode, NULL));
 
     mp_obj_t iterable = mp_getiter(initializer);
     mp_obj_t item;
-    mp_uint_t i = 0;
     while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
-        if (len == 0) {
-            array_append(array, item);
-        } else {
-            mp_binary_set_val_array(typecode, array->items, i++, item);
-        }
+        array_append(array, item);
     }
 
     return array;
@@ -187,10 +237,7 @@ STATIC mp_obj_t array_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_k
 #endif
 
 #if MICROPY_PY_BUILTINS_BYTEARRAY
-STATIC mp_obj_t bytearray_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
-    (void)type_in;
-    mp_arg_check_num(n_args, n_kw, 0, 1, false);
-
+STATIC mp_obj_t bytearray_make(mp_uint_t n_args, const mp_obj_t *args) {
     if (n_args == 0) {
         // no args: construct an empty bytearray
         return array_new(BYTEARRAY_TYPECODE, 0);
@@ -205,6 +252,34 @@ STATIC mp_obj_t bytearray_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t
         return array_construct(BYTEARRAY_TYPECODE, args[0]);
     }
 }
+
+STATIC mp_obj_t bytearray_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    (void)type_in;
+    #if MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE
+    if (n_kw != 0) {
+        static const mp_arg_t allowed_args[] = {
+            { MP_QSTR_source, MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+            { MP_QSTR_reserve, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        };
+        mp_arg_val_t vals[MP_ARRAY_SIZE(allowed_args)];
+        mp_arg_parse_all_kw_array(n_args, n_kw, args, MP_ARRAY_SIZE(allowed_args), allowed_args, vals);
+        mp_obj_array_t *o = bytearray_make(vals[0].u_obj == MP_OBJ_NULL ? 0 : 1, &vals[0].u_obj);
+        // make the capacity (len + free) at least the reserve, so that
+        // appends up to that size don't need to reallocate
+        if (vals[1].u_int > 0 && (mp_uint_t)vals[1].u_int > o->len + o->free) {
+            mp_uint_t n = vals[1].u_int - o->len;
+            if (n > ARRAY_FREE_MAX) {
+                n = ARRAY_FREE_MAX;
+            }
+            o->items = m_renew(byte, o->items, o->len + o->free, o->len + n);
+            o->free = n;
+        }
+        return o;
+    }
+    #endif
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    return bytearray_make(n_args, args);
+}
 #endif
 
 #if MICROPY_PY_BUILTINS_MEMORYVIEW
@@ -230,6 +305,17 @@ STATIC mp_obj_t memoryview_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
 
+    #if MICROPY_OPT_STR_VIEW
+    // str/bytes data that doesn't start a heap block may belong to a view, and
+    // the memoryview alone can't keep the view's parent alive, so view a copy
+    // instead.  The data is immutable so the copy behaves just the same.
+    if (MP_OBJ_IS_STR_OR_BYTES(args[0]) && bufinfo.len > 0 && gc_nbytes(bufinfo.buf) == 0) {
+        byte *copy = m_new(byte, bufinfo.len);
+        memcpy(copy, bufinfo.buf, bufinfo.len);
+        bufinfo.buf = copy;
+    }
+    #endif
+
     mp_obj_array_t *self = mp_obj_new_memoryview(bufinfo.typecode,
         bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL),
         bufinfo.buf);
@@ -241,6 +327,29 @@ STATIC mp_obj_t memoryview_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_
 
     return self;
 }
+
+// Returns a view of the same memory with another typecode.  The length and
+// the offset of the view in its buffer, in bytes, must both be multiples of
+// the new item size.
+STATIC mp_obj_t memoryview_cast(mp_obj_t self_in, mp_obj_t typecode_in) {
+    mp_obj_array_t *self = self_in;
+    const char *typecode = mp_obj_str_get_str(typecode_in);
+    int old_sz = mp_binary_get_size('@', self->typecode & TYPECODE_MASK, NULL);
+    int new_sz = mp_binary_get_size('@', typecode[0], NULL);
+    if (new_sz == 0 || typecode[0] == 'O' || typecode[1] != '\0') {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "memoryview: bad typecode"));
+    }
+    mp_uint_t offset = (mp_uint_t)self->free * old_sz;
+    mp_uint_t len = self->len * old_sz;
+    if (offset % new_sz != 0 || len % new_sz != 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError,
+            "memoryview: length is not a multiple of itemsize"));
+    }
+    mp_obj_array_t *res = mp_obj_new_memoryview(typecode[0] | (self->typecode & 0x80), len / new_sz, self->items);
+    res->free = offset / new_sz;
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(memoryview_cast_obj, memoryview_cast);
 #endif
 
 STATIC mp_obj_t array_unary_op(mp_uint_t op, mp_obj_t o_in) {
@@ -304,15 +413,8 @@ STATIC mp_obj_t array_append(mp_obj_t self_in, mp_obj_t arg) {
     assert(MP_OBJ_IS_TYPE(self_in, &mp_type_array) || MP_OBJ_IS_TYPE(self_in, &mp_type_bytearray));
     mp_obj_array_t *self = self_in;
 
-    if (self->free == 0) {
-        int item_sz = mp_binary_get_size('@', self->typecode, NULL);
-        // TODO: alloc policy
-        self->free = 8;
-        self->items = m_renew(byte, self->items, item_sz * self->len, item_sz * (self->len + self->free));
-        mp_seq_clear(self->items, self->len + 1, self->len + self->free, item_sz);
-    }
+    array_reserve(self, 1);
     mp_binary_set_val_array(self->typecode, self->items, self->len++, arg);
-    self->free--;
     return mp_const_none; // return None, as per CPython
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_append_obj, array_append);
@@ -324,29 +426,108 @@ STATIC mp_obj_t array_extend(mp_obj_t self_in, mp_obj_t arg_in) {
 
     // allow to extend by anything that has the buffer protocol (extension to CPython)
     mp_buffer_info_t arg_bufinfo;
-    mp_get_buffer_raise(arg_in, &arg_bufinfo, MP_BUFFER_READ);
-
-    int sz = mp_binary_get_size('@', self->typecode, NULL);
+    if (mp_get_buffer(arg_in, &arg_bufinfo, MP_BUFFER_READ)) {
+        int sz = mp_binary_get_size('@', self->typecode, NULL);
+
+        // convert byte count to element count
+        mp_uint_t len = arg_bufinfo.len / sz;
+
+        // arg may be self (or a view of it), in which case the source moves
+        // along with the items when they are reallocated
+        byte *src = arg_bufinfo.buf;
+        byte *old_items = self->items;
+        mp_uint_t old_nbytes = (self->len + self->free) * sz;
+        array_reserve(self, len);
+        if (src >= old_items && src < old_items + old_nbytes) {
+            src = (byte*)self->items + (src - old_items);
+        }
+        memmove((byte*)self->items + self->len * sz, src, len * sz);
+        self->len += len;
+    } else if (MP_OBJ_IS_TYPE(arg_in, &mp_type_list) || MP_OBJ_IS_TYPE(arg_in, &mp_type_tuple)) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(arg_in, &len, &items);
+        array_reserve(self, len);
+        array_store_objs(self, self->len, len, items);
+        self->len += len;
+    } else {
+        // any other iterable, as per CPython
+        mp_obj_t iterable = mp_getiter(arg_in);
+        mp_obj_t item;
+        while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+            array_append(self, item);
+        }
+    }
 
-    // convert byte count to element count
-    mp_uint_t len = arg_bufinfo.len / sz;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_extend_obj, array_extend);
+#endif
 
-    // make sure we have enough room to extend
-    // TODO: alloc policy; at the moment we go conservative
-    if (self->free < len) {
-        self->items = m_renew(byte, self->items, (self->len + self->free) * sz, (self->len + len) * sz);
-        self->free = 0;
-    } else {
-        self->free -= len;
+#if MICROPY_PY_BUILTINS_BYTEARRAY && MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS
+// get the byte range [start, end) selected by the optional start/end args of
+// a method taking (self, arg[, start[, end]]); they act like slice indices
+STATIC byte *bytearray_get_range(mp_uint_t n_args, const mp_obj_t *args, mp_uint_t *len) {
+    mp_obj_array_t *self = args[0];
+    mp_uint_t start = 0;
+    mp_uint_t end = self->len;
+    if (n_args >= 3 && args[2] != mp_const_none) {
+        start = mp_get_index(self->base.type, self->len, args[2], true);
     }
+    if (n_args >= 4 && args[3] != mp_const_none) {
+        end = mp_get_index(self->base.type, self->len, args[3], true);
+    }
+    *len = start < end ? end - start : 0;
+    return (byte*)self->items + start;
+}
 
-    // extend
-    mp_seq_copy((byte*)self->items + self->len * sz, arg_bufinfo.buf, len * sz, byte);
-    self->len += len;
+// bytearray.itranslate(table[, start[, end]]): map each byte through a
+// 256-byte table, in place
+STATIC mp_obj_t bytearray_itranslate(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t table;
+    mp_get_buffer_raise(args[1], &table, MP_BUFFER_READ);
+    if (table.len != 256) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "translation table must be 256 characters long"));
+    }
+    const byte *tab = table.buf;
+    mp_uint_t len;
+    byte *p = bytearray_get_range(n_args, args, &len);
+    for (byte *top = p + len; p < top; p++) {
+        *p = tab[*p];
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bytearray_itranslate_obj, 2, 4, bytearray_itranslate);
 
+// bytearray.ixor(key[, start[, end]]): xor with an int, or with a buffer
+// which is repeated as often as needed, in place
+STATIC mp_obj_t bytearray_ixor(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_uint_t len;
+    byte *p = bytearray_get_range(n_args, args, &len);
+    byte *top = p + len;
+    if (MP_OBJ_IS_INT(args[1])) {
+        byte k = mp_obj_get_int(args[1]);
+        for (; p < top; p++) {
+            *p ^= k;
+        }
+    } else {
+        mp_buffer_info_t key;
+        mp_get_buffer_raise(args[1], &key, MP_BUFFER_READ);
+        if (key.len == 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty key"));
+        }
+        const byte *k = key.buf;
+        mp_uint_t j = 0;
+        for (; p < top; p++) {
+            *p ^= k[j];
+            if (++j == key.len) {
+                j = 0;
+            }
+        }
+    }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_extend_obj, array_extend);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bytearray_ixor_obj, 2, 4, bytearray_ixor);
 #endif
 
 STATIC mp_obj_t array_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value) {
@@ -371,7 +552,8 @@ STATIC mp_obj_t array_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value
                 // Assign
                 mp_uint_t src_len;
                 void *src_items;
-                int item_sz = mp_binary_get_size('@', o->typecode, NULL);
+                mp_buffer_info_t bufinfo;
+                int item_sz = mp_binary_get_size('@', o->typecode & TYPECODE_MASK, NULL);
                 if (MP_OBJ_IS_TYPE(value, &mp_type_array) || MP_OBJ_IS_TYPE(value, &mp_type_bytearray)) {
                     mp_obj_array_t *src_slice = value;
                     if (item_sz != mp_binary_get_size('@', src_slice->typecode, NULL)) {
@@ -380,26 +562,50 @@ STATIC mp_obj_t array_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value
                     }
                     src_len = src_slice->len;
                     src_items = src_slice->items;
-                } else if (MP_OBJ_IS_TYPE(value, &mp_type_bytes)) {
-                    if (item_sz != 1) {
+                } else if (!MP_OBJ_IS_STR(value) && mp_get_buffer(value, &bufinfo, MP_BUFFER_READ)) {
+                    // bytes, memoryview or any other buffer object
+                    if (item_sz != mp_binary_get_size('@', bufinfo.typecode, NULL)) {
                         goto compat_error;
                     }
-                    mp_buffer_info_t bufinfo;
-                    mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
-                    src_len = bufinfo.len;
+                    src_len = bufinfo.len / item_sz;
                     src_items = bufinfo.buf;
                 } else {
                     mp_not_implemented("array/bytes required on right side");
                 }
 
+                #if MICROPY_PY_BUILTINS_MEMORYVIEW
+                if (o->base.type == &mp_type_memoryview) {
+                    // a memoryview can't change size, so the data is just
+                    // copied into place; memmove allows the source to be a
+                    // view of the same buffer
+                    if ((o->typecode & 0x80) == 0) {
+                        // store to read-only memoryview
+                        return MP_OBJ_NULL;
+                    }
+                    if (src_len != slice.stop - slice.start) {
+                        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError,
+                            "memoryview assignment: lvalue and rvalue have different structures"));
+                    }
+                    memmove((byte*)o->items + ((mp_uint_t)o->free + slice.start) * item_sz, src_items, src_len * item_sz);
+                    return mp_const_none;
+                }
+                #endif
+
                 // TODO: check src/dst compat
                 mp_int_t len_adj = src_len - (slice.stop - slice.start);
+                if (len_adj == 0) {
+                    memmove((byte*)o->items + slice.start * item_sz, src_items, src_len * item_sz);
+                    return mp_const_none;
+                }
+                if ((byte*)src_items >= (byte*)o->items && (byte*)src_items < (byte*)o->items + (o->len + o->free) * item_sz) {
+                    // the source is a view of this array, which is about to
+                    // be rearranged (and maybe moved), so take a copy of it
+                    byte *copy = m_new(byte, src_len * item_sz);
+                    memcpy(copy, src_items, src_len * item_sz);
+                    src_items = copy;
+                }
                 if (len_adj > 0) {
-                    if (len_adj > o->free) {
-                        // TODO: alloc policy; at the moment we go conservative
-                        o->items = m_renew(byte, o->items, (o->len + o->free) * item_sz, (o->len + len_adj) * item_sz);
-                        o->free = 0;
-                    }
+                    array_reserve(o, len_adj);
                     mp_seq_replace_slice_grow_inplace(o->items, o->len,
                         slice.start, slice.stop, src_items, src_len, len_adj, item_sz);
                 } else {
@@ -408,7 +614,12 @@ STATIC mp_obj_t array_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value
                     // Clear "freed" elements at the end of list
                     // TODO: This is actually only needed for typecode=='O'
                     mp_seq_clear(o->items, o->len + len_adj, o->len, item_sz);
-                    // TODO: alloc policy after shrinking
+                    // the freed elements stay allocated as spare room (len_adj
+                    // is negative here, so the free count only grows)
+                    mp_uint_t new_free = (mp_uint_t)o->free + (mp_uint_t)(-len_adj);
+                    if (new_free <= ARRAY_FREE_MAX) {
+                        o->free = new_free;
+                    }
                 }
                 o->len += len_adj;
                 return mp_const_none;
@@ -485,6 +696,19 @@ STATIC const mp_map_elem_t array_locals_dict_table[] = {
 STATIC MP_DEFINE_CONST_DICT(array_locals_dict, array_locals_dict_table);
 #endif
 
+#if MICROPY_PY_BUILTINS_BYTEARRAY && MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS
+STATIC const mp_map_elem_t bytearray_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_append), (mp_obj_t)&array_append_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_extend), (mp_obj_t)&array_extend_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_itranslate), (mp_obj_t)&bytearray_itranslate_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ixor), (mp_obj_t)&bytearray_ixor_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(bytearray_locals_dict, bytearray_locals_dict_table);
+#else
+#define bytearray_locals_dict array_locals_dict
+#endif
+
 #if MICROPY_PY_ARRAY
 const mp_obj_type_t mp_type_array = {
     { &mp_type_type },
@@ -511,11 +735,17 @@ const mp_obj_type_t mp_type_bytearray = {
     .binary_op = array_binary_op,
     .subscr = array_subscr,
     .buffer_p = { .get_buffer = array_get_buffer },
-    .locals_dict = (mp_obj_t)&array_locals_dict,
+    .locals_dict = (mp_obj_t)&bytearray_locals_dict,
 };
 #endif
 
 #if MICROPY_PY_BUILTINS_MEMORYVIEW
+STATIC const mp_map_elem_t memoryview_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_cast), (mp_obj_t)&memoryview_cast_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(memoryview_locals_dict, memoryview_locals_dict_table);
+
 const mp_obj_type_t mp_type_memoryview = {
     { &mp_type_type },
     .name = MP_QSTR_memoryview,
@@ -525,9 +755,16 @@ const mp_obj_type_t mp_type_memoryview = {
     .binary_op = array_binary_op,
     .subscr = array_subscr,
     .buffer_p = { .get_buffer = array_get_buffer },
+    .locals_dict = (mp_obj_t)&memoryview_locals_dict,
 };
 #endif
 
+#if MICROPY_PY_ARRAY
+mp_obj_t mp_obj_new_array(char typecode, mp_uint_t n) {
+    return array_new(typecode, n);
+}
+#endif
+
 /* unused
 mp_uint_t mp_obj_array_len(mp_obj_t self_in) {
     return ((mp_obj_array_t *)self_in)->len;
@@ -47,29 +47,32 @@ STATIC void bound_meth_print(const mp_print_t *print, mp_obj_t o_in, mp_print_ki
 }
 #endif
 
-STATIC mp_obj_t bound_meth_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
-    mp_obj_bound_meth_t *self = self_in;
-
-    // need to insert self->self before all other args and then call self->meth
-
+// call meth with self inserted before all the other args, without making a
+// bound method object
+mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
     mp_uint_t n_total = n_args + 2 * n_kw;
     if (n_total <= 4) {
         // use stack to allocate temporary args array
         mp_obj_t args2[5];
-        args2[0] = self->self;
+        args2[0] = self;
         memcpy(args2 + 1, args, n_total * sizeof(mp_obj_t));
-        return mp_call_function_n_kw(self->meth, n_args + 1, n_kw, &args2[0]);
+        return mp_call_function_n_kw(meth, n_args + 1, n_kw, &args2[0]);
     } else {
         // use heap to allocate temporary args array
         mp_obj_t *args2 = m_new(mp_obj_t, 1 + n_total);
-        args2[0] = self->self;
+        args2[0] = self;
         memcpy(args2 + 1, args, n_total * sizeof(mp_obj_t));
-        mp_obj_t res = mp_call_function_n_kw(self->meth, n_args + 1, n_kw, &args2[0]);
+        mp_obj_t res = mp_call_function_n_kw(meth, n_args + 1, n_kw, &args2[0]);
         m_del(mp_obj_t, args2, 1 + n_total);
         return res;
     }
 }
 
+STATIC mp_obj_t bound_meth_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_obj_bound_meth_t *self = self_in;
+    return mp_call_method_self_n_kw(self->meth, self->self, n_args, n_kw, args);
+}
+
 #if MICROPY_PY_FUNCTION_ATTRS
 STATIC void bound_meth_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] != MP_OBJ_NULL) {
@@ -96,9 +99,19 @@ STATIC const mp_obj_type_t mp_type_bound_meth = {
 };
 
 mp_obj_t mp_obj_new_bound_meth(mp_obj_t meth, mp_obj_t self) {
-    mp_obj_bound_meth_t *o = m_new_obj(mp_obj_bound_meth_t);
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    mp_obj_bound_meth_t **cache = &MP_STATE_VM(bound_meth_cache)[
+        (((mp_uint_t)meth >> 4) ^ ((mp_uint_t)self >> 4)) & (MICROPY_OPT_BOUND_METH_CACHE_SIZE - 1)];
+    if (*cache != NULL && (*cache)->meth == meth && (*cache)->self == self) {
+        return *cache;
+    }
+    #endif
+    mp_obj_bound_meth_t *o = m_new_obj_pooled(mp_obj_bound_meth_t, &mp_type_bound_meth, MP_OBJ_POOL_BOUND_METH);
     o->base.type = &mp_type_bound_meth;
     o->meth = meth;
     o->self = self;
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    *cache = o;
+    #endif
     return o;
 }
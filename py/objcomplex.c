@@ -38,20 +38,28 @@
 
 #include <math.h>
 
-#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT || MICROPY_FLOAT_EXACT_CONV
 #include "py/formatfloat.h"
 #endif
 
-typedef struct _mp_obj_complex_t {
-    mp_obj_base_t base;
-    mp_float_t real;
-    mp_float_t imag;
-} mp_obj_complex_t;
-
 STATIC void complex_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_complex_t *o = o_in;
-#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#if MICROPY_FLOAT_EXACT_CONV
+    char buf[MP_FLOAT_REPR_BUF_SIZE];
+    if (o->real == 0) {
+        mp_format_float_repr(o->imag, buf, sizeof(buf));
+        mp_printf(print, "%sj", buf);
+    } else {
+        mp_format_float_repr(o->real, buf, sizeof(buf));
+        mp_printf(print, "(%s", buf);
+        if (o->imag >= 0) {
+            mp_print_str(print, "+");
+        }
+        mp_format_float_repr(o->imag, buf, sizeof(buf));
+        mp_printf(print, "%sj)", buf);
+    }
+#elif MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
     char buf[16];
     if (o->real == 0) {
         mp_format_float(o->imag, buf, sizeof(buf), 'g', 7, '\0');
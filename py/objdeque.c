@@ -0,0 +1,325 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_COLLECTIONS_DEQUE
+
+// The items are kept in a ring buffer: items[head] is the leftmost one and
+// the others follow it, wrapping round at the end of the buffer.  With a
+// maxlen the buffer is allocated once at that size, and adding to a full
+// deque drops an item from the other end.  Otherwise the buffer doubles in
+// size when it's full.  Slots not in use are cleared, so the GC doesn't see
+// items that were removed.
+
+#define DEQUE_MIN_ALLOC (4)
+#define DEQUE_NO_MAXLEN ((mp_uint_t)-1)
+
+typedef struct _mp_obj_deque_t {
+    mp_obj_base_t base;
+    mp_uint_t alloc;
+    mp_uint_t len;
+    mp_uint_t head;
+    mp_uint_t maxlen;
+    mp_obj_t *items;
+} mp_obj_deque_t;
+
+// index in the buffer of item i, for 0 <= i < alloc
+static inline mp_uint_t deque_slot(mp_obj_deque_t *self, mp_uint_t i) {
+    i += self->head;
+    return i < self->alloc ? i : i - self->alloc;
+}
+
+STATIC void deque_grow(mp_obj_deque_t *self) {
+    mp_uint_t old_alloc = self->alloc;
+    mp_uint_t new_alloc = old_alloc * 2;
+    self->items = m_renew(mp_obj_t, self->items, old_alloc, new_alloc);
+    // the items from head to the end of the old buffer move to the end of
+    // the new one, so the free slots are in the middle
+    mp_uint_t n_top = old_alloc - self->head;
+    memmove(self->items + new_alloc - n_top, self->items + self->head, n_top * sizeof(mp_obj_t));
+    memset(self->items + self->head, 0, (new_alloc - old_alloc) * sizeof(mp_obj_t));
+    self->head = new_alloc - n_top;
+    self->alloc = new_alloc;
+}
+
+STATIC mp_obj_t deque_pop_right(mp_obj_deque_t *self) {
+    mp_uint_t slot = deque_slot(self, self->len - 1);
+    mp_obj_t item = self->items[slot];
+    self->items[slot] = MP_OBJ_NULL;
+    self->len -= 1;
+    return item;
+}
+
+STATIC mp_obj_t deque_pop_left(mp_obj_deque_t *self) {
+    mp_obj_t item = self->items[self->head];
+    self->items[self->head] = MP_OBJ_NULL;
+    self->head = deque_slot(self, 1);
+    self->len -= 1;
+    return item;
+}
+
+STATIC void deque_add_right(mp_obj_deque_t *self, mp_obj_t item) {
+    if (self->len == self->alloc) {
+        if (self->maxlen != DEQUE_NO_MAXLEN) {
+            if (self->maxlen == 0) {
+                return;
+            }
+            deque_pop_left(self);
+        } else {
+            deque_grow(self);
+        }
+    }
+    self->items[deque_slot(self, self->len)] = item;
+    self->len += 1;
+}
+
+STATIC void deque_add_left(mp_obj_deque_t *self, mp_obj_t item) {
+    if (self->len == self->alloc) {
+        if (self->maxlen != DEQUE_NO_MAXLEN) {
+            if (self->maxlen == 0) {
+                return;
+            }
+            deque_pop_right(self);
+        } else {
+            deque_grow(self);
+        }
+    }
+    self->head = self->head == 0 ? self->alloc - 1 : self->head - 1;
+    self->items[self->head] = item;
+    self->len += 1;
+}
+
+STATIC void deque_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_deque_t *self = self_in;
+    mp_print_str(print, "deque([");
+    for (mp_uint_t i = 0; i < self->len; i++) {
+        if (i > 0) {
+            mp_print_str(print, ", ");
+        }
+        mp_obj_print_helper(print, self->items[deque_slot(self, i)], PRINT_REPR);
+    }
+    mp_print_str(print, "]");
+    if (self->maxlen != DEQUE_NO_MAXLEN) {
+        mp_printf(print, ", maxlen=" UINT_FMT, self->maxlen);
+    }
+    mp_print_str(print, ")");
+}
+
+STATIC mp_obj_t deque_extend(mp_obj_t self_in, mp_obj_t iterable);
+
+STATIC const mp_arg_t deque_make_new_args[] = {
+    { MP_QSTR_iterable, MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_maxlen, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+};
+#define DEQUE_MAKE_NEW_NUM_ARGS MP_ARRAY_SIZE(deque_make_new_args)
+
+STATIC mp_obj_t deque_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_val_t vals[DEQUE_MAKE_NEW_NUM_ARGS];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args, DEQUE_MAKE_NEW_NUM_ARGS, deque_make_new_args, vals);
+
+    mp_obj_deque_t *o = m_new_obj(mp_obj_deque_t);
+    o->base.type = type_in;
+    o->len = 0;
+    o->head = 0;
+    if (vals[1].u_obj == mp_const_none) {
+        o->maxlen = DEQUE_NO_MAXLEN;
+        o->alloc = DEQUE_MIN_ALLOC;
+    } else {
+        mp_int_t maxlen = mp_obj_get_int(vals[1].u_obj);
+        if (maxlen < 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "maxlen must be non-negative"));
+        }
+        o->maxlen = maxlen;
+        o->alloc = maxlen;
+    }
+    o->items = m_new0(mp_obj_t, o->alloc);
+
+    if (vals[0].u_obj != MP_OBJ_NULL) {
+        deque_extend(o, vals[0].u_obj);
+    }
+    return o;
+}
+
+STATIC mp_obj_t deque_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_deque_t *self = self_in;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(self->len != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->len);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t deque_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_deque_t *self = self_in;
+    if (value == MP_OBJ_NULL) {
+        // delete is not supported
+        return MP_OBJ_NULL;
+    }
+    mp_uint_t i = mp_get_index(self->base.type, self->len, index, false);
+    mp_obj_t *slot = &self->items[deque_slot(self, i)];
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return *slot;
+    } else {
+        // store
+        *slot = value;
+        return mp_const_none;
+    }
+}
+
+STATIC mp_obj_t deque_append(mp_obj_t self_in, mp_obj_t item) {
+    deque_add_right(self_in, item);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_append_obj, deque_append);
+
+STATIC mp_obj_t deque_appendleft(mp_obj_t self_in, mp_obj_t item) {
+    deque_add_left(self_in, item);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_appendleft_obj, deque_appendleft);
+
+STATIC mp_obj_t deque_extend(mp_obj_t self_in, mp_obj_t iterable) {
+    mp_obj_t iter = mp_getiter(iterable);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        deque_add_right(self_in, item);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_extend_obj, deque_extend);
+
+STATIC mp_obj_t deque_pop(mp_obj_t self_in) {
+    mp_obj_deque_t *self = self_in;
+    if (self->len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "pop from an empty deque"));
+    }
+    return deque_pop_right(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_pop_obj, deque_pop);
+
+STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
+    mp_obj_deque_t *self = self_in;
+    if (self->len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "pop from an empty deque"));
+    }
+    return deque_pop_left(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_popleft_obj, deque_popleft);
+
+STATIC mp_obj_t deque_clear(mp_obj_t self_in) {
+    mp_obj_deque_t *self = self_in;
+    memset(self->items, 0, self->alloc * sizeof(mp_obj_t));
+    self->len = 0;
+    self->head = 0;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_clear_obj, deque_clear);
+
+
+/******************************************************************************/
+/* deque iterator                                                             */
+
+typedef struct _mp_obj_deque_it_t {
+    mp_obj_base_t base;
+    mp_obj_deque_t *deque;
+    mp_uint_t cur;
+} mp_obj_deque_it_t;
+
+STATIC mp_obj_t deque_it_iternext(mp_obj_t self_in) {
+    mp_obj_deque_it_t *self = self_in;
+    mp_obj_deque_t *deque = self->deque;
+    if (self->cur < deque->len) {
+        mp_obj_t o_out = deque->items[deque_slot(deque, self->cur)];
+        self->cur += 1;
+        return o_out;
+    } else {
+        return MP_OBJ_STOP_ITERATION;
+    }
+}
+
+STATIC const mp_obj_type_t mp_type_deque_it = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = deque_it_iternext,
+};
+
+STATIC mp_obj_t deque_getiter(mp_obj_t self_in) {
+    mp_obj_deque_it_t *o = m_new_obj(mp_obj_deque_it_t);
+    o->base.type = &mp_type_deque_it;
+    o->deque = self_in;
+    o->cur = 0;
+    return o;
+}
+
+STATIC const mp_map_elem_t deque_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_append), (mp_obj_t)&deque_append_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_appendleft), (mp_obj_t)&deque_appendleft_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_extend), (mp_obj_t)&deque_extend_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pop), (mp_obj_t)&deque_pop_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_popleft), (mp_obj_t)&deque_popleft_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_clear), (mp_obj_t)&deque_clear_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(deque_locals_dict, deque_locals_dict_table);
+
+// a type with an attr slot does its own lookup of methods too
+STATIC void deque_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not load attribute
+        return;
+    }
+    mp_obj_deque_t *self = self_in;
+    if (attr == MP_QSTR_maxlen) {
+        dest[0] = self->maxlen == DEQUE_NO_MAXLEN ? mp_const_none : mp_obj_new_int_from_uint(self->maxlen);
+        return;
+    }
+    mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&deque_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        dest[0] = elem->value;
+        dest[1] = self_in;
+    }
+}
+
+const mp_obj_type_t mp_type_deque = {
+    { &mp_type_type },
+    .name = MP_QSTR_deque,
+    .print = deque_print,
+    .make_new = deque_make_new,
+    .unary_op = deque_unary_op,
+    .subscr = deque_subscr,
+    .getiter = deque_getiter,
+    .attr = deque_attr,
+};
+
+#endif // MICROPY_PY_COLLECTIONS_DEQUE
@@ -86,7 +86,8 @@ STATIC mp_obj_t dict_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw
     mp_obj_t dict_out = mp_obj_new_dict(0);
     mp_obj_dict_t *dict = MP_OBJ_CAST(dict_out);
     dict->base.type = MP_OBJ_CAST(type_in);
-    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT && !MICROPY_OPT_MAP_COMPACT
+    // a compact map keeps insertion order so only needs this without it
     if (MP_OBJ_CAST(type_in) == &mp_type_ordereddict) {
         dict->map.is_ordered = 1;
     }
@@ -201,9 +202,26 @@ STATIC mp_obj_t dict_it_iternext(mp_obj_t self_in) {
     }
 }
 
+// the remaining count is bounded by both the number of entries and the
+// number of slots not yet visited
+STATIC mp_obj_t dict_it_len_hint(mp_obj_t dict_in, mp_uint_t cur) {
+    mp_map_t *map = &((mp_obj_dict_t*)MP_OBJ_CAST(dict_in))->map;
+    mp_uint_t left = cur < map->alloc ? map->alloc - cur : 0;
+    return MP_OBJ_NEW_SMALL_INT(MIN(left, map->used));
+}
+
+STATIC mp_obj_t dict_it_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_dict_it_t *self = MP_OBJ_CAST(self_in);
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        return dict_it_len_hint(self->dict, self->cur);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 STATIC const mp_obj_type_t mp_type_dict_it = {
     { &mp_type_type },
     .name = MP_QSTR_iterator,
+    .unary_op = dict_it_unary_op,
     .getiter = mp_identity,
     .iternext = dict_it_iternext,
 };
@@ -240,7 +258,7 @@ STATIC mp_obj_t dict_copy(mp_obj_t self_in) {
     other->map.all_keys_are_qstrs = self->map.all_keys_are_qstrs;
     other->map.is_fixed = 0;
     other->map.is_ordered = self->map.is_ordered;
-    memcpy(other->map.table, self->map.table, self->map.alloc * sizeof(mp_map_elem_t));
+    memcpy(other->map.table, self->map.table, MP_MAP_TABLE_LEN(self->map.alloc) * sizeof(mp_map_elem_t));
     return other_out;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, dict_copy);
@@ -249,7 +267,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, dict_copy);
 STATIC mp_obj_t dict_fromkeys(mp_uint_t n_args, const mp_obj_t *args) {
     assert(2 <= n_args && n_args <= 3);
     mp_obj_t iter = mp_getiter(args[1]);
-    mp_obj_t len = mp_obj_len_maybe(iter);
+    mp_int_t len = mp_obj_len_hint(iter);
     mp_obj_t value = mp_const_none;
     mp_obj_t next = NULL;
     mp_obj_t self_out;
@@ -258,12 +276,7 @@ STATIC mp_obj_t dict_fromkeys(mp_uint_t n_args, const mp_obj_t *args) {
         value = args[2];
     }
 
-    if (len == MP_OBJ_NULL) {
-        /* object's type doesn't have a __len__ slot */
-        self_out = mp_obj_new_dict(0);
-    } else {
-        self_out = mp_obj_new_dict(MP_OBJ_SMALL_INT_VALUE(len));
-    }
+    self_out = mp_obj_new_dict(len < 0 ? 0 : len);
 
     mp_obj_dict_t *self = MP_OBJ_CAST(self_out);
     while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
@@ -338,14 +351,30 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(dict_setdefault_obj, 2, 3, dict_setde
 STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     assert(MP_OBJ_IS_DICT_TYPE(self_in));
     mp_obj_dict_t *self = MP_OBJ_CAST(self_in);
-    mp_uint_t cur = 0;
-    mp_map_elem_t *next = dict_iter_next(self, &cur);
+    mp_map_elem_t *next = NULL;
+    if (MICROPY_OPT_MAP_COMPACT && !self->map.is_ordered) {
+        // remove the most recently inserted item, like CPython
+        for (mp_uint_t i = self->map.alloc; i-- > 0;) {
+            if (MP_MAP_SLOT_IS_FILLED(&self->map, i)) {
+                next = &self->map.table[i];
+                break;
+            }
+        }
+    } else {
+        mp_uint_t cur = 0;
+        next = dict_iter_next(self, &cur);
+    }
     if (next == NULL) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_KeyError, "popitem(): dictionary is empty"));
     }
-    self->map.used--;
     mp_obj_t items[] = {next->key, next->value};
-    next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
+    if (self->map.is_ordered) {
+        self->map.used--;
+        next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
+    } else {
+        // a hash table must be updated through the map, to keep its tags valid
+        mp_map_lookup(&self->map, next->key, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    }
     next->value = MP_OBJ_NULL;
     mp_obj_t tuple = mp_obj_new_tuple(2, items);
 
@@ -365,6 +394,7 @@ STATIC mp_obj_t dict_update(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw
         if (MP_OBJ_IS_DICT_TYPE(args[1])) {
             // update from other dictionary (make sure other is not self)
             if (args[1] != args[0]) {
+                mp_map_reserve(&self->map, ((mp_obj_dict_t*)args[1])->map.used);
                 mp_uint_t cur = 0;
                 mp_map_elem_t *elem = NULL;
                 while ((elem = dict_iter_next((mp_obj_dict_t*)args[1], &cur)) != NULL) {
@@ -374,6 +404,10 @@ STATIC mp_obj_t dict_update(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw
         } else {
             // update from a generic iterable of pairs
             mp_obj_t iter = mp_getiter(args[1]);
+            mp_int_t len = mp_obj_len_hint(iter);
+            if (len > 0) {
+                mp_map_reserve(&self->map, len);
+            }
             mp_obj_t next = NULL;
             while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
                 mp_obj_t inneriter = mp_getiter(next);
@@ -394,6 +428,7 @@ STATIC mp_obj_t dict_update(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw
     }
 
     // update the dict with any keyword args
+    mp_map_reserve(&self->map, kwargs->used);
     for (mp_uint_t i = 0; i < kwargs->alloc; i++) {
         if (MP_MAP_SLOT_IS_FILLED(kwargs, i)) {
             mp_map_lookup(&self->map, kwargs->table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = kwargs->table[i].value;
@@ -454,9 +489,39 @@ STATIC mp_obj_t dict_view_it_iternext(mp_obj_t self_in) {
     }
 }
 
+#if MICROPY_OPT_ITER_FUSION
+// see mp_iternext_unpack; a for loop over dict.items() that unpacks each
+// item into a key and a value takes them straight from the map
+mp_obj_t mp_obj_dict_view_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items) {
+    if (!MP_OBJ_IS_TYPE(self_in, &dict_view_it_type)) {
+        return MP_OBJ_SENTINEL;
+    }
+    mp_obj_dict_view_it_t *self = MP_OBJ_CAST(self_in);
+    if (self->kind != MP_DICT_VIEW_ITEMS || num != 2) {
+        return MP_OBJ_SENTINEL;
+    }
+    mp_map_elem_t *next = dict_iter_next(MP_OBJ_CAST(self->dict), &self->cur);
+    if (next == NULL) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    items[0] = next->value;
+    items[1] = next->key;
+    return mp_const_none;
+}
+#endif
+
+STATIC mp_obj_t dict_view_it_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_dict_view_it_t *self = MP_OBJ_CAST(self_in);
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        return dict_it_len_hint(self->dict, self->cur);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 STATIC const mp_obj_type_t dict_view_it_type = {
     { &mp_type_type },
     .name = MP_QSTR_iterator,
+    .unary_op = dict_view_it_unary_op,
     .getiter = mp_identity,
     .iternext = dict_view_it_iternext,
 };
@@ -576,7 +641,7 @@ const mp_obj_type_t mp_type_dict = {
 };
 
 #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-STATIC const mp_obj_tuple_t ordereddict_base_tuple = {{&mp_type_tuple}, 1, {(mp_obj_t)&mp_type_dict}};
+STATIC const mp_obj_tuple_t ordereddict_base_tuple = {.base = {&mp_type_tuple}, .len = 1, .items = {(mp_obj_t)&mp_type_dict}};
 
 const mp_obj_type_t mp_type_ordereddict = {
     { &mp_type_type },
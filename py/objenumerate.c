@@ -35,6 +35,7 @@ typedef struct _mp_obj_enumerate_t {
     mp_obj_base_t base;
     mp_obj_t iter;
     mp_int_t cur;
+    mp_uint_t idx; // for a list or tuple source
 } mp_obj_enumerate_t;
 
 STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in);
@@ -54,13 +55,15 @@ STATIC mp_obj_t enumerate_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t
     // create enumerate object
     mp_obj_enumerate_t *o = m_new_obj(mp_obj_enumerate_t);
     o->base.type = type_in;
-    o->iter = mp_getiter(vals[0].u_obj);
+    o->iter = mp_getiter_or_seq(vals[0].u_obj);
     o->cur = vals[1].u_int;
+    o->idx = 0;
 #else
     mp_obj_enumerate_t *o = m_new_obj(mp_obj_enumerate_t);
     o->base.type = type_in;
-    o->iter = mp_getiter(args[0]);
+    o->iter = mp_getiter_or_seq(args[0]);
     o->cur = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    o->idx = 0;
 #endif
 
     return o;
@@ -77,13 +80,31 @@ const mp_obj_type_t mp_type_enumerate = {
 STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in) {
     assert(MP_OBJ_IS_TYPE(self_in, &mp_type_enumerate));
     mp_obj_enumerate_t *self = self_in;
-    mp_obj_t next = mp_iternext(self->iter);
+    mp_obj_t next = mp_iternext_or_seq(self->iter, self->idx);
     if (next == MP_OBJ_STOP_ITERATION) {
         return MP_OBJ_STOP_ITERATION;
     } else {
+        self->idx++;
         mp_obj_t items[] = {MP_OBJ_NEW_SMALL_INT(self->cur++), next};
         return mp_obj_new_tuple(2, items);
     }
 }
 
+#if MICROPY_OPT_ITER_FUSION
+mp_obj_t mp_obj_enumerate_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items) {
+    mp_obj_enumerate_t *self = self_in;
+    if (num != 2) {
+        return MP_OBJ_SENTINEL;
+    }
+    mp_obj_t next = mp_iternext_or_seq(self->iter, self->idx);
+    if (next == MP_OBJ_STOP_ITERATION) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    self->idx++;
+    items[0] = next;
+    items[1] = MP_OBJ_NEW_SMALL_INT(self->cur++);
+    return mp_const_none;
+}
+#endif
+
 #endif // MICROPY_PY_BUILTINS_ENUMERATE
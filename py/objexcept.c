@@ -36,6 +36,9 @@
 #include "py/objtype.h"
 #include "py/runtime.h"
 #include "py/gc.h"
+#if MICROPY_OPT_LAZY_TRACEBACK
+#include "py/bc.h"
+#endif
 
 // Instance of MemoryError exception - needed by mp_malloc_fail
 const mp_obj_exception_t mp_const_MemoryError_obj = {{&mp_type_MemoryError}, 0, 0, MP_OBJ_NULL, mp_const_empty_tuple};
@@ -177,7 +180,7 @@ const mp_obj_type_t mp_type_BaseException = {
 };
 
 #define MP_DEFINE_EXCEPTION_BASE(base_name) \
-STATIC const mp_obj_tuple_t mp_type_ ## base_name ## _base_tuple = {{&mp_type_tuple}, 1, {(mp_obj_t)&mp_type_ ## base_name}};\
+STATIC const mp_obj_tuple_t mp_type_ ## base_name ## _base_tuple = {.base = {&mp_type_tuple}, .len = 1, .items = {(mp_obj_t)&mp_type_ ## base_name}};\
 
 #define MP_DEFINE_EXCEPTION(exc_name, base_name) \
 const mp_obj_type_t mp_type_ ## exc_name = { \
@@ -292,7 +295,54 @@ mp_obj_t mp_obj_new_exception_args(const mp_obj_type_t *exc_type, mp_uint_t n_ar
 }
 
 mp_obj_t mp_obj_new_exception_msg(const mp_obj_type_t *exc_type, const char *msg) {
-    return mp_obj_new_exception_msg_varg(exc_type, msg);
+    // check that the given type is an exception type
+    assert(exc_type->make_new == mp_obj_exception_make_new);
+
+    mp_obj_exception_t *o = m_new_obj_var_maybe(mp_obj_exception_t, mp_obj_t, 0);
+    if (o == NULL) {
+        // use the emergency exception and buffer
+        return mp_obj_new_exception_msg_varg(exc_type, msg);
+    }
+    o->base.type = exc_type;
+    o->traceback_data = NULL;
+    o->args = mp_const_empty_tuple;
+
+    // the message is constant, so the str object uses it in place; as in
+    // mp_obj_new_exception_msg_varg, the message is dropped if memory runs out
+    mp_obj_tuple_t *tuple = m_new_obj_var_maybe(mp_obj_tuple_t, mp_obj_t, 1);
+    mp_obj_str_t *str = m_new_obj_maybe(mp_obj_str_t);
+    if (tuple != NULL && str != NULL) {
+        str->base.type = &mp_type_str;
+        str->len = strlen(msg);
+        #if MICROPY_OPT_CACHE_HASH
+        str->hash = 0;
+        #else
+        str->hash = qstr_compute_hash((const byte*)msg, str->len);
+        #endif
+        str->data = (const byte*)msg;
+
+        tuple->base.type = &mp_type_tuple;
+        tuple->len = 1;
+        #if MICROPY_OPT_CACHE_HASH
+        tuple->hash = 0;
+        #endif
+        tuple->items[0] = str;
+        o->args = tuple;
+    }
+    return o;
+}
+
+STATIC void exc_msg_count_strn(void *data, const char *str, mp_uint_t len) {
+    (void)str;
+    *(size_t*)data += len;
+}
+
+// Returns the length of the message that fmt renders to, without allocating.
+STATIC size_t exc_msg_len(const char *fmt, va_list ap) {
+    size_t len = 0;
+    mp_print_t print = {&len, exc_msg_count_strn};
+    mp_vprintf(&print, fmt, ap);
+    return len;
 }
 
 mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char *fmt, ...) {
@@ -319,6 +369,9 @@ mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char
 
             tuple->base.type = &mp_type_tuple;
             tuple->len = 1;
+            #if MICROPY_OPT_CACHE_HASH
+            tuple->hash = 0;
+            #endif
             tuple->items[0] = str;
 
             byte *str_data = (byte *)&str[1];
@@ -334,8 +387,8 @@ mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char
             va_end(ap);
 
             str->base.type = &mp_type_str;
-            str->hash = qstr_compute_hash(str_data, str->len);
             str->len = vstr.len;
+            str->hash = qstr_compute_hash(str_data, str->len);
             str->data = str_data;
 
             o->args = tuple;
@@ -355,25 +408,40 @@ mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char
     } else {
         o->base.type = exc_type;
         o->traceback_data = NULL;
-        o->args = mp_obj_new_tuple(1, NULL);
-
-        if (fmt == NULL) {
-            // no message
-            assert(0);
-        } else {
-            if (strchr(fmt, '%') == NULL) {
-                // no formatting substitutions, avoid allocating vstr.
-                o->args->items[0] = mp_obj_new_str(fmt, strlen(fmt), false);
-            } else {
-                // render exception message and store as .args[0]
-                va_list ap;
-                vstr_t vstr;
-                vstr_init(&vstr, 16);
-                va_start(ap, fmt);
-                vstr_vprintf(&vstr, fmt, ap);
-                va_end(ap);
-                o->args->items[0] = mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
-            }
+        o->args = mp_const_empty_tuple;
+
+        // Everything here is allocated with the _maybe variants: this function
+        // is used by m_malloc_fail, and raising MemoryError from inside it
+        // would recurse until the stack overflows.  If memory runs out the
+        // exception is returned without a message.
+        assert(fmt != NULL);
+        va_list ap;
+        va_start(ap, fmt);
+        size_t len = exc_msg_len(fmt, ap);
+        va_end(ap);
+        mp_obj_tuple_t *tuple = m_new_obj_var_maybe(mp_obj_tuple_t, mp_obj_t, 1);
+        mp_obj_str_t *str = m_new_obj_maybe(mp_obj_str_t);
+        byte *str_data = m_new_maybe(byte, len + 1);
+        if (tuple != NULL && str != NULL && str_data != NULL) {
+            vstr_t vstr;
+            vstr_init_fixed_buf(&vstr, len + 1, (char*)str_data);
+            va_start(ap, fmt);
+            vstr_vprintf(&vstr, fmt, ap);
+            va_end(ap);
+            str_data[vstr.len] = '\0';
+
+            str->base.type = &mp_type_str;
+            str->len = vstr.len;
+            str->hash = qstr_compute_hash(str_data, str->len);
+            str->data = str_data;
+
+            tuple->base.type = &mp_type_tuple;
+            tuple->len = 1;
+            #if MICROPY_OPT_CACHE_HASH
+            tuple->hash = 0;
+            #endif
+            tuple->items[0] = str;
+            o->args = tuple;
         }
     }
 
@@ -427,24 +495,36 @@ void mp_obj_exception_clear_traceback(mp_obj_t self_in) {
     self->traceback_data = NULL;
 }
 
-void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, mp_uint_t line, qstr block) {
-    GET_NATIVE_EXCEPTION(self, self_in);
-
-    // append this traceback info to traceback data
-    // if memory allocation fails (eg because gc is locked), just return
-
+// Return space for another traceback entry of 3 words, or NULL if memory
+// allocation fails (eg because gc is locked).
+STATIC mp_uint_t *exc_traceback_new_entry(mp_obj_exception_t *self) {
     if (self->traceback_data == NULL) {
+        #if MICROPY_OPT_LAZY_TRACEBACK
+        self->traceback_data = self->traceback_first;
+        #else
         self->traceback_data = m_new_maybe(mp_uint_t, 3);
         if (self->traceback_data == NULL) {
-            return;
+            return NULL;
         }
+        #endif
         self->traceback_alloc = 3;
         self->traceback_len = 0;
     } else if (self->traceback_len + 3 > self->traceback_alloc) {
         // be conservative with growing traceback data
-        mp_uint_t *tb_data = m_renew_maybe(mp_uint_t, self->traceback_data, self->traceback_alloc, self->traceback_alloc + 3);
+        mp_uint_t *tb_data;
+        #if MICROPY_OPT_LAZY_TRACEBACK
+        if (self->traceback_data == self->traceback_first) {
+            tb_data = m_new_maybe(mp_uint_t, self->traceback_alloc + 3);
+            if (tb_data != NULL) {
+                memcpy(tb_data, self->traceback_first, sizeof(self->traceback_first));
+            }
+        } else
+        #endif
+        {
+            tb_data = m_renew_maybe(mp_uint_t, self->traceback_data, self->traceback_alloc, self->traceback_alloc + 3);
+        }
         if (tb_data == NULL) {
-            return;
+            return NULL;
         }
         self->traceback_data = tb_data;
         self->traceback_alloc += 3;
@@ -452,11 +532,47 @@ void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, mp_uint_t line,
 
     mp_uint_t *tb_data = &self->traceback_data[self->traceback_len];
     self->traceback_len += 3;
-    tb_data[0] = (mp_uint_t)file;
-    tb_data[1] = (mp_uint_t)line;
-    tb_data[2] = (mp_uint_t)block;
+    return tb_data;
+}
+
+void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, mp_uint_t line, qstr block) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+
+    // append this traceback info to traceback data
+    mp_uint_t *tb_data = exc_traceback_new_entry(self);
+    if (tb_data != NULL) {
+        tb_data[0] = (mp_uint_t)file;
+        tb_data[1] = (mp_uint_t)line;
+        tb_data[2] = (mp_uint_t)block;
+    }
 }
 
+#if MICROPY_OPT_LAZY_TRACEBACK
+// marks an entry holding a code_info and ip that are not decoded yet
+#define TRACEBACK_ENTRY_PENDING ((mp_uint_t)-1)
+
+void mp_obj_exception_add_traceback_ip(mp_obj_t self_in, const byte *code_info, const byte *ip) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+
+    if (self == &MP_STATE_VM(mp_emergency_exception_obj)) {
+        // not in the heap, so it wouldn't keep the bytecode alive
+        qstr block_name, source_file;
+        mp_uint_t source_line = mp_bytecode_get_source_line(code_info, ip, &block_name, &source_file);
+        mp_obj_exception_add_traceback(self, source_file, source_line, block_name);
+        return;
+    }
+
+    // the entry keeps a pointer to the start of the bytecode, which keeps it
+    // alive until the entry is decoded
+    mp_uint_t *tb_data = exc_traceback_new_entry(self);
+    if (tb_data != NULL) {
+        tb_data[0] = (mp_uint_t)code_info;
+        tb_data[1] = (mp_uint_t)ip;
+        tb_data[2] = TRACEBACK_ENTRY_PENDING;
+    }
+}
+#endif
+
 void mp_obj_exception_get_traceback(mp_obj_t self_in, mp_uint_t *n, mp_uint_t **values) {
     GET_NATIVE_EXCEPTION(self, self_in);
 
@@ -464,6 +580,17 @@ void mp_obj_exception_get_traceback(mp_obj_t self_in, mp_uint_t *n, mp_uint_t **
         *n = 0;
         *values = NULL;
     } else {
+        #if MICROPY_OPT_LAZY_TRACEBACK
+        for (mp_uint_t i = 0; i < self->traceback_len; i += 3) {
+            mp_uint_t *tb_data = &self->traceback_data[i];
+            if (tb_data[2] == TRACEBACK_ENTRY_PENDING) {
+                qstr block_name, source_file;
+                tb_data[1] = mp_bytecode_get_source_line((const byte*)tb_data[0], (const byte*)tb_data[1], &block_name, &source_file);
+                tb_data[0] = source_file;
+                tb_data[2] = block_name;
+            }
+        }
+        #endif
         *n = self->traceback_len;
         *values = self->traceback_data;
     }
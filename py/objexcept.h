@@ -35,6 +35,9 @@ typedef struct _mp_obj_exception_t {
     mp_uint_t traceback_len : (BITS_PER_WORD / 2);
     mp_uint_t *traceback_data;
     mp_obj_tuple_t *args;
+    #if MICROPY_OPT_LAZY_TRACEBACK
+    mp_uint_t traceback_first[3];
+    #endif
 } mp_obj_exception_t;
 
 #endif // __MICROPY_INCLUDED_PY_OBJEXCEPT_H__
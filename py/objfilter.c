@@ -30,6 +30,7 @@ typedef struct _mp_obj_filter_t {
     mp_obj_base_t base;
     mp_obj_t fun;
     mp_obj_t iter;
+    mp_uint_t idx; // for a list or tuple source
 } mp_obj_filter_t;
 
 STATIC mp_obj_t filter_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
@@ -37,7 +38,8 @@ STATIC mp_obj_t filter_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_
     mp_obj_filter_t *o = m_new_obj(mp_obj_filter_t);
     o->base.type = type_in;
     o->fun = args[0];
-    o->iter = mp_getiter(args[1]);
+    o->iter = mp_getiter_or_seq(args[1]);
+    o->idx = 0;
     return o;
 }
 
@@ -45,7 +47,8 @@ STATIC mp_obj_t filter_iternext(mp_obj_t self_in) {
     assert(MP_OBJ_IS_TYPE(self_in, &mp_type_filter));
     mp_obj_filter_t *self = self_in;
     mp_obj_t next;
-    while ((next = mp_iternext(self->iter)) != MP_OBJ_STOP_ITERATION) {
+    while ((next = mp_iternext_or_seq(self->iter, self->idx)) != MP_OBJ_STOP_ITERATION) {
+        self->idx++;
         mp_obj_t val;
         if (self->fun != mp_const_none) {
             val = mp_call_function_n_kw(self->fun, 1, 0, &next);
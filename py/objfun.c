@@ -34,6 +34,7 @@
 #include "py/runtime0.h"
 #include "py/runtime.h"
 #include "py/bc.h"
+#include "py/compile.h"
 #include "py/stackctrl.h"
 
 #if 0 // print debugging info
@@ -105,12 +106,15 @@ const mp_obj_type_t mp_type_fun_builtin = {
 
 qstr mp_obj_code_get_name(const byte *code_info) {
     mp_decode_uint(&code_info); // skip code_info_size entry
-    return mp_decode_uint(&code_info);
+    return mp_decode_code_info_qstr(&code_info);
 }
 
 #if MICROPY_EMIT_NATIVE
 STATIC const mp_obj_type_t mp_type_fun_native;
 #endif
+#if MICROPY_EMIT_NATIVE_JIT
+STATIC const mp_obj_type_t mp_type_fun_jit;
+#endif
 
 qstr mp_obj_fun_get_name(mp_const_obj_t fun_in) {
     const mp_obj_fun_bc_t *fun = fun_in;
@@ -120,6 +124,11 @@ qstr mp_obj_fun_get_name(mp_const_obj_t fun_in) {
         return MP_QSTR_;
     }
     #endif
+    #if MICROPY_EMIT_NATIVE_JIT
+    if (fun->base.type == &mp_type_fun_jit) {
+        return fun->jit.name;
+    }
+    #endif
     const byte *code_info = fun->bytecode;
     return mp_obj_code_get_name(code_info);
 }
@@ -153,17 +162,64 @@ STATIC void dump_args(const mp_obj_t *a, mp_uint_t sz) {
 #define VM_DETECT_STACK_OVERFLOW (0)
 
 #if MICROPY_STACKLESS
+
+#if MICROPY_EMIT_NATIVE_JIT
+STATIC bool fun_bc_jit_promote(mp_obj_fun_bc_t *self);
+#endif
+
+#if MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+#define FRAME_POOL_END ((byte*)MP_STATE_THREAD(frame_pool) + sizeof(MP_STATE_THREAD(frame_pool)))
+#endif
+
+// Frames for stackless calls are taken from the frame pool, which is used
+// strictly LIFO because frames are released in the reverse order of the calls.
+// If the pool is exhausted then the frame is allocated on the heap instead.
+STATIC mp_code_state *fun_bc_alloc_codestate(mp_uint_t state_size) {
+    #if MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    mp_uint_t n = (sizeof(mp_code_state) + state_size + sizeof(mp_uint_t) - 1) & ~(sizeof(mp_uint_t) - 1);
+    byte *top = MP_STATE_THREAD(frame_pool_top);
+    if (n <= (mp_uint_t)(FRAME_POOL_END - top)) {
+        MP_STATE_THREAD(frame_pool_top) = top + n;
+        return (mp_code_state*)top;
+    }
+    #endif
+    return m_new_obj_var_maybe(mp_code_state, byte, state_size);
+}
+
+void mp_obj_fun_bc_release_codestate(mp_code_state *code_state) {
+    #if MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    if ((byte*)code_state >= (byte*)MP_STATE_THREAD(frame_pool) && (byte*)code_state < FRAME_POOL_END) {
+        assert((byte*)code_state < MP_STATE_THREAD(frame_pool_top));
+        MP_STATE_THREAD(frame_pool_top) = (byte*)code_state;
+    }
+    #else
+    (void)code_state;
+    #endif
+    // a frame on the heap is left for the GC to reclaim
+}
+
 mp_code_state *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
     MP_STACK_CHECK();
     mp_obj_fun_bc_t *self = self_in;
 
+    #if MICROPY_EMIT_NATIVE_JIT
+    // only calls are counted for stackless frames; the caller makes a normal
+    // call if the function was promoted
+    if (++self->jit.count >= MP_STATE_VM(jit_threshold) && MP_STATE_VM(jit_threshold) != 0
+        && !self->jit_failed && fun_bc_jit_promote(self)) {
+        return NULL;
+    }
+    #endif
+
     // skip code-info block
     const byte *code_info = self->bytecode;
     mp_uint_t code_info_size = mp_decode_uint(&code_info);
     const byte *ip = self->bytecode + code_info_size;
 
+    #if !MICROPY_PERSISTENT_CODE
     // bytecode prelude: skip arg names
     ip += (self->n_pos_args + self->n_kwonly_args) * sizeof(mp_obj_t);
+    #endif
 
     // bytecode prelude: state size and exception stack size
     mp_uint_t n_state = mp_decode_uint(&ip);
@@ -171,8 +227,7 @@ mp_code_state *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, mp_uint_t n_arg
 
     // allocate state for locals and stack
     mp_uint_t state_size = n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t);
-    mp_code_state *code_state;
-    code_state = m_new_obj_var_maybe(mp_code_state, byte, state_size);
+    mp_code_state *code_state = fun_bc_alloc_codestate(state_size);
     if (!code_state) {
         return NULL;
     }
@@ -190,6 +245,136 @@ mp_code_state *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, mp_uint_t n_arg
 }
 #endif
 
+#if MICROPY_PY_FUNCTION_ATTRS
+STATIC void fun_bc_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not load attribute
+        return;
+    }
+    if (attr == MP_QSTR___name__) {
+        dest[0] = MP_OBJ_NEW_QSTR(mp_obj_fun_get_name(self_in));
+    }
+}
+#endif
+
+#if MICROPY_OPT_CODE_STATE_CACHE
+
+// size of each bucket of the code state cache, in bytes
+#define CODE_STATE_CACHE_GRANULE (4 * sizeof(mp_uint_t))
+
+STATIC mp_code_state *fun_bc_new_codestate(mp_uint_t n_bytes) {
+    mp_uint_t bucket = (n_bytes - 1) / CODE_STATE_CACHE_GRANULE;
+    if (bucket >= MICROPY_OPT_CODE_STATE_CACHE_BUCKETS) {
+        return m_new_obj_var(mp_code_state, byte, n_bytes - sizeof(mp_code_state));
+    }
+    mp_code_state *code_state = MP_STATE_VM(code_state_cache)[bucket];
+    if (code_state != NULL) {
+        MP_STATE_VM(code_state_cache)[bucket] = (mp_code_state*)(void*)code_state->code_info;
+        MP_STATE_VM(code_state_cache_len)[bucket] -= 1;
+        MP_STATE_VM(code_state_cache_hit) += 1;
+        code_state->code_info = NULL;
+        return code_state;
+    }
+    MP_STATE_VM(code_state_cache_miss) += 1;
+    return m_malloc((bucket + 1) * CODE_STATE_CACHE_GRANULE);
+}
+
+STATIC void fun_bc_del_codestate(mp_code_state *code_state, mp_uint_t n_bytes) {
+    mp_uint_t bucket = (n_bytes - 1) / CODE_STATE_CACHE_GRANULE;
+    if (bucket >= MICROPY_OPT_CODE_STATE_CACHE_BUCKETS) {
+        m_del_var(mp_code_state, byte, n_bytes - sizeof(mp_code_state), code_state);
+    } else if (MP_STATE_VM(code_state_cache_len)[bucket] >= MICROPY_OPT_CODE_STATE_CACHE_DEPTH) {
+        m_free(code_state, (bucket + 1) * CODE_STATE_CACHE_GRANULE);
+    } else {
+        // zero it so the GC doesn't keep alive what it referred to; the part
+        // of the bucket beyond n_bytes is still zero from any previous use
+        memset(code_state, 0, n_bytes);
+        code_state->code_info = (const byte*)(void*)MP_STATE_VM(code_state_cache)[bucket];
+        MP_STATE_VM(code_state_cache)[bucket] = code_state;
+        MP_STATE_VM(code_state_cache_len)[bucket] += 1;
+    }
+}
+
+#endif // MICROPY_OPT_CODE_STATE_CACHE
+
+#if MICROPY_EMIT_NATIVE_JIT
+
+// Native code doesn't switch to the globals of the function like the VM does,
+// so a promoted function must do it itself to keep the same semantics.
+STATIC mp_obj_t fun_jit_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    MP_STACK_CHECK();
+    mp_obj_fun_bc_t *self = self_in;
+    mp_call_fun_t fun = MICROPY_MAKE_POINTER_CALLABLE((void*)self->bytecode);
+    mp_obj_dict_t *volatile old_globals = mp_globals_get();
+    mp_globals_set(self->globals);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t ret = fun(self_in, n_args, n_kw, args);
+        nlr_pop();
+        mp_globals_set(old_globals);
+        return ret;
+    } else {
+        mp_globals_set(old_globals);
+        nlr_raise(nlr.ret_val);
+    }
+}
+
+STATIC const mp_obj_type_t mp_type_fun_jit = {
+    { &mp_type_type },
+    .name = MP_QSTR_function,
+#if MICROPY_CPYTHON_COMPAT
+    .print = fun_bc_print,
+#endif
+    .call = fun_jit_call,
+#if MICROPY_PY_FUNCTION_ATTRS
+    .attr = fun_bc_attr,
+#endif
+};
+
+// Try to promote a hot bytecode function to native code.  The bytecode can't
+// be translated directly because the peephole optimiser doesn't keep it in
+// step with the compiler, so the source file is compiled again and the
+// function found by its code-info.  On success self is changed in place.
+STATIC bool fun_bc_jit_promote(mp_obj_fun_bc_t *self) {
+    // only ever try once
+    self->jit_failed = true;
+
+    const byte *code_info = self->bytecode;
+    mp_decode_uint(&code_info); // skip code_info_size entry
+    qstr block_name = mp_decode_code_info_qstr(&code_info);
+    qstr source_file = mp_decode_code_info_qstr(&code_info);
+
+    mp_lexer_t *lex = mp_lexer_new_from_file(qstr_str(source_file));
+    if (lex == NULL) {
+        return false;
+    }
+
+    mp_raw_code_t *rc = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        rc = mp_compile_jit(&parse_tree, source_file, self->bytecode);
+        nlr_pop();
+    } else {
+        // the function uses something the native emitter doesn't support, or
+        // the source file changed; either way keep running the bytecode
+        return false;
+    }
+    if (rc == NULL) {
+        return false;
+    }
+
+    self->base.type = &mp_type_fun_jit;
+    self->bytecode = rc->data.u_native.fun_data;
+    #if MICROPY_PERSISTENT_CODE
+    self->const_table = rc->data.u_native.const_table;
+    #endif
+    self->jit.name = block_name;
+    return true;
+}
+
+#endif // MICROPY_EMIT_NATIVE_JIT
+
 STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
     MP_STACK_CHECK();
 
@@ -201,13 +386,22 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
     mp_obj_fun_bc_t *self = self_in;
     DEBUG_printf("Func n_def_args: %d\n", self->n_def_args);
 
+    #if MICROPY_EMIT_NATIVE_JIT
+    if (self->jit.count >= MP_STATE_VM(jit_threshold) && MP_STATE_VM(jit_threshold) != 0
+        && !self->jit_failed && fun_bc_jit_promote(self)) {
+        return fun_jit_call(self_in, n_args, n_kw, args);
+    }
+    #endif
+
     // skip code-info block
     const byte *code_info = self->bytecode;
     mp_uint_t code_info_size = mp_decode_uint(&code_info);
     const byte *ip = self->bytecode + code_info_size;
 
+    #if !MICROPY_PERSISTENT_CODE
     // bytecode prelude: skip arg names
     ip += (self->n_pos_args + self->n_kwonly_args) * sizeof(mp_obj_t);
+    #endif
 
     // bytecode prelude: state size and exception stack size
     mp_uint_t n_state = mp_decode_uint(&ip);
@@ -221,7 +415,11 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
     mp_uint_t state_size = n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t);
     mp_code_state *code_state;
     if (state_size > VM_MAX_STATE_ON_STACK) {
+        #if MICROPY_OPT_CODE_STATE_CACHE
+        code_state = fun_bc_new_codestate(sizeof(mp_code_state) + state_size);
+        #else
         code_state = m_new_obj_var(mp_code_state, byte, state_size);
+        #endif
     } else {
         code_state = alloca(sizeof(mp_code_state) + state_size);
     }
@@ -234,8 +432,36 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
     // execute the byte code with the correct globals context
     code_state->old_globals = mp_globals_get();
     mp_globals_set(self->globals);
+    #if MICROPY_GC_PRECISE_VM_ROOTS
+    // register a code state on the C stack so the GC can scan it precisely;
+    // mp_execute_bytecode catches all exceptions so it is always unregistered
+    bool gc_register = state_size <= VM_MAX_STATE_ON_STACK;
+    if (gc_register) {
+        code_state->gc_prev = MP_STATE_VM(gc_code_state_top);
+        code_state->gc_n_exc_stack = n_exc_stack;
+        MP_STATE_VM(gc_code_state_top) = code_state;
+    }
+    #endif
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    mp_code_state *old_code_state = MP_STATE_THREAD(current_code_state);
+    MP_STATE_THREAD(current_code_state) = code_state;
+    #endif
     mp_vm_return_kind_t vm_return_kind = mp_execute_bytecode(code_state, MP_OBJ_NULL);
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    MP_STATE_THREAD(current_code_state) = old_code_state;
+    #endif
+    #if MICROPY_GC_PRECISE_VM_ROOTS
+    if (gc_register) {
+        MP_STATE_VM(gc_code_state_top) = code_state->gc_prev;
+    }
+    #endif
     mp_globals_set(code_state->old_globals);
+    #if MICROPY_EMIT_NATIVE_JIT
+    if (self->base.type == &mp_type_fun_bc) {
+        // the function may have been promoted by a recursive call
+        self->jit.count += 1 + code_state->jit_count;
+    }
+    #endif
 
 #if VM_DETECT_STACK_OVERFLOW
     if (vm_return_kind == MP_VM_RETURN_NORMAL) {
@@ -285,7 +511,11 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
 
     // free the state if it was allocated on the heap
     if (state_size > VM_MAX_STATE_ON_STACK) {
+        #if MICROPY_OPT_CODE_STATE_CACHE
+        fun_bc_del_codestate(code_state, sizeof(mp_code_state) + state_size);
+        #else
         m_del_var(mp_code_state, byte, state_size, code_state);
+        #endif
     }
 
     if (vm_return_kind == MP_VM_RETURN_NORMAL) {
@@ -295,18 +525,6 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
     }
 }
 
-#if MICROPY_PY_FUNCTION_ATTRS
-STATIC void fun_bc_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
-    if (dest[0] != MP_OBJ_NULL) {
-        // not load attribute
-        return;
-    }
-    if (attr == MP_QSTR___name__) {
-        dest[0] = MP_OBJ_NEW_QSTR(mp_obj_fun_get_name(self_in));
-    }
-}
-#endif
-
 const mp_obj_type_t mp_type_fun_bc = {
     { &mp_type_type },
     .name = MP_QSTR_function,
@@ -319,7 +537,7 @@ const mp_obj_type_t mp_type_fun_bc = {
 #endif
 };
 
-mp_obj_t mp_obj_new_fun_bc(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const byte *code) {
+mp_obj_t mp_obj_new_fun_bc(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table) {
     mp_uint_t n_def_args = 0;
     mp_uint_t n_extra_args = 0;
     mp_obj_tuple_t *def_args = def_args_in;
@@ -341,6 +559,15 @@ mp_obj_t mp_obj_new_fun_bc(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_
     o->takes_var_args = (scope_flags & MP_SCOPE_FLAG_VARARGS) != 0;
     o->takes_kw_args = (scope_flags & MP_SCOPE_FLAG_VARKEYWORDS) != 0;
     o->bytecode = code;
+    #if MICROPY_PERSISTENT_CODE
+    o->const_table = const_table;
+    #else
+    (void)const_table;
+    #endif
+    #if MICROPY_EMIT_NATIVE_JIT
+    o->jit_failed = false;
+    o->jit.count = 0;
+    #endif
     if (def_args != MP_OBJ_NULL) {
         memcpy(o->extra_args, def_args->items, n_def_args * sizeof(mp_obj_t));
     }
@@ -368,8 +595,8 @@ STATIC const mp_obj_type_t mp_type_fun_native = {
     .call = fun_native_call,
 };
 
-mp_obj_t mp_obj_new_fun_native(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data) {
-    mp_obj_fun_bc_t *o = mp_obj_new_fun_bc(scope_flags, n_pos_args, n_kwonly_args, def_args_in, def_kw_args, (const byte*)fun_data);
+mp_obj_t mp_obj_new_fun_native(mp_uint_t scope_flags, mp_uint_t n_pos_args, mp_uint_t n_kwonly_args, mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data, const mp_uint_t *const_table) {
+    mp_obj_fun_bc_t *o = mp_obj_new_fun_bc(scope_flags, n_pos_args, n_kwonly_args, def_args_in, def_kw_args, (const byte*)fun_data, const_table);
     o->base.type = &mp_type_fun_native;
     return o;
 }
@@ -404,11 +631,11 @@ STATIC mp_obj_t fun_viper_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_k
     if (n_args == 0) {
         ret = ((viper_fun_0_t)fun)();
     } else if (n_args == 1) {
-        ret = ((viper_fun_1_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 2));
+        ret = ((viper_fun_1_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 4));
     } else if (n_args == 2) {
-        ret = ((viper_fun_2_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 2), mp_convert_obj_to_native(args[1], self->type_sig >> 4));
+        ret = ((viper_fun_2_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 4), mp_convert_obj_to_native(args[1], self->type_sig >> 8));
     } else if (n_args == 3) {
-        ret = ((viper_fun_3_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 2), mp_convert_obj_to_native(args[1], self->type_sig >> 4), mp_convert_obj_to_native(args[2], self->type_sig >> 6));
+        ret = ((viper_fun_3_t)fun)(mp_convert_obj_to_native(args[0], self->type_sig >> 4), mp_convert_obj_to_native(args[1], self->type_sig >> 8), mp_convert_obj_to_native(args[2], self->type_sig >> 12));
     } else {
         assert(0);
         ret = 0;
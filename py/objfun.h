@@ -37,7 +37,19 @@ typedef struct _mp_obj_fun_bc_t {
     mp_uint_t has_def_kw_args : 1;  // set if this function has default keyword args
     mp_uint_t takes_var_args : 1;   // set if this function takes variable args
     mp_uint_t takes_kw_args : 1;    // set if this function takes keyword args
+    #if MICROPY_EMIT_NATIVE_JIT
+    mp_uint_t jit_failed : 1;       // set if promotion to native code failed
+    #endif
     const byte *bytecode;           // bytecode for the function
+    #if MICROPY_PERSISTENT_CODE
+    const mp_uint_t *const_table;   // constant table for the bytecode, see emitbc.c
+    #endif
+    #if MICROPY_EMIT_NATIVE_JIT
+    union {
+        mp_uint_t count;            // calls plus loop iterations while bytecode
+        qstr name;                  // name once promoted, native code has no code-info
+    } jit;
+    #endif
     // the following extra_args array is allocated space to take (in order):
     //  - values of positional default args (if any)
     //  - a single slot for default kw args dict (if it has them)
@@ -46,6 +46,8 @@ typedef struct _mp_obj_gen_wrap_t {
 typedef struct _mp_obj_gen_instance_t {
     mp_obj_base_t base;
     mp_obj_dict_t *globals;
+    // value returned when the generator finished, until taken by next()
+    mp_obj_t return_value;
     mp_code_state code_state;
 } mp_obj_gen_instance_t;
 
@@ -59,8 +61,10 @@ STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw
     mp_uint_t code_info_size = mp_decode_uint(&code_info);
     const byte *ip = self_fun->bytecode + code_info_size;
 
+    #if !MICROPY_PERSISTENT_CODE
     // bytecode prelude: skip arg names
     ip += (self_fun->n_pos_args + self_fun->n_kwonly_args) * sizeof(mp_obj_t);
+    #endif
 
     // bytecode prelude: get state size and exception stack size
     mp_uint_t n_state = mp_decode_uint(&ip);
@@ -72,6 +76,7 @@ STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw
     o->base.type = &mp_type_gen_instance;
 
     o->globals = self_fun->globals;
+    o->return_value = mp_const_none;
     o->code_state.n_state = n_state;
     o->code_state.code_info = 0; // offset to code-info
     o->code_state.ip = (byte*)(ip - self_fun->bytecode); // offset to prelude
@@ -117,7 +122,14 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
     }
     mp_obj_dict_t *old_globals = mp_globals_get();
     mp_globals_set(self->globals);
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    mp_code_state *old_code_state = MP_STATE_THREAD(current_code_state);
+    MP_STATE_THREAD(current_code_state) = &self->code_state;
+    #endif
     mp_vm_return_kind_t ret_kind = mp_execute_bytecode(&self->code_state, throw_value);
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    MP_STATE_THREAD(current_code_state) = old_code_state;
+    #endif
     mp_globals_set(old_globals);
 
     switch (ret_kind) {
@@ -175,8 +187,38 @@ STATIC mp_obj_t gen_resume_and_raise(mp_obj_t self_in, mp_obj_t send_value, mp_o
     }
 }
 
+// Iteration signals the end of the generator with MP_OBJ_STOP_ITERATION, and
+// keeps any return value in the generator rather than raising StopIteration
+// with it, so that for-loops and other consumers never allocate to finish.
 STATIC mp_obj_t gen_instance_iternext(mp_obj_t self_in) {
-    return gen_resume_and_raise(self_in, mp_const_none, MP_OBJ_NULL);
+    mp_obj_gen_instance_t *self = self_in;
+    mp_obj_t ret;
+    switch (mp_obj_gen_resume(self_in, mp_const_none, MP_OBJ_NULL, &ret)) {
+        case MP_VM_RETURN_NORMAL:
+        default:
+            if (ret != MP_OBJ_STOP_ITERATION) {
+                self->return_value = ret;
+            }
+            return MP_OBJ_STOP_ITERATION;
+
+        case MP_VM_RETURN_YIELD:
+            return ret;
+
+        case MP_VM_RETURN_EXCEPTION:
+            if (mp_obj_is_subclass_fast(mp_obj_get_type(ret), &mp_type_StopIteration)) {
+                return MP_OBJ_STOP_ITERATION;
+            } else {
+                nlr_raise(ret);
+            }
+    }
+}
+
+mp_obj_t mp_obj_gen_take_return_value(mp_obj_t self_in) {
+    assert(MP_OBJ_IS_TYPE(self_in, &mp_type_gen_instance));
+    mp_obj_gen_instance_t *self = self_in;
+    mp_obj_t ret = self->return_value;
+    self->return_value = mp_const_none;
+    return ret;
 }
 
 STATIC mp_obj_t gen_instance_send(mp_obj_t self_in, mp_obj_t send_value) {
@@ -31,4 +31,8 @@
 
 mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_val, mp_obj_t throw_val, mp_obj_t *ret_val);
 
+// Get the value returned by a generator that iternext reported as finished,
+// or None; the value is cleared so it's only given once.
+mp_obj_t mp_obj_gen_take_return_value(mp_obj_t self_in);
+
 #endif // __MICROPY_INCLUDED_PY_OBJGENERATOR_H__
@@ -62,5 +62,9 @@ mp_obj_t mp_obj_int_abs(mp_obj_t self_in);
 mp_obj_t mp_obj_int_unary_op(mp_uint_t op, mp_obj_t o_in);
 mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
 mp_obj_t mp_obj_int_binary_op_extra_cases(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
+mp_obj_t mp_obj_int_pow3(mp_obj_t base, mp_obj_t exponent, mp_obj_t modulus);
+#if MICROPY_LONGINT_IMPL == MICROPY_LONGINT_IMPL_MPZ
+mp_obj_t mp_obj_new_int_from_mpz(mpz_t *z);
+#endif
 
 #endif // __MICROPY_INCLUDED_PY_OBJINT_H__
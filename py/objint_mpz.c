@@ -70,6 +70,25 @@ STATIC mp_obj_int_t *mp_obj_int_new_mpz(void) {
     return o;
 }
 
+// Make an int object from z, which is typically an MPZ_SCRATCH that a result
+// was computed into.  Returns a small int if the value fits, otherwise takes
+// over z's digits if they are on the heap, or copies them if not; either way
+// z must not be used afterwards.
+mp_obj_t mp_obj_new_int_from_mpz(mpz_t *z) {
+    mp_int_t value;
+    if (mpz_as_int_checked(z, &value) && MP_SMALL_INT_FITS(value)) {
+        mpz_deinit(z);
+        return MP_OBJ_NEW_SMALL_INT(value);
+    }
+    mp_obj_int_t *o = mp_obj_int_new_mpz();
+    if (z->fixed_dig) {
+        mpz_set(&o->mpz, z);
+    } else {
+        o->mpz = *z;
+    }
+    return o;
+}
+
 // This routine expects you to pass in a buffer and size (in *buf and buf_size).
 // If, for some reason, this buffer is too small, then it will allocate a
 // buffer and return the allocated buffer and size in *buf and *buf_size. It
@@ -153,13 +172,14 @@ mp_obj_t mp_obj_int_unary_op(mp_uint_t op, mp_obj_t o_in) {
 mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     const mpz_t *zlhs;
     const mpz_t *zrhs;
-    mpz_t z_int;
-    mpz_dig_t z_int_dig[MPZ_NUM_DIG_FOR_INT];
+    mpz_t z_lhs_int, z_rhs_int;
+    mpz_dig_t z_lhs_int_dig[MPZ_NUM_DIG_FOR_INT];
+    mpz_dig_t z_rhs_int_dig[MPZ_NUM_DIG_FOR_INT];
 
-    // lhs could be a small int (eg small-int + mpz)
+    // lhs could be a small int (eg small-int + mpz, or a small-int op that overflowed)
     if (MP_OBJ_IS_SMALL_INT(lhs_in)) {
-        mpz_init_fixed_from_int(&z_int, z_int_dig, MPZ_NUM_DIG_FOR_INT, MP_OBJ_SMALL_INT_VALUE(lhs_in));
-        zlhs = &z_int;
+        mpz_init_fixed_from_int(&z_lhs_int, z_lhs_int_dig, MPZ_NUM_DIG_FOR_INT, MP_OBJ_SMALL_INT_VALUE(lhs_in));
+        zlhs = &z_lhs_int;
     } else if (MP_OBJ_IS_TYPE(lhs_in, &mp_type_int)) {
         zlhs = &((mp_obj_int_t*)lhs_in)->mpz;
     } else {
@@ -167,14 +187,13 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
         return MP_OBJ_NULL;
     }
 
-    // if rhs is small int, then lhs was not (otherwise mp_binary_op handles it)
     if (MP_OBJ_IS_SMALL_INT(rhs_in)) {
-        mpz_init_fixed_from_int(&z_int, z_int_dig, MPZ_NUM_DIG_FOR_INT, MP_OBJ_SMALL_INT_VALUE(rhs_in));
-        zrhs = &z_int;
+        mpz_init_fixed_from_int(&z_rhs_int, z_rhs_int_dig, MPZ_NUM_DIG_FOR_INT, MP_OBJ_SMALL_INT_VALUE(rhs_in));
+        zrhs = &z_rhs_int;
     } else if (MP_OBJ_IS_TYPE(rhs_in, &mp_type_int)) {
         zrhs = &((mp_obj_int_t*)rhs_in)->mpz;
 #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (MP_OBJ_IS_TYPE(rhs_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(rhs_in)) {
         return mp_obj_float_binary_op(op, mpz_as_float(zlhs), rhs_in);
 #if MICROPY_PY_BUILTINS_COMPLEX
     } else if (MP_OBJ_IS_TYPE(rhs_in, &mp_type_complex)) {
@@ -195,29 +214,31 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
 #endif
 
     } else if (op <= MP_BINARY_OP_INPLACE_POWER) {
-        mp_obj_int_t *res = mp_obj_int_new_mpz();
+        // compute into stack scratch space, so results that fit in a small
+        // int or a few digits don't need any temporary heap allocation
+        MPZ_SCRATCH(res);
 
         switch (op) {
             case MP_BINARY_OP_ADD:
             case MP_BINARY_OP_INPLACE_ADD:
-                mpz_add_inpl(&res->mpz, zlhs, zrhs);
+                mpz_add_inpl(&res, zlhs, zrhs);
                 break;
             case MP_BINARY_OP_SUBTRACT:
             case MP_BINARY_OP_INPLACE_SUBTRACT:
-                mpz_sub_inpl(&res->mpz, zlhs, zrhs);
+                mpz_sub_inpl(&res, zlhs, zrhs);
                 break;
             case MP_BINARY_OP_MULTIPLY:
             case MP_BINARY_OP_INPLACE_MULTIPLY:
-                mpz_mul_inpl(&res->mpz, zlhs, zrhs);
+                mpz_mul_inpl(&res, zlhs, zrhs);
                 break;
             case MP_BINARY_OP_FLOOR_DIVIDE:
             case MP_BINARY_OP_INPLACE_FLOOR_DIVIDE: {
-                mpz_t rem; mpz_init_zero(&rem);
-                mpz_divmod_inpl(&res->mpz, &rem, zlhs, zrhs);
+                MPZ_SCRATCH(rem);
+                mpz_divmod_inpl(&res, &rem, zlhs, zrhs);
                 if (zlhs->neg != zrhs->neg) {
                     if (!mpz_is_zero(&rem)) {
-                        mpz_t mpzone; mpz_init_from_int(&mpzone, -1);
-                        mpz_add_inpl(&res->mpz, &res->mpz, &mpzone);
+                        MPZ_CONST_INT(minus_one, -1);
+                        mpz_add_inpl(&res, &res, &minus_one);
                     }
                 }
                 mpz_deinit(&rem);
@@ -225,27 +246,27 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
             }
             case MP_BINARY_OP_MODULO:
             case MP_BINARY_OP_INPLACE_MODULO: {
-                mpz_t quo; mpz_init_zero(&quo);
-                mpz_divmod_inpl(&quo, &res->mpz, zlhs, zrhs);
+                MPZ_SCRATCH(quo);
+                mpz_divmod_inpl(&quo, &res, zlhs, zrhs);
                 mpz_deinit(&quo);
                 // Check signs and do Python style modulo
-                if (zlhs->neg != zrhs->neg) {
-                    mpz_add_inpl(&res->mpz, &res->mpz, zrhs);
+                if (zlhs->neg != zrhs->neg && !mpz_is_zero(&res)) {
+                    mpz_add_inpl(&res, &res, zrhs);
                 }
                 break;
             }
 
             case MP_BINARY_OP_AND:
             case MP_BINARY_OP_INPLACE_AND:
-                mpz_and_inpl(&res->mpz, zlhs, zrhs);
+                mpz_and_inpl(&res, zlhs, zrhs);
                 break;
             case MP_BINARY_OP_OR:
             case MP_BINARY_OP_INPLACE_OR:
-                mpz_or_inpl(&res->mpz, zlhs, zrhs);
+                mpz_or_inpl(&res, zlhs, zrhs);
                 break;
             case MP_BINARY_OP_XOR:
             case MP_BINARY_OP_INPLACE_XOR:
-                mpz_xor_inpl(&res->mpz, zlhs, zrhs);
+                mpz_xor_inpl(&res, zlhs, zrhs);
                 break;
 
             case MP_BINARY_OP_LSHIFT:
@@ -257,23 +278,23 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
                     nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative shift count"));
                 }
                 if (op == MP_BINARY_OP_LSHIFT || op == MP_BINARY_OP_INPLACE_LSHIFT) {
-                    mpz_shl_inpl(&res->mpz, zlhs, irhs);
+                    mpz_shl_inpl(&res, zlhs, irhs);
                 } else {
-                    mpz_shr_inpl(&res->mpz, zlhs, irhs);
+                    mpz_shr_inpl(&res, zlhs, irhs);
                 }
                 break;
             }
 
             case MP_BINARY_OP_POWER:
             case MP_BINARY_OP_INPLACE_POWER:
-                mpz_pow_inpl(&res->mpz, zlhs, zrhs);
+                mpz_pow_inpl(&res, zlhs, zrhs);
                 break;
 
             default:
                 return MP_OBJ_NULL; // op not supported
         }
 
-        return res;
+        return mp_obj_new_int_from_mpz(&res);
 
     } else {
         int cmp = mpz_cmp(zlhs, zrhs);
@@ -295,6 +316,38 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     }
 }
 
+#if MICROPY_PY_BUILTINS_POW3
+// computes base ** exponent % modulus for int arguments
+mp_obj_t mp_obj_int_pow3(mp_obj_t base, mp_obj_t exponent, mp_obj_t modulus) {
+    if (!MP_OBJ_IS_INT(base) || !MP_OBJ_IS_INT(exponent) || !MP_OBJ_IS_INT(modulus)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "pow() with 3 arguments requires integers"));
+    }
+    if (!mp_obj_int_is_positive(exponent)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "pow() 2nd argument cannot be negative when 3rd argument specified"));
+    }
+
+    mpz_t z_int[3];
+    mpz_dig_t z_int_dig[3][MPZ_NUM_DIG_FOR_INT];
+    const mpz_t *z[3];
+    mp_obj_t args[3] = {base, exponent, modulus};
+    for (int i = 0; i < 3; ++i) {
+        if (MP_OBJ_IS_SMALL_INT(args[i])) {
+            mpz_init_fixed_from_int(&z_int[i], z_int_dig[i], MPZ_NUM_DIG_FOR_INT, MP_OBJ_SMALL_INT_VALUE(args[i]));
+            z[i] = &z_int[i];
+        } else {
+            z[i] = &((mp_obj_int_t*)args[i])->mpz;
+        }
+    }
+    if (mpz_is_zero(z[2])) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "pow() 3rd argument cannot be 0"));
+    }
+
+    MPZ_SCRATCH(res);
+    mpz_pow3_inpl(&res, z[0], z[1], z[2]);
+    return mp_obj_new_int_from_mpz(&res);
+}
+#endif
+
 mp_obj_t mp_obj_new_int(mp_int_t value) {
     if (MP_SMALL_INT_FITS(value)) {
         return MP_OBJ_NEW_SMALL_INT(value);
@@ -315,9 +368,9 @@ mp_obj_t mp_obj_new_int_from_ull(unsigned long long val) {
 }
 
 mp_obj_t mp_obj_new_int_from_uint(mp_uint_t value) {
-    // SMALL_INT accepts only signed numbers, of one bit less size
-    // than word size, which totals 2 bits less for unsigned numbers.
-    if ((value & (WORD_MSBIT_HIGH | (WORD_MSBIT_HIGH >> 1))) == 0) {
+    // SMALL_INT accepts only signed numbers, so an unsigned number must not
+    // have any bits set above those of MP_SMALL_INT_MAX.
+    if ((value & ~(mp_uint_t)MP_SMALL_INT_MAX) == 0) {
         return MP_OBJ_NEW_SMALL_INT(value);
     }
     return mp_obj_new_int_from_ull(value);
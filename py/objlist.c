@@ -31,6 +31,7 @@
 #include "py/objlist.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
+#include "py/binary.h"
 #include "py/stackctrl.h"
 
 STATIC mp_obj_t mp_obj_new_list_iterator(mp_obj_t list, mp_uint_t cur);
@@ -59,8 +60,48 @@ STATIC void list_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t k
     mp_print_str(print, "]");
 }
 
+// make room for at least n more items without changing len
+STATIC void list_reserve(mp_obj_list_t *self, mp_uint_t n) {
+    if (self->alloc < self->len + n) {
+        self->items = m_renew(mp_obj_t, self->items, self->alloc, self->len + n);
+        mp_seq_clear(self->items, self->len, self->len + n, sizeof(*self->items));
+        self->alloc = self->len + n;
+    }
+}
+
 STATIC mp_obj_t list_extend_from_iter(mp_obj_t list, mp_obj_t iterable) {
+    #if MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_ARRAY
+    // bytes and array-like objects: read the elements straight from the buffer
+    mp_buffer_info_t bufinfo;
+    if ((MP_OBJ_IS_TYPE(iterable, &mp_type_bytes)
+        #if MICROPY_PY_BUILTINS_BYTEARRAY
+        || MP_OBJ_IS_TYPE(iterable, &mp_type_bytearray)
+        #endif
+        #if MICROPY_PY_ARRAY
+        || MP_OBJ_IS_TYPE(iterable, &mp_type_array)
+        #endif
+        #if MICROPY_PY_BUILTINS_MEMORYVIEW
+        || MP_OBJ_IS_TYPE(iterable, &mp_type_memoryview)
+        #endif
+        ) && mp_get_buffer(iterable, &bufinfo, MP_BUFFER_READ)) {
+        // bytes reports signed typecode 'b' but iterates as unsigned
+        char typecode = MP_OBJ_IS_TYPE(iterable, &mp_type_bytes) ? 'B' : bufinfo.typecode;
+        mp_uint_t n = bufinfo.len / mp_binary_get_size('@', typecode, NULL);
+        mp_obj_list_t *self = MP_OBJ_CAST(list);
+        list_reserve(self, n);
+        for (mp_uint_t i = 0; i < n; i++) {
+            self->items[self->len++] = mp_binary_get_val_array(typecode, bufinfo.buf, i);
+        }
+        return list;
+    }
+    #endif
+
+    // size the list once up front if the final length is known
+    mp_int_t hint = mp_obj_len_hint(iterable);
     mp_obj_t iter = mp_getiter(iterable);
+    if (hint > 0) {
+        list_reserve(MP_OBJ_CAST(list), hint);
+    }
     mp_obj_t item;
     while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
         mp_obj_list_append(list, item);
@@ -80,7 +121,6 @@ STATIC mp_obj_t list_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw
         case 1:
         default: {
             // make list from iterable
-            // TODO: optimize list/tuple
             mp_obj_t list = mp_obj_new_list(0, NULL);
             return list_extend_from_iter(list, args[0]);
         }
@@ -285,6 +325,499 @@ STATIC mp_obj_t list_pop(mp_uint_t n_args, const mp_obj_t *args) {
     return ret;
 }
 
+#if MICROPY_OPT_STABLE_SORT
+
+// A stable, adaptive merge sort in the style of TimSort.  It finds runs that
+// are already in order (reversing strictly descending ones), extends short
+// runs with binary insertion sort, and merges runs off a stack so that their
+// lengths stay balanced.  Merges gallop through long stretches that come from
+// one side.  Elements are w words long, where w is 2 when a key value is
+// paired with each item, and only the first word is compared.
+
+#define SORT_MIN_MERGE (64)
+#define SORT_MIN_GALLOP (7)
+// enough for any list that fits in memory, given the run length invariants
+#define SORT_MAX_RUNS (sizeof(mp_uint_t) * 8 * 3 / 2)
+
+typedef struct _sort_run_t {
+    mp_obj_t *base;
+    mp_uint_t len;
+} sort_run_t;
+
+typedef struct _sort_state_t {
+    mp_obj_t *tmp; // room for half the elements, used by the merges
+    mp_uint_t w;
+    bool reverse;
+    mp_uint_t min_gallop;
+    mp_uint_t n_runs;
+    sort_run_t runs[SORT_MAX_RUNS];
+} sort_state_t;
+
+STATIC bool sort_lt(sort_state_t *st, mp_obj_t a, mp_obj_t b) {
+    if (st->reverse) {
+        mp_obj_t t = a;
+        a = b;
+        b = t;
+    }
+    #if MICROPY_OPT_NUMERIC_SEQ
+    bool res;
+    if (mp_binary_op_less_fast(a, b, &res)) {
+        return res;
+    }
+    #endif
+    return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, a, b));
+}
+
+STATIC inline void sort_copy(mp_obj_t *dest, const mp_obj_t *src, mp_uint_t w) {
+    dest[0] = src[0];
+    if (w == 2) {
+        dest[1] = src[1];
+    }
+}
+
+// Sort a[0:n] given that a[0:start] is already sorted.
+STATIC void sort_binary_insertion(sort_state_t *st, mp_obj_t *a, mp_uint_t n, mp_uint_t start) {
+    mp_uint_t w = st->w;
+    for (mp_uint_t i = start; i < n; i++) {
+        mp_obj_t pivot[2];
+        sort_copy(pivot, a + i * w, w);
+        mp_uint_t lo = 0, hi = i;
+        while (lo < hi) {
+            mp_uint_t mid = lo + (hi - lo) / 2;
+            if (sort_lt(st, pivot[0], a[mid * w])) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        memmove(a + (lo + 1) * w, a + lo * w, (i - lo) * w * sizeof(mp_obj_t));
+        sort_copy(a + lo * w, pivot, w);
+    }
+}
+
+// Return the length of the run at the start of a[0:n], making it ascending.
+STATIC mp_uint_t sort_count_run(sort_state_t *st, mp_obj_t *a, mp_uint_t n) {
+    mp_uint_t w = st->w;
+    if (n == 1) {
+        return 1;
+    }
+    mp_uint_t i = 2;
+    if (sort_lt(st, a[w], a[0])) {
+        // strictly descending, so reversing it keeps the sort stable
+        while (i < n && sort_lt(st, a[i * w], a[(i - 1) * w])) {
+            i++;
+        }
+        for (mp_obj_t *lo = a, *hi = a + (i - 1) * w; lo < hi; lo += w, hi -= w) {
+            mp_obj_t t[2];
+            sort_copy(t, lo, w);
+            sort_copy(lo, hi, w);
+            sort_copy(hi, t, w);
+        }
+    } else {
+        while (i < n && !sort_lt(st, a[i * w], a[(i - 1) * w])) {
+            i++;
+        }
+    }
+    return i;
+}
+
+// Return k such that a[k-1] < key <= a[k], searching out from a[hint].
+STATIC mp_uint_t sort_gallop_left(sort_state_t *st, mp_obj_t key, mp_obj_t *a, mp_int_t n, mp_int_t hint) {
+    mp_uint_t w = st->w;
+    mp_int_t lastofs = 0, ofs = 1;
+    if (sort_lt(st, a[hint * w], key)) {
+        // a[hint] < key, so gallop right until a[hint+lastofs] < key <= a[hint+ofs]
+        mp_int_t maxofs = n - hint;
+        while (ofs < maxofs && sort_lt(st, a[(hint + ofs) * w], key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) {
+            ofs = maxofs;
+        }
+        lastofs += hint;
+        ofs += hint;
+    } else {
+        // key <= a[hint], so gallop left until a[hint-ofs] < key <= a[hint-lastofs]
+        mp_int_t maxofs = hint + 1;
+        while (ofs < maxofs && !sort_lt(st, a[(hint - ofs) * w], key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) {
+            ofs = maxofs;
+        }
+        mp_int_t k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    }
+    // now a[lastofs] < key <= a[ofs], so binary search in between
+    lastofs++;
+    while (lastofs < ofs) {
+        mp_int_t m = lastofs + ((ofs - lastofs) >> 1);
+        if (sort_lt(st, a[m * w], key)) {
+            lastofs = m + 1;
+        } else {
+            ofs = m;
+        }
+    }
+    return ofs;
+}
+
+// Return k such that a[k-1] <= key < a[k], searching out from a[hint].
+STATIC mp_uint_t sort_gallop_right(sort_state_t *st, mp_obj_t key, mp_obj_t *a, mp_int_t n, mp_int_t hint) {
+    mp_uint_t w = st->w;
+    mp_int_t lastofs = 0, ofs = 1;
+    if (sort_lt(st, key, a[hint * w])) {
+        // key < a[hint], so gallop left until a[hint-ofs] <= key < a[hint-lastofs]
+        mp_int_t maxofs = hint + 1;
+        while (ofs < maxofs && sort_lt(st, key, a[(hint - ofs) * w])) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) {
+            ofs = maxofs;
+        }
+        mp_int_t k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    } else {
+        // a[hint] <= key, so gallop right until a[hint+lastofs] <= key < a[hint+ofs]
+        mp_int_t maxofs = n - hint;
+        while (ofs < maxofs && !sort_lt(st, key, a[(hint + ofs) * w])) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) {
+            ofs = maxofs;
+        }
+        lastofs += hint;
+        ofs += hint;
+    }
+    // now a[lastofs] <= key < a[ofs], so binary search in between
+    lastofs++;
+    while (lastofs < ofs) {
+        mp_int_t m = lastofs + ((ofs - lastofs) >> 1);
+        if (sort_lt(st, key, a[m * w])) {
+            ofs = m;
+        } else {
+            lastofs = m + 1;
+        }
+    }
+    return ofs;
+}
+
+// Merge the adjacent runs dest[0:na] and pb[0:nb], where na <= nb, the first
+// element of B is less than the first of A, and the last element of A is
+// greater than all of B.  A is moved to the temporary buffer first.
+STATIC void sort_merge_lo(sort_state_t *st, mp_obj_t *dest, mp_uint_t na, mp_obj_t *pb, mp_uint_t nb) {
+    mp_uint_t w = st->w;
+    mp_obj_t *pa = st->tmp;
+    memcpy(pa, dest, na * w * sizeof(mp_obj_t));
+
+    sort_copy(dest, pb, w);
+    dest += w;
+    pb += w;
+    if (--nb == 0) {
+        goto done;
+    }
+    if (na == 1) {
+        goto copy_b;
+    }
+
+    mp_uint_t min_gallop = st->min_gallop;
+    for (;;) {
+        mp_uint_t acount = 0, bcount = 0;
+
+        // take one element at a time until one run starts winning consistently
+        do {
+            if (sort_lt(st, pb[0], pa[0])) {
+                sort_copy(dest, pb, w);
+                dest += w;
+                pb += w;
+                bcount++;
+                acount = 0;
+                if (--nb == 0) {
+                    goto done;
+                }
+            } else {
+                sort_copy(dest, pa, w);
+                dest += w;
+                pa += w;
+                acount++;
+                bcount = 0;
+                if (--na == 1) {
+                    goto copy_b;
+                }
+            }
+        } while ((acount | bcount) < min_gallop);
+
+        // then gallop, looking for where the next element of each run goes
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            mp_uint_t k = sort_gallop_right(st, pb[0], pa, na, 0);
+            acount = k;
+            if (k) {
+                memcpy(dest, pa, k * w * sizeof(mp_obj_t));
+                dest += k * w;
+                pa += k * w;
+                na -= k;
+                if (na == 1) {
+                    goto copy_b;
+                }
+                if (na == 0) {
+                    goto done;
+                }
+            }
+            sort_copy(dest, pb, w);
+            dest += w;
+            pb += w;
+            if (--nb == 0) {
+                goto done;
+            }
+
+            k = sort_gallop_left(st, pa[0], pb, nb, 0);
+            bcount = k;
+            if (k) {
+                memmove(dest, pb, k * w * sizeof(mp_obj_t));
+                dest += k * w;
+                pb += k * w;
+                nb -= k;
+                if (nb == 0) {
+                    goto done;
+                }
+            }
+            sort_copy(dest, pa, w);
+            dest += w;
+            pa += w;
+            if (--na == 1) {
+                goto copy_b;
+            }
+        } while (acount >= SORT_MIN_GALLOP || bcount >= SORT_MIN_GALLOP);
+        min_gallop++;
+        st->min_gallop = min_gallop;
+    }
+
+copy_b:
+    // the last element of A goes after the rest of B
+    memmove(dest, pb, nb * w * sizeof(mp_obj_t));
+    sort_copy(dest + nb * w, pa, w);
+    return;
+
+done:
+    memcpy(dest, pa, na * w * sizeof(mp_obj_t));
+}
+
+// Merge the adjacent runs pa[0:na] and pb[0:nb], where na >= nb, with the
+// same conditions as sort_merge_lo.  B is moved to the temporary buffer and
+// the merge works from the end.
+STATIC void sort_merge_hi(sort_state_t *st, mp_obj_t *pa, mp_uint_t na, mp_obj_t *pb, mp_uint_t nb) {
+    mp_uint_t w = st->w;
+    mp_obj_t *base_a = pa;
+    mp_obj_t *base_b = st->tmp;
+    memcpy(base_b, pb, nb * w * sizeof(mp_obj_t));
+    mp_obj_t *dest = pb + (nb - 1) * w;
+    pa += (na - 1) * w;
+    pb = base_b + (nb - 1) * w;
+
+    sort_copy(dest, pa, w);
+    dest -= w;
+    pa -= w;
+    if (--na == 0) {
+        goto done;
+    }
+    if (nb == 1) {
+        goto copy_a;
+    }
+
+    mp_uint_t min_gallop = st->min_gallop;
+    for (;;) {
+        mp_uint_t acount = 0, bcount = 0;
+
+        do {
+            if (sort_lt(st, pb[0], pa[0])) {
+                sort_copy(dest, pa, w);
+                dest -= w;
+                pa -= w;
+                acount++;
+                bcount = 0;
+                if (--na == 0) {
+                    goto done;
+                }
+            } else {
+                sort_copy(dest, pb, w);
+                dest -= w;
+                pb -= w;
+                bcount++;
+                acount = 0;
+                if (--nb == 1) {
+                    goto copy_a;
+                }
+            }
+        } while ((acount | bcount) < min_gallop);
+
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            // the elements of A greater than the last of B
+            mp_uint_t k = na - sort_gallop_right(st, pb[0], base_a, na, na - 1);
+            acount = k;
+            if (k) {
+                dest -= k * w;
+                pa -= k * w;
+                memmove(dest + w, pa + w, k * w * sizeof(mp_obj_t));
+                na -= k;
+                if (na == 0) {
+                    goto done;
+                }
+            }
+            sort_copy(dest, pb, w);
+            dest -= w;
+            pb -= w;
+            if (--nb == 1) {
+                goto copy_a;
+            }
+
+            // the elements of B not less than the last of A
+            k = nb - sort_gallop_left(st, pa[0], base_b, nb, nb - 1);
+            bcount = k;
+            if (k) {
+                dest -= k * w;
+                pb -= k * w;
+                memcpy(dest + w, pb + w, k * w * sizeof(mp_obj_t));
+                nb -= k;
+                if (nb == 1) {
+                    goto copy_a;
+                }
+                if (nb == 0) {
+                    goto done;
+                }
+            }
+            sort_copy(dest, pa, w);
+            dest -= w;
+            pa -= w;
+            if (--na == 0) {
+                goto done;
+            }
+        } while (acount >= SORT_MIN_GALLOP || bcount >= SORT_MIN_GALLOP);
+        min_gallop++;
+        st->min_gallop = min_gallop;
+    }
+
+copy_a:
+    // the first element of B goes before the rest of A
+    dest -= na * w;
+    pa -= na * w;
+    memmove(dest + w, pa + w, na * w * sizeof(mp_obj_t));
+    sort_copy(dest, base_b, w);
+    return;
+
+done:
+    memcpy(dest + w - nb * w, base_b, nb * w * sizeof(mp_obj_t));
+}
+
+// Merge runs i and i+1 on the stack.
+STATIC void sort_merge_at(sort_state_t *st, mp_uint_t i) {
+    mp_uint_t w = st->w;
+    mp_obj_t *pa = st->runs[i].base;
+    mp_uint_t na = st->runs[i].len;
+    mp_obj_t *pb = st->runs[i + 1].base;
+    mp_uint_t nb = st->runs[i + 1].len;
+
+    st->runs[i].len = na + nb;
+    if (i == st->n_runs - 3) {
+        st->runs[i + 1] = st->runs[i + 2];
+    }
+    st->n_runs--;
+
+    // elements of A not greater than the first of B are already in place
+    mp_uint_t k = sort_gallop_right(st, pb[0], pa, na, 0);
+    pa += k * w;
+    na -= k;
+    if (na == 0) {
+        return;
+    }
+    // as are elements of B not less than the last of A
+    nb = sort_gallop_left(st, pa[(na - 1) * w], pb, nb, nb - 1);
+    if (nb == 0) {
+        return;
+    }
+
+    if (na <= nb) {
+        sort_merge_lo(st, pa, na, pb, nb);
+    } else {
+        sort_merge_hi(st, pa, na, pb, nb);
+    }
+}
+
+// Merge runs until their lengths, from the top of the stack down, grow faster
+// than the Fibonacci numbers.  This keeps the stack short and merges balanced.
+STATIC void sort_merge_collapse(sort_state_t *st) {
+    sort_run_t *r = st->runs;
+    while (st->n_runs > 1) {
+        mp_uint_t n = st->n_runs - 2;
+        if ((n > 0 && r[n - 1].len <= r[n].len + r[n + 1].len)
+            || (n > 1 && r[n - 2].len <= r[n - 1].len + r[n].len)) {
+            if (r[n - 1].len < r[n + 1].len) {
+                n--;
+            }
+        } else if (r[n].len > r[n + 1].len) {
+            break;
+        }
+        sort_merge_at(st, n);
+    }
+}
+
+STATIC void mp_timsort(mp_obj_t *a, mp_uint_t n, mp_uint_t w, bool reverse) {
+    sort_state_t st;
+    st.tmp = NULL;
+    st.w = w;
+    st.reverse = reverse;
+    st.min_gallop = SORT_MIN_GALLOP;
+    st.n_runs = 0;
+
+    if (n < SORT_MIN_MERGE) {
+        sort_binary_insertion(&st, a, n, sort_count_run(&st, a, n));
+        return;
+    }
+
+    // runs shorter than min_run are extended by insertion sort; it is chosen
+    // so that n / min_run is a power of 2, or a little less
+    mp_uint_t min_run = n, r = 0;
+    while (min_run >= SORT_MIN_MERGE) {
+        r |= min_run & 1;
+        min_run >>= 1;
+    }
+    min_run += r;
+
+    st.tmp = m_new(mp_obj_t, n / 2 * w);
+    for (mp_uint_t rem = n; rem > 0;) {
+        mp_uint_t len = sort_count_run(&st, a, rem);
+        if (len < min_run) {
+            mp_uint_t force = rem < min_run ? rem : min_run;
+            sort_binary_insertion(&st, a, force, len);
+            len = force;
+        }
+        st.runs[st.n_runs].base = a;
+        st.runs[st.n_runs].len = len;
+        st.n_runs++;
+        sort_merge_collapse(&st);
+        a += len * w;
+        rem -= len;
+    }
+    while (st.n_runs > 1) {
+        mp_uint_t i = st.n_runs - 2;
+        if (i > 0 && st.runs[i - 1].len < st.runs[i + 1].len) {
+            i--;
+        }
+        sort_merge_at(&st, i);
+    }
+    m_del(mp_obj_t, st.tmp, n / 2 * w);
+}
+
+#else
+
 STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
     MP_STACK_CHECK();
     while (head < tail) {
@@ -313,7 +846,8 @@ STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj
     }
 }
 
-// TODO Python defines sort to be stable but ours is not
+#endif
+
 mp_obj_t mp_obj_list_sort(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
@@ -327,11 +861,38 @@ mp_obj_t mp_obj_list_sort(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *
     assert(MP_OBJ_IS_TYPE(pos_args[0], &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_CAST(pos_args[0]);
 
+    #if MICROPY_OPT_STABLE_SORT
+    if (self->len > 1) {
+        // Sort a copy of the items, each paired with its key if there's a key
+        // function, so the list is left as it was if a comparison raises.
+        mp_uint_t n = self->len;
+        mp_uint_t w = args[0].u_obj == mp_const_none ? 1 : 2;
+        mp_obj_t *a = m_new(mp_obj_t, n * w);
+        if (w == 1) {
+            memcpy(a, self->items, n * sizeof(mp_obj_t));
+        } else {
+            for (mp_uint_t i = 0; i < n; i++) {
+                a[2 * i] = mp_call_function_1(args[0].u_obj, self->items[i]);
+                a[2 * i + 1] = self->items[i];
+            }
+        }
+        mp_timsort(a, n, w, args[1].u_bool);
+        if (self->len != n) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "list modified during sort"));
+        }
+        for (mp_uint_t i = 0; i < n; i++) {
+            self->items[i] = a[i * w + w - 1];
+        }
+        m_del(mp_obj_t, a, n * w);
+    }
+    #else
+    // TODO Python defines sort to be stable but ours is not
     if (self->len > 1) {
         mp_quicksort(self->items, self->items + self->len - 1,
                      args[0].u_obj == mp_const_none ? MP_OBJ_NULL : args[0].u_obj,
                      args[1].u_bool ? mp_const_false : mp_const_true);
     }
+    #endif
 
     return mp_const_none;
 }
@@ -462,7 +1023,7 @@ void mp_obj_list_init(mp_obj_list_t *o, mp_uint_t n) {
 }
 
 STATIC mp_obj_list_t *list_new(mp_uint_t n) {
-    mp_obj_t o_in = m_new_obj(mp_obj_list_t);
+    mp_obj_t o_in = m_new_obj_pooled(mp_obj_list_t, &mp_type_list, MP_OBJ_POOL_LIST);
     mp_obj_list_t *o = MP_OBJ_CAST(o_in);
     mp_obj_list_init(o, n);
     return o;
@@ -518,9 +1079,19 @@ STATIC mp_obj_t list_it_iternext(mp_obj_t self_in) {
     }
 }
 
+STATIC mp_obj_t list_it_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_list_it_t *self = MP_OBJ_CAST(self_in);
+    mp_obj_list_t *list = MP_OBJ_CAST(self->list);
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        return MP_OBJ_NEW_SMALL_INT(self->cur < list->len ? list->len - self->cur : 0);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 STATIC const mp_obj_type_t mp_type_list_it = {
     { &mp_type_type },
     .name = MP_QSTR_iterator,
+    .unary_op = list_it_unary_op,
     .getiter = mp_identity,
     .iternext = list_it_iternext,
 };
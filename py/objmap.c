@@ -27,11 +27,13 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include "py/runtime0.h"
 #include "py/runtime.h"
 
 typedef struct _mp_obj_map_t {
     mp_obj_base_t base;
     mp_uint_t n_iters;
+    mp_uint_t idx; // for list and tuple sources
     mp_obj_t fun;
     mp_obj_t iters[];
 } mp_obj_map_t;
@@ -41,9 +43,10 @@ STATIC mp_obj_t map_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
     mp_obj_map_t *o = m_new_obj_var(mp_obj_map_t, mp_obj_t, n_args - 1);
     o->base.type = type_in;
     o->n_iters = n_args - 1;
+    o->idx = 0;
     o->fun = args[0];
     for (mp_uint_t i = 0; i < n_args - 1; i++) {
-        o->iters[i] = mp_getiter(args[i + 1]);
+        o->iters[i] = mp_getiter_or_seq(args[i + 1]);
     }
     return o;
 }
@@ -51,23 +54,51 @@ STATIC mp_obj_t map_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
 STATIC mp_obj_t map_iternext(mp_obj_t self_in) {
     assert(MP_OBJ_IS_TYPE(self_in, &mp_type_map));
     mp_obj_map_t *self = self_in;
-    mp_obj_t *nextses = m_new(mp_obj_t, self->n_iters);
+    // the arguments for the common cases of a few sources go on the C stack
+    mp_obj_t nextses_stack[4];
+    mp_obj_t *nextses = nextses_stack;
+    if (self->n_iters > MP_ARRAY_SIZE(nextses_stack)) {
+        nextses = m_new(mp_obj_t, self->n_iters);
+    }
 
     for (mp_uint_t i = 0; i < self->n_iters; i++) {
-        mp_obj_t next = mp_iternext(self->iters[i]);
+        mp_obj_t next = mp_iternext_or_seq(self->iters[i], self->idx);
         if (next == MP_OBJ_STOP_ITERATION) {
-            m_del(mp_obj_t, nextses, self->n_iters);
+            if (nextses != nextses_stack) {
+                m_del(mp_obj_t, nextses, self->n_iters);
+            }
             return MP_OBJ_STOP_ITERATION;
         }
         nextses[i] = next;
     }
+    self->idx++;
     return mp_call_function_n_kw(self->fun, self->n_iters, 0, nextses);
 }
 
+// map stops with the shortest iterable; the hint is unknown if any is unknown
+STATIC mp_obj_t map_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_map_t *self = self_in;
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        mp_int_t len = -1;
+        for (mp_uint_t i = 0; i < self->n_iters; i++) {
+            mp_int_t l = mp_len_hint_or_seq(self->iters[i], self->idx);
+            if (l < 0) {
+                return MP_OBJ_NULL;
+            }
+            if (len < 0 || l < len) {
+                len = l;
+            }
+        }
+        return MP_OBJ_NEW_SMALL_INT(len);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 const mp_obj_type_t mp_type_map = {
     { &mp_type_type },
     .name = MP_QSTR_map,
     .make_new = map_make_new,
+    .unary_op = map_unary_op,
     .getiter = mp_identity,
     .iternext = map_iternext,
 };
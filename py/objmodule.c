@@ -57,6 +57,33 @@ STATIC void module_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
         mp_map_elem_t *elem = mp_map_lookup(&self->globals->map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
         if (elem != NULL) {
             dest[0] = elem->value;
+        #if MICROPY_MULTIPLE_INTERPRETERS && MICROPY_PY_SYS
+        } else if (self == &mp_module_sys) {
+            // these belong to the running interpreter, so they can't be in
+            // the static globals of sys
+            if (attr == MP_QSTR_path) {
+                dest[0] = mp_sys_path;
+            } else if (attr == MP_QSTR_argv) {
+                dest[0] = mp_sys_argv;
+            }
+        #endif
+        } else {
+            #if MICROPY_MODULE_LAZY_SUBMODULES
+            // a submodule not imported yet is imported now
+            dest[0] = mp_import_submodule_maybe(self, attr);
+            if (dest[0] != MP_OBJ_NULL) {
+                return;
+            }
+            #endif
+            #if MICROPY_MODULE_GETATTR
+            // try __getattr__
+            if (attr != MP_QSTR___getattr__) {
+                elem = mp_map_lookup(&self->globals->map, MP_OBJ_NEW_QSTR(MP_QSTR___getattr__), MP_MAP_LOOKUP);
+                if (elem != NULL) {
+                    dest[0] = mp_call_function_1(elem->value, MP_OBJ_NEW_QSTR(attr));
+                }
+            }
+            #endif
         }
     } else {
         // delete/store attribute
@@ -128,7 +155,9 @@ mp_obj_dict_t *mp_obj_module_get_globals(mp_obj_t self_in) {
 // Global module table and related functions
 
 STATIC const mp_map_elem_t mp_builtin_module_table[] = {
+#if !MICROPY_MULTIPLE_INTERPRETERS
     { MP_OBJ_NEW_QSTR(MP_QSTR___main__), (mp_obj_t)&mp_module___main__ },
+#endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_builtins), (mp_obj_t)&mp_module_builtins },
     { MP_OBJ_NEW_QSTR(MP_QSTR_micropython), (mp_obj_t)&mp_module_micropython },
 
@@ -159,6 +188,9 @@ STATIC const mp_map_elem_t mp_builtin_module_table[] = {
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
     { MP_OBJ_NEW_QSTR(MP_QSTR_gc), (mp_obj_t)&mp_module_gc },
 #endif
+#if MICROPY_PY_THREAD
+    { MP_OBJ_NEW_QSTR(MP_QSTR__thread), (mp_obj_t)&mp_module_thread },
+#endif
 
     // extmod modules
 
@@ -183,9 +215,30 @@ STATIC const mp_map_elem_t mp_builtin_module_table[] = {
 #if MICROPY_PY_UBINASCII
     { MP_OBJ_NEW_QSTR(MP_QSTR_ubinascii), (mp_obj_t)&mp_module_ubinascii },
 #endif
+#if MICROPY_PY_UCRYPTOLIB
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ucryptolib), (mp_obj_t)&mp_module_ucryptolib },
+#endif
 #if MICROPY_PY_MACHINE
     { MP_OBJ_NEW_QSTR(MP_QSTR_machine), (mp_obj_t)&mp_module_machine },
 #endif
+#if MICROPY_PY_UASYNCIO
+    { MP_OBJ_NEW_QSTR(MP_QSTR__uasyncio), (mp_obj_t)&mp_module_uasyncio },
+#endif
+#if MICROPY_PY_URINGBUF
+    { MP_OBJ_NEW_QSTR(MP_QSTR_uringbuf), (mp_obj_t)&mp_module_uringbuf },
+#endif
+#if MICROPY_PY_UWEAKREF
+    { MP_OBJ_NEW_QSTR(MP_QSTR_uweakref), (mp_obj_t)&mp_module_uweakref },
+#endif
+#if MICROPY_PY_URANDOM
+    { MP_OBJ_NEW_QSTR(MP_QSTR_urandom), (mp_obj_t)&mp_module_urandom },
+#endif
+#if MICROPY_PY_FRAMEBUF
+    { MP_OBJ_NEW_QSTR(MP_QSTR_framebuf), (mp_obj_t)&mp_module_framebuf },
+#endif
+#if MICROPY_PY_UHTTP
+    { MP_OBJ_NEW_QSTR(MP_QSTR_uhttp), (mp_obj_t)&mp_module_uhttp },
+#endif
 
     // extra builtin modules as defined by a port
     MICROPY_PORT_BUILTIN_MODULES
@@ -195,10 +248,16 @@ STATIC MP_DEFINE_CONST_MAP(mp_builtin_module_map, mp_builtin_module_table);
 
 void mp_module_init(void) {
     mp_map_init(&MP_STATE_VM(mp_loaded_modules_map), 3);
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_map_init(&MP_STATE_VM(mp_import_listdir_cache), 0);
+    #endif
 }
 
 void mp_module_deinit(void) {
     mp_map_deinit(&MP_STATE_VM(mp_loaded_modules_map));
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_map_deinit(&MP_STATE_VM(mp_import_listdir_cache));
+    #endif
 }
 
 // returns MP_OBJ_NULL if not found
@@ -212,6 +271,19 @@ mp_obj_t mp_module_get(qstr module_name) {
         if (el == NULL) {
             return MP_OBJ_NULL;
         }
+
+        #if MICROPY_MODULE_BUILTIN_INIT
+        // on first import, register the module so its __init__ runs only
+        // once, then call __init__ if it has one
+        mp_obj_t module_obj = el->value;
+        mp_module_register(module_name, module_obj);
+        mp_map_t *globals = &((mp_obj_module_t*)module_obj)->globals->map;
+        mp_map_elem_t *init = mp_map_lookup(globals, MP_OBJ_NEW_QSTR(MP_QSTR___init__), MP_MAP_LOOKUP);
+        if (init != NULL) {
+            mp_call_function_0(init->value);
+        }
+        return module_obj;
+        #endif
     }
 
     // module found, return it
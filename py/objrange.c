@@ -52,15 +52,30 @@ STATIC mp_obj_t range_it_iternext(mp_obj_t o_in) {
     }
 }
 
+STATIC mp_obj_t range_it_unary_op(mp_uint_t op, mp_obj_t o_in) {
+    mp_obj_range_it_t *o = o_in;
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        mp_int_t len = 0;
+        if (o->step > 0 && o->cur < o->stop) {
+            len = (o->stop - o->cur + o->step - 1) / o->step;
+        } else if (o->step < 0 && o->cur > o->stop) {
+            len = (o->cur - o->stop - o->step - 1) / -o->step;
+        }
+        return MP_OBJ_NEW_SMALL_INT(len);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 STATIC const mp_obj_type_t range_it_type = {
     { &mp_type_type },
     .name = MP_QSTR_iterator,
+    .unary_op = range_it_unary_op,
     .getiter = mp_identity,
     .iternext = range_it_iternext,
 };
 
 STATIC mp_obj_t mp_obj_new_range_iterator(mp_int_t cur, mp_int_t stop, mp_int_t step) {
-    mp_obj_range_it_t *o = m_new_obj(mp_obj_range_it_t);
+    mp_obj_range_it_t *o = m_new_obj_pooled(mp_obj_range_it_t, &range_it_type, MP_OBJ_POOL_RANGE_IT);
     o->base.type = &range_it_type;
     o->cur = cur;
     o->stop = stop;
@@ -127,6 +142,13 @@ STATIC mp_int_t range_len(mp_obj_range_t *self) {
     return len;
 }
 
+mp_int_t mp_obj_range_get(mp_obj_t self_in, mp_int_t *start, mp_int_t *step) {
+    mp_obj_range_t *self = self_in;
+    *start = self->start;
+    *step = self->step;
+    return range_len(self);
+}
+
 STATIC mp_obj_t range_unary_op(mp_uint_t op, mp_obj_t self_in) {
     mp_obj_range_t *self = self_in;
     mp_int_t len = range_len(self);
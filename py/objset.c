@@ -135,6 +135,10 @@ STATIC mp_obj_t set_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
             // 1 argument, an iterable from which we make a new set
             mp_obj_set_t *set = mp_obj_new_set(0, NULL);
             mp_obj_t iterable = mp_getiter(args[0]);
+            mp_int_t len = mp_obj_len_hint(iterable);
+            if (len > 0) {
+                mp_set_reserve(&set->set, len);
+            }
             mp_obj_t item;
             while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
                 mp_obj_set_store(set, item);
@@ -230,6 +234,20 @@ STATIC mp_obj_t set_discard(mp_obj_t self_in, mp_obj_t item) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(set_discard_obj, set_discard);
 
+// Remove from the given set, in place, the elements that are (keep=false) or
+// are not (keep=true) in the other set.
+STATIC void set_filter_by(mp_set_t *set, const mp_set_t *other, bool keep) {
+    for (mp_uint_t pos = 0; pos < set->alloc; pos++) {
+        if (MP_SET_SLOT_IS_FILLED(set, pos)) {
+            bool found = mp_set_lookup((mp_set_t*)other, set->table[pos], MP_MAP_LOOKUP) != MP_OBJ_NULL;
+            if (found != keep) {
+                set->table[pos] = MP_OBJ_SENTINEL;
+                set->used--;
+            }
+        }
+    }
+}
+
 STATIC mp_obj_t set_diff_int(mp_uint_t n_args, const mp_obj_t *args, bool update) {
     assert(n_args > 0);
 
@@ -239,14 +257,34 @@ STATIC mp_obj_t set_diff_int(mp_uint_t n_args, const mp_obj_t *args, bool update
         self = args[0];
     } else {
         check_set_or_frozenset(args[0]);
+        mp_obj_set_t *first = args[0];
+        if (n_args == 2 && is_set_or_frozenset(args[1]) && args[1] != args[0]
+            && ((mp_obj_set_t*)args[1])->set.used > first->set.used) {
+            // the other set is bigger, so rather than copy this set and
+            // discard each element of the other, pick out the elements of
+            // this set that are not in the other
+            self = mp_obj_new_set(0, NULL);
+            mp_set_reserve(&self->set, first->set.used);
+            const mp_set_t *other = &((mp_obj_set_t*)args[1])->set;
+            for (mp_uint_t pos = 0; pos < first->set.alloc; pos++) {
+                if (MP_SET_SLOT_IS_FILLED(&first->set, pos)
+                    && !mp_set_lookup((mp_set_t*)other, first->set.table[pos], MP_MAP_LOOKUP)) {
+                    mp_set_lookup(&self->set, first->set.table[pos], MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+                }
+            }
+            self->base.type = first->base.type;
+            return self;
+        }
         self = set_copy_as_mutable(args[0]);
     }
 
-
     for (mp_uint_t i = 1; i < n_args; i++) {
         mp_obj_t other = args[i];
         if (self == other) {
             set_clear(self);
+        } else if (is_set_or_frozenset(other) && ((mp_obj_set_t*)other)->set.used > self->set.used) {
+            // fewer probes to check each element of this set in the other
+            set_filter_by(&self->set, &((mp_obj_set_t*)other)->set, false);
         } else {
             mp_obj_t iter = mp_getiter(other);
             mp_obj_t next;
@@ -283,6 +321,32 @@ STATIC mp_obj_t set_intersect_int(mp_obj_t self_in, mp_obj_t other, bool update)
     }
 
     mp_obj_set_t *self = self_in;
+
+    if (is_set_or_frozenset(other)) {
+        mp_set_t *other_set = &((mp_obj_set_t*)other)->set;
+        if (update) {
+            // drop in place the elements that are not in the other set
+            set_filter_by(&self->set, other_set, true);
+            return mp_const_none;
+        }
+        // walk the smaller set and probe the bigger one
+        mp_set_t *small = &self->set;
+        mp_set_t *big = other_set;
+        if (small->used > big->used) {
+            small = other_set;
+            big = &self->set;
+        }
+        mp_obj_set_t *out = mp_obj_new_set(0, NULL);
+        mp_set_reserve(&out->set, small->used);
+        for (mp_uint_t pos = 0; pos < small->alloc; pos++) {
+            if (MP_SET_SLOT_IS_FILLED(small, pos) && mp_set_lookup(big, small->table[pos], MP_MAP_LOOKUP)) {
+                mp_set_lookup(&out->set, small->table[pos], MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+            }
+        }
+        out->base.type = self->base.type;
+        return out;
+    }
+
     mp_obj_set_t *out = mp_obj_new_set(0, NULL);
 
     mp_obj_t iter = mp_getiter(other);
@@ -317,6 +381,13 @@ STATIC mp_obj_t set_isdisjoint(mp_obj_t self_in, mp_obj_t other) {
     check_set_or_frozenset(self_in);
     mp_obj_set_t *self = self_in;
 
+    // walk the smaller of two sets and probe the other
+    if (is_set_or_frozenset(other) && ((mp_obj_set_t*)other)->set.used > self->set.used) {
+        mp_obj_t tmp = other;
+        other = self;
+        self = tmp;
+    }
+
     mp_obj_t iter = mp_getiter(other);
     mp_obj_t next;
     while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
@@ -347,7 +418,8 @@ STATIC mp_obj_t set_issubset_internal(mp_obj_t self_in, mp_obj_t other_in, bool
         cleanup_other = true;
     }
     bool out = true;
-    if (proper && self->set.used == other->set.used) {
+    if (self->set.used > other->set.used || (proper && self->set.used == other->set.used)) {
+        // too big to be a subset, no need to look at the elements
         out = false;
     } else {
         mp_obj_t iter = set_getiter(self);
@@ -443,6 +515,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(set_symmetric_difference_obj, set_symmetric_dif
 
 STATIC void set_update_int(mp_obj_set_t *self, mp_obj_t other_in) {
     mp_obj_t iter = mp_getiter(other_in);
+    mp_int_t len = mp_obj_len_hint(iter);
+    if (len > 0) {
+        mp_set_reserve(&self->set, len);
+    }
     mp_obj_t next;
     while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
         mp_set_lookup(&self->set, next, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
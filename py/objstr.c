@@ -34,12 +34,16 @@
 #include "py/objlist.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, mp_uint_t n_args, const mp_obj_t *args, mp_obj_t dict);
 
 mp_obj_t mp_obj_new_str_iterator(mp_obj_t str);
 STATIC mp_obj_t mp_obj_new_bytes_iterator(mp_obj_t str);
 STATIC NORETURN void bad_implicit_conversion(mp_obj_t self_in);
+#if MICROPY_OPT_STR_VIEW
+STATIC mp_obj_str_t *str_new_view(const mp_obj_type_t *type, mp_obj_t parent, const byte *data, mp_uint_t len);
+#endif
 
 /******************************************************************************/
 /* str                                                                        */
@@ -142,9 +146,8 @@ mp_obj_t mp_obj_str_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
             return MP_OBJ_NEW_QSTR(MP_QSTR_);
 
         case 1: {
-            vstr_t vstr;
-            mp_print_t print;
-            vstr_init_print(&vstr, 16, &print);
+            VSTR_SMALL(vstr);
+            mp_print_t print = {&vstr, (mp_print_strn_t)vstr_add_strn};
             mp_obj_print_helper(&print, args[0], PRINT_STR);
             return mp_obj_new_str_from_vstr(type_in, &vstr);
         }
@@ -154,8 +157,13 @@ mp_obj_t mp_obj_str_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
             if (MP_OBJ_IS_TYPE(args[0], &mp_type_bytes)) {
                 GET_STR_DATA_LEN(args[0], str_data, str_len);
                 GET_STR_HASH(args[0], str_hash);
+                #if MICROPY_OPT_STR_VIEW
+                // args[0] may itself be a view, so hold on to it
+                mp_obj_str_t *o = str_new_view(type_in, args[0], str_data, str_len);
+                #else
                 mp_obj_str_t *o = mp_obj_new_str_of_type(type_in, NULL, str_len);
                 o->data = str_data;
+                #endif
                 o->hash = str_hash;
                 return o;
             } else {
@@ -185,8 +193,12 @@ STATIC mp_obj_t bytes_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_k
         }
         GET_STR_DATA_LEN(args[0], str_data, str_len);
         GET_STR_HASH(args[0], str_hash);
+        #if MICROPY_OPT_STR_VIEW
+        mp_obj_str_t *o = str_new_view(&mp_type_bytes, args[0], str_data, str_len);
+        #else
         mp_obj_str_t *o = mp_obj_new_str_of_type(&mp_type_bytes, NULL, str_len);
         o->data = str_data;
+        #endif
         o->hash = str_hash;
         return o;
     }
@@ -210,15 +222,29 @@ STATIC mp_obj_t bytes_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_k
     }
 
     vstr_t vstr;
-    // Try to create array of exact len if initializer len is known
-    mp_obj_t len_in = mp_obj_len_maybe(args[0]);
-    if (len_in == MP_OBJ_NULL) {
-        vstr_init(&vstr, 16);
-    } else {
-        mp_int_t len = MP_OBJ_SMALL_INT_VALUE(len_in);
-        vstr_init(&vstr, len);
+    if (MP_OBJ_IS_TYPE(args[0], &mp_type_list) || MP_OBJ_IS_TYPE(args[0], &mp_type_tuple)) {
+        // fill directly from the items, no iterator needed
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(args[0], &len, &items);
+        vstr_init_len(&vstr, len);
+        byte *dest = (byte*)vstr.buf;
+        for (mp_uint_t i = 0; i < len; i++) {
+            mp_int_t val = MP_OBJ_IS_SMALL_INT(items[i]) ? MP_OBJ_SMALL_INT_VALUE(items[i]) : mp_obj_get_int(items[i]);
+            #if MICROPY_CPYTHON_COMPAT
+            if (val < 0 || val > 255) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bytes value out of range"));
+            }
+            #endif
+            dest[i] = val;
+        }
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
     }
 
+    // Try to create array of exact len if initializer len is known
+    mp_int_t len = mp_obj_len_hint(args[0]);
+    vstr_init(&vstr, len < 0 ? 16 : len);
+
     mp_obj_t iterable = mp_getiter(args[0]);
     mp_obj_t item;
     while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
@@ -237,28 +263,59 @@ wrong_args:
     nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "wrong number of arguments"));
 }
 
+// Horspool search, for long needles: the window is moved along by how far the
+// byte under its last position is from that byte's last occurrence in the
+// needle.  Shifts are capped at 255 so the table fits in 256 bytes.
+STATIC const byte *find_subbytes_horspool(const byte *haystack, mp_uint_t hlen, const byte *needle, mp_uint_t nlen) {
+    byte skip[256];
+    mp_uint_t max_skip = nlen < 255 ? nlen : 255;
+    memset(skip, max_skip, sizeof(skip));
+    for (mp_uint_t i = nlen - max_skip; i < nlen - 1; i++) {
+        skip[needle[i]] = nlen - 1 - i;
+    }
+    byte last = needle[nlen - 1];
+    for (const byte *p = haystack, *top = haystack + hlen - nlen; p <= top;) {
+        byte c = p[nlen - 1];
+        if (c == last && memcmp(p, needle, nlen - 1) == 0) {
+            return p;
+        }
+        p += skip[c];
+    }
+    return NULL;
+}
+
 // like strstr but with specified length and allows \0 bytes
-// TODO replace with something more efficient/standard
 STATIC const byte *find_subbytes(const byte *haystack, mp_uint_t hlen, const byte *needle, mp_uint_t nlen, mp_int_t direction) {
-    if (hlen >= nlen) {
-        mp_uint_t str_index, str_index_end;
-        if (direction > 0) {
-            str_index = 0;
-            str_index_end = hlen - nlen;
-        } else {
-            str_index = hlen - nlen;
-            str_index_end = 0;
+    if (hlen < nlen) {
+        return NULL;
+    }
+    if (nlen == 0) {
+        return direction > 0 ? haystack : haystack + hlen;
+    }
+    if (direction > 0) {
+        if (nlen >= 4 && hlen >= 64) {
+            return find_subbytes_horspool(haystack, hlen, needle, nlen);
+        }
+        // find candidates with memchr, which libc implementations optimise
+        // to scan a word or vector at a time
+        const byte *top = haystack + hlen - nlen;
+        for (const byte *p = haystack; p <= top; p++) {
+            p = memchr(p, needle[0], top - p + 1);
+            if (p == NULL) {
+                break;
+            }
+            if (memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
+            }
         }
-        for (;;) {
-            if (memcmp(&haystack[str_index], needle, nlen) == 0) {
-                //found
-                return haystack + str_index;
+    } else {
+        for (const byte *p = haystack + hlen - nlen;; p--) {
+            if (*p == needle[0] && memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
             }
-            if (str_index == str_index_end) {
-                //not found
+            if (p == haystack) {
                 break;
             }
-            str_index += direction;
         }
     }
     return NULL;
@@ -267,6 +324,42 @@ STATIC const byte *find_subbytes(const byte *haystack, mp_uint_t hlen, const byt
 // Note: this function is used to check if an object is a str or bytes, which
 // works because both those types use it as their binary_op method.  Revisit
 // MP_OBJ_IS_STR_OR_BYTES if this fact changes.
+#if MICROPY_OPT_STR_INPLACE_ADD
+// Makes lhs + rhs in a buffer with room to spare.  If lhs is the last string
+// put in that buffer then rhs is appended in place, and the result shares the
+// buffer with lhs.  lhs keeps its length so its value doesn't change, but its
+// null terminator is overwritten (see mp_obj_str_get_str).
+STATIC mp_obj_t str_inplace_add(const mp_obj_type_t *type, mp_obj_str_t *lhs, const byte *rhs_data, mp_uint_t rhs_len) {
+    mp_uint_t len = lhs->len + rhs_len;
+    byte *buf = MP_STATE_VM(str_add_buf);
+    byte *data;
+    // lhs->data must be the start of the buffer, because a view of the last
+    // string can also end at the used mark
+    if (buf != NULL && lhs->data == buf && lhs->len == MP_STATE_VM(str_add_used)
+        && MP_STATE_VM(str_add_used) + rhs_len < MP_STATE_VM(str_add_alloc)) {
+        data = (byte*)lhs->data;
+    } else {
+        // start a new buffer; doubling its size each time keeps it linear
+        mp_uint_t alloc = 2 * len + 1;
+        buf = m_new(byte, alloc);
+        memcpy(buf, lhs->data, lhs->len);
+        MP_STATE_VM(str_add_buf) = buf;
+        MP_STATE_VM(str_add_alloc) = alloc;
+        data = buf;
+    }
+    memcpy(data + lhs->len, rhs_data, rhs_len);
+    data[len] = '\0';
+    MP_STATE_VM(str_add_used) = len;
+
+    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+    o->base.type = type;
+    o->hash = 0;
+    o->len = len;
+    o->data = data;
+    return o;
+}
+#endif
+
 mp_obj_t mp_obj_str_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     // check for modulo
     if (op == MP_BINARY_OP_MODULO) {
@@ -344,8 +437,14 @@ mp_obj_t mp_obj_str_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     }
 
     switch (op) {
-        case MP_BINARY_OP_ADD:
-        case MP_BINARY_OP_INPLACE_ADD: {
+        case MP_BINARY_OP_INPLACE_ADD:
+            #if MICROPY_OPT_STR_INPLACE_ADD
+            if (!MP_OBJ_IS_QSTR(lhs_in) && rhs_len > 0) {
+                return str_inplace_add(lhs_type, lhs_in, rhs_data, rhs_len);
+            }
+            #endif
+            // fall through
+        case MP_BINARY_OP_ADD: {
             vstr_t vstr;
             vstr_init_len(&vstr, lhs_len + rhs_len);
             memcpy(vstr.buf, lhs_data, lhs_len);
@@ -371,9 +470,9 @@ mp_obj_t mp_obj_str_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
 
 #if !MICROPY_PY_BUILTINS_STR_UNICODE
 // objstrunicode defines own version
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, mp_uint_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len,
                              mp_obj_t index, bool is_slice) {
-    mp_uint_t index_val = mp_get_index(type, self_len, index, is_slice);
+    mp_uint_t index_val = mp_get_index(mp_obj_get_type(self_in), self_len, index, is_slice);
     return self_data + index_val;
 }
 #endif
@@ -391,7 +490,7 @@ STATIC mp_obj_t bytes_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
                 nlr_raise(mp_obj_new_exception_msg(&mp_type_NotImplementedError,
                     "only slices with step=1 (aka None) are supported"));
             }
-            return mp_obj_new_str_of_type(type, self_data + slice.start, slice.stop - slice.start);
+            return mp_obj_new_str_sub(type, self_in, self_data + slice.start, slice.stop - slice.start);
         }
 #endif
         mp_uint_t index_val = mp_get_index(type, self_len, index, false);
@@ -484,7 +583,7 @@ STATIC inline mp_obj_t str_split_internal(mp_uint_t n_args, const mp_obj_t *args
         while (s < top && splits != 0) {
             const byte *start = s;
             while (s < top && !unichar_isspace(*s)) s++;
-            mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, s - start));
+            mp_obj_list_append(res, mp_obj_new_str_sub(self_type, args[0], start, s - start));
             if (s >= top) {
                 break;
             }
@@ -495,7 +594,7 @@ STATIC inline mp_obj_t str_split_internal(mp_uint_t n_args, const mp_obj_t *args
         }
 
         if (s < top) {
-            mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, s, top - s));
+            mp_obj_list_append(res, mp_obj_new_str_sub(self_type, args[0], s, top - s));
         }
 
     } else {
@@ -513,21 +612,15 @@ STATIC inline mp_obj_t str_split_internal(mp_uint_t n_args, const mp_obj_t *args
 
         for (;;) {
             const byte *start = s;
-            for (;;) {
-                if (splits == 0 || s + sep_len > top) {
-                    s = top;
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s++;
+            if (splits == 0 || (s = find_subbytes(s, top - s, (const byte*)sep_str, sep_len, 1)) == NULL) {
+                s = top;
             }
             mp_uint_t sub_len = s - start;
             if (MP_LIKELY(!(sub_len == 0 && s == top && (type && SPLITLINES)))) {
                 if (start + sub_len != top && (type & KEEP)) {
                     sub_len++;
                 }
-                mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, sub_len));
+                mp_obj_list_append(res, mp_obj_new_str_sub(self_type, args[0], start, sub_len));
             }
             if (s >= top) {
                 break;
@@ -601,10 +694,10 @@ STATIC mp_obj_t str_rsplit(mp_uint_t n_args, const mp_obj_t *args) {
                 s--;
             }
             if (s < beg || splits == 0) {
-                res->items[idx] = mp_obj_new_str_of_type(self_type, beg, last - beg);
+                res->items[idx] = mp_obj_new_str_sub(self_type, args[0], beg, last - beg);
                 break;
             }
-            res->items[idx--] = mp_obj_new_str_of_type(self_type, s + sep_len, last - s - sep_len);
+            res->items[idx--] = mp_obj_new_str_sub(self_type, args[0], s + sep_len, last - s - sep_len);
             last = s;
             if (splits > 0) {
                 splits--;
@@ -638,10 +731,10 @@ STATIC mp_obj_t str_finder(mp_uint_t n_args, const mp_obj_t *args, mp_int_t dire
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(args[0], haystack, haystack_len, args[3], true);
     }
 
     const byte *p = find_subbytes(start, end - start, needle, needle_len, direction);
@@ -656,7 +749,7 @@ STATIC mp_obj_t str_finder(mp_uint_t n_args, const mp_obj_t *args, mp_int_t dire
         // found
         #if MICROPY_PY_BUILTINS_STR_UNICODE
         if (self_type == &mp_type_str) {
-            return MP_OBJ_NEW_SMALL_INT(utf8_ptr_to_index(haystack, p));
+            return MP_OBJ_NEW_SMALL_INT(str_ptr_to_index(args[0], haystack, haystack_len, p));
         }
         #endif
         return MP_OBJ_NEW_SMALL_INT(p - haystack);
@@ -681,12 +774,11 @@ STATIC mp_obj_t str_rindex(mp_uint_t n_args, const mp_obj_t *args) {
 
 // TODO: (Much) more variety in args
 STATIC mp_obj_t str_startswith(mp_uint_t n_args, const mp_obj_t *args) {
-    const mp_obj_type_t *self_type = mp_obj_get_type(args[0]);
     GET_STR_DATA_LEN(args[0], str, str_len);
     GET_STR_DATA_LEN(args[1], prefix, prefix_len);
     const byte *start = str;
     if (n_args > 2) {
-        start = str_index_to_ptr(self_type, str, str_len, args[2], true);
+        start = str_index_to_ptr(args[0], str, str_len, args[2], true);
     }
     if (prefix_len + (start - str) > str_len) {
         return mp_const_false;
@@ -776,7 +868,7 @@ STATIC mp_obj_t str_uni_strip(int type, mp_uint_t n_args, const mp_obj_t *args)
         assert(first_good_char_pos == 0);
         return args[0];
     }
-    return mp_obj_new_str_of_type(self_type, orig_str + first_good_char_pos, stripped_len);
+    return mp_obj_new_str_sub(self_type, args[0], orig_str + first_good_char_pos, stripped_len);
 }
 
 STATIC mp_obj_t str_strip(mp_uint_t n_args, const mp_obj_t *args) {
@@ -821,14 +913,14 @@ STATIC bool arg_looks_integer(mp_obj_t arg) {
 STATIC bool arg_looks_numeric(mp_obj_t arg) {
     return arg_looks_integer(arg)
 #if MICROPY_PY_BUILTINS_FLOAT
-        || MP_OBJ_IS_TYPE(arg, &mp_type_float)
+        || mp_obj_is_float(arg)
 #endif
     ;
 }
 
 STATIC mp_obj_t arg_as_int(mp_obj_t arg) {
 #if MICROPY_PY_BUILTINS_FLOAT
-    if (MP_OBJ_IS_TYPE(arg, &mp_type_float)) {
+    if (mp_obj_is_float(arg)) {
         return mp_obj_new_int_from_float(mp_obj_get_float(arg));
     }
 #endif
@@ -846,9 +938,19 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
     int arg_i = 0;
     vstr_t vstr;
     mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    // the result is usually a little longer than the format string
+    vstr_init_print(&vstr, len + 16, &print);
 
     for (const byte *top = str + len; str < top; str++) {
+        // copy literal text up to the next brace in one go
+        const byte *lit = str;
+        while (str < top && *str != '{' && *str != '}') {
+            str++;
+        }
+        vstr_add_strn(&vstr, (const char*)lit, str - lit);
+        if (str >= top) {
+            break;
+        }
         if (*str == '}') {
             str++;
             if (str < top && *str == '}') {
@@ -862,10 +964,6 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
                     "single '}' encountered in format string"));
             }
         }
-        if (*str != '{') {
-            vstr_add_char(&vstr, *str);
-            continue;
-        }
 
         str++;
         if (str < top && *str == '{') {
@@ -875,16 +973,14 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
 
         // replacement_field ::=  "{" [field_name] ["!" conversion] [":" format_spec] "}"
 
-        vstr_t *field_name = NULL;
+        const char *field = (const char*)str;
         char conversion = '\0';
         vstr_t *format_spec = NULL;
 
-        if (str < top && *str != '}' && *str != '!' && *str != ':') {
-            field_name = vstr_new();
-            while (str < top && *str != '}' && *str != '!' && *str != ':') {
-                vstr_add_char(field_name, *str++);
-            }
+        while (str < top && *str != '}' && *str != '!' && *str != ':') {
+            str++;
         }
+        const char *field_top = (const char*)str;
 
         // conversion ::=  "r" | "s"
 
@@ -935,9 +1031,8 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
 
         mp_obj_t arg = mp_const_none;
 
-        if (field_name) {
+        if (field < field_top) {
             int index = 0;
-            const char *field = vstr_null_terminated_str(field_name);
             const char *lookup = NULL;
             if (MP_LIKELY(unichar_isdigit(*field))) {
                 if (arg_i > 0) {
@@ -955,7 +1050,7 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
                 arg = args[index + 1];
                 arg_i = -1;
             } else {
-                for (lookup = field; *lookup && *lookup != '.' && *lookup != '['; lookup++);
+                for (lookup = field; lookup < field_top && *lookup != '.' && *lookup != '['; lookup++);
                 mp_obj_t field_q = mp_obj_new_str(field, lookup - field, true/*?*/);
                 mp_map_elem_t *key_elem = mp_map_lookup(kwargs, field_q, MP_MAP_LOOKUP);
                 if (key_elem == NULL) {
@@ -963,11 +1058,9 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
                 }
                 arg = key_elem->value;
             }
-            if (*lookup) {
+            if (lookup < field_top) {
                 nlr_raise(mp_obj_new_exception_msg(&mp_type_NotImplementedError, "attributes not supported yet"));
             }
-            vstr_free(field_name);
-            field_name = NULL;
         } else {
             if (arg_i < 0) {
                 if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
@@ -1000,9 +1093,13 @@ mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwa
                         "unknown conversion specifier %c", conversion));
                 }
             }
-            vstr_t arg_vstr;
-            mp_print_t arg_print;
-            vstr_init_print(&arg_vstr, 16, &arg_print);
+            if (!format_spec) {
+                // nothing to pad or align, so print straight into the result
+                mp_obj_print_helper(&print, arg, print_kind);
+                continue;
+            }
+            VSTR_SMALL(arg_vstr);
+            mp_print_t arg_print = {&arg_vstr, (mp_print_strn_t)vstr_add_strn};
             mp_obj_print_helper(&arg_print, arg, print_kind);
             arg = mp_obj_new_str_from_vstr(&mp_type_str, &arg_vstr);
         }
@@ -1287,13 +1384,19 @@ STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, mp_uint_t n_args, const mp_o
     int arg_i = 0;
     vstr_t vstr;
     mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    // the result is usually a little longer than the format string
+    vstr_init_print(&vstr, len + 16, &print);
 
     for (const byte *top = str + len; str < top; str++) {
         mp_obj_t arg = MP_OBJ_NULL;
-        if (*str != '%') {
-            vstr_add_char(&vstr, *str);
-            continue;
+        // copy literal text up to the next % in one go
+        const byte *lit = str;
+        while (str < top && *str != '%') {
+            str++;
+        }
+        vstr_add_strn(&vstr, (const char*)lit, str - lit);
+        if (str >= top) {
+            break;
         }
         if (++str >= top) {
             break;
@@ -1428,9 +1531,13 @@ not_enough_args:
             case 'r':
             case 's':
             {
-                vstr_t arg_vstr;
-                mp_print_t arg_print;
-                vstr_init_print(&arg_vstr, 16, &arg_print);
+                if (prec < 0 && width == 0) {
+                    // nothing to truncate or pad, so print straight into the result
+                    mp_obj_print_helper(&print, arg, *str == 'r' ? PRINT_REPR : PRINT_STR);
+                    break;
+                }
+                VSTR_SMALL(arg_vstr);
+                mp_print_t arg_print = {&arg_vstr, (mp_print_strn_t)vstr_add_strn};
                 mp_obj_print_helper(&arg_print, arg, *str == 'r' ? PRINT_REPR : PRINT_STR);
                 uint vlen = arg_vstr.len;
                 if (prec < 0) {
@@ -1588,10 +1695,10 @@ STATIC mp_obj_t str_count(mp_uint_t n_args, const mp_obj_t *args) {
     const byte *start = haystack;
     const byte *end = haystack + haystack_len;
     if (n_args >= 3 && args[2] != mp_const_none) {
-        start = str_index_to_ptr(self_type, haystack, haystack_len, args[2], true);
+        start = str_index_to_ptr(args[0], haystack, haystack_len, args[2], true);
     }
     if (n_args >= 4 && args[3] != mp_const_none) {
-        end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
+        end = str_index_to_ptr(args[0], haystack, haystack_len, args[3], true);
     }
 
     // if needle_len is zero then we count each gap between characters as an occurrence
@@ -1601,13 +1708,12 @@ STATIC mp_obj_t str_count(mp_uint_t n_args, const mp_obj_t *args) {
 
     // count the occurrences
     mp_int_t num_occurrences = 0;
-    for (const byte *haystack_ptr = start; haystack_ptr + needle_len <= end;) {
-        if (memcmp(haystack_ptr, needle, needle_len) == 0) {
-            num_occurrences++;
-            haystack_ptr += needle_len;
-        } else {
-            haystack_ptr = utf8_next_char(haystack_ptr);
-        }
+    // a match can't start in the middle of a utf-8 char, since the needle
+    // starts with a whole char
+    for (const byte *haystack_ptr = start; haystack_ptr + needle_len <= end
+        && (haystack_ptr = find_subbytes(haystack_ptr, end - haystack_ptr, needle, needle_len, 1)) != NULL;) {
+        num_occurrences++;
+        haystack_ptr += needle_len;
     }
 
     return MP_OBJ_NEW_SMALL_INT(num_occurrences);
@@ -1647,9 +1753,9 @@ STATIC mp_obj_t str_partitioner(mp_obj_t self_in, mp_obj_t arg, mp_int_t directi
     const byte *position_ptr = find_subbytes(str, str_len, sep, sep_len, direction);
     if (position_ptr != NULL) {
         mp_uint_t position = position_ptr - str;
-        result[0] = mp_obj_new_str_of_type(self_type, str, position);
+        result[0] = mp_obj_new_str_sub(self_type, self_in, str, position);
         result[1] = arg;
-        result[2] = mp_obj_new_str_of_type(self_type, str + position + sep_len, str_len - position - sep_len);
+        result[2] = mp_obj_new_str_sub(self_type, self_in, str + position + sep_len, str_len - position - sep_len);
     }
 
     return mp_obj_new_tuple(3, result);
@@ -1891,8 +1997,11 @@ mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte* data, mp_
     mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
     o->base.type = type;
     o->len = len;
+    o->hash = 0;
     if (data) {
+        #if !MICROPY_OPT_CACHE_HASH
         o->hash = qstr_compute_hash(data, len);
+        #endif
         byte *p = m_new(byte, len + 1);
         o->data = p;
         memcpy(p, data, len * sizeof(byte));
@@ -1901,6 +2010,46 @@ mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte* data, mp_
     return o;
 }
 
+#if MICROPY_OPT_STR_VIEW
+// A view is a str/bytes object whose data points into the data of another
+// str/bytes object.  The GC only follows pointers to the start of a block, so
+// the view also holds the parent object itself to keep the data alive.  To the
+// rest of the runtime a view is just an mp_obj_str_t; the only difference is
+// that its data may not be followed by a null byte (see mp_obj_str_get_str).
+typedef struct _mp_obj_str_view_t {
+    mp_obj_str_t str;
+    mp_obj_t parent;
+} mp_obj_str_view_t;
+
+STATIC mp_obj_str_t *str_new_view(const mp_obj_type_t *type, mp_obj_t parent, const byte *data, mp_uint_t len) {
+    mp_obj_str_view_t *o = m_new_obj(mp_obj_str_view_t);
+    o->str.base.type = type;
+    o->str.len = len;
+    #if MICROPY_OPT_CACHE_HASH
+    o->str.hash = 0;
+    #else
+    o->str.hash = qstr_compute_hash(data, len);
+    #endif
+    o->str.data = data;
+    o->parent = parent;
+    return &o->str;
+}
+#endif
+
+// Create a str/bytes object holding len bytes at data, which lie within the
+// data of the str/bytes object parent.  Long results share the parent's data
+// when MICROPY_OPT_STR_VIEW is enabled, others are copied.
+mp_obj_t mp_obj_new_str_sub(const mp_obj_type_t *type, mp_obj_t parent, const byte* data, mp_uint_t len) {
+    #if MICROPY_OPT_STR_VIEW
+    if (len >= MICROPY_OPT_STR_VIEW_MIN_LEN) {
+        return str_new_view(type, parent, data, len);
+    }
+    #else
+    (void)parent;
+    #endif
+    return mp_obj_new_str_of_type(type, data, len);
+}
+
 // Create a str/bytes object from the given vstr.  The vstr buffer is resized to
 // the exact length required and then reused for the str/bytes object.  The vstr
 // is cleared and can safely be passed to vstr_free if it was heap allocated.
@@ -1919,8 +2068,19 @@ mp_obj_t mp_obj_new_str_from_vstr(const mp_obj_type_t *type, vstr_t *vstr) {
     mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
     o->base.type = type;
     o->len = vstr->len;
+    #if MICROPY_OPT_CACHE_HASH
+    o->hash = 0;
+    #else
     o->hash = qstr_compute_hash((byte*)vstr->buf, vstr->len);
-    o->data = (byte*)m_renew(char, vstr->buf, vstr->alloc, vstr->len + 1);
+    #endif
+    if (vstr->small_buf) {
+        // the data is still in the vstr's stack buffer so copy it out
+        byte *p = m_new(byte, vstr->len + 1);
+        memcpy(p, vstr->buf, vstr->len);
+        o->data = p;
+    } else {
+        o->data = (byte*)m_renew(char, vstr->buf, vstr->alloc, vstr->len + 1);
+    }
     ((byte*)o->data)[o->len] = '\0'; // add null byte
     vstr->buf = NULL;
     vstr->alloc = 0;
@@ -1986,6 +2146,16 @@ mp_uint_t mp_obj_str_get_hash(mp_obj_t self_in) {
     // TODO: This has too big overhead for hash accessor
     if (MP_OBJ_IS_STR_OR_BYTES(self_in)) {
         GET_STR_HASH(self_in, h);
+        if (h == 0) {
+            // hash not computed yet (or a const object that was never hashed)
+            mp_obj_str_t *self = self_in;
+            h = qstr_compute_hash(self->data, self->len);
+            #if MICROPY_OPT_CACHE_HASH
+            if (gc_nbytes(self) != 0) {
+                self->hash = h;
+            }
+            #endif
+        }
         return h;
     } else {
         bad_implicit_conversion(self_in);
@@ -2020,7 +2190,18 @@ qstr mp_obj_str_get_qstr(mp_obj_t self_in) {
 const char *mp_obj_str_get_str(mp_obj_t self_in) {
     if (MP_OBJ_IS_STR_OR_BYTES(self_in)) {
         GET_STR_DATA_LEN(self_in, s, l);
+        #if MICROPY_OPT_STR_INPLACE_ADD || MICROPY_OPT_STR_VIEW
+        if (s[l] != '\0') {
+            // an in-place add overwrote the null terminator, or this is a view
+            // that ends before its parent does, so make a copy
+            char *p = m_new(char, l + 1);
+            memcpy(p, s, l);
+            p[l] = '\0';
+            return p;
+        }
+        #else
         (void)l; // len unused
+        #endif
         return (const char*)s;
     } else {
         bad_implicit_conversion(self_in);
@@ -59,12 +59,16 @@ void mp_str_print_json(const mp_print_t *print, const byte *str_data, mp_uint_t
 mp_obj_t mp_obj_str_format(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kwargs);
 mp_obj_t mp_obj_str_split(mp_uint_t n_args, const mp_obj_t *args);
 mp_obj_t mp_obj_new_str_of_type(const mp_obj_type_t *type, const byte* data, mp_uint_t len);
+mp_obj_t mp_obj_new_str_sub(const mp_obj_type_t *type, mp_obj_t parent, const byte* data, mp_uint_t len);
 
 mp_obj_t mp_obj_str_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in);
 mp_int_t mp_obj_str_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags);
 
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, mp_uint_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len,
                              mp_obj_t index, bool is_slice);
+#if MICROPY_PY_BUILTINS_STR_UNICODE
+mp_uint_t str_ptr_to_index(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len, const byte *ptr);
+#endif
 
 MP_DECLARE_CONST_FUN_OBJ(str_encode_obj);
 MP_DECLARE_CONST_FUN_OBJ(str_find_obj);
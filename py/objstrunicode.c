@@ -29,6 +29,7 @@
 #include <assert.h>
 
 #include "py/nlr.h"
+#include "py/unicode.h"
 #include "py/objstr.h"
 #include "py/objlist.h"
 #include "py/runtime0.h"
@@ -100,13 +101,69 @@ STATIC void uni_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     }
 }
 
+#if MICROPY_OPT_STR_INDEX_CACHE
+// The index cache remembers the last str indexed, its length in characters
+// and a checkpoint: the byte offset of one of its characters.  Lookups walk
+// from whichever of the start, the checkpoint and the end is nearest and then
+// move the checkpoint there, so stepping through a str is O(1) per character.
+// A str whose character length equals its byte length is ASCII and needs no
+// walking at all.  The str is a root pointer, so while it's cached it can't be
+// freed and its address reused by another str.
+STATIC mp_uint_t str_index_cache_load(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len) {
+    if (MP_STATE_VM(str_index_obj) != self_in || MP_STATE_VM(str_index_data) != self_data) {
+        MP_STATE_VM(str_index_obj) = self_in;
+        MP_STATE_VM(str_index_data) = self_data;
+        MP_STATE_VM(str_index_charlen) = unichar_charlen((const char*)self_data, self_len);
+        MP_STATE_VM(str_index_char) = 0;
+        MP_STATE_VM(str_index_byte) = 0;
+    }
+    return MP_STATE_VM(str_index_charlen);
+}
+
+// Returns a pointer to character i of the cached str, where i <= its length.
+STATIC const byte *str_index_cache_lookup(const byte *self_data, mp_uint_t self_len, mp_uint_t i) {
+    mp_uint_t charlen = MP_STATE_VM(str_index_charlen);
+    if (charlen == self_len) {
+        return self_data + i;
+    }
+    const byte *top = self_data + self_len;
+    mp_uint_t c = MP_STATE_VM(str_index_char);
+    const byte *s = self_data + MP_STATE_VM(str_index_byte);
+    if (i < c && i < c - i) {
+        c = 0;
+        s = self_data;
+    } else if (i > c && charlen - i < i - c) {
+        c = charlen;
+        s = top;
+    }
+    for (; c < i; ++c) {
+        ++s;
+        while (s < top && UTF8_IS_CONT(*s)) {
+            ++s;
+        }
+    }
+    for (; c > i; --c) {
+        do {
+            --s;
+        } while (UTF8_IS_CONT(*s));
+    }
+    MP_STATE_VM(str_index_char) = c;
+    MP_STATE_VM(str_index_byte) = s - self_data;
+    return s;
+}
+#endif
+
 STATIC mp_obj_t uni_unary_op(mp_uint_t op, mp_obj_t self_in) {
     GET_STR_DATA_LEN(self_in, str_data, str_len);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return MP_BOOL(str_len != 0);
         case MP_UNARY_OP_LEN:
+            #if MICROPY_OPT_STR_INDEX_CACHE
+            return MP_OBJ_NEW_SMALL_INT(str_index_cache_load(self_in, str_data, str_len));
+            #else
             return MP_OBJ_NEW_SMALL_INT(unichar_charlen((const char *)str_data, str_len));
+            #endif
         default:
             return MP_OBJ_NULL; // op not supported
     }
@@ -114,9 +171,8 @@ STATIC mp_obj_t uni_unary_op(mp_uint_t op, mp_obj_t self_in) {
 
 // Convert an index into a pointer to its lead byte. Out of bounds indexing will raise IndexError or
 // be capped to the first/last character of the string, depending on is_slice.
-const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, mp_uint_t self_len,
+const byte *str_index_to_ptr(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len,
                              mp_obj_t index, bool is_slice) {
-    (void)type;
     mp_int_t i;
     // Copied from mp_get_index; I don't want bounds checking, just give me
     // the integer as-is. (I can't bounds-check without scanning the whole
@@ -126,6 +182,23 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, m
     } else if (!mp_obj_get_int_maybe(index, &i)) {
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError, "string indices must be integers, not %s", mp_obj_get_type_str(index)));
     }
+    if (!i) {
+        return self_data; // Shortcut - str[0] is its base pointer
+    }
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    mp_int_t charlen = str_index_cache_load(self_in, self_data, self_len);
+    if (i < 0) {
+        i += charlen;
+    }
+    if (i < 0 || i >= charlen) {
+        if (!is_slice) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_IndexError, "string index out of range"));
+        }
+        i = i < 0 ? 0 : charlen;
+    }
+    return str_index_cache_lookup(self_data, self_len, i);
+    #else
+    (void)self_in;
     const byte *s, *top = self_data + self_len;
     if (i < 0)
     {
@@ -142,8 +215,6 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, m
             }
         }
         ++s;
-    } else if (!i) {
-        return self_data; // Shortcut - str[0] is its base pointer
     } else {
         // Positive indexing, correspondingly, counts from the start of the string.
         // It's assumed that negative indexing will generally be used with small
@@ -165,6 +236,30 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, m
         }
     }
     return s;
+    #endif
+}
+
+// Convert a pointer to a lead byte into the index of its character.
+mp_uint_t str_ptr_to_index(mp_obj_t self_in, const byte *self_data, mp_uint_t self_len, const byte *ptr) {
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    if (str_index_cache_load(self_in, self_data, self_len) == self_len) {
+        return ptr - self_data;
+    }
+    mp_uint_t c = 0;
+    const byte *s = self_data;
+    if (ptr >= self_data + MP_STATE_VM(str_index_byte)) {
+        c = MP_STATE_VM(str_index_char);
+        s += MP_STATE_VM(str_index_byte);
+    }
+    c += utf8_ptr_to_index(s, ptr);
+    MP_STATE_VM(str_index_char) = c;
+    MP_STATE_VM(str_index_byte) = ptr - self_data;
+    return c;
+    #else
+    (void)self_in;
+    (void)self_len;
+    return utf8_ptr_to_index(self_data, ptr);
+    #endif
 }
 
 STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
@@ -184,24 +279,24 @@ STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
 
             const byte *pstart, *pstop;
             if (ostart != mp_const_none) {
-                pstart = str_index_to_ptr(type, self_data, self_len, ostart, true);
+                pstart = str_index_to_ptr(self_in, self_data, self_len, ostart, true);
             } else {
                 pstart = self_data;
             }
             if (ostop != mp_const_none) {
                 // pstop will point just after the stop character. This depends on
                 // the \0 at the end of the string.
-                pstop = str_index_to_ptr(type, self_data, self_len, ostop, true);
+                pstop = str_index_to_ptr(self_in, self_data, self_len, ostop, true);
             } else {
                 pstop = self_data + self_len;
             }
             if (pstop < pstart) {
                 return MP_OBJ_NEW_QSTR(MP_QSTR_);
             }
-            return mp_obj_new_str_of_type(type, (const byte *)pstart, pstop - pstart);
+            return mp_obj_new_str_sub(type, self_in, (const byte *)pstart, pstop - pstart);
         }
 #endif
-        const byte *s = str_index_to_ptr(type, self_data, self_len, index, false);
+        const byte *s = str_index_to_ptr(self_in, self_data, self_len, index, false);
         int len = 1;
         if (UTF8_IS_NONASCII(*s)) {
             // Count the number of 1 bits (after the first)
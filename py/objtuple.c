@@ -31,6 +31,7 @@
 #include "py/objtuple.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 STATIC mp_obj_t mp_obj_new_tuple_iterator(mp_obj_tuple_t *tuple, mp_uint_t cur);
 
@@ -78,25 +79,35 @@ STATIC mp_obj_t mp_obj_tuple_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uin
                 return args[0];
             }
 
-            // TODO optimise for cases where we know the length of the iterator
-
-            mp_uint_t alloc = 4;
+            // fill the tuple object itself, allocated up front with the
+            // length hint so that iterables of known length need no copy
+            mp_int_t hint = mp_obj_len_hint(args[0]);
+            mp_uint_t alloc = hint > 0 ? hint : 4;
+            mp_obj_tuple_t *tuple = m_new_obj_var(mp_obj_tuple_t, mp_obj_t, alloc);
+            tuple->base.type = &mp_type_tuple;
+            #if MICROPY_OPT_CACHE_HASH
+            tuple->hash = 0;
+            #endif
             mp_uint_t len = 0;
-            mp_obj_t *items = m_new(mp_obj_t, alloc);
 
             mp_obj_t iterable = mp_getiter(args[0]);
             mp_obj_t item;
             while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
                 if (len >= alloc) {
-                    items = m_renew(mp_obj_t, items, alloc, alloc * 2);
+                    tuple = m_renew_obj_var(mp_obj_tuple_t, mp_obj_t, tuple, alloc, alloc * 2);
                     alloc *= 2;
                 }
-                items[len++] = item;
+                tuple->items[len++] = item;
             }
 
-            mp_obj_t tuple = mp_obj_new_tuple(len, items);
-            m_del(mp_obj_t, items, alloc);
-
+            if (len == 0) {
+                m_del_var(mp_obj_tuple_t, mp_obj_t, alloc, tuple);
+                return mp_const_empty_tuple;
+            }
+            if (len < alloc) {
+                tuple = m_renew_obj_var(mp_obj_tuple_t, mp_obj_t, tuple, alloc, len);
+            }
+            tuple->len = len;
             return tuple;
         }
     }
@@ -228,15 +239,23 @@ const mp_obj_type_t mp_type_tuple = {
 };
 
 // the zero-length tuple
-const mp_obj_tuple_t mp_const_empty_tuple_obj = {{&mp_type_tuple}, 0};
+const mp_obj_tuple_t mp_const_empty_tuple_obj = {.base = {&mp_type_tuple}, .len = 0};
 
 mp_obj_t mp_obj_new_tuple(mp_uint_t n, const mp_obj_t *items) {
     if (n == 0) {
         return mp_const_empty_tuple;
     }
-    mp_obj_tuple_t *o = m_new_obj_var(mp_obj_tuple_t, mp_obj_t, n);
+    mp_obj_tuple_t *o;
+    if (n == 2) {
+        o = m_new_obj_var_pooled(mp_obj_tuple_t, mp_obj_t, 2, &mp_type_tuple, MP_OBJ_POOL_TUPLE2);
+    } else {
+        o = m_new_obj_var(mp_obj_tuple_t, mp_obj_t, n);
+    }
     o->base.type = &mp_type_tuple;
     o->len = n;
+    #if MICROPY_OPT_CACHE_HASH
+    o->hash = 0;
+    #endif
     if (items) {
         for (mp_uint_t i = 0; i < n; i++) {
             o->items[i] = items[i];
@@ -261,11 +280,22 @@ void mp_obj_tuple_del(mp_obj_t self_in) {
 mp_int_t mp_obj_tuple_hash(mp_obj_t self_in) {
     assert(MP_OBJ_IS_TYPE(self_in, &mp_type_tuple));
     mp_obj_tuple_t *self = self_in;
+    #if MICROPY_OPT_CACHE_HASH
+    if (self->hash != 0) {
+        return self->hash;
+    }
+    #endif
     // start hash with pointer to empty tuple, to make it fairly unique
     mp_int_t hash = (mp_int_t)mp_const_empty_tuple;
     for (mp_uint_t i = 0; i < self->len; i++) {
         hash += mp_obj_hash(self->items[i]);
     }
+    #if MICROPY_OPT_CACHE_HASH
+    // const tuples may be in ROM so only cache the hash of heap tuples
+    if (gc_nbytes(self) != 0) {
+        self->hash = hash;
+    }
+    #endif
     return hash;
 }
 
@@ -289,9 +319,18 @@ STATIC mp_obj_t tuple_it_iternext(mp_obj_t self_in) {
     }
 }
 
+STATIC mp_obj_t tuple_it_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_tuple_it_t *self = self_in;
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        return MP_OBJ_NEW_SMALL_INT(self->tuple->len - self->cur);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 STATIC const mp_obj_type_t mp_type_tuple_it = {
     { &mp_type_type },
     .name = MP_QSTR_iterator,
+    .unary_op = tuple_it_unary_op,
     .getiter = mp_identity,
     .iternext = tuple_it_iternext,
 };
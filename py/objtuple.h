@@ -31,6 +31,9 @@
 typedef struct _mp_obj_tuple_t {
     mp_obj_base_t base;
     mp_uint_t len;
+    #if MICROPY_OPT_CACHE_HASH
+    mp_uint_t hash; // 0 means not computed yet
+    #endif
     mp_obj_t items[];
 } mp_obj_tuple_t;
 
@@ -51,6 +54,16 @@ extern const mp_obj_type_t mp_type_attrtuple;
 
 #if MICROPY_PY_COLLECTIONS
 void mp_obj_attrtuple_print_helper(const mp_print_t *print, const qstr *fields, mp_obj_tuple_t *o);
+
+typedef struct _mp_obj_namedtuple_type_t {
+    mp_obj_type_t base;
+    mp_uint_t n_fields;
+    qstr fields[];
+} mp_obj_namedtuple_type_t;
+
+// the attr method of all namedtuple types, for the VM to recognise them
+void mp_obj_namedtuple_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
+mp_uint_t mp_obj_namedtuple_find_field(const mp_obj_namedtuple_type_t *type, qstr name);
 #endif
 
 mp_obj_t mp_obj_new_attrtuple(const qstr *fields, mp_uint_t n, const mp_obj_t *items);
@@ -49,6 +49,20 @@ STATIC mp_obj_t static_class_method_make_new(mp_obj_t self_in, mp_uint_t n_args,
 // instance object
 
 STATIC mp_obj_t mp_obj_new_instance(mp_obj_t class, uint subobjs) {
+    #if MICROPY_PY_SLOTS
+    const mp_obj_class_t *cls = class;
+    if (MP_OBJ_CLASS_SLOTS_IN_MEMBERS(cls)) {
+        // the values of the slots take the place of the members map
+        mp_uint_t n = sizeof(mp_map_t) / sizeof(mp_obj_t);
+        n = cls->n_slots > n ? cls->n_slots - n : 0;
+        mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, n);
+        o->base.type = class;
+        mp_seq_clear(MP_OBJ_INSTANCE_SLOTS(o, cls), 0, cls->n_slots, sizeof(mp_obj_t));
+        return o;
+    }
+    // the values of the slots follow the native sub-object (if any)
+    subobjs += cls->n_slots;
+    #endif
     mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, subobjs);
     o->base.type = class;
     mp_map_init(&o->members, 0);
@@ -102,58 +116,85 @@ struct class_lookup_data {
     bool is_type;
 };
 
-STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
-    assert(lookup->dest[0] == NULL);
-    assert(lookup->dest[1] == NULL);
-    for (;;) {
-        // Optimize special method lookup for native types
-        // This avoids extra method_name => slot lookup. On the other hand,
-        // this should not be applied to class types, as will result in extra
-        // lookup either.
-        if (lookup->meth_offset != 0 && mp_obj_is_native_type(type)) {
-            if (*(void**)((char*)type + lookup->meth_offset) != NULL) {
-                DEBUG_printf("mp_obj_class_lookup: matched special meth slot for %s\n", qstr_str(lookup->attr));
-                lookup->dest[0] = MP_OBJ_SENTINEL;
-                return;
-            }
+// searches only the given type, not its bases; returns true if found
+STATIC bool class_lookup_in_type(struct class_lookup_data *lookup, const mp_obj_type_t *type) {
+    // Optimize special method lookup for native types
+    // This avoids extra method_name => slot lookup. On the other hand,
+    // this should not be applied to class types, as will result in extra
+    // lookup either.
+    if (lookup->meth_offset != 0 && mp_obj_is_native_type(type)) {
+        if (*(void**)((char*)type + lookup->meth_offset) != NULL) {
+            DEBUG_printf("mp_obj_class_lookup: matched special meth slot for %s\n", qstr_str(lookup->attr));
+            lookup->dest[0] = MP_OBJ_SENTINEL;
+            return true;
         }
+    }
 
-        if (type->locals_dict != NULL) {
-            // search locals_dict (the set of methods/attributes)
-            assert(MP_OBJ_IS_TYPE(type->locals_dict, &mp_type_dict)); // Micro Python restriction, for now
-            mp_map_t *locals_map = mp_obj_dict_get_map(type->locals_dict);
-            mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(lookup->attr), MP_MAP_LOOKUP);
-            if (elem != NULL) {
-                if (lookup->is_type) {
-                    // If we look up a class method, we need to return original type for which we
-                    // do a lookup, not a (base) type in which we found the class method.
-                    const mp_obj_type_t *org_type = (const mp_obj_type_t*)lookup->obj;
-                    mp_convert_member_lookup(NULL, org_type, elem->value, lookup->dest);
-                } else {
-                    mp_obj_instance_t *obj = lookup->obj;
-                    if (obj != MP_OBJ_NULL && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
-                        // If we're dealing with native base class, then it applies to native sub-object
-                        obj = obj->subobj[0];
-                    }
-                    mp_convert_member_lookup(obj, type, elem->value, lookup->dest);
+    if (type->locals_dict != NULL) {
+        // search locals_dict (the set of methods/attributes)
+        assert(MP_OBJ_IS_TYPE(type->locals_dict, &mp_type_dict)); // Micro Python restriction, for now
+        mp_map_t *locals_map = mp_obj_dict_get_map(type->locals_dict);
+        mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(lookup->attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            if (lookup->is_type) {
+                // If we look up a class method, we need to return original type for which we
+                // do a lookup, not a (base) type in which we found the class method.
+                const mp_obj_type_t *org_type = (const mp_obj_type_t*)lookup->obj;
+                mp_convert_member_lookup(NULL, org_type, elem->value, lookup->dest);
+            } else {
+                mp_obj_instance_t *obj = lookup->obj;
+                if (obj != MP_OBJ_NULL && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
+                    // If we're dealing with native base class, then it applies to native sub-object
+                    obj = obj->subobj[0];
                 }
+                mp_convert_member_lookup(obj, type, elem->value, lookup->dest);
+            }
 #if DEBUG_PRINT
-                printf("mp_obj_class_lookup: Returning: ");
-                mp_obj_print(lookup->dest[0], PRINT_REPR); printf(" ");
-                mp_obj_print(lookup->dest[1], PRINT_REPR); printf("\n");
+            printf("mp_obj_class_lookup: Returning: ");
+            mp_obj_print(lookup->dest[0], PRINT_REPR); printf(" ");
+            mp_obj_print(lookup->dest[1], PRINT_REPR); printf("\n");
 #endif
-                return;
-            }
+            return true;
         }
+    }
 
-        // Previous code block takes care about attributes defined in .locals_dict,
-        // but some attributes of native types may be handled using .load_attr method,
-        // so make sure we try to lookup those too.
-        if (lookup->obj != MP_OBJ_NULL && !lookup->is_type && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
-            mp_load_method_maybe(lookup->obj->subobj[0], lookup->attr, lookup->dest);
-            if (lookup->dest[0] != MP_OBJ_NULL) {
-                return;
-            }
+    // Previous code block takes care about attributes defined in .locals_dict,
+    // but some attributes of native types may be handled using .load_attr method,
+    // so make sure we try to lookup those too.
+    if (lookup->obj != MP_OBJ_NULL && !lookup->is_type && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
+        mp_load_method_maybe(lookup->obj->subobj[0], lookup->attr, lookup->dest);
+        if (lookup->dest[0] != MP_OBJ_NULL) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#if MICROPY_OPT_CLASS_MRO
+// searches the types in mro[start:], skipping object, which is not a "real" type
+STATIC void class_lookup_mro(struct class_lookup_data *lookup, const mp_obj_class_t *cls, mp_uint_t start) {
+    for (mp_uint_t i = start; i < cls->mro_len; i++) {
+        const mp_obj_type_t *type = cls->mro[i];
+        if (type != &mp_type_object && class_lookup_in_type(lookup, type)) {
+            return;
+        }
+    }
+}
+#endif
+
+STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
+    assert(lookup->dest[0] == NULL);
+    assert(lookup->dest[1] == NULL);
+    #if MICROPY_OPT_CLASS_MRO
+    if (mp_obj_is_instance_type(type)) {
+        class_lookup_mro(lookup, (const mp_obj_class_t*)type, 0);
+        return;
+    }
+    #endif
+    for (;;) {
+        if (class_lookup_in_type(lookup, type)) {
+            return;
         }
 
         // attribute not found, keep searching base classes
@@ -332,7 +373,8 @@ const qstr mp_unary_op_method_name[] = {
     [MP_UNARY_OP_NEGATIVE] = MP_QSTR___neg__,
     [MP_UNARY_OP_INVERT] = MP_QSTR___invert__,
     #endif
-    [MP_UNARY_OP_NOT] = MP_QSTR_, // don't need to implement this, used to make sure array has full size
+    [MP_UNARY_OP_NOT] = MP_QSTR_, // don't need to implement this
+    [MP_UNARY_OP_LEN_HINT] = MP_QSTR_, // only used on native types, entry makes sure array has full size
 };
 
 STATIC mp_obj_t instance_unary_op(mp_uint_t op, mp_obj_t self_in) {
@@ -437,18 +479,190 @@ STATIC mp_obj_t instance_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
     }
 }
 
+#if MICROPY_OPT_METHOD_CACHE
+#define METHOD_CACHE_ENTRY(type, attr) (&MP_STATE_VM(method_cache)[(((mp_uint_t)(type) >> 4) ^ (attr)) & (MICROPY_OPT_METHOD_CACHE_SIZE - 1)])
+
+void mp_obj_type_method_cache_clear(void) {
+    memset(MP_STATE_VM(method_cache), 0, sizeof(MP_STATE_VM(method_cache)));
+}
+#endif
+
+#if MICROPY_OPT_INSTANCE_SHAPES
+
+// instances with more attributes than this, or that would make a shape have
+// more children than this, use a map instead
+#define SHAPE_MAX_LEN (16)
+#define SHAPE_MAX_CHILDREN (8)
+
+mp_int_t mp_obj_instance_shape_index(const mp_obj_instance_t *self, qstr attr) {
+    const mp_obj_shape_t *shape = MP_OBJ_INSTANCE_SHAPE(self);
+    for (mp_uint_t i = 0; i < shape->len; i++) {
+        if (shape->keys[i] == attr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// get the shape made by adding attr to the given one (NULL for no attributes)
+STATIC mp_obj_shape_t *instance_shape_add(mp_obj_shape_t *shape, qstr attr) {
+    mp_obj_shape_t **link = shape == NULL ? &MP_STATE_VM(instance_shapes) : &shape->child;
+    mp_uint_t n_children = 0;
+    for (mp_obj_shape_t *child = *link; child != NULL; child = child->sibling) {
+        if (child->keys[child->len - 1] == attr) {
+            return child;
+        }
+        n_children += 1;
+    }
+    mp_uint_t len = shape == NULL ? 0 : shape->len;
+    if (len >= SHAPE_MAX_LEN || n_children >= SHAPE_MAX_CHILDREN) {
+        return NULL;
+    }
+    mp_obj_shape_t *child = m_new_obj_var(mp_obj_shape_t, qstr, len + 1);
+    child->child = NULL;
+    child->sibling = *link;
+    child->len = len + 1;
+    if (len != 0) {
+        memcpy(child->keys, shape->keys, len * sizeof(qstr));
+    }
+    child->keys[len] = attr;
+    *link = child;
+    return child;
+}
+
+// move the attributes of an instance with a shape into a map of its own
+STATIC void instance_shape_to_map(mp_obj_instance_t *self) {
+    const mp_obj_shape_t *shape = MP_OBJ_INSTANCE_SHAPE(self);
+    mp_obj_t *values = MP_OBJ_INSTANCE_VALUES(self);
+    mp_map_elem_t *old_table = self->members.table;
+    mp_uint_t old_alloc = self->members.alloc;
+    mp_map_init(&self->members, shape->len + 1);
+    for (mp_uint_t i = 0; i < shape->len; i++) {
+        mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(shape->keys[i]), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = values[i];
+    }
+    m_del(mp_obj_t, old_table, 1 + old_alloc);
+}
+
+// store an attribute of an instance that has a shape, or no attributes yet;
+// returns false if the instance must use a map instead
+STATIC bool instance_shape_store(mp_obj_instance_t *self, qstr attr, mp_obj_t value) {
+    mp_obj_shape_t *shape = NULL;
+    if (MP_OBJ_INSTANCE_HAS_SHAPE(self)) {
+        mp_int_t i = mp_obj_instance_shape_index(self, attr);
+        if (i >= 0) {
+            MP_OBJ_INSTANCE_VALUES(self)[i] = value;
+            return true;
+        }
+        shape = (mp_obj_shape_t*)MP_OBJ_INSTANCE_SHAPE(self);
+    }
+    mp_obj_shape_t *new_shape = instance_shape_add(shape, attr);
+    if (new_shape == NULL) {
+        if (shape != NULL) {
+            instance_shape_to_map(self);
+        }
+        return false;
+    }
+    mp_uint_t len = new_shape->len;
+    if (len > self->members.alloc) {
+        // the shape and values together fill a whole number of GC blocks
+        mp_uint_t new_alloc = (len + 4) / 4 * 4 - 1;
+        mp_obj_t *table = (mp_obj_t*)self->members.table;
+        if (table == NULL) {
+            table = m_new(mp_obj_t, 1 + new_alloc);
+        } else {
+            table = m_renew(mp_obj_t, table, 1 + self->members.alloc, 1 + new_alloc);
+        }
+        self->members.table = (mp_map_elem_t*)table;
+        self->members.alloc = new_alloc;
+    }
+    ((mp_obj_t*)self->members.table)[0] = new_shape;
+    MP_OBJ_INSTANCE_VALUES(self)[len - 1] = value;
+    self->members.used = len;
+    self->members.is_fixed = 1;
+    return true;
+}
+
+#endif
+
+#if MICROPY_PY_SLOTS
+mp_int_t mp_obj_class_slot_index(const mp_obj_class_t *cls, qstr attr) {
+    for (mp_uint_t i = 0; i < cls->n_slots; i++) {
+        if (cls->slot_names[i] == attr) {
+            return i;
+        }
+    }
+    return -1;
+}
+#endif
+
+#if MICROPY_PY_BUILTINS_PROPERTY
+STATIC void instance_load_property(mp_obj_t self_in, mp_obj_t property, mp_obj_t *dest) {
+    // Note: This is an optimisation for code size and execution time.
+    // The proper way to do it is have the functionality just below
+    // in a __get__ method of the property object, and then it would
+    // be called by the descriptor code down below.  But that way
+    // requires overhead for the nested mp_call's and overhead for
+    // the code.
+    const mp_obj_t *proxy = mp_obj_property_get(property);
+    if (proxy[0] == mp_const_none) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_AttributeError, "unreadable attribute"));
+    } else {
+        dest[0] = mp_call_function_n_kw(proxy[0], 1, 0, &self_in);
+    }
+}
+#endif
+
 STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     // logic: look in instance members then class locals
     assert(mp_obj_is_instance_type(mp_obj_get_type(self_in)));
     mp_obj_instance_t *self = self_in;
 
-    mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
-    if (elem != NULL) {
-        // object member, always treated as a value
-        // TODO should we check for properties?
-        dest[0] = elem->value;
+    #if MICROPY_PY_SLOTS
+    const mp_obj_class_t *cls = (const mp_obj_class_t*)self->base.type;
+    if (cls->n_slots != 0) {
+        mp_int_t i = mp_obj_class_slot_index(cls, attr);
+        if (i >= 0 && MP_OBJ_INSTANCE_SLOTS(self, cls)[i] != MP_OBJ_NULL) {
+            dest[0] = MP_OBJ_INSTANCE_SLOTS(self, cls)[i];
+            return;
+        }
+    }
+    if (!cls->has_dict) {
+        // no members to look in
+    } else
+    #endif
+    #if MICROPY_OPT_INSTANCE_SHAPES
+    if (MP_OBJ_INSTANCE_HAS_SHAPE(self)) {
+        mp_int_t i = mp_obj_instance_shape_index(self, attr);
+        if (i >= 0) {
+            dest[0] = MP_OBJ_INSTANCE_VALUES(self)[i];
+            return;
+        }
+    } else
+    #endif
+    {
+        mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            // object member, always treated as a value
+            // TODO should we check for properties?
+            dest[0] = elem->value;
+            return;
+        }
+    }
+
+    #if MICROPY_OPT_METHOD_CACHE
+    mp_method_cache_entry_t *cache = METHOD_CACHE_ENTRY(self->base.type, attr);
+    if (cache->type == self->base.type && cache->attr == attr) {
+        #if MICROPY_PY_BUILTINS_PROPERTY
+        if (MP_OBJ_IS_TYPE(cache->meth, &mp_type_property)) {
+            instance_load_property(self_in, cache->meth, dest);
+            return;
+        }
+        #endif
+        dest[0] = cache->meth;
+        dest[1] = self_in;
         return;
     }
+    #endif
 
     struct class_lookup_data lookup = {
         .obj = self,
@@ -460,21 +674,28 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
     mp_obj_class_lookup(&lookup, self->base.type);
     mp_obj_t member = dest[0];
     if (member != MP_OBJ_NULL) {
+        #if MICROPY_OPT_METHOD_CACHE
+        // Only plain functions bound to this instance are cached: they have
+        // no __get__, and a native base would bind to the native sub-object.
+        if (dest[1] == self_in && MP_OBJ_IS_FUN(member)) {
+            cache->type = self->base.type;
+            cache->attr = attr;
+            cache->meth = member;
+            return;
+        }
+        #endif
+
         #if MICROPY_PY_BUILTINS_PROPERTY
         if (MP_OBJ_IS_TYPE(member, &mp_type_property)) {
             // object member is a property; delegate the load to the property
-            // Note: This is an optimisation for code size and execution time.
-            // The proper way to do it is have the functionality just below
-            // in a __get__ method of the property object, and then it would
-            // be called by the descriptor code down below.  But that way
-            // requires overhead for the nested mp_call's and overhead for
-            // the code.
-            const mp_obj_t *proxy = mp_obj_property_get(member);
-            if (proxy[0] == mp_const_none) {
-                nlr_raise(mp_obj_new_exception_msg(&mp_type_AttributeError, "unreadable attribute"));
-            } else {
-                dest[0] = mp_call_function_n_kw(proxy[0], 1, 0, &self_in);
-            }
+            #if MICROPY_OPT_METHOD_CACHE
+            // properties are cached too, so later loads call the getter
+            // without walking the class hierarchy
+            cache->type = self->base.type;
+            cache->attr = attr;
+            cache->meth = member;
+            #endif
+            instance_load_property(self_in, member, dest);
             return;
         }
         #endif
@@ -518,14 +739,23 @@ STATIC bool mp_obj_instance_store_attr(mp_obj_t self_in, qstr attr, mp_obj_t val
     // be delegated.
     // Note: this makes all stores slow... how to fix?
     mp_obj_t member[2] = {MP_OBJ_NULL};
-    struct class_lookup_data lookup = {
-        .obj = self,
-        .attr = attr,
-        .meth_offset = 0,
-        .dest = member,
-        .is_type = false,
-    };
-    mp_obj_class_lookup(&lookup, self->base.type);
+    #if MICROPY_OPT_METHOD_CACHE
+    // a cached method or property is what the lookup would find
+    mp_method_cache_entry_t *cache = METHOD_CACHE_ENTRY(self->base.type, attr);
+    if (cache->type == self->base.type && cache->attr == attr) {
+        member[0] = cache->meth;
+    } else
+    #endif
+    {
+        struct class_lookup_data lookup = {
+            .obj = self,
+            .attr = attr,
+            .meth_offset = 0,
+            .dest = member,
+            .is_type = false,
+        };
+        mp_obj_class_lookup(&lookup, self->base.type);
+    }
 
     if (member[0] != MP_OBJ_NULL) {
         #if MICROPY_PY_BUILTINS_PROPERTY
@@ -588,6 +818,44 @@ STATIC bool mp_obj_instance_store_attr(mp_obj_t self_in, qstr attr, mp_obj_t val
     }
     #endif
 
+    #if MICROPY_PY_SLOTS
+    {
+        const mp_obj_class_t *cls = (const mp_obj_class_t*)self->base.type;
+        mp_int_t i = mp_obj_class_slot_index(cls, attr);
+        if (i >= 0) {
+            mp_obj_t *slot = &MP_OBJ_INSTANCE_SLOTS(self, cls)[i];
+            if (value == MP_OBJ_NULL && *slot == MP_OBJ_NULL) {
+                // can't delete an unset slot
+                return false;
+            }
+            *slot = value;
+            return true;
+        }
+        if (!cls->has_dict) {
+            // instance can only have attributes in its slots
+            return false;
+        }
+    }
+    #endif
+
+    #if MICROPY_OPT_INSTANCE_SHAPES
+    if (MP_OBJ_INSTANCE_HAS_SHAPE(self)) {
+        if (value != MP_OBJ_NULL) {
+            if (instance_shape_store(self, attr, value)) {
+                return true;
+            }
+        } else if (mp_obj_instance_shape_index(self, attr) >= 0) {
+            // a shape can't lose attributes
+            instance_shape_to_map(self);
+        } else {
+            return false;
+        }
+    } else if (value != MP_OBJ_NULL && self->members.alloc == 0
+        && instance_shape_store(self, attr, value)) {
+        return true;
+    }
+    #endif
+
     if (value == MP_OBJ_NULL) {
         // delete attribute
         mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
@@ -684,8 +952,7 @@ mp_obj_t mp_obj_instance_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw
     if (call == MP_OBJ_SENTINEL) {
         return mp_call_function_n_kw(self->subobj[0], n_args, n_kw, args);
     }
-    mp_obj_t meth = mp_obj_new_bound_meth(call, self);
-    return mp_call_function_n_kw(meth, n_args, n_kw, args);
+    return mp_call_method_self_n_kw(call, self, n_args, n_kw, args);
 }
 
 STATIC mp_obj_t instance_getiter(mp_obj_t self_in) {
@@ -806,6 +1073,11 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
 
         // TODO CPython allows STORE_ATTR to a class, but is this the correct implementation?
 
+        #if MICROPY_OPT_METHOD_CACHE
+        // this may change the method found for this class or any subclass
+        mp_obj_type_method_cache_clear();
+        #endif
+
         if (self->locals_dict != NULL) {
             assert(MP_OBJ_IS_TYPE(self->locals_dict, &mp_type_dict)); // Micro Python restriction, for now
             mp_map_t *locals_map = mp_obj_dict_get_map(self->locals_dict);
@@ -838,6 +1110,140 @@ const mp_obj_type_t mp_type_type = {
     .attr = type_attr,
 };
 
+#if MICROPY_PY_SLOTS
+// work out the slots of a new class from __slots__ and its bases
+STATIC void type_init_slots(mp_obj_class_t *cls, uint num_native_bases) {
+    mp_map_t *locals_map = mp_obj_dict_get_map(cls->type.locals_dict);
+
+    // at most one base can have slots, and they are inherited from it
+    const mp_obj_class_t *slot_base = NULL;
+    bool has_dict = false;
+    mp_uint_t len;
+    mp_obj_t *items;
+    mp_obj_tuple_get(cls->type.bases_tuple, &len, &items);
+    for (mp_uint_t i = 0; i < len; i++) {
+        const mp_obj_type_t *bt = items[i];
+        if (mp_obj_is_instance_type(bt)) {
+            const mp_obj_class_t *bc = (const mp_obj_class_t*)bt;
+            has_dict |= bc->has_dict;
+            if (bc->n_slots != 0) {
+                if (slot_base != NULL) {
+                    nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "multiple bases have instance lay-out conflict"));
+                }
+                slot_base = bc;
+            }
+        }
+    }
+
+    mp_obj_t slots_in = MP_OBJ_NULL;
+    mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___slots__), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        // a class without __slots__ has a dict
+        has_dict = true;
+    } else {
+        slots_in = elem->value;
+        if (MP_OBJ_IS_STR(slots_in)) {
+            len = 1;
+            items = &slots_in;
+        } else {
+            mp_obj_get_array(slots_in, &len, &items);
+        }
+    }
+
+    mp_uint_t n_base = slot_base == NULL ? 0 : slot_base->n_slots;
+    mp_uint_t n_slots = n_base;
+    qstr *slot_names = NULL;
+    if (slots_in != MP_OBJ_NULL) {
+        n_slots += len;
+    }
+    if (n_slots != 0) {
+        slot_names = m_new(qstr, n_slots);
+        for (mp_uint_t i = 0; i < n_base; i++) {
+            qstr name = slot_base->slot_names[i];
+            if (mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP) != NULL) {
+                // a class attribute hides the slot of the base
+                name = MP_QSTR_NULL;
+            }
+            slot_names[i] = name;
+        }
+        n_slots = n_base;
+        for (mp_uint_t i = 0; slots_in != MP_OBJ_NULL && i < len; i++) {
+            if (!MP_OBJ_IS_STR(items[i])) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "__slots__ items must be strings"));
+            }
+            qstr name = mp_obj_str_get_qstr(items[i]);
+            if (name == MP_QSTR___dict__) {
+                has_dict = true;
+                continue;
+            }
+            if (mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(name), MP_MAP_LOOKUP) != NULL) {
+                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "__slots__ conflicts with class variable"));
+                } else {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                        "'%q' in __slots__ conflicts with class variable", name));
+                }
+            }
+            slot_names[n_slots++] = name;
+        }
+    }
+
+    cls->n_native = num_native_bases;
+    cls->has_dict = has_dict;
+    cls->n_slots = n_slots;
+    cls->slot_names = slot_names;
+}
+#endif
+
+#if MICROPY_OPT_CLASS_MRO
+// appends type, and then its bases, to the mro of cls unless already there
+STATIC void type_mro_add(mp_obj_class_t *cls, mp_uint_t *alloc, const mp_obj_type_t *type) {
+    for (mp_uint_t i = 0; i < cls->mro_len; i++) {
+        if (cls->mro[i] == type) {
+            // all its bases were added with it
+            return;
+        }
+    }
+    if (cls->mro_len >= *alloc) {
+        cls->mro = m_renew(const mp_obj_type_t*, cls->mro, *alloc, *alloc * 2);
+        *alloc *= 2;
+    }
+    cls->mro[cls->mro_len++] = type;
+
+    if (mp_obj_is_instance_type(type)) {
+        // a class already has its bases in order, and those that are present
+        // in cls are there with all of their own bases
+        const mp_obj_class_t *bc = (const mp_obj_class_t*)type;
+        for (mp_uint_t i = 1; i < bc->mro_len; i++) {
+            type_mro_add(cls, alloc, bc->mro[i]);
+        }
+    } else if (type->bases_tuple != MP_OBJ_NULL) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_tuple_get(type->bases_tuple, &len, &items);
+        for (mp_uint_t i = 0; i < len; i++) {
+            type_mro_add(cls, alloc, (const mp_obj_type_t*)items[i]);
+        }
+    }
+}
+
+STATIC void type_init_mro(mp_obj_class_t *cls) {
+    mp_uint_t len;
+    mp_obj_t *items;
+    mp_obj_tuple_get(cls->type.bases_tuple, &len, &items);
+    mp_uint_t alloc = len + 1;
+    cls->mro = m_new(const mp_obj_type_t*, alloc);
+    cls->mro[0] = &cls->type;
+    cls->mro_len = 1;
+    for (mp_uint_t i = 0; i < len; i++) {
+        type_mro_add(cls, &alloc, (const mp_obj_type_t*)items[i]);
+    }
+    if (cls->mro_len < alloc) {
+        cls->mro = m_renew(const mp_obj_type_t*, cls->mro, alloc, cls->mro_len);
+    }
+}
+#endif
+
 mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict) {
     assert(MP_OBJ_IS_TYPE(bases_tuple, &mp_type_tuple)); // Micro Python restriction, for now
     assert(MP_OBJ_IS_TYPE(locals_dict, &mp_type_dict)); // Micro Python restriction, for now
@@ -863,7 +1269,11 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         }
     }
 
+    #if MICROPY_PY_SLOTS || MICROPY_OPT_CLASS_MRO
+    mp_obj_type_t *o = (mp_obj_type_t*)m_new0(mp_obj_class_t, 1);
+    #else
     mp_obj_type_t *o = m_new0(mp_obj_type_t, 1);
+    #endif
     o->base.type = &mp_type_type;
     o->name = name;
     o->print = instance_print;
@@ -886,6 +1296,14 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "multiple bases have instance lay-out conflict"));
     }
 
+    #if MICROPY_PY_SLOTS
+    type_init_slots((mp_obj_class_t*)o, num_native_bases);
+    #endif
+
+    #if MICROPY_OPT_CLASS_MRO
+    type_init_mro((mp_obj_class_t*)o);
+    #endif
+
     mp_map_t *locals_map = mp_obj_dict_get_map(o->locals_dict);
     mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___new__), MP_MAP_LOOKUP);
     if (elem != NULL) {
@@ -954,6 +1372,16 @@ STATIC void super_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
         .dest = dest,
         .is_type = false,
     };
+    #if MICROPY_OPT_CLASS_MRO
+    if (mp_obj_is_instance_type(type)) {
+        // the bases of type follow it in its mro
+        class_lookup_mro(&lookup, (const mp_obj_class_t*)type, 1);
+        if (dest[0] != MP_OBJ_NULL) {
+            return;
+        }
+        len = 0;
+    }
+    #endif
     for (uint i = 0; i < len; i++) {
         assert(MP_OBJ_IS_TYPE(items[i], &mp_type_type));
         mp_obj_class_lookup(&lookup, (mp_obj_type_t*)items[i]);
@@ -998,6 +1426,19 @@ bool mp_obj_is_subclass_fast(mp_const_obj_t object, mp_const_obj_t classinfo) {
 
         const mp_obj_type_t *self = object;
 
+        #if MICROPY_OPT_CLASS_MRO
+        if (mp_obj_is_instance_type(self)) {
+            // all the bases of a class are in its mro, after the class itself
+            const mp_obj_class_t *cls = (const mp_obj_class_t*)self;
+            for (mp_uint_t i = 1; i < cls->mro_len; i++) {
+                if (cls->mro[i] == classinfo) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        #endif
+
         // for a const struct, this entry might be NULL
         if (self->bases_tuple == MP_OBJ_NULL) {
             return false;
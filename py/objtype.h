@@ -28,6 +28,26 @@
 
 #include "py/obj.h"
 
+#if MICROPY_OPT_INSTANCE_SHAPES
+// A shape is the list of attribute names of an instance, in the order they
+// were first stored.  Instances that store the same names in the same order
+// share a shape, which is found by following the transitions from the shape
+// without the last name.  Shapes are never freed.
+typedef struct _mp_obj_shape_t {
+    struct _mp_obj_shape_t *child; // first shape with one more name than this
+    struct _mp_obj_shape_t *sibling; // next shape with the same parent
+    mp_uint_t len;
+    qstr keys[];
+} mp_obj_shape_t;
+
+// An instance with a shape has members.is_fixed set and members.table
+// pointing to an array of the shape followed by the values (members.used of
+// them, with room for members.alloc).  Otherwise members is a normal map.
+#define MP_OBJ_INSTANCE_HAS_SHAPE(self) ((self)->members.is_fixed)
+#define MP_OBJ_INSTANCE_SHAPE(self) ((const mp_obj_shape_t*)((mp_obj_t*)(self)->members.table)[0])
+#define MP_OBJ_INSTANCE_VALUES(self) ((mp_obj_t*)(self)->members.table + 1)
+#endif
+
 // instance object
 // creating an instance of a class makes one of these objects
 typedef struct _mp_obj_instance_t {
@@ -37,9 +57,52 @@ typedef struct _mp_obj_instance_t {
     // TODO maybe cache __getattr__ and __setattr__ for efficient lookup of them
 } mp_obj_instance_t;
 
+#if MICROPY_PY_SLOTS || MICROPY_OPT_CLASS_MRO
+// A class made by mp_obj_new_type.  Its instances hold n_slots values, for
+// the names in slot_names, after their n_native native sub-objects.  A value
+// is MP_OBJ_NULL if unset, and a name is MP_QSTR_NULL if a subclass hides
+// that slot.  Only a class with has_dict set lets instances have members.
+// The mro array holds the class itself followed by each of its bases once,
+// in depth-first left-to-right order, including object if it is reached.
+typedef struct _mp_obj_class_t {
+    mp_obj_type_t type;
+    #if MICROPY_PY_SLOTS
+    mp_uint_t n_native : 1;
+    mp_uint_t has_dict : 1;
+    mp_uint_t n_slots : (8 * sizeof(mp_uint_t) - 2);
+    const qstr *slot_names;
+    #endif
+    #if MICROPY_OPT_CLASS_MRO
+    mp_uint_t mro_len;
+    const mp_obj_type_t **mro;
+    #endif
+} mp_obj_class_t;
+#endif
+
+#if MICROPY_PY_SLOTS
+
+// Without members or a native sub-object, the slot values of an instance
+// are stored in place of its members map (continuing into subobj).
+#define MP_OBJ_CLASS_SLOTS_IN_MEMBERS(cls) (!(cls)->has_dict && (cls)->n_native == 0)
+#define MP_OBJ_INSTANCE_SLOTS(self, cls) (MP_OBJ_CLASS_SLOTS_IN_MEMBERS(cls) \
+    ? (mp_obj_t*)&(self)->members : &(self)->subobj[(cls)->n_native])
+
+// returns the index of the slot called attr, or -1
+mp_int_t mp_obj_class_slot_index(const mp_obj_class_t *cls, qstr attr);
+#endif
+
+#if MICROPY_OPT_METHOD_CACHE
+void mp_obj_type_method_cache_clear(void);
+#endif
+
 // this needs to be exposed for MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE to work
 void mp_obj_instance_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
 
+#if MICROPY_OPT_INSTANCE_SHAPES
+// returns the index of attr in the values of an instance with a shape, or -1
+mp_int_t mp_obj_instance_shape_index(const mp_obj_instance_t *self, qstr attr);
+#endif
+
 // these need to be exposed so mp_obj_is_callable can work correctly
 bool mp_obj_instance_is_callable(mp_obj_t self_in);
 mp_obj_t mp_obj_instance_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
@@ -28,11 +28,13 @@
 #include <assert.h>
 
 #include "py/objtuple.h"
+#include "py/runtime0.h"
 #include "py/runtime.h"
 
 typedef struct _mp_obj_zip_t {
     mp_obj_base_t base;
     mp_uint_t n_iters;
+    mp_uint_t idx; // for list and tuple sources
     mp_obj_t iters[];
 } mp_obj_zip_t;
 
@@ -42,8 +44,9 @@ STATIC mp_obj_t zip_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
     mp_obj_zip_t *o = m_new_obj_var(mp_obj_zip_t, mp_obj_t, n_args);
     o->base.type = type_in;
     o->n_iters = n_args;
+    o->idx = 0;
     for (mp_uint_t i = 0; i < n_args; i++) {
-        o->iters[i] = mp_getiter(args[i]);
+        o->iters[i] = mp_getiter_or_seq(args[i]);
     }
     return o;
 }
@@ -57,20 +60,59 @@ STATIC mp_obj_t zip_iternext(mp_obj_t self_in) {
     mp_obj_tuple_t *tuple = mp_obj_new_tuple(self->n_iters, NULL);
 
     for (mp_uint_t i = 0; i < self->n_iters; i++) {
-        mp_obj_t next = mp_iternext(self->iters[i]);
+        mp_obj_t next = mp_iternext_or_seq(self->iters[i], self->idx);
         if (next == MP_OBJ_STOP_ITERATION) {
             mp_obj_tuple_del(tuple);
             return MP_OBJ_STOP_ITERATION;
         }
         tuple->items[i] = next;
     }
+    self->idx++;
     return tuple;
 }
 
+#if MICROPY_OPT_ITER_FUSION
+mp_obj_t mp_obj_zip_iternext_unpack(mp_obj_t self_in, mp_uint_t num, mp_obj_t *items) {
+    mp_obj_zip_t *self = self_in;
+    if (num != self->n_iters || num == 0) {
+        return MP_OBJ_SENTINEL;
+    }
+    for (mp_uint_t i = 0; i < num; i++) {
+        mp_obj_t next = mp_iternext_or_seq(self->iters[i], self->idx);
+        if (next == MP_OBJ_STOP_ITERATION) {
+            return MP_OBJ_STOP_ITERATION;
+        }
+        items[num - 1 - i] = next;
+    }
+    self->idx++;
+    return mp_const_none;
+}
+#endif
+
+// zip stops with the shortest iterable; the hint is unknown if any is unknown
+STATIC mp_obj_t zip_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_zip_t *self = self_in;
+    if (op == MP_UNARY_OP_LEN_HINT) {
+        mp_int_t len = 0;
+        for (mp_uint_t i = 0; i < self->n_iters; i++) {
+            mp_int_t l = mp_len_hint_or_seq(self->iters[i], self->idx);
+            if (l < 0) {
+                return MP_OBJ_NULL;
+            }
+            if (i == 0 || l < len) {
+                len = l;
+            }
+        }
+        return MP_OBJ_NEW_SMALL_INT(len);
+    }
+    return MP_OBJ_NULL; // op not supported
+}
+
 const mp_obj_type_t mp_type_zip = {
     { &mp_type_type },
     .name = MP_QSTR_zip,
     .make_new = zip_make_new,
+    .unary_op = zip_unary_op,
     .getiter = mp_identity,
     .iternext = zip_iternext,
 };
@@ -112,6 +112,15 @@ typedef struct _rule_stack_t {
     mp_uint_t arg_i; // this dictates the maximum nodes in a "list" of things
 } rule_stack_t;
 
+// parse nodes (and the compiler's scopes) are bump-allocated from a list of
+// chunks, which are all freed together by mp_parse_tree_clear
+typedef struct _mp_parse_chunk_t {
+    struct _mp_parse_chunk_t *next;
+    mp_uint_t alloc;
+    mp_uint_t used;
+    byte data[];
+} mp_parse_chunk_t;
+
 typedef struct _parser_t {
     bool had_memory_error;
 
@@ -124,6 +133,8 @@ typedef struct _parser_t {
     mp_parse_node_t *result_stack;
 
     mp_lexer_t *lexer;
+
+    mp_parse_tree_t tree;
 } parser_t;
 
 STATIC inline void memory_error(parser_t *parser) {
@@ -164,6 +175,57 @@ STATIC void pop_rule(parser_t *parser, const rule_t **rule, mp_uint_t *arg_i, mp
     *src_line = parser->rule_stack[parser->rule_stack_top].src_line;
 }
 
+STATIC void *tree_alloc(mp_parse_tree_t *tree, size_t num_bytes, bool raise) {
+    // keep everything word aligned, parse nodes need their low bits to be zero
+    num_bytes = (num_bytes + sizeof(mp_uint_t) - 1) & ~(sizeof(mp_uint_t) - 1);
+    mp_parse_chunk_t *chunk = tree->chunk;
+    if (chunk == NULL || chunk->used + num_bytes > chunk->alloc) {
+        // start a new chunk; the unused end of the previous one is wasted
+        size_t alloc = MICROPY_ALLOC_PARSE_CHUNK_INIT;
+        if (alloc < num_bytes) {
+            alloc = num_bytes;
+        }
+        if (raise) {
+            chunk = (mp_parse_chunk_t*)m_new(byte, sizeof(mp_parse_chunk_t) + alloc);
+        } else {
+            chunk = (mp_parse_chunk_t*)m_new_maybe(byte, sizeof(mp_parse_chunk_t) + alloc);
+            if (chunk == NULL) {
+                return NULL;
+            }
+        }
+        chunk->next = tree->chunk;
+        chunk->alloc = alloc;
+        chunk->used = 0;
+        tree->chunk = chunk;
+    }
+    void *ret = chunk->data + chunk->used;
+    chunk->used += num_bytes;
+    return ret;
+}
+
+void *mp_parse_tree_alloc(mp_parse_tree_t *tree, size_t num_bytes) {
+    return tree_alloc(tree, num_bytes, true);
+}
+
+void mp_parse_tree_clear(mp_parse_tree_t *tree) {
+    mp_parse_chunk_t *chunk = tree->chunk;
+    while (chunk != NULL) {
+        mp_parse_chunk_t *next = chunk->next;
+        m_del(byte, chunk, sizeof(mp_parse_chunk_t) + chunk->alloc);
+        chunk = next;
+    }
+    tree->root = MP_PARSE_NODE_NULL;
+    tree->chunk = NULL;
+}
+
+STATIC mp_parse_node_struct_t *parser_new_node(parser_t *parser, mp_uint_t num_nodes) {
+    mp_parse_node_struct_t *pn = tree_alloc(&parser->tree, sizeof(mp_parse_node_struct_t) + num_nodes * sizeof(mp_parse_node_t), false);
+    if (pn == NULL) {
+        memory_error(parser);
+    }
+    return pn;
+}
+
 mp_parse_node_t mp_parse_node_new_leaf(mp_int_t kind, mp_int_t arg) {
     if (kind == MP_PARSE_NODE_SMALL_INT) {
         return (mp_parse_node_t)(kind | (arg << 1));
@@ -171,31 +233,6 @@ mp_parse_node_t mp_parse_node_new_leaf(mp_int_t kind, mp_int_t arg) {
     return (mp_parse_node_t)(kind | (arg << 4));
 }
 
-void mp_parse_node_free(mp_parse_node_t pn) {
-    if (MP_PARSE_NODE_IS_STRUCT(pn)) {
-        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t *)pn;
-        mp_uint_t n = MP_PARSE_NODE_STRUCT_NUM_NODES(pns);
-        mp_uint_t rule_id = MP_PARSE_NODE_STRUCT_KIND(pns);
-        if (rule_id == RULE_string || rule_id == RULE_bytes) {
-            m_del(char, (char*)pns->nodes[0], (mp_uint_t)pns->nodes[1]);
-        } else if (rule_id == RULE_const_object) {
-            // don't free the const object since it's probably used by the compiled code
-        } else {
-            bool adjust = ADD_BLANK_NODE(rules[rule_id]);
-            if (adjust) {
-                n--;
-            }
-            for (mp_uint_t i = 0; i < n; i++) {
-                mp_parse_node_free(pns->nodes[i]);
-            }
-            if (adjust) {
-                n++;
-            }
-        }
-        m_del_var(mp_parse_node_struct_t, mp_parse_node_t, n, pns);
-    }
-}
-
 int mp_parse_node_extract_list(mp_parse_node_t *pn, mp_uint_t pn_kind, mp_parse_node_t **nodes) {
     if (MP_PARSE_NODE_IS_NULL(*pn)) {
         *nodes = NULL;
@@ -305,14 +342,14 @@ STATIC void push_result_node(parser_t *parser, mp_parse_node_t pn) {
 }
 
 STATIC mp_parse_node_t make_node_string_bytes(parser_t *parser, mp_uint_t src_line, mp_uint_t rule_kind, const char *str, mp_uint_t len) {
-    mp_parse_node_struct_t *pn = m_new_obj_var_maybe(mp_parse_node_struct_t, mp_parse_node_t, 2);
-    if (pn == NULL) {
+    mp_parse_node_struct_t *pn = parser_new_node(parser, 2);
+    char *p = tree_alloc(&parser->tree, len, false);
+    if (pn == NULL || p == NULL) {
         memory_error(parser);
         return MP_PARSE_NODE_NULL;
     }
     pn->source_line = src_line;
     pn->kind_num_nodes = rule_kind | (2 << 8);
-    char *p = m_new(char, len);
     memcpy(p, str, len);
     pn->nodes[0] = (mp_int_t)p;
     pn->nodes[1] = len;
@@ -320,9 +357,8 @@ STATIC mp_parse_node_t make_node_string_bytes(parser_t *parser, mp_uint_t src_li
 }
 
 STATIC mp_parse_node_t make_node_const_object(parser_t *parser, mp_uint_t src_line, mp_obj_t obj) {
-    mp_parse_node_struct_t *pn = m_new_obj_var_maybe(mp_parse_node_struct_t, mp_parse_node_t, 1);
+    mp_parse_node_struct_t *pn = parser_new_node(parser, 1);
     if (pn == NULL) {
-        memory_error(parser);
         return MP_PARSE_NODE_NULL;
     }
     pn->source_line = src_line;
@@ -371,9 +407,8 @@ STATIC void push_result_token(parser_t *parser) {
 }
 
 STATIC void push_result_rule(parser_t *parser, mp_uint_t src_line, const rule_t *rule, mp_uint_t num_args) {
-    mp_parse_node_struct_t *pn = m_new_obj_var_maybe(mp_parse_node_struct_t, mp_parse_node_t, num_args);
+    mp_parse_node_struct_t *pn = parser_new_node(parser, num_args);
     if (pn == NULL) {
-        memory_error(parser);
         return;
     }
     pn->source_line = src_line;
@@ -384,37 +419,40 @@ STATIC void push_result_rule(parser_t *parser, mp_uint_t src_line, const rule_t
     push_result_node(parser, (mp_parse_node_t)pn);
 }
 
-mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
-
-    // initialise parser and allocate memory for its stacks
-
-    parser_t parser;
+STATIC void parser_init(parser_t *parser, mp_lexer_t *lex) {
+    parser->had_memory_error = false;
 
-    parser.had_memory_error = false;
+    parser->rule_stack_alloc = MICROPY_ALLOC_PARSE_RULE_INIT;
+    parser->rule_stack_top = 0;
+    parser->rule_stack = m_new_maybe(rule_stack_t, parser->rule_stack_alloc);
 
-    parser.rule_stack_alloc = MICROPY_ALLOC_PARSE_RULE_INIT;
-    parser.rule_stack_top = 0;
-    parser.rule_stack = m_new_maybe(rule_stack_t, parser.rule_stack_alloc);
+    parser->result_stack_alloc = MICROPY_ALLOC_PARSE_RESULT_INIT;
+    parser->result_stack_top = 0;
+    parser->result_stack = m_new_maybe(mp_parse_node_t, parser->result_stack_alloc);
 
-    parser.result_stack_alloc = MICROPY_ALLOC_PARSE_RESULT_INIT;
-    parser.result_stack_top = 0;
-    parser.result_stack = m_new_maybe(mp_parse_node_t, parser.result_stack_alloc);
+    parser->lexer = lex;
 
-    parser.lexer = lex;
+    parser->tree.root = MP_PARSE_NODE_NULL;
+    parser->tree.chunk = NULL;
 
     // check if we could allocate the stacks
-    if (parser.rule_stack == NULL || parser.result_stack == NULL) {
-        goto memory_error;
+    if (parser->rule_stack == NULL || parser->result_stack == NULL) {
+        memory_error(parser);
     }
+}
 
-    // work out the top-level rule to use, and push it on the stack
-    mp_uint_t top_level_rule;
-    switch (input_kind) {
-        case MP_PARSE_SINGLE_INPUT: top_level_rule = RULE_single_input; break;
-        case MP_PARSE_EVAL_INPUT: top_level_rule = RULE_eval_input; break;
-        default: top_level_rule = RULE_file_input;
-    }
-    push_rule(&parser, lex->tok_line, rules[top_level_rule], 0);
+STATIC void parser_free(parser_t *parser) {
+    m_del(rule_stack_t, parser->rule_stack, parser->rule_stack_alloc);
+    m_del(mp_parse_node_t, parser->result_stack, parser->result_stack_alloc);
+}
+
+// parses the given top-level rule, leaving its parse node on the result stack;
+// returns false if there was a syntax error (a memory error is recorded in the
+// parser instead)
+STATIC bool parse_rule(parser_t *parser, const rule_t *top_rule, mp_parse_input_kind_t input_kind) {
+    mp_lexer_t *lex = parser->lexer;
+
+    push_rule(parser, lex->tok_line, top_rule, 0);
 
     // parse!
 
@@ -425,17 +463,17 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
 
     for (;;) {
         next_rule:
-        if (parser.rule_stack_top == 0 || parser.had_memory_error) {
+        if (parser->rule_stack_top == 0 || parser->had_memory_error) {
             break;
         }
 
-        pop_rule(&parser, &rule, &i, &rule_src_line);
+        pop_rule(parser, &rule, &i, &rule_src_line);
         n = rule->act & RULE_ACT_ARG_MASK;
 
         /*
         // debugging
-        printf("depth=%d ", parser.rule_stack_top);
-        for (int j = 0; j < parser.rule_stack_top; ++j) {
+        printf("depth=%d ", parser->rule_stack_top);
+        for (int j = 0; j < parser->rule_stack_top; ++j) {
             printf(" ");
         }
         printf("%s n=%d i=%d bt=%d\n", rule->rule_name, n, i, backtrack);
@@ -452,15 +490,15 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     switch (rule->arg[i] & RULE_ARG_KIND_MASK) {
                         case RULE_ARG_TOK:
                             if (lex->tok_kind == (rule->arg[i] & RULE_ARG_ARG_MASK)) {
-                                push_result_token(&parser);
+                                push_result_token(parser);
                                 mp_lexer_to_next(lex);
                                 goto next_rule;
                             }
                             break;
                         case RULE_ARG_RULE:
                         rule_or_no_other_choice:
-                            push_rule(&parser, rule_src_line, rule, i + 1); // save this or-rule
-                            push_rule_from_arg(&parser, rule->arg[i]); // push child of or-rule
+                            push_rule(parser, rule_src_line, rule, i + 1); // save this or-rule
+                            push_rule_from_arg(parser, rule->arg[i]); // push child of or-rule
                             goto next_rule;
                         default:
                             assert(0);
@@ -469,14 +507,14 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                 }
                 if ((rule->arg[i] & RULE_ARG_KIND_MASK) == RULE_ARG_TOK) {
                     if (lex->tok_kind == (rule->arg[i] & RULE_ARG_ARG_MASK)) {
-                        push_result_token(&parser);
+                        push_result_token(parser);
                         mp_lexer_to_next(lex);
                     } else {
                         backtrack = true;
                         goto next_rule;
                     }
                 } else {
-                    push_rule_from_arg(&parser, rule->arg[i]);
+                    push_rule_from_arg(parser, rule->arg[i]);
                 }
                 break;
 
@@ -487,7 +525,7 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     assert(i > 0);
                     if ((rule->arg[i - 1] & RULE_ARG_KIND_MASK) == RULE_ARG_OPT_RULE) {
                         // an optional rule that failed, so continue with next arg
-                        push_result_node(&parser, MP_PARSE_NODE_NULL);
+                        push_result_node(parser, MP_PARSE_NODE_NULL);
                         backtrack = false;
                     } else {
                         // a mandatory rule that failed, so propagate backtrack
@@ -509,7 +547,7 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                             if (lex->tok_kind == tok_kind) {
                                 // matched token
                                 if (tok_kind == MP_TOKEN_NAME) {
-                                    push_result_token(&parser);
+                                    push_result_token(parser);
                                 }
                                 mp_lexer_to_next(lex);
                             } else {
@@ -528,8 +566,8 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                         case RULE_ARG_RULE:
                         case RULE_ARG_OPT_RULE:
                         rule_and_no_other_choice:
-                            push_rule(&parser, rule_src_line, rule, i + 1); // save this and-rule
-                            push_rule_from_arg(&parser, rule->arg[i]); // push child of and-rule
+                            push_rule(parser, rule_src_line, rule, i + 1); // save this and-rule
+                            push_rule_from_arg(parser, rule->arg[i]); // push child of and-rule
                             goto next_rule;
                         default:
                             assert(0);
@@ -562,12 +600,12 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
 
 #if !MICROPY_EMIT_CPYTHON && !MICROPY_ENABLE_DOC_STRING
                 // this code discards lonely statements, such as doc strings
-                if (input_kind != MP_PARSE_SINGLE_INPUT && rule->rule_id == RULE_expr_stmt && peek_result(&parser, 0) == MP_PARSE_NODE_NULL) {
-                    mp_parse_node_t p = peek_result(&parser, 1);
+                if (input_kind != MP_PARSE_SINGLE_INPUT && rule->rule_id == RULE_expr_stmt && peek_result(parser, 0) == MP_PARSE_NODE_NULL) {
+                    mp_parse_node_t p = peek_result(parser, 1);
                     if ((MP_PARSE_NODE_IS_LEAF(p) && !MP_PARSE_NODE_IS_ID(p)) || MP_PARSE_NODE_IS_STRUCT_KIND(p, RULE_string)) {
-                        pop_result(&parser); // MP_PARSE_NODE_NULL
-                        mp_parse_node_free(pop_result(&parser)); // RULE_string
-                        push_result_rule(&parser, rule_src_line, rules[RULE_pass_stmt], 0);
+                        pop_result(parser); // MP_PARSE_NODE_NULL
+                        pop_result(parser); // RULE_string
+                        push_result_rule(parser, rule_src_line, rules[RULE_pass_stmt], 0);
                         break;
                     }
                 }
@@ -590,32 +628,32 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                 // always emit these rules, and add an extra blank node at the end (to be used by the compiler to store data)
                 if (ADD_BLANK_NODE(rule)) {
                     emit_rule = true;
-                    push_result_node(&parser, MP_PARSE_NODE_NULL);
+                    push_result_node(parser, MP_PARSE_NODE_NULL);
                     i += 1;
                 }
 
                 mp_uint_t num_not_nil = 0;
                 for (mp_uint_t x = 0; x < i; ++x) {
-                    if (peek_result(&parser, x) != MP_PARSE_NODE_NULL) {
+                    if (peek_result(parser, x) != MP_PARSE_NODE_NULL) {
                         num_not_nil += 1;
                     }
                 }
                 if (emit_rule) {
-                    push_result_rule(&parser, rule_src_line, rule, i);
+                    push_result_rule(parser, rule_src_line, rule, i);
                 } else if (num_not_nil == 0) {
-                    push_result_rule(&parser, rule_src_line, rule, i); // needed for, eg, atom_paren, testlist_comp_3b
+                    push_result_rule(parser, rule_src_line, rule, i); // needed for, eg, atom_paren, testlist_comp_3b
                 } else if (num_not_nil == 1) {
                     // single result, leave it on stack
                     mp_parse_node_t pn = MP_PARSE_NODE_NULL;
                     for (mp_uint_t x = 0; x < i; ++x) {
-                        mp_parse_node_t pn2 = pop_result(&parser);
+                        mp_parse_node_t pn2 = pop_result(parser);
                         if (pn2 != MP_PARSE_NODE_NULL) {
                             pn = pn2;
                         }
                     }
-                    push_result_node(&parser, pn);
+                    push_result_node(parser, pn);
                 } else {
-                    push_result_rule(&parser, rule_src_line, rule, i);
+                    push_result_rule(parser, rule_src_line, rule, i);
                 }
                 break;
             }
@@ -664,7 +702,7 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                                     if (i & 1 & n) {
                                         // separators which are tokens are not pushed to result stack
                                     } else {
-                                        push_result_token(&parser);
+                                        push_result_token(parser);
                                     }
                                     mp_lexer_to_next(lex);
                                     // got element of list, so continue parsing list
@@ -678,8 +716,8 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                                 break;
                             case RULE_ARG_RULE:
                             rule_list_no_other_choice:
-                                push_rule(&parser, rule_src_line, rule, i + 1); // save this list-rule
-                                push_rule_from_arg(&parser, arg); // push child of list-rule
+                                push_rule(parser, rule_src_line, rule, i + 1); // save this list-rule
+                                push_rule_from_arg(parser, arg); // push child of list-rule
                                 goto next_rule;
                             default:
                                 assert(0);
@@ -700,12 +738,12 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     // list matched single item
                     if (had_trailing_sep) {
                         // if there was a trailing separator, make a list of a single item
-                        push_result_rule(&parser, rule_src_line, rule, i);
+                        push_result_rule(parser, rule_src_line, rule, i);
                     } else {
                         // just leave single item on stack (ie don't wrap in a list)
                     }
                 } else {
-                    push_result_rule(&parser, rule_src_line, rule, i);
+                    push_result_rule(parser, rule_src_line, rule, i);
                 }
                 break;
             }
@@ -715,69 +753,142 @@ mp_parse_node_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
         }
     }
 
-    mp_obj_t exc;
-    mp_parse_node_t result;
+    return true;
 
-    // check if we had a memory error
-    if (parser.had_memory_error) {
-memory_error:
-        exc = mp_obj_new_exception_msg(&mp_type_MemoryError,
-            "parser could not allocate enough memory");
-        result = MP_PARSE_NODE_NULL;
-        goto finished;
+syntax_error:
+#ifdef USE_RULE_NAME
+    // debugging: print the rule name that failed and the token
+    printf("rule: %s\n", rule->rule_name);
+#if MICROPY_DEBUG_PRINTERS
+    mp_lexer_show_token(lex);
+#endif
+#endif
+    return false;
+}
+
+STATIC mp_obj_t parse_make_syntax_error(mp_lexer_t *lex) {
+    if (lex->tok_kind == MP_TOKEN_INDENT) {
+        return mp_obj_new_exception_msg(&mp_type_IndentationError,
+            "unexpected indent");
+    } else if (lex->tok_kind == MP_TOKEN_DEDENT_MISMATCH) {
+        return mp_obj_new_exception_msg(&mp_type_IndentationError,
+            "unindent does not match any outer indentation level");
+    } else {
+        return mp_obj_new_exception_msg(&mp_type_SyntaxError,
+            "invalid syntax");
     }
+}
+
+STATIC mp_obj_t parse_make_memory_error(void) {
+    return mp_obj_new_exception_msg(&mp_type_MemoryError,
+        "parser could not allocate enough memory");
+}
+
+// frees the lexer and raises the exception, with info about the file name and
+// location; we don't have a 'block' name, so just pass the NULL qstr for that
+STATIC NORETURN void parse_raise(mp_lexer_t *lex, mp_obj_t exc) {
+    mp_obj_exception_add_traceback(exc, lex->source_name, lex->tok_line, MP_QSTR_NULL);
+    mp_lexer_free(lex);
+    nlr_raise(exc);
+}
+
+mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+
+    // initialise parser and allocate memory for its stacks
+
+    parser_t parser;
+    parser_init(&parser, lex);
 
-    // check we are at the end of the token stream
-    if (lex->tok_kind != MP_TOKEN_END) {
-        goto syntax_error;
+    // work out the top-level rule to use
+    mp_uint_t top_level_rule;
+    switch (input_kind) {
+        case MP_PARSE_SINGLE_INPUT: top_level_rule = RULE_single_input; break;
+        case MP_PARSE_EVAL_INPUT: top_level_rule = RULE_eval_input; break;
+        default: top_level_rule = RULE_file_input;
     }
 
-    //result_stack_show(parser);
-    //printf("rule stack alloc: %d\n", parser.rule_stack_alloc);
-    //printf("result stack alloc: %d\n", parser.result_stack_alloc);
-    //printf("number of parse nodes allocated: %d\n", num_parse_nodes_allocated);
+    // parse, and check we are at the end of the token stream
+    bool ok = parser.had_memory_error
+        || (parse_rule(&parser, rules[top_level_rule], input_kind) && lex->tok_kind == MP_TOKEN_END);
 
-    // get the root parse node that we created
-    assert(parser.result_stack_top == 1);
-    exc = MP_OBJ_NULL;
-    result = parser.result_stack[0];
+    mp_obj_t exc;
+
+    if (parser.had_memory_error) {
+        exc = parse_make_memory_error();
+    } else if (!ok) {
+        exc = parse_make_syntax_error(lex);
+    } else {
+        //result_stack_show(parser);
+        //printf("rule stack alloc: %d\n", parser.rule_stack_alloc);
+        //printf("result stack alloc: %d\n", parser.result_stack_alloc);
+        //printf("number of parse nodes allocated: %d\n", num_parse_nodes_allocated);
+
+        // get the root parse node that we created
+        assert(parser.result_stack_top == 1);
+        exc = MP_OBJ_NULL;
+        parser.tree.root = parser.result_stack[0];
+    }
 
-finished:
     // free the memory that we don't need anymore
-    m_del(rule_stack_t, parser.rule_stack, parser.rule_stack_alloc);
-    m_del(mp_parse_node_t, parser.result_stack, parser.result_stack_alloc);
-    // we also free the lexer on behalf of the caller (see below)
+    parser_free(&parser);
 
+    // we also free the lexer on behalf of the caller (see below)
     if (exc != MP_OBJ_NULL) {
-        // had an error so raise the exception
-        // add traceback to give info about file name and location
-        // we don't have a 'block' name, so just pass the NULL qstr to indicate this
-        mp_obj_exception_add_traceback(exc, lex->source_name, lex->tok_line, MP_QSTR_NULL);
-        mp_lexer_free(lex);
-        nlr_raise(exc);
+        // had an error so free the partial tree and raise the exception
+        mp_parse_tree_clear(&parser.tree);
+        parse_raise(lex, exc);
+    }
+    mp_lexer_free(lex);
+    return parser.tree;
+}
+
+#if MICROPY_PARSE_STREAMING
+void mp_parse_file_stmts(mp_lexer_t *lex, mp_parse_stmt_fun_t fun, void *env) {
+    parser_t parser;
+    parser_init(&parser, lex);
+
+    mp_obj_t exc = MP_OBJ_NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // each statement is parsed with the rule used for the body of a file,
+        // so the nodes given to fun are the same as those in a full parse tree
+        while (!parser.had_memory_error && lex->tok_kind != MP_TOKEN_END) {
+            if (!parse_rule(&parser, &rule_file_input_3, MP_PARSE_FILE_INPUT)
+                || (!parser.had_memory_error && parser.result_stack_top != 1)) {
+                exc = parse_make_syntax_error(lex);
+                break;
+            }
+            if (parser.had_memory_error) {
+                break;
+            }
+            // hand the statement's nodes over to fun, and start a new tree
+            mp_parse_tree_t tree = parser.tree;
+            tree.root = parser.result_stack[--parser.result_stack_top];
+            parser.tree.chunk = NULL;
+            if (MP_PARSE_NODE_IS_TOKEN_KIND(tree.root, MP_TOKEN_NEWLINE)) {
+                // a blank line, nothing to compile
+                mp_parse_tree_clear(&tree);
+                continue;
+            }
+            fun(env, &tree);
+        }
+        nlr_pop();
     } else {
+        // fun raised an exception; clean up and pass it on
+        parser_free(&parser);
+        mp_parse_tree_clear(&parser.tree);
         mp_lexer_free(lex);
-        return result;
+        nlr_jump(nlr.ret_val);
     }
 
-syntax_error:
-    if (lex->tok_kind == MP_TOKEN_INDENT) {
-        exc = mp_obj_new_exception_msg(&mp_type_IndentationError,
-            "unexpected indent");
-    } else if (lex->tok_kind == MP_TOKEN_DEDENT_MISMATCH) {
-        exc = mp_obj_new_exception_msg(&mp_type_IndentationError,
-            "unindent does not match any outer indentation level");
-    } else {
-        exc = mp_obj_new_exception_msg(&mp_type_SyntaxError,
-            "invalid syntax");
-#ifdef USE_RULE_NAME
-        // debugging: print the rule name that failed and the token
-        printf("rule: %s\n", rule->rule_name);
-#if MICROPY_DEBUG_PRINTERS
-        mp_lexer_show_token(lex);
-#endif
-#endif
+    if (parser.had_memory_error) {
+        exc = parse_make_memory_error();
     }
-    result = MP_PARSE_NODE_NULL;
-    goto finished;
+    parser_free(&parser);
+    mp_parse_tree_clear(&parser.tree);
+    if (exc != MP_OBJ_NULL) {
+        parse_raise(lex, exc);
+    }
+    mp_lexer_free(lex);
 }
+#endif
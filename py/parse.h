@@ -26,6 +26,7 @@
 #ifndef __MICROPY_INCLUDED_PY_PARSE_H__
 #define __MICROPY_INCLUDED_PY_PARSE_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "py/mpconfig.h"
@@ -76,7 +77,6 @@ typedef struct _mp_parse_node_struct_t {
 #define MP_PARSE_NODE_STRUCT_NUM_NODES(pns) ((pns)->kind_num_nodes >> 8)
 
 mp_parse_node_t mp_parse_node_new_leaf(mp_int_t kind, mp_int_t arg);
-void mp_parse_node_free(mp_parse_node_t pn);
 int mp_parse_node_extract_list(mp_parse_node_t *pn, mp_uint_t pn_kind, mp_parse_node_t **nodes);
 void mp_parse_node_print(mp_parse_node_t pn, mp_uint_t indent);
 
@@ -86,8 +86,27 @@ typedef enum {
     MP_PARSE_EVAL_INPUT,
 } mp_parse_input_kind_t;
 
+// a parse tree owns the memory of all its nodes, which is allocated in chunks
+// and freed in one go by mp_parse_tree_clear; the compiler also allocates its
+// scopes from the tree it's compiling
+typedef struct _mp_parse_tree_t {
+    mp_parse_node_t root;
+    struct _mp_parse_chunk_t *chunk;
+} mp_parse_tree_t;
+
+void *mp_parse_tree_alloc(mp_parse_tree_t *tree, size_t num_bytes);
+void mp_parse_tree_clear(mp_parse_tree_t *tree);
+
 // the parser will raise an exception if an error occurred
 // the parser will free the lexer before it returns
-mp_parse_node_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
+mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
+
+#if MICROPY_PARSE_STREAMING
+// parses a file one top-level statement at a time, passing each one to fun as
+// soon as it's complete; fun owns the parse tree it's given and must clear it
+// the parser will free the lexer before it returns, also if fun raises
+typedef void (*mp_parse_stmt_fun_t)(void *env, mp_parse_tree_t *tree);
+void mp_parse_file_stmts(struct _mp_lexer_t *lex, mp_parse_stmt_fun_t fun, void *env);
+#endif
 
 #endif // __MICROPY_INCLUDED_PY_PARSE_H__
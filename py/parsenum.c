@@ -35,6 +35,11 @@
 #include <math.h>
 #endif
 
+#if MICROPY_PY_BUILTINS_FLOAT && MICROPY_FLOAT_EXACT_CONV
+#include "py/mpz.h"
+#include "py/formatfloat.h"
+#endif
+
 STATIC NORETURN void raise(mp_obj_t exc, mp_lexer_t *lex) {
     // if lex!=NULL then the parser called us and we need to make a SyntaxError with traceback
     if (lex != NULL) {
@@ -160,6 +165,172 @@ typedef enum {
     PARSE_DEC_IN_EXP,
 } parse_dec_in_t;
 
+#if MICROPY_PY_BUILTINS_FLOAT && MICROPY_FLOAT_EXACT_CONV
+
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#define DEC_MANT_BITS (24)
+#define DEC_EXP_MIN (-126) // binary exponent of the smallest normal float
+#define DEC_EXP10_MIN (-46) // anything below 10^DEC_EXP10_MIN rounds to 0
+#define DEC_EXP10_MAX (39) // anything from 10^DEC_EXP10_MAX up is inf
+#define DEC_DIG_MAX (120) // enough digits to decide any rounding
+#else
+#define DEC_MANT_BITS (53)
+#define DEC_EXP_MIN (-1022)
+#define DEC_EXP10_MIN (-324)
+#define DEC_EXP10_MAX (309)
+#define DEC_DIG_MAX (800)
+#endif
+
+// powers of ten that are exact as floats
+STATIC const mp_float_t dec_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    #endif
+};
+#define DEC_POW10_MAX ((mp_int_t)(sizeof(dec_pow10) / sizeof(dec_pow10[0])) - 1)
+
+STATIC mp_uint_t dec_mpz_bit_length(const mpz_t *z) {
+    if (z->len == 0) {
+        return 0;
+    }
+    mp_uint_t n = (z->len - 1) * MPZ_DIG_SIZE;
+    for (mpz_dig_t d = z->dig[z->len - 1]; d != 0; d >>= 1) {
+        n += 1;
+    }
+    return n;
+}
+
+// The decimal number with mantissa digits (and a point) in str..top times
+// 10^exp10, correctly rounded using exact big integer arithmetic
+STATIC mp_float_t parse_dec_exact(const char *str, const char *top, mp_int_t exp10) {
+    MPZ_SCRATCH(num);
+    MPZ_SCRATCH(den);
+    MPZ_SCRATCH(tmp);
+    MPZ_CONST_INT(ten, 10);
+    mp_float_t result = 0;
+
+    // accumulate up to DEC_DIG_MAX significant digits, 9 at a time
+    mp_int_t n_dig = 0;
+    mp_int_t chunk = 0;
+    mp_int_t chunk_scale = 1;
+    bool in_frac = false;
+    bool sticky = false;
+    for (; str < top; ++str) {
+        if (*str == '.') {
+            in_frac = true;
+            continue;
+        }
+        mp_int_t dig = *str - '0';
+        if (n_dig == 0 && dig == 0) {
+            // leading zero
+        } else if (n_dig == DEC_DIG_MAX) {
+            // the rest only matter for being non-zero
+            sticky |= dig != 0;
+            if (!in_frac) {
+                exp10 += 1;
+            }
+            continue;
+        } else {
+            chunk = 10 * chunk + dig;
+            chunk_scale *= 10;
+            n_dig += 1;
+        }
+        if (in_frac) {
+            exp10 -= 1;
+        }
+        if (chunk_scale == 1000000000 || (str + 1 == top && chunk_scale > 1)) {
+            MPZ_CONST_INT(scale, chunk_scale);
+            MPZ_CONST_INT(chunk_mpz, chunk);
+            mpz_mul_inpl(&tmp, &num, &scale);
+            mpz_add_inpl(&num, &tmp, &chunk_mpz);
+            chunk = 0;
+            chunk_scale = 1;
+        }
+    }
+    if (chunk_scale > 1) {
+        // mantissa ended with a point after a partial chunk
+        MPZ_CONST_INT(scale, chunk_scale);
+        MPZ_CONST_INT(chunk_mpz, chunk);
+        mpz_mul_inpl(&tmp, &num, &scale);
+        mpz_add_inpl(&num, &tmp, &chunk_mpz);
+    }
+    if (sticky) {
+        // a trailing 1 stands in for the dropped non-zero digits
+        MPZ_CONST_INT(one, 1);
+        mpz_mul_inpl(&tmp, &num, &ten);
+        mpz_add_inpl(&num, &tmp, &one);
+        n_dig += 1;
+        exp10 -= 1;
+    }
+
+    if (n_dig == 0 || n_dig + exp10 <= DEC_EXP10_MIN) {
+        goto done;
+    }
+    if (n_dig + exp10 > DEC_EXP10_MAX) {
+        result = INFINITY;
+        goto done;
+    }
+
+    // value is num / den
+    MPZ_CONST_INT(exp10_mpz, exp10 < 0 ? -exp10 : exp10);
+    if (exp10 >= 0) {
+        mpz_pow_inpl(&den, &ten, &exp10_mpz);
+        mpz_mul_inpl(&tmp, &num, &den);
+        mpz_set(&num, &tmp);
+        mpz_set_from_int(&den, 1);
+    } else {
+        mpz_pow_inpl(&den, &ten, &exp10_mpz);
+    }
+
+    // scale by 2^shift so the quotient has DEC_MANT_BITS + 2 or 3 bits,
+    // enough to round correctly along with the remainder being non-zero
+    mp_int_t shift = DEC_MANT_BITS + 2 - (mp_int_t)dec_mpz_bit_length(&num) + (mp_int_t)dec_mpz_bit_length(&den);
+    if (shift >= 0) {
+        mpz_shl_inpl(&tmp, &num, shift);
+        mpz_set(&num, &tmp);
+    } else {
+        mpz_shl_inpl(&tmp, &den, -shift);
+        mpz_set(&den, &tmp);
+    }
+    MPZ_SCRATCH(rem);
+    mpz_divmod_inpl(&tmp, &rem, &num, &den);
+    sticky = !mpz_is_zero(&rem);
+    mpz_deinit(&rem);
+    uint64_t q = 0;
+    for (mp_uint_t i = tmp.len; i > 0; --i) {
+        q = (q << MPZ_DIG_SIZE) | tmp.dig[i - 1];
+    }
+
+    // the value is in [2^e2, 2^(e2 + 1)); subnormals have fewer bits
+    mp_int_t q_bits = dec_mpz_bit_length(&tmp);
+    mp_int_t e2 = q_bits - 1 - shift;
+    mp_int_t bits = DEC_MANT_BITS;
+    if (e2 < DEC_EXP_MIN) {
+        bits -= DEC_EXP_MIN - e2;
+        if (bits < 0) {
+            goto done;
+        }
+    }
+
+    // round half to even
+    mp_int_t drop = q_bits - bits;
+    uint64_t mant = q >> drop;
+    uint64_t half = (uint64_t)1 << (drop - 1);
+    if ((q & half) && ((q & (half - 1)) || sticky || (mant & 1))) {
+        mant += 1;
+    }
+    result = MICROPY_FLOAT_C_FUN(ldexp)((mp_float_t)mant, drop - shift);
+
+done:
+    mpz_deinit(&num);
+    mpz_deinit(&den);
+    mpz_deinit(&tmp);
+    return result;
+}
+
+#endif
+
 mp_obj_t mp_parse_num_decimal(const char *str, mp_uint_t len, bool allow_imag, bool force_complex, mp_lexer_t *lex) {
 #if MICROPY_PY_BUILTINS_FLOAT
     const char *top = str + len;
@@ -206,24 +377,58 @@ mp_obj_t mp_parse_num_decimal(const char *str, mp_uint_t len, bool allow_imag, b
         // string should be a decimal number
         parse_dec_in_t in = PARSE_DEC_IN_INTG;
         bool exp_neg = false;
-        mp_float_t frac_mult = 0.1;
         mp_int_t exp_val = 0;
+        #if MICROPY_FLOAT_EXACT_CONV
+        // the first 19 significant digits, exact if the rest are zero
+        const char *mant_start = str;
+        const char *mant_top = str;
+        uint64_t mant = 0;
+        mp_int_t mant_exp10 = 0;
+        bool mant_exact = true;
+        #else
+        mp_float_t frac_mult = 0.1;
+        #endif
         while (str < top) {
             mp_uint_t dig = *str++;
             if ('0' <= dig && dig <= '9') {
                 dig -= '0';
                 if (in == PARSE_DEC_IN_EXP) {
+                    #if MICROPY_FLOAT_EXACT_CONV
+                    // larger exponents overflow or underflow anyway
+                    if (exp_val < 100000) {
+                        exp_val = 10 * exp_val + dig;
+                    }
+                    #else
                     exp_val = 10 * exp_val + dig;
+                    #endif
                 } else {
+                    #if MICROPY_FLOAT_EXACT_CONV
+                    mant_top = str;
+                    if (mant < 1000000000000000000ULL) {
+                        mant = 10 * mant + dig;
+                        if (in == PARSE_DEC_IN_FRAC) {
+                            mant_exp10 -= 1;
+                        }
+                    } else {
+                        mant_exact &= dig == 0;
+                        if (in == PARSE_DEC_IN_INTG) {
+                            mant_exp10 += 1;
+                        }
+                    }
+                    #else
                     if (in == PARSE_DEC_IN_FRAC) {
                         dec_val += dig * frac_mult;
                         frac_mult *= 0.1;
                     } else {
                         dec_val = 10 * dec_val + dig;
                     }
+                    #endif
                 }
             } else if (in == PARSE_DEC_IN_INTG && dig == '.') {
                 in = PARSE_DEC_IN_FRAC;
+                #if MICROPY_FLOAT_EXACT_CONV
+                mant_top = str;
+                #endif
             } else if (in != PARSE_DEC_IN_EXP && ((dig | 0x20) == 'e')) {
                 in = PARSE_DEC_IN_EXP;
                 if (str < top) {
@@ -253,12 +458,34 @@ mp_obj_t mp_parse_num_decimal(const char *str, mp_uint_t len, bool allow_imag, b
         }
 
         // apply the exponent
+        #if MICROPY_FLOAT_EXACT_CONV
+        mp_int_t exp10 = exp_val + mant_exp10;
+        if (mant_exact && mant <= ((uint64_t)1 << DEC_MANT_BITS)) {
+            // move some of a large power of ten into the mantissa if it stays exact
+            for (; exp10 > DEC_POW10_MAX && mant <= ((uint64_t)1 << DEC_MANT_BITS) / 10; exp10--) {
+                mant *= 10;
+            }
+        }
+        if (mant_exact && mant <= ((uint64_t)1 << DEC_MANT_BITS)
+            && -DEC_POW10_MAX <= exp10 && exp10 <= DEC_POW10_MAX) {
+            // both the mantissa and the power of ten are exact as floats, so
+            // one multiply or divide gives the correctly rounded value
+            if (exp10 >= 0) {
+                dec_val = (mp_float_t)mant * dec_pow10[exp10];
+            } else {
+                dec_val = (mp_float_t)mant / dec_pow10[-exp10];
+            }
+        } else if (!mp_float_from_decimal_fast(mant, mant_exact, exp10, &dec_val)) {
+            dec_val = parse_dec_exact(mant_start, mant_top, exp_val);
+        }
+        #else
         for (; exp_val > 0; exp_val--) {
             dec_val *= 10;
         }
         for (; exp_val < 0; exp_val++) {
             dec_val *= 0.1;
         }
+        #endif
     }
 
     // negate value if needed
@@ -43,11 +43,14 @@ PY_O_BASENAME = \
 	emitinlinethumb.o \
 	asmarm.o \
 	emitnarm.o \
+	asmxtensa.o \
+	emitnxtensa.o \
 	formatfloat.o \
 	parsenumbase.o \
 	parsenum.o \
 	emitglue.o \
 	runtime.o \
+	scheduler.o \
 	nativeglue.o \
 	stackctrl.o \
 	argcheck.o \
@@ -79,6 +82,7 @@ PY_O_BASENAME = \
 	objproperty.o \
 	objnone.o \
 	objnamedtuple.o \
+	objdeque.o \
 	objrange.o \
 	objreversed.o \
 	objset.o \
@@ -106,6 +110,7 @@ PY_O_BASENAME = \
 	modmicropython.o \
 	modstruct.o \
 	modsys.o \
+	modthread.o \
 	vm.o \
 	bc.o \
 	showbc.o \
@@ -119,11 +124,47 @@ PY_O_BASENAME = \
 	../extmod/moduheapq.o \
 	../extmod/moduhashlib.o \
 	../extmod/modubinascii.o \
+	../extmod/moducryptolib.o \
 	../extmod/modmachine.o \
+	../extmod/moduasyncio.o \
+	../extmod/moduringbuf.o \
+	../extmod/moduweakref.o \
+	../extmod/modurandom.o \
+	../extmod/modframebuf.o \
+	../extmod/moduhttp.o \
 
 # prepend the build destination prefix to the py object files
 PY_O = $(addprefix $(PY_BUILD)/, $(PY_O_BASENAME))
 
+# frozen bytecode: if FROZEN_MPY_DIR is set then the .py files in it are
+# compiled by mpy-cross and converted to C data by mpy-tool.py
+ifneq ($(FROZEN_MPY_DIR),)
+MPY_CROSS = $(TOP)/mpy-cross/mpy-cross
+MPY_TOOL = $(TOP)/tools/mpy-tool.py
+FROZEN_MPY_PY_FILES := $(shell find -L $(FROZEN_MPY_DIR) -maxdepth 1 -type f -name '*.py' | sed -e 's=^$(FROZEN_MPY_DIR)/==')
+FROZEN_MPY_MPY_FILES := $(addprefix $(BUILD)/frozen_mpy/,$(FROZEN_MPY_PY_FILES:.py=.mpy))
+QSTR_DEFS += $(BUILD)/frozen_mpy_qstr.h
+PY_O += $(BUILD)/$(BUILD)/frozen_mpy.o
+# some ports set CFLAGS after including this file, but they keep CFLAGS_MOD
+CFLAGS += -DMICROPY_MODULE_FROZEN_MPY=1
+CFLAGS_MOD += -DMICROPY_MODULE_FROZEN_MPY=1
+
+# mpy-cross must be built with the same bytecode options as the target
+$(MPY_CROSS):
+	$(error mpy-cross not found; build it first with "make -C $(TOP)/mpy-cross")
+
+$(BUILD)/frozen_mpy/%.mpy: $(FROZEN_MPY_DIR)/%.py | $(MPY_CROSS)
+	$(ECHO) "MPY $<"
+	$(Q)$(MKDIR) -p $(dir $@)
+	$(Q)$(MPY_CROSS) -o $@ -s $(<:$(FROZEN_MPY_DIR)/%=%) $<
+
+$(BUILD)/frozen_mpy.c: $(FROZEN_MPY_MPY_FILES) $(MPY_TOOL)
+	$(ECHO) "Creating $@"
+	$(Q)$(PYTHON) $(MPY_TOOL) -o $@ -q $(BUILD)/frozen_mpy_qstr.h $(FROZEN_MPY_MPY_FILES)
+
+$(BUILD)/frozen_mpy_qstr.h: $(BUILD)/frozen_mpy.c
+endif
+
 # Anything that depends on FORCE will be considered out-of-date
 FORCE:
 .PHONY: FORCE
@@ -159,6 +200,10 @@ $(PY_BUILD)/emitnarm.o: CFLAGS += -DN_ARM
 $(PY_BUILD)/emitnarm.o: py/emitnative.c
 	$(call compile_c)
 
+$(PY_BUILD)/emitnxtensa.o: CFLAGS += -DN_XTENSA
+$(PY_BUILD)/emitnxtensa.o: py/emitnative.c
+	$(call compile_c)
+
 # optimising gc for speed; 5ms down to 4ms on pybv2
 $(PY_BUILD)/gc.o: CFLAGS += $(CSUPEROPT)
 
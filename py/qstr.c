@@ -45,32 +45,82 @@
 // A qstr is an index into the qstr pool.
 // The data for a qstr contains (hash, length, data).
 // For now we use very simple encoding, just to get the framework correct:
-//  - hash is 2 bytes (see function below)
-//  - length is 2 bytes
+//  - hash is MICROPY_QSTR_BYTES_IN_HASH bytes (see function below)
+//  - length is MICROPY_QSTR_BYTES_IN_LEN bytes
 //  - data follows
 //  - \0 terminated (for now, so they can be printed using printf)
 
-#define Q_GET_HASH(q)   ((mp_uint_t)(q)[0] | ((mp_uint_t)(q)[1] << 8))
-#define Q_GET_ALLOC(q)  (2 + MICROPY_QSTR_BYTES_IN_LEN + Q_GET_LENGTH(q) + 1)
-#define Q_GET_DATA(q)   ((q) + 2 + MICROPY_QSTR_BYTES_IN_LEN)
+#define Q_HASH_MASK ((mp_uint_t)0xffffffff >> (8 * (4 - MICROPY_QSTR_BYTES_IN_HASH)))
+#define Q_HEADER_BYTES (MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN)
+
+#if MICROPY_QSTR_BYTES_IN_HASH == 1
+    #define Q_GET_HASH(q) ((mp_uint_t)(q)[0])
+    #define Q_SET_HASH(q, hash) do { (q)[0] = (hash); } while (0)
+#elif MICROPY_QSTR_BYTES_IN_HASH == 2
+    #define Q_GET_HASH(q) ((mp_uint_t)(q)[0] | ((mp_uint_t)(q)[1] << 8))
+    #define Q_SET_HASH(q, hash) do { (q)[0] = (hash); (q)[1] = (hash) >> 8; } while (0)
+#elif MICROPY_QSTR_BYTES_IN_HASH == 4
+    #define Q_GET_HASH(q) ((mp_uint_t)(q)[0] | ((mp_uint_t)(q)[1] << 8) | ((mp_uint_t)(q)[2] << 16) | ((mp_uint_t)(q)[3] << 24))
+    #define Q_SET_HASH(q, hash) do { (q)[0] = (hash); (q)[1] = (hash) >> 8; (q)[2] = (hash) >> 16; (q)[3] = (hash) >> 24; } while (0)
+#else
+    #error unimplemented qstr hash decoding
+#endif
+#define Q_GET_ALLOC(q)  (Q_HEADER_BYTES + Q_GET_LENGTH(q) + 1)
+#define Q_GET_DATA(q)   ((q) + Q_HEADER_BYTES)
 #if MICROPY_QSTR_BYTES_IN_LEN == 1
-    #define Q_GET_LENGTH(q) ((q)[2])
-    #define Q_SET_LENGTH(q, len) do { (q)[2] = (len); } while (0)
+    #define Q_GET_LENGTH(q) ((q)[MICROPY_QSTR_BYTES_IN_HASH])
+    #define Q_SET_LENGTH(q, len) do { (q)[MICROPY_QSTR_BYTES_IN_HASH] = (len); } while (0)
 #elif MICROPY_QSTR_BYTES_IN_LEN == 2
-    #define Q_GET_LENGTH(q) ((q)[2] | ((q)[3] << 8))
-    #define Q_SET_LENGTH(q, len) do { (q)[2] = (len); (q)[3] = (len) >> 8; } while (0)
+    #define Q_GET_LENGTH(q) ((q)[MICROPY_QSTR_BYTES_IN_HASH] | ((q)[MICROPY_QSTR_BYTES_IN_HASH + 1] << 8))
+    #define Q_SET_LENGTH(q, len) do { (q)[MICROPY_QSTR_BYTES_IN_HASH] = (len); (q)[MICROPY_QSTR_BYTES_IN_HASH + 1] = (len) >> 8; } while (0)
 #else
     #error unimplemented qstr length decoding
 #endif
 
+#if MICROPY_OPT_QSTR_INDEX
+// The first entry to probe for a hash in an index of the given (power of 2)
+// length.  The hash is spread over the whole index when the index has more
+// entries than there are hash values.  This must match makeqstrdata.py.
+STATIC inline mp_uint_t q_index_start(mp_uint_t hash, mp_uint_t index_len) {
+    #if MICROPY_QSTR_BYTES_IN_HASH < 4
+    mp_uint_t spread = index_len >> (8 * MICROPY_QSTR_BYTES_IN_HASH);
+    if (spread > 1) {
+        hash *= spread;
+    }
+    #endif
+    return hash & (index_len - 1);
+}
+#endif
+
 // this must match the equivalent function in makeqstrdata.py
 mp_uint_t qstr_compute_hash(const byte *data, mp_uint_t len) {
+    #if MICROPY_QSTR_HASH == MICROPY_QSTR_HASH_FNV1A_WORD
+    // 32-bit FNV-1a over little-endian words, then the remaining bytes; see
+    // http://www.isthe.com/chongo/tech/comp/fnv/
+    uint32_t hash = 2166136261u;
+    const byte *top = data + (len & ~(mp_uint_t)3);
+    for (; data < top; data += 4) {
+        hash ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        hash *= 16777619u;
+    }
+    for (top += len & 3; data < top; data++) {
+        hash = (hash ^ *data) * 16777619u;
+    }
+    // the multiplies only carry upwards, so mix the high bits down (this is
+    // the finaliser of MurmurHash3)
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    #else
     // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
     mp_uint_t hash = 5381;
     for (const byte *top = data + len; data < top; data++) {
         hash = ((hash << 5) + hash) ^ (*data); // hash * 33 ^ data
     }
-    hash &= 0xffff;
+    #endif
+    hash &= Q_HASH_MASK;
     // Make sure that valid hash is never zero, zero means "hash not computed"
     if (hash == 0) {
         hash++;
@@ -90,8 +140,28 @@ STATIC const qstr_pool_t const_pool = {
     },
 };
 
+#if MICROPY_OPT_QSTR_INDEX
+// hash table of the const qstrs, with a power of 2 length
+STATIC const uint16_t const_index[] = {
+#define QDEF(id, str)
+#define QINDEX(id) id,
+#include "genhdr/qstrdefs.generated.h"
+#undef QINDEX
+#undef QDEF
+};
+#endif
+
 void qstr_init(void) {
     MP_STATE_VM(last_pool) = (qstr_pool_t*)&const_pool; // we won't modify the const_pool since it has no allocated room left
+    #if MICROPY_OPT_QSTR_INDEX
+    MP_STATE_VM(qstr_index) = NULL;
+    MP_STATE_VM(qstr_index_alloc) = 0;
+    #endif
+    #if MICROPY_ALLOC_QSTR_CHUNK_INIT
+    MP_STATE_VM(qstr_last_chunk) = NULL;
+    MP_STATE_VM(qstr_last_alloc) = 0;
+    MP_STATE_VM(qstr_last_used) = 0;
+    #endif
 }
 
 STATIC const byte *find_qstr(qstr q) {
@@ -106,6 +176,36 @@ STATIC const byte *find_qstr(qstr q) {
     return 0;
 }
 
+#if MICROPY_OPT_QSTR_INDEX
+STATIC void qstr_index_insert(qstr *index, mp_uint_t alloc, qstr q, mp_uint_t hash) {
+    mp_uint_t pos = q_index_start(hash, alloc);
+    while (index[pos] != 0) {
+        pos = (pos + 1) & (alloc - 1);
+    }
+    index[pos] = q;
+}
+
+// add a new dynamic qstr to the index, growing it to keep it at most half full
+STATIC void qstr_index_add(qstr q, mp_uint_t hash) {
+    mp_uint_t alloc = MP_STATE_VM(qstr_index_alloc);
+    if (2 * (q - MP_QSTR_number_of + 1) > alloc) {
+        mp_uint_t new_alloc = alloc == 0 ? 32 : 2 * alloc;
+        qstr *index = m_new0(qstr, new_alloc);
+        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != &const_pool; pool = pool->prev) {
+            for (mp_uint_t i = 0; i < pool->len; i++) {
+                if (pool->total_prev_len + i != q) {
+                    qstr_index_insert(index, new_alloc, pool->total_prev_len + i, Q_GET_HASH(pool->qstrs[i]));
+                }
+            }
+        }
+        m_del(qstr, MP_STATE_VM(qstr_index), alloc);
+        MP_STATE_VM(qstr_index) = index;
+        MP_STATE_VM(qstr_index_alloc) = alloc = new_alloc;
+    }
+    qstr_index_insert(MP_STATE_VM(qstr_index), alloc, q, hash);
+}
+#endif
+
 STATIC qstr qstr_add(const byte *q_ptr) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
 
@@ -122,15 +222,46 @@ STATIC qstr qstr_add(const byte *q_ptr) {
 
     // add the new qstr
     MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr q = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+
+    #if MICROPY_OPT_QSTR_INDEX
+    qstr_index_add(q, Q_GET_HASH(q_ptr));
+    #endif
 
     // return id for the newly-added qstr
-    return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+    return q;
 }
 
 qstr qstr_find_strn(const char *str, mp_uint_t str_len) {
     // work out hash of str
     mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
 
+    #if MICROPY_OPT_QSTR_INDEX
+    #define Q_MATCHES(q) (Q_GET_HASH(q) == str_hash && Q_GET_LENGTH(q) == str_len && memcmp(Q_GET_DATA(q), str, str_len) == 0)
+
+    // look in the index of const qstrs
+    mp_uint_t mask = MP_ARRAY_SIZE(const_index) - 1;
+    for (mp_uint_t pos = q_index_start(str_hash, mask + 1); const_index[pos] != 0; pos = (pos + 1) & mask) {
+        if (Q_MATCHES(const_pool.qstrs[const_index[pos]])) {
+            return const_index[pos];
+        }
+    }
+
+    // look in the index of dynamic qstrs
+    if (MP_STATE_VM(qstr_index) != NULL) {
+        const qstr *index = MP_STATE_VM(qstr_index);
+        mask = MP_STATE_VM(qstr_index_alloc) - 1;
+        for (mp_uint_t pos = q_index_start(str_hash, mask + 1); index[pos] != 0; pos = (pos + 1) & mask) {
+            if (Q_MATCHES(find_qstr(index[pos]))) {
+                return index[pos];
+            }
+        }
+    }
+
+    #undef Q_MATCHES
+    return 0;
+    #else
+
     // search pools for the data
     for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
@@ -142,8 +273,36 @@ qstr qstr_find_strn(const char *str, mp_uint_t str_len) {
 
     // not found; return null qstr
     return 0;
+    #endif
 }
 
+#if MICROPY_ALLOC_QSTR_CHUNK_INIT
+// Allocate the bytes for a new qstr by bumping a pointer in the current chunk,
+// so that small qstrs don't each pay for the heap's block rounding.  The first
+// qstr in a chunk starts at its beginning and keeps the chunk alive in the GC;
+// once a chunk is full its unused tail is given back to the heap.
+STATIC byte *qstr_alloc_bytes(mp_uint_t n_bytes) {
+    if (n_bytes >= MICROPY_ALLOC_QSTR_CHUNK_INIT) {
+        // big strings get their own allocation
+        return m_new(byte, n_bytes);
+    }
+    if (MP_STATE_VM(qstr_last_used) + n_bytes > MP_STATE_VM(qstr_last_alloc)) {
+        #if MICROPY_ENABLE_GC
+        // the GC shrinks an allocation in place, so the qstrs in it stay valid
+        if (MP_STATE_VM(qstr_last_chunk) != NULL) {
+            (void)m_renew(byte, MP_STATE_VM(qstr_last_chunk), MP_STATE_VM(qstr_last_alloc), MP_STATE_VM(qstr_last_used));
+        }
+        #endif
+        MP_STATE_VM(qstr_last_chunk) = m_new(byte, MICROPY_ALLOC_QSTR_CHUNK_INIT);
+        MP_STATE_VM(qstr_last_alloc) = MICROPY_ALLOC_QSTR_CHUNK_INIT;
+        MP_STATE_VM(qstr_last_used) = 0;
+    }
+    byte *q_ptr = MP_STATE_VM(qstr_last_chunk) + MP_STATE_VM(qstr_last_used);
+    MP_STATE_VM(qstr_last_used) += n_bytes;
+    return q_ptr;
+}
+#endif
+
 qstr qstr_from_str(const char *str) {
     return qstr_from_strn(str, strlen(str));
 }
@@ -153,12 +312,16 @@ qstr qstr_from_strn(const char *str, mp_uint_t len) {
     qstr q = qstr_find_strn(str, len);
     if (q == 0) {
         mp_uint_t hash = qstr_compute_hash((const byte*)str, len);
-        byte *q_ptr = m_new(byte, 2 + MICROPY_QSTR_BYTES_IN_LEN + len + 1);
-        q_ptr[0] = hash;
-        q_ptr[1] = hash >> 8;
+        mp_uint_t n_bytes = Q_HEADER_BYTES + len + 1;
+        #if MICROPY_ALLOC_QSTR_CHUNK_INIT
+        byte *q_ptr = qstr_alloc_bytes(n_bytes);
+        #else
+        byte *q_ptr = m_new(byte, n_bytes);
+        #endif
+        Q_SET_HASH(q_ptr, hash);
         Q_SET_LENGTH(q_ptr, len);
-        memcpy(q_ptr + 2 + MICROPY_QSTR_BYTES_IN_LEN, str, len);
-        q_ptr[2 + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
+        memcpy(Q_GET_DATA(q_ptr), str, len);
+        Q_GET_DATA(q_ptr)[len] = '\0';
         q = qstr_add(q_ptr);
     }
     return q;
@@ -166,7 +329,7 @@ qstr qstr_from_strn(const char *str, mp_uint_t len) {
 
 byte *qstr_build_start(mp_uint_t len, byte **q_ptr) {
     assert(len < (1 << (8 * MICROPY_QSTR_BYTES_IN_LEN)));
-    *q_ptr = m_new(byte, 2 + MICROPY_QSTR_BYTES_IN_LEN + len + 1);
+    *q_ptr = m_new(byte, Q_HEADER_BYTES + len + 1);
     Q_SET_LENGTH(*q_ptr, len);
     return Q_GET_DATA(*q_ptr);
 }
@@ -176,9 +339,8 @@ qstr qstr_build_end(byte *q_ptr) {
     if (q == 0) {
         mp_uint_t len = Q_GET_LENGTH(q_ptr);
         mp_uint_t hash = qstr_compute_hash(Q_GET_DATA(q_ptr), len);
-        q_ptr[0] = hash;
-        q_ptr[1] = hash >> 8;
-        q_ptr[2 + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
+        Q_SET_HASH(q_ptr, hash);
+        Q_GET_DATA(q_ptr)[len] = '\0';
         q = qstr_add(q_ptr);
     } else {
         m_del(byte, q_ptr, Q_GET_ALLOC(q_ptr));
@@ -216,7 +378,7 @@ void qstr_pool_info(mp_uint_t *n_pool, mp_uint_t *n_qstr, mp_uint_t *n_str_data_
         *n_pool += 1;
         *n_qstr += pool->len;
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-            #if MICROPY_ENABLE_GC
+            #if MICROPY_ENABLE_GC && !MICROPY_ALLOC_QSTR_CHUNK_INIT
             *n_str_data_bytes += gc_nbytes(*q); // this counts actual bytes used in heap
             #else
             *n_str_data_bytes += Q_GET_ALLOC(*q);
@@ -31,6 +31,8 @@
 
 // qstr configuration passed to makeqstrdata.py of the form QCFG(key, value)
 QCFG(BYTES_IN_LEN, MICROPY_QSTR_BYTES_IN_LEN)
+QCFG(BYTES_IN_HASH, MICROPY_QSTR_BYTES_IN_HASH)
+QCFG(HASH, MICROPY_QSTR_HASH)
 
 Q()
 Q(*)
@@ -47,6 +49,10 @@ Q(__name__)
 Q(__hash__)
 Q(__next__)
 Q(__qualname__)
+#if MICROPY_PY_SLOTS
+Q(__slots__)
+Q(__dict__)
+#endif
 Q(__path__)
 Q(__repl_print__)
 #if MICROPY_PY___FILE__
@@ -102,6 +108,11 @@ Q(uint)
 Q(ptr)
 Q(ptr8)
 Q(ptr16)
+Q(ptr32)
+#if MICROPY_EMIT_NATIVE_FLOAT
+Q(ptrf)
+Q(ptrd)
+#endif
 #endif
 
 #if MICROPY_EMIT_INLINE_THUMB
@@ -166,6 +177,18 @@ Q(NoneType)
 Q(OrderedDict)
 #endif
 
+#if MICROPY_PY_COLLECTIONS_DEQUE
+Q(deque)
+Q(iterable)
+Q(maxlen)
+Q(append)
+Q(appendleft)
+Q(extend)
+Q(pop)
+Q(popleft)
+Q(clear)
+#endif
+
 Q(abs)
 Q(all)
 Q(any)
@@ -173,14 +196,29 @@ Q(args)
 #if MICROPY_PY_ARRAY
 Q(array)
 #endif
+#if MICROPY_PY_ARRAY_MATH
+Q(mul)
+Q(scale)
+Q(clip)
+Q(dot)
+#endif
 Q(bin)
 Q({:#b})
 Q(bool)
 #if MICROPY_PY_BUILTINS_BYTEARRAY
 Q(bytearray)
 #endif
+#if MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE
+Q(source)
+Q(reserve)
+#endif
+#if MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS
+Q(itranslate)
+Q(ixor)
+#endif
 #if MICROPY_PY_BUILTINS_MEMORYVIEW
 Q(memoryview)
+Q(cast)
 #endif
 Q(bytes)
 Q(callable)
@@ -391,6 +429,12 @@ Q(frexp)
 Q(ldexp)
 Q(degrees)
 Q(radians)
+Q(fsum)
+Q(hypot)
+#if MICROPY_PY_MATH_ARRAY_FUNCTIONS
+Q(apply)
+Q(polyval)
+#endif
 #if MICROPY_PY_MATH_SPECIAL_FUNCTIONS
 Q(erf)
 Q(erfc)
@@ -414,6 +458,36 @@ Q(mem_peak)
 #endif
 Q(mem_info)
 Q(qstr_info)
+#if MICROPY_GC_HEAP_PROFILE
+Q(heap_profile)
+#endif
+#endif
+Q(opt_level)
+
+#if MICROPY_EMIT_NATIVE_JIT
+Q(jit_threshold)
+#endif
+
+#if MICROPY_VM_PROFILE
+Q(profile)
+Q(profile_stats)
+#endif
+
+#if MICROPY_VM_SAMPLE_PROFILE
+Q(sample)
+Q(sample_stats)
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+Q(opcode_stats)
+#endif
+
+#if MICROPY_ENABLE_SCHEDULER
+Q(schedule)
+#endif
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+Q(import_cache_clear)
 #endif
 
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
@@ -468,6 +542,10 @@ Q(ustruct)
 Q(pack)
 Q(unpack)
 Q(calcsize)
+Q(pack_into)
+Q(unpack_from)
+Q(Struct)
+Q(size)
 #endif
 
 #if MICROPY_PY_UCTYPES
@@ -477,6 +555,14 @@ Q(sizeof)
 Q(addressof)
 Q(bytes_at)
 Q(bytearray_at)
+#if MICROPY_PY_UCTYPES_LAYOUT
+Q(compile)
+Q(unpack)
+Q(pack)
+Q(iter_unpack)
+Q(layout)
+Q(iterator)
+#endif
 
 Q(NATIVE)
 Q(LITTLE_ENDIAN)
@@ -527,6 +613,14 @@ Q(file)
 Q(mode)
 Q(r)
 Q(encoding)
+#if MICROPY_PY_IO_BUFFERED
+Q(BufferedReader)
+Q(BufferedWriter)
+Q(peek)
+Q(flush)
+Q(close)
+Q(write)
+#endif
 #endif
 
 #if MICROPY_PY_GC
@@ -537,6 +631,38 @@ Q(enable)
 Q(isenabled)
 Q(mem_free)
 Q(mem_alloc)
+#if MICROPY_GC_INCREMENTAL
+Q(collect_step)
+#endif
+#if MICROPY_GC_ALLOC_THRESHOLD
+Q(threshold)
+#endif
+#if MICROPY_GC_STATS
+Q(stats)
+Q(collections)
+Q(alloc_collections)
+Q(alloc_failures)
+Q(alloc_bytes)
+Q(mark_ticks)
+Q(mark_max)
+Q(sweep_ticks)
+Q(sweep_max)
+Q(pause_max)
+Q(pause_hist)
+#endif
+#endif
+
+#if MICROPY_PY_THREAD
+Q(_thread)
+Q(LockType)
+Q(lock)
+Q(acquire)
+Q(release)
+Q(locked)
+Q(start_new_thread)
+Q(get_ident)
+Q(allocate_lock)
+Q(stack_size)
 #endif
 
 #if MICROPY_PY_BUILTINS_PROPERTY
@@ -549,11 +675,32 @@ Q(deleter)
 #if MICROPY_PY_UZLIB
 Q(uzlib)
 Q(decompress)
+Q(crc32)
+Q(adler32)
+#if MICROPY_PY_UZLIB_COMPRESS
+Q(compress)
+Q(compressobj)
+Q(Compress)
+Q(flush)
+Q(level)
+Q(method)
+Q(wbits)
+#endif
+#if MICROPY_PY_UZLIB_DECOMPIO
+Q(DecompIO)
+Q(read)
+Q(readall)
+Q(readinto)
+Q(readline)
+Q(wbits)
+#endif
 #endif
 
 #if MICROPY_PY_UJSON
 Q(ujson)
+Q(dump)
 Q(dumps)
+Q(load)
 Q(loads)
 #endif
 
@@ -564,6 +711,13 @@ Q(match)
 Q(search)
 Q(group)
 Q(DEBUG)
+#if MICROPY_PY_URE_SUB
+Q(sub)
+Q(finditer)
+Q(start)
+Q(end)
+Q(span)
+#endif
 #endif
 
 #if MICROPY_PY_UHEAPQ
@@ -571,6 +725,12 @@ Q(uheapq)
 Q(heappush)
 Q(heappop)
 Q(heapify)
+#if MICROPY_PY_UHEAPQ_PQUEUE
+Q(PriorityQueue)
+Q(push)
+Q(pop)
+Q(peek)
+#endif
 #endif
 
 #if MICROPY_PY_UHASHLIB
@@ -579,11 +739,105 @@ Q(update)
 Q(digest)
 Q(hexdigest)
 Q(sha256)
+#if MICROPY_PY_UHASHLIB_SHA1
+Q(sha1)
+#endif
+#if MICROPY_PY_UHASHLIB_MD5
+Q(md5)
+#endif
 #endif
 
 #if MICROPY_PY_UBINASCII
 Q(ubinascii)
 Q(hexlify)
+Q(unhexlify)
+Q(a2b_base64)
+Q(b2a_base64)
+Q(hexlify_into)
+Q(unhexlify_into)
+Q(a2b_base64_into)
+Q(b2a_base64_into)
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB
+Q(ucryptolib)
+Q(aes)
+Q(encrypt)
+Q(decrypt)
+Q(MODE_ECB)
+Q(MODE_CBC)
+Q(MODE_CTR)
+#endif
+
+#if MICROPY_PY_UASYNCIO
+Q(_uasyncio)
+Q(Loop)
+Q(create_task)
+Q(call_later_ms)
+Q(wait_read)
+Q(wait_write)
+Q(run)
+Q(stop)
+Q(uselect)
+Q(poll)
+Q(ipoll)
+Q(register)
+Q(unregister)
+Q(modify)
+Q(POLLIN)
+Q(POLLOUT)
+#endif
+
+#if MICROPY_PY_URANDOM
+Q(urandom)
+Q(seed)
+Q(getrandbits)
+Q(randrange)
+Q(randint)
+Q(choice)
+#if MICROPY_PY_BUILTINS_FLOAT
+Q(random)
+Q(uniform)
+#endif
+#endif
+
+#if MICROPY_PY_UWEAKREF
+Q(uweakref)
+Q(ref)
+#endif
+
+#if MICROPY_PY_URINGBUF
+Q(uringbuf)
+Q(RingBuffer)
+Q(put)
+Q(get)
+Q(write)
+Q(readinto)
+Q(any)
+Q(free)
+#endif
+
+#if MICROPY_PY_FRAMEBUF
+Q(framebuf)
+Q(FrameBuffer)
+Q(MVLSB)
+Q(RGB565)
+Q(fill)
+Q(fill_rect)
+Q(pixel)
+Q(hline)
+Q(vline)
+Q(rect)
+Q(line)
+Q(blit)
+Q(text)
+#endif
+
+#if MICROPY_PY_UHTTP
+Q(uhttp)
+Q(parse_request)
+Q(parse_response)
+Q(header)
 #endif
 
 #if MICROPY_PY_MACHINE
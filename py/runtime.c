@@ -35,6 +35,7 @@
 #include "py/objtuple.h"
 #include "py/objlist.h"
 #include "py/objmodule.h"
+#include "py/objtype.h"
 #include "py/objgenerator.h"
 #include "py/smallint.h"
 #include "py/runtime0.h"
@@ -42,6 +43,7 @@
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/bc.h"
 
 #if 0 // print debugging info
 #define DEBUG_PRINT (1)
@@ -52,19 +54,49 @@
 #define DEBUG_OP_printf(...) (void)0
 #endif
 
+#if !MICROPY_MULTIPLE_INTERPRETERS
 const mp_obj_module_t mp_module___main__ = {
     .base = { &mp_type_module },
     .name = MP_QSTR___main__,
     .globals = (mp_obj_dict_t*)&MP_STATE_VM(dict_main),
 };
+#endif
 
 void mp_init(void) {
     qstr_init();
     mp_stack_ctrl_init();
 
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    MP_STATE_THREAD(current_code_state) = NULL;
+    #endif
+
+    #if MICROPY_VM_PROFILE
+    MP_STATE_THREAD(vm_profile_depth) = 0;
+    MP_STATE_VM(vm_profile_enabled) = false;
+    memset(MP_STATE_VM(vm_profile_func), 0, sizeof(MP_STATE_VM(vm_profile_func)));
+    #endif
+
+    #if MICROPY_VM_SAMPLE_PROFILE
+    MP_STATE_VM(vm_sample_enabled) = false;
+    memset(MP_STATE_VM(vm_sample), 0, sizeof(MP_STATE_VM(vm_sample)));
+    #endif
+
+    #if MICROPY_VM_OPCODE_STATS
+    memset(MP_STATE_VM(opcode_count), 0, sizeof(MP_STATE_VM(opcode_count)));
+    memset(MP_STATE_VM(opcode_pair), 0, sizeof(MP_STATE_VM(opcode_pair)));
+    MP_STATE_VM(opcode_pair_lost) = 0;
+    MP_STATE_VM(opcode_last) = 0;
+    #endif
+
     // no pending exceptions to start with
     MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
 
+    #if MICROPY_ENABLE_SCHEDULER
+    MP_STATE_VM(sched_len) = 0;
+    MP_STATE_VM(sched_idx) = 0;
+    MP_STATE_VM(sched_running) = 0;
+    #endif
+
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
     mp_init_emergency_exception_buf();
 #endif
@@ -77,26 +109,76 @@ void mp_init(void) {
     // optimization disabled by default
     MP_STATE_VM(mp_optimise_value) = 0;
 
+    #if MICROPY_EMIT_NATIVE_JIT
+    MP_STATE_VM(jit_threshold) = MICROPY_EMIT_NATIVE_JIT_THRESHOLD;
+    #endif
+
+    #if MICROPY_STACKLESS && MICROPY_STACKLESS_FRAME_POOL_SIZE > 0
+    MP_STATE_THREAD(frame_pool_top) = (byte*)MP_STATE_THREAD(frame_pool);
+    #endif
+
+    #if MICROPY_OPT_CODE_STATE_CACHE
+    for (mp_uint_t i = 0; i < MICROPY_OPT_CODE_STATE_CACHE_BUCKETS; i++) {
+        MP_STATE_VM(code_state_cache)[i] = NULL;
+        MP_STATE_VM(code_state_cache_len)[i] = 0;
+    }
+    MP_STATE_VM(code_state_cache_hit) = 0;
+    MP_STATE_VM(code_state_cache_miss) = 0;
+    #endif
+
     // init global module stuff
     mp_module_init();
 
     // initialise the __main__ module
     mp_obj_dict_init(&MP_STATE_VM(dict_main), 1);
     mp_obj_dict_store(&MP_STATE_VM(dict_main), MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR___main__));
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    MP_STATE_VM(module_main).base.type = &mp_type_module;
+    MP_STATE_VM(module_main).name = MP_QSTR___main__;
+    MP_STATE_VM(module_main).globals = &MP_STATE_VM(dict_main);
+    mp_module_register(MP_QSTR___main__, (mp_obj_t)&MP_STATE_VM(module_main));
+    #endif
 
     // locals = globals for outer module (see Objects/frameobject.c/PyFrame_New())
-    MP_STATE_CTX(dict_locals) = MP_STATE_CTX(dict_globals) = &MP_STATE_VM(dict_main);
+    MP_STATE_THREAD(dict_locals) = MP_STATE_THREAD(dict_globals) = &MP_STATE_VM(dict_main);
 
     #if MICROPY_CAN_OVERRIDE_BUILTINS
     // start with no extensions to builtins
     MP_STATE_VM(mp_module_builtins_override_dict) = NULL;
     #endif
+
+    #if MICROPY_OPT_METHOD_CACHE
+    mp_obj_type_method_cache_clear();
+    #endif
+
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    memset(MP_STATE_VM(bound_meth_cache), 0, sizeof(MP_STATE_VM(bound_meth_cache)));
+    #endif
+
+    #if MICROPY_OPT_INSTANCE_SHAPES
+    MP_STATE_VM(instance_shapes) = NULL;
+    #endif
+
+    #if MICROPY_OPT_STR_INPLACE_ADD
+    MP_STATE_VM(str_add_buf) = NULL;
+    #endif
+
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    MP_STATE_VM(str_index_obj) = MP_OBJ_NULL;
+    #endif
 }
 
 void mp_deinit(void) {
     //mp_obj_dict_free(&dict_main);
     mp_module_deinit();
 
+    #if MICROPY_VM_SAMPLE_PROFILE
+    if (MP_STATE_VM(vm_sample_enabled)) {
+        MP_STATE_VM(vm_sample_enabled) = false;
+        mp_hal_sample_timer(0);
+    }
+    #endif
+
     // call port specific deinitialization if any 
 #ifdef MICROPY_PORT_INIT_FUNC
     MICROPY_PORT_DEINIT_FUNC;
@@ -119,8 +201,8 @@ mp_obj_t mp_load_name(qstr qst) {
     // logic: search locals, globals, builtins
     DEBUG_OP_printf("load name %s\n", qstr_str(qst));
     // If we're at the outer scope (locals == globals), dispatch to load_global right away
-    if (MP_STATE_CTX(dict_locals) != MP_STATE_CTX(dict_globals)) {
-        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_CTX(dict_locals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+    if (MP_STATE_THREAD(dict_locals) != MP_STATE_THREAD(dict_globals)) {
+        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_THREAD(dict_locals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
         if (elem != NULL) {
             return elem->value;
         }
@@ -131,7 +213,7 @@ mp_obj_t mp_load_name(qstr qst) {
 mp_obj_t mp_load_global(qstr qst) {
     // logic: search globals, builtins
     DEBUG_OP_printf("load global %s\n", qstr_str(qst));
-    mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_CTX(dict_globals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+    mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_THREAD(dict_globals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
     if (elem == NULL) {
         #if MICROPY_CAN_OVERRIDE_BUILTINS
         if (MP_STATE_VM(mp_module_builtins_override_dict) != NULL) {
@@ -172,24 +254,24 @@ mp_obj_t mp_load_build_class(void) {
 
 void mp_store_name(qstr qst, mp_obj_t obj) {
     DEBUG_OP_printf("store name %s <- %p\n", qstr_str(qst), obj);
-    mp_obj_dict_store(MP_STATE_CTX(dict_locals), MP_OBJ_NEW_QSTR(qst), obj);
+    mp_obj_dict_store(MP_STATE_THREAD(dict_locals), MP_OBJ_NEW_QSTR(qst), obj);
 }
 
 void mp_delete_name(qstr qst) {
     DEBUG_OP_printf("delete name %s\n", qstr_str(qst));
     // TODO convert KeyError to NameError if qst not found
-    mp_obj_dict_delete(MP_STATE_CTX(dict_locals), MP_OBJ_NEW_QSTR(qst));
+    mp_obj_dict_delete(MP_STATE_THREAD(dict_locals), MP_OBJ_NEW_QSTR(qst));
 }
 
 void mp_store_global(qstr qst, mp_obj_t obj) {
     DEBUG_OP_printf("store global %s <- %p\n", qstr_str(qst), obj);
-    mp_obj_dict_store(MP_STATE_CTX(dict_globals), MP_OBJ_NEW_QSTR(qst), obj);
+    mp_obj_dict_store(MP_STATE_THREAD(dict_globals), MP_OBJ_NEW_QSTR(qst), obj);
 }
 
 void mp_delete_global(qstr qst) {
     DEBUG_OP_printf("delete global %s\n", qstr_str(qst));
     // TODO convert KeyError to NameError if qst not found
-    mp_obj_dict_delete(MP_STATE_CTX(dict_globals), MP_OBJ_NEW_QSTR(qst));
+    mp_obj_dict_delete(MP_STATE_THREAD(dict_globals), MP_OBJ_NEW_QSTR(qst));
 }
 
 mp_obj_t mp_unary_op(mp_uint_t op, mp_obj_t arg) {
@@ -320,8 +402,7 @@ mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
                         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative shift count"));
                     } else if (rhs_val >= (mp_int_t)BITS_PER_WORD || lhs_val > (MP_SMALL_INT_MAX >> rhs_val) || lhs_val < (MP_SMALL_INT_MIN >> rhs_val)) {
                         // left-shift will overflow, so use higher precision integer
-                        lhs = mp_obj_new_int_from_ll(lhs_val);
-                        goto generic_binary_op;
+                        goto small_int_overflow;
                     } else {
                         // use standard precision
                         lhs_val <<= rhs_val;
@@ -349,29 +430,13 @@ mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
                 case MP_BINARY_OP_INPLACE_SUBTRACT: lhs_val -= rhs_val; break;
                 case MP_BINARY_OP_MULTIPLY:
                 case MP_BINARY_OP_INPLACE_MULTIPLY: {
-
-                    // If long long type exists and is larger than mp_int_t, then
-                    // we can use the following code to perform overflow-checked multiplication.
-                    // Otherwise (eg in x64 case) we must use mp_small_int_mul_overflow.
-                    #if 0
-                    // compute result using long long precision
-                    long long res = (long long)lhs_val * (long long)rhs_val;
-                    if (res > MP_SMALL_INT_MAX || res < MP_SMALL_INT_MIN) {
-                        // result overflowed SMALL_INT, so return higher precision integer
-                        return mp_obj_new_int_from_ll(res);
-                    } else {
-                        // use standard precision
-                        lhs_val = (mp_int_t)res;
-                    }
-                    #endif
-
-                    if (mp_small_int_mul_overflow(lhs_val, rhs_val)) {
+                    mp_int_t res;
+                    if (mp_small_int_mul_checked(lhs_val, rhs_val, &res)) {
                         // use higher precision
-                        lhs = mp_obj_new_int_from_ll(lhs_val);
-                        goto generic_binary_op;
+                        goto small_int_overflow;
                     } else {
                         // use standard precision
-                        return MP_OBJ_NEW_SMALL_INT(lhs_val * rhs_val);
+                        return MP_OBJ_NEW_SMALL_INT(res);
                     }
                     break;
                 }
@@ -394,6 +459,9 @@ mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
 
                 case MP_BINARY_OP_MODULO:
                 case MP_BINARY_OP_INPLACE_MODULO: {
+                    if (rhs_val == 0) {
+                        goto zero_division;
+                    }
                     lhs_val = mp_small_int_modulo(lhs_val, rhs_val);
                     break;
                 }
@@ -408,30 +476,35 @@ mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
                         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative power with no float support"));
                         #endif
                     } else {
+                        // square-and-multiply, falling back to the long int
+                        // implementation only when the result won't fit
                         mp_int_t ans = 1;
-                        while (rhs_val > 0) {
-                            if (rhs_val & 1) {
-                                if (mp_small_int_mul_overflow(ans, lhs_val)) {
-                                    goto power_overflow;
+                        mp_int_t base = lhs_val;
+                        mp_int_t exp = rhs_val;
+                        while (exp > 0) {
+                            if (exp & 1) {
+                                if (mp_small_int_mul_checked(ans, base, &ans)) {
+                                    goto small_int_overflow;
                                 }
-                                ans *= lhs_val;
                             }
-                            if (rhs_val == 1) {
+                            if (exp == 1) {
                                 break;
                             }
-                            rhs_val /= 2;
-                            if (mp_small_int_mul_overflow(lhs_val, lhs_val)) {
-                                goto power_overflow;
+                            exp /= 2;
+                            if (mp_small_int_mul_checked(base, base, &base)) {
+                                goto small_int_overflow;
                             }
-                            lhs_val *= lhs_val;
                         }
                         lhs_val = ans;
                     }
                     break;
 
-                power_overflow:
-                    // use higher precision
-                    lhs = mp_obj_new_int_from_ll(MP_OBJ_SMALL_INT_VALUE(lhs));
+                small_int_overflow:
+                    // use higher precision; the long int implementations take
+                    // small int operands directly, so lhs needn't be converted
+                    #if MICROPY_LONGINT_IMPL == MICROPY_LONGINT_IMPL_NONE
+                    lhs = mp_obj_new_int_from_ll(MP_OBJ_SMALL_INT_VALUE(lhs)); // raises OverflowError
+                    #endif
                     goto generic_binary_op;
 
                 case MP_BINARY_OP_LESS: return MP_BOOL(lhs_val < rhs_val); break;
@@ -449,7 +522,7 @@ mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
                 return mp_obj_new_int(lhs_val);
             }
 #if MICROPY_PY_BUILTINS_FLOAT
-        } else if (MP_OBJ_IS_TYPE(rhs, &mp_type_float)) {
+        } else if (mp_obj_is_float(rhs)) {
             mp_obj_t res = mp_obj_float_binary_op(op, lhs_val, rhs);
             if (res == MP_OBJ_NULL) {
                 goto unsupported_op;
@@ -1070,6 +1143,44 @@ mp_obj_t mp_iternext(mp_obj_t o_in) {
     }
 }
 
+#if MICROPY_OPT_ITER_FUSION
+
+mp_obj_t mp_getiter_or_seq(mp_obj_t o) {
+    if (MP_OBJ_IS_TYPE(o, &mp_type_list) || MP_OBJ_IS_TYPE(o, &mp_type_tuple)) {
+        return o;
+    }
+    return mp_getiter(o);
+}
+
+mp_int_t mp_len_hint_or_seq(mp_obj_t iter, mp_uint_t idx) {
+    mp_int_t len = mp_obj_len_hint(iter);
+    if (MP_OBJ_IS_TYPE(iter, &mp_type_list) || MP_OBJ_IS_TYPE(iter, &mp_type_tuple)) {
+        len = (mp_uint_t)len > idx ? len - (mp_int_t)idx : 0;
+    }
+    return len;
+}
+
+// For a for loop that unpacks each item into num values: gets the values of
+// the next item of an enumerate, zip or dict.items() into items[], in the
+// order that mp_unpack_sequence leaves them, without making a tuple.  Returns
+// MP_OBJ_STOP_ITERATION at the end, MP_OBJ_SENTINEL (before taking anything
+// from the iterator) if the values can't be got this way, else mp_const_none.
+// (MP_OBJ_NULL can't be used for the latter because it is the same as
+// MP_OBJ_STOP_ITERATION in non-debug builds.)
+mp_obj_t mp_iternext_unpack(mp_obj_t iter, mp_uint_t num, mp_obj_t *items) {
+    #if MICROPY_PY_BUILTINS_ENUMERATE
+    if (MP_OBJ_IS_TYPE(iter, &mp_type_enumerate)) {
+        return mp_obj_enumerate_iternext_unpack(iter, num, items);
+    }
+    #endif
+    if (MP_OBJ_IS_TYPE(iter, &mp_type_zip)) {
+        return mp_obj_zip_iternext_unpack(iter, num, items);
+    }
+    return mp_obj_dict_view_iternext_unpack(iter, num, items);
+}
+
+#endif
+
 // TODO: Unclear what to do with StopIterarion exception here.
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val) {
     assert((send_value != MP_OBJ_NULL) ^ (throw_value != MP_OBJ_NULL));
@@ -1229,6 +1340,18 @@ void mp_import_all(mp_obj_t module) {
     }
 }
 
+#if MICROPY_PARSE_STREAMING
+typedef struct _compile_execute_stmt_t {
+    qstr source_name;
+    mp_map_t consts;
+} compile_execute_stmt_t;
+
+STATIC void compile_execute_stmt(void *env, mp_parse_tree_t *parse_tree) {
+    compile_execute_stmt_t *ces = env;
+    mp_call_function_0(mp_compile_stmt(parse_tree, ces->source_name, &ces->consts));
+}
+#endif
+
 // this is implemented in this file so it can optimise access to locals/globals
 mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_input_kind, mp_obj_dict_t *globals, mp_obj_dict_t *locals) {
     // save context
@@ -1242,8 +1365,24 @@ mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_i
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
         qstr source_name = lex->source_name;
-        mp_parse_node_t pn = mp_parse(lex, parse_input_kind);
-        mp_obj_t module_fun = mp_compile(pn, source_name, MP_EMIT_OPT_NONE, false);
+
+        #if MICROPY_PARSE_STREAMING
+        if (parse_input_kind == MP_PARSE_FILE_INPUT && globals != NULL) {
+            // run each statement as soon as it's parsed, then free it
+            compile_execute_stmt_t ces;
+            ces.source_name = source_name;
+            mp_map_init(&ces.consts, 0);
+            mp_parse_file_stmts(lex, compile_execute_stmt, &ces);
+            mp_map_deinit(&ces.consts);
+            nlr_pop();
+            mp_globals_set(old_globals);
+            mp_locals_set(old_locals);
+            return mp_const_none;
+        }
+        #endif
+
+        mp_parse_tree_t parse_tree = mp_parse(lex, parse_input_kind);
+        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
 
         mp_obj_t ret;
         if (MICROPY_PY_BUILTINS_COMPILE && globals == NULL) {
@@ -63,6 +63,11 @@ extern const qstr mp_binary_op_method_name[];
 void mp_init(void);
 void mp_deinit(void);
 
+#if MICROPY_ENABLE_SCHEDULER
+bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg);
+void mp_sched_run_pending(void);
+#endif
+
 // extra printing method specifically for mp_obj_t's which are integral type
 int mp_print_mp_int(const mp_print_t *print, mp_obj_t x, int base, int base_char, int flags, char fill, int width, int prec);
 
@@ -72,10 +77,10 @@ void mp_arg_parse_all_kw_array(mp_uint_t n_pos, mp_uint_t n_kw, const mp_obj_t *
 NORETURN void mp_arg_error_terse_mismatch(void);
 NORETURN void mp_arg_error_unimpl_kw(void);
 
-static inline mp_obj_dict_t *mp_locals_get(void) { return MP_STATE_CTX(dict_locals); }
-static inline void mp_locals_set(mp_obj_dict_t *d) { MP_STATE_CTX(dict_locals) = d; }
-static inline mp_obj_dict_t *mp_globals_get(void) { return MP_STATE_CTX(dict_globals); }
-static inline void mp_globals_set(mp_obj_dict_t *d) { MP_STATE_CTX(dict_globals) = d; }
+static inline mp_obj_dict_t *mp_locals_get(void) { return MP_STATE_THREAD(dict_locals); }
+static inline void mp_locals_set(mp_obj_dict_t *d) { MP_STATE_THREAD(dict_locals) = d; }
+static inline mp_obj_dict_t *mp_globals_get(void) { return MP_STATE_THREAD(dict_globals); }
+static inline void mp_globals_set(mp_obj_dict_t *d) { MP_STATE_THREAD(dict_globals) = d; }
 
 mp_obj_t mp_load_name(qstr qst);
 mp_obj_t mp_load_global(qstr qst);
@@ -88,6 +93,24 @@ void mp_delete_global(qstr qst);
 mp_obj_t mp_unary_op(mp_uint_t op, mp_obj_t arg);
 mp_obj_t mp_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs);
 
+#if MICROPY_OPT_NUMERIC_SEQ
+// Computes lhs < rhs into *res without calling mp_binary_op when both are
+// small ints or both are floats; returns false for anything else.
+static inline bool mp_binary_op_less_fast(mp_obj_t lhs, mp_obj_t rhs, bool *res) {
+    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+        *res = MP_OBJ_SMALL_INT_VALUE(lhs) < MP_OBJ_SMALL_INT_VALUE(rhs);
+        return true;
+    }
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (mp_obj_is_float(lhs) && mp_obj_is_float(rhs)) {
+        *res = mp_obj_float_get(lhs) < mp_obj_float_get(rhs);
+        return true;
+    }
+    #endif
+    return false;
+}
+#endif
+
 mp_obj_t mp_load_const_int(qstr qst);
 mp_obj_t mp_load_const_dec(qstr qst);
 mp_obj_t mp_load_const_str(qstr qst);
@@ -98,6 +121,7 @@ mp_obj_t mp_call_function_1(mp_obj_t fun, mp_obj_t arg);
 mp_obj_t mp_call_function_2(mp_obj_t fun, mp_obj_t arg1, mp_obj_t arg2);
 mp_obj_t mp_call_function_n_kw(mp_obj_t fun, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
 mp_obj_t mp_call_method_n_kw(mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
+mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
 mp_obj_t mp_call_method_n_kw_var(bool have_self, mp_uint_t n_args_n_kw, const mp_obj_t *args);
 
 typedef struct _mp_call_args_t {
@@ -126,6 +150,31 @@ void mp_store_attr(mp_obj_t base, qstr attr, mp_obj_t val);
 mp_obj_t mp_getiter(mp_obj_t o);
 mp_obj_t mp_iternext_allow_raise(mp_obj_t o); // may return MP_OBJ_STOP_ITERATION instead of raising StopIteration()
 mp_obj_t mp_iternext(mp_obj_t o); // will always return MP_OBJ_STOP_ITERATION instead of raising StopIteration(...)
+
+#if MICROPY_OPT_ITER_FUSION
+// map, filter, zip and enumerate keep a list or tuple source as it is, and
+// step through it with an index, instead of an iterator over it.  idx is
+// ignored for any other source.
+mp_obj_t mp_getiter_or_seq(mp_obj_t o);
+static inline mp_obj_t mp_iternext_or_seq(mp_obj_t iter, mp_uint_t idx) {
+    mp_uint_t len;
+    mp_obj_t *items;
+    if (MP_OBJ_IS_TYPE(iter, &mp_type_list)) {
+        mp_obj_list_get(iter, &len, &items);
+    } else if (MP_OBJ_IS_TYPE(iter, &mp_type_tuple)) {
+        mp_obj_tuple_get(iter, &len, &items);
+    } else {
+        return mp_iternext(iter);
+    }
+    return idx < len ? items[idx] : MP_OBJ_STOP_ITERATION;
+}
+mp_int_t mp_len_hint_or_seq(mp_obj_t iter, mp_uint_t idx);
+mp_obj_t mp_iternext_unpack(mp_obj_t iter, mp_uint_t num, mp_obj_t *items);
+#else
+#define mp_getiter_or_seq(o) mp_getiter(o)
+#define mp_iternext_or_seq(iter, idx) mp_iternext(iter)
+#define mp_len_hint_or_seq(iter, idx) mp_obj_len_hint(iter)
+#endif
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val);
 
 mp_obj_t mp_make_raise_obj(mp_obj_t o);
@@ -41,11 +41,12 @@
 */
 #define MP_SCOPE_FLAG_NOFREE       0x40
 
-// types for native (viper) function signature
+// types for native (viper) function signature, each fits in 4 bits
 #define MP_NATIVE_TYPE_OBJ  (0x00)
 #define MP_NATIVE_TYPE_BOOL (0x01)
 #define MP_NATIVE_TYPE_INT  (0x02)
 #define MP_NATIVE_TYPE_UINT (0x03)
+#define MP_NATIVE_TYPE_FLOAT (0x04)
 
 typedef enum {
     MP_UNARY_OP_BOOL, // __bool__
@@ -56,6 +57,9 @@ typedef enum {
     // The NOT op is only implemented by bool.  The emitter must synthesise NOT
     // for other types by calling BOOL then inverting (eg by then calling NOT).
     MP_UNARY_OP_NOT,
+    // LEN_HINT is never emitted; native iterators may implement it to return
+    // the number of items they have left, see mp_obj_len_hint.
+    MP_UNARY_OP_LEN_HINT,
 } mp_unary_op_t;
 
 typedef enum {
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "py/runtime.h"
+
+#if MICROPY_ENABLE_SCHEDULER
+
+// The scheduler is a small circular queue of (function, arg) pairs.  It may
+// be appended to from an IRQ handler with mp_sched_schedule, and is drained
+// by the VM between bytecodes, so the callbacks run as normal Python code and
+// are free to allocate memory.
+
+// Queue a call of function(arg).  Safe to call from an IRQ handler; does not
+// allocate.  Returns false if the queue is full.
+bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg) {
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    bool ret;
+    if (MP_STATE_VM(sched_len) < MICROPY_SCHEDULER_DEPTH) {
+        uint8_t i = (MP_STATE_VM(sched_idx) + MP_STATE_VM(sched_len)) % MICROPY_SCHEDULER_DEPTH;
+        MP_STATE_VM(sched_queue)[i].func = function;
+        MP_STATE_VM(sched_queue)[i].arg = arg;
+        MP_STATE_VM(sched_len) += 1;
+        ret = true;
+    } else {
+        ret = false;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return ret;
+}
+
+// Run all queued callbacks.  Called by the VM when sched_len is non-zero.
+// Callbacks don't nest: anything scheduled while one runs is picked up by
+// the loop below.  An exception from a callback propagates to the code that
+// was interrupted, and the remaining callbacks stay queued.
+void mp_sched_run_pending(void) {
+    if (MP_STATE_VM(sched_running)) {
+        return;
+    }
+    MP_STATE_VM(sched_running) = 1;
+    while (MP_STATE_VM(sched_len) != 0) {
+        mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        mp_sched_item_t item = MP_STATE_VM(sched_queue)[MP_STATE_VM(sched_idx)];
+        MP_STATE_VM(sched_queue)[MP_STATE_VM(sched_idx)].func = MP_OBJ_NULL;
+        MP_STATE_VM(sched_queue)[MP_STATE_VM(sched_idx)].arg = MP_OBJ_NULL;
+        MP_STATE_VM(sched_idx) = (MP_STATE_VM(sched_idx) + 1) % MICROPY_SCHEDULER_DEPTH;
+        MP_STATE_VM(sched_len) -= 1;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            mp_call_function_1(item.func, item.arg);
+            nlr_pop();
+        } else {
+            MP_STATE_VM(sched_running) = 0;
+            nlr_jump(nlr.ret_val);
+        }
+    }
+    MP_STATE_VM(sched_running) = 0;
+}
+
+#endif // MICROPY_ENABLE_SCHEDULER
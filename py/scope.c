@@ -25,11 +25,14 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "py/scope.h"
 
-scope_t *scope_new(scope_kind_t kind, mp_parse_node_t pn, qstr source_file, mp_uint_t emit_options) {
-    scope_t *scope = m_new0(scope_t, 1);
+scope_t *scope_new(mp_parse_tree_t *tree, scope_kind_t kind, mp_parse_node_t pn, qstr source_file, mp_uint_t emit_options) {
+    scope_t *scope = mp_parse_tree_alloc(tree, sizeof(scope_t));
+    memset(scope, 0, sizeof(scope_t));
+    scope->tree = tree;
     scope->kind = kind;
     scope->pn = pn;
     scope->source_file = source_file;
@@ -63,16 +66,11 @@ scope_t *scope_new(scope_kind_t kind, mp_parse_node_t pn, qstr source_file, mp_u
     scope->raw_code = mp_emit_glue_new_raw_code();
     scope->emit_options = emit_options;
     scope->id_info_alloc = MICROPY_ALLOC_SCOPE_ID_INIT;
-    scope->id_info = m_new(id_info_t, scope->id_info_alloc);
+    scope->id_info = mp_parse_tree_alloc(tree, scope->id_info_alloc * sizeof(id_info_t));
 
     return scope;
 }
 
-void scope_free(scope_t *scope) {
-    m_del(id_info_t, scope->id_info, scope->id_info_alloc);
-    m_del(scope_t, scope, 1);
-}
-
 id_info_t *scope_find_or_add_id(scope_t *scope, qstr qst, bool *added) {
     id_info_t *id_info = scope_find(scope, qst);
     if (id_info != NULL) {
@@ -82,7 +80,10 @@ id_info_t *scope_find_or_add_id(scope_t *scope, qstr qst, bool *added) {
 
     // make sure we have enough memory
     if (scope->id_info_len >= scope->id_info_alloc) {
-        scope->id_info = m_renew(id_info_t, scope->id_info, scope->id_info_alloc, scope->id_info_alloc + MICROPY_ALLOC_SCOPE_ID_INC);
+        // the old array stays in the parse tree until it's cleared
+        id_info_t *new_info = mp_parse_tree_alloc(scope->tree, (scope->id_info_alloc + MICROPY_ALLOC_SCOPE_ID_INC) * sizeof(id_info_t));
+        memcpy(new_info, scope->id_info, scope->id_info_len * sizeof(id_info_t));
+        scope->id_info = new_info;
         scope->id_info_alloc += MICROPY_ALLOC_SCOPE_ID_INC;
     }
 
@@ -41,6 +41,8 @@ enum {
     ID_FLAG_IS_PARAM = 0x01,
     ID_FLAG_IS_STAR_PARAM = 0x02,
     ID_FLAG_IS_DBL_STAR_PARAM = 0x04,
+    ID_FLAG_IS_REBOUND = 0x08, // assigned to or deleted besides being a param, or declared nonlocal by a child
+    ID_FLAG_IS_BY_VALUE = 0x10, // a cell/free var that holds its value directly instead of a cell
 };
 
 typedef struct _id_info_t {
@@ -56,6 +58,7 @@ typedef struct _id_info_t {
 typedef enum { SCOPE_MODULE, SCOPE_FUNCTION, SCOPE_LAMBDA, SCOPE_LIST_COMP, SCOPE_DICT_COMP, SCOPE_SET_COMP, SCOPE_GEN_EXPR, SCOPE_CLASS } scope_kind_t;
 typedef struct _scope_t {
     scope_kind_t kind;
+    mp_parse_tree_t *tree; // the scope and its ids are allocated from this
     struct _scope_t *parent;
     struct _scope_t *next;
     mp_parse_node_t pn;
@@ -74,8 +77,7 @@ typedef struct _scope_t {
     id_info_t *id_info;
 } scope_t;
 
-scope_t *scope_new(scope_kind_t kind, mp_parse_node_t pn, qstr source_file, mp_uint_t emit_options);
-void scope_free(scope_t *scope);
+scope_t *scope_new(mp_parse_tree_t *tree, scope_kind_t kind, mp_parse_node_t pn, qstr source_file, mp_uint_t emit_options);
 id_info_t *scope_find_or_add_id(scope_t *scope, qstr qstr, bool *added);
 id_info_t *scope_find(scope_t *scope, qstr qstr);
 id_info_t *scope_find_global(scope_t *scope, qstr qstr);
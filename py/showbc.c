@@ -27,8 +27,10 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include "py/mpstate.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/runtime.h"
 
 #if MICROPY_DEBUG_PRINTERS
 
@@ -40,6 +42,18 @@
 }
 #define DECODE_ULABEL do { unum = (ip[0] | (ip[1] << 8)); ip += 2; } while (0)
 #define DECODE_SLABEL do { unum = (ip[0] | (ip[1] << 8)) - 0x8000; ip += 2; } while (0)
+
+#if MICROPY_PERSISTENT_CODE
+
+#define DECODE_QSTR \
+    qst = ip[0] | ip[1] << 8; \
+    ip += 2
+#define DECODE_PTR \
+    DECODE_UINT; \
+    unum = mp_showbc_const_table[unum]
+
+#else
+
 #define DECODE_QSTR { \
     qst = 0; \
     do { \
@@ -52,18 +66,22 @@
     ip += sizeof(mp_uint_t); \
 } while (0)
 
+#endif
+
 const byte *mp_showbc_code_start;
+const mp_uint_t *mp_showbc_const_table;
 
-void mp_bytecode_print(const void *descr, mp_uint_t n_total_args, const byte *ip, mp_uint_t len) {
+void mp_bytecode_print(const void *descr, mp_uint_t n_total_args, const byte *ip, mp_uint_t len, const mp_uint_t *const_table) {
     mp_showbc_code_start = ip;
+    mp_showbc_const_table = const_table;
 
     // get code info size
     const byte *code_info = ip;
     mp_uint_t code_info_size = mp_decode_uint(&code_info);
     ip += code_info_size;
 
-    qstr block_name = mp_decode_uint(&code_info);
-    qstr source_file = mp_decode_uint(&code_info);
+    qstr block_name = mp_decode_code_info_qstr(&code_info);
+    qstr source_file = mp_decode_code_info_qstr(&code_info);
     printf("File %s, code block '%s' (descriptor: %p, bytecode @%p " UINT_FMT " bytes)\n",
         qstr_str(source_file), qstr_str(block_name), descr, code_info, len);
 
@@ -80,8 +98,12 @@ void mp_bytecode_print(const void *descr, mp_uint_t n_total_args, const byte *ip
     // bytecode prelude: arg names (as qstr objects)
     printf("arg names:");
     for (mp_uint_t i = 0; i < n_total_args; i++) {
+        #if MICROPY_PERSISTENT_CODE
+        printf(" %s", qstr_str(MP_OBJ_QSTR_VALUE(const_table[i])));
+        #else
         printf(" %s", qstr_str(MP_OBJ_QSTR_VALUE(*(mp_obj_t*)ip)));
         ip += sizeof(mp_obj_t);
+        #endif
     }
     printf("\n");
 
@@ -375,6 +397,33 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("NOT");
             break;
 
+        case MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT:
+            printf("LOAD_FAST_BINARY_OP_SMALL_INT %d %d " INT_FMT, ip[0], ip[1], (mp_int_t)(int8_t)ip[2]);
+            ip += 3;
+            break;
+
+        case MP_BC_STORE_FAST_BINARY_OP_SMALL_INT:
+            printf("STORE_FAST_BINARY_OP_SMALL_INT %d %d " INT_FMT, ip[0], ip[1], (mp_int_t)(int8_t)ip[2]);
+            ip += 3;
+            break;
+
+        case MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE:
+        case MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE: {
+            const byte *args = ip;
+            ip += 3;
+            DECODE_SLABEL;
+            printf("BINARY_OP_SMALL_INT_POP_JUMP_IF_%s %d %d " INT_FMT " " UINT_FMT,
+                args[-1] == MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE ? "TRUE" : "FALSE",
+                args[0], args[1], (mp_int_t)(int8_t)args[2], ip + unum - mp_showbc_code_start);
+            break;
+        }
+
+        case MP_BC_FOR_RANGE_SMALL_INT:
+            DECODE_ULABEL; // jump if the range is exhausted
+            printf("FOR_RANGE_SMALL_INT " UINT_FMT " " INT_FMT, ip + unum - mp_showbc_code_start, (mp_int_t)(int8_t)ip[0]);
+            ip += 1;
+            break;
+
         case MP_BC_BUILD_TUPLE:
             DECODE_UINT;
             printf("BUILD_TUPLE " UINT_FMT, unum);
@@ -534,3 +583,173 @@ void mp_bytecode_print2(const byte *ip, mp_uint_t len) {
 }
 
 #endif // MICROPY_DEBUG_PRINTERS
+
+#if MICROPY_VM_OPCODE_STATS
+
+// names of the opcodes below MP_BC_LOAD_CONST_SMALL_INT_MULTI; the ones from
+// there on encode a value, and are named by print_opcode
+STATIC const char *const opcode_name_table[MP_BC_LOAD_CONST_SMALL_INT_MULTI] = {
+    [MP_BC_LOAD_CONST_FALSE] = "LOAD_CONST_FALSE",
+    [MP_BC_LOAD_CONST_NONE] = "LOAD_CONST_NONE",
+    [MP_BC_LOAD_CONST_TRUE] = "LOAD_CONST_TRUE",
+    [MP_BC_LOAD_CONST_SMALL_INT] = "LOAD_CONST_SMALL_INT",
+    [MP_BC_LOAD_CONST_BYTES] = "LOAD_CONST_BYTES",
+    [MP_BC_LOAD_CONST_STRING] = "LOAD_CONST_STRING",
+    [MP_BC_LOAD_CONST_OBJ] = "LOAD_CONST_OBJ",
+    [MP_BC_LOAD_NULL] = "LOAD_NULL",
+    [MP_BC_LOAD_FAST_N] = "LOAD_FAST_N",
+    [MP_BC_LOAD_DEREF] = "LOAD_DEREF",
+    [MP_BC_LOAD_NAME] = "LOAD_NAME",
+    [MP_BC_LOAD_GLOBAL] = "LOAD_GLOBAL",
+    [MP_BC_LOAD_ATTR] = "LOAD_ATTR",
+    [MP_BC_LOAD_METHOD] = "LOAD_METHOD",
+    [MP_BC_LOAD_BUILD_CLASS] = "LOAD_BUILD_CLASS",
+    [MP_BC_LOAD_SUBSCR] = "LOAD_SUBSCR",
+    [MP_BC_STORE_FAST_N] = "STORE_FAST_N",
+    [MP_BC_STORE_DEREF] = "STORE_DEREF",
+    [MP_BC_STORE_NAME] = "STORE_NAME",
+    [MP_BC_STORE_GLOBAL] = "STORE_GLOBAL",
+    [MP_BC_STORE_ATTR] = "STORE_ATTR",
+    [MP_BC_STORE_SUBSCR] = "STORE_SUBSCR",
+    [MP_BC_DELETE_FAST] = "DELETE_FAST",
+    [MP_BC_DELETE_DEREF] = "DELETE_DEREF",
+    [MP_BC_DELETE_NAME] = "DELETE_NAME",
+    [MP_BC_DELETE_GLOBAL] = "DELETE_GLOBAL",
+    [MP_BC_DUP_TOP] = "DUP_TOP",
+    [MP_BC_DUP_TOP_TWO] = "DUP_TOP_TWO",
+    [MP_BC_POP_TOP] = "POP_TOP",
+    [MP_BC_ROT_TWO] = "ROT_TWO",
+    [MP_BC_ROT_THREE] = "ROT_THREE",
+    [MP_BC_JUMP] = "JUMP",
+    [MP_BC_POP_JUMP_IF_TRUE] = "POP_JUMP_IF_TRUE",
+    [MP_BC_POP_JUMP_IF_FALSE] = "POP_JUMP_IF_FALSE",
+    [MP_BC_JUMP_IF_TRUE_OR_POP] = "JUMP_IF_TRUE_OR_POP",
+    [MP_BC_JUMP_IF_FALSE_OR_POP] = "JUMP_IF_FALSE_OR_POP",
+    [MP_BC_SETUP_WITH] = "SETUP_WITH",
+    [MP_BC_WITH_CLEANUP] = "WITH_CLEANUP",
+    [MP_BC_SETUP_EXCEPT] = "SETUP_EXCEPT",
+    [MP_BC_SETUP_FINALLY] = "SETUP_FINALLY",
+    [MP_BC_END_FINALLY] = "END_FINALLY",
+    [MP_BC_GET_ITER] = "GET_ITER",
+    [MP_BC_FOR_ITER] = "FOR_ITER",
+    [MP_BC_POP_BLOCK] = "POP_BLOCK",
+    [MP_BC_POP_EXCEPT] = "POP_EXCEPT",
+    [MP_BC_UNWIND_JUMP] = "UNWIND_JUMP",
+    [MP_BC_NOT] = "NOT",
+    [MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT] = "LOAD_FAST_BINARY_OP_SMALL_INT",
+    [MP_BC_STORE_FAST_BINARY_OP_SMALL_INT] = "STORE_FAST_BINARY_OP_SMALL_INT",
+    [MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE] = "BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE",
+    [MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE] = "BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE",
+    [MP_BC_FOR_RANGE_SMALL_INT] = "FOR_RANGE_SMALL_INT",
+    [MP_BC_BUILD_TUPLE] = "BUILD_TUPLE",
+    [MP_BC_BUILD_LIST] = "BUILD_LIST",
+    [MP_BC_LIST_APPEND] = "LIST_APPEND",
+    [MP_BC_BUILD_MAP] = "BUILD_MAP",
+    [MP_BC_STORE_MAP] = "STORE_MAP",
+    [MP_BC_MAP_ADD] = "MAP_ADD",
+    [MP_BC_BUILD_SET] = "BUILD_SET",
+    [MP_BC_SET_ADD] = "SET_ADD",
+    [MP_BC_BUILD_SLICE] = "BUILD_SLICE",
+    [MP_BC_UNPACK_SEQUENCE] = "UNPACK_SEQUENCE",
+    [MP_BC_UNPACK_EX] = "UNPACK_EX",
+    [MP_BC_RETURN_VALUE] = "RETURN_VALUE",
+    [MP_BC_RAISE_VARARGS] = "RAISE_VARARGS",
+    [MP_BC_YIELD_VALUE] = "YIELD_VALUE",
+    [MP_BC_YIELD_FROM] = "YIELD_FROM",
+    [MP_BC_MAKE_FUNCTION] = "MAKE_FUNCTION",
+    [MP_BC_MAKE_FUNCTION_DEFARGS] = "MAKE_FUNCTION_DEFARGS",
+    [MP_BC_MAKE_CLOSURE] = "MAKE_CLOSURE",
+    [MP_BC_MAKE_CLOSURE_DEFARGS] = "MAKE_CLOSURE_DEFARGS",
+    [MP_BC_CALL_FUNCTION] = "CALL_FUNCTION",
+    [MP_BC_CALL_FUNCTION_VAR_KW] = "CALL_FUNCTION_VAR_KW",
+    [MP_BC_CALL_METHOD] = "CALL_METHOD",
+    [MP_BC_CALL_METHOD_VAR_KW] = "CALL_METHOD_VAR_KW",
+    [MP_BC_IMPORT_NAME] = "IMPORT_NAME",
+    [MP_BC_IMPORT_FROM] = "IMPORT_FROM",
+    [MP_BC_IMPORT_STAR] = "IMPORT_STAR",
+};
+
+// print the name of op, in the style of mp_bytecode_print_str
+STATIC void print_opcode(const mp_print_t *print, mp_uint_t op) {
+    if (op < MP_BC_LOAD_CONST_SMALL_INT_MULTI) {
+        const char *name = opcode_name_table[op];
+        if (name != NULL) {
+            mp_print_str(print, name);
+        } else {
+            mp_printf(print, "0x%02x", (uint)op);
+        }
+    } else if (op < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
+        mp_printf(print, "LOAD_CONST_SMALL_INT " INT_FMT, (mp_int_t)op - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16);
+    } else if (op < MP_BC_LOAD_FAST_MULTI + 16) {
+        mp_printf(print, "LOAD_FAST " UINT_FMT, op - MP_BC_LOAD_FAST_MULTI);
+    } else if (op < MP_BC_STORE_FAST_MULTI + 16) {
+        mp_printf(print, "STORE_FAST " UINT_FMT, op - MP_BC_STORE_FAST_MULTI);
+    } else if (op < MP_BC_UNARY_OP_MULTI + 5) {
+        mp_printf(print, "UNARY_OP %q", mp_unary_op_method_name[op - MP_BC_UNARY_OP_MULTI]);
+    } else if (op < MP_BC_BINARY_OP_MULTI + 35) {
+        mp_printf(print, "BINARY_OP %q", mp_binary_op_method_name[op - MP_BC_BINARY_OP_MULTI]);
+    } else {
+        mp_printf(print, "0x%02x", (uint)op);
+    }
+}
+
+// Print the n most frequently executed opcodes, and pairs of consecutive
+// opcodes, with their share of all those executed.
+void mp_bytecode_print_opcode_stats(const mp_print_t *print, mp_uint_t n) {
+    const mp_uint_t *count = MP_STATE_VM(opcode_count);
+    const mp_vm_opcode_pair_t *pair = MP_STATE_VM(opcode_pair);
+    mp_uint_t total = 0;
+    for (mp_uint_t i = 0; i < 256; i++) {
+        total += count[i];
+    }
+    mp_printf(print, "opcodes: " UINT_FMT "\n", total);
+    if (total == 0) {
+        return;
+    }
+
+    // select the largest counts in turn; ties are taken in index order
+    mp_uint_t last_count = (mp_uint_t)-1, last_i = 0;
+    for (mp_uint_t k = 0; k < n; k++) {
+        mp_uint_t best = 256;
+        for (mp_uint_t i = 0; i < 256; i++) {
+            if (count[i] != 0 && (count[i] < last_count || (count[i] == last_count && i > last_i))
+                && (best == 256 || count[i] > count[best])) {
+                best = i;
+            }
+        }
+        if (best == 256) {
+            break;
+        }
+        mp_printf(print, "%10u %3u%% ", (uint)count[best], (uint)((uint64_t)count[best] * 100 / total));
+        print_opcode(print, best);
+        mp_print_str(print, "\n");
+        last_count = count[best];
+        last_i = best;
+    }
+
+    mp_printf(print, "opcode pairs: " UINT_FMT " not counted\n", MP_STATE_VM(opcode_pair_lost));
+    last_count = (mp_uint_t)-1;
+    last_i = 0;
+    for (mp_uint_t k = 0; k < n; k++) {
+        mp_uint_t best = MICROPY_VM_OPCODE_STATS_PAIRS;
+        for (mp_uint_t i = 0; i < MICROPY_VM_OPCODE_STATS_PAIRS; i++) {
+            mp_uint_t c = pair[i].count;
+            if (pair[i].pair != 0 && (c < last_count || (c == last_count && i > last_i))
+                && (best == MICROPY_VM_OPCODE_STATS_PAIRS || c > pair[best].count)) {
+                best = i;
+            }
+        }
+        if (best == MICROPY_VM_OPCODE_STATS_PAIRS) {
+            break;
+        }
+        mp_printf(print, "%10u %3u%% ", (uint)pair[best].count, (uint)((uint64_t)pair[best].count * 100 / total));
+        print_opcode(print, pair[best].pair >> 8);
+        mp_print_str(print, ", ");
+        print_opcode(print, pair[best].pair & 0xff);
+        mp_print_str(print, "\n");
+        last_count = pair[best].count;
+        last_i = best;
+    }
+}
+
+#endif // MICROPY_VM_OPCODE_STATS
@@ -26,6 +26,7 @@
 
 #include "py/smallint.h"
 
+#if defined(MP_SMALL_INT_MUL_DIVIDE)
 bool mp_small_int_mul_overflow(mp_int_t x, mp_int_t y) {
     // Check for multiply overflow; see CERT INT32-C
     if (x > 0) { // x is positive
@@ -51,6 +52,7 @@ bool mp_small_int_mul_overflow(mp_int_t x, mp_int_t y) {
     } // End if x is nonpositive
     return false;
 }
+#endif
 
 mp_int_t mp_small_int_modulo(mp_int_t dividend, mp_int_t divisor) {
     // Python specs require that mod has same sign as second operand
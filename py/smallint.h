@@ -32,21 +32,71 @@
 // Functions for small integer arithmetic
 
 // In SMALL_INT, next-to-highest bits is used as sign, so both must match for value in range
-#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A
+// MP_SMALL_INT_BITS is the number of bits in a small int, including the sign
+#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D
 
+#define MP_SMALL_INT_BITS (BITS_PER_WORD - 1)
 #define MP_SMALL_INT_MIN ((mp_int_t)(((mp_int_t)WORD_MSBIT_HIGH) >> 1))
 #define MP_SMALL_INT_FITS(n) ((((n) ^ ((n) << 1)) & WORD_MSBIT_HIGH) == 0)
 
 #elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B
 
+#define MP_SMALL_INT_BITS (BITS_PER_WORD - 2)
 #define MP_SMALL_INT_MIN ((mp_int_t)(((mp_int_t)WORD_MSBIT_HIGH) >> 2))
 #define MP_SMALL_INT_FITS(n) ((((n) & MP_SMALL_INT_MIN) == 0) || (((n) & MP_SMALL_INT_MIN) == MP_SMALL_INT_MIN))
 
+#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C
+
+// small ints have 48 bits, the top 16 bits of the word are the object tag
+#define MP_SMALL_INT_BITS (48)
+#define MP_SMALL_INT_MIN ((mp_int_t)(((mp_int_t)WORD_MSBIT_HIGH) >> 16))
+#define MP_SMALL_INT_FITS(n) ((((n) & MP_SMALL_INT_MIN) == 0) || (((n) & MP_SMALL_INT_MIN) == MP_SMALL_INT_MIN))
+
 #endif
 
 #define MP_SMALL_INT_MAX ((mp_int_t)(~(MP_SMALL_INT_MIN)))
 
+// Overflow-checked multiplication: mp_small_int_mul_checked stores x * y in
+// *res and returns false if the product fits in a small int, else returns
+// true.  It uses the compiler's overflow builtin where there is one, else a
+// double-width product on 32-bit machines, else a division-based test.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_mul_overflow)
+#define MP_SMALL_INT_MUL_BUILTIN (1)
+#endif
+#elif defined(__GNUC__) && __GNUC__ >= 5
+#define MP_SMALL_INT_MUL_BUILTIN (1)
+#endif
+
+#if defined(MP_SMALL_INT_MUL_BUILTIN)
+static inline bool mp_small_int_mul_checked(mp_int_t x, mp_int_t y, mp_int_t *res) {
+    return __builtin_mul_overflow(x, y, res) || !MP_SMALL_INT_FITS(*res);
+}
+#else
+#define MP_SMALL_INT_MUL_DIVIDE (1)
 bool mp_small_int_mul_overflow(mp_int_t x, mp_int_t y);
+static inline bool mp_small_int_mul_checked(mp_int_t x, mp_int_t y, mp_int_t *res) {
+    // the size test is resolved at compile time
+    if (sizeof(mp_int_t) < sizeof(long long)) {
+        long long r = (long long)x * (long long)y;
+        *res = (mp_int_t)r;
+        return r > MP_SMALL_INT_MAX || r < MP_SMALL_INT_MIN;
+    }
+    if (mp_small_int_mul_overflow(x, y)) {
+        return true;
+    }
+    *res = x * y;
+    return false;
+}
+#endif
+
+#if !defined(MP_SMALL_INT_MUL_DIVIDE)
+static inline bool mp_small_int_mul_overflow(mp_int_t x, mp_int_t y) {
+    mp_int_t res;
+    return mp_small_int_mul_checked(x, y, &res);
+}
+#endif
+
 mp_int_t mp_small_int_modulo(mp_int_t dividend, mp_int_t divisor);
 mp_int_t mp_small_int_floor_divide(mp_int_t num, mp_int_t denom);
 
@@ -31,13 +31,6 @@
 #include "py/objstr.h"
 #include "py/stream.h"
 
-#if MICROPY_STREAMS_NON_BLOCK
-#include <errno.h>
-#if defined(__MINGW32__) && !defined(__MINGW64_VERSION_MAJOR)
-#define EWOULDBLOCK 140
-#endif
-#endif
-
 // This file defines generic Python stream read/write methods which
 // dispatch to the underlying stream interface of an object.
 
@@ -46,16 +39,49 @@
 
 STATIC mp_obj_t stream_readall(mp_obj_t self_in);
 
-#if MICROPY_STREAMS_NON_BLOCK
-// TODO: This is POSIX-specific (but then POSIX is the only real thing,
-// and anything else just emulates it, right?)
-#define is_nonblocking_error(errno) ((errno) == EAGAIN || (errno) == EWOULDBLOCK)
-#else
-#define is_nonblocking_error(errno) (0)
-#endif
-
 #define STREAM_CONTENT_TYPE(stream) (((stream)->is_text) ? &mp_type_str : &mp_type_bytes)
 
+const mp_stream_p_t *mp_get_stream_raise(mp_obj_t self_in, int flags) {
+    const mp_stream_p_t *stream_p = mp_obj_get_type(self_in)->stream_p;
+    if (stream_p == NULL
+        || ((flags & MP_STREAM_OP_READ) && stream_p->read == NULL)
+        || ((flags & MP_STREAM_OP_WRITE) && stream_p->write == NULL)
+        || ((flags & MP_STREAM_OP_IOCTL) && stream_p->ioctl == NULL)) {
+        // CPython: io.UnsupportedOperation, OSError subclass
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Operation not supported"));
+    }
+    return stream_p;
+}
+
+mp_uint_t mp_stream_rw_into(mp_obj_t stream, void *buf_in, mp_uint_t size, int *errcode, byte flags) {
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream,
+        (flags & MP_STREAM_RW_WRITE) ? MP_STREAM_OP_WRITE : MP_STREAM_OP_READ);
+    byte *buf = buf_in;
+    mp_uint_t done = 0;
+    *errcode = 0;
+    while (done < size) {
+        mp_uint_t out_sz;
+        if (flags & MP_STREAM_RW_WRITE) {
+            out_sz = stream_p->write(stream, buf + done, size - done, errcode);
+        } else {
+            out_sz = stream_p->read(stream, buf + done, size - done, errcode);
+        }
+        if (out_sz == MP_STREAM_ERROR) {
+            break;
+        }
+        if (out_sz == 0) {
+            // end of stream
+            *errcode = 0;
+            break;
+        }
+        done += out_sz;
+        if (flags & MP_STREAM_RW_ONCE) {
+            break;
+        }
+    }
+    return done;
+}
+
 STATIC mp_obj_t stream_read(mp_uint_t n_args, const mp_obj_t *args) {
     struct _mp_obj_base_t *o = (struct _mp_obj_base_t *)args[0];
     if (o->type->stream_p == NULL || o->type->stream_p->read == NULL) {
@@ -95,7 +121,7 @@ STATIC mp_obj_t stream_read(mp_uint_t n_args, const mp_obj_t *args) {
             mp_uint_t out_sz = o->type->stream_p->read(o, p, more_bytes, &error);
             if (out_sz == MP_STREAM_ERROR) {
                 vstr_cut_tail_bytes(&vstr, more_bytes);
-                if (is_nonblocking_error(error)) {
+                if (mp_is_nonblocking_error(error)) {
                     // With non-blocking streams, we read as much as we can.
                     // If we read nothing, return None, just like read().
                     // Otherwise, return data read so far.
@@ -166,7 +192,7 @@ STATIC mp_obj_t stream_read(mp_uint_t n_args, const mp_obj_t *args) {
     mp_uint_t out_sz = o->type->stream_p->read(o, vstr.buf, sz, &error);
     if (out_sz == MP_STREAM_ERROR) {
         vstr_clear(&vstr);
-        if (is_nonblocking_error(error)) {
+        if (mp_is_nonblocking_error(error)) {
             // https://docs.python.org/3.4/library/io.html#io.RawIOBase.read
             // "If the object is in non-blocking mode and no bytes are available,
             // None is returned."
@@ -191,7 +217,7 @@ mp_obj_t mp_stream_write(mp_obj_t self_in, const void *buf, mp_uint_t len) {
     int error;
     mp_uint_t out_sz = o->type->stream_p->write(self_in, buf, len, &error);
     if (out_sz == MP_STREAM_ERROR) {
-        if (is_nonblocking_error(error)) {
+        if (mp_is_nonblocking_error(error)) {
             // http://docs.python.org/3/library/io.html#io.RawIOBase.write
             // "None is returned if the raw stream is set not to block and
             // no single byte could be readily written to it."
@@ -234,7 +260,7 @@ STATIC mp_obj_t stream_readinto(mp_uint_t n_args, const mp_obj_t *args) {
     int error;
     mp_uint_t out_sz = o->type->stream_p->read(o, bufinfo.buf, len, &error);
     if (out_sz == MP_STREAM_ERROR) {
-        if (is_nonblocking_error(error)) {
+        if (mp_is_nonblocking_error(error)) {
             return mp_const_none;
         }
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error)));
@@ -259,7 +285,7 @@ STATIC mp_obj_t stream_readall(mp_obj_t self_in) {
         int error;
         mp_uint_t out_sz = o->type->stream_p->read(self_in, p, current_read, &error);
         if (out_sz == MP_STREAM_ERROR) {
-            if (is_nonblocking_error(error)) {
+            if (mp_is_nonblocking_error(error)) {
                 // With non-blocking streams, we read as much as we can.
                 // If we read nothing, return None, just like read().
                 // Otherwise, return data read so far.
@@ -320,7 +346,7 @@ STATIC mp_obj_t stream_unbuffered_readline(mp_uint_t n_args, const mp_obj_t *arg
         int error;
         mp_uint_t out_sz = o->type->stream_p->read(o, p, 1, &error);
         if (out_sz == MP_STREAM_ERROR) {
-            if (is_nonblocking_error(error)) {
+            if (mp_is_nonblocking_error(error)) {
                 if (vstr.len == 1) {
                     // We just incremented it, but otherwise we read nothing
                     // and immediately got EAGAIN. This is case is not well
@@ -28,6 +28,13 @@
 
 #include "py/obj.h"
 
+#if MICROPY_STREAMS_NON_BLOCK
+#include <errno.h>
+#if defined(__MINGW32__) && !defined(__MINGW64_VERSION_MAJOR)
+#define EWOULDBLOCK 140
+#endif
+#endif
+
 MP_DECLARE_CONST_FUN_OBJ(mp_stream_read_obj);
 MP_DECLARE_CONST_FUN_OBJ(mp_stream_readinto_obj);
 MP_DECLARE_CONST_FUN_OBJ(mp_stream_readall_obj);
@@ -41,4 +48,30 @@ mp_obj_t mp_stream_unbuffered_iter(mp_obj_t self);
 
 mp_obj_t mp_stream_write(mp_obj_t self_in, const void *buf, mp_uint_t len);
 
+// Flags for mp_get_stream_raise, saying which operations are needed
+#define MP_STREAM_OP_READ (1)
+#define MP_STREAM_OP_WRITE (2)
+#define MP_STREAM_OP_IOCTL (4)
+
+const mp_stream_p_t *mp_get_stream_raise(mp_obj_t self_in, int flags);
+
+// Flags for mp_stream_rw_into
+#define MP_STREAM_RW_READ  (0)
+#define MP_STREAM_RW_WRITE (2)
+#define MP_STREAM_RW_ONCE  (1)
+
+// Transfer size bytes between a stream and buf, with no intermediate copy,
+// so buf can be anywhere, e.g. the memory of a memoryview slice. Returns the
+// number of bytes transferred; if less than size, *errcode is the error
+// that stopped the transfer, or 0 for end of stream.
+mp_uint_t mp_stream_rw_into(mp_obj_t stream, void *buf, mp_uint_t size, int *errcode, byte flags);
+
+#if MICROPY_STREAMS_NON_BLOCK
+// TODO: This is POSIX-specific (but then POSIX is the only real thing,
+// and anything else just emulates it, right?)
+#define mp_is_nonblocking_error(errno) ((errno) == EAGAIN || (errno) == EWOULDBLOCK)
+#else
+#define mp_is_nonblocking_error(errno) (0)
+#endif
+
 #endif // __MICROPY_INCLUDED_PY_STREAM_H__
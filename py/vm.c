@@ -32,10 +32,14 @@
 #include "py/mpstate.h"
 #include "py/nlr.h"
 #include "py/emitglue.h"
+#include "py/runtime0.h"
 #include "py/objtype.h"
+#include "py/objgenerator.h"
+#include "py/objtuple.h"
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/smallint.h"
 
 #if 0
 #define TRACE(ip) printf("sp=" INT_FMT " ", sp - code_state->sp); mp_bytecode_print2(ip, 1);
@@ -65,6 +69,25 @@ typedef enum {
     } while ((*ip++ & 0x80) != 0)
 #define DECODE_ULABEL mp_uint_t ulab = (ip[0] | (ip[1] << 8)); ip += 2
 #define DECODE_SLABEL mp_uint_t slab = (ip[0] | (ip[1] << 8)) - 0x8000; ip += 2
+
+#if MICROPY_EMIT_NATIVE_JIT
+// count taken backward jumps (ie loop iterations) towards promotion to native code
+#define COUNT_BACKEDGE() do { if ((mp_int_t)slab < 0) { code_state->jit_count += 1; } } while (0)
+#else
+#define COUNT_BACKEDGE()
+#endif
+
+#if MICROPY_PERSISTENT_CODE
+
+#define DECODE_QSTR \
+    qstr qst = ip[0] | ip[1] << 8; \
+    ip += 2
+#define DECODE_PTR \
+    DECODE_UINT; \
+    void *ptr = (void*)code_state->const_table[unum]
+
+#else
+
 #define DECODE_QSTR qstr qst = 0; \
     do { \
         qst = (qst << 7) + (*ip & 0x7f); \
@@ -73,13 +96,16 @@ typedef enum {
     ip = (byte*)(((mp_uint_t)ip + sizeof(mp_uint_t) - 1) & (~(sizeof(mp_uint_t) - 1))); /* align ip */ \
     void *ptr = (void*)*(mp_uint_t*)ip; \
     ip += sizeof(mp_uint_t)
+
+#endif
+
 #define PUSH(val) *++sp = (val)
 #define POP() (*sp--)
 #define TOP() (*sp)
 #define SET_TOP(val) *sp = (val)
 
 #if MICROPY_PY_SYS_EXC_INFO
-#define CLEAR_SYS_EXC_INFO() MP_STATE_VM(cur_exception) = MP_OBJ_NULL;
+#define CLEAR_SYS_EXC_INFO() MP_STATE_THREAD(cur_exception) = MP_OBJ_NULL;
 #else
 #define CLEAR_SYS_EXC_INFO()
 #endif
@@ -98,6 +124,194 @@ typedef enum {
     exc_sp--; /* pop back to previous exception handler */ \
     CLEAR_SYS_EXC_INFO() /* just clear sys.exc_info(), not compliant, but it shouldn't be used in 1st place */
 
+#if MICROPY_OPT_SMALL_INT_BINARY_OP || MICROPY_OPT_FUSED_OPCODES
+// tries to compute "lhs <op> rhs" for two small ints without calling mp_binary_op
+// returns false if op isn't handled here or the result doesn't fit in a small int
+STATIC inline bool vm_small_int_binary_op(mp_uint_t op, mp_int_t lhs, mp_int_t rhs, mp_obj_t *res) {
+    switch (op) {
+        case MP_BINARY_OP_OR:
+        case MP_BINARY_OP_INPLACE_OR: *res = MP_OBJ_NEW_SMALL_INT(lhs | rhs); return true;
+        case MP_BINARY_OP_XOR:
+        case MP_BINARY_OP_INPLACE_XOR: *res = MP_OBJ_NEW_SMALL_INT(lhs ^ rhs); return true;
+        case MP_BINARY_OP_AND:
+        case MP_BINARY_OP_INPLACE_AND: *res = MP_OBJ_NEW_SMALL_INT(lhs & rhs); return true;
+        // add and subtract can't overflow a mp_int_t, but need a SMALL_INT check
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD: lhs += rhs; break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT: lhs -= rhs; break;
+        case MP_BINARY_OP_LESS: *res = MP_BOOL(lhs < rhs); return true;
+        case MP_BINARY_OP_MORE: *res = MP_BOOL(lhs > rhs); return true;
+        case MP_BINARY_OP_EQUAL: *res = MP_BOOL(lhs == rhs); return true;
+        case MP_BINARY_OP_LESS_EQUAL: *res = MP_BOOL(lhs <= rhs); return true;
+        case MP_BINARY_OP_MORE_EQUAL: *res = MP_BOOL(lhs >= rhs); return true;
+        case MP_BINARY_OP_NOT_EQUAL: *res = MP_BOOL(lhs != rhs); return true;
+        default: return false;
+    }
+    if (!MP_SMALL_INT_FITS(lhs)) {
+        return false;
+    }
+    *res = MP_OBJ_NEW_SMALL_INT(lhs);
+    return true;
+}
+#endif
+
+#if MICROPY_OPT_FUSED_OPCODES
+// computes "lhs <op> rhs" for the fused opcodes, where rhs is a small int
+STATIC mp_obj_t vm_binary_op_small_int(mp_uint_t op, mp_obj_t lhs, mp_int_t rhs) {
+    mp_obj_t res;
+    if (MP_OBJ_IS_SMALL_INT(lhs) && vm_small_int_binary_op(op, MP_OBJ_SMALL_INT_VALUE(lhs), rhs, &res)) {
+        return res;
+    }
+    return mp_binary_op(op, lhs, MP_OBJ_NEW_SMALL_INT(rhs));
+}
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+// count op, and the pair it makes with the opcode executed before it
+STATIC void vm_opcode_stats(byte op) {
+    MP_STATE_VM(opcode_count)[op] += 1;
+    mp_uint_t pair = MP_STATE_VM(opcode_last) << 8 | op;
+    MP_STATE_VM(opcode_last) = op;
+    if (pair <= 0xff) {
+        // first opcode executed
+        return;
+    }
+    mp_vm_opcode_pair_t *table = MP_STATE_VM(opcode_pair);
+    mp_uint_t i = (pair ^ (pair >> 7)) & (MICROPY_VM_OPCODE_STATS_PAIRS - 1);
+    for (mp_uint_t n = MICROPY_VM_OPCODE_STATS_PAIRS; n > 0; n--) {
+        if (table[i].pair == pair) {
+            table[i].count += 1;
+            return;
+        }
+        if (table[i].pair == 0) {
+            table[i].pair = pair;
+            table[i].count = 1;
+            return;
+        }
+        i = (i + 1) & (MICROPY_VM_OPCODE_STATS_PAIRS - 1);
+    }
+    MP_STATE_VM(opcode_pair_lost) += 1;
+}
+#define OPCODE_STATS(op) vm_opcode_stats(op)
+#else
+#define OPCODE_STATS(op)
+#endif
+
+#if MICROPY_VM_PROFILE
+mp_uint_t mp_hal_ticks_cpu(void);
+
+// find (or record) the profiler entry for the function with this code info
+STATIC mp_vm_profile_func_t *vm_profile_find(const byte *code_info) {
+    mp_vm_profile_func_t *table = MP_STATE_VM(vm_profile_func);
+    mp_uint_t i = ((mp_uint_t)code_info >> 4) & (MICROPY_VM_PROFILE_FUNCS - 1);
+    for (mp_uint_t n = MICROPY_VM_PROFILE_FUNCS; n > 0; n--) {
+        if (table[i].code_info == code_info) {
+            return &table[i];
+        }
+        if (table[i].code_info == NULL) {
+            table[i].code_info = code_info;
+            return &table[i];
+        }
+        i = (i + 1) & (MICROPY_VM_PROFILE_FUNCS - 1);
+    }
+    // table is full
+    return &table[MICROPY_VM_PROFILE_FUNCS];
+}
+
+// start timing code_state, which is about to run
+STATIC void vm_profile_enter(const mp_code_state *code_state) {
+    mp_uint_t depth = MP_STATE_THREAD(vm_profile_depth);
+    if (depth == MICROPY_VM_PROFILE_DEPTH) {
+        return;
+    }
+    mp_vm_profile_func_t *func = vm_profile_find(code_state->code_info);
+    func->depth += 1;
+    func->n_calls += 1;
+    mp_vm_profile_frame_t *frame = &MP_STATE_THREAD(vm_profile_frame)[depth];
+    frame->code_state = code_state;
+    frame->func = func;
+    frame->child = 0;
+    MP_STATE_THREAD(vm_profile_depth) = depth + 1;
+    frame->start = mp_hal_ticks_cpu();
+}
+
+// stop timing the innermost timed code state, which has returned, yielded or
+// raised; its time is charged to the one that started it
+STATIC void vm_profile_exit(void) {
+    mp_uint_t depth = MP_STATE_THREAD(vm_profile_depth) - 1;
+    mp_vm_profile_frame_t *frame = &MP_STATE_THREAD(vm_profile_frame)[depth];
+    mp_uint_t ticks = mp_hal_ticks_cpu() - frame->start;
+    mp_vm_profile_func_t *func = frame->func;
+    func->self_ticks += ticks - frame->child;
+    if (--func->depth == 0) {
+        // only the outermost activation of a recursive function counts
+        func->total_ticks += ticks;
+    }
+    if (depth > 0) {
+        frame[-1].child += ticks;
+    }
+    MP_STATE_THREAD(vm_profile_depth) = depth;
+}
+
+// a code state that started while the profiler was disabled, or too deep in
+// the call chain, isn't timed
+#define VM_PROFILE_ENTER(code_state) do { \
+    if (MP_STATE_VM(vm_profile_enabled)) { \
+        vm_profile_enter(code_state); \
+    } \
+} while (0)
+#define VM_PROFILE_EXIT(code_state) do { \
+    mp_uint_t depth = MP_STATE_THREAD(vm_profile_depth); \
+    if (depth > 0 && MP_STATE_THREAD(vm_profile_frame)[depth - 1].code_state == (code_state)) { \
+        vm_profile_exit(); \
+    } \
+} while (0)
+#else
+#define VM_PROFILE_ENTER(code_state)
+#define VM_PROFILE_EXIT(code_state)
+#endif
+
+#if MICROPY_VM_SAMPLE_PROFILE
+// Count the position of the bytecode that the current thread is running.  It
+// is called from an interrupt (or signal handler), so it doesn't allocate,
+// and tolerates a code state that is being released.  An entry's code info is
+// written last, since it marks the entry as taken.
+void mp_vm_sample(void) {
+    if (!MP_STATE_VM(vm_sample_enabled)) {
+        return;
+    }
+    mp_vm_sample_t *table = MP_STATE_VM(vm_sample);
+    #if MICROPY_PY_THREAD
+    // a thread that doesn't run Python code has no state
+    if (MP_STATE_THREAD_PTR() == NULL) {
+        table[MICROPY_VM_SAMPLE_PROFILE_SLOTS].count += 1;
+        return;
+    }
+    #endif
+    const mp_code_state *code_state = MP_STATE_THREAD(current_code_state);
+    const byte *code_info = code_state == NULL ? NULL : code_state->code_info;
+    if (code_info != NULL) {
+        const byte *ip = code_state->ip;
+        mp_uint_t h = (mp_uint_t)ip;
+        for (mp_uint_t i = 0; i < 8; i++, h++) {
+            mp_vm_sample_t *s = &table[h & (MICROPY_VM_SAMPLE_PROFILE_SLOTS - 1)];
+            if (s->code_info == NULL) {
+                s->ip = ip;
+                s->count = 1;
+                s->code_info = code_info;
+                return;
+            }
+            if (s->ip == ip) {
+                s->count += 1;
+                return;
+            }
+        }
+    }
+    table[MICROPY_VM_SAMPLE_PROFILE_SLOTS].count += 1;
+}
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
@@ -117,6 +331,7 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state *code_state, volatile mp_o
     #include "py/vmentrytable.h"
     #define DISPATCH() do { \
         TRACE(ip); \
+        OPCODE_STATS(*ip); \
         MARK_EXC_IP_GLOBAL(); \
         goto *entry_table[*ip++]; \
     } while (0)
@@ -136,8 +351,22 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state *code_state, volatile mp_o
     // loop and the exception handler, leading to very obscure bugs.
     #define RAISE(o) do { nlr_pop(); nlr.ret_val = o; goto exception_handler; } while (0)
 
+    nlr_buf_t nlr;
+
+    VM_PROFILE_ENTER(code_state);
+
 #if MICROPY_STACKLESS
+    // Calls to and returns from bytecode functions switch code_state without
+    // leaving the nlr buffer: it is pushed once and stays valid for every frame
+    // run here.  The exception handler can be reached by nlr_jump, which doesn't
+    // preserve locals changed since the push, so it reloads code_state from here.
+    mp_code_state *volatile code_state_cur;
+    volatile bool nlr_pushed = false;
 run_code_state: ;
+    code_state_cur = code_state;
+    #if MICROPY_VM_CURRENT_CODE_STATE
+    MP_STATE_THREAD(current_code_state) = code_state;
+    #endif
 #endif
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn = &code_state->state[code_state->n_state - 1];
@@ -149,13 +378,21 @@ run_code_state: ;
 
     // outer exception handling loop
     for (;;) {
-        nlr_buf_t nlr;
 outer_dispatch_loop:
+        #if MICROPY_STACKLESS
+        if (nlr_pushed || nlr_push(&nlr) == 0) {
+            nlr_pushed = false;
+        #else
         if (nlr_push(&nlr) == 0) {
+        #endif
             // local variables that are not visible to the exception handler
             const byte *ip = code_state->ip;
             mp_obj_t *sp = code_state->sp;
             mp_obj_t obj_shared;
+            #if MICROPY_PY_THREAD
+            // jumps left until the GIL is next offered to other threads
+            mp_uint_t gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
+            #endif
 
             // If we have exception to inject, now that we finish setting up
             // execution context, raise it. This works as if RAISE_VARARGS
@@ -176,6 +413,7 @@ dispatch_loop:
                 DISPATCH();
 #else
                 TRACE(ip);
+                OPCODE_STATS(*ip);
                 MARK_EXC_IP_GLOBAL();
                 switch (*ip++) {
 #endif
@@ -261,12 +499,12 @@ dispatch_loop:
                     DECODE_QSTR;
                     mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                     mp_uint_t x = *ip;
-                    if (x < MP_STATE_CTX(dict_locals)->map.alloc && MP_STATE_CTX(dict_locals)->map.table[x].key == key) {
-                        PUSH(MP_STATE_CTX(dict_locals)->map.table[x].value);
+                    if (x < MP_STATE_THREAD(dict_locals)->map.alloc && MP_STATE_THREAD(dict_locals)->map.table[x].key == key) {
+                        PUSH(MP_STATE_THREAD(dict_locals)->map.table[x].value);
                     } else {
-                        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_CTX(dict_locals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+                        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_THREAD(dict_locals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &MP_STATE_CTX(dict_locals)->map.table[0]) & 0xff;
+                            *(byte*)ip = (elem - &MP_STATE_THREAD(dict_locals)->map.table[0]) & 0xff;
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_name(MP_OBJ_QSTR_VALUE(key)));
@@ -290,12 +528,12 @@ dispatch_loop:
                     DECODE_QSTR;
                     mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                     mp_uint_t x = *ip;
-                    if (x < MP_STATE_CTX(dict_globals)->map.alloc && MP_STATE_CTX(dict_globals)->map.table[x].key == key) {
-                        PUSH(MP_STATE_CTX(dict_globals)->map.table[x].value);
+                    if (x < MP_STATE_THREAD(dict_globals)->map.alloc && MP_STATE_THREAD(dict_globals)->map.table[x].key == key) {
+                        PUSH(MP_STATE_THREAD(dict_globals)->map.table[x].value);
                     } else {
-                        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_CTX(dict_globals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+                        mp_map_elem_t *elem = mp_map_lookup(&MP_STATE_THREAD(dict_globals)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &MP_STATE_CTX(dict_globals)->map.table[0]) & 0xff;
+                            *(byte*)ip = (elem - &MP_STATE_THREAD(dict_globals)->map.table[0]) & 0xff;
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_global(MP_OBJ_QSTR_VALUE(key)));
@@ -318,9 +556,53 @@ dispatch_loop:
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     mp_obj_t top = TOP();
-                    if (mp_obj_get_type(top)->attr == mp_obj_instance_attr) {
+                    mp_obj_type_t *top_type = mp_obj_get_type(top);
+                    if (top_type->attr == mp_obj_instance_attr) {
                         mp_obj_instance_t *self = top;
                         mp_uint_t x = *ip;
+                        #if MICROPY_PY_SLOTS
+                        const mp_obj_class_t *cls = (const mp_obj_class_t*)self->base.type;
+                        if (cls->n_slots != 0) {
+                            // a cache with the top bit set holds the index of a slot
+                            mp_int_t i = x & 0x7f;
+                            if (!(x & 0x80) || (mp_uint_t)i >= cls->n_slots || cls->slot_names[i] != qst) {
+                                i = mp_obj_class_slot_index(cls, qst);
+                                if (i >= 0x80) {
+                                    goto load_attr_cache_fail;
+                                } else if (i >= 0) {
+                                    *(byte*)ip = 0x80 | i;
+                                }
+                            }
+                            if (i >= 0) {
+                                mp_obj_t value = MP_OBJ_INSTANCE_SLOTS(self, cls)[i];
+                                if (value != MP_OBJ_NULL) {
+                                    SET_TOP(value);
+                                    ip++;
+                                    DISPATCH();
+                                }
+                                goto load_attr_cache_fail;
+                            }
+                        }
+                        if (!cls->has_dict) {
+                            goto load_attr_cache_fail;
+                        }
+                        #endif
+                        #if MICROPY_OPT_INSTANCE_SHAPES
+                        if (MP_OBJ_INSTANCE_HAS_SHAPE(self)) {
+                            // the cache holds the index of the value
+                            if (x >= self->members.used || MP_OBJ_INSTANCE_SHAPE(self)->keys[x] != qst) {
+                                mp_int_t i = mp_obj_instance_shape_index(self, qst);
+                                if (i < 0) {
+                                    goto load_attr_cache_fail;
+                                }
+                                x = i;
+                                *(byte*)ip = x;
+                            }
+                            SET_TOP(MP_OBJ_INSTANCE_VALUES(self)[x]);
+                            ip++;
+                            DISPATCH();
+                        }
+                        #endif
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
                         if (x < self->members.alloc && self->members.table[x].key == key) {
@@ -337,6 +619,23 @@ dispatch_loop:
                         ip++;
                         DISPATCH();
                     }
+                    #if MICROPY_PY_COLLECTIONS
+                    if (top_type->attr == mp_obj_namedtuple_attr) {
+                        // the cache holds the index of the field
+                        const mp_obj_namedtuple_type_t *type = (const mp_obj_namedtuple_type_t*)top_type;
+                        mp_uint_t x = *ip;
+                        if (x >= type->n_fields || type->fields[x] != qst) {
+                            x = mp_obj_namedtuple_find_field(type, qst);
+                            if (x > 0xff) {
+                                goto load_attr_cache_fail;
+                            }
+                            *(byte*)ip = x;
+                        }
+                        SET_TOP(((mp_obj_tuple_t*)top)->items[x]);
+                        ip++;
+                        DISPATCH();
+                    }
+                    #endif
                 load_attr_cache_fail:
                     SET_TOP(mp_load_attr(top, qst));
                     ip++;
@@ -411,6 +710,47 @@ dispatch_loop:
                     if (mp_obj_get_type(top)->attr == mp_obj_instance_attr && sp[-1] != MP_OBJ_NULL) {
                         mp_obj_instance_t *self = top;
                         mp_uint_t x = *ip;
+                        #if MICROPY_PY_SLOTS
+                        const mp_obj_class_t *cls = (const mp_obj_class_t*)self->base.type;
+                        if (cls->n_slots != 0) {
+                            // a cache with the top bit set holds the index of a slot
+                            mp_int_t i = x & 0x7f;
+                            if (!(x & 0x80) || (mp_uint_t)i >= cls->n_slots || cls->slot_names[i] != qst) {
+                                i = mp_obj_class_slot_index(cls, qst);
+                                if (i >= 0x80) {
+                                    goto store_attr_cache_fail;
+                                } else if (i >= 0) {
+                                    *(byte*)ip = 0x80 | i;
+                                }
+                            }
+                            if (i >= 0) {
+                                MP_OBJ_INSTANCE_SLOTS(self, cls)[i] = sp[-1];
+                                sp -= 2;
+                                ip++;
+                                DISPATCH();
+                            }
+                        }
+                        if (!cls->has_dict) {
+                            goto store_attr_cache_fail;
+                        }
+                        #endif
+                        #if MICROPY_OPT_INSTANCE_SHAPES
+                        if (MP_OBJ_INSTANCE_HAS_SHAPE(self)) {
+                            // the cache holds the index of the value
+                            if (x >= self->members.used || MP_OBJ_INSTANCE_SHAPE(self)->keys[x] != qst) {
+                                mp_int_t i = mp_obj_instance_shape_index(self, qst);
+                                if (i < 0) {
+                                    goto store_attr_cache_fail;
+                                }
+                                x = i;
+                                *(byte*)ip = x;
+                            }
+                            MP_OBJ_INSTANCE_VALUES(self)[x] = sp[-1];
+                            sp -= 2;
+                            ip++;
+                            DISPATCH();
+                        }
+                        #endif
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
                         if (x < self->members.alloc && self->members.table[x].key == key) {
@@ -509,6 +849,7 @@ dispatch_loop:
 
                 ENTRY(MP_BC_JUMP): {
                     DECODE_SLABEL;
+                    COUNT_BACKEDGE();
                     ip += slab;
                     DISPATCH_WITH_PEND_EXC_CHECK();
                 }
@@ -516,6 +857,7 @@ dispatch_loop:
                 ENTRY(MP_BC_POP_JUMP_IF_TRUE): {
                     DECODE_SLABEL;
                     if (mp_obj_is_true(POP())) {
+                        COUNT_BACKEDGE();
                         ip += slab;
                     }
                     DISPATCH_WITH_PEND_EXC_CHECK();
@@ -524,6 +866,7 @@ dispatch_loop:
                 ENTRY(MP_BC_POP_JUMP_IF_FALSE): {
                     DECODE_SLABEL;
                     if (!mp_obj_is_true(POP())) {
+                        COUNT_BACKEDGE();
                         ip += slab;
                     }
                     DISPATCH_WITH_PEND_EXC_CHECK();
@@ -710,6 +1053,24 @@ unwind_jump:;
                     DECODE_ULABEL; // the jump offset if iteration finishes; for labels are always forward
                     code_state->sp = sp;
                     assert(TOP());
+                    #if MICROPY_OPT_ITER_FUSION
+                    if (*ip == MP_BC_UNPACK_SEQUENCE) {
+                        // the loop unpacks each item, which enumerate and zip
+                        // can put straight on the stack without a tuple
+                        const byte *ip_body = ip++;
+                        DECODE_UINT;
+                        mp_obj_t ret = mp_iternext_unpack(TOP(), unum, sp + 1);
+                        if (ret == MP_OBJ_STOP_ITERATION) {
+                            --sp; // pop the exhausted iterator
+                            ip = ip_body + ulab; // jump to after for-block
+                            DISPATCH();
+                        } else if (ret != MP_OBJ_SENTINEL) {
+                            sp += unum;
+                            DISPATCH();
+                        }
+                        ip = ip_body;
+                    }
+                    #endif
                     mp_obj_t value = mp_iternext_allow_raise(TOP());
                     if (value == MP_OBJ_STOP_ITERATION) {
                         --sp; // pop the exhausted iterator
@@ -747,10 +1108,105 @@ unwind_jump:;
                     }
                     DISPATCH();
 
+                #if MICROPY_OPT_FUSED_OPCODES
+                ENTRY(MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    obj_shared = fastn[-ip[0]];
+                    if (obj_shared == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    PUSH(vm_binary_op_small_int(ip[1], obj_shared, (int8_t)ip[2]));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_STORE_FAST_BINARY_OP_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t *local = &fastn[-ip[0]];
+                    if (*local == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    *local = vm_binary_op_small_int(ip[1], *local, (int8_t)ip[2]);
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE):
+                ENTRY(MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE): {
+                    MARK_EXC_IP_SELECTIVE();
+                    obj_shared = fastn[-ip[0]];
+                    if (obj_shared == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    obj_shared = vm_binary_op_small_int(ip[1], obj_shared, (int8_t)ip[2]);
+                    ip += 3;
+                    DECODE_SLABEL;
+                    if (mp_obj_is_true(obj_shared) == (ip[-6] == MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE)) {
+                        COUNT_BACKEDGE();
+                        ip += slab;
+                    }
+                    DISPATCH_WITH_PEND_EXC_CHECK();
+                }
+                #endif
+
+                #if MICROPY_OPT_FOR_RANGE
+                ENTRY(MP_BC_FOR_RANGE_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_ULABEL; // the jump offset if the range is exhausted; always forward
+                    mp_int_t step = (int8_t)*ip; // ulab doesn't include this byte
+                    // the stack holds the end value and then the counter
+                    mp_obj_t cur = TOP();
+                    if (MP_OBJ_IS_SMALL_INT(cur) && MP_OBJ_IS_SMALL_INT(sp[-1])) {
+                        mp_int_t val = MP_OBJ_SMALL_INT_VALUE(cur);
+                        mp_int_t end = MP_OBJ_SMALL_INT_VALUE(sp[-1]);
+                        if (step >= 0 ? val >= end : val <= end) {
+                            ip += ulab; // jump to after for-block
+                            DISPATCH();
+                        }
+                        // can't overflow a mp_int_t, only leave the small-int range
+                        SET_TOP(mp_obj_new_int(val + step));
+                    } else {
+                        mp_obj_t more = mp_binary_op(step >= 0 ? MP_BINARY_OP_LESS : MP_BINARY_OP_MORE, cur, sp[-1]);
+                        if (!mp_obj_is_true(more)) {
+                            ip += ulab; // jump to after for-block
+                            DISPATCH();
+                        }
+                        SET_TOP(mp_binary_op(MP_BINARY_OP_INPLACE_ADD, cur, MP_OBJ_NEW_SMALL_INT(step)));
+                    }
+                    ip += 1;
+                    PUSH(cur); // the value to store in the loop variable
+                    DISPATCH();
+                }
+                #endif
+
                 ENTRY(MP_BC_BUILD_TUPLE): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_UINT;
                     sp -= unum - 1;
+                    #if MICROPY_STACKLESS && MICROPY_OPT_MULTI_RETURN
+                    if (*ip == MP_BC_RETURN_VALUE && exc_sp < exc_stack && code_state->prev != NULL) {
+                        // Returning a tuple, with no finally blocks to run, to a
+                        // caller in this loop.  If the caller unpacks it into the
+                        // same number of values then put them straight into its
+                        // stack, in the order UNPACK_SEQUENCE would leave them.
+                        mp_code_state *caller = code_state->prev;
+                        const byte *caller_ip = caller->ip;
+                        if (caller_ip[0] == MP_BC_UNPACK_SEQUENCE && unum < 0x80 && caller_ip[1] == unum) {
+                            for (mp_uint_t i = 0; i < unum; i++) {
+                                caller->sp[i] = sp[unum - 1 - i];
+                            }
+                            caller->sp += unum - 1;
+                            caller->ip = caller_ip + 2;
+                            code_state->sp = sp;
+                            VM_PROFILE_EXIT(code_state);
+                            mp_globals_set(code_state->old_globals);
+                            mp_obj_fun_bc_release_codestate(code_state);
+                            code_state = caller;
+                            nlr_pushed = true;
+                            goto run_code_state;
+                        }
+                    }
+                    #endif
                     SET_TOP(mp_obj_new_tuple(unum, sp));
                     DISPATCH();
                 }
@@ -894,11 +1350,12 @@ unwind_jump:;
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
-                            nlr_pop();
+                            VM_PROFILE_ENTER(code_state);
+                            nlr_pushed = true;
                             goto run_code_state;
                         }
                         #if MICROPY_STACKLESS_STRICT
-                        else {
+                        else if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
                         deep_recursion_error:
                             mp_exc_recursion_depth();
                         }
@@ -932,11 +1389,12 @@ unwind_jump:;
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
-                            nlr_pop();
+                            VM_PROFILE_ENTER(code_state);
+                            nlr_pushed = true;
                             goto run_code_state;
                         }
                         #if MICROPY_STACKLESS_STRICT
-                        else {
+                        else if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
                             goto deep_recursion_error;
                         }
                         #endif
@@ -966,11 +1424,12 @@ unwind_jump:;
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
-                            nlr_pop();
+                            VM_PROFILE_ENTER(code_state);
+                            nlr_pushed = true;
                             goto run_code_state;
                         }
                         #if MICROPY_STACKLESS_STRICT
-                        else {
+                        else if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
                             goto deep_recursion_error;
                         }
                         #endif
@@ -1003,11 +1462,12 @@ unwind_jump:;
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
-                            nlr_pop();
+                            VM_PROFILE_ENTER(code_state);
+                            nlr_pushed = true;
                             goto run_code_state;
                         }
                         #if MICROPY_STACKLESS_STRICT
-                        else {
+                        else if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
                             goto deep_recursion_error;
                         }
                         #endif
@@ -1036,18 +1496,22 @@ unwind_return:
                         }
                         exc_sp--;
                     }
-                    nlr_pop();
                     code_state->sp = sp;
                     assert(exc_sp == exc_stack - 1);
+                    VM_PROFILE_EXIT(code_state);
                     #if MICROPY_STACKLESS
                     if (code_state->prev != NULL) {
                         mp_obj_t res = *sp;
                         mp_globals_set(code_state->old_globals);
-                        code_state = code_state->prev;
+                        mp_code_state *new_state = code_state->prev;
+                        mp_obj_fun_bc_release_codestate(code_state);
+                        code_state = new_state;
                         *code_state->sp = res;
+                        nlr_pushed = true;
                         goto run_code_state;
                     }
                     #endif
+                    nlr_pop();
                     return MP_VM_RETURN_NORMAL;
 
                 ENTRY(MP_BC_RAISE_VARARGS): {
@@ -1078,6 +1542,7 @@ unwind_return:
                 ENTRY(MP_BC_YIELD_VALUE):
 yield:
                     nlr_pop();
+                    VM_PROFILE_EXIT(code_state);
                     code_state->ip = ip;
                     code_state->sp = sp;
                     code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
@@ -1095,9 +1560,13 @@ yield:
                     if (inject_exc != MP_OBJ_NULL) {
                         t_exc = inject_exc;
                         inject_exc = MP_OBJ_NULL;
-                        ret_kind = mp_resume(TOP(), MP_OBJ_NULL, t_exc, &ret_value);
+                        send_value = MP_OBJ_NULL;
+                    }
+                    if (MP_OBJ_IS_TYPE(TOP(), &mp_type_gen_instance)) {
+                        // delegating to a generator, so resume it directly
+                        ret_kind = mp_obj_gen_resume(TOP(), send_value, t_exc, &ret_value);
                     } else {
-                        ret_kind = mp_resume(TOP(), send_value, MP_OBJ_NULL, &ret_value);
+                        ret_kind = mp_resume(TOP(), send_value, t_exc, &ret_value);
                     }
 
                     if (ret_kind == MP_VM_RETURN_YIELD) {
@@ -1179,6 +1648,16 @@ yield:
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t rhs = POP();
                     mp_obj_t lhs = TOP();
+                    #if MICROPY_OPT_SMALL_INT_BINARY_OP
+                    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+                        mp_obj_t res;
+                        if (vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI,
+                            MP_OBJ_SMALL_INT_VALUE(lhs), MP_OBJ_SMALL_INT_VALUE(rhs), &res)) {
+                            SET_TOP(res);
+                            DISPATCH();
+                        }
+                    }
+                    #endif
                     SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                     DISPATCH();
                 }
@@ -1202,6 +1681,16 @@ yield:
                     } else if (ip[-1] < MP_BC_BINARY_OP_MULTI + 35) {
                         mp_obj_t rhs = POP();
                         mp_obj_t lhs = TOP();
+                        #if MICROPY_OPT_SMALL_INT_BINARY_OP
+                        if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+                            mp_obj_t res;
+                            if (vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI,
+                                MP_OBJ_SMALL_INT_VALUE(lhs), MP_OBJ_SMALL_INT_VALUE(rhs), &res)) {
+                                SET_TOP(res);
+                                DISPATCH();
+                            }
+                        }
+                        #endif
                         SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                         DISPATCH();
                     } else
@@ -1209,6 +1698,7 @@ yield:
                 {
                     mp_obj_t obj = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "byte code not implemented");
                     nlr_pop();
+                    VM_PROFILE_EXIT(code_state);
                     fastn[0] = obj;
                     return MP_VM_RETURN_EXCEPTION;
                 }
@@ -1218,6 +1708,13 @@ yield:
 #endif
 
 pending_exception_check:
+                #if MICROPY_ENABLE_SCHEDULER
+                if (MP_STATE_VM(sched_len) != 0) {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_sched_run_pending();
+                }
+                #endif
+
                 if (MP_STATE_VM(mp_pending_exception) != MP_OBJ_NULL) {
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t obj = MP_STATE_VM(mp_pending_exception);
@@ -1225,14 +1722,27 @@ pending_exception_check:
                     RAISE(obj);
                 }
 
+                #if MICROPY_PY_THREAD
+                if (--gil_divisor == 0) {
+                    gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
+                    mp_thread_gil_yield();
+                }
+                #endif
+
             } // for loop
 
         } else {
 exception_handler:
             // exception occurred
 
+            #if MICROPY_STACKLESS
+            code_state = code_state_cur;
+            fastn = &code_state->state[code_state->n_state - 1];
+            exc_stack = (mp_exc_stack_t*)(code_state->state + code_state->n_state);
+            #endif
+
             #if MICROPY_PY_SYS_EXC_INFO
-            MP_STATE_VM(cur_exception) = nlr.ret_val;
+            MP_STATE_THREAD(cur_exception) = nlr.ret_val;
             #endif
 
             #if SELECTIVE_EXC_IP
@@ -1257,35 +1767,13 @@ unwind_loop:
             // But consider how to handle nested exceptions.
             // TODO need a better way of not adding traceback to constant objects (right now, just GeneratorExit_obj and MemoryError_obj)
             if (mp_obj_is_exception_instance(nlr.ret_val) && nlr.ret_val != &mp_const_GeneratorExit_obj && nlr.ret_val != &mp_const_MemoryError_obj) {
-                const byte *ip = code_state->code_info;
-                mp_uint_t code_info_size = mp_decode_uint(&ip);
-                qstr block_name = mp_decode_uint(&ip);
-                qstr source_file = mp_decode_uint(&ip);
-                mp_uint_t bc = code_state->ip - code_state->code_info - code_info_size;
-                mp_uint_t source_line = 1;
-                mp_uint_t c;
-                while ((c = *ip)) {
-                    mp_uint_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
+                #if MICROPY_OPT_LAZY_TRACEBACK
+                mp_obj_exception_add_traceback_ip(nlr.ret_val, code_state->code_info, code_state->ip);
+                #else
+                qstr block_name, source_file;
+                mp_uint_t source_line = mp_bytecode_get_source_line(code_state->code_info, code_state->ip, &block_name, &source_file);
                 mp_obj_exception_add_traceback(nlr.ret_val, source_file, source_line, block_name);
+                #endif
             }
 
             while (currently_in_except_block) {
@@ -1317,8 +1805,15 @@ unwind_loop:
 
             #if MICROPY_STACKLESS
             } else if (code_state->prev != NULL) {
+                VM_PROFILE_EXIT(code_state);
                 mp_globals_set(code_state->old_globals);
-                code_state = code_state->prev;
+                mp_code_state *new_state = code_state->prev;
+                mp_obj_fun_bc_release_codestate(code_state);
+                code_state = new_state;
+                code_state_cur = code_state;
+                #if MICROPY_VM_CURRENT_CODE_STATE
+                MP_STATE_THREAD(current_code_state) = code_state;
+                #endif
                 fastn = &code_state->state[code_state->n_state - 1];
                 exc_stack = (mp_exc_stack_t*)(code_state->state + code_state->n_state);
                 // variables that are visible to the exception handler (declared volatile)
@@ -1330,6 +1825,7 @@ unwind_loop:
             } else {
                 // propagate exception to higher level
                 // TODO what to do about ip and sp? they don't really make sense at this point
+                VM_PROFILE_EXIT(code_state);
                 fastn[0] = nlr.ret_val; // must put exception here because sp is invalid
                 return MP_VM_RETURN_EXCEPTION;
             }
@@ -78,6 +78,15 @@ static void* entry_table[256] = {
     [MP_BC_POP_BLOCK] = &&entry_MP_BC_POP_BLOCK,
     [MP_BC_POP_EXCEPT] = &&entry_MP_BC_POP_EXCEPT,
     [MP_BC_NOT] = &&entry_MP_BC_NOT,
+    #if MICROPY_OPT_FUSED_OPCODES
+    [MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT] = &&entry_MP_BC_LOAD_FAST_BINARY_OP_SMALL_INT,
+    [MP_BC_STORE_FAST_BINARY_OP_SMALL_INT] = &&entry_MP_BC_STORE_FAST_BINARY_OP_SMALL_INT,
+    [MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE] = &&entry_MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_TRUE,
+    [MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE] = &&entry_MP_BC_BINARY_OP_SMALL_INT_POP_JUMP_IF_FALSE,
+    #endif
+    #if MICROPY_OPT_FOR_RANGE
+    [MP_BC_FOR_RANGE_SMALL_INT] = &&entry_MP_BC_FOR_RANGE_SMALL_INT,
+    #endif
     [MP_BC_BUILD_TUPLE] = &&entry_MP_BC_BUILD_TUPLE,
     [MP_BC_BUILD_LIST] = &&entry_MP_BC_BUILD_LIST,
     [MP_BC_LIST_APPEND] = &&entry_MP_BC_LIST_APPEND,
@@ -36,6 +36,9 @@
 // returned value is always at least 1 greater than argument
 #define ROUND_ALLOC(a) (((a) & ((~0) - 7)) + 8)
 
+// size to grow to when at least n bytes are needed; see MICROPY_ALLOC_VSTR_GROWTH_SHIFT
+#define GROW_ALLOC(n) ROUND_ALLOC((n) + ((n) >> MICROPY_ALLOC_VSTR_GROWTH_SHIFT))
+
 // Init the vstr so it allocs exactly given number of bytes.  Set length to zero.
 void vstr_init(vstr_t *vstr, size_t alloc) {
     if (alloc < 1) {
@@ -50,6 +53,7 @@ void vstr_init(vstr_t *vstr, size_t alloc) {
     }
     vstr->had_error = false;
     vstr->fixed_buf = false;
+    vstr->small_buf = false;
 }
 
 // Init the vstr so it allocs exactly enough ram to hold given length, and set the length.
@@ -64,6 +68,32 @@ void vstr_init_fixed_buf(vstr_t *vstr, size_t alloc, char *buf) {
     vstr->buf = buf;
     vstr->had_error = false;
     vstr->fixed_buf = true;
+    vstr->small_buf = false;
+}
+
+// Init the vstr to use the given buffer (usually on the stack) until it needs
+// more room, at which point its contents are moved to the heap.
+void vstr_init_small_buf(vstr_t *vstr, size_t alloc, char *buf) {
+    vstr->alloc = alloc;
+    vstr->len = 0;
+    vstr->buf = buf;
+    vstr->had_error = false;
+    vstr->fixed_buf = false;
+    vstr->small_buf = true;
+}
+
+// Resize the buffer of a growable vstr, moving it to the heap if it's still
+// in its small buffer.
+STATIC char *vstr_realloc(vstr_t *vstr, size_t new_alloc) {
+    if (vstr->small_buf) {
+        char *new_buf = m_new(char, new_alloc);
+        if (new_buf != NULL) {
+            memcpy(new_buf, vstr->buf, vstr->len);
+            vstr->small_buf = false;
+        }
+        return new_buf;
+    }
+    return m_renew(char, vstr->buf, vstr->alloc, new_alloc);
 }
 
 void vstr_init_print(vstr_t *vstr, size_t alloc, mp_print_t *print) {
@@ -73,7 +103,7 @@ void vstr_init_print(vstr_t *vstr, size_t alloc, mp_print_t *print) {
 }
 
 void vstr_clear(vstr_t *vstr) {
-    if (!vstr->fixed_buf) {
+    if (!vstr->fixed_buf && !vstr->small_buf) {
         m_del(char, vstr->buf, vstr->alloc);
     }
     vstr->buf = NULL;
@@ -134,7 +164,7 @@ char *vstr_extend(vstr_t *vstr, size_t size) {
     if (vstr->fixed_buf) {
         return NULL;
     }
-    char *new_buf = m_renew(char, vstr->buf, vstr->alloc, vstr->alloc + size);
+    char *new_buf = vstr_realloc(vstr, vstr->alloc + size);
     if (new_buf == NULL) {
         vstr->had_error = true;
         return NULL;
@@ -150,8 +180,8 @@ STATIC bool vstr_ensure_extra(vstr_t *vstr, size_t size) {
         if (vstr->fixed_buf) {
             return false;
         }
-        size_t new_alloc = ROUND_ALLOC((vstr->len + size) * 2);
-        char *new_buf = m_renew(char, vstr->buf, vstr->alloc, new_alloc);
+        size_t new_alloc = GROW_ALLOC(vstr->len + size);
+        char *new_buf = vstr_realloc(vstr, new_alloc);
         if (new_buf == NULL) {
             vstr->had_error = true;
             return false;
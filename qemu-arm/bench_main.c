@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "py/nlr.h"
+#include "py/obj.h"
+#include "py/compile.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+#include "py/stackctrl.h"
+#include "py/gc.h"
+#include "py/repl.h"
+
+// Runs the benchmark named on the command line (passed by qemu's -append
+// through semihosting), or nothing if no name is given, so that the
+// instruction count of the empty run can be subtracted as the overhead.
+
+#include "genhdr/bench.h"
+
+STATIC int do_str(const char *src) {
+    mp_lexer_t *lex = mp_lexer_new_from_str_len(MP_QSTR__lt_stdin_gt_, src, strlen(src), 0);
+    if (lex == NULL) {
+        return 1;
+    }
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        mp_call_function_0(module_fun);
+        nlr_pop();
+        return 0;
+    } else {
+        // uncaught exception
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        return 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    mp_stack_set_limit(10240);
+    void *heap = malloc(256 * 1024);
+    gc_init(heap, (char*)heap + 256 * 1024);
+    mp_init();
+    int r = 0;
+    if (argc > 1) {
+        r = 1;
+        for (size_t i = 0; i < MP_ARRAY_SIZE(bench_scripts); i++) {
+            if (strcmp(argv[1], bench_scripts[i].name) == 0) {
+                r = do_str(bench_scripts[i].script);
+                break;
+            }
+        }
+    }
+    mp_deinit();
+    printf("status: %i\n", r);
+    return r;
+}
+
+void gc_collect(void) {
+    gc_collect_start();
+
+    // get the registers and the sp
+    jmp_buf env;
+    setjmp(env);
+    volatile mp_uint_t dummy;
+    void *sp = (void*)&dummy;
+
+    // trace the stack, including the registers (since they live on the stack in this function)
+    gc_collect_root((void**)sp, ((uint32_t)MP_STATE_THREAD(stack_top) - (uint32_t)sp) / sizeof(uint32_t));
+
+    gc_collect_end();
+}
+
+mp_lexer_t *mp_lexer_new_from_file(const char *filename) {
+    return NULL;
+}
+
+mp_import_stat_t mp_import_stat(const char *path) {
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+mp_obj_t mp_builtin_open(uint n_args, const mp_obj_t *args, mp_map_t *kwargs) {
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mp_builtin_open_obj, 1, mp_builtin_open);
+
+void nlr_jump_fail(void *val) {
+}
@@ -31,10 +31,12 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/gc.h"
 #include "adc.h"
 #include "pin.h"
 #include "genhdr/pins.h"
 #include "timer.h"
+#include MICROPY_HAL_H
 
 /// \moduleref pyb
 /// \class ADC - analog to digital conversion: read analog values on a pin
@@ -44,11 +46,15 @@
 ///     adc = pyb.ADC(pin)              # create an analog object from a pin
 ///     val = adc.read()                # read an analog value
 ///
+///     tim = pyb.Timer(8, freq=100000) # sample at 100kHz, in the background
+///     adc.read_timed_stream(buf, tim, callback)
+///
 ///     adc = pyb.ADCAll(resolution)    # creale an ADCAll object
 ///     val = adc.read_channel(channel) # read the given channel
 ///     val = adc.read_core_temp()      # read MCU temperature
 ///     val = adc.read_core_vbat()      # read MCU VBAT
 ///     val = adc.read_core_vref()      # read MCU VREF
+///     adc.read_timed(channels, buf, timer) # sample several channels
 
 /* ADC defintions */
 #define ADCx                    (ADC1)
@@ -75,6 +81,10 @@ typedef struct _pyb_obj_adc_t {
     mp_obj_t pin_name;
     int channel;
     ADC_HandleTypeDef handle;
+    // set while streaming with read_timed_stream()
+    mp_obj_t stream_buf;
+    mp_obj_t stream_callback;
+    volatile int8_t stream_half; // half last filled, -1 if taken
 } pyb_obj_adc_t;
 
 STATIC void adc_init_single(pyb_obj_adc_t *adc_obj) {
@@ -136,6 +146,111 @@ STATIC uint32_t adc_read_channel(ADC_HandleTypeDef *adcHandle) {
     return rawValue;
 }
 
+/******************************************************************************/
+// DMA streaming
+
+// ADC1 requests go to DMA2 stream 0 or 4, channel 0; stream 0 is also one of
+// the SPI1 RX options, so stream 4 is used.
+#define ADC_DMA_STREAM (DMA2_Stream4)
+#define ADC_DMA_CHANNEL (DMA_CHANNEL_0)
+#define ADC_DMA_IRQN (DMA2_Stream4_IRQn)
+
+STATIC DMA_HandleTypeDef adc_dma_handle;
+
+void DMA2_Stream4_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&adc_dma_handle);
+}
+
+STATIC void adc_stream_half_done(ADC_HandleTypeDef *hadc, int half) {
+    pyb_obj_adc_t *self = MP_STATE_PORT(pyb_adc_stream);
+    if (self == NULL || hadc != &self->handle) {
+        return;
+    }
+    self->stream_half = half;
+    if (self->stream_callback != mp_const_none) {
+        // When executing code within a handler we must lock the GC to prevent
+        // any memory allocations.  We must also catch any exceptions.
+        gc_lock();
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            mp_call_function_1(self->stream_callback, MP_OBJ_NEW_SMALL_INT(half));
+            nlr_pop();
+        } else {
+            // Uncaught exception; disable the callback so it doesn't run again.
+            self->stream_callback = mp_const_none;
+            printf("uncaught exception in ADC stream callback\n");
+            mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        }
+        gc_unlock();
+    }
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) {
+    adc_stream_half_done(hadc, 0);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+    adc_stream_half_done(hadc, 1);
+}
+
+// Sets up the given Timer (2 or 8) so that its update event, used as its
+// trigger output, starts a conversion, and returns the ADC trigger setting.
+STATIC uint32_t adc_timer_trigger(mp_obj_t timer) {
+    TIM_HandleTypeDef *tim = pyb_timer_get_handle(timer);
+    uint32_t trigger;
+    if (tim->Instance == TIM2) {
+        trigger = ADC_EXTERNALTRIGCONV_T2_TRGO;
+    #if defined(TIM8)
+    } else if (tim->Instance == TIM8) {
+        trigger = ADC_EXTERNALTRIGCONV_T8_TRGO;
+    #endif
+    } else {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Timer can't trigger the ADC"));
+    }
+    TIM_MasterConfigTypeDef config;
+    config.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    config.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    HAL_TIMEx_MasterConfigSynchronization(tim, &config);
+    return trigger;
+}
+
+// Sets up the DMA stream to move data items of typesize bytes from the ADC
+// to memory, and links it to the given ADC handle.
+STATIC void adc_dma_config(ADC_HandleTypeDef *adcHandle, int typesize, uint32_t mode) {
+    __DMA2_CLK_ENABLE();
+    adc_dma_handle.Instance = ADC_DMA_STREAM;
+    adc_dma_handle.State = HAL_DMA_STATE_READY;
+    HAL_DMA_DeInit(&adc_dma_handle);
+    adc_dma_handle.Init.Channel = ADC_DMA_CHANNEL;
+    adc_dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    adc_dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    adc_dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    adc_dma_handle.Init.PeriphDataAlignment = typesize == 1 ? DMA_PDATAALIGN_BYTE : DMA_PDATAALIGN_HALFWORD;
+    adc_dma_handle.Init.MemDataAlignment = typesize == 1 ? DMA_MDATAALIGN_BYTE : DMA_MDATAALIGN_HALFWORD;
+    adc_dma_handle.Init.Mode = mode;
+    adc_dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+    adc_dma_handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    adc_dma_handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    adc_dma_handle.Init.MemBurst = DMA_MBURST_SINGLE;
+    adc_dma_handle.Init.PeriphBurst = DMA_PBURST_SINGLE;
+    HAL_DMA_Init(&adc_dma_handle);
+    __HAL_LINKDMA(adcHandle, DMA_Handle, adc_dma_handle);
+}
+
+// Stops streaming, if it's going on, and puts the ADC back to software
+// started conversions.  Also called on soft reset.
+void adc_deinit(void) {
+    pyb_obj_adc_t *self = MP_STATE_PORT(pyb_adc_stream);
+    if (self != NULL) {
+        HAL_ADC_Stop_DMA(&self->handle);
+        HAL_NVIC_DisableIRQ(ADC_DMA_IRQN);
+        MP_STATE_PORT(pyb_adc_stream) = NULL;
+        self->stream_buf = MP_OBJ_NULL;
+        self->stream_callback = mp_const_none;
+        adc_init_single(self);
+    }
+}
+
 /******************************************************************************/
 /* Micro Python bindings : adc object (single channel)                        */
 
@@ -181,6 +296,8 @@ STATIC mp_obj_t adc_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
     o->base.type = &pyb_adc_type;
     o->pin_name = pin_obj;
     o->channel = channel;
+    o->stream_callback = mp_const_none;
+    o->stream_half = -1;
     adc_init_single(o);
 
     return o;
@@ -192,6 +309,9 @@ STATIC mp_obj_t adc_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw,
 STATIC mp_obj_t adc_read(mp_obj_t self_in) {
     pyb_obj_adc_t *self = self_in;
 
+    // ADC1 is shared, so this can't be done while streaming
+    adc_deinit();
+
     adc_config_channel(self);
     uint32_t data = adc_read_channel(&self->handle);
     return mp_obj_new_int(data);
@@ -221,6 +341,9 @@ STATIC mp_obj_t adc_read_timed(mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t freq_
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
     int typesize = mp_binary_get_size('@', bufinfo.typecode, NULL);
 
+    // ADC1 is shared, so this can't be done while streaming
+    adc_deinit();
+
     // Init TIM6 at the required frequency (in Hz)
     timer_tim6_init(mp_obj_get_int(freq_in));
 
@@ -278,11 +401,106 @@ STATIC mp_obj_t adc_read_timed(mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t freq_
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(adc_read_timed_obj, adc_read_timed);
 #endif
 
+/// \method read_timed_stream(buf, timer, callback=None)
+/// Start sampling continuously into buf, which is used as a ring of two
+/// halves, and return straight away.  Conversions are triggered by the
+/// given Timer (2 or 8), which sets the sample rate, and the samples are
+/// moved into buf by DMA, so the CPU isn't involved and rates up to 1MHz
+/// are possible.  Each time a half of buf has been filled, callback is
+/// called (from an interrupt) with the number of that half, 0 or 1, while
+/// the other half is being filled.  Buf must have 8 or 16 bit elements; with
+/// 8 bits the sample resolution is reduced to 8 bits.
+///
+/// Example:
+///
+///     buf = array.array('H', bytearray(2000))
+///     tim = pyb.Timer(8, freq=100000)
+///     adc.read_timed_stream(buf, tim)
+///     while True:
+///         half = adc.stream_half()
+///         if half is not None:
+///             process(buf, half * 500, 500)
+///
+/// Streaming goes on until stream_stop() is called, or read() or read_timed()
+/// is used.  This function does not allocate any memory.
+STATIC mp_obj_t adc_read_timed_stream(mp_uint_t n_args, const mp_obj_t *args) {
+    pyb_obj_adc_t *self = args[0];
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    int typesize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    if (typesize > 2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer must have 8 or 16 bit elements"));
+    }
+    uint nelems = bufinfo.len / typesize;
+    if (nelems < 2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+
+    uint32_t trigger = adc_timer_trigger(args[2]);
+
+    // stop any stream already going on
+    adc_deinit();
+
+    // DMA goes round the buffer for ever, interrupting at half and full
+    adc_dma_config(&self->handle, typesize, DMA_CIRCULAR);
+    HAL_NVIC_SetPriority(ADC_DMA_IRQN, 6, 0);
+    HAL_NVIC_EnableIRQ(ADC_DMA_IRQN);
+
+    // one conversion per trigger, each one making a DMA request
+    ADC_HandleTypeDef *adcHandle = &self->handle;
+    adcHandle->Init.Resolution = typesize == 1 ? ADC_RESOLUTION8b : ADC_RESOLUTION12b;
+    adcHandle->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    adcHandle->Init.ExternalTrigConv = trigger;
+    adcHandle->Init.DMAContinuousRequests = ENABLE;
+    HAL_ADC_Init(adcHandle);
+    adc_config_channel(self);
+
+    self->stream_buf = args[1];
+    self->stream_callback = n_args > 3 ? args[3] : mp_const_none;
+    self->stream_half = -1;
+    MP_STATE_PORT(pyb_adc_stream) = self;
+
+    HAL_ADC_Start_DMA(adcHandle, (uint32_t*)bufinfo.buf, nelems);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(adc_read_timed_stream_obj, 3, 4, adc_read_timed_stream);
+
+/// \method stream_half()
+/// Return the half of the buffer (0 or 1) filled since the last call, or
+/// None if neither was.  An alternative to the callback for polling.
+STATIC mp_obj_t adc_stream_half(mp_obj_t self_in) {
+    pyb_obj_adc_t *self = self_in;
+    mp_uint_t irq_state = disable_irq();
+    int half = self->stream_half;
+    self->stream_half = -1;
+    enable_irq(irq_state);
+    if (half < 0) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(half);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_stream_half_obj, adc_stream_half);
+
+/// \method stream_stop()
+/// Stop the sampling started by read_timed_stream().
+STATIC mp_obj_t adc_stream_stop(mp_obj_t self_in) {
+    if (MP_STATE_PORT(pyb_adc_stream) == self_in) {
+        adc_deinit();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_stream_stop_obj, adc_stream_stop);
+
 STATIC const mp_map_elem_t adc_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&adc_read_obj},
     #if defined(TIM6)
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_timed), (mp_obj_t)&adc_read_timed_obj},
     #endif
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_timed_stream), (mp_obj_t)&adc_read_timed_stream_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stream_half), (mp_obj_t)&adc_stream_half_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stream_stop), (mp_obj_t)&adc_stream_stop_obj},
 };
 
 STATIC MP_DEFINE_CONST_DICT(adc_locals_dict, adc_locals_dict_table);
@@ -304,6 +522,8 @@ typedef struct _pyb_adc_all_obj_t {
 } pyb_adc_all_obj_t;
 
 void adc_init_all(pyb_adc_all_obj_t *adc_all, uint32_t resolution) {
+    // ADC1 is shared, so this can't be done while streaming
+    adc_deinit();
 
     switch (resolution) {
         case 6:  resolution = ADC_RESOLUTION6b;  break;
@@ -448,6 +668,174 @@ STATIC mp_obj_t adc_all_read_core_vref(mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_all_read_core_vref_obj, adc_all_read_core_vref);
 #endif
 
+/// \method read_timed(channels, buf, timer, *, simultaneous=False)
+/// Sample the given list of channels each time the Timer (2 or 8) triggers,
+/// until buf is full, and return the number of samples stored.  Buf must
+/// have 16 bit elements (eg array('H')) and gets the samples interleaved:
+/// buf[k * len(channels) + i] is the k-th sample of channels[i].  The
+/// samples are moved by DMA, so there's no per-sample CPU overhead.
+///
+/// Normally ADC1 converts the channels one after another after each trigger.
+/// With simultaneous=True, 2 or 3 channels are converted at the same instant
+/// by ADC1, ADC2 and (for 3) ADC3 in the F4's dual/triple regular
+/// simultaneous mode, giving phase-coherent samples.  ADC3 can't convert
+/// channels 4 to 9, 14 and 15.
+STATIC mp_obj_t adc_all_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_simultaneous, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    pyb_adc_all_obj_t *self = pos_args[0];
+    mp_arg_val_t vals[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 4, pos_args + 4, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, vals);
+    bool simultaneous = vals[0].u_bool;
+
+    mp_uint_t n_chan;
+    mp_obj_t *chan_objs;
+    mp_obj_get_array(pos_args[1], &n_chan, &chan_objs);
+    #if defined(ADC3)
+    #define ADC_MAX_SIMULTANEOUS (3)
+    #elif defined(ADC2)
+    #define ADC_MAX_SIMULTANEOUS (2)
+    #else
+    #define ADC_MAX_SIMULTANEOUS (1) // so there's no simultaneous mode
+    #endif
+    if (n_chan < 1 || n_chan > 16 || (simultaneous && (n_chan < 2 || n_chan > ADC_MAX_SIMULTANEOUS))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad number of channels"));
+    }
+    uint32_t channels[16];
+    for (mp_uint_t i = 0; i < n_chan; i++) {
+        channels[i] = mp_obj_get_int(chan_objs[i]);
+        if (!IS_ADC_CHANNEL(channels[i])) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "not a valid ADC Channel: %d", channels[i]));
+        }
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(pos_args[2], &bufinfo, MP_BUFFER_WRITE);
+    if (mp_binary_get_size('@', bufinfo.typecode, NULL) != 2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer must have 16 bit elements"));
+    }
+    uint nelems = bufinfo.len / 2;
+    nelems -= nelems % n_chan;
+    if (nelems == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+
+    uint32_t trigger = adc_timer_trigger(pos_args[3]);
+    int resolution = adc_get_resolution(&self->handle);
+
+    // ADC1 is shared, so this can't be done while streaming
+    adc_deinit();
+
+    // ADC1 is the master, started by the timer; DMA requests stop once the
+    // buffer is full
+    ADC_HandleTypeDef *adcHandle = &self->handle;
+    adcHandle->Init.ScanConvMode = simultaneous ? DISABLE : ENABLE;
+    adcHandle->Init.NbrOfConversion = simultaneous ? 1 : n_chan;
+    adcHandle->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    adcHandle->Init.ExternalTrigConv = trigger;
+    adcHandle->Init.DMAContinuousRequests = DISABLE;
+    HAL_ADC_Init(adcHandle);
+
+    ADC_ChannelConfTypeDef sConfig;
+    sConfig.SamplingTime = ADC_SAMPLETIME_15CYCLES;
+    sConfig.Offset = 0;
+    ADC_HandleTypeDef slaves[2];
+    memset(slaves, 0, sizeof(slaves));
+    if (!simultaneous) {
+        for (mp_uint_t i = 0; i < n_chan; i++) {
+            sConfig.Channel = channels[i];
+            sConfig.Rank = i + 1;
+            HAL_ADC_ConfigChannel(adcHandle, &sConfig);
+        }
+    } else {
+        sConfig.Channel = channels[0];
+        sConfig.Rank = 1;
+        HAL_ADC_ConfigChannel(adcHandle, &sConfig);
+
+        #if ADC_MAX_SIMULTANEOUS > 1
+        // ADC2 (and ADC3) convert along with ADC1, not on their own trigger
+        __ADC2_CLK_ENABLE();
+        #if ADC_MAX_SIMULTANEOUS > 2
+        __ADC3_CLK_ENABLE();
+        #endif
+        for (mp_uint_t i = 0; i < n_chan - 1; i++) {
+            #if ADC_MAX_SIMULTANEOUS > 2
+            slaves[i].Instance = i == 0 ? ADC2 : ADC3;
+            #else
+            slaves[i].Instance = ADC2;
+            #endif
+            slaves[i].Init = adcHandle->Init;
+            slaves[i].Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+            HAL_ADC_Init(&slaves[i]);
+            sConfig.Channel = channels[i + 1];
+            HAL_ADC_ConfigChannel(&slaves[i], &sConfig);
+            __HAL_ADC_ENABLE(&slaves[i]);
+        }
+
+        // with DMA mode 1 the results come out as ADC1, ADC2[, ADC3] halfwords
+        ADC_MultiModeTypeDef multimode;
+        multimode.Mode = n_chan == 2 ? ADC_DUALMODE_REGSIMULT : ADC_TRIPLEMODE_REGSIMULT;
+        multimode.DMAAccessMode = ADC_DMAACCESSMODE_1;
+        multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_5CYCLES;
+        HAL_ADCEx_MultiModeConfigChannel(adcHandle, &multimode);
+        #endif
+    }
+
+    adc_dma_config(adcHandle, 2, DMA_NORMAL);
+    HAL_NVIC_SetPriority(ADC_DMA_IRQN, 6, 0);
+    HAL_NVIC_EnableIRQ(ADC_DMA_IRQN);
+    if (simultaneous) {
+        HAL_ADCEx_MultiModeStart_DMA(adcHandle, (uint32_t*)bufinfo.buf, nelems);
+    } else {
+        HAL_ADC_Start_DMA(adcHandle, (uint32_t*)bufinfo.buf, nelems);
+    }
+
+    // Sleep until the buffer is full.  An overrun (sampling too fast) stops
+    // the DMA, as does the timer not running, so give up if no progress is
+    // made for a while.
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t remain = nelems;
+    uint32_t start = HAL_GetTick();
+    for (;;) {
+        uint32_t n = __HAL_DMA_GET_COUNTER(&adc_dma_handle);
+        if (n == 0) {
+            break;
+        }
+        if (ADCx->SR & ADC_FLAG_OVR) {
+            status = HAL_ERROR;
+            break;
+        }
+        if (n != remain) {
+            remain = n;
+            start = HAL_GetTick();
+        } else if (HAL_GetTick() - start > 1000) {
+            status = HAL_TIMEOUT;
+            break;
+        }
+        __WFI();
+    }
+
+    // back to independent, software started conversions
+    if (simultaneous) {
+        HAL_ADCEx_MultiModeStop_DMA(adcHandle);
+        ADC->CCR &= ~(ADC_CCR_MULTI | ADC_CCR_DMA);
+        for (mp_uint_t i = 0; i < n_chan - 1; i++) {
+            __HAL_ADC_DISABLE(&slaves[i]);
+        }
+    } else {
+        HAL_ADC_Stop_DMA(adcHandle);
+    }
+    HAL_NVIC_DisableIRQ(ADC_DMA_IRQN);
+    adc_init_all(self, resolution);
+
+    if (status != HAL_OK) {
+        mp_hal_raise(status);
+    }
+    return mp_obj_new_int(nelems);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_all_read_timed_obj, 4, adc_all_read_timed);
+
 STATIC const mp_map_elem_t adc_all_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_channel),   (mp_obj_t)&adc_all_read_channel_obj},
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_core_temp), (mp_obj_t)&adc_all_read_core_temp_obj},
@@ -455,6 +843,7 @@ STATIC const mp_map_elem_t adc_all_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_core_vbat), (mp_obj_t)&adc_all_read_core_vbat_obj},
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_core_vref), (mp_obj_t)&adc_all_read_core_vref_obj},
 #endif
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_timed), (mp_obj_t)&adc_all_read_timed_obj},
 };
 
 STATIC MP_DEFINE_CONST_DICT(adc_all_locals_dict, adc_all_locals_dict_table);
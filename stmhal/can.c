@@ -64,6 +64,16 @@
 ///     can = pyb.CAN(1, pyb.CAN.LOOPBACK)
 ///     can.send('message!', 123)   # send message with id 123
 ///     can.recv(0)                 # receive message on FIFO 0
+///
+/// For bursty traffic the bus can be initialised with `rx_buf_len` so that
+/// an IRQ drains each hardware FIFO into a software ring of raw frames:
+///
+///     can = pyb.CAN(1, pyb.CAN.LOOPBACK, rx_buf_len=64)
+///     buf = bytearray(16 * 8)     # room for 8 frame records
+///     n = can.recv_into(0, buf)   # no heap allocation
+
+// each frame record written by recv_into is 16 bytes
+#define CAN_FRAME_REC_SIZE (16)
 
 typedef enum _rx_state_t {
     RX_STATE_FIFO_EMPTY = 0,
@@ -72,6 +82,16 @@ typedef enum _rx_state_t {
     RX_STATE_FIFO_OVERFLOW,
 } rx_state_t;
 
+// Software rx ring for one FIFO.  Each entry is a raw copy of the hardware
+// mailbox: RIR, RDTR, RDLR, RDHR.  It holds at most rx_buf_len - 1 frames.
+typedef struct _can_rx_ring_t {
+    volatile uint16_t head; // written by the IRQ handler
+    volatile uint16_t tail; // written by the reader
+    uint32_t dropped;       // frames lost because the ring was full
+    uint32_t overrun;       // hardware FIFO overrun events
+    uint32_t (*frame)[4];
+} can_rx_ring_t;
+
 typedef struct _pyb_can_obj_t {
     mp_obj_base_t base;
     mp_obj_t rxcallback0;
@@ -81,10 +101,13 @@ typedef struct _pyb_can_obj_t {
     bool extframe : 1;
     byte rx_state0;
     byte rx_state1;
+    uint16_t rx_buf_len; // in frames; 0 means no software rx ring
+    can_rx_ring_t rx_ring[2];
     CAN_HandleTypeDef can;
 } pyb_can_obj_t;
 
 STATIC mp_obj_t pyb_can_deinit(mp_obj_t self_in);
+STATIC mp_obj_t pyb_can_rxcallback(mp_obj_t self_in, mp_obj_t fifo_in, mp_obj_t callback_in);
 
 STATIC uint8_t can2_start_bank = 14;
 
@@ -260,6 +283,127 @@ STATIC HAL_StatusTypeDef CAN_Transmit(CAN_HandleTypeDef *hcan, uint32_t Timeout)
     }
 }
 
+// (Re)allocate the software rx rings; len == 0 frees them.
+STATIC void can_rx_ring_init(pyb_can_obj_t *self, mp_uint_t len) {
+    uint32_t (*frame[2])[4] = {NULL, NULL};
+    if (len != 0) {
+        if (len < 2 || len > 0xffff) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "rx_buf_len must be 2-65535"));
+        }
+        frame[0] = (uint32_t(*)[4])m_new(uint32_t, 4 * len);
+        frame[1] = (uint32_t(*)[4])m_new(uint32_t, 4 * len);
+    }
+
+    // swap the rings with IRQs off so the rx handler never sees a half-updated ring
+    mp_uint_t old_len = self->rx_buf_len;
+    uint32_t (*old_frame[2])[4] = {self->rx_ring[0].frame, self->rx_ring[1].frame};
+    mp_uint_t irq_state = disable_irq();
+    self->rx_buf_len = len;
+    for (int i = 0; i < 2; i++) {
+        can_rx_ring_t *ring = &self->rx_ring[i];
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+        ring->overrun = 0;
+        ring->frame = frame[i];
+    }
+    enable_irq(irq_state);
+
+    if (old_len != 0) {
+        m_del(uint32_t, old_frame[0], 4 * old_len);
+        m_del(uint32_t, old_frame[1], 4 * old_len);
+    }
+}
+
+STATIC bool can_rx_any(pyb_can_obj_t *self, mp_uint_t fifo) {
+    if (self->rx_buf_len != 0) {
+        can_rx_ring_t *ring = &self->rx_ring[fifo];
+        return ring->head != ring->tail;
+    }
+    return __HAL_CAN_MSG_PENDING(&self->can, fifo) != 0;
+}
+
+// Wait up to timeout ms for a frame; returns false if none arrived.
+STATIC bool can_rx_wait(pyb_can_obj_t *self, mp_uint_t fifo, uint32_t timeout) {
+    uint32_t start = HAL_GetTick();
+    while (!can_rx_any(self, fifo)) {
+        if (HAL_GetTick() - start >= timeout) {
+            return false;
+        }
+        __WFI();
+    }
+    return true;
+}
+
+// Manage the rx state machine after a message has been taken from a hardware
+// FIFO (only used when there is no software rx ring).
+STATIC void can_rx_state_update(pyb_can_obj_t *self, mp_uint_t fifo) {
+    if ((fifo == CAN_FIFO0 && self->rxcallback0 != mp_const_none) ||
+        (fifo == CAN_FIFO1 && self->rxcallback1 != mp_const_none)) {
+        byte *state = (fifo == CAN_FIFO0) ? &self->rx_state0 : &self->rx_state1;
+
+        switch (*state) {
+        case RX_STATE_FIFO_EMPTY:
+            break;
+        case RX_STATE_MESSAGE_PENDING:
+            if (__HAL_CAN_MSG_PENDING(&self->can, fifo) == 0) {
+                // Fifo is empty
+                __HAL_CAN_ENABLE_IT(&self->can, (fifo == CAN_FIFO0) ? CAN_IT_FMP0 : CAN_IT_FMP1);
+                *state = RX_STATE_FIFO_EMPTY;
+            }
+            break;
+        case RX_STATE_FIFO_FULL:
+            __HAL_CAN_ENABLE_IT(&self->can, (fifo == CAN_FIFO0) ? CAN_IT_FF0 : CAN_IT_FF1);
+            *state = RX_STATE_MESSAGE_PENDING;
+            break;
+        case RX_STATE_FIFO_OVERFLOW:
+            __HAL_CAN_ENABLE_IT(&self->can, (fifo == CAN_FIFO0) ? CAN_IT_FOV0 : CAN_IT_FOV1);
+            __HAL_CAN_ENABLE_IT(&self->can, (fifo == CAN_FIFO0) ? CAN_IT_FF0  : CAN_IT_FF1);
+            *state = RX_STATE_MESSAGE_PENDING;
+            break;
+        }
+    }
+}
+
+// Take the oldest raw frame from the software ring, or straight from the
+// hardware FIFO if there is no ring.  Returns false if there is none.
+STATIC bool can_rx_pop(pyb_can_obj_t *self, mp_uint_t fifo, uint32_t *frame) {
+    if (self->rx_buf_len != 0) {
+        can_rx_ring_t *ring = &self->rx_ring[fifo];
+        if (ring->head == ring->tail) {
+            return false;
+        }
+        memcpy(frame, ring->frame[ring->tail], 4 * sizeof(uint32_t));
+        ring->tail = (ring->tail + 1) % self->rx_buf_len;
+        return true;
+    }
+    if (__HAL_CAN_MSG_PENDING(&self->can, fifo) == 0) {
+        return false;
+    }
+    CAN_FIFOMailBox_TypeDef *mb = &self->can.Instance->sFIFOMailBox[fifo];
+    frame[0] = mb->RIR;
+    frame[1] = mb->RDTR;
+    frame[2] = mb->RDLR;
+    frame[3] = mb->RDHR;
+    __HAL_CAN_FIFO_RELEASE(&self->can, fifo);
+    can_rx_state_update(self, fifo);
+    return true;
+}
+
+STATIC mp_obj_t can_frame_to_tuple(const uint32_t *frame) {
+    mp_obj_tuple_t *tuple = mp_obj_new_tuple(4, NULL);
+    if (frame[0] & CAN_RI0R_IDE) {
+        tuple->items[0] = MP_OBJ_NEW_SMALL_INT(frame[0] >> 3);
+    } else {
+        tuple->items[0] = MP_OBJ_NEW_SMALL_INT(frame[0] >> 21);
+    }
+    tuple->items[1] = (frame[0] & CAN_RI0R_RTR) ? mp_const_true : mp_const_false;
+    tuple->items[2] = MP_OBJ_NEW_SMALL_INT((frame[1] >> 8) & 0xff);
+    mp_uint_t dlc = MIN(frame[1] & 0xf, 8);
+    tuple->items[3] = mp_obj_new_bytes((const byte*)&frame[2], dlc);
+    return tuple;
+}
+
 /******************************************************************************/
 // Micro Python bindings
 
@@ -286,7 +430,7 @@ STATIC void pyb_can_print(const mp_print_t *print, mp_obj_t self_in, mp_print_ki
     }
 }
 
-// init(mode, extframe=False, prescaler=100, *, sjw=1, bs1=6, bs2=8)
+// init(mode, extframe=False, prescaler=100, *, sjw=1, bs1=6, bs2=8, rx_buf_len=0)
 STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_mode,         MP_ARG_REQUIRED | MP_ARG_INT,   {.u_int  = CAN_MODE_NORMAL} },
@@ -295,6 +439,7 @@ STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, mp_uint_t n_args, const
         { MP_QSTR_sjw,          MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 1} },
         { MP_QSTR_bs1,          MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 6} },
         { MP_QSTR_bs2,          MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 8} },
+        { MP_QSTR_rx_buf_len,   MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 0} },
     };
 
     // parse args
@@ -303,6 +448,10 @@ STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, mp_uint_t n_args, const
 
     self->extframe = args[1].u_bool;
 
+    // set up the software rx rings before the peripheral can receive
+    mp_uint_t old_rx_buf_len = self->rx_buf_len;
+    can_rx_ring_init(self, args[6].u_int);
+
     // set the CAN configuration values
     memset(&self->can, 0, sizeof(self->can));
     CAN_InitTypeDef *init = &self->can.Init;
@@ -323,6 +472,27 @@ STATIC mp_obj_t pyb_can_init_helper(pyb_can_obj_t *self, mp_uint_t n_args, const
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "CAN port %d does not exist", self->can_id));
     }
 
+    if (self->rx_buf_len != 0) {
+        // the rx IRQs run continuously, draining each FIFO into its ring
+        IRQn_Type irq0 = (self->can_id == PYB_CAN_1) ? CAN1_RX0_IRQn : CAN2_RX0_IRQn;
+        IRQn_Type irq1 = (self->can_id == PYB_CAN_1) ? CAN1_RX1_IRQn : CAN2_RX1_IRQn;
+        HAL_NVIC_SetPriority(irq0, 7, 0);
+        HAL_NVIC_EnableIRQ(irq0);
+        HAL_NVIC_SetPriority(irq1, 7, 0);
+        HAL_NVIC_EnableIRQ(irq1);
+        __HAL_CAN_DISABLE_IT(&self->can, CAN_IT_FF0 | CAN_IT_FF1);
+        __HAL_CAN_ENABLE_IT(&self->can, CAN_IT_FMP0 | CAN_IT_FOV0 | CAN_IT_FMP1 | CAN_IT_FOV1);
+    } else if (old_rx_buf_len != 0) {
+        // back to direct FIFO access; restart the rx callback state machines
+        for (mp_uint_t fifo = 0; fifo < 2; fifo++) {
+            mp_obj_t callback = (fifo == 0) ? self->rxcallback0 : self->rxcallback1;
+            pyb_can_rxcallback(self, MP_OBJ_NEW_SMALL_INT(fifo), mp_const_none);
+            if (callback != mp_const_none) {
+                pyb_can_rxcallback(self, MP_OBJ_NEW_SMALL_INT(fifo), callback);
+            }
+        }
+    }
+
     return mp_const_none;
 }
 
@@ -369,6 +539,8 @@ STATIC mp_obj_t pyb_can_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n
     MP_STATE_PORT(pyb_can_obj_all)[o->can_id - 1] = o;
     o->rx_state0 = RX_STATE_FIFO_EMPTY;
     o->rx_state1 = RX_STATE_FIFO_EMPTY;
+    o->rx_buf_len = 0;
+    memset(o->rx_ring, 0, sizeof(o->rx_ring));
 
     if (n_args > 1 || n_kw > 0) {
         // start the peripheral
@@ -413,16 +585,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_can_deinit_obj, pyb_can_deinit);
 STATIC mp_obj_t pyb_can_any(mp_obj_t self_in, mp_obj_t fifo_in) {
     pyb_can_obj_t *self = self_in;
     mp_int_t fifo = mp_obj_get_int(fifo_in);
-    if (fifo == 0) {
-        if (__HAL_CAN_MSG_PENDING(&self->can, CAN_FIFO0) != 0) {
-            return mp_const_true;
-        }
-    } else {
-        if (__HAL_CAN_MSG_PENDING(&self->can, CAN_FIFO1) != 0) {
-            return mp_const_true;
-        }
-    }
-    return mp_const_false;
+    return MP_BOOL(can_rx_any(self, fifo == 0 ? CAN_FIFO0 : CAN_FIFO1));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_can_any_obj, pyb_can_any);
 
@@ -505,6 +668,17 @@ STATIC mp_obj_t pyb_can_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    if (self->rx_buf_len != 0) {
+        // take the next frame from the software ring
+        mp_uint_t fifo = args[0].u_int == 0 ? CAN_FIFO0 : CAN_FIFO1;
+        uint32_t frame[4];
+        if (!can_rx_wait(self, fifo, args[1].u_int)) {
+            mp_hal_raise(HAL_TIMEOUT);
+        }
+        can_rx_pop(self, fifo, frame);
+        return can_frame_to_tuple(frame);
+    }
+
     // receive the data
     CanRxMsgTypeDef rx_msg;
     self->can.pRxMsg = &rx_msg;
@@ -515,31 +689,7 @@ STATIC mp_obj_t pyb_can_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     }
 
     // Manage the rx state machine
-    if ((args[0].u_int == CAN_FIFO0 && self->rxcallback0 != mp_const_none) ||
-        (args[0].u_int == CAN_FIFO1 && self->rxcallback1 != mp_const_none)) {
-        byte *state = (args[0].u_int == CAN_FIFO0) ? &self->rx_state0 : &self->rx_state1;
-
-        switch (*state) {
-        case RX_STATE_FIFO_EMPTY:
-            break;
-        case RX_STATE_MESSAGE_PENDING:
-            if (__HAL_CAN_MSG_PENDING(&self->can, args[0].u_int) == 0) {
-                // Fifo is empty
-                __HAL_CAN_ENABLE_IT(&self->can, (args[0].u_int == CAN_FIFO0) ? CAN_IT_FMP0 : CAN_IT_FMP1);
-                *state = RX_STATE_FIFO_EMPTY;
-            }
-            break;
-        case RX_STATE_FIFO_FULL:
-            __HAL_CAN_ENABLE_IT(&self->can, (args[0].u_int == CAN_FIFO0) ? CAN_IT_FF0 : CAN_IT_FF1);
-            *state = RX_STATE_MESSAGE_PENDING;
-            break;
-        case RX_STATE_FIFO_OVERFLOW:
-            __HAL_CAN_ENABLE_IT(&self->can, (args[0].u_int == CAN_FIFO0) ? CAN_IT_FOV0 : CAN_IT_FOV1);
-            __HAL_CAN_ENABLE_IT(&self->can, (args[0].u_int == CAN_FIFO0) ? CAN_IT_FF0  : CAN_IT_FF1);
-            *state = RX_STATE_MESSAGE_PENDING;
-            break;
-        }
-    }
+    can_rx_state_update(self, args[0].u_int);
 
     // return the received data
     // TODO use a namedtuple (when namedtuple types can be stored in ROM)
@@ -561,6 +711,94 @@ STATIC mp_obj_t pyb_can_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_recv_obj, 1, pyb_can_recv);
 
+/// \method recv_into(fifo, buf, *, timeout=0)
+///
+/// Receive as many waiting messages as fit into `buf` without allocating.
+/// `buf` must be a writable buffer; each message takes a 16 byte record:
+///
+///   - bytes 0-3: the id, as a little-endian uint32
+///   - byte 4: flags, bit 0 set for a remote frame, bit 1 for an extended id
+///   - byte 5: index of the filter that matched
+///   - byte 6: number of data bytes (0-8)
+///   - byte 7: reserved (0)
+///   - bytes 8-15: the data bytes
+///
+/// `timeout` is how long in milliseconds to wait for the first message.
+///
+/// Return value: the number of records written.
+STATIC mp_obj_t pyb_can_recv_into(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fifo,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_buf,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+
+    // parse args
+    pyb_can_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_uint_t fifo = args[0].u_int == 0 ? CAN_FIFO0 : CAN_FIFO1;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t max = bufinfo.len / CAN_FRAME_REC_SIZE;
+
+    mp_uint_t n = 0;
+    if (max > 0 && can_rx_wait(self, fifo, args[2].u_int)) {
+        byte *rec = bufinfo.buf;
+        uint32_t frame[4];
+        while (n < max && can_rx_pop(self, fifo, frame)) {
+            uint32_t id = (frame[0] & CAN_RI0R_IDE) ? frame[0] >> 3 : frame[0] >> 21;
+            memcpy(rec, &id, 4);
+            rec[4] = ((frame[0] & CAN_RI0R_RTR) ? 1 : 0) | ((frame[0] & CAN_RI0R_IDE) ? 2 : 0);
+            rec[5] = (frame[1] >> 8) & 0xff;
+            rec[6] = MIN(frame[1] & 0xf, 8);
+            rec[7] = 0;
+            memcpy(rec + 8, &frame[2], 8);
+            rec += CAN_FRAME_REC_SIZE;
+            n += 1;
+        }
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_can_recv_into_obj, 1, pyb_can_recv_into);
+
+/// \method rxstats(fifo)
+///
+/// Return a tuple `(waiting, dropped, overruns)` for the FIFO: the number of
+/// messages waiting to be received, the number lost because the software
+/// rx ring was full, and the number of hardware FIFO overruns seen.  The
+/// counters are reset by `init`.
+STATIC mp_obj_t pyb_can_rxstats(mp_obj_t self_in, mp_obj_t fifo_in) {
+    pyb_can_obj_t *self = self_in;
+    mp_uint_t fifo = mp_obj_get_int(fifo_in) == 0 ? CAN_FIFO0 : CAN_FIFO1;
+    can_rx_ring_t *ring = &self->rx_ring[fifo];
+    volatile uint32_t *rfr = (fifo == CAN_FIFO0) ? &self->can.Instance->RF0R : &self->can.Instance->RF1R;
+
+    // without a ring the overrun IRQ may be off, so pick up the flag here
+    mp_uint_t irq_state = disable_irq();
+    if (*rfr & CAN_RF0R_FOVR0) {
+        *rfr = CAN_RF0R_FOVR0;
+        ring->overrun += 1;
+    }
+    enable_irq(irq_state);
+
+    mp_uint_t waiting;
+    if (self->rx_buf_len != 0) {
+        waiting = (ring->head + self->rx_buf_len - ring->tail) % self->rx_buf_len;
+    } else {
+        waiting = __HAL_CAN_MSG_PENDING(&self->can, fifo);
+    }
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_uint(waiting),
+        mp_obj_new_int_from_uint(ring->dropped),
+        mp_obj_new_int_from_uint(ring->overrun),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_can_rxstats_obj, pyb_can_rxstats);
+
 /// \class method initfilterbanks
 ///
 /// Set up the filterbanks. All filter will be disabled and set to their reset states.
@@ -728,7 +966,13 @@ STATIC mp_obj_t pyb_can_rxcallback(mp_obj_t self_in, mp_obj_t fifo_in, mp_obj_t
     mp_obj_t *callback;
 
     callback = (fifo == 0) ? &self->rxcallback0 : &self->rxcallback1;
-    if (callback_in == mp_const_none) {
+    if (self->rx_buf_len != 0) {
+        // the rx IRQs are always on when there is a software ring
+        if (callback_in != mp_const_none && !mp_obj_is_callable(callback_in)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "callback must be None or a callable object"));
+        }
+        *callback = callback_in;
+    } else if (callback_in == mp_const_none) {
         __HAL_CAN_DISABLE_IT(&self->can, (fifo == 0) ? CAN_IT_FMP0 : CAN_IT_FMP1);
         __HAL_CAN_DISABLE_IT(&self->can, (fifo == 0) ? CAN_IT_FF0 : CAN_IT_FF1);
         __HAL_CAN_DISABLE_IT(&self->can, (fifo == 0) ? CAN_IT_FOV0 : CAN_IT_FOV1);
@@ -762,6 +1006,8 @@ STATIC const mp_map_elem_t pyb_can_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_any), (mp_obj_t)&pyb_can_any_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_send), (mp_obj_t)&pyb_can_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv), (mp_obj_t)&pyb_can_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into), (mp_obj_t)&pyb_can_recv_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rxstats), (mp_obj_t)&pyb_can_rxstats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_initfilterbanks), (mp_obj_t)&pyb_can_initfilterbanks_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setfilter), (mp_obj_t)&pyb_can_setfilter_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_clearfilter), (mp_obj_t)&pyb_can_clearfilter_obj },
@@ -789,13 +1035,19 @@ mp_uint_t can_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t arg, int *err
         mp_uint_t flags = arg;
         ret = 0;
         if ((flags & MP_IOCTL_POLL_RD)
-            && ((__HAL_CAN_MSG_PENDING(&self->can, CAN_FIFO0) != 0)
-                || (__HAL_CAN_MSG_PENDING(&self->can, CAN_FIFO1) != 0))) {
+            && (can_rx_any(self, CAN_FIFO0) || can_rx_any(self, CAN_FIFO1))) {
             ret |= MP_IOCTL_POLL_RD;
         }
         if ((flags & MP_IOCTL_POLL_WR) && (self->can.Instance->TSR & CAN_TSR_TME)) {
             ret |= MP_IOCTL_POLL_WR;
         }
+    } else if (request == MP_IOCTL_POLL_IRQ && !(arg & MP_IOCTL_POLL_WR)
+        && (self->rx_buf_len != 0
+            || (self->can.Instance->IER & (CAN_IT_FMP0 | CAN_IT_FMP1)) == (CAN_IT_FMP0 | CAN_IT_FMP1))) {
+        // a message arriving in either FIFO is signalled by its rx IRQ, which
+        // is always enabled with a software ring, and otherwise only while
+        // there is an rx callback and the FIFO is empty
+        ret = 0;
     } else {
         *errcode = EINVAL;
         ret = -1;
@@ -811,6 +1063,8 @@ void can_rx_irq_handler(uint can_id, uint fifo_id) {
 
     self = MP_STATE_PORT(pyb_can_obj_all)[can_id - 1];
 
+    MP_IOCTL_POLL_NOTIFY();
+
     if (fifo_id == CAN_FIFO0) {
         callback = self->rxcallback0;
         state = &self->rx_state0;
@@ -819,25 +1073,66 @@ void can_rx_irq_handler(uint can_id, uint fifo_id) {
         state = &self->rx_state1;
     }
 
-    switch (*state) {
-        case RX_STATE_FIFO_EMPTY:
-            __HAL_CAN_DISABLE_IT(&self->can,  (fifo_id == CAN_FIFO0) ? CAN_IT_FMP0 : CAN_IT_FMP1);
-            irq_reason = MP_OBJ_NEW_SMALL_INT(0);
-            *state = RX_STATE_MESSAGE_PENDING;
-            break;
-        case RX_STATE_MESSAGE_PENDING:
-            __HAL_CAN_DISABLE_IT(&self->can, (fifo_id == CAN_FIFO0) ? CAN_IT_FF0 : CAN_IT_FF1);
-            irq_reason = MP_OBJ_NEW_SMALL_INT(1);
-            *state = RX_STATE_FIFO_FULL;
-            break;
-        case RX_STATE_FIFO_FULL:
-            __HAL_CAN_DISABLE_IT(&self->can, (fifo_id == CAN_FIFO0) ? CAN_IT_FOV0 : CAN_IT_FOV1);
+    if (self->rx_buf_len != 0) {
+        // drain the hardware FIFO into the software ring
+        can_rx_ring_t *ring = &self->rx_ring[fifo_id];
+        volatile uint32_t *rfr = (fifo_id == CAN_FIFO0) ? &self->can.Instance->RF0R : &self->can.Instance->RF1R;
+        bool was_empty = ring->head == ring->tail;
+        bool lost = false;
+        if (*rfr & CAN_RF0R_FOVR0) {
+            // FULL and FOVR are cleared by writing 1
+            *rfr = CAN_RF0R_FULL0 | CAN_RF0R_FOVR0;
+            ring->overrun += 1;
+            lost = true;
+        }
+        while (*rfr & CAN_RF0R_FMP0) {
+            uint16_t next_head = (ring->head + 1) % self->rx_buf_len;
+            if (next_head != ring->tail) {
+                CAN_FIFOMailBox_TypeDef *mb = &self->can.Instance->sFIFOMailBox[fifo_id];
+                uint32_t *frame = ring->frame[ring->head];
+                frame[0] = mb->RIR;
+                frame[1] = mb->RDTR;
+                frame[2] = mb->RDLR;
+                frame[3] = mb->RDHR;
+                ring->head = next_head;
+            } else {
+                ring->dropped += 1;
+                lost = true;
+            }
+            *rfr = CAN_RF0R_RFOM0;
+        }
+
+        // the callback reasons mirror the FIFO states: 0 = messages now
+        // waiting, 1 = ring full, 2 = messages lost
+        if (lost) {
             irq_reason = MP_OBJ_NEW_SMALL_INT(2);
-            *state = RX_STATE_FIFO_OVERFLOW;
-            break;
-        case RX_STATE_FIFO_OVERFLOW:
-            // This should never happen
-            break;
+        } else if ((ring->head + 1) % self->rx_buf_len == ring->tail) {
+            irq_reason = MP_OBJ_NEW_SMALL_INT(1);
+        } else if (!was_empty || ring->head == ring->tail) {
+            // nothing new for the callback to act on
+            callback = mp_const_none;
+        }
+    } else {
+        switch (*state) {
+            case RX_STATE_FIFO_EMPTY:
+                __HAL_CAN_DISABLE_IT(&self->can,  (fifo_id == CAN_FIFO0) ? CAN_IT_FMP0 : CAN_IT_FMP1);
+                irq_reason = MP_OBJ_NEW_SMALL_INT(0);
+                *state = RX_STATE_MESSAGE_PENDING;
+                break;
+            case RX_STATE_MESSAGE_PENDING:
+                __HAL_CAN_DISABLE_IT(&self->can, (fifo_id == CAN_FIFO0) ? CAN_IT_FF0 : CAN_IT_FF1);
+                irq_reason = MP_OBJ_NEW_SMALL_INT(1);
+                *state = RX_STATE_FIFO_FULL;
+                break;
+            case RX_STATE_FIFO_FULL:
+                __HAL_CAN_DISABLE_IT(&self->can, (fifo_id == CAN_FIFO0) ? CAN_IT_FOV0 : CAN_IT_FOV1);
+                irq_reason = MP_OBJ_NEW_SMALL_INT(2);
+                *state = RX_STATE_FIFO_OVERFLOW;
+                break;
+            case RX_STATE_FIFO_OVERFLOW:
+                // This should never happen
+                break;
+        }
     }
 
     if (callback != mp_const_none) {
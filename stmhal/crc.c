@@ -0,0 +1,50 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013, 2014 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "stm32f4xx_hal.h"
+
+#include "py/mpconfig.h"
+#include "crc.h"
+
+// The CRC unit computes the CRC-32/MPEG-2 form of the zlib polynomial: it
+// takes whole words, MSB first, and always starts from 0xffffffff.  zlib's
+// CRC32 is the bit-reflected form, so each word is bit-reversed on the way
+// in and the result on the way out.  Xoring the previous crc into the first
+// word is the same as starting the unit from that crc, which is what lets
+// a checksum be continued across calls.
+uint32_t crc_hw_crc32_update(uint32_t crc, const uint8_t *buf, mp_uint_t len) {
+    __CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+    for (; len >= 4; len -= 4, buf += 4) {
+        uint32_t w;
+        memcpy(&w, buf, 4);
+        CRC->DR = __RBIT(w ^ crc);
+        crc = 0;
+    }
+    return ~__RBIT(CRC->DR);
+}
@@ -32,6 +32,7 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "timer.h"
 #include "dac.h"
 #include "pin.h"
@@ -65,18 +66,52 @@
 ///     # output the sine-wave at 400Hz
 ///     dac = DAC(1)
 ///     dac.write_timed(buf, 400 * len(buf), mode=DAC.CIRCULAR)
+///
+/// To output a continuously computed waveform, stream a queue of buffers:
+///
+///     bufs = [bytearray(256) for i in range(4)]
+///     def refill(dac, buf):
+///         compute_next_samples(buf)
+///         dac.queue(buf)
+///     dac.write_timed(bufs, 8000, mode=DAC.STREAM, callback=refill)
 
 #if MICROPY_HW_ENABLE_DAC
 
+// number of buffers that can wait behind the two being played in STREAM mode
+#define PYB_DAC_QUEUE_LEN (4)
+
+// value of the STREAM mode constant; it is the DMA double-buffer-mode bit
+#define PYB_DAC_STREAM (DMA_SxCR_DBM)
+
 STATIC DAC_HandleTypeDef DAC_Handle;
 
+// DMA1_Stream5 for DAC channel 1 and DMA1_Stream6 for DAC channel 2
+STATIC DMA_HandleTypeDef DAC_DMA_Handle[2];
+
 void dac_init(void) {
+    // stop any DMA that is using buffers from before a soft reset
+    for (int i = 0; i < 2; i++) {
+        if (MP_STATE_PORT(pyb_dac_obj_all)[i] != NULL) {
+            HAL_NVIC_DisableIRQ(i == 0 ? DMA1_Stream5_IRQn : DMA1_Stream6_IRQn);
+            HAL_DMA_Abort(&DAC_DMA_Handle[i]);
+            MP_STATE_PORT(pyb_dac_obj_all)[i] = NULL;
+        }
+    }
+
     memset(&DAC_Handle, 0, sizeof DAC_Handle);
     DAC_Handle.Instance = DAC;
     DAC_Handle.State = HAL_DAC_STATE_RESET;
     HAL_DAC_Init(&DAC_Handle);
 }
 
+void DMA1_Stream5_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&DAC_DMA_Handle[0]);
+}
+
+void DMA1_Stream6_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&DAC_DMA_Handle[1]);
+}
+
 #if defined(TIM6)
 STATIC void TIM6_Config(uint freq) {
     // Init TIM6 at the required frequency (in Hz)
@@ -101,8 +136,124 @@ typedef struct _pyb_dac_obj_t {
     uint32_t dac_channel; // DAC_CHANNEL_1 or DAC_CHANNEL_2
     DMA_Stream_TypeDef *dma_stream; // DMA1_Stream5 or DMA1_Stream6
     mp_uint_t state;
+    // the following are only used while write_timed is active with a
+    // callback or in STREAM mode, when the object is in pyb_dac_obj_all
+    mp_obj_t callback;
+    mp_uint_t stream_len;
+    mp_obj_t stream_buf[2];         // buffers in DMA memory 0 and 1
+    mp_obj_t queue[PYB_DAC_QUEUE_LEN];
+    void *queue_ptr[PYB_DAC_QUEUE_LEN];
+    volatile uint8_t queue_head;    // indexes the buffer to play next
+    volatile uint8_t queue_num;     // number of buffers waiting
 } pyb_dac_obj_t;
 
+STATIC mp_uint_t dac_index(uint32_t dac_channel) {
+    return dac_channel == DAC_CHANNEL_1 ? 0 : 1;
+}
+
+// Calls the user's callback from the DMA IRQ.
+STATIC void dac_call_callback(pyb_dac_obj_t *self, mp_obj_t arg) {
+    if (self->callback == mp_const_none) {
+        return;
+    }
+    // When executing code within a handler we must lock the GC to prevent
+    // any memory allocations.  We must also catch any exceptions.
+    gc_lock();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_call_function_2(self->callback, self, arg);
+        nlr_pop();
+    } else {
+        // Uncaught exception; disable the callback so it doesn't run again.
+        self->callback = mp_const_none;
+        printf("Uncaught exception in DAC callback\n");
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+    }
+    gc_unlock();
+}
+
+// NORMAL and CIRCULAR modes: report which half of the buffer has been output
+
+void HAL_DAC_ConvHalfCpltCallbackCh1(DAC_HandleTypeDef *hdac) {
+    pyb_dac_obj_t *self = MP_STATE_PORT(pyb_dac_obj_all)[0];
+    if (self != NULL) {
+        dac_call_callback(self, MP_OBJ_NEW_SMALL_INT(0));
+    }
+}
+
+void HAL_DAC_ConvCpltCallbackCh1(DAC_HandleTypeDef *hdac) {
+    pyb_dac_obj_t *self = MP_STATE_PORT(pyb_dac_obj_all)[0];
+    if (self != NULL) {
+        dac_call_callback(self, MP_OBJ_NEW_SMALL_INT(1));
+    }
+}
+
+void HAL_DACEx_ConvHalfCpltCallbackCh2(DAC_HandleTypeDef *hdac) {
+    pyb_dac_obj_t *self = MP_STATE_PORT(pyb_dac_obj_all)[1];
+    if (self != NULL) {
+        dac_call_callback(self, MP_OBJ_NEW_SMALL_INT(0));
+    }
+}
+
+void HAL_DACEx_ConvCpltCallbackCh2(DAC_HandleTypeDef *hdac) {
+    pyb_dac_obj_t *self = MP_STATE_PORT(pyb_dac_obj_all)[1];
+    if (self != NULL) {
+        dac_call_callback(self, MP_OBJ_NEW_SMALL_INT(1));
+    }
+}
+
+// STREAM mode: the DMA has finished with the buffer in the given memory slot
+// and moved on to the other one, so put the next queued buffer in its place.
+// If none is queued the finished buffer is played again.
+STATIC void dac_stream_done(DMA_HandleTypeDef *hdma, mp_uint_t slot) {
+    pyb_dac_obj_t *self = MP_STATE_PORT(pyb_dac_obj_all)[hdma - &DAC_DMA_Handle[0]];
+    if (self == NULL) {
+        return;
+    }
+    mp_obj_t done = self->stream_buf[slot];
+    if (self->queue_num > 0) {
+        uint32_t addr = (uint32_t)self->queue_ptr[self->queue_head];
+        if (slot == 0) {
+            hdma->Instance->M0AR = addr;
+        } else {
+            hdma->Instance->M1AR = addr;
+        }
+        self->stream_buf[slot] = self->queue[self->queue_head];
+        self->queue[self->queue_head] = MP_OBJ_NULL;
+        self->queue_head = (self->queue_head + 1) % PYB_DAC_QUEUE_LEN;
+        self->queue_num -= 1;
+    }
+    dac_call_callback(self, done);
+}
+
+STATIC void dac_stream_m0_done(DMA_HandleTypeDef *hdma) {
+    dac_stream_done(hdma, 0);
+}
+
+STATIC void dac_stream_m1_done(DMA_HandleTypeDef *hdma) {
+    dac_stream_done(hdma, 1);
+}
+
+// queue a buffer for STREAM mode; returns false if the queue is full
+STATIC bool dac_queue_buf(pyb_dac_obj_t *self, mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len != self->stream_len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffers must all be the same length"));
+    }
+    bool queued = false;
+    mp_uint_t irq_state = disable_irq();
+    if (self->queue_num < PYB_DAC_QUEUE_LEN) {
+        mp_uint_t i = (self->queue_head + self->queue_num) % PYB_DAC_QUEUE_LEN;
+        self->queue[i] = buf;
+        self->queue_ptr[i] = bufinfo.buf;
+        self->queue_num += 1;
+        queued = true;
+    }
+    enable_irq(irq_state);
+    return queued;
+}
+
 // create the dac object
 // currently support either DAC1 on X5 (id = 1) or DAC2 on X6 (id = 2)
 
@@ -157,6 +308,7 @@ STATIC mp_obj_t pyb_dac_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n
     __DAC_CLK_ENABLE();
 
     // stop anything already going on
+    MP_STATE_PORT(pyb_dac_obj_all)[dac_index(dac->dac_channel)] = NULL;
     HAL_DAC_Stop(&DAC_Handle, dac->dac_channel);
     if ((dac->dac_channel == DAC_CHANNEL_1 && DAC_Handle.DMA_Handle1 != NULL)
             || (dac->dac_channel == DAC_CHANNEL_2 && DAC_Handle.DMA_Handle2 != NULL)) {
@@ -164,6 +316,7 @@ STATIC mp_obj_t pyb_dac_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n
     }
 
     dac->state = 0;
+    dac->callback = mp_const_none;
 
     // return object
     return dac;
@@ -249,19 +402,30 @@ STATIC mp_obj_t pyb_dac_write(mp_obj_t self_in, mp_obj_t val) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_dac_write_obj, pyb_dac_write);
 
 #if defined(TIM6)
-/// \method write_timed(data, freq, *, mode=DAC.NORMAL)
+/// \method write_timed(data, freq, *, mode=DAC.NORMAL, callback=None)
 /// Initiates a burst of RAM to DAC using a DMA transfer.
 /// The input data is treated as an array of bytes (8 bit data).
 ///
-/// `mode` can be `DAC.NORMAL` or `DAC.CIRCULAR`.
+/// `mode` can be `DAC.NORMAL`, `DAC.CIRCULAR` or `DAC.STREAM`.
+///
+/// In `NORMAL` and `CIRCULAR` mode `callback(dac, half)` is called from the
+/// IRQ with `half` 0 once the first half of `data` has been output, and 1
+/// once all of it has.  In `CIRCULAR` mode this lets one half be refilled
+/// while the other is playing.
+///
+/// In `STREAM` mode `data` is a list of equal-length buffers.  The first two
+/// are played alternately using DMA double buffering, and the rest are put in
+/// the queue, see `queue()`.  Each time a buffer finishes the next queued one
+/// takes its place without a gap, and `callback(dac, buf)` is called with the
+/// buffer that finished, ready to be refilled and queued again.  If the queue
+/// has run dry the finished buffer is played again.
 ///
 /// TIM6 is used to control the frequency of the transfer.
-// TODO add callback argument, to call when transfer is finished
-// TODO add double buffer argument
 STATIC const mp_arg_t pyb_dac_write_timed_args[] = {
     { MP_QSTR_data, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
     { MP_QSTR_freq, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
     { MP_QSTR_mode, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = DMA_NORMAL} },
+    { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
 };
 #define PYB_DAC_WRITE_TIMED_NUM_ARGS MP_ARRAY_SIZE(pyb_dac_write_timed_args)
 
@@ -272,9 +436,35 @@ mp_obj_t pyb_dac_write_timed(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *k
     mp_arg_val_t vals[PYB_DAC_WRITE_TIMED_NUM_ARGS];
     mp_arg_parse_all(n_args - 1, args + 1, kw_args, PYB_DAC_WRITE_TIMED_NUM_ARGS, pyb_dac_write_timed_args, vals);
 
-    // get the data to write
+    mp_uint_t mode = vals[2].u_int;
+    mp_obj_t callback = vals[3].u_obj;
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "callback must be None or a callable object"));
+    }
+
+    // get the data to write; in STREAM mode it's the first of a list of buffers
+    mp_uint_t num_bufs = 1;
+    mp_obj_t *bufs = &vals[0].u_obj;
+    if (mode == PYB_DAC_STREAM) {
+        mp_obj_get_array(vals[0].u_obj, &num_bufs, &bufs);
+        if (num_bufs == 0 || num_bufs > 2 + PYB_DAC_QUEUE_LEN) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "need 1 to 6 buffers"));
+        }
+    }
     mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(vals[0].u_obj, &bufinfo, MP_BUFFER_READ);
+    mp_get_buffer_raise(bufs[0], &bufinfo, MP_BUFFER_READ);
+    mp_buffer_info_t bufinfo1 = bufinfo;
+    if (num_bufs > 1) {
+        mp_get_buffer_raise(bufs[1], &bufinfo1, MP_BUFFER_READ);
+        if (bufinfo1.len != bufinfo.len) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffers must all be the same length"));
+        }
+    }
+
+    // stop any callbacks from the previous transfer on this channel
+    mp_uint_t idx = dac_index(self->dac_channel);
+    HAL_NVIC_DisableIRQ(idx == 0 ? DMA1_Stream5_IRQn : DMA1_Stream6_IRQn);
+    MP_STATE_PORT(pyb_dac_obj_all)[idx] = NULL;
 
     // set TIM6 to trigger the DAC at the given frequency
     TIM6_Config(vals[1].u_int);
@@ -300,31 +490,33 @@ mp_obj_t pyb_dac_write_timed(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *k
     */
 
     // DMA1_Stream[67] channel7 configuration
-    DMA_HandleTypeDef DMA_Handle;
-    DMA_Handle.Instance = self->dma_stream;
+    DMA_HandleTypeDef *dma = &DAC_DMA_Handle[idx];
+    memset(dma, 0, sizeof(*dma));
+    dma->Instance = self->dma_stream;
 
     // Need to deinit DMA first
-    DMA_Handle.State = HAL_DMA_STATE_READY;
-    HAL_DMA_DeInit(&DMA_Handle);
-
-    DMA_Handle.Init.Channel = DMA_CHANNEL_7;
-    DMA_Handle.Init.Direction = DMA_MEMORY_TO_PERIPH;
-    DMA_Handle.Init.PeriphInc = DMA_PINC_DISABLE;
-    DMA_Handle.Init.MemInc = DMA_MINC_ENABLE;
-    DMA_Handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-    DMA_Handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-    DMA_Handle.Init.Mode = vals[2].u_int;
-    DMA_Handle.Init.Priority = DMA_PRIORITY_HIGH;
-    DMA_Handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
-    DMA_Handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_HALFFULL;
-    DMA_Handle.Init.MemBurst = DMA_MBURST_SINGLE;
-    DMA_Handle.Init.PeriphBurst = DMA_PBURST_SINGLE;
-    HAL_DMA_Init(&DMA_Handle);
+    dma->State = HAL_DMA_STATE_READY;
+    HAL_DMA_DeInit(dma);
+
+    dma->Init.Channel = DMA_CHANNEL_7;
+    dma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    // double buffer mode is set when the stream is started
+    dma->Init.Mode = mode == PYB_DAC_STREAM ? DMA_CIRCULAR : mode;
+    dma->Init.Priority = DMA_PRIORITY_HIGH;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    dma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_HALFFULL;
+    dma->Init.MemBurst = DMA_MBURST_SINGLE;
+    dma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+    HAL_DMA_Init(dma);
 
     if (self->dac_channel == DAC_CHANNEL_1) {
-        __HAL_LINKDMA(&DAC_Handle, DMA_Handle1, DMA_Handle);
+        __HAL_LINKDMA(&DAC_Handle, DMA_Handle1, *dma);
     } else {
-        __HAL_LINKDMA(&DAC_Handle, DMA_Handle2, DMA_Handle);
+        __HAL_LINKDMA(&DAC_Handle, DMA_Handle2, *dma);
     }
 
     DAC_Handle.Instance = DAC;
@@ -339,7 +531,34 @@ mp_obj_t pyb_dac_write_timed(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *k
         self->state = 3;
     }
 
-    HAL_DAC_Start_DMA(&DAC_Handle, self->dac_channel, (uint32_t*)bufinfo.buf, bufinfo.len, DAC_ALIGN_8B_R);
+    // keep the buffers alive, and let the IRQ find this object
+    self->callback = callback;
+    self->stream_len = bufinfo.len;
+    self->stream_buf[0] = bufs[0];
+    self->stream_buf[1] = num_bufs > 1 ? bufs[1] : bufs[0];
+    self->queue_head = 0;
+    self->queue_num = 0;
+    memset(self->queue, 0, sizeof(self->queue));
+    for (mp_uint_t i = 2; i < num_bufs; i++) {
+        dac_queue_buf(self, bufs[i]);
+    }
+    if (callback != mp_const_none || mode == PYB_DAC_STREAM) {
+        MP_STATE_PORT(pyb_dac_obj_all)[idx] = self;
+        IRQn_Type irqn = idx == 0 ? DMA1_Stream5_IRQn : DMA1_Stream6_IRQn;
+        HAL_NVIC_SetPriority(irqn, 5, 0);
+        HAL_NVIC_EnableIRQ(irqn);
+    }
+
+    if (mode == PYB_DAC_STREAM) {
+        dma->XferCpltCallback = dac_stream_m0_done;
+        dma->XferM1CpltCallback = dac_stream_m1_done;
+        DAC_Handle.Instance->CR |= self->dac_channel == DAC_CHANNEL_1 ? DAC_CR_DMAEN1 : DAC_CR_DMAEN2;
+        uint32_t dhr = self->dac_channel == DAC_CHANNEL_1 ? (uint32_t)&DAC->DHR8R1 : (uint32_t)&DAC->DHR8R2;
+        HAL_DMAEx_MultiBufferStart_IT(dma, (uint32_t)bufinfo.buf, dhr, (uint32_t)bufinfo1.buf, bufinfo.len);
+        HAL_DAC_Start(&DAC_Handle, self->dac_channel);
+    } else {
+        HAL_DAC_Start_DMA(&DAC_Handle, self->dac_channel, (uint32_t*)bufinfo.buf, bufinfo.len, DAC_ALIGN_8B_R);
+    }
 
     /*
     // enable DMA stream
@@ -359,6 +578,36 @@ mp_obj_t pyb_dac_write_timed(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *k
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_dac_write_timed_obj, 1, pyb_dac_write_timed);
+
+/// \method queue(data)
+/// Queue a buffer to be output after those already playing or queued in
+/// `STREAM` mode.  It must be the same length as the other buffers.
+/// Returns `True` if it was queued, or `False` if the queue is full.
+STATIC mp_obj_t pyb_dac_queue(mp_obj_t self_in, mp_obj_t data) {
+    pyb_dac_obj_t *self = self_in;
+    if (MP_STATE_PORT(pyb_dac_obj_all)[dac_index(self->dac_channel)] != self
+        || !(self->dma_stream->CR & DMA_SxCR_DBM)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "DAC is not streaming"));
+    }
+    return MP_BOOL(dac_queue_buf(self, data));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_dac_queue_obj, pyb_dac_queue);
+
+/// \method stop()
+/// Stop a transfer started by `write_timed`.
+STATIC mp_obj_t pyb_dac_stop(mp_obj_t self_in) {
+    pyb_dac_obj_t *self = self_in;
+    mp_uint_t idx = dac_index(self->dac_channel);
+    HAL_NVIC_DisableIRQ(idx == 0 ? DMA1_Stream5_IRQn : DMA1_Stream6_IRQn);
+    if (MP_STATE_PORT(pyb_dac_obj_all)[idx] == self) {
+        MP_STATE_PORT(pyb_dac_obj_all)[idx] = NULL;
+    }
+    if ((idx == 0 ? DAC_Handle.DMA_Handle1 : DAC_Handle.DMA_Handle2) != NULL) {
+        HAL_DAC_Stop_DMA(&DAC_Handle, self->dac_channel);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_dac_stop_obj, pyb_dac_stop);
 #endif
 
 STATIC const mp_map_elem_t pyb_dac_locals_dict_table[] = {
@@ -368,11 +617,16 @@ STATIC const mp_map_elem_t pyb_dac_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_noise), (mp_obj_t)&pyb_dac_noise_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_triangle), (mp_obj_t)&pyb_dac_triangle_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_write_timed), (mp_obj_t)&pyb_dac_write_timed_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_queue), (mp_obj_t)&pyb_dac_queue_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stop), (mp_obj_t)&pyb_dac_stop_obj },
     #endif
 
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_NORMAL),      MP_OBJ_NEW_SMALL_INT(DMA_NORMAL) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CIRCULAR),    MP_OBJ_NEW_SMALL_INT(DMA_CIRCULAR) },
+    #if defined(TIM6)
+    { MP_OBJ_NEW_QSTR(MP_QSTR_STREAM),      MP_OBJ_NEW_SMALL_INT(PYB_DAC_STREAM) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(pyb_dac_locals_dict, pyb_dac_locals_dict_table);
@@ -34,6 +34,7 @@
 #include MICROPY_HAL_H
 #include "pin.h"
 #include "extint.h"
+#include "irq.h"
 
 /// \moduleref pyb
 /// \class ExtInt - configure I/O pins to interrupt on external events
@@ -77,6 +78,15 @@
 ///
 /// Valid pull values are pyb.Pin.PULL_UP, pyb.Pin.PULL_DOWN, pyb.Pin.PULL_NONE.
 ///
+/// For timing measurements and protocol decoding, lines created with
+/// `capture=True` record each edge into a shared queue from the interrupt
+/// handler itself, so no events are lost to callback overhead:
+///
+///     pyb.ExtInt.capture_init(256)
+///     ext = pyb.ExtInt(pin, pyb.ExtInt.IRQ_RISING_FALLING, pyb.Pin.PULL_NONE, None, capture=True)
+///     ...
+///     events = pyb.ExtInt.capture_read() # list of (line, level, cycles)
+///
 /// There is also a C API, so that drivers which require EXTI interrupt lines
 /// can also use this code. See extint.h for the available functions and
 /// usrsw.h for an example of using this.
@@ -99,7 +109,20 @@ typedef struct {
     mp_int_t line;
 } extint_obj_t;
 
+// Queue of captured edges, filled by the IRQ handler and emptied by the
+// main task.  Each event is the cycle counter at the time of the IRQ, and
+// the line and the pin level (read just after the edge).
+typedef struct _extint_capture_t {
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    uint16_t len;
+    uint32_t dropped;
+    uint32_t event[][2];
+} extint_capture_t;
+
 STATIC uint32_t pyb_extint_mode[EXTI_NUM_VECTORS];
+STATIC uint32_t pyb_extint_capture_lines;
+STATIC pin_gpio_t *pyb_extint_capture_gpio[16];
 
 #if !defined(ETH)
 #define ETH_WKUP_IRQn   62  // Some MCUs don't have ETH, but we want a value to put in our table
@@ -262,6 +285,118 @@ STATIC mp_obj_t extint_regs(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(extint_regs_fun_obj, extint_regs);
 STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(extint_regs_obj, (mp_obj_t)&extint_regs_fun_obj);
 
+/// \classmethod capture_init(n)
+/// Set up the capture queue to hold `n` events, discarding any waiting
+/// events; `n=0` frees it.  Timestamps come from the CPU cycle counter,
+/// which this enables.
+STATIC mp_obj_t extint_capture_init(mp_obj_t n_in) {
+    mp_int_t n = mp_obj_get_int(n_in);
+    if (n < 0 || n >= 0xffff) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad queue size"));
+    }
+    extint_capture_t *cap = NULL;
+    if (n > 0) {
+        // one slot is kept free to tell a full queue from an empty one
+        cap = m_malloc(sizeof(extint_capture_t) + (n + 1) * sizeof(cap->event[0]));
+        cap->head = 0;
+        cap->tail = 0;
+        cap->len = n + 1;
+        cap->dropped = 0;
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    mp_uint_t irq_state = disable_irq();
+    extint_capture_t *old = MP_STATE_PORT(pyb_extint_capture);
+    MP_STATE_PORT(pyb_extint_capture) = cap;
+    enable_irq(irq_state);
+    if (old != NULL) {
+        m_free(old, sizeof(extint_capture_t) + old->len * sizeof(old->event[0]));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(extint_capture_init_fun_obj, extint_capture_init);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(extint_capture_init_obj, (mp_obj_t)&extint_capture_init_fun_obj);
+
+STATIC extint_capture_t *extint_get_capture(void) {
+    extint_capture_t *cap = MP_STATE_PORT(pyb_extint_capture);
+    if (cap == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "capture not initialised"));
+    }
+    return cap;
+}
+
+/// \classmethod capture_read([buf])
+/// Take events from the capture queue.  With no argument, return a list of
+/// `(line, level, cycles)` tuples for all waiting events.  With `buf`, fill
+/// it with as many whole 8-byte records as fit (cycles as a little-endian
+/// 32-bit word, then line, level and 2 zero bytes) and return the number of
+/// events; this doesn't allocate memory.
+STATIC mp_obj_t extint_capture_read(mp_uint_t n_args, const mp_obj_t *args) {
+    extint_capture_t *cap = extint_get_capture();
+    uint16_t tail = cap->tail;
+    uint16_t head = cap->head;
+    mp_uint_t n = head >= tail ? head - tail : cap->len - tail + head;
+
+    mp_buffer_info_t bufinfo;
+    mp_obj_t list = MP_OBJ_NULL;
+    if (n_args == 1) {
+        mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+        n = MIN(n, bufinfo.len / 8);
+    } else {
+        list = mp_obj_new_list(0, NULL);
+    }
+
+    for (mp_uint_t i = 0; i < n; i++) {
+        uint32_t t = cap->event[tail][0];
+        uint32_t info = cap->event[tail][1];
+        if (list == MP_OBJ_NULL) {
+            byte *p = (byte*)bufinfo.buf + 8 * i;
+            p[0] = t;
+            p[1] = t >> 8;
+            p[2] = t >> 16;
+            p[3] = t >> 24;
+            p[4] = info & 0xff;
+            p[5] = info >> 8;
+            p[6] = 0;
+            p[7] = 0;
+        } else {
+            mp_obj_t tuple[3] = {
+                MP_OBJ_NEW_SMALL_INT(info & 0xff),
+                MP_OBJ_NEW_SMALL_INT(info >> 8),
+                mp_obj_new_int_from_uint(t),
+            };
+            mp_obj_list_append(list, mp_obj_new_tuple(3, tuple));
+        }
+        if (++tail == cap->len) {
+            tail = 0;
+        }
+        cap->tail = tail;
+    }
+
+    if (list == MP_OBJ_NULL) {
+        return MP_OBJ_NEW_SMALL_INT(n);
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(extint_capture_read_fun_obj, 0, 1, extint_capture_read);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(extint_capture_read_obj, (mp_obj_t)&extint_capture_read_fun_obj);
+
+/// \classmethod capture_stats()
+/// Return `(waiting, dropped)`: the number of events in the capture queue
+/// and the number lost because it was full.
+STATIC mp_obj_t extint_capture_stats(void) {
+    extint_capture_t *cap = extint_get_capture();
+    uint16_t tail = cap->tail;
+    uint16_t head = cap->head;
+    mp_obj_t tuple[2] = {
+        MP_OBJ_NEW_SMALL_INT(head >= tail ? head - tail : cap->len - tail + head),
+        mp_obj_new_int_from_uint(cap->dropped),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(extint_capture_stats_fun_obj, extint_capture_stats);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(extint_capture_stats_obj, (mp_obj_t)&extint_capture_stats_fun_obj);
+
 /// \classmethod \constructor(pin, mode, pull, callback)
 /// Create an ExtInt object:
 ///
@@ -276,12 +411,15 @@ STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(extint_regs_obj, (mp_obj_t)&extint_regs_
 ///     - `pyb.Pin.PULL_DOWN` - enable the pull-down resistor.
 ///   - `callback` is the function to call when the interrupt triggers.  The
 ///   callback function must accept exactly 1 argument, which is the line that
-///   triggered the interrupt.
+///   triggered the interrupt.  It can be `None` if `capture` is set.
+///   - `capture` if `True` records each interrupt into the queue set up by
+///   `ExtInt.capture_init()`, before calling any callback.
 STATIC const mp_arg_t pyb_extint_make_new_args[] = {
     { MP_QSTR_pin,      MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
     { MP_QSTR_mode,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
     { MP_QSTR_pull,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
     { MP_QSTR_callback, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_capture,  MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
 };
 #define PYB_EXTINT_MAKE_NEW_NUM_ARGS MP_ARRAY_SIZE(pyb_extint_make_new_args)
 
@@ -294,7 +432,20 @@ STATIC mp_obj_t extint_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_
 
     extint_obj_t *self = m_new_obj(extint_obj_t);
     self->base.type = type_in;
-    self->line = extint_register(vals[0].u_obj, vals[1].u_int, vals[2].u_int, vals[3].u_obj, false);
+    mp_obj_t callback = vals[3].u_obj;
+    if (vals[4].u_bool && callback == mp_const_none) {
+        // capture only: mark the line as in use but with nothing to call
+        callback = MP_OBJ_SENTINEL;
+    }
+    self->line = extint_register(vals[0].u_obj, vals[1].u_int, vals[2].u_int, callback, false);
+    if (vals[4].u_bool) {
+        if (self->line < 16) {
+            pyb_extint_capture_gpio[self->line] = pin_find(vals[0].u_obj)->gpio;
+        }
+        pyb_extint_capture_lines |= 1 << self->line;
+    } else {
+        pyb_extint_capture_lines &= ~(1 << self->line);
+    }
 
     return self;
 }
@@ -310,6 +461,9 @@ STATIC const mp_map_elem_t extint_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_disable), (mp_obj_t)&extint_obj_disable_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_swint),   (mp_obj_t)&extint_obj_swint_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_regs),    (mp_obj_t)&extint_regs_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_init),  (mp_obj_t)&extint_capture_init_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_read),  (mp_obj_t)&extint_capture_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_stats), (mp_obj_t)&extint_capture_stats_obj },
 
     // class constants
     /// \constant IRQ_RISING - interrupt on a rising edge
@@ -338,15 +492,41 @@ void extint_init0(void) {
         MP_STATE_PORT(pyb_extint_callback)[i] = mp_const_none;
         pyb_extint_mode[i] = EXTI_Mode_Interrupt;
    }
+   pyb_extint_capture_lines = 0;
+   MP_STATE_PORT(pyb_extint_capture) = NULL;
+}
+
+STATIC void extint_capture_event(uint32_t line, uint32_t t) {
+    extint_capture_t *cap = MP_STATE_PORT(pyb_extint_capture);
+    if (cap == NULL) {
+        return;
+    }
+    uint16_t head = cap->head;
+    uint16_t next = head + 1 == cap->len ? 0 : head + 1;
+    if (next == cap->tail) {
+        cap->dropped += 1;
+        return;
+    }
+    uint32_t level = 0;
+    if (line < 16) {
+        level = GPIO_read_pin(pyb_extint_capture_gpio[line], line);
+    }
+    cap->event[head][0] = t;
+    cap->event[head][1] = line | level << 8;
+    cap->head = next;
 }
 
 // Interrupt handler
 void Handle_EXTI_Irq(uint32_t line) {
     if (__HAL_GPIO_EXTI_GET_FLAG(1 << line)) {
+        uint32_t t = DWT->CYCCNT; // timestamp as close to the edge as possible
         __HAL_GPIO_EXTI_CLEAR_FLAG(1 << line);
         if (line < EXTI_NUM_VECTORS) {
+            if (pyb_extint_capture_lines & (1 << line)) {
+                extint_capture_event(line, t);
+            }
             mp_obj_t *cb = &MP_STATE_PORT(pyb_extint_callback)[line];
-            if (*cb != mp_const_none) {
+            if (*cb != mp_const_none && *cb != MP_OBJ_SENTINEL) {
                 // When executing code within a handler we must lock the GC to prevent
                 // any memory allocations.  We must also catch any exceptions.
                 gc_lock();
@@ -30,6 +30,7 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "py/builtin.h"
 #include "lib/fatfs/ff.h"
 #include "file.h"
 
@@ -82,6 +83,13 @@ STATIC mp_uint_t file_obj_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
 
 STATIC mp_uint_t file_obj_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
     pyb_file_obj_t *self = self_in;
+    #if _USE_FASTSEEK
+    // the cluster link map can't follow the chain as it grows, so a write
+    // that extends the file drops back to normal seek mode
+    if (self->fp.cltbl != NULL && f_tell(&self->fp) + size > f_size(&self->fp)) {
+        self->fp.cltbl = NULL;
+    }
+    #endif
     UINT sz_out;
     FRESULT res = f_write(&self->fp, buf, size, &sz_out);
     if (res != FR_OK) {
@@ -149,6 +157,39 @@ mp_obj_t file_obj_tell(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(file_obj_tell_obj, file_obj_tell);
 
+#if _USE_FASTSEEK
+// fastseek([enable]): build a cluster link map table for the file so that
+// seeking doesn't have to walk the FAT chain; fastseek(False) turns it off
+STATIC mp_obj_t file_obj_fastseek(mp_uint_t n_args, const mp_obj_t *args) {
+    pyb_file_obj_t *self = args[0];
+    self->fp.cltbl = NULL;
+    if (n_args == 2 && !mp_obj_is_true(args[1])) {
+        return mp_const_none;
+    }
+
+    // the table lives on the heap and is kept alive by the FIL that points
+    // to it; start small and grow it to the size f_lseek asks for
+    DWORD len = 16;
+    for (;;) {
+        DWORD *tbl = m_new(DWORD, len);
+        tbl[0] = len;
+        self->fp.cltbl = tbl;
+        FRESULT res = f_lseek(&self->fp, CREATE_LINKMAP);
+        if (res == FR_OK) {
+            return mp_const_none;
+        }
+        self->fp.cltbl = NULL;
+        DWORD needed = tbl[0];
+        m_del(DWORD, tbl, len);
+        if (res != FR_NOT_ENOUGH_CORE || needed <= len) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(fresult_to_errno_table[res])));
+        }
+        len = needed;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(file_obj_fastseek_obj, 1, 2, file_obj_fastseek);
+#endif
+
 // Note: encoding is ignored for now; it's also not a valid kwarg for CPython's FileIO,
 // but by adding it here we can use one single mp_arg_t array for open() and FileIO's constructor
 STATIC const mp_arg_t file_open_args[] = {
@@ -205,6 +246,13 @@ STATIC mp_obj_t file_open(mp_obj_t type, mp_arg_val_t *args) {
         f_lseek(&o->fp, f_size(&o->fp));
     }
 
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    if ((mode & (FA_CREATE_ALWAYS | FA_CREATE_NEW | FA_OPEN_ALWAYS)) != 0) {
+        // the file may be new, so it may be a module import hasn't seen
+        mp_import_cache_clear();
+    }
+    #endif
+
     return o;
 }
 
@@ -227,6 +275,9 @@ STATIC const mp_map_elem_t rawfile_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&file_obj_close_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_seek), (mp_obj_t)&mp_stream_seek_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_tell), (mp_obj_t)&file_obj_tell_obj },
+    #if _USE_FASTSEEK
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fastseek), (mp_obj_t)&file_obj_fastseek_obj },
+    #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR___del__), (mp_obj_t)&file_obj_close_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR___enter__), (mp_obj_t)&mp_identity_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR___exit__), (mp_obj_t)&file_obj___exit___obj },
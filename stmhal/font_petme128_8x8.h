@@ -24,7 +24,7 @@
  * THE SOFTWARE.
  */
 
-const uint8_t font_petme128_8x8[] = {
+static const uint8_t font_petme128_8x8[] = {
     0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // 32= 
     0x00,0x00,0x00,0x4f,0x4f,0x00,0x00,0x00, // 33=!
     0x00,0x07,0x07,0x00,0x00,0x07,0x07,0x00, // 34="
@@ -26,6 +26,7 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/builtin.h"
 #include "lib/fatfs/ff.h"
 #include "fsusermount.h"
 
@@ -110,6 +111,12 @@ STATIC mp_obj_t pyb_mount(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *
         printf(" on %s with %u bytes free\n", fs_user_mount.str, (uint)(nclst * fatfs->csize * 512));
         */
     }
+
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    // the files under the mount point have changed
+    mp_import_cache_clear();
+    #endif
+
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(pyb_mount_obj, 2, pyb_mount);
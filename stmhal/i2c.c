@@ -29,6 +29,8 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/gc.h"
+#include "irq.h"
 #include "pin.h"
 #include "genhdr/pins.h"
 #include "bufhelper.h"
@@ -83,6 +85,13 @@
 ///     i2c.mem_read(3, 0x42, 2)     # read 3 bytes from memory of slave 0x42,
 ///                                  #   starting at address 2 in the slave
 ///     i2c.mem_write('abc', 0x42, 2, timeout=1000)
+///
+/// Several transfers can be run back-to-back from the I2C interrupt with
+/// a single call, optionally without waiting for them:
+///
+///     # write 0x00 to then read 2 bytes from each of 2 devices
+///     res = i2c.transact([(0x40, b'\x00', 2), (0x41, b'\x00', 2)])
+///     i2c.transact(ops, callback=lambda i2c, err: print(err))
 
 #define PYB_I2C_MASTER (0)
 #define PYB_I2C_SLAVE  (1)
@@ -111,6 +120,8 @@ void i2c_init0(void) {
     memset(&I2CHandle3, 0, sizeof(I2C_HandleTypeDef));
     I2CHandle3.Instance = I2C3;
     #endif
+    // forget any transactions from before a soft reset
+    memset(MP_STATE_PORT(pyb_i2c_transact), 0, sizeof(MP_STATE_PORT(pyb_i2c_transact)));
 }
 
 void i2c_init(I2C_HandleTypeDef *i2c) {
@@ -121,12 +132,15 @@ void i2c_init(I2C_HandleTypeDef *i2c) {
     GPIO_InitStructure.Pull = GPIO_NOPULL; // have external pull-up resistors on both lines
 
     const pin_obj_t *pins[2];
+    IRQn_Type ev_irqn, er_irqn;
     if (0) {
     #if defined(MICROPY_HW_I2C1_SCL)
     } else if (i2c == &I2CHandle1) {
         pins[0] = &MICROPY_HW_I2C1_SCL;
         pins[1] = &MICROPY_HW_I2C1_SDA;
         GPIO_InitStructure.Alternate = GPIO_AF4_I2C1;
+        ev_irqn = I2C1_EV_IRQn;
+        er_irqn = I2C1_ER_IRQn;
         __I2C1_CLK_ENABLE();
     #endif
     #if defined(MICROPY_HW_I2C2_SCL)
@@ -134,6 +148,8 @@ void i2c_init(I2C_HandleTypeDef *i2c) {
         pins[0] = &MICROPY_HW_I2C2_SCL;
         pins[1] = &MICROPY_HW_I2C2_SDA;
         GPIO_InitStructure.Alternate = GPIO_AF4_I2C2;
+        ev_irqn = I2C2_EV_IRQn;
+        er_irqn = I2C2_ER_IRQn;
         __I2C2_CLK_ENABLE();
     #endif
     #if defined(MICROPY_HW_I2C3_SCL)
@@ -141,6 +157,8 @@ void i2c_init(I2C_HandleTypeDef *i2c) {
         pins[0] = &MICROPY_HW_I2C3_SCL;
         pins[1] = &MICROPY_HW_I2C3_SDA;
         GPIO_InitStructure.Alternate = GPIO_AF4_I2C3;
+        ev_irqn = I2C3_EV_IRQn;
+        er_irqn = I2C3_ER_IRQn;
         __I2C3_CLK_ENABLE();
     #endif
     } else {
@@ -162,6 +180,13 @@ void i2c_init(I2C_HandleTypeDef *i2c) {
         printf("OSError: HAL_I2C_Init failed\n");
         return;
     }
+
+    // the IRQs only fire during transfers started by transact(); the
+    // blocking methods don't enable any I2C interrupt sources
+    HAL_NVIC_SetPriority(ev_irqn, 7, 0);
+    HAL_NVIC_EnableIRQ(ev_irqn);
+    HAL_NVIC_SetPriority(er_irqn, 7, 0);
+    HAL_NVIC_EnableIRQ(er_irqn);
 }
 
 void i2c_deinit(I2C_HandleTypeDef *i2c) {
@@ -169,18 +194,24 @@ void i2c_deinit(I2C_HandleTypeDef *i2c) {
     if (0) {
     #if defined(MICROPY_HW_I2C1_SCL)
     } else if (i2c->Instance == I2C1) {
+        HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
         __I2C1_FORCE_RESET();
         __I2C1_RELEASE_RESET();
         __I2C1_CLK_DISABLE();
     #endif
     #if defined(MICROPY_HW_I2C2_SCL)
     } else if (i2c->Instance == I2C2) {
+        HAL_NVIC_DisableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C2_ER_IRQn);
         __I2C2_FORCE_RESET();
         __I2C2_RELEASE_RESET();
         __I2C2_CLK_DISABLE();
     #endif
     #if defined(MICROPY_HW_I2C3_SCL)
     } else if (i2c->Instance == I2C3) {
+        HAL_NVIC_DisableIRQ(I2C3_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C3_ER_IRQn);
         __I2C3_FORCE_RESET();
         __I2C3_RELEASE_RESET();
         __I2C3_CLK_DISABLE();
@@ -188,6 +219,36 @@ void i2c_deinit(I2C_HandleTypeDef *i2c) {
     }
 }
 
+#if defined(MICROPY_HW_I2C1_SCL)
+void I2C1_EV_IRQHandler(void) {
+    HAL_I2C_EV_IRQHandler(&I2CHandle1);
+}
+
+void I2C1_ER_IRQHandler(void) {
+    HAL_I2C_ER_IRQHandler(&I2CHandle1);
+}
+#endif
+
+#if defined(MICROPY_HW_I2C2_SCL)
+void I2C2_EV_IRQHandler(void) {
+    HAL_I2C_EV_IRQHandler(&I2CHandle2);
+}
+
+void I2C2_ER_IRQHandler(void) {
+    HAL_I2C_ER_IRQHandler(&I2CHandle2);
+}
+#endif
+
+#if defined(MICROPY_HW_I2C3_SCL)
+void I2C3_EV_IRQHandler(void) {
+    HAL_I2C_EV_IRQHandler(&I2CHandle3);
+}
+
+void I2C3_ER_IRQHandler(void) {
+    HAL_I2C_ER_IRQHandler(&I2CHandle3);
+}
+#endif
+
 /******************************************************************************/
 /* Micro Python bindings                                                      */
 
@@ -588,6 +649,252 @@ STATIC mp_obj_t pyb_i2c_mem_write(mp_uint_t n_args, const mp_obj_t *args, mp_map
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_i2c_mem_write_obj, 1, pyb_i2c_mem_write);
 
+// One (addr, write, read) operation of a transaction, with the buffers
+// already looked up so the IRQ doesn't need to touch any objects.
+typedef struct _i2c_op_t {
+    uint16_t addr;
+    uint16_t write_len;
+    uint16_t read_len;
+    const byte *write;
+    byte *read;
+} i2c_op_t;
+
+// The state of a transaction.  It is kept alive by a root pointer while
+// it runs, which in turn keeps the user's buffers alive.
+typedef struct _pyb_i2c_transact_t {
+    const pyb_i2c_obj_t *i2c_obj;
+    mp_obj_t ops_in;
+    mp_obj_t callback;
+    mp_uint_t num_ops;
+    volatile mp_uint_t cur_op;
+    volatile byte phase;            // 0: nothing done, 1: write done, 2: all done
+    volatile bool done;
+    volatile int error;             // errno value, or 0 for success
+    i2c_op_t ops[];
+} pyb_i2c_transact_t;
+
+STATIC void i2c_transact_finish(pyb_i2c_transact_t *t) {
+    t->done = true;
+    MP_STATE_PORT(pyb_i2c_transact)[t->i2c_obj - &pyb_i2c_obj[0]] = NULL;
+    if (t->callback != mp_const_none) {
+        // When executing code within a handler we must lock the GC to prevent
+        // any memory allocations.  We must also catch any exceptions.
+        gc_lock();
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            mp_call_function_2(t->callback, (mp_obj_t)t->i2c_obj, MP_OBJ_NEW_SMALL_INT(t->error));
+            nlr_pop();
+        } else {
+            printf("Uncaught exception in I2C callback\n");
+            mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+        }
+        gc_unlock();
+    }
+}
+
+// Starts the next transfer of the transaction, or finishes it if there are
+// none left or a transfer can't be started.  Called first from transact()
+// and then from the IRQ each time a transfer completes.
+STATIC void i2c_transact_step(pyb_i2c_transact_t *t) {
+    I2C_HandleTypeDef *i2c = t->i2c_obj->i2c;
+    while (t->cur_op < t->num_ops) {
+        i2c_op_t *op = &t->ops[t->cur_op];
+        if (t->phase == 2 || (t->phase == 1 && op->read_len == 0)) {
+            t->cur_op += 1;
+            t->phase = 0;
+            continue;
+        }
+
+        // the bus stays busy for a moment after the STOP of the last transfer
+        uint32_t start = HAL_GetTick();
+        while (__HAL_I2C_GET_FLAG(i2c, I2C_FLAG_BUSY) == SET && HAL_GetTick() - start < 2) {
+        }
+
+        HAL_StatusTypeDef status;
+        if (t->phase == 0 && op->write_len > 0 && op->write_len <= 2 && op->read_len > 0) {
+            // a short write then a read is done with a repeated start, as a
+            // memory read whose memory address is the bytes to write
+            uint16_t mem_addr = op->write[0];
+            uint16_t mem_addr_size = I2C_MEMADD_SIZE_8BIT;
+            if (op->write_len == 2) {
+                mem_addr = mem_addr << 8 | op->write[1];
+                mem_addr_size = I2C_MEMADD_SIZE_16BIT;
+            }
+            status = HAL_I2C_Mem_Read_IT(i2c, op->addr, mem_addr, mem_addr_size, op->read, op->read_len);
+            t->phase = 2;
+        } else if (t->phase == 0 && op->write_len > 0) {
+            status = HAL_I2C_Master_Transmit_IT(i2c, op->addr, (uint8_t*)op->write, op->write_len);
+            t->phase = 1;
+        } else if (op->read_len > 0) {
+            status = HAL_I2C_Master_Receive_IT(i2c, op->addr, op->read, op->read_len);
+            t->phase = 2;
+        } else {
+            // nothing to write or read
+            t->phase = 2;
+            continue;
+        }
+        if (status == HAL_OK) {
+            // the IRQ takes it from here
+            return;
+        }
+        t->error = mp_hal_status_to_errno_table[status];
+        break;
+    }
+    i2c_transact_finish(t);
+}
+
+STATIC void i2c_transact_irq(I2C_HandleTypeDef *hi2c, bool error) {
+    for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(pyb_i2c_obj); i++) {
+        pyb_i2c_transact_t *t = MP_STATE_PORT(pyb_i2c_transact)[i];
+        if (pyb_i2c_obj[i].i2c == hi2c && t != NULL && !t->done) {
+            if (error) {
+                // release the bus
+                hi2c->Instance->CR1 |= I2C_CR1_STOP;
+                t->error = EIO;
+                i2c_transact_finish(t);
+            } else {
+                i2c_transact_step(t);
+            }
+        }
+    }
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    i2c_transact_irq(hi2c, false);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    i2c_transact_irq(hi2c, false);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    i2c_transact_irq(hi2c, false);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    i2c_transact_irq(hi2c, true);
+}
+
+/// \method transact(ops, *, callback=None, timeout=5000)
+///
+/// Run a list of I2C operations back-to-back, driven by the I2C interrupt:
+///
+///   - `ops` is a list of `(addr, write, read)` tuples.  `write` is a buffer
+///     to send to the device at `addr`, or `None`.  `read` is then the number
+///     of bytes to read back, a buffer to read into, or `None`.  A write of 1
+///     or 2 bytes followed by a read uses a repeated start (like `mem_read`);
+///     otherwise the write and the read are separate transfers.
+///   - `callback`, if given, makes the call non-blocking: it returns straight
+///     away and `callback(i2c, err)` is called from the IRQ when all the
+///     operations are done, or one fails.  `err` is 0 on success or an errno.
+///   - `timeout` is the timeout in milliseconds for the whole transaction,
+///     when not using a callback.
+///
+/// Returns a list holding, for each operation, the buffer read into (a new
+/// bytearray if `read` was a number), or `None` if it did no read.  With a
+/// callback the buffers are only filled in once it has been called.
+/// This is only valid in master mode.
+STATIC const mp_arg_t pyb_i2c_transact_args[] = {
+    { MP_QSTR_ops,      MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+};
+#define PYB_I2C_TRANSACT_NUM_ARGS MP_ARRAY_SIZE(pyb_i2c_transact_args)
+
+STATIC mp_obj_t pyb_i2c_transact(mp_uint_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    pyb_i2c_obj_t *self = args[0];
+
+    if (!in_master_mode(self)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "I2C must be a master"));
+    }
+
+    // parse args
+    mp_arg_val_t vals[PYB_I2C_TRANSACT_NUM_ARGS];
+    mp_arg_parse_all(n_args - 1, args + 1, kw_args, PYB_I2C_TRANSACT_NUM_ARGS, pyb_i2c_transact_args, vals);
+
+    mp_obj_t callback = vals[1].u_obj;
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "callback must be None or a callable object"));
+    }
+    if (query_irq() == IRQ_STATE_DISABLED) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "transact needs IRQs enabled"));
+    }
+    mp_uint_t idx = self - &pyb_i2c_obj[0];
+    if (MP_STATE_PORT(pyb_i2c_transact)[idx] != NULL) {
+        mp_hal_raise(HAL_BUSY);
+    }
+
+    // look up all the buffers now, so the IRQ doesn't have to
+    mp_uint_t num_ops;
+    mp_obj_t *ops;
+    mp_obj_get_array(vals[0].u_obj, &num_ops, &ops);
+    pyb_i2c_transact_t *t = m_new_obj_var(pyb_i2c_transact_t, i2c_op_t, num_ops);
+    t->i2c_obj = self;
+    t->ops_in = vals[0].u_obj;
+    t->callback = callback;
+    t->num_ops = num_ops;
+    t->cur_op = 0;
+    t->phase = 0;
+    t->done = false;
+    t->error = 0;
+    mp_obj_t result = mp_obj_new_list(num_ops, NULL);
+    for (mp_uint_t i = 0; i < num_ops; i++) {
+        mp_obj_t *op_in;
+        mp_obj_get_array_fixed_n(ops[i], 3, &op_in);
+        i2c_op_t *op = &t->ops[i];
+        op->addr = mp_obj_get_int(op_in[0]) << 1;
+        op->write_len = 0;
+        op->write = NULL;
+        if (op_in[1] != mp_const_none) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(op_in[1], &bufinfo, MP_BUFFER_READ);
+            op->write_len = bufinfo.len;
+            op->write = bufinfo.buf;
+        }
+        op->read_len = 0;
+        op->read = NULL;
+        mp_obj_t read_obj = mp_const_none;
+        if (MP_OBJ_IS_INT(op_in[2])) {
+            vstr_t vstr;
+            vstr_init_len(&vstr, mp_obj_get_int(op_in[2]));
+            read_obj = mp_obj_new_bytearray_by_ref(vstr.len, vstr.buf);
+        } else if (op_in[2] != mp_const_none) {
+            read_obj = op_in[2];
+        }
+        if (read_obj != mp_const_none) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(read_obj, &bufinfo, MP_BUFFER_WRITE);
+            op->read_len = bufinfo.len;
+            op->read = bufinfo.buf;
+        }
+        mp_obj_list_store(result, MP_OBJ_NEW_SMALL_INT(i), read_obj);
+    }
+
+    // start the first transfer; the IRQ does the rest
+    MP_STATE_PORT(pyb_i2c_transact)[idx] = t;
+    i2c_transact_step(t);
+
+    if (callback == mp_const_none) {
+        uint32_t start = HAL_GetTick();
+        while (!t->done) {
+            if (HAL_GetTick() - start >= vals[2].u_int) {
+                // give up, and reset the peripheral to abort the transfer
+                MP_STATE_PORT(pyb_i2c_transact)[idx] = NULL;
+                i2c_deinit(self->i2c);
+                i2c_init(self->i2c);
+                mp_hal_raise(HAL_TIMEOUT);
+            }
+            __WFI();
+        }
+        if (t->error != 0) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(t->error)));
+        }
+    }
+
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_i2c_transact_obj, 1, pyb_i2c_transact);
+
 STATIC const mp_map_elem_t pyb_i2c_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_init), (mp_obj_t)&pyb_i2c_init_obj },
@@ -598,6 +905,7 @@ STATIC const mp_map_elem_t pyb_i2c_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv), (mp_obj_t)&pyb_i2c_recv_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mem_read), (mp_obj_t)&pyb_i2c_mem_read_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mem_write), (mp_obj_t)&pyb_i2c_mem_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_transact), (mp_obj_t)&pyb_i2c_transact_obj },
 
     // class constants
     /// \constant MASTER - for initialising the bus to master mode
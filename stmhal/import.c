@@ -45,3 +45,38 @@ mp_import_stat_t mp_import_stat(const char *path) {
     }
     return MP_IMPORT_STAT_NO_EXIST;
 }
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+bool mp_import_listdir(const char *path, void *env) {
+    FILINFO fno;
+#if _USE_LFN
+    char lfn[_MAX_LFN + 1];
+    fno.lfname = lfn;
+    fno.lfsize = sizeof lfn;
+#endif
+    DIR dir;
+    FRESULT res = f_opendir(&dir, path);
+    if (res != FR_OK) {
+        // the root directory, holding the mount points, can't be opened
+        return res == FR_NO_PATH || res == FR_NO_FILE;
+    }
+    for (;;) {
+        res = f_readdir(&dir, &fno);
+        if (res != FR_OK || fno.fname[0] == 0) {
+            break;
+        }
+#if _USE_LFN
+        char *fn = *fno.lfname ? fno.lfname : fno.fname;
+#else
+        char *fn = fno.fname;
+#endif
+        if (fn[0] == '.' && (fn[1] == 0 || (fn[1] == '.' && fn[2] == 0))) {
+            continue;
+        }
+        mp_import_listdir_add(env, fn, (fno.fattrib & AM_DIR) ? MP_IMPORT_STAT_DIR : MP_IMPORT_STAT_FILE);
+    }
+    f_closedir(&dir);
+    // a listing cut short by an error can't be trusted
+    return res == FR_OK;
+}
+#endif
@@ -37,6 +37,7 @@
 #include "genhdr/pins.h"
 #include "bufhelper.h"
 #include "spi.h"
+#include "irq.h"
 #include "font_petme128_8x8.h"
 #include "lcd.h"
 
@@ -105,6 +106,12 @@ typedef struct _pyb_lcd_obj_t {
     // double buffering for pixel buffer
     byte pix_buf[LCD_PIX_BUF_BYTE_SIZE];
     byte pix_buf2[LCD_PIX_BUF_BYTE_SIZE];
+
+    // set when the screen may differ from pix_buf, so show() must send it all
+    bool redraw_all;
+
+    // one page of pixel data, reordered for sending by DMA
+    byte tx_buf[LCD_PIX_BUF_W];
 } pyb_lcd_obj_t;
 
 STATIC void lcd_delay(void) {
@@ -123,6 +130,21 @@ STATIC void lcd_out(pyb_lcd_obj_t *lcd, int instr_data, uint8_t i) {
     HAL_SPI_Transmit(lcd->spi, &i, 1, 1000);
 }
 
+// send a run of data bytes, by DMA if possible
+STATIC void lcd_out_data(pyb_lcd_obj_t *lcd, const uint8_t *buf, uint len) {
+    lcd_delay();
+    lcd->pin_cs1->gpio->BSRRH = lcd->pin_cs1->pin_mask; // CS=0; enable
+    lcd->pin_a0->gpio->BSRRL = lcd->pin_a0->pin_mask; // A0=1; select data reg
+    lcd_delay();
+    if (query_irq() == IRQ_STATE_ENABLED && HAL_SPI_Transmit_DMA(lcd->spi, (uint8_t*)buf, len) == HAL_OK) {
+        while (HAL_SPI_GetState(lcd->spi) != HAL_SPI_STATE_READY) {
+            __WFI();
+        }
+    } else {
+        HAL_SPI_Transmit(lcd->spi, (uint8_t*)buf, len, 1000);
+    }
+}
+
 // write a string to the LCD at the current cursor location
 // output it straight away (doesn't use the pixel buffer)
 STATIC void lcd_write_strn(pyb_lcd_obj_t *lcd, const char *str, unsigned int len) {
@@ -170,6 +192,11 @@ STATIC void lcd_write_strn(pyb_lcd_obj_t *lcd, const char *str, unsigned int len
         }
     }
 
+    // text goes straight to the screen, so it no longer matches pix_buf
+    if (redraw_min < redraw_max) {
+        lcd->redraw_all = true;
+    }
+
     // we must draw upside down, because the LCD is upside down
     for (int i = redraw_min; i < redraw_max; i++) {
         uint page = i / LCD_CHAR_BUF_W;
@@ -318,6 +345,7 @@ STATIC mp_obj_t pyb_lcd_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n
     // clear local pixel buffer
     memset(lcd->pix_buf, 0, LCD_PIX_BUF_BYTE_SIZE);
     memset(lcd->pix_buf2, 0, LCD_PIX_BUF_BYTE_SIZE);
+    lcd->redraw_all = false;
 
     return lcd;
 }
@@ -342,6 +370,7 @@ STATIC mp_obj_t pyb_lcd_command(mp_obj_t self_in, mp_obj_t instr_data_in, mp_obj
     for (uint i = 0; i < bufinfo.len; i++) {
         lcd_out(self, instr_data, ((byte*)bufinfo.buf)[i]);
     }
+    self->redraw_all = true;
 
     return mp_const_none;
 }
@@ -403,6 +432,7 @@ STATIC mp_obj_t pyb_lcd_fill(mp_obj_t self_in, mp_obj_t col_in) {
     }
     memset(self->pix_buf, col, LCD_PIX_BUF_BYTE_SIZE);
     memset(self->pix_buf2, col, LCD_PIX_BUF_BYTE_SIZE);
+    self->redraw_all = true;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_lcd_fill_obj, pyb_lcd_fill);
@@ -498,18 +528,42 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_lcd_text_obj, 5, 5, pyb_lcd_text)
 
 /// \method show()
 ///
-/// Show the hidden buffer on the screen.
+/// Show the hidden buffer on the screen.  Only the parts of the screen that
+/// changed since the last call are sent.
 STATIC mp_obj_t pyb_lcd_show(mp_obj_t self_in) {
     pyb_lcd_obj_t *self = self_in;
-    memcpy(self->pix_buf, self->pix_buf2, LCD_PIX_BUF_BYTE_SIZE);
     for (uint page = 0; page < 4; page++) {
-        lcd_out(self, LCD_INSTR, 0xb0 | page); // page address set
-        lcd_out(self, LCD_INSTR, 0x10); // column address set upper; 0
-        lcd_out(self, LCD_INSTR, 0x00); // column address set lower; 0
-        for (uint i = 0; i < 128; i++) {
-            lcd_out(self, LCD_DATA, self->pix_buf[128 * page + 127 - i]);
+        const byte *cur = &self->pix_buf[LCD_PIX_BUF_W * page];
+        const byte *new = &self->pix_buf2[LCD_PIX_BUF_W * page];
+
+        // find the range of columns in this page that changed
+        int x0 = 0;
+        int x1 = LCD_PIX_BUF_W - 1;
+        if (!self->redraw_all) {
+            while (x0 < LCD_PIX_BUF_W && cur[x0] == new[x0]) {
+                x0++;
+            }
+            if (x0 == LCD_PIX_BUF_W) {
+                continue;
+            }
+            while (cur[x1] == new[x1]) {
+                x1--;
+            }
+        }
+
+        // the LCD is upside down, so column c on the LCD shows pixel x = 127 - c
+        uint n = x1 - x0 + 1;
+        for (uint i = 0; i < n; i++) {
+            self->tx_buf[i] = new[x1 - i];
         }
+        uint col = LCD_PIX_BUF_W - 1 - x1;
+        lcd_out(self, LCD_INSTR, 0xb0 | page); // page address set
+        lcd_out(self, LCD_INSTR, 0x10 | (col >> 4)); // column address set upper
+        lcd_out(self, LCD_INSTR, 0x00 | (col & 0x0f)); // column address set lower
+        lcd_out_data(self, self->tx_buf, n);
     }
+    memcpy(self->pix_buf, self->pix_buf2, LCD_PIX_BUF_BYTE_SIZE);
+    self->redraw_all = false;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_lcd_show_obj, pyb_lcd_show);
@@ -529,10 +583,21 @@ STATIC const mp_map_elem_t pyb_lcd_locals_dict_table[] = {
 
 STATIC MP_DEFINE_CONST_DICT(pyb_lcd_locals_dict, pyb_lcd_locals_dict_table);
 
+// The buffer protocol gives the hidden buffer, so that it can be drawn into
+// with framebuf.FrameBuffer(lcd, 128, 32, framebuf.MVLSB).
+STATIC mp_int_t pyb_lcd_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    pyb_lcd_obj_t *self = self_in;
+    bufinfo->buf = self->pix_buf2;
+    bufinfo->len = LCD_PIX_BUF_BYTE_SIZE;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
 const mp_obj_type_t pyb_lcd_type = {
     { &mp_type_type },
     .name = MP_QSTR_LCD,
     .make_new = pyb_lcd_make_new,
+    .buffer_p = { .get_buffer = pyb_lcd_get_buffer },
     .locals_dict = (mp_obj_t)&pyb_lcd_locals_dict,
 };
 
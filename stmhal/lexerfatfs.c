@@ -31,26 +31,21 @@
 
 typedef struct _mp_lexer_file_buf_t {
     FIL fp;
-    byte buf[20];
-    uint16_t len;
-    uint16_t pos;
+    bool eof;
+    byte buf[128];
 } mp_lexer_file_buf_t;
 
-STATIC mp_uint_t file_buf_next_byte(mp_lexer_file_buf_t *fb) {
-    if (fb->pos >= fb->len) {
-        if (fb->len < sizeof(fb->buf)) {
-            return MP_LEXER_EOF;
-        } else {
-            UINT n;
-            f_read(&fb->fp, fb->buf, sizeof(fb->buf), &n);
-            if (n == 0) {
-                return MP_LEXER_EOF;
-            }
-            fb->len = n;
-            fb->pos = 0;
+STATIC const byte *file_buf_read(mp_lexer_file_buf_t *fb, mp_uint_t *len) {
+    UINT n = 0;
+    if (!fb->eof) {
+        f_read(&fb->fp, fb->buf, sizeof(fb->buf), &n);
+        if (n < sizeof(fb->buf)) {
+            // a short read means the end of the file
+            fb->eof = true;
         }
     }
-    return fb->buf[fb->pos++];
+    *len = n;
+    return fb->buf;
 }
 
 STATIC void file_buf_close(mp_lexer_file_buf_t *fb) {
@@ -68,9 +63,6 @@ mp_lexer_t *mp_lexer_new_from_file(const char *filename) {
         m_del_obj(mp_lexer_file_buf_t, fb);
         return NULL;
     }
-    UINT n;
-    f_read(&fb->fp, fb->buf, sizeof(fb->buf), &n);
-    fb->len = n;
-    fb->pos = 0;
-    return mp_lexer_new(qstr_from_str(filename), fb, (mp_lexer_stream_next_byte_t)file_buf_next_byte, (mp_lexer_stream_close_t)file_buf_close);
+    fb->eof = false;
+    return mp_lexer_new(qstr_from_str(filename), fb, (mp_lexer_stream_read_t)file_buf_read, (mp_lexer_stream_close_t)file_buf_close);
 }
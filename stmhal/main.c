@@ -58,6 +58,7 @@
 #include "accel.h"
 #include "servo.h"
 #include "dac.h"
+#include "adc.h"
 #include "can.h"
 #include "modnetwork.h"
 #include MICROPY_HAL_H
@@ -498,7 +499,7 @@ soft_reset:
     dac_init();
 #endif
 
-    mod_network_init();
+    // the network module is set up by its __init__ on first import
 
     // At this point everything is fully configured and initialised.
 
@@ -545,6 +546,7 @@ soft_reset_exit:
 
     printf("PYB: soft reboot\n");
     timer_deinit();
+    adc_deinit();
     uart_deinit();
 #if MICROPY_HW_ENABLE_CAN
     can_deinit();
@@ -47,7 +47,6 @@
 
 typedef struct _wiznet5k_obj_t {
     mp_obj_base_t base;
-    mp_uint_t cris_state;
     SPI_HandleTypeDef *spi;
     const pin_obj_t *cs;
     const pin_obj_t *rst;
@@ -56,12 +55,13 @@ typedef struct _wiznet5k_obj_t {
 
 STATIC wiznet5k_obj_t wiznet5k_obj;
 
+// The driver is only ever called from the main thread, never from an IRQ,
+// so its critical sections don't need to disable IRQs.  Leaving them enabled
+// lets the socket buffer transfers below go by DMA.
 STATIC void wiz_cris_enter(void) {
-    wiznet5k_obj.cris_state = MICROPY_BEGIN_ATOMIC_SECTION();
 }
 
 STATIC void wiz_cris_exit(void) {
-    MICROPY_END_ATOMIC_SECTION(wiznet5k_obj.cris_state);
 }
 
 STATIC void wiz_cs_select(void) {
@@ -72,13 +72,15 @@ STATIC void wiz_cs_deselect(void) {
     GPIO_set_pin(wiznet5k_obj.cs->gpio, wiznet5k_obj.cs->pin_mask);
 }
 
+// socket data is moved in one burst straight between the chip and the
+// caller's buffer (e.g. the target of recv_into)
 STATIC void wiz_spi_read(uint8_t *buf, uint32_t len) {
-    HAL_StatusTypeDef status = HAL_SPI_Receive(wiznet5k_obj.spi, buf, len, 5000);
+    HAL_StatusTypeDef status = spi_transfer(wiznet5k_obj.spi, len, NULL, buf, 5000);
     (void)status;
 }
 
 STATIC void wiz_spi_write(const uint8_t *buf, uint32_t len) {
-    HAL_StatusTypeDef status = HAL_SPI_Transmit(wiznet5k_obj.spi, (uint8_t*)buf, len, 5000);
+    HAL_StatusTypeDef status = spi_transfer(wiznet5k_obj.spi, len, buf, NULL, 5000);
     (void)status;
 }
 
@@ -324,7 +326,6 @@ STATIC mp_obj_t wiznet5k_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t
 
     // init the wiznet5k object
     wiznet5k_obj.base.type = (mp_obj_type_t*)&mod_network_nic_type_wiznet5k;
-    wiznet5k_obj.cris_state = 0;
     wiznet5k_obj.spi = spi_get_handle(args[0]);
     wiznet5k_obj.cs = pin_find(args[1]);
     wiznet5k_obj.rst = pin_find(args[2]);
@@ -558,6 +558,7 @@ STATIC const mp_map_elem_t pyb_module_globals_table[] = {
 #endif
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_Pin), (mp_obj_t)&pin_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Port), (mp_obj_t)&pin_port_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ExtInt), (mp_obj_t)&extint_type },
 
 #if MICROPY_HW_ENABLE_SERVO
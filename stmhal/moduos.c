@@ -31,6 +31,7 @@
 #include "py/obj.h"
 #include "py/objtuple.h"
 #include "py/objstr.h"
+#include "py/builtin.h"
 #include "genhdr/mpversion.h"
 #include "lib/fatfs/ff.h"
 #include "lib/fatfs/diskio.h"
@@ -103,6 +104,11 @@ STATIC mp_obj_t os_chdir(mp_obj_t path_in) {
         res = f_chdir(path);
     }
 
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    // listings of relative paths no longer apply
+    mp_import_cache_clear();
+    #endif
+
     if (res != FR_OK) {
         // TODO should be mp_type_FileNotFoundError
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_OSError, "No such file or directory: '%s'", path));
@@ -212,6 +218,9 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(os_listdir_obj, 0, 1, os_listdir);
 STATIC mp_obj_t os_mkdir(mp_obj_t path_o) {
     const char *path = mp_obj_str_get_str(path_o);
     FRESULT res = f_mkdir(path);
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_import_cache_clear();
+    #endif
     switch (res) {
         case FR_OK:
             return mp_const_none;
@@ -230,6 +239,9 @@ STATIC mp_obj_t os_remove(mp_obj_t path_o) {
     const char *path = mp_obj_str_get_str(path_o);
     // TODO check that path is actually a file before trying to unlink it
     FRESULT res = f_unlink(path);
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_import_cache_clear();
+    #endif
     switch (res) {
         case FR_OK:
             return mp_const_none;
@@ -245,6 +257,9 @@ STATIC mp_obj_t os_rmdir(mp_obj_t path_o) {
     const char *path = mp_obj_str_get_str(path_o);
     // TODO check that path is actually a directory before trying to unlink it
     FRESULT res = f_unlink(path);
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_import_cache_clear();
+    #endif
     switch (res) {
         case FR_OK:
             return mp_const_none;
@@ -350,9 +365,7 @@ STATIC mp_obj_t os_urandom(mp_obj_t num) {
     mp_int_t n = mp_obj_get_int(num);
     vstr_t vstr;
     vstr_init_len(&vstr, n);
-    for (int i = 0; i < n; i++) {
-        vstr.buf[i] = rng_get();
-    }
+    rng_get_bytes((uint8_t*)vstr.buf, n);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(os_urandom_obj, os_urandom);
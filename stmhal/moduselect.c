@@ -30,6 +30,8 @@
 #include "py/nlr.h"
 #include "py/obj.h"
 #include "py/objlist.h"
+#include "irq.h"
+#include "systick.h"
 #include "pybioctl.h"
 #include MICROPY_HAL_H
 
@@ -37,6 +39,8 @@
 ///
 /// This module provides the select function.
 
+volatile uint8_t mp_ioctl_poll_event;
+
 typedef struct _poll_obj_t {
     mp_obj_t obj;
     mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, mp_uint_t arg, int *errcode);
@@ -107,6 +111,44 @@ STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, mp_uint_t *rwx_num) {
     return n_ready;
 }
 
+// check whether every object in the map notifies from an IRQ when it may be ready
+STATIC bool poll_map_irq_notifies(mp_map_t *poll_map) {
+    for (mp_uint_t i = 0; i < poll_map->alloc; ++i) {
+        if (!MP_MAP_SLOT_IS_FILLED(poll_map, i)) {
+            continue;
+        }
+        poll_obj_t *poll_obj = (poll_obj_t*)poll_map->table[i].value;
+        int errcode;
+        if (poll_obj->ioctl(poll_obj->obj, MP_IOCTL_POLL_IRQ, poll_obj->flags, &errcode) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sleep until one of the objects may be ready, or the timeout expires.
+// mp_ioctl_poll_event must have been cleared before the objects were polled.
+STATIC void poll_map_wait(mp_map_t *poll_map, mp_uint_t start_tick, mp_uint_t timeout) {
+    if (!poll_map_irq_notifies(poll_map)) {
+        // some object must be polled, so do that after the next interrupt
+        __WFI();
+        return;
+    }
+    for (;;) {
+        // WFI still wakes on a pending IRQ with IRQs disabled, so this
+        // doesn't miss an event that comes in just after the check
+        mp_uint_t irq_state = disable_irq();
+        mp_uint_t elapsed = HAL_GetTick() - start_tick;
+        if (mp_ioctl_poll_event || (timeout != -1 && elapsed >= timeout)) {
+            enable_irq(irq_state);
+            return;
+        }
+        // sleep without waking for every tick until the timeout
+        sys_tick_sleep(timeout == -1 ? 0xffffffff : timeout - elapsed);
+        enable_irq(irq_state);
+    }
+}
+
 /// \function select(rlist, wlist, xlist[, timeout])
 STATIC mp_obj_t select_select(uint n_args, const mp_obj_t *args) {
     // get array data from tuple/list arguments
@@ -142,6 +184,7 @@ STATIC mp_obj_t select_select(uint n_args, const mp_obj_t *args) {
     rwx_len[0] = rwx_len[1] = rwx_len[2] = 0;
     for (;;) {
         // poll the objects
+        mp_ioctl_poll_event = 0;
         mp_uint_t n_ready = poll_map_poll(&poll_map, rwx_len);
 
         if (n_ready > 0 || (timeout != -1 && HAL_GetTick() - start_tick >= timeout)) {
@@ -169,7 +212,7 @@ STATIC mp_obj_t select_select(uint n_args, const mp_obj_t *args) {
             mp_map_deinit(&poll_map);
             return mp_obj_new_tuple(3, list_array);
         }
-        __WFI();
+        poll_map_wait(&poll_map, start_tick, timeout);
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_select_obj, 3, 4, select_select);
@@ -235,6 +278,7 @@ STATIC mp_obj_t poll_poll(uint n_args, const mp_obj_t *args) {
     mp_uint_t start_tick = HAL_GetTick();
     for (;;) {
         // poll the objects
+        mp_ioctl_poll_event = 0;
         mp_uint_t n_ready = poll_map_poll(&self->poll_map, NULL);
 
         if (n_ready > 0 || (timeout != -1 && HAL_GetTick() - start_tick >= timeout)) {
@@ -253,7 +297,7 @@ STATIC mp_obj_t poll_poll(uint n_args, const mp_obj_t *args) {
             }
             return ret_list;
         }
-        __WFI();
+        poll_map_wait(&self->poll_map, start_tick, timeout);
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_poll_obj, 1, 2, poll_poll);
@@ -285,6 +329,10 @@ STATIC const mp_map_elem_t mp_module_select_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uselect) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_select), (mp_obj_t)&mp_select_select_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_poll), (mp_obj_t)&mp_select_poll_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLIN), MP_OBJ_NEW_SMALL_INT(MP_IOCTL_POLL_RD) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLOUT), MP_OBJ_NEW_SMALL_INT(MP_IOCTL_POLL_WR) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLERR), MP_OBJ_NEW_SMALL_INT(MP_IOCTL_POLL_ERR) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLHUP), MP_OBJ_NEW_SMALL_INT(MP_IOCTL_POLL_HUP) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_select_globals, mp_module_select_globals_table);
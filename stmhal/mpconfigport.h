@@ -33,17 +33,27 @@
 #define MICROPY_ALLOC_PATH_MAX      (128)
 #define MICROPY_EMIT_THUMB          (1)
 #define MICROPY_EMIT_INLINE_THUMB   (1)
+#define MICROPY_EMIT_NATIVE_FLOAT   (1)
 #define MICROPY_COMP_MODULE_CONST   (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
+#define MICROPY_COMP_CLOSURE_BY_VALUE (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_DEFERRED_FINALISERS (1)
+#define MICROPY_GC_OBJ_POOLS        (1)
+#define MICROPY_GC_ALLOC_THRESHOLD  (1)
+#define MICROPY_GC_STATS            (1)
+#define MICROPY_VM_SAMPLE_PROFILE   (1)
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_HELPER_REPL         (1)
+#define MICROPY_REPL_RAW_FILE_TRANSFER (1)
 #define MICROPY_ENABLE_SOURCE_LINE  (1)
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_FLOAT)
+#define MICROPY_OBJ_REPR            (MICROPY_OBJ_REPR_D) // floats are stored in the object word
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
+#define MICROPY_OPT_ARG_PARSE       (1)
 /* Enable FatFS LFNs
     0: Disable LFN feature.
     1: Enable LFN with static working buffer on the BSS. Always NOT reentrant.
@@ -54,11 +64,16 @@
 #define MICROPY_LFN_CODE_PAGE       (437) /* 1=SFN/ANSI 437=LFN/U.S.(OEM) */
 #define MICROPY_STREAMS_NON_BLOCK   (1)
 #define MICROPY_MODULE_WEAK_LINKS   (1)
+#define MICROPY_MODULE_LISTDIR_CACHE (1)
+#define MICROPY_MODULE_LAZY_SUBMODULES (1)
+#define MICROPY_MODULE_GETATTR      (1)
+#define MICROPY_MODULE_BUILTIN_INIT (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (1)
+#define MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE (1)
 #define MICROPY_PY_BUILTINS_FROZENSET (1)
 #define MICROPY_PY_BUILTINS_EXECFILE (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO (1)
@@ -67,7 +82,9 @@
 #define MICROPY_PY_SYS_MAXSIZE      (1)
 #define MICROPY_PY_SYS_STDFILES     (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE (1)
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
+#define MICROPY_PY_MATH_ARRAY_FUNCTIONS (1)
 #define MICROPY_PY_CMATH            (1)
 #define MICROPY_PY_IO               (1)
 #define MICROPY_PY_IO_FILEIO        (1)
@@ -78,7 +95,14 @@
 #define MICROPY_PY_URE              (1)
 #define MICROPY_PY_UHEAPQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
+#define MICROPY_PY_UASYNCIO         (1)
+#define MICROPY_PY_URINGBUF         (1)
+#define MICROPY_PY_UWEAKREF         (1)
+#define MICROPY_PY_URANDOM          (1)
+#define MICROPY_PY_FRAMEBUF         (1)
+#define MICROPY_PY_UHTTP            (1)
 
+#define MICROPY_ENABLE_SCHEDULER    (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (0)
 
@@ -151,6 +175,7 @@ extern const struct _mp_obj_module_t mp_module_network;
     mp_obj_t pin_class_map_dict; \
     \
     mp_obj_t pyb_extint_callback[PYB_EXTI_NUM_VECTORS]; \
+    struct _extint_capture_t *pyb_extint_capture; \
     \
     /* Used to do callbacks to Python code on interrupt */ \
     struct _pyb_timer_obj_t *pyb_timer_obj_all[14]; \
@@ -164,6 +189,19 @@ extern const struct _mp_obj_module_t mp_module_network;
     /* pointers to all CAN objects (if they have been created) */ \
     struct _pyb_can_obj_t *pyb_can_obj_all[2]; \
     \
+    /* the ADC object streaming with DMA, if any */ \
+    struct _pyb_obj_adc_t *pyb_adc_stream; \
+    \
+    /* completion callback and buffers of non-blocking SPI transfers */ \
+    mp_obj_t pyb_spi_callback[3]; \
+    mp_obj_t pyb_spi_nb_buf[3][2]; \
+    \
+    /* DAC objects doing DMA with a callback or a stream of buffers */ \
+    struct _pyb_dac_obj_t *pyb_dac_obj_all[2]; \
+    \
+    /* I2C transactions in progress, see I2C.transact */ \
+    struct _pyb_i2c_transact_t *pyb_i2c_transact[3]; \
+    \
     /* list of registered NICs */ \
     mp_obj_list_t mod_network_nic_list; \
 
@@ -224,6 +262,16 @@ static inline mp_uint_t disable_irq(void) {
 // board specific definitions
 #include "mpconfigboard.h"
 
+// continue uzlib.crc32 over whole words with the CRC unit
+uint32_t crc_hw_crc32_update(uint32_t crc, const uint8_t *buf, mp_uint_t len);
+#define MICROPY_PY_UZLIB_CRC32_HW_FUNC crc_hw_crc32_update
+
+// seed urandom from the hardware RNG, if the board has one
+#if MICROPY_HW_ENABLE_RNG
+uint32_t rng_get(void);
+#define MICROPY_PY_URANDOM_SEED_INIT_FUNC (rng_get())
+#endif
+
 // We need to provide a declaration/definition of alloca()
 #include <alloca.h>
 
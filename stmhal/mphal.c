@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "py/mpstate.h"
+#include "py/bc.h"
 #include "usb.h"
 #include "uart.h"
 #include "mphal.h"
@@ -22,6 +23,41 @@ void mp_hal_set_interrupt_char(int c) {
     usb_vcp_set_interrupt_char(c);
 }
 
+mp_uint_t mp_hal_ticks_ms(void) {
+    return HAL_GetTick();
+}
+
+// used by the VM profiler, so the ticks are CPU cycles
+mp_uint_t mp_hal_ticks_cpu(void) {
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+#if MICROPY_VM_SAMPLE_PROFILE
+// milliseconds between samples of the VM (0 when stopped), and until the next
+STATIC volatile uint32_t sample_period;
+STATIC volatile uint32_t sample_countdown;
+
+// samples are taken by SysTick, so the period is rounded up to milliseconds
+void mp_hal_sample_timer(mp_uint_t period_us) {
+    sample_period = 0;
+    sample_countdown = (period_us + 999) / 1000;
+    sample_period = sample_countdown;
+}
+
+// called by SysTick_Handler every millisecond
+void mp_hal_sample_systick(void) {
+    if (sample_period != 0 && --sample_countdown == 0) {
+        sample_countdown = sample_period;
+        mp_vm_sample();
+    }
+}
+#endif
+
 int mp_hal_stdin_rx_chr(void) {
     for (;;) {
 #if 0
@@ -44,6 +80,22 @@ int mp_hal_stdin_rx_chr(void) {
     }
 }
 
+int mp_hal_stdin_rx_chr_timeout(mp_uint_t timeout_ms) {
+    mp_uint_t start = HAL_GetTick();
+    for (;;) {
+        byte c;
+        if (usb_vcp_recv_byte(&c) != 0) {
+            return c;
+        } else if (MP_STATE_PORT(pyb_stdio_uart) != NULL && uart_rx_any(MP_STATE_PORT(pyb_stdio_uart))) {
+            return uart_rx_char(MP_STATE_PORT(pyb_stdio_uart));
+        }
+        if (HAL_GetTick() - start >= timeout_ms) {
+            return -1;
+        }
+        __WFI();
+    }
+}
+
 void mp_hal_stdout_tx_str(const char *str) {
     mp_hal_stdout_tx_strn(str, strlen(str));
 }
@@ -11,8 +11,12 @@ extern const byte mp_hal_status_to_errno_table[4];
 
 NORETURN void mp_hal_raise(HAL_StatusTypeDef status);
 void mp_hal_set_interrupt_char(int c); // -1 to disable
+mp_uint_t mp_hal_ticks_ms(void);
+mp_uint_t mp_hal_ticks_cpu(void);
+void mp_hal_sample_systick(void);
 
 int mp_hal_stdin_rx_chr(void);
+int mp_hal_stdin_rx_chr_timeout(mp_uint_t timeout_ms); // -1 on timeout
 void mp_hal_stdout_tx_str(const char *str);
 void mp_hal_stdout_tx_strn(const char *str, mp_uint_t len);
 void mp_hal_stdout_tx_strn_cooked(const char *str, mp_uint_t len);
@@ -498,7 +498,8 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(pin_pin_obj, pin_pin);
 /// Returns the base address of the GPIO block associated with this pin.
 STATIC mp_obj_t pin_gpio(mp_obj_t self_in) {
     pin_obj_t *self = self_in;
-    return MP_OBJ_NEW_SMALL_INT((mp_int_t)self->gpio);
+    // the address doesn't fit in a small int
+    return mp_obj_new_int_from_uint((mp_uint_t)self->gpio);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pin_gpio_obj, pin_gpio);
 
@@ -587,6 +588,148 @@ const mp_obj_type_t pin_type = {
     .locals_dict = (mp_obj_t)&pin_locals_dict,
 };
 
+/// \moduleref pyb
+/// \class Port - access all pins of a GPIO port at once
+///
+/// A Port reads and writes several pins of one GPIO port in a single
+/// register access, so pins that change together (eg a parallel bus) do so
+/// at the same instant.  Pins must be configured with the Pin class first.
+///
+/// Usage Model:
+///
+///     p = pyb.Port('A')
+///     p.write(0x0005, 0x000f) # PA0 and PA2 high, PA1 and PA3 low
+///     p.read(0x00f0)          # state of PA4-PA7
+///
+/// For the tightest loops, viper code can access the registers directly
+/// using the address from `gpio()`, eg `ptr16(p.gpio() + 0x18)` for BSRRL.
+
+typedef struct _pyb_port_obj_t {
+    mp_obj_base_t base;
+    pin_gpio_t *gpio;
+    char name;
+} pyb_port_obj_t;
+
+STATIC pin_gpio_t *const pyb_port_gpio[] = {
+    GPIOA, GPIOB, GPIOC, GPIOD, GPIOE,
+    #if defined(GPIOF)
+    GPIOF,
+    #else
+    NULL,
+    #endif
+    #if defined(GPIOG)
+    GPIOG,
+    #else
+    NULL,
+    #endif
+    GPIOH,
+    #if defined(GPIOI)
+    GPIOI,
+    #endif
+};
+
+STATIC void port_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    pyb_port_obj_t *self = self_in;
+    mp_printf(print, "Port(%c)", self->name);
+}
+
+/// \classmethod \constructor(id)
+/// Create a Port object for the given port.  `id` can be the port letter
+/// ('A', 'B', ...), its index (0 for A) or a Pin on that port.
+STATIC mp_obj_t port_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t idx;
+    if (MP_OBJ_IS_TYPE(args[0], &pin_type)) {
+        idx = ((pin_obj_t*)args[0])->port;
+    } else if (MP_OBJ_IS_STR(args[0])) {
+        mp_uint_t len;
+        const char *str = mp_obj_str_get_data(args[0], &len);
+        idx = len == 1 ? (str[0] | 0x20) - 'a' : -1;
+    } else {
+        idx = mp_obj_get_int(args[0]);
+    }
+    if (idx < 0 || (mp_uint_t)idx >= MP_ARRAY_SIZE(pyb_port_gpio) || pyb_port_gpio[idx] == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "port does not exist"));
+    }
+    pyb_port_obj_t *o = m_new_obj(pyb_port_obj_t);
+    o->base.type = type_in;
+    o->gpio = pyb_port_gpio[idx];
+    o->name = 'A' + idx;
+    return o;
+}
+
+/// \method read([mask])
+/// Return the input levels of the port's pins, masked by `mask`.
+STATIC mp_obj_t port_read(mp_uint_t n_args, const mp_obj_t *args) {
+    pyb_port_obj_t *self = args[0];
+    mp_uint_t value = self->gpio->IDR;
+    if (n_args == 2) {
+        value &= mp_obj_get_int(args[1]);
+    }
+    return MP_OBJ_NEW_SMALL_INT(value & 0xffff);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(port_read_obj, 1, 2, port_read);
+
+/// \method write(value[, mask])
+/// Atomically set the pins selected by `mask` (default all) to the
+/// corresponding bits of `value`; the other pins are left alone.
+STATIC mp_obj_t port_write(mp_uint_t n_args, const mp_obj_t *args) {
+    pyb_port_obj_t *self = args[0];
+    uint32_t value = mp_obj_get_int(args[1]);
+    uint32_t mask = 0xffff;
+    if (n_args == 3) {
+        mask = mp_obj_get_int(args[2]) & 0xffff;
+    }
+    // the low half of BSRR sets pins and the high half resets them
+    *(__IO uint32_t*)&self->gpio->BSRRL = (value & mask) | ((~value & mask) << 16);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(port_write_obj, 2, 3, port_write);
+
+/// \method high(mask)
+/// Set the pins selected by `mask` high.
+STATIC mp_obj_t port_high(mp_obj_t self_in, mp_obj_t mask_in) {
+    pyb_port_obj_t *self = self_in;
+    GPIO_set_pin(self->gpio, mp_obj_get_int(mask_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(port_high_obj, port_high);
+
+/// \method low(mask)
+/// Set the pins selected by `mask` low.
+STATIC mp_obj_t port_low(mp_obj_t self_in, mp_obj_t mask_in) {
+    pyb_port_obj_t *self = self_in;
+    GPIO_clear_pin(self->gpio, mp_obj_get_int(mask_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(port_low_obj, port_low);
+
+/// \method gpio()
+/// Returns the base address of the GPIO block of this port.
+STATIC mp_obj_t port_gpio(mp_obj_t self_in) {
+    pyb_port_obj_t *self = self_in;
+    return mp_obj_new_int_from_uint((mp_uint_t)self->gpio);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(port_gpio_obj, port_gpio);
+
+STATIC const mp_map_elem_t port_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read),    (mp_obj_t)&port_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write),   (mp_obj_t)&port_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_high),    (mp_obj_t)&port_high_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_low),     (mp_obj_t)&port_low_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_gpio),    (mp_obj_t)&port_gpio_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(port_locals_dict, port_locals_dict_table);
+
+const mp_obj_type_t pin_port_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Port,
+    .print = port_print,
+    .make_new = port_make_new,
+    .locals_dict = (mp_obj_t)&port_locals_dict,
+};
+
 /// \moduleref pyb
 /// \class PinAF - Pin Alternate Functions
 ///
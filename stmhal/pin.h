@@ -59,6 +59,7 @@ typedef struct {
 
 extern const mp_obj_type_t pin_type;
 extern const mp_obj_type_t pin_af_type;
+extern const mp_obj_type_t pin_port_type;
 
 typedef struct {
   const char *name;
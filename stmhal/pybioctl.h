@@ -1,6 +1,15 @@
 #define MP_IOCTL_POLL (0x100 | 1)
 
+// Returns 0 if the object calls MP_IOCTL_POLL_NOTIFY from an IRQ whenever it
+// may become ready for the given flags, so that a waiting poll can sleep
+// until then instead of polling the object after every interrupt.
+#define MP_IOCTL_POLL_IRQ (0x100 | 2)
+
 #define MP_IOCTL_POLL_RD  (0x0001)
 #define MP_IOCTL_POLL_WR  (0x0002)
 #define MP_IOCTL_POLL_HUP (0x0004)
 #define MP_IOCTL_POLL_ERR (0x0008)
+
+// set from IRQ handlers, see MP_IOCTL_POLL_IRQ
+extern volatile uint8_t mp_ioctl_poll_event;
+#define MP_IOCTL_POLL_NOTIFY() (mp_ioctl_poll_event = 1)
@@ -33,6 +33,8 @@
 #include "py/runtime.h"
 #include "py/repl.h"
 #include "py/gc.h"
+#include "py/stream.h"
+#include "py/builtin.h"
 #ifdef MICROPY_HAL_H
 #include MICROPY_HAL_H
 #endif
@@ -64,8 +66,8 @@ STATIC int parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t input_ki
     if (nlr_push(&nlr) == 0) {
         // parse and compile the script
         qstr source_name = lex->source_name;
-        mp_parse_node_t pn = mp_parse(lex, input_kind);
-        mp_obj_t module_fun = mp_compile(pn, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
+        mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
+        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
 
         // execute code
         mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
@@ -118,12 +120,46 @@ STATIC int parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t input_ki
     return ret;
 }
 
+// Paste mode (CTRL-E at an empty prompt) takes the input as it comes, with
+// no auto-indent, history or continuation checks, until CTRL-D, and then
+// compiles and runs it as a whole, like a file.  This makes pasting a long
+// script much faster and exactly preserves its indentation.  Characters
+// are echoed as they are, with a "=== " prompt at each new line.
+#define PASTE_MODE_BANNER "\r\npaste mode; Ctrl-C to cancel, Ctrl-D to finish\r\n=== "
+
+STATIC void pyexec_paste_add_char(vstr_t *line, int c) {
+    if (c == '\r') {
+        mp_hal_stdout_tx_str("\r\n=== ");
+        c = '\n';
+    } else if (c == '\n') {
+        // a CRLF line ending was already dealt with by its CR
+        if (line->len > 0 && line->buf[line->len - 1] == '\n') {
+            return;
+        }
+        mp_hal_stdout_tx_str("\r\n=== ");
+    } else {
+        char ch = c;
+        mp_hal_stdout_tx_strn(&ch, 1);
+    }
+    vstr_add_byte(line, c);
+}
+
+STATIC int pyexec_paste_execute(vstr_t *line) {
+    mp_lexer_t *lex = mp_lexer_new_from_str_len(MP_QSTR__lt_stdin_gt_, vstr_str(line), vstr_len(line), 0);
+    if (lex == NULL) {
+        printf("MemoryError\n");
+        return 0;
+    }
+    return parse_compile_execute(lex, MP_PARSE_FILE_INPUT, EXEC_FLAG_ALLOW_DEBUGGING | EXEC_FLAG_IS_REPL);
+}
+
 #if MICROPY_REPL_EVENT_DRIVEN
 
 typedef struct _repl_t {
     // XXX line holds a root pointer!
     vstr_t line;
     bool cont_line;
+    bool paste_mode;
 } repl_t;
 
 repl_t repl;
@@ -134,6 +170,7 @@ STATIC int pyexec_friendly_repl_process_char(int c);
 void pyexec_event_repl_init(void) {
     vstr_init(&repl.line, 32);
     repl.cont_line = false;
+    repl.paste_mode = false;
     readline_init(&repl.line, ">>> ");
     if (pyexec_mode_kind == PYEXEC_MODE_RAW_REPL) {
         pyexec_raw_repl_process_char(CHAR_CTRL_A);
@@ -193,6 +230,25 @@ reset:
 }
 
 STATIC int pyexec_friendly_repl_process_char(int c) {
+    if (repl.paste_mode) {
+        if (c == CHAR_CTRL_C) {
+            // cancel everything
+            mp_hal_stdout_tx_str("\r\n");
+            goto input_restart;
+        } else if (c == CHAR_CTRL_D) {
+            // end of input
+            mp_hal_stdout_tx_str("\r\n");
+            int ret = pyexec_paste_execute(&repl.line);
+            if (ret & PYEXEC_FORCED_EXIT) {
+                return ret;
+            }
+            goto input_restart;
+        } else {
+            pyexec_paste_add_char(&repl.line, c);
+            return 0;
+        }
+    }
+
     int ret = readline_process_char(c);
 
     if (!repl.cont_line) {
@@ -218,6 +274,12 @@ STATIC int pyexec_friendly_repl_process_char(int c) {
             mp_hal_stdout_tx_str("\r\n");
             vstr_clear(&repl.line);
             return PYEXEC_FORCED_EXIT;
+        } else if (ret == CHAR_CTRL_E) {
+            // paste mode
+            mp_hal_stdout_tx_str(PASTE_MODE_BANNER);
+            vstr_reset(&repl.line);
+            repl.paste_mode = true;
+            return 0;
         }
 
         if (ret < 0) {
@@ -269,6 +331,7 @@ exec: ;
 input_restart:
         vstr_reset(&repl.line);
         repl.cont_line = false;
+        repl.paste_mode = false;
         readline_init(&repl.line, ">>> ");
         return 0;
     }
@@ -284,6 +347,215 @@ int pyexec_event_repl_process_char(int c) {
 
 #else // MICROPY_REPL_EVENT_DRIVEN
 
+#if MICROPY_REPL_RAW_FILE_TRANSFER
+
+// Binary file transfer in the raw REPL, used by pyboard.py put and get.
+//
+// At the start of a command the host sends CTRL-F, then 'W' to write a file
+// to the board or 'R' to read one from it, a byte with the length of the
+// file name and the name.  The board replies 'O' if it opened the file,
+// else 'E'.  The file data then goes as chunks, each of a sequence number
+// byte, a 2-byte length (little endian, at most FT_CHUNK_MAX), the data and
+// a 2-byte CRC-16/CCITT (initial value 0xffff) of all the preceding bytes of
+// the chunk; a chunk of length 0 ends the file.  The receiver answers each
+// chunk with FT_ACK and the sequence number it expects next, or FT_NAK and
+// that number if the chunk was bad, upon which the sender starts again from
+// that chunk.  The board sends FT_CAN instead if it cannot read or write the
+// file; the host abandons a transfer by going quiet.  The sender may
+// have FT_WINDOW chunks not yet acknowledged, so the link stays busy while
+// the file is read or written.  At the end the board sends 'O' if the whole
+// file was transferred, else 'E', and then the raw REPL prompt.
+
+#define FT_CHUNK_MAX (512)
+#define FT_WINDOW (4) // a power of 2, at most 128
+#define FT_TIMEOUT_MS (1000)
+#define FT_IDLE_MS (20)
+#define FT_MAX_RETRIES (8)
+#define FT_ACK (0x06)
+#define FT_NAK (0x15)
+#define FT_CAN (0x18)
+
+STATIC uint16_t ft_crc16(uint16_t crc, const byte *data, mp_uint_t len) {
+    while (len--) {
+        crc ^= *data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// reads len bytes, returning false if the line goes quiet first
+STATIC bool ft_recv(byte *buf, mp_uint_t len) {
+    for (; len > 0; len--) {
+        int c = mp_hal_stdin_rx_chr_timeout(FT_TIMEOUT_MS);
+        if (c < 0) {
+            return false;
+        }
+        *buf++ = c;
+    }
+    return true;
+}
+
+STATIC void ft_send_reply(byte reply, byte seq) {
+    byte buf[2] = {reply, seq};
+    mp_hal_stdout_tx_strn((const char*)buf, 2);
+}
+
+// sends a chunk; buf has 3 bytes of room before the data and 2 after it
+STATIC void ft_send_chunk(byte seq, byte *buf, mp_uint_t len) {
+    buf[0] = seq;
+    buf[1] = len;
+    buf[2] = len >> 8;
+    uint16_t crc = ft_crc16(0xffff, buf, 3 + len);
+    buf[3 + len] = crc;
+    buf[4 + len] = crc >> 8;
+    mp_hal_stdout_tx_strn((const char*)buf, 5 + len);
+}
+
+// receives the chunks of a file from the host and writes them to the stream
+STATIC bool ft_recv_file(mp_obj_t stream, byte *buf) {
+    byte seq = 0;
+    int retries = 0;
+    for (;;) {
+        if (!ft_recv(buf, 3)) {
+            goto bad_chunk;
+        }
+        mp_uint_t len = buf[1] | (buf[2] << 8);
+        if (len > FT_CHUNK_MAX || !ft_recv(buf + 3, len + 2)
+            || ft_crc16(0xffff, buf, 3 + len) != (buf[3 + len] | (buf[4 + len] << 8))) {
+            goto bad_chunk;
+        }
+        if (buf[0] != seq) {
+            // a resent chunk that was received before, or one after a bad one
+            ft_send_reply(FT_ACK, seq);
+            continue;
+        }
+        if (len == 0) {
+            ft_send_reply(FT_ACK, seq + 1);
+            return true;
+        }
+        int errcode;
+        if (mp_stream_rw_into(stream, buf + 3, len, &errcode, MP_STREAM_RW_WRITE) != len) {
+            ft_send_reply(FT_CAN, seq);
+            return false;
+        }
+        seq += 1;
+        ft_send_reply(FT_ACK, seq);
+        retries = 0;
+        continue;
+
+    bad_chunk:
+        if (++retries > FT_MAX_RETRIES) {
+            return false;
+        }
+        // let the rest of the window arrive and be dropped, then ask for it again
+        while (mp_hal_stdin_rx_chr_timeout(FT_IDLE_MS) >= 0) {
+        }
+        ft_send_reply(FT_NAK, seq);
+    }
+}
+
+// reads the stream and sends it to the host in chunks; buf holds FT_WINDOW
+// chunks with their headers
+STATIC bool ft_send_file(mp_obj_t stream, byte *buf) {
+    const mp_uint_t chunk_alloc = 5 + FT_CHUNK_MAX;
+    mp_uint_t lens[FT_WINDOW];
+    byte base = 0; // first chunk not yet acknowledged
+    byte next = 0; // next chunk to send
+    byte filled = 0; // next chunk to read from the stream
+    bool eof = false;
+    int retries = 0;
+    for (;;) {
+        while ((byte)(next - base) < FT_WINDOW) {
+            byte *chunk = buf + (next % FT_WINDOW) * chunk_alloc;
+            if (next == filled) {
+                if (eof) {
+                    break;
+                }
+                int errcode;
+                mp_uint_t len = mp_stream_rw_into(stream, chunk + 3, FT_CHUNK_MAX, &errcode, MP_STREAM_RW_READ);
+                if (errcode != 0) {
+                    ft_send_reply(FT_CAN, next);
+                    return false;
+                }
+                lens[next % FT_WINDOW] = len;
+                eof = len == 0;
+                filled += 1;
+            }
+            ft_send_chunk(next, chunk, lens[next % FT_WINDOW]);
+            next += 1;
+        }
+        if (eof && base == filled) {
+            return true;
+        }
+        byte reply[2] = {0, 0};
+        bool got_reply = ft_recv(reply, 2);
+        bool in_window = (byte)(reply[1] - base) <= (byte)(next - base);
+        if (got_reply && reply[0] == FT_ACK && in_window) {
+            base = reply[1];
+            retries = 0;
+            continue;
+        }
+        if (++retries > FT_MAX_RETRIES) {
+            return false;
+        }
+        // let any other replies arrive and be dropped, then go back
+        while (mp_hal_stdin_rx_chr_timeout(FT_IDLE_MS) >= 0) {
+        }
+        if (got_reply && reply[0] == FT_NAK && in_window) {
+            base = reply[1];
+        }
+        next = base;
+    }
+}
+
+STATIC void pyexec_raw_file_transfer(void) {
+    byte hdr[2];
+    char name[256];
+    if (!ft_recv(hdr, 2) || !ft_recv((byte*)name, hdr[1]) || (hdr[0] != 'W' && hdr[0] != 'R')) {
+        mp_hal_stdout_tx_str("E");
+        return;
+    }
+    bool is_write = hdr[0] == 'W';
+
+    mp_uint_t buf_alloc = (5 + FT_CHUNK_MAX) * (is_write ? 1 : FT_WINDOW);
+    byte *buf = m_new_maybe(byte, buf_alloc);
+    if (buf == NULL) {
+        mp_hal_stdout_tx_str("E");
+        return;
+    }
+
+    bool ok;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = {
+            mp_obj_new_str(name, hdr[1], false),
+            mp_obj_new_str(is_write ? "wb" : "rb", 2, false),
+        };
+        mp_obj_t stream = mp_builtin_open(2, args, (mp_map_t*)&mp_const_empty_map);
+        mp_hal_stdout_tx_str("O");
+        if (is_write) {
+            ok = ft_recv_file(stream, buf);
+        } else {
+            ok = ft_send_file(stream, buf);
+        }
+        mp_obj_t dest[2];
+        mp_load_method(stream, MP_QSTR_close, dest);
+        mp_call_method_n_kw(0, 0, dest);
+        nlr_pop();
+    } else {
+        // an open file is left to the finaliser
+        ok = false;
+    }
+    m_del(byte, buf, buf_alloc);
+    // if the file could not be opened this is the reply to the command,
+    // else it is the final status
+    mp_hal_stdout_tx_str(ok ? "O" : "E");
+}
+
+#endif // MICROPY_REPL_RAW_FILE_TRANSFER
+
 int pyexec_raw_repl(void) {
     vstr_t line;
     vstr_init(&line, 32);
@@ -292,6 +564,7 @@ raw_repl_reset:
     mp_hal_stdout_tx_str("raw REPL; CTRL-B to exit\r\n");
 
     for (;;) {
+    raw_repl_prompt:
         vstr_reset(&line);
         mp_hal_stdout_tx_str(">");
         for (;;) {
@@ -299,6 +572,12 @@ raw_repl_reset:
             if (c == CHAR_CTRL_A) {
                 // reset raw REPL
                 goto raw_repl_reset;
+            #if MICROPY_REPL_RAW_FILE_TRANSFER
+            } else if (c == CHAR_CTRL_F && line.len == 0) {
+                // binary file transfer
+                pyexec_raw_file_transfer();
+                goto raw_repl_prompt;
+            #endif
             } else if (c == CHAR_CTRL_B) {
                 // change to friendly REPL
                 mp_hal_stdout_tx_str("\r\n");
@@ -409,6 +688,28 @@ friendly_repl_reset:
             mp_hal_stdout_tx_str("\r\n");
             vstr_clear(&line);
             return PYEXEC_FORCED_EXIT;
+        } else if (ret == CHAR_CTRL_E) {
+            // paste mode
+            mp_hal_stdout_tx_str(PASTE_MODE_BANNER);
+            vstr_reset(&line);
+            for (;;) {
+                int c = mp_hal_stdin_rx_chr();
+                if (c == CHAR_CTRL_C) {
+                    // cancel everything
+                    mp_hal_stdout_tx_str("\r\n");
+                    goto input_restart;
+                } else if (c == CHAR_CTRL_D) {
+                    // end of input
+                    mp_hal_stdout_tx_str("\r\n");
+                    break;
+                }
+                pyexec_paste_add_char(&line, c);
+            }
+            ret = pyexec_paste_execute(&line);
+            if (ret & PYEXEC_FORCED_EXIT) {
+                return ret;
+            }
+            continue;
         } else if (vstr_len(&line) == 0) {
             continue;
         }
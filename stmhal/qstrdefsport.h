@@ -91,6 +91,7 @@ Q(hashlib)
 // for file class
 Q(seek)
 Q(tell)
+Q(fastseek)
 
 // for USB configuration
 Q(usb_mode)
@@ -127,6 +128,7 @@ Q(wakeup)
 Q(Pin)
 Q(PinAF)
 Q(PinNamed)
+Q(Port)
 Q(init)
 Q(value)
 Q(low)
@@ -177,6 +179,9 @@ Q(stop)
 Q(parity)
 Q(flow)
 Q(read_buf_len)
+Q(write_buf_len)
+Q(rx_dma)
+Q(stats)
 Q(buf)
 Q(len)
 Q(timeout)
@@ -213,6 +218,9 @@ Q(initfilterbanks)
 Q(clearfilter)
 Q(setfilter)
 Q(rxcallback)
+Q(rx_buf_len)
+Q(recv_into)
+Q(rxstats)
 Q(rtr)
 Q(NORMAL)
 Q(LOOPBACK)
@@ -234,6 +242,8 @@ Q(source_freq)
 Q(prescaler)
 Q(period)
 Q(callback)
+Q(fun)
+Q(hard)
 Q(freq)
 Q(mode)
 Q(div)
@@ -264,6 +274,8 @@ Q(pulse_width)
 Q(pulse_width_percent)
 Q(compare)
 Q(capture)
+Q(capture_dma)
+Q(capture_index)
 Q(polarity)
 Q(deadtime)
 
@@ -278,6 +290,10 @@ Q(enable)
 Q(disable)
 Q(swint)
 Q(regs)
+Q(capture)
+Q(capture_init)
+Q(capture_read)
+Q(capture_stats)
 Q(IRQ_RISING)
 Q(IRQ_FALLING)
 Q(IRQ_RISING_FALLING)
@@ -303,6 +319,9 @@ Q(send)
 Q(recv)
 Q(mem_read)
 Q(mem_write)
+Q(transact)
+Q(ops)
+Q(callback)
 
 // for SPI class
 Q(SPI)
@@ -311,6 +330,9 @@ Q(deinit)
 Q(send)
 Q(recv)
 Q(send_recv)
+Q(callback)
+Q(busy)
+Q(wait)
 Q(mode)
 Q(baudrate)
 Q(polarity)
@@ -338,6 +360,10 @@ Q(filtered_xyz)
 Q(ADC)
 Q(ADCAll)
 Q(read_timed)
+Q(read_timed_stream)
+Q(stream_half)
+Q(stream_stop)
+Q(simultaneous)
 Q(read_channel)
 Q(read_core_temp)
 Q(read_core_vbat)
@@ -354,6 +380,10 @@ Q(freq)
 Q(mode)
 Q(NORMAL)
 Q(CIRCULAR)
+Q(STREAM)
+Q(callback)
+Q(queue)
+Q(stop)
 
 // for Servo object
 Q(Servo)
@@ -399,6 +429,10 @@ Q(poll)
 Q(register)
 Q(unregister)
 Q(modify)
+Q(POLLIN)
+Q(POLLOUT)
+Q(POLLERR)
+Q(POLLHUP)
 
 // for input
 Q(input)
@@ -426,6 +460,8 @@ Q(send)
 Q(recv)
 Q(sendto)
 Q(recvfrom)
+Q(recv_into)
+Q(recvfrom_into)
 Q(setblocking)
 Q(setsockopt)
 Q(settimeout)
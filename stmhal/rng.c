@@ -55,6 +55,29 @@ uint32_t rng_get(void) {
     return HAL_RNG_GetRandomNumber(&RNGHandle);
 }
 
+// Fill buf with n random bytes.  This polls the data register directly
+// rather than going through HAL_RNG_GetRandomNumber for each word, and uses
+// all 4 bytes of every word; a new word is ready every 40 RNG clocks.
+void rng_get_bytes(uint8_t *buf, size_t n) {
+    if (RNGHandle.State == HAL_RNG_STATE_RESET) {
+        rng_init();
+    }
+    while (n > 0) {
+        uint32_t sr;
+        while (!((sr = RNG->SR) & RNG_SR_DRDY)) {
+            if (sr & (RNG_SR_SEIS | RNG_SR_CEIS)) {
+                // a seed or clock error; clear it and let the RNG recover
+                RNG->SR = 0;
+            }
+        }
+        uint32_t val = RNG->DR;
+        size_t chunk = n < 4 ? n : 4;
+        memcpy(buf, &val, chunk);
+        buf += chunk;
+        n -= chunk;
+    }
+}
+
 /// \function rng()
 /// Return a 30-bit hardware generated random number.
 STATIC mp_obj_t pyb_rng_get(void) {
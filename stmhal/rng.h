@@ -26,5 +26,6 @@
 
 void rng_init0(void);
 uint32_t rng_get(void);
+void rng_get_bytes(uint8_t *buf, size_t n);
 
 MP_DECLARE_CONST_FUN_OBJ(pyb_rng_get_obj);
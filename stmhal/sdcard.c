@@ -24,8 +24,7 @@
  * THE SOFTWARE.
  */
 
-// TODO make it work with DMA
-
+#include <string.h>
 #include <stm32f4xx_hal.h>
 
 #include "py/nlr.h"
@@ -34,11 +33,19 @@
 #include "pin.h"
 #include "genhdr/pins.h"
 #include "bufhelper.h"
+#include "irq.h"
 
 #if MICROPY_HW_HAS_SDCARD
 
 static SD_HandleTypeDef sd_handle;
 
+// DMA2_Stream3 channel 4 serves the SDIO in both directions; it is
+// reconfigured for the direction of each transfer
+static DMA_HandleTypeDef sd_dma;
+
+// word-aligned block for transfers to/from buffers the DMA can't use
+static uint32_t sd_bounce_buf[SDCARD_BLOCK_SIZE / 4];
+
 void sdcard_init(void) {
     GPIO_InitTypeDef GPIO_Init_Structure;
 
@@ -72,14 +79,28 @@ void HAL_SD_MspInit(SD_HandleTypeDef *hsd) {
 
     // GPIO have already been initialised by sdcard_init
 
-    // interrupts are not used at the moment
-    // they are needed only for DMA transfer (I think...)
+    // SDIO and DMA interrupts must be able to preempt the USB IRQ because
+    // the MSC class reads and writes blocks from within that IRQ
+    HAL_NVIC_SetPriority(SDIO_IRQn, 4, 0);
+    HAL_NVIC_EnableIRQ(SDIO_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 4, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
 }
 
 void HAL_SD_MspDeInit(SD_HandleTypeDef *hsd) {
+    HAL_NVIC_DisableIRQ(SDIO_IRQn);
+    HAL_NVIC_DisableIRQ(DMA2_Stream3_IRQn);
     __SDIO_CLK_DISABLE();
 }
 
+void SDIO_IRQHandler(void) {
+    HAL_SD_IRQHandler(&sd_handle);
+}
+
+void DMA2_Stream3_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&sd_dma);
+}
+
 bool sdcard_is_present(void) {
     return HAL_GPIO_ReadPin(MICROPY_HW_SDCARD_DETECT_PIN.gpio, MICROPY_HW_SDCARD_DETECT_PIN.pin_mask) == MICROPY_HW_SDCARD_DETECT_PRESENT;
 }
@@ -140,101 +161,127 @@ uint64_t sdcard_get_capacity_in_bytes(void) {
     return cardinfo.CardCapacity;
 }
 
-mp_uint_t sdcard_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
-    // check that dest pointer is aligned on a 4-byte boundary
-    if (((uint32_t)dest & 3) != 0) {
-        return SD_ERROR;
-    }
-
-    // check that SD card is initialised
-    if (sd_handle.Instance == NULL) {
-        return SD_ERROR;
-    }
-
-    // We must disable IRQs because the SDIO peripheral has a small FIFO
-    // buffer and we can't let it fill up in the middle of a read.
-    // This will not be needed when SD uses DMA for transfer.
-    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
-    HAL_SD_ErrorTypedef err = HAL_SD_ReadBlocks_BlockNumber(&sd_handle, (uint32_t*)dest, block_num, SDCARD_BLOCK_SIZE, num_blocks);
-    MICROPY_END_ATOMIC_SECTION(atomic_state);
-
-    return err;
+STATIC void sdcard_dma_init(uint32_t direction) {
+    __DMA2_CLK_ENABLE();
+
+    memset(&sd_dma, 0, sizeof(sd_dma));
+    sd_dma.Instance = DMA2_Stream3;
+    sd_dma.Init.Channel = DMA_CHANNEL_4;
+    sd_dma.Init.Direction = direction;
+    sd_dma.Init.PeriphInc = DMA_PINC_DISABLE;
+    sd_dma.Init.MemInc = DMA_MINC_ENABLE;
+    sd_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    sd_dma.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    sd_dma.Init.Mode = DMA_PFCTRL; // the SDIO controls the transfer length
+    sd_dma.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    sd_dma.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+    sd_dma.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    sd_dma.Init.MemBurst = DMA_MBURST_INC4;
+    sd_dma.Init.PeriphBurst = DMA_PBURST_INC4;
+
+    HAL_DMA_DeInit(&sd_dma);
+    HAL_DMA_Init(&sd_dma);
+
+    __HAL_LINKDMA(&sd_handle, hdmarx, sd_dma);
+    __HAL_LINKDMA(&sd_handle, hdmatx, sd_dma);
 }
 
-mp_uint_t sdcard_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
-    // check that src pointer is aligned on a 4-byte boundary
-    if (((uint32_t)src & 3) != 0) {
-        return SD_ERROR;
+// the DMA can only access word-aligned buffers outside of CCM
+STATIC bool sdcard_dma_capable(const void *buf) {
+    if (((uint32_t)buf & 3) != 0) {
+        return false;
     }
-
-    // check that SD card is initialised
-    if (sd_handle.Instance == NULL) {
-        return SD_ERROR;
+    #if defined(CCMDATARAM_BASE)
+    if ((uint32_t)buf >= CCMDATARAM_BASE && (uint32_t)buf < CCMDATARAM_BASE + 0x10000) {
+        return false;
     }
+    #endif
+    return true;
+}
 
-    // We must disable IRQs because the SDIO peripheral has a small FIFO
-    // buffer and we can't let it drain to empty in the middle of a write.
-    // This will not be needed when SD uses DMA for transfer.
-    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
-    HAL_SD_ErrorTypedef err = HAL_SD_WriteBlocks_BlockNumber(&sd_handle, (uint32_t*)src, block_num, SDCARD_BLOCK_SIZE, num_blocks);
-    MICROPY_END_ATOMIC_SECTION(atomic_state);
-
+// transfer to/from a DMA-capable buffer
+STATIC HAL_SD_ErrorTypedef sdcard_read_blocks_raw(uint32_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    HAL_SD_ErrorTypedef err;
+    if (query_irq() == IRQ_STATE_ENABLED) {
+        sdcard_dma_init(DMA_PERIPH_TO_MEMORY);
+        err = HAL_SD_ReadBlocks_BlockNumber_DMA(&sd_handle, dest, block_num, SDCARD_BLOCK_SIZE, num_blocks);
+        if (err == SD_OK) {
+            // wait for DMA transfer to finish, with a large timeout
+            err = HAL_SD_CheckReadOperation(&sd_handle, 100000000);
+        }
+        if (err != SD_OK) {
+            HAL_DMA_Abort(&sd_dma);
+        }
+    } else {
+        // IRQs are disabled so the DMA completion can't be signalled; poll
+        // instead.  The SDIO peripheral has a small FIFO buffer and we
+        // can't let it fill up in the middle of a read.
+        err = HAL_SD_ReadBlocks_BlockNumber(&sd_handle, dest, block_num, SDCARD_BLOCK_SIZE, num_blocks);
+    }
     return err;
 }
 
-#if 0
-DMA not implemented
-bool sdcard_read_blocks_dma(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
-    // check that dest pointer is aligned on a 4-byte boundary
-    if (((uint32_t)dest & 3) != 0) {
-        return false;
+STATIC HAL_SD_ErrorTypedef sdcard_write_blocks_raw(const uint32_t *src, uint32_t block_num, uint32_t num_blocks) {
+    HAL_SD_ErrorTypedef err;
+    if (query_irq() == IRQ_STATE_ENABLED) {
+        sdcard_dma_init(DMA_MEMORY_TO_PERIPH);
+        err = HAL_SD_WriteBlocks_BlockNumber_DMA(&sd_handle, (uint32_t*)src, block_num, SDCARD_BLOCK_SIZE, num_blocks);
+        if (err == SD_OK) {
+            // wait for DMA transfer to finish, with a large timeout
+            err = HAL_SD_CheckWriteOperation(&sd_handle, 100000000);
+        }
+        if (err != SD_OK) {
+            HAL_DMA_Abort(&sd_dma);
+        }
+    } else {
+        // IRQs are disabled so poll; the SDIO FIFO must not drain to empty
+        // in the middle of a write.
+        err = HAL_SD_WriteBlocks_BlockNumber(&sd_handle, (uint32_t*)src, block_num, SDCARD_BLOCK_SIZE, num_blocks);
     }
+    return err;
+}
 
+mp_uint_t sdcard_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
     // check that SD card is initialised
     if (sd_handle.Instance == NULL) {
-        return false;
+        return SD_ERROR;
     }
 
-    // do the read
-    if (HAL_SD_ReadBlocks_BlockNumber_DMA(&sd_handle, (uint32_t*)dest, block_num, SDCARD_BLOCK_SIZE) != SD_OK) {
-        return false;
+    if (sdcard_dma_capable(dest)) {
+        return sdcard_read_blocks_raw((uint32_t*)dest, block_num, num_blocks);
     }
 
-    // wait for DMA transfer to finish, with a large timeout
-    if (HAL_SD_CheckReadOperation(&sd_handle, 100000000) != SD_OK) {
-        return false;
+    // go through the bounce buffer one block at a time
+    for (; num_blocks > 0; --num_blocks, ++block_num, dest += SDCARD_BLOCK_SIZE) {
+        HAL_SD_ErrorTypedef err = sdcard_read_blocks_raw(sd_bounce_buf, block_num, 1);
+        if (err != SD_OK) {
+            return err;
+        }
+        memcpy(dest, sd_bounce_buf, SDCARD_BLOCK_SIZE);
     }
-
-    return true;
+    return SD_OK;
 }
 
-bool sdcard_write_blocks_dma(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
-    // check that src pointer is aligned on a 4-byte boundary
-    if (((uint32_t)src & 3) != 0) {
-        return false;
-    }
-
+mp_uint_t sdcard_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
     // check that SD card is initialised
     if (sd_handle.Instance == NULL) {
-        return false;
+        return SD_ERROR;
     }
 
-    SD_Error status;
-
-    status = HAL_SD_WriteBlocks_BlockNumber_DMA(&sd_handle, (uint32_t*)src, block_num, SDCARD_BLOCK_SIZE, num_blocks);
-    if (status != SD_OK) {
-        return false;
+    if (sdcard_dma_capable(src)) {
+        return sdcard_write_blocks_raw((const uint32_t*)src, block_num, num_blocks);
     }
 
-    // wait for DMA transfer to finish, with a large timeout
-    status = HAL_SD_CheckWriteOperation(&sd_handle, 100000000);
-    if (status != SD_OK) {
-        return false;
+    // go through the bounce buffer one block at a time
+    for (; num_blocks > 0; --num_blocks, ++block_num, src += SDCARD_BLOCK_SIZE) {
+        memcpy(sd_bounce_buf, src, SDCARD_BLOCK_SIZE);
+        HAL_SD_ErrorTypedef err = sdcard_write_blocks_raw(sd_bounce_buf, block_num, 1);
+        if (err != SD_OK) {
+            return err;
+        }
     }
-
-    return true;
+    return SD_OK;
 }
-#endif
 
 /******************************************************************************/
 // Micro Python bindings
@@ -29,6 +29,7 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 #include "irq.h"
 #include "pin.h"
 #include "genhdr/pins.h"
@@ -140,6 +141,9 @@ void spi_init0(void) {
     memset(&SPIHandle3, 0, sizeof(SPI_HandleTypeDef));
     SPIHandle3.Instance = SPI3;
 #endif
+    // forget any non-blocking transfers
+    memset(MP_STATE_PORT(pyb_spi_callback), 0, sizeof(MP_STATE_PORT(pyb_spi_callback)));
+    memset(MP_STATE_PORT(pyb_spi_nb_buf), 0, sizeof(MP_STATE_PORT(pyb_spi_nb_buf)));
 }
 
 // TODO allow to take a list of pins to use
@@ -300,6 +304,51 @@ STATIC HAL_StatusTypeDef spi_wait_dma_finished(SPI_HandleTypeDef *spi, uint32_t
     return HAL_OK;
 }
 
+// Transfers shorter than this aren't worth setting up the DMA for.
+#define SPI_TRANSFER_DMA_MIN (16)
+
+// the DMA can't access CCM
+STATIC bool spi_dma_capable(const void *buf) {
+    #if defined(CCMDATARAM_BASE)
+    if ((uint32_t)buf >= CCMDATARAM_BASE && (uint32_t)buf < CCMDATARAM_BASE + 0x10000) {
+        return false;
+    }
+    #endif
+    return true;
+}
+
+// A blocking transfer for drivers that use an SPI bus directly.  src or dest
+// may be NULL for a receive-only or send-only transfer.  Long transfers go by
+// DMA, sleeping until it's done, when IRQs are enabled.
+HAL_StatusTypeDef spi_transfer(SPI_HandleTypeDef *spi, size_t len, const uint8_t *src, uint8_t *dest, uint32_t timeout) {
+    bool use_dma = len >= SPI_TRANSFER_DMA_MIN && query_irq() == IRQ_STATE_ENABLED
+        && (src == NULL || spi_dma_capable(src)) && (dest == NULL || spi_dma_capable(dest));
+    HAL_StatusTypeDef status;
+    if (dest == NULL) {
+        if (use_dma) {
+            status = HAL_SPI_Transmit_DMA(spi, (uint8_t*)src, len);
+        } else {
+            status = HAL_SPI_Transmit(spi, (uint8_t*)src, len, timeout);
+        }
+    } else if (src == NULL) {
+        if (use_dma) {
+            status = HAL_SPI_Receive_DMA(spi, dest, len);
+        } else {
+            status = HAL_SPI_Receive(spi, dest, len, timeout);
+        }
+    } else {
+        if (use_dma) {
+            status = HAL_SPI_TransmitReceive_DMA(spi, (uint8_t*)src, dest, len);
+        } else {
+            status = HAL_SPI_TransmitReceive(spi, (uint8_t*)src, dest, len, timeout);
+        }
+    }
+    if (use_dma && status == HAL_OK) {
+        status = spi_wait_dma_finished(spi, timeout);
+    }
+    return status;
+}
+
 /******************************************************************************/
 /* Micro Python bindings                                                      */
 
@@ -335,6 +384,82 @@ SPI_HandleTypeDef *spi_get_handle(mp_obj_t o) {
     return self->spi;
 }
 
+// A non-blocking transfer starts the DMA and returns straight away.  The
+// objects it uses are stored in root pointers so the GC won't reclaim them
+// while the DMA is running, and the callback is called from the DMA IRQ when
+// the transfer is complete.  Returns false if the transfer should block.
+STATIC bool spi_nb_begin(const pyb_spi_obj_t *self, mp_obj_t callback, mp_obj_t send, mp_obj_t recv) {
+    if (callback == mp_const_none) {
+        return false;
+    }
+    if (!mp_obj_is_callable(callback)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "callback must be None or a callable object"));
+    }
+    if (send != MP_OBJ_NULL && MP_OBJ_IS_INT(send)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "non-blocking send needs a buffer"));
+    }
+    if (query_irq() == IRQ_STATE_DISABLED) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "non-blocking transfer needs IRQs enabled"));
+    }
+    if (HAL_SPI_GetState(self->spi) != HAL_SPI_STATE_READY) {
+        mp_hal_raise(HAL_BUSY);
+    }
+    mp_uint_t i = self - &pyb_spi_obj[0];
+    MP_STATE_PORT(pyb_spi_nb_buf)[i][0] = send;
+    MP_STATE_PORT(pyb_spi_nb_buf)[i][1] = recv;
+    MP_STATE_PORT(pyb_spi_callback)[i] = callback;
+    return true;
+}
+
+STATIC void spi_nb_end(const pyb_spi_obj_t *self) {
+    mp_uint_t i = self - &pyb_spi_obj[0];
+    MP_STATE_PORT(pyb_spi_nb_buf)[i][0] = MP_OBJ_NULL;
+    MP_STATE_PORT(pyb_spi_nb_buf)[i][1] = MP_OBJ_NULL;
+    MP_STATE_PORT(pyb_spi_callback)[i] = MP_OBJ_NULL;
+}
+
+// called from the DMA IRQ when a transfer is complete or has failed
+STATIC void spi_nb_done(SPI_HandleTypeDef *spi) {
+    for (mp_uint_t i = 0; i < PYB_NUM_SPI; i++) {
+        const pyb_spi_obj_t *self = &pyb_spi_obj[i];
+        if (self->spi != spi) {
+            continue;
+        }
+        mp_obj_t callback = MP_STATE_PORT(pyb_spi_callback)[i];
+        spi_nb_end(self);
+        if (callback != MP_OBJ_NULL) {
+            // When executing code within a handler we must lock the GC to prevent
+            // any memory allocations.  We must also catch any exceptions.
+            gc_lock();
+            nlr_buf_t nlr;
+            if (nlr_push(&nlr) == 0) {
+                mp_call_function_1(callback, (mp_obj_t)self);
+                nlr_pop();
+            } else {
+                printf("Uncaught exception in SPI(%u) callback\n", (uint)i + 1);
+                mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+            }
+            gc_unlock();
+        }
+    }
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_nb_done(hspi);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_nb_done(hspi);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_nb_done(hspi);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    spi_nb_done(hspi);
+}
+
 STATIC void pyb_spi_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     pyb_spi_obj_t *self = self_in;
 
@@ -497,19 +622,23 @@ STATIC mp_obj_t pyb_spi_deinit(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_spi_deinit_obj, pyb_spi_deinit);
 
-/// \method send(send, *, timeout=5000)
+/// \method send(send, *, timeout=5000, callback=None)
 /// Send data on the bus:
 ///
 ///   - `send` is the data to send (an integer to send, or a buffer object).
 ///   - `timeout` is the timeout in milliseconds to wait for the send.
+///   - `callback`, if given, makes the send non-blocking: the DMA transfer is
+///     started and this method returns immediately.  `callback(spi)` is called
+///     from the IRQ when the transfer is done.  `send` must be a buffer.
 ///
 /// Return value: `None`.
 STATIC mp_obj_t pyb_spi_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     // TODO assumes transmission size is 8-bits wide
 
     static const mp_arg_t allowed_args[] = {
-        { MP_QSTR_send,    MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_send,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
     };
 
     // parse args
@@ -521,6 +650,7 @@ STATIC mp_obj_t pyb_spi_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     mp_buffer_info_t bufinfo;
     uint8_t data[1];
     pyb_buf_get_for_send(args[0].u_obj, &bufinfo, data);
+    bool nb = spi_nb_begin(self, args[2].u_obj, args[0].u_obj, MP_OBJ_NULL);
 
     // send the data
     HAL_StatusTypeDef status;
@@ -528,12 +658,15 @@ STATIC mp_obj_t pyb_spi_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
         status = HAL_SPI_Transmit(self->spi, bufinfo.buf, bufinfo.len, args[1].u_int);
     } else {
         status = HAL_SPI_Transmit_DMA(self->spi, bufinfo.buf, bufinfo.len);
-        if (status == HAL_OK) {
+        if (status == HAL_OK && !nb) {
             status = spi_wait_dma_finished(self->spi, args[1].u_int);
         }
     }
 
     if (status != HAL_OK) {
+        if (nb) {
+            spi_nb_end(self);
+        }
         mp_hal_raise(status);
     }
 
@@ -541,22 +674,25 @@ STATIC mp_obj_t pyb_spi_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_send_obj, 1, pyb_spi_send);
 
-/// \method recv(recv, *, timeout=5000)
+/// \method recv(recv, *, timeout=5000, callback=None)
 ///
 /// Receive data on the bus:
 ///
 ///   - `recv` can be an integer, which is the number of bytes to receive,
 ///     or a mutable buffer, which will be filled with received bytes.
 ///   - `timeout` is the timeout in milliseconds to wait for the receive.
+///   - `callback`, if given, makes the receive non-blocking, as for `send`.
 ///
 /// Return value: if `recv` is an integer then a new buffer of the bytes received,
-/// otherwise the same buffer that was passed in to `recv`.
+/// otherwise the same buffer that was passed in to `recv`.  For a non-blocking
+/// receive the new buffer is a bytearray, which is filled in by the DMA.
 STATIC mp_obj_t pyb_spi_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     // TODO assumes transmission size is 8-bits wide
 
     static const mp_arg_t allowed_args[] = {
-        { MP_QSTR_recv,    MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_recv,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
     };
 
     // parse args
@@ -567,6 +703,11 @@ STATIC mp_obj_t pyb_spi_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     // get the buffer to receive into
     vstr_t vstr;
     mp_obj_t o_ret = pyb_buf_get_for_recv(args[0].u_obj, &vstr);
+    if (args[2].u_obj != mp_const_none && o_ret == MP_OBJ_NULL) {
+        // the data arrives after we return, so it can't go in an immutable bytes
+        o_ret = mp_obj_new_bytearray_by_ref(vstr.len, vstr.buf);
+    }
+    bool nb = spi_nb_begin(self, args[2].u_obj, MP_OBJ_NULL, o_ret);
 
     // receive the data
     HAL_StatusTypeDef status;
@@ -574,12 +715,15 @@ STATIC mp_obj_t pyb_spi_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
         status = HAL_SPI_Receive(self->spi, (uint8_t*)vstr.buf, vstr.len, args[1].u_int);
     } else {
         status = HAL_SPI_Receive_DMA(self->spi, (uint8_t*)vstr.buf, vstr.len);
-        if (status == HAL_OK) {
+        if (status == HAL_OK && !nb) {
             status = spi_wait_dma_finished(self->spi, args[1].u_int);
         }
     }
 
     if (status != HAL_OK) {
+        if (nb) {
+            spi_nb_end(self);
+        }
         mp_hal_raise(status);
     }
 
@@ -601,15 +745,18 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_recv_obj, 1, pyb_spi_recv);
 ///   It can be the same as `send`, or omitted.  If omitted, a new buffer will
 ///   be created.
 ///   - `timeout` is the timeout in milliseconds to wait for the receive.
+///   - `callback`, if given, makes the transfer non-blocking, as for `send`.
+///     If `recv` is omitted the new buffer is a bytearray filled in by the DMA.
 ///
 /// Return value: the buffer with the received bytes.
 STATIC mp_obj_t pyb_spi_send_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     // TODO assumes transmission size is 8-bits wide
 
     static const mp_arg_t allowed_args[] = {
-        { MP_QSTR_send,    MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_recv,    MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_send,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_recv,     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 5000} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
     };
 
     // parse args
@@ -650,18 +797,27 @@ STATIC mp_obj_t pyb_spi_send_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp
         }
     }
 
+    if (args[3].u_obj != mp_const_none && o_ret == MP_OBJ_NULL) {
+        // the data arrives after we return, so it can't go in an immutable bytes
+        o_ret = mp_obj_new_bytearray_by_ref(vstr_recv.len, vstr_recv.buf);
+    }
+    bool nb = spi_nb_begin(self, args[3].u_obj, args[0].u_obj, o_ret);
+
     // send and receive the data
     HAL_StatusTypeDef status;
     if (query_irq() == IRQ_STATE_DISABLED) {
         status = HAL_SPI_TransmitReceive(self->spi, bufinfo_send.buf, bufinfo_recv.buf, bufinfo_send.len, args[2].u_int);
     } else {
         status = HAL_SPI_TransmitReceive_DMA(self->spi, bufinfo_send.buf, bufinfo_recv.buf, bufinfo_send.len);
-        if (status == HAL_OK) {
+        if (status == HAL_OK && !nb) {
             status = spi_wait_dma_finished(self->spi, args[2].u_int);
         }
     }
 
     if (status != HAL_OK) {
+        if (nb) {
+            spi_nb_end(self);
+        }
         mp_hal_raise(status);
     }
 
@@ -674,6 +830,28 @@ STATIC mp_obj_t pyb_spi_send_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_send_recv_obj, 1, pyb_spi_send_recv);
 
+/// \method busy()
+/// Return `True` if a non-blocking transfer is still in progress.
+STATIC mp_obj_t pyb_spi_busy(mp_obj_t self_in) {
+    pyb_spi_obj_t *self = self_in;
+    return MP_BOOL(HAL_SPI_GetState(self->spi) != HAL_SPI_STATE_READY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_spi_busy_obj, pyb_spi_busy);
+
+/// \method wait(timeout=5000)
+/// Wait for a non-blocking transfer to finish, raising `OSError` if it
+/// doesn't finish within `timeout` milliseconds.
+STATIC mp_obj_t pyb_spi_wait(mp_uint_t n_args, const mp_obj_t *args) {
+    pyb_spi_obj_t *self = args[0];
+    uint32_t timeout = n_args > 1 ? mp_obj_get_int(args[1]) : 5000;
+    HAL_StatusTypeDef status = spi_wait_dma_finished(self->spi, timeout);
+    if (status != HAL_OK) {
+        mp_hal_raise(status);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_spi_wait_obj, 1, 2, pyb_spi_wait);
+
 STATIC const mp_map_elem_t pyb_spi_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_init), (mp_obj_t)&pyb_spi_init_obj },
@@ -681,6 +859,8 @@ STATIC const mp_map_elem_t pyb_spi_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_send), (mp_obj_t)&pyb_spi_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv), (mp_obj_t)&pyb_spi_recv_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_send_recv), (mp_obj_t)&pyb_spi_send_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_busy), (mp_obj_t)&pyb_spi_busy_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wait), (mp_obj_t)&pyb_spi_wait_obj },
 
     // class constants
     /// \constant MASTER - for initialising the bus to master mode
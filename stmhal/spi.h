@@ -32,3 +32,4 @@ extern const mp_obj_type_t pyb_spi_type;
 void spi_init0(void);
 void spi_init(SPI_HandleTypeDef *spi, bool enable_nss_pin);
 SPI_HandleTypeDef *spi_get_handle(mp_obj_t o);
+HAL_StatusTypeDef spi_transfer(SPI_HandleTypeDef *spi, size_t len, const uint8_t *src, uint8_t *dest, uint32_t timeout);
@@ -71,6 +71,7 @@
 #include "stm32f4xx_hal.h"
 
 #include "py/obj.h"
+#include MICROPY_HAL_H
 #include "pendsv.h"
 #include "extint.h"
 #include "timer.h"
@@ -182,6 +183,10 @@ void SysTick_Handler(void) {
     // the COUNTFLAG bit, which makes the logic in sys_tick_get_microseconds
     // work properly.
     SysTick->CTRL;
+
+    #if MICROPY_VM_SAMPLE_PROFILE
+    mp_hal_sample_systick();
+    #endif
 }
 
 /******************************************************************************/
@@ -55,16 +55,34 @@ STATIC byte flash_cache_mem[0x4000] __attribute__((aligned(4))); // 16k
 #error "no storage support for this MCU"
 #endif
 
+// The cache memory is split into units of the smallest sector size and can
+// hold several whole sectors at once.  This lets writes alternate between,
+// eg, the FAT in sector 1 and data in sector 2 without an erase/program cycle
+// each time they cross a sector boundary.  Dirty sectors are written back
+// together when the cache is flushed or has been idle for a while, and a
+// sector is only evicted when a new one doesn't fit.
+#define FLASH_CACHE_UNIT_SIZE (0x4000)
+#define FLASH_CACHE_NUM_UNITS (FLASH_SECTOR_SIZE_MAX / FLASH_CACHE_UNIT_SIZE)
+
+typedef struct _flash_cache_entry_t {
+    uint32_t sector_id; // 0 if entry is unused (sector 0 is never cached)
+    uint32_t sector_start;
+    uint32_t sector_size;
+    uint32_t last_use;
+    uint16_t unit; // first cache unit occupied by this sector
+    volatile uint16_t dirty;
+} flash_cache_entry_t;
+
 #define FLASH_FLAG_DIRTY        (1)
 #define FLASH_FLAG_FORCE_WRITE  (2)
-#define FLASH_FLAG_ERASED       (4)
 static bool flash_is_initialised = false;
 static __IO uint8_t flash_flags = 0;
-static uint32_t flash_cache_sector_id;
-static uint32_t flash_cache_sector_start;
-static uint32_t flash_cache_sector_size;
+static flash_cache_entry_t flash_cache[FLASH_CACHE_NUM_UNITS];
+static uint32_t flash_cache_use_counter;
 static uint32_t flash_tick_counter_last_write;
 
+#define FLASH_CACHE_ADDR(e) ((uint8_t*)CACHE_MEM_START_ADDR + (e)->unit * FLASH_CACHE_UNIT_SIZE)
+
 static void flash_cache_flush(void) {
     if (flash_flags & FLASH_FLAG_DIRTY) {
         flash_flags |= FLASH_FLAG_FORCE_WRITE;
@@ -74,6 +92,94 @@ static void flash_cache_flush(void) {
     }
 }
 
+// write a dirty sector back to flash, called from the flash IRQ
+static void flash_cache_sync(flash_cache_entry_t *e) {
+    const uint32_t *cache = (const uint32_t*)FLASH_CACHE_ADDR(e);
+    const uint32_t *flash = (const uint32_t*)e->sector_start;
+    uint32_t num_word32 = e->sector_size / 4;
+
+    // An erase is only needed if some bit must go from 0 back to 1.  Sectors
+    // that are unchanged are skipped, and those whose changes only clear bits
+    // are programmed in place, which saves erase cycles and time.
+    bool changed = false;
+    bool need_erase = false;
+    for (uint32_t i = 0; i < num_word32; i++) {
+        if (cache[i] != flash[i]) {
+            changed = true;
+            if ((flash[i] & cache[i]) != cache[i]) {
+                need_erase = true;
+                break;
+            }
+        }
+    }
+
+    if (changed) {
+        if (need_erase) {
+            flash_erase(e->sector_start, cache, num_word32);
+        } else {
+            HAL_FLASH_Unlock();
+        }
+        flash_write(e->sector_start, cache, num_word32);
+    }
+}
+
+static flash_cache_entry_t *flash_cache_find(uint32_t flash_sector_id) {
+    for (int i = 0; i < FLASH_CACHE_NUM_UNITS; i++) {
+        if (flash_cache[i].sector_id == flash_sector_id) {
+            return &flash_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// find a run of free cache units, returning the first one or -1 if none
+static int flash_cache_find_units(uint32_t num_units) {
+    uint32_t used = 0;
+    for (int i = 0; i < FLASH_CACHE_NUM_UNITS; i++) {
+        flash_cache_entry_t *e = &flash_cache[i];
+        if (e->sector_id != 0) {
+            used |= ((1 << ((e->sector_size + FLASH_CACHE_UNIT_SIZE - 1) / FLASH_CACHE_UNIT_SIZE)) - 1) << e->unit;
+        }
+    }
+    uint32_t mask = (1 << num_units) - 1;
+    for (int unit = 0; unit + num_units <= FLASH_CACHE_NUM_UNITS; unit++) {
+        if ((used & (mask << unit)) == 0) {
+            return unit;
+        }
+    }
+    return -1;
+}
+
+static flash_cache_entry_t *flash_cache_load(uint32_t flash_sector_id, uint32_t flash_sector_start, uint32_t flash_sector_size) {
+    uint32_t num_units = (flash_sector_size + FLASH_CACHE_UNIT_SIZE - 1) / FLASH_CACHE_UNIT_SIZE;
+    int unit = flash_cache_find_units(num_units);
+    if (unit < 0) {
+        // no room: write back all dirty sectors and evict the least recently
+        // used ones until the new sector fits
+        flash_cache_flush();
+        while ((unit = flash_cache_find_units(num_units)) < 0) {
+            flash_cache_entry_t *lru = NULL;
+            for (int i = 0; i < FLASH_CACHE_NUM_UNITS; i++) {
+                flash_cache_entry_t *e = &flash_cache[i];
+                if (e->sector_id != 0 && (lru == NULL || e->last_use < lru->last_use)) {
+                    lru = e;
+                }
+            }
+            lru->sector_id = 0;
+        }
+    }
+
+    // take a free entry
+    flash_cache_entry_t *e = flash_cache_find(0);
+    memcpy((uint8_t*)CACHE_MEM_START_ADDR + unit * FLASH_CACHE_UNIT_SIZE, (const void*)flash_sector_start, flash_sector_size);
+    e->sector_start = flash_sector_start;
+    e->sector_size = flash_sector_size;
+    e->unit = unit;
+    e->dirty = 0;
+    e->sector_id = flash_sector_id;
+    return e;
+}
+
 static uint8_t *flash_cache_get_addr_for_write(uint32_t flash_addr) {
     uint32_t flash_sector_start;
     uint32_t flash_sector_size;
@@ -81,26 +187,25 @@ static uint8_t *flash_cache_get_addr_for_write(uint32_t flash_addr) {
     if (flash_sector_size > FLASH_SECTOR_SIZE_MAX) {
         flash_sector_size = FLASH_SECTOR_SIZE_MAX;
     }
-    if (flash_cache_sector_id != flash_sector_id) {
-        flash_cache_flush();
-        memcpy((void*)CACHE_MEM_START_ADDR, (const void*)flash_sector_start, flash_sector_size);
-        flash_cache_sector_id = flash_sector_id;
-        flash_cache_sector_start = flash_sector_start;
-        flash_cache_sector_size = flash_sector_size;
+    flash_cache_entry_t *e = flash_cache_find(flash_sector_id);
+    if (e == NULL) {
+        e = flash_cache_load(flash_sector_id, flash_sector_start, flash_sector_size);
     }
+    e->last_use = ++flash_cache_use_counter;
+    e->dirty = 1;
     flash_flags |= FLASH_FLAG_DIRTY;
     led_state(PYB_LED_R1, 1); // indicate a dirty cache with LED on
     flash_tick_counter_last_write = HAL_GetTick();
-    return (uint8_t*)CACHE_MEM_START_ADDR + flash_addr - flash_sector_start;
+    return FLASH_CACHE_ADDR(e) + flash_addr - flash_sector_start;
 }
 
 static uint8_t *flash_cache_get_addr_for_read(uint32_t flash_addr) {
     uint32_t flash_sector_start;
-    uint32_t flash_sector_size;
-    uint32_t flash_sector_id = flash_get_sector_info(flash_addr, &flash_sector_start, &flash_sector_size);
-    if (flash_cache_sector_id == flash_sector_id) {
+    uint32_t flash_sector_id = flash_get_sector_info(flash_addr, &flash_sector_start, NULL);
+    flash_cache_entry_t *e = flash_cache_find(flash_sector_id);
+    if (e != NULL) {
         // in cache, copy from there
-        return (uint8_t*)CACHE_MEM_START_ADDR + flash_addr - flash_sector_start;
+        return FLASH_CACHE_ADDR(e) + flash_addr - flash_sector_start;
     }
     // not in cache, copy straight from flash
     return (uint8_t*)flash_addr;
@@ -109,7 +214,8 @@ static uint8_t *flash_cache_get_addr_for_read(uint32_t flash_addr) {
 void storage_init(void) {
     if (!flash_is_initialised) {
         flash_flags = 0;
-        flash_cache_sector_id = 0;
+        memset(flash_cache, 0, sizeof(flash_cache));
+        flash_cache_use_counter = 0;
         flash_tick_counter_last_write = 0;
         flash_is_initialised = true;
     }
@@ -134,37 +240,17 @@ void storage_irq_handler(void) {
         return;
     }
 
-    // This code uses interrupts to erase the flash
-    /*
-    if (flash_erase_state == 0) {
-        flash_erase_it(flash_cache_sector_start, (const uint32_t*)CACHE_MEM_START_ADDR, flash_cache_sector_size / 4);
-        flash_erase_state = 1;
-        return;
-    }
-
-    if (flash_erase_state == 1) {
-        // wait for erase
-        // TODO add timeout
-        #define flash_erase_done() (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) == RESET)
-        if (!flash_erase_done()) {
-            return;
-        }
-        flash_erase_state = 2;
-    }
-    */
-
-    // This code erases the flash directly, waiting for it to finish
-    if (!(flash_flags & FLASH_FLAG_ERASED)) {
-        flash_erase(flash_cache_sector_start, (const uint32_t*)CACHE_MEM_START_ADDR, flash_cache_sector_size / 4);
-        flash_flags |= FLASH_FLAG_ERASED;
-        return;
-    }
-
     // If not a forced write, wait at least 5 seconds after last write to flush
     // On file close and flash unmount we get a forced write, so we can afford to wait a while
     if ((flash_flags & FLASH_FLAG_FORCE_WRITE) || sys_tick_has_passed(flash_tick_counter_last_write, 5000)) {
-        // sync the cache RAM buffer by writing it to the flash page
-        flash_write(flash_cache_sector_start, (const uint32_t*)CACHE_MEM_START_ADDR, flash_cache_sector_size / 4);
+        // sync the dirty cache sectors to flash
+        for (int i = 0; i < FLASH_CACHE_NUM_UNITS; i++) {
+            flash_cache_entry_t *e = &flash_cache[i];
+            if (e->sector_id != 0 && e->dirty) {
+                e->dirty = 0;
+                flash_cache_sync(e);
+            }
+        }
         // clear the flash flags now that we have a clean cache
         flash_flags = 0;
         // indicate a clean cache with LED off
@@ -26,21 +26,89 @@
 
 #include <stm32f4xx_hal.h>
 
+#include "py/mpconfig.h"
+#include "py/misc.h"
 #include "py/obj.h"
 #include "irq.h"
 #include "systick.h"
 
-// We provide our own version of HAL_Delay that calls __WFI while waiting, in
+extern __IO uint32_t uwTick;
+
+// Sleep until an interrupt is pending, or for at most ms milliseconds.  This
+// must be called with IRQs disabled; WFI still wakes on a pending IRQ, which
+// is then serviced when the caller enables IRQs again.
+//
+// For sleeps longer than a tick the SysTick period is stretched to cover the
+// whole sleep (up to about 100ms at 168MHz, the limit of its 24-bit counter),
+// so an idle CPU isn't woken every millisecond.  On wakeup uwTick is advanced
+// by the ticks that passed and SysTick goes back to its 1ms period, in phase
+// with where it would have been.
+void sys_tick_sleep(uint32_t ms) {
+    uint32_t t = SysTick->LOAD + 1; // counts per tick
+    uint32_t n = MIN(ms, SysTick_LOAD_RELOAD_Msk / t);
+    if (n < 2) {
+        __WFI();
+        return;
+    }
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        // a tick is already due; handle it normally
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return;
+    }
+
+    // stretch the current tick so the next SysTick IRQ comes n ticks from now
+    uint32_t val = SysTick->VAL;
+    uint32_t load = val + (n - 1) * t;
+    SysTick->LOAD = load;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    __WFI();
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t now = SysTick->VAL;
+    uint32_t remain;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        // the whole sleep passed; the pending SysTick IRQ counts its last tick
+        // and the counter has been running since it reloaded
+        uint32_t since = load - now;
+        uwTick += n - 1 + since / t;
+        remain = t - since % t;
+    } else {
+        // woken early by another IRQ; count the ticks that passed
+        uint32_t elapsed = load - now;
+        uint32_t k = elapsed >= val ? 1 + (elapsed - val) / t : 0;
+        uwTick += k;
+        remain = val + k * t - elapsed;
+    }
+
+    // run the partial tick up to the next boundary, then back to 1ms; the
+    // counter takes the first reload value before LOAD is rewritten
+    SysTick->LOAD = remain > 1 ? remain - 1 : 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = t - 1;
+}
+
+// We provide our own version of HAL_Delay that sleeps while waiting, in
 // order to reduce power consumption.
 void HAL_Delay(uint32_t Delay) {
     if (query_irq() == IRQ_STATE_ENABLED) {
         // IRQs enabled, so can use systick counter to do the delay
-        extern __IO uint32_t uwTick;
         uint32_t start = uwTick;
-        // Wraparound of tick is taken care of by 2's complement arithmetic.
-        while (uwTick - start < Delay) {
-            // Enter sleep mode, waiting for (at least) the SysTick interrupt.
-            __WFI();
+        for (;;) {
+            // Wraparound of tick is taken care of by 2's complement arithmetic.
+            mp_uint_t irq_state = disable_irq();
+            uint32_t elapsed = uwTick - start;
+            if (elapsed >= Delay) {
+                enable_irq(irq_state);
+                break;
+            }
+            // Enter sleep mode, waiting for an interrupt or the end of the delay.
+            sys_tick_sleep(Delay - elapsed);
+            enable_irq(irq_state);
         }
     } else {
         // IRQs disabled, so need to use a busy loop for the delay.
@@ -77,8 +145,15 @@ bool sys_tick_has_passed(uint32_t start_tick, uint32_t delay_ms) {
 // startTick. Handles overflow properly. Assumes stc was taken from
 // HAL_GetTick() some time before calling this function.
 void sys_tick_wait_at_least(uint32_t start_tick, uint32_t delay_ms) {
-    while (!sys_tick_has_passed(start_tick, delay_ms)) {
-        __WFI(); // enter sleep mode, waiting for interrupt
+    for (;;) {
+        mp_uint_t irq_state = disable_irq();
+        uint32_t elapsed = HAL_GetTick() - start_tick;
+        if (elapsed >= delay_ms) {
+            enable_irq(irq_state);
+            break;
+        }
+        sys_tick_sleep(delay_ms - elapsed); // enter sleep mode, waiting for interrupt
+        enable_irq(irq_state);
     }
 }
 
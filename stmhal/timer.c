@@ -68,6 +68,15 @@
 ///     tim.callback(lambda t: ...)     # set callback for update interrupt (t=tim instance)
 ///     tim.callback(None)              # clear callback
 ///
+/// By default a callback is "hard": it runs in the IRQ handler with the heap
+/// locked, so it must not allocate.  For the most predictable latency make it
+/// a `@micropython.viper` or `@micropython.native` function that works on
+/// preallocated buffers.  With `hard=False` the callback is instead queued
+/// with `micropython.schedule` and run by the VM between bytecodes, where it
+/// may allocate:
+///
+///     tim.callback(lambda t: print(t.counter()), hard=False)
+///
 /// *Note:* Timer 3 is reserved for internal use.  Timer 5 controls
 /// the servo driver, and Timer 6 is used for timed ADC/DAC reading/writing.
 /// It is recommended to use the other timers in your programs.
@@ -124,7 +133,10 @@ typedef struct _pyb_timer_channel_obj_t {
     struct _pyb_timer_obj_t *timer;
     uint8_t channel;
     uint8_t mode;
+    bool callback_soft;
     mp_obj_t callback;
+    mp_obj_t capture_buf;            // kept here so the GC doesn't free it
+    DMA_HandleTypeDef *capture_dma;  // non-NULL while capture_dma is running
     struct _pyb_timer_channel_obj_t *next;
 } pyb_timer_channel_obj_t;
 
@@ -132,6 +144,7 @@ typedef struct _pyb_timer_obj_t {
     mp_obj_base_t base;
     uint8_t tim_id;
     uint8_t is_32bit;
+    bool callback_soft;
     mp_obj_t callback;
     TIM_HandleTypeDef tim;
     IRQn_Type irqn;
@@ -157,6 +170,7 @@ STATIC uint32_t timer_get_source_freq(uint32_t tim_id);
 STATIC mp_obj_t pyb_timer_deinit(mp_obj_t self_in);
 STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback);
 STATIC mp_obj_t pyb_timer_channel_callback(mp_obj_t self_in, mp_obj_t callback);
+STATIC void timer_channel_capture_dma_stop(pyb_timer_channel_obj_t *chan);
 
 void timer_init0(void) {
     tim3_counter = 0;
@@ -305,7 +319,7 @@ STATIC uint32_t compute_prescaler_period_from_freq(pyb_timer_obj_t *self, mp_obj
     uint32_t period;
     if (0) {
     #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (MP_OBJ_IS_TYPE(freq_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(freq_in)) {
         float freq = mp_obj_get_float(freq_in);
         if (freq <= 0) {
             goto bad_freq;
@@ -366,7 +380,7 @@ STATIC uint32_t compute_pwm_value_from_percent(uint32_t period, mp_obj_t percent
     uint32_t cmp;
     if (0) {
     #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (MP_OBJ_IS_TYPE(percent_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(percent_in)) {
         float percent = mp_obj_get_float(percent_in);
         if (percent <= 0.0) {
             cmp = 0;
@@ -714,6 +728,7 @@ STATIC mp_obj_t pyb_timer_deinit(mp_obj_t self_in) {
     // Disable the channel interrupts
     while (chan != NULL) {
         pyb_timer_channel_callback(chan, mp_const_none);
+        timer_channel_capture_dma_stop(chan);
         pyb_timer_channel_obj_t *prev_chan = chan;
         chan = chan->next;
         prev_chan->next = NULL;
@@ -841,8 +856,9 @@ STATIC mp_obj_t pyb_timer_channel(mp_uint_t n_args, const mp_obj_t *pos_args, mp
     // the order we do things here is important so as to appear atomic to
     // the IRQ handler.
     if (chan) {
-        // Turn off any IRQ associated with the channel.
+        // Turn off any IRQ and DMA associated with the channel.
         pyb_timer_channel_callback(chan, mp_const_none);
+        timer_channel_capture_dma_stop(chan);
 
         // Unlink the channel from the list.
         if (prev_chan) {
@@ -1131,10 +1147,6 @@ STATIC mp_obj_t pyb_timer_period(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_timer_period_obj, 1, 2, pyb_timer_period);
 
-/// \method callback(fun)
-/// Set the function to be called when the timer triggers.
-/// `fun` is passed 1 argument, the timer object.
-/// If `fun` is `None` then the callback will be disabled.
 STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback) {
     pyb_timer_obj_t *self = self_in;
     if (callback == mp_const_none) {
@@ -1154,7 +1166,25 @@ STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback) {
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_timer_callback_obj, pyb_timer_callback);
+
+/// \method callback(fun, *, hard=True)
+/// Set the function to be called when the timer triggers.
+/// `fun` is passed 1 argument, the timer object.
+/// If `fun` is `None` then the callback will be disabled.
+/// If `hard` is `False` the callback is scheduled to run outside the IRQ
+/// handler; if the schedule queue is full the event is lost.
+STATIC mp_obj_t pyb_timer_callback_kw(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fun,  MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_hard, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    pyb_timer_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    self->callback_soft = !args[1].u_bool;
+    return pyb_timer_callback(self, args[0].u_obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_timer_callback_obj, 1, pyb_timer_callback_kw);
 
 STATIC const mp_map_elem_t pyb_timer_locals_dict_table[] = {
     // instance methods
@@ -1198,6 +1228,16 @@ const mp_obj_type_t pyb_timer_type = {
     .locals_dict = (mp_obj_t)&pyb_timer_locals_dict,
 };
 
+// Gives other peripherals (eg ADC) access to a Timer object's handle,
+// so they can be triggered by it.
+TIM_HandleTypeDef *pyb_timer_get_handle(mp_obj_t timer) {
+    if (mp_obj_get_type(timer) != &pyb_timer_type) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "need a Timer object"));
+    }
+    pyb_timer_obj_t *self = timer;
+    return &self->tim;
+}
+
 /// \moduleref pyb
 /// \class TimerChannel - setup a channel for a timer.
 ///
@@ -1265,10 +1305,6 @@ STATIC mp_obj_t pyb_timer_channel_pulse_width_percent(mp_uint_t n_args, const mp
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_timer_channel_pulse_width_percent_obj, 1, 2, pyb_timer_channel_pulse_width_percent);
 
-/// \method callback(fun)
-/// Set the function to be called when the timer channel triggers.
-/// `fun` is passed 1 argument, the timer object.
-/// If `fun` is `None` then the callback will be disabled.
 STATIC mp_obj_t pyb_timer_channel_callback(mp_obj_t self_in, mp_obj_t callback) {
     pyb_timer_channel_obj_t *self = self_in;
     if (callback == mp_const_none) {
@@ -1301,7 +1337,146 @@ STATIC mp_obj_t pyb_timer_channel_callback(mp_obj_t self_in, mp_obj_t callback)
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_timer_channel_callback_obj, pyb_timer_channel_callback);
+
+/// \method callback(fun, *, hard=True)
+/// Set the function to be called when the timer channel triggers.
+/// `fun` is passed 1 argument, the timer object.
+/// If `fun` is `None` then the callback will be disabled.
+/// `hard` is as per Timer.callback().
+STATIC mp_obj_t pyb_timer_channel_callback_kw(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fun,  MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_hard, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    pyb_timer_channel_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    self->callback_soft = !args[1].u_bool;
+    return pyb_timer_channel_callback(self, args[0].u_obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_timer_channel_callback_obj, 1, pyb_timer_channel_callback_kw);
+
+// The DMA stream and channel serving the capture/compare request of each timer
+// channel that supports capture_dma.  Some streams are shared with other
+// peripherals (see spi.c, uart.c, dac.c), which can't be using DMA at the
+// same time.
+typedef struct _timer_cc_dma_t {
+    uint8_t tim_id;
+    uint8_t channel;
+    DMA_Stream_TypeDef *stream;
+    uint32_t dma_channel;
+} timer_cc_dma_t;
+
+STATIC const timer_cc_dma_t timer_cc_dma_table[] = {
+    { 1, 1, DMA2_Stream1, DMA_CHANNEL_6 },
+    { 1, 2, DMA2_Stream2, DMA_CHANNEL_6 },
+    { 1, 3, DMA2_Stream6, DMA_CHANNEL_6 },
+    { 1, 4, DMA2_Stream4, DMA_CHANNEL_6 },
+    { 2, 1, DMA1_Stream5, DMA_CHANNEL_3 },
+    { 2, 2, DMA1_Stream6, DMA_CHANNEL_3 },
+    { 2, 3, DMA1_Stream1, DMA_CHANNEL_3 },
+    { 2, 4, DMA1_Stream7, DMA_CHANNEL_3 },
+    { 4, 1, DMA1_Stream0, DMA_CHANNEL_2 },
+    { 4, 2, DMA1_Stream3, DMA_CHANNEL_2 },
+    { 4, 3, DMA1_Stream7, DMA_CHANNEL_2 },
+    { 5, 1, DMA1_Stream2, DMA_CHANNEL_6 },
+    { 5, 2, DMA1_Stream4, DMA_CHANNEL_6 },
+    { 5, 3, DMA1_Stream0, DMA_CHANNEL_6 },
+    { 5, 4, DMA1_Stream1, DMA_CHANNEL_6 },
+};
+
+STATIC void timer_channel_capture_dma_stop(pyb_timer_channel_obj_t *chan) {
+    if (chan->capture_dma != NULL) {
+        __HAL_TIM_DISABLE_DMA(&chan->timer->tim, TIM_DMA_CC1 << (chan->channel - 1));
+        HAL_DMA_Abort(chan->capture_dma);
+        chan->capture_dma = NULL;
+    }
+    chan->capture_buf = MP_OBJ_NULL;
+}
+
+/// \method capture_dma(buf)
+/// Start storing each captured value into `buf` using circular DMA, so that
+/// no code runs per edge.  `buf` must be an `array('I')` (or 'i', 'L', 'l'),
+/// which is used as a ring; see `capture_index`.  If `buf` is `None` then
+/// DMA capture is stopped.  The channel must be in `Timer.IC` mode.
+///
+/// Only some timer channels can do this: 1-4 of timers 1, 2 and 5, and 1-3
+/// of timer 4.  For 16-bit timers the upper half of each value is 0.
+STATIC mp_obj_t pyb_timer_channel_capture_dma(mp_obj_t self_in, mp_obj_t buf_in) {
+    pyb_timer_channel_obj_t *self = self_in;
+    timer_channel_capture_dma_stop(self);
+    if (buf_in == mp_const_none) {
+        return mp_const_none;
+    }
+
+    if (self->mode != CHANNEL_MODE_IC) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "capture_dma needs Timer.IC mode"));
+    }
+    const timer_cc_dma_t *cc_dma = NULL;
+    for (mp_uint_t i = 0; i < MP_ARRAY_SIZE(timer_cc_dma_table); i++) {
+        if (timer_cc_dma_table[i].tim_id == self->timer->tim_id && timer_cc_dma_table[i].channel == self->channel) {
+            cc_dma = &timer_cc_dma_table[i];
+            break;
+        }
+    }
+    if (cc_dma == NULL) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Timer(%u) channel %u has no DMA", self->timer->tim_id, self->channel));
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.typecode == 0 || strchr("IiLl", bufinfo.typecode) == NULL || bufinfo.len < 4 || bufinfo.len / 4 > 0xffff) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buf must be an array('I') of 1-65535 items"));
+    }
+
+    DMA_HandleTypeDef *dma = m_new_obj(DMA_HandleTypeDef);
+    memset(dma, 0, sizeof(*dma));
+    dma->Instance = cc_dma->stream;
+    if ((uint32_t)dma->Instance >= DMA2_BASE) {
+        __DMA2_CLK_ENABLE();
+    } else {
+        __DMA1_CLK_ENABLE();
+    }
+    dma->Init.Channel = cc_dma->dma_channel;
+    dma->Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    dma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    dma->Init.Mode = DMA_CIRCULAR;
+    dma->Init.Priority = DMA_PRIORITY_HIGH;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    dma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    dma->Init.MemBurst = DMA_MBURST_SINGLE;
+    dma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+    HAL_DMA_DeInit(dma);
+    HAL_DMA_Init(dma);
+
+    self->capture_buf = buf_in;
+    self->capture_dma = dma;
+    HAL_DMA_Start(dma, (uint32_t)(&self->timer->tim.Instance->CCR1 + (self->channel - 1)), (uint32_t)bufinfo.buf, bufinfo.len / 4);
+    __HAL_TIM_ENABLE_DMA(&self->timer->tim, TIM_DMA_CC1 << (self->channel - 1));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_timer_channel_capture_dma_obj, pyb_timer_channel_capture_dma);
+
+/// \method capture_index()
+/// Return the index in the `capture_dma` buffer that the next captured value
+/// will be stored at.  The values before it, back to where the caller last
+/// read, are new; if more than the buffer length arrive between reads then
+/// the oldest are overwritten.
+STATIC mp_obj_t pyb_timer_channel_capture_index(mp_obj_t self_in) {
+    pyb_timer_channel_obj_t *self = self_in;
+    if (self->capture_dma == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "capture_dma not running"));
+    }
+    mp_uint_t len = self->capture_dma->Instance->NDTR;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer(self->capture_buf, &bufinfo, MP_BUFFER_READ);
+    mp_uint_t n = bufinfo.len / 4;
+    return MP_OBJ_NEW_SMALL_INT((n - len) % n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_timer_channel_capture_index_obj, pyb_timer_channel_capture_index);
 
 STATIC const mp_map_elem_t pyb_timer_channel_locals_dict_table[] = {
     // instance methods
@@ -1310,6 +1485,8 @@ STATIC const mp_map_elem_t pyb_timer_channel_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_pulse_width_percent), (mp_obj_t)&pyb_timer_channel_pulse_width_percent_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_capture), (mp_obj_t)&pyb_timer_channel_capture_compare_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_compare), (mp_obj_t)&pyb_timer_channel_capture_compare_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_dma), (mp_obj_t)&pyb_timer_channel_capture_dma_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_index), (mp_obj_t)&pyb_timer_channel_capture_index_obj },
 };
 STATIC MP_DEFINE_CONST_DICT(pyb_timer_channel_locals_dict, pyb_timer_channel_locals_dict_table);
 
@@ -1320,7 +1497,7 @@ STATIC const mp_obj_type_t pyb_timer_channel_type = {
     .locals_dict = (mp_obj_t)&pyb_timer_channel_locals_dict,
 };
 
-STATIC void timer_handle_irq_channel(pyb_timer_obj_t *tim, uint8_t channel, mp_obj_t callback) {
+STATIC void timer_handle_irq_channel(pyb_timer_obj_t *tim, uint8_t channel, mp_obj_t callback, bool soft) {
     uint32_t irq_mask = TIMER_IRQ_MASK(channel);
 
     if (__HAL_TIM_GET_FLAG(&tim->tim, irq_mask) != RESET) {
@@ -1329,7 +1506,10 @@ STATIC void timer_handle_irq_channel(pyb_timer_obj_t *tim, uint8_t channel, mp_o
             __HAL_TIM_CLEAR_IT(&tim->tim, irq_mask);
 
             // execute callback if it's set
-            if (callback != mp_const_none) {
+            if (callback != mp_const_none && soft) {
+                // queue it to run outside the IRQ; the event is lost if the queue is full
+                mp_sched_schedule(callback, tim);
+            } else if (callback != mp_const_none) {
                 // When executing code within a handler we must lock the GC to prevent
                 // any memory allocations.  We must also catch any exceptions.
                 gc_lock();
@@ -1367,13 +1547,13 @@ void timer_irq_handler(uint tim_id) {
         }
 
         // Check for timer (versus timer channel) interrupt.
-        timer_handle_irq_channel(tim, 0, tim->callback);
+        timer_handle_irq_channel(tim, 0, tim->callback, tim->callback_soft);
         uint32_t handled = TIMER_IRQ_MASK(0);
 
         // Check to see if a timer channel interrupt was pending
         pyb_timer_channel_obj_t *chan = tim->channel;
         while (chan != NULL) {
-            timer_handle_irq_channel(tim, chan->channel, chan->callback);
+            timer_handle_irq_channel(tim, chan->channel, chan->callback, chan->callback_soft);
             handled |= TIMER_IRQ_MASK(chan->channel);
             chan = chan->next;
         }
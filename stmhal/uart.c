@@ -33,6 +33,7 @@
 #include "py/runtime.h"
 #include "py/stream.h"
 #include "uart.h"
+#include "irq.h"
 #include "pybioctl.h"
 #include MICROPY_HAL_H
 
@@ -70,6 +71,12 @@
 /// To check if there is anything to be read, use:
 ///
 ///     uart.any()               # returns True if any characters waiting
+///
+/// For high baudrates, writes can be buffered and sent from the IRQ, and
+/// reception can be done by DMA straight into the read buffer:
+///
+///     uart.init(921600, write_buf_len=256, read_buf_len=1024, rx_dma=True)
+///     uart.stats()             # see how full the buffers get
 
 #define CHAR_WIDTH_8BIT (0)
 #define CHAR_WIDTH_9BIT (1)
@@ -80,6 +87,7 @@ struct _pyb_uart_obj_t {
     IRQn_Type irqn;
     pyb_uart_t uart_id : 8;
     bool is_enabled : 1;
+    bool rx_dma_enabled : 1;            // read_buf is filled by circular DMA
     byte char_width;                    // 0 for 7,8 bit chars, 1 for 9 bit chars
     uint16_t char_mask;                 // 0x7f for 7 bit, 0xff for 8 bit, 0x1ff for 9 bit
     uint16_t timeout;                   // timeout waiting for first char
@@ -88,6 +96,14 @@ struct _pyb_uart_obj_t {
     volatile uint16_t read_buf_head;    // indexes first empty slot
     uint16_t read_buf_tail;             // indexes first full slot (not full if equals head)
     byte *read_buf;                     // byte or uint16_t, depending on char size
+    uint16_t read_buf_peak;             // most chars seen waiting in read_buf
+    uint16_t write_buf_len;             // len in chars; buf can hold len-1 chars
+    uint16_t write_buf_head;            // indexes first empty slot
+    volatile uint16_t write_buf_tail;   // indexes first full slot (not full if equals head)
+    uint16_t write_buf_peak;            // most chars seen waiting in write_buf
+    byte *write_buf;                    // byte or uint16_t, depending on char size
+    mp_uint_t read_buf_dropped;         // chars lost because read_buf was full
+    DMA_HandleTypeDef rx_dma;
 };
 
 STATIC mp_obj_t pyb_uart_deinit(mp_obj_t self_in);
@@ -237,7 +253,84 @@ bool uart_init(pyb_uart_obj_t *uart_obj, uint32_t baudrate) {
 }
 */
 
+// The DMA stream and channel to receive on for each UART, indexed by uart_id - 1.
+// Some streams are shared with other peripherals, which can't be used at the
+// same time as that UART with rx_dma enabled:
+// UART1_RX: DMA2_Stream5.CHANNEL_4 (also SPI1_TX)
+// UART2_RX: DMA1_Stream5.CHANNEL_4 (also DAC1)
+// UART3_RX: DMA1_Stream1.CHANNEL_4
+// UART4_RX: DMA1_Stream2.CHANNEL_4 (also SPI3_RX)
+// UART5_RX: DMA1_Stream0.CHANNEL_4
+// UART6_RX: DMA2_Stream1.CHANNEL_5
+STATIC DMA_Stream_TypeDef *const uart_rx_dma_stream[] = {
+    DMA2_Stream5, DMA1_Stream5, DMA1_Stream1, DMA1_Stream2, DMA1_Stream0, DMA2_Stream1,
+};
+STATIC const uint32_t uart_rx_dma_channel[] = {
+    DMA_CHANNEL_4, DMA_CHANNEL_4, DMA_CHANNEL_4, DMA_CHANNEL_4, DMA_CHANNEL_4, DMA_CHANNEL_5,
+};
+
+// start receiving into read_buf with circular DMA; read_buf_head then follows
+// the DMA position, see uart_rx_dma_sync
+STATIC void uart_rx_dma_start(pyb_uart_obj_t *self) {
+    DMA_HandleTypeDef *dma = &self->rx_dma;
+    memset(dma, 0, sizeof(*dma));
+    dma->Instance = uart_rx_dma_stream[self->uart_id - 1];
+    if ((uint32_t)dma->Instance >= DMA2_BASE) {
+        __DMA2_CLK_ENABLE();
+    } else {
+        __DMA1_CLK_ENABLE();
+    }
+    dma->Init.Channel = uart_rx_dma_channel[self->uart_id - 1];
+    dma->Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    if (self->char_width == CHAR_WIDTH_9BIT) {
+        dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        dma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    } else {
+        dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        dma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    }
+    dma->Init.Mode = DMA_CIRCULAR;
+    dma->Init.Priority = DMA_PRIORITY_HIGH;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    dma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    dma->Init.MemBurst = DMA_MBURST_SINGLE;
+    dma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+    HAL_DMA_DeInit(dma);
+    HAL_DMA_Init(dma);
+    HAL_DMA_Start(dma, (uint32_t)&self->uart.Instance->DR, (uint32_t)self->read_buf, self->read_buf_len);
+    self->uart.Instance->CR3 |= USART_CR3_DMAR;
+    self->rx_dma_enabled = true;
+}
+
+STATIC void uart_rx_dma_stop(pyb_uart_obj_t *self) {
+    if (self->rx_dma_enabled) {
+        self->uart.Instance->CR3 &= ~USART_CR3_DMAR;
+        HAL_DMA_Abort(&self->rx_dma);
+        self->rx_dma_enabled = false;
+    }
+}
+
+STATIC void uart_rx_note_peak(pyb_uart_obj_t *self) {
+    uint16_t level = (self->read_buf_head + self->read_buf_len - self->read_buf_tail) % self->read_buf_len;
+    if (level > self->read_buf_peak) {
+        self->read_buf_peak = level;
+    }
+}
+
+// bring read_buf_head up to date with the chars the DMA has stored
+STATIC void uart_rx_dma_sync(pyb_uart_obj_t *self) {
+    self->read_buf_head = (self->read_buf_len - __HAL_DMA_GET_COUNTER(&self->rx_dma)) % self->read_buf_len;
+    uart_rx_note_peak(self);
+}
+
 bool uart_rx_any(pyb_uart_obj_t *self) {
+    if (self->rx_dma_enabled) {
+        // the DMA takes each char as it arrives so RXNE is never of use
+        uart_rx_dma_sync(self);
+        return self->read_buf_tail != self->read_buf_head;
+    }
     return self->read_buf_tail != self->read_buf_head
         || __HAL_UART_GET_FLAG(&self->uart, UART_FLAG_RXNE) != RESET;
 }
@@ -248,7 +341,7 @@ bool uart_rx_any(pyb_uart_obj_t *self) {
 STATIC bool uart_rx_wait(pyb_uart_obj_t *self, uint32_t timeout) {
     uint32_t start = HAL_GetTick();
     for (;;) {
-        if (self->read_buf_tail != self->read_buf_head || __HAL_UART_GET_FLAG(&self->uart, UART_FLAG_RXNE) != RESET) {
+        if (uart_rx_any(self)) {
             return true; // have at least 1 char ready for reading
         }
         if (HAL_GetTick() - start >= timeout) {
@@ -276,13 +369,79 @@ int uart_rx_char(pyb_uart_obj_t *self) {
     }
 }
 
+// Move chars from write_buf to the UART for as long as it will take them.
+// Must not be interrupted by the UART IRQ (so call it from there, or with IRQs
+// disabled).
+STATIC void uart_tx_pump(pyb_uart_obj_t *self) {
+    while (self->write_buf_tail != self->write_buf_head
+        && __HAL_UART_GET_FLAG(&self->uart, UART_FLAG_TXE) != RESET) {
+        if (self->char_width == CHAR_WIDTH_9BIT) {
+            self->uart.Instance->DR = ((uint16_t*)self->write_buf)[self->write_buf_tail] & 0x1ff;
+        } else {
+            self->uart.Instance->DR = self->write_buf[self->write_buf_tail];
+        }
+        self->write_buf_tail = (self->write_buf_tail + 1) % self->write_buf_len;
+    }
+    if (self->write_buf_tail == self->write_buf_head) {
+        __HAL_UART_DISABLE_IT(&self->uart, UART_IT_TXE);
+    }
+}
+
+// Send num_chars chars from src, which holds bytes or uint16_t depending on
+// the char size.  Without a write_buf this blocks until they are sent;
+// otherwise it only blocks while write_buf is full.  Returns the number of
+// chars sent or queued, and sets *errcode if that is less than num_chars.
+STATIC mp_uint_t uart_tx_data(pyb_uart_obj_t *self, const void *src_in, mp_uint_t num_chars, int *errcode) {
+    if (self->write_buf_len == 0) {
+        HAL_StatusTypeDef status = HAL_UART_Transmit(&self->uart, (uint8_t*)src_in, num_chars, self->timeout);
+        if (status != HAL_OK) {
+            *errcode = mp_hal_status_to_errno_table[status];
+            return 0;
+        }
+        return num_chars;
+    }
+
+    const byte *src = src_in;
+    for (mp_uint_t i = 0; i < num_chars; i++) {
+        uint16_t next_head = (self->write_buf_head + 1) % self->write_buf_len;
+        if (next_head == self->write_buf_tail) {
+            // write_buf is full; drain it ourselves too, in case we are
+            // running at a priority that stops the UART IRQ from doing so
+            uint32_t start = HAL_GetTick();
+            do {
+                mp_uint_t irq_state = disable_irq();
+                uart_tx_pump(self);
+                enable_irq(irq_state);
+                if (HAL_GetTick() - start >= self->timeout) {
+                    *errcode = ETIMEDOUT;
+                    return i;
+                }
+            } while (next_head == self->write_buf_tail);
+        }
+        if (self->char_width == CHAR_WIDTH_9BIT) {
+            ((uint16_t*)self->write_buf)[self->write_buf_head] = ((const uint16_t*)src)[i];
+        } else {
+            self->write_buf[self->write_buf_head] = src[i];
+        }
+        self->write_buf_head = next_head;
+        uint16_t level = (next_head + self->write_buf_len - self->write_buf_tail) % self->write_buf_len;
+        if (level > self->write_buf_peak) {
+            self->write_buf_peak = level;
+        }
+        __HAL_UART_ENABLE_IT(&self->uart, UART_IT_TXE);
+    }
+    return num_chars;
+}
+
 STATIC void uart_tx_char(pyb_uart_obj_t *uart_obj, int c) {
     uint8_t ch = c;
-    HAL_UART_Transmit(&uart_obj->uart, &ch, 1, uart_obj->timeout);
+    int errcode;
+    uart_tx_data(uart_obj, &ch, 1, &errcode);
 }
 
 void uart_tx_strn(pyb_uart_obj_t *uart_obj, const char *str, uint len) {
-    HAL_UART_Transmit(&uart_obj->uart, (uint8_t*)str, len, uart_obj->timeout);
+    int errcode;
+    uart_tx_data(uart_obj, str, len, &errcode);
 }
 
 void uart_tx_strn_cooked(pyb_uart_obj_t *uart_obj, const char *str, uint len) {
@@ -294,7 +453,8 @@ void uart_tx_strn_cooked(pyb_uart_obj_t *uart_obj, const char *str, uint len) {
     }
 }
 
-// this IRQ handler is set up to handle RXNE interrupts only
+// this IRQ handler is set up to handle RXNE, IDLE (with rx_dma) and TXE
+// (with a write_buf) interrupts
 void uart_irq_handler(mp_uint_t uart_id) {
     // get the uart object
     pyb_uart_obj_t *self = MP_STATE_PORT(pyb_uart_obj_all)[uart_id - 1];
@@ -305,7 +465,15 @@ void uart_irq_handler(mp_uint_t uart_id) {
         return;
     }
 
-    if (__HAL_UART_GET_FLAG(&self->uart, UART_FLAG_RXNE) != RESET) {
+    if (self->rx_dma_enabled) {
+        // the line went idle after receiving, so the DMA has stored some chars
+        if (__HAL_UART_GET_FLAG(&self->uart, UART_FLAG_IDLE) != RESET) {
+            __HAL_UART_CLEAR_IDLEFLAG(&self->uart);
+            uart_rx_dma_sync(self);
+            MP_IOCTL_POLL_NOTIFY();
+        }
+    } else if (__HAL_UART_GET_IT_SOURCE(&self->uart, UART_IT_RXNE)
+        && __HAL_UART_GET_FLAG(&self->uart, UART_FLAG_RXNE) != RESET) {
         int data = self->uart.Instance->DR; // clears UART_FLAG_RXNE
         data &= self->char_mask;
         if (self->read_buf_len != 0) {
@@ -318,11 +486,22 @@ void uart_irq_handler(mp_uint_t uart_id) {
                     self->read_buf[self->read_buf_head] = data;
                 }
                 self->read_buf_head = next_head;
+                uart_rx_note_peak(self);
+            } else {
+                self->read_buf_dropped += 1;
             }
+            MP_IOCTL_POLL_NOTIFY();
         } else {
             // TODO set flag for buffer overflow
         }
     }
+
+    if (self->write_buf_len != 0 && __HAL_UART_GET_IT_SOURCE(&self->uart, UART_IT_TXE)) {
+        uart_tx_pump(self);
+        if (self->write_buf_tail == self->write_buf_head) {
+            MP_IOCTL_POLL_NOTIFY();
+        }
+    }
 }
 
 /******************************************************************************/
@@ -350,7 +529,7 @@ STATIC void pyb_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
     }
 }
 
-/// \method init(baudrate, bits=8, parity=None, stop=1, *, timeout=1000, timeout_char=0, read_buf_len=64)
+/// \method init(baudrate, bits=8, parity=None, stop=1, *, timeout=1000, timeout_char=0, read_buf_len=64, write_buf_len=0, rx_dma=False)
 ///
 /// Initialise the UART bus with the given parameters:
 ///
@@ -361,6 +540,12 @@ STATIC void pyb_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
 ///   - `timeout` is the timeout in milliseconds to wait for the first character.
 ///   - `timeout_char` is the timeout in milliseconds to wait between characters.
 ///   - `read_buf_len` is the character length of the read buffer (0 to disable).
+///   - `write_buf_len` is the character length of the write buffer.  If non-zero,
+///     writes return once the data is queued, and it is sent from the IRQ.
+///     A write only blocks (for up to `timeout`) while the buffer is full.
+///   - `rx_dma`, if true, receives into the read buffer with circular DMA
+///     (notified by the idle-line IRQ) rather than an IRQ per character.
+///     Unread data is then overwritten, not dropped, if the buffer wraps.
 STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_baudrate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 9600} },
@@ -371,12 +556,24 @@ STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, mp_uint_t n_args, con
         { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1000} },
         { MP_QSTR_timeout_char, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_read_buf_len, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 64} },
+        { MP_QSTR_write_buf_len, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_rx_dma, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
 
     // parse args
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    if (args[9].u_bool && args[7].u_int <= 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "rx_dma needs a read buffer"));
+    }
+
+    // stop using the buffers before they are freed below
+    if (self->is_enabled) {
+        uart_rx_dma_stop(self);
+        __HAL_UART_DISABLE_IT(&self->uart, UART_IT_TXE);
+    }
+
     // set the UART configuration values
     memset(&self->uart, 0, sizeof(self->uart));
     UART_InitTypeDef *init = &self->uart.Init;
@@ -425,8 +622,9 @@ STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, mp_uint_t n_args, con
     self->timeout = args[5].u_int;
     self->timeout_char = args[6].u_int;
 
-    // setup the read buffer
+    // setup the read and write buffers
     m_del(byte, self->read_buf, self->read_buf_len << self->char_width);
+    m_del(byte, self->write_buf, self->write_buf_len << self->char_width);
     if (init->WordLength == UART_WORDLENGTH_9B && init->Parity == UART_PARITY_NONE) {
         self->char_mask = 0x1ff;
         self->char_width = CHAR_WIDTH_9BIT;
@@ -440,19 +638,46 @@ STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, mp_uint_t n_args, con
     }
     self->read_buf_head = 0;
     self->read_buf_tail = 0;
+    self->read_buf_peak = 0;
+    self->read_buf_dropped = 0;
+    __HAL_UART_DISABLE_IT(&self->uart, UART_IT_RXNE);
+    __HAL_UART_DISABLE_IT(&self->uart, UART_IT_IDLE);
     if (args[7].u_int <= 0) {
         // no read buffer
         self->read_buf_len = 0;
         self->read_buf = NULL;
-        HAL_NVIC_DisableIRQ(self->irqn);
-        __HAL_UART_DISABLE_IT(&self->uart, UART_IT_RXNE);
     } else {
-        // read buffer using interrupts
         self->read_buf_len = args[7].u_int;
         self->read_buf = m_new(byte, args[7].u_int << self->char_width);
-        __HAL_UART_ENABLE_IT(&self->uart, UART_IT_RXNE);
+        if (args[9].u_bool) {
+            // read buffer using DMA, with the IRQ waking up readers
+            uart_rx_dma_start(self);
+            __HAL_UART_ENABLE_IT(&self->uart, UART_IT_IDLE);
+        } else {
+            // read buffer using interrupts
+            __HAL_UART_ENABLE_IT(&self->uart, UART_IT_RXNE);
+        }
+    }
+
+    // setup the write buffer
+    self->write_buf_head = 0;
+    self->write_buf_tail = 0;
+    self->write_buf_peak = 0;
+    if (args[8].u_int <= 0) {
+        // no write buffer, writes block
+        self->write_buf_len = 0;
+        self->write_buf = NULL;
+    } else {
+        // write buffer drained by the TXE interrupt
+        self->write_buf_len = args[8].u_int;
+        self->write_buf = m_new(byte, args[8].u_int << self->char_width);
+    }
+
+    if (self->read_buf_len != 0 || self->write_buf_len != 0) {
         HAL_NVIC_SetPriority(self->irqn, 0xd, 0xd); // next-to-next-to lowest priority
         HAL_NVIC_EnableIRQ(self->irqn);
+    } else {
+        HAL_NVIC_DisableIRQ(self->irqn);
     }
 
     // compute actual baudrate that was configured
@@ -555,6 +780,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_uart_init_obj, 1, pyb_uart_init);
 /// Turn off the UART bus.
 STATIC mp_obj_t pyb_uart_deinit(mp_obj_t self_in) {
     pyb_uart_obj_t *self = self_in;
+    if (self->is_enabled) {
+        uart_rx_dma_stop(self);
+        __HAL_UART_DISABLE_IT(&self->uart, UART_IT_TXE);
+    }
     self->is_enabled = false;
     UART_HandleTypeDef *uart = &self->uart;
     HAL_UART_DeInit(uart);
@@ -614,10 +843,9 @@ STATIC mp_obj_t pyb_uart_writechar(mp_obj_t self_in, mp_obj_t char_in) {
     uint16_t data = mp_obj_get_int(char_in);
 
     // write the data
-    HAL_StatusTypeDef status = HAL_UART_Transmit(&self->uart, (uint8_t*)&data, 1, self->timeout);
-
-    if (status != HAL_OK) {
-        mp_hal_raise(status);
+    int errcode;
+    if (uart_tx_data(self, &data, 1, &errcode) != 1) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
     }
 
     return mp_const_none;
@@ -646,6 +874,38 @@ STATIC mp_obj_t pyb_uart_sendbreak(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_uart_sendbreak_obj, pyb_uart_sendbreak);
 
+/// \method stats()
+/// Return a tuple `(rx_waiting, rx_peak, rx_dropped, tx_waiting, tx_peak)`
+/// giving, in characters, how full the read and write buffers are now and the
+/// most they have been since `init`, and how many received characters were
+/// lost because the read buffer was full.  Use it to choose `read_buf_len`
+/// and `write_buf_len`.  With `rx_dma` unread characters are overwritten
+/// instead, which `rx_dropped` can't count, so keep `rx_peak` well below
+/// `read_buf_len`.
+STATIC mp_obj_t pyb_uart_stats(mp_obj_t self_in) {
+    pyb_uart_obj_t *self = self_in;
+    mp_uint_t rx_waiting = 0;
+    if (self->read_buf_len != 0) {
+        if (self->rx_dma_enabled) {
+            uart_rx_dma_sync(self);
+        }
+        rx_waiting = (self->read_buf_head + self->read_buf_len - self->read_buf_tail) % self->read_buf_len;
+    }
+    mp_uint_t tx_waiting = 0;
+    if (self->write_buf_len != 0) {
+        tx_waiting = (self->write_buf_head + self->write_buf_len - self->write_buf_tail) % self->write_buf_len;
+    }
+    mp_obj_t tuple[5] = {
+        MP_OBJ_NEW_SMALL_INT(rx_waiting),
+        MP_OBJ_NEW_SMALL_INT(self->read_buf_peak),
+        mp_obj_new_int_from_uint(self->read_buf_dropped),
+        MP_OBJ_NEW_SMALL_INT(tx_waiting),
+        MP_OBJ_NEW_SMALL_INT(self->write_buf_peak),
+    };
+    return mp_obj_new_tuple(5, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_uart_stats_obj, pyb_uart_stats);
+
 STATIC const mp_map_elem_t pyb_uart_locals_dict_table[] = {
     // instance methods
 
@@ -667,6 +927,7 @@ STATIC const mp_map_elem_t pyb_uart_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_writechar), (mp_obj_t)&pyb_uart_writechar_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_readchar), (mp_obj_t)&pyb_uart_readchar_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendbreak), (mp_obj_t)&pyb_uart_sendbreak_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats), (mp_obj_t)&pyb_uart_stats_obj },
 
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_RTS), MP_OBJ_NEW_SMALL_INT(UART_HWCONTROL_RTS) },
@@ -728,14 +989,13 @@ STATIC mp_uint_t pyb_uart_write(mp_obj_t self_in, const void *buf_in, mp_uint_t
     }
 
     // write the data
-    HAL_StatusTypeDef status = HAL_UART_Transmit(&self->uart, (uint8_t*)buf, size >> self->char_width, self->timeout);
+    mp_uint_t num_tx = uart_tx_data(self, buf, size >> self->char_width, errcode);
 
-    if (status == HAL_OK) {
-        // return number of bytes written
-        return size;
-    } else {
-        *errcode = mp_hal_status_to_errno_table[status];
+    if (num_tx == 0 && size != 0) {
         return MP_STREAM_ERROR;
+    } else {
+        // return number of bytes written
+        return num_tx << self->char_width;
     }
 }
 
@@ -748,9 +1008,19 @@ STATIC mp_uint_t pyb_uart_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t a
         if ((flags & MP_IOCTL_POLL_RD) && uart_rx_any(self)) {
             ret |= MP_IOCTL_POLL_RD;
         }
-        if ((flags & MP_IOCTL_POLL_WR) && __HAL_UART_GET_FLAG(&self->uart, UART_FLAG_TXE)) {
-            ret |= MP_IOCTL_POLL_WR;
+        if (flags & MP_IOCTL_POLL_WR) {
+            if (self->write_buf_len != 0) {
+                if ((self->write_buf_head + 1) % self->write_buf_len != self->write_buf_tail) {
+                    ret |= MP_IOCTL_POLL_WR;
+                }
+            } else if (__HAL_UART_GET_FLAG(&self->uart, UART_FLAG_TXE)) {
+                ret |= MP_IOCTL_POLL_WR;
+            }
         }
+    } else if (request == MP_IOCTL_POLL_IRQ && !(arg & MP_IOCTL_POLL_WR) && self->read_buf_len != 0 && !self->rx_dma_enabled) {
+        // received chars are signalled by the RXNE IRQ, but TXE is not, and
+        // with rx_dma they are only signalled once the line goes idle
+        ret = 0;
     } else {
         *errcode = EINVAL;
         ret = MP_STREAM_ERROR;
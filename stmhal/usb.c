@@ -57,9 +57,9 @@ STATIC const mp_obj_str_t pyb_usb_hid_mouse_desc_obj = {
     USBD_HID_MOUSE_ReportDesc,
 };
 const mp_obj_tuple_t pyb_usb_hid_mouse_obj = {
-    {&mp_type_tuple},
-    5,
-    {
+    .base = {&mp_type_tuple},
+    .len = 5,
+    .items = {
         MP_OBJ_NEW_SMALL_INT(1), // subclass: boot
         MP_OBJ_NEW_SMALL_INT(2), // protocol: mouse
         MP_OBJ_NEW_SMALL_INT(USBD_HID_MOUSE_MAX_PACKET),
@@ -76,9 +76,9 @@ STATIC const mp_obj_str_t pyb_usb_hid_keyboard_desc_obj = {
     USBD_HID_KEYBOARD_ReportDesc,
 };
 const mp_obj_tuple_t pyb_usb_hid_keyboard_obj = {
-    {&mp_type_tuple},
-    5,
-    {
+    .base = {&mp_type_tuple},
+    .len = 5,
+    .items = {
         MP_OBJ_NEW_SMALL_INT(1), // subclass: boot
         MP_OBJ_NEW_SMALL_INT(1), // protocol: keyboard
         MP_OBJ_NEW_SMALL_INT(USBD_HID_KEYBOARD_MAX_PACKET),
@@ -436,6 +436,8 @@ STATIC const mp_map_elem_t pyb_usb_vcp_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
     /// \method readline()
     { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&mp_stream_unbuffered_readline_obj},
+    /// \method readinto(buf[, nbytes])
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
     /// \method write(buf)
     { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj },
     /// \method close()
@@ -478,6 +480,9 @@ STATIC mp_uint_t pyb_usb_vcp_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_
         if ((flags & MP_IOCTL_POLL_WR) && USBD_CDC_TxHalfEmpty()) {
             ret |= MP_IOCTL_POLL_WR;
         }
+    } else if (request == MP_IOCTL_POLL_IRQ) {
+        // the CDC interface notifies on rx and when the tx buffer drains
+        ret = 0;
     } else {
         *errcode = EINVAL;
         ret = MP_STREAM_ERROR;
@@ -36,6 +36,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "usbd_cdc_msc_hid.h"
 #include "usbd_cdc_interface.h"
@@ -44,6 +45,7 @@
 #include "py/obj.h"
 #include "timer.h"
 #include "usb.h"
+#include "pybioctl.h"
 
 // CDC control commands
 #define CDC_SEND_ENCAPSULATED_COMMAND               0x00
@@ -58,8 +60,24 @@
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
-#define APP_RX_DATA_SIZE  1024 // I think this must be at least CDC_DATA_FS_OUT_PACKET_SIZE=64 (APP_RX_DATA_SIZE was 2048)
-#define APP_TX_DATA_SIZE  1024 // I think this can be any value (was 2048)
+// The buffer sizes can be set by a board.  The rx buffer must hold at least
+// 2 * CDC_DATA_FS_MAX_PACKET_SIZE; the tx buffer size must be a power of 2.
+#ifndef MICROPY_HW_USB_CDC_RX_DATA_SIZE
+#define MICROPY_HW_USB_CDC_RX_DATA_SIZE (1024)
+#endif
+#ifndef MICROPY_HW_USB_CDC_TX_DATA_SIZE
+#define MICROPY_HW_USB_CDC_TX_DATA_SIZE (2048)
+#endif
+
+#define APP_RX_DATA_SIZE  MICROPY_HW_USB_CDC_RX_DATA_SIZE
+#define APP_TX_DATA_SIZE  MICROPY_HW_USB_CDC_TX_DATA_SIZE
+
+#if APP_RX_DATA_SIZE < 2 * CDC_DATA_FS_MAX_PACKET_SIZE
+#error MICROPY_HW_USB_CDC_RX_DATA_SIZE is too small
+#endif
+#if (APP_TX_DATA_SIZE & (APP_TX_DATA_SIZE - 1)) != 0 || APP_TX_DATA_SIZE > 32768
+#error MICROPY_HW_USB_CDC_TX_DATA_SIZE must be a power of 2, at most 32768
+#endif
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
@@ -85,12 +103,14 @@ static int8_t CDC_Itf_Init     (void);
 static int8_t CDC_Itf_DeInit   (void);
 static int8_t CDC_Itf_Control  (uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Itf_Receive  (uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_Itf_TxComplete (void);
 
 const USBD_CDC_ItfTypeDef USBD_CDC_fops = {
     CDC_Itf_Init,
     CDC_Itf_DeInit,
     CDC_Itf_Control,
-    CDC_Itf_Receive
+    CDC_Itf_Receive,
+    CDC_Itf_TxComplete
 };
 
 /* Private functions ---------------------------------------------------------*/
@@ -256,6 +276,42 @@ static int8_t CDC_Itf_Control(uint8_t cmd, uint8_t* pbuf, uint16_t length) {
     return USBD_OK;
 }
 
+// Pass the next contiguous chunk of the tx buffer to the USB IN endpoint.
+// Called from the TIM3 and USB IRQs, which have the same priority so can't
+// preempt each other.
+static void CDC_Itf_TxStart(void) {
+    if (UserTxBufPtrOutShadow != UserTxBufPtrIn || UserTxNeedEmptyPacket) {
+        uint32_t buffptr;
+        uint32_t buffsize;
+
+        if (UserTxBufPtrOutShadow > UserTxBufPtrIn) { // rollback
+            buffsize = APP_TX_DATA_SIZE - UserTxBufPtrOutShadow;
+        } else {
+            buffsize = UserTxBufPtrIn - UserTxBufPtrOutShadow;
+        }
+
+        buffptr = UserTxBufPtrOutShadow;
+
+        USBD_CDC_SetTxBuffer(&hUSBDDevice, (uint8_t*)&UserTxBuffer[buffptr], buffsize);
+
+        if (USBD_CDC_TransmitPacket(&hUSBDDevice) == USBD_OK) {
+            UserTxBufPtrOutShadow += buffsize;
+            if (UserTxBufPtrOutShadow == APP_TX_DATA_SIZE) {
+                UserTxBufPtrOutShadow = 0;
+            }
+            UserTxBufPtrWaitCount = 0;
+
+            // According to the USB specification, a packet size of 64 bytes (CDC_DATA_FS_MAX_PACKET_SIZE)
+            // gets held at the USB host until the next packet is sent.  This is because a
+            // packet of maximum size is considered to be part of a longer chunk of data, and
+            // the host waits for all data to arrive (ie, waits for a packet < max packet size).
+            // To flush a packet of exactly max packet size, we need to send a zero-size packet.
+            // See eg http://www.cypress.com/?id=4&rID=92719
+            UserTxNeedEmptyPacket = (buffsize > 0 && buffsize % CDC_DATA_FS_MAX_PACKET_SIZE == 0 && UserTxBufPtrOutShadow == UserTxBufPtrIn);
+        }
+    }
+}
+
 /**
   * @brief  TIM period elapsed callback
   * @param  htim: TIM handle
@@ -286,38 +342,29 @@ void USBD_CDC_HAL_TIM_PeriodElapsedCallback(void) {
             }
         }
         UserTxBufPtrOut = UserTxBufPtrOutShadow;
+        MP_IOCTL_POLL_NOTIFY();
     }
 
-    if (UserTxBufPtrOutShadow != UserTxBufPtrIn || UserTxNeedEmptyPacket) {
-        uint32_t buffptr;
-        uint32_t buffsize;
-
-        if (UserTxBufPtrOutShadow > UserTxBufPtrIn) { // rollback
-            buffsize = APP_TX_DATA_SIZE - UserTxBufPtrOutShadow;
-        } else {
-            buffsize = UserTxBufPtrIn - UserTxBufPtrOutShadow;
-        }
-
-        buffptr = UserTxBufPtrOutShadow;
-
-        USBD_CDC_SetTxBuffer(&hUSBDDevice, (uint8_t*)&UserTxBuffer[buffptr], buffsize);
-
-        if (USBD_CDC_TransmitPacket(&hUSBDDevice) == USBD_OK) {
-            UserTxBufPtrOutShadow += buffsize;
-            if (UserTxBufPtrOutShadow == APP_TX_DATA_SIZE) {
-                UserTxBufPtrOutShadow = 0;
-            }
-            UserTxBufPtrWaitCount = 0;
+    CDC_Itf_TxStart();
+}
 
-            // According to the USB specification, a packet size of 64 bytes (CDC_DATA_FS_MAX_PACKET_SIZE)
-            // gets held at the USB host until the next packet is sent.  This is because a
-            // packet of maximum size is considered to be part of a longer chunk of data, and
-            // the host waits for all data to arrive (ie, waits for a packet < max packet size).
-            // To flush a packet of exactly max packet size, we need to send a zero-size packet.
-            // See eg http://www.cypress.com/?id=4&rID=92719
-            UserTxNeedEmptyPacket = (buffsize > 0 && buffsize % CDC_DATA_FS_MAX_PACKET_SIZE == 0 && UserTxBufPtrOutShadow == UserTxBufPtrIn);
-        }
+/**
+  * @brief  CDC_Itf_TxComplete
+  *         The USB IN endpoint has sent all the data it was given.
+  * @retval Result of the opeartion: USBD_OK
+  * @note   The next chunk is sent straight away, rather than at the next
+  *         timer tick, so a full tx buffer drains at the bus rate.
+  */
+static int8_t CDC_Itf_TxComplete(void) {
+    if (!dev_is_connected) {
+        return USBD_OK;
+    }
+    if (UserTxBufPtrOut != UserTxBufPtrOutShadow) {
+        UserTxBufPtrOut = UserTxBufPtrOutShadow;
+        MP_IOCTL_POLL_NOTIFY();
     }
+    CDC_Itf_TxStart();
+    return USBD_OK;
 }
 
 /**
@@ -379,6 +426,7 @@ static int8_t CDC_Itf_Receive(uint8_t* Buf, uint32_t *Len) {
     } else {
         // data fits, leaving room for another CDC_DATA_FS_OUT_PACKET_SIZE
         UserRxBufLen += delta_len;
+        MP_IOCTL_POLL_NOTIFY();
     }
 
     // initiate next USB packet transfer, to append to existing data in buffer
@@ -405,13 +453,33 @@ int USBD_CDC_TxHalfEmpty(void) {
     return tx_waiting <= APP_TX_DATA_SIZE / 2;
 }
 
+static uint32_t USBD_CDC_TxFree(void) {
+    return (UserTxBufPtrOut - UserTxBufPtrIn - 1) & (APP_TX_DATA_SIZE - 1);
+}
+
+// Copy as much of buf as fits contiguously into the free part of the tx
+// buffer.  Returns the number of bytes copied.
+static uint32_t USBD_CDC_TxCopy(const uint8_t *buf, uint32_t len) {
+    uint32_t n = USBD_CDC_TxFree();
+    if (n > APP_TX_DATA_SIZE - UserTxBufPtrIn) {
+        n = APP_TX_DATA_SIZE - UserTxBufPtrIn;
+    }
+    if (n > len) {
+        n = len;
+    }
+    memcpy(UserTxBuffer + UserTxBufPtrIn, buf, n);
+    UserTxBufPtrIn = (UserTxBufPtrIn + n) & (APP_TX_DATA_SIZE - 1);
+    return n;
+}
+
 // timout in milliseconds.
 // Returns number of bytes written to the device.
 int USBD_CDC_Tx(const uint8_t *buf, uint32_t len, uint32_t timeout) {
-    for (uint32_t i = 0; i < len; i++) {
+    uint32_t i = 0;
+    while (i < len) {
         // Wait until the device is connected and the buffer has space, with a given timeout
         uint32_t start = HAL_GetTick();
-        while (!dev_is_connected || ((UserTxBufPtrIn + 1) & (APP_TX_DATA_SIZE - 1)) == UserTxBufPtrOut) {
+        while (!dev_is_connected || USBD_CDC_TxFree() == 0) {
             // Wraparound of tick is taken care of by 2's complement arithmetic.
             if (HAL_GetTick() - start >= timeout) {
                 // timeout
@@ -420,9 +488,8 @@ int USBD_CDC_Tx(const uint8_t *buf, uint32_t len, uint32_t timeout) {
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Write data to device buffer
-        UserTxBuffer[UserTxBufPtrIn] = buf[i];
-        UserTxBufPtrIn = (UserTxBufPtrIn + 1) & (APP_TX_DATA_SIZE - 1);
+        // Write as much data as fits to the device buffer
+        i += USBD_CDC_TxCopy(buf + i, len - i);
     }
 
     // Success, return number of bytes read
@@ -433,7 +500,8 @@ int USBD_CDC_Tx(const uint8_t *buf, uint32_t len, uint32_t timeout) {
 // device is not connected, or if the buffer is full.  Has a small timeout
 // to wait for the buffer to be drained, in the case the device is connected.
 void USBD_CDC_TxAlways(const uint8_t *buf, uint32_t len) {
-    for (int i = 0; i < len; i++) {
+    while (len > 0) {
+        uint32_t n = 0;
         // If the CDC device is not connected to the host then we don't have anyone to receive our data.
         // The device may become connected in the future, so we should at least try to fill the buffer
         // and hope that it doesn't overflow by the time the device connects.
@@ -443,9 +511,10 @@ void USBD_CDC_TxAlways(const uint8_t *buf, uint32_t len) {
             // If the buffer is full, wait until it gets drained, with a timeout of 500ms
             // (wraparound of tick is taken care of by 2's complement arithmetic).
             uint32_t start = HAL_GetTick();
-            while (((UserTxBufPtrIn + 1) & (APP_TX_DATA_SIZE - 1)) == UserTxBufPtrOut && HAL_GetTick() - start <= 500) {
+            while (USBD_CDC_TxFree() == 0 && HAL_GetTick() - start <= 500) {
                 __WFI(); // enter sleep mode, waiting for interrupt
             }
+            n = USBD_CDC_TxCopy(buf, len);
 
             // Some unused code that makes sure the low-level USB buffer is drained.
             // Waiting for low-level is handled in USBD_CDC_HAL_TIM_PeriodElapsedCallback.
@@ -466,8 +535,15 @@ void USBD_CDC_TxAlways(const uint8_t *buf, uint32_t len) {
             */
         }
 
-        UserTxBuffer[UserTxBufPtrIn] = buf[i];
-        UserTxBufPtrIn = (UserTxBufPtrIn + 1) & (APP_TX_DATA_SIZE - 1);
+        if (n == 0) {
+            // Not connected or timed out, so write regardless of the data
+            // that has not yet been sent.
+            n = MIN(len, APP_TX_DATA_SIZE - UserTxBufPtrIn);
+            memcpy(UserTxBuffer + UserTxBufPtrIn, buf, n);
+            UserTxBufPtrIn = (UserTxBufPtrIn + n) & (APP_TX_DATA_SIZE - 1);
+        }
+        buf += n;
+        len -= n;
     }
 }
 
@@ -479,8 +555,9 @@ int USBD_CDC_RxNum(void) {
 // timout in milliseconds.
 // Returns number of bytes read from the device.
 int USBD_CDC_Rx(uint8_t *buf, uint32_t len, uint32_t timeout) {
-    // loop to read bytes
-    for (uint32_t i = 0; i < len; i++) {
+    // loop to read chunks of bytes
+    uint32_t i = 0;
+    while (i < len) {
         // Wait until we have at least 1 byte to read
         uint32_t start = HAL_GetTick();
         while (UserRxBufLen == UserRxBufCur) {
@@ -492,8 +569,11 @@ int USBD_CDC_Rx(uint8_t *buf, uint32_t len, uint32_t timeout) {
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Copy byte from device to user buffer
-        buf[i] = UserRxBuffer[UserRxBufCur++];
+        // Copy as many bytes as are available from device to user buffer
+        uint32_t n = MIN(len - i, (uint32_t)(UserRxBufLen - UserRxBufCur));
+        memcpy(buf + i, UserRxBuffer + UserRxBufCur, n);
+        UserRxBufCur += n;
+        i += n;
     }
 
     // Success, return number of bytes read
@@ -32,6 +32,7 @@
   */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "usbd_cdc_msc_hid.h"
 #include "usbd_msc_storage.h"
@@ -47,6 +48,39 @@ static uint8_t flash_started = 0;
 
 #if MICROPY_HW_HAS_SDCARD
 static uint8_t sdcard_started = 0;
+
+// The MSC class reads and writes at most MSC_MEDIA_PACKET bytes at a time,
+// and each of those is a separate SD card command.  To make fewer, longer
+// transfers, the SD card blocks after a sequential read are read ahead, and
+// consecutive writes are gathered, in a cache of this many blocks (0 to
+// disable it).  A board can set the size.
+#ifndef MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS
+#define MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS (16)
+#endif
+
+#if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+// The cache holds sd_cache_len blocks from sd_cache_addr, which are either
+// as on the card or (if sd_cache_dirty) written by the host but not yet to
+// the card.  It is flushed and emptied when a SCSI command starts, so that
+// it does not hide changes made to the card by anything else, and a write
+// reaches the card no later than the host's next command.
+static uint32_t sd_cache[MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS * SDCARD_BLOCK_SIZE / 4];
+static uint32_t sd_cache_addr;
+static uint32_t sd_cache_len = 0;
+static bool sd_cache_dirty = false;
+static uint32_t sd_next_read = 0; // the block after the last one read
+static uint32_t sd_num_blocks;
+
+static bool sd_cache_flush(void) {
+    bool ok = true;
+    if (sd_cache_dirty) {
+        ok = sdcard_write_blocks((uint8_t*)sd_cache, sd_cache_addr, sd_cache_len) == 0;
+        sd_cache_dirty = false;
+    }
+    sd_cache_len = 0;
+    return ok;
+}
+#endif
 #endif
 
 /******************************************************************************/
@@ -232,6 +266,11 @@ int8_t SDCARD_STORAGE_Init(uint8_t lun) {
         return -1;
     }
     sdcard_started = 1;
+    #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+    sd_cache_len = 0;
+    sd_cache_dirty = false;
+    sd_num_blocks = sdcard_get_capacity_in_bytes() / SDCARD_BLOCK_SIZE;
+    #endif
     return 0;
 
 }
@@ -268,6 +307,12 @@ int8_t SDCARD_STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *bl
   */
 int8_t SDCARD_STORAGE_IsReady(uint8_t lun) {
     if (sdcard_started) {
+        #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+        // this is called at the start of each SCSI command
+        if (!sd_cache_flush()) {
+            return -1;
+        }
+        #endif
         return 0;
     }
     return -1;
@@ -284,11 +329,17 @@ int8_t SDCARD_STORAGE_IsWriteProtected(uint8_t lun) {
 
 // Remove the lun
 int8_t SDCARD_STORAGE_StartStopUnit(uint8_t lun, uint8_t started) {
+    #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+    sd_cache_flush();
+    #endif
     sdcard_started = started;
     return 0;
 }
 
 int8_t SDCARD_STORAGE_PreventAllowMediumRemoval(uint8_t lun, uint8_t param) {
+    #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+    sd_cache_flush();
+    #endif
     return 0;
 }
 
@@ -301,6 +352,36 @@ int8_t SDCARD_STORAGE_PreventAllowMediumRemoval(uint8_t lun, uint8_t param) {
   * @retval Status
   */
 int8_t SDCARD_STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len) {
+    #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+    bool sequential = blk_addr == sd_next_read;
+    sd_next_read = blk_addr + blk_len;
+    if (sd_cache_dirty) {
+        if (!sd_cache_flush()) {
+            return -1;
+        }
+    }
+    if (sd_cache_len > 0 && blk_addr >= sd_cache_addr && blk_addr + blk_len <= sd_cache_addr + sd_cache_len) {
+        memcpy(buf, (uint8_t*)sd_cache + (blk_addr - sd_cache_addr) * SDCARD_BLOCK_SIZE, blk_len * SDCARD_BLOCK_SIZE);
+        return 0;
+    }
+    if (sequential && blk_len < MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS) {
+        // read ahead, up to the end of the card
+        uint32_t n = MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS;
+        if (blk_addr + n > sd_num_blocks) {
+            n = sd_num_blocks - blk_addr;
+        }
+        if (n >= blk_len) {
+            sd_cache_len = 0;
+            if (sdcard_read_blocks((uint8_t*)sd_cache, blk_addr, n) != 0) {
+                return -1;
+            }
+            sd_cache_addr = blk_addr;
+            sd_cache_len = n;
+            memcpy(buf, sd_cache, blk_len * SDCARD_BLOCK_SIZE);
+            return 0;
+        }
+    }
+    #endif
     if (sdcard_read_blocks(buf, blk_addr, blk_len) != 0) {
         return -1;
     }
@@ -316,10 +397,40 @@ int8_t SDCARD_STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_
   * @retval Status
   */
 int8_t SDCARD_STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len) {
+    #if MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS > 0
+    if (sd_cache_dirty && blk_addr == sd_cache_addr + sd_cache_len
+        && sd_cache_len + blk_len <= MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS) {
+        // carry on gathering consecutive blocks
+        memcpy((uint8_t*)sd_cache + sd_cache_len * SDCARD_BLOCK_SIZE, buf, blk_len * SDCARD_BLOCK_SIZE);
+        sd_cache_len += blk_len;
+    } else {
+        // write out the gathered blocks, or forget the blocks read ahead
+        if (!sd_cache_flush()) {
+            return -1;
+        }
+        if (blk_len >= MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS) {
+            if (sdcard_write_blocks(buf, blk_addr, blk_len) != 0) {
+                return -1;
+            }
+            return 0;
+        }
+        memcpy(sd_cache, buf, blk_len * SDCARD_BLOCK_SIZE);
+        sd_cache_addr = blk_addr;
+        sd_cache_len = blk_len;
+        sd_cache_dirty = true;
+    }
+    if (sd_cache_len == MICROPY_HW_USB_MSC_SD_CACHE_BLOCKS) {
+        if (!sd_cache_flush()) {
+            return -1;
+        }
+    }
+    return 0;
+    #else
     if (sdcard_write_blocks(buf, blk_addr, blk_len) != 0) {
         return -1;
     }
     return 0;
+    #endif
 }
 
 /**
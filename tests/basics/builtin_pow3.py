@@ -0,0 +1,26 @@
+# test builtin pow() with 3 integral arguments
+
+# small values, and signs of the base and modulus
+print(pow(2, 10, 1000), pow(-2, 3, 5), pow(5, 3, -7), pow(-3, 3, -4))
+print(pow(3, 0, 7), pow(3, 0, 1), pow(0, 0, 7), pow(0, 5, 7), pow(7, 5, 1), pow(7, 5, -1))
+
+# big odd and even moduli
+print(pow(2 ** 64 + 1, 2 ** 64 + 3, 2 ** 127 - 1))
+print(pow(2, 2 ** 100, 10 ** 30))
+print(pow(123, 456, 2 ** 200))
+print(pow(-(3 ** 100), 12345, 2 ** 521 - 1))
+
+# modulus with many digits
+m = 7 ** 700 + 2
+print(pow(3 ** 500, 2 ** 300 + 1, m) % 1000000007)
+print(pow(3 ** 500, 2 ** 300 + 1, m + 1) % 1000000007)
+
+# errors
+try:
+    pow(2, 3, 0)
+except ValueError:
+    print('ValueError')
+try:
+    pow(2.0, 3, 5)
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,55 @@
+# sum, min, max, any and all over ranges, lists, tuples and arrays
+try:
+    from array import array
+except ImportError:
+    import sys
+    print("SKIP")
+    sys.exit()
+
+# ranges have a closed form
+for r in (range(0), range(10), range(-5, 17, 3), range(20, -7, -4), range(5, 5), range(1000000)):
+    print(sum(r), sum(r, 7))
+    if len(r):
+        print(min(r), max(r))
+print(sum(range(2**30, 2**30 + 100000)))
+print(sum(range(10), 0.5))
+try:
+    min(range(0))
+except ValueError:
+    print('ValueError')
+
+# lists and tuples
+l = [3, 0, -2, 7.5, 1]
+print(min(l), max(l), min(tuple(l)), max(tuple(l)))
+print(any([]), all([]), any([0, 0, 1]), all([1, 1, 0]), any((0, None, '')), all((1, 'a')))
+
+# an item that changes the list when its truth is tested
+class B:
+    def __init__(self, l):
+        self.l = l
+    def __bool__(self):
+        del self.l[:]
+        return False
+l = [0]
+l.append(B(l))
+l.extend([1] * 100)
+print(any(l), len(l))
+
+# arrays of each typecode
+for t in 'bBhHiIlLfd':
+    a = array(t, [1, 5, 3, 100, 2])
+    print(t, sum(a), sum(a, 10), sum(a, 0.5), min(a), max(a))
+a = array('b', [-128, 127, -1, 0])
+print(sum(a), min(a), max(a))
+print(sum(bytearray(b'\x01\x02\xff')), min(b'xyz'), max(bytearray(b'\x00\x90')))
+# bytes items are unsigned
+print(min(b'\x05\xff'), max(b'\x00\xff'), sum(b'\xff\x80'), sum(b'\x80', 1.5), min(b'\x90\x80'))
+print(sum(array('i')), sum(array('f'), 1))
+a = array('l', [2**62, 2**62, -5])
+print(sum(a), min(a), max(a))
+a = array('I', [2**32 - 1, 3])
+print(sum(a), min(a), max(a))
+a = array('d', [1.5, float('inf'), -2.25])
+print(sum(a), min(a), max(a))
+print(any(array('i', [0, 0])), all(array('h', [1, 2])), any(bytearray(3)))
+print(min(array('i', [4, 2, 9]), key=lambda x: -x))
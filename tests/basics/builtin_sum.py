@@ -12,3 +12,7 @@ tests = (
 for test in tests:
     print(sum(test))
     print(sum(test, -2))
+
+# small ints that overflow into a big int
+print(sum([2 ** 29, 2 ** 29, 2 ** 29, 2 ** 29]))
+print(sum((2 ** 61, 2 ** 61, 2 ** 62, 1)))
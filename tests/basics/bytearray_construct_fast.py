@@ -0,0 +1,31 @@
+# construct bytes/bytearray/list from sequences and buffers
+
+# from list and tuple
+print(bytes([1, 2, 255]))
+print(bytes((0, 65, 97)))
+print(bytearray([1, 2, 255]))
+print(bytearray((0, 65, 97)))
+print(bytes([]), bytearray(()))
+
+# from other iterables
+print(bytes(range(5)))
+print(bytearray(x * 2 for x in range(5)))
+
+# bytes checks the range of values
+try:
+    bytes([1, 256])
+except ValueError:
+    print("ValueError")
+try:
+    bytes((-1,))
+except ValueError:
+    print("ValueError")
+
+# list from buffer-like objects
+print(list(b"\x00\x7f\x80\xff"))
+print(list(bytearray(b"\x00\x7f\x80\xff")))
+l = [1]
+l.extend(b"ab")
+print(l)
+l.extend(bytearray(b"cd"))
+print(l)
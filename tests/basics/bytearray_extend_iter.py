@@ -0,0 +1,29 @@
+# bytearray.extend with iterables, and growth by repeated append/extend
+
+a = bytearray()
+a.extend([1, 2, 3])
+a.extend((4, 5))
+a.extend(range(6, 9))
+a.extend(x for x in (9, 10))
+print(a)
+
+a = bytearray(b"ab")
+a.extend(a)
+print(a)
+
+a = bytearray()
+for i in range(1000):
+    a.append(i & 0xff)
+print(len(a), a[0], a[255], a[256], a[999])
+
+a = bytearray()
+for i in range(100):
+    a.extend(b"0123456789")
+print(len(a), a[-10:])
+
+# slice assignment from a memoryview
+a = bytearray(b"0123456789")
+a[2:4] = memoryview(b"abcdef")
+print(a)
+a[0:0] = memoryview(bytearray(b"XY"))[1:]
+print(a)
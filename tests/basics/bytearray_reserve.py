@@ -0,0 +1,37 @@
+# test the reserve argument of bytearray (extension to CPython)
+try:
+    bytearray(reserve=1)
+except TypeError:
+    import sys
+    print("SKIP")
+    sys.exit()
+
+print(bytearray(reserve=10))
+print(bytearray(b'abc', reserve=10))
+print(bytearray(3, reserve=10))
+print(bytearray([1, 2], reserve=1))
+print(bytearray(source=b'xy', reserve=0))
+
+# appends fill the reserved room, and then grow as usual
+b = bytearray(b'ab', reserve=4)
+for i in range(8):
+    b.append(0x30 + i)
+print(b)
+b.extend(b'XYZ')
+print(b, len(b))
+
+# slice assignment growing and shrinking within the reserved room
+b = bytearray(b'0123', reserve=16)
+b[1:2] = b'abcdef'
+print(b)
+b[0:8] = b''
+print(b)
+b.extend(b'xyz')
+b[1:1] = b'ABC'
+print(b)
+
+# reserve is keyword only
+try:
+    bytearray(b'abc', 10)
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,71 @@
+# test instance attributes being stored, replaced and deleted, in ways that
+# exercise shared attribute layouts
+
+class A:
+    pass
+
+# same attributes set in different orders
+a1 = A()
+a1.x = 1
+a1.y = 2
+a2 = A()
+a2.y = 3
+a2.x = 4
+print(a1.x, a1.y, a2.x, a2.y)
+a1.x = 5
+print(a1.x, a2.x)
+
+# deleting an attribute
+a3 = A()
+a3.x = 1
+a3.y = 2
+a3.z = 3
+del a3.y
+print(a3.x, a3.z, hasattr(a3, "y"))
+try:
+    del a3.y
+except AttributeError:
+    print("AttributeError")
+a3.y = 4
+print(a3.x, a3.y, a3.z)
+a4 = A()
+try:
+    del a4.x
+except AttributeError:
+    print("AttributeError")
+
+# many attributes
+a = A()
+for i in range(40):
+    setattr(a, "attr%d" % i, i)
+print(sum(getattr(a, "attr%d" % i) for i in range(40)))
+
+# many different first attributes
+l = []
+for i in range(20):
+    o = A()
+    setattr(o, "first%d" % i, i)
+    o.common = -i
+    l.append(o)
+print([getattr(o, "first%d" % i) + o.common for i, o in enumerate(l)])
+
+# repeated access from the same code, with instances of different layouts
+def get(o):
+    return o.x
+def put(o, v):
+    o.x = v
+for o in (a1, a2, a3, a2, a1):
+    put(o, get(o) + 10)
+print(a1.x, a2.x, a3.x)
+
+# class attributes and methods are still found
+class B:
+    c = 100
+    def __init__(self):
+        self.v = 1
+    def m(self):
+        return self.v + self.c
+b = B()
+print(b.m(), b.c)
+b.c = 200
+print(b.m(), B.c)
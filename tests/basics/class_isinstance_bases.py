@@ -0,0 +1,62 @@
+# isinstance, issubclass, super() and attribute lookup through deep and
+# multiple base classes
+
+class A:
+    def f(self):
+        return 'A.f'
+    def g(self):
+        return 'A.g'
+
+class B(A):
+    def g(self):
+        return 'B.g+' + super().g()
+
+class C:
+    def h(self):
+        return 'C.h'
+
+class D(B, C):
+    pass
+
+class E(D):
+    def h(self):
+        return 'E.h+' + super().h()
+
+e = E()
+print(e.f(), e.g(), e.h())
+for cls in (A, B, C, D, E, object, int):
+    print(isinstance(e, cls), issubclass(E, cls), issubclass(cls, E))
+print(isinstance(e, (int, str)), isinstance(e, (int, C)), isinstance(1, (A, int)))
+print(issubclass(B, (C, D)), issubclass(D, (C, int)))
+
+# a chain of classes
+cls = A
+for i in range(20):
+    cls = type('X%d' % i, (cls,), {})
+print(issubclass(cls, A), issubclass(cls, B), cls().g())
+
+# a native base, reached through classes
+class L(list):
+    def add(self, x):
+        super().append(x)
+        return self
+
+class M(L, C):
+    pass
+
+m = M()
+print(m.add(1).add(2), len(m), m.h())
+print(isinstance(m, list), isinstance(m, L), isinstance(m, (dict, C)), isinstance(m, tuple))
+
+# exception classes
+class MyError(ValueError):
+    pass
+
+class MyError2(MyError, C):
+    pass
+
+print(issubclass(MyError2, Exception), issubclass(MyError2, BaseException), issubclass(MyError2, KeyError))
+try:
+    raise MyError2('x')
+except ValueError as er:
+    print('caught', er.h(), er.args)
@@ -0,0 +1,52 @@
+# test that cached method lookups see changes to classes and instances
+
+class A:
+    def f(self):
+        return 'A.f'
+
+class B(A):
+    pass
+
+def call(o, n=3):
+    return [o.f() for i in range(n)]
+
+a = A()
+b = B()
+print(call(a), call(b))
+
+# override in a subclass after the lookup has been cached
+def bf(self):
+    return 'B.f'
+B.f = bf
+print(call(a), call(b))
+
+# change the base class method
+def af(self):
+    return 'A.f2'
+A.f = af
+print(call(a), call(b))
+
+# remove the override
+del B.f
+print(call(a), call(b))
+
+# instance attribute shadows the method
+b.f = lambda: 'b.f'
+print(call(b))
+del b.f
+print(call(b))
+
+# bound method obtained via load attr
+m = a.f
+print(m())
+
+# same attribute name on different classes at the same call site
+class C:
+    def f(self):
+        return 'C.f'
+for o in (a, b, C(), a, C()):
+    print(o.f())
+
+# method replaced by a non-function value
+A.f = 1
+print(a.f, b.f)
@@ -0,0 +1,65 @@
+# test that loads and stores of properties stay correct when the class or
+# its attributes change between accesses
+
+class A:
+    def __init__(self):
+        self._x = 1
+
+    @property
+    def x(self):
+        return self._x
+
+    @x.setter
+    def x(self, value):
+        self._x = value * 2
+
+class B(A):
+    pass
+
+a = A()
+b = B()
+for i in range(3):
+    a.x = i
+    b.x = i + 10
+    print(a.x, b.x)
+
+# replace the property with a method, then with a read-only property
+A.x = lambda self: 'meth'
+print(a.x(), b.x())
+A.x = property(lambda self: 'ro')
+print(a.x, b.x)
+try:
+    a.x = 1
+except AttributeError:
+    print('AttributeError')
+
+# a property defined in the subclass only
+B.x = property(lambda self: 'B.x')
+print(a.x, b.x)
+
+# the same load site seeing both a property and a method
+class C:
+    @property
+    def y(self):
+        return 'prop'
+
+class D:
+    def y(self):
+        return 'meth'
+
+def get_y(o):
+    return o.y
+
+for o in (C(), D(), C(), D()):
+    y = get_y(o)
+    print(y if isinstance(y, str) else y())
+
+# store to a plain attribute of a class that has a cached method of that name
+class E:
+    def f(self):
+        return 'E.f'
+
+e = E()
+print(e.f())
+e.f = lambda: 'inst'
+print(e.f())
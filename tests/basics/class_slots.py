@@ -0,0 +1,101 @@
+# test __slots__
+
+class A:
+    __slots__ = ("x", "y")
+    def __init__(self, x):
+        self.x = x
+    def total(self):
+        return self.x + self.y
+
+a = A(1)
+a.y = 2
+print(a.x, a.y, a.total())
+a.x = 10
+print(a.total())
+
+# attributes not in __slots__ can't be set
+try:
+    a.z = 3
+except AttributeError:
+    print("AttributeError")
+
+# unset and deleted slots
+b = A(5)
+try:
+    b.y
+except AttributeError:
+    print("AttributeError")
+del b.x
+try:
+    b.x
+except AttributeError:
+    print("AttributeError")
+try:
+    del b.x
+except AttributeError:
+    print("AttributeError")
+b.x = 6
+print(b.x)
+
+# a single string
+class S:
+    __slots__ = "v"
+s = S()
+s.v = "str"
+print(s.v)
+
+# subclasses add slots, or get a dict
+class B(A):
+    __slots__ = ("z",)
+bb = B(1)
+bb.y = 2
+bb.z = 3
+print(bb.total(), bb.z)
+try:
+    bb.w = 4
+except AttributeError:
+    print("AttributeError")
+
+class C(A):
+    pass
+c = C(1)
+c.y = 2
+c.w = 4
+print(c.total(), c.w)
+
+# __dict__ in __slots__ allows other attributes
+class D:
+    __slots__ = ("a", "__dict__")
+d = D()
+d.a = 1
+d.b = 2
+print(d.a, d.b)
+
+# a subclass attribute hides a slot of the base
+class E(A):
+    y = 100
+e = E(1)
+print(e.y, e.total())
+
+# conflict with a class variable
+try:
+    class F:
+        __slots__ = ("x",)
+        x = 1
+except ValueError:
+    print("ValueError")
+
+# repeated access from the same code
+def f(o):
+    for i in range(5):
+        o.x = o.x + i
+    return o.x
+print(f(A(0)), f(B(1)), f(c))
+
+# slots with a native base class
+class L(list):
+    __slots__ = ("tag",)
+l = L([1, 2])
+l.tag = "t"
+l.append(3)
+print(l.tag, len(l))
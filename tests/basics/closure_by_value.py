@@ -0,0 +1,88 @@
+# closed over params that are never rebound, and ones that are
+
+def adder(n):
+    return lambda x: x + n
+print(adder(3)(4), [adder(i)(1) for i in range(3)])
+
+def make(cb, *args, **kw):
+    def inner(x):
+        return cb(x, *args, **kw)
+    return inner
+print(make(lambda a, b, c=0: a + b + c, 10, c=100)(1))
+
+# rebound after the closure is made: the closure sees the new value
+def f(a):
+    g = lambda: a
+    a = 2
+    return g()
+print(f(1))
+
+def f(a):
+    g = lambda: a
+    a += 5
+    return g()
+print(f(1))
+
+def f(a):
+    g = lambda: a
+    for a in range(3):
+        pass
+    return g()
+print(f(1))
+
+def f(a):
+    g = lambda: a
+    del a
+    try:
+        g()
+    except NameError:
+        print('NameError')
+f(1)
+
+# rebound by a child
+def f(a):
+    def g():
+        nonlocal a
+        a = 7
+    g()
+    return a, (lambda: a)()
+print(f(1))
+
+def f(a):
+    def g():
+        def h():
+            nonlocal a
+            a += 1
+        h()
+        return a
+    return g(), a
+print(f(1))
+
+# passed down through a middle function
+def f(a, b):
+    def g():
+        def h():
+            return a + b
+        return h
+    return g()()
+print(f(1, 2))
+
+# a mix of a by-value param, a rebound param and a local
+def f(a, b):
+    c = 10
+    b = b * 2
+    return lambda: (a, b, c)
+print(f(1, 2)())
+
+# a generator closing over a param
+def f(n):
+    return (i * n for i in range(3))
+print(list(f(5)))
+
+# a class body closing over a param
+def f(a):
+    class C:
+        def m(self):
+            return a
+    return C().m()
+print(f('x'))
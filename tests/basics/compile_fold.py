@@ -0,0 +1,73 @@
+# test constant folding and dead code elimination in the compiler;
+# the results must be the same as evaluating at run time
+
+# strings, bytes and tuples
+print("ab" + "cd", "x" * 3, 3 * "y", b"a" + b"b", b"z" * 2)
+print((1, 2) + (3,), (1,) * 3, ("a", b"b", None, True, False, ...))
+print(((1, 2), (3, (4, 5))))
+print("%s-%d" % ("a", 1))
+print("a" < "b", (1, 2) == (1, 2), not "", not (1,))
+
+# long chains, and mixed small and big ints
+print(1 + 2 + 3 - 4, 1 | 2 | 4, 7 & 3 & 1, 1 ^ 3 ^ 7)
+print(1 << 40 >> 30, 12345678901234567890 + 1, -(12345678901234567890))
+
+# big results that are left to run time
+print(len("a" * 1000), 2 ** 100 > 0, 1 << 100 > 0)
+
+# operations that raise are not folded
+try:
+    1 % 0
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+try:
+    "a" + 1
+except TypeError:
+    print("TypeError")
+try:
+    ~"a"
+except TypeError:
+    print("TypeError")
+
+# a constant tuple is immutable and can be used again
+def f():
+    return (1, 2, 3)
+print(f(), f() == f())
+
+# dead branches
+if __debug__:
+    print("debug")
+if not __debug__:
+    print("not debug")
+if None:
+    print("None")
+else:
+    print("not None")
+print(__debug__)
+
+# unreachable code; variables in it still belong to the function
+x = "global"
+def g():
+    return 1
+    x = 2
+    print("unreachable")
+print(g())
+def h():
+    try:
+        return x
+        x = 1
+    except NameError:
+        return "NameError"
+print(h())
+for i in range(3):
+    if i == 1:
+        continue
+        print("unreachable")
+    print(i)
+    break; print("unreachable")
+def k():
+    raise ValueError; print("unreachable")
+try:
+    k()
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,68 @@
+try:
+    from collections import deque
+except ImportError:
+    try:
+        from _collections import deque
+    except ImportError:
+        print("SKIP")
+        import sys
+        sys.exit()
+
+# unbounded: grows as needed, with both ends in use
+d = deque()
+print(len(d), bool(d))
+for i in range(10):
+    d.append(i)
+for i in range(1, 4):
+    d.appendleft(-i)
+print(list(d), len(d), bool(d))
+print(d[0], d[-1], d[5])
+d[1] = 'x'
+print(d[1])
+print(d.pop(), d.popleft(), list(d))
+print(d.maxlen)
+
+# drain from the left while adding on the right, so the items wrap round
+d = deque([1, 2, 3])
+for i in range(20):
+    d.append(d.popleft() + 3)
+print(list(d))
+
+# bounded: adding to a full deque drops from the other end
+w = deque((), 3)
+for i in range(7):
+    w.append(i)
+print(list(w), sum(w), w.maxlen)
+w.appendleft(10)
+print(list(w))
+w.extend([20, 21])
+print(list(w))
+
+w = deque([1, 2, 3, 4, 5], maxlen=2)
+print(list(w))
+
+z = deque(maxlen=0)
+z.append(1)
+z.appendleft(2)
+print(list(z))
+
+d.clear()
+print(list(d), len(d))
+
+# iteration
+print([x * 2 for x in deque(range(5))])
+print(3 in deque(range(5)))
+
+for f in (deque().pop, deque().popleft):
+    try:
+        f()
+    except IndexError:
+        print('IndexError')
+try:
+    deque()[0]
+except IndexError:
+    print('IndexError')
+try:
+    deque((), -1)
+except ValueError:
+    print('ValueError')
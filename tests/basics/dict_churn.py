@@ -0,0 +1,26 @@
+# test many insertions and deletions of keys of mixed types in dicts
+
+seed = 12345
+def rnd(n):
+    global seed
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff
+    return seed % n
+
+for trial in range(20):
+    d = {}
+    n_found = 0
+    for step in range(200):
+        op = rnd(10)
+        k = rnd(60)
+        if rnd(3) == 0:
+            k = 'k%d' % k
+        elif rnd(5) == 0:
+            k = k * 1000003
+        if op < 5:
+            d[k] = step
+        elif op < 8:
+            if k in d:
+                del d[k]
+        else:
+            n_found += k in d
+    print(len(d), n_found, sum(d.values()), sorted(str(k) for k in d)[:3])
@@ -0,0 +1,65 @@
+# for loops that unpack the items of dict.items()
+
+d = {1: 'a', 2: 'b', 3: 'c'}
+print(sorted([(k, v) for k, v in d.items()]))
+l = []
+for k, v in d.items():
+    l.append((k, v))
+print(sorted(l))
+
+# break, continue and else
+for k, v in d.items():
+    if k == 2:
+        continue
+    if v == 'z':
+        break
+else:
+    print('else')
+
+# nested loops over the same dict
+n = 0
+for k1, v1 in d.items():
+    for k2, v2 in d.items():
+        n += k1 * k2
+print(n)
+
+# an iterator that was partly used
+it = iter({'x': 1}.items())
+for k, v in it:
+    print(k, v)
+for k, v in it:
+    print('not reached')
+
+# the view can be walked more than once
+view = d.items()
+print(sorted(k for k, v in view), sorted(v for k, v in view))
+
+# items unpacked into the wrong number of values
+for t in (1, 3):
+    try:
+        if t == 1:
+            for a, in d.items():
+                pass
+        else:
+            for a, b, c in d.items():
+                pass
+    except ValueError:
+        print('ValueError')
+
+# nested unpacking, and targets that aren't plain names
+for k, (a, b) in {1: (2, 3)}.items():
+    print(k, a, b)
+o = [0, 0]
+for o[0], o[1] in {4: 5}.items():
+    print(o)
+
+# keys and values
+print(sorted(k for k in d.keys()), sorted(v for v in d.values()))
+
+# empty dict and a dict emptied by deletions
+for k, v in {}.items():
+    print('not reached')
+e = {1: 2}
+del e[1]
+for k, v in e.items():
+    print('not reached')
@@ -0,0 +1,42 @@
+# test insertion order of dicts, for builds with compact maps
+
+d = {}
+for k in (30, 10, 20):
+    d[k] = None
+if list(d) != [30, 10, 20]:
+    print("SKIP")
+    raise SystemExit
+
+# order is kept across deletion and reinsertion
+d = {}
+for i in range(20):
+    d[str(i)] = i
+del d["5"]
+del d["0"]
+d["5"] = 50
+d["3"] = 30
+print(list(d.keys()))
+print(list(d.values()))
+
+# popitem removes the last item
+print(d.popitem(), d.popitem(), len(d))
+
+# churn with a fixed number of live keys
+d = {}
+for i in range(1000):
+    d[i] = i
+    if i >= 8:
+        del d[i - 8]
+print(list(d.items()))
+
+# big dicts, needing wider index entries
+for n in (100, 300):
+    d = {}
+    for i in range(n):
+        d[i * 7] = i
+    print(len(d), all(d[i * 7] == i for i in range(0, n, 13)), (n * 7) in d)
+    print(list(d)[:5], list(d)[-3:])
+
+# copy keeps the order
+d = {"b": 1, "a": 2, "c": 3}
+print(list(d.copy()))
@@ -0,0 +1,39 @@
+# dicts and sets built from things that know their length
+
+d = dict([(i, i * i) for i in range(50)])
+print(len(d), d[0], d[49])
+
+d2 = dict(d)
+print(len(d2), d2 == d)
+
+d2.update(zip(range(40, 90), range(50)))
+print(len(d2), d2[45], d2[89])
+
+d3 = dict(a=1, b=2, c=3)
+d3.update(d3)
+print(sorted(d3.items()))
+
+# duplicate keys overestimate the size needed
+d4 = dict([(1, 2)] * 30)
+print(d4)
+
+# a length hint that is wrong must still give the right result
+class It:
+    def __init__(self, n):
+        self.n = n
+    def __iter__(self):
+        return self
+    def __next__(self):
+        self.n -= 1
+        if self.n < 0:
+            raise StopIteration
+        return self.n
+print(sorted(set(It(10))))
+
+s = set(range(100))
+print(len(s), 0 in s, 99 in s, 100 in s)
+s.update(range(50, 150))
+print(len(s))
+s = set([1] * 20)
+print(s)
+print(sorted({1, 2, 3}.union(range(5))))
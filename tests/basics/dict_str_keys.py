@@ -0,0 +1,20 @@
+# dict with many str keys, mixing interned and non-interned strings of
+# various lengths (the hash is computed a word at a time on some ports)
+
+d = {}
+for i in range(400):
+    d['k%d' % i] = i
+    d['a_longer_key_%d_with_a_tail' % i] = -i
+print(len(d))
+print(all(d['k%d' % i] == i for i in range(400)))
+print(all(d['a_longer_key_%d_with_a_tail' % i] == -i for i in range(400)))
+
+# keys that are also identifiers (qstrs) hash the same as built strings
+d = {'append': 1, '__init__': 2, 'x': 3, '': 4}
+for k in ('app' + 'end', '__' + 'init__', 'x', 'x'[:0]):
+    print(k, d[k], hash(k) == hash(str(k.encode(), 'utf-8')))
+
+# str and bytes of the same length ending at every position within a word
+for n in range(9):
+    s = 'abcdefgh'[:n]
+    print(n, hash(s) == hash(''.join(list(s))), hash(s.encode()) == hash(bytes(s, 'ascii')))
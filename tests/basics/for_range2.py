@@ -0,0 +1,70 @@
+# test the special handling of for-range loops: the counter, <end>, the step
+
+# negative and larger steps
+for i in range(10, 0, -3):
+    print(i)
+for i in range(0, 10, 4):
+    print(i)
+for i in range(5, 5):
+    print(i)
+
+# the loop variable keeps its last value, or isn't assigned if never run
+for j in range(3):
+    pass
+print(j)
+for k in range(3, 3):
+    pass
+try:
+    k
+except NameError:
+    print('NameError')
+
+# non-constant end, evaluated once
+def get_end():
+    print('get_end')
+    return 3
+for i in range(get_end()):
+    print(i)
+
+# assigning to the loop variable or end in the body doesn't change the loop
+n = 3
+for i in range(n):
+    n = 10
+    print(i)
+    i = 100
+
+# break, continue and else
+for i in range(10):
+    if i == 1:
+        continue
+    if i == 4:
+        break
+    print(i)
+else:
+    print('not reached')
+for i in range(2):
+    print(i)
+else:
+    print('else')
+
+# nested loops, and a loop in a function
+for i in range(2):
+    for j in range(2, 0, -1):
+        print(i, j)
+def f(n):
+    l = []
+    for i in range(n):
+        l.append(i)
+    return l
+print(f(4))
+
+# crossing into, and starting from, big integers
+big = 1 << 80
+for i in range(big - 2, big + 1):
+    print(i)
+for i in range(-big, -big - 3, -1):
+    print(i)
+t = 0
+for i in range(2 ** 62 - 3, 2 ** 62 + 3):
+    t += i
+print(t)
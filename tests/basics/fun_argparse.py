@@ -0,0 +1,58 @@
+# test argument parsing of builtin functions that take keyword arguments
+
+# positional only, keywords only, and mixed
+print(list(enumerate([1, 2])))
+print(list(enumerate([1, 2], 3)))
+print(list(enumerate([1, 2], start=3)))
+print(list(enumerate(iterable=[1, 2], start=3)))
+print(list(enumerate(start=3, iterable=[1, 2])))
+
+# keywords from a dict
+print(list(enumerate(**{'iterable': [1, 2], 'start': 4})))
+print(list(enumerate([1, 2], **{'start': 5})))
+
+l = [3, 1, 2]
+l.sort(reverse=True)
+print(l)
+l.sort(key=lambda x: -x, reverse=True)
+print(l)
+l.sort(**{'reverse': True})
+print(l)
+
+# missing required argument
+try:
+    enumerate()
+except TypeError:
+    print('TypeError')
+try:
+    enumerate(start=1)
+except TypeError:
+    print('TypeError')
+
+# too many positional arguments
+try:
+    enumerate([], 1, 2)
+except TypeError:
+    print('TypeError')
+
+# keyword-only argument given positionally
+try:
+    l.sort(None)
+except TypeError:
+    print('TypeError')
+
+# unknown keyword
+try:
+    enumerate([], stop=1)
+except TypeError:
+    print('TypeError')
+try:
+    l.sort(**{'foo': 1})
+except TypeError:
+    print('TypeError')
+
+# positional argument given again as a keyword
+try:
+    enumerate([], iterable=[])
+except TypeError:
+    print('TypeError')
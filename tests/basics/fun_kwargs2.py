@@ -0,0 +1,52 @@
+# keyword arguments matched repeatedly, in different orders
+
+def f(a, b, c):
+    return a, b, c
+
+for i in range(3):
+    print(f(a=i, b=2, c=3))
+    print(f(c=i, b=2, a=1))
+    print(f(1, c=i, b=2))
+
+# same keyword at a different position in another function
+def g(c, a, b=10):
+    return a, b, c
+
+for i in range(3):
+    print(g(a=i, c=5))
+    print(f(a=i, b=2, c=3))
+
+# keywords that match and keywords that go to **kwargs
+def h(x, y=0, **kw):
+    return x, y, sorted(kw.items())
+
+for i in range(2):
+    print(h(x=i))
+    print(h(z=1, x=i, w=2))
+    print(h(1, y=2, q=3))
+
+# all arguments given, including keyword-only ones
+def k(a, *, b, c=3):
+    return a, b, c
+
+print(k(b=2, a=1))
+print(k(c=0, b=2, a=1))
+try:
+    k(a=1)
+except TypeError:
+    print('TypeError')
+
+# errors are still detected after the names have been seen
+for i in range(2):
+    try:
+        f(1, a=2, b=3)
+    except TypeError:
+        print('TypeError')
+    try:
+        f(a=1, b=2)
+    except TypeError:
+        print('TypeError')
+    try:
+        f(a=1, b=2, c=3, d=4)
+    except TypeError:
+        print('TypeError')
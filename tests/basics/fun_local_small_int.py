@@ -0,0 +1,134 @@
+# test operations between a local and a small int constant, which the
+# bytecode emitter may fuse into a single opcode
+
+def arith(x):
+    print(x + 1, x - 1, x + 127, x - 128, x * 3, x // 2, x % 7, x ** 2)
+
+arith(0)
+arith(-5)
+arith(100)
+arith((1 << 62) - 1)
+arith(-(1 << 62))
+arith(1 << 62)
+arith(True)
+
+def bitwise(x):
+    print(x | 1, x ^ 5, x & 6, x << 2, x >> 1)
+
+bitwise(0)
+bitwise(100)
+bitwise((1 << 62) - 1)
+bitwise(1 << 62)
+
+def cmp(x):
+    print(x < 1, x > 1, x == 1, x <= 1, x >= 1, x != 1)
+    print(x < -100, x > -100, x == -100)
+
+cmp(0)
+cmp(1)
+cmp(2)
+cmp(-100)
+cmp(1.5)
+cmp(1 << 100)
+cmp(-(1 << 62))
+
+# store back to the same local
+def inplace(x):
+    x += 1
+    print(x)
+    x -= 100
+    print(x)
+    x = x * 2
+    print(x)
+    y = x + 3
+    print(x, y)
+
+inplace(0)
+inplace(1 << 62)
+inplace(2.5)
+
+# non-int left-hand sides
+def other(x):
+    return x * 3
+
+print(other('ab'))
+print(other([1]))
+print(other((1, 2)))
+
+# loops and conditional jumps
+def loop(n):
+    i = 0
+    total = 0
+    while i < n:
+        if i == 3:
+            total -= 1
+        elif i != 5:
+            total += i
+        i += 1
+    return total
+
+print(loop(0))
+print(loop(10))
+
+def loop_false(n):
+    i = 10
+    while not i <= n:
+        i -= 1
+    return i
+
+print(loop_false(4))
+
+# comparison result used as a value
+def cmp_value(x):
+    a = x < 3
+    return a, not x > 3
+
+print(cmp_value(2), cmp_value(5))
+
+# local referenced before assignment
+def unbound():
+    try:
+        x + 1
+    except NameError:
+        print('NameError')
+    try:
+        y += 1
+    except NameError:
+        print('NameError')
+    try:
+        while z < 1:
+            pass
+    except NameError:
+        print('NameError')
+    x = y = z = 0
+
+unbound()
+
+# type errors
+def bad(x):
+    try:
+        x + 1
+    except TypeError:
+        print('TypeError')
+    try:
+        x += 1
+    except TypeError:
+        print('TypeError')
+    try:
+        if x < 1:
+            pass
+    except TypeError:
+        print('TypeError')
+
+bad(None)
+
+# many locals, so some have large local numbers
+def many():
+    a0 = a1 = a2 = a3 = a4 = a5 = a6 = a7 = a8 = a9 = 0
+    b0 = b1 = b2 = b3 = b4 = b5 = b6 = b7 = b8 = b9 = 0
+    b9 += 5
+    while b9 < 8:
+        b9 += 1
+    return b9 - 2
+
+print(many())
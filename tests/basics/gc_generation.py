@@ -0,0 +1,28 @@
+# test that minor collections keep objects reachable only from old objects
+
+try:
+    import gc
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# make an old container
+old = []
+d = {}
+gc.collect()
+
+# store young objects into the old containers, then do a minor collection
+for i in range(100):
+    old.append([i, str(i)])
+    d[i] = (i, [i])
+gc.collect(0)
+
+# allocate more to reuse any incorrectly freed blocks
+junk = [[j] for j in range(200)]
+gc.collect(0)
+junk = None
+gc.collect()
+
+print(sum(x[0] for x in old), all(x[1] == str(x[0]) for x in old))
+print(sum(v[1][0] for v in d.values()))
@@ -0,0 +1,46 @@
+# the value returned by a generator is given to StopIteration raised by next()
+
+def gen():
+    yield 1
+    return 42
+
+g = gen()
+print(next(g))
+try:
+    next(g)
+except StopIteration as e:
+    print(e.args)
+# the generator is finished, so the value is not seen again
+try:
+    next(g)
+except StopIteration as e:
+    print(e.args)
+
+# returning None gives a plain StopIteration
+def gen2():
+    yield 1
+
+g = gen2()
+next(g)
+try:
+    next(g)
+except StopIteration as e:
+    print(e.args)
+
+# iterating doesn't expose the return value
+print(list(gen()))
+for x in gen():
+    print(x)
+
+# yield from gets the return value of the inner generator
+def outer():
+    r = yield from gen()
+    print("inner returned", r)
+    return r + 1
+
+g = outer()
+print(next(g))
+try:
+    next(g)
+except StopIteration as e:
+    print(e.args)
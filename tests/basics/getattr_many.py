@@ -0,0 +1,16 @@
+# test creating and looking up many attribute names made at runtime
+
+class A:
+    pass
+
+a = A()
+names = ["attr_%d" % i for i in range(300)]
+for i, n in enumerate(names):
+    setattr(a, n, i)
+print(sum(getattr(a, n) for n in names))
+print(hasattr(a, "attr_299"), hasattr(a, "attr_300"))
+
+# names equal to builtin ones
+setattr(a, "append", 1)
+setattr(a, "".join(["ke", "ys"]), 2)
+print(a.append, a.keys)
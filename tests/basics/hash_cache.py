@@ -0,0 +1,39 @@
+# test that hashes of str/bytes/tuple objects are consistent when they are
+# computed lazily and cached in the object
+
+import sys
+
+# const str objects must hash the same as equal heap/interned strings
+s = "".join(list(sys.version))
+print(hash(sys.version) == hash(s))
+d = {s: 1}
+print(sys.version in d, d[sys.version])
+
+# long dynamically built keys, looked up repeatedly
+keys = ["key" * 20 + str(i) for i in range(20)]
+d = {}
+for k in keys:
+    d[k] = len(k)
+for _ in range(3):
+    print(sum(d[k] for k in keys))
+print(("key" * 20 + "7") in d, ("key" * 20 + "x") in d)
+
+# bytes
+b = bytes(range(40))
+d = {b: 1}
+print(bytes(range(40)) in d, b[1:] in d)
+print(hash(b) == hash(bytes(range(40))))
+
+# tuples, hashed many times and built freshly
+t = (1, "abc" * 10, (2, 3))
+d = {t: "x"}
+for _ in range(3):
+    print(d[t], d[(1, "abc" * 10, (2, 3))])
+print(hash(t) == hash((1, "abc" * 10, (2, 3))))
+print((1, "abc" * 10, (2, 4)) in d)
+
+# unhashable item in tuple
+try:
+    hash((1, []))
+except TypeError:
+    print("TypeError")
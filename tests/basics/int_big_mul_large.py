@@ -0,0 +1,29 @@
+# test multiplication, division and string conversion of large ints
+# (large enough to use any sub-quadratic algorithms)
+
+a = 3 ** 2000 - 1
+b = 7 ** 1500 + 12345
+p = a * b
+print(p % 1000000007, p // a == b, p % b, p - b * a)
+print((2 ** 4000 - 1) * (2 ** 2000 + 1) == 2 ** 6000 + 2 ** 4000 - 2 ** 2000 - 1)
+print((-a) * b == -p, a * (-b) == -p, a * a == a ** 2)
+
+# unbalanced sizes
+c = 5 ** 100
+print(p * c // c == p, (a * c) % 999999937)
+
+# divisors with a top digit that has its high bit set
+for n in (1, 2, 31, 32, 33, 64):
+    d = (1 << (32 * n)) - 3
+    x = (1 << (32 * 40)) - 1
+    print(n, (x * d) // d == x, (x * d + 5) % d)
+
+# conversion to and from strings
+s = str(p)
+print(len(s), s[:20], s[-20:], int(s) == p)
+print(int('0' * 2000 + s) == p, int('-' + s) == -p)
+print(int(hex(p), 16) == p, int(oct(p), 8) == p, int(bin(p), 2) == p)
+print(str(10 ** 1000)[:5], len(str(10 ** 1000)))
+
+# thousands separators
+print('{:,}'.format(10 ** 20), '{:,}'.format(-10 ** 23), '{:,}'.format(123456))
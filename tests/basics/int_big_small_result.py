@@ -0,0 +1,16 @@
+# long-int operations whose results fit back into a small int
+
+t = 1 << 80
+for i in range(-3, 4):
+    print((t + i) - t, (t * i) // t, (t + i) % t, -(t + i) + t)
+
+# small-int overflow promotes correctly
+x = 1 << 30
+print(x * x, x << 40, 3 ** 50, -x * x)
+for i in range(5):
+    print(i * 1234567891011 * 1000 // 1000000)
+
+# mixed small/big division and modulo signs
+for a in (7, -7, (1 << 70) + 5, -(1 << 70) - 5):
+    for b in (3, -3, 1 << 65, -(1 << 65)):
+        print(a // b, a % b)
@@ -0,0 +1,38 @@
+# test binary ops between two small ints, including results that overflow
+
+def test(a, b):
+    print(a + b, a - b, b - a)
+    print(a | b, a ^ b, a & b)
+    print(a < b, a > b, a == b, a <= b, a >= b, a != b)
+
+test(0, 0)
+test(1, 2)
+test(-7, 5)
+test(-8, -3)
+test(1000, 1000)
+
+# values around the small-int limits of 32-bit and 64-bit builds
+def test_arith(a, b):
+    print(a + b, a - b, b - a)
+    print(a < b, a > b, a == b, a <= b, a >= b, a != b)
+
+for n in (30, 31, 62, 63):
+    a = (1 << n) - 1
+    b = -(1 << n)
+    test(a, 1)
+    test(a, a)
+    test_arith(b, -1)
+    test_arith(b, 1)
+    test_arith(a, b)
+
+# in-place variants
+a = 1 << 29
+a += a
+a += a
+a -= 1
+print(a)
+a = 6
+a |= 9
+a ^= 3
+a &= 5
+print(a)
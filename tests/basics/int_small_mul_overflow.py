@@ -0,0 +1,28 @@
+# test small int multiply and power at the boundary of the small int range
+
+# products either side of 2**30, 2**31, 2**46, 2**47, 2**62 and 2**63
+for bits in (30, 31, 46, 47, 62, 63):
+    half = 1 << (bits // 2)
+    for a in (half - 1, half, half + 1):
+        for b in (a - 1, a, a + 1, 1 << (bits - bits // 2)):
+            for sa, sb in ((1, 1), (1, -1), (-1, 1), (-1, -1)):
+                print(bits, (sa * a) * (sb * b))
+
+# small operand times large operand
+for x in (1 << 29, (1 << 30) - 1, 1 << 45, (1 << 46) - 1, 1 << 61):
+    for m in (-3, -2, -1, 0, 1, 2, 3):
+        print(x * m, m * x, -x * m)
+
+# powers that just fit and just overflow
+for base in (2, -2, 3, -3, 7, 10, 255):
+    for e in range(70):
+        print(base, e, base ** e)
+
+# square-and-multiply with an odd exponent after squaring overflows
+print(46341 ** 2, 46341 ** 3, 3037000500 ** 2)
+
+# in-place multiply
+x = 1
+for i in range(100):
+    x *= 3
+print(x)
@@ -0,0 +1,78 @@
+# map, filter, zip and enumerate over lists and tuples, and unpacking their
+# items in a for loop
+
+l = [10, 20, 30]
+t = ('a', 'b', 'c', 'd')
+
+for i, x in enumerate(l):
+    print(i, x)
+for i, x in enumerate(t, 5):
+    print(i, x)
+for a, b in zip(l, t):
+    print(a, b)
+for a, b, c in zip(l, t, range(100)):
+    print(a, b, c)
+for a, in zip(t):
+    print(a)
+print(list(map(lambda a, b: a + b, l, l)), list(filter(None, (0, 1, '', 'x'))))
+print(list(map(lambda *a: sum(a), l, l, l, l, l)))
+
+# enumerate of a pair unpacked into three values
+try:
+    for a, b, c in enumerate(l):
+        pass
+except ValueError:
+    print('ValueError')
+# nested unpacking of enumerate
+for i, (a, b) in enumerate(zip(l, t)):
+    print(i, a, b)
+
+# the list changing while it is walked
+l = [1, 2, 3]
+for i, x in enumerate(l):
+    if i == 0:
+        l.append(4)
+    print(i, x)
+l = [1, 2, 3, 4, 5]
+for i, x in enumerate(l):
+    if i == 1:
+        del l[2:]
+    print(i, x)
+
+# an iterator that was partly used
+e = enumerate([5, 6, 7])
+next(e)
+for i, x in e:
+    print(i, x)
+z = zip([1, 2, 3], (4, 5, 6))
+print(next(z), list(z))
+
+# a source that is shared
+it = iter(range(6))
+for a, b in zip(it, it):
+    print(a, b)
+l = [1, 2]
+print(list(zip(l, l)))
+
+# zip that stops part way through an item
+it = iter([1, 2, 3])
+for a, b in zip(it, [7]):
+    print(a, b)
+print(list(it))
+
+# loops run to exhaustion, over iterators that the fused unpacking handles
+# and ones it hands back to the plain iteration
+def count(it):
+    n = 0
+    for a, b in it:
+        n += 1
+    return n, a, b
+print(count([(1, 2), (3, 4)]), count(iter(((5, 6),))), count(x for x in ('ab', 'cd')))
+print(count(enumerate('xyz')), count(zip('ab', 'cd')), count({1: 2, 3: 4}.items()))
+print(count(enumerate([(1, 2)])) == (1, 0, (1, 2)), count({1: (2, 3)}.values()))
+for a, b, c in zip('ab', 'cd', 'ef'):
+    pass
+print(a, b, c)
+for (a, b), in zip([(1, 2), (3, 4)]):
+    pass
+print(a, b)
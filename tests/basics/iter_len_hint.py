@@ -0,0 +1,39 @@
+# constructing containers from iterators whose length is known in advance
+
+for r in (range(5), range(0), range(10, 0, -3), range(1, 10, 4), range(5, 10, -1)):
+    print(list(iter(r)), tuple(iter(r)))
+
+# partially consumed iterators
+for seq in ([1, 2, 3, 4], (1, 2, 3, 4), {1: 2, 3: 4, 5: 6}, range(4)):
+    it = iter(seq)
+    next(it)
+    print(sorted(list(it)))
+it = iter({1: 2, 3: 4}.items())
+next(it)
+print(tuple(it))
+
+# map and zip stop at the shortest iterable
+print(list(map(lambda x, y: x + y, [1, 2, 3], (4, 5))))
+print(tuple(zip(range(3), "abcd", iter([7, 8, 9, 10]))))
+print(tuple(zip()))
+print(list(map(abs, (x for x in (-1, -2)))))
+
+# bytes, bytearray and dict from iterators
+print(bytes(iter(range(65, 70))), bytearray(map(lambda x: x + 1, b"abc")))
+print(bytes(zip()), bytearray(iter([])))
+print(sorted(dict.fromkeys(iter([3, 1, 2]), 0).items()))
+
+# extending with a hinted iterator
+l = [0]
+l.extend(iter((1, 2)))
+l.extend(map(lambda x: x * 2, range(3)))
+print(l)
+
+# an object whose length disagrees with its iteration
+class Liar:
+    def __len__(self):
+        return 1
+    def __iter__(self):
+        return iter(range(20))
+print(list(Liar()), tuple(Liar()))
+print(bytes(Liar()), bytearray(Liar()))
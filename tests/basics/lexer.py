@@ -38,3 +38,14 @@ def a(x):
                if x:
                 print(x)
 a(1)
+
+# runs of identifier, digit and string characters, up to the end of input
+abcdefgh = 1
+print(eval("abcdefgh"))
+print(eval("abcdefgh\r\n"))
+print(eval("1234567890123"))
+print(eval("12345678e2"))
+print(eval("'abcdefgh'"))
+print(eval("'abc\\\\defgh' + \"ab'cd\""))
+print(eval("'''ab\ncdefgh\tij'''"))
+exec("x_1234567 = 'abcdefghijkl'\r\nprint(x_1234567)")
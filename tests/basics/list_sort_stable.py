@@ -0,0 +1,34 @@
+# test that sort is stable and adapts to runs already in order
+
+# records with equal keys keep their original order
+l = [(i * 37 % 10, i) for i in range(200)]
+print(sorted(l, key=lambda t: t[0]) == [t for k in range(10) for t in l if t[0] == k])
+print(sorted(l, key=lambda t: t[0], reverse=True) == [t for k in range(9, -1, -1) for t in l if t[0] == k])
+
+# runs: ascending, descending, and a sorted list with a few items appended
+for l in (list(range(1000)), list(range(1000, 0, -1)), list(range(500)) + [3, 1, 2], [5] * 300 + [4] * 300):
+    print(sorted(l) == sorted(l, key=lambda x: x), sorted(l)[:3], sorted(l)[-3:])
+
+# key function is called once per item
+n = [0]
+def key(x):
+    n[0] += 1
+    return -x
+l = list(range(500))
+l.sort(key=key)
+print(n[0], l[:3])
+
+# list is unchanged if a comparison raises
+class A:
+    def __init__(self, x):
+        self.x = x
+    def __lt__(self, other):
+        if self.x == 50 or other.x == 50:
+            raise ValueError
+        return self.x < other.x
+l = [A(i) for i in range(100, 0, -1)]
+try:
+    l.sort()
+except ValueError:
+    print('ValueError')
+print([a.x for a in l[:5]], len(l))
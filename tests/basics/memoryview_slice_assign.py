@@ -0,0 +1,69 @@
+# test memoryview slice assignment and cast
+try:
+    memoryview
+except:
+    import sys
+    print("SKIP")
+    sys.exit()
+try:
+    import array
+except ImportError:
+    import sys
+    print("SKIP")
+    sys.exit()
+
+# slice assignment writes through to the underlying buffer
+b = bytearray(b'0123456789')
+m = memoryview(b)
+m[2:4] = b'ab'
+print(b)
+
+# source overlapping the destination
+m[0:4] = m[2:6]
+print(b)
+m[4:8] = memoryview(b)[3:7]
+print(b)
+
+# assignment to a slice of a slice
+m[6:10][1:3] = bytearray(b'XY')
+print(b)
+
+# the length can't change
+try:
+    m[0:2] = b'xyz'
+except ValueError:
+    print('ValueError')
+
+# read-only memoryview
+mr = memoryview(b'abcd')
+try:
+    mr[0:2] = b'xy'
+except TypeError:
+    print('TypeError')
+
+# multi-byte items
+a = array.array('i', [1, 2, 3, 4])
+ma = memoryview(a)
+ma[1:3] = array.array('i', [20, 30])
+print(a, ma[1], len(ma))
+
+# cast
+mb = ma.cast('B')
+print(len(mb))
+mb[4:8] = ma.cast('B')[0:4]
+print(a)
+print(list(memoryview(bytearray(4)).cast('H')))
+mh = memoryview(bytearray(8))[2:6].cast('h')
+mh[0] = -2
+print(len(mh), list(mh))
+try:
+    memoryview(b'abc').cast('H')
+except TypeError:
+    print('TypeError')
+
+# bytearray slice assignment from itself that changes its size
+b = bytearray(b'abcdef')
+b[1:2] = b
+print(b)
+b[2:9] = b
+print(b)
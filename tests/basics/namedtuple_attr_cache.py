@@ -0,0 +1,33 @@
+# test that attribute loads from namedtuples work when the same load site
+# sees different types
+try:
+    from collections import namedtuple
+except ImportError:
+    from _collections import namedtuple
+
+A = namedtuple("A", ["x", "y", "z"])
+B = namedtuple("B", ["z", "y"])
+C = namedtuple("C", ["a", "b"])
+
+class D:
+    def __init__(self):
+        self.z = "D.z"
+
+def get_z(o):
+    return o.z
+
+for o in (A(1, 2, 3), A(4, 5, 6), B(7, 8), D(), A(9, 10, 11), B(12, 13)):
+    print(get_z(o))
+
+try:
+    get_z(C(1, 2))
+except AttributeError:
+    print("AttributeError")
+print(get_z(A(14, 15, 16)))
+
+# a namedtuple with many fields
+N = namedtuple("N", ["f%d" % i for i in range(300)])
+n = N(*range(300))
+print(n.f0, n.f5, n.f255, n.f256, n.f299)
+for i in range(3):
+    print(n.f299, n.f1)
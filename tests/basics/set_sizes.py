@@ -0,0 +1,43 @@
+# set operations where one operand is much bigger than the other
+
+small = {1, 5, 9}
+big = set(range(100))
+
+print(sorted(small & big), sorted(big & small))
+print(sorted(small.intersection(big)), sorted(big.intersection(small)))
+print(type(frozenset(small) & big), type(big & frozenset(small)))
+
+print(sorted(small - big), len(big - small))
+print(sorted({1, 200} - big), type(frozenset({1, 200}) - big))
+print(sorted(small.difference(big, {7})))
+
+print(small.issubset(big), big.issubset(small), small < big, big < small)
+print(big.issuperset(small), small >= big)
+print(small.isdisjoint(big), big.isdisjoint(small), {200}.isdisjoint(big))
+
+s = set(small)
+s.intersection_update(big)
+print(sorted(s))
+s = set(big)
+s.intersection_update(small)
+print(sorted(s))
+s = set(big)
+s.intersection_update({1, 2, 500})
+print(sorted(s))
+
+s = set(small)
+s.difference_update(big)
+print(s)
+s = {1, 2, 500}
+s.difference_update(big)
+print(s)
+s = set(big)
+s.difference_update(small)
+print(len(s), 1 in s, 2 in s)
+
+# the set must still work after removing in place
+s = set(range(20))
+s.intersection_update(set(range(10, 100)))
+s.add(3)
+s.add(15)
+print(sorted(s), 3 in s, 4 in s)
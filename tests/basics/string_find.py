@@ -21,3 +21,10 @@ print("0000".find('-1', 3))
 print("0000".find('1', 3))
 print("0000".find('1', 4))
 print("0000".find('1', 5))
+
+# long needles and haystacks
+s = 'abcdefghij' * 20 + 'needle in a haystack' + 'xyz' * 30
+print(s.find('needle in a haystack'), s.find('needle in a haystacks'))
+print(s.find('jabcdefghija'), s.rfind('jabcdefghija'), s.find('xyzxyzxyzxyz', 210))
+print(s.find('needle', 250), s.rfind('needle', 0, 205), s.rfind('needle'))
+print(('a' * 300 + 'b').find('a' * 20 + 'b'), ('ab' * 100).find('ba' * 40 + 'c'))
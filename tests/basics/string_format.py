@@ -124,3 +124,9 @@ if full_tests:
                         test_fmt(conv, fill, alignment, '', '', width, '', 's', str)
 
 # TODO Add tests for erroneous format strings.
+
+# literal text around and between fields
+print('{}:{}'.format('abc', 12))
+print('x = {!r}, y = {!s}; {{{}}}'.format('a', 'b', 3))
+print('{1}-{0}-{1} end'.format('p', 'q'))
+print('no fields here'.format(1))
@@ -86,3 +86,8 @@ try:
     print("%(foo)*s" % {"foo": "bar"})
 except TypeError:
     print("TypeError")
+
+# literal text around and between fields
+print('%s:%s' % ('abc', 12))
+print('x = %r, y = %s; 100%%' % ('a', 'b'))
+print('%s%s' % ('', 'end'))
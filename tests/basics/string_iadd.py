@@ -0,0 +1,35 @@
+# test += on str and bytes, which may append in place
+
+# building up a string in a loop
+s = ''
+for i in range(100):
+    s += str(i)
+print(len(s), s[:20], s[-20:])
+
+# earlier values must not change when a later one is appended to
+a = 'ab' + 'cd'
+b = a
+a += 'ef'
+c = a
+a += 'gh'
+print(a, b, c)
+
+# appending to an earlier value again must not change the later ones
+c += 'XY'
+print(a, b, c)
+b += '12'
+print(a, b, c)
+
+# hashing and comparing strings that share a buffer
+d = 'x' * 3
+d += 'y'
+e = d
+d += 'z'
+print(e == 'xxxy', e, hash(e) == hash('xxxy'), {e: 1}['xxxy'])
+
+# bytes
+x = b'ab' + b'c'
+y = x
+x += b'\x00d'
+x += bytearray(b'e')
+print(x, y)
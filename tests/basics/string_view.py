@@ -0,0 +1,51 @@
+# test slicing, splitting etc of long strings, which may share data with the original
+
+s = 'abcdefghijklmnopqrstuvwxyz' * 4
+t = s[3:90]
+print(t)
+print(len(t), t == s[3:90], hash(t) == hash(s[3:90]))
+print(t[2:70])
+print(t + '!')
+t += '!'
+print(t)
+
+# split/rsplit/strip/partition
+words = ' '.join(['word%d' % i * 8 for i in range(5)])
+print(words.split())
+print(words.split(' '))
+print(words.rsplit(' ', 2))
+print(('   ' + words + '   ').strip())
+print(('   ' + words + '   ').lstrip())
+print(('   ' + words + '   ').rstrip())
+print(words.partition(' '))
+print(words.rpartition(' '))
+
+# views as dict keys and in str functions that need a null terminator
+d = {}
+for w in words.split():
+    d[w] = len(w)
+print(sorted(d.items()))
+print(int(('1' * 40 + '2' * 40)[10:50]))
+print(float(('0.' + '5' * 60)[:40]))
+
+# bytes
+b = bytes(range(100))
+v = b[10:60]
+print(v)
+print(v[5:45])
+print(b.split(b'\x32'))
+print(str(v, 'latin-1') == str(b[10:60], 'latin-1'))
+print(bytes(str(v[:45], 'latin-1'), 'latin-1') == v[:45])
+
+# memoryview of a slice
+m = memoryview(v)
+print(len(m), m[0], m[-1])
+
+# original goes away, view stays valid
+def make():
+    return ('x' * 50 + 'y' * 50)[25:75]
+t = make()
+import gc
+gc.collect()
+x = ['z' * 200 for i in range(100)]
+print(t)
@@ -0,0 +1,49 @@
+# test pack_into, unpack_from and Struct objects
+
+try:
+    import ustruct as struct
+except:
+    import struct
+
+buf = bytearray(8)
+struct.pack_into('<hI', buf, 1, -2, 0x12345678)
+print(buf)
+print(struct.unpack_from('<hI', buf, 1))
+print(struct.unpack_from('<B', buf))
+print(struct.unpack_from('<B', buf, -1))
+struct.pack_into('>H', buf, -2, 0x0102)
+print(buf)
+
+# memoryview
+m = memoryview(buf)
+struct.pack_into('<4s', m, 2, b'abcd')
+print(buf, struct.unpack_from('<2s', m, 3))
+
+# Struct objects
+s = struct.Struct('<bH')
+print(s.size, s.format)
+print(s.pack(-1, 300))
+print(s.unpack(b'\x01\x02\x03'))
+s.pack_into(buf, 4, 5, 6)
+print(buf, s.unpack_from(buf, 4))
+print(struct.Struct('>3sI').unpack(b'xyz\0\0\0\x01'))
+
+# errors
+for f, args in ((struct.pack_into, ('<I', buf, 6, 1)),
+                (struct.unpack_from, ('<I', buf, 5)),
+                (struct.unpack_from, ('<I', buf, -9)),
+                (s.unpack_from, (b'\x01\x02', 0)),
+                (s.pack_into, (buf, 7, 1, 2)),
+                (struct.unpack, ('<I', b'12345')),
+                (struct.unpack, ('<I', b'123')),
+                (s.unpack, (b'\x01\x02\x03\x04',)),
+                (struct.pack, ('<bH', 1)),
+                (struct.pack, ('<bH', 1, 2, 3))):
+    try:
+        f(*args)
+    except:
+        print('error')
+try:
+    struct.pack_into('<I', b'1234', 0, 1)
+except TypeError:
+    print('TypeError')
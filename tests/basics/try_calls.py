@@ -0,0 +1,47 @@
+# exceptions raised and caught across nested calls to bytecode functions
+
+def leaf(n):
+    if n == 0:
+        raise ValueError(n)
+    return n
+def mid(n):
+    x = leaf(n)
+    return leaf(x - 1)
+def top(n):
+    try:
+        return mid(n)
+    except ValueError as e:
+        return ('caught', e.args)
+for i in range(3):
+    print(top(1), top(0))
+def deep(n):
+    if n == 0:
+        {}[1]
+    return deep(n - 1)
+def catcher():
+    r = 0
+    for i in range(5):
+        try:
+            deep(i * 3)
+        except KeyError:
+            r += 1
+        r += leaf(1)
+    return r
+print(catcher())
+def ret_then_raise():
+    a = leaf(5)
+    b = leaf(6)
+    try:
+        1/0
+    except ZeroDivisionError:
+        return a + b
+print(ret_then_raise())
+def fin(n):
+    try:
+        return deep(n)
+    finally:
+        print('fin', n)
+try:
+    fin(4)
+except KeyError:
+    print('ok')
@@ -1,10 +1,85 @@
-import time
+import sys
+import gc
+try:
+    import utime as time
+except ImportError:
+    import time
 
 
 ITERS = 20000000
 
-def run(f):
-    t = time.time()
-    f(ITERS)
-    t = time.time() - t
-    print(t)
+# Number of untimed and timed runs of the benchmark, and a factor applied to
+# its iteration count.  Taken from the command line ("-w N -r N -s F", as
+# passed by run-bench-tests), or set by configure() when run on a board.
+WARMUP = 0
+REPEAT = 1
+SCALE = 1
+
+def configure(warmup=0, repeat=1, scale=1):
+    global WARMUP, REPEAT, SCALE
+    WARMUP = warmup
+    REPEAT = repeat
+    SCALE = scale
+
+def _parse_argv():
+    args = sys.argv[1:]
+    for i in range(0, len(args) - 1, 2):
+        if args[i] == '-w':
+            configure(int(args[i + 1]), REPEAT, SCALE)
+        elif args[i] == '-r':
+            configure(WARMUP, int(args[i + 1]), SCALE)
+        elif args[i] == '-s':
+            configure(WARMUP, REPEAT, float(args[i + 1]))
+
+_parse_argv()
+
+try:
+    import pyb
+    def _start():
+        return pyb.micros()
+    def _elapsed(t):
+        return pyb.elapsed_micros(t) / 1000000
+except ImportError:
+    def _start():
+        return time.time()
+    def _elapsed(t):
+        return time.time() - t
+
+# bytes allocated and collections done so far, or -1 where not available
+def _counters():
+    try:
+        import micropython
+        n_alloc = micropython.mem_total()
+    except (ImportError, AttributeError):
+        n_alloc = -1
+    try:
+        n_gc = gc.stats().collections
+    except AttributeError:
+        n_gc = -1
+    return n_alloc, n_gc
+
+# time one call of f(n), and count what it allocates and collects
+def _measure(f, n):
+    gc.collect()
+    a0, g0 = _counters()
+    t = _start()
+    f(n)
+    t = _elapsed(t)
+    a1, g1 = _counters()
+    return t, a1 - a0 if a0 >= 0 else -1, g1 - g0 if g0 >= 0 else -1
+
+# Run f(iters) WARMUP + REPEAT times, and for each timed run print a line
+# with the time in seconds, the bytes allocated and the collections done.
+# The bytes allocated by the measurement itself are not counted.
+def run(f, iters=ITERS):
+    n = int(iters * SCALE)
+    if n < 1:
+        n = 1
+    overhead = _measure(lambda n: None, 0)[1]
+    for i in range(WARMUP):
+        f(n)
+    for i in range(REPEAT):
+        t, n_alloc, n_gc = _measure(f, n)
+        if n_alloc > 0:
+            n_alloc -= overhead
+        print(t, n_alloc, n_gc)
@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    for i in iter(range(num // 100)):
+        # factorial of 200, a 375 digit number
+        x = 1
+        for j in range(2, 200):
+            x *= j
+
+bench.run(test, 1000000)
@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    a = 3 ** 200
+    b = 7 ** 90 + 1
+    for i in iter(range(num)):
+        q = (a + i) // b
+        r = (a + i) % b
+        c = r * r + q
+
+bench.run(test, 300000)
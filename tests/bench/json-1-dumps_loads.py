@@ -0,0 +1,18 @@
+import bench
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+DATA = {
+    "name": "sensor", "id": 1234, "enabled": True, "scale": 0.5,
+    "tags": ["a", "bb", "ccc"],
+    "readings": [{"t": i, "v": i * 3, "ok": i % 2 == 0} for i in range(10)],
+}
+
+def test(num):
+    for i in iter(range(num)):
+        s = json.dumps(DATA)
+        d = json.loads(s)
+
+bench.run(test, 40000)
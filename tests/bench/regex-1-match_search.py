@@ -0,0 +1,18 @@
+import bench
+try:
+    import ure as re
+except ImportError:
+    import re
+
+LINE = "2015-06-26 12:34:56 INFO sensor=temp value=23 unit=C"
+
+def test(num):
+    date = re.compile(r"(\d+)-(\d+)-(\d+)")
+    field = re.compile(r"value=(\d+)")
+    for i in iter(range(num)):
+        m = date.match(LINE)
+        y = m.group(1)
+        m = field.search(LINE)
+        v = m.group(1)
+
+bench.run(test, 500000)
@@ -0,0 +1,9 @@
+import bench
+
+def test(num):
+    # a fixed pseudo-random list of 500 ints
+    l = [(i * 7919) % 1009 for i in range(500)]
+    for i in iter(range(num // 500)):
+        s = sorted(l)
+
+bench.run(test, 5000000)
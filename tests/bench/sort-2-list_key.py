@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    l = [(i * 7919) % 1009 for i in range(500)]
+    for i in iter(range(num // 500)):
+        s = sorted(l, key=lambda x: -x)
+
+bench.run(test, 3000000)
@@ -0,0 +1,7 @@
+import bench
+
+def test(num):
+    for i in iter(range(num)):
+        s = "%s: %d items at %.2f (%x)" % ("name", i, 1.25, i)
+
+bench.run(test, 500000)
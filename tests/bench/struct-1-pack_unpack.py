@@ -0,0 +1,12 @@
+import bench
+try:
+    import ustruct as struct
+except ImportError:
+    import struct
+
+def test(num):
+    for i in iter(range(num)):
+        b = struct.pack("<HhIf", i & 0xffff, -1, i, 1.5)
+        t = struct.unpack("<HhIf", b)
+
+bench.run(test, 800000)
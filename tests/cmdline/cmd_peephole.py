@@ -0,0 +1,15 @@
+# cmdline: -v -v
+# test the peephole optimisations of the bytecode emitter
+def f(a, b):
+    # a jump to "return None" is replaced by the return itself
+    if a:
+        if b:
+            a()
+    else:
+        b()
+
+def g(a, b):
+    # a jump to a jump goes straight to the final destination
+    for x in a:
+        if b:
+            x()
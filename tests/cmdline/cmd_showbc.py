@@ -10,7 +10,7 @@ def f():
 
     # constructing data
     a = 1
-    b = (1, 2)
+    b = (1, a)
     c = [1, 2]
     d = {1, 2}
     e = {}
@@ -109,12 +109,12 @@ def f():
     from a import b
     from a import *
 
-    # raise
-    raise
-    raise 1
+    # raise, guarded so that the code after it is reachable
+    if a: raise
+    if a: raise 1
 
     # return
-    return
+    if a: return
     return 1
 
 # functions with default args
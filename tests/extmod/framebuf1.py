@@ -0,0 +1,87 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+w = 5
+h = 16
+buf = bytearray(w * h // 8)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.MVLSB)
+
+# fill
+fbuf.fill(1)
+print(buf)
+fbuf.fill(0)
+print(buf)
+
+# put pixel
+fbuf.pixel(0, 0, 1)
+fbuf.pixel(4, 0, 1)
+fbuf.pixel(0, 15, 1)
+fbuf.pixel(4, 15, 1)
+print(buf)
+
+# clear pixel
+fbuf.pixel(4, 15, 0)
+print(buf)
+
+# get pixel
+print(fbuf.pixel(0, 0), fbuf.pixel(1, 1))
+
+# out of bounds pixels are ignored
+fbuf.pixel(-1, 0, 1)
+fbuf.pixel(5, 16, 1)
+print(fbuf.pixel(-1, 0))
+
+# lines and rectangles
+fbuf.fill(0)
+fbuf.hline(0, 1, w, 1)
+fbuf.vline(2, 0, h, 1)
+print(buf)
+fbuf.fill(0)
+fbuf.rect(0, 0, w, h, 1)
+print(buf)
+fbuf.fill(0)
+fbuf.fill_rect(1, 1, 3, 3, 1)
+fbuf.fill_rect(-10, -10, 11, 11, 1)
+print(buf)
+fbuf.fill(0)
+fbuf.line(0, 0, 4, 7, 1)
+print(buf)
+
+# text
+fbuf.fill(0)
+fbuf.text("hello", 0, 0, 1)
+print(buf)
+fbuf.text("hello", 0, 0, 0)
+print(buf)
+
+# RGB565 and blit
+buf2 = bytearray(4 * 3 * 2)
+fb2 = framebuf.FrameBuffer(buf2, 4, 3, framebuf.RGB565)
+fb2.fill(0x1234)
+fb2.pixel(1, 1, 0xffff)
+print(fb2.pixel(0, 0) == 0x1234, fb2.pixel(1, 1))
+src = framebuf.FrameBuffer(bytearray(2 * 2 * 2), 2, 2, framebuf.RGB565)
+src.fill(7)
+src.pixel(0, 0, 9)
+fb2.blit(src, 3, 2)
+fb2.blit(src, -1, -1, 9)
+print([fb2.pixel(x, y) for y in range(3) for x in range(4)])
+
+# blit between formats
+fbuf.fill(0)
+fbuf.blit(src, 0, 0)
+print(buf)
+
+# errors
+try:
+    framebuf.FrameBuffer(bytearray(1), 8, 8, framebuf.MVLSB)
+except ValueError:
+    print('ValueError')
+try:
+    framebuf.FrameBuffer(bytearray(8), 8, 8, 99)
+except ValueError:
+    print('ValueError')
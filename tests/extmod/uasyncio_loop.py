@@ -0,0 +1,72 @@
+try:
+    import _uasyncio
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+loop = _uasyncio.Loop()
+
+# tasks that yield None take turns
+def counter(n):
+    for i in range(3):
+        print("counter", n, i)
+        yield
+
+# tasks that yield an int sleep for that many ms
+def sleeper(name, ms):
+    print("start", name)
+    yield ms
+    print("woke", name)
+
+loop.create_task(counter(1))
+loop.create_task(counter(2))
+loop.call_later_ms(60, sleeper("later", 0))
+loop.create_task(sleeper("s40", 40))
+loop.create_task(sleeper("s20", 20))
+loop.run()
+print("done")
+
+# waiting for I/O
+try:
+    import usocket
+except ImportError:
+    usocket = None
+if usocket:
+    s = usocket.socket(usocket.AF_INET, usocket.SOCK_DGRAM)
+    def writer():
+        yield loop.wait_write(s)
+        print("writable")
+    loop.create_task(writer())
+    loop.run()
+    s.close()
+else:
+    print("writable")
+
+# wait_read and wait_write are only for the running task
+try:
+    loop.wait_read(0)
+except RuntimeError:
+    print("RuntimeError")
+
+# an exception in a task comes out of run()
+def bad():
+    yield
+    raise ValueError("bad")
+loop.create_task(bad())
+try:
+    loop.run()
+except ValueError as e:
+    print("ValueError", e)
+
+# stop() makes run() return, and a later run() carries on
+def stopper():
+    yield 5
+    loop.stop()
+    yield
+    print("after stop")
+loop.create_task(stopper())
+loop.run()
+print("stopped")
+loop.run()
+print("finished")
@@ -0,0 +1,21 @@
+try:
+    import ubinascii as binascii
+except ImportError:
+    import binascii
+
+for data in (b'', b'f', b'fo', b'foo', b'foob', b'fooba', b'foobar', bytes(range(256))):
+    enc = binascii.b2a_base64(data)
+    print(enc[:40])
+    print(binascii.a2b_base64(enc) == data)
+
+# characters outside the alphabet are skipped, pads end the data
+print(binascii.a2b_base64(b'Zm9v\nYmFy\n'))
+print(binascii.a2b_base64(b'Zm9vYg==ignored'))
+print(binascii.a2b_base64(b'Zm9vYmE='))
+print(binascii.a2b_base64('Zm9vYmFy'))
+
+for bad in (b'Zm9vY', b'Zm9vYg', b'Zm9vYg='):
+    try:
+        binascii.a2b_base64(bad)
+    except ValueError:
+        print('ValueError')
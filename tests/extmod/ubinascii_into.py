@@ -0,0 +1,21 @@
+# test the *_into variants, which are MicroPython extensions
+import ubinascii as binascii
+
+buf = bytearray(16)
+print(binascii.hexlify_into(b'\x01\xab', buf), buf[:4])
+print(binascii.unhexlify_into(b'0102abcd', buf), buf[:4])
+print(binascii.b2a_base64_into(b'foob', buf), buf[:9])
+print(binascii.a2b_base64_into(b'Zm9vYmFy\n', buf), buf[:6])
+
+# a memoryview lets the output go into the middle of a buffer
+buf = bytearray(b'xxxxxxxx')
+print(binascii.hexlify_into(b'\xff', memoryview(buf)[2:]), buf)
+
+small = bytearray(3)
+for f, data in ((binascii.hexlify_into, b'ab'), (binascii.unhexlify_into, b'01020304'),
+                (binascii.b2a_base64_into, b'a'), (binascii.a2b_base64_into, b'Zm9vYmFy')):
+    try:
+        f(data, small)
+    except ValueError:
+        print('ValueError')
+print(binascii.a2b_base64_into(b'Zm9v', small), small)
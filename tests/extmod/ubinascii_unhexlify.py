@@ -0,0 +1,17 @@
+try:
+    import ubinascii as binascii
+except ImportError:
+    import binascii
+
+print(binascii.unhexlify(b'0001020304050607'))
+print(binascii.unhexlify(b'7f80ff'))
+print(binascii.unhexlify(b'313233344142434461626364'))
+print(binascii.unhexlify(b'DEADbeef'))
+print(binascii.unhexlify('00ff'))
+print(binascii.unhexlify(binascii.hexlify(bytes(range(256)))) == bytes(range(256)))
+
+for bad in (b'0', b'0g', b'g0', b'123'):
+    try:
+        binascii.unhexlify(bad)
+    except ValueError:
+        print('ValueError')
@@ -0,0 +1,69 @@
+try:
+    import ucryptolib
+    from ubinascii import hexlify
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+def unhexlify(s):
+    return bytes(int(s[i:i + 2], 16) for i in range(0, len(s), 2))
+
+# FIPS-197 appendix C, for each key size
+pt = unhexlify(b'00112233445566778899aabbccddeeff')
+for klen in (16, 24, 32):
+    key = bytes(range(klen))
+    ct = ucryptolib.aes(key, ucryptolib.MODE_ECB).encrypt(pt)
+    print(hexlify(ct))
+    print(ucryptolib.aes(key, ucryptolib.MODE_ECB).decrypt(ct) == pt)
+
+# SP800-38A, CBC and CTR with AES-128
+key = unhexlify(b'2b7e151628aed2a6abf7158809cf4f3c')
+pt = unhexlify(b'6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51')
+iv = bytes(range(16))
+ct = ucryptolib.aes(key, ucryptolib.MODE_CBC, iv).encrypt(pt)
+print(hexlify(ct))
+print(ucryptolib.aes(key, ucryptolib.MODE_CBC, iv).decrypt(ct) == pt)
+
+# chaining carries over between calls
+aes = ucryptolib.aes(key, ucryptolib.MODE_CBC, iv)
+print(aes.encrypt(pt[:16]) + aes.encrypt(pt[16:]) == ct)
+
+ctr_iv = unhexlify(b'f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff')
+ct = ucryptolib.aes(key, ucryptolib.MODE_CTR, ctr_iv).encrypt(pt)
+print(hexlify(ct))
+print(ucryptolib.aes(key, ucryptolib.MODE_CTR, ctr_iv).decrypt(ct) == pt)
+
+# CTR is a stream mode, any length and any split works
+aes = ucryptolib.aes(key, ucryptolib.MODE_CTR, ctr_iv)
+print(aes.encrypt(pt[:5]) + aes.encrypt(pt[5:21]) + aes.encrypt(pt[21:]) == ct)
+
+# in place, with a bytearray and with a memoryview slice
+buf = bytearray(pt)
+print(ucryptolib.aes(key, ucryptolib.MODE_CBC, iv).encrypt(buf, buf))
+ucryptolib.aes(key, ucryptolib.MODE_CBC, iv).decrypt(buf, buf)
+print(buf == pt)
+buf = bytearray(b'x' * 8 + pt)
+ucryptolib.aes(key, ucryptolib.MODE_CTR, ctr_iv).encrypt(memoryview(buf)[8:], memoryview(buf)[8:])
+print(hexlify(buf[8:]) == hexlify(ct))
+
+# errors
+for args in ((b'short', 1), (key, 3), (key, ucryptolib.MODE_CBC), (key, ucryptolib.MODE_CBC, b'short')):
+    try:
+        ucryptolib.aes(*args)
+    except ValueError:
+        print('ValueError')
+try:
+    ucryptolib.aes(key, ucryptolib.MODE_ECB).encrypt(b'15 bytes long..')
+except ValueError:
+    print('ValueError')
+try:
+    ucryptolib.aes(key, ucryptolib.MODE_ECB).encrypt(pt, bytearray(16))
+except ValueError:
+    print('ValueError')
+aes = ucryptolib.aes(key, ucryptolib.MODE_CBC, iv)
+aes.encrypt(pt)
+try:
+    aes.decrypt(pt)
+except OSError:
+    print('OSError')
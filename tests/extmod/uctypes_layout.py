@@ -0,0 +1,71 @@
+try:
+    import uctypes
+    uctypes.compile
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+desc = {
+    "flags": uctypes.UINT16 | 0,
+    "len": uctypes.UINT16 | 2,
+    "hdr": (4, {
+        "a": uctypes.UINT8 | 0,
+        "b": uctypes.INT8 | 1,
+    }),
+    "bf": uctypes.BFUINT16 | 6 | 4 << uctypes.BF_POS | 8 << uctypes.BF_LEN,
+    "arr": (uctypes.ARRAY | 8, uctypes.UINT8 | 4),
+}
+
+buf = bytearray(b"\x01\x02\x03\x04\x05\xff\x34\x12abcd")
+L = uctypes.compile(desc, ("flags", "len", "hdr.a", "hdr.b", "bf"), uctypes.LITTLE_ENDIAN)
+print(uctypes.unpack(L, buf))
+print(uctypes.unpack(uctypes.compile(desc, ["len", "flags"], uctypes.BIG_ENDIAN), buf))
+
+# same result from an address and from a struct
+S = uctypes.struct(desc, uctypes.addressof(buf), uctypes.LITTLE_ENDIAN)
+print(uctypes.unpack(L, uctypes.addressof(buf)) == uctypes.unpack(L, S))
+
+# pack writes through, and struct attribute access sees it
+uctypes.pack(L, buf, (0x1111, 0x2222, 7, -3, 0xab))
+print(hex(S.flags), hex(S.len), S.hdr.a, S.hdr.b, hex(S.bf))
+print(uctypes.unpack(L, buf))
+
+# iterate over an array of structures
+rec = {"id": uctypes.UINT8 | 0, "val": uctypes.UINT16 | 1}
+R = uctypes.compile(rec, ("id", "val"), uctypes.BIG_ENDIAN)
+# the record size is rounded up to the alignment of its widest field, 4
+data = bytes([1, 0, 10, 0, 2, 0, 20, 0, 3, 1, 0, 0])
+print(list(uctypes.iter_unpack(R, data)))
+print(list(uctypes.iter_unpack(R, data, 2)))
+print(list(uctypes.iter_unpack(R, uctypes.addressof(data), 1)))
+
+# errors
+try:
+    uctypes.compile(desc, ("arr",))
+except TypeError:
+    print("TypeError")
+try:
+    uctypes.compile(desc, ("nope",))
+except KeyError:
+    print("KeyError")
+try:
+    uctypes.unpack(L, b"short")
+except ValueError:
+    print("ValueError")
+try:
+    uctypes.pack(L, buf, (1, 2))
+except ValueError:
+    print("ValueError")
+try:
+    uctypes.iter_unpack(R, data, 4)
+except ValueError:
+    print("ValueError")
+try:
+    uctypes.iter_unpack(R, uctypes.addressof(data))
+except TypeError:
+    print("TypeError")
+try:
+    uctypes.unpack(desc, buf)
+except TypeError:
+    print("TypeError")
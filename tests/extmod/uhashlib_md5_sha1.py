@@ -0,0 +1,25 @@
+try:
+    import uhashlib as hashlib
+except ImportError:
+    import hashlib
+
+for name in ('sha256', 'sha1', 'md5'):
+    try:
+        h = getattr(hashlib, name)
+    except AttributeError:
+        print(name, 'SKIP')
+        continue
+    print(name, h().digest())
+    print(name, h(b'abc').digest())
+    data = bytes(range(256)) * 3
+    for n in (55, 56, 63, 64, 65, 128, 700):
+        print(n, h(data[:n]).digest())
+    # chunked updates, both within and across blocks, and from a memoryview
+    m = memoryview(data)
+    o = h()
+    for i in range(0, len(data), 37):
+        o.update(m[i:i + 37])
+    print(o.digest() == h(data).digest())
+    o = h(b'x' * 10)
+    o.update(data[:200])
+    print(o.digest() == h(b'x' * 10 + data[:200]).digest())
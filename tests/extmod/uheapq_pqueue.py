@@ -0,0 +1,57 @@
+try:
+    import uheapq
+    uheapq.PriorityQueue
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+pq = uheapq.PriorityQueue()
+print(len(pq), bool(pq))
+try:
+    pq.pop()
+except IndexError:
+    print("IndexError")
+try:
+    pq.peek()
+except IndexError:
+    print("IndexError")
+
+# grows past the initial capacity, and pops in priority order
+for p in (5, 3, 9, -1, 7, 3, 0, 12, 8, 3):
+    pq.push(p, 'item%d' % p)
+print(len(pq), bool(pq), pq.peek())
+l = []
+while pq:
+    l.append(pq.pop())
+print(l)
+
+# equal priorities come out in the order they went in
+pq = uheapq.PriorityQueue(2)
+for i in range(6):
+    pq.push(i % 2, i)
+print([pq.pop() for i in range(6)])
+
+# interleaved pushes and pops, checked against sorting
+seed = 1
+def rand():
+    global seed
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff
+    return seed >> 16
+pq = uheapq.PriorityQueue()
+ref = []
+out = []
+for i in range(300):
+    if rand() % 3 and ref:
+        ref.sort()
+        out.append(pq.pop() == ref.pop(0))
+    else:
+        p = rand() % 50
+        pq.push(p, (p, i))
+        ref.append((p, i))
+print(all(out), len(pq) == len(ref))
+
+try:
+    pq.push('a', 1)
+except TypeError:
+    print("TypeError")
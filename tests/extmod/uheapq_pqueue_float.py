@@ -0,0 +1,17 @@
+try:
+    import uheapq
+    uheapq.PriorityQueue
+    1.0
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# pushing a float switches the queue over to float priorities
+pq = uheapq.PriorityQueue()
+pq.push(2, 'b')
+pq.push(1, 'a')
+pq.push(1.5, 'c')
+pq.push(0.25, 'd')
+print(pq.peek())
+print([pq.pop() for i in range(4)])
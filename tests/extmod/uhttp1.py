@@ -0,0 +1,58 @@
+try:
+    import uhttp
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+def s(buf, span):
+    return buf[span[0]:span[1]]
+
+# incomplete head
+print(uhttp.parse_request(b"GET / HTTP/1.1\r\nHost: x\r\n"))
+
+# complete request with CRLF line endings
+req = b"GET /index.html HTTP/1.1\r\nHost: example.com\r\nContent-Length:  12 \r\n\r\nbody"
+r = uhttp.parse_request(req)
+print(r[0], len(req) - 4)
+print(s(req, r[1]), s(req, r[2]), r[3])
+for h in r[4]:
+    print(req[h[0]:h[1]], req[h[2]:h[3]])
+print(s(req, uhttp.header(req, r[4], "content-length")))
+print(uhttp.header(req, r[4], "Accept"))
+
+# LF line endings, no headers, HTTP/1.0
+req = b"POST /x HTTP/1.0\n\n"
+r = uhttp.parse_request(req)
+print(r[0], s(req, r[1]), s(req, r[2]), r[3], r[4])
+
+# incremental parsing into a bytearray, with a fill length
+buf = bytearray(64)
+data = b"HEAD / HTTP/1.1\r\nA: b\r\n\r\n"
+last = 0
+for i in range(1, len(data) + 1):
+    buf[:i] = data[:i]
+    r = uhttp.parse_request(buf, i, last)
+    if r is not None:
+        print(i, r[0], s(buf, r[1]))
+        break
+    last = i
+
+# response
+resp = b"HTTP/1.1 404 Not Found\r\nServer: t\r\n\r\n"
+r = uhttp.parse_response(resp)
+print(r[0], r[1], r[2], s(resp, r[3]))
+print(s(resp, uhttp.header(resp, r[4], "SERVER")))
+r = uhttp.parse_response(b"HTTP/1.0 200\n\n")
+print(r[1], r[2], r[3])
+
+# malformed input
+for bad in (b"GET\r\n\r\n", b"GET / HTTP/2.0\r\n\r\n", b"GET / HTTP/1.1\r\nNoColon\r\n\r\n",
+            b"GET / HTTP/1.1\r\nA: b\r\n  folded\r\n\r\n", b"HTTP/1.1 20x OK\r\n\r\n"):
+    try:
+        if bad.startswith(b"HTTP"):
+            uhttp.parse_response(bad)
+        else:
+            uhttp.parse_request(bad)
+    except ValueError:
+        print("ValueError")
@@ -0,0 +1,18 @@
+try:
+    from _io import StringIO
+    import ujson as json
+except ImportError:
+    from io import StringIO
+    import json
+
+s = StringIO()
+json.dump(['a', 1, None, False, (2, 3)], s)
+json.dump({'a': 'b'}, s)
+print(s.getvalue())
+
+# output longer than the internal buffer, and a round trip
+obj = [str(i) * i for i in range(30)]
+s = StringIO()
+json.dump(obj, s)
+print(len(s.getvalue()), s.getvalue() == json.dumps(obj))
+print(json.load(StringIO(s.getvalue())) == obj)
@@ -0,0 +1,23 @@
+try:
+    from _io import StringIO
+    import ujson as json
+except ImportError:
+    from io import StringIO
+    import json
+
+print(json.load(StringIO('null')))
+print(json.load(StringIO('"abc\\u0064e"')))
+print(json.load(StringIO('[false, true, 1, -2]')))
+print(json.load(StringIO('{"a":true}')) == {'a':True})
+
+# documents longer than the internal buffer
+s = '[' + ', '.join('{"key%d": "%s"}' % (i, 'x' * i) for i in range(40)) + ']'
+print(json.load(StringIO(s)) == json.loads(s))
+print(json.load(StringIO(' ' * 200 + '123' + ' ' * 200)))
+
+# errors
+for s in ('', '[1', '"abc', 'nul', '1 2'):
+    try:
+        json.load(StringIO(s))
+    except ValueError:
+        print('ValueError')
@@ -0,0 +1,38 @@
+# decoding documents with repeated keys and repeated container shapes
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+def dump(o):
+    # print dicts in a canonical order
+    if isinstance(o, dict):
+        return '{' + ', '.join('%r: %s' % (k, dump(o[k])) for k in sorted(o)) + '}'
+    if isinstance(o, list):
+        return '[' + ', '.join(dump(x) for x in o) + ']'
+    return repr(o)
+
+# records sharing keys, with list/dict sizes that grow and shrink
+recs = []
+for i in range(12):
+    r = {'id': i, 'name': 'n%d' % i, 'tags': list(range(i % 5))}
+    for j in range(i % 4):
+        r['extra%d' % j] = {'k': j}
+    recs.append(r)
+s = json.dumps(recs)
+print(json.loads(s) == recs)
+print(dump(json.loads(s)[:3]))
+
+# many distinct keys, more than any cache of recent keys
+d = dict(('key%d' % i, i) for i in range(100))
+print(json.loads(json.dumps(d)) == d)
+
+# string values equal to keys, and keys equal to values
+print(dump(json.loads('{"a": "a", "b": {"a": "b"}, "c": ["a", {"c": "a"}]}')))
+
+# deep nesting
+s = '[' * 20 + '{"x": [1, 2]}' + ']' * 20
+o = json.loads(s)
+for i in range(20):
+    o = o[0]
+print(dump(o))
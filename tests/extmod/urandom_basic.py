@@ -0,0 +1,47 @@
+try:
+    import urandom as random
+except ImportError:
+    import random
+
+# same seed gives the same sequence
+random.seed(42)
+a = [random.getrandbits(16) for i in range(10)]
+random.seed(42)
+b = [random.getrandbits(16) for i in range(10)]
+print(a == b)
+
+# getrandbits range
+for n in (1, 8, 16, 30, 32):
+    for i in range(20):
+        r = random.getrandbits(n)
+        if not 0 <= r < (1 << n):
+            print('bad', n, r)
+print(random.getrandbits(0))
+
+# randint/randrange bounds
+for i in range(100):
+    r = random.randint(-5, 5)
+    if not -5 <= r <= 5:
+        print('bad randint', r)
+    r = random.randrange(3, 30, 3)
+    if r < 3 or r >= 30 or r % 3:
+        print('bad randrange', r)
+    r = random.randrange(10, 0, -2)
+    if r <= 0 or r > 10 or r % 2:
+        print('bad randrange', r)
+print(random.randint(7, 7))
+print(random.randrange(1))
+
+# every value of a small range comes up
+print(sorted(set(random.randrange(4) for i in range(200))))
+
+# choice
+print(random.choice([5]))
+print(random.choice('abc') in 'abc')
+
+# errors
+for f, args in ((random.randrange, (0,)), (random.randrange, (5, 1)), (random.randint, (3, 2)), (random.choice, ([],))):
+    try:
+        f(*args)
+    except (ValueError, IndexError) as er:
+        print(type(er).__name__)
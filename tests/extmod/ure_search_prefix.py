@@ -0,0 +1,19 @@
+# search skips ahead using the literal prefix or the possible first bytes
+try:
+    import ure as re
+except ImportError:
+    import re
+
+subjects = ['', 'x', 'abc', 'xxabcxx', 'xxabxabc', 'aaab', 'q 12 z', 'B-52 b52', 'abab', 'Abc\nabc']
+patterns = ['abc', 'ab+c', 'ab*', 'ab?c', 'a|c', '[a-c]+', '[^a-c]', '\\d+', '\\w+', '\\s', '(ab)+', '^ab', '^x|c', 'x*', 'b.', '[Bb]-?52']
+
+for p in patterns:
+    r = re.compile(p)
+    for s in subjects:
+        m = r.search(s)
+        print(p, repr(s), m and m.group(0), r.match(s) and r.match(s).group(0))
+
+# split keeps ^ anchored at the start of the whole subject
+print(re.compile('^a').split('aaxa'))
+print(re.compile('[,;] *').split('a, b;c,d'))
+print(re.compile('xy').split('1xy2xyxy3'))
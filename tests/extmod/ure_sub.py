@@ -0,0 +1,40 @@
+try:
+    import ure as re
+except ImportError:
+    import re
+
+try:
+    re.sub
+except AttributeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+print(re.sub('a', 'b', 'banana'))
+print(re.sub('a', 'b', 'banana', 2))
+print(re.sub('x', 'y', 'banana'))
+print(re.sub('[0-9]+', '#', 'a1b22c333'))
+print(re.sub('(\\w+)=(\\d+)', '\\2=\\1', 'a=1, bb=22'))
+print(re.sub('(\\w+)=(\\d+)', '\\g<2>:\\g<1>\\g<0>', 'a=1, bb=22'))
+print(re.sub('(a)|b', '[\\1]', 'abc'))
+print(re.sub(',', '\\n', 'a,b'))
+print(re.sub('x*', '-', 'abxd'))
+print(re.sub('', '-', 'abc'))
+print(re.sub('^', '> ', 'line'))
+print(re.sub(b'b+', b'B', b'abbcb'))
+
+r = re.compile('\\d+')
+print(r.sub(lambda m: str(int(m.group(0)) * 2), 'x=10, y=21'))
+print(r.sub('N', 'no digits'))
+
+for p, s in (('a+', 'caaabaad'), ('\\d', '1a23'), ('x*', 'axb'), ('(b)(c)?', 'abcab')):
+    print([m.group(0) for m in re.finditer(p, s)])
+    print([m.span() for m in re.compile(p).finditer(s)])
+
+m = re.search('(b)(x)?', 'abc')
+print(m.start(), m.end(), m.span(), m.span(1), m.start(1), m.end(1), m.span(2))
+
+try:
+    re.sub('(a)', '\\2', 'a')
+except Exception:
+    print('Exception')
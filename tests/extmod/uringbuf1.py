@@ -0,0 +1,42 @@
+try:
+    from uringbuf import RingBuffer
+except ImportError:
+    import sys
+    print("SKIP")
+    sys.exit()
+
+r = RingBuffer(4)
+print(len(r), bool(r), r.any(), r.free())
+print(r.get())
+
+# put/get single bytes
+for i in range(5):
+    print(r.put(i))
+print(len(r), r.free())
+print([r.get() for i in range(5)])
+
+# write/readinto with wrap around
+print(r.write(b'ab'), r.get())
+print(r.write(b'cdef'))
+buf = bytearray(8)
+print(r.readinto(buf), buf)
+print(r.readinto(buf), r.any())
+
+# readinto with a length limit
+r.write(b'xyz')
+buf = bytearray(8)
+print(r.readinto(buf, 2), buf, r.get())
+
+# user-provided backing store
+store = bytearray(3)
+r = RingBuffer(store)
+print(r.write(b'1234'), r.get(), r.get(), r.get())
+
+try:
+    RingBuffer(0)
+except ValueError:
+    print('ValueError')
+try:
+    RingBuffer(bytearray(1))
+except ValueError:
+    print('ValueError')
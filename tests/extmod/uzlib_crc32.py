@@ -0,0 +1,25 @@
+try:
+    import uzlib as zlib
+except ImportError:
+    import zlib
+
+data = bytes(range(256)) * 5
+
+print(zlib.crc32(b''))
+print(zlib.crc32(b'123456789'))
+print(zlib.crc32(data))
+print(zlib.crc32(b'abc', 0xffffffff))
+print(zlib.adler32(b''))
+print(zlib.adler32(b'123456789'))
+print(zlib.adler32(data))
+
+# incremental updates over pieces of every alignment and length give the
+# same result as a single call
+for step in (1, 3, 4, 7, 8, 13, 100):
+    crc = 0
+    adler = 1
+    m = memoryview(data)
+    for i in range(0, len(data), step):
+        crc = zlib.crc32(m[i:i + step], crc)
+        adler = zlib.adler32(m[i:i + step], adler)
+    print(step, crc == zlib.crc32(data), adler == zlib.adler32(data))
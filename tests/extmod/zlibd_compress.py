@@ -0,0 +1,32 @@
+try:
+    import zlib
+except ImportError:
+    import uzlib as zlib
+
+PATTERNS = [
+    b'',
+    b'0',
+    b'hello',
+    b'0' * 100,
+    bytes(range(64)),
+    b'abcabcabcabc' * 50,
+    bytes(i * 7 % 251 for i in range(2000)),
+    b'{"id": 12, "name": "sensor", "value": 21.5}, ' * 40,
+]
+
+for data in PATTERNS:
+    packed = zlib.compress(data)
+    print(len(data), zlib.decompress(packed) == data)
+
+# streaming in chunks, zlib and raw
+data = bytes(''.join('line %d of the log\n' % i for i in range(300)), 'ascii')
+for wbits in (10, -10):
+    c = zlib.compressobj(wbits=wbits)
+    out = b''
+    for i in range(0, len(data), 77):
+        out += c.compress(data[i:i + 77])
+    out += c.flush()
+    print(wbits, len(out) < len(data) // 2, zlib.decompress(out, wbits if wbits < 0 else 15) == data)
+
+# repetitive input compresses well
+print(len(zlib.compress(b'a' * 1000)) < 50)
@@ -0,0 +1,62 @@
+try:
+    import uzlib as zlib
+    zlib.DecompIO
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+try:
+    from _io import BytesIO
+except ImportError:
+    from io import BytesIO
+
+# dynamic Huffman codes, produced by CPython's zlib.compress(data, 9)
+def gen(n):
+    x = 1
+    out = bytearray()
+    for i in range(n):
+        x = (x * 75 + 74) % 65537
+        out.append(b'eeeeeetttaaoinshrdlu   '[x % 23])
+    return bytes(out)
+data = b'hello world\n' * 20 + gen(300)
+packed = b'x\xda\xe5\x8eA\xaa\x040\x08C\xf7s\x8a\\M0PA\x14l\xca\\\xff;\xe7\xf8\xbb&\xd4\xbcw\x98\xd9\xf8\xf6\xa4\x7f\xce?x7\x83dU\xb7.\x99\xd1,P\xdd\x04\x11\xcf\x1c\x19fV\xb8\x88\xd2\x83\xb93\x10\xc4\xde=iN\xb7\x8d\x84cT\xf2Z\x88\xdcx\xa5\x1e\xdf\xbd\x16S\x18\x1a\x96\x92\xf4g0\x96\xcb\xb6\xe89\xb6;\x97o\x14{n<[f\x17\x85\xf5\xa0\x95\xe9\xbd#\x86)\xa1\xb2\x05\xde\xa4)P\r\xb8y\x0f\xb9\xc4#\xc3\x92V\x9do\xf9k\xc0^\x9eb\xe8\xc4\x0b\xf9\x03\xed.\x12\x07[\x12\xbf_G\xe0\x1c\xd8\xean\xf6\xda\xa0,\xdd\xd50\xbeZ\xfe\x9b\xdd\xfdM\x8aS\xbc\xfd\x07Cw\xcb\x07'
+
+d = zlib.DecompIO(BytesIO(packed))
+print(d.readline())
+print(d.read(5))
+buf = bytearray(20)
+print(d.readinto(buf), buf)
+print(d.read() == data[37:])
+print(d.read())
+
+# small reads
+d = zlib.DecompIO(BytesIO(packed))
+out = b''
+while True:
+    b = d.read(7)
+    if not b:
+        break
+    out += b
+print(out == data)
+
+# stored block
+d = zlib.DecompIO(BytesIO(b'x\x01\x01\x0b\x00\xf4\xffstored data\x1a\xb2\x04L'))
+print(d.read())
+
+# raw deflate stream
+d = zlib.DecompIO(BytesIO(b'+J,WHIM\xcbI,IU(\xa2#\x1b\x00'), -9)
+print(d.read())
+
+# window bigger than allowed
+try:
+    zlib.DecompIO(BytesIO(packed), 9)
+except ValueError:
+    print('ValueError')
+
+# truncated and corrupted input
+for bad in (packed[:-2], packed[:30], packed[:-1] + b'\x00', b'abc'):
+    try:
+        zlib.DecompIO(BytesIO(bad)).read()
+    except ValueError:
+        print('ValueError')
@@ -0,0 +1,13 @@
+# test sum of lists and tuples mixing small ints and floats
+
+print(sum([1.5, 2.5, 3]))
+print(sum((1, 2, 0.25)))
+print(sum([0.1] * 10))
+print(sum([1, 2], 0.5))
+print(sum([0.5, 2 ** 40]))
+print(sum([1.0, True, 2]))
+print(sum([2.0, -1, 1e300, -1e300]))
+try:
+    sum([1, 2.0, 'a'])
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,21 @@
+# test floats with special bit patterns, and ints near small-int boundaries
+
+try:
+    import ustruct as struct
+except ImportError:
+    import struct
+import math
+
+# NaNs with various payloads and signs
+for b in (b'\x7f\xf8', b'\x7f\xfc', b'\x7f\xfd', b'\x7f\xfe', b'\x7f\xff', b'\xff\xf8', b'\xff\xff', b'\x7f\xf0'):
+    f = struct.unpack('>d', b + b'\x00\x00\x00\x00\x00\x01')[0]
+    print(math.isnan(f), math.isnan(f + 1), type(f))
+
+# values around the special ones
+for f in (0.0, -0.0, 2.0 ** -1070, -2.0 ** -1070, 2.0 ** 1023, -2.0 ** 1023, float('inf'), -float('inf')):
+    print(f == -(-f), f * 2 == f + f, struct.pack('>d', f) == struct.pack('>d', -(-f)))
+
+# ints around powers of 2 that may be small-int boundaries
+for n in (30, 31, 46, 47, 48, 62, 63):
+    for x in (2 ** n - 1, 2 ** n, -2 ** n, -2 ** n - 1):
+        print(x, x + 1, x - 1, x * 2, x // 2, -x, x >> 1, x << 1, int(float(2 ** n)) == 2 ** n)
@@ -0,0 +1,22 @@
+# test that float repr is the shortest string that reads back as the same
+# float, and that parsing and formatting are correctly rounded
+
+# shortest round-trip repr
+for x in (0.1, 0.2, 0.1 + 0.2, 1 / 3, 2 / 3, 1e16, 1e15, 123456789.0, 0.0001, 0.00001,
+          1e22, 1e23, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308,
+          9007199254740993.0, 0.3, 100.0, -1.5, -0.0, 1e-7, 4.35, 2 ** 60, 2 ** -20):
+    print(repr(x), str(x), float(repr(x)) == x)
+print(complex(0.1, 0.2), complex(0, 1e16))
+
+# parsing, including halfway cases that need every digit
+for s in ('0.1', '1.7976931348623157e308', '1.7976931348623159e308', '2.4703282292062327e-324',
+          '2.4703282292062328e-324', '9007199254740993', '9007199254740993.0000000000000000001',
+          '18257556.92039728723466396331787109375', '18257556.920397287234663963317871093750001',
+          '1.000000000000000111', '1.000000000000000112', '1e-400', '1e400', '123456789012345678901234567890',
+          '.5', '5.', '0e999999999', '-0.0', '2.5e-3', '10'):
+    print(s, repr(float(s)))
+
+# formatting rounds the exact value, ties to even
+for x in (0.125, 0.375, 2.5, 0.5, 1.5, 1.005, 2.675, 1e-10, 123.456, 9.9995, 1e20):
+    print('%.2f %.0f %.3e %.4g %g' % (x, x, x, x, x))
+print('%.17g %.20f %.20e' % (0.1, 0.1, 0.1))
@@ -0,0 +1,40 @@
+# test math.apply and math.polyval, which work over float arrays
+
+try:
+    import math
+    import array
+    math.apply
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+a = array.array('f', [0.0, 0.25, 1.0, 4.0])
+print(list(math.apply(math.sqrt, a)))
+print(list(math.apply(lambda x: x * 3, a)))
+print(list(a))
+
+# in place, and into a given array
+math.apply(math.fabs, array.array('f', [-1, 2, -3, 4]), a)
+print(list(a))
+d = array.array('d', [0.0, 1.0, 2.0])
+math.apply(math.exp, d, d)
+print(['%.4f' % x for x in d])
+
+# polynomials, highest power first
+d = array.array('d', [0.0, 1.0, 2.0])
+print(list(math.polyval([1, 2, 3], d)))
+print(list(math.polyval([], d)))
+print(math.polyval((2.0, 0, -1), 3))
+f = array.array('f', [0, 0, 0])
+print(math.polyval([1, 1], d, f) is f, list(f))
+
+# errors
+try:
+    math.apply(math.sin, bytearray(4))
+except TypeError:
+    print('TypeError')
+try:
+    math.apply(math.sin, d, array.array('d', [0]))
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,26 @@
+# test math.fsum and math.hypot
+
+try:
+    import math
+    math.fsum
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# fsum doesn't accumulate rounding errors
+print(math.fsum([0.1] * 10))
+print(math.fsum([1e100, 1.0, -1e100, 1e-100, 1e50, -1.0, -1e50]))
+print(math.fsum([]), math.fsum(range(10)), math.fsum(x / 4 for x in range(5)))
+
+# special values
+print(math.fsum([1.0, float('inf')]), math.fsum([float('nan'), 1.0]))
+try:
+    math.fsum([float('inf'), float('-inf')])
+except ValueError:
+    print('ValueError')
+
+# hypot with any number of arguments
+print(math.hypot(3, 4), math.hypot(1, 2, 2), math.hypot(), math.hypot(-5))
+print(math.hypot(3.0, 4.0, 12.0))
+print(math.hypot(float('inf'), float('nan')), math.hypot(1, float('nan')))
@@ -0,0 +1,14 @@
+try:
+    import urandom as random
+except ImportError:
+    import random
+
+random.seed(1)
+for i in range(100):
+    r = random.random()
+    if not 0 <= r < 1:
+        print('bad random', r)
+    r = random.uniform(-2, 3)
+    if not -2 <= r <= 3:
+        print('bad uniform', r)
+print('ok')
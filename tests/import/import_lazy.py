@@ -0,0 +1,20 @@
+# test that submodules of a package are imported on first access, and that
+# a module's __getattr__ is called for missing attributes
+
+import pkg7
+print('pkg7 imported')
+
+# submodule loaded here, then found in the package
+print(pkg7.mod1.x)
+print(pkg7.mod1.x)
+
+# module-level __getattr__
+print(pkg7.answer)
+try:
+    pkg7.missing
+except AttributeError:
+    print('AttributeError')
+
+# from-import of a submodule not loaded yet
+from pkg7 import mod2
+print(mod2.y, pkg7.mod2 is mod2)
@@ -0,0 +1,6 @@
+print('pkg7 __init__')
+
+def __getattr__(attr):
+    if attr == 'answer':
+        return 42
+    raise AttributeError(attr)
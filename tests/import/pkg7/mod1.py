@@ -0,0 +1,2 @@
+print('pkg7.mod1 loaded')
+x = 1
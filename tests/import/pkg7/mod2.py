@@ -0,0 +1,2 @@
+print('pkg7.mod2 loaded')
+y = 2
@@ -0,0 +1,42 @@
+# test DSP/SIMD instructions (these need a Cortex-M4 or higher)
+
+@micropython.asm_thumb
+def qadd16(r0, r1):
+    qadd16(r0, r0, r1)
+
+@micropython.asm_thumb
+def usub8(r0, r1):
+    usub8(r0, r0, r1)
+
+@micropython.asm_thumb
+def smlad(r0, r1, r2):
+    smlad(r0, r1, r2, r0)
+
+@micropython.asm_thumb
+def smuad(r0, r1):
+    smuad(r0, r0, r1)
+
+@micropython.asm_thumb
+def ssat8(r0):
+    ssat(r0, 8, r0)
+
+@micropython.asm_thumb
+def usat8(r0):
+    usat(r0, 8, r0)
+
+@micropython.asm_thumb
+def uxtb16(r0):
+    uxtb16(r0, r0)
+
+@micropython.asm_thumb
+def umull_hi(r0, r1):
+    umull(r2, r0, r0, r1)
+
+print(hex(qadd16(0x7fff0001, 0x00010002)))
+print(hex(usub8(0x05050505, 0x01020304)))
+print(smlad(0x00020003, 0x00040005, 100))
+print(smuad(0x00020003, 0x00040005))
+print(ssat8(1000), ssat8(-1000), ssat8(5))
+print(usat8(1000), usat8(-1000), usat8(5))
+print(hex(uxtb16(0x12345678)))
+print(hex(umull_hi(0x10000, 0x30000)))
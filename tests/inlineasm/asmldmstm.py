@@ -0,0 +1,23 @@
+# test ldm/stm block transfers
+
+@micropython.asm_thumb
+def copy3(r0, r1):
+    # r0 = dest, r1 = src; ldmia/stmia write back the base register
+    ldmia(r1, {r2, r3, r4})
+    stmia(r0, {r2, r3, r4})
+    sub(r0, 12)
+    ldm(r0, {r0})
+
+@micropython.asm_thumb
+def sum4(r0):
+    ldm(r0, {r1, r2, r3, r8})
+    add(r0, r1, r2)
+    add(r0, r0, r3)
+    mov(r1, r8)
+    add(r0, r0, r1)
+
+import array
+src = array.array('i', [10, 20, 30])
+dest = array.array('i', [0, 0, 0])
+print(copy3(dest, src), list(dest))
+print(sum4(array.array('i', [1, 2, 3, 4])))
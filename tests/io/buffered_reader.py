@@ -0,0 +1,44 @@
+import _io as io
+
+try:
+    io.BufferedReader
+except AttributeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+data = b"line one\nline two\n\nlonger line number four\nno newline"
+
+# small buffer, so lines straddle refills
+r = io.BufferedReader(io.BytesIO(data), 8)
+print(r.readline())
+print(r.read(3))
+print(r.readline())
+print(r.readline())
+print(r.readline(6))
+print(r.readline())
+print(r.readline())
+print(r.readline())
+
+# iteration
+print(list(io.BufferedReader(io.BytesIO(data), 5)))
+
+# reads bigger than the buffer, and readinto
+r = io.BufferedReader(io.BytesIO(data), 4)
+print(r.read(2), r.read(20), r.read())
+r = io.BufferedReader(io.BytesIO(data), 16)
+b = bytearray(12)
+print(r.readinto(b), b)
+print(r.peek(1)[:1])
+print(r.read(4))
+
+# file on disk
+f = io.BufferedReader(open("io/data/file1", "rb"), 4)
+print(f.readline())
+print(f.read())
+f.close()
+
+try:
+    io.BufferedReader(io.BytesIO(), 0)
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,27 @@
+import _io as io
+
+try:
+    io.BufferedWriter
+except AttributeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+b = io.BytesIO()
+w = io.BufferedWriter(b, 8)
+print(w.write(b"abc"), b.getvalue())
+print(w.write(b"defg"), b.getvalue())
+# overflows the buffer, so what was held is written first
+print(w.write(b"hi"), b.getvalue())
+# bigger than the buffer, so it goes straight through
+print(w.write(b"0123456789"), b.getvalue())
+w.write(b"xyz")
+print(b.getvalue())
+w.flush()
+print(b.getvalue())
+
+# flush() also flushes the underlying stream
+w = io.BufferedWriter(io.BytesIO(), 8)
+w.write(b"12")
+w.flush()
+print("flushed")
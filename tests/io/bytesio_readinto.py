@@ -0,0 +1,21 @@
+import _io as io
+
+a = io.BytesIO(b"foobarbaz")
+
+# read into a whole buffer
+b = bytearray(4)
+print(a.readinto(b), b)
+
+# read into a slice of a buffer, without a copy
+b = bytearray(8)
+print(a.readinto(memoryview(b)[2:5]), b)
+
+# short read at the end of the stream
+print(a.readinto(b), b)
+print(a.readinto(b))
+
+# write from a slice of a buffer
+a = io.BytesIO()
+b = b"0123456789"
+print(a.write(memoryview(b)[2:5]))
+print(a.getvalue())
@@ -0,0 +1,61 @@
+# test elementwise math functions in the array module
+
+try:
+    import array
+    array.dot
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+a = array.array('h', [1, -2, 3, 4])
+b = array.array('h', [10, 20, -30, 40])
+
+print(array.add(a, b))
+print(array.mul(a, b))
+print(array.scale(a, 3))
+print(array.clip(b, -5, 25))
+print(array.dot(a, b))
+print(array.sum(a), array.min(a), array.max(a))
+
+# output argument
+out = array.array('h', [0] * 4)
+r = array.add(a, b, out)
+print(r is out, out)
+array.scale(a, 2, a)
+print(a)
+
+# results wrap to the element width
+print(array.add(array.array('B', [200, 100]), array.array('B', [100, 100])))
+print(array.mul(array.array('b', [100]), array.array('b', [2])))
+
+# bytes, bytearray and memoryview operands
+print(array.sum(b'\x01\x02\x03'), array.max(bytearray(b'abc')))
+m = memoryview(array.array('i', [5, 6, 7, 8]))
+print(array.sum(m[1:3]), array.dot(m, m))
+
+# float types
+f = array.array('f', [1.5, -2.0, 3.25])
+d = array.array('d', [0.5, 1.5, 2.5])
+print(array.scale(f, 2))
+print(array.sum(d), array.dot(d, d), array.min(f), array.max(d))
+print(array.clip(d, 1, 2))
+
+# typecodes using the generic path
+q = array.array('l', [1, 2, 3])
+print(array.add(q, q), array.sum(q), array.dot(q, q), array.max(q))
+
+# errors
+for args in ((a, array.array('h', [1])), (a, array.array('i', [1, 2, 3, 4]))):
+    try:
+        array.add(*args)
+    except ValueError:
+        print('ValueError')
+try:
+    array.add(a, a, b'1234')
+except TypeError:
+    print('TypeError')
+try:
+    array.min(array.array('f'))
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,41 @@
+# test that looking up the same bound method repeatedly needs no allocation
+
+import micropython
+
+try:
+    micropython.mem_total
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+class A:
+    def __init__(self, x):
+        self.x = x
+    def f(self, y):
+        return self.x + y
+    def __call__(self, y):
+        return self.x * y
+
+a = A(1)
+b = A(2)
+
+# bound methods of different objects and functions stay distinct
+fa = a.f
+fb = b.f
+print(fa(10), fb(10), getattr(a, 'f')(20))
+print(fa is not fb, a.f is not a.__init__)
+
+def use(cb):
+    return cb(1)
+
+# passing a bound method as a callback
+m0 = micropython.mem_total()
+for i in range(100):
+    use(a.f)
+print(micropython.mem_total() - m0 < 100 * 16)
+
+# calling an instance with __call__
+m0 = micropython.mem_total()
+for i in range(100):
+    b(i)
+print(b(3), micropython.mem_total() - m0 < 100 * 16)
@@ -0,0 +1,42 @@
+# bytearray in-place itranslate and ixor methods (extension to CPython)
+
+try:
+    bytearray().ixor
+except AttributeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+a = bytearray(b"hello")
+print(a.ixor(0x20), a)
+a.ixor(0x20)
+print(a)
+
+a = bytearray(b"\x00\x00\x00\x00\x00")
+a.ixor(b"\x01\x02")
+print(a)
+a.ixor(bytearray(b"\xff"), 1, -1)
+print(a)
+a.ixor(b"\x0f", 3)
+print(a)
+a.ixor(b"\x0f", 4, 2)
+print(a)
+
+try:
+    a.ixor(b"")
+except ValueError:
+    print("ValueError")
+
+table = bytearray(range(256))
+table[ord("a"):ord("z") + 1] = bytes(range(ord("A"), ord("Z") + 1))
+a = bytearray(b"hello world")
+print(a.itranslate(table, 6), a)
+a.itranslate(table)
+print(a)
+a.itranslate(bytes(reversed(range(256))), None, 1)
+print(a)
+
+try:
+    a.itranslate(b"abc")
+except ValueError:
+    print("ValueError")
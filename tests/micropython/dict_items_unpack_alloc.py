@@ -0,0 +1,22 @@
+# a for loop that unpacks the items of dict.items() doesn't make a tuple for
+# each item
+
+import gc
+
+d = {}
+for i in range(100):
+    d[i] = i
+
+def f():
+    n = 0
+    for k, v in d.items():
+        n += v
+    return n
+
+f()
+gc.collect()
+gc.disable()
+m = gc.mem_free()
+print(f())
+print(m - gc.mem_free() < 100 * 16)
+gc.enable()
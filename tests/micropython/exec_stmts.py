@@ -0,0 +1,34 @@
+# test exec of a file input with many top-level statements; const() names
+# and definitions must carry over from one statement to the next
+
+exec("""
+# a comment
+
+X = const(1)
+Y = const(X + 2)
+
+def f(a):
+    return a + Y
+
+class A:
+    def g(self):
+        return f(X)
+
+if X:
+    z = A().g()
+else:
+    z = None
+
+print(X, Y, z)""")
+
+# a syntax error is still raised
+try:
+    exec("a = 1\nb = (\n")
+except SyntaxError:
+    print('SyntaxError')
+
+# so is a compile error, for a constant redefined in a later statement
+try:
+    exec("C = const(1)\nx = 2\nC = const(2)\n")
+except SyntaxError:
+    print('SyntaxError')
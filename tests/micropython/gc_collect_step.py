@@ -0,0 +1,35 @@
+# test incremental garbage collection
+
+import gc
+
+if not hasattr(gc, 'collect_step'):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# build some data, and mutate it while the incremental mark is running
+l = [[i] for i in range(50)]
+d = {}
+done = False
+n = 0
+while not done:
+    done = gc.collect_step(10)
+    # new objects stored into possibly-scanned containers must survive
+    l.append([n])
+    d[n] = str(n)
+    n += 1
+
+# reuse any wrongly freed memory
+junk = [[j, j] for j in range(100)]
+junk = None
+gc.collect()
+
+print(n > 1)
+print(sum(x[0] for x in l[:50]))
+print(all(l[50 + i][0] == i for i in range(n)))
+print(all(d[i] == str(i) for i in range(n)))
+
+# a full collection also finishes an incremental cycle in progress
+gc.collect_step(1)
+gc.collect()
+print(gc.collect_step(0) in (True, False))
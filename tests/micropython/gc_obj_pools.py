@@ -0,0 +1,39 @@
+# objects taken from the object pools must be fully reinitialised, and the
+# pools must not hold on to memory that is needed elsewhere
+import gc
+
+class A:
+    def f(self, x):
+        return (self, x)
+
+def make(n):
+    a = A()
+    return [((i, -i), [i], a.f, range(i, i + 2)) for i in range(n)]
+
+# create garbage for the pools, then allocate again from them
+for k in range(3):
+    make(50)
+    gc.collect()
+    objs = make(50)
+    gc.collect()
+    ok = True
+    for i, (t, l, m, r) in enumerate(objs):
+        ok = ok and t == (i, -i) and l == [i] and m(i)[1] == i and list(r) == [i, i + 1]
+    print(k, ok)
+
+# iterators over ranges
+print([[j for j in range(i)] for i in range(4)])
+
+# the pools are freed when an allocation would otherwise fail
+make(50)
+gc.collect()
+free = gc.mem_free()
+bufs = []
+try:
+    while True:
+        bufs.append(bytearray(256))
+except MemoryError:
+    pass
+print(len(bufs) * 256 > free // 2)
+bufs = None
+gc.collect()
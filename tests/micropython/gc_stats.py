@@ -0,0 +1,36 @@
+# test gc.stats
+
+import gc
+
+# this function is not always available
+if not hasattr(gc, 'stats'):
+    print('SKIP')
+    raise SystemExit
+
+s0 = gc.stats()
+print(len(s0), len(s0.pause_hist))
+print(s0.collections == s0[0], s0.pause_hist == s0[-1])
+
+# explicit collections are counted, and reset the bytes allocated
+gc.collect()
+gc.collect()
+s1 = gc.stats()
+print(s1.collections - s0.collections)
+print(s1.alloc_bytes < 1000)
+print(sum(s1.pause_hist) >= s1.collections)
+print(s1.pause_max >= s1.mark_max, s1.mark_ticks >= s1.mark_max)
+
+# allocations are counted until the next collection
+b = bytearray(2000)
+s2 = gc.stats()
+print(s2.alloc_bytes - s1.alloc_bytes >= 2000)
+
+# an allocation that can't succeed collects first, then fails
+try:
+    bytearray(1 << 28)
+except MemoryError:
+    print('MemoryError')
+s3 = gc.stats()
+print(s3.alloc_failures - s2.alloc_failures)
+print(s3.alloc_collections - s2.alloc_collections)
+print(s3.collections - s2.collections)
@@ -0,0 +1,32 @@
+# test gc.threshold
+
+import gc
+
+# this function is not always available
+if not hasattr(gc, 'threshold'):
+    print('SKIP')
+    raise SystemExit
+
+print(gc.threshold())
+gc.threshold(8192)
+print(gc.threshold())
+
+# allocating well past the threshold triggers collections
+if hasattr(gc, 'stats'):
+    n = gc.stats().collections
+    for i in range(100):
+        b = bytearray(1024)
+    print(gc.stats().collections - n >= 5)
+else:
+    print(True)
+
+# turn it off again; allocations no longer collect
+gc.threshold(-1)
+print(gc.threshold())
+if hasattr(gc, 'stats'):
+    n = gc.stats().collections
+    for i in range(100):
+        b = bytearray(1024)
+    print(gc.stats().collections - n)
+else:
+    print(0)
@@ -0,0 +1,28 @@
+# test micropython.heap_profile
+
+import micropython
+
+# this function is not always available
+if not hasattr(micropython, 'heap_profile'):
+    print('SKIP')
+    raise SystemExit
+
+def alloc():
+    return [bytearray(30) for i in range(5)]
+
+def sites(name):
+    return [s for s in micropython.heap_profile() if s[1] == name]
+
+keep = alloc()
+for s in sites('<listcomp>'):
+    if s[5] >= 10:
+        # at least 2 chains (object and buffer) for each bytearray
+        print(s[2], s[3] >= 10, s[4] >= 5 * 30, s[5] >= 10)
+
+keep = None
+import gc
+gc.collect()
+for s in sites('<listcomp>'):
+    if s[5] >= 10:
+        # fewer are live than were allocated
+        print(s[2], s[3] < s[5])
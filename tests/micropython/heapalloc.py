@@ -24,7 +24,7 @@ def h():
 gc.disable()
 try:
     while True:
-        'a'.lower # allocates 1 cell for boundmeth
+        object() # allocates 1 cell
 except MemoryError:
     pass
 h()
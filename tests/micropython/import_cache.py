@@ -0,0 +1,52 @@
+# test that import sees modules created after their directory was listed
+
+import sys
+import micropython
+
+try:
+    try:
+        import uos as os
+    except ImportError:
+        import _os as os
+    micropython.import_cache_clear
+except (ImportError, AttributeError):
+    print('SKIP')
+    raise SystemExit
+
+name = 'import_cache_tmp'
+path = sys.path[0] + '/' + name + '.py'
+
+# the module's directory is listed by this failed import
+try:
+    import import_cache_tmp
+except ImportError:
+    print('ImportError')
+
+# creating the file makes the cached listing stale
+with open(path, 'w') as f:
+    f.write('x = 1\n')
+try:
+    import import_cache_tmp
+    print(import_cache_tmp.x)
+finally:
+    os.unlink(path)
+
+# a removed file is no longer found, though its directory was listed while
+# the file existed
+path2 = sys.path[0] + '/import_cache_tmp2.py'
+with open(path2, 'w') as f:
+    f.write('x = 2\n')
+try:
+    import import_cache_none
+except ImportError:
+    print('ImportError')
+os.unlink(path2)
+try:
+    import import_cache_tmp2
+except ImportError:
+    print('ImportError')
+
+# an explicit clear is accepted at any time
+micropython.import_cache_clear()
+import import_cache_tmp
+print(import_cache_tmp.x)
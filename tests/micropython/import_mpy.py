@@ -0,0 +1,14 @@
+# test importing of invalid precompiled bytecode (.mpy) files
+
+import sys
+
+# bad magic, unknown version, truncated file
+for name in ('import_mpy_bad1', 'import_mpy_bad2', 'import_mpy_bad3'):
+    try:
+        __import__(name)
+    except ImportError:
+        # .mpy files are not supported
+        print('SKIP')
+        sys.exit()
+    except ValueError as er:
+        print(name, 'ValueError', er)
@@ -0,0 +1,99 @@
+# test automatic promotion of hot bytecode functions to native code
+import micropython
+
+try:
+    micropython.jit_threshold
+except AttributeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+old_threshold = micropython.jit_threshold()
+micropython.jit_threshold(20)
+print(micropython.jit_threshold())
+
+# loop iterations count towards promotion
+def loop(n):
+    s = 0
+    for i in range(n):
+        s += i
+    return s
+
+for n in (10, 10, 10, 100):
+    print(loop(n))
+
+# calls count towards promotion
+def add(a, b=2, *args, **kw):
+    return a + b + len(args) + len(kw)
+
+print([add(i) for i in range(30)])
+print(add(1, 2, 3, x=4), add.__name__)
+
+# exceptions propagate the same way once promoted
+def check(x):
+    if x < 0:
+        raise ValueError(x)
+    return x
+
+for i in range(30):
+    check(i)
+try:
+    check(-1)
+except ValueError as er:
+    print('ValueError', er)
+
+# globals are those of the defining module
+G = 1
+def get_g():
+    return G
+for i in range(30):
+    get_g()
+G = 2
+print(get_g())
+
+# closures
+def outer(x):
+    def inner(y):
+        return x + y
+    return inner
+f = outer(10)
+print([f(i) for i in range(30)][-1])
+
+# promotion while the bytecode version is still running
+def fib(n):
+    if n < 2:
+        return n
+    return fib(n - 1) + fib(n - 2)
+print(fib(15))
+
+# exception handlers
+def catch(x):
+    try:
+        return 1 // x
+    except ZeroDivisionError:
+        return 'div'
+    finally:
+        x = None
+print([catch(i) for i in range(30)][:3])
+
+# functions the native emitter can't compile keep running as bytecode
+def with_stmt():
+    class C:
+        def __enter__(self):
+            return 1
+        def __exit__(self, a, b, c):
+            pass
+    with C() as c:
+        return c
+print(sum(with_stmt() for i in range(30)))
+
+# disabling promotion
+micropython.jit_threshold(0)
+def loop2(n):
+    s = 0
+    for i in range(n):
+        s += i
+    return s
+print(loop2(100))
+
+micropython.jit_threshold(old_threshold)
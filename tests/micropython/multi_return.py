@@ -0,0 +1,62 @@
+# returning a tuple to a caller that unpacks it straight away
+import micropython
+
+def f(a, b):
+    return b, a
+
+def g(a):
+    return a, a + 1, a + 2
+
+x, y = f(1, 2)
+print(x, y)
+x, y, z = g(10)
+print(x, y, z)
+
+# a width that does not match
+try:
+    x, y = g(1)
+except ValueError:
+    print('ValueError')
+
+# the tuple is still made when it is kept
+t = f(3, 4)
+print(t)
+
+# return inside try/finally
+def h():
+    try:
+        return 5, 6
+    finally:
+        print('finally')
+x, y = h()
+print(x, y)
+
+# nested calls and a recursive one
+def fib2(n):
+    if n == 0:
+        return 0, 1
+    a, b = fib2(n - 1)
+    return b, a + b
+print(fib2(30))
+x, y = f(*g(7)[:2])
+print(x, y)
+
+# methods
+class A:
+    def m(self):
+        return self, 42
+a, b = A().m()
+print(type(a) is A, b)
+
+# no tuple is allocated when the values go straight to the caller
+def loop(n):
+    for i in range(n):
+        x, y = f(i, i)
+loop(10)
+# mem_total is not always available
+if hasattr(micropython, 'mem_total'):
+    m = micropython.mem_total()
+    loop(100)
+    print(micropython.mem_total() - m < 100 * 16)
+else:
+    print(True)
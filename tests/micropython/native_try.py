@@ -0,0 +1,157 @@
+# test native try handling
+
+# a local changed in the try block is seen by the handler
+@micropython.native
+def f(x):
+    try:
+        x = 2
+        raise ValueError(x)
+    except ValueError as e:
+        print('caught', e, x)
+f(1)
+
+# exception goes through finally
+@micropython.native
+def f():
+    try:
+        try:
+            raise TypeError('t')
+        finally:
+            print('finally')
+    except TypeError as e:
+        print('caught', e)
+f()
+
+# exception escapes the function
+@micropython.native
+def f():
+    try:
+        raise ValueError('out')
+    finally:
+        print('finally')
+try:
+    f()
+except ValueError as e:
+    print('caught', e)
+
+# return from within try/finally
+@micropython.native
+def f(n):
+    try:
+        if n:
+            return 'in try'
+    finally:
+        print('finally', n)
+    return 'after'
+print(f(0), f(1))
+
+# return from within a handler
+@micropython.native
+def f(n):
+    try:
+        raise ValueError(n)
+    except ValueError as e:
+        return 'handler %s' % e
+print(f(3))
+
+# return in finally swallows the exception
+@micropython.native
+def f():
+    try:
+        raise ValueError
+    finally:
+        return 'swallowed'
+print(f())
+
+# break and continue through nested finally blocks
+@micropython.native
+def f():
+    for i in range(4):
+        try:
+            try:
+                if i == 1:
+                    continue
+                if i == 3:
+                    break
+                print('body', i)
+            finally:
+                print('inner', i)
+        finally:
+            print('outer', i)
+    print('done', i)
+f()
+
+# break out of try/except, and through finally within try/except
+@micropython.native
+def f():
+    for i in range(3):
+        try:
+            if i == 1:
+                break
+        except:
+            pass
+    while True:
+        try:
+            try:
+                break
+            finally:
+                print('finally')
+        except:
+            print('not reached')
+    print(i)
+f()
+
+# exception raised in finally while unwinding a return
+@micropython.native
+def f():
+    try:
+        for i in range(3):
+            try:
+                return i
+            finally:
+                raise KeyError('from finally')
+    except KeyError as e:
+        print('caught', e)
+    return -1
+print(f())
+
+# bare raise re-raises the exception being handled
+@micropython.native
+def f():
+    try:
+        try:
+            raise KeyError('k')
+        except KeyError:
+            print('reraise')
+            raise
+    except KeyError as e:
+        print('caught', e)
+f()
+
+# viper
+@micropython.viper
+def f(n:int) -> int:
+    s = 0
+    for i in range(n):
+        try:
+            if i == 3:
+                raise ValueError
+            s += i
+        except ValueError:
+            s += 100
+        finally:
+            s += 1000
+    return s
+print(f(5))
+
+@micropython.viper
+def f(n:int) -> int:
+    x = 1
+    try:
+        x = 2
+        if n:
+            raise ValueError
+    except ValueError:
+        return x
+    return x + 10
+print(f(0), f(1))
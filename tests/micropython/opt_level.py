@@ -0,0 +1,18 @@
+import micropython
+
+# check we can get and set the level
+micropython.opt_level(0)
+print(micropython.opt_level())
+micropython.opt_level(1)
+print(micropython.opt_level())
+
+# check that the optimisation levels do what they should
+for level in range(4):
+    micropython.opt_level(level)
+    exec('print(__debug__)')
+
+# at level 3 there are no line numbers, so tracebacks report line 1
+micropython.opt_level(3)
+exec('try:\n  xyz\nexcept NameError as er:\n  import sys\n  sys.print_exception(er)')
+micropython.opt_level(0)
+exec('try:\n  xyz\nexcept NameError as er:\n  import sys\n  sys.print_exception(er)')
@@ -0,0 +1,60 @@
+# test micropython.profile and micropython.profile_stats
+
+import micropython
+
+# this function is not always available
+if not hasattr(micropython, 'profile'):
+    print('SKIP')
+    raise SystemExit
+
+# keep the functions below in bytecode, where the profiler sees them
+if hasattr(micropython, 'jit_threshold'):
+    micropython.jit_threshold(0)
+
+def leaf(n):
+    s = 0
+    for i in range(n):
+        s += i
+    return s
+
+def mid(n):
+    return leaf(n) + leaf(n)
+
+def rec(n):
+    if n:
+        return rec(n - 1)
+    return leaf(10)
+
+def gen():
+    for i in range(3):
+        yield leaf(10)
+
+def bad():
+    raise ValueError
+
+micropython.profile(True)
+for i in range(10):
+    mid(100)
+rec(5)
+list(gen())
+try:
+    bad()
+except ValueError:
+    pass
+micropython.profile(False)
+
+# not counted once the profiler is stopped
+mid(1)
+
+stats = {}
+for s in micropython.profile_stats():
+    stats[s[1]] = s
+for name in ('leaf', 'mid', 'rec', 'gen', 'bad'):
+    s = stats[name]
+    print(name, s[2], s[3], 0 <= s[4] <= s[5])
+
+# restarting clears the counts
+micropython.profile(True)
+leaf(1)
+micropython.profile(False)
+print([(s[1], s[3]) for s in micropython.profile_stats()])
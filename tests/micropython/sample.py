@@ -0,0 +1,42 @@
+# test micropython.sample and micropython.sample_stats
+
+import micropython
+
+# this function is not always available
+if not hasattr(micropython, 'sample'):
+    print('SKIP')
+    raise SystemExit
+
+# keep the functions below in bytecode, where the sampler sees them
+if hasattr(micropython, 'jit_threshold'):
+    micropython.jit_threshold(0)
+
+def hot(n):
+    s = 0
+    for i in range(n):
+        s += i * i
+    return s
+
+def lines():
+    return [s for s in micropython.sample_stats() if s[1] == 'hot']
+
+# sample until the hot function has been seen a few times
+micropython.sample(1000)
+for i in range(1000):
+    hot(10000)
+    if sum(s[3] for s in lines()) >= 5:
+        break
+micropython.sample(0)
+
+print(sum(s[3] for s in lines()) >= 5)
+print(all(15 <= s[2] <= 19 for s in lines()))
+
+# not counted once the sampler is stopped
+n = sum(s[3] for s in micropython.sample_stats())
+hot(100000)
+print(sum(s[3] for s in micropython.sample_stats()) == n)
+
+# restarting clears the counts
+micropython.sample(1000000)
+micropython.sample(0)
+print(micropython.sample_stats())
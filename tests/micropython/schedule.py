@@ -0,0 +1,57 @@
+# test micropython.schedule() function
+
+import micropython
+
+try:
+    micropython.schedule
+except AttributeError:
+    print('SKIP')
+    import sys
+    sys.exit()
+
+# scheduled callbacks run in order, between bytecodes
+def callback(arg):
+    print('callback', arg)
+
+micropython.schedule(callback, 1)
+micropython.schedule(callback, 2)
+for i in range(2):
+    pass
+print('after loop')
+
+# the queue has a fixed depth (callbacks don't run while one is running, so
+# it is filled from a callback)
+def filler(arg):
+    try:
+        for i in range(3, 8):
+            micropython.schedule(callback, i)
+    except RuntimeError:
+        print('RuntimeError')
+
+micropython.schedule(filler, None)
+for i in range(2):
+    pass
+print('drained')
+
+# an exception in a callback propagates to the interrupted code
+def raiser(arg):
+    raise ValueError(arg)
+
+try:
+    micropython.schedule(raiser, 'err')
+    for i in range(2):
+        pass
+except ValueError as er:
+    print('ValueError', er)
+
+# a callback can allocate and schedule further callbacks
+def chain(arg):
+    l = [arg] * 2
+    print('chain', l)
+    if arg > 0:
+        micropython.schedule(chain, arg - 1)
+
+micropython.schedule(chain, 2)
+for i in range(3):
+    pass
+print('done')
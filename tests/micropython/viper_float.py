@@ -0,0 +1,59 @@
+# test viper unboxed float type
+
+@micropython.viper
+def add(x:float, y:float) -> float:
+    return x + y
+print(add(1.25, 2.5))
+
+# arithmetic, constants and mixing with ints
+@micropython.viper
+def arith(x:float, n:int) -> float:
+    a = x * 2.0
+    b = a - 0.5
+    c = b / 4.0
+    return c + n
+print(arith(3.0, 2))
+
+# accumulate in a loop
+@micropython.viper
+def poly(x:float) -> float:
+    acc = 0.0
+    for i in range(5):
+        acc = acc * x + 1.0
+    return acc
+print(poly(0.5))
+
+# negation and in-place ops
+@micropython.viper
+def neg(x:float) -> float:
+    y = -x
+    y += 1.0
+    y *= 2.0
+    return y
+print(neg(3.0))
+
+# comparisons
+@micropython.viper
+def cmp(x:float, y:float):
+    print(x < y, x > y, x == y, x <= y, x >= y, x != y)
+cmp(1.0, 2.0)
+cmp(2.0, 1.0)
+cmp(1.5, 1.5)
+nan = float('nan')
+cmp(nan, 1.0)
+cmp(1.0, nan)
+
+# conversion between int and float
+@micropython.viper
+def conv(x:int, f:float, o) -> int:
+    g = float(x) + f + float(o)
+    print(g)
+    return int(g)
+print(conv(3, 0.75, 0.5))
+print(conv(-3, -0.75, 0))
+
+# float value passed to Python code is boxed
+@micropython.viper
+def box(x:float):
+    print(x, type(x))
+box(0.5)
@@ -0,0 +1,59 @@
+# test ptr8/ptr16 loads and stores at constant offsets either side of the
+# ranges the emitters can encode directly, and at variable offsets
+
+@micropython.viper
+def get8(src:ptr8) -> int:
+    return src[1] + src[31] + src[32] + src[255] + src[256] + src[300]
+
+@micropython.viper
+def get16(src:ptr16) -> int:
+    return src[1] + src[31] + src[32] + src[127] + src[128] + src[255] + src[256]
+
+@micropython.viper
+def set8(dest:ptr8, val:int):
+    dest[1] = val
+    dest[32] = val
+    dest[255] = val
+    dest[256] = val
+
+@micropython.viper
+def set16(dest:ptr16, val:int):
+    dest[1] = val
+    dest[32] = val
+    dest[128] = val
+    dest[255] = val
+    dest[256] = val
+
+@micropython.viper
+def copy16(dest:ptr16, src:ptr16, n:int):
+    for i in range(n):
+        dest[i] = src[i] + 1
+
+b = bytearray(range(256)) + bytearray(range(256)) + bytearray(range(256))
+print(get8(b), get16(b))
+
+b = bytearray(600)
+set8(b, 7)
+print([i for i in range(len(b)) if b[i]])
+
+b = bytearray(600)
+set16(b, 0x0102)
+print([i for i in range(len(b)) if b[i]])
+
+src = bytearray(range(8))
+dest = bytearray(8)
+copy16(dest, src, 4)
+print(dest)
+
+# enough locals that the stack frame can't be adjusted with an immediate
+@micropython.viper
+def many(a:int) -> int:
+    l0 = l1 = l2 = l3 = l4 = l5 = l6 = l7 = l8 = l9 = a
+    l10 = l11 = l12 = l13 = l14 = l15 = l16 = l17 = l18 = l19 = a + 1
+    l20 = l21 = l22 = l23 = l24 = l25 = l26 = l27 = l28 = l29 = a + 2
+    l30 = l31 = l32 = l33 = l34 = l35 = l36 = l37 = l38 = l39 = a + 3
+    return (l0 + l1 + l2 + l3 + l4 + l5 + l6 + l7 + l8 + l9
+        + l10 + l11 + l12 + l13 + l14 + l15 + l16 + l17 + l18 + l19
+        + l20 + l21 + l22 + l23 + l24 + l25 + l26 + l27 + l28 + l29
+        + l30 + l31 + l32 + l33 + l34 + l35 + l36 + l37 + l38 + l39)
+print(many(1))
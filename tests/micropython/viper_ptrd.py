@@ -0,0 +1,18 @@
+# test ptrd, pointer to 64-bit doubles (not available on all targets)
+
+import array
+
+@micropython.viper
+def axpy(y:ptrd, x:ptrd, n:int):
+    for i in range(n):
+        y[i] = 2.0 * x[i] + y[i]
+
+@micropython.viper
+def get(x:ptrd) -> float:
+    return x[0] + x[1]
+
+x = array.array('d', [1.0, 2.0, 3.0])
+y = array.array('d', [0.5, 0.5, 0.5])
+axpy(y, x, 3)
+print(list(y))
+print(get(y))
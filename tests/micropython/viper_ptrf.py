@@ -0,0 +1,34 @@
+# test ptrf and ptrd, pointers to 32-bit floats and 64-bit doubles
+
+import array
+
+@micropython.viper
+def dot(a:ptrf, b:ptrf, n:int) -> float:
+    acc = 0.0
+    for i in range(n):
+        acc += a[i] * b[i]
+    return acc
+
+@micropython.viper
+def scale(dest:ptrf, src:ptrf, n:int):
+    for i in range(n):
+        dest[i] = src[i] * 1.5
+
+@micropython.viper
+def first(a:ptrf) -> float:
+    return a[0] + a[2]
+
+@micropython.viper
+def fill(a:ptrf):
+    a[0] = 1
+    a[1] = 2.5
+
+x = array.array('f', [1.0, 2.0, 3.0, 4.0])
+y = array.array('f', [0.5, 0.25, 2.0, 1.0])
+print(dot(x, y, 4))
+z = array.array('f', [0, 0, 0, 0])
+scale(z, x, 4)
+print(list(z))
+print(first(x))
+fill(z)
+print(list(z))
@@ -0,0 +1,77 @@
+# test register allocation of viper locals
+
+# more live locals than registers, all live across a loop
+@micropython.viper
+def f1(n:int) -> int:
+    a = 1
+    b = 2
+    c = 3
+    d = 4
+    e = 5
+    f = 6
+    g = 7
+    i = 0
+    while i < n:
+        a += b
+        b += c
+        c += d
+        d += e
+        e += f
+        f += g
+        g += 1
+        i += 1
+    return a + b + c + d + e + f + g
+print(f1(10))
+
+# locals with disjoint live ranges can share registers
+@micropython.viper
+def f2(x:int) -> int:
+    a = x + 1
+    b = a << 1
+    c = b - 3
+    d = c + c + c
+    e = d + a
+    f = e - b
+    g = f + c
+    h = g << 1
+    return h + x
+print(f2(5))
+
+# a local first read inside the loop keeps its value around the back edge
+@micropython.viper
+def f3(n:int) -> int:
+    s = 0
+    t = 0
+    for i in range(n):
+        s += t
+        t = i + i + 1
+    return s
+print(f3(6))
+
+# pointers held in registers
+@micropython.viper
+def f4(src, dest, n:int):
+    p = ptr8(src)
+    q = ptr8(dest)
+    r = ptr16(dest)
+    for i in range(n):
+        q[i] = p[i] + p[n - 1 - i]
+    r[3] = r[0] + p[1] + p[3]
+b1 = bytearray(b'\x01\x02\x03\x04\x05\x06\x07\x08')
+b2 = bytearray(8)
+f4(b1, b2, 4)
+print(b2)
+
+# nested loops with many locals
+@micropython.viper
+def f5(n:int) -> int:
+    total = 0
+    k = 3
+    for i in range(n):
+        x = i + k
+        for j in range(i):
+            y = x + j
+            total += y
+        total += x
+    return total
+print(f5(7))
@@ -0,0 +1,75 @@
+# weak references are cleared by the GC, and their callbacks are run after
+# the collection; the stack is scanned conservatively, so a few targets may
+# be kept alive
+
+try:
+    import uweakref
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+import gc
+
+class A:
+    pass
+
+def make(n, cb=None):
+    objs = [A() for i in range(n)]
+    if cb is None:
+        return objs, [uweakref.ref(o) for o in objs]
+    return objs, [uweakref.ref(o, cb) for o in objs]
+
+def n_dead(refs):
+    return sum(1 for r in refs if r() is None)
+
+# the targets are alive while referred to
+objs, refs = make(40)
+gc.collect()
+print(n_dead(refs), refs[0]() is objs[0])
+print(repr(refs[0]))
+
+# and are cleared once they aren't
+objs = None
+gc.collect()
+print(n_dead(refs) >= 35)
+
+# callbacks are called with the weak reference, which is dead by then; more
+# than fit in the finaliser queue at once are run by later collections
+log = []
+def cb(r):
+    log.append(r)
+objs, refs = make(40, cb)
+objs = None
+for i in range(4):
+    gc.collect()
+print(len(log) >= 35, all(r() is None for r in log))
+print(repr(log[0]))
+
+# a callback isn't called for a weak reference that is unreachable itself
+log = []
+objs, refs = make(40, cb)
+objs = refs = None
+for i in range(4):
+    gc.collect()
+print(len(log) <= 5)
+
+# an exception in a callback is printed and doesn't stop the others
+n = [0]
+def bad(r):
+    n[0] += 1
+    if n[0] == 1:
+        raise ValueError("bad")
+objs, refs = make(10, bad)
+objs = None
+gc.collect()
+print(n[0] >= 5)
+
+# functions and classes can be targets too, other objects can't
+def f():
+    pass
+print(uweakref.ref(f)() is f, uweakref.ref(A)() is A)
+for x in (1, "str", [], (1,), None):
+    try:
+        uweakref.ref(x)
+    except TypeError:
+        print("TypeError")
@@ -0,0 +1,48 @@
+# deep recursion of Python functions, which without stackless calls would
+# exhaust the C stack
+
+# native code always recurses on the C stack, so keep these functions bytecode
+try:
+    import micropython
+    micropython.jit_threshold(0)
+except (ImportError, AttributeError):
+    pass
+
+def f(n):
+    if n == 0:
+        return 0
+    return 1 + f(n - 1)
+
+try:
+    print(f(2000))
+except RuntimeError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# frames are released on return, also when unwinding an exception
+def g(n):
+    if n == 0:
+        raise ValueError
+    g(n - 1)
+
+for i in range(100):
+    try:
+        g(50)
+    except ValueError:
+        pass
+print(f(50), f(2000))
+
+# methods, keyword args and var args
+class A:
+    def m(self, n, k=0):
+        if n == 0:
+            return k
+        return self.m(n - 1, k=k + 1)
+print(A().m(1000))
+
+def v(n, *args):
+    if n == 0:
+        return len(args)
+    return v(n - 1, *args)
+print(v(1000, 1, 2, 3))
@@ -0,0 +1,35 @@
+# test _thread.exit and the thread identity functions
+
+try:
+    import _thread
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+try:
+    import utime as time
+except ImportError:
+    import time
+
+lock = _thread.allocate_lock()
+idents = []
+
+def thread_entry():
+    with lock:
+        idents.append(_thread.get_ident())
+    _thread.exit()
+    idents.append(None)
+
+lock.acquire()
+_thread.start_new_thread(thread_entry, ())
+main_ident = _thread.get_ident()
+lock.release()
+
+while True:
+    with lock:
+        if idents:
+            break
+    time.sleep(0.01)
+time.sleep(0.05)
+
+print(len(idents), idents[0] != main_ident)
@@ -0,0 +1,30 @@
+# test exiting the interpreter while other threads are still running
+
+try:
+    import _thread
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+lock = _thread.allocate_lock()
+n_running = 0
+
+def thread_entry(n):
+    global n_running
+    with lock:
+        n_running += 1
+    while True:
+        l = [n] * 10
+
+# some threads are running Python code when the main thread exits, and the
+# last ones are started just before it exits, so they haven't run yet
+for i in range(3):
+    _thread.start_new_thread(thread_entry, (i,))
+while True:
+    with lock:
+        if n_running == 3:
+            break
+print('done')
+for i in range(3):
+    _thread.start_new_thread(thread_entry, (i,))
@@ -0,0 +1,41 @@
+# test that the GC finds objects only referenced by other threads
+
+try:
+    import _thread
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+try:
+    import utime as time
+except ImportError:
+    import time
+import gc
+
+lock = _thread.allocate_lock()
+n_finished = 0
+results = []
+
+def thread_entry(k):
+    global n_finished
+    data = [[k, i, str(i) * 3] for i in range(50)]
+    for j in range(100):
+        tmp = [bytearray(20) for _ in range(10)]
+        if j % 25 == 0:
+            gc.collect()
+    ok = all(d[0] == k and d[2] == str(d[1]) * 3 for d in data)
+    with lock:
+        results.append(ok)
+        n_finished += 1
+
+n_thread = 4
+for i in range(n_thread):
+    _thread.start_new_thread(thread_entry, (i,))
+
+while True:
+    with lock:
+        if n_finished == n_thread:
+            break
+    time.sleep(0.01)
+
+print(results)
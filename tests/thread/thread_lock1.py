@@ -0,0 +1,28 @@
+# test _thread lock object
+
+try:
+    import _thread
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+lock = _thread.allocate_lock()
+print(type(lock) == _thread.LockType)
+print(lock.locked())
+print(lock.acquire())
+print(lock.locked())
+print(lock.acquire(0))
+lock.release()
+print(lock.locked())
+
+# context manager
+with lock:
+    print(lock.locked())
+print(lock.locked())
+
+# releasing an unlocked lock is an error
+try:
+    lock.release()
+except RuntimeError:
+    print("RuntimeError")
@@ -0,0 +1,38 @@
+# test starting threads and passing them args
+
+try:
+    import _thread
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+try:
+    import utime as time
+except ImportError:
+    import time
+
+lock = _thread.allocate_lock()
+n_finished = 0
+results = []
+
+def thread_entry(n, step, name='x'):
+    global n_finished
+    total = 0
+    for i in range(0, n, step):
+        total += i
+    with lock:
+        results.append((name, total))
+        n_finished += 1
+
+n_thread = 4
+for i in range(n_thread):
+    _thread.start_new_thread(thread_entry, (1000 * (i + 1), i + 1), {'name': str(i)})
+
+# wait for the threads to finish
+while True:
+    with lock:
+        if n_finished == n_thread:
+            break
+    time.sleep(0.01)
+
+print(sorted(results))
@@ -0,0 +1,30 @@
+# test indexing a str in sequence, in both directions and at random
+
+s = 'aé€😀b' * 6
+n = len(s)
+print(n)
+print(''.join(s[i] for i in range(n)))
+print(''.join(s[i] for i in range(n - 1, -1, -1)))
+print(''.join(s[-i] for i in range(1, n + 1)))
+print(''.join(s[(i * 7) % n] for i in range(n)))
+
+# switch between two strs
+t = 'xyz' * 10
+print(''.join(s[i] + t[i] for i in range(n)))
+
+# slices and bounds
+print(s[3:9], s[-9:-3], s[n - 2:n + 5], s[-n - 5:2])
+for i in (n, -n - 1):
+    try:
+        s[i]
+    except IndexError:
+        print('IndexError', i)
+
+# find with start, from successive positions
+i = -1
+while True:
+    i = s.find('😀', i + 1)
+    if i < 0:
+        break
+    print(i, end=' ')
+print()
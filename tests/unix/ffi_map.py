@@ -0,0 +1,55 @@
+# test ffifunc.map and passing of buffers as pointers
+
+try:
+    import ffi
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+import array
+
+def ffi_open(names):
+    err = None
+    for n in names:
+        try:
+            mod = ffi.open(n)
+            return mod
+        except OSError as e:
+            err = e
+    raise err
+
+libc = ffi_open(('libc.so', 'libc.so.0', 'libc.so.6', 'libc.dylib'))
+
+abs_ = libc.func("i", "abs", "i")
+print(abs_(-5))
+print(abs_.map([1, -2, 3, -4]))
+print(abs_.map((x,) for x in range(-2, 2)))
+
+strlen = libc.func("L", "strlen", "s")
+print(strlen.map(["", "a", "hello"]))
+print(strlen(b"abc\0def"))
+
+# memset writes through to the buffer, which is not copied
+memset = libc.func("p", "memset", "pil")
+ba = bytearray(8)
+memset(ba, 0x41, 3)
+print(ba)
+memset(memoryview(ba)[4:], 0x42, 2)
+print(ba)
+a = array.array('B', [0] * 4)
+print(memset.map([(a, 1, 1), (memoryview(a)[2:], 2, 2)]) is not None)
+print(a)
+
+# a function returning void gives None
+srand = libc.func("v", "srand", "I")
+print(srand.map([1, 2]))
+
+try:
+    abs_.map([(1, 2)])
+except TypeError:
+    print("TypeError")
+try:
+    abs_(1, 2)
+except TypeError:
+    print("TypeError")
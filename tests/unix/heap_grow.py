@@ -0,0 +1,18 @@
+# test that the heap grows when it runs out of memory
+
+import gc
+
+gc.collect()
+total0 = gc.mem_free() + gc.mem_alloc()
+
+# more live data than the default heap holds
+l = [bytearray(1000) for i in range(2000)]
+print(len(l), sum(len(b) for b in l))
+total1 = gc.mem_free() + gc.mem_alloc()
+print(total1 > total0, total1 > 2000000)
+
+# the memory can be used again once freed
+l = None
+gc.collect()
+l = [bytearray(1000) for i in range(2000)]
+print(len(l))
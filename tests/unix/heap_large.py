@@ -0,0 +1,27 @@
+# test objects big enough to be allocated outside the heap's blocks
+
+import gc
+
+# a big buffer, and growing and shrinking it
+b = bytearray(300000)
+print(len(b), b[0], b[-1])
+b[-1] = 1
+for i in range(100000):
+    b.append(i & 0xff)
+print(len(b), b[299999], b[-1])
+b = b[:10]
+print(len(b))
+
+# a big list keeps the objects it refers to alive across collections
+l = [[i] for i in range(40000)]
+gc.collect()
+x = [[0] * 4 for i in range(10000)]
+print(sum(i[0] for i in l))
+
+# big objects are collected as they are replaced
+gc.collect()
+a0 = gc.mem_alloc()
+for i in range(20):
+    b = bytearray(1000000)
+gc.collect()
+print(gc.mem_alloc() - a0 < 5000000)
@@ -0,0 +1,34 @@
+try:
+    import mmap
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+import ure, ustruct
+
+data = open("io/data/file1", "rb").read()
+f = open("io/data/file1", "rb")
+# a length of 0 maps the whole file
+m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+print(len(m) == len(data), m[0] == data[0], m[2:6] == data[2:6])
+print(bytes(memoryview(m)[1:4]) == data[1:4])
+print(ustruct.unpack_from("<H", m, 2) == ustruct.unpack_from("<H", data, 2))
+print(ure.search(b"[a-z]+", m).group(0) == ure.search(b"[a-z]+", data).group(0))
+try:
+    m[0] = 1
+except TypeError:
+    print("TypeError")
+m.close()
+try:
+    m[0]
+except ValueError:
+    print("ValueError")
+
+# a file object can be given instead of an fd, and with closes the map
+with mmap.mmap(f, 3, access=mmap.ACCESS_READ) as m:
+    print(len(m), m[:] == data[:3])
+try:
+    len(m)
+except ValueError:
+    print("ValueError")
+f.close()
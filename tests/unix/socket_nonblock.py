@@ -0,0 +1,30 @@
+try:
+    import usocket as socket
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+s = socket.socket()
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+addr = socket.getaddrinfo("127.0.0.1", 8271)[0][4]
+s.bind(addr)
+s.listen(2)
+s.setblocking(False)
+# no pending connection
+print(s.accept())
+c = socket.socket()
+c.setblocking(False)
+c.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+print(c.getsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY) != 0)
+# the connection completes in the background
+print(c.connect(addr))
+print(c.getsockopt(socket.SOL_SOCKET, socket.SO_ERROR))
+buf = bytearray(16)
+# the address goes into the given buffer
+a = s.accept(buf)
+print(type(a), buf[4:8] == addr[4:8])
+print(len(c.getsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4)))
+a.close()
+c.close()
+s.close()
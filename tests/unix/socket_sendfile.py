@@ -0,0 +1,34 @@
+try:
+    import usocket as socket
+    socket.sendfile
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+s = socket.socket()
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+addr = socket.getaddrinfo("127.0.0.1", 8267)[0][4]
+s.bind(addr)
+s.listen(1)
+c = socket.socket()
+c.connect(addr)
+a = s.accept()[0]
+
+data = open("io/data/file1", "rb").read()
+f = open("io/data/file1", "rb")
+# whole file
+print(a.sendfile(f) == len(data))
+print(c.recv(1000) == data)
+# from an offset; the file position ends up after what was sent
+print(a.sendfile(f, 2, 5))
+print(c.recv(1000) == data[2:7])
+print(f.read(3) == data[7:10])
+# the function form takes fds too, and sends from the current position
+print(socket.sendfile(a.fileno(), f.fileno(), None, 4))
+print(c.recv(1000) == data[10:14])
+f.close()
+
+a.close()
+c.close()
+s.close()
@@ -0,0 +1,36 @@
+try:
+    import usocket as socket
+    socket.socket.sendv
+except (ImportError, AttributeError):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+addr = socket.getaddrinfo("127.0.0.1", 8269)[0][4]
+a = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+a.bind(addr)
+b = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+b.connect(addr)
+# the buffers go out as one datagram
+print(b.sendv([b"abc", bytearray(b"de"), b""]))
+buf = bytearray(10)
+print(a.recv_into(buf), buf)
+b.send(b"xyz")
+n, frm = a.recvfrom_into(buf, 2)
+print(n, buf, len(frm))
+for i in range(3):
+    b.send(b"p%d" % i * (i + 1))
+# several datagrams with one call
+bufs = [bytearray(8) for i in range(5)]
+lens = [0] * 5
+print(a.recvmmsg(bufs, lens, socket.MSG_DONTWAIT), lens, bufs[:3])
+b.send(b"q")
+print(a.recvmmsg(bufs), bufs[0])
+try:
+    a.recvmmsg(bufs, None, socket.MSG_DONTWAIT)
+except OSError as e:
+    print("OSError", e.args[0] == 11)
+b.send(b"hello")
+print(a.recv(100))
+a.close()
+b.close()
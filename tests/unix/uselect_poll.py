@@ -0,0 +1,46 @@
+try:
+    import uselect, usocket
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+p = uselect.poll()
+s = usocket.socket(usocket.AF_INET, usocket.SOCK_DGRAM)
+
+# an unbound datagram socket is writable but not readable
+p.register(s, uselect.POLLIN)
+print(p.poll(0))
+p.modify(s, uselect.POLLOUT)
+r = p.poll(0)
+print(len(r), r[0][0] is s, r[0][1] == uselect.POLLOUT)
+
+# a plain fd can be registered too; ipoll yields the same tuple for each
+# ready object
+s2 = usocket.socket(usocket.AF_INET, usocket.SOCK_DGRAM)
+fd = s2.fileno()
+p.register(fd, uselect.POLLOUT)
+res = []
+for obj, ev in p.ipoll(0):
+    res.append((obj is s or obj == fd, ev))
+print(res)
+it = p.ipoll(0)
+print(next(it) is next(it))
+
+p.unregister(s)
+print(p.poll(0) == [(fd, uselect.POLLOUT)])
+p.unregister(fd)
+print(p.poll(0))
+
+try:
+    p.unregister(s)
+except KeyError:
+    print("KeyError")
+try:
+    p.modify(s, uselect.POLLIN)
+except OSError as e:
+    print("OSError", e.args[0])
+
+p.close()
+s.close()
+s2.close()
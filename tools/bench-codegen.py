@@ -0,0 +1,52 @@
+#! /usr/bin/env python3
+
+# Generate a C header with the benchmarks in tests/bench as strings, so that
+# they can be built into a firmware without a filesystem (eg qemu-arm).
+# Must be run from the tests directory.
+#
+# The bench module is replaced by a small class that just calls the test
+# function, so that nothing is timed, and all iteration counts are divided
+# by the given factor (default 1000) to keep the runs short.
+
+import sys
+from glob import glob
+from re import match
+
+ITERS = 20000000
+
+# these need modules that are not in the minimal ports
+exclude_tests = ('bench/json-1-dumps_loads.py', 'bench/regex-1-match_search.py',)
+
+def escape(s):
+  lookup = {
+    '\0': '\\0',
+    '\t': '\\t',
+    '\n': '\\n\"\n\"',
+    '\r': '\\r',
+    '\\': '\\\\',
+    '\"': '\\\"',
+  }
+  return "\"\"\n\"{}\"".format(''.join([lookup[x] if x in lookup else x for x in s]))
+
+def bench_shim(div):
+  return (
+    "class bench:\n"
+    "    def run(f, iters={}):\n"
+    "        f(max(1, iters // {}))\n"
+  ).format(ITERS, div)
+
+def script_to_c(t, div):
+  with open(t) as f:
+    lines = f.readlines()
+  # some benchmarks use the default count directly, scale it too
+  lines = [l.replace(str(ITERS), str(ITERS // div)) for l in lines]
+  script = ''.join(bench_shim(div) if l.strip() == 'import bench' else l for l in lines)
+  return "  {{ \"{}\", {} }},".format(t, escape(script))
+
+div = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+
+tests = sorted(t for t in glob('bench/*.py') if match(r'bench/.+?-.+\.py$', t) and t not in exclude_tests)
+
+print("static const struct {\n  const char *name;\n  const char *script;\n} bench_scripts[] = {")
+print('\n'.join(script_to_c(t, div) for t in tests))
+print("};")
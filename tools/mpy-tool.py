@@ -0,0 +1,443 @@
+#!/usr/bin/env python3
+#
+# Convert precompiled bytecode (.mpy files, made by mpy-cross) into frozen
+# bytecode for MicroPython.
+#
+# Usage:
+#
+# ./mpy-tool.py -o frozen_mpy.c -q frozen_mpy_qstr.h foo.mpy bar.mpy
+#
+# This writes the bytecode, constant objects and raw code structures as const
+# C data into frozen_mpy.c, and the qstrs that they use into frozen_mpy_qstr.h.
+# Add the latter to QSTR_DEFS and the former to the build, and define
+# MICROPY_MODULE_FROZEN_MPY in the config; the modules can then be imported
+# (by the name of the .mpy file) and run in place, without heap for the code.
+#
+# py/py.mk does all of this if FROZEN_MPY_DIR is set to a directory of .py
+# files (only modules, not packages, are supported so far).
+#
+
+from __future__ import print_function
+
+import argparse
+import math
+import struct
+import os
+import sys
+
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../py'))
+import makeqstrdata as qstrutil
+
+# must match py/emitglue.c
+MPY_VERSION = 0
+MPY_FEATURE_CACHE_MAP_LOOKUP = 1
+MPY_FEATURE_FUSED_OPCODES = 2
+MPY_FEATURE_FOR_RANGE = 4
+
+class FreezeError(Exception):
+    pass
+
+class Reader:
+    def __init__(self, filename):
+        with open(filename, 'rb') as f:
+            self.data = bytearray(f.read())
+        self.filename = filename
+        self.pos = 0
+
+    def read_byte(self):
+        if self.pos >= len(self.data):
+            raise FreezeError('%s: unexpected end of file' % self.filename)
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def read_bytes(self, n):
+        if self.pos + n > len(self.data):
+            raise FreezeError('%s: unexpected end of file' % self.filename)
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+    def read_uint(self):
+        n = 0
+        while True:
+            b = self.read_byte()
+            n = (n << 7) | (b & 0x7f)
+            if b & 0x80 == 0:
+                return n
+
+    def read_qstr(self):
+        return bytes(self.read_bytes(self.read_uint()))
+
+class RawCode:
+    # a counter to give each raw code and constant a unique C name
+    next_id = 0
+
+    def __init__(self, reader):
+        self.id = RawCode.next_id
+        RawCode.next_id += 1
+
+        self.scope_flags = reader.read_uint()
+        self.n_pos_args = reader.read_uint()
+        self.n_kwonly_args = reader.read_uint()
+
+        self.bytecode = reader.read_bytes(reader.read_uint())
+        self.qstr_slots = {}
+        ofs = 0
+        while True:
+            delta = reader.read_uint()
+            if delta == 0:
+                break
+            ofs += delta
+            if ofs + 2 > len(self.bytecode):
+                raise FreezeError('%s: bad qstr fixup' % reader.filename)
+            self.qstr_slots[ofs] = reader.read_qstr()
+
+        n_obj = reader.read_uint()
+        n_raw_code = reader.read_uint()
+        self.arg_names = [reader.read_qstr() for i in range(self.n_pos_args + self.n_kwonly_args)]
+        self.objs = [self.read_obj(reader) for i in range(n_obj)]
+        self.raw_codes = [RawCode(reader) for i in range(n_raw_code)]
+
+    def read_obj(self, reader):
+        obj_type = chr(reader.read_byte())
+        if obj_type in 'neFT':
+            return (obj_type, None)
+        elif obj_type == 't':
+            return (obj_type, [self.read_obj(reader) for i in range(reader.read_uint())])
+        data = bytes(reader.read_bytes(reader.read_uint()))
+        if obj_type in 'sb':
+            return (obj_type, data)
+        elif obj_type == 'i':
+            return (obj_type, int(data))
+        elif obj_type == 'f':
+            return (obj_type, float(data))
+        elif obj_type == 'c':
+            real, imag = data.split(b' ')
+            return (obj_type, (float(real), float(imag)))
+        else:
+            raise FreezeError('%s: unknown object type %r' % (reader.filename, obj_type))
+
+    def qstrs(self):
+        for q in self.qstr_slots.values():
+            yield q
+        for q in self.arg_names:
+            yield q
+        for rc in self.raw_codes:
+            for q in rc.qstrs():
+                yield q
+
+    def freeze(self, bytecode_const, small_int_bits):
+        # inner raw codes must be defined first so they can be referenced
+        for rc in self.raw_codes:
+            rc.freeze(bytecode_const, small_int_bits)
+
+        # the bytecode, with the qstr slots filled in
+        print('STATIC %sbyte bytecode_data_%d[%d] = {' % (bytecode_const, self.id, len(self.bytecode)))
+        i = 0
+        line = []
+        while i < len(self.bytecode):
+            if i in self.qstr_slots:
+                q = qstr_ident(self.qstr_slots[i])
+                line.append('MP_QSTR_%s & 0xff, MP_QSTR_%s >> 8,' % (q, q))
+                i += 2
+            else:
+                line.append('0x%02x,' % self.bytecode[i])
+                i += 1
+            if len(line) >= 12 or (line and line[-1].startswith('MP_QSTR')):
+                print('    ' + ' '.join(line))
+                line = []
+        if line:
+            print('    ' + ' '.join(line))
+        print('};')
+
+        # the constant objects
+        const_table = []
+        for q in self.arg_names:
+            const_table.append('(mp_uint_t)MP_OBJ_NEW_QSTR(MP_QSTR_%s)' % qstr_ident(q))
+        for i, obj in enumerate(self.objs):
+            const_table.append('(mp_uint_t)%s' % freeze_obj('const_obj_%d_%d' % (self.id, i), obj, small_int_bits))
+        for rc in self.raw_codes:
+            const_table.append('(mp_uint_t)&raw_code_%d' % rc.id)
+
+        # the constant table: arg names, then the objects, then the raw codes
+        if const_table:
+            print('STATIC const mp_uint_t const_table_data_%d[%d] = {' % (self.id, len(const_table)))
+            for c in const_table:
+                print('    %s,' % c)
+            print('};')
+            const_table_name = 'const_table_data_%d' % self.id
+        else:
+            const_table_name = 'NULL'
+
+        print('STATIC const mp_raw_code_t raw_code_%d = {' % self.id)
+        print('    .kind = MP_CODE_BYTECODE,')
+        print('    .scope_flags = 0x%02x,' % self.scope_flags)
+        print('    .n_pos_args = %d,' % self.n_pos_args)
+        print('    .n_kwonly_args = %d,' % self.n_kwonly_args)
+        print('    .data.u_byte = {')
+        print('        .code = (byte*)bytecode_data_%d,' % self.id)
+        print('        .len = %d,' % len(self.bytecode))
+        print('        .const_table = %s,' % const_table_name)
+        print('        #if MICROPY_PERSISTENT_CODE_SAVE')
+        print('        .n_obj = %d,' % len(self.objs))
+        print('        .n_raw_code = %d,' % len(self.raw_codes))
+        print('        #endif')
+        print('    },')
+        print('};')
+        print()
+
+def freeze_obj(name, obj, small_int_bits):
+    # writes out the definition of a constant object if it needs one, and
+    # returns the C expression for the object
+    obj_type, value = obj
+    if obj_type == 'n':
+        return 'mp_const_none'
+    elif obj_type == 'e':
+        return '&mp_const_ellipsis_obj'
+    elif obj_type == 'F':
+        return 'mp_const_false'
+    elif obj_type == 'T':
+        return 'mp_const_true'
+    elif obj_type in 'sb':
+        # a const object can't cache its hash, so give the hash for each
+        # hash function and width the target may use; see MP_FROZEN_STR_HASH
+        text = value.decode('latin-1')
+        hashes = [qstrutil.compute_hash(text, b, fn)
+            for fn in (qstrutil.HASH_DJB2, qstrutil.HASH_FNV1A_WORD) for b in (1, 2)]
+        print('STATIC const mp_obj_str_t %s = {{&mp_type_%s}, MP_FROZEN_STR_HASH(%s), %d, (const byte*)"%s"};'
+            % (name, 'str' if obj_type == 's' else 'bytes',
+            ', '.join(str(h) for h in hashes), len(value), c_escape(value)))
+    elif obj_type == 'i':
+        # ints in a tuple may be small; the target has at least as many
+        # small int bits as the .mpy file
+        if -(1 << (small_int_bits - 1)) <= value < 1 << (small_int_bits - 1):
+            return 'MP_OBJ_NEW_SMALL_INT(%d)' % value
+        freeze_int(name, value)
+    elif obj_type == 'f':
+        # with object representations C and D a float is stored in the
+        # object word itself, so it needs no const object at all
+        print('#if !MICROPY_PY_BUILTINS_FLOAT')
+        print('#error "the frozen bytecode needs MICROPY_PY_BUILTINS_FLOAT"')
+        print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C')
+        print('#define %s_ref ((mp_obj_t)0x%016xULL)' % (name, float_obj_repr_c(value)))
+        print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D')
+        print('#define %s_ref ((mp_obj_t)0x%08xUL)' % (name, float_obj_repr_d(value)))
+        print('#else')
+        print('STATIC const mp_obj_float_t %s = {{&mp_type_float}, %s};' % (name, c_float(value)))
+        print('#define %s_ref ((mp_obj_t)&%s)' % (name, name))
+        print('#endif')
+        return name + '_ref'
+    elif obj_type == 'c':
+        print('#if MICROPY_PY_BUILTINS_COMPLEX')
+        print('STATIC const mp_obj_complex_t %s = {{&mp_type_complex}, %s, %s};'
+            % (name, c_float(value[0]), c_float(value[1])))
+        print('#else')
+        print('#error "the frozen bytecode needs MICROPY_PY_BUILTINS_COMPLEX"')
+        print('#endif')
+    elif obj_type == 't':
+        if not value:
+            return 'mp_const_empty_tuple'
+        items = [freeze_obj('%s_%d' % (name, i), item, small_int_bits) for i, item in enumerate(value)]
+        # same layout as mp_obj_tuple_t, but with a fixed number of items
+        print('STATIC const struct { mp_obj_base_t base; mp_uint_t len; MP_FROZEN_TUPLE_HASH_FIELD mp_obj_t items[%d]; } %s = {{&mp_type_tuple}, %d, MP_FROZEN_TUPLE_HASH_INIT {%s}};'
+            % (len(items), name, len(items), ', '.join('(mp_obj_t)%s' % item for item in items)))
+    return '&' + name
+
+def qstr_text(q):
+    # the text of a qstr as it appears in a Q(...) line; makeqstrdata.py decodes
+    # octal escapes, and the best characters to escape are those that it can't
+    # make into an identifier
+    text = ''
+    for b in bytearray(q):
+        c = chr(b)
+        if (c.isalnum() or c == '_' or b in qstrutil.codepoint2name) and 32 <= b < 127 and c != '\\':
+            text += c
+        else:
+            text += '\\%03o' % b
+    return text
+
+def qstr_ident(q):
+    return qstrutil.qstr_escape(qstr_text(q))
+
+def c_escape(data):
+    # escape bytes for a C string literal; octal escapes are always 3 digits
+    # so they can't run into a following digit, and '?' avoids trigraphs
+    s = ''
+    for b in bytearray(data):
+        c = chr(b)
+        if 32 <= b < 127 and c not in '\\"?':
+            s += c
+        else:
+            s += '\\%03o' % b
+    return s
+
+def c_float(f):
+    if math.isinf(f):
+        return '%sINFINITY' % ('-' if f < 0 else '')
+    elif math.isnan(f):
+        return 'NAN'
+    else:
+        return repr(f)
+
+# these must match mp_obj_new_float in obj.h
+def float_obj_repr_c(value):
+    bits = struct.unpack('<Q', struct.pack('<d', value))[0]
+    o = (bits + 0x8004000000000000) & 0xffffffffffffffff
+    if o >> 50 == 0:
+        # a NaN that would look like another kind of object
+        o = (0x7ff8000000000000 + 0x8004000000000000) & 0xffffffffffffffff
+    return o
+
+def float_obj_repr_d(value):
+    try:
+        bits = struct.unpack('<I', struct.pack('<f', value))[0]
+    except OverflowError:
+        bits = 0x7f800000 if value > 0 else 0xff800000
+    o = (((bits & ~3) | 2) + 0x80800000) & 0xffffffff
+    if o & 0xff800007 == 0x00000006:
+        # a NaN that would look like a qstr
+        o = ((0x7fc00000 | 2) + 0x80800000) & 0xffffffff
+    return o
+
+def freeze_int(name, value):
+    neg = value < 0
+    value = abs(value)
+    print('#if MICROPY_LONGINT_IMPL == MICROPY_LONGINT_IMPL_LONGLONG')
+    if value < 1 << 63:
+        print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, %s%dLL};' % (name, '-' if neg else '', value))
+    else:
+        print('#error "the frozen bytecode has an int that is too big for long long"')
+    print('#elif MICROPY_LONGINT_IMPL == MICROPY_LONGINT_IMPL_MPZ')
+    for i, dig_size in enumerate((16, 32)):
+        digs = []
+        v = value
+        while v:
+            digs.append(v & ((1 << dig_size) - 1))
+            v >>= dig_size
+        print('#%s MPZ_DIG_SIZE == %d' % ('if' if i == 0 else 'elif', dig_size))
+        print('STATIC const mpz_dig_t %s_digits[] = {%s};' % (name, ', '.join('0x%x' % d for d in digs)))
+        print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, {.neg = %d, .fixed_dig = 1, .alloc = %d, .len = %d, .dig = (mpz_dig_t*)%s_digits}};'
+            % (name, neg, len(digs), len(digs), name))
+    print('#else')
+    print('#error "the frozen bytecode needs MPZ_DIG_SIZE of 16 or 32"')
+    print('#endif')
+    print('#else')
+    print('#error "the frozen bytecode needs long int support"')
+    print('#endif')
+
+def read_mpy(filename):
+    reader = Reader(filename)
+    header = reader.read_bytes(4)
+    if header[0] != ord('M') or header[1] != MPY_VERSION:
+        raise FreezeError('%s: not a compatible .mpy file' % filename)
+    return header[2], header[3], RawCode(reader)
+
+def freeze_mpy(filenames, qstr_filename):
+    modules = []
+    feature_flags = None
+    small_int_bits = 0
+    for filename in filenames:
+        flags, bits, rc = read_mpy(filename)
+        if feature_flags is not None and flags != feature_flags:
+            raise FreezeError('%s: was made with different options to the other files' % filename)
+        feature_flags = flags
+        small_int_bits = max(small_int_bits, bits)
+        name = os.path.basename(filename)
+        if name.endswith('.mpy'):
+            name = name[:-4]
+        modules.append((name, rc))
+
+    # write out the qstrs used by all the modules
+    with open(qstr_filename, 'w') as f:
+        f.write('// qstrs used by the frozen bytecode; generated by mpy-tool.py\n')
+        qstrs = set()
+        for name, rc in modules:
+            for q in rc.qstrs():
+                if q not in qstrs:
+                    qstrs.add(q)
+                    f.write('Q(%s)\n' % qstr_text(q))
+
+    print('// frozen bytecode, generated by mpy-tool.py')
+    print()
+    print('#include <math.h>')
+    print()
+    print('#include "py/mpconfig.h"')
+    print('#include "py/objint.h"')
+    print('#include "py/objstr.h"')
+    print('#include "py/emitglue.h"')
+    print('#include "py/smallint.h"')
+    print()
+    print('#if !MICROPY_MODULE_FROZEN_MPY')
+    print('#error "frozen bytecode needs MICROPY_MODULE_FROZEN_MPY"')
+    print('#endif')
+    print()
+    print('// picks the precomputed hash of a const str/bytes for the target; 0 for')
+    print('// other widths means the hash is computed each time it is needed')
+    print('#if MICROPY_QSTR_HASH == MICROPY_QSTR_HASH_FNV1A_WORD')
+    print('#define MP_FROZEN_STR_HASH(d1, d2, f1, f2) (MICROPY_QSTR_BYTES_IN_HASH == 1 ? (f1) : MICROPY_QSTR_BYTES_IN_HASH == 2 ? (f2) : 0)')
+    print('#else')
+    print('#define MP_FROZEN_STR_HASH(d1, d2, f1, f2) (MICROPY_QSTR_BYTES_IN_HASH == 1 ? (d1) : MICROPY_QSTR_BYTES_IN_HASH == 2 ? (d2) : 0)')
+    print('#endif')
+    print()
+    print('// a const tuple has the (never cached) hash slot of mp_obj_tuple_t')
+    print('#if MICROPY_OPT_CACHE_HASH')
+    print('#define MP_FROZEN_TUPLE_HASH_FIELD mp_uint_t hash;')
+    print('#define MP_FROZEN_TUPLE_HASH_INIT 0,')
+    print('#else')
+    print('#define MP_FROZEN_TUPLE_HASH_FIELD')
+    print('#define MP_FROZEN_TUPLE_HASH_INIT')
+    print('#endif')
+    print()
+    print('// the bytecode must have been made with the same options as the target')
+    if feature_flags is not None:
+        print('#if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE != %d'
+            % bool(feature_flags & MPY_FEATURE_CACHE_MAP_LOOKUP))
+        print('#error "incompatible MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE"')
+        print('#endif')
+        if feature_flags & MPY_FEATURE_FUSED_OPCODES:
+            print('#if !MICROPY_OPT_FUSED_OPCODES')
+            print('#error "the frozen bytecode needs MICROPY_OPT_FUSED_OPCODES"')
+            print('#endif')
+        if feature_flags & MPY_FEATURE_FOR_RANGE:
+            print('#if !MICROPY_OPT_FOR_RANGE')
+            print('#error "the frozen bytecode needs MICROPY_OPT_FOR_RANGE"')
+            print('#endif')
+        print('typedef int mp_frozen_mpy_check_small_int_bits[((unsigned long long)MP_SMALL_INT_MAX >= %dULL) ? 1 : -1];'
+            % ((1 << (small_int_bits - 1)) - 1))
+    print()
+
+    # the map lookup cache is written by the VM, so such bytecode must be in RAM
+    if feature_flags is not None and feature_flags & MPY_FEATURE_CACHE_MAP_LOOKUP:
+        bytecode_const = ''
+    else:
+        bytecode_const = 'const '
+    for name, rc in modules:
+        rc.freeze(bytecode_const, small_int_bits)
+
+    print('const char mp_frozen_mpy_names[] = {')
+    for name, rc in modules:
+        print('    "%s\\0"' % c_escape(name.encode('utf-8')))
+    print('    "\\0"};')
+    print('const mp_raw_code_t *const mp_frozen_mpy_content[] = {')
+    for name, rc in modules:
+        print('    &raw_code_%d,' % rc.id)
+    print('};')
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Convert .mpy files to frozen bytecode.')
+    cmd_parser.add_argument('-o', '--output', help='output C file (default: stdout)')
+    cmd_parser.add_argument('-q', '--qstr-output', required=True, help='output file for the qstrs')
+    cmd_parser.add_argument('files', nargs='*', help='input .mpy files')
+    args = cmd_parser.parse_args()
+
+    if args.output:
+        sys.stdout = open(args.output, 'w')
+    try:
+        freeze_mpy(args.files, args.qstr_output)
+    except FreezeError as er:
+        print('error:', er, file=sys.stderr)
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
@@ -27,10 +27,16 @@ Or:
 
     python pyboard.py test.py
 
+To copy a file to or from the pyboard's filesystem, use:
+
+    ./pyboard.py put app.py /flash/app.py
+    ./pyboard.py get /flash/log.txt log.txt
+
 """
 
 import sys
 import time
+import binascii
 import serial
 
 def stdout_write_bytes(b):
@@ -40,6 +46,19 @@ def stdout_write_bytes(b):
 class PyboardError(BaseException):
     pass
 
+# binary file transfer in the raw REPL; see stmhal/pyexec.c for the protocol
+FT_CHUNK_MAX = 512
+FT_WINDOW = 4
+FT_MAX_RETRIES = 8
+FT_ACK = 0x06
+FT_NAK = 0x15
+FT_CAN = 0x18
+
+def ft_chunk(seq, data):
+    chunk = bytes([seq & 0xff, len(data) & 0xff, len(data) >> 8]) + data
+    crc = binascii.crc_hqx(chunk, 0xffff)
+    return chunk + bytes([crc & 0xff, crc >> 8])
+
 class Pyboard:
     def __init__(self, serial_device):
         self.serial = serial.Serial(serial_device, baudrate=115200, interCharTimeout=1)
@@ -136,6 +155,104 @@ class Pyboard:
             pyfile = f.read()
         return self.exec(pyfile)
 
+    def _ft_drain(self):
+        # wait for the line to go quiet and drop what arrived
+        time.sleep(0.05)
+        while self.serial.inWaiting() > 0:
+            self.serial.read(self.serial.inWaiting())
+            time.sleep(0.05)
+
+    def _ft_command(self, cmd, filename):
+        name = bytes(filename, encoding='utf8')
+        self.serial.write(b'\x06' + cmd + bytes([len(name)]) + name)
+        if self.serial.read(1) != b'O':
+            self.read_until(1, b'>')
+            raise PyboardError('could not open {}'.format(filename))
+
+    def _ft_status(self):
+        status = self.read_until(2, b'>')
+        if not status.endswith(b'O>'):
+            raise PyboardError('file transfer failed')
+
+    def _ft_send(self, data):
+        chunks = [data[i:i + FT_CHUNK_MAX] for i in range(0, len(data), FT_CHUNK_MAX)] + [b'']
+        base = 0
+        next = 0
+        retries = 0
+        while base < len(chunks):
+            while next < len(chunks) and next - base < FT_WINDOW:
+                self.serial.write(ft_chunk(next, chunks[next]))
+                next += 1
+            reply = self.serial.read(2)
+            ahead = (reply[1] - base) & 0xff if len(reply) == 2 else 0xff
+            if len(reply) == 2 and reply[0] == FT_ACK and ahead <= next - base:
+                base += ahead
+                retries = 0
+                continue
+            if reply[:1] == bytes([FT_CAN]) or reply[:1] == b'E':
+                raise PyboardError('board could not write file')
+            retries += 1
+            if retries > FT_MAX_RETRIES:
+                raise PyboardError('too many retries')
+            self._ft_drain()
+            if len(reply) == 2 and reply[0] == FT_NAK and ahead <= next - base:
+                base += ahead
+            next = base
+
+    def _ft_recv(self):
+        data = []
+        seq = 0
+        retries = 0
+        while True:
+            hdr = self.serial.read(3)
+            n = hdr[1] | hdr[2] << 8 if len(hdr) == 3 else 0
+            if len(hdr) == 3 and n <= FT_CHUNK_MAX:
+                rest = self.serial.read(n + 2)
+                crc = binascii.crc_hqx(hdr + rest[:n], 0xffff)
+                if len(rest) == n + 2 and rest[n] | rest[n + 1] << 8 == crc:
+                    if hdr[0] == seq:
+                        if n == 0:
+                            self.serial.write(bytes([FT_ACK, (seq + 1) & 0xff]))
+                            return b''.join(data)
+                        data.append(rest[:n])
+                        seq = (seq + 1) & 0xff
+                        retries = 0
+                    self.serial.write(bytes([FT_ACK, seq]))
+                    continue
+            if len(hdr) == 3 and hdr[0] == FT_CAN and hdr[2:] == b'E':
+                raise PyboardError('board could not read file')
+            retries += 1
+            if retries > FT_MAX_RETRIES:
+                raise PyboardError('too many retries')
+            self._ft_drain()
+            self.serial.write(bytes([FT_NAK, seq]))
+
+    def fs_put(self, src, dest):
+        # copy the local file src to dest on the pyboard; needs the raw REPL
+        with open(src, 'rb') as f:
+            data = f.read()
+        timeout = self.serial.timeout
+        self.serial.timeout = 1
+        try:
+            self._ft_command(b'W', dest)
+            self._ft_send(data)
+            self._ft_status()
+        finally:
+            self.serial.timeout = timeout
+
+    def fs_get(self, src, dest):
+        # copy the file src on the pyboard to the local file dest; needs the raw REPL
+        timeout = self.serial.timeout
+        self.serial.timeout = 1
+        try:
+            self._ft_command(b'R', src)
+            data = self._ft_recv()
+            self._ft_status()
+        finally:
+            self.serial.timeout = timeout
+        with open(dest, 'wb') as f:
+            f.write(data)
+
     def get_time(self):
         t = str(self.eval('pyb.RTC().datetime()'), encoding='utf8')[1:-1].split(', ')
         return int(t[4]) * 3600 + int(t[5]) * 60 + int(t[6])
@@ -210,12 +327,33 @@ def main():
     cmd_parser.add_argument('--device', default='/dev/ttyACM0', help='the serial device of the pyboard')
     cmd_parser.add_argument('--follow', action='store_true', help='follow the output after running the scripts [default if no scripts given]')
     cmd_parser.add_argument('--test', action='store_true', help='run a small test suite on the pyboard')
-    cmd_parser.add_argument('files', nargs='*', help='input files')
+    cmd_parser.add_argument('files', nargs='*', help='input files, or put SRC [DEST] to copy a file to the pyboard, or get SRC [DEST] to copy one from it')
     args = cmd_parser.parse_args()
 
     if args.test:
         run_test(device=args.device)
 
+    if args.files and args.files[0] in ('put', 'get'):
+        if not 2 <= len(args.files) <= 3:
+            cmd_parser.error('{} needs a source and an optional destination'.format(args.files[0]))
+        src = args.files[1]
+        dest = args.files[2] if len(args.files) == 3 else src.rsplit('/', 1)[-1]
+        try:
+            pyb = Pyboard(args.device)
+            pyb.enter_raw_repl()
+            if args.files[0] == 'put':
+                pyb.fs_put(src, dest)
+            else:
+                pyb.fs_get(src, dest)
+            pyb.exit_raw_repl()
+            pyb.close()
+        except PyboardError as er:
+            print(er)
+            sys.exit(1)
+        except KeyboardInterrupt:
+            sys.exit(1)
+        return
+
     for filename in args.files:
         try:
             pyb = Pyboard(args.device)
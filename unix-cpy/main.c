@@ -49,15 +49,15 @@ void do_file(const char *file) {
 
     } else {
         // parse
-        mp_parse_node_t pn = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
 
-        if (pn != MP_PARSE_NODE_NULL) {
+        if (parse_tree.root != MP_PARSE_NODE_NULL) {
             //printf("----------------\n");
-            //mp_parse_node_print(pn, 0);
+            //mp_parse_node_print(parse_tree.root, 0);
             //printf("----------------\n");
 
             // compile
-            mp_compile(pn, 0, MP_EMIT_OPT_NONE, false);
+            mp_compile(&parse_tree, 0, MP_EMIT_OPT_NONE, false);
 
             //printf("----------------\n");
         }
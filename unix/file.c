@@ -33,6 +33,7 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
 #include "py/stream.h"
 #include "py/builtin.h"
 
@@ -66,10 +67,20 @@ STATIC void fdfile_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kin
     mp_printf(print, "<io.%s %d>", mp_obj_get_type_str(self), self->fd);
 }
 
+// Writes to stdout go through the C library's stdout stream, so they are
+// buffered (by line on a terminal, fully when going to a pipe or file), and
+// stay in order with the output of MP_PLAT_PRINT_STRN and printf.  The
+// buffer is flushed on exit, and before reading stdin or writing stderr.
+
 STATIC mp_uint_t fdfile_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errcode) {
     mp_obj_fdfile_t *o = o_in;
     check_fd_is_open(o);
+    if (o->fd == STDIN_FILENO) {
+        fflush(stdout);
+    }
+    MP_THREAD_GIL_EXIT();
     mp_int_t r = read(o->fd, buf, size);
+    MP_THREAD_GIL_ENTER();
     if (r == -1) {
         *errcode = errno;
         return MP_STREAM_ERROR;
@@ -80,7 +91,22 @@ STATIC mp_uint_t fdfile_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errc
 STATIC mp_uint_t fdfile_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
     mp_obj_fdfile_t *o = o_in;
     check_fd_is_open(o);
+    if (o->fd == STDOUT_FILENO) {
+        MP_THREAD_GIL_EXIT();
+        size_t r = fwrite(buf, 1, size, stdout);
+        MP_THREAD_GIL_ENTER();
+        if (r < size && ferror(stdout)) {
+            clearerr(stdout);
+            *errcode = errno;
+            return MP_STREAM_ERROR;
+        }
+        return r;
+    } else if (o->fd == STDERR_FILENO) {
+        fflush(stdout);
+    }
+    MP_THREAD_GIL_EXIT();
     mp_int_t r = write(o->fd, buf, size);
+    MP_THREAD_GIL_ENTER();
     if (r == -1) {
         *errcode = errno;
         return MP_STREAM_ERROR;
@@ -108,6 +134,9 @@ STATIC mp_uint_t fdfile_ioctl(mp_obj_t o_in, mp_uint_t request, mp_uint_t arg, i
 STATIC mp_obj_t fdfile_flush(mp_obj_t self_in) {
     mp_obj_fdfile_t *self = self_in;
     check_fd_is_open(self);
+    if (self->fd == STDOUT_FILENO) {
+        fflush(stdout);
+    }
     fsync(self->fd);
     return mp_const_none;
 }
@@ -193,6 +222,12 @@ STATIC mp_obj_t fdfile_open(mp_obj_t type_in, mp_arg_val_t *args) {
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
     }
     o->fd = fd;
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    if (mode & O_CREAT) {
+        // the file may be new, so it may be a module import hasn't seen
+        mp_import_cache_clear();
+    }
+    #endif
     return o;
 }
 
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/mpstate.h"
 #include "py/gc.h"
@@ -122,6 +123,20 @@ STATIC void gc_helper_get_regs(regs_t arr) {
 #endif
 #endif // !MICROPY_GCREGS_SETJMP
 
+#if MICROPY_PY_THREAD
+typedef char regs_fit_check[sizeof(regs_t) <= MP_THREAD_GC_REGS_WORDS * sizeof(mp_uint_t) ? 1 : -1];
+
+// Save the callee-save registers of a thread that is releasing the GIL, so
+// that other threads can scan them while it runs without it.  Returns the
+// stack pointer, from where its stack must be scanned.
+mp_uint_t gc_helper_save_regs(mp_uint_t *regs_out) {
+    regs_t regs;
+    gc_helper_get_regs(regs);
+    memcpy(regs_out, &regs, sizeof(regs));
+    return (mp_uint_t)&regs;
+}
+#endif
+
 void gc_collect(void) {
     //gc_dump_info();
 
@@ -130,7 +145,10 @@ void gc_collect(void) {
     gc_helper_get_regs(regs);
     // GC stack (and regs because we captured them)
     void **regs_ptr = (void**)(void*)&regs;
-    gc_collect_root(regs_ptr, ((mp_uint_t)MP_STATE_VM(stack_top) - (mp_uint_t)&regs) / sizeof(mp_uint_t));
+    gc_collect_root(regs_ptr, ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&regs) / sizeof(mp_uint_t));
+    #if MICROPY_PY_THREAD
+    mp_thread_gc_others();
+    #endif
     #if MICROPY_EMIT_NATIVE
     mp_unix_mark_exec();
     #endif
@@ -140,4 +158,98 @@ void gc_collect(void) {
     //gc_dump_info();
 }
 
+#if MICROPY_GC_PARALLEL
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+// Helper threads for parallel collections, started on first use.  Each run
+// bumps the generation to wake them and then waits until they're all done.
+STATIC pthread_mutex_t gc_workers_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t gc_workers_wake = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t gc_workers_done = PTHREAD_COND_INITIALIZER;
+STATIC int gc_workers_n = -1;
+STATIC int gc_workers_running;
+STATIC mp_uint_t gc_workers_gen;
+STATIC void (*gc_workers_fun)(void *arg);
+STATIC void *gc_workers_arg;
+
+STATIC void *gc_worker_thread(void *gen_in) {
+    mp_uint_t gen = (mp_uint_t)gen_in;
+    pthread_mutex_lock(&gc_workers_mutex);
+    for (;;) {
+        while (gc_workers_gen == gen) {
+            pthread_cond_wait(&gc_workers_wake, &gc_workers_mutex);
+        }
+        gen = gc_workers_gen;
+        void (*fun)(void *arg) = gc_workers_fun;
+        void *arg = gc_workers_arg;
+        pthread_mutex_unlock(&gc_workers_mutex);
+        fun(arg);
+        pthread_mutex_lock(&gc_workers_mutex);
+        if (--gc_workers_running == 0) {
+            pthread_cond_signal(&gc_workers_done);
+        }
+    }
+    return NULL;
+}
+
+// start the helpers if that hasn't been done yet; call with the mutex held
+STATIC void gc_workers_init(void) {
+    if (gc_workers_n < 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n > MICROPY_GC_PARALLEL_WORKERS) {
+            n = MICROPY_GC_PARALLEL_WORKERS;
+        }
+        // signals are left to the interpreter threads
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        gc_workers_n = 0;
+        for (; n > 1; n--) {
+            pthread_t id;
+            if (pthread_create(&id, NULL, gc_worker_thread, (void*)gc_workers_gen) != 0) {
+                break;
+            }
+            pthread_detach(id);
+            gc_workers_n += 1;
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+    }
+}
+
+mp_uint_t gc_num_workers(void) {
+    pthread_mutex_lock(&gc_workers_mutex);
+    gc_workers_init();
+    mp_uint_t n = gc_workers_n + 1;
+    pthread_mutex_unlock(&gc_workers_mutex);
+    return n;
+}
+
+void gc_run_workers(void (*fun)(void *arg), void *arg) {
+    pthread_mutex_lock(&gc_workers_mutex);
+    gc_workers_init();
+    if (gc_workers_n == 0 || gc_workers_running > 0) {
+        // no helpers, or they're busy with another interpreter's collection
+        pthread_mutex_unlock(&gc_workers_mutex);
+        fun(arg);
+        return;
+    }
+    gc_workers_fun = fun;
+    gc_workers_arg = arg;
+    gc_workers_running = gc_workers_n;
+    gc_workers_gen += 1;
+    pthread_cond_broadcast(&gc_workers_wake);
+    pthread_mutex_unlock(&gc_workers_mutex);
+
+    fun(arg);
+
+    pthread_mutex_lock(&gc_workers_mutex);
+    while (gc_workers_running > 0) {
+        pthread_cond_wait(&gc_workers_done, &gc_workers_mutex);
+    }
+    pthread_mutex_unlock(&gc_workers_mutex);
+}
+#endif
+
 #endif //MICROPY_ENABLE_GC
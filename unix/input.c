@@ -30,6 +30,7 @@
 
 #include "py/nlr.h"
 #include "py/obj.h"
+#include "py/mpthread.h"
 #include "input.h"
 
 #if MICROPY_USE_READLINE
@@ -43,14 +44,19 @@
 
 char *prompt(char *p) {
 #if MICROPY_USE_READLINE
+    MP_THREAD_GIL_EXIT();
     char *line = readline(p);
+    MP_THREAD_GIL_ENTER();
     if (line) {
         add_history(line);
     }
 #else
     static char buf[256];
     fputs(p, stdout);
+    fflush(stdout);
+    MP_THREAD_GIL_EXIT();
     char *s = fgets(buf, sizeof(buf), stdin);
+    MP_THREAD_GIL_ENTER();
     if (!s) {
         return NULL;
     }
@@ -43,6 +43,7 @@
 #include "py/repl.h"
 #include "py/gc.h"
 #include "py/stackctrl.h"
+#include "py/bc.h"
 #include "genhdr/mpversion.h"
 #include "input.h"
 
@@ -57,6 +58,118 @@ mp_uint_t mp_verbose_flag = 0;
 long heap_size = 128*1024 * (sizeof(mp_uint_t) / 4);
 #endif
 
+#if MICROPY_GC_AUTO_GROW
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The heap can grow to heap_max bytes.  That much address space is reserved
+// at startup, and the part after the first heap_size bytes is made usable a
+// region at a time when the GC runs out of memory.  Unless it is given, it
+// is at least twice heap_size.
+long heap_max = 32*1024*1024 * (sizeof(mp_uint_t) / 4);
+STATIC bool heap_max_given = false;
+STATIC char *heap_reserved_end;
+STATIC char *heap_grow_next;
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+// large objects are mapped separately, but count towards heap_max
+STATIC mp_uint_t heap_large_bytes;
+#else
+#define heap_large_bytes (0)
+#endif
+
+bool gc_grow_heap(mp_uint_t n_bytes) {
+    // double the heap each time, or add enough for the allocation (plus the
+    // region's tables) if that is more
+    mp_uint_t page = sysconf(_SC_PAGESIZE);
+    mp_uint_t len = heap_grow_next - (char*)MP_STATE_MEM(area).gc_alloc_table_start;
+    if (len < n_bytes + n_bytes / 4 + page) {
+        len = n_bytes + n_bytes / 4 + page;
+    }
+    len = (len + page - 1) & ~(page - 1);
+    if (len > (mp_uint_t)(heap_reserved_end - heap_grow_next - heap_large_bytes)) {
+        len = heap_reserved_end - heap_grow_next - heap_large_bytes;
+        if (len < n_bytes + n_bytes / 4 + page) {
+            return false;
+        }
+    }
+    if (mprotect(heap_grow_next, len, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+    gc_add_region(heap_grow_next, heap_grow_next + len);
+    heap_grow_next += len;
+    return true;
+}
+
+void gc_decommit(void *start, void *end) {
+    mp_uint_t page = sysconf(_SC_PAGESIZE);
+    start = (void*)(((mp_uint_t)start + page - 1) & ~(page - 1));
+    end = (void*)((mp_uint_t)end & ~(page - 1));
+    if (start < end) {
+        // the pages read as zero when next touched
+        madvise(start, (char*)end - (char*)start, MADV_DONTNEED);
+    }
+}
+
+STATIC char *heap_reserve(void) {
+    if (!heap_max_given && heap_max < 2 * heap_size) {
+        heap_max = 2 * heap_size;
+    }
+    if (heap_max < heap_size) {
+        heap_max = heap_size;
+    }
+    char *heap = mmap(NULL, heap_max, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (heap == MAP_FAILED || mprotect(heap, heap_size, PROT_READ | PROT_WRITE) != 0) {
+        fprintf(stderr, "could not reserve %ld bytes for the heap\n", heap_max);
+        exit(1);
+    }
+    heap_reserved_end = heap + heap_max;
+    heap_grow_next = heap + heap_size;
+    return heap;
+}
+#endif
+
+#if MICROPY_GC_LARGE_ALLOC_THRESHOLD
+#include <sys/mman.h>
+#include <unistd.h>
+
+// each large object gets its own mapping, which is unmapped when it's freed
+void *gc_large_alloc_pages(mp_uint_t n_bytes) {
+    mp_uint_t page = sysconf(_SC_PAGESIZE);
+    n_bytes = (n_bytes + page - 1) & ~(page - 1);
+    #if MICROPY_GC_AUTO_GROW
+    if (n_bytes > (mp_uint_t)(heap_reserved_end - heap_grow_next - heap_large_bytes)) {
+        return NULL;
+    }
+    #endif
+    void *ptr = mmap(NULL, n_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+    #if MICROPY_GC_AUTO_GROW
+    heap_large_bytes += n_bytes;
+    #endif
+    return ptr;
+}
+
+void gc_large_free_pages(void *ptr, mp_uint_t n_bytes) {
+    mp_uint_t page = sysconf(_SC_PAGESIZE);
+    n_bytes = (n_bytes + page - 1) & ~(page - 1);
+    munmap(ptr, n_bytes);
+    #if MICROPY_GC_AUTO_GROW
+    heap_large_bytes -= n_bytes;
+    #endif
+}
+#endif
+
+#if MICROPY_EMIT_NATIVE_PERF_MAP
+#include <unistd.h>
+extern FILE *mp_unix_perf_map;
+#endif
+
+#if MICROPY_MODULE_LISTDIR_CACHE
+#include <dirent.h>
+#endif
+
 #ifndef _WIN32
 #include <signal.h>
 
@@ -122,15 +235,15 @@ STATIC int execute_from_lexer(mp_lexer_t *lex, mp_parse_input_kind_t input_kind,
         }
         #endif
 
-        mp_parse_node_t pn = mp_parse(lex, input_kind);
+        mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
 
         /*
         printf("----------------\n");
-        mp_parse_node_print(pn, 0);
+        mp_parse_node_print(parse_tree.root, 0);
         printf("----------------\n");
         */
 
-        mp_obj_t module_fun = mp_compile(pn, source_name, emit_opt, is_repl);
+        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, emit_opt, is_repl);
 
         if (!compile_only) {
             // execute it
@@ -223,12 +336,24 @@ STATIC int usage(char **argv) {
 "  emit={bytecode,native,viper} -- set the default code emitter\n"
 );
     impl_opts_cnt++;
+#if MICROPY_EMIT_NATIVE_PERF_MAP
+    printf(
+"  perfmap -- write the symbols of native code to /tmp/perf-<pid>.map\n"
+);
+    impl_opts_cnt++;
+#endif
 #if MICROPY_ENABLE_GC
     printf(
 "  heapsize=<n> -- set the heap size for the GC (default %ld)\n"
 , heap_size);
     impl_opts_cnt++;
 #endif
+#if MICROPY_GC_AUTO_GROW
+    printf(
+"  heapmax=<n> -- set the size the GC heap may grow to (default %ld)\n"
+, heap_max);
+    impl_opts_cnt++;
+#endif
 
     if (impl_opts_cnt == 0) {
         printf("  (none)\n");
@@ -237,6 +362,33 @@ STATIC int usage(char **argv) {
     return 1;
 }
 
+#if MICROPY_ENABLE_GC
+STATIC long parse_heap_size(const char *arg) {
+    char *end;
+    long size = strtol(arg, &end, 0);
+    // Don't bring unneeded libc dependencies like tolower()
+    // If there's 'w' immediately after number, adjust it for
+    // target word size. Note that it should be *before* size
+    // suffix like K or M, to avoid confusion with kilowords,
+    // etc. the size is still in bytes, just can be adjusted
+    // for word size (taking 32bit as baseline).
+    bool word_adjust = false;
+    if ((*end | 0x20) == 'w') {
+        word_adjust = true;
+        end++;
+    }
+    if ((*end | 0x20) == 'k') {
+        size *= 1024;
+    } else if ((*end | 0x20) == 'm') {
+        size *= 1024 * 1024;
+    }
+    if (word_adjust) {
+        size = size * BYTES_PER_WORD / 4;
+    }
+    return size;
+}
+#endif
+
 // Process options which set interpreter init options
 STATIC void pre_process_options(int argc, char **argv) {
     for (int a = 1; a < argc; a++) {
@@ -254,29 +406,20 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_NATIVE_PYTHON;
                 } else if (strcmp(argv[a + 1], "emit=viper") == 0) {
                     emit_opt = MP_EMIT_OPT_VIPER;
+#if MICROPY_EMIT_NATIVE_PERF_MAP
+                } else if (strcmp(argv[a + 1], "perfmap") == 0) {
+                    char path[32];
+                    snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+                    mp_unix_perf_map = fopen(path, "w");
+#endif
 #if MICROPY_ENABLE_GC
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
-                    char *end;
-                    heap_size = strtol(argv[a + 1] + sizeof("heapsize=") - 1, &end, 0);
-                    // Don't bring unneeded libc dependencies like tolower()
-                    // If there's 'w' immediately after number, adjust it for
-                    // target word size. Note that it should be *before* size
-                    // suffix like K or M, to avoid confusion with kilowords,
-                    // etc. the size is still in bytes, just can be adjusted
-                    // for word size (taking 32bit as baseline).
-                    bool word_adjust = false;
-                    if ((*end | 0x20) == 'w') {
-                        word_adjust = true;
-                        end++;
-                    }
-                    if ((*end | 0x20) == 'k') {
-                        heap_size *= 1024;
-                    } else if ((*end | 0x20) == 'm') {
-                        heap_size *= 1024 * 1024;
-                    }
-                    if (word_adjust) {
-                        heap_size = heap_size * BYTES_PER_WORD / 4;
-                    }
+                    heap_size = parse_heap_size(argv[a + 1] + sizeof("heapsize=") - 1);
+#endif
+#if MICROPY_GC_AUTO_GROW
+                } else if (strncmp(argv[a + 1], "heapmax=", sizeof("heapmax=") - 1) == 0) {
+                    heap_max = parse_heap_size(argv[a + 1] + sizeof("heapmax=") - 1);
+                    heap_max_given = true;
 #endif
                 } else {
                     exit(usage(argv));
@@ -299,7 +442,20 @@ STATIC void set_sys_argv(char *argv[], int argc, int start_arg) {
 #define PATHLIST_SEP_CHAR ':'
 #endif
 
+#if MICROPY_MULTIPLE_INTERPRETERS
+// this program runs a single interpreter, on the main thread
+STATIC mp_state_ctx_t main_ctx;
+#endif
+
 int main(int argc, char **argv) {
+    #if MICROPY_MULTIPLE_INTERPRETERS
+    mp_state_ctx_ptr = &main_ctx;
+    #endif
+
+    #if MICROPY_PY_THREAD
+    mp_thread_init();
+    #endif
+
     prompt_read_history();
 
     mp_stack_set_limit(40000 * (BYTES_PER_WORD / 4));
@@ -307,7 +463,11 @@ int main(int argc, char **argv) {
     pre_process_options(argc, argv);
 
 #if MICROPY_ENABLE_GC
+    #if MICROPY_GC_AUTO_GROW
+    char *heap = heap_reserve();
+    #else
     char *heap = malloc(heap_size);
+    #endif
     gc_init(heap, heap + heap_size);
 #endif
 
@@ -476,12 +636,30 @@ int main(int argc, char **argv) {
     }
     #endif
 
+    #if MICROPY_VM_OPCODE_STATS
+    mp_bytecode_print_opcode_stats(&mp_plat_print, 20);
+    #endif
+
     mp_deinit();
 
+    #if MICROPY_PY_THREAD
+    // other threads are left waiting for the GIL, which is never released
+    bool threads_alive = mp_thread_deinit();
+    #else
+    const bool threads_alive = false;
+    #endif
+    (void)threads_alive;
+
 #if MICROPY_ENABLE_GC && !defined(NDEBUG)
     // We don't really need to free memory since we are about to exit the
     // process, but doing so helps to find memory leaks.
-    free(heap);
+    if (!threads_alive) {
+        #if MICROPY_GC_AUTO_GROW
+        munmap(heap, heap_max);
+        #else
+        free(heap);
+        #endif
+    }
 #endif
 
     //printf("total bytes = %d\n", m_get_total_bytes_allocated());
@@ -501,6 +679,44 @@ uint mp_import_stat(const char *path) {
     return MP_IMPORT_STAT_NO_EXIST;
 }
 
+#if MICROPY_MODULE_LISTDIR_CACHE
+bool mp_import_listdir(const char *path, void *env) {
+    DIR *dir = opendir(path[0] == '\0' ? "." : path);
+    if (dir == NULL) {
+        return errno == ENOENT || errno == ENOTDIR;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        mp_import_stat_t stat;
+        #ifdef _DIRENT_HAVE_D_TYPE
+        if (de->d_type == DT_DIR) {
+            stat = MP_IMPORT_STAT_DIR;
+        } else if (de->d_type == DT_REG) {
+            stat = MP_IMPORT_STAT_FILE;
+        } else if (de->d_type != DT_LNK && de->d_type != DT_UNKNOWN) {
+            continue;
+        } else
+        #endif
+        {
+            // the type isn't known without following the entry
+            char buf[MICROPY_ALLOC_PATH_MAX];
+            snprintf(buf, sizeof(buf), "%s/%s", path[0] == '\0' ? "." : path, de->d_name);
+            stat = mp_import_stat(buf);
+            if (stat == MP_IMPORT_STAT_NO_EXIST) {
+                continue;
+            }
+        }
+        if (stat == MP_IMPORT_STAT_DIR && de->d_name[0] == '.'
+            && (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0'))) {
+            continue;
+        }
+        mp_import_listdir_add(env, de->d_name, stat);
+    }
+    closedir(dir);
+    return true;
+}
+#endif
+
 int DEBUG_printf(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
@@ -53,6 +53,14 @@
  *
  * Note: all constraint specified by typecode can be not enforced at this time,
  * but may be later.
+ *
+ * The argument types of a function are checked and copied when it is made,
+ * and each call converts its arguments by switching on them.  Objects with
+ * the buffer protocol (bytes, bytearray, array, memoryview) are passed as a
+ * pointer to their data, without a copy.  ffifunc.map(args) calls a function
+ * for each item of args (a tuple of the arguments, or the argument itself if
+ * there is one) and returns a list of the results, or None for a "v" return
+ * type.
  */
 
 typedef struct _mp_obj_opaque_t {
@@ -76,11 +84,18 @@ typedef struct _mp_obj_ffifunc_t {
     mp_obj_base_t base;
     void *func;
     char rettype;
-    const char *argtypes;
+    char *argtypes; // a copy, one char per argument
     ffi_cif cif;
     ffi_type *params[];
 } mp_obj_ffifunc_t;
 
+// storage for an argument, big enough for a double even if ffi_arg is not
+typedef union _ffi_val_t {
+    ffi_arg arg;
+    float flt;
+    double dbl;
+} ffi_val_t;
+
 typedef struct _mp_obj_fficallback_t {
     mp_obj_base_t base;
     void *func;
@@ -190,7 +205,8 @@ STATIC mp_obj_t make_func(mp_obj_t rettype_in, void *func, mp_obj_t argtypes_in)
 
     o->func = func;
     o->rettype = *rettype;
-    o->argtypes = argtypes;
+    o->argtypes = m_new(char, nparams);
+    memcpy(o->argtypes, argtypes, nparams);
 
     mp_obj_t iterable = mp_getiter(argtypes_in);
     mp_obj_t item;
@@ -344,50 +360,54 @@ STATIC void ffifunc_print(const mp_print_t *print, mp_obj_t self_in, mp_print_ki
     mp_printf(print, "<ffifunc %p>", self->func);
 }
 
-STATIC mp_obj_t ffifunc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
-    mp_obj_ffifunc_t *self = self_in;
-    assert(n_kw == 0);
-    assert(n_args == self->cif.nargs);
-
-    ffi_arg values[n_args];
-    void *valueptrs[n_args];
-    const char *argtype = self->argtypes;
-    for (uint i = 0; i < n_args; i++, argtype++) {
-        mp_obj_t a = args[i];
-        if (*argtype == 'O') {
-            values[i] = (ffi_arg)a;
+STATIC void ffifunc_set_arg(char type, mp_obj_t a, ffi_val_t *val) {
+    switch (type) {
+        case 'O':
+            val->arg = (ffi_arg)a;
+            return;
         #if MICROPY_PY_BUILTINS_FLOAT
-        } else if (*argtype == 'f') {
-            float *p = (float*)&values[i];
-            *p = mp_obj_get_float(a);
-        } else if (*argtype == 'd') {
-            double *p = (double*)&values[i];
-            *p = mp_obj_get_float(a);
+        case 'f':
+            val->flt = mp_obj_get_float(a);
+            return;
+        case 'd':
+            val->dbl = mp_obj_get_float(a);
+            return;
         #endif
-        } else if (a == mp_const_none) {
-            values[i] = 0;
-        } else if (MP_OBJ_IS_INT(a)) {
-            values[i] = mp_obj_int_get_truncated(a);
-        } else if (MP_OBJ_IS_STR(a)) {
-            const char *s = mp_obj_str_get_str(a);
-            values[i] = (ffi_arg)s;
-        } else if (((mp_obj_base_t*)a)->type->buffer_p.get_buffer != NULL) {
-            mp_obj_base_t *o = (mp_obj_base_t*)a;
-            mp_buffer_info_t bufinfo;
-            int ret = o->type->buffer_p.get_buffer(o, &bufinfo, MP_BUFFER_READ); // TODO: MP_BUFFER_READ?
-            if (ret != 0) {
-                goto error;
+        case 'b': case 'B': case 'h': case 'H': case 'i': case 'I': case 'l': case 'L':
+            if (MP_OBJ_IS_SMALL_INT(a)) {
+                val->arg = MP_OBJ_SMALL_INT_VALUE(a);
+                return;
             }
-            values[i] = (ffi_arg)bufinfo.buf;
-        } else if (MP_OBJ_IS_TYPE(a, &fficallback_type)) {
-            mp_obj_fficallback_t *p = a;
-            values[i] = (ffi_arg)p->func;
-        } else {
+            break;
+    }
+    if (a == mp_const_none) {
+        val->arg = 0;
+    } else if (MP_OBJ_IS_INT(a)) {
+        val->arg = mp_obj_int_get_truncated(a);
+    } else if (MP_OBJ_IS_STR(a)) {
+        const char *s = mp_obj_str_get_str(a);
+        val->arg = (ffi_arg)s;
+    } else if (mp_obj_get_type(a)->buffer_p.get_buffer != NULL) {
+        mp_buffer_info_t bufinfo;
+        int ret = mp_obj_get_type(a)->buffer_p.get_buffer(a, &bufinfo, MP_BUFFER_READ); // TODO: MP_BUFFER_READ?
+        if (ret != 0) {
             goto error;
         }
-        valueptrs[i] = &values[i];
+        val->arg = (ffi_arg)bufinfo.buf;
+    } else if (MP_OBJ_IS_TYPE(a, &fficallback_type)) {
+        mp_obj_fficallback_t *p = a;
+        val->arg = (ffi_arg)p->func;
+    } else {
+        goto error;
     }
+    return;
 
+error:
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "Don't know how to pass object to native function"));
+}
+
+// calls the function with the arguments in values, which valueptrs point to
+STATIC mp_obj_t ffifunc_invoke(mp_obj_ffifunc_t *self, void **valueptrs) {
     // If ffi_arg is not big enough to hold a double, then we must pass along a
     // pointer to a memory location of the correct size.
     // TODO check if this needs to be done for other types which don't fit into
@@ -404,16 +424,74 @@ STATIC mp_obj_t ffifunc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw,
         ffi_call(&self->cif, self->func, &retval, valueptrs);
         return return_ffi_value(retval, self->rettype);
     }
+}
 
-error:
-    nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "Don't know how to pass object to native function"));
+STATIC mp_obj_t ffifunc_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_obj_ffifunc_t *self = self_in;
+    assert(n_kw == 0);
+    mp_arg_check_num(n_args, n_kw, self->cif.nargs, self->cif.nargs, false);
+
+    ffi_val_t values[n_args];
+    void *valueptrs[n_args];
+    for (uint i = 0; i < n_args; i++) {
+        ffifunc_set_arg(self->argtypes[i], args[i], &values[i]);
+        valueptrs[i] = &values[i];
+    }
+    return ffifunc_invoke(self, valueptrs);
+}
+
+STATIC mp_obj_t ffifunc_map(mp_obj_t self_in, mp_obj_t args_in) {
+    mp_obj_ffifunc_t *self = self_in;
+    mp_uint_t n_args = self->cif.nargs;
+    ffi_val_t values[n_args];
+    void *valueptrs[n_args];
+    for (uint i = 0; i < n_args; i++) {
+        valueptrs[i] = &values[i];
+    }
+
+    mp_obj_t list = mp_const_none;
+    if (self->rettype != 'v') {
+        list = mp_obj_new_list(0, NULL);
+    }
+    mp_obj_t iter = mp_getiter(args_in);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        if (n_args == 1 && !MP_OBJ_IS_TYPE(item, &mp_type_tuple)) {
+            len = 1;
+            items = &item;
+        } else {
+            mp_obj_get_array(item, &len, &items);
+            if (len != n_args) {
+                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+                    "function takes %d positional arguments but %d were given", n_args, len));
+            }
+        }
+        for (uint i = 0; i < n_args; i++) {
+            ffifunc_set_arg(self->argtypes[i], items[i], &values[i]);
+        }
+        mp_obj_t ret = ffifunc_invoke(self, valueptrs);
+        if (list != mp_const_none) {
+            mp_obj_list_append(list, ret);
+        }
+    }
+    return list;
 }
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ffifunc_map_obj, ffifunc_map);
+
+STATIC const mp_map_elem_t ffifunc_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_map), (mp_obj_t)&ffifunc_map_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(ffifunc_locals_dict, ffifunc_locals_dict_table);
 
 STATIC const mp_obj_type_t ffifunc_type = {
     { &mp_type_type },
     .name = MP_QSTR_ffifunc,
     .print = ffifunc_print,
     .call = ffifunc_call,
+    .locals_dict = (mp_obj_t)&ffifunc_locals_dict,
 };
 
 // FFI callback for Python function
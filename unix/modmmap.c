@@ -0,0 +1,280 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "py/nlr.h"
+#include "py/obj.h"
+#include "py/runtime0.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_MMAP
+
+#define RAISE_ERRNO(err_flag, error_val) \
+    { if (err_flag == -1) \
+        { nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error_val))); } }
+
+/// \module mmap - Memory-mapped files
+///
+/// An mmap object maps (part of) a file into memory and gives access to it
+/// through the buffer protocol, so memoryview, ustruct.unpack_from,
+/// uctypes.struct and ure can work on file data without it being read into
+/// the heap.  Pages are only read in from the file when touched.
+///
+/// Memoryviews and uctypes structs of an mmap don't keep it alive, so the
+/// mapping isn't removed when the mmap object is collected; it stays until
+/// close() is called (or the mmap is used in a with statement).
+
+#define ACCESS_DEFAULT (0)
+#define ACCESS_READ (1)
+#define ACCESS_WRITE (2)
+#define ACCESS_COPY (3)
+
+typedef struct _mp_obj_mmap_t {
+    mp_obj_base_t base;
+    byte *addr; // NULL once closed
+    mp_uint_t len;
+    bool writable;
+} mp_obj_mmap_t;
+
+STATIC mp_obj_mmap_t *mmap_get_open(mp_obj_t self_in) {
+    mp_obj_mmap_t *self = self_in;
+    if (self->addr == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "mmap closed"));
+    }
+    return self;
+}
+
+STATIC void mmap_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_mmap_t *self = self_in;
+    mp_printf(print, "<mmap len=%u>", self->len);
+}
+
+/// \classmethod \constructor(fileno, length, flags=MAP_SHARED, prot=PROT_READ|PROT_WRITE, access=ACCESS_DEFAULT, offset=0)
+/// Map length bytes of the file, starting at offset (a multiple of
+/// the page size).  A length of 0 maps the rest of the file.  fileno can also be
+/// an object with a fileno() method.  access, if given, sets the flags and
+/// prot as for CPython's mmap.
+STATIC mp_obj_t mmap_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    enum { ARG_fileno, ARG_length, ARG_flags, ARG_prot, ARG_access, ARG_offset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_fileno, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_length, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_flags, MP_ARG_INT, {.u_int = MAP_SHARED} },
+        { MP_QSTR_prot, MP_ARG_INT, {.u_int = PROT_READ | PROT_WRITE} },
+        { MP_QSTR_access, MP_ARG_INT, {.u_int = ACCESS_DEFAULT} },
+        { MP_QSTR_offset, MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t vals[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args, MP_ARRAY_SIZE(allowed_args), allowed_args, vals);
+
+    int fd;
+    if (MP_OBJ_IS_SMALL_INT(vals[ARG_fileno].u_obj)) {
+        fd = MP_OBJ_SMALL_INT_VALUE(vals[ARG_fileno].u_obj);
+    } else {
+        mp_obj_t dest[2];
+        mp_load_method(vals[ARG_fileno].u_obj, MP_QSTR_fileno, dest);
+        fd = mp_obj_get_int(mp_call_method_n_kw(0, 0, dest));
+    }
+
+    int flags = vals[ARG_flags].u_int;
+    int prot = vals[ARG_prot].u_int;
+    switch (vals[ARG_access].u_int) {
+        case ACCESS_DEFAULT: break;
+        case ACCESS_READ: flags = MAP_SHARED; prot = PROT_READ; break;
+        case ACCESS_WRITE: flags = MAP_SHARED; prot = PROT_READ | PROT_WRITE; break;
+        case ACCESS_COPY: flags = MAP_PRIVATE; prot = PROT_READ | PROT_WRITE; break;
+        default:
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad access"));
+    }
+
+    mp_int_t offset = vals[ARG_offset].u_int;
+    mp_int_t len = vals[ARG_length].u_int;
+    if (len < 0 || offset < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative length or offset"));
+    }
+    if (len == 0) {
+        struct stat st;
+        int r = fstat(fd, &st);
+        RAISE_ERRNO(r, errno);
+        if (st.st_size <= offset) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "cannot mmap an empty file"));
+        }
+        len = st.st_size - offset;
+    }
+
+    void *addr = mmap(NULL, len, prot, flags, fd, offset);
+    if (addr == MAP_FAILED) {
+        RAISE_ERRNO(-1, errno);
+    }
+
+    mp_obj_mmap_t *self = m_new_obj(mp_obj_mmap_t);
+    self->base.type = type_in;
+    self->addr = addr;
+    self->len = len;
+    self->writable = (prot & PROT_WRITE) != 0;
+    return self;
+}
+
+/// \method close()
+/// Remove the mapping; the object can't be used afterwards.
+STATIC mp_obj_t mmap_close(mp_obj_t self_in) {
+    mp_obj_mmap_t *self = self_in;
+    if (self->addr != NULL) {
+        munmap(self->addr, self->len);
+        self->addr = NULL;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mmap_close_obj, mmap_close);
+
+STATIC mp_obj_t mmap___exit__(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mmap_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mmap___exit___obj, 4, 4, mmap___exit__);
+
+/// \method flush()
+/// Write changes made to a shared mapping back to the file.
+STATIC mp_obj_t mmap_flush(mp_obj_t self_in) {
+    mp_obj_mmap_t *self = mmap_get_open(self_in);
+    int r = msync(self->addr, self->len, MS_SYNC);
+    RAISE_ERRNO(r, errno);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mmap_flush_obj, mmap_flush);
+
+STATIC mp_obj_t mmap_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_mmap_t *self = mmap_get_open(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(self->len != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->len);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+// Indexing gives ints and slicing gives bytes, as for CPython's mmap
+STATIC mp_obj_t mmap_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_mmap_t *self = mmap_get_open(self_in);
+    if (value == MP_OBJ_NULL) {
+        // delete
+        return MP_OBJ_NULL; // op not supported
+    }
+    if (value != MP_OBJ_SENTINEL && !self->writable) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "mmap is read-only"));
+    }
+    #if MICROPY_PY_BUILTINS_SLICE
+    if (MP_OBJ_IS_TYPE(index, &mp_type_slice)) {
+        mp_bound_slice_t slice;
+        if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_NotImplementedError,
+                "only slices with step=1 (aka None) are supported"));
+        }
+        mp_uint_t n = slice.stop - slice.start;
+        if (value == MP_OBJ_SENTINEL) {
+            // load
+            return mp_obj_new_bytes(self->addr + slice.start, n);
+        }
+        // store
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len != n) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "mmap slice assignment is wrong size"));
+        }
+        memmove(self->addr + slice.start, bufinfo.buf, n);
+        return mp_const_none;
+    }
+    #endif
+    mp_uint_t i = mp_get_index(self->base.type, self->len, index, false);
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return MP_OBJ_NEW_SMALL_INT(self->addr[i]);
+    }
+    // store
+    self->addr[i] = mp_obj_get_int(value);
+    return mp_const_none;
+}
+
+STATIC mp_int_t mmap_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_obj_mmap_t *self = mmap_get_open(self_in);
+    if ((flags & MP_BUFFER_WRITE) && !self->writable) {
+        return 1;
+    }
+    bufinfo->buf = self->addr;
+    bufinfo->len = self->len;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+STATIC const mp_map_elem_t mmap_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&mmap_close_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_flush), (mp_obj_t)&mmap_flush_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___enter__), (mp_obj_t)&mp_identity_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___exit__), (mp_obj_t)&mmap___exit___obj },
+};
+STATIC MP_DEFINE_CONST_DICT(mmap_locals_dict, mmap_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_mmap = {
+    { &mp_type_type },
+    .name = MP_QSTR_mmap,
+    .print = mmap_print,
+    .make_new = mmap_make_new,
+    .unary_op = mmap_unary_op,
+    .subscr = mmap_subscr,
+    .buffer_p = { .get_buffer = mmap_get_buffer },
+    .locals_dict = (mp_obj_t)&mmap_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_mmap_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_mmap) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mmap), (mp_obj_t)&mp_type_mmap },
+#define C(name) { MP_OBJ_NEW_QSTR(MP_QSTR_ ## name), MP_OBJ_NEW_SMALL_INT(name) }
+    C(MAP_SHARED),
+    C(MAP_PRIVATE),
+    C(PROT_READ),
+    C(PROT_WRITE),
+    C(ACCESS_DEFAULT),
+    C(ACCESS_READ),
+    C(ACCESS_WRITE),
+    C(ACCESS_COPY),
+#undef C
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_mmap_globals, mp_module_mmap_globals_table);
+
+const mp_obj_module_t mp_module_mmap = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_mmap,
+    .globals = (mp_obj_dict_t*)&mp_module_mmap_globals,
+};
+
+#endif // MICROPY_PY_MMAP
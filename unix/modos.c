@@ -25,6 +25,7 @@
  * THE SOFTWARE.
  */
 
+#include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -34,6 +35,7 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
 #include "py/objtuple.h"
+#include "py/builtin.h"
 
 #define RAISE_ERRNO(err_flag, error_val) \
     { if (err_flag == -1) \
@@ -70,6 +72,10 @@ STATIC mp_obj_t mod_os_unlink(mp_obj_t path_in) {
 
     RAISE_ERRNO(r, errno);
 
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    mp_import_cache_clear();
+    #endif
+
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_unlink_obj, mod_os_unlink);
@@ -77,8 +83,15 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_unlink_obj, mod_os_unlink);
 STATIC mp_obj_t mod_os_system(mp_obj_t cmd_in) {
     const char *cmd = mp_obj_str_get_str(cmd_in);
 
+    // the command's output must come after what was printed so far
+    fflush(stdout);
     int r = system(cmd);
 
+    #if MICROPY_MODULE_LISTDIR_CACHE
+    // the command may have changed any file
+    mp_import_cache_clear();
+    #endif
+
     RAISE_ERRNO(r, errno);
 
     return MP_OBJ_NEW_SMALL_INT(r);
@@ -25,6 +25,11 @@
  * THE SOFTWARE.
  */
 
+#ifdef __linux__
+// for splice()
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
@@ -33,15 +38,21 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "py/nlr.h"
 #include "py/objtuple.h"
 #include "py/objstr.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
 #include "py/stream.h"
 #include "py/builtin.h"
 
@@ -90,7 +101,9 @@ STATIC void socket_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kin
 
 STATIC mp_uint_t socket_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errcode) {
     mp_obj_socket_t *o = o_in;
+    MP_THREAD_GIL_EXIT();
     mp_int_t r = read(o->fd, buf, size);
+    MP_THREAD_GIL_ENTER();
     if (r == -1) {
         *errcode = errno;
         return MP_STREAM_ERROR;
@@ -100,7 +113,9 @@ STATIC mp_uint_t socket_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errc
 
 STATIC mp_uint_t socket_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
     mp_obj_socket_t *o = o_in;
+    MP_THREAD_GIL_EXIT();
     mp_int_t r = write(o->fd, buf, size);
+    MP_THREAD_GIL_ENTER();
     if (r == -1) {
         *errcode = errno;
         return MP_STREAM_ERROR;
@@ -125,7 +140,15 @@ STATIC mp_obj_t socket_connect(mp_obj_t self_in, mp_obj_t addr_in) {
     mp_obj_socket_t *self = self_in;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(addr_in, &bufinfo, MP_BUFFER_READ);
+    MP_THREAD_GIL_EXIT();
     int r = connect(self->fd, (const struct sockaddr *)bufinfo.buf, bufinfo.len);
+    MP_THREAD_GIL_ENTER();
+    // For a non-blocking socket the connection completes in the background:
+    // the socket becomes writable when it's done, and getsockopt(SOL_SOCKET,
+    // SO_ERROR) then gives the outcome.
+    if (r == -1 && errno == EINPROGRESS) {
+        return mp_const_none;
+    }
     RAISE_ERRNO(r, errno);
     return mp_const_none;
 }
@@ -149,20 +172,37 @@ STATIC mp_obj_t socket_listen(mp_obj_t self_in, mp_obj_t backlog_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_listen_obj, socket_listen);
 
-STATIC mp_obj_t socket_accept(mp_obj_t self_in) {
-    mp_obj_socket_t *self = self_in;
-    struct sockaddr addr;
+// accept([addr_buf])
+// Returns (socket, address).  If the writable buffer addr_buf is given, the
+// address is written into it instead (truncated to its length) and only the
+// new socket is returned, so accepting doesn't allocate for the address.
+// On a non-blocking socket with no pending connection, returns None.
+STATIC mp_obj_t socket_accept(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_socket_t *self = args[0];
+    struct sockaddr_storage addr;
     socklen_t addr_len = sizeof(addr);
-    int fd = accept(self->fd, &addr, &addr_len);
+    MP_THREAD_GIL_EXIT();
+    int fd = accept(self->fd, (struct sockaddr*)&addr, &addr_len);
+    MP_THREAD_GIL_ENTER();
+    if (fd == -1 && mp_is_nonblocking_error(errno)) {
+        return mp_const_none;
+    }
     RAISE_ERRNO(fd, errno);
 
+    if (n_args > 1) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+        memcpy(bufinfo.buf, &addr, MIN(bufinfo.len, addr_len));
+        return socket_new(fd);
+    }
+
     mp_obj_tuple_t *t = mp_obj_new_tuple(2, NULL);
     t->items[0] = socket_new(fd);
     t->items[1] = mp_obj_new_bytearray(addr_len, &addr);
 
     return t;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(socket_accept_obj, socket_accept);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_accept_obj, 1, 2, socket_accept);
 
 // Note: besides flag param, this differs from read() in that
 // this does not swallow blocking errors (EAGAIN, EWOULDBLOCK) -
@@ -176,15 +216,111 @@ STATIC mp_obj_t socket_recv(mp_uint_t n_args, const mp_obj_t *args) {
         flags = MP_OBJ_SMALL_INT_VALUE(args[2]);
     }
 
-    byte *buf = m_new(byte, sz);
-    int out_sz = recv(self->fd, buf, sz, flags);
+    // receive straight into the bytes object's storage rather than copying
+    vstr_t vstr;
+    vstr_init_len(&vstr, sz);
+    MP_THREAD_GIL_EXIT();
+    int out_sz = recv(self->fd, vstr.buf, sz, flags);
+    MP_THREAD_GIL_ENTER();
+    if (out_sz == -1) {
+        int err = errno;
+        vstr_clear(&vstr);
+        RAISE_ERRNO(out_sz, err);
+    }
+    vstr.len = out_sz;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_obj, 2, 3, socket_recv);
+
+// Common part of recv_into() and recvfrom_into(): fills buf (or its first
+// nbytes bytes) from args[1], returning the number of bytes received.
+STATIC int socket_recv_into_helper(mp_uint_t n_args, const mp_obj_t *args, struct sockaddr *addr, socklen_t *addr_len) {
+    mp_obj_socket_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t sz = bufinfo.len;
+    if (n_args > 2 && args[2] != MP_OBJ_NEW_SMALL_INT(0)) {
+        mp_uint_t n = mp_obj_get_int(args[2]);
+        if (n > sz) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+        }
+        sz = n;
+    }
+    int flags = 0;
+    if (n_args > 3) {
+        flags = MP_OBJ_SMALL_INT_VALUE(args[3]);
+    }
+    MP_THREAD_GIL_EXIT();
+    int out_sz = recvfrom(self->fd, bufinfo.buf, sz, flags, addr, addr_len);
+    MP_THREAD_GIL_ENTER();
     RAISE_ERRNO(out_sz, errno);
+    return out_sz;
+}
 
-    mp_obj_t ret = mp_obj_new_str_of_type(&mp_type_bytes, buf, out_sz);
-    m_del(char, buf, sz);
-    return ret;
+// recv_into(buf[, nbytes[, flags]])
+// Like recv() but fills the given writable buffer instead of allocating a
+// bytes object; returns the number of bytes received.
+STATIC mp_obj_t socket_recv_into(mp_uint_t n_args, const mp_obj_t *args) {
+    return MP_OBJ_NEW_SMALL_INT(socket_recv_into_helper(n_args, args, NULL, NULL));
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_obj, 2, 3, socket_recv);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_into_obj, 2, 4, socket_recv_into);
+
+// recvfrom_into(buf[, nbytes[, flags]])
+// Returns (nbytes, address), the address being in the same form as accept()
+STATIC mp_obj_t socket_recvfrom_into(mp_uint_t n_args, const mp_obj_t *args) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int out_sz = socket_recv_into_helper(n_args, args, (struct sockaddr*)&addr, &addr_len);
+    mp_obj_t t[2] = {MP_OBJ_NEW_SMALL_INT(out_sz), mp_obj_new_bytearray(addr_len, &addr)};
+    return mp_obj_new_tuple(2, t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_obj, 2, 4, socket_recvfrom_into);
+
+#ifdef __linux__
+// recvmmsg(bufs[, lens[, flags]])
+// Receives up to len(bufs) datagrams with one system call, each one into the
+// corresponding writable buffer of the bufs list (or tuple).  The length of
+// each datagram is stored in lens (a list or array) if it's given.  Returns
+// the number of datagrams received; with flags=MSG_DONTWAIT this is however
+// many were queued, after blocking only for the first one otherwise.
+STATIC mp_obj_t socket_recvmmsg(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_socket_t *self = args[0];
+    mp_uint_t n_bufs;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n_bufs, &bufs);
+    mp_obj_t lens = n_args > 2 ? args[2] : mp_const_none;
+    int flags = 0;
+    if (n_args > 3) {
+        flags = MP_OBJ_SMALL_INT_VALUE(args[3]);
+    }
+
+    struct iovec *iov = alloca(n_bufs * sizeof(struct iovec));
+    struct mmsghdr *msgs = alloca(n_bufs * sizeof(struct mmsghdr));
+    memset(msgs, 0, n_bufs * sizeof(struct mmsghdr));
+    for (mp_uint_t i = 0; i < n_bufs; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_WRITE);
+        iov[i].iov_base = bufinfo.buf;
+        iov[i].iov_len = bufinfo.len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // without MSG_WAITFORONE a blocking socket waits for all n_bufs datagrams
+    MP_THREAD_GIL_EXIT();
+    int n = recvmmsg(self->fd, msgs, n_bufs, flags | MSG_WAITFORONE, NULL);
+    MP_THREAD_GIL_ENTER();
+    RAISE_ERRNO(n, errno);
+
+    if (lens != mp_const_none) {
+        for (int i = 0; i < n; i++) {
+            mp_obj_subscr(lens, MP_OBJ_NEW_SMALL_INT(i), MP_OBJ_NEW_SMALL_INT(msgs[i].msg_len));
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvmmsg_obj, 2, 4, socket_recvmmsg);
+#endif
 
 // Note: besides flag param, this differs from write() in that
 // this does not swallow blocking errors (EAGAIN, EWOULDBLOCK) -
@@ -199,13 +335,49 @@ STATIC mp_obj_t socket_send(mp_uint_t n_args, const mp_obj_t *args) {
 
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    MP_THREAD_GIL_EXIT();
     int out_sz = send(self->fd, bufinfo.buf, bufinfo.len, flags);
+    MP_THREAD_GIL_ENTER();
     RAISE_ERRNO(out_sz, errno);
 
     return MP_OBJ_NEW_SMALL_INT(out_sz);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_send_obj, 2, 3, socket_send);
 
+// sendv(bufs[, flags])
+// Sends all the buffers of the bufs list (or tuple) with one system call,
+// as a single datagram for datagram sockets.  Returns the number of bytes
+// sent; like send(), blocking errors are raised.
+STATIC mp_obj_t socket_sendv(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_socket_t *self = args[0];
+    mp_uint_t n_bufs;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n_bufs, &bufs);
+    int flags = 0;
+    if (n_args > 2) {
+        flags = MP_OBJ_SMALL_INT_VALUE(args[2]);
+    }
+
+    struct iovec *iov = alloca(n_bufs * sizeof(struct iovec));
+    for (mp_uint_t i = 0; i < n_bufs; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+        iov[i].iov_base = bufinfo.buf;
+        iov[i].iov_len = bufinfo.len;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n_bufs;
+
+    MP_THREAD_GIL_EXIT();
+    int out_sz = sendmsg(self->fd, &msg, flags);
+    MP_THREAD_GIL_ENTER();
+    RAISE_ERRNO(out_sz, errno);
+    return MP_OBJ_NEW_SMALL_INT(out_sz);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_sendv_obj, 2, 3, socket_sendv);
+
 STATIC mp_obj_t socket_setsockopt(mp_uint_t n_args, const mp_obj_t *args) {
     (void)n_args; // always 4
     mp_obj_socket_t *self = args[0];
@@ -230,6 +402,35 @@ STATIC mp_obj_t socket_setsockopt(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_setsockopt_obj, 4, 4, socket_setsockopt);
 
+// getsockopt(level, option[, buflen])
+// Returns the option as an int, or as bytes of up to buflen if it's given
+STATIC mp_obj_t socket_getsockopt(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_socket_t *self = args[0];
+    int level = MP_OBJ_SMALL_INT_VALUE(args[1]);
+    int option = mp_obj_get_int(args[2]);
+
+    if (n_args > 3) {
+        vstr_t vstr;
+        vstr_init_len(&vstr, mp_obj_get_int(args[3]));
+        socklen_t optlen = vstr.len;
+        int r = getsockopt(self->fd, level, option, vstr.buf, &optlen);
+        if (r == -1) {
+            int err = errno;
+            vstr_clear(&vstr);
+            RAISE_ERRNO(r, err);
+        }
+        vstr.len = optlen;
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+
+    int val = 0;
+    socklen_t optlen = sizeof(val);
+    int r = getsockopt(self->fd, level, option, &val, &optlen);
+    RAISE_ERRNO(r, errno);
+    return MP_OBJ_NEW_SMALL_INT(val);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_getsockopt_obj, 3, 4, socket_getsockopt);
+
 STATIC mp_obj_t socket_setblocking(mp_obj_t self_in, mp_obj_t flag_in) {
     mp_obj_socket_t *self = self_in;
     int val = mp_obj_is_true(flag_in);
@@ -260,6 +461,84 @@ STATIC mp_obj_t socket_makefile(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_makefile_obj, 1, 3, socket_makefile);
 
+// Accepts a small int fd or any object with a fileno() method
+STATIC int get_fd(mp_obj_t obj) {
+    if (MP_OBJ_IS_SMALL_INT(obj)) {
+        return MP_OBJ_SMALL_INT_VALUE(obj);
+    }
+    mp_obj_t dest[2];
+    mp_load_method(obj, MP_QSTR_fileno, dest);
+    return mp_obj_get_int(mp_call_method_n_kw(0, 0, dest));
+}
+
+// sendfile(file[, offset[, count]]) as a method, or
+// usocket.sendfile(sock, file[, offset[, count]]) as a function.
+// Sends the file to the socket without copying it through Python objects.
+// A count of 0 (or None) means up to the end of the file.  If offset is
+// given, sending starts there and the file position is left just after the
+// last byte sent, as CPython does.  Returns the number of bytes sent, which
+// can be short if the socket is non-blocking.
+STATIC mp_obj_t socket_sendfile(mp_uint_t n_args, const mp_obj_t *args) {
+    int out_fd = get_fd(args[0]);
+    int in_fd = get_fd(args[1]);
+    bool have_offset = n_args > 2 && args[2] != mp_const_none;
+    off_t offset = 0;
+    if (have_offset) {
+        offset = mp_obj_get_int(args[2]);
+        if (lseek(in_fd, offset, SEEK_SET) == -1) {
+            RAISE_ERRNO(-1, errno);
+        }
+    }
+    mp_uint_t count = 0;
+    if (n_args > 3 && args[3] != mp_const_none) {
+        count = mp_obj_get_int(args[3]);
+    }
+
+    mp_uint_t total = 0;
+    for (;;) {
+        size_t len = 0x7ffff000; // most Linux will move in one call
+        if (count != 0) {
+            if (total >= count) {
+                break;
+            }
+            if (count - total < len) {
+                len = count - total;
+            }
+        }
+        MP_THREAD_GIL_EXIT();
+        #ifdef __linux__
+        ssize_t r = sendfile(out_fd, in_fd, NULL, len);
+        #else
+        byte buf[4096];
+        if (len > sizeof(buf)) {
+            len = sizeof(buf);
+        }
+        ssize_t r = read(in_fd, buf, len);
+        if (r > 0) {
+            ssize_t w = write(out_fd, buf, r);
+            if (w >= 0 && w < r) {
+                // put back what the socket didn't take
+                lseek(in_fd, w - r, SEEK_CUR);
+            }
+            r = w;
+        }
+        #endif
+        MP_THREAD_GIL_ENTER();
+        if (r == -1) {
+            if (total > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            RAISE_ERRNO(r, errno);
+        }
+        if (r == 0) {
+            break;
+        }
+        total += r;
+    }
+    return mp_obj_new_int_from_uint(total);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_sendfile_obj, 2, 4, socket_sendfile);
+
 STATIC mp_obj_t socket_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
     (void)type_in;
     (void)n_kw;
@@ -299,8 +578,16 @@ STATIC const mp_map_elem_t usocket_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_listen), (mp_obj_t)&socket_listen_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_accept), (mp_obj_t)&socket_accept_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv), (mp_obj_t)&socket_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into), (mp_obj_t)&socket_recv_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom_into), (mp_obj_t)&socket_recvfrom_into_obj },
+#ifdef __linux__
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recvmmsg), (mp_obj_t)&socket_recvmmsg_obj },
+#endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_send), (mp_obj_t)&socket_send_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sendv), (mp_obj_t)&socket_sendv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sendfile), (mp_obj_t)&socket_sendfile_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setsockopt), (mp_obj_t)&socket_setsockopt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_getsockopt), (mp_obj_t)&socket_getsockopt_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setblocking), (mp_obj_t)&socket_setblocking_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&socket_close_obj },
 };
@@ -391,7 +678,9 @@ STATIC mp_obj_t mod_socket_getaddrinfo(mp_uint_t n_args, const mp_obj_t *args) {
     }
 
     struct addrinfo *addr_list;
+    MP_THREAD_GIL_EXIT();
     int res = getaddrinfo(host, serv, &hints, &addr_list);
+    MP_THREAD_GIL_ENTER();
 
     if (res != 0) {
         // CPython: socket.gaierror
@@ -420,12 +709,45 @@ STATIC mp_obj_t mod_socket_getaddrinfo(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_socket_getaddrinfo_obj, 2, 6, mod_socket_getaddrinfo);
 
+#ifdef __linux__
+// splice(src, dst, count)
+// Moves up to count bytes between two fds (or objects with fileno()), one
+// of which must be a pipe, without copying them to userspace.  Returns the
+// number of bytes moved, which is less than count only at end of input or
+// when a non-blocking fd would block.
+STATIC mp_obj_t mod_socket_splice(mp_obj_t src_in, mp_obj_t dst_in, mp_obj_t count_in) {
+    int in_fd = get_fd(src_in);
+    int out_fd = get_fd(dst_in);
+    mp_uint_t count = mp_obj_get_int(count_in);
+    mp_uint_t total = 0;
+    while (total < count) {
+        ssize_t r = splice(in_fd, NULL, out_fd, NULL, count - total, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (r == -1) {
+            if (total > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            RAISE_ERRNO(r, errno);
+        }
+        if (r == 0) {
+            break;
+        }
+        total += r;
+    }
+    return mp_obj_new_int_from_uint(total);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mod_socket_splice_obj, mod_socket_splice);
+#endif
+
 extern mp_obj_type_t sockaddr_in_type;
 
 STATIC const mp_map_elem_t mp_module_socket_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_usocket) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_socket), (mp_obj_t)&usocket_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_getaddrinfo), (mp_obj_t)&mod_socket_getaddrinfo_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sendfile), (mp_obj_t)&socket_sendfile_obj },
+#ifdef __linux__
+    { MP_OBJ_NEW_QSTR(MP_QSTR_splice), (mp_obj_t)&mod_socket_splice_obj },
+#endif
 #if MICROPY_SOCKET_EXTRA
     { MP_OBJ_NEW_QSTR(MP_QSTR_sockaddr_in), (mp_obj_t)&sockaddr_in_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_htons), (mp_obj_t)&mod_socket_htons_obj },
@@ -450,6 +772,14 @@ STATIC const mp_map_elem_t mp_module_socket_globals_table[] = {
     C(SO_KEEPALIVE),
     C(SO_LINGER),
     C(SO_REUSEADDR),
+#ifdef SO_REUSEPORT
+    C(SO_REUSEPORT),
+#endif
+    C(SO_RCVBUF),
+    C(SO_SNDBUF),
+
+    C(IPPROTO_TCP),
+    C(TCP_NODELAY),
 #undef C
 };
 
@@ -31,6 +31,7 @@
 #include <math.h>
 
 #include "py/runtime.h"
+#include "py/mpthread.h"
 
 #ifdef _WIN32
 void msec_sleep_tv(struct timeval *tv) {
@@ -71,7 +72,11 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_time_time_obj, mod_time_time);
 
 // Note: this is deprecated since CPy3.3, but pystone still uses it.
 STATIC mp_obj_t mod_time_clock(void) {
-#if MICROPY_PY_BUILTINS_FLOAT
+#if MICROPY_PY_BUILTINS_FLOAT && defined(_WIN32)
+    // clock() only counts milliseconds on Windows, so use the performance
+    // counter; it runs from startup, as clock() does there
+    return mp_obj_new_float(msec_clock() / 1000.0);
+#elif MICROPY_PY_BUILTINS_FLOAT
     // float cannot represent full range of int32 precisely, so we pre-divide
     // int to reduce resolution, and then actually do float division hoping
     // to preserve integer part resolution.
@@ -89,9 +94,14 @@ STATIC mp_obj_t mod_time_sleep(mp_obj_t arg) {
     double ipart;
     tv.tv_usec = round(modf(val, &ipart) * 1000000);
     tv.tv_sec = ipart;
+    MP_THREAD_GIL_EXIT();
     sleep_select(0, NULL, NULL, NULL, &tv);
+    MP_THREAD_GIL_ENTER();
 #else
-    sleep(mp_obj_get_int(arg));
+    mp_int_t secs = mp_obj_get_int(arg);
+    MP_THREAD_GIL_EXIT();
+    sleep(secs);
+    MP_THREAD_GIL_ENTER();
 #endif
     return mp_const_none;
 }
@@ -0,0 +1,369 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "py/nlr.h"
+#include "py/obj.h"
+#include "py/objlist.h"
+#include "py/objtuple.h"
+#include "py/runtime.h"
+#include "py/mpthread.h"
+
+#if MICROPY_PY_USELECT
+
+// On Linux the poll object is backed by epoll, so that waiting on many
+// objects doesn't cost a scan of all of them; elsewhere poll() is used.
+#ifndef MICROPY_PY_USELECT_EPOLL
+#ifdef __linux__
+#define MICROPY_PY_USELECT_EPOLL (1)
+#else
+#define MICROPY_PY_USELECT_EPOLL (0)
+#endif
+#endif
+
+#if MICROPY_PY_USELECT_EPOLL
+#include <sys/epoll.h>
+// Event masks are passed through as is, which relies on the EPOLL* and
+// POLL* bits being the same, as they are on Linux.
+#endif
+
+#define RAISE_ERRNO(err_flag, error_val) \
+    { if (err_flag == -1) \
+        { nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error_val))); } }
+
+/// \module uselect - Provides a poll object to wait for events on file descriptors
+
+/// \class Poll - poll class
+
+typedef struct _mp_obj_poll_t {
+    mp_obj_base_t base;
+    // maps the fd, as a small int, to the object registered for it
+    mp_map_t fd_map;
+    #if MICROPY_PY_USELECT_EPOLL
+    int epfd;
+    struct epoll_event *events;
+    #else
+    // one entry for each registered fd, in no particular order
+    struct pollfd *entries;
+    #endif
+    mp_uint_t alloc;
+    // state of the iteration started by ipoll()
+    mp_uint_t iter_idx;
+    mp_uint_t iter_cnt;
+    mp_obj_tuple_t *ret_tuple;
+} mp_obj_poll_t;
+
+// objects are given as a file descriptor or anything with a fileno() method
+STATIC int poll_get_fd(mp_obj_t obj) {
+    if (MP_OBJ_IS_SMALL_INT(obj)) {
+        return MP_OBJ_SMALL_INT_VALUE(obj);
+    }
+    mp_obj_t dest[2];
+    mp_load_method(obj, MP_QSTR_fileno, dest);
+    return mp_obj_get_int(mp_call_method_n_kw(0, 0, dest));
+}
+
+#if !MICROPY_PY_USELECT_EPOLL
+STATIC struct pollfd *poll_find_entry(mp_obj_poll_t *self, int fd) {
+    for (mp_uint_t i = 0; i < self->fd_map.used; i++) {
+        if (self->entries[i].fd == fd) {
+            return &self->entries[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
+/// \method register(obj[, eventmask])
+/// If obj is already registered its eventmask is replaced.
+STATIC mp_obj_t poll_register(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = args[0];
+    int fd = poll_get_fd(args[1]);
+    mp_uint_t flags;
+    if (n_args == 3) {
+        flags = mp_obj_get_int(args[2]);
+    } else {
+        flags = POLLIN | POLLOUT;
+    }
+
+    mp_map_elem_t *elem = mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    bool is_new = (elem->value == MP_OBJ_NULL);
+
+    #if MICROPY_PY_USELECT_EPOLL
+    struct epoll_event ev;
+    ev.events = flags;
+    ev.data.fd = fd;
+    int res = epoll_ctl(self->epfd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+    if (res == -1) {
+        int err = errno;
+        if (is_new) {
+            mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+        }
+        RAISE_ERRNO(res, err);
+    }
+    #else
+    struct pollfd *entry;
+    if (is_new) {
+        if (self->fd_map.used > self->alloc) {
+            self->entries = m_renew(struct pollfd, self->entries, self->alloc, self->alloc + 4);
+            self->alloc += 4;
+        }
+        entry = &self->entries[self->fd_map.used - 1];
+        entry->fd = fd;
+    } else {
+        entry = poll_find_entry(self, fd);
+    }
+    entry->events = flags;
+    entry->revents = 0;
+    #endif
+
+    elem->value = args[1];
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
+
+/// \method unregister(obj)
+STATIC mp_obj_t poll_unregister(mp_obj_t self_in, mp_obj_t obj_in) {
+    mp_obj_poll_t *self = self_in;
+    int fd = poll_get_fd(obj_in);
+    if (mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP) == NULL) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, obj_in));
+    }
+    #if MICROPY_PY_USELECT_EPOLL
+    // an fd which was closed is already removed from the epoll set by the
+    // kernel, so an error here is not interesting
+    epoll_ctl(self->epfd, EPOLL_CTL_DEL, fd, NULL);
+    #else
+    // move the last entry into the hole left by the removed one
+    *poll_find_entry(self, fd) = self->entries[self->fd_map.used - 1];
+    #endif
+    mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(poll_unregister_obj, poll_unregister);
+
+/// \method modify(obj, eventmask)
+STATIC mp_obj_t poll_modify(mp_obj_t self_in, mp_obj_t obj_in, mp_obj_t eventmask_in) {
+    mp_obj_poll_t *self = self_in;
+    int fd = poll_get_fd(obj_in);
+    if (mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP) == NULL) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(ENOENT)));
+    }
+    #if MICROPY_PY_USELECT_EPOLL
+    struct epoll_event ev;
+    ev.events = mp_obj_get_int(eventmask_in);
+    ev.data.fd = fd;
+    int res = epoll_ctl(self->epfd, EPOLL_CTL_MOD, fd, &ev);
+    RAISE_ERRNO(res, errno);
+    #else
+    poll_find_entry(self, fd)->events = mp_obj_get_int(eventmask_in);
+    #endif
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_3(poll_modify_obj, poll_modify);
+
+// Wait for events and return the number of ready objects.
+// Timeout is in milliseconds, with None or a negative value meaning forever.
+STATIC mp_uint_t poll_wait(mp_obj_poll_t *self, mp_uint_t n_args, const mp_obj_t *args) {
+    int timeout = -1;
+    if (n_args >= 2 && args[1] != mp_const_none) {
+        mp_int_t timeout_i = mp_obj_get_int(args[1]);
+        if (timeout_i >= 0) {
+            timeout = timeout_i;
+        }
+    }
+
+    #if MICROPY_PY_USELECT_EPOLL
+    if (self->alloc < self->fd_map.used || self->alloc == 0) {
+        mp_uint_t new_alloc = self->fd_map.used > 0 ? self->fd_map.used : 1;
+        self->events = m_renew(struct epoll_event, self->events, self->alloc, new_alloc);
+        self->alloc = new_alloc;
+    }
+    MP_THREAD_GIL_EXIT();
+    int n_ready = epoll_wait(self->epfd, self->events, self->alloc, timeout);
+    MP_THREAD_GIL_ENTER();
+    #else
+    MP_THREAD_GIL_EXIT();
+    int n_ready = poll(self->entries, self->fd_map.used, timeout);
+    MP_THREAD_GIL_ENTER();
+    #endif
+    RAISE_ERRNO(n_ready, errno);
+
+    self->iter_idx = 0;
+    self->iter_cnt = n_ready;
+    return n_ready;
+}
+
+// Get the next ready object and its events, or MP_OBJ_NULL if there are no
+// more.  Objects unregistered since the wait are skipped, so it's fine for
+// the caller of ipoll() to unregister objects while iterating.
+STATIC mp_obj_t poll_next_ready(mp_obj_poll_t *self, mp_uint_t *flags_ret) {
+    while (self->iter_cnt > 0) {
+        #if MICROPY_PY_USELECT_EPOLL
+        struct epoll_event *ev = &self->events[self->iter_idx++];
+        int fd = ev->data.fd;
+        *flags_ret = ev->events;
+        #else
+        if (self->iter_idx >= self->fd_map.used) {
+            // entries were moved by unregister
+            self->iter_cnt = 0;
+            break;
+        }
+        struct pollfd *entry = &self->entries[self->iter_idx++];
+        if (entry->revents == 0) {
+            continue;
+        }
+        int fd = entry->fd;
+        *flags_ret = entry->revents;
+        #endif
+        self->iter_cnt--;
+        mp_map_elem_t *elem = mp_map_lookup(&self->fd_map, MP_OBJ_NEW_SMALL_INT(fd), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            return elem->value;
+        }
+    }
+    return MP_OBJ_NULL;
+}
+
+/// \method poll([timeout])
+/// Returns a list of (obj, event) tuples.  Timeout is in milliseconds.
+STATIC mp_obj_t poll_poll(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = args[0];
+    mp_uint_t n_ready = poll_wait(self, n_args, args);
+    mp_obj_list_t *ret_list = mp_obj_new_list(n_ready, NULL);
+    for (mp_uint_t i = 0; i < n_ready; i++) {
+        mp_uint_t flags_ret;
+        mp_obj_t tuple[2];
+        tuple[0] = poll_next_ready(self, &flags_ret);
+        tuple[1] = MP_OBJ_NEW_SMALL_INT(flags_ret);
+        ret_list->items[i] = mp_obj_new_tuple(2, tuple);
+    }
+    return ret_list;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_poll_obj, 1, 2, poll_poll);
+
+/// \method ipoll([timeout])
+/// Like poll(), but returns an iterator over the ready objects.  Each
+/// iteration yields the same (obj, event) tuple, updated in place, so
+/// waiting for events allocates no memory on the heap.
+STATIC mp_obj_t poll_ipoll(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_poll_t *self = args[0];
+    if (self->ret_tuple == MP_OBJ_NULL) {
+        self->ret_tuple = mp_obj_new_tuple(2, NULL);
+    }
+    poll_wait(self, n_args, args);
+    return self;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_ipoll_obj, 1, 2, poll_ipoll);
+
+STATIC mp_obj_t poll_iternext(mp_obj_t self_in) {
+    mp_obj_poll_t *self = self_in;
+    mp_uint_t flags_ret;
+    mp_obj_t obj = poll_next_ready(self, &flags_ret);
+    if (obj == MP_OBJ_NULL) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    self->ret_tuple->items[0] = obj;
+    self->ret_tuple->items[1] = MP_OBJ_NEW_SMALL_INT(flags_ret);
+    return self->ret_tuple;
+}
+
+/// \method close()
+STATIC mp_obj_t poll_close(mp_obj_t self_in) {
+    mp_obj_poll_t *self = self_in;
+    #if MICROPY_PY_USELECT_EPOLL
+    if (self->epfd != -1) {
+        close(self->epfd);
+        self->epfd = -1;
+    }
+    #else
+    (void)self;
+    #endif
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(poll_close_obj, poll_close);
+
+STATIC const mp_map_elem_t poll_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_register), (mp_obj_t)&poll_register_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unregister), (mp_obj_t)&poll_unregister_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_modify), (mp_obj_t)&poll_modify_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_poll), (mp_obj_t)&poll_poll_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ipoll), (mp_obj_t)&poll_ipoll_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&poll_close_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__), (mp_obj_t)&poll_close_obj },
+};
+STATIC MP_DEFINE_CONST_DICT(poll_locals_dict, poll_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_poll = {
+    { &mp_type_type },
+    .name = MP_QSTR_poll,
+    .getiter = mp_identity,
+    .iternext = poll_iternext,
+    .locals_dict = (mp_obj_t)&poll_locals_dict,
+};
+
+/// \function poll()
+STATIC mp_obj_t select_poll(void) {
+    mp_obj_poll_t *poll = m_new_obj_with_finaliser(mp_obj_poll_t);
+    poll->base.type = &mp_type_poll;
+    mp_map_init(&poll->fd_map, 0);
+    #if MICROPY_PY_USELECT_EPOLL
+    poll->epfd = epoll_create(1);
+    RAISE_ERRNO(poll->epfd, errno);
+    poll->events = NULL;
+    #else
+    poll->entries = NULL;
+    #endif
+    poll->alloc = 0;
+    poll->iter_idx = 0;
+    poll->iter_cnt = 0;
+    poll->ret_tuple = MP_OBJ_NULL;
+    return poll;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(mp_select_poll_obj, select_poll);
+
+STATIC const mp_map_elem_t mp_module_select_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uselect) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_poll), (mp_obj_t)&mp_select_poll_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLIN), MP_OBJ_NEW_SMALL_INT(POLLIN) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLOUT), MP_OBJ_NEW_SMALL_INT(POLLOUT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLERR), MP_OBJ_NEW_SMALL_INT(POLLERR) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_POLLHUP), MP_OBJ_NEW_SMALL_INT(POLLHUP) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_select_globals, mp_module_select_globals_table);
+
+const mp_obj_module_t mp_module_uselect = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_uselect,
+    .globals = (mp_obj_dict_t*)&mp_module_select_globals,
+};
+
+#endif // MICROPY_PY_USELECT
@@ -27,6 +27,8 @@
 // options to control how Micro Python is built
 
 #define MICROPY_ALLOC_PATH_MAX      (PATH_MAX)
+#define MICROPY_ALLOC_QSTR_CHUNK_INIT (128)
+#define MICROPY_ALLOC_PARSE_CHUNK_INIT (512)
 #if !defined(MICROPY_EMIT_X64) && defined(__x86_64__)
     #define MICROPY_EMIT_X64        (1)
 #endif
@@ -42,13 +44,48 @@
 #if !defined(MICROPY_EMIT_ARM) && defined(__arm__) && !defined(__thumb2__)
     #define MICROPY_EMIT_ARM        (1)
 #endif
+#define MICROPY_EMIT_NATIVE_FLOAT   (1)
+#define MICROPY_EMIT_NATIVE_JIT     (MICROPY_EMIT_NATIVE)
+#define MICROPY_EMIT_NATIVE_PERF_MAP (MICROPY_EMIT_NATIVE)
+#define MICROPY_PARSE_STREAMING     (1)
 #define MICROPY_COMP_MODULE_CONST   (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
+#define MICROPY_COMP_CLOSURE_BY_VALUE (1)
+#define MICROPY_COMP_CONST_FOLDING_OBJ (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_DEFERRED_FINALISERS (1)
+#define MICROPY_GC_INCREMENTAL      (1)
+// Speed features, which the small profile (mpconfigport_small.h) turns
+// off.  Each one can also be set on the command line, which is how
+// "make size-report" measures their code size.
+#ifndef MICROPY_UNIX_SPEED_OPTS
+#define MICROPY_UNIX_SPEED_OPTS     (1)
+#endif
+#ifndef MICROPY_GC_FREE_LISTS
+#define MICROPY_GC_FREE_LISTS       (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_GC_OBJ_POOLS
+#define MICROPY_GC_OBJ_POOLS        (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#define MICROPY_GC_LAZY_SWEEP       (1)
+#define MICROPY_GC_ALLOC_THRESHOLD  (1)
+#define MICROPY_GC_STATS            (1)
+#define MICROPY_GC_SPLIT_HEAP       (1)
+#define MICROPY_GC_AUTO_GROW        (1)
+// the heap is reserved with mmap, so its pages start out zero
+#define MICROPY_GC_HEAP_ZEROED      (MICROPY_GC_AUTO_GROW)
+#define MICROPY_GC_LARGE_ALLOC_THRESHOLD (128 * 1024)
+#if MICROPY_GC_PARALLEL
+// deeper mark stacks so that the workers rarely overflow them
+#define MICROPY_ALLOC_GC_STACK_SIZE (1024)
+#endif
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_MEM_STATS           (1)
+#define MICROPY_VM_PROFILE          (1)
+#define MICROPY_VM_SAMPLE_PROFILE   (1)
+#define MICROPY_VM_SAMPLE_PROFILE_SLOTS (256)
 #define MICROPY_DEBUG_PRINTERS      (1)
 #define MICROPY_USE_READLINE_HISTORY (1)
 #define MICROPY_HELPER_REPL         (1)
@@ -56,43 +93,151 @@
 #define MICROPY_ENABLE_SOURCE_LINE  (1)
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_DOUBLE)
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
+#define MICROPY_FLOAT_EXACT_CONV    (1)
+// on 64-bit machines floats are stored in the object word, not on the heap
+#if !defined(MICROPY_OBJ_REPR) && (defined(__x86_64__) || defined(__aarch64__))
+#define MICROPY_OBJ_REPR            (MICROPY_OBJ_REPR_C)
+#endif
 #define MICROPY_STREAMS_NON_BLOCK   (1)
-#define MICROPY_OPT_COMPUTED_GOTO   (1)
-#define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
+#define MICROPY_MODULE_LISTDIR_CACHE (1)
+#define MICROPY_MODULE_LAZY_SUBMODULES (1)
+#define MICROPY_MODULE_GETATTR      (1)
+#define MICROPY_MODULE_BUILTIN_INIT (1)
+#ifndef MICROPY_OPT_COMPUTED_GOTO
+#define MICROPY_OPT_COMPUTED_GOTO   (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+#define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_METHOD_CACHE
+#define MICROPY_OPT_METHOD_CACHE    (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_INSTANCE_SHAPES
+#define MICROPY_OPT_INSTANCE_SHAPES (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_CLASS_MRO
+#define MICROPY_OPT_CLASS_MRO       (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_CODE_STATE_CACHE
+#define MICROPY_OPT_CODE_STATE_CACHE (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_KW_ARG_CACHE
+#define MICROPY_OPT_KW_ARG_CACHE    (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_ARG_PARSE
+#define MICROPY_OPT_ARG_PARSE       (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_LAZY_TRACEBACK
+#define MICROPY_OPT_LAZY_TRACEBACK  (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_QSTR_INDEX
+#define MICROPY_OPT_QSTR_INDEX      (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_MAP_COMPACT
+#define MICROPY_OPT_MAP_COMPACT     (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_CACHE_HASH
+#define MICROPY_OPT_CACHE_HASH      (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#define MICROPY_QSTR_BYTES_IN_HASH  (4)
+#define MICROPY_QSTR_HASH           (MICROPY_QSTR_HASH_FNV1A_WORD)
+#ifndef MICROPY_OPT_STR_INPLACE_ADD
+#define MICROPY_OPT_STR_INPLACE_ADD (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_STR_VIEW
+#define MICROPY_OPT_STR_VIEW        (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_STR_INDEX_CACHE
+#define MICROPY_OPT_STR_INDEX_CACHE (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_STABLE_SORT
+#define MICROPY_OPT_STABLE_SORT     (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_NUMERIC_SEQ
+#define MICROPY_OPT_NUMERIC_SEQ     (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_ITER_FUSION
+#define MICROPY_OPT_ITER_FUSION     (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_MULTI_RETURN
+#define MICROPY_OPT_MULTI_RETURN    (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_MPZ_KARATSUBA
+#define MICROPY_OPT_MPZ_KARATSUBA   (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_FUSED_OPCODES
+#define MICROPY_OPT_FUSED_OPCODES   (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_PEEPHOLE
+#define MICROPY_OPT_PEEPHOLE        (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_FOR_RANGE
+#define MICROPY_OPT_FOR_RANGE       (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#ifndef MICROPY_OPT_SMALL_INT_BINARY_OP
+#define MICROPY_OPT_SMALL_INT_BINARY_OP (MICROPY_UNIX_SPEED_OPTS)
+#endif
+#define MICROPY_PERSISTENT_CODE_LOAD (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
+#define MICROPY_PY_SLOTS            (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
+#define MICROPY_PY_BUILTINS_BYTEARRAY_INPLACE_OPS (1)
+#define MICROPY_PY_BUILTINS_BYTEARRAY_RESERVE (1)
 #define MICROPY_PY_BUILTINS_MEMORYVIEW (1)
 #define MICROPY_PY_BUILTINS_FROZENSET (1)
+#define MICROPY_PY_BUILTINS_POW3 (1)
 #define MICROPY_PY_BUILTINS_COMPILE (1)
 #define MICROPY_PY_BUILTINS_NOTIMPLEMENTED (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO (1)
 #define MICROPY_PY_ALL_SPECIAL_METHODS (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
+#define MICROPY_PY_ARRAY_MATH       (1)
 #define MICROPY_PY_SYS_EXIT         (1)
 #define MICROPY_PY_SYS_PLATFORM     "linux"
 #define MICROPY_PY_SYS_MAXSIZE      (1)
 #define MICROPY_PY_SYS_STDFILES     (1)
 #define MICROPY_PY_SYS_EXC_INFO     (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE (1)
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
+#define MICROPY_PY_MATH_ARRAY_FUNCTIONS (1)
 #define MICROPY_PY_CMATH            (1)
 #define MICROPY_PY_IO_FILEIO        (1)
+#define MICROPY_PY_IO_BUFFERED      (1)
 #define MICROPY_PY_GC_COLLECT_RETVAL (1)
 
-#define MICROPY_STACKLESS           (0)
+#define MICROPY_STACKLESS           (1)
 #define MICROPY_STACKLESS_STRICT    (0)
 
 #define MICROPY_PY_UCTYPES          (1)
+#define MICROPY_PY_UCTYPES_LAYOUT   (1)
 #define MICROPY_PY_UZLIB            (1)
+#define MICROPY_PY_UZLIB_COMPRESS   (1)
+#define MICROPY_PY_UZLIB_DECOMPIO   (1)
+#define MICROPY_PY_UZLIB_CRC32_SLICE8 (1)
 #define MICROPY_PY_UJSON            (1)
 #define MICROPY_PY_URE              (1)
+#define MICROPY_PY_URE_SUB          (1)
 #define MICROPY_PY_UHEAPQ           (1)
+#define MICROPY_PY_UHEAPQ_PQUEUE    (1)
 #define MICROPY_PY_UHASHLIB         (1)
+#define MICROPY_PY_UHASHLIB_SHA1    (1)
+#define MICROPY_PY_UHASHLIB_MD5     (1)
 #define MICROPY_PY_UBINASCII        (1)
+#define MICROPY_PY_UCRYPTOLIB       (1)
 #define MICROPY_PY_MACHINE          (1)
+#define MICROPY_PY_UASYNCIO         (MICROPY_PY_USELECT)
+#define MICROPY_PY_URINGBUF         (1)
+#define MICROPY_PY_UWEAKREF         (1)
+#define MICROPY_PY_URANDOM          (1)
+#define MICROPY_PY_FRAMEBUF         (1)
+#define MICROPY_PY_UHTTP            (1)
 
 // Define to MICROPY_ERROR_REPORTING_DETAILED to get function, etc.
 // names in exception messages (may require more RAM).
@@ -109,6 +254,7 @@
     #endif
 #endif
 
+#define MICROPY_ENABLE_SCHEDULER    (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (256)
 
@@ -117,6 +263,8 @@ extern const struct _mp_obj_module_t mp_module_time;
 extern const struct _mp_obj_module_t mp_module_termios;
 extern const struct _mp_obj_module_t mp_module_socket;
 extern const struct _mp_obj_module_t mp_module_ffi;
+extern const struct _mp_obj_module_t mp_module_uselect;
+extern const struct _mp_obj_module_t mp_module_mmap;
 
 #if MICROPY_PY_FFI
 #define MICROPY_PY_FFI_DEF { MP_OBJ_NEW_QSTR(MP_QSTR_ffi), (mp_obj_t)&mp_module_ffi },
@@ -138,11 +286,23 @@ extern const struct _mp_obj_module_t mp_module_ffi;
 #else
 #define MICROPY_PY_SOCKET_DEF
 #endif
+#if MICROPY_PY_USELECT
+#define MICROPY_PY_USELECT_DEF { MP_OBJ_NEW_QSTR(MP_QSTR_uselect), (mp_obj_t)&mp_module_uselect },
+#else
+#define MICROPY_PY_USELECT_DEF
+#endif
+#if MICROPY_PY_MMAP
+#define MICROPY_PY_MMAP_DEF { MP_OBJ_NEW_QSTR(MP_QSTR_mmap), (mp_obj_t)&mp_module_mmap },
+#else
+#define MICROPY_PY_MMAP_DEF
+#endif
 
 #define MICROPY_PORT_BUILTIN_MODULES \
     MICROPY_PY_FFI_DEF \
     MICROPY_PY_TIME_DEF \
     MICROPY_PY_SOCKET_DEF \
+    MICROPY_PY_USELECT_DEF \
+    MICROPY_PY_MMAP_DEF \
     { MP_OBJ_NEW_QSTR(MP_QSTR__os), (mp_obj_t)&mp_module_os }, \
     MICROPY_PY_TERMIOS_DEF \
 
@@ -178,6 +338,16 @@ void mp_unix_mark_exec(void);
 
 #define MP_PLAT_PRINT_STRN(str, len) fwrite(str, 1, len, stdout)
 
+// milliseconds from the monotonic clock, for uasyncio
+mp_uint_t mp_hal_ticks_ms(void);
+
+// writes a symbol for generated code to the perf map, if -X perfmap is on
+void mp_hal_perf_map_add(const void *code, mp_uint_t len, const char *name);
+
+// seed urandom from the nanosecond counter so each run differs
+mp_uint_t mp_hal_ticks_cpu(void);
+#define MICROPY_PY_URANDOM_SEED_INIT_FUNC (mp_hal_ticks_cpu())
+
 extern const struct _mp_obj_fun_builtin_t mp_builtin_input_obj;
 extern const struct _mp_obj_fun_builtin_t mp_builtin_open_obj;
 #define MICROPY_PORT_BUILTINS \
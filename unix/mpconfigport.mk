@@ -15,5 +15,21 @@ MICROPY_PY_TERMIOS = 1
 # Subset of CPython socket module
 MICROPY_PY_SOCKET = 1
 
+# Subset of CPython select module, with poll objects backed by epoll on Linux
+MICROPY_PY_USELECT = 1
+
+# _thread module using pthreads, with a global interpreter lock
+MICROPY_PY_THREAD = 1
+
+# Mark and sweep large heaps using several threads
+MICROPY_GC_PARALLEL = 1
+
+# Reach the interpreter state through a thread-local pointer, so that several
+# independent interpreters can run in one process (needs MICROPY_PY_THREAD = 0)
+MICROPY_MULTIPLE_INTERPRETERS = 0
+
+# Subset of CPython mmap module, with mmap objects giving the buffer protocol
+MICROPY_PY_MMAP = 1
+
 # ffi module requires libffi (libffi-dev Debian package)
 MICROPY_PY_FFI = 1
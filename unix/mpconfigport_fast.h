@@ -33,3 +33,14 @@
 // 91 is a magic number proposed by @dpgeorge, which make pystone run ~ at tie
 // with CPython 3.4.
 #define MICROPY_MODULE_DICT_SIZE (91)
+
+// the instrumentation of the standard build costs time on every allocation
+// and opcode, so it is left out
+#undef MICROPY_MEM_STATS
+#define MICROPY_MEM_STATS (0)
+#undef MICROPY_VM_PROFILE
+#define MICROPY_VM_PROFILE (0)
+#undef MICROPY_VM_SAMPLE_PROFILE
+#define MICROPY_VM_SAMPLE_PROFILE (0)
+#undef MICROPY_GC_STATS
+#define MICROPY_GC_STATS (0)
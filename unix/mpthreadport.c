@@ -0,0 +1,252 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "py/mpstate.h"
+#include "py/gc.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_THREAD
+
+// stack size for new threads if _thread.stack_size() isn't set, and the least
+// that is allowed
+#define THREAD_STACK_SIZE_DEFAULT (256 * 1024)
+#define THREAD_STACK_SIZE_MIN (32 * 1024)
+
+// There is one of these for each running thread, in a linked list
+typedef struct _thread_t {
+    pthread_t id;
+    void *(*entry)(void*);
+    // holds the thread's function and arguments, so it's a GC root
+    void *arg;
+    mp_state_thread_t *state;
+    // the stack pointer (0 if the thread hasn't run any Python code yet) and
+    // callee-save registers when the thread last released the GIL; while it
+    // runs without the GIL, its stack below sp belongs to C code only
+    mp_uint_t sp;
+    mp_uint_t regs[MP_THREAD_GC_REGS_WORDS];
+    struct _thread_t *next;
+} thread_t;
+
+__thread mp_state_thread_t *mp_thread_state;
+STATIC __thread thread_t *thread_current;
+
+STATIC pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC thread_t *thread_list;
+
+// The GIL is a flag guarded by a mutex, with a condition variable to wait
+// for it, rather than a plain mutex: that way mp_thread_gil_yield() can wait
+// until another thread has actually taken it, instead of just taking it back.
+STATIC struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool locked;
+    // number of threads waiting for the GIL; read without the mutex by
+    // mp_thread_gil_yield(), which doesn't need an exact value
+    volatile unsigned int waiting;
+    // incremented each time the GIL is taken
+    unsigned int serial;
+} gil = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, 0, 0 };
+
+void mp_thread_init(void) {
+    // the main thread's state is in mp_state_ctx
+    STATIC thread_t main_thread;
+    main_thread.id = pthread_self();
+    main_thread.state = &mp_state_ctx.thread;
+    thread_list = &main_thread;
+    thread_current = &main_thread;
+    mp_thread_state = &mp_state_ctx.thread;
+    mp_thread_gil_enter();
+}
+
+bool mp_thread_deinit(void) {
+    pthread_mutex_lock(&thread_mutex);
+    bool others = thread_list != thread_current || thread_list->next != NULL;
+    pthread_mutex_unlock(&thread_mutex);
+    return others;
+}
+
+void mp_thread_set_state(mp_state_thread_t *state) {
+    mp_thread_state = state;
+    thread_current->state = state;
+}
+
+STATIC void *thread_entry(void *th_in) {
+    thread_current = th_in;
+    return thread_current->entry(thread_current->arg);
+}
+
+void mp_thread_create(void *(*entry)(void*), void *arg, mp_uint_t *stack_size) {
+    if (*stack_size == 0) {
+        *stack_size = THREAD_STACK_SIZE_DEFAULT;
+    } else if (*stack_size < THREAD_STACK_SIZE_MIN) {
+        *stack_size = THREAD_STACK_SIZE_MIN;
+    }
+
+    thread_t *th = malloc(sizeof(thread_t));
+    if (th == NULL) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(ENOMEM)));
+    }
+    th->entry = entry;
+    th->arg = arg;
+    th->state = NULL;
+    th->sp = 0;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, *stack_size);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    // the thread is added to the list before it starts, so that its
+    // arguments are kept alive
+    pthread_mutex_lock(&thread_mutex);
+    th->next = thread_list;
+    thread_list = th;
+    int ret = pthread_create(&th->id, &attr, thread_entry, th);
+    if (ret != 0) {
+        thread_list = th->next;
+    }
+    pthread_mutex_unlock(&thread_mutex);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        free(th);
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(ret)));
+    }
+}
+
+STATIC void gil_release(void) {
+    pthread_mutex_lock(&gil.mutex);
+    gil.locked = false;
+    pthread_mutex_unlock(&gil.mutex);
+    pthread_cond_signal(&gil.cond);
+}
+
+void mp_thread_finish(void) {
+    thread_t *th = thread_current;
+    pthread_mutex_lock(&thread_mutex);
+    for (thread_t **p = &thread_list; *p != NULL; p = &(*p)->next) {
+        if (*p == th) {
+            *p = th->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread_mutex);
+    free(th);
+    gil_release();
+}
+
+void mp_thread_mutex_init(mp_thread_mutex_t *mutex) {
+    sem_init(mutex, 0, 1);
+}
+
+// returns 1 if the lock was taken, 0 if not (only when not waiting), or a
+// negative errno value on error
+int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait) {
+    int ret;
+    if (wait) {
+        do {
+            ret = sem_wait(mutex);
+        } while (ret == -1 && errno == EINTR);
+    } else {
+        ret = sem_trywait(mutex);
+    }
+    if (ret == 0) {
+        return 1;
+    } else if (errno == EAGAIN) {
+        return 0;
+    }
+    return -errno;
+}
+
+void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex) {
+    sem_post(mutex);
+}
+
+// must be called with gil.mutex held
+STATIC void gil_take(void) {
+    gil.waiting += 1;
+    while (gil.locked) {
+        pthread_cond_wait(&gil.cond, &gil.mutex);
+    }
+    gil.waiting -= 1;
+    gil.locked = true;
+    gil.serial += 1;
+}
+
+void mp_thread_gil_enter(void) {
+    pthread_mutex_lock(&gil.mutex);
+    gil_take();
+    pthread_mutex_unlock(&gil.mutex);
+}
+
+void mp_thread_gil_exit(void) {
+    thread_current->sp = gc_helper_save_regs(thread_current->regs);
+    gil_release();
+}
+
+void mp_thread_gil_yield(void) {
+    if (gil.waiting == 0) {
+        return;
+    }
+    thread_current->sp = gc_helper_save_regs(thread_current->regs);
+    pthread_mutex_lock(&gil.mutex);
+    gil.locked = false;
+    pthread_cond_signal(&gil.cond);
+    // let a waiting thread take the GIL before taking it back
+    unsigned int serial = gil.serial;
+    gil.waiting += 1;
+    while (gil.locked || gil.serial == serial) {
+        pthread_cond_wait(&gil.cond, &gil.mutex);
+    }
+    gil.waiting -= 1;
+    gil.locked = true;
+    gil.serial += 1;
+    pthread_mutex_unlock(&gil.mutex);
+}
+
+// Called by gc_collect, with the GIL held, to scan the threads other than
+// the current one
+void mp_thread_gc_others(void) {
+    pthread_mutex_lock(&thread_mutex);
+    for (thread_t *th = thread_list; th != NULL; th = th->next) {
+        gc_collect_root(&th->arg, 1);
+        if (th == thread_current || th->sp == 0) {
+            continue;
+        }
+        gc_collect_thread_state(th->state);
+        gc_collect_root((void**)th->regs, MP_THREAD_GC_REGS_WORDS);
+        gc_collect_root((void**)th->sp, ((mp_uint_t)th->state->stack_top - th->sp) / sizeof(mp_uint_t));
+    }
+    pthread_mutex_unlock(&thread_mutex);
+}
+
+#endif // MICROPY_PY_THREAD
@@ -0,0 +1,47 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef __MICROPY_INCLUDED_UNIX_MPTHREADPORT_H__
+#define __MICROPY_INCLUDED_UNIX_MPTHREADPORT_H__
+
+#include <semaphore.h>
+
+// A semaphore rather than a pthread mutex, because a _thread lock may be
+// released by a thread other than the one that acquired it.
+typedef sem_t mp_thread_mutex_t;
+
+extern __thread struct _mp_state_thread_t *mp_thread_state;
+
+static inline struct _mp_state_thread_t *mp_thread_get_state(void) {
+    return mp_thread_state;
+}
+
+// Room for the registers saved by gc_helper_save_regs(), which is enough for
+// the callee-save registers of any supported arch or for a jmp_buf.
+#define MP_THREAD_GC_REGS_WORDS (32)
+
+mp_uint_t gc_helper_save_regs(mp_uint_t *regs);
+
+#endif // __MICROPY_INCLUDED_UNIX_MPTHREADPORT_H__
@@ -71,7 +71,14 @@ Q(listen)
 Q(accept)
 Q(recv)
 Q(setsockopt)
+Q(getsockopt)
 Q(setblocking)
+Q(sendfile)
+Q(sendv)
+Q(recv_into)
+Q(recvfrom_into)
+Q(recvmmsg)
+Q(splice)
 
 Q(AF_UNIX)
 Q(AF_INET)
@@ -89,6 +96,42 @@ Q(SO_ERROR)
 Q(SO_KEEPALIVE)
 Q(SO_LINGER)
 Q(SO_REUSEADDR)
+Q(SO_REUSEPORT)
+Q(SO_RCVBUF)
+Q(SO_SNDBUF)
+Q(IPPROTO_TCP)
+Q(TCP_NODELAY)
+
+#if MICROPY_PY_USELECT
+Q(uselect)
+Q(poll)
+Q(register)
+Q(unregister)
+Q(modify)
+Q(ipoll)
+Q(POLLIN)
+Q(POLLOUT)
+Q(POLLERR)
+Q(POLLHUP)
+#endif
+
+#if MICROPY_PY_MMAP
+Q(mmap)
+Q(fileno)
+Q(length)
+Q(flags)
+Q(prot)
+Q(access)
+Q(offset)
+Q(MAP_SHARED)
+Q(MAP_PRIVATE)
+Q(PROT_READ)
+Q(PROT_WRITE)
+Q(ACCESS_DEFAULT)
+Q(ACCESS_READ)
+Q(ACCESS_WRITE)
+Q(ACCESS_COPY)
+#endif
 
 #if MICROPY_PY_TERMIOS
 Q(termios)
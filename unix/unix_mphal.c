@@ -0,0 +1,86 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "py/mpconfig.h"
+
+mp_uint_t mp_hal_ticks_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// used by the VM profiler, so the ticks are nanoseconds
+mp_uint_t mp_hal_ticks_cpu(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#if MICROPY_EMIT_NATIVE_PERF_MAP
+// /tmp/perf-<pid>.map, opened by the -X perfmap option; perf reads the
+// symbols of generated code from it
+FILE *mp_unix_perf_map = NULL;
+
+void mp_hal_perf_map_add(const void *code, mp_uint_t len, const char *name) {
+    if (mp_unix_perf_map != NULL) {
+        fprintf(mp_unix_perf_map, "%lx %lx %s\n", (unsigned long)(mp_uint_t)code, (unsigned long)len, name);
+        fflush(mp_unix_perf_map);
+    }
+}
+#endif
+
+#if MICROPY_VM_SAMPLE_PROFILE
+#include <signal.h>
+#include <sys/time.h>
+
+#include "py/bc.h"
+
+STATIC void sample_handler(int signum) {
+    (void)signum;
+    mp_vm_sample();
+}
+
+// Samples are taken on SIGPROF, so the period is of CPU time used by the
+// process, in multiples of the kernel's tick.
+void mp_hal_sample_timer(mp_uint_t period_us) {
+    if (period_us != 0) {
+        struct sigaction sa;
+        sa.sa_handler = sample_handler;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGPROF, &sa, NULL);
+    }
+    struct itimerval it;
+    it.it_interval.tv_sec = period_us / 1000000;
+    it.it_interval.tv_usec = period_us % 1000000;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+#endif
@@ -28,10 +28,34 @@
 #include <stdio.h>
 #include <windows.h>
 
-HANDLE hSleepEvent = NULL;
+#include "py/mpconfig.h"
+
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION (0x00000002)
+#endif
+
+typedef HANDLE (WINAPI *create_waitable_timer_ex_t)(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+
+HANDLE hSleepTimer = NULL;
+STATIC BOOL timer_period_raised = FALSE;
 
 void init() {
-    hSleepEvent = CreateEvent(NULL, TRUE, FALSE, FALSE);
+    mp_hal_ticks_init();
+    // high resolution timers are only supported since Windows 10 1803, and
+    // CreateWaitableTimerEx since Vista, so it's looked up at run time
+    create_waitable_timer_ex_t create_timer_ex = (create_waitable_timer_ex_t)
+        GetProcAddress(GetModuleHandleA("kernel32.dll"), "CreateWaitableTimerExW");
+    if (create_timer_ex != NULL) {
+        hSleepTimer = create_timer_ex(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    }
+    if (hSleepTimer == NULL) {
+        hSleepTimer = CreateWaitableTimer(NULL, TRUE, NULL);
+        timer_period_raised = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
 #ifdef __MINGW32__
     putenv("PRINTF_EXPONENT_DIGITS=2");
 #else
@@ -40,7 +64,10 @@ void init() {
 }
 
 void deinit() {
-    if (hSleepEvent != NULL) {
-        CloseHandle(hSleepEvent);
+    if (hSleepTimer != NULL) {
+        CloseHandle(hSleepTimer);
+    }
+    if (timer_period_raised) {
+        timeEndPeriod(1);
     }
 }
@@ -72,6 +72,8 @@
 #define MICROPY_PY_UHEAPQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
 #define MICROPY_PY_UBINASCII        (1)
+#define MICROPY_PY_USELECT          (1)
+#define MICROPY_PY_UASYNCIO         (1)
 
 #define MICROPY_ERROR_REPORTING     (MICROPY_ERROR_REPORTING_DETAILED)
 #ifdef _MSC_VER
@@ -125,9 +127,11 @@ extern const struct _mp_obj_fun_builtin_t mp_builtin_open_obj;
 
 extern const struct _mp_obj_module_t mp_module_os;
 extern const struct _mp_obj_module_t mp_module_time;
+extern const struct _mp_obj_module_t mp_module_uselect;
 #define MICROPY_PORT_BUILTIN_MODULES \
     { MP_OBJ_NEW_QSTR(MP_QSTR_time), (mp_obj_t)&mp_module_time }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR__os), (mp_obj_t)&mp_module_os }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_uselect), (mp_obj_t)&mp_module_uselect }, \
 
 // We need to provide a declaration/definition of alloca()
 #include <malloc.h>
@@ -137,6 +141,12 @@ extern const struct _mp_obj_module_t mp_module_time;
 
 // sleep for given number of milliseconds
 void msec_sleep(double msec);
+// make the sleep timer fire after the given number of milliseconds
+void msec_timer_start(double msec);
+// milliseconds since startup, from the performance counter
+void mp_hal_ticks_init(void);
+double msec_clock(void);
+mp_uint_t mp_hal_ticks_ms(void);
 
 // MSVC specifics
 #ifdef _MSC_VER
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <stdbool.h>
+
+#include "py/mpconfig.h"
+#include "poll.h"
+
+// Windows has no poll() for the C runtime's file descriptors, and they
+// can't be used with I/O completion ports either, since that needs handles
+// opened for overlapped I/O.  Instead each descriptor is checked according
+// to what its handle is, and the wait is done on the handles that can be
+// waited on, which are console inputs, together with the sleep timer for
+// the timeout.  Pipes give no signal when data arrives, so while any pipe
+// is polled the wait is cut short to check them again.
+
+#define POLL_PIPE_RECHECK_MS (1.0)
+
+extern HANDLE hSleepTimer;
+
+// returns true if the console has a key press to read; other input events
+// would keep the handle signalled, so they are discarded (as _kbhit does)
+STATIC bool poll_console_has_key(HANDLE h) {
+    INPUT_RECORD rec;
+    DWORD n;
+    while (PeekConsoleInputW(h, &rec, 1, &n) && n > 0) {
+        if (rec.EventType == KEY_EVENT && rec.Event.KeyEvent.bKeyDown) {
+            return true;
+        }
+        ReadConsoleInputW(h, &rec, 1, &n);
+    }
+    return false;
+}
+
+// Returns the events that are ready on the descriptor now.  If none are,
+// then *wait_handle is set to a handle that is signalled when there may be,
+// or *recheck is set if there is no such handle.
+STATIC short poll_fd(struct pollfd *pfd, HANDLE *wait_handle, bool *recheck) {
+    HANDLE h = (HANDLE)_get_osfhandle(pfd->fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        return POLLNVAL;
+    }
+    short ready;
+    switch (GetFileType(h)) {
+        case FILE_TYPE_CHAR: {
+            DWORD n_events;
+            if (GetNumberOfConsoleInputEvents(h, &n_events)) {
+                // console input
+                if (poll_console_has_key(h)) {
+                    ready = POLLIN;
+                } else {
+                    ready = 0;
+                    *wait_handle = h;
+                }
+            } else {
+                // console output, or a device such as NUL
+                ready = POLLIN | POLLOUT;
+            }
+            break;
+        }
+
+        case FILE_TYPE_PIPE: {
+            DWORD avail;
+            // there's no telling whether a write would block
+            ready = POLLOUT;
+            if (PeekNamedPipe(h, NULL, 0, NULL, &avail, NULL)) {
+                if (avail > 0) {
+                    ready |= POLLIN;
+                } else if (pfd->events & POLLIN) {
+                    *recheck = true;
+                }
+            } else if (GetLastError() == ERROR_BROKEN_PIPE) {
+                ready |= POLLHUP;
+            }
+            break;
+        }
+
+        default:
+            // regular files are always ready, as on other systems
+            ready = POLLIN | POLLOUT;
+            break;
+    }
+    return ready & (pfd->events | POLLERR | POLLHUP | POLLNVAL);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+    double deadline = msec_clock() + timeout;
+    for (;;) {
+        HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+        DWORD n_handles = 0;
+        bool recheck = false;
+        int n_ready = 0;
+        for (nfds_t i = 0; i < nfds; i++) {
+            HANDLE wait_handle = NULL;
+            fds[i].revents = poll_fd(&fds[i], &wait_handle, &recheck);
+            if (fds[i].revents != 0) {
+                n_ready += 1;
+            } else if (wait_handle != NULL) {
+                if (n_handles < MAXIMUM_WAIT_OBJECTS - 1) {
+                    handles[n_handles++] = wait_handle;
+                } else {
+                    recheck = true;
+                }
+            }
+        }
+        if (n_ready > 0 || timeout == 0) {
+            return n_ready;
+        }
+
+        // wait until something may be ready, or the timeout
+        double wait_ms = -1;
+        if (timeout > 0) {
+            wait_ms = deadline - msec_clock();
+            if (wait_ms <= 0) {
+                return 0;
+            }
+        }
+        if (recheck && (wait_ms < 0 || wait_ms > POLL_PIPE_RECHECK_MS)) {
+            wait_ms = POLL_PIPE_RECHECK_MS;
+        }
+        if (wait_ms >= 0) {
+            msec_timer_start(wait_ms);
+            handles[n_handles++] = hSleepTimer;
+        }
+        if (n_handles == 0) {
+            // nothing to wait for, and no timeout
+            Sleep(INFINITE);
+        } else {
+            WaitForMultipleObjects(n_handles, handles, FALSE, INFINITE);
+        }
+    }
+}
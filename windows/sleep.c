@@ -26,9 +26,24 @@
 
 #include <windows.h>
 
-extern HANDLE hSleepEvent;
+#include "py/mpconfig.h"
+
+extern HANDLE hSleepTimer;
+
+// The timer is high resolution where Windows supports it.  Elsewhere init()
+// raises the resolution of the system timer to 1ms, instead of the default
+// of 15.6ms which a Sleep(1) would otherwise round up to.
+void msec_timer_start(double msec) {
+    LARGE_INTEGER due;
+    // a negative due time is relative, in units of 100ns
+    due.QuadPart = -(LONGLONG)(msec * 10000.0);
+    SetWaitableTimer(hSleepTimer, &due, 0, NULL, NULL, FALSE);
+}
 
 void msec_sleep(double msec) {
-    ResetEvent(hSleepEvent);
-    WaitForSingleObjectEx(hSleepEvent, msec, FALSE);
+    if (msec <= 0) {
+        return;
+    }
+    msec_timer_start(msec);
+    WaitForSingleObject(hSleepTimer, INFINITE);
 }
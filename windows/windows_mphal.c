@@ -0,0 +1,65 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <windows.h>
+
+#include "py/mpconfig.h"
+
+// All timing is done with the performance counter, which has a resolution
+// well below a microsecond, rather than with clock() or GetTickCount(),
+// which only advance with the system timer (every 1ms to 15.6ms).
+
+STATIC LARGE_INTEGER ticks_freq;
+STATIC LARGE_INTEGER ticks_start;
+
+void mp_hal_ticks_init(void) {
+    QueryPerformanceFrequency(&ticks_freq);
+    QueryPerformanceCounter(&ticks_start);
+}
+
+// ticks since mp_hal_ticks_init in units of 1/scale seconds; the count is
+// split so that the multiplication doesn't overflow
+STATIC unsigned long long ticks_scaled(unsigned long long scale) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    unsigned long long t = now.QuadPart - ticks_start.QuadPart;
+    unsigned long long f = ticks_freq.QuadPart;
+    return t / f * scale + t % f * scale / f;
+}
+
+double msec_clock(void) {
+    return ticks_scaled(1000000) / 1000.0;
+}
+
+mp_uint_t mp_hal_ticks_ms(void) {
+    return ticks_scaled(1000);
+}
+
+// used by the VM profiler, so the ticks are nanoseconds
+mp_uint_t mp_hal_ticks_cpu(void) {
+    return ticks_scaled(1000000000);
+}